@@ -52,6 +52,17 @@ ulong timer_get_boot_us(void)
 	return lldiv(get_ticks(), gd->arch.timer_rate_hz / 1000000);
 }
 
+u64 timer_get_boot_ns(void)
+{
+	u64 ticks = get_ticks();
+	u32 rem;
+
+	rem = do_div(ticks, gd->arch.timer_rate_hz);
+
+	return ticks * 1000000000 +
+		lldiv((u64)rem * 1000000000, gd->arch.timer_rate_hz);
+}
+
 ulong get_tbclk(void)
 {
 	return gd->arch.timer_rate_hz;
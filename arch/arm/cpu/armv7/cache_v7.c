@@ -130,6 +130,14 @@ void invalidate_dcache_range(unsigned long start, unsigned long stop)
  */
 void flush_dcache_range(unsigned long start, unsigned long stop)
 {
+#ifdef CONFIG_SYS_DCACHE_FLUSH_ALL_SIZE
+	/* Cheaper than walking a large range line by line */
+	if (CONFIG_SYS_DCACHE_FLUSH_ALL_SIZE &&
+	    stop - start >= CONFIG_SYS_DCACHE_FLUSH_ALL_SIZE) {
+		flush_dcache_all();
+		return;
+	}
+#endif
 	check_cache_range(start, stop);
 
 	v7_dcache_maint_range(start, stop, ARMV7_DCACHE_CLEAN_INVAL_RANGE);
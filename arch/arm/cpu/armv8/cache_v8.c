@@ -456,6 +456,14 @@ void invalidate_dcache_range(unsigned long start, unsigned long stop)
  */
 void flush_dcache_range(unsigned long start, unsigned long stop)
 {
+#ifdef CONFIG_SYS_DCACHE_FLUSH_ALL_SIZE
+	/* Cheaper than walking a large range line by line */
+	if (CONFIG_SYS_DCACHE_FLUSH_ALL_SIZE &&
+	    stop - start >= CONFIG_SYS_DCACHE_FLUSH_ALL_SIZE) {
+		flush_dcache_all();
+		return;
+	}
+#endif
 	__asm_flush_dcache_range(start, stop);
 }
 
@@ -498,11 +506,6 @@ u64 *__weak arch_get_page_table(void) {
 	return NULL;
 }
 
-static bool is_aligned(u64 addr, u64 size, u64 align)
-{
-	return !(addr & (align - 1)) && !(size & (align - 1));
-}
-
 /* Use flag to indicate if attrs has more than d-cache attributes */
 static u64 set_one_region(u64 start, u64 size, u64 attrs, bool flag, int level)
 {
@@ -510,8 +513,14 @@ static u64 set_one_region(u64 start, u64 size, u64 attrs, bool flag, int level)
 	u64 levelsize = 1ULL << levelshift;
 	u64 *pte = find_pte(start, level);
 
-	/* Can we can just modify the current level block PTE? */
-	if (is_aligned(start, size, levelsize)) {
+	/*
+	 * Can we just modify the current level block PTE? The range only
+	 * needs to cover the whole block, what is left over is dealt with by
+	 * the next call. A table PTE (level 3 pages look the same) has to be
+	 * walked instead, its attributes do not apply to the entries below.
+	 */
+	if (!(start & (levelsize - 1)) && size >= levelsize &&
+	    (level == 3 || pte_type(pte) != PTE_TYPE_TABLE)) {
 		if (flag) {
 			*pte &= ~PMD_ATTRMASK;
 			*pte |= attrs & PMD_ATTRMASK;
@@ -540,24 +549,55 @@ static u64 set_one_region(u64 start, u64 size, u64 attrs, bool flag, int level)
 	return 0;
 }
 
-void mmu_set_region_dcache_behaviour(phys_addr_t start, size_t size,
-				     enum dcache_option option)
+void mmu_region_batch_begin(void)
 {
-	u64 attrs = PMD_ATTRINDX(option);
-	u64 real_start = start;
-	u64 real_size = size;
-
-	debug("start=%lx size=%lx\n", (ulong)start, (ulong)size);
-
 	if (!gd->arch.tlb_emerg)
 		panic("Emergency page table not setup.");
 
+	if (gd->arch.tlb_batch++)
+		return;
+
 	/*
 	 * We can not modify page tables that we're currently running on,
 	 * so we first need to switch to the "emergency" page tables where
 	 * we can safely modify our primary page tables and then switch back
 	 */
 	__asm_switch_ttbr(gd->arch.tlb_emerg);
+}
+
+static void region_batch_end(bool flush)
+{
+	if (--gd->arch.tlb_batch)
+		return;
+
+	/* We're done modifying page tables, switch back to our primary ones */
+	__asm_switch_ttbr(gd->arch.tlb_addr);
+
+	/*
+	 * Make sure there's nothing stale in dcache for the regions that
+	 * might have caches off now. One pass over the whole cache is cheaper
+	 * than cleaning every region by address.
+	 */
+	if (flush)
+		flush_dcache_all();
+}
+
+void mmu_region_batch_end(void)
+{
+	region_batch_end(true);
+}
+
+void mmu_set_region_dcache_behaviour(phys_addr_t start, size_t size,
+				     enum dcache_option option)
+{
+	u64 attrs = PMD_ATTRINDX(option);
+	u64 real_start = start;
+	u64 real_size = size;
+	bool batched = gd->arch.tlb_batch;
+
+	debug("start=%lx size=%lx\n", (ulong)start, (ulong)size);
+
+	mmu_region_batch_begin();
 
 	/*
 	 * Loop through the address range until we find a page granule that fits
@@ -580,14 +620,9 @@ void mmu_set_region_dcache_behaviour(phys_addr_t start, size_t size,
 
 	}
 
-	/* We're done modifying page tables, switch back to our primary ones */
-	__asm_switch_ttbr(gd->arch.tlb_addr);
-
-	/*
-	 * Make sure there's nothing stale in dcache for a region that might
-	 * have caches off now
-	 */
-	flush_dcache_range(real_start, real_start + real_size);
+	region_batch_end(false);
+	if (!batched)
+		flush_dcache_range(real_start, real_start + real_size);
 }
 
 /*
@@ -602,6 +637,11 @@ void mmu_change_region_attr(phys_addr_t addr, size_t siz, u64 attrs)
 
 	start = addr;
 	size = siz;
+
+	/* In a batch the primary page tables are not in use: no need to break */
+	if (gd->arch.tlb_batch)
+		goto make;
+
 	/*
 	 * Loop through the address range until we find a page granule that fits
 	 * our alignment constraints, then set it to "invalid".
@@ -630,6 +670,7 @@ void mmu_change_region_attr(phys_addr_t addr, size_t siz, u64 attrs)
 	 */
 	start = addr;
 	size = siz;
+make:
 	while (size > 0) {
 		for (level = 1; level < 4; level++) {
 			/* Set PTE to new attributes */
@@ -642,6 +683,9 @@ void mmu_change_region_attr(phys_addr_t addr, size_t siz, u64 attrs)
 			}
 		}
 	}
+	/* The TLBs are invalidated when the batch switches back */
+	if (gd->arch.tlb_batch)
+		return;
 	flush_dcache_range(gd->arch.tlb_addr,
 			   gd->arch.tlb_addr + gd->arch.tlb_size);
 	__asm_invalidate_tlb_all();
@@ -684,6 +728,14 @@ void mmu_set_region_dcache_behaviour(phys_addr_t start, size_t size,
 {
 }
 
+void mmu_region_batch_begin(void)
+{
+}
+
+void mmu_region_batch_end(void)
+{
+}
+
 #endif	/* CONFIG_SYS_DCACHE_OFF */
 
 #ifndef CONFIG_SYS_ICACHE_OFF
@@ -53,10 +53,13 @@ struct aspeed_verify_info {
 	u8 *signature;
 	u8 *digest;
 	u8 *rsa_key;
+	u8 *image_digest;	/* computed already, or NULL */
 	struct aspeed_secboot_header *sb_header;
 };
 
 extern int aspeed_bl2_verify(void *bl2_image, void *bl1_image);
 extern int aspeed_verify_boot(void *cur_image, void *next_image);
+extern u32 aspeed_bl2_sha_mode(void *bl1_image);
+extern int aspeed_bl2_verify_digest(void *bl2_image, void *bl1_image, u8 *digest);
 
 #endif /* #ifndef _ASPEED_VERIFY_H_ */
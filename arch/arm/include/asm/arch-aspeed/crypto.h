@@ -7,6 +7,8 @@
 #ifndef _CRYPTO_H_
 #define _CRYPTO_H_
 
+#include <asm/cache.h>
+
 #define ASPEED_SHA224		0x0
 #define ASPEED_SHA256		0x1
 #define ASPEED_SHA384		0x2
@@ -41,6 +43,21 @@ struct aspeed_sg_list {
 	u32 phy_addr;
 } __packed;
 
+/* Accumulative digest: allocate with memalign(ARCH_DMA_MINALIGN, ...) */
+struct aspeed_digest_ctx {
+	u8 digest[64] __aligned(ARCH_DMA_MINALIGN);
+	u8 buffer[256] __aligned(ARCH_DMA_MINALIGN);
+	u32 method;
+	u32 cmd;
+	u32 block_size;
+	u32 bufcnt;
+	u64 total;
+	bool pending;
+};
+
+extern int aspeed_digest_init(struct aspeed_digest_ctx *ctx, u32 method);
+extern int aspeed_digest_update(struct aspeed_digest_ctx *ctx, u8 *src, u32 length);
+extern int aspeed_digest_final(struct aspeed_digest_ctx *ctx, u8 *digest);
 extern int aspeed_sg_digest(struct aspeed_sg_list *src_list, u32 list_length, u32 length, u8 *digest, u32 method);
 extern int digest_object(u8 *src, u32 length, u8 *digest, u32 method);
 extern int aes256ctr_decrypt_object(u8 *src, u8 *dst, u32 length, u8 *context);
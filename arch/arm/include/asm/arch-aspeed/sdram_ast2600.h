@@ -157,6 +157,23 @@ struct ast2600_sdrammc_regs {
 	u32 reserved0[6];		/* offset 0x88 ~ 0x9C */
 };
 
+/*
+ * Save the DDR-PHY training of this boot to the boot flash, for the next SPL
+ * to skip the full memory test with. This does nothing when the training was
+ * already as good as the saved one.
+ *
+ * @return 0 if OK, -ve on error
+ */
+int ast2600_sdrammc_save_training(void);
+
+/*
+ * Wait for the ECC initialization which the DRAM driver started in the
+ * background, if it is still running. The DRAM must not be accessed before.
+ *
+ * @return 0 if OK, -ve on error
+ */
+int ast2600_sdrammc_ecc_wait(void);
+
 #endif  /* __ASSEMBLY__ */
 
 #endif  /* _ASM_ARCH_SDRAM_AST2600_H */
@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Job offload to the secondary Cortex-A7 of the AST2600
+ */
+
+#ifndef _ASPEED_SMP_H_
+#define _ASPEED_SMP_H_
+
+/**
+ * aspeed_smp_job_submit() - queue @fn(@arg) on the secondary core
+ *
+ * The core is released from the boot mailbox on the first call. A job
+ * runs with the MMU and caches on, but must not use malloc, the console
+ * or any driver: nothing in U-Boot expects to be entered from two cores.
+ * Buffers are handed over by cleaning the whole data cache, so the caller
+ * must not touch the job's memory until aspeed_smp_job_wait() returns.
+ *
+ * @return job number to wait for, -EBUSY if the queue is full, or another
+ *	   -ve error if the core could not be started
+ */
+int aspeed_smp_job_submit(int (*fn)(void *arg), void *arg);
+
+/**
+ * aspeed_smp_job_done() - check whether a job has finished
+ *
+ * @return true if aspeed_smp_job_wait() would not block
+ */
+bool aspeed_smp_job_done(int job);
+
+/**
+ * aspeed_smp_job_wait() - wait for a job and release its queue slot
+ *
+ * @return the value returned by the job function
+ */
+int aspeed_smp_job_wait(int job);
+
+/**
+ * aspeed_smp_stop() - return the secondary core to the boot mailbox
+ *
+ * Waits for queued jobs, then parks the core with its MMU off so that the
+ * OS can release it the usual way. Called before booting an OS.
+ */
+void aspeed_smp_stop(void);
+
+#endif
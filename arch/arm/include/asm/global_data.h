@@ -41,6 +41,7 @@ struct arch_global_data {
 #if defined(CONFIG_ARM64)
 	unsigned long tlb_fillptr;
 	unsigned long tlb_emerg;
+	unsigned int tlb_batch;		/* nesting of mmu_region_batch_begin() */
 #endif
 #endif
 #ifdef CONFIG_SYS_MEM_RESERVE_SECURE
@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Architecture-specific SPL handoff information for ARM
+ */
+
+#ifndef __handoff_h
+#define __handoff_h
+
+struct arch_spl_handoff {
+	ulong	reserved;	/* Nothing ARM-specific is passed yet */
+};
+
+#endif
@@ -31,6 +31,9 @@ extern void * memchr(const void *, int, __kernel_size_t);
 #endif
 extern void * memset(void *, int, __kernel_size_t);
 
+/* Enable NEON on this core for large memcpy()/memset(), 0 if available */
+int arm_neon_mem_init(void);
+
 #if 0
 extern void __memzero(void *ptr, __kernel_size_t n);
 
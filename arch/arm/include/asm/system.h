@@ -244,6 +244,24 @@ void smp_kick_all_cpus(void);
 void flush_l3_cache(void);
 void mmu_change_region_attr(phys_addr_t start, size_t size, u64 attrs);
 
+/**
+ * mmu_region_batch_begin() - Start a batch of page table changes
+ *
+ * Until the matching mmu_region_batch_end(), mmu_set_region_dcache_behaviour()
+ * and mmu_change_region_attr() only update the page tables: the CPU keeps
+ * running on the emergency page tables with the old attributes. Batches may
+ * nest; only the outermost one switches the tables.
+ */
+void mmu_region_batch_begin(void);
+
+/**
+ * mmu_region_batch_end() - Apply a batch of page table changes
+ *
+ * Switches back to the updated page tables, with a single TLB invalidation,
+ * and flushes the D-cache once for all the regions changed.
+ */
+void mmu_region_batch_end(void);
+
 /*
  *Issue a secure monitor call in accordance with ARM "SMC Calling convention",
  * DEN0028A
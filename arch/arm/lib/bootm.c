@@ -13,6 +13,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <cyclic.h>
 #include <dm.h>
 #include <dm/root.h>
 #include <image.h>
@@ -21,6 +22,8 @@
 #include <linux/libfdt.h>
 #include <mapmem.h>
 #include <fdt_support.h>
+#include <serial.h>
+#include <trace.h>
 #include <asm/bootm.h>
 #include <asm/secure.h>
 #include <linux/compiler.h>
@@ -30,6 +33,7 @@
 #ifdef CONFIG_ARMV7_NONSEC
 #include <asm/armv7.h>
 #endif
+#include <asm/sections.h>
 #include <asm/setup.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -75,6 +79,12 @@ void arch_lmb_reserve(struct lmb *lmb)
 		lmb_reserve(lmb, sp, bank_end - sp + 1);
 		break;
 	}
+
+#ifdef CONFIG_XIP_RAM_DATA
+	/* U-Boot runs from flash, but its data is still in use in RAM */
+	lmb_reserve(lmb, (ulong)__xip_data_start,
+		    __bss_end - __xip_data_start);
+#endif
 }
 
 __weak void board_quiesce_devices(void)
@@ -100,10 +110,17 @@ static void announce_and_cleanup(int fake)
 	udc_disconnect();
 #endif
 
+	/* Background tasks must leave the hardware alone from here on */
+	cyclic_wait_all();
 	board_quiesce_devices();
 
+	/* The OS does not expect the sampling interrupt */
+	if (IS_ENABLED(CONFIG_TRACE_SAMPLE))
+		trace_sample_stop();
+
 	printf("\nStarting kernel ...%s\n\n", fake ?
 		"(fake run for tracing)" : "");
+	serial_flush(true);
 	/*
 	 * Call remove function of all devices with a removal flag set.
 	 * This may be useful for last-stage operations, like cancelling
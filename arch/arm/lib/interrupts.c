@@ -20,6 +20,7 @@
 
 #include <common.h>
 #include <efi_loader.h>
+#include <trace.h>
 #include <asm/proc-armv/ptrace.h>
 #include <asm/u-boot-arm.h>
 
@@ -191,6 +192,9 @@ void do_fiq (struct pt_regs *pt_regs)
 
 void do_irq (struct pt_regs *pt_regs)
 {
+	if (IS_ENABLED(CONFIG_TRACE_SAMPLE) && !arch_sample_irq(pt_regs))
+		return;
+
 	efi_restore_gd();
 	printf ("interrupt request\n");
 	fixup_pc(pt_regs, -8);
@@ -0,0 +1,363 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Performance monitor unit of ARMv7-A and ARMv8-A cores
+ *
+ * The cycle counter counts CPU cycles and the first few event counters
+ * count the events in pmu_event[]. On ARMv7 all counters are 32 bits wide,
+ * on ARMv8 the cycle counter is 64 bits wide. The counters are extended to
+ * 64 bits using the overflow flags.
+ */
+
+#include <common.h>
+#include <div64.h>
+#include <pmu.h>
+#include <asm/system.h>
+
+#define PMCR_E			BIT(0)	/* enable */
+#define PMCR_P			BIT(1)	/* reset event counters */
+#define PMCR_C			BIT(2)	/* reset cycle counter */
+#define PMCR_LC			BIT(6)	/* 64-bit cycle counter */
+#define PMCR_N_SHIFT		11
+#define PMCR_N_MASK		0x1f
+
+#define PMU_CYCLE_BIT		BIT(31)
+#define PMEVTYPER_NSH		BIT(27)	/* count at EL2 */
+#define MDCR_EL3_SPME		BIT(17)	/* count in the secure state */
+
+/* Architectural (common) event numbers */
+static const uint pmu_default_event[PMUC_COUNT] = {
+	[PMUC_INSTRUCTIONS]	= 0x08,	/* INST_RETIRED */
+	[PMUC_L1D_MISSES]	= 0x03,	/* L1D_CACHE_REFILL */
+	[PMUC_L2D_MISSES]	= 0x17,	/* L2D_CACHE_REFILL */
+	[PMUC_BRANCH_MISSES]	= 0x10,	/* BR_MIS_PRED */
+};
+
+static const char *const pmu_name[PMUC_COUNT] = {
+	"cycles",
+	"instructions",
+	"l1d-misses",
+	"l2d-misses",
+	"branch-misses",
+};
+
+static bool pmu_started;
+/* Number of event counters in use */
+static int pmu_nr;
+/* Event counted by each counter */
+static uint pmu_event[PMUC_COUNT];
+/* Upper bits of each counter */
+static u64 pmu_high[PMUC_COUNT];
+
+#ifdef CONFIG_ARM64
+static bool pmu_present(void)
+{
+	u64 dfr0;
+	uint ver;
+
+	asm volatile("mrs %0, id_aa64dfr0_el1" : "=r" (dfr0));
+	ver = (dfr0 >> 8) & 0xf;
+
+	return ver && ver != 0xf;
+}
+
+static u32 pmu_read_pmcr(void)
+{
+	u64 val;
+
+	asm volatile("mrs %0, pmcr_el0" : "=r" (val));
+
+	return val;
+}
+
+static void pmu_write_pmcr(u32 val)
+{
+	asm volatile("msr pmcr_el0, %0" : : "r" ((u64)val));
+	isb();
+}
+
+static void pmu_enable_counters(u32 mask)
+{
+	asm volatile("msr pmcntenset_el0, %0" : : "r" ((u64)mask));
+}
+
+static u32 pmu_read_overflow(void)
+{
+	u64 val;
+
+	asm volatile("mrs %0, pmovsclr_el0" : "=r" (val));
+
+	return val;
+}
+
+static void pmu_clear_overflow(u32 mask)
+{
+	asm volatile("msr pmovsclr_el0, %0" : : "r" ((u64)mask));
+}
+
+static void pmu_select(int idx)
+{
+	asm volatile("msr pmselr_el0, %0" : : "r" ((u64)idx));
+	isb();
+}
+
+static void pmu_write_type(u32 val)
+{
+	asm volatile("msr pmxevtyper_el0, %0" : : "r" ((u64)val));
+}
+
+static u32 pmu_read_counter(void)
+{
+	u64 val;
+
+	asm volatile("mrs %0, pmxevcntr_el0" : "=r" (val));
+
+	return val;
+}
+
+static void pmu_write_counter(u32 val)
+{
+	asm volatile("msr pmxevcntr_el0, %0" : : "r" ((u64)val));
+}
+
+static u64 pmu_read_cycles(void)
+{
+	u64 val;
+
+	asm volatile("mrs %0, pmccntr_el0" : "=r" (val));
+
+	return val;
+}
+
+static void pmu_arch_init(void)
+{
+	u64 val;
+
+	/* Count at EL2 too, and in the secure state when at EL3 */
+	asm volatile("msr pmccfiltr_el0, %0" : : "r" ((u64)PMEVTYPER_NSH));
+	if (current_el() == 3) {
+		asm volatile("mrs %0, mdcr_el3" : "=r" (val));
+		asm volatile("msr mdcr_el3, %0" : : "r" (val | MDCR_EL3_SPME));
+		isb();
+	}
+}
+#else
+static bool pmu_present(void)
+{
+	u32 dfr0;
+	uint ver;
+
+	asm volatile("mrc p15, 0, %0, c0, c1, 2" : "=r" (dfr0));
+	ver = (dfr0 >> 24) & 0xf;
+
+	return ver && ver != 0xf;
+}
+
+static u32 pmu_read_pmcr(void)
+{
+	u32 val;
+
+	asm volatile("mrc p15, 0, %0, c9, c12, 0" : "=r" (val));
+
+	return val;
+}
+
+static void pmu_write_pmcr(u32 val)
+{
+	asm volatile("mcr p15, 0, %0, c9, c12, 0" : : "r" (val));
+	isb();
+}
+
+static void pmu_enable_counters(u32 mask)
+{
+	asm volatile("mcr p15, 0, %0, c9, c12, 1" : : "r" (mask));
+}
+
+static u32 pmu_read_overflow(void)
+{
+	u32 val;
+
+	asm volatile("mrc p15, 0, %0, c9, c12, 3" : "=r" (val));
+
+	return val;
+}
+
+static void pmu_clear_overflow(u32 mask)
+{
+	asm volatile("mcr p15, 0, %0, c9, c12, 3" : : "r" (mask));
+}
+
+static void pmu_select(int idx)
+{
+	asm volatile("mcr p15, 0, %0, c9, c12, 5" : : "r" (idx));
+	isb();
+}
+
+static void pmu_write_type(u32 val)
+{
+	asm volatile("mcr p15, 0, %0, c9, c13, 1" : : "r" (val));
+}
+
+static u32 pmu_read_counter(void)
+{
+	u32 val;
+
+	asm volatile("mrc p15, 0, %0, c9, c13, 2" : "=r" (val));
+
+	return val;
+}
+
+static void pmu_write_counter(u32 val)
+{
+	asm volatile("mcr p15, 0, %0, c9, c13, 2" : : "r" (val));
+}
+
+static u64 pmu_read_cycles(void)
+{
+	u32 val;
+
+	asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (val));
+
+	return val;
+}
+
+static void pmu_arch_init(void)
+{
+}
+#endif
+
+/* Program the event counter used for @counter and reset it */
+static void pmu_setup_counter(enum pmu_counter counter)
+{
+	pmu_select(counter - PMUC_INSTRUCTIONS);
+	pmu_write_type(PMEVTYPER_NSH | pmu_event[counter]);
+	pmu_write_counter(0);
+	pmu_high[counter] = 0;
+}
+
+int pmu_init(void)
+{
+	u32 pmcr, mask;
+	int i;
+
+	if (pmu_started)
+		return 0;
+	if (!pmu_present())
+		return -ENODEV;
+
+	pmu_arch_init();
+	memcpy(pmu_event, pmu_default_event, sizeof(pmu_event));
+	pmcr = pmu_read_pmcr();
+	pmu_nr = min_t(int, (pmcr >> PMCR_N_SHIFT) & PMCR_N_MASK,
+		       PMUC_COUNT - PMUC_INSTRUCTIONS);
+	mask = PMU_CYCLE_BIT;
+	for (i = 0; i < pmu_nr; i++) {
+		pmu_setup_counter(PMUC_INSTRUCTIONS + i);
+		mask |= BIT(i);
+	}
+
+	pmu_clear_overflow(~0U);
+	pmu_write_pmcr(pmcr | PMCR_E | PMCR_P | PMCR_C |
+		       (IS_ENABLED(CONFIG_ARM64) ? PMCR_LC : 0));
+	pmu_enable_counters(mask);
+	pmu_started = true;
+
+	return 0;
+}
+
+/*
+ * Extend counter @val to 64 bits. If @overflow is set the counter wrapped
+ * since the last read, perhaps after @val was read
+ */
+static u64 pmu_extend(enum pmu_counter counter, u32 val, bool overflow)
+{
+	if (overflow) {
+		pmu_high[counter] += 1ULL << 32;
+		if (val & BIT(31))
+			return pmu_high[counter] - (1ULL << 32) + val;
+	}
+
+	return pmu_high[counter] + val;
+}
+
+void pmu_read(struct pmu_counts *counts)
+{
+	u32 vals[PMUC_COUNT];
+	u32 overflow;
+	u64 cycles;
+	int i;
+
+	memset(counts, '\0', sizeof(*counts));
+	if (!pmu_started)
+		return;
+
+	for (i = 0; i < pmu_nr; i++) {
+		pmu_select(i);
+		vals[PMUC_INSTRUCTIONS + i] = pmu_read_counter();
+	}
+	cycles = pmu_read_cycles();
+	overflow = pmu_read_overflow();
+	pmu_clear_overflow(overflow);
+
+	if (!IS_ENABLED(CONFIG_ARM64))
+		cycles = pmu_extend(PMUC_CYCLES, cycles,
+				    overflow & PMU_CYCLE_BIT);
+	counts->count[PMUC_CYCLES] = cycles;
+	counts->valid = BIT(PMUC_CYCLES);
+	for (i = 0; i < pmu_nr; i++) {
+		counts->count[PMUC_INSTRUCTIONS + i] =
+			pmu_extend(PMUC_INSTRUCTIONS + i,
+				   vals[PMUC_INSTRUCTIONS + i],
+				   overflow & BIT(i));
+		counts->valid |= BIT(PMUC_INSTRUCTIONS + i);
+	}
+}
+
+int pmu_set_event(enum pmu_counter counter, uint event)
+{
+	int ret;
+
+	if (counter <= PMUC_CYCLES || counter >= PMUC_COUNT)
+		return -EINVAL;
+	ret = pmu_init();
+	if (ret)
+		return ret;
+	pmu_event[counter] = event;
+	if (counter - PMUC_INSTRUCTIONS < pmu_nr)
+		pmu_setup_counter(counter);
+
+	return 0;
+}
+
+uint pmu_get_event(enum pmu_counter counter)
+{
+	return pmu_event[counter];
+}
+
+void pmu_show(const struct pmu_counts *start, const struct pmu_counts *end)
+{
+	u64 delta[PMUC_COUNT];
+	u64 ipc;
+	int i;
+
+	for (i = 0; i < PMUC_COUNT; i++)
+		delta[i] = end->count[i] - start->count[i];
+
+	for (i = 0; i < PMUC_COUNT; i++) {
+		if (!(start->valid & end->valid & BIT(i)))
+			continue;
+		printf("%14llu  ", delta[i]);
+		if (i == PMUC_CYCLES || pmu_event[i] == pmu_default_event[i])
+			printf("%s", pmu_name[i]);
+		else
+			printf("event %#x", pmu_event[i]);
+		if (i == PMUC_INSTRUCTIONS &&
+		    pmu_event[i] == pmu_default_event[i] &&
+		    delta[PMUC_CYCLES]) {
+			ipc = delta[i] * 100;
+			do_div(ipc, delta[PMUC_CYCLES]);
+			printf("  (%u.%02u per cycle)", (uint)ipc / 100,
+			       (uint)ipc % 100);
+		}
+		printf("\n");
+	}
+}
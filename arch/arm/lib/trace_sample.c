@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sampling interrupt for ARMv7-A
+ *
+ * The virtual timer of the generic timer interrupts U-Boot every sampling
+ * period and the handler records the interrupted PC and LR. U-Boot does
+ * not otherwise use interrupts, so only the timer PPI is set up in the GIC
+ * (v2), which is found in the control FDT. U-Boot must be running in SVC
+ * mode; in HYP mode interrupts go to the hypervisor vectors.
+ */
+
+#include <common.h>
+#include <div64.h>
+#include <trace.h>
+#include <asm/gic.h>
+#include <asm/io.h>
+#include <asm/proc-armv/ptrace.h>
+#include <dm/ofnode.h>
+#include <linux/sizes.h>
+
+#define SAMPLE_PPI		27	/* virtual timer */
+#define CNTV_CTL_ENABLE		BIT(0)
+#define GICC_IAR_ID_MASK	0x3ff
+#define GIC_SPURIOUS		1023
+
+static const char *const sample_gic_compat[] = {
+	"arm,cortex-a7-gic",
+	"arm,cortex-a15-gic",
+	"arm,gic-400",
+};
+
+static void __iomem *sample_gicd;
+static void __iomem *sample_gicc;
+static u32 sample_ticks;
+
+static void sample_timer_set(u32 ticks, u32 ctl)
+{
+	asm volatile("mcr p15, 0, %0, c14, c3, 0" : : "r" (ticks));
+	asm volatile("mcr p15, 0, %0, c14, c3, 1" : : "r" (ctl));
+	isb();
+}
+
+static int sample_find_gic(void)
+{
+	phys_addr_t gicd, gicc;
+	ofnode node;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sample_gic_compat); i++) {
+		node = ofnode_by_compatible(ofnode_null(),
+					    sample_gic_compat[i]);
+		if (ofnode_valid(node))
+			break;
+	}
+	if (i == ARRAY_SIZE(sample_gic_compat))
+		return -ENODEV;
+
+	gicd = ofnode_get_addr_index(node, 0);
+	gicc = ofnode_get_addr_index(node, 1);
+	if (gicd == FDT_ADDR_T_NONE || gicc == FDT_ADDR_T_NONE)
+		return -EINVAL;
+	sample_gicd = map_physmem(gicd, SZ_4K, MAP_NOCACHE);
+	sample_gicc = map_physmem(gicc, SZ_4K, MAP_NOCACHE);
+
+	return 0;
+}
+
+int arch_sample_start(uint period_us)
+{
+	u32 cpsr, freq;
+	u64 ticks;
+	int ret;
+
+	asm volatile("mrs %0, cpsr" : "=r" (cpsr));
+	if ((cpsr & MODE_MASK) != SVC_MODE)
+		return -ENOTSUPP;
+	if (!sample_gicd) {
+		ret = sample_find_gic();
+		if (ret)
+			return ret;
+	}
+
+	asm volatile("mrc p15, 0, %0, c14, c0, 0" : "=r" (freq));
+	ticks = (u64)freq * period_us;
+	do_div(ticks, 1000000);
+	sample_ticks = max_t(u64, ticks, 1);
+
+	/* Deliver the timer PPI to this CPU as an IRQ */
+	writeb(0xa0, sample_gicd + GICD_IPRIORITYRn + SAMPLE_PPI);
+	writel(BIT(SAMPLE_PPI), sample_gicd + GICD_ISENABLERn);
+	setbits_le32(sample_gicd + GICD_CTLR, 1);
+	writel(0xf0, sample_gicc + GICC_PMR);
+	setbits_le32(sample_gicc + GICC_CTLR, 1);
+
+	sample_timer_set(sample_ticks, CNTV_CTL_ENABLE);
+	asm volatile("cpsie i");
+
+	return 0;
+}
+
+void arch_sample_stop(void)
+{
+	asm volatile("cpsid i");
+	sample_timer_set(0, 0);
+	if (sample_gicd)
+		writel(BIT(SAMPLE_PPI), sample_gicd + GICD_ICENABLERn);
+}
+
+int arch_sample_irq(struct pt_regs *regs)
+{
+	u32 iar;
+
+	if (!sample_gicc)
+		return -ENOENT;
+	iar = readl(sample_gicc + GICC_IAR);
+	if ((iar & GICC_IAR_ID_MASK) == GIC_SPURIOUS)
+		return 0;
+	if ((iar & GICC_IAR_ID_MASK) != SAMPLE_PPI) {
+		writel(iar, sample_gicc + GICC_EOIR);
+		return -ENOENT;
+	}
+
+	/* The saved PC is 4 bytes after the interrupted instruction */
+	trace_sample_record(regs->ARM_pc - 4, regs->ARM_lr);
+	sample_timer_set(sample_ticks, CNTV_CTL_ENABLE);
+	writel(iar, sample_gicc + GICC_EOIR);
+
+	return 0;
+}
@@ -6,6 +6,7 @@
 
 #include <common.h>
 #include <malloc.h>
+#include <asm/cache.h>
 #include <asm/io.h>
 #include <linux/kernel.h>
 #include <asm/arch/aspeed_verify.h>
@@ -31,12 +32,17 @@ static int aspeed_digest_verify(struct aspeed_verify_info *info)
 		break;
 	}
 
-	enable_crypto();
-	digest_result = memalign(8, digest_length);
-	ret = digest_object(info->image, info->image_size, digest_result, info->sha_mode);
-	if (ret)
-		goto err;
-
+	if (info->image_digest) {
+		digest_result = info->image_digest;
+	} else {
+		enable_crypto();
+		digest_result = memalign(ARCH_DMA_MINALIGN,
+					 ALIGN(digest_length, ARCH_DMA_MINALIGN));
+		ret = digest_object(info->image, info->image_size,
+				    digest_result, info->sha_mode);
+		if (ret)
+			goto err;
+	}
 
 	ret = memcmp(info->digest, digest_result, digest_length);
 err:
@@ -72,11 +78,17 @@ static int aspeed_signature_verify(struct aspeed_verify_info *info)
 		digest_length = 0;
 	}
 
-	digest_result = memalign(8, digest_length);
-	enable_crypto();
-	ret = digest_object(info->image, info->image_size, digest_result, info->sha_mode);
-	if (ret)
-		goto err;
+	if (info->image_digest) {
+		digest_result = info->image_digest;
+	} else {
+		digest_result = memalign(ARCH_DMA_MINALIGN,
+					 ALIGN(digest_length, ARCH_DMA_MINALIGN));
+		enable_crypto();
+		ret = digest_object(info->image, info->image_size,
+				    digest_result, info->sha_mode);
+		if (ret)
+			goto err;
+	}
 
 	contex_buf = malloc(0x600);
 	memset(contex_buf, 0, 0x600);
@@ -210,7 +222,8 @@ static void print_verification_data(const struct aspeed_verify_info *info,
 	}
 }
 
-int _aspeed_verify_boot(u32 cot_alg, u8 *cot_info, void *verify_image)
+int _aspeed_verify_boot(u32 cot_alg, u8 *cot_info, void *verify_image,
+			u8 *digest)
 {
 	struct aspeed_verify_info info;
 	struct aspeed_secboot_header *sbh;
@@ -231,6 +244,7 @@ int _aspeed_verify_boot(u32 cot_alg, u8 *cot_info, void *verify_image)
 	info.verify_mode = ASPEED_VERIFY_MODE(cot_alg);
 	info.digest = NULL;
 	info.rsa_key = NULL;
+	info.image_digest = digest;
 
 	printf("## Starting verify image.\n");
 	switch (info.verify_mode) {
@@ -269,7 +283,7 @@ int aspeed_verify_boot(void *cur_image, void *next_image)
 	cot_info = cur_image + cur_sbh->sbh_cot_info_off;
 
 
-	return _aspeed_verify_boot(cot_alg, cot_info, next_image);
+	return _aspeed_verify_boot(cot_alg, cot_info, next_image, NULL);
 }
 
 /**
@@ -283,5 +297,30 @@ int aspeed_bl2_verify(void *bl2_image, void *bl1_image)
 	u32 cot_alg = * (u32 *)(bl1_image + ASPEED_VERIFY_HEADER);
 	u8 *cot_info = (u8 *) * (u32 *)(bl1_image + ASPEED_VERIFY_INFO_OFFSET);
 
-	return _aspeed_verify_boot(cot_alg, cot_info, bl2_image);
+	return _aspeed_verify_boot(cot_alg, cot_info, bl2_image, NULL);
+}
+
+/**
+ * Hash method of the images verified by aspeed_bl2_verify()
+ *
+ * \param bl1_image	spl image offset
+ */
+u32 aspeed_bl2_sha_mode(void *bl1_image)
+{
+	return ASPEED_VERIFY_SHA(*(u32 *)(bl1_image + ASPEED_VERIFY_HEADER));
+}
+
+/**
+ * Aspeed verified boot, with the image hashed already
+ *
+ * \param bl2_image	u-boot image offset
+ * \param bl1_image	spl image offset
+ * \param digest	digest of the image, by aspeed_bl2_sha_mode()
+ */
+int aspeed_bl2_verify_digest(void *bl2_image, void *bl1_image, u8 *digest)
+{
+	u32 cot_alg = * (u32 *)(bl1_image + ASPEED_VERIFY_HEADER);
+	u8 *cot_info = (u8 *) * (u32 *)(bl1_image + ASPEED_VERIFY_INFO_OFFSET);
+
+	return _aspeed_verify_boot(cot_alg, cot_info, bl2_image, digest);
 }
\ No newline at end of file
@@ -4,9 +4,11 @@
  */
 #include <common.h>
 #include <dm.h>
+#include <handoff.h>
 #include <ram.h>
 #include <timer.h>
 #include <asm/io.h>
+#include <asm/arch/sdram_ast2600.h>
 #include <asm/arch/timer.h>
 #include <linux/bitops.h>
 #include <linux/err.h>
@@ -100,6 +102,13 @@ __weak int dram_init(void)
 	struct ram_info ram;
 	int ret;
 
+#if CONFIG_IS_ENABLED(HANDOFF) && !defined(CONFIG_SPL_BUILD)
+	/* SPL sized the DRAM already */
+	if (gd->spl_handoff && gd->spl_handoff->ram_size) {
+		handoff_load_dram_size(gd->spl_handoff);
+		goto done;
+	}
+#endif
 	ret = uclass_get_device(UCLASS_RAM, 0, &dev);
 	if (ret) {
 		debug("DRAM FAIL1\r\n");
@@ -113,6 +122,13 @@ __weak int dram_init(void)
 	}
 
 	gd->ram_size = ram.size;
+#if CONFIG_IS_ENABLED(HANDOFF) && !defined(CONFIG_SPL_BUILD)
+done:
+#endif
+#if defined(CONFIG_ASPEED_ECC_BACKGROUND_INIT) && !defined(CONFIG_SPL_BUILD)
+	/* U-Boot is relocated to the DRAM right after */
+	ast2600_sdrammc_ecc_wait();
+#endif
 	return 0;
 }
 
@@ -122,6 +138,9 @@ int arch_early_init_r(void)
 	/* Trigger PCIe devices detection */
 	pci_init();
 #endif
+#ifdef CONFIG_ASPEED_DDR_TRAIN_CACHE
+	ast2600_sdrammc_save_training();
+#endif
 
 	return 0;
 }
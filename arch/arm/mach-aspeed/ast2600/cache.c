@@ -23,4 +23,11 @@ void enable_caches(void)
 	mmu_set_region_dcache_behaviour(ASPEED_DRAM_BASE,
 				       gd->ram_size,
 				       opt);
+
+#if defined(CONFIG_ASPEED_UBOOT_XIP) && !defined(CONFIG_SPL_BUILD)
+	/* U-Boot runs from the SPI flash, let its code be cached too */
+	mmu_set_region_dcache_behaviour(CONFIG_ASPEED_UBOOT_SPI_BASE,
+				       CONFIG_ASPEED_UBOOT_SPI_SIZE,
+				       DCACHE_WRITETHROUGH);
+#endif
 }
@@ -5,6 +5,7 @@
  */
 
 #include <common.h>
+#include <asm/cache.h>
 #include <asm/io.h>
 #include <linux/kernel.h>
 #include <asm/arch/crypto.h>
@@ -27,10 +28,47 @@ static int ast_hace_wait_isr(u32 reg, u32 flag, u32 timeout)
 	return 0;
 }
 
+/*
+ * The engines access the DRAM behind the D-cache, which SPL may have
+ * turned on: flush what they read, invalidate what they write.
+ */
+static void crypto_flush(const void *buf, u32 len)
+{
+	flush_dcache_range(rounddown((ulong)buf, ARCH_DMA_MINALIGN),
+			   roundup((ulong)buf + len, ARCH_DMA_MINALIGN));
+}
+
+static void crypto_inval(const void *buf, u32 len)
+{
+	invalidate_dcache_range(rounddown((ulong)buf, ARCH_DMA_MINALIGN),
+				roundup((ulong)buf + len, ARCH_DMA_MINALIGN));
+}
+
+static u32 digest_length(u32 method)
+{
+	switch (method) {
+	case ASPEED_SHA224:
+		return 28;
+	case ASPEED_SHA256:
+		return 32;
+	case ASPEED_SHA384:
+		return 48;
+	default:
+		return 64;
+	}
+}
 
 int aspeed_sg_digest(struct aspeed_sg_list *src_list, u32 list_length, u32 length, u8 *digest, u32 method)
 {
+	int ret;
+	int i;
+
 	READ_ONCE(src_list[list_length - 1].phy_addr);
+	for (i = 0; i < list_length; i++)
+		crypto_flush((void *)src_list[i].phy_addr,
+			     src_list[i].len & ~BIT(31));
+	crypto_flush(src_list, list_length * sizeof(*src_list));
+	crypto_flush(digest, digest_length(method));
 	writel((u32)src_list, ASPEED_HACE_HASH_SRC);
 	writel((u32)digest, ASPEED_HACE_HASH_DIGEST_BUFF);
 	writel(length, ASPEED_HACE_HASH_DATA_LEN);
@@ -50,7 +88,10 @@ int aspeed_sg_digest(struct aspeed_sg_list *src_list, u32 list_length, u32 lengt
 		break;
 	}
 
-	return ast_hace_wait_isr(ASPEED_HACE_STS, HACE_HASH_ISR, 100000);
+	ret = ast_hace_wait_isr(ASPEED_HACE_STS, HACE_HASH_ISR, 100000);
+	crypto_inval(digest, digest_length(method));
+
+	return ret;
 }
 
 /**
@@ -63,7 +104,11 @@ int aspeed_sg_digest(struct aspeed_sg_list *src_list, u32 list_length, u32 lengt
  */
 int digest_object(u8 *src, u32 length, u8 *digest, u32 method)
 {
+	int ret;
+
 	READ_ONCE(src[length - 1]);
+	crypto_flush(src, length);
+	crypto_flush(digest, digest_length(method));
 	writel((u32)src, ASPEED_HACE_HASH_SRC);
 	writel((u32)digest, ASPEED_HACE_HASH_DIGEST_BUFF);
 	writel(length, ASPEED_HACE_HASH_DATA_LEN);
@@ -83,18 +128,188 @@ int digest_object(u8 *src, u32 length, u8 *digest, u32 method)
 		break;
 	}
 
-	return ast_hace_wait_isr(ASPEED_HACE_STS, HACE_HASH_ISR, 100000);
+	ret = ast_hace_wait_isr(ASPEED_HACE_STS, HACE_HASH_ISR, 100000);
+	crypto_inval(digest, digest_length(method));
+
+	return ret;
+}
+
+/* Initial hash values, in the byte order of the digest buffer */
+static const u32 sha224_iv[8] = {
+	0xd89e05c1, 0x07d57c36, 0x17dd7030, 0x39590ef7,
+	0x310bc0ff, 0x11155868, 0xa78ff964, 0xa44ffabe
+};
+
+static const u32 sha256_iv[8] = {
+	0x67e6096a, 0x85ae67bb, 0x72f36e3c, 0x3af54fa5,
+	0x7f520e51, 0x8c68059b, 0xabd9831f, 0x19cde05b
+};
+
+static const u32 sha384_iv[16] = {
+	0x5d9dbbcb, 0xd89e05c1, 0x2a299a62, 0x07d57c36,
+	0x5a015991, 0x17dd7030, 0xd8ec2f15, 0x39590ef7,
+	0x67263367, 0x310bc0ff, 0x874ab48e, 0x11155868,
+	0x0d2e0cdb, 0xa78ff964, 0x1d48b547, 0xa44ffabe
+};
+
+static const u32 sha512_iv[16] = {
+	0x67e6096a, 0x08c9bcf3, 0x85ae67bb, 0x3ba7ca84,
+	0x72f36e3c, 0x2bf894fe, 0x3af54fa5, 0xf1361d5f,
+	0x7f520e51, 0xd182e6ad, 0x8c68059b, 0x1f6c3e2b,
+	0xabd9831f, 0x6bbd41fb, 0x19cde05b, 0x79217e13
+};
+
+/**
+ * Start an accumulative digest, for data which arrives in pieces.
+ *
+ * \param ctx		digest context
+ * \param method	hash method
+ */
+int aspeed_digest_init(struct aspeed_digest_ctx *ctx, u32 method)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->method = method;
+	switch (method) {
+	case ASPEED_SHA224:
+		ctx->cmd = 0x148;
+		ctx->block_size = 64;
+		memcpy(ctx->digest, sha224_iv, sizeof(sha224_iv));
+		break;
+	case ASPEED_SHA256:
+		ctx->cmd = 0x158;
+		ctx->block_size = 64;
+		memcpy(ctx->digest, sha256_iv, sizeof(sha256_iv));
+		break;
+	case ASPEED_SHA384:
+		ctx->cmd = 0x568;
+		ctx->block_size = 128;
+		memcpy(ctx->digest, sha384_iv, sizeof(sha384_iv));
+		break;
+	case ASPEED_SHA512:
+		ctx->cmd = 0x168;
+		ctx->block_size = 128;
+		memcpy(ctx->digest, sha512_iv, sizeof(sha512_iv));
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void aspeed_digest_start(struct aspeed_digest_ctx *ctx, u8 *src,
+				u32 length)
+{
+	READ_ONCE(src[length - 1]);
+	crypto_flush(src, length);
+	crypto_flush(ctx->digest, sizeof(ctx->digest));
+	writel((u32)src, ASPEED_HACE_HASH_SRC);
+	writel((u32)ctx->digest, ASPEED_HACE_HASH_DIGEST_BUFF);
+	writel(length, ASPEED_HACE_HASH_DATA_LEN);
+	writel(ctx->cmd, ASPEED_HACE_HASH_CMD);
+	ctx->pending = true;
+}
+
+static int aspeed_digest_wait(struct aspeed_digest_ctx *ctx)
+{
+	int ret;
+
+	if (!ctx->pending)
+		return 0;
+
+	ret = ast_hace_wait_isr(ASPEED_HACE_STS, HACE_HASH_ISR, 100000);
+	ctx->pending = false;
+	crypto_inval(ctx->digest, sizeof(ctx->digest));
+
+	return ret;
+}
+
+/**
+ * Hash the next piece of data. The engine is left running on it, so that
+ * the next piece can be fetched meanwhile; \p src must then stay untouched
+ * until the next call. All pieces but the last must be a multiple of the
+ * block size of the hash.
+ *
+ * \param ctx		digest context
+ * \param src		next piece of data
+ * \param length	size of the piece
+ */
+int aspeed_digest_update(struct aspeed_digest_ctx *ctx, u8 *src, u32 length)
+{
+	u32 tail = length & (ctx->block_size - 1);
+	int ret;
+
+	if (ctx->bufcnt)
+		return -EINVAL;
+
+	ret = aspeed_digest_wait(ctx);
+	if (ret)
+		return ret;
+
+	ctx->total += length;
+	/* The partial block is hashed with the padding */
+	memcpy(ctx->buffer, src + length - tail, tail);
+	ctx->bufcnt = tail;
+	if (length > tail)
+		aspeed_digest_start(ctx, src, length - tail);
+
+	return 0;
+}
+
+/**
+ * Finish an accumulative digest.
+ *
+ * \param ctx		digest context
+ * \param digest	digest, of the size of the hash
+ */
+int aspeed_digest_final(struct aspeed_digest_ctx *ctx, u8 *digest)
+{
+	u32 len_size = ctx->block_size / 8;
+	u32 padlen;
+	u64 bits;
+	int ret;
+
+	ret = aspeed_digest_wait(ctx);
+	if (ret)
+		return ret;
+
+	padlen = ctx->block_size - len_size - ctx->bufcnt;
+	if (ctx->bufcnt >= ctx->block_size - len_size)
+		padlen += ctx->block_size;
+	ctx->buffer[ctx->bufcnt] = 0x80;
+	memset(ctx->buffer + ctx->bufcnt + 1, 0, padlen - 1 + len_size - 8);
+	bits = cpu_to_be64(ctx->total << 3);
+	memcpy(ctx->buffer + ctx->bufcnt + padlen + len_size - 8, &bits, 8);
+
+	aspeed_digest_start(ctx, ctx->buffer, ctx->bufcnt + padlen + len_size);
+	ret = aspeed_digest_wait(ctx);
+	if (ret)
+		return ret;
+
+	memcpy(digest, ctx->digest, digest_length(ctx->method));
+
+	return 0;
 }
 
 int aes256ctr_decrypt_object(u8 *src, u8 *dst, u32 length, u8 *context)
 {
+	int ret;
+
+	/* The IV and the key, and the counter written back */
+	crypto_flush(context, 48);
+	crypto_flush(src, length);
+	crypto_flush(dst, length);
 	writel((u32)src, ASPEED_HACE_SRC);
 	writel((u32)dst, ASPEED_HACE_DEST);
 	writel((u32)context, ASPEED_HACE_CONTEXT);
 	writel(length, ASPEED_HACE_DATA_LEN);
 	writel(0x3048, ASPEED_HACE_CMD);
 
-	return ast_hace_wait_isr(ASPEED_HACE_STS, HACE_CRYPTO_ISR, 100000);
+	ret = ast_hace_wait_isr(ASPEED_HACE_STS, HACE_CRYPTO_ISR, 100000);
+	crypto_inval(context, 48);
+	crypto_inval(dst, length);
+
+	return ret;
 }
 
 int rsa_alg(u8 *data, int data_bytes, u8 *m, int m_bits, u8 *e, int e_bits, u8 *dst, void *contex_buf)
@@ -132,6 +347,8 @@ int rsa_alg(u8 *data, int data_bytes, u8 *m, int m_bits, u8 *e, int e_bits, u8 *
 		j++;
 		j = j % 16 ? j : j + 32;
 	}
+	crypto_flush(contex,
+		     DIV_ROUND_UP(max3(e_bytes, m_bytes, data_bytes), 16) * 48);
 
 	writel((u32)contex, 0x1e6fa04c);
 	writel((e_bits << 16) + m_bits, 0x1e6fa058);
@@ -0,0 +1,302 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Job offload to the secondary Cortex-A7 of the AST2600
+ *
+ * The second core is parked in the SMP mailbox by lowlevel_init. On the
+ * first job it is released into aspeed_smp_entry with a stack of its own,
+ * turns its MMU on with the primary core's page tables and then runs the
+ * jobs of a small ring of slots, one cache line each.
+ *
+ * The page tables do not mark memory shareable, so the two L1 caches are
+ * not kept coherent for us: every hand-over cleans the data cache of the
+ * core giving the data away, and a slot is always invalidated before it is
+ * looked at.
+ */
+
+#include <common.h>
+#include <bootm.h>
+#include <errno.h>
+#include <watchdog.h>
+#include <asm/cache.h>
+#include <asm/io.h>
+#include <asm/system.h>
+#include <asm/arch/smp.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define AST_SMP_MAILBOX_BASE		0x1E6E2180
+#define AST_SMP_MBOX_FIELD_ENTRY	(AST_SMP_MAILBOX_BASE + 0x0)
+#define AST_SMP_MBOX_FIELD_GOSIGN	(AST_SMP_MAILBOX_BASE + 0x4)
+#define AST_SMP_MBOX_FIELD_READY	(AST_SMP_MAILBOX_BASE + 0x8)
+#define AST_SMP_MBOX_FIELD_POLLINSN	(AST_SMP_MAILBOX_BASE + 0xc)
+
+#define AST_SMP_MBOX_READY		0xBABECAFE
+#define AST_SMP_GOSIGN(cpu)		(0xABBAAB00 | (cpu))
+#define AST_SMP_CPU			1
+
+#define AST_SMP_SLOTS			8
+#define AST_SMP_START_TIMEOUT		100	/* ms */
+
+enum {
+	SLOT_FREE,
+	SLOT_QUEUED,
+	SLOT_DONE,
+	SLOT_PARK,
+};
+
+struct aspeed_smp_slot {
+	int (*fn)(void *arg);
+	void *arg;
+	int ret;
+	u32 state;
+} __aligned(ARCH_DMA_MINALIGN);
+
+/* What the secondary core needs before its MMU is on */
+struct aspeed_smp_boot {
+	ulong sp;			/* read by aspeed_smp_entry */
+	ulong gd;			/* likewise */
+	ulong vbar;
+	ulong ttbcr;
+	ulong ttbr0;
+	ulong dacr;
+	ulong sctlr;
+	/* written by the secondary core, so in a line of its own */
+	u32 online __aligned(ARCH_DMA_MINALIGN);
+} __aligned(ARCH_DMA_MINALIGN);
+
+struct aspeed_smp_boot aspeed_smp_boot;
+static struct aspeed_smp_slot aspeed_smp_slots[AST_SMP_SLOTS];
+static u8 aspeed_smp_stack[CONFIG_ASPEED_SMP_JOBS_STACK_SIZE]
+	__aligned(ARCH_DMA_MINALIGN);
+static int aspeed_smp_head;
+
+void aspeed_smp_entry(void);
+
+static void slot_flush(struct aspeed_smp_slot *s)
+{
+	flush_dcache_range((ulong)s, (ulong)(s + 1));
+}
+
+static void slot_inval(struct aspeed_smp_slot *s)
+{
+	invalidate_dcache_range((ulong)s, (ulong)(s + 1));
+}
+
+static u32 boot_online(void)
+{
+	invalidate_dcache_range((ulong)&aspeed_smp_boot.online,
+				(ulong)&aspeed_smp_boot.online +
+				ARCH_DMA_MINALIGN);
+
+	return readl(&aspeed_smp_boot.online);
+}
+
+static void boot_set_online(u32 val)
+{
+	writel(val, &aspeed_smp_boot.online);
+	flush_dcache_range((ulong)&aspeed_smp_boot.online,
+			   (ulong)&aspeed_smp_boot.online + ARCH_DMA_MINALIGN);
+}
+
+static void __noreturn aspeed_smp_park(void)
+{
+	register ulong r0 asm("r0") = AST_SMP_MBOX_FIELD_GOSIGN;
+	register ulong r1 asm("r1") = AST_SMP_MBOX_FIELD_ENTRY;
+	register ulong r2 asm("r2") = AST_SMP_GOSIGN(AST_SMP_CPU);
+
+	flush_dcache_all();
+	set_cr(get_cr() & ~(CR_M | CR_C));
+	asm volatile("mcr p15, 0, %0, c8, c7, 0" : : "r" (0));
+	asm volatile("mcr p15, 0, %0, c7, c5, 0" : : "r" (0));
+	dsb();
+	isb();
+
+	/* With the MMU off this goes straight to memory */
+	writel(0, &aspeed_smp_boot.online);
+	dsb();
+	asm volatile("sev");
+
+	/* Back to polling the go sign, as after reset */
+	asm volatile("bx %3" : : "r" (r0), "r" (r1), "r" (r2),
+		     "r" (AST_SMP_MBOX_FIELD_POLLINSN));
+	unreachable();
+}
+
+void __noreturn aspeed_smp_main(void)
+{
+	struct aspeed_smp_boot *b = &aspeed_smp_boot;
+	struct aspeed_smp_slot *s;
+	int i;
+
+	asm volatile("mcr p15, 0, %0, c12, c0, 0" : : "r" (b->vbar));
+	asm volatile("mcr p15, 0, %0, c2, c0, 2" : : "r" (b->ttbcr));
+	asm volatile("mcr p15, 0, %0, c2, c0, 0" : : "r" (b->ttbr0));
+	asm volatile("mcr p15, 0, %0, c3, c0, 0" : : "r" (b->dacr));
+	asm volatile("mcr p15, 0, %0, c8, c7, 0" : : "r" (0));
+	dsb();
+	isb();
+	set_cr(b->sctlr);
+#if CONFIG_IS_ENABLED(ARM_NEON_MEM)
+	/* memcpy() may already use NEON, which is per core */
+	arm_neon_mem_init();
+#endif
+
+	boot_set_online(1);
+	dsb();
+	asm volatile("sev");
+
+	for (i = 0;; i = (i + 1) % AST_SMP_SLOTS) {
+		s = &aspeed_smp_slots[i];
+		for (;;) {
+			slot_inval(s);
+			if (s->state == SLOT_QUEUED || s->state == SLOT_PARK)
+				break;
+			asm volatile("wfe");
+		}
+		if (s->state == SLOT_PARK) {
+			s->state = SLOT_FREE;
+			slot_flush(s);
+			aspeed_smp_park();
+		}
+
+		s->ret = s->fn(s->arg);
+		/* Hand everything the job wrote back to the primary core */
+		flush_dcache_all();
+		s->state = SLOT_DONE;
+		slot_flush(s);
+		dsb();
+		asm volatile("sev");
+	}
+}
+
+static int aspeed_smp_start(void)
+{
+	struct aspeed_smp_boot *b = &aspeed_smp_boot;
+	ulong start;
+
+	if (boot_online())
+		return 0;
+	if (readl(AST_SMP_MBOX_FIELD_READY) != AST_SMP_MBOX_READY) {
+		debug("%s: secondary core is not in the mailbox\n", __func__);
+		return -ENODEV;
+	}
+
+	b->sp = (ulong)aspeed_smp_stack + sizeof(aspeed_smp_stack);
+	b->gd = (ulong)gd;
+	asm volatile("mrc p15, 0, %0, c12, c0, 0" : "=r" (b->vbar));
+	asm volatile("mrc p15, 0, %0, c2, c0, 2" : "=r" (b->ttbcr));
+	asm volatile("mrc p15, 0, %0, c2, c0, 0" : "=r" (b->ttbr0));
+	asm volatile("mrc p15, 0, %0, c3, c0, 0" : "=r" (b->dacr));
+	b->sctlr = get_cr();
+	/* The core starts uncached, it must find all of this in memory */
+	flush_dcache_all();
+
+	writel((ulong)aspeed_smp_entry, AST_SMP_MBOX_FIELD_ENTRY);
+	writel(AST_SMP_GOSIGN(AST_SMP_CPU), AST_SMP_MBOX_FIELD_GOSIGN);
+	dsb();
+	asm volatile("sev");
+
+	start = get_timer(0);
+	while (!boot_online()) {
+		if (get_timer(start) > AST_SMP_START_TIMEOUT) {
+			printf("SMP: secondary core did not start\n");
+			writel(0, AST_SMP_MBOX_FIELD_GOSIGN);
+			return -ETIMEDOUT;
+		}
+	}
+	/* It has left the poll loop; have it wait there again when parked */
+	writel(0, AST_SMP_MBOX_FIELD_GOSIGN);
+	debug("SMP: secondary core online\n");
+
+	return 0;
+}
+
+int aspeed_smp_job_submit(int (*fn)(void *arg), void *arg)
+{
+	struct aspeed_smp_slot *s = &aspeed_smp_slots[aspeed_smp_head];
+	int job = aspeed_smp_head;
+	int ret;
+
+	ret = aspeed_smp_start();
+	if (ret)
+		return ret;
+
+	slot_inval(s);
+	if (s->state != SLOT_FREE)
+		return -EBUSY;
+
+	s->fn = fn;
+	s->arg = arg;
+	s->state = SLOT_QUEUED;
+	/* Cleans the job's data along with the slot */
+	flush_dcache_all();
+	dsb();
+	asm volatile("sev");
+	aspeed_smp_head = (aspeed_smp_head + 1) % AST_SMP_SLOTS;
+
+	return job;
+}
+
+bool aspeed_smp_job_done(int job)
+{
+	struct aspeed_smp_slot *s = &aspeed_smp_slots[job];
+
+	slot_inval(s);
+
+	return s->state == SLOT_DONE;
+}
+
+int aspeed_smp_job_wait(int job)
+{
+	struct aspeed_smp_slot *s = &aspeed_smp_slots[job];
+	int ret;
+
+	while (!aspeed_smp_job_done(job))
+		WATCHDOG_RESET();
+
+	/* Drop whatever we fetched of the job's output while it ran */
+	ret = s->ret;
+	flush_dcache_all();
+	s->state = SLOT_FREE;
+	slot_flush(s);
+
+	return ret;
+}
+
+void aspeed_smp_stop(void)
+{
+	struct aspeed_smp_slot *s;
+	ulong start;
+	int i;
+
+	if (!boot_online())
+		return;
+
+	for (i = 0; i < AST_SMP_SLOTS; i++) {
+		s = &aspeed_smp_slots[i];
+		slot_inval(s);
+		if (s->state != SLOT_FREE)
+			aspeed_smp_job_wait(i);
+	}
+
+	s = &aspeed_smp_slots[aspeed_smp_head];
+	s->state = SLOT_PARK;
+	slot_flush(s);
+	dsb();
+	asm volatile("sev");
+	start = get_timer(0);
+	while (boot_online()) {
+		if (get_timer(start) > AST_SMP_START_TIMEOUT) {
+			printf("SMP: secondary core did not park\n");
+			return;
+		}
+	}
+	writel(0, AST_SMP_MBOX_FIELD_ENTRY);
+	aspeed_smp_head = 0;
+	debug("SMP: secondary core parked\n");
+}
+
+void arch_preboot_os(void)
+{
+	aspeed_smp_stop();
+}
@@ -7,10 +7,14 @@
 #include <debug_uart.h>
 #include <spl.h>
 #include <dm.h>
+#include <environment.h>
 #include <mmc.h>
+#include <malloc.h>
 #include <xyzModem.h>
 #include <asm/io.h>
+#include <asm/system.h>
 #include <asm/arch/aspeed_verify.h>
+#include <asm/arch/sdram_ast2600.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -31,6 +35,12 @@ void board_init_f(ulong dummy)
 	preloader_console_init();
 	dram_init();
 	aspeed_mmc_init();
+#ifdef CONFIG_ASPEED_ECC_BACKGROUND_INIT
+	/* The stack and heap move to the DRAM after this */
+	if (IS_ENABLED(CONFIG_SPL_STACK_R) ||
+	    !IS_ENABLED(CONFIG_SPL_BOARD_INIT))
+		ast2600_sdrammc_ecc_wait();
+#endif
 #endif
 }
 
@@ -45,6 +55,31 @@ void spl_board_init(void)
 					&dev)) {
 		debug("Warning: HACE initialization failure\n");
 	}
+#ifdef CONFIG_ASPEED_ECC_BACKGROUND_INIT
+	/* Before the boot devices load to the DRAM */
+	ast2600_sdrammc_ecc_wait();
+#endif
+#ifdef CONFIG_ASPEED_SPL_DCACHE
+	/* The page table needs 16KB alignment */
+	gd->arch.tlb_addr = (ulong)memalign(0x4000, PGTABLE_SIZE);
+	if (gd->arch.tlb_addr)
+		enable_caches();
+	else
+		debug("Warning: no memory for the page table\n");
+#endif
+}
+#endif
+
+#ifdef CONFIG_ASPEED_SPL_DCACHE
+/* The next stage starts with the MMU and the caches off */
+void spl_board_prepare_for_boot(void)
+{
+	dcache_disable();
+}
+
+void spl_board_prepare_for_linux(void)
+{
+	dcache_disable();
 }
 #endif
 
@@ -89,8 +124,23 @@ void board_boot_order(u32 *spl_boot_list)
 #ifdef CONFIG_SPL_OS_BOOT
 int spl_start_uboot(void)
 {
-	/* boot linux */
-	return 0;
+	static int start_uboot = -1;
+
+	/* Asked by each loader, so only look at the console once */
+	if (start_uboot >= 0)
+		return start_uboot;
+
+	/* break into full u-boot on 'c' */
+	start_uboot = serial_tstc() && serial_getc() == 'c';
+#ifdef CONFIG_SPL_ENV_SUPPORT
+	if (!start_uboot) {
+		env_init();
+		env_load();
+		start_uboot = env_get_yesno("boot_os") == 0;
+	}
+#endif
+
+	return start_uboot;
 }
 #endif
 
@@ -7,14 +7,84 @@
 #include <debug_uart.h>
 #include <spl.h>
 #include <dm.h>
+#include <malloc.h>
 #include <mmc.h>
 #include <xyzModem.h>
 #include <asm/io.h>
 #include <asm/arch/aspeed_verify.h>
+#include <linux/libfdt.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#if CONFIG_IS_ENABLED(LOAD_FIT)
+/* Read from a FIT which is in memory, at load->priv */
+static ulong aspeed_spl_mem_load_read(struct spl_load_info *load, ulong sector,
+				      ulong count, void *buf)
+{
+	memcpy(buf, load->priv + sector, count);
+	return count;
+}
+
+static int aspeed_spl_load_fit_mem(struct spl_image_info *spl_image, void *fit)
+{
+	struct spl_load_info load;
+
+	memset(&load, 0, sizeof(load));
+	load.bl_len = 1;
+	load.priv = fit;
+	load.read = aspeed_spl_mem_load_read;
+
+	return spl_load_simple_fit(spl_image, &load, 0, fit);
+}
+#endif
+
+#if CONFIG_IS_ENABLED(OS_BOOT) && CONFIG_IS_ENABLED(LOAD_FIT)
+/*
+ * Falcon mode: instead of U-Boot, the kernel FIT is loaded. Its kernel gets
+ * the FDT from the FIT, unless there is a prepared one ('spl export') at
+ * CONFIG_SYS_SPL_ARGS_ADDR.
+ */
+#define ASPEED_SPL_FALCON	1
+
+static int aspeed_spl_kernel_loaded(struct spl_image_info *spl_image, int ret)
+{
+	if (ret)
+		return ret;
+	if (spl_image->os != IH_OS_LINUX) {
+		printf("spl: no Linux kernel in the kernel FIT\n");
+		return -EINVAL;
+	}
+#ifndef CONFIG_SYS_SPL_ARGS_ADDR
+	spl_image->arg = spl_image->fdt_addr;
+#endif
+
+	return 0;
+}
+#else
+#define ASPEED_SPL_FALCON	0
+#endif
 
 static int aspeed_spl_ram_load_image(struct spl_image_info *spl_image,
 				      struct spl_boot_device *bootdev)
 {
+#if CONFIG_IS_ENABLED(LOAD_FIT)
+	/*
+	 * A FIT in flash is loaded (and decompressed) to the DRAM, instead of
+	 * running the U-Boot in place
+	 */
+	struct image_header *header =
+		(struct image_header *)CONFIG_ASPEED_UBOOT_SPI_BASE;
+
+#if ASPEED_SPL_FALCON
+	if (!spl_start_uboot())
+		return aspeed_spl_kernel_loaded(spl_image,
+				aspeed_spl_load_fit_mem(spl_image,
+					(void *)CONFIG_ASPEED_KERNEL_FIT_SPI_BASE));
+#endif
+
+	if (image_get_magic(header) == FDT_MAGIC)
+		return aspeed_spl_load_fit_mem(spl_image, header);
+#endif
 	spl_image->os = IH_OS_U_BOOT;
 	spl_image->name = "U-Boot";
 	spl_image->entry_point = CONFIG_ASPEED_UBOOT_SPI_BASE;
@@ -30,20 +100,168 @@ static int aspeed_secboot_spl_ram_load_image(struct spl_image_info *spl_image,
 	struct aspeed_secboot_header *sb_hdr =
 		(struct aspeed_secboot_header *)CONFIG_ASPEED_UBOOT_DRAM_BASE - 1;
 
+#if ASPEED_SPL_FALCON
+	if (!spl_start_uboot()) {
+		sb_hdr = (struct aspeed_secboot_header *)CONFIG_ASPEED_KERNEL_FIT_DRAM_BASE - 1;
+		memcpy(sb_hdr, (void *)CONFIG_ASPEED_KERNEL_FIT_SPI_BASE,
+		       CONFIG_ASPEED_KERNEL_FIT_SPI_SIZE);
+		if (aspeed_bl2_verify(sb_hdr, CONFIG_SPL_TEXT_BASE) != 0)
+			return -EPERM;
+
+		return aspeed_spl_kernel_loaded(spl_image,
+				aspeed_spl_load_fit_mem(spl_image,
+					(void *)CONFIG_ASPEED_KERNEL_FIT_DRAM_BASE));
+	}
+#endif
+
+#if IS_ENABLED(CONFIG_ASPEED_UBOOT_XIP)
+	/*
+	 * Verify U-Boot where it is, through the FMC window the HACE can
+	 * read, and run it from the flash: it copies its .data to the DRAM
+	 * itself
+	 */
+	BUILD_BUG_ON(CONFIG_SYS_TEXT_BASE !=
+		     CONFIG_ASPEED_UBOOT_SPI_BASE + sizeof(*sb_hdr));
+	sb_hdr = (struct aspeed_secboot_header *)(ASPEED_FMC_CS0_BASE +
+						  CONFIG_ASPEED_UBOOT_SPI_BASE);
+	if (aspeed_bl2_verify(sb_hdr, CONFIG_SPL_TEXT_BASE) != 0)
+		return -EPERM;
+
+	spl_image->entry_point = CONFIG_SYS_TEXT_BASE;
+#else
 	memcpy(sb_hdr, (void *)(CONFIG_ASPEED_UBOOT_SPI_BASE), CONFIG_ASPEED_UBOOT_SPI_SIZE);
 	if (aspeed_bl2_verify(sb_hdr, CONFIG_SPL_TEXT_BASE) != 0)
 		return -EPERM;
 
+	spl_image->entry_point = CONFIG_ASPEED_UBOOT_DRAM_BASE;
+#endif
 	spl_image->os = IH_OS_U_BOOT;
 	spl_image->name = "U-Boot";
-	spl_image->entry_point = CONFIG_ASPEED_UBOOT_DRAM_BASE;
-	spl_image->load_addr = CONFIG_ASPEED_UBOOT_DRAM_BASE;
+	spl_image->load_addr = spl_image->entry_point;
 
 	return 0;
 }
 SPL_LOAD_IMAGE_METHOD("RAM with Aspeed Secure Boot", 0, ASPEED_SECBOOT_DEVICE_RAM, aspeed_secboot_spl_ram_load_image);
 #endif /* IS_ENABLED(CONFIG_ASPEED_SECURE_BOOT) */
 
+#if ASPEED_SPL_FALCON
+static int aspeed_spl_mmc_select_part(struct mmc *mmc, struct blk_desc *bd,
+				      int part)
+{
+	if (!part)
+		return 0;
+	if (CONFIG_IS_ENABLED(MMC_TINY))
+		return mmc_switch_part(mmc, part);
+
+	return blk_dselect_hwpart(bd, part);
+}
+
+static ulong aspeed_spl_mmc_load_read(struct spl_load_info *load, ulong sector,
+				      ulong count, void *buf)
+{
+	return blk_dread(load->dev, sector, count, buf);
+}
+
+/* Read only the parts of the kernel FIT which are loaded */
+static int aspeed_spl_mmc_load_kernel(struct spl_image_info *spl_image,
+				      struct mmc *mmc, struct blk_desc *bd)
+{
+	struct image_header *header;
+	struct spl_load_info load;
+	int err;
+
+	err = aspeed_spl_mmc_select_part(mmc, bd,
+					 CONFIG_ASPEED_KERNEL_FIT_MMC_PART);
+	if (err)
+		return err;
+
+	header = spl_get_load_buffer(-sizeof(*header), bd->blksz);
+	if (blk_dread(bd, CONFIG_ASPEED_KERNEL_FIT_MMC_BASE, 1, header) != 1) {
+		printf("spl: mmc raw sector read failed\n");
+		return -EIO;
+	}
+	if (image_get_magic(header) != FDT_MAGIC) {
+		printf("spl: no kernel FIT in the mmc\n");
+		return -EINVAL;
+	}
+
+	memset(&load, 0, sizeof(load));
+	load.dev = bd;
+	load.bl_len = bd->blksz;
+	load.read = aspeed_spl_mmc_load_read;
+	err = spl_load_simple_fit(spl_image, &load,
+				  CONFIG_ASPEED_KERNEL_FIT_MMC_BASE, header);
+
+	return aspeed_spl_kernel_loaded(spl_image, err);
+}
+#endif
+
+#if IS_ENABLED(CONFIG_ASPEED_SECURE_BOOT)
+/* mmc blocks read at once, while the engine hashes the ones before */
+#define ASPEED_SECBOOT_MMC_CHUNK	128
+
+/*
+ * Read a signed image to sb_hdr and verify it. The image is hashed piece by
+ * piece while the rest is read, so only the signature check is left once
+ * the last block has landed.
+ */
+static int aspeed_secboot_mmc_read_verify(struct blk_desc *bd, lbaint_t start,
+					  lbaint_t blkcnt,
+					  struct aspeed_secboot_header *sb_hdr)
+{
+	void *bl1_image = (void *)CONFIG_SPL_TEXT_BASE;
+	struct aspeed_digest_ctx *ctx;
+	u8 *buf = (u8 *)sb_hdr;
+	u8 digest[64];
+	lbaint_t i, n;
+	u32 left, len;
+	int ret;
+
+	if (blk_dread(bd, start, 1, buf) != 1)
+		goto read_err;
+
+	left = sb_hdr->sbh_img_size;
+	ctx = memalign(ARCH_DMA_MINALIGN, sizeof(*ctx));
+	if (!ctx || strcmp((char *)sb_hdr->sbh_magic, ASPEED_SECBOOT_MAGIC_STR) ||
+	    left > blkcnt * bd->blksz ||
+	    aspeed_digest_init(ctx, aspeed_bl2_sha_mode(bl1_image))) {
+		/* Read it all and let aspeed_bl2_verify() tell what is wrong */
+		free(ctx);
+		n = blkcnt - 1;
+		if (blk_dread(bd, start + 1, n, buf + bd->blksz) != n)
+			goto read_err;
+		return aspeed_bl2_verify(sb_hdr, bl1_image) ? -EPERM : 0;
+	}
+
+	enable_crypto();
+	ret = 0;
+	for (i = 0; i < blkcnt && !ret; i += n) {
+		n = i ? min_t(lbaint_t, blkcnt - i, ASPEED_SECBOOT_MMC_CHUNK) : 1;
+		if (i && blk_dread(bd, start + i, n, buf + i * bd->blksz) != n) {
+			free(ctx);
+			goto read_err;
+		}
+		len = min_t(u32, left, n * bd->blksz);
+		if (len)
+			ret = aspeed_digest_update(ctx, buf + i * bd->blksz, len);
+		left -= len;
+	}
+	if (!ret)
+		ret = aspeed_digest_final(ctx, digest);
+	free(ctx);
+	if (ret) {
+		printf("spl: hash failed with error: %d\n", ret);
+		return ret;
+	}
+
+	return aspeed_bl2_verify_digest(sb_hdr, bl1_image, digest) ? -EPERM : 0;
+
+read_err:
+	printf("spl: mmc raw sector read failed\n");
+	return -EIO;
+}
+#endif
+
 static int aspeed_spl_mmc_load_image(struct spl_image_info *spl_image,
 				      struct spl_boot_device *bootdev)
 {
@@ -81,6 +299,11 @@ static int aspeed_spl_mmc_load_image(struct spl_image_info *spl_image,
 
 	bd = mmc_get_blk_desc(mmc);
 
+#if ASPEED_SPL_FALCON
+	if (!spl_start_uboot())
+		return aspeed_spl_mmc_load_kernel(spl_image, mmc, bd);
+#endif
+
 	if (part) {
 		if (CONFIG_IS_ENABLED(MMC_TINY))
 			err = mmc_switch_part(mmc, part);
@@ -110,7 +333,6 @@ static int aspeed_secboot_spl_mmc_load_image(struct spl_image_info *spl_image,
 {
 	int err;
 	int part = CONFIG_ASPEED_UBOOT_MMC_PART;
-	u32 count;
 
 	struct mmc *mmc = NULL;
 	struct udevice *dev;
@@ -148,6 +370,27 @@ static int aspeed_secboot_spl_mmc_load_image(struct spl_image_info *spl_image,
 		return -EINVAL;
 	}
 
+#if ASPEED_SPL_FALCON
+	if (!spl_start_uboot()) {
+		/* The whole FIT is read, to be verified */
+		err = aspeed_spl_mmc_select_part(mmc, bd,
+						 CONFIG_ASPEED_KERNEL_FIT_MMC_PART);
+		if (err)
+			return err;
+
+		sb_hdr = (struct aspeed_secboot_header *)CONFIG_ASPEED_KERNEL_FIT_DRAM_BASE - 1;
+		err = aspeed_secboot_mmc_read_verify(bd,
+				CONFIG_ASPEED_KERNEL_FIT_MMC_BASE,
+				CONFIG_ASPEED_KERNEL_FIT_MMC_SIZE, sb_hdr);
+		if (err)
+			return err;
+
+		return aspeed_spl_kernel_loaded(spl_image,
+				aspeed_spl_load_fit_mem(spl_image,
+					(void *)CONFIG_ASPEED_KERNEL_FIT_DRAM_BASE));
+	}
+#endif
+
 	if (part) {
 		if (CONFIG_IS_ENABLED(MMC_TINY))
 			err = mmc_switch_part(mmc, part);
@@ -156,14 +399,11 @@ static int aspeed_secboot_spl_mmc_load_image(struct spl_image_info *spl_image,
 	}
 
 	sb_hdr = (struct aspeed_secboot_header *)CONFIG_ASPEED_UBOOT_DRAM_BASE - 1;
-	count = blk_dread(bd, CONFIG_ASPEED_UBOOT_MMC_BASE, CONFIG_ASPEED_UBOOT_MMC_SIZE, sb_hdr);
-	if (count != (CONFIG_ASPEED_UBOOT_MMC_SIZE)) {
-		printf("spl: mmc raw sector read failed\n");
-		return -EIO;
-	}
-
-	if (aspeed_bl2_verify(sb_hdr, CONFIG_SPL_TEXT_BASE) != 0)
-		return -EPERM;
+	err = aspeed_secboot_mmc_read_verify(bd, CONFIG_ASPEED_UBOOT_MMC_BASE,
+					     CONFIG_ASPEED_UBOOT_MMC_SIZE,
+					     sb_hdr);
+	if (err)
+		return err;
 
 	spl_image->os = IH_OS_U_BOOT;
 	spl_image->name = "U-Boot";
@@ -176,6 +416,14 @@ SPL_LOAD_IMAGE_METHOD("MMC with Aspeed Secure Boot", 0, ASPEED_SECBOOT_DEVICE_MM
 #endif /* IS_ENABLED(CONFIG_ASPEED_SECURE_BOOT) */
 
 #if IS_ENABLED(CONFIG_SPL_YMODEM_SUPPORT)
+#if IS_ENABLED(CONFIG_ASPEED_SPL_YMODEM_G)
+#define YMODEM_MODE		xyzModem_ymodem_g
+#else
+#define YMODEM_MODE		xyzModem_ymodem
+#endif
+
+#define YMODEM_BAUDRATE_TIMEOUT	10000	/* ms for the host to follow */
+
 static int getcymodem(void)
 {
 	if (tstc())
@@ -183,6 +431,44 @@ static int getcymodem(void)
 	return -1;
 }
 
+static void ymodem_baudrate_restore(void)
+{
+	if (gd->baudrate == CONFIG_BAUDRATE)
+		return;
+
+	printf("## Switch baudrate to %d bps\n", CONFIG_BAUDRATE);
+	udelay(50000);
+	gd->baudrate = CONFIG_BAUDRATE;
+	serial_setbrg();
+}
+
+/*
+ * Switch to the transfer baud rate as loady does, but go back to the
+ * console rate if the host does not send ENTER at the new one in time.
+ */
+static void ymodem_baudrate_up(void)
+{
+	ulong start;
+
+	if (!CONFIG_ASPEED_SPL_YMODEM_BAUDRATE ||
+	    gd->baudrate == CONFIG_ASPEED_SPL_YMODEM_BAUDRATE)
+		return;
+
+	printf("## Switch baudrate to %d bps and press ENTER ...\n",
+	       CONFIG_ASPEED_SPL_YMODEM_BAUDRATE);
+	udelay(50000);
+	gd->baudrate = CONFIG_ASPEED_SPL_YMODEM_BAUDRATE;
+	serial_setbrg();
+	udelay(50000);
+
+	start = get_timer(0);
+	while (get_timer(start) < YMODEM_BAUDRATE_TIMEOUT) {
+		if (tstc() && getc() == '\r')
+			return;
+	}
+	ymodem_baudrate_restore();
+}
+
 static int aspeed_spl_ymodem_load_image(struct spl_image_info *spl_image,
 		struct spl_boot_device *bootdev)
 {
@@ -198,9 +484,11 @@ static int aspeed_spl_ymodem_load_image(struct spl_image_info *spl_image,
 	writel(0x0, 0x1e6f20a0);
 	writel(0x0, 0x1e620064);
 
-	conn_info.mode = xyzModem_ymodem;
+	ymodem_baudrate_up();
+	conn_info.mode = YMODEM_MODE;
 	ret = xyzModem_stream_open(&conn_info, &err);
 	if (ret) {
+		ymodem_baudrate_restore();
 		printf("spl: ymodem err - %s\n", xyzModem_error(err));
 		return ret;
 	}
@@ -220,6 +508,7 @@ static int aspeed_spl_ymodem_load_image(struct spl_image_info *spl_image,
 end_stream:
 	xyzModem_stream_close(&err);
 	xyzModem_stream_terminate(false, &getcymodem);
+	ymodem_baudrate_restore();
 
 	return ret;
 }
@@ -243,9 +532,11 @@ static int aspeed_secboot_spl_ymodem_load_image(struct spl_image_info *spl_image
 	writel(0x0, 0x1e6f20a0);
 	writel(0x0, 0x1e620064);
 
-	conn_info.mode = xyzModem_ymodem;
+	ymodem_baudrate_up();
+	conn_info.mode = YMODEM_MODE;
 	ret = xyzModem_stream_open(&conn_info, &err);
 	if (ret) {
+		ymodem_baudrate_restore();
 		printf("spl: ymodem err - %s\n", xyzModem_error(err));
 		return ret;
 	}
@@ -257,8 +548,10 @@ static int aspeed_secboot_spl_ymodem_load_image(struct spl_image_info *spl_image
 		goto end_stream;
 	}
 
-	if (aspeed_bl2_verify(sb_hdr, CONFIG_SPL_TEXT_BASE) != 0)
-		return -EPERM;
+	if (aspeed_bl2_verify(sb_hdr, CONFIG_SPL_TEXT_BASE) != 0) {
+		ret = -EPERM;
+		goto end_stream;
+	}
 
 	spl_image->os = IH_OS_U_BOOT;
 	spl_image->name = "U-Boot";
@@ -268,6 +561,7 @@ static int aspeed_secboot_spl_ymodem_load_image(struct spl_image_info *spl_image
 end_stream:
 	xyzModem_stream_close(&err);
 	xyzModem_stream_terminate(false, &getcymodem);
+	ymodem_baudrate_restore();
 
 	printf("Loaded %lu bytes\n", size);
 
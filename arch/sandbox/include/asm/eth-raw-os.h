@@ -23,6 +23,7 @@
  *		 a message to the server claiming the port is
  *		 unreachable
  * local_bind_udp_port: The UDP port number that we bound to
+ * link: emulated link state, NULL if the link is not emulated
  */
 struct eth_sandbox_raw_priv {
 	int sd;
@@ -32,6 +33,7 @@ struct eth_sandbox_raw_priv {
 	int local;
 	int local_bind_sd;
 	unsigned short local_bind_udp_port;
+	struct sb_eth_link *link;
 };
 
 /* A struct to mimic if_nameindex but that does not depend on Linux headers */
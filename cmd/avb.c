@@ -6,14 +6,36 @@
  */
 
 #include <avb_verify.h>
+#include <blk.h>
 #include <command.h>
 #include <image.h>
 #include <malloc.h>
 #include <mmc.h>
+#include <tpm-v2.h>
 
 #define AVB_BOOTARGS	"avb_bootargs"
 static struct AvbOps *avb_ops;
 
+#if CONFIG_IS_ENABLED(CMD_AVB_VERIFY_CACHE)
+/* Result of the last successful 'avb verify' */
+static struct {
+	bool valid;
+	unsigned long mmc_dev;
+	bool unlocked;
+	ulong blk_writes;	/* blk_write_count() when it was verified */
+	char *cmdline;
+} avb_verified;
+
+static void avb_verified_drop(void)
+{
+	free(avb_verified.cmdline);
+	avb_verified.cmdline = NULL;
+	avb_verified.valid = false;
+}
+#else
+static inline void avb_verified_drop(void) {}
+#endif
+
 static const char * const requested_partitions[] = {"boot",
 					     "system",
 					     "vendor",
@@ -28,6 +50,12 @@ int do_avb_init(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 	mmc_dev = simple_strtoul(argv[1], NULL, 16);
 
+#if CONFIG_IS_ENABLED(CMD_AVB_VERIFY_CACHE)
+	if (avb_verified.mmc_dev != mmc_dev)
+		avb_verified_drop();
+	avb_verified.mmc_dev = mmc_dev;
+#endif
+
 	if (avb_ops)
 		avb_ops_free(avb_ops);
 
@@ -191,6 +219,7 @@ int do_avb_write_rb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	index = (size_t)simple_strtoul(argv[1], NULL, 16);
 	rb_idx = simple_strtoul(argv[2], NULL, 16);
 
+	avb_verified_drop();
 	if (avb_ops->write_rollback_index(avb_ops, index, rb_idx) ==
 	    AVB_IO_RESULT_OK)
 		return CMD_RET_SUCCESS;
@@ -235,6 +264,9 @@ int do_avb_verify_part(cmd_tbl_t *cmdtp, int flag,
 	AvbSlotVerifyData *out_data;
 	char *cmdline;
 	char *extra_args;
+#if CONFIG_IS_ENABLED(MEASURED_BOOT)
+	u8 digest[AVB_SHA256_DIGEST_SIZE];
+#endif
 
 	bool unlocked = false;
 	int res = CMD_RET_FAILURE;
@@ -256,6 +288,18 @@ int do_avb_verify_part(cmd_tbl_t *cmdtp, int flag,
 		return CMD_RET_FAILURE;
 	}
 
+#if CONFIG_IS_ENABLED(CMD_AVB_VERIFY_CACHE)
+	/* Nothing was written since, so nothing can verify differently */
+	if (avb_verified.valid && avb_verified.unlocked == unlocked &&
+	    avb_verified.blk_writes == blk_write_count()) {
+		printf("Verification passed before, reusing its result\n");
+		avb_set_state(avb_ops, AVB_GREEN);
+		env_set(AVB_BOOTARGS, avb_verified.cmdline);
+		return CMD_RET_SUCCESS;
+	}
+	avb_verified_drop();
+#endif
+
 	slot_result =
 		avb_slot_verify(avb_ops,
 				requested_partitions,
@@ -273,6 +317,20 @@ int do_avb_verify_part(cmd_tbl_t *cmdtp, int flag,
 		 */
 		printf("Verification passed successfully\n");
 
+#if CONFIG_IS_ENABLED(MEASURED_BOOT)
+		/*
+		 * The vbmeta images hold the partition digests just checked,
+		 * so measuring their digest avoids hashing the partitions
+		 */
+		avb_slot_verify_data_calculate_vbmeta_digest(out_data,
+							     AVB_DIGEST_TYPE_SHA256,
+							     digest);
+		if (tpm2_measure(CONFIG_MEASURED_BOOT_PCR, digest)) {
+			printf("Can't extend PCR\n");
+			break;
+		}
+#endif
+
 		/* export additional bootargs to AVB_BOOTARGS env var */
 
 		extra_args = avb_set_state(avb_ops, AVB_GREEN);
@@ -284,6 +342,13 @@ int do_avb_verify_part(cmd_tbl_t *cmdtp, int flag,
 
 		env_set(AVB_BOOTARGS, cmdline);
 
+#if CONFIG_IS_ENABLED(CMD_AVB_VERIFY_CACHE)
+		avb_verified.cmdline = strdup(cmdline);
+		avb_verified.valid = avb_verified.cmdline != NULL;
+		avb_verified.unlocked = unlocked;
+		avb_verified.blk_writes = blk_write_count();
+#endif
+
 		res = CMD_RET_SUCCESS;
 		break;
 	case AVB_SLOT_VERIFY_RESULT_ERROR_VERIFICATION:
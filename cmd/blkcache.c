@@ -7,6 +7,7 @@
 #include <config.h>
 #include <common.h>
 #include <malloc.h>
+#include <blk.h>
 #include <part.h>
 
 static int blkc_show(cmd_tbl_t *cmdtp, int flag,
@@ -25,24 +26,58 @@ static int blkc_show(cmd_tbl_t *cmdtp, int flag,
 	return 0;
 }
 
+static int blkc_stats(cmd_tbl_t *cmdtp, int flag,
+		      int argc, char * const argv[])
+{
+	struct block_cache_dev_stats stats;
+	int i;
+
+	printf("device    hits     misses   entries        "
+	       "ra reads  ra blocks  ra hits\n");
+	for (i = 0; !blkcache_dev_stats(i, &stats); i++)
+		printf("%-5s %-3d %-8u %-8u %4u/%-4u x%-3u %-9u %-10u %u\n",
+		       blk_get_if_type_name(stats.iftype), stats.devnum,
+		       stats.hits, stats.misses, stats.entries,
+		       stats.max_entries, stats.max_blocks_per_entry,
+		       stats.ra_reads, stats.ra_blocks, stats.ra_hits);
+	return 0;
+}
+
 static int blkc_configure(cmd_tbl_t *cmdtp, int flag,
 			  int argc, char * const argv[])
 {
 	unsigned blocks_per_entry, max_entries;
-	if (argc != 3)
+	struct blk_desc *desc;
+
+	if (argc != 3 && argc != 5)
 		return CMD_RET_USAGE;
 
 	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
 	max_entries = simple_strtoul(argv[2], 0, 0);
-	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	if (argc == 3) {
+		blkcache_configure(blocks_per_entry, max_entries);
+		printf("changed to max of %u entries of %u blocks each\n",
+		       max_entries, blocks_per_entry);
+		return 0;
+	}
+
+	desc = blk_get_dev(argv[3], simple_strtoul(argv[4], 0, 0));
+	if (!desc) {
+		printf("no such device %s %s\n", argv[3], argv[4]);
+		return CMD_RET_FAILURE;
+	}
+	if (blkcache_configure_dev(desc->if_type, desc->devnum,
+				   blocks_per_entry, max_entries))
+		return CMD_RET_FAILURE;
+	printf("changed %s %s to max of %u entries of %u blocks each\n",
+	       argv[3], argv[4], max_entries, blocks_per_entry);
 	return 0;
 }
 
 static cmd_tbl_t cmd_blkc_sub[] = {
 	U_BOOT_CMD_MKENT(show, 0, 0, blkc_show, "", ""),
-	U_BOOT_CMD_MKENT(configure, 3, 0, blkc_configure, "", ""),
+	U_BOOT_CMD_MKENT(stats, 0, 0, blkc_stats, "", ""),
+	U_BOOT_CMD_MKENT(configure, 5, 0, blkc_configure, "", ""),
 };
 
 static __maybe_unused void blkc_reloc(void)
@@ -79,8 +114,10 @@ static int do_blkcache(cmd_tbl_t *cmdtp, int flag,
 }
 
 U_BOOT_CMD(
-	blkcache, 4, 0, do_blkcache,
+	blkcache, 6, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure blocks entries\n"
+	"blkcache stats - show and reset statistics per device\n"
+	"blkcache configure blocks entries [interface dev]\n"
+	"    - set the size of the cache, of all devices or just one"
 );
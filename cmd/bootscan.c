@@ -0,0 +1,413 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Scan block devices for something to boot
+ *
+ * This does for block devices what the scan_dev_for_* scripts of
+ * config_distro_bootcmd.h do, without running a dozen commands for each
+ * partition: each device is enumerated once, the filesystem of a partition
+ * is found from one read of its first blocks and the candidate files are
+ * looked up with one pass over each prefix directory. What was found is
+ * kept until a block device is written to. Booting itself still goes
+ * through the boot_extlinux, boot_a_script and scan_dev_for_efi scripts.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <command.h>
+#include <environment.h>
+#include <errno.h>
+#include <fs.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <part.h>
+#include <asm/unaligned.h>
+#include <linux/ctype.h>
+
+#define BOOTSCAN_MAX_PARTS	16	/* partitions remembered */
+#define BOOTSCAN_MAX_FILES	4	/* boot files remembered per partition */
+#define BOOTSCAN_MAX_SCRIPTS	8	/* names in boot_scripts */
+#define BOOTSCAN_SNIFF_SIZE	2048	/* FAT boot sector and ext superblock */
+#define BOOTSCAN_NAME_LEN	64
+
+enum bootscan_kind {
+	BOOTSCAN_EXTLINUX,
+	BOOTSCAN_SCRIPT,
+};
+
+struct bootscan_file {
+	enum bootscan_kind kind;
+	char prefix[BOOTSCAN_NAME_LEN];
+	char script[BOOTSCAN_NAME_LEN];	/* empty for extlinux */
+};
+
+struct bootscan_part {
+	struct blk_desc *desc;		/* NULL if the slot is free */
+	lbaint_t start;
+	bool has_fs;
+	int count;
+	struct bootscan_file file[BOOTSCAN_MAX_FILES];
+};
+
+static struct {
+	struct bootscan_part part[BOOTSCAN_MAX_PARTS];
+	int next;		/* slot to replace next */
+	ulong blk_writes;	/* blk_write_count() when filled */
+	char *settings;		/* the variables the results depend on */
+} bootscan_cache;
+
+/* Block device types, with the command which finds their devices */
+static const struct {
+	const char *name;
+	const char *init;
+} bootscan_types[] = {
+	{ "mmc", NULL },
+	{ "usb", "usb start" },
+	{ "scsi", "scsi scan" },
+	{ "sata", "sata init" },
+	{ "nvme", "nvme scan" },
+	{ "virtio", "virtio scan" },
+	{ "ide", NULL },
+	{ "host", NULL },
+};
+
+struct bootscan_ctx {
+	const char *devtype;
+	int devnum;
+	char devpart[16];	/* "<devnum>:<part>" */
+	int fstype;
+	bool fat;		/* file names are case-insensitive */
+	const char *conf;	/* boot_syslinux_conf */
+	char conf_dir[BOOTSCAN_NAME_LEN];
+	char *scripts[BOOTSCAN_MAX_SCRIPTS];
+	int script_count;
+};
+
+/* Drop what was found if anything it depends on may have changed */
+static void bootscan_cache_check(void)
+{
+	char settings[CONFIG_SYS_CBSIZE];
+	int i;
+
+	snprintf(settings, sizeof(settings), "%s|%s|%s",
+		 env_get("boot_prefixes") ?: "", env_get("boot_scripts") ?: "",
+		 env_get("boot_syslinux_conf") ?: "");
+	if (bootscan_cache.blk_writes == blk_write_count() &&
+	    bootscan_cache.settings && !strcmp(bootscan_cache.settings, settings))
+		return;
+
+	for (i = 0; i < BOOTSCAN_MAX_PARTS; i++)
+		bootscan_cache.part[i].desc = NULL;
+	free(bootscan_cache.settings);
+	bootscan_cache.settings = strdup(settings);
+	bootscan_cache.blk_writes = blk_write_count();
+}
+
+/*
+ * Find the filesystem from the start of the partition, instead of trying
+ * the probe of each filesystem in turn
+ */
+static int bootscan_fstype(struct blk_desc *desc, disk_partition_t *info)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, buf, 2 * BOOTSCAN_SNIFF_SIZE);
+	lbaint_t cnt = DIV_ROUND_UP(BOOTSCAN_SNIFF_SIZE, desc->blksz);
+
+	if (cnt * desc->blksz > 2 * BOOTSCAN_SNIFF_SIZE ||
+	    blk_dread(desc, info->start, cnt, buf) != cnt)
+		return FS_TYPE_ANY;
+
+	if (get_unaligned_le16(buf + 1024 + 56) == 0xef53)
+		return FS_TYPE_EXT;
+	if (buf[510] == 0x55 && buf[511] == 0xaa &&
+	    (!memcmp(buf + 0x36, "FAT", 3) || !memcmp(buf + 0x52, "FAT", 3)))
+		return FS_TYPE_FAT;
+
+	return FS_TYPE_ANY;
+}
+
+static int bootscan_set_dev(struct bootscan_ctx *ctx)
+{
+	return fs_set_blk_dev(ctx->devtype, ctx->devpart, ctx->fstype);
+}
+
+static bool bootscan_exists(struct bootscan_ctx *ctx, const char *prefix,
+			    const char *name)
+{
+	char path[2 * BOOTSCAN_NAME_LEN];
+
+	snprintf(path, sizeof(path), "%s%s", prefix, name);
+	if (bootscan_set_dev(ctx))
+		return false;
+
+	return fs_exists(path);
+}
+
+static bool bootscan_name_eq(struct bootscan_ctx *ctx, const char *a,
+			     const char *b)
+{
+	return ctx->fat ? !strcasecmp(a, b) : !strcmp(a, b);
+}
+
+static void bootscan_add(struct bootscan_part *bp, enum bootscan_kind kind,
+			 const char *prefix, const char *script)
+{
+	struct bootscan_file *file;
+
+	if (bp->count == BOOTSCAN_MAX_FILES)
+		return;
+	file = &bp->file[bp->count++];
+	file->kind = kind;
+	strlcpy(file->prefix, prefix, sizeof(file->prefix));
+	strlcpy(file->script, script ?: "", sizeof(file->script));
+}
+
+/* Look for the boot files in one directory, in the order the scripts do */
+static void bootscan_dir(struct bootscan_ctx *ctx, struct bootscan_part *bp,
+			 const char *prefix)
+{
+	bool found[BOOTSCAN_MAX_SCRIPTS] = { false };
+	bool conf = false;
+	struct fs_dir_stream *dirs;
+	struct fs_dirent *dent;
+	int i;
+
+	if (bootscan_set_dev(ctx)) {
+		if (ctx->fstype == FS_TYPE_ANY)
+			return;
+		/* Not that filesystem after all, or it is not enabled */
+		ctx->fstype = FS_TYPE_ANY;
+		if (bootscan_set_dev(ctx))
+			return;
+	}
+	bp->has_fs = true;
+	ctx->fat = !strcmp(fs_get_type_name(), "fat");
+	dirs = fs_opendir(prefix);
+	if (!dirs && errno != EACCES)
+		return;
+
+	if (dirs) {
+		while ((dent = fs_readdir(dirs))) {
+			if (ctx->conf && bootscan_name_eq(ctx, dent->name,
+							  ctx->conf_dir))
+				conf = true;
+			for (i = 0; i < ctx->script_count; i++) {
+				if (dent->type != FS_DT_DIR &&
+				    bootscan_name_eq(ctx, dent->name,
+						     ctx->scripts[i]))
+					found[i] = true;
+			}
+		}
+		fs_closedir(dirs);
+		if (conf && strcmp(ctx->conf, ctx->conf_dir))
+			conf = bootscan_exists(ctx, prefix, ctx->conf);
+	} else {
+		/* The filesystem cannot list directories */
+		conf = ctx->conf && bootscan_exists(ctx, prefix, ctx->conf);
+		for (i = 0; i < ctx->script_count; i++)
+			found[i] = bootscan_exists(ctx, prefix,
+						   ctx->scripts[i]);
+	}
+
+	if (conf)
+		bootscan_add(bp, BOOTSCAN_EXTLINUX, prefix, NULL);
+	for (i = 0; i < ctx->script_count; i++) {
+		if (found[i])
+			bootscan_add(bp, BOOTSCAN_SCRIPT, prefix,
+				     ctx->scripts[i]);
+	}
+}
+
+static struct bootscan_part *bootscan_part(struct bootscan_ctx *ctx,
+					   struct blk_desc *desc, int part)
+{
+	struct bootscan_part *bp;
+	disk_partition_t info;
+	char *prefixes, *prefix, *p;
+	int i;
+
+	if (part_get_info(desc, part, &info))
+		return NULL;
+
+	for (i = 0; i < BOOTSCAN_MAX_PARTS; i++) {
+		bp = &bootscan_cache.part[i];
+		if (bp->desc == desc && bp->start == info.start)
+			return bp;
+	}
+
+	bp = &bootscan_cache.part[bootscan_cache.next];
+	bootscan_cache.next = (bootscan_cache.next + 1) % BOOTSCAN_MAX_PARTS;
+	bp->desc = desc;
+	bp->start = info.start;
+	bp->count = 0;
+	bp->has_fs = false;
+
+	ctx->fstype = bootscan_fstype(desc, &info);
+	prefixes = strdup(env_get("boot_prefixes") ?: "");
+	if (!prefixes)
+		return bp;
+	for (p = prefixes; (prefix = strsep(&p, " ")); ) {
+		if (*prefix)
+			bootscan_dir(ctx, bp, prefix);
+	}
+	free(prefixes);
+
+	return bp;
+}
+
+static void bootscan_boot(struct bootscan_ctx *ctx,
+			  struct bootscan_file *file)
+{
+	env_set("prefix", file->prefix);
+	if (file->kind == BOOTSCAN_EXTLINUX) {
+		printf("Found %s%s\n", file->prefix, ctx->conf);
+		run_command("run boot_extlinux", 0);
+	} else {
+		env_set("script", file->script);
+		printf("Found U-Boot script %s%s\n", file->prefix,
+		       file->script);
+		run_command("run boot_a_script", 0);
+	}
+	printf("SCRIPT FAILED: continuing...\n");
+}
+
+static void bootscan_dev(struct bootscan_ctx *ctx, struct blk_desc *desc,
+			 bool list)
+{
+	int parts[MAX_SEARCH_PARTITIONS];
+	struct bootscan_part *bp;
+	disk_partition_t info;
+	char part[12];
+	int count = 0;
+	int i, p;
+
+	/* Bootable partitions, else the first one, as 'part list' finds them */
+	for (p = 1; p < MAX_SEARCH_PARTITIONS; p++) {
+		if (!part_get_info(desc, p, &info) && info.bootable)
+			parts[count++] = p;
+	}
+	if (!count)
+		parts[count++] = 1;
+
+	for (i = 0; i < count; i++) {
+		snprintf(ctx->devpart, sizeof(ctx->devpart), "%x:%x",
+			 ctx->devnum, parts[i]);
+		bp = bootscan_part(ctx, desc, parts[i]);
+		if (!bp || !bp->has_fs)
+			continue;
+
+		snprintf(part, sizeof(part), "%x", parts[i]);
+		printf("Scanning %s %s...\n", ctx->devtype, ctx->devpart);
+		if (list) {
+			for (p = 0; p < bp->count; p++)
+				printf("  %s%s\n", bp->file[p].prefix,
+				       bp->file[p].kind == BOOTSCAN_EXTLINUX ?
+				       ctx->conf : bp->file[p].script);
+			continue;
+		}
+
+		env_set("devtype", ctx->devtype);
+		env_set_ulong("devnum", ctx->devnum);
+		env_set("distro_bootpart", part);
+		for (p = 0; p < bp->count; p++)
+			bootscan_boot(ctx, &bp->file[p]);
+		if (env_get("scan_dev_for_efi"))
+			run_command("run scan_dev_for_efi", 0);
+	}
+}
+
+static void bootscan_target(struct bootscan_ctx *ctx, const char *target,
+			    bool *inited, bool list)
+{
+	char cmd[CONFIG_SYS_CBSIZE];
+	struct blk_desc *desc;
+	const char *num;
+	int i;
+
+	for (num = target; *num && !isdigit(*num); num++)
+		;
+	for (i = 0; i < ARRAY_SIZE(bootscan_types); i++) {
+		if (*num && strlen(bootscan_types[i].name) == num - target &&
+		    !strncmp(bootscan_types[i].name, target, num - target))
+			break;
+	}
+
+	/* Network and other targets are left to their scripts */
+	if (i == ARRAY_SIZE(bootscan_types)) {
+		if (!list) {
+			snprintf(cmd, sizeof(cmd), "run bootcmd_%s", target);
+			run_command(cmd, 0);
+		}
+		return;
+	}
+
+	if (bootscan_types[i].init && !inited[i]) {
+		run_command(bootscan_types[i].init, 0);
+		inited[i] = true;
+	}
+
+	ctx->devtype = bootscan_types[i].name;
+	ctx->devnum = simple_strtoul(num, NULL, 10);
+	desc = blk_get_dev(ctx->devtype, ctx->devnum);
+	if (!desc || desc->type == DEV_TYPE_UNKNOWN)
+		return;
+
+	bootscan_dev(ctx, desc, list);
+}
+
+static int do_bootscan(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char * const argv[])
+{
+	bool inited[ARRAY_SIZE(bootscan_types)] = { false };
+	struct bootscan_ctx ctx = { NULL };
+	char *targets, *target, *scripts, *p;
+	bool list = false;
+	int i;
+
+	if (argc > 1 && !strcmp(argv[1], "-l")) {
+		list = true;
+		argc--;
+		argv++;
+	}
+
+	bootscan_cache_check();
+
+	ctx.conf = env_get("boot_syslinux_conf");
+	if (ctx.conf) {
+		strlcpy(ctx.conf_dir, ctx.conf, sizeof(ctx.conf_dir));
+		p = strchr(ctx.conf_dir, '/');
+		if (p)
+			*p = '\0';
+	}
+	scripts = strdup(env_get("boot_scripts") ?: "");
+	if (!scripts)
+		return CMD_RET_FAILURE;
+	for (p = scripts; ctx.script_count < BOOTSCAN_MAX_SCRIPTS &&
+	     (target = strsep(&p, " ")); ) {
+		if (*target)
+			ctx.scripts[ctx.script_count++] = target;
+	}
+
+	if (argc > 1) {
+		for (i = 1; i < argc; i++)
+			bootscan_target(&ctx, argv[i], inited, list);
+	} else {
+		targets = strdup(env_get("boot_targets") ?: "");
+		for (p = targets; p && (target = strsep(&p, " ")); ) {
+			if (*target)
+				bootscan_target(&ctx, target, inited, list);
+		}
+		free(targets);
+	}
+	free(scripts);
+
+	return list ? CMD_RET_SUCCESS : CMD_RET_FAILURE;
+}
+
+U_BOOT_CMD(
+	bootscan, CONFIG_SYS_MAXARGS, 1, do_bootscan,
+	"scan the boot targets for something to boot",
+	"[-l] [<target>...]\n"
+	"    - boot from the first of <target>s, or of ${boot_targets}, with\n"
+	"      an extlinux.conf, U-Boot script or EFI binary, as\n"
+	"      distro_bootcmd does\n"
+	"      -l: only list the boot files found on block devices"
+);
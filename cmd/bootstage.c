@@ -4,6 +4,7 @@
  */
 
 #include <common.h>
+#include <mapmem.h>
 
 static int do_bootstage_report(cmd_tbl_t *cmdtp, int flag, int argc,
 			       char * const argv[])
@@ -57,10 +58,39 @@ static int do_bootstage_stash(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+static int do_bootstage_export(cmd_tbl_t *cmdtp, int flag, int argc,
+			       char * const argv[])
+{
+	ulong base, size = 0x10000;
+	char *buf, *endp;
+	int len;
+
+	if (argc < 2 || argc > 3)
+		return CMD_RET_USAGE;
+	base = simple_strtoul(argv[1], &endp, 16);
+	if (*endp)
+		return CMD_RET_USAGE;
+	if (argc == 3)
+		size = simple_strtoul(argv[2], NULL, 16);
+
+	buf = map_sysmem(base, size);
+	len = bootstage_export(buf, size);
+	unmap_sysmem(buf);
+	if (len > size) {
+		printf("Export needs %#x bytes, only %#lx available\n", len,
+		       size);
+		return 1;
+	}
+	env_set_hex("filesize", len);
+
+	return 0;
+}
+
 static cmd_tbl_t cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
+	U_BOOT_CMD_MKENT(export, 3, 0, do_bootstage_export, "", ""),
 };
 
 /*
@@ -90,5 +120,6 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
-	"unstash [<start> [<size>]]  - Unstash data from memory"
+	"unstash [<start> [<size>]]  - Unstash data from memory\n"
+	"export <addr> [<size>]      - Write a Chrome trace (JSON), set filesize"
 );
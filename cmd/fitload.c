@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Load the FDT part of a FIT, leaving its external data where it is until
+ * bootm asks for it
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <command.h>
+#include <errno.h>
+#include <fs.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <part.h>
+#include <spi_flash.h>
+
+static struct fitload_src {
+	struct fit_lazy_src src;
+	ulong base;			/* byte offset of the FIT */
+	/* part */
+	struct blk_desc *desc;
+	disk_partition_t info;
+	u8 *block;
+	/* file */
+	char ifname[16];
+	char dev_part[32];
+	char filename[256];
+	/* sf */
+	struct spi_flash *flash;
+} fitload;
+
+static int fitload_part_read(struct fit_lazy_src *src, ulong offset,
+			     ulong size, void *buf)
+{
+	struct blk_desc *desc = fitload.desc;
+	ulong blksz = desc->blksz;
+	lbaint_t blk, count;
+	ulong skip, len;
+
+	offset += fitload.base;
+	blk = fitload.info.start + offset / blksz;
+	skip = offset % blksz;
+
+	while (size) {
+		if (skip || size < blksz) {
+			/* Partial block at either end */
+			if (blk_dread(desc, blk, 1, fitload.block) != 1)
+				return -EIO;
+			len = min(size, blksz - skip);
+			memcpy(buf, fitload.block + skip, len);
+			count = 1;
+			skip = 0;
+		} else {
+			count = size / blksz;
+			if (blk_dread(desc, blk, count, buf) != count)
+				return -EIO;
+			len = count * blksz;
+		}
+		blk += count;
+		buf += len;
+		size -= len;
+	}
+
+	return 0;
+}
+
+static int fitload_file_read(struct fit_lazy_src *src, ulong offset,
+			     ulong size, void *buf)
+{
+	loff_t actread;
+	int ret;
+
+	/* fs_read() closes the filesystem again */
+	if (fs_set_blk_dev(fitload.ifname, fitload.dev_part, FS_TYPE_ANY))
+		return -ENODEV;
+	ret = fs_read(fitload.filename, map_to_sysmem(buf), offset, size,
+		      &actread);
+	if (ret)
+		return ret;
+
+	return actread == size ? 0 : -EIO;
+}
+
+#ifdef CONFIG_SPI_FLASH
+static int fitload_sf_read(struct fit_lazy_src *src, ulong offset,
+			   ulong size, void *buf)
+{
+	return spi_flash_read(fitload.flash, fitload.base + offset, size, buf);
+}
+#endif
+
+static int fitload_open(ulong addr)
+{
+	void *buf = map_sysmem(addr, 0);
+	int ret;
+
+	ret = fit_lazy_open(&fitload.src, buf);
+	if (ret) {
+		printf("Can't read FIT: %d\n", ret);
+		return CMD_RET_FAILURE;
+	}
+	printf("%d bytes of FIT read to %08lx\n", fdt_totalsize(buf), addr);
+	env_set_hex("fileaddr", addr);
+
+	return 0;
+}
+
+static int do_fitload_part(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	if (argc < 4 || argc > 5)
+		return CMD_RET_USAGE;
+
+	if (blk_get_device_part_str(argv[1], argv[2], &fitload.desc,
+				    &fitload.info, 1) < 0)
+		return CMD_RET_FAILURE;
+	fitload.base = argc == 5 ? simple_strtoul(argv[4], NULL, 16) : 0;
+
+	free(fitload.block);
+	fitload.block = memalign(ARCH_DMA_MINALIGN, fitload.desc->blksz);
+	if (!fitload.block)
+		return CMD_RET_FAILURE;
+	fitload.src.read = fitload_part_read;
+
+	return fitload_open(simple_strtoul(argv[3], NULL, 16));
+}
+
+static int do_fitload_file(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	if (argc != 5)
+		return CMD_RET_USAGE;
+
+	strlcpy(fitload.ifname, argv[1], sizeof(fitload.ifname));
+	strlcpy(fitload.dev_part, argv[2], sizeof(fitload.dev_part));
+	strlcpy(fitload.filename, argv[4], sizeof(fitload.filename));
+	fitload.src.read = fitload_file_read;
+
+	return fitload_open(simple_strtoul(argv[3], NULL, 16));
+}
+
+#ifdef CONFIG_SPI_FLASH
+static int do_fitload_sf(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char * const argv[])
+{
+	if (argc != 3)
+		return CMD_RET_USAGE;
+
+	if (!fitload.flash) {
+		fitload.flash = spi_flash_probe(CONFIG_SF_DEFAULT_BUS,
+						CONFIG_SF_DEFAULT_CS,
+						CONFIG_SF_DEFAULT_SPEED,
+						CONFIG_SF_DEFAULT_MODE);
+		if (!fitload.flash) {
+			puts("SPI probe failed\n");
+			return CMD_RET_FAILURE;
+		}
+	}
+	fitload.base = simple_strtoul(argv[2], NULL, 16);
+	fitload.src.read = fitload_sf_read;
+
+	return fitload_open(simple_strtoul(argv[1], NULL, 16));
+}
+#endif
+
+static cmd_tbl_t cmd_fitload_sub[] = {
+	U_BOOT_CMD_MKENT(part, 5, 0, do_fitload_part, "", ""),
+	U_BOOT_CMD_MKENT(file, 5, 0, do_fitload_file, "", ""),
+#ifdef CONFIG_SPI_FLASH
+	U_BOOT_CMD_MKENT(sf, 3, 0, do_fitload_sf, "", ""),
+#endif
+};
+
+static int do_fitload(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* Strip off leading argument */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], &cmd_fitload_sub[0],
+			 ARRAY_SIZE(cmd_fitload_sub));
+	if (!c)
+		return CMD_RET_USAGE;
+
+	return c->cmd(cmdtp, flag, argc, argv);
+}
+
+U_BOOT_CMD(
+	fitload, 6, 0, do_fitload,
+	"load a FIT, reading its subimages only when they are booted",
+	"part <interface> <dev[:part]> <addr> [offset]\n"
+	"    - FIT at hex byte offset in a partition or whole device\n"
+	"fitload file <interface> <dev[:part]> <addr> <filename>\n"
+	"    - FIT in a file\n"
+#ifdef CONFIG_SPI_FLASH
+	"fitload sf <addr> <offset>\n"
+	"    - FIT at offset in the default SPI flash\n"
+#endif
+	"The FDT part of the FIT is read to addr. Boot it with 'bootm addr';\n"
+	"only subimages with external data (mkimage -E) are read lazily."
+);
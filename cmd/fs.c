@@ -27,14 +27,16 @@ static int do_load_wrapper(cmd_tbl_t *cmdtp, int flag, int argc,
 				char * const argv[])
 {
 #ifdef CONFIG_CMD_BOOTEFI
-	efi_set_bootdev(argv[1], (argc > 2) ? argv[2] : "",
-			(argc > 4) ? argv[4] : "");
+	int z = argc > 1 && !strcmp(argv[1], "-z");
+
+	efi_set_bootdev(argv[1 + z], (argc > 2 + z) ? argv[2 + z] : "",
+			(argc > 4 + z) ? argv[4 + z] : "");
 #endif
 	return do_load(cmdtp, flag, argc, argv, FS_TYPE_ANY);
 }
 
 U_BOOT_CMD(
-	load,	7,	0,	do_load_wrapper,
+	load,	8,	0,	do_load_wrapper,
 	"load binary file from a filesystem",
 	"<interface> [<dev[:part]> [<addr> [<filename> [bytes [pos]]]]]\n"
 	"    - Load binary file 'filename' from partition 'part' on device\n"
@@ -43,6 +45,13 @@ U_BOOT_CMD(
 	"      If 'bytes' is 0 or omitted, the file is read until the end.\n"
 	"      'pos' gives the file byte position to start reading from.\n"
 	"      If 'pos' is 0 or omitted, the file is read from the start."
+#ifdef CONFIG_DECOMP_STREAM
+	"\nload -z <interface> [<dev[:part]> [<addr> [<filename> [bytes [pos]]]]]\n"
+	"    - Load a gzip, LZ4 or zstd compressed file, decompressing it\n"
+	"      to 'addr' while it is read. 'bytes' is then the largest\n"
+	"      size it may decompress to, and 'filesize' is set to the\n"
+	"      decompressed size."
+#endif
 )
 
 static int do_save_wrapper(cmd_tbl_t *cmdtp, int flag, int argc,
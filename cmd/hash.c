@@ -36,20 +36,27 @@ static int do_hash(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	return hash_command(*argv, flags, cmdtp, flag, argc - 1, argv + 1);
 }
 
-#ifdef CONFIG_HASH_VERIFY
-#define HARGS 6
-#else
-#define HARGS 5
-#endif
-
 U_BOOT_CMD(
-	hash,	HARGS,	1,	do_hash,
+	hash,	CONFIG_SYS_MAXARGS,	1,	do_hash,
 	"compute hash message digest",
-	"algorithm address count [[*]hash_dest]\n"
-		"    - compute message digest [save to env var / *address]"
+	"algorithm[,algorithm...] address count [[*]hash_dest...]\n"
+		"    - compute message digests in a single pass\n"
+		"      [save to env vars / *addresses, one per algorithm]"
+#ifdef CONFIG_HASH_DEVICE
+	"\nhash algorithm[,algorithm...] blk <interface> <dev[:part]> offset count\n"
+		"    [[*]hash_dest...]\n"
+		"    - compute message digests of a block device range\n"
+		"hash algorithm[,algorithm...] mtd <name> offset count [[*]hash_dest...]\n"
+		"    - compute message digests of an MTD device range"
+#endif
 #ifdef CONFIG_HASH_VERIFY
-	"\nhash -v algorithm address count [*]hash\n"
-		"    - verify message digest of memory area to immediate value, \n"
-		"      env var or *address"
+	"\nhash -v algorithm[,algorithm...] address count [*]hash...\n"
+		"    - verify message digests of memory area to immediate values, \n"
+		"      env vars or *addresses"
+#ifdef CONFIG_HASH_DEVICE
+	"\nhash -v algorithm[,algorithm...] {blk <interface> <dev[:part]> | mtd <name>}\n"
+		"    offset count [*]hash...\n"
+		"    - verify message digests of a device range"
+#endif
 #endif
 );
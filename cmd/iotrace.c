@@ -5,20 +5,25 @@
 
 #include <common.h>
 #include <command.h>
+#include <div64.h>
 #include <iotrace.h>
+#include <mapmem.h>
 
 static void do_print_stats(void)
 {
 	ulong start, size, needed_size, offset, count;
+	ulong region, region_size;
+	int i;
 
 	printf("iotrace is %sabled\n", iotrace_get_enabled() ? "en" : "dis");
 	iotrace_get_buffer(&start, &size, &needed_size, &offset, &count);
 	printf("Start:  %08lx\n", start);
 	printf("Actual Size:   %08lx\n", size);
 	printf("Needed Size:   %08lx\n", needed_size);
-	iotrace_get_region(&start, &size);
-	printf("Region: %08lx\n", start);
-	printf("Size:   %08lx\n", size);
+	for (i = 0; !iotrace_get_region(i, &region, &region_size); i++) {
+		printf("Region: %08lx\n", region);
+		printf("Size:   %08lx\n", region_size);
+	}
 	printf("Offset: %08lx\n", offset);
 	printf("Output: %08lx\n", start + offset);
 	printf("Count:  %08lx\n", count);
@@ -36,25 +41,76 @@ static void do_print_trace(void)
 	if (!start || !size || !count)
 		return;
 
-	printf("Timestamp  Value          Address\n");
+	printf("Ticks      Duration  Value          Address\n");
 
-	cur_record = (struct iotrace_record *)start;
+	cur_record = map_sysmem(start + sizeof(struct iotrace_hdr),
+				count * sizeof(*cur_record));
 	for (int i = 0; i < count; i++) {
-		if (cur_record->flags & IOT_WRITE)
-			printf("%08llu: 0x%08lx --> 0x%08llx\n",
-			       cur_record->timestamp,
-					cur_record->value,
-					(unsigned long long)cur_record->addr);
-		else
-			printf("%08llu: 0x%08lx <-- 0x%08llx\n",
-			       cur_record->timestamp,
-					cur_record->value,
-					(unsigned long long)cur_record->addr);
+		printf("%10u %8u: 0x%08x %s 0x%08llx\n",
+		       cur_record->ticks, cur_record->duration,
+		       cur_record->value,
+		       cur_record->flags & IOT_WRITE ? "-->" : "<--",
+		       (unsigned long long)cur_record->addr);
 
 		cur_record++;
 	}
 }
 
+static int h_cmp_summary(const void *v1, const void *v2)
+{
+	const struct iotrace_summary *s1 = v1, *s2 = v2;
+
+	if (s1->ticks == s2->ticks)
+		return 0;
+
+	return s1->ticks < s2->ticks ? 1 : -1;
+}
+
+static void do_print_summary(void)
+{
+	struct iotrace_summary *summary, *entry;
+	ulong rate = get_tbclk();
+	u64 us;
+	int i, count;
+
+	summary = iotrace_get_summary(&count);
+	if (!summary) {
+		printf("Use 'iotrace summary on' first\n");
+		return;
+	}
+
+	/* Show the registers which took the most time first */
+	qsort(summary, count, sizeof(*summary), h_cmp_summary);
+	printf("Address         Reads    Writes     Ticks        us\n");
+	for (i = 0, entry = summary; i < count; i++, entry++) {
+		if (!(entry->reads + entry->writes))
+			continue;
+		us = entry->ticks * 1000000;
+		if (rate)
+			do_div(us, rate);
+		printf("0x%08llx %10u %9u %9llu %9llu\n",
+		       (unsigned long long)entry->addr, entry->reads,
+		       entry->writes, entry->ticks, us);
+	}
+}
+
+static int do_summary(int argc, char * const argv[])
+{
+	if (!argc) {
+		do_print_summary();
+		return 0;
+	}
+	if (argc != 1)
+		return CMD_RET_USAGE;
+
+	if (iotrace_set_summary(!strcmp(argv[0], "on"))) {
+		printf("Out of memory\n");
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
 static int do_set_buffer(int argc, char * const argv[])
 {
 	ulong addr = 0, size = 0;
@@ -82,7 +138,12 @@ static int do_set_region(int argc, char * const argv[])
 		return CMD_RET_USAGE;
 	}
 
-	iotrace_set_region(addr, size);
+	if (!size) {
+		iotrace_reset_region();
+	} else if (iotrace_add_region(addr, size)) {
+		printf("Too many regions (max %d)\n", IOTRACE_MAX_REGIONS);
+		return CMD_RET_FAILURE;
+	}
 
 	return 0;
 }
@@ -93,6 +154,8 @@ int do_iotrace(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 	if (!cmd)
 		return cmd_usage(cmdtp);
+	if (!strcmp(cmd, "summary"))
+		return do_summary(argc - 2, argv + 2);
 	switch (*cmd) {
 	case 'b':
 		return do_set_buffer(argc - 2, argv + 2);
@@ -122,8 +185,12 @@ U_BOOT_CMD(
 	"iotrace utility commands",
 	"stats                        - display iotrace stats\n"
 	"iotrace buffer <address> <size>      - set iotrace buffer\n"
-	"iotrace limit <address> <size>       - set iotrace region limit\n"
+	"iotrace limit <address> <size>       - add an iotrace region limit\n"
+	"iotrace limit                        - trace all regions\n"
 	"iotrace pause                        - pause tracing\n"
 	"iotrace resume                       - resume tracing\n"
-	"iotrace dump                         - dump iotrace buffer"
+	"iotrace dump                         - dump iotrace buffer\n"
+	"iotrace summary on|off               - count accesses per register\n"
+	"                                       instead of recording them\n"
+	"iotrace summary                      - show accesses per register"
 );
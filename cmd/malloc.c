@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Show heap usage recorded by CONFIG_MALLOC_PROFILE
+ */
+
+#include <common.h>
+#include <bloblist.h>
+#include <command.h>
+#include <malloc_profile.h>
+
+static void show_spl_profile(void)
+{
+	struct malloc_profile_handoff *ho;
+
+	if (!CONFIG_IS_ENABLED(BLOBLIST))
+		return;
+	ho = bloblist_find(BLOBLISTT_MALLOC_PROFILE, sizeof(*ho));
+	if (!ho)
+		return;
+	printf("SPL:\n");
+	printf("Early heap: %x of %x bytes used\n", ho->simple_used,
+	       ho->simple_size);
+	if (ho->heap_size) {
+		printf("Heap:       %x of %x bytes used\n", ho->heap_used,
+		       ho->heap_size);
+	}
+	printf("Peak:       %x bytes\n", ho->peak);
+	printf("Calls:      %u allocs, %u frees, %u failed\n", ho->allocs,
+	       ho->frees, ho->fails);
+}
+
+static int do_malloc_info(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	malloc_profile_show();
+	show_spl_profile();
+
+	return 0;
+}
+
+static char malloc_help_text[] =
+	"info - show heap usage, free chunks and the main allocation call sites";
+
+U_BOOT_CMD_WITH_SUBCMDS(malloc, "malloc heap usage", malloc_help_text,
+	U_BOOT_SUBCMD_MKENT(info, 1, 1, do_malloc_info));
@@ -15,12 +15,17 @@
 #include <bootretry.h>
 #include <cli.h>
 #include <command.h>
+#include <dma.h>
 #include <console.h>
 #include <hash.h>
 #include <mapmem.h>
 #include <watchdog.h>
 #include <asm/io.h>
 #include <linux/compiler.h>
+#include <linux/sizes.h>
+#ifdef CONFIG_ASPEED_SMP_JOBS
+#include <asm/arch/smp.h>
+#endif
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -343,7 +348,8 @@ static int do_mem_cp(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	}
 #endif
 
-	memcpy((void *)dest, (void *)addr, count * size);
+	if (dma_memcpy_large((void *)dest, (void *)addr, count * size))
+		memcpy((void *)dest, (void *)addr, count * size);
 
 	return 0;
 }
@@ -849,6 +855,170 @@ static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
 	return errs;
 }
 
+#ifdef CONFIG_CMD_MEMTEST_FAST
+#define MTEST_FAST_PATTERNS	4
+#define MTEST_FAST_REPORT	8	/* errors kept per part */
+#define MTEST_FAST_ALIGN	32	/* bytes written by one loop iteration */
+
+/* One part of the range, tested by one core */
+struct mtest_fast {
+	u64 *buf;
+	ulong start;		/* address of @buf */
+	ulong words;
+	int check;		/* pattern to check, -1 for none */
+	int write;		/* pattern to write, -1 for none */
+	bool primary;		/* running on the boot core */
+	ulong errs;
+	ulong err_addr[MTEST_FAST_REPORT];
+	u64 err_found[MTEST_FAST_REPORT];
+	u64 err_expected[MTEST_FAST_REPORT];
+};
+
+/*
+ * The patterns: the address and its inverse in each word, then walking
+ * ones, each followed by its inverse.
+ */
+static inline u64 mtest_fast_pattern(int pattern, ulong addr)
+{
+	u64 val;
+
+	if (pattern < 2)
+		val = (u64)~(u32)addr << 32 | (u32)addr;
+	else
+		val = 1ULL << ((addr / sizeof(u64)) & 63);
+
+	return pattern & 1 ? ~val : val;
+}
+
+static inline void mtest_fast_word(struct mtest_fast *t, u64 *p, ulong addr)
+{
+	u64 expected, found;
+	int i;
+
+	if (t->check >= 0) {
+		found = *p;
+		expected = mtest_fast_pattern(t->check, addr);
+		if (found != expected) {
+			i = t->errs++;
+			if (i < MTEST_FAST_REPORT) {
+				t->err_addr[i] = addr;
+				t->err_found[i] = found;
+				t->err_expected[i] = expected;
+			}
+		}
+	}
+	if (t->write >= 0)
+		*p = mtest_fast_pattern(t->write, addr);
+}
+
+/*
+ * One sweep over the part, checking the previous pattern and writing the
+ * next one in the same pass. The loop works on a 32-byte block at a time,
+ * with 64-bit accesses. It also runs as a job on the secondary core.
+ */
+static int mtest_fast_sweep(void *arg)
+{
+	struct mtest_fast *t = arg;
+	ulong addr = t->start;
+	u64 *p = t->buf;
+	ulong i;
+
+	for (i = 0; i < t->words; i += 4) {
+		if (t->primary && !(i & 0xffff))
+			WATCHDOG_RESET();
+		mtest_fast_word(t, p, addr);
+		mtest_fast_word(t, p + 1, addr + 8);
+		mtest_fast_word(t, p + 2, addr + 16);
+		mtest_fast_word(t, p + 3, addr + 24);
+		p += 4;
+		addr += MTEST_FAST_ALIGN;
+	}
+
+	return 0;
+}
+
+static void mtest_fast_report(struct mtest_fast *t)
+{
+	int i;
+
+	for (i = 0; i < min_t(ulong, t->errs, MTEST_FAST_REPORT); i++)
+		printf("\nMem error @ 0x%08lX: found %016llX, expected %016llX",
+		       t->err_addr[i], t->err_found[i], t->err_expected[i]);
+	if (t->errs > MTEST_FAST_REPORT)
+		printf("\n... and %lu more", t->errs - MTEST_FAST_REPORT);
+	if (t->errs)
+		putc('\n');
+	t->errs = 0;
+}
+
+/*
+ * Test the range with all the patterns, in one sweep more than there are
+ * patterns. With CONFIG_ASPEED_SMP_JOBS the upper half of the range is
+ * tested by the secondary core at the same time.
+ *
+ * @return number of errors
+ */
+static ulong mem_test_fast(void *buf, ulong start, ulong end)
+{
+	struct mtest_fast part[2];
+	ulong errs = 0, mib, ms;
+	int parts = 1;
+	int pass, i;
+#ifdef CONFIG_ASPEED_SMP_JOBS
+	int job;
+#endif
+
+	memset(part, '\0', sizeof(part));
+	part[0].buf = buf;
+	part[0].start = start;
+	part[0].words = (end - start) / sizeof(u64);
+	part[0].primary = true;
+#ifdef CONFIG_ASPEED_SMP_JOBS
+	part[1] = part[0];
+	part[0].words = round_down(part[0].words / 2,
+				   MTEST_FAST_ALIGN / sizeof(u64));
+	part[1].buf += part[0].words;
+	part[1].start += part[0].words * sizeof(u64);
+	part[1].words -= part[0].words;
+	part[1].primary = false;
+	parts = 2;
+#endif
+
+	ms = get_timer(0);
+	for (pass = 0; pass <= MTEST_FAST_PATTERNS; pass++) {
+		printf("\rPass %d/%d", pass + 1, MTEST_FAST_PATTERNS + 1);
+		for (i = 0; i < parts; i++) {
+			part[i].check = pass - 1;
+			part[i].write = pass < MTEST_FAST_PATTERNS ? pass : -1;
+		}
+#ifdef CONFIG_ASPEED_SMP_JOBS
+		job = aspeed_smp_job_submit(mtest_fast_sweep, &part[1]);
+		if (job < 0)
+			mtest_fast_sweep(&part[1]);
+#endif
+		mtest_fast_sweep(&part[0]);
+#ifdef CONFIG_ASPEED_SMP_JOBS
+		if (job >= 0)
+			aspeed_smp_job_wait(job);
+#endif
+		for (i = 0; i < parts; i++) {
+			errs += part[i].errs;
+			mtest_fast_report(&part[i]);
+		}
+		if (ctrlc())
+			return -1;
+	}
+	ms = max(get_timer(ms), 1UL);
+
+	/* Each word was written and read once per pattern */
+	mib = (end - start) / SZ_1M * MTEST_FAST_PATTERNS * 2;
+	printf("\r%lu MiB in %lu ms, %lu MiB/s%s\n", mib, ms,
+	       mib * 1000 / ms, parts > 1 ? " on 2 cores" : "");
+
+	return errs;
+}
+#endif /* CONFIG_CMD_MEMTEST_FAST */
+
 /*
  * Perform a memory test. A more complete alternative test can be
  * configured using CONFIG_SYS_ALT_MEMTEST. The complete test loops until
@@ -869,10 +1039,18 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 #else
 	const int alt_test = 0;
 #endif
+	bool fast = false;
 
 	start = CONFIG_SYS_MEMTEST_START;
 	end = CONFIG_SYS_MEMTEST_END;
 
+	if (IS_ENABLED(CONFIG_CMD_MEMTEST_FAST) && argc > 1 &&
+	    !strcmp(argv[1], "-f")) {
+		fast = true;
+		argc--;
+		argv++;
+	}
+
 	if (argc > 1)
 		if (strict_strtoul(argv[1], 16, &start) < 0)
 			return CMD_RET_USAGE;
@@ -893,6 +1071,19 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 		printf("Refusing to do empty test\n");
 		return -1;
 	}
+#ifdef CONFIG_CMD_MEMTEST_FAST
+	if (fast) {
+		/* There is no pattern argument, that one is the limit */
+		if (argc == 4)
+			iteration_limit = pattern;
+		start = ALIGN(start, MTEST_FAST_ALIGN);
+		end = round_down(end, MTEST_FAST_ALIGN);
+		if (end <= start) {
+			printf("Refusing to do empty test\n");
+			return -1;
+		}
+	}
+#endif
 
 	printf("Testing %08lx ... %08lx:\n", start, end);
 	debug("%s:%d: start %#08lx end %#08lx\n", __func__, __LINE__,
@@ -910,7 +1101,11 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 
 		printf("Iteration: %6d\r", iteration + 1);
 		debug("\n");
-		if (alt_test) {
+		if (fast) {
+#ifdef CONFIG_CMD_MEMTEST_FAST
+			errs = mem_test_fast((void *)buf, start, end);
+#endif
+		} else if (alt_test) {
 			errs = mem_test_alt(buf, start, end, dummy);
 		} else {
 			errs = mem_test_quick(buf, start, end, pattern,
@@ -1218,6 +1413,10 @@ U_BOOT_CMD(
 	mtest,	5,	1,	do_mem_mtest,
 	"simple RAM read/write test",
 	"[start [end [pattern [iterations]]]]"
+#ifdef CONFIG_CMD_MEMTEST_FAST
+	"\nmtest -f [start [end [iterations]]]\n"
+	"    - faster test with 64-bit accesses and several patterns per pass"
+#endif
 );
 #endif	/* CONFIG_CMD_MEMTEST */
 
@@ -332,6 +332,35 @@ static lbaint_t mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t mmc_sparse_erase(struct sparse_storage *info, lbaint_t blk,
+				 lbaint_t blkcnt, u32 fill_val)
+{
+	struct blk_desc *dev_desc = info->priv;
+	struct mmc *mmc = find_mmc_device(dev_desc->devnum);
+	u32 erased_val;
+
+	if (!mmc || !mmc_can_trim(mmc, &erased_val) || erased_val != fill_val)
+		return 0;
+
+	/* Leave any failure to write_sparse_image(), which writes instead */
+	if (mmc_berase_arg(dev_desc, blk, blkcnt, MMC_TRIM_ARG) != blkcnt)
+		return 0;
+
+	return blkcnt;
+}
+
+static lbaint_t mmc_sparse_discard(struct sparse_storage *info,
+				   lbaint_t blk, lbaint_t blkcnt)
+{
+	struct blk_desc *dev_desc = info->priv;
+	struct mmc *mmc = find_mmc_device(dev_desc->devnum);
+
+	if (mmc && mmc_can_discard(mmc))
+		mmc_berase_arg(dev_desc, blk, blkcnt, MMC_DISCARD_ARG);
+
+	return blkcnt;
+}
+
 static int do_mmc_sparse_write(cmd_tbl_t *cmdtp, int flag,
 			       int argc, char * const argv[])
 {
@@ -372,6 +401,8 @@ static int do_mmc_sparse_write(cmd_tbl_t *cmdtp, int flag,
 	sparse.size = dev_desc->lba - blk;
 	sparse.write = mmc_sparse_write;
 	sparse.reserve = mmc_sparse_reserve;
+	sparse.erase = mmc_sparse_erase;
+	sparse.discard = mmc_sparse_discard;
 	sparse.mssg = NULL;
 	sprintf(dest, "0x" LBAF, sparse.start * sparse.blksz);
 
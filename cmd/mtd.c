@@ -170,6 +170,12 @@ static void mtd_show_device(struct mtd_info *mtd)
 		       mtd->bitflip_threshold);
 	}
 
+#ifdef CONFIG_MTD_PAGE_CACHE
+	printf("  - page cache: %lu hits, %lu misses, %lu invalidated, %lu CRC errors\n",
+	       mtd->cache_stats.hits, mtd->cache_stats.misses,
+	       mtd->cache_stats.invalidated, mtd->cache_stats.crc_errors);
+#endif
+
 	printf("  - 0x%012llx-0x%012llx : \"%s\"\n",
 	       mtd->offset, mtd->offset + mtd->size, mtd->name);
 
@@ -10,6 +10,9 @@
 #include <common.h>
 #include <command.h>
 #include <net.h>
+#include <part.h>
+#include <spi_flash.h>
+#include <net/wget.h>
 
 static int netboot_common(enum proto_t, cmd_tbl_t *, int, char * const []);
 
@@ -113,6 +116,90 @@ U_BOOT_CMD(
 );
 #endif
 
+#if defined(CONFIG_CMD_WGET)
+/* Download straight to storage, nothing is left in memory to boot */
+static int wget_to_storage(int argc, char * const argv[])
+{
+	int ret;
+
+	switch (argv[1][1]) {
+#ifdef CONFIG_HAVE_BLOCK_DEVICE
+	case 'b': {
+		struct blk_desc *desc;
+		disk_partition_t info;
+
+		if (argc != 5)
+			return CMD_RET_USAGE;
+		if (blk_get_device_part_str(argv[2], argv[3], &desc, &info,
+					    1) < 0)
+			return CMD_RET_FAILURE;
+		ret = wget_set_blk_sink(desc, info.start, info.size);
+		break;
+	}
+#endif
+#ifdef CONFIG_SPI_FLASH
+	case 's': {
+		struct spi_flash *flash;
+		ulong offset;
+
+		if (argc != 4 || strict_strtoul(argv[2], 16, &offset) < 0)
+			return CMD_RET_USAGE;
+		flash = spi_flash_probe(CONFIG_SF_DEFAULT_BUS,
+					CONFIG_SF_DEFAULT_CS,
+					CONFIG_SF_DEFAULT_SPEED,
+					CONFIG_SF_DEFAULT_MODE);
+		if (!flash) {
+			puts("Failed to initialize SPI flash\n");
+			return CMD_RET_FAILURE;
+		}
+		ret = wget_set_sf_sink(flash, offset, flash->size - offset);
+		break;
+	}
+#endif
+	default:
+		return CMD_RET_USAGE;
+	}
+	if (ret) {
+		printf("Cannot write there (%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	net_boot_file_name_explicit = true;
+	copy_filename(net_boot_file_name, argv[argc - 1],
+		      sizeof(net_boot_file_name));
+	if (net_loop(WGET) < 0) {
+		/* The sink is still set if wget never started */
+		wget_set_sink(NULL);
+		return CMD_RET_FAILURE;
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
+static int do_wget(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	if (argc > 1 && argv[1][0] == '-')
+		return wget_to_storage(argc, argv);
+
+	return netboot_common(WGET, cmdtp, argc, argv);
+}
+
+U_BOOT_CMD(
+	wget,	5,	1,	do_wget,
+	"boot image via network using HTTP/TCP protocol",
+	"[loadAddress] [[hostIPaddr:]path]\n"
+#ifdef CONFIG_HAVE_BLOCK_DEVICE
+	"wget -b <interface> <dev[:part]> [hostIPaddr:]path\n"
+	"    - stream the file to a block device or partition\n"
+#endif
+#ifdef CONFIG_SPI_FLASH
+	"wget -s <offset> [hostIPaddr:]path\n"
+	"    - stream the file to SPI flash at offset, erasing as it goes\n"
+#endif
+	"The server port is 80, or the value of 'httpdstp'."
+);
+#endif
+
 static void netboot_update_env(void)
 {
 	char tmp[22];
@@ -173,6 +173,15 @@ struct otp_image_layout {
 
 static struct otp_info_cb info_cb;
 
+/*
+ * RAM copy of the config and data regions. A region is read in one pass
+ * the first time it is used and dropped whenever a bit is programmed.
+ */
+static u32 otp_conf_shadow[32];
+static u32 otp_data_shadow[2048];
+static u32 otp_shadow_valid;
+static int otp_soak_mode;
+
 static const struct otpkey_type a0_key_type[] = {
 	{0, OTP_KEY_TYPE_AES,   0, "AES-256 as OEM platform key for image encryption/decryption"},
 	{1, OTP_KEY_TYPE_VAULT, 0, "AES-256 as secret vault key"},
@@ -328,6 +337,7 @@ static void otp_write(u32 otp_addr, u32 data)
 
 static void otp_soak(int soak)
 {
+	otp_soak_mode = soak;
 	if (info_cb.version == OTP_A2 || info_cb.version == OTP_A3) {
 		switch (soak) {
 		case 0: //default
@@ -373,7 +383,7 @@ static void otp_soak(int soak)
 	wait_complete();
 }
 
-static void otp_read_data(u32 offset, u32 *data)
+static void otp_read_data_raw(u32 offset, u32 *data)
 {
 	writel(offset, OTP_ADDR); //Read address
 	writel(0x23b1e361, OTP_COMMAND); //trigger read
@@ -382,7 +392,7 @@ static void otp_read_data(u32 offset, u32 *data)
 	data[1] = readl(OTP_COMPARE_2);
 }
 
-static void otp_read_conf(u32 offset, u32 *data)
+static void otp_read_conf_raw(u32 offset, u32 *data)
 {
 	int config_offset;
 
@@ -396,6 +406,53 @@ static void otp_read_conf(u32 offset, u32 *data)
 	data[0] = readl(OTP_COMPARE_1);
 }
 
+/* Fill the shadow of the regions in @region which are not valid yet */
+static void otp_read_region(u32 region)
+{
+	int soak = otp_soak_mode;
+	int i;
+
+	region &= ~otp_shadow_valid;
+	if (!region)
+		return;
+
+	/* The shadow holds the values read in the default mode */
+	if (soak)
+		otp_soak(0);
+	if (region & OTP_REGION_CONF) {
+		for (i = 0; i < 32; i++)
+			otp_read_conf_raw(i, &otp_conf_shadow[i]);
+	}
+	if (region & OTP_REGION_DATA) {
+		for (i = 0; i < 2048; i += 2)
+			otp_read_data_raw(i, &otp_data_shadow[i]);
+	}
+	if (soak)
+		otp_soak(soak);
+	otp_shadow_valid |= region;
+}
+
+static void otp_read_data(u32 offset, u32 *data)
+{
+	if (offset % 2 || offset >= 2048) {
+		otp_read_data_raw(offset, data);
+		return;
+	}
+	otp_read_region(OTP_REGION_DATA);
+	data[0] = otp_data_shadow[offset];
+	data[1] = otp_data_shadow[offset + 1];
+}
+
+static void otp_read_conf(u32 offset, u32 *data)
+{
+	if (offset >= 32) {
+		otp_read_conf_raw(offset, data);
+		return;
+	}
+	otp_read_region(OTP_REGION_CONF);
+	data[0] = otp_conf_shadow[offset];
+}
+
 static int otp_compare(u32 otp_addr, u32 addr)
 {
 	u32 ret;
@@ -501,6 +558,7 @@ static u32 verify_dw(u32 otp_addr, u32 *value, u32 *ignore, u32 *compare, int si
 
 static void otp_prog(u32 otp_addr, u32 prog_bit)
 {
+	otp_shadow_valid = 0;
 	otp_write(0x0, prog_bit);
 	writel(otp_addr, OTP_ADDR); //write address
 	writel(prog_bit, OTP_COMPARE_1); //write data
@@ -1440,13 +1498,8 @@ static int otp_print_data_image(struct otp_image_layout *image_layout)
 
 static void otp_print_key_info(void)
 {
-	u32 data[2048];
-	int i;
-
-	for (i = 0; i < 2048 ; i += 2)
-		otp_read_data(i, &data[i]);
-
-	_otp_print_key(data);
+	otp_read_region(OTP_REGION_DATA);
+	_otp_print_key(otp_data_shadow);
 }
 
 static int otp_prog_data(struct otp_image_layout *image_layout, u32 *data)
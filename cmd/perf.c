@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Count CPU events over a sequence of commands
+ */
+
+#include <common.h>
+#include <command.h>
+#include <pmu.h>
+
+static struct pmu_counts perf_start;
+static bool perf_started;
+
+static int do_perf_start(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char * const argv[])
+{
+	pmu_read(&perf_start);
+	perf_started = true;
+
+	return 0;
+}
+
+static int do_perf_show(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	struct pmu_counts now;
+
+	if (!perf_started) {
+		printf("Use 'perf start' first\n");
+		return CMD_RET_FAILURE;
+	}
+	pmu_read(&now);
+	pmu_show(&perf_start, &now);
+
+	return 0;
+}
+
+static int do_perf_event(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char * const argv[])
+{
+	ulong counter;
+	int i;
+
+	if (argc == 1) {
+		for (i = PMUC_INSTRUCTIONS; i < PMUC_COUNT; i++)
+			printf("%d: %#x\n", i, pmu_get_event(i));
+		return 0;
+	}
+	if (argc != 3)
+		return CMD_RET_USAGE;
+
+	counter = simple_strtoul(argv[1], NULL, 10);
+	if (pmu_set_event(counter, simple_strtoul(argv[2], NULL, 16))) {
+		printf("Invalid counter %lu\n", counter);
+		return CMD_RET_FAILURE;
+	}
+	/* The counter was reset */
+	perf_started = false;
+
+	return 0;
+}
+
+static cmd_tbl_t perf_sub[] = {
+	U_BOOT_CMD_MKENT(start, 1, 1, do_perf_start, "", ""),
+	U_BOOT_CMD_MKENT(show, 1, 1, do_perf_show, "", ""),
+	U_BOOT_CMD_MKENT(event, 3, 1, do_perf_event, "", ""),
+};
+
+static int do_perf(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	cmd_tbl_t *cp;
+	int ret;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	ret = pmu_init();
+	if (ret) {
+		printf("No performance monitor (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	/* drop initial "perf" arg */
+	argc--;
+	argv++;
+
+	cp = find_cmd_tbl(argv[0], perf_sub, ARRAY_SIZE(perf_sub));
+	if (cp)
+		return cp->cmd(cmdtp, flag, argc, argv);
+
+	return CMD_RET_USAGE;
+}
+
+#ifdef CONFIG_SYS_LONGHELP
+static char perf_help_text[] =
+	"start - start counting CPU events\n"
+	"perf show - show the events counted since 'perf start'\n"
+	"perf event [<counter> <event>] - show the event numbers counted, or\n"
+	"\tset the (hex) event counted by counter 1-4"
+	;
+#endif
+
+U_BOOT_CMD(
+	perf, 4, 1, do_perf,
+	"count CPU events", perf_help_text
+);
@@ -264,6 +264,9 @@ static int get_pxe_file(cmd_tbl_t *cmdtp, const char *file_path,
 
 #define PXELINUX_DIR "pxelinux.cfg/"
 
+/* Name of the last config file found by get_pxelinux_path() */
+static char pxe_found_name[MAX_TFTP_PATH_LEN + 1];
+
 /*
  * Retrieves a file in the 'pxelinux.cfg' folder. Since this uses get_pxe_file
  * to do the hard work, the location of the 'pxelinux.cfg' folder is generated
@@ -276,6 +279,7 @@ static int get_pxelinux_path(cmd_tbl_t *cmdtp, const char *file,
 {
 	size_t base_len = strlen(PXELINUX_DIR);
 	char path[MAX_TFTP_PATH_LEN+1];
+	int err;
 
 	if (base_len + strlen(file) > MAX_TFTP_PATH_LEN) {
 		printf("path (%s%s) too long, skipping\n",
@@ -285,7 +289,11 @@ static int get_pxelinux_path(cmd_tbl_t *cmdtp, const char *file,
 
 	sprintf(path, PXELINUX_DIR "%s", file);
 
-	return get_pxe_file(cmdtp, path, pxefile_addr_r);
+	err = get_pxe_file(cmdtp, path, pxefile_addr_r);
+	if (err > 0)
+		strcpy(pxe_found_name, file);
+
+	return err;
 }
 
 /*
@@ -350,6 +358,52 @@ static int pxe_ipaddr_paths(cmd_tbl_t *cmdtp, unsigned long pxefile_addr_r)
 	return -ENOENT;
 }
 
+/*
+ * Looks for the pxe file found last time for this MAC address, which is
+ * remembered as "<MAC>:<name>" in the pxefile_cached environment variable.
+ *
+ * Returns 1 on success or < 0 on error.
+ */
+static int pxe_cached_path(cmd_tbl_t *cmdtp, unsigned long pxefile_addr_r)
+{
+	char mac_str[21];
+	char *cached;
+	size_t len;
+	int err;
+
+	if (!IS_ENABLED(CONFIG_CMD_PXE_CACHE))
+		return -ENOENT;
+
+	cached = env_get("pxefile_cached");
+	err = format_mac_pxe(mac_str, sizeof(mac_str));
+	if (!cached || err < 0)
+		return -ENOENT;
+
+	len = strlen(mac_str);
+	if (strncmp(cached, mac_str, len) || cached[len] != ':')
+		return -ENOENT;
+
+	return get_pxelinux_path(cmdtp, cached + len + 1, pxefile_addr_r);
+}
+
+/* Remembers the name of the pxe file found for this MAC address */
+static void pxe_cache_path(void)
+{
+	char cached[21 + 1 + MAX_TFTP_PATH_LEN + 1];
+	char *old;
+
+	if (!IS_ENABLED(CONFIG_CMD_PXE_CACHE))
+		return;
+	if (format_mac_pxe(cached, sizeof(cached)) < 0)
+		return;
+
+	strcat(cached, ":");
+	strcat(cached, pxe_found_name);
+	old = env_get("pxefile_cached");
+	if (!old || strcmp(old, cached))
+		env_set("pxefile_cached", cached);
+}
+
 /*
  * Entry point for the 'pxe get' command.
  * This Follows pxelinux's rules to download a config file from a tftp server.
@@ -390,10 +444,12 @@ do_pxe_get(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	 * Keep trying paths until we successfully get a file we're looking
 	 * for.
 	 */
-	if (pxe_uuid_path(cmdtp, pxefile_addr_r) > 0 ||
+	if (pxe_cached_path(cmdtp, pxefile_addr_r) > 0 ||
+	    pxe_uuid_path(cmdtp, pxefile_addr_r) > 0 ||
 	    pxe_mac_path(cmdtp, pxefile_addr_r) > 0 ||
 	    pxe_ipaddr_paths(cmdtp, pxefile_addr_r) > 0) {
 		printf("Config file found\n");
+		pxe_cache_path();
 
 		return 0;
 	}
@@ -402,6 +458,7 @@ do_pxe_get(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		if (get_pxelinux_path(cmdtp, pxe_default_paths[i],
 				      pxefile_addr_r) > 0) {
 			printf("Config file found\n");
+			pxe_cache_path();
 			return 0;
 		}
 		i++;
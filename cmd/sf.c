@@ -14,6 +14,7 @@
 #include <spi_flash.h>
 #include <jffs2/jffs2.h>
 #include <linux/mtd/mtd.h>
+#include <linux/sizes.h>
 
 #include <asm/io.h>
 #include <dm/device-internal.h>
@@ -152,10 +153,61 @@ static int do_spi_flash_probe(int argc, char * const argv[])
 	return 0;
 }
 
+/* Read granularity used to find a difference early in a sector */
+#define SF_UPDATE_READ_CHUNK	SZ_4K
+
+static bool spi_flash_is_blank(const char *buf, size_t len)
+{
+	const u32 *p = (const u32 *)buf;
+	size_t i;
+
+	for (i = 0; i < len / 4; i++)
+		if (p[i] != 0xffffffff)
+			return false;
+	for (i *= 4; i < len; i++)
+		if ((u8)buf[i] != 0xff)
+			return false;
+
+	return true;
+}
+
+/*
+ * Program a freshly erased (or blank) sector, skipping the pages which
+ * are to stay erased.
+ */
+static int spi_flash_write_sector(struct spi_flash *flash, u32 offset,
+				  const char *buf)
+{
+	u32 page = flash->page_size ? flash->page_size : 256;
+	u32 start, pos;
+
+	for (pos = 0; pos < flash->sector_size; ) {
+		/* Skip erased pages, then write the run of programmed ones */
+		while (pos < flash->sector_size &&
+		       spi_flash_is_blank(buf + pos, page))
+			pos += page;
+		start = pos;
+		while (pos < flash->sector_size &&
+		       !spi_flash_is_blank(buf + pos, page))
+			pos += page;
+		if (pos > start &&
+		    spi_flash_write(flash, offset + start, pos - start,
+				    buf + start))
+			return -EIO;
+	}
+
+	return 0;
+}
+
 /**
  * Write a block of data to SPI flash, first checking if it is different from
  * what is already there.
  *
+ * The sector is read back in chunks. Reading stops as soon as the data is
+ * known to match, or, for a full sector, as soon as it is known to differ
+ * from the new data and not to be blank. Blank sectors are not erased
+ * again, and pages that are to stay erased are not programmed.
+ *
  * If the data being written is the same, then *skipped is incremented by len.
  *
  * @param flash		flash context pointer
@@ -169,22 +221,41 @@ static int do_spi_flash_probe(int argc, char * const argv[])
 static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
 		size_t len, const char *buf, char *cmp_buf, size_t *skipped)
 {
-	char *ptr = (char *)buf;
+	const char *ptr = buf;
+	bool same = true, blank = true;
+	u32 pos, chunk;
 
 	debug("offset=%#x, sector_size=%#x, len=%#zx\n",
 	      offset, flash->sector_size, len);
-	/* Read the entire sector so to allow for rewriting */
-	if (spi_flash_read(flash, offset, flash->sector_size, cmp_buf))
-		return "read";
-	/* Compare only what is meaningful (len) */
-	if (memcmp(cmp_buf, buf, len) == 0) {
-		debug("Skip region %x size %zx: no change\n",
-		      offset, len);
-		*skipped += len;
-		return NULL;
+	/*
+	 * A partial sector is rewritten as a whole, so its old contents
+	 * must be read entirely unless nothing changes.
+	 */
+	for (pos = 0; pos < flash->sector_size; pos += chunk) {
+		chunk = min_t(u32, SF_UPDATE_READ_CHUNK,
+			      flash->sector_size - pos);
+		if (spi_flash_read(flash, offset + pos, chunk, cmp_buf + pos))
+			return "read";
+
+		/* Compare only what is meaningful (len) */
+		if (same && pos < len &&
+		    memcmp(cmp_buf + pos, buf + pos,
+			   min_t(size_t, chunk, len - pos)))
+			same = false;
+		if (same && pos + chunk >= len) {
+			debug("Skip region %x size %zx: no change\n",
+			      offset, len);
+			*skipped += len;
+			return NULL;
+		}
+
+		if (blank && !spi_flash_is_blank(cmp_buf + pos, chunk))
+			blank = false;
+		if (!same && !blank && len == flash->sector_size)
+			break;
 	}
-	/* Erase the entire sector */
-	if (spi_flash_erase(flash, offset, flash->sector_size))
+	/* Erase the entire sector, unless it is blank already */
+	if (!blank && spi_flash_erase(flash, offset, flash->sector_size))
 		return "erase";
 	/* If it's a partial sector, copy the data into the temp-buffer */
 	if (len != flash->sector_size) {
@@ -192,7 +263,7 @@ static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
 		ptr = cmp_buf;
 	}
 	/* Write one complete sector */
-	if (spi_flash_write(flash, offset, flash->sector_size, ptr))
+	if (spi_flash_write_sector(flash, offset, ptr))
 		return "write";
 
 	return NULL;
@@ -5,6 +5,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <pmu.h>
 
 static void report_time(ulong cycles)
 {
@@ -26,15 +27,22 @@ static void report_time(ulong cycles)
 
 static int do_time(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
+	struct pmu_counts start, end;
 	ulong cycles = 0;
 	int retval = 0;
 	int repeatable = 0;
+	bool use_pmu;
 
 	if (argc == 1)
 		return CMD_RET_USAGE;
 
+	use_pmu = !pmu_init();
+	pmu_read(&start);
 	retval = cmd_process(0, argc - 1, argv + 1, &repeatable, &cycles);
+	pmu_read(&end);
 	report_time(cycles);
+	if (use_pmu)
+		pmu_show(&start, &end);
 
 	return retval;
 }
@@ -77,12 +77,77 @@ static int create_call_list(int argc, char * const argv[])
 	return 0;
 }
 
+#ifdef CONFIG_TRACE_SAMPLE
+static int create_sample_list(int argc, char * const argv[])
+{
+	size_t buff_size, avail, buff_ptr, used;
+	unsigned int needed;
+	char *buff;
+	int err;
+
+	if (get_args(argc, argv, &buff, &buff_ptr, &buff_size))
+		return -1;
+
+	avail = buff_size - buff_ptr;
+	err = trace_list_samples(buff + buff_ptr, avail, &needed);
+	if (err)
+		printf("Error: truncated (%#x bytes needed)\n", needed);
+	used = min(avail, (size_t)needed);
+	printf("Samples dumped to %08lx, size %#zx\n",
+	       (ulong)map_to_sysmem(buff + buff_ptr), used);
+
+	env_set_hex("profbase", map_to_sysmem(buff));
+	env_set_hex("profsize", buff_size);
+	env_set_hex("profoffset", buff_ptr + used);
+
+	return 0;
+}
+
+static int do_trace_sample(cmd_tbl_t *cmdtp, int argc, char * const argv[])
+{
+	const char *cmd = argc < 2 ? NULL : argv[1];
+	uint period, count;
+	int ret;
+
+	if (!cmd)
+		return cmd_usage(cmdtp);
+	if (!strcmp(cmd, "start")) {
+		period = argc > 2 ? simple_strtoul(argv[2], NULL, 10) : 1000;
+		count = argc > 3 ? simple_strtoul(argv[3], NULL, 10) :
+			CONFIG_TRACE_SAMPLE_COUNT;
+		ret = trace_sample_start(period, count);
+		if (ret) {
+			printf("Cannot start sampling (err=%d)\n", ret);
+			return CMD_RET_FAILURE;
+		}
+	} else if (!strcmp(cmd, "stop")) {
+		trace_sample_stop();
+	} else if (!strcmp(cmd, "stats")) {
+		trace_sample_print_stats();
+	} else if (!strcmp(cmd, "dump")) {
+		if (create_sample_list(argc, argv))
+			return cmd_usage(cmdtp);
+	} else {
+		return CMD_RET_USAGE;
+	}
+
+	return 0;
+}
+#endif
+
 int do_trace(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	const char *cmd = argc < 2 ? NULL : argv[1];
 
 	if (!cmd)
 		return cmd_usage(cmdtp);
+#ifdef CONFIG_TRACE_SAMPLE
+	if (!strcmp(cmd, "sample"))
+		return do_trace_sample(cmdtp, argc - 1, argv + 1);
+#endif
+	/* Function tracing needs a build with FTRACE=1 */
+	if (!IS_ENABLED(CONFIG_TRACE))
+		return CMD_RET_USAGE;
 	switch (*cmd) {
 	case 'p':
 		trace_set_enabled(0);
@@ -109,7 +174,7 @@ int do_trace(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 }
 
 U_BOOT_CMD(
-	trace,	4,	1,	do_trace,
+	trace,	5,	1,	do_trace,
 	"trace utility commands",
 	"stats                        - display tracing statistics\n"
 	"trace pause                        - pause tracing\n"
@@ -117,4 +182,11 @@ U_BOOT_CMD(
 	"trace funclist [<addr> <size>]     - dump function list into buffer\n"
 	"trace calls  [<addr> <size>]       "
 		"- dump function call trace into buffer"
+#ifdef CONFIG_TRACE_SAMPLE
+	"\ntrace sample start [<us> [<count>]] - sample every <us> "
+		"microseconds (default 1000)\n"
+	"trace sample stop                  - stop sampling\n"
+	"trace sample stats                 - display sampling statistics\n"
+	"trace sample dump [<addr> <size>]  - dump samples into buffer"
+#endif
 );
@@ -79,7 +79,7 @@ U_BOOT_CMD(
 	"unzip and write memory to block device",
 	"<interface> <dev> <addr> length [wbuf=1M [offs=0 [outsize=0]]]\n"
 	"\twbuf is the size in bytes (hex) of write buffer\n"
-	"\t\tand should be padded to erase size for SSDs\n"
+	"\t\tand is rounded up to the erase group size of eMMC\n"
 	"\toffs is the output start offset in bytes (hex)\n"
 	"\toutsize is the size of the expected output (hex bytes)\n"
 	"\t\tand is required for files with uncompressed lengths\n"
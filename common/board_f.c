@@ -13,6 +13,7 @@
 #include <bloblist.h>
 #include <console.h>
 #include <cpu.h>
+#include <cyclic.h>
 #include <dm.h>
 #include <environment.h>
 #include <fdtdec.h>
@@ -261,9 +262,23 @@ __weak int init_func_vid(void)
 }
 #endif
 
+#ifdef CONFIG_XIP_RAM_DATA
+/* U-Boot runs from flash: copy .data to RAM, where it is linked */
+static int setup_xip_data(void)
+{
+	memcpy(__xip_data_start, __xip_data_load,
+	       __xip_data_end - __xip_data_start);
+
+	return 0;
+}
+#endif
+
 static int setup_mon_len(void)
 {
-#if defined(__ARM__) || defined(__MICROBLAZE__)
+#if defined(CONFIG_XIP_RAM_DATA)
+	/* .bss is not next to the code, count what is in the flash */
+	gd->mon_len = (ulong)_end - (ulong)_start;
+#elif defined(__ARM__) || defined(__MICROBLAZE__)
 	gd->mon_len = (ulong)&__bss_end - (ulong)_start;
 #elif defined(CONFIG_SANDBOX) || defined(CONFIG_EFI_APP)
 	gd->mon_len = (ulong)&_end - (ulong)_init;
@@ -449,8 +464,38 @@ static int reserve_trace(void)
 	return 0;
 }
 
+#ifdef CONFIG_RELOC_IN_PLACE
+/* Is U-Boot already running just below the areas reserved at the top? */
+static bool reloc_in_place(void)
+{
+	ulong end = (ulong)__image_copy_start + gd->mon_len;
+
+	return end <= gd->relocaddr &&
+	       gd->relocaddr - end <= CONFIG_RELOC_IN_PLACE_SLACK;
+}
+#endif
+
 static int reserve_uboot(void)
 {
+#ifdef CONFIG_XIP_RAM_DATA
+	/*
+	 * The code stays in flash and the data is linked in RAM, so there is
+	 * nothing to reserve here. relocate_code() has nothing to do for a
+	 * zero offset.
+	 */
+	gd->start_addr_sp = gd->relocaddr;
+	gd->relocaddr = (ulong)__image_copy_start;
+	debug("Running U-Boot in place from flash at: %08lx\n", gd->relocaddr);
+
+	return 0;
+#endif
+#ifdef CONFIG_RELOC_IN_PLACE
+	if (reloc_in_place()) {
+		/* relocate_code() has nothing to do for a zero offset */
+		gd->relocaddr = (ulong)__image_copy_start;
+		debug("Running U-Boot in place at: %08lx\n", gd->relocaddr);
+	} else
+#endif
 	if (!(gd->flags & GD_FLG_SKIP_RELOC)) {
 		/*
 		 * reserve memory for U-Boot code, data & bss
@@ -691,6 +736,11 @@ static int reloc_bloblist(void)
 		debug("Copying bloblist from %p to %p, size %x\n",
 		      gd->bloblist, gd->new_bloblist, size);
 		memcpy(gd->new_bloblist, gd->bloblist, size);
+#if CONFIG_IS_ENABLED(HANDOFF)
+		if (gd->spl_handoff)
+			gd->spl_handoff = (void *)gd->spl_handoff -
+				(void *)gd->bloblist + (void *)gd->new_bloblist;
+#endif
 		gd->bloblist = gd->new_bloblist;
 	}
 #endif
@@ -835,6 +885,9 @@ __weak int arch_cpu_init_dm(void)
 }
 
 static const init_fnc_t init_sequence_f[] = {
+#ifdef CONFIG_XIP_RAM_DATA
+	setup_xip_data,
+#endif
 	setup_mon_len,
 #ifdef CONFIG_OF_CONTROL
 	fdtdec_setup,
@@ -964,6 +1017,9 @@ static const init_fnc_t init_sequence_f[] = {
 	fix_fdt,
 #endif
 	INIT_FUNC_WATCHDOG_RESET
+#if CONFIG_IS_ENABLED(CYCLIC)
+	cyclic_wait_all,	/* tasks cannot survive relocation */
+#endif
 	reloc_fdt,
 	reloc_bootstage,
 	reloc_bloblist,
@@ -110,6 +110,10 @@ static int initr_caches(void)
 {
 	/* Enable caches */
 	enable_caches();
+#if CONFIG_IS_ENABLED(ARM_NEON_MEM)
+	/* Relocated now, so memcpy()/memset() may pick up NEON */
+	arm_neon_mem_init();
+#endif
 	return 0;
 }
 #endif
@@ -276,6 +280,14 @@ static int initr_of_live(void)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(OF_INDEX)
+static int initr_of_index(void)
+{
+	/* The control FDT does not move after relocation, index it once */
+	return fdtdec_index_build(gd->fdt_blob);
+}
+#endif
+
 #ifdef CONFIG_DM
 static int initr_dm(void)
 {
@@ -553,6 +565,14 @@ static int initr_bbmii(void)
 }
 #endif
 
+#ifdef CONFIG_ETH_EARLY_PROBE
+static int initr_eth_early(void)
+{
+	eth_probe_early();
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_CMD_NET
 static int initr_net(void)
 {
@@ -670,6 +690,9 @@ static init_fnc_t init_sequence_r[] = {
 #ifdef CONFIG_OF_LIVE
 	initr_of_live,
 #endif
+#if CONFIG_IS_ENABLED(OF_INDEX)
+	initr_of_index,
+#endif
 #ifdef CONFIG_DM
 	initr_dm,
 #endif
@@ -721,6 +744,9 @@ static init_fnc_t init_sequence_r[] = {
 	arch_early_init_r,
 #endif
 	power_init_board,
+#ifdef CONFIG_ETH_EARLY_PROBE
+	initr_eth_early,
+#endif
 #ifdef CONFIG_MTD_NOR_FLASH
 	initr_flash,
 #endif
@@ -15,9 +15,11 @@
 #include <mapmem.h>
 #include <asm/io.h>
 #include <linux/lzo.h>
+#include <linux/sizes.h>
 #include <lzma/LzmaTypes.h>
 #include <lzma/LzmaDec.h>
 #include <lzma/LzmaTools.h>
+#include <u-boot/zstd.h>
 #if defined(CONFIG_CMD_USB)
 #include <usb.h>
 #endif
@@ -425,6 +427,15 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		break;
 	}
 #endif /* CONFIG_LZ4 */
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD: {
+		size_t size = unc_len;
+
+		ret = zstd_decompress(image_buf, image_len, load_buf, &size);
+		image_len = size;
+		break;
+	}
+#endif /* CONFIG_ZSTD */
 	default:
 		printf("Unimplemented compression type %d\n", comp);
 		return BOOTM_ERR_UNIMPLEMENTED;
@@ -440,6 +451,63 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 }
 
 #ifndef USE_HOSTCC
+/**
+ * bootm_decomp_in_place() - check whether the OS can be decompressed over
+ *	its own compressed data
+ *
+ * LZ4 and zstd decompress front to back and never read input which they have
+ * written over, as long as the compressed data ends a small margin after the
+ * end of the decompressed data. An image loaded to the top of its final
+ * region can so be decompressed into itself, without a separate staging area,
+ * provided the output is kept below that margin.
+ *
+ * @images: Images information, with the ramdisk and device tree found
+ * @load: Load address of the OS
+ * @return the largest decompressed size which is safe, or 0 if the image
+ *	cannot be decompressed in place
+ */
+static ulong bootm_decomp_in_place(bootm_headers_t *images, ulong load)
+{
+	image_info_t *os = &images->os;
+	ulong image_end = os->image_start + os->image_len;
+	ulong ft_start = map_to_sysmem(images->ft_addr);
+	ulong margin;
+
+	/* Without an overlap the usual decompression is fine */
+	if (load > os->image_start ||
+	    load + CONFIG_SYS_BOOTM_LEN <= os->image_start)
+		return 0;
+
+	switch (os->comp) {
+	case IH_COMP_LZ4:
+		/* LZ4_DECOMPRESS_INPLACE_MARGIN, plus the frame and block headers */
+		margin = (os->image_len >> 8) + (os->image_len >> 14) + 64;
+		break;
+	case IH_COMP_ZSTD:
+		/*
+		 * ZSTD_DECOMPRESSION_MARGIN: the frame header and checksum, three
+		 * bytes per block and one whole block
+		 */
+		margin = 18 + 4 + 3 * DIV_ROUND_UP(image_end - load, SZ_128K) +
+			 SZ_128K;
+		break;
+	default:
+		return 0;
+	}
+	if (image_end - load <= margin)
+		return 0;
+
+	/* The ramdisk and device tree may still be in the blob with the OS */
+	if (images->rd_start && images->rd_start < image_end &&
+	    images->rd_end > load)
+		return 0;
+	if (images->ft_addr && ft_start < image_end &&
+	    ft_start + images->ft_len > load)
+		return 0;
+
+	return min_t(ulong, image_end - load - margin, CONFIG_SYS_BOOTM_LEN);
+}
+
 static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 {
 	image_info_t os = images->os;
@@ -451,15 +519,24 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 	ulong image_len = os.image_len;
 	ulong flush_start = ALIGN_DOWN(load, ARCH_DMA_MINALIGN);
 	ulong flush_len;
+	ulong unc_len;
+	bool in_place;
 	bool no_overlap;
 	void *load_buf, *image_buf;
 	int err;
 
+	unc_len = bootm_decomp_in_place(images, load);
+	in_place = unc_len != 0;
+	if (in_place)
+		debug("   decompressing in place, up to 0x%lx bytes\n", unc_len);
+	else
+		unc_len = CONFIG_SYS_BOOTM_LEN;
+
 	load_buf = map_sysmem(load, 0);
 	image_buf = map_sysmem(os.image_start, image_len);
 	err = bootm_decomp_image(os.comp, load, os.image_start, os.type,
 				 load_buf, image_buf, image_len,
-				 CONFIG_SYS_BOOTM_LEN, &load_end);
+				 unc_len, &load_end);
 	if (err) {
 		bootstage_error(BOOTSTAGE_ID_DECOMP_IMAGE);
 		return err;
@@ -474,7 +551,8 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 	debug("   kernel loaded at 0x%08lx, end = 0x%08lx\n", load, load_end);
 	bootstage_mark(BOOTSTAGE_ID_KERNEL_LOADED);
 
-	no_overlap = (os.comp == IH_COMP_NONE && load == image_start);
+	no_overlap = (os.comp == IH_COMP_NONE && load == image_start) ||
+		     in_place;
 
 	if (!no_overlap && load < blob_end && load_end > blob_start) {
 		debug("images.os.start = 0x%lX, images.os.end = 0x%lx\n",
@@ -518,6 +596,7 @@ ulong bootm_disable_interrupts(void)
 	iflag = disable_interrupts();
 #ifdef CONFIG_NETCONSOLE
 	/* Stop the ethernet stack if NetConsole could have left it up */
+	nc_flush();
 	eth_halt();
 # ifndef CONFIG_DM_ETH
 	eth_unregister(eth_get_dev());
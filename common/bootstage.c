@@ -10,6 +10,7 @@
  */
 
 #include <common.h>
+#include <div64.h>
 #include <linux/libfdt.h>
 #include <malloc.h>
 #include <linux/compiler.h>
@@ -20,22 +21,35 @@ enum {
 	RECORD_COUNT = CONFIG_VAL(BOOTSTAGE_RECORD_COUNT),
 };
 
+/*
+ * A record is one of:
+ * - a mark: @time_us is the time of the event
+ * - an accumulator: @start_us is the start of the last period and @time_us
+ *   the total time of all periods
+ * - a span (BOOTSTAGEF_SPAN): @start_us is the start, @time_us the
+ *   duration, @parent the span it is nested in and @start_ns / @time_ns
+ *   add nanoseconds to the start and duration
+ */
 struct bootstage_record {
 	ulong time_us;
 	uint32_t start_us;
 	const char *name;
 	int flags;		/* see enum bootstage_flags */
 	enum bootstage_id id;
+	uint32_t parent;	/* id of the enclosing span, 0 if none */
+	uint16_t start_ns;
+	uint16_t time_ns;
 };
 
 struct bootstage_data {
 	uint rec_count;
 	uint next_id;
+	uint cur_span;		/* id of the innermost open span, 0 if none */
 	struct bootstage_record record[RECORD_COUNT];
 };
 
 enum {
-	BOOTSTAGE_VERSION	= 0,
+	BOOTSTAGE_VERSION	= 1,
 	BOOTSTAGE_MAGIC		= 0xb00757a3,
 	BOOTSTAGE_DIGITS	= 9,
 };
@@ -195,6 +209,74 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+uint32_t bootstage_add_accum(const char *name, uint32_t start_us,
+			     uint32_t duration_us)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+
+	if (data->rec_count >= RECORD_COUNT)
+		return 0;
+
+	rec = ensure_id(data, data->next_id++);
+	rec->start_us = start_us;
+	rec->time_us = duration_us;
+	rec->name = name;
+	rec->flags = 0;
+
+	return duration_us;
+}
+
+/* Split a time in nanoseconds into microseconds and the nanoseconds left */
+static uint32_t bootstage_split_ns(u64 ns, uint16_t *frac_ns)
+{
+	*frac_ns = do_div(ns, 1000);
+
+	return ns;
+}
+
+uint bootstage_begin(const char *name)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+	u64 now_ns = timer_get_boot_ns();
+
+	if (data->rec_count >= RECORD_COUNT)
+		return 0;
+
+	rec = ensure_id(data, data->next_id++);
+	rec->start_us = bootstage_split_ns(now_ns, &rec->start_ns);
+	rec->time_us = 0;
+	rec->time_ns = 0;
+	rec->name = name;
+	rec->flags = BOOTSTAGEF_SPAN;
+	rec->parent = data->cur_span;
+	data->cur_span = rec->id;
+
+	return rec->id;
+}
+
+uint32_t bootstage_end(uint id)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+	u64 now_ns = timer_get_boot_ns();
+	u64 start_ns;
+
+	rec = id ? find_id(data, id) : NULL;
+	if (!rec || !(rec->flags & BOOTSTAGEF_SPAN))
+		return 0;
+
+	start_ns = (u64)rec->start_us * 1000 + rec->start_ns;
+	if (now_ns > start_ns)
+		rec->time_us = bootstage_split_ns(now_ns - start_ns,
+						  &rec->time_ns);
+	/* This also closes any span left open inside this one */
+	data->cur_span = rec->parent;
+
+	return rec->time_us;
+}
+
 /**
  * Get a record name as a printable string
  *
@@ -239,6 +321,31 @@ static int h_compare_record(const void *r1, const void *r2)
 	return rec1->time_us > rec2->time_us ? 1 : -1;
 }
 
+static int h_compare_start(const void *r1, const void *r2)
+{
+	const struct bootstage_record *rec1 = r1, *rec2 = r2;
+
+	if (rec1->start_us != rec2->start_us)
+		return rec1->start_us > rec2->start_us ? 1 : -1;
+
+	return rec1->start_ns > rec2->start_ns ? 1 : -1;
+}
+
+/* Get the nesting depth of a span */
+static int span_depth(struct bootstage_data *data,
+		      const struct bootstage_record *rec)
+{
+	int depth;
+
+	for (depth = 0; rec->parent && depth < 10; depth++) {
+		rec = find_id(data, rec->parent);
+		if (!rec)
+			break;
+	}
+
+	return depth;
+}
+
 #ifdef CONFIG_OF_LIBFDT
 /**
  * Add all bootstage timings to a device tree.
@@ -287,9 +394,26 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 
 		/* Check if this is a 'mark' or 'accum' record */
 		if (fdt_setprop_cell(blob, node,
-				rec->start_us ? "accum" : "mark",
+				rec->start_us || (rec->flags & BOOTSTAGEF_SPAN) ?
+				"accum" : "mark",
 				rec->time_us))
 			return -EINVAL;
+
+		/* A span also has its start and the node of its parent */
+		if (rec->flags & BOOTSTAGEF_SPAN) {
+			struct bootstage_record *parent;
+
+			if (fdt_setprop_cell(blob, node, "start",
+					     rec->start_us))
+				return -EINVAL;
+			parent = rec->parent ? find_id(data, rec->parent) :
+				 NULL;
+			if (parent &&
+			    fdt_setprop_cell(blob, node, "parent",
+					     data->rec_count - 1 -
+					     (parent - data->record)))
+				return -EINVAL;
+		}
 	}
 
 	return 0;
@@ -308,6 +432,7 @@ void bootstage_report(void)
 {
 	struct bootstage_data *data = gd->bootstage;
 	struct bootstage_record *rec = data->record;
+	bool spans = false;
 	uint32_t prev;
 	int i;
 
@@ -321,7 +446,8 @@ void bootstage_report(void)
 	qsort(data->record, data->rec_count, sizeof(*rec), h_compare_record);
 
 	for (i = 1, rec++; i < data->rec_count; i++, rec++) {
-		if (rec->id && !rec->start_us)
+		if (rec->id && !rec->start_us &&
+		    !(rec->flags & BOOTSTAGEF_SPAN))
 			prev = print_time_record(rec, prev);
 	}
 	if (data->rec_count > RECORD_COUNT)
@@ -331,9 +457,88 @@ void bootstage_report(void)
 
 	puts("\nAccumulated time:\n");
 	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
-		if (rec->start_us)
+		if (rec->start_us && !(rec->flags & BOOTSTAGEF_SPAN))
 			prev = print_time_record(rec, -1);
 	}
+
+	qsort(data->record, data->rec_count, sizeof(*rec), h_compare_start);
+	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
+		char buf[20];
+
+		if (!(rec->flags & BOOTSTAGEF_SPAN))
+			continue;
+		if (!spans) {
+			printf("\nSpans:\n%11s%11s  %s\n", "Start",
+			       "Duration", "Stage");
+			spans = true;
+		}
+		print_grouped_ull(rec->start_us, BOOTSTAGE_DIGITS);
+		print_grouped_ull(rec->time_us, BOOTSTAGE_DIGITS);
+		printf("  %*s%s\n", span_depth(data, rec) * 2, "",
+		       get_record_name(buf, sizeof(buf), rec));
+	}
+}
+
+/* Append formatted text to an export buffer, counting what does not fit */
+static void export_printf(char **ptrp, char *end, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(*ptrp, *ptrp < end ? end - *ptrp : 0, fmt, args);
+	va_end(args);
+	*ptrp += len;
+}
+
+/* Append a JSON string to an export buffer */
+static void export_string(char **ptrp, char *end, const char *str)
+{
+	export_printf(ptrp, end, "\"");
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			export_printf(ptrp, end, "\\%c", *str);
+		else if ((unsigned char)*str < ' ')
+			export_printf(ptrp, end, "\\u%04x", *str);
+		else
+			export_printf(ptrp, end, "%c", *str);
+	}
+	export_printf(ptrp, end, "\"");
+}
+
+int bootstage_export(char *buf, int size)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+	char *ptr = buf, *end = buf + size;
+	char name[20];
+	int i;
+
+	export_printf(&ptr, end, "{\"traceEvents\":[\n"
+		      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+		      "\"args\":{\"name\":\"U-Boot\"}}");
+	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
+		if (!rec->id)
+			continue;
+		export_printf(&ptr, end, ",\n{\"name\":");
+		export_string(&ptr, end,
+			      get_record_name(name, sizeof(name), rec));
+		if (rec->start_us || (rec->flags & BOOTSTAGEF_SPAN)) {
+			export_printf(&ptr, end,
+				      ",\"ph\":\"X\",\"ts\":%u.%03u,"
+				      "\"dur\":%lu.%03u",
+				      rec->start_us, rec->start_ns,
+				      rec->time_us, rec->time_ns);
+		} else {
+			export_printf(&ptr, end,
+				      ",\"ph\":\"i\",\"s\":\"g\",\"ts\":%lu",
+				      rec->time_us);
+		}
+		export_printf(&ptr, end, ",\"pid\":1,\"tid\":1}");
+	}
+	export_printf(&ptr, end, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+	return ptr - buf;
 }
 
 /**
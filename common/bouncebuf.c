@@ -9,6 +9,50 @@
 #include <malloc.h>
 #include <errno.h>
 #include <bouncebuf.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/*
+ * Bounce buffers of up to this size are kept for the next transfer rather
+ * than freed, so that a stream of small unaligned transfers (e.g. the
+ * partial sectors of a filesystem read) does not allocate for each one
+ */
+#define BOUNCE_POOL_MAX		SZ_64K
+
+static struct {
+	void *buf;
+	size_t size;
+	bool busy;
+} bounce_pool;
+
+static void *bounce_alloc(size_t len)
+{
+	/* BSS is not available before relocation */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) || len > BOUNCE_POOL_MAX ||
+	    bounce_pool.busy)
+		return memalign(ARCH_DMA_MINALIGN, len);
+
+	if (bounce_pool.size < len) {
+		free(bounce_pool.buf);
+		bounce_pool.size = 0;
+		bounce_pool.buf = memalign(ARCH_DMA_MINALIGN, len);
+		if (!bounce_pool.buf)
+			return NULL;
+		bounce_pool.size = len;
+	}
+	bounce_pool.busy = true;
+
+	return bounce_pool.buf;
+}
+
+static void bounce_free(void *buf)
+{
+	if (bounce_pool.busy && buf == bounce_pool.buf)
+		bounce_pool.busy = false;
+	else
+		free(buf);
+}
 
 static int addr_aligned(struct bounce_buffer *state)
 {
@@ -40,8 +84,7 @@ int bounce_buffer_start(struct bounce_buffer *state, void *data,
 	state->flags = flags;
 
 	if (!addr_aligned(state)) {
-		state->bounce_buffer = memalign(ARCH_DMA_MINALIGN,
-						state->len_aligned);
+		state->bounce_buffer = bounce_alloc(state->len_aligned);
 		if (!state->bounce_buffer)
 			return -ENOMEM;
 
@@ -76,7 +119,7 @@ int bounce_buffer_stop(struct bounce_buffer *state)
 	if (state->flags & GEN_BB_WRITE)
 		memcpy(state->user_buffer, state->bounce_buffer, state->len);
 
-	free(state->bounce_buffer);
+	bounce_free(state->bounce_buffer);
 
 	return 0;
 }
@@ -307,6 +307,9 @@ struct variables *top_vars = &shell_ver;
 static int flag_repeat = 0;
 static int do_repeat = 0;
 static struct variables *top_vars = NULL ;
+#ifdef CONFIG_HUSH_PARSE_CACHE
+static int parse_cache_quiet;
+#endif
 #endif /*__U_BOOT__ */
 
 #define B_CHUNK (100)
@@ -376,6 +379,11 @@ static inline void debug_printf(const char *format, ...) { }
 
 #ifdef __U_BOOT__
 static void syntax_err(void) {
+#ifdef CONFIG_HUSH_PARSE_CACHE
+	/* parse_string_outer() reports it when it parses the script again */
+	if (parse_cache_quiet)
+		return;
+#endif
 	 printf("syntax error\n");
 }
 #else
@@ -1533,7 +1541,7 @@ shell_terminal_error:
  */
 static int run_pipe_real(struct pipe *pi)
 {
-	int i;
+	int i, sp;
 #ifndef __U_BOOT__
 	int nextin, nextout;
 	int pipefds[2];				/* pipefds[0] is for reading */
@@ -1618,6 +1626,8 @@ static int run_pipe_real(struct pipe *pi)
 			}
 			return EXIT_SUCCESS;   /* don't worry about errors in set_local_var() yet */
 		}
+		/* Do not change the pipe itself, it may be run again */
+		sp = child->sp;
 		for (i = 0; is_assignment(child->argv[i]); i++) {
 			p = insert_var_value(child->argv[i]);
 #ifndef __U_BOOT__
@@ -1626,11 +1636,11 @@ static int run_pipe_real(struct pipe *pi)
 			set_local_var(p, 0);
 #endif
 			if (p != child->argv[i]) {
-				child->sp--;
+				sp--;
 				free(p);
 			}
 		}
-		if (child->sp) {
+		if (sp) {
 			char * str = NULL;
 
 			str = make_string(child->argv + i,
@@ -1763,6 +1773,7 @@ static int run_list_real(struct pipe *pi)
 	char *save_name = NULL;
 	char **list = NULL;
 	char **save_list = NULL;
+	struct pipe *save_pipe = NULL;
 	struct pipe *rpipe;
 	int flag_rep = 0;
 #ifndef __U_BOOT__
@@ -1802,7 +1813,8 @@ static int run_list_real(struct pipe *pi)
 				/* check Ctrl-C */
 				ctrlc();
 				if ((had_ctrlc())) {
-					return 1;
+					rcode = 1;
+					break;
 				}
 #endif
 				flag_restore = 0;
@@ -1832,6 +1844,7 @@ static int run_list_real(struct pipe *pi)
 					pi->progs->argv[0]);
 				save_list = list;
 				save_name = pi->progs->argv[0];
+				save_pipe = pi;
 				pi->progs->argv[0] = NULL;
 				flag_rep = 1;
 			}
@@ -1902,7 +1915,8 @@ static int run_list_real(struct pipe *pi)
 #else
 		if (rcode < -1) {
 			last_return_code = -rcode - 2;
-			return -2;	/* exit */
+			rcode = -2;	/* exit */
+			break;
 		}
 		last_return_code=(rcode == 0) ? 0 : 1;
 #endif
@@ -1922,6 +1936,14 @@ static int run_list_real(struct pipe *pi)
 		checkjobs(NULL);
 #endif
 	}
+	/* Put back the "for" variable if we left the loop early */
+	if (list) {
+		free(save_pipe->progs->argv[0]);
+		while (*list)
+			free(*list++);
+		free(save_list);
+		save_pipe->progs->argv[0] = save_name;
+	}
 	return rcode;
 }
 
@@ -3252,6 +3274,174 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 #endif /* __U_BOOT__ */
 }
 
+#ifdef CONFIG_HUSH_PARSE_CACHE
+/*
+ * Scripts kept in the environment, such as bootcmd and the distro boot
+ * scripts, are run many times. Keep the parsed form of the ones run
+ * recently, keyed by their text, so that they are not parsed each time.
+ * Running a pipe list leaves it unchanged, so it can be run again.
+ */
+#define PARSE_CACHE_SIZE	16
+
+struct parse_cache {
+	char *text;		/* script, as passed to parse_string_outer() */
+	int len;
+	int flag;
+	struct pipe **lines;	/* list parsed from each line of the script */
+	int count;
+	int busy;		/* number of runs in progress */
+	ulong last_used;
+};
+
+static struct parse_cache parse_cache[PARSE_CACHE_SIZE];
+static ulong parse_cache_tick;
+
+static void parse_cache_free(struct parse_cache *pc)
+{
+	int i;
+
+	for (i = 0; i < pc->count; i++)
+		free_pipe_list(pc->lines[i], 0);
+	free(pc->lines);
+	free(pc->text);
+	memset(pc, '\0', sizeof(*pc));
+}
+
+/*
+ * Parse a script line by line as parse_stream_outer() does, but keep the
+ * lists instead of running them. Scripts with syntax errors are not
+ * cached, so that they fail as before.
+ */
+static int parse_cache_parse(struct parse_cache *pc, struct in_str *inp,
+			     int flag)
+{
+	struct p_context ctx;
+	o_string temp = NULL_O_STRING;
+	struct pipe **lines;
+	int rcode, ret = 0;
+
+	parse_cache_quiet = 1;
+	do {
+		ctx.type = flag;
+		initialize_context(&ctx);
+		update_ifs_map();
+		if (!(flag & FLAG_PARSE_SEMICOLON) || (flag & FLAG_REPARSING)) mapset((uchar *)";$&|", 0);
+		inp->promptmode = 1;
+		rcode = parse_stream(&temp, &ctx, inp,
+				     flag & FLAG_CONT_ON_NEWLINE ? -1 : '\n');
+		if (rcode == 1 || ctx.old_flag != 0) {
+			/* Drop any unfinished if, for or while as well */
+			while (ctx.stack) {
+				struct p_context *old = ctx.stack;
+
+				free_pipe_list(ctx.list_head, 0);
+				ctx = *old;
+				free(old);
+			}
+			free_pipe_list(ctx.list_head, 0);
+			ret = -EINVAL;
+		} else {
+			done_word(&temp, &ctx);
+			done_pipe(&ctx, PIPE_SEQ);
+			lines = realloc(pc->lines,
+					(pc->count + 1) * sizeof(*lines));
+			if (lines) {
+				pc->lines = lines;
+				pc->lines[pc->count++] = ctx.list_head;
+			} else {
+				free_pipe_list(ctx.list_head, 0);
+				ret = -ENOMEM;
+			}
+		}
+		b_free(&temp);
+	} while (!ret && rcode != -1 && !(flag & FLAG_EXIT_FROM_LOOP) &&
+		 b_peek(inp));
+	parse_cache_quiet = 0;
+
+	return ret;
+}
+
+static int parse_cache_exec(struct parse_cache *pc)
+{
+	int code = 1;
+	int i;
+
+	pc->busy++;
+	for (i = 0; i < pc->count; i++) {
+		code = run_list_real(pc->lines[i]);
+		if (code == -2) {	/* exit */
+			code = 0;
+			break;
+		}
+		if (code == -1)
+			flag_repeat = 0;
+	}
+	pc->busy--;
+
+	return (code != 0) ? 1 : 0;
+}
+
+/*
+ * Run a script from the cache, parsing it first if needed. Returns -1 if
+ * the cache cannot be used, so that the caller parses it as usual.
+ */
+static int parse_cache_run(const char *s, int flag)
+{
+	struct parse_cache *pc, *victim = NULL;
+	struct in_str input;
+	int len = strlen(s);
+	char *text = NULL;
+	char *p;
+	int ret;
+
+	if (flag & FLAG_REPARSING)
+		return -1;
+
+	for (pc = parse_cache; pc < parse_cache + PARSE_CACHE_SIZE; pc++) {
+		if (pc->text && pc->len == len && pc->flag == flag &&
+		    !strcmp(pc->text, s)) {
+			/* A script which runs itself is parsed again */
+			if (pc->busy)
+				return -1;
+			pc->last_used = ++parse_cache_tick;
+			return parse_cache_exec(pc);
+		}
+		if (pc->busy)
+			continue;
+		if (!victim || (victim->text &&
+				(!pc->text || pc->last_used < victim->last_used)))
+			victim = pc;
+	}
+	if (!victim)
+		return -1;
+
+	parse_cache_free(victim);
+	/* The input must end with a newline, as in parse_string_outer() */
+	if (!(p = strchr(s, '\n')) || *++p) {
+		text = xmalloc(len + 2);
+		strcpy(text, s);
+		strcat(text, "\n");
+	}
+	setup_string_in_str(&input, text ? text : s);
+	ret = parse_cache_parse(victim, &input, flag);
+	free(text);
+	if (ret) {
+		parse_cache_free(victim);
+		return -1;
+	}
+	victim->text = strdup(s);
+	if (!victim->text) {
+		parse_cache_free(victim);
+		return -1;
+	}
+	victim->len = len;
+	victim->flag = flag;
+	victim->last_used = ++parse_cache_tick;
+
+	return parse_cache_exec(victim);
+}
+#endif /* CONFIG_HUSH_PARSE_CACHE */
+
 #ifndef __U_BOOT__
 static int parse_string_outer(const char *s, int flag)
 #else
@@ -3266,6 +3456,11 @@ int parse_string_outer(const char *s, int flag)
 		return 1;
 	if (!*s)
 		return 0;
+#ifdef CONFIG_HUSH_PARSE_CACHE
+	rcode = parse_cache_run(s, flag);
+	if (rcode >= 0)
+		return rcode;
+#endif
 	if (!(p = strchr(s, '\n')) || *++p) {
 		p = xmalloc(strlen(s) + 2);
 		strcpy(p, s);
@@ -12,6 +12,9 @@
 #include <command.h>
 #include <console.h>
 #include <linux/ctype.h>
+#include <malloc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 /*
  * Use puts() instead of printf() to avoid printf buffer overflow
@@ -116,10 +119,82 @@ cmd_tbl_t *find_cmd_tbl(const char *cmd, cmd_tbl_t *table, int table_len)
 	return NULL;	/* not found or ambiguous command */
 }
 
+#ifdef CONFIG_CMDLINE
+/*
+ * Index of the command linker list, sorted by name. It is built after
+ * relocation, on the first lookup, so that find_cmd() does not compare
+ * the command against every entry each time it runs.
+ */
+static cmd_tbl_t **cmd_index;
+
+static int cmd_index_cmp(const void *a, const void *b)
+{
+	const cmd_tbl_t *ca = *(const cmd_tbl_t **)a;
+	const cmd_tbl_t *cb = *(const cmd_tbl_t **)b;
+
+	return strcmp(ca->name, cb->name);
+}
+
+static cmd_tbl_t **cmd_index_get(cmd_tbl_t *start, int count)
+{
+	int i;
+
+	if (cmd_index || !(gd->flags & GD_FLG_RELOC))
+		return cmd_index;
+
+	cmd_index = malloc(count * sizeof(*cmd_index));
+	if (!cmd_index)
+		return NULL;
+	for (i = 0; i < count; i++)
+		cmd_index[i] = start + i;
+	qsort(cmd_index, count, sizeof(*cmd_index), cmd_index_cmp);
+
+	return cmd_index;
+}
+
+/*
+ * Same result as find_cmd_tbl(): names starting with the command sort
+ * together, and an exact match is the first of them.
+ */
+static cmd_tbl_t *cmd_index_find(cmd_tbl_t **index, int count,
+				 const char *cmd)
+{
+	const char *p;
+	int lo = 0, hi = count;
+	int len;
+
+	len = ((p = strchr(cmd, '.')) == NULL) ? strlen(cmd) : (p - cmd);
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (strncmp(index[mid]->name, cmd, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == count || strncmp(index[lo]->name, cmd, len))
+		return NULL;
+	if (index[lo]->name[len] == '\0')
+		return index[lo];	/* full match */
+	if (lo + 1 < count && !strncmp(index[lo + 1]->name, cmd, len))
+		return NULL;		/* ambiguous */
+
+	return index[lo];		/* abbreviated command */
+}
+#endif /* CONFIG_CMDLINE */
+
 cmd_tbl_t *find_cmd(const char *cmd)
 {
 	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
 	const int len = ll_entry_count(cmd_tbl_t, cmd);
+#ifdef CONFIG_CMDLINE
+	cmd_tbl_t **index;
+
+	index = cmd_index_get(start, len);
+	if (index && cmd)
+		return cmd_index_find(index, len, cmd);
+#endif
 	return find_cmd_tbl(cmd, start, len);
 }
 
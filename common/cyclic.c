@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cooperative background tasks, see include/cyclic.h
+ *
+ * The list of tasks is held in global_data so that it can be used before
+ * relocation. The tasks themselves are owned by their callers.
+ */
+
+#include <common.h>
+#include <cyclic.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+int cyclic_register(struct cyclic_info *info, cyclic_func_t func, void *ctx,
+		    ulong period_us, uint flags, const char *name)
+{
+	if (info->active)
+		return -EALREADY;
+
+	info->func = func;
+	info->ctx = ctx;
+	info->name = name;
+	info->period_us = period_us;
+	info->next_us = timer_get_us();
+	info->flags = flags;
+	info->ret = -EBUSY;
+	info->running = false;
+	info->active = true;
+	info->next = gd->cyclic_list;
+	gd->cyclic_list = info;
+
+	return 0;
+}
+
+void cyclic_unregister(struct cyclic_info *info)
+{
+	struct cyclic_info **ptr;
+
+	for (ptr = &gd->cyclic_list; *ptr; ptr = &(*ptr)->next) {
+		if (*ptr == info) {
+			*ptr = info->next;
+			break;
+		}
+	}
+	info->active = false;
+}
+
+ulong cyclic_run(void)
+{
+	struct cyclic_info *info, *next;
+	ulong now, wait = ULONG_MAX;
+	long left;
+
+	for (info = gd->cyclic_list; info; info = next) {
+		/* This task may be waiting in udelay(); don't call it again */
+		if (info->running) {
+			next = info->next;
+			continue;
+		}
+
+		now = timer_get_us();
+		left = info->next_us - now;
+		if (left <= 0) {
+			info->running = true;
+			info->ret = info->func(info->ctx);
+			info->running = false;
+			info->next_us = timer_get_us() + info->period_us;
+			left = info->period_us;
+		}
+
+		/* The function may have unregistered any task, even this one */
+		next = info->next;
+		if (info->ret != -EBUSY && info->active) {
+			if (info->ret)
+				debug("%s: Task '%s' failed (err=%d)\n",
+				      __func__, info->name, info->ret);
+			cyclic_unregister(info);
+			continue;
+		}
+		wait = min(wait, (ulong)max(left, 1L));
+	}
+
+	return wait;
+}
+
+int cyclic_wait(struct cyclic_info *info)
+{
+	while (info->active)
+		cyclic_run();
+
+	return info->ret == -EBUSY ? 0 : info->ret;
+}
+
+int cyclic_wait_all(void)
+{
+	struct cyclic_info *info;
+
+	do {
+		cyclic_run();
+		for (info = gd->cyclic_list; info; info = info->next) {
+			if (!(info->flags & CYCLICF_ENDLESS))
+				break;
+		}
+	} while (info);
+
+	while (gd->cyclic_list)
+		cyclic_unregister(gd->cyclic_list);
+
+	return 0;
+}
@@ -79,6 +79,9 @@ int run_usb_dnl_gadget(int usbctrl_index, char *usb_dnl_gadget)
 			}
 		}
 
+		/* Write to the medium while the host sends the next buffer */
+		dfu_write_poll();
+
 		WATCHDOG_RESET();
 		usb_gadget_handle_interrupts(usbctrl_index);
 	}
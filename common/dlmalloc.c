@@ -5,6 +5,7 @@
 #endif
 
 #include <malloc.h>
+#include <malloc_profile.h>
 #include <asm/io.h>
 
 #ifdef DEBUG
@@ -2395,6 +2396,31 @@ int initf_malloc(void)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(MALLOC_PROFILE)
+ulong malloc_free_histogram(uint hist[MALLOC_PROFILE_BUCKETS],
+			    ulong *largestp)
+{
+	ulong size, largest = 0;
+	mchunkptr p;
+	mbinptr b;
+	int i, n;
+
+	memset(hist, '\0', MALLOC_PROFILE_BUCKETS * sizeof(*hist));
+	for (i = 1; i < NAV; ++i) {
+		b = bin_at(i);
+		for (p = last(b); p != b; p = p->bk) {
+			size = chunksize(p);
+			n = fls(size) - 5;
+			hist[max(0, min(n, MALLOC_PROFILE_BUCKETS - 1))]++;
+			largest = max(largest, size);
+		}
+	}
+	*largestp = largest;
+
+	return chunksize(top);
+}
+#endif
+
 /*
 
 History:
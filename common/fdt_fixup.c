@@ -0,0 +1,346 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Batched device tree fixups
+ *
+ * Each fdt_setprop() which grows a property moves the whole tail of the
+ * blob, and each do_fixup_by_compat() scans the whole tree. While a session
+ * is open, do_fixup_by_path() and do_fixup_by_compat() only record their
+ * changes. Closing the session writes the tree out once, applying all the
+ * changes and dropping the NOPs on the way, then copies it back.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <fdt_support.h>
+#include <linux/libfdt.h>
+
+struct fdt_fixup {
+	bool by_compat;		/* @target is a compatible string, not a path */
+	const char *target;
+	const char *name;
+	const void *val;
+	int len;
+	bool create;
+	int node;		/* offset of the node @target is a path to */
+	int nameoff;		/* offset of @name in the new strings */
+	bool match;		/* applies to the current node */
+	bool done;		/* already written to the current node */
+};
+
+static struct {
+	void *fdt;
+	struct fdt_fixup *fix;
+	int count;
+	int size;
+} session;
+
+int fdt_fixup_session_begin(void *fdt)
+{
+	if (session.fdt)
+		return -FDT_ERR_BADSTATE;
+	session.fdt = fdt;
+
+	return 0;
+}
+
+bool fdt_fixup_session_add(void *fdt, const char *target, bool by_compat,
+			   const char *name, const void *val, int len,
+			   int create)
+{
+	struct fdt_fixup *fix;
+	char *buf;
+
+	if (!session.fdt || session.fdt != fdt)
+		return false;
+
+	if (session.count == session.size) {
+		int size = session.size ? session.size * 2 : 32;
+
+		fix = realloc(session.fix, size * sizeof(*fix));
+		if (!fix)
+			return false;
+		session.fix = fix;
+		session.size = size;
+	}
+	buf = malloc(strlen(target) + strlen(name) + 2 + len);
+	if (!buf)
+		return false;
+
+	fix = &session.fix[session.count++];
+	fix->by_compat = by_compat;
+	fix->create = create;
+	fix->len = len;
+	fix->target = strcpy(buf, target);
+	buf += strlen(target) + 1;
+	fix->name = strcpy(buf, name);
+	buf += strlen(name) + 1;
+	fix->val = memcpy(buf, val, len);
+
+	return true;
+}
+
+static const char *find_string(const char *tab, int size, const char *s)
+{
+	int len = strlen(s) + 1;
+	const char *p;
+
+	for (p = tab; p + len <= tab + size; p += strlen(p) + 1) {
+		if (!memcmp(p, s, len))
+			return p;
+	}
+
+	return NULL;
+}
+
+struct fixup_out {
+	char *buf;
+	int pos;
+	int limit;
+};
+
+static int out_write(struct fixup_out *out, const void *data, int len)
+{
+	int size = ALIGN(len, FDT_TAGSIZE);
+
+	if (out->pos + size > out->limit)
+		return -FDT_ERR_NOSPACE;
+	memcpy(out->buf + out->pos, data, len);
+	memset(out->buf + out->pos + len, '\0', size - len);
+	out->pos += size;
+
+	return 0;
+}
+
+static int out_prop(struct fixup_out *out, int nameoff, const void *val,
+		    int len)
+{
+	struct fdt_property prop;
+	int ret;
+
+	prop.tag = cpu_to_fdt32(FDT_PROP);
+	prop.len = cpu_to_fdt32(len);
+	prop.nameoff = cpu_to_fdt32(nameoff);
+	ret = out_write(out, &prop, sizeof(prop));
+	if (ret)
+		return ret;
+
+	return out_write(out, val, len);
+}
+
+/*
+ * Find the change of property @name on the current node: the last one
+ * recorded wins. All of them are marked as done.
+ */
+static struct fdt_fixup *fixup_find(struct fdt_fixup *fix, int count,
+				    const char *name, bool *create)
+{
+	struct fdt_fixup *last = NULL;
+	int i;
+
+	*create = false;
+	for (i = 0; i < count; i++) {
+		if (!fix[i].match || fix[i].done || strcmp(fix[i].name, name))
+			continue;
+		fix[i].done = true;
+		*create |= fix[i].create;
+		last = &fix[i];
+	}
+
+	return last;
+}
+
+/* Add the properties the current node does not have yet */
+static int fixup_add_props(struct fixup_out *out, struct fdt_fixup *fix,
+			   int count)
+{
+	struct fdt_fixup *last;
+	bool create;
+	int ret;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (!fix[i].match || fix[i].done)
+			continue;
+		last = fixup_find(fix, count, fix[i].name, &create);
+		if (!create)
+			continue;
+		ret = out_prop(out, last->nameoff, last->val, last->len);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void fixup_match(const void *fdt, int node, struct fdt_fixup *fix,
+			int count)
+{
+	const char *compat;
+	int len;
+	int i;
+
+	compat = fdt_getprop(fdt, node, "compatible", &len);
+	for (i = 0; i < count; i++) {
+		if (fix[i].by_compat)
+			fix[i].match = compat &&
+				fdt_stringlist_contains(compat, len,
+							fix[i].target);
+		else
+			fix[i].match = fix[i].node == node;
+		fix[i].done = false;
+	}
+}
+
+/* Write the structure block out to @out, with the changes applied */
+static int fixup_write_struct(const void *fdt, struct fixup_out *out,
+			      struct fdt_fixup *fix, int count)
+{
+	const char *base = fdt + fdt_off_dt_struct(fdt);
+	const struct fdt_property *prop;
+	struct fdt_fixup *last;
+	bool pending = false;
+	int offset = 0;
+	int next;
+	uint32_t tag;
+	bool create;
+	int ret;
+
+	do {
+		tag = fdt_next_tag(fdt, offset, &next);
+		if (next < 0)
+			return next;
+
+		/* The properties of a node all come before its subnodes */
+		if (pending && (tag == FDT_BEGIN_NODE || tag == FDT_END_NODE)) {
+			ret = fixup_add_props(out, fix, count);
+			if (ret)
+				return ret;
+			pending = false;
+		}
+
+		switch (tag) {
+		case FDT_BEGIN_NODE:
+			fixup_match(fdt, offset, fix, count);
+			pending = true;
+			break;
+		case FDT_PROP:
+			prop = fdt_offset_ptr(fdt, offset, sizeof(*prop));
+			last = fixup_find(fix, count,
+					  fdt_string(fdt,
+						     fdt32_to_cpu(prop->nameoff)),
+					  &create);
+			if (last) {
+				ret = out_prop(out, fdt32_to_cpu(prop->nameoff),
+					       last->val, last->len);
+				if (ret)
+					return ret;
+				offset = next;
+				continue;
+			}
+			break;
+		case FDT_NOP:
+			offset = next;
+			continue;
+		}
+
+		ret = out_write(out, base + offset, next - offset);
+		if (ret)
+			return ret;
+		offset = next;
+	} while (tag != FDT_END);
+
+	return 0;
+}
+
+static int fixup_apply(void *fdt, struct fdt_fixup *fix, int count)
+{
+	struct fixup_out out;
+	const char *p;
+	char *strtab;
+	int strsize;
+	int size;
+	int ret;
+	int i;
+
+	/* Make sure the blocks are in the order written out below */
+	ret = fdt_open_into(fdt, fdt, fdt_totalsize(fdt));
+	if (ret)
+		return ret;
+
+	/* Look up every node and property name only once */
+	strsize = fdt_size_dt_strings(fdt);
+	size = strsize;
+	for (i = 0; i < count; i++)
+		size += strlen(fix[i].name) + 1;
+	strtab = malloc(size);
+	if (!strtab)
+		return -FDT_ERR_NOSPACE;
+	memcpy(strtab, fdt + fdt_off_dt_strings(fdt), strsize);
+
+	for (i = 0; i < count; i++) {
+		p = find_string(strtab, strsize, fix[i].name);
+		if (!p) {
+			p = strcpy(strtab + strsize, fix[i].name);
+			strsize += strlen(fix[i].name) + 1;
+		}
+		fix[i].nameoff = p - strtab;
+
+		fix[i].node = -1;
+		if (!fix[i].by_compat) {
+			fix[i].node = fdt_path_offset(fdt, fix[i].target);
+			if (fix[i].node < 0)
+				printf("Unable to update property %s:%s, err=%s\n",
+				       fix[i].target, fix[i].name,
+				       fdt_strerror(fix[i].node));
+		}
+	}
+
+	out.pos = fdt_off_dt_struct(fdt);
+	out.limit = fdt_totalsize(fdt) - strsize;
+	out.buf = malloc(out.limit);
+	if (!out.buf) {
+		ret = -FDT_ERR_NOSPACE;
+		goto err;
+	}
+	memcpy(out.buf, fdt, out.pos);
+
+	ret = fixup_write_struct(fdt, &out, fix, count);
+	if (ret)
+		goto err;
+
+	fdt_set_size_dt_struct(out.buf, out.pos - fdt_off_dt_struct(fdt));
+	fdt_set_off_dt_strings(out.buf, out.pos);
+	fdt_set_size_dt_strings(out.buf, strsize);
+	memcpy(fdt, out.buf, out.pos);
+	memcpy(fdt + out.pos, strtab, strsize);
+
+err:
+	free(out.buf);
+	free(strtab);
+
+	return ret;
+}
+
+int fdt_fixup_session_end(void)
+{
+	void *fdt = session.fdt;
+	int ret = 0;
+	int i;
+
+	if (!fdt)
+		return 0;
+
+	/* Changes made from now on go straight to the blob */
+	session.fdt = NULL;
+	if (session.count)
+		ret = fixup_apply(fdt, session.fix, session.count);
+
+	for (i = 0; i < session.count; i++)
+		free((void *)session.fix[i].target);
+	free(session.fix);
+	session.fix = NULL;
+	session.count = 0;
+	session.size = 0;
+
+	return ret;
+}
@@ -312,6 +312,9 @@ void do_fixup_by_path(void *fdt, const char *path, const char *prop,
 		debug(" %.2x", *(u8*)(val+i));
 	debug("\n");
 #endif
+	if (fdt_fixup_session_add(fdt, path, false, prop, val, len, create))
+		return;
+
 	int rc = fdt_find_and_setprop(fdt, path, prop, val, len, create);
 	if (rc)
 		printf("Unable to update property %s:%s, err=%s\n",
@@ -365,6 +368,9 @@ void do_fixup_by_compat(void *fdt, const char *compat,
 		debug(" %.2x", *(u8*)(val+i));
 	debug("\n");
 #endif
+	if (fdt_fixup_session_add(fdt, compat, true, prop, val, len, create))
+		return;
+
 	off = fdt_node_offset_by_compatible(fdt, -1, compat);
 	while (off != -FDT_ERR_NOTFOUND) {
 		if (create || (fdt_get_property(fdt, off, prop, NULL) != NULL))
@@ -1752,4 +1758,47 @@ int fdt_overlay_apply_verbose(void *fdt, void *fdto)
 	}
 	return err;
 }
+
+/**
+ * fdt_overlay_apply_in_place - Apply an overlay to a device tree which grows
+ *
+ * @fdt: ptr to device tree, with room for @extra more bytes after its blocks
+ * @fdto: ptr to device tree overlay
+ * @extra: room the overlay may take, its size is enough
+ *
+ * Applying overlays with fdt_open_into() and fdt_pack() around each one
+ * moves the whole base tree twice per overlay. Here the tree is only moved
+ * if its blocks are not in the order libfdt edits them in, which is only
+ * the case for the first overlay: after that, only the total size in the
+ * header changes. The tree is left with its total size trimmed to the
+ * blocks in use, as fdt_pack() would.
+ */
+int fdt_overlay_apply_in_place(void *fdt, void *fdto, int extra)
+{
+	int used = fdt_off_dt_strings(fdt) + fdt_size_dt_strings(fdt);
+	int err;
+
+	if (fdt_version(fdt) >= 17 &&
+	    fdt_off_mem_rsvmap(fdt) >= sizeof(struct fdt_header) &&
+	    fdt_off_dt_struct(fdt) >= fdt_off_mem_rsvmap(fdt) &&
+	    fdt_off_dt_strings(fdt) >=
+	    fdt_off_dt_struct(fdt) + fdt_size_dt_struct(fdt)) {
+		fdt_set_totalsize(fdt, used + extra);
+	} else {
+		err = fdt_open_into(fdt, fdt, fdt_totalsize(fdt) + extra);
+		if (err < 0) {
+			printf("failed on fdt_open_into\n");
+			return err;
+		}
+	}
+
+	/* the verbose method prints out messages on error */
+	err = fdt_overlay_apply_verbose(fdt, fdto);
+	if (err < 0)
+		return err;
+	fdt_set_totalsize(fdt, fdt_off_dt_strings(fdt) +
+			  fdt_size_dt_strings(fdt));
+
+	return 0;
+}
 #endif
@@ -15,8 +15,13 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <hw_sha.h>
+#include <part.h>
+#include <watchdog.h>
 #include <asm/io.h>
 #include <linux/errno.h>
+#ifdef CONFIG_CMD_MTD
+#include <mtd.h>
+#endif
 #else
 #include "mkimage.h"
 #include <time.h>
@@ -513,75 +518,369 @@ static void hash_show(struct hash_algo *algo, ulong addr, ulong len, uint8_t *ou
 		printf("%02x", output[i]);
 }
 
+/* Number of algorithms which can be computed in a single pass */
+#define HASH_MAX_ALGOS		4
+
+/**
+ * struct hash_src - Where hash_command() reads the data from
+ *
+ * @mem:	memory to hash, if not read from a device
+ * @blk:	block device to read from
+ * @start:	block of @blk to start reading from
+ * @mtd:	MTD device to read from
+ * @off:	offset in @mtd to start reading from
+ */
+struct hash_src {
+	const void *mem;
+#ifdef CONFIG_HASH_DEVICE
+	struct blk_desc *blk;
+	lbaint_t start;
+	struct mtd_info *mtd;
+	loff_t off;
+#endif
+};
+
+#ifdef CONFIG_HASH_DEVICE
+/**
+ * hash_parse_dev() - Parse the device to hash from, if any
+ *
+ * This is "blk <interface> <dev[:part]>" or "mtd <name>".
+ *
+ * @src:	Returns the device
+ * @argc:	Number of arguments left
+ * @argv:	Arguments left
+ * @nargs:	Number of arguments needed after the device
+ * @return number of arguments used, 0 if reading from memory, -ve on error
+ */
+static int hash_parse_dev(struct hash_src *src, int argc, char * const argv[],
+			  int nargs)
+{
+#ifdef CONFIG_HAVE_BLOCK_DEVICE
+	if (!strcmp(argv[0], "blk")) {
+		disk_partition_t info;
+
+		if (argc < 3 + nargs)
+			return -EINVAL;
+		if (blk_get_device_part_str(argv[1], argv[2], &src->blk, &info,
+					    1) < 0)
+			return -ENODEV;
+		src->start = info.start;
+
+		return 3;
+	}
+#endif
+#ifdef CONFIG_CMD_MTD
+	if (!strcmp(argv[0], "mtd")) {
+		if (argc < 2 + nargs)
+			return -EINVAL;
+		mtd_probe_devices();
+		src->mtd = get_mtd_device_nm(argv[1]);
+		if (IS_ERR_OR_NULL(src->mtd)) {
+			printf("MTD device %s not found\n", argv[1]);
+			src->mtd = NULL;
+			return -ENODEV;
+		}
+
+		return 2;
+	}
+#endif
+
+	return 0;
+}
+
+/* Check that @len bytes at @off can be read from the device in @src */
+static int hash_check_dev(struct hash_src *src, ulong off, ulong len)
+{
+	if (src->blk) {
+		if (off % src->blk->blksz || CHUNKSZ % src->blk->blksz) {
+			printf("Offset must be a multiple of %lu bytes\n",
+			       src->blk->blksz);
+			return -EINVAL;
+		}
+		src->start += off / src->blk->blksz;
+	}
+
+	if (src->mtd) {
+		if (off + len > src->mtd->size) {
+			puts("Range is past the end of the device\n");
+			return -EINVAL;
+		}
+		src->off = off;
+	}
+
+	return 0;
+}
+#endif
+
+/*
+ * Get @len bytes at @pos from @src, reading them into @buf (of CHUNKSZ
+ * bytes) from a device. Returns a pointer to the data, NULL on error.
+ */
+static const void *hash_src_read(struct hash_src *src, ulong pos, ulong len,
+				 void *buf)
+{
+#ifdef CONFIG_HASH_DEVICE
+	if (src->blk) {
+		lbaint_t blks = DIV_ROUND_UP(len, src->blk->blksz);
+
+		if (blk_dread(src->blk, src->start + pos / src->blk->blksz,
+			      blks, buf) != blks)
+			return NULL;
+
+		return buf;
+	}
+#ifdef CONFIG_CMD_MTD
+	if (src->mtd) {
+		size_t retlen;
+		int ret;
+
+		ret = mtd_read(src->mtd, src->off + pos, len, &retlen, buf);
+		if ((ret && !mtd_is_bitflip(ret)) || retlen != len)
+			return NULL;
+
+		return buf;
+	}
+#endif
+#endif
+
+	return src->mem + pos;
+}
+
+/**
+ * hash_multi() - Hash data with several algorithms in a single pass
+ *
+ * Each chunk is read once and handed to every algorithm. A hash engine
+ * which can run asynchronously hashes a chunk while the next one is read.
+ *
+ * @algos:	Algorithms to use
+ * @count:	Number of algorithms
+ * @src:	Where to read the data from
+ * @len:	Number of bytes to hash
+ * @output:	Returns the digest of each algorithm
+ * @return 0 if ok, -ve on error
+ */
+static int hash_multi(struct hash_algo **algos, int count,
+		      struct hash_src *src, ulong len,
+		      uint8_t output[][HASH_MAX_DIGEST_SIZE])
+{
+	int (*update[HASH_MAX_ALGOS])(struct hash_algo *algo, void *ctx,
+				      const void *buf, unsigned int size,
+				      int is_last);
+	void *ctx[HASH_MAX_ALGOS];
+	void *buf[2] = { NULL, NULL };
+	const void *data;
+	ulong off = 0;
+	ulong chunk;
+	int ret = 0;
+	int i, n = 0;
+
+	/* One buffer is read while the other may still be hashed */
+	if (!src->mem) {
+		buf[0] = memalign(ARCH_DMA_MINALIGN, CHUNKSZ);
+		buf[1] = memalign(ARCH_DMA_MINALIGN, CHUNKSZ);
+		if (!buf[0] || !buf[1]) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		update[i] = algos[i]->hash_update;
+#ifdef CONFIG_SHA_HW_ASYNC
+		if (update[i] == hw_sha_update)
+			update[i] = hw_sha_update_async;
+#endif
+		if (algos[i]->hash_init(algos[i], &ctx[i])) {
+			ctx[i] = NULL;
+			ret = -EIO;
+		}
+	}
+
+	while (!ret) {
+		chunk = min_t(ulong, len - off, CHUNKSZ);
+		data = hash_src_read(src, off, chunk, buf[n]);
+		if (!data) {
+			printf("Read error at offset %lx\n", off);
+			ret = -EIO;
+			break;
+		}
+
+		for (i = 0; i < count; i++) {
+			if (update[i](algos[i], ctx[i], data, chunk,
+				      off + chunk == len)) {
+				/* The algorithm has freed the context */
+				ctx[i] = NULL;
+				ret = -EIO;
+			}
+		}
+
+		off += chunk;
+		n ^= 1;
+		WATCHDOG_RESET();
+		if (off == len)
+			break;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (ctx[i] && algos[i]->hash_finish(algos[i], ctx[i], output[i],
+						    HASH_MAX_DIGEST_SIZE))
+			ret = -EIO;
+	}
+
+out:
+	free(buf[0]);
+	free(buf[1]);
+
+	return ret;
+}
+
+/**
+ * hash_lookup_algos() - Look up a comma-separated list of algorithms
+ *
+ * @algo_names:	Names of the algorithms, e.g. "crc32,sha256"
+ * @algos:	Returns the algorithms (HASH_MAX_ALGOS entries)
+ * @return number of algorithms, -ve on error
+ */
+static int hash_lookup_algos(const char *algo_names, struct hash_algo **algos)
+{
+	char name[20];
+	const char *end;
+	int count = 0;
+
+	do {
+		end = strchrnul(algo_names, ',');
+		if (count == HASH_MAX_ALGOS || end - algo_names >= sizeof(name)) {
+			printf("Too many hash algorithms or name too long\n");
+			return -E2BIG;
+		}
+		strlcpy(name, algo_names, end - algo_names + 1);
+		if (hash_lookup_algo(name, &algos[count])) {
+			printf("Unknown hash algorithm '%s'\n", name);
+			return -EPROTONOSUPPORT;
+		}
+		if (algos[count]->digest_size > HASH_MAX_DIGEST_SIZE) {
+			puts("HASH_MAX_DIGEST_SIZE exceeded\n");
+			return -E2BIG;
+		}
+		count++;
+		algo_names = end + 1;
+	} while (*end);
+
+	return count;
+}
+
 int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 		 int argc, char * const argv[])
 {
 	ulong addr, len;
+	int nargs = flags & HASH_FLAG_VERIFY ? 3 : 2;
+	struct hash_src src = { };
+	int ret = 0;
 
-	if ((argc < 2) || ((flags & HASH_FLAG_VERIFY) && (argc < 3)))
+	if (argc < nargs)
 		return CMD_RET_USAGE;
 
+#ifdef CONFIG_HASH_DEVICE
+	ret = hash_parse_dev(&src, argc, argv, nargs);
+	if (ret == -EINVAL)
+		return CMD_RET_USAGE;
+	if (ret < 0)
+		return CMD_RET_FAILURE;
+	argc -= ret;
+	argv += ret;
+	ret = 0;
+#endif
+
 	addr = simple_strtoul(*argv++, NULL, 16);
 	len = simple_strtoul(*argv++, NULL, 16);
 
 	if (multi_hash()) {
+		struct hash_algo *algos[HASH_MAX_ALGOS];
 		struct hash_algo *algo;
-		u8 *output;
+		uint8_t (*output)[HASH_MAX_DIGEST_SIZE];
 		uint8_t vsum[HASH_MAX_DIGEST_SIZE];
-		void *buf;
+		bool from_dev = false;
+		int count;
+		int i;
 
-		if (hash_lookup_algo(algo_name, &algo)) {
-			printf("Unknown hash algorithm '%s'\n", algo_name);
+		count = hash_lookup_algos(algo_name, algos);
+		if (count < 0)
 			return CMD_RET_USAGE;
-		}
 		argc -= 2;
 
-		if (algo->digest_size > HASH_MAX_DIGEST_SIZE) {
-			puts("HASH_MAX_DIGEST_SIZE exceeded\n");
-			return 1;
-		}
+		if ((flags & HASH_FLAG_VERIFY) && argc < count)
+			return CMD_RET_USAGE;
 
 		output = memalign(ARCH_DMA_MINALIGN,
-				  sizeof(uint32_t) * HASH_MAX_DIGEST_SIZE);
+				  HASH_MAX_ALGOS * HASH_MAX_DIGEST_SIZE);
+		if (!output)
+			return CMD_RET_FAILURE;
+
+#ifdef CONFIG_HASH_DEVICE
+		from_dev = src.blk || src.mtd;
+		if (from_dev)
+			ret = hash_check_dev(&src, addr, len);
+#endif
+		if (!from_dev)
+			src.mem = map_sysmem(addr, len);
+
+		if (!ret && count == 1 && !from_dev) {
+			algos[0]->hash_func_ws(src.mem, len, output[0],
+					       algos[0]->chunk_size);
+		} else if (!ret) {
+			ret = hash_multi(algos, count, &src, len, output);
+			if (ret)
+				printf("ERROR: hashing failed (%d)\n", ret);
+		}
 
-		buf = map_sysmem(addr, len);
-		algo->hash_func_ws(buf, len, output, algo->chunk_size);
-		unmap_sysmem(buf);
+		if (!from_dev)
+			unmap_sysmem(src.mem);
+#if defined(CONFIG_HASH_DEVICE) && defined(CONFIG_CMD_MTD)
+		if (src.mtd)
+			put_mtd_device(src.mtd);
+#endif
+		if (ret) {
+			free(output);
+			return 1;
+		}
+
+		for (i = 0; i < count; i++) {
+			algo = algos[i];
 
-		/* Try to avoid code bloat when verify is not needed */
+			/* Try to avoid code bloat when verify is not needed */
 #if defined(CONFIG_CRC32_VERIFY) || defined(CONFIG_SHA1SUM_VERIFY) || \
 	defined(CONFIG_HASH_VERIFY)
-		if (flags & HASH_FLAG_VERIFY) {
+			if (flags & HASH_FLAG_VERIFY) {
 #else
-		if (0) {
+			if (0) {
 #endif
-			if (parse_verify_sum(algo, *argv, vsum,
-					flags & HASH_FLAG_ENV)) {
-				printf("ERROR: %s does not contain a valid "
-					"%s sum\n", *argv, algo->name);
-				return 1;
+				if (parse_verify_sum(algo, argv[i], vsum,
+						flags & HASH_FLAG_ENV)) {
+					printf("ERROR: %s does not contain a valid "
+						"%s sum\n", argv[i], algo->name);
+					ret = 1;
+				} else if (memcmp(output[i], vsum,
+						  algo->digest_size) != 0) {
+					int j;
+
+					hash_show(algo, addr, len, output[i]);
+					printf(" != ");
+					for (j = 0; j < algo->digest_size; j++)
+						printf("%02x", vsum[j]);
+					puts(" ** ERROR **\n");
+					ret = 1;
+				}
+			} else {
+				hash_show(algo, addr, len, output[i]);
+				printf("\n");
+
+				if (argc > i) {
+					store_result(algo, output[i], argv[i],
+						flags & HASH_FLAG_ENV);
+				}
 			}
-			if (memcmp(output, vsum, algo->digest_size) != 0) {
-				int i;
-
-				hash_show(algo, addr, len, output);
-				printf(" != ");
-				for (i = 0; i < algo->digest_size; i++)
-					printf("%02x", vsum[i]);
-				puts(" ** ERROR **\n");
-				return 1;
-			}
-		} else {
-			hash_show(algo, addr, len, output);
-			printf("\n");
-
-			if (argc) {
-				store_result(algo, output, *argv,
-					flags & HASH_FLAG_ENV);
-			}
-		unmap_sysmem(output);
-
 		}
+		free(output);
 
 	/* Horrible code size hack for boards that just want crc32 */
 	} else {
@@ -599,7 +898,7 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 		}
 	}
 
-	return 0;
+	return ret;
 }
 #endif /* CONFIG_CMD_HASH || CONFIG_CMD_SHA1SUM || CONFIG_CMD_CRC32) */
 #endif /* !USE_HOSTCC */
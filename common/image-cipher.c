@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Decryption of FIT subimages which have a cipher node
+ *
+ * The cipher node names the algorithm and the key:
+ *
+ *	cipher {
+ *		algo = "aes256";		(CBC; "aes256-ctr" for CTR)
+ *		key-name-hint = "image-key";
+ *		iv = [...];			(optional)
+ *	};
+ *
+ * The key is looked up in the control FDT, in /cipher/key-<algo>-<hint>,
+ * which holds the "key" and, unless the cipher node has one, the "iv".
+ * The image data is the ciphertext, padded to whole blocks for CBC, and
+ * "data-size-unciphered" gives the size of the plain data.
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <hw_aes.h>
+#include <image.h>
+#include <malloc.h>
+#include <uboot_aes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+struct fit_cipher {
+	enum hw_aes_mode mode;
+#if IS_ENABLED(CONFIG_AES_HW_ACCEL)
+	void *hw;
+#else
+	u8 key_exp[AES_EXPAND_KEY_LENGTH];
+	u8 iv[HW_AES_BLOCK_SIZE];
+#endif
+};
+
+bool fit_image_has_cipher(const void *fit, int image_noffset)
+{
+	return fdt_subnode_offset(fit, image_noffset,
+				  FIT_CIPHER_NODENAME) >= 0;
+}
+
+static int fit_cipher_get_mode(const char *algo, enum hw_aes_mode *modep,
+			       int *key_lenp)
+{
+	static const struct {
+		const char *name;
+		enum hw_aes_mode mode;
+		int key_len;
+	} algos[] = {
+		{ "aes128", HW_AES_CBC, 16 },
+		{ "aes192", HW_AES_CBC, 24 },
+		{ "aes256", HW_AES_CBC, 32 },
+		{ "aes128-ctr", HW_AES_CTR, 16 },
+		{ "aes192-ctr", HW_AES_CTR, 24 },
+		{ "aes256-ctr", HW_AES_CTR, 32 },
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(algos); i++) {
+		if (!strcmp(algos[i].name, algo)) {
+			*modep = algos[i].mode;
+			*key_lenp = algos[i].key_len;
+			return 0;
+		}
+	}
+
+	return -EPROTONOSUPPORT;
+}
+
+#if !IS_ENABLED(CONFIG_AES_HW_ACCEL)
+/* The software AES only has 128-bit keys */
+static int fit_cipher_sw_init(struct fit_cipher *c, const u8 *key,
+			      int key_len, const u8 *iv)
+{
+	if (key_len != AES_KEY_LENGTH) {
+		debug("%s: no %d-bit AES without an engine\n", __func__,
+		      key_len * 8);
+		return -EPROTONOSUPPORT;
+	}
+	aes_expand_key((u8 *)key, c->key_exp);
+	memcpy(c->iv, iv, sizeof(c->iv));
+
+	return 0;
+}
+
+static void fit_cipher_sw_decrypt(struct fit_cipher *c, const u8 *src,
+				  u8 *dst, size_t len)
+{
+	u8 block[HW_AES_BLOCK_SIZE];
+	size_t off;
+	int i;
+
+	for (off = 0; off < len; off += HW_AES_BLOCK_SIZE) {
+		if (c->mode == HW_AES_CBC) {
+			/* src and dst may be the same */
+			memcpy(block, src + off, sizeof(block));
+			aes_cbc_decrypt_blocks(c->key_exp, c->iv, block,
+					       dst + off, 1);
+			memcpy(c->iv, block, sizeof(block));
+		} else {
+			aes_encrypt(c->iv, c->key_exp, block);
+			for (i = 0; i < HW_AES_BLOCK_SIZE; i++)
+				dst[off + i] = src[off + i] ^ block[i];
+			/* Big-endian 128-bit counter */
+			for (i = HW_AES_BLOCK_SIZE - 1; i >= 0; i--) {
+				if (++c->iv[i])
+					break;
+			}
+		}
+	}
+}
+#endif
+
+int fit_image_cipher_init(const void *fit, int image_noffset,
+			  struct fit_cipher **cp, size_t *plain_sizep)
+{
+	const void *blob = gd_fdt_blob();
+	const char *algo, *key_name;
+	struct fit_cipher *c;
+	const fdt32_t *val;
+	const u8 *key, *iv;
+	char path[128];
+	int noffset, key_noffset;
+	int key_len, len, ret;
+	const void *data;
+	size_t size;
+
+	noffset = fdt_subnode_offset(fit, image_noffset, FIT_CIPHER_NODENAME);
+	if (noffset < 0)
+		return -ENOENT;
+
+	algo = fdt_getprop(fit, noffset, FIT_ALGO_PROP, NULL);
+	key_name = fdt_getprop(fit, noffset, FIT_KEY_HINT, NULL);
+	if (!algo || !key_name) {
+		printf("Cipher node of '%s' lacks '%s' or '%s'\n",
+		       fit_get_name(fit, image_noffset, NULL), FIT_ALGO_PROP,
+		       FIT_KEY_HINT);
+		return -EINVAL;
+	}
+
+	c = calloc(1, sizeof(*c));
+	if (!c)
+		return -ENOMEM;
+	ret = fit_cipher_get_mode(algo, &c->mode, &key_len);
+	if (ret) {
+		printf("Unsupported cipher '%s'\n", algo);
+		goto err;
+	}
+
+	snprintf(path, sizeof(path), "/%s/key-%s-%s", FIT_CIPHER_NODENAME,
+		 algo, key_name);
+	key_noffset = blob ? fdt_path_offset(blob, path) : -FDT_ERR_NOTFOUND;
+	if (key_noffset < 0) {
+		printf("Can't find cipher key %s\n", path);
+		ret = -ENOENT;
+		goto err;
+	}
+	key = fdt_getprop(blob, key_noffset, FIT_CIPHER_KEY_PROP, &len);
+	if (!key || len != key_len) {
+		printf("Bad cipher key %s\n", path);
+		ret = -EINVAL;
+		goto err;
+	}
+	iv = fdt_getprop(fit, noffset, FIT_CIPHER_IV_PROP, &len);
+	if (!iv)
+		iv = fdt_getprop(blob, key_noffset, FIT_CIPHER_IV_PROP, &len);
+	if (!iv || len != HW_AES_BLOCK_SIZE) {
+		printf("Bad or missing cipher IV for %s\n", path);
+		ret = -EINVAL;
+		goto err;
+	}
+
+	ret = fit_image_get_data_and_size(fit, image_noffset, &data, &size);
+	if (ret)
+		goto err;
+	val = fdt_getprop(fit, image_noffset, FIT_DATA_SIZE_UNCIPHERED_PROP,
+			  &len);
+	if (!val || len != sizeof(*val) || fdt32_to_cpu(*val) > size ||
+	    (c->mode == HW_AES_CBC && size % HW_AES_BLOCK_SIZE)) {
+		printf("Bad '%s' for '%s'\n", FIT_DATA_SIZE_UNCIPHERED_PROP,
+		       fit_get_name(fit, image_noffset, NULL));
+		ret = -EINVAL;
+		goto err;
+	}
+	*plain_sizep = fdt32_to_cpu(*val);
+
+#if IS_ENABLED(CONFIG_AES_HW_ACCEL)
+	ret = hw_aes_init(c->mode, key, key_len, iv, &c->hw);
+#else
+	ret = fit_cipher_sw_init(c, key, key_len, iv);
+#endif
+	if (ret)
+		goto err;
+	*cp = c;
+
+	return 0;
+
+err:
+	free(c);
+	return ret;
+}
+
+int fit_cipher_decrypt(struct fit_cipher *c, const void *src, void *dst,
+		       size_t len)
+{
+#if IS_ENABLED(CONFIG_AES_HW_ACCEL)
+	return hw_aes_decrypt(c->hw, src, dst, len);
+#else
+	if (len % HW_AES_BLOCK_SIZE)
+		return -EINVAL;
+	fit_cipher_sw_decrypt(c, src, dst, len);
+
+	return 0;
+#endif
+}
+
+int fit_cipher_finish(struct fit_cipher *c)
+{
+	int ret = 0;
+
+#if IS_ENABLED(CONFIG_AES_HW_ACCEL)
+	ret = hw_aes_finish(c->hw);
+#endif
+	free(c);
+
+	return ret;
+}
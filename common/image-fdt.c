@@ -175,12 +175,13 @@ int boot_relocate_fdt(struct lmb *lmb, char **of_flat_tree, ulong *of_size)
 	if (fdt_high) {
 		void *desired_addr = (void *)simple_strtoul(fdt_high, NULL, 16);
 
-		if (((ulong) desired_addr) == ~0UL) {
+		if (((ulong) desired_addr) == ~0UL &&
+		    boot_addr_in_ram(map_to_sysmem(fdt_blob), of_len)) {
 			/* All ones means use fdt in place */
 			of_start = fdt_blob;
 			lmb_reserve(lmb, (ulong)of_start, of_len);
 			disable_relocation = 1;
-		} else if (desired_addr) {
+		} else if (desired_addr && ((ulong)desired_addr) != ~0UL) {
 			of_start =
 			    (void *)(ulong) lmb_alloc_base(lmb, of_len, 0x1000,
 							   (ulong)desired_addr);
@@ -539,6 +540,12 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 		printf("ERROR: /chosen node create failed\n");
 		goto err;
 	}
+	fdt_ret = fdt_fixup_session_begin(blob);
+	if (fdt_ret) {
+		printf("ERROR: fdt fixup session failed: %s\n",
+		       fdt_strerror(fdt_ret));
+		goto err;
+	}
 	if (arch_fixup_fdt(blob) < 0) {
 		printf("ERROR: arch-specific fdt fixup failed\n");
 		goto err;
@@ -561,6 +568,20 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 			goto err;
 		}
 	}
+	fdt_ret = fdt_fixup_session_end();
+	if (fdt_ret) {
+		printf("ERROR: fdt fixups failed: %s\n", fdt_strerror(fdt_ret));
+		goto err;
+	}
+
+	if (CONFIG_IS_ENABLED(LOG_RING)) {
+		fdt_ret = log_ring_fdt_setup(blob);
+		if (fdt_ret) {
+			printf("ERROR: log ring fdt fixup failed: %s\n",
+			       fdt_strerror(fdt_ret));
+			goto err;
+		}
+	}
 
 	/* Delete the old LMB reservation */
 	if (lmb)
@@ -591,6 +612,7 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 
 	return 0;
 err:
+	fdt_fixup_session_end();
 	printf(" - must RESET the board to recover.\n\n");
 
 	return ret;
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Lazily loaded FIT images
+ *
+ * Only the FDT part of such a FIT is in memory. The data of subimages with
+ * a data-offset or data-position is read from the source the first time it
+ * is asked for, either straight to the load address that fit_image_load()
+ * chose for it or into a buffer on the heap. Subimages that no one looks at
+ * are never read.
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+
+#define FIT_LAZY_IMAGES_MAX	32
+
+struct fit_lazy_image {
+	int noffset;
+	void *buf;
+	size_t size;
+	bool alloc;		/* @buf is on the heap */
+	bool valid;		/* @buf holds the data */
+};
+
+static struct fit_lazy {
+	struct fit_lazy_src *src;
+	const void *fit;
+	struct fdt_header hdr;	/* to notice that @fit was overwritten */
+	int count;
+	struct fit_lazy_image image[FIT_LAZY_IMAGES_MAX];
+} lazy;
+
+static void fit_lazy_reset(void)
+{
+	int i;
+
+	for (i = 0; i < lazy.count; i++) {
+		if (lazy.image[i].alloc)
+			free(lazy.image[i].buf);
+	}
+	lazy.count = 0;
+	lazy.src = NULL;
+	lazy.fit = NULL;
+}
+
+int fit_lazy_open(struct fit_lazy_src *src, void *buf)
+{
+	int ret;
+
+	fit_lazy_reset();
+
+	ret = src->read(src, 0, sizeof(struct fdt_header), buf);
+	if (ret)
+		return ret;
+	if (fdt_check_header(buf)) {
+		puts("Bad FIT header\n");
+		return -ENOEXEC;
+	}
+	ret = src->read(src, 0, fdt_totalsize(buf), buf);
+	if (ret)
+		return ret;
+	if (!fit_check_format(buf)) {
+		puts("Bad FIT format\n");
+		return -ENOEXEC;
+	}
+
+	lazy.src = src;
+	lazy.fit = buf;
+	memcpy(&lazy.hdr, buf, sizeof(lazy.hdr));
+
+	return 0;
+}
+
+bool fit_is_lazy(const void *fit)
+{
+	return lazy.src && fit == lazy.fit &&
+	       !memcmp(fit, &lazy.hdr, sizeof(lazy.hdr));
+}
+
+static struct fit_lazy_image *fit_lazy_find(int noffset)
+{
+	struct fit_lazy_image *img;
+	int i;
+
+	for (i = 0; i < lazy.count; i++) {
+		if (lazy.image[i].noffset == noffset)
+			return &lazy.image[i];
+	}
+	if (lazy.count == FIT_LAZY_IMAGES_MAX)
+		return NULL;
+
+	img = &lazy.image[lazy.count++];
+	memset(img, '\0', sizeof(*img));
+	img->noffset = noffset;
+
+	return img;
+}
+
+void fit_lazy_set_dest(const void *fit, int noffset, void *dst)
+{
+	struct fit_lazy_image *img;
+
+	if (!fit_is_lazy(fit))
+		return;
+	img = fit_lazy_find(noffset);
+	if (!img || img->buf == dst)
+		return;
+
+	if (img->alloc)
+		free(img->buf);
+	img->buf = dst;
+	img->alloc = false;
+	img->valid = false;
+}
+
+int fit_lazy_get_data(const void *fit, int noffset, ulong offset, size_t size,
+		      const void **datap)
+{
+	const void *fit_end = fit + fdt_totalsize(fit);
+	struct fit_lazy_image *img;
+	int ret;
+
+	img = fit_lazy_find(noffset);
+	if (!img)
+		return -ENOSPC;
+	if (img->valid && img->size == size) {
+		*datap = img->buf;
+		return 0;
+	}
+
+	/* Never read over the FDT, whatever the load address is */
+	if (img->buf && !img->alloc &&
+	    img->buf < fit_end && img->buf + size > fit) {
+		printf("Not reading %s over the FIT\n",
+		       fit_get_name(fit, noffset, NULL));
+		img->buf = NULL;
+	}
+	if (!img->buf || (img->alloc && img->size != size)) {
+		if (img->alloc)
+			free(img->buf);
+		img->buf = memalign(ARCH_DMA_MINALIGN, size);
+		img->alloc = true;
+		if (!img->buf) {
+			printf("No memory for %s (%zu bytes)\n",
+			       fit_get_name(fit, noffset, NULL), size);
+			img->alloc = false;
+			return -ENOMEM;
+		}
+	}
+
+	debug("%s: %s: %zu bytes at %#lx to %p\n", __func__,
+	      fit_get_name(fit, noffset, NULL), size, offset, img->buf);
+	ret = lazy.src->read(lazy.src, offset, size, img->buf);
+	if (ret) {
+		printf("Can't read %s: %d\n", fit_get_name(fit, noffset, NULL),
+		       ret);
+		return ret;
+	}
+	img->size = size;
+	img->valid = true;
+	*datap = img->buf;
+
+	return 0;
+}
@@ -16,9 +16,18 @@
 #include <linux/kconfig.h>
 #include <common.h>
 #include <errno.h>
+#include <hw_aes.h>
+#include <hw_sha.h>
 #include <mapmem.h>
 #include <asm/io.h>
 #include <malloc.h>
+#include <watchdog.h>
+#include <dm.h>
+#include <tpm-v2.h>
+#include <u-boot/hash.h>
+#ifdef CONFIG_ASPEED_SMP_JOBS
+#include <asm/arch/smp.h>
+#endif
 DECLARE_GLOBAL_DATA_PTR;
 #endif /* !USE_HOSTCC*/
 
@@ -985,6 +994,13 @@ int fit_image_get_data_and_size(const void *fit, int noffset,
 	if (external_data) {
 		debug("External Data\n");
 		ret = fit_image_get_data_size(fit, noffset, &len);
+#if IMAGE_ENABLE_FIT_LAZY
+		if (!ret && fit_is_lazy(fit)) {
+			*size = len;
+			return fit_lazy_get_data(fit, noffset, offset, len,
+						 data);
+		}
+#endif
 		if (!ret) {
 			*data = fit + offset;
 			*size = len;
@@ -1145,14 +1161,39 @@ int calculate_hash(const void *data, int data_len, const char *algo_name,
 		return -1;
 	}
 
+#if defined(CONFIG_SHA_HW_SG) && !defined(USE_HOSTCC)
+	{
+		struct image_region region = { .data = data, .size = data_len };
+		int ret;
+
+		ret = hw_sha_digest_sg(algo, &region, 1, value,
+				       algo->digest_size);
+		if (!ret) {
+			*value_len = algo->digest_size;
+			return 0;
+		} else if (ret != -EINVAL) {
+			return -1;
+		}
+	}
+#endif
+
 	algo->hash_func_ws(data, data_len, value, algo->chunk_size);
 	*value_len = algo->digest_size;
 
 	return 0;
 }
 
+/* A digest computed ahead of fit_image_check_hash(), see fit_verify_run() */
+struct fit_hash_result {
+	int noffset;		/* hash node */
+	int ret;
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int value_len;
+};
+
 static int fit_image_check_hash(const void *fit, int noffset, const void *data,
-				size_t size, char **err_msgp)
+				size_t size, const struct fit_hash_result *res,
+				char **err_msgp)
 {
 	uint8_t value[FIT_MAX_HASH_LEN];
 	int value_len;
@@ -1183,7 +1224,14 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	if (res) {
+		if (res->ret) {
+			*err_msgp = "Hash calculation failed";
+			return -1;
+		}
+		memcpy(value, res->value, res->value_len);
+		value_len = res->value_len;
+	} else if (calculate_hash(data, size, algo, value, &value_len)) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
 	}
@@ -1196,11 +1244,39 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
+#if !defined(USE_HOSTCC) && CONFIG_IS_ENABLED(MEASURED_BOOT)
+	/* Measure the digest just verified rather than hashing again */
+	if (!strcmp(algo, "sha256") &&
+	    tpm2_measure(CONFIG_MEASURED_BOOT_PCR, value)) {
+		*err_msgp = "Can't extend PCR";
+		return -1;
+	}
+#endif
+
 	return 0;
 }
 
-int fit_image_verify_with_data(const void *fit, int image_noffset,
-			       const void *data, size_t size)
+static const struct fit_hash_result *
+fit_hash_result_find(const struct fit_hash_result *res, int count, int noffset)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (res[i].noffset == noffset)
+			return &res[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Hash nodes with an entry in @res are checked against the digest found
+ * there instead of computing it again
+ */
+static int fit_image_verify_results(const void *fit, int image_noffset,
+				    const void *data, size_t size,
+				    const struct fit_hash_result *res,
+				    int res_count)
 {
 	int		noffset = 0;
 	char		*err_msg = "";
@@ -1227,6 +1303,8 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 		if (!strncmp(name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
 			if (fit_image_check_hash(fit, noffset, data, size,
+						 fit_hash_result_find(res,
+							res_count, noffset),
 						 &err_msg))
 				goto error;
 			puts("+ ");
@@ -1263,176 +1341,941 @@ error:
 	return 0;
 }
 
-/**
- * fit_image_verify - verify data integrity
- * @fit: pointer to the FIT format image header
- * @image_noffset: component image node offset
- *
- * fit_image_verify() goes over component image hash nodes,
- * re-calculates each data hash and compares with the value stored in hash
- * node.
- *
- * returns:
- *     1, if all hashes are valid
- *     0, otherwise (or on error)
+int fit_image_verify_with_data(const void *fit, int image_noffset,
+			       const void *data, size_t size)
+{
+	return fit_image_verify_results(fit, image_noffset, data, size,
+					NULL, 0);
+}
+
+#if !defined(USE_HOSTCC) && \
+	(defined(CONFIG_FIT_PIPELINED_LOAD) || IMAGE_ENABLE_DECRYPT)
+/* The first hash node of an image that can be computed progressively */
+static int fit_image_prog_hash_node(const void *fit, int image_noffset,
+				    struct hash_algo **algop)
+{
+	char *algo_name;
+	int noffset;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (fit_image_hash_get_algo(fit, noffset, &algo_name))
+			continue;
+		if (!hash_progressive_lookup_algo(algo_name, algop))
+			return noffset;
+	}
+
+	return -ENOENT;
+}
+
+/*
+ * fit_image_pipelined_load() - check whether fit_image_load() will copy the
+ * image to a load address, so that its hashes can be checked during the copy
  */
-int fit_image_verify(const void *fit, int image_noffset)
+static bool fit_image_pipelined_load(const void *fit, int noffset,
+				     enum fit_load_op load_op)
 {
-	const void	*data;
-	size_t		size;
-	int		noffset = 0;
-	char		*err_msg = "";
+	ulong load;
+	int sub;
 
-	/* Get image data and data length */
-	if (fit_image_get_data_and_size(fit, image_noffset, &data, &size)) {
-		err_msg = "Can't get image data/size";
-		printf("error!\n%s for '%s' hash node in '%s' image node\n",
-		       err_msg, fit_get_name(fit, noffset, NULL),
-		       fit_get_name(fit, image_noffset, NULL));
-		return 0;
+	if (load_op == FIT_LOAD_IGNORED || fit_image_get_load(fit, noffset, &load))
+		return false;
+	if (load_op == FIT_LOAD_OPTIONAL_NON_ZERO && !load)
+		return false;
+
+	/* Image signatures are reported per node in fit_image_verify() */
+	fdt_for_each_subnode(sub, fit, noffset) {
+		if (!strncmp(fit_get_name(fit, sub, NULL), FIT_SIG_NODENAME,
+			     strlen(FIT_SIG_NODENAME)))
+			return false;
 	}
 
-	return fit_image_verify_with_data(fit, image_noffset, data, size);
+	return true;
 }
+#endif
 
+#if !defined(USE_HOSTCC) && defined(CONFIG_FIT_PIPELINED_LOAD)
 /**
- * fit_all_image_verify - verify data integrity for all images
+ * fit_image_copy_verify - copy image data and verify its hashes on the way
  * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ * @dst: destination of the copy, i.e. the image load address
+ * @src: image data inside the FIT
+ * @size: image data size
  *
- * fit_all_image_verify() goes over all images in the FIT and
- * for every images checks if all it's hashes are valid.
+ * The data is copied in CONFIG_FIT_PIPELINED_LOAD_CHUNK sized pieces and
+ * each piece is fed to the first hash node's algorithm once it has landed
+ * at @dst. With an asynchronous hash engine the copy of the next piece
+ * overlaps the hashing of the current one. Any further hash nodes and
+ * required image signatures are then checked against @dst.
+ *
+ * @dst and @src must not overlap.
  *
  * returns:
- *     1, if all hashes of all images are valid
- *     0, otherwise (or on error)
+ *     0, if all hashes are valid
+ *     -EACCES otherwise
  */
-int fit_all_image_verify(const void *fit)
+int fit_image_copy_verify(const void *fit, int image_noffset, void *dst,
+			  const void *src, size_t size)
 {
-	int images_noffset;
+	int (*update)(struct hash_algo *algo, void *ctx, const void *buf,
+		      unsigned int size, int is_last);
+	uint8_t value[FIT_MAX_HASH_LEN];
+	struct hash_algo *algo = NULL;
+	int hash_noffset = -1;
+	uint8_t *fit_value;
+	int fit_value_len;
+	char *err_msg = "";
+	int verify_all = 1;
+	size_t off, chunk;
 	int noffset;
-	int ndepth;
-	int count;
+	void *ctx;
 
-	/* Find images parent node offset */
-	images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
-	if (images_noffset < 0) {
-		printf("Can't find images parent node '%s' (%s)\n",
-		       FIT_IMAGES_PATH, fdt_strerror(images_noffset));
-		return 0;
+	hash_noffset = fit_image_prog_hash_node(fit, image_noffset, &algo);
+	if (hash_noffset < 0) {
+		memcpy(dst, src, size);
+		return fit_image_verify_with_data(fit, image_noffset, dst,
+						  size) ? 0 : -EACCES;
 	}
 
-	/* Process all image subnodes, check hashes for each */
-	printf("## Checking hash(es) for FIT Image at %08lx ...\n",
-	       (ulong)fit);
-	for (ndepth = 0, count = 0,
-	     noffset = fdt_next_node(fit, images_noffset, &ndepth);
-			(noffset >= 0) && (ndepth > 0);
-			noffset = fdt_next_node(fit, noffset, &ndepth)) {
-		if (ndepth == 1) {
-			/*
-			 * Direct child node of the images parent node,
-			 * i.e. component image node.
-			 */
-			printf("   Hash(es) for Image %u (%s): ", count,
-			       fit_get_name(fit, noffset, NULL));
-			count++;
+	if (fit_image_hash_get_value(fit, hash_noffset, &fit_value,
+				     &fit_value_len)) {
+		err_msg = "Can't get hash value property";
+		goto error;
+	}
 
-			if (!fit_image_verify(fit, noffset))
-				return 0;
-			printf("\n");
+	update = algo->hash_update;
+#ifdef CONFIG_SHA_HW_ASYNC
+	if (update == hw_sha_update)
+		update = hw_sha_update_async;
+#endif
+
+	printf("%s", algo->name);
+	if (algo->hash_init(algo, &ctx)) {
+		err_msg = "Can't start hash";
+		goto error;
+	}
+
+	for (off = 0; off < size; off += chunk) {
+		chunk = min_t(size_t, size - off,
+			      CONFIG_FIT_PIPELINED_LOAD_CHUNK);
+		memcpy(dst + off, src + off, chunk);
+		if (update(algo, ctx, dst + off, chunk, off + chunk == size)) {
+			err_msg = "Hash update failed";
+			goto error;
 		}
+		WATCHDOG_RESET();
 	}
-	return 1;
+
+	if (algo->hash_finish(algo, ctx, value, sizeof(value))) {
+		err_msg = "Hash finish failed";
+		goto error;
+	}
+
+	if (algo->digest_size != fit_value_len) {
+		err_msg = "Bad hash value len";
+		goto error;
+	} else if (memcmp(value, fit_value, fit_value_len) != 0) {
+		err_msg = "Bad hash value";
+		goto error;
+	}
+	puts("+ ");
+
+	/* Check the remaining hash nodes on the copy */
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (noffset == hash_noffset ||
+		    strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (fit_image_check_hash(fit, noffset, dst, size, NULL,
+					 &err_msg))
+			goto error;
+		puts("+ ");
+	}
+
+	if (IMAGE_ENABLE_VERIFY &&
+	    fit_image_verify_required_sigs(fit, image_noffset, dst, size,
+					   gd_fdt_blob(), &verify_all)) {
+		err_msg = "Unable to verify required signature";
+		goto error;
+	}
+
+	return 0;
+
+error:
+	printf(" error!\n%s for '%s' hash node in '%s' image node\n",
+	       err_msg, hash_noffset < 0 ? "" :
+	       fit_get_name(fit, hash_noffset, NULL),
+	       fit_get_name(fit, image_noffset, NULL));
+	return -EACCES;
 }
+#endif
 
-/**
- * fit_image_check_os - check whether image node is of a given os type
- * @fit: pointer to the FIT format image header
- * @noffset: component image node offset
- * @os: requested image os
- *
- * fit_image_check_os() reads image os property and compares its numeric
- * id with the requested os. Comparison result is returned to the caller.
- *
- * returns:
- *     1 if image is of given os type
- *     0 otherwise (or on error)
- */
-int fit_image_check_os(const void *fit, int noffset, uint8_t os)
+#if !defined(USE_HOSTCC) && IMAGE_ENABLE_DECRYPT
+#define FIT_CIPHER_CHUNK	0x100000
+
+/* Decrypt the partial block at the end of a CTR stream */
+static int fit_cipher_decrypt_tail(struct fit_cipher *c, void *buf,
+				   size_t len)
 {
-	uint8_t image_os;
+	u8 *block;
+	int ret;
 
-	if (fit_image_get_os(fit, noffset, &image_os))
-		return 0;
-	return (os == image_os);
+	block = memalign(ARCH_DMA_MINALIGN, HW_AES_BLOCK_SIZE);
+	if (!block)
+		return -ENOMEM;
+	memset(block, '\0', HW_AES_BLOCK_SIZE);
+	memcpy(block, buf, len);
+	ret = fit_cipher_decrypt(c, block, block, HW_AES_BLOCK_SIZE);
+	if (!ret)
+		ret = fit_cipher_finish(c);
+	else
+		fit_cipher_finish(c);
+	if (!ret)
+		memcpy(buf, block, len);
+	free(block);
+
+	return ret;
 }
 
 /**
- * fit_image_check_arch - check whether image node is of a given arch
+ * fit_image_decrypt_copy - copy a ciphered image and decrypt it in place
  * @fit: pointer to the FIT format image header
- * @noffset: component image node offset
- * @arch: requested imagearch
+ * @image_noffset: component image node offset
+ * @dst: destination, which must hold @size bytes
+ * @src: ciphertext inside the FIT
+ * @size: ciphertext size
+ * @verify: check the image hashes and signatures on the way
+ * @lenp: returns the size of the plain data
  *
- * fit_image_check_arch() reads image arch property and compares its numeric
- * id with the requested arch. Comparison result is returned to the caller.
+ * The ciphertext is copied in FIT_CIPHER_CHUNK sized pieces. Each piece is
+ * fed to the first hash node's algorithm once it has landed at @dst and is
+ * decrypted in place after that, so with asynchronous engines the copy of
+ * one piece, the hashing of the previous one and the decryption of the one
+ * before run at the same time. The hashes and signatures of the image cover
+ * the ciphertext; any further hash nodes are checked against @src.
+ *
+ * @dst and @src must not overlap. Nothing is left at @dst on error.
  *
  * returns:
- *     1 if image is of given arch
- *     0 otherwise (or on error)
+ *     0, if ok
+ *     -EACCES if a hash or signature is bad
+ *     other -ve value if the image could not be decrypted
  */
-int fit_image_check_arch(const void *fit, int noffset, uint8_t arch)
+int fit_image_decrypt_copy(const void *fit, int image_noffset, void *dst,
+			   const void *src, size_t size, bool verify,
+			   size_t *lenp)
 {
-	uint8_t image_arch;
-	int aarch32_support = 0;
+	int (*update)(struct hash_algo *algo, void *ctx, const void *buf,
+		      unsigned int size, int is_last);
+	struct fit_hash_result res = { .noffset = -1 };
+	struct hash_algo *algo = NULL;
+	size_t off, chunk, prev, body;
+	struct fit_cipher *c;
+	void *ctx = NULL;
+	size_t plain;
+	int ret;
 
-#ifdef CONFIG_ARM64_SUPPORT_AARCH32
-	aarch32_support = 1;
+	ret = fit_image_cipher_init(fit, image_noffset, &c, &plain);
+	if (ret)
+		return ret;
+
+	if (verify) {
+		res.noffset = fit_image_prog_hash_node(fit, image_noffset,
+						       &algo);
+		if (res.noffset < 0 &&
+		    !fit_image_verify_with_data(fit, image_noffset, src, size)) {
+			fit_cipher_finish(c);
+			return -EACCES;
+		}
+	}
+	if (res.noffset >= 0) {
+		update = algo->hash_update;
+#ifdef CONFIG_SHA_HW_ASYNC
+		if (update == hw_sha_update)
+			update = hw_sha_update_async;
 #endif
+		if (algo->hash_init(algo, &ctx)) {
+			ctx = NULL;
+			res.ret = -EIO;
+		}
+	}
 
-	if (fit_image_get_arch(fit, noffset, &image_arch))
-		return 0;
-	return (arch == image_arch) ||
-		(arch == IH_ARCH_I386 && image_arch == IH_ARCH_X86_64) ||
-		(arch == IH_ARCH_ARM64 && image_arch == IH_ARCH_ARM &&
-		 aarch32_support);
+	/* Only a CTR stream can end in a partial block */
+	body = rounddown(size, HW_AES_BLOCK_SIZE);
+	for (off = 0, prev = 0; off < size; off += chunk) {
+		chunk = min_t(size_t, size - off, FIT_CIPHER_CHUNK);
+		memcpy(dst + off, src + off, chunk);
+		if (ctx && update(algo, ctx, dst + off, chunk,
+				  off + chunk == size)) {
+			/* The algorithm has freed the context */
+			ctx = NULL;
+			res.ret = -EIO;
+		}
+		/* The previous piece has been hashed by now */
+		if (off && !ret)
+			ret = fit_cipher_decrypt(c, dst + prev, dst + prev,
+						 off - prev);
+		prev = off;
+		WATCHDOG_RESET();
+	}
+	if (ctx) {
+		res.ret = algo->hash_finish(algo, ctx, res.value,
+					    sizeof(res.value));
+		res.value_len = algo->digest_size;
+	}
+	if (!ret && body > prev)
+		ret = fit_cipher_decrypt(c, dst + prev, dst + prev, body - prev);
+	if (ret) {
+		fit_cipher_finish(c);
+	} else if (size > body) {
+		ret = fit_cipher_decrypt_tail(c, dst + body, size - body);
+	} else {
+		ret = fit_cipher_finish(c);
+	}
+	if (ret) {
+		debug("%s: decryption failed: %d\n", __func__, ret);
+		goto err;
+	}
+
+	if (res.noffset >= 0 &&
+	    !fit_image_verify_results(fit, image_noffset, src, size, &res, 1)) {
+		ret = -EACCES;
+		goto err;
+	}
+	*lenp = plain;
+
+	return 0;
+
+err:
+	memset(dst, '\0', size);
+	return ret;
 }
+#endif
 
-/**
- * fit_image_check_type - check whether image node is of a given type
- * @fit: pointer to the FIT format image header
- * @noffset: component image node offset
- * @type: requested image type
- *
- * fit_image_check_type() reads image type property and compares its numeric
- * id with the requested type. Comparison result is returned to the caller.
- *
- * returns:
- *     1 if image is of given type
- *     0 otherwise (or on error)
- */
-int fit_image_check_type(const void *fit, int noffset, uint8_t type)
+static int fit_image_verify_res(const void *fit, int image_noffset,
+				const struct fit_hash_result *res, int res_count)
 {
-	uint8_t image_type;
+	const void	*data;
+	size_t		size;
+	int		noffset = 0;
+	char		*err_msg = "";
 
-	if (fit_image_get_type(fit, noffset, &image_type))
+	/* Get image data and data length */
+	if (fit_image_get_data_and_size(fit, image_noffset, &data, &size)) {
+		err_msg = "Can't get image data/size";
+		printf("error!\n%s for '%s' hash node in '%s' image node\n",
+		       err_msg, fit_get_name(fit, noffset, NULL),
+		       fit_get_name(fit, image_noffset, NULL));
 		return 0;
-	return (type == image_type);
+	}
+
+	return fit_image_verify_results(fit, image_noffset, data, size,
+					res, res_count);
 }
 
 /**
- * fit_image_check_comp - check whether image node uses given compression
+ * fit_image_verify - verify data integrity
  * @fit: pointer to the FIT format image header
- * @noffset: component image node offset
- * @comp: requested image compression type
+ * @image_noffset: component image node offset
  *
- * fit_image_check_comp() reads image compression property and compares its
- * numeric id with the requested compression type. Comparison result is
- * returned to the caller.
+ * fit_image_verify() goes over component image hash nodes,
+ * re-calculates each data hash and compares with the value stored in hash
+ * node.
  *
  * returns:
- *     1 if image uses requested compression
- *     0 otherwise (or on error)
- */
+ *     1, if all hashes are valid
+ *     0, otherwise (or on error)
+ */
+int fit_image_verify(const void *fit, int image_noffset)
+{
+	return fit_image_verify_res(fit, image_noffset, NULL, 0);
+}
+
+#if IMAGE_ENABLE_FIT_PARALLEL_VERIFY
+/* Hash nodes scheduled together; any further ones are checked as usual */
+#define FIT_VERIFY_JOBS_MAX	16
+
+enum {
+	FIT_JOB_NEW,
+	FIT_JOB_ENGINE,		/* submitted to the hash engine */
+	FIT_JOB_SMP,		/* running on the secondary core */
+	FIT_JOB_CPU,		/* only used to pick jobs for this core */
+	FIT_JOB_DONE,
+};
+
+/*
+ * Software digests for either core: none of them uses malloc, the console,
+ * the watchdog or a hash engine
+ */
+struct fit_sw_algo {
+	const char *name;
+	void (*digest)(const void *data, size_t size, uint8_t *value);
+};
+
+struct fit_verify_job {
+	const char *algo;
+	int digest_size;
+	const void *data;
+	size_t size;
+	int state;
+	struct udevice *dev;	/* asynchronous engine for @algo, or NULL */
+	void *ctx;
+	const struct fit_sw_algo *sw;
+	int smp_job;
+	struct fit_hash_result *res;
+};
+
+struct fit_verify {
+	int count;
+	struct fit_verify_job job[FIT_VERIFY_JOBS_MAX];
+	struct fit_hash_result res[FIT_VERIFY_JOBS_MAX];
+};
+
+static void fit_sw_crc32(const void *data, size_t size, uint8_t *value)
+{
+	uint32_t crc = cpu_to_be32(crc32(0, data, size));
+
+	memcpy(value, &crc, sizeof(crc));
+}
+
+#ifdef CONFIG_MD5
+static void fit_sw_md5(const void *data, size_t size, uint8_t *value)
+{
+	md5((unsigned char *)data, size, value);
+}
+#endif
+
+#ifdef CONFIG_SHA1
+static void fit_sw_sha1(const void *data, size_t size, uint8_t *value)
+{
+	sha1_context ctx;
+
+	sha1_starts(&ctx);
+	sha1_update(&ctx, data, size);
+	sha1_finish(&ctx, value);
+}
+#endif
+
+#ifdef CONFIG_SHA256
+static void fit_sw_sha256(const void *data, size_t size, uint8_t *value)
+{
+	sha256_context ctx;
+
+	sha256_starts(&ctx);
+	sha256_update(&ctx, data, size);
+	sha256_finish(&ctx, value);
+}
+#endif
+
+#ifdef CONFIG_SHA384
+static void fit_sw_sha384(const void *data, size_t size, uint8_t *value)
+{
+	sha512_context ctx;
+
+	sha384_starts(&ctx);
+	sha384_update(&ctx, data, size);
+	sha384_finish(&ctx, value);
+}
+#endif
+
+#ifdef CONFIG_SHA512
+static void fit_sw_sha512(const void *data, size_t size, uint8_t *value)
+{
+	sha512_context ctx;
+
+	sha512_starts(&ctx);
+	sha512_update(&ctx, data, size);
+	sha512_finish(&ctx, value);
+}
+#endif
+
+static const struct fit_sw_algo fit_sw_algos[] = {
+	{ "crc32", fit_sw_crc32 },
+#ifdef CONFIG_MD5
+	{ "md5", fit_sw_md5 },
+#endif
+#ifdef CONFIG_SHA1
+	{ "sha1", fit_sw_sha1 },
+#endif
+#ifdef CONFIG_SHA256
+	{ "sha256", fit_sw_sha256 },
+#endif
+#ifdef CONFIG_SHA384
+	{ "sha384", fit_sw_sha384 },
+#endif
+#ifdef CONFIG_SHA512
+	{ "sha512", fit_sw_sha512 },
+#endif
+};
+
+static const struct fit_sw_algo *fit_sw_algo_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(fit_sw_algos); i++) {
+		if (!strcmp(fit_sw_algos[i].name, name))
+			return &fit_sw_algos[i];
+	}
+
+	return NULL;
+}
+
+#ifdef CONFIG_ASPEED_SMP_JOBS
+/*
+ * The one digest the secondary core works on. This core does not touch
+ * it while the job runs, which is why it has cache lines of its own.
+ */
+struct fit_smp_work {
+	const struct fit_sw_algo *sw;
+	const void *data;
+	size_t size;
+	uint8_t value[FIT_MAX_HASH_LEN];
+} __aligned(ARCH_DMA_MINALIGN);
+
+static struct fit_smp_work fit_smp_work;
+
+static int fit_smp_digest(void *arg)
+{
+	struct fit_smp_work *w = arg;
+
+	w->sw->digest(w->data, w->size, w->value);
+
+	return 0;
+}
+#endif
+
+static int fit_verify_smp_start(struct fit_verify_job *job)
+{
+#ifdef CONFIG_ASPEED_SMP_JOBS
+	int ret;
+
+	fit_smp_work.sw = job->sw;
+	fit_smp_work.data = job->data;
+	fit_smp_work.size = job->size;
+	ret = aspeed_smp_job_submit(fit_smp_digest, &fit_smp_work);
+	if (ret < 0)
+		return ret;
+	job->smp_job = ret;
+	job->state = FIT_JOB_SMP;
+
+	return 0;
+#else
+	return -ENOSYS;
+#endif
+}
+
+static bool fit_verify_smp_done(struct fit_verify_job *job)
+{
+#ifdef CONFIG_ASPEED_SMP_JOBS
+	if (!aspeed_smp_job_done(job->smp_job))
+		return false;
+
+	job->res->ret = aspeed_smp_job_wait(job->smp_job);
+	memcpy(job->res->value, fit_smp_work.value, job->digest_size);
+	job->res->value_len = job->digest_size;
+#endif
+	return true;
+}
+
+static int fit_verify_engine_start(struct fit_verify_job *job)
+{
+	int ret;
+
+	ret = hash_dev_init(job->dev, job->algo, &job->ctx);
+	if (ret)
+		return ret;
+
+	ret = hash_dev_submit(job->dev, job->ctx, job->data, job->size, 1);
+	if (ret) {
+		/* Only to free the context */
+		hash_dev_finish(job->dev, job->ctx, job->res->value,
+				sizeof(job->res->value));
+		return ret;
+	}
+	job->state = FIT_JOB_ENGINE;
+
+	return 0;
+}
+
+static bool fit_verify_engine_done(struct fit_verify_job *job)
+{
+	if (hash_dev_poll(job->dev, job->ctx) == -EBUSY)
+		return false;
+
+	/* This also returns any error of the update, and frees the context */
+	job->res->ret = hash_dev_finish(job->dev, job->ctx, job->res->value,
+					sizeof(job->res->value));
+	job->res->value_len = job->digest_size;
+
+	return true;
+}
+
+static void fit_verify_cpu_run(struct fit_verify_job *job)
+{
+	if (job->sw) {
+		job->sw->digest(job->data, job->size, job->res->value);
+		job->res->ret = 0;
+		job->res->value_len = job->digest_size;
+	} else {
+		job->res->ret = calculate_hash(job->data, job->size, job->algo,
+					       job->res->value,
+					       &job->res->value_len);
+	}
+}
+
+/*
+ * The engine takes the largest job left. The cores take the jobs it cannot
+ * do, smallest first; as software is much slower than the engine, the
+ * secondary core only helps out with engine jobs while there are at least
+ * two of them left.
+ */
+static struct fit_verify_job *fit_verify_pick(struct fit_verify *v,
+					      int where)
+{
+	struct fit_verify_job *best = NULL, *job;
+	int engine_left = 0;
+	int i;
+
+	for (i = 0; i < v->count; i++) {
+		job = &v->job[i];
+		if (job->state != FIT_JOB_NEW)
+			continue;
+		if (job->dev)
+			engine_left++;
+
+		if (where == FIT_JOB_ENGINE) {
+			if (job->dev && (!best || job->size > best->size))
+				best = job;
+			continue;
+		}
+		if ((where == FIT_JOB_SMP && !job->sw) ||
+		    (where == FIT_JOB_CPU && job->dev))
+			continue;
+		if (!best || (best->dev && !job->dev) ||
+		    (!best->dev == !job->dev && job->size < best->size))
+			best = job;
+	}
+
+	if (where == FIT_JOB_SMP && best && best->dev && engine_left < 2)
+		return NULL;
+
+	return best;
+}
+
+/**
+ * fit_verify_alloc() - start collecting hash nodes to be computed at once
+ *
+ * returns:
+ *     the new set, or NULL without memory; the images are then verified
+ *     one after the other
+ */
+static struct fit_verify *fit_verify_alloc(void)
+{
+	return calloc(1, sizeof(struct fit_verify));
+}
+
+/**
+ * fit_verify_add_image() - add the hash nodes of an image to a set
+ * @v: set from fit_verify_alloc(), may be NULL
+ * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ *
+ * Nodes which cannot be scheduled are left out and later checked by
+ * fit_image_verify_res() as usual; so are all errors.
+ */
+static void fit_verify_add_image(struct fit_verify *v, const void *fit,
+				 int image_noffset)
+{
+	struct fit_verify_job *job;
+	struct hash_algo *algo;
+	struct udevice *dev;
+	const void *data;
+	char *algo_name;
+	size_t size;
+	int noffset;
+	int ignore;
+
+	if (!v || fit_image_get_data_and_size(fit, image_noffset, &data,
+					      &size))
+		return;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (v->count == FIT_VERIFY_JOBS_MAX)
+			break;
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (fit_image_hash_get_algo(fit, noffset, &algo_name) ||
+		    hash_lookup_algo(algo_name, &algo))
+			continue;
+		if (IMAGE_ENABLE_IGNORE) {
+			fit_image_hash_get_ignore(fit, noffset, &ignore);
+			if (ignore)
+				continue;
+		}
+
+		job = &v->job[v->count];
+		job->res = &v->res[v->count];
+		job->res->noffset = noffset;
+		job->algo = algo_name;
+		job->digest_size = algo->digest_size;
+		job->data = data;
+		job->size = size;
+		job->sw = fit_sw_algo_find(algo_name);
+		/* A blocking device is no better than calculate_hash() */
+		if (!hash_get_device(algo_name, &dev) &&
+		    hash_get_ops(dev)->submit)
+			job->dev = dev;
+		v->count++;
+	}
+}
+
+/**
+ * fit_verify_run() - compute the digests of all hash nodes of a set
+ * @v: set from fit_verify_alloc(), may be NULL
+ *
+ * The hash engine, the secondary core (with CONFIG_ASPEED_SMP_JOBS) and
+ * this core each work on a different image, so the time taken is about
+ * that of the largest image rather than that of all of them. This only
+ * returns once every digest is in, failed or not; they are compared by
+ * fit_image_verify_res().
+ */
+static void fit_verify_run(struct fit_verify *v)
+{
+	struct fit_verify_job *engine = NULL, *smp = NULL, *job;
+	bool smp_ok = IS_ENABLED(CONFIG_ASPEED_SMP_JOBS);
+	int left = v ? v->count : 0;
+
+	while (left) {
+		if (!engine) {
+			engine = fit_verify_pick(v, FIT_JOB_ENGINE);
+			if (engine && fit_verify_engine_start(engine)) {
+				/* Leave it to the cores */
+				engine->dev = NULL;
+				engine = NULL;
+				continue;
+			}
+		}
+		if (!smp && smp_ok) {
+			smp = fit_verify_pick(v, FIT_JOB_SMP);
+			if (smp && fit_verify_smp_start(smp)) {
+				smp_ok = false;
+				smp = NULL;
+			}
+		}
+
+		if (engine && fit_verify_engine_done(engine)) {
+			engine->state = FIT_JOB_DONE;
+			engine = NULL;
+			left--;
+		}
+		if (smp && fit_verify_smp_done(smp)) {
+			smp->state = FIT_JOB_DONE;
+			smp = NULL;
+			left--;
+		}
+
+		job = fit_verify_pick(v, FIT_JOB_CPU);
+		if (job) {
+			fit_verify_cpu_run(job);
+			job->state = FIT_JOB_DONE;
+			left--;
+		}
+		WATCHDOG_RESET();
+	}
+}
+
+static int fit_image_verify_set(const void *fit, int image_noffset,
+				struct fit_verify *v)
+{
+	return fit_image_verify_res(fit, image_noffset, v ? v->res : NULL,
+				    v ? v->count : 0);
+}
+#else
+struct fit_verify;
+
+static inline struct fit_verify *fit_verify_alloc(void)
+{
+	return NULL;
+}
+
+static inline void fit_verify_add_image(struct fit_verify *v,
+					const void *fit, int image_noffset)
+{
+}
+
+static inline void fit_verify_run(struct fit_verify *v)
+{
+}
+
+static inline int fit_image_verify_set(const void *fit, int image_noffset,
+				       struct fit_verify *v)
+{
+	return fit_image_verify(fit, image_noffset);
+}
+#endif
+
+/**
+ * fit_all_image_verify - verify data integrity for all images
+ * @fit: pointer to the FIT format image header
+ *
+ * fit_all_image_verify() goes over all images in the FIT and
+ * for every images checks if all it's hashes are valid.
+ *
+ * returns:
+ *     1, if all hashes of all images are valid
+ *     0, otherwise (or on error)
+ */
+int fit_all_image_verify(const void *fit)
+{
+	struct fit_verify *v;
+	int images_noffset;
+	int noffset;
+	int ndepth;
+	int count;
+	int ret = 1;
+
+	/* Find images parent node offset */
+	images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images_noffset < 0) {
+		printf("Can't find images parent node '%s' (%s)\n",
+		       FIT_IMAGES_PATH, fdt_strerror(images_noffset));
+		return 0;
+	}
+
+	/* Compute all the digests first, in parallel where possible */
+	v = fit_verify_alloc();
+	if (v) {
+		fdt_for_each_subnode(noffset, fit, images_noffset)
+			fit_verify_add_image(v, fit, noffset);
+		fit_verify_run(v);
+	}
+
+	/* Process all image subnodes, check hashes for each */
+	printf("## Checking hash(es) for FIT Image at %08lx ...\n",
+	       (ulong)fit);
+	for (ndepth = 0, count = 0,
+	     noffset = fdt_next_node(fit, images_noffset, &ndepth);
+			(noffset >= 0) && (ndepth > 0);
+			noffset = fdt_next_node(fit, noffset, &ndepth)) {
+		if (ndepth == 1) {
+			/*
+			 * Direct child node of the images parent node,
+			 * i.e. component image node.
+			 */
+			printf("   Hash(es) for Image %u (%s): ", count,
+			       fit_get_name(fit, noffset, NULL));
+			count++;
+
+			if (!fit_image_verify_set(fit, noffset, v)) {
+				ret = 0;
+				break;
+			}
+			printf("\n");
+		}
+	}
+	free(v);
+
+	return ret;
+}
+
+/**
+ * fit_image_check_os - check whether image node is of a given os type
+ * @fit: pointer to the FIT format image header
+ * @noffset: component image node offset
+ * @os: requested image os
+ *
+ * fit_image_check_os() reads image os property and compares its numeric
+ * id with the requested os. Comparison result is returned to the caller.
+ *
+ * returns:
+ *     1 if image is of given os type
+ *     0 otherwise (or on error)
+ */
+int fit_image_check_os(const void *fit, int noffset, uint8_t os)
+{
+	uint8_t image_os;
+
+	if (fit_image_get_os(fit, noffset, &image_os))
+		return 0;
+	return (os == image_os);
+}
+
+/**
+ * fit_image_check_arch - check whether image node is of a given arch
+ * @fit: pointer to the FIT format image header
+ * @noffset: component image node offset
+ * @arch: requested imagearch
+ *
+ * fit_image_check_arch() reads image arch property and compares its numeric
+ * id with the requested arch. Comparison result is returned to the caller.
+ *
+ * returns:
+ *     1 if image is of given arch
+ *     0 otherwise (or on error)
+ */
+int fit_image_check_arch(const void *fit, int noffset, uint8_t arch)
+{
+	uint8_t image_arch;
+	int aarch32_support = 0;
+
+#ifdef CONFIG_ARM64_SUPPORT_AARCH32
+	aarch32_support = 1;
+#endif
+
+	if (fit_image_get_arch(fit, noffset, &image_arch))
+		return 0;
+	return (arch == image_arch) ||
+		(arch == IH_ARCH_I386 && image_arch == IH_ARCH_X86_64) ||
+		(arch == IH_ARCH_ARM64 && image_arch == IH_ARCH_ARM &&
+		 aarch32_support);
+}
+
+/**
+ * fit_image_check_type - check whether image node is of a given type
+ * @fit: pointer to the FIT format image header
+ * @noffset: component image node offset
+ * @type: requested image type
+ *
+ * fit_image_check_type() reads image type property and compares its numeric
+ * id with the requested type. Comparison result is returned to the caller.
+ *
+ * returns:
+ *     1 if image is of given type
+ *     0 otherwise (or on error)
+ */
+int fit_image_check_type(const void *fit, int noffset, uint8_t type)
+{
+	uint8_t image_type;
+
+	if (fit_image_get_type(fit, noffset, &image_type))
+		return 0;
+	return (type == image_type);
+}
+
+/**
+ * fit_image_check_comp - check whether image node uses given compression
+ * @fit: pointer to the FIT format image header
+ * @noffset: component image node offset
+ * @comp: requested image compression type
+ *
+ * fit_image_check_comp() reads image compression property and compares its
+ * numeric id with the requested compression type. Comparison result is
+ * returned to the caller.
+ *
+ * returns:
+ *     1 if image uses requested compression
+ *     0 otherwise (or on error)
+ */
 int fit_image_check_comp(const void *fit, int noffset, uint8_t comp)
 {
 	uint8_t image_comp;
@@ -1485,6 +2328,35 @@ int fit_check_format(const void *fit)
 }
 
 
+/* Find the fdt of a configuration, returning the offset of its root node */
+static int fit_conf_get_fdt(const void *fit, int images_noffset,
+			    int conf_noffset, const void **fdtp)
+{
+	const char *kfdt_name;
+	int kfdt_noffset;
+	size_t size;
+
+	kfdt_name = fdt_getprop(fit, conf_noffset, FIT_FDT_PROP, NULL);
+	if (!kfdt_name) {
+		debug("No fdt property found.\n");
+		return -ENOENT;
+	}
+	kfdt_noffset = fdt_subnode_offset(fit, images_noffset, kfdt_name);
+	if (kfdt_noffset < 0) {
+		debug("No image node named \"%s\" found.\n", kfdt_name);
+		return -ENOENT;
+	}
+	/*
+	 * Get a pointer to this configuration's fdt.
+	 */
+	if (fit_image_get_data(fit, kfdt_noffset, fdtp, &size)) {
+		debug("Failed to get fdt \"%s\".\n", kfdt_name);
+		return -ENOENT;
+	}
+
+	return 0;
+}
+
 /**
  * fit_conf_find_compat
  * @fit: pointer to the FIT format image header
@@ -1520,6 +2392,11 @@ int fit_check_format(const void *fit)
  * compatible list, "foo,bar", matches a compatible string in the root of fdt1.
  * "bim,bam" in fdt2 matches the second string which isn't as good as fdt1.
  *
+ * A configuration with a compatible property of its own is matched on that
+ * instead, without looking at its fdt; mkimage -I copies the fdt's list
+ * there. That is much quicker for a FIT of many configurations, and works
+ * for compressed fdts too.
+ *
  * returns:
  *     offset to the configuration to use if one was found
  *     -1 otherwise
@@ -1553,34 +2430,22 @@ int fit_conf_find_compat(const void *fit, const void *fdt)
 			(noffset >= 0) && (ndepth > 0);
 			noffset = fdt_next_node(fit, noffset, &ndepth)) {
 		const void *kfdt;
-		const char *kfdt_name;
-		int kfdt_noffset;
+		int compat_noffset;
 		const char *cur_fdt_compat;
 		int len;
-		size_t size;
 		int i;
 
 		if (ndepth > 1)
 			continue;
 
-		kfdt_name = fdt_getprop(fit, noffset, "fdt", &len);
-		if (!kfdt_name) {
-			debug("No fdt property found.\n");
-			continue;
-		}
-		kfdt_noffset = fdt_subnode_offset(fit, images_noffset,
-						  kfdt_name);
-		if (kfdt_noffset < 0) {
-			debug("No image node named \"%s\" found.\n",
-			      kfdt_name);
-			continue;
-		}
-		/*
-		 * Get a pointer to this configuration's fdt.
-		 */
-		if (fit_image_get_data(fit, kfdt_noffset, &kfdt, &size)) {
-			debug("Failed to get fdt \"%s\".\n", kfdt_name);
-			continue;
+		if (fdt_getprop(fit, noffset, FIT_COMPATIBLE_PROP, NULL)) {
+			kfdt = fit;
+			compat_noffset = noffset;
+		} else {
+			compat_noffset = fit_conf_get_fdt(fit, images_noffset,
+							  noffset, &kfdt);
+			if (compat_noffset < 0)
+				continue;
 		}
 
 		len = fdt_compat_len;
@@ -1593,7 +2458,7 @@ int fit_conf_find_compat(const void *fit, const void *fdt)
 		     (!best_match_offset || best_match_pos > i); i++) {
 			int cur_len = strlen(cur_fdt_compat) + 1;
 
-			if (!fdt_node_check_compatible(kfdt, 0,
+			if (!fdt_node_check_compatible(kfdt, compat_noffset,
 						       cur_fdt_compat)) {
 				best_match_offset = noffset;
 				best_match_pos = i;
@@ -1708,13 +2573,319 @@ int fit_conf_get_prop_node(const void *fit, int noffset,
 	return fit_conf_get_prop_node_index(fit, noffset, prop_name, 0);
 }
 
-static int fit_image_select(const void *fit, int rd_noffset, int verify)
+#if IMAGE_ENABLE_FIT_VERIFY_CACHE
+static bool fit_verified_find(bootm_headers_t *images, const void *fit,
+			      int noffset, const void *data, ulong size)
+{
+	struct fit_verified *v;
+	int i;
+
+	for (i = 0; i < images->fit_verified_count; i++) {
+		v = &images->fit_verified[i];
+		if (v->fit == fit && v->noffset == noffset &&
+		    v->data == data && v->size == size)
+			return true;
+	}
+
+	return false;
+}
+
+static void fit_verified_add(bootm_headers_t *images, const void *fit,
+			     int noffset, const void *data, ulong size)
+{
+	struct fit_verified *v;
+
+	/* Without a free entry it is only checked again next time */
+	if (images->fit_verified_count == FIT_VERIFIED_MAX)
+		return;
+
+	v = &images->fit_verified[images->fit_verified_count++];
+	v->fit = fit;
+	v->noffset = noffset;
+	v->data = data;
+	v->size = size;
+}
+
+/* Drop the entries whose data overlaps [start, start + len) */
+static void fit_verified_forget(bootm_headers_t *images, const void *start,
+				ulong len)
+{
+	struct fit_verified *v;
+	int i = 0;
+
+	while (i < images->fit_verified_count) {
+		v = &images->fit_verified[i];
+		if (v->data < start + len && start < v->data + v->size)
+			*v = images->fit_verified[--images->fit_verified_count];
+		else
+			i++;
+	}
+}
+
+static bool fit_image_verified(bootm_headers_t *images, const void *fit,
+			       int noffset)
+{
+	const void *data;
+	size_t size;
+
+	if (fit_image_get_data_and_size(fit, noffset, &data, &size))
+		return false;
+
+	return fit_verified_find(images, fit, noffset, data, size);
+}
+
+static void fit_image_set_verified(bootm_headers_t *images, const void *fit,
+				   int noffset)
+{
+	const void *data;
+	size_t size;
+
+	if (!fit_image_get_data_and_size(fit, noffset, &data, &size))
+		fit_verified_add(images, fit, noffset, data, size);
+}
+
+/* The signature only covers the FIT structure, not external data */
+static int fit_config_verify_once(bootm_headers_t *images, const void *fit,
+				  int cfg_noffset)
+{
+	ulong size = fit_get_size(fit);
+	int ret;
+
+	if (fit_verified_find(images, fit, cfg_noffset, fit, size)) {
+		puts("(verified before) ");
+		return 0;
+	}
+
+	ret = fit_config_verify(fit, cfg_noffset);
+	if (!ret)
+		fit_verified_add(images, fit, cfg_noffset, fit, size);
+
+	return ret;
+}
+#else
+static inline bool fit_image_verified(bootm_headers_t *images,
+				      const void *fit, int noffset)
+{
+	return false;
+}
+
+static inline void fit_image_set_verified(bootm_headers_t *images,
+					  const void *fit, int noffset)
+{
+}
+
+static inline void fit_verified_forget(bootm_headers_t *images,
+				       const void *start, ulong len)
+{
+}
+
+static inline int fit_config_verify_once(bootm_headers_t *images,
+					 const void *fit, int cfg_noffset)
+{
+	return fit_config_verify(fit, cfg_noffset);
+}
+#endif
+
+#if !defined(USE_HOSTCC) && defined(CONFIG_LMB)
+#ifndef CONFIG_SYS_BOOTM_LEN
+#define CONFIG_SYS_BOOTM_LEN	0x800000
+#endif
+
+/*
+ * fit_image_needs_ram_copy() - check whether an image that is not copied
+ * to a load address must be copied to DRAM anyway, as it lies outside of it,
+ * e.g. in a memory-mapped flash window
+ */
+static bool fit_image_needs_ram_copy(const void *fit, int noffset,
+				     enum fit_load_op load_op)
+{
+	const void *buf;
+	size_t size;
+
+	if (load_op != FIT_LOAD_IGNORED ||
+	    (IMAGE_ENABLE_FIT_LAZY && fit_is_lazy(fit)) ||
+	    (IMAGE_ENABLE_DECRYPT && fit_image_has_cipher(fit, noffset)) ||
+	    fit_image_get_data_and_size(fit, noffset, &buf, &size))
+		return false;
+
+	return !boot_addr_in_ram(map_to_sysmem(buf), size);
+}
+
+/**
+ * fit_image_ram_copy() - copy an image out of a FIT that is not in DRAM
+ * @images: bootm state, whose LMB the copy is reserved in
+ * @fit: pointer to the FIT format image header
+ * @noffset: component image node offset
+ * @load_op: how fit_image_load() handles the load address
+ * @sizep: returns the size of the copy
+ *
+ * The FIT itself is parsed where it is; only the data of an image that
+ * would otherwise be used in place is copied, which is the kernel. The
+ * hashes are then checked on the copy, which the hash engine can reach.
+ * An uncompressed kernel goes straight to its load address, so that
+ * bootm_load_os() finds it there and does not move it again; anything else
+ * goes to free memory, clear of the kernel load area, from where it is
+ * decompressed. The FDT and ramdisk are moved out of the flash by
+ * boot_relocate_fdt() and boot_ramdisk_high().
+ *
+ * returns:
+ *     the address of the copy, or 0 if the image data is used in place
+ */
+static ulong fit_image_ram_copy(bootm_headers_t *images, const void *fit,
+				int noffset, enum fit_load_op load_op,
+				size_t *sizep)
+{
+	const void *buf;
+	ulong load, dst;
+	struct lmb lmb;
+	size_t size;
+
+	if (!fit_image_needs_ram_copy(fit, noffset, load_op) ||
+	    fit_image_get_data_and_size(fit, noffset, &buf, &size))
+		return 0;
+
+	if (fit_image_get_load(fit, noffset, &load) ||
+	    !boot_addr_in_ram(load, size)) {
+		dst = lmb_alloc(&images->lmb, size, ARCH_DMA_MINALIGN);
+	} else if (fit_image_check_type(fit, noffset, IH_TYPE_KERNEL) &&
+		   fit_image_check_comp(fit, noffset, IH_COMP_NONE) &&
+		   lmb_reserve(&images->lmb, load, size) >= 0) {
+		dst = load;
+	} else {
+		/* Not decompressed yet, so allow for the largest kernel */
+		lmb = images->lmb;
+		lmb_reserve(&lmb, load, CONFIG_SYS_BOOTM_LEN);
+		dst = lmb_alloc(&lmb, size, ARCH_DMA_MINALIGN);
+		if (dst)
+			lmb_reserve(&images->lmb, dst, size);
+	}
+	if (!dst) {
+		puts("   Can't copy the image to RAM, using it in place\n");
+		return 0;
+	}
+
+	printf("   Copying from 0x%08lx to 0x%08lx\n",
+	       (ulong)map_to_sysmem(buf), dst);
+	memmove_wd(map_sysmem(dst, size), (void *)buf, size, CHUNKSZ);
+	fit_verified_forget(images, map_sysmem(dst, size), size);
+	*sizep = size;
+
+	return dst;
+}
+#else
+static inline bool fit_image_needs_ram_copy(const void *fit, int noffset,
+					    enum fit_load_op load_op)
+{
+	return false;
+}
+
+static inline ulong fit_image_ram_copy(bootm_headers_t *images,
+				       const void *fit, int noffset,
+				       enum fit_load_op load_op,
+				       size_t *sizep)
+{
+	return 0;
+}
+#endif
+
+#if IMAGE_ENABLE_FIT_PARALLEL_VERIFY
+/**
+ * fit_config_images_verify() - verify all subimages of a configuration at once
+ * @images: bootm state, which records the subimages that pass
+ * @fit: pointer to the FIT format image header
+ * @cfg_noffset: configuration node offset
+ *
+ * Loading the subimages then finds them verified already. Subimages that
+ * were verified before are left out.
+ *
+ * returns:
+ *     0, if all hashes are valid or nothing was verified
+ *     -EACCES otherwise
+ */
+static int fit_config_images_verify(bootm_headers_t *images, const void *fit,
+				    int cfg_noffset)
+{
+	static const char * const props[] = {
+		FIT_KERNEL_PROP, FIT_FDT_PROP, FIT_RAMDISK_PROP,
+		FIT_LOADABLE_PROP, FIT_FPGA_PROP, FIT_SETUP_PROP,
+		FIT_FIRMWARE_PROP, FIT_STANDALONE_PROP,
+	};
+	int noffsets[FIT_VERIFIED_MAX];
+	struct fit_verify *v;
+	int noffset;
+	int count = 0;
+	int i, j, k, n;
+	int ret = 0;
+
+	/* These are read, and verified, one by one as they are loaded */
+	if (IMAGE_ENABLE_FIT_LAZY && fit_is_lazy(fit))
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(props); i++) {
+		n = fit_conf_get_prop_node_count(fit, cfg_noffset, props[i]);
+		for (j = 0; j < n && count < ARRAY_SIZE(noffsets); j++) {
+			noffset = fit_conf_get_prop_node_index(fit, cfg_noffset,
+							       props[i], j);
+			/* A kernel in flash is verified once copied to DRAM */
+			if (noffset < 0 ||
+			    fit_image_verified(images, fit, noffset) ||
+			    (i == 0 && fit_image_needs_ram_copy(fit, noffset,
+							FIT_LOAD_IGNORED)))
+				continue;
+			for (k = 0; k < count && noffsets[k] != noffset; k++)
+				;
+			if (k == count)
+				noffsets[count++] = noffset;
+		}
+	}
+
+	/* Nothing to overlap with a single subimage */
+	if (count < 2)
+		return 0;
+	v = fit_verify_alloc();
+	if (!v)
+		return 0;
+
+	for (i = 0; i < count; i++)
+		fit_verify_add_image(v, fit, noffsets[i]);
+	fit_verify_run(v);
+
+	printf("   Verifying Hash Integrity of %d subimages ... ", count);
+	for (i = 0; i < count; i++) {
+		if (!fit_image_verify_set(fit, noffsets[i], v)) {
+			ret = -EACCES;
+			break;
+		}
+	}
+	free(v);
+	if (ret)
+		return ret;
+	puts("OK\n");
+
+	for (i = 0; i < count; i++)
+		fit_image_set_verified(images, fit, noffsets[i]);
+
+	return 0;
+}
+#else
+static inline int fit_config_images_verify(bootm_headers_t *images,
+					   const void *fit, int cfg_noffset)
+{
+	return 0;
+}
+#endif
+
+/* @data, if not NULL, is a copy of the image data to verify instead */
+static int fit_image_select(const void *fit, int rd_noffset, int verify,
+			    const void *data, size_t size)
 {
 	fit_image_print(fit, rd_noffset, "   ");
 
 	if (verify) {
 		puts("   Verifying Hash Integrity ... ");
-		if (!fit_image_verify(fit, rd_noffset)) {
+		if (data ? !fit_image_verify_with_data(fit, rd_noffset, data,
+						       size) :
+		    !fit_image_verify(fit, rd_noffset)) {
 			puts("Bad Data Hash\n");
 			return -EACCES;
 		}
@@ -1784,6 +2955,35 @@ static const char *fit_get_image_type_property(int type)
 	return "unknown";
 }
 
+#if !defined(USE_HOSTCC) && defined(CONFIG_BOOTM_PLAN) && \
+	defined(CONFIG_SYS_BOOT_RAMDISK_HIGH)
+/*
+ * fit_image_get_final_load() - get the load address of a subimage, moved for
+ * a ramdisk to where boot_ramdisk_high() would otherwise copy it later
+ */
+static int fit_image_get_final_load(bootm_headers_t *images, ulong addr,
+				    const void *fit, int noffset,
+				    int image_type, ulong len, ulong *load)
+{
+	int ret;
+
+	ret = fit_image_get_load(fit, noffset, load);
+	if (ret || image_type != IH_TYPE_RAMDISK || !images)
+		return ret;
+	*load = boot_ramdisk_plan(images, *load, len, addr,
+				  addr + fit_get_size(fit));
+
+	return 0;
+}
+#else
+static int fit_image_get_final_load(bootm_headers_t *images, ulong addr,
+				    const void *fit, int noffset,
+				    int image_type, ulong len, ulong *load)
+{
+	return fit_image_get_load(fit, noffset, load);
+}
+#endif
+
 int fit_image_load(bootm_headers_t *images, ulong addr,
 		   const char **fit_unamep, const char **fit_uname_configp,
 		   int arch, int image_type, int bootstage_id,
@@ -1803,6 +3003,14 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	uint8_t os_arch;
 #endif
 	const char *prop_name;
+	ulong ram_copy;
+	size_t ram_size = 0;
+	bool pipelined = false;
+	bool cipher = false;
+	bool verified;
+#if IMAGE_ENABLE_FIT_LAZY
+	int lazy_size;
+#endif
 	int ret;
 
 	fit = map_sysmem(addr, 0);
@@ -1851,13 +3059,20 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 
 		if (IMAGE_ENABLE_VERIFY && images->verify) {
 			puts("   Verifying Hash Integrity ... ");
-			if (fit_config_verify(fit, cfg_noffset)) {
+			if (fit_config_verify_once(images, fit, cfg_noffset)) {
 				puts("Bad Data Hash\n");
 				bootstage_error(bootstage_id +
 					BOOTSTAGE_SUB_HASH);
 				return -EACCES;
 			}
 			puts("OK\n");
+			if (fit_config_images_verify(images, fit,
+						     cfg_noffset)) {
+				puts("Bad Data Hash\n");
+				bootstage_error(bootstage_id +
+					BOOTSTAGE_SUB_HASH);
+				return -EACCES;
+			}
 		}
 
 		bootstage_mark(BOOTSTAGE_ID_FIT_CONFIG);
@@ -1874,11 +3089,40 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+#if IMAGE_ENABLE_FIT_LAZY
+	/* Read the data straight to the load address, if there is one */
+	if (fit_is_lazy(fit) && load_op != FIT_LOAD_IGNORED &&
+	    !fit_image_get_data_size(fit, noffset, &lazy_size) &&
+	    !fit_image_get_final_load(images, addr, fit, noffset, image_type,
+				      lazy_size, &load) &&
+	    (load_op != FIT_LOAD_OPTIONAL_NON_ZERO || load) &&
+	    !(IMAGE_ENABLE_DECRYPT && fit_image_has_cipher(fit, noffset)))
+		fit_lazy_set_dest(fit, noffset, map_sysmem(load, 0));
+#endif
+	/* Only a FIT in a memory-mapped flash needs this */
+	ram_copy = fit_image_ram_copy(images, fit, noffset, load_op,
+				      &ram_size);
+	verified = images->verify && fit_image_verified(images, fit, noffset);
+#if !defined(USE_HOSTCC) && \
+	(defined(CONFIG_FIT_PIPELINED_LOAD) || IMAGE_ENABLE_DECRYPT)
+	cipher = IMAGE_ENABLE_DECRYPT && fit_image_has_cipher(fit, noffset);
+	/* Hashes are then checked while copying to the load address */
+	if (IS_ENABLED(CONFIG_FIT_PIPELINED_LOAD) || cipher)
+		pipelined = images->verify && !verified &&
+			    fit_image_pipelined_load(fit, noffset, load_op);
+#endif
+	ret = fit_image_select(fit, noffset,
+			       images->verify && !pipelined && !verified,
+			       ram_copy ? map_sysmem(ram_copy, ram_size) : NULL,
+			       ram_size);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
 	}
+	if (verified)
+		puts("   Verifying Hash Integrity ... (verified before) OK\n");
+	else if (images->verify && !pipelined && !ram_copy)
+		fit_image_set_verified(images, fit, noffset);
 
 	bootstage_mark(bootstage_id + BOOTSTAGE_SUB_CHECK_ARCH);
 #if !defined(USE_HOSTCC) && !defined(CONFIG_SANDBOX)
@@ -1935,6 +3179,8 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_GET_DATA);
 		return -ENOENT;
 	}
+	if (ram_copy)
+		buf = map_sysmem(ram_copy, size);
 
 #if !defined(USE_HOSTCC) && defined(CONFIG_FIT_IMAGE_POST_PROCESS)
 	/* perform any post-processing on the image data */
@@ -1944,7 +3190,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	len = (ulong)size;
 
 	/* verify that image data is a proper FDT blob */
-	if (image_type == IH_TYPE_FLATDT && fdt_check_header(buf)) {
+	if (image_type == IH_TYPE_FLATDT && !cipher && fdt_check_header(buf)) {
 		puts("Subimage data is not a FDT");
 		return -ENOEXEC;
 	}
@@ -1964,7 +3210,8 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 
 	if (load_op == FIT_LOAD_IGNORED) {
 		/* Don't load */
-	} else if (fit_image_get_load(fit, noffset, &load)) {
+	} else if (fit_image_get_final_load(images, addr, fit, noffset,
+					    image_type, len, &load)) {
 		if (load_op == FIT_LOAD_REQUIRED) {
 			printf("Can't get %s subimage load address!\n",
 			       prop_name);
@@ -1974,6 +3221,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	} else if (load_op != FIT_LOAD_OPTIONAL_NON_ZERO || load) {
 		ulong image_start, image_end;
 		ulong load_end;
+		bool copied = false;
 		void *dst;
 
 		/*
@@ -1994,9 +3242,87 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		       prop_name, data, load);
 
 		dst = map_sysmem(load, len);
-		memmove(dst, buf, len);
+#if !defined(USE_HOSTCC) && IMAGE_ENABLE_DECRYPT
+		if (cipher) {
+			if (pipelined)
+				puts("   Verifying Hash Integrity ... ");
+			if (dst + len <= buf || buf + len <= dst) {
+				ret = fit_image_decrypt_copy(fit, noffset, dst,
+							     buf, len,
+							     pipelined, &size);
+			} else {
+				printf("Error: %s overwritten\n", prop_name);
+				ret = -EXDEV;
+			}
+			if (ret) {
+				puts(ret == -EACCES ? "Bad Data Hash\n" :
+				     "Can't decrypt\n");
+				bootstage_error(bootstage_id +
+						BOOTSTAGE_SUB_HASH);
+				return ret;
+			}
+			if (pipelined)
+				puts("OK\n");
+			copied = true;
+		}
+#endif
+#if !defined(USE_HOSTCC) && defined(CONFIG_FIT_PIPELINED_LOAD)
+		if (pipelined && !copied) {
+			puts("   Verifying Hash Integrity ... ");
+			if (dst + len <= buf || buf + len <= dst) {
+				ret = fit_image_copy_verify(fit, noffset, dst,
+							    buf, len);
+				copied = true;
+			} else {
+				ret = fit_image_verify_with_data(fit, noffset,
+								 buf, len) ?
+					0 : -EACCES;
+				if (!ret)
+					fit_image_set_verified(images, fit,
+							       noffset);
+			}
+			if (ret) {
+				puts("Bad Data Hash\n");
+				bootstage_error(bootstage_id +
+						BOOTSTAGE_SUB_HASH);
+				return ret;
+			}
+			puts("OK\n");
+		}
+#endif
+		/* Lazily loaded data may already be there */
+		if (!copied && dst != buf)
+			memmove(dst, buf, len);
+		if (dst != buf)
+			fit_verified_forget(images, dst, len);
+		if (cipher)
+			len = size;
 		data = load;
 	}
+#if !defined(USE_HOSTCC) && IMAGE_ENABLE_DECRYPT
+	if (cipher && data == map_to_sysmem(buf)) {
+		/*
+		 * Not loaded, so the plain data stays on the heap for the rest
+		 * of the boot. Its hashes have been checked by
+		 * fit_image_select().
+		 */
+		void *plain = memalign(ARCH_DMA_MINALIGN, size);
+
+		if (!plain || fit_image_decrypt_copy(fit, noffset, plain, buf,
+						     size, false, &size)) {
+			puts("Can't decrypt\n");
+			free(plain);
+			return -EIO;
+		}
+		data = map_to_sysmem(plain);
+		len = size;
+	}
+	if (cipher && image_type == IH_TYPE_FLATDT &&
+	    fdt_check_header(map_sysmem(data, len))) {
+		puts("Subimage data is not a FDT");
+		return -ENOEXEC;
+	}
+#endif
 	bootstage_mark(bootstage_id + BOOTSTAGE_SUB_LOAD);
 
 	*datap = data;
@@ -2135,19 +3461,12 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 		ov = map_sysmem(ovload, ovlen);
 
 		base = map_sysmem(load, len + ovlen);
-		err = fdt_open_into(base, base, len + ovlen);
-		if (err < 0) {
-			printf("failed on fdt_open_into\n");
-			fdt_noffset = err;
-			goto out;
-		}
-		/* the verbose method prints out messages on error */
-		err = fdt_overlay_apply_verbose(base, ov);
+		/* the base tree is only moved for the first overlay */
+		err = fdt_overlay_apply_in_place(base, ov, ovlen);
 		if (err < 0) {
 			fdt_noffset = err;
 			goto out;
 		}
-		fdt_pack(base);
 		len = fdt_totalsize(base);
 	}
 #else
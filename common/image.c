@@ -8,6 +8,7 @@
 
 #ifndef USE_HOSTCC
 #include <common.h>
+#include <dma.h>
 #include <watchdog.h>
 
 #ifdef CONFIG_SHOW_BOOT_PROGRESS
@@ -178,6 +179,7 @@ static const table_entry_t uimage_comp[] = {
 	{	IH_COMP_LZMA,	"lzma",		"lzma compressed",	},
 	{	IH_COMP_LZO,	"lzo",		"lzo compressed",	},
 	{	IH_COMP_LZ4,	"lz4",		"lz4 compressed",	},
+	{	IH_COMP_ZSTD,	"zstd",		"zstd compressed",	},
 	{	-1,		"",		"",			},
 };
 
@@ -527,6 +529,8 @@ void memmove_wd(void *to, void *from, size_t len, ulong chunksz)
 {
 	if (to == from)
 		return;
+	if (!dma_memcpy_large(to, from, len))
+		return;
 
 #if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
 	if (to > from) {
@@ -1115,6 +1119,23 @@ int boot_get_ramdisk(int argc, char * const argv[], bootm_headers_t *images,
 	return 0;
 }
 
+/**
+ * boot_addr_in_ram - check whether a region lies in DRAM
+ * @addr: start of the region
+ * @len: length of the region
+ *
+ * Images booted in place from a memory-mapped flash window are readable
+ * but cannot be written, nor reached by the hash engine.
+ *
+ * returns:
+ *     true if the region is within the DRAM U-Boot knows about
+ */
+bool boot_addr_in_ram(ulong addr, ulong len)
+{
+	return addr >= gd->ram_base && len <= gd->ram_size &&
+	       addr - gd->ram_base <= gd->ram_size - len;
+}
+
 #ifdef CONFIG_SYS_BOOT_RAMDISK_HIGH
 /**
  * boot_ramdisk_high - relocate init ramdisk
@@ -1137,13 +1158,12 @@ int boot_get_ramdisk(int argc, char * const argv[], bootm_headers_t *images,
  *      0 - success
  *     -1 - failure
  */
-int boot_ramdisk_high(struct lmb *lmb, ulong rd_data, ulong rd_len,
-		  ulong *initrd_start, ulong *initrd_end)
+static ulong boot_get_initrd_high(int *initrd_copy_to_ram)
 {
 	char	*s;
 	ulong	initrd_high;
-	int	initrd_copy_to_ram = 1;
 
+	*initrd_copy_to_ram = 1;
 	s = env_get("initrd_high");
 	if (s) {
 		/* a value of "no" or a similar string will act like 0,
@@ -1151,21 +1171,109 @@ int boot_ramdisk_high(struct lmb *lmb, ulong rd_data, ulong rd_len,
 		 */
 		initrd_high = simple_strtoul(s, NULL, 16);
 		if (initrd_high == ~0)
-			initrd_copy_to_ram = 0;
+			*initrd_copy_to_ram = 0;
 	} else {
 		initrd_high = env_get_bootm_mapsize() + env_get_bootm_low();
 	}
 
+	return initrd_high;
+}
+
+#ifdef CONFIG_BOOTM_PLAN
+#ifndef CONFIG_SYS_BOOTM_LEN
+#define CONFIG_SYS_BOOTM_LEN	0x800000
+#endif
+
+/*
+ * A ramdisk needs no copy if it lies in free memory, page aligned as the
+ * lmb_alloc() below would place it, and below initrd_high
+ */
+static bool boot_ramdisk_in_place(struct lmb *lmb, ulong rd_data,
+				  ulong rd_len, ulong initrd_high)
+{
+	if (rd_data & 0xfff)
+		return false;
+	if (initrd_high && rd_data + rd_len > initrd_high)
+		return false;
+
+	return lmb_get_free_size(lmb, rd_data) >= rd_len;
+}
+
+/**
+ * boot_ramdisk_plan - choose the final address of a ramdisk before loading it
+ * @images: pointer to the bootm images structure, with the OS image found
+ * @load: load address given by the ramdisk image
+ * @len: ramdisk size
+ * @img_start: start of the image holding the ramdisk
+ * @img_end: end of the image holding the ramdisk
+ *
+ * boot_ramdisk_high() later moves the ramdisk to the top of the memory
+ * below initrd_high. This finds that address now, avoiding the kernel load
+ * area and the image still being loaded from, so that the ramdisk can be
+ * loaded there directly and boot_ramdisk_high() uses it in place.
+ *
+ * returns:
+ *     the address to load the ramdisk to, @load if it is not moved
+ */
+ulong boot_ramdisk_plan(bootm_headers_t *images, ulong load, ulong len,
+			ulong img_start, ulong img_end)
+{
+	struct lmb lmb = images->lmb;
+	ulong initrd_high, os_len;
+	int initrd_copy_to_ram;
+	ulong start;
+
+	initrd_high = boot_get_initrd_high(&initrd_copy_to_ram);
+	if (!initrd_copy_to_ram)
+		return load;
+
+	if (images->os.load) {
+		/* Not decompressed yet, so allow for the largest kernel */
+		os_len = images->os.comp == IH_COMP_NONE ?
+			 images->os.image_len : CONFIG_SYS_BOOTM_LEN;
+		lmb_reserve(&lmb, images->os.load, os_len);
+	}
+	lmb_reserve(&lmb, img_start, img_end - img_start);
+
+	if (initrd_high)
+		start = (ulong)lmb_alloc_base(&lmb, len, 0x1000, initrd_high);
+	else
+		start = (ulong)lmb_alloc(&lmb, len, 0x1000);
+	if (!start)
+		return load;
+	debug("## ramdisk planned at %08lx instead of %08lx\n", start, load);
+
+	return start;
+}
+#endif
+
+int boot_ramdisk_high(struct lmb *lmb, ulong rd_data, ulong rd_len,
+		  ulong *initrd_start, ulong *initrd_end)
+{
+	ulong	initrd_high;
+	int	initrd_copy_to_ram;
+
+	initrd_high = boot_get_initrd_high(&initrd_copy_to_ram);
 
 	debug("## initrd_high = 0x%08lx, copy_to_ram = %d\n",
 			initrd_high, initrd_copy_to_ram);
 
 	if (rd_data) {
-		if (!initrd_copy_to_ram) {	/* zero-copy ramdisk support */
+		/* zero-copy ramdisk support, unless it is still in flash */
+		if (!initrd_copy_to_ram && boot_addr_in_ram(rd_data, rd_len)) {
 			debug("   in-place initrd\n");
 			*initrd_start = rd_data;
 			*initrd_end = rd_data + rd_len;
 			lmb_reserve(lmb, rd_data, rd_len);
+#ifdef CONFIG_BOOTM_PLAN
+		} else if (boot_ramdisk_in_place(lmb, rd_data, rd_len,
+						 initrd_high)) {
+			*initrd_start = rd_data;
+			*initrd_end = rd_data + rd_len;
+			lmb_reserve(lmb, rd_data, rd_len);
+			printf("   Using Ramdisk in place at %08lx, end %08lx\n",
+			       *initrd_start, *initrd_end);
+#endif
 		} else {
 			if (initrd_high)
 				*initrd_start = (ulong)lmb_alloc_base(lmb,
@@ -6,6 +6,9 @@
  */
 
 #include <common.h>
+#include <bloblist.h>
+#include <clk.h>
+#include <dm.h>
 #include <handoff.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -14,7 +17,7 @@ void handoff_save_dram(struct spl_handoff *ho)
 {
 	ho->ram_size = gd->ram_size;
 #ifdef CONFIG_NR_DRAM_BANKS
-	{
+	if (gd->bd) {
 		struct bd_info *bd = gd->bd;
 		int i;
 
@@ -45,3 +48,95 @@ void handoff_load_dram_banks(struct spl_handoff *ho)
 	}
 #endif
 }
+
+#ifdef CONFIG_HANDOFF_DEVICES
+void handoff_init_devices(struct spl_handoff *ho)
+{
+	ho->baudrate = 0;
+	ho->console_seq = -1;
+	ho->clk_count = 0;
+}
+
+void handoff_save_console(struct spl_handoff *ho)
+{
+	ho->baudrate = gd->baudrate;
+#if CONFIG_IS_ENABLED(DM_SERIAL)
+	if (gd->cur_serial_dev)
+		ho->console_seq = gd->cur_serial_dev->seq;
+#endif
+}
+
+#ifndef CONFIG_SPL_BUILD
+int handoff_console_seq(void)
+{
+	struct spl_handoff *ho = gd->spl_handoff;
+
+	if (!ho || ho->console_seq < 0 || ho->baudrate != gd->baudrate)
+		return -ENOENT;
+
+	return ho->console_seq;
+}
+#endif
+
+static struct handoff_clk *handoff_find_clk(struct spl_handoff *ho,
+					    struct clk *clk)
+{
+	int i;
+
+	for (i = 0; i < min_t(u32, ho->clk_count, HANDOFF_CLKS); i++) {
+		if (ho->clk[i].id == clk->id &&
+		    !strncmp(ho->clk[i].dev, clk->dev->name,
+			     HANDOFF_CLK_NAME_LEN))
+			return &ho->clk[i];
+	}
+
+	return NULL;
+}
+
+void handoff_save_clk_rate(struct clk *clk, ulong rate, ulong actual)
+{
+	struct spl_handoff *ho;
+	struct handoff_clk *hc;
+
+	ho = bloblist_find(BLOBLISTT_SPL_HANDOFF, sizeof(*ho));
+	if (!ho)
+		return;
+	hc = handoff_find_clk(ho, clk);
+	if (!hc) {
+		if (ho->clk_count >= HANDOFF_CLKS) {
+			debug("%s: no room for %s/%lu\n", __func__,
+			      clk->dev->name, clk->id);
+			return;
+		}
+		hc = &ho->clk[ho->clk_count++];
+		strlcpy(hc->dev, clk->dev->name, sizeof(hc->dev));
+		hc->id = clk->id;
+	}
+	hc->rate = rate;
+	hc->actual = actual;
+}
+
+#ifndef CONFIG_SPL_BUILD
+bool handoff_adopt_clk_rate(struct clk *clk, ulong rate, ulong *actualp)
+{
+	struct spl_handoff *ho = gd->spl_handoff;
+	struct handoff_clk *hc;
+	bool match;
+
+	if (!ho || !(clk->dev->driver->flags & DM_FLAG_HANDOFF))
+		return false;
+	hc = handoff_find_clk(ho, clk);
+	if (!hc)
+		return false;
+	match = rate && hc->rate == rate;
+	if (match)
+		*actualp = hc->actual;
+	/* From now on the driver owns the clock */
+	hc->rate = 0;
+	debug("%s: %s/%lu at %lu: %s\n", __func__, clk->dev->name, clk->id,
+	      rate, match ? "adopted" : "reprogrammed");
+
+	return match;
+}
+#endif
+#endif
@@ -6,11 +6,15 @@
 #define IOTRACE_IMPL
 
 #include <common.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <asm/io.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Number of registers which can be counted in summary mode */
+#define IOTRACE_SUMMARY_SIZE	256
+
 /**
  * struct iotrace - current trace status and checksum
  *
@@ -18,25 +22,36 @@ DECLARE_GLOBAL_DATA_PTR;
  * @size:	Actual size of iotrace buffer in bytes
  * @needed_size: Needed of iotrace buffer in bytes
  * @offset:	Current write offset into iotrace buffer
- * @region_start: Address of IO region to trace
- * @region_size: Size of region to trace. if 0 will trace all address space
+ * @region_start: Address of each IO region to trace
+ * @region_size: Size of each region to trace
+ * @region_count: Number of regions. If 0 will trace all address space
+ * @summary:	Per-register totals, used in summary mode
+ * @summary_dropped: Number of accesses not counted as the table was full
  * @crc32:	Current value of CRC chceksum of trace records
  * @enabled:	true if enabled, false if disabled
+ * @summary_mode: true to count accesses in @summary instead of recording
+ * @busy:	true while an access is being traced, to avoid tracing the
+ *		accesses made by the timer
  */
 static struct iotrace {
 	ulong start;
 	ulong size;
 	ulong needed_size;
 	ulong offset;
-	ulong region_start;
-	ulong region_size;
+	ulong region_start[IOTRACE_MAX_REGIONS];
+	ulong region_size[IOTRACE_MAX_REGIONS];
+	int region_count;
+	struct iotrace_summary *summary;
+	ulong summary_dropped;
 	u32 crc32;
 	bool enabled;
+	bool summary_mode;
+	bool busy;
 } iotrace;
 
-static void add_record(int flags, const void *ptr, ulong value)
+static bool iotrace_wanted(const void *ptr)
 {
-	struct iotrace_record srec, *rec = &srec;
+	int i;
 
 	/*
 	 * We don't support iotrace before relocation. Since the trace buffer
@@ -44,84 +59,175 @@ static void add_record(int flags, const void *ptr, ulong value)
 	 * this we would need to set the iotrace buffer at build-time. See
 	 * lib/trace.c for how this might be done if you are interested.
 	 */
-	if (!(gd->flags & GD_FLG_RELOC) || !iotrace.enabled)
+	if (!(gd->flags & GD_FLG_RELOC) || !iotrace.enabled || iotrace.busy)
+		return false;
+
+	if (!iotrace.region_count)
+		return true;
+	for (i = 0; i < iotrace.region_count; i++) {
+		if ((ulong)ptr - iotrace.region_start[i] <
+		    iotrace.region_size[i])
+			return true;
+	}
+
+	return false;
+}
+
+/* Start timing an access, returning the tick count */
+static u32 iotrace_start(void)
+{
+	u32 ticks;
+
+	iotrace.busy = true;
+	ticks = get_ticks();
+	iotrace.busy = false;
+
+	return ticks;
+}
+
+static void add_summary(int flags, phys_addr_t addr, u32 ticks)
+{
+	struct iotrace_summary *entry;
+	int i, idx;
+
+	/* Registers are usually word-aligned, so hash on the word address */
+	idx = (addr >> 2) % IOTRACE_SUMMARY_SIZE;
+	for (i = 0; i < IOTRACE_SUMMARY_SIZE; i++) {
+		entry = &iotrace.summary[idx];
+		if (entry->addr == addr || !(entry->reads + entry->writes))
+			break;
+		idx = (idx + 1) % IOTRACE_SUMMARY_SIZE;
+	}
+	if (i == IOTRACE_SUMMARY_SIZE) {
+		iotrace.summary_dropped++;
+		return;
+	}
+
+	entry->addr = addr;
+	if (flags & IOT_WRITE)
+		entry->writes++;
+	else
+		entry->reads++;
+	entry->ticks += ticks;
+}
+
+static void add_record(int flags, const void *ptr, ulong value, u32 start)
+{
+	struct iotrace_record srec, *rec = &srec;
+	struct iotrace_hdr *hdr;
+	phys_addr_t addr;
+	u32 duration;
+
+	iotrace.busy = true;
+	duration = (u32)get_ticks() - start;
+	addr = map_to_sysmem(ptr);
+
+	if (iotrace.summary_mode) {
+		add_summary(flags, addr, duration);
+		iotrace.busy = false;
 		return;
+	}
 
-	if (iotrace.region_size)
-		if ((ulong)ptr < iotrace.region_start ||
-		    (ulong)ptr > iotrace.region_start + iotrace.region_size)
-			return;
+	/* Update our checksum, which only covers the accesses themselves */
+	iotrace.crc32 = crc32(iotrace.crc32, (unsigned char *)&flags,
+			      sizeof(flags));
+	iotrace.crc32 = crc32(iotrace.crc32, (unsigned char *)&addr,
+			      sizeof(addr));
+	iotrace.crc32 = crc32(iotrace.crc32, (unsigned char *)&value,
+			      sizeof(value));
 
 	/* Store it if there is room */
-	if (iotrace.offset + sizeof(*rec) < iotrace.size) {
+	if (iotrace.offset + sizeof(*rec) <= iotrace.size) {
 		rec = (struct iotrace_record *)map_sysmem(
 					iotrace.start + iotrace.offset,
-					sizeof(value));
+					sizeof(*rec));
 	} else {
 		WARN_ONCE(1, "WARNING: iotrace buffer exhausted, please check needed length using \"iotrace stats\"\n");
 		iotrace.needed_size += sizeof(struct iotrace_record);
+		iotrace.busy = false;
 		return;
 	}
 
-	rec->timestamp = timer_get_us();
-	rec->flags = flags;
-	rec->addr = map_to_sysmem(ptr);
+	rec->ticks = start;
 	rec->value = value;
-
-	/* Update our checksum */
-	iotrace.crc32 = crc32(iotrace.crc32, (unsigned char *)rec,
-			      sizeof(*rec));
+	rec->addr = addr;
+	rec->duration = min(duration, 0xffffU);
+	rec->flags = flags;
 
 	iotrace.needed_size += sizeof(struct iotrace_record);
 	iotrace.offset += sizeof(struct iotrace_record);
+	hdr = map_sysmem(iotrace.start, sizeof(*hdr));
+	hdr->count++;
+	iotrace.busy = false;
 }
 
 u32 iotrace_readl(const void *ptr)
 {
+	bool wanted = iotrace_wanted(ptr);
+	u32 start = wanted ? iotrace_start() : 0;
 	u32 v;
 
 	v = readl(ptr);
-	add_record(IOT_32 | IOT_READ, ptr, v);
+	if (wanted)
+		add_record(IOT_32 | IOT_READ, ptr, v, start);
 
 	return v;
 }
 
 void iotrace_writel(ulong value, const void *ptr)
 {
-	add_record(IOT_32 | IOT_WRITE, ptr, value);
+	bool wanted = iotrace_wanted(ptr);
+	u32 start = wanted ? iotrace_start() : 0;
+
 	writel(value, ptr);
+	if (wanted)
+		add_record(IOT_32 | IOT_WRITE, ptr, value, start);
 }
 
 u16 iotrace_readw(const void *ptr)
 {
+	bool wanted = iotrace_wanted(ptr);
+	u32 start = wanted ? iotrace_start() : 0;
 	u32 v;
 
 	v = readw(ptr);
-	add_record(IOT_16 | IOT_READ, ptr, v);
+	if (wanted)
+		add_record(IOT_16 | IOT_READ, ptr, v, start);
 
 	return v;
 }
 
 void iotrace_writew(ulong value, const void *ptr)
 {
-	add_record(IOT_16 | IOT_WRITE, ptr, value);
+	bool wanted = iotrace_wanted(ptr);
+	u32 start = wanted ? iotrace_start() : 0;
+
 	writew(value, ptr);
+	if (wanted)
+		add_record(IOT_16 | IOT_WRITE, ptr, value, start);
 }
 
 u8 iotrace_readb(const void *ptr)
 {
+	bool wanted = iotrace_wanted(ptr);
+	u32 start = wanted ? iotrace_start() : 0;
 	u32 v;
 
 	v = readb(ptr);
-	add_record(IOT_8 | IOT_READ, ptr, v);
+	if (wanted)
+		add_record(IOT_8 | IOT_READ, ptr, v, start);
 
 	return v;
 }
 
 void iotrace_writeb(ulong value, const void *ptr)
 {
-	add_record(IOT_8 | IOT_WRITE, ptr, value);
+	bool wanted = iotrace_wanted(ptr);
+	u32 start = wanted ? iotrace_start() : 0;
+
 	writeb(value, ptr);
+	if (wanted)
+		add_record(IOT_8 | IOT_WRITE, ptr, value, start);
 }
 
 void iotrace_reset_checksum(void)
@@ -136,20 +242,35 @@ u32 iotrace_get_checksum(void)
 
 void iotrace_set_region(ulong start, ulong size)
 {
-	iotrace.region_start = start;
-	iotrace.region_size = size;
+	iotrace_reset_region();
+	if (size)
+		iotrace_add_region(start, size);
+}
+
+int iotrace_add_region(ulong start, ulong size)
+{
+	if (iotrace.region_count == IOTRACE_MAX_REGIONS)
+		return -ENOSPC;
+	iotrace.region_start[iotrace.region_count] = start;
+	iotrace.region_size[iotrace.region_count] = size;
+	iotrace.region_count++;
+
+	return 0;
 }
 
 void iotrace_reset_region(void)
 {
-	iotrace.region_start = 0;
-	iotrace.region_size = 0;
+	iotrace.region_count = 0;
 }
 
-void iotrace_get_region(ulong *start, ulong *size)
+int iotrace_get_region(int idx, ulong *start, ulong *size)
 {
-	*start = iotrace.region_start;
-	*size = iotrace.region_size;
+	if (idx < 0 || idx >= iotrace.region_count)
+		return -ENOENT;
+	*start = iotrace.region_start[idx];
+	*size = iotrace.region_size[idx];
+
+	return 0;
 }
 
 void iotrace_set_enabled(int enable)
@@ -162,12 +283,56 @@ int iotrace_get_enabled(void)
 	return iotrace.enabled;
 }
 
+int iotrace_set_summary(bool enable)
+{
+	if (enable) {
+		if (!iotrace.summary) {
+			iotrace.summary = malloc(IOTRACE_SUMMARY_SIZE *
+						 sizeof(*iotrace.summary));
+			if (!iotrace.summary)
+				return -ENOMEM;
+		}
+		memset(iotrace.summary, '\0',
+		       IOTRACE_SUMMARY_SIZE * sizeof(*iotrace.summary));
+		iotrace.summary_dropped = 0;
+	}
+	iotrace.summary_mode = enable;
+
+	return 0;
+}
+
+struct iotrace_summary *iotrace_get_summary(int *countp)
+{
+	*countp = iotrace.summary ? IOTRACE_SUMMARY_SIZE : 0;
+
+	return iotrace.summary;
+}
+
 void iotrace_set_buffer(ulong start, ulong size)
 {
+	struct iotrace_hdr *hdr;
+
+	/* The timer may use I/O, which must not go into the new buffer */
+	iotrace.busy = true;
 	iotrace.start = start;
 	iotrace.size = size;
 	iotrace.offset = 0;
+	iotrace.needed_size = sizeof(*hdr);
 	iotrace.crc32 = 0;
+	if (size < sizeof(*hdr)) {
+		iotrace.size = 0;
+		iotrace.busy = false;
+		return;
+	}
+
+	hdr = map_sysmem(start, sizeof(*hdr));
+	hdr->magic = IOTRACE_MAGIC;
+	hdr->version = IOTRACE_VERSION;
+	hdr->rec_size = sizeof(struct iotrace_record);
+	hdr->tick_rate = get_tbclk();
+	hdr->count = 0;
+	iotrace.offset = sizeof(*hdr);
+	iotrace.busy = false;
 }
 
 void iotrace_get_buffer(ulong *start, ulong *size, ulong *needed_size, ulong *offset, ulong *count)
@@ -176,5 +341,7 @@ void iotrace_get_buffer(ulong *start, ulong *size, ulong *needed_size, ulong *of
 	*size = iotrace.size;
 	*needed_size = iotrace.needed_size;
 	*offset = iotrace.offset;
-	*count = iotrace.offset / sizeof(struct iotrace_record);
+	*count = iotrace.offset > sizeof(struct iotrace_hdr) ?
+		(iotrace.offset - sizeof(struct iotrace_hdr)) /
+		sizeof(struct iotrace_record) : 0;
 }
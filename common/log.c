@@ -179,18 +179,39 @@ static bool log_passes_filters(struct log_device *ldev, struct log_rec *rec)
  * log_dispatch() - Send a log record to all log devices for processing
  *
  * The log record is sent to each log device in turn, skipping those which have
- * filters which block the record
+ * filters which block the record. The message is formatted the first time a
+ * device which needs it accepts the record.
  *
  * @rec: Log record to dispatch
+ * @args: Arguments for @rec->fmt
  * @return 0 (meaning success)
  */
-static int log_dispatch(struct log_rec *rec)
+static int log_dispatch(struct log_rec *rec, va_list args)
 {
+	char buf[CONFIG_SYS_CBSIZE];
 	struct log_device *ldev;
+	va_list rec_args;
 
+	rec->msg = NULL;
+	rec->args = NULL;
 	list_for_each_entry(ldev, &gd->log_head, sibling_node) {
-		if (log_passes_filters(ldev, rec))
+		if (!log_passes_filters(ldev, rec))
+			continue;
+		if (ldev->drv->flags & LOGDF_RAW) {
+			va_copy(rec_args, args);
+			rec->args = &rec_args;
 			ldev->drv->emit(ldev, rec);
+			rec->args = NULL;
+			va_end(rec_args);
+			continue;
+		}
+		if (!rec->msg) {
+			va_copy(rec_args, args);
+			vsnprintf(buf, sizeof(buf), rec->fmt, rec_args);
+			va_end(rec_args);
+			rec->msg = buf;
+		}
+		ldev->drv->emit(ldev, rec);
 	}
 
 	return 0;
@@ -199,25 +220,23 @@ static int log_dispatch(struct log_rec *rec)
 int _log(enum log_category_t cat, enum log_level_t level, const char *file,
 	 int line, const char *func, const char *fmt, ...)
 {
-	char buf[CONFIG_SYS_CBSIZE];
 	struct log_rec rec;
 	va_list args;
 
+	if (!gd || !(gd->flags & GD_FLG_LOG_READY)) {
+		if (gd)
+			gd->log_drop_count++;
+		return -ENOSYS;
+	}
 	rec.cat = cat;
 	rec.level = level;
 	rec.file = file;
 	rec.line = line;
 	rec.func = func;
+	rec.fmt = fmt;
 	va_start(args, fmt);
-	vsnprintf(buf, sizeof(buf), fmt, args);
+	log_dispatch(&rec, args);
 	va_end(args);
-	rec.msg = buf;
-	if (!gd || !(gd->flags & GD_FLG_LOG_READY)) {
-		if (gd)
-			gd->log_drop_count++;
-		return -ENOSYS;
-	}
-	log_dispatch(&rec);
 
 	return 0;
 }
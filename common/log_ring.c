@@ -0,0 +1,544 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Binary log ring
+ *
+ * Records are kept in a bloblist record so that they survive relocation
+ * and can be passed on to the next boot phase. The message is not
+ * formatted when it is logged: the record holds the format string and a
+ * copy of the printf() arguments, and is only formatted when it is read.
+ * Formatted records hold the message text instead.
+ *
+ * The ring is a struct log_ring_hdr followed by a circular buffer of
+ * records, each a struct log_ring_rec followed by its data. Records may
+ * wrap around the end of the buffer.
+ */
+
+#include <common.h>
+#include <bloblist.h>
+#include <bootstage.h>
+#include <fdt_support.h>
+#include <log.h>
+#include <mapmem.h>
+#include <linux/ctype.h>
+#include <linux/libfdt.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+enum {
+	LOG_RING_DATA_MAX	= 128,	/* maximum bytes of packed arguments */
+};
+
+/**
+ * struct log_ring_hdr - header of the log ring
+ *
+ * @size: Size of the circular buffer which follows, in bytes
+ * @rd: Offset of the oldest record, modulo @size
+ * @wr: Offset of the next record, modulo @size
+ * @count: Number of records in the ring
+ * @dropped: Number of records dropped to make room for new ones
+ */
+struct log_ring_hdr {
+	u32 size;
+	u32 rd;
+	u32 wr;
+	u32 count;
+	u32 dropped;
+};
+
+/* Flags for struct log_ring_rec */
+enum {
+	LOGRF_TEXT	= 1 << 0,	/* data is the formatted message */
+};
+
+/**
+ * struct log_ring_rec - a record in the log ring
+ *
+ * @size: Size of the record including its data, in bytes
+ * @level: Log level (enum log_level_t)
+ * @flags: LOGRF_... flags
+ * @cat: Log category (enum log_category_t)
+ * @line: Line number
+ * @time_us: Time the record was logged, see timer_get_boot_us()
+ * @fmt: Format string, NULL if LOGRF_TEXT
+ * @file: File name, NULL if LOGRF_TEXT
+ * @func: Function name, NULL if LOGRF_TEXT
+ */
+struct log_ring_rec {
+	u16 size;
+	u8 level;
+	u8 flags;
+	u16 cat;
+	u16 line;
+	u32 time_us;
+	const char *fmt;
+	const char *file;
+	const char *func;
+};
+
+enum log_ring_type {
+	LRT_NONE,	/* %% */
+	LRT_INT,
+	LRT_LONG,
+	LRT_LLONG,
+	LRT_SIZE,
+	LRT_PTRDIFF,
+	LRT_PTR,
+	LRT_STR,
+	LRT_BAD,	/* not supported, format the message instead */
+};
+
+/**
+ * struct log_ring_spec - a conversion in a format string
+ *
+ * @type: Type of its argument
+ * @stars: Number of '*' widths and precisions, each taking an int
+ * @len: Length of the conversion including the '%'
+ */
+struct log_ring_spec {
+	enum log_ring_type type;
+	int stars;
+	int len;
+};
+
+/* Parse the conversion at @p, which points to a '%' */
+static void log_ring_parse(const char *p, struct log_ring_spec *spec)
+{
+	const char *start = p++;
+	int qual = 0;
+
+	spec->stars = 0;
+	while (*p && strchr("-+ #0", *p))
+		p++;
+	if (*p == '*') {
+		spec->stars++;
+		p++;
+	}
+	while (isdigit(*p))
+		p++;
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->stars++;
+			p++;
+		}
+		while (isdigit(*p))
+			p++;
+	}
+	if (*p && strchr("hlLqZzt", *p)) {
+		qual = *p++;
+		if (qual == 'l' && *p == 'l') {
+			qual = 'L';
+			p++;
+		} else if (qual == 'h' && *p == 'h') {
+			p++;
+		}
+	}
+
+	switch (*p) {
+	case '%':
+		spec->type = LRT_NONE;
+		break;
+	case 'd':
+	case 'i':
+	case 'u':
+	case 'x':
+	case 'X':
+	case 'o':
+	case 'c':
+		if (qual == 'l')
+			spec->type = LRT_LONG;
+		else if (qual == 'L' || qual == 'q')
+			spec->type = LRT_LLONG;
+		else if (qual == 'z' || qual == 'Z')
+			spec->type = LRT_SIZE;
+		else if (qual == 't')
+			spec->type = LRT_PTRDIFF;
+		else
+			spec->type = LRT_INT;
+		break;
+	case 's':
+		spec->type = LRT_STR;
+		break;
+	case 'p':
+		/* Extensions such as %pM read memory, which may change */
+		spec->type = isalnum(p[1]) ? LRT_BAD : LRT_PTR;
+		break;
+	default:
+		spec->type = LRT_BAD;
+		break;
+	}
+	if (*p)
+		p++;
+	spec->len = p - start;
+}
+
+#define LOG_RING_PUT(type, val) ({				\
+	type _v = (val);					\
+								\
+	if (len + sizeof(_v) > size)				\
+		return -ENOSPC;					\
+	memcpy(buf + len, &_v, sizeof(_v));			\
+	len += sizeof(_v);					\
+})
+
+/*
+ * Copy the arguments for @fmt to @buf. Returns the number of bytes used,
+ * or -ve if they do not fit or cannot be stored
+ */
+static int log_ring_pack(char *buf, int size, const char *fmt, va_list args)
+{
+	struct log_ring_spec spec;
+	const char *p, *str;
+	int len = 0;
+	int i, n;
+
+	for (p = fmt; *p; p++) {
+		if (*p != '%')
+			continue;
+		log_ring_parse(p, &spec);
+		if (spec.type == LRT_BAD)
+			return -ENOTSUPP;
+		p += spec.len - 1;
+		if (spec.type == LRT_NONE)
+			continue;
+		for (i = 0; i < spec.stars; i++)
+			LOG_RING_PUT(int, va_arg(args, int));
+
+		switch (spec.type) {
+		case LRT_INT:
+			LOG_RING_PUT(int, va_arg(args, int));
+			break;
+		case LRT_LONG:
+			LOG_RING_PUT(long, va_arg(args, long));
+			break;
+		case LRT_LLONG:
+			LOG_RING_PUT(long long, va_arg(args, long long));
+			break;
+		case LRT_SIZE:
+			LOG_RING_PUT(size_t, va_arg(args, size_t));
+			break;
+		case LRT_PTRDIFF:
+			LOG_RING_PUT(ptrdiff_t, va_arg(args, ptrdiff_t));
+			break;
+		case LRT_PTR:
+			LOG_RING_PUT(void *, va_arg(args, void *));
+			break;
+		case LRT_STR:
+			/* The string may not exist by the time it is read */
+			str = va_arg(args, const char *);
+			if (!str)
+				str = "(null)";
+			n = strlen(str) + 1;
+			if (len + n > size)
+				return -ENOSPC;
+			memcpy(buf + len, str, n);
+			len += n;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return len;
+}
+
+#define LOG_RING_GET(type) ({					\
+	type _v;						\
+								\
+	memcpy(&_v, data, sizeof(_v));				\
+	data += sizeof(_v);					\
+	_v;							\
+})
+
+#define LOG_RING_PRINT(val)					\
+	(spec.stars == 2 ? snprintf(out, left, conv, star[0], star[1], val) : \
+	 spec.stars == 1 ? snprintf(out, left, conv, star[0], val) :	\
+	 snprintf(out, left, conv, val))
+
+/* Format a message from @fmt and the arguments packed by log_ring_pack() */
+static void log_ring_format(char *buf, int size, const char *fmt,
+			    const char *data)
+{
+	struct log_ring_spec spec;
+	char *out = buf;
+	int left = size;
+	char conv[32];
+	int star[2];
+	const char *p;
+	int i, n;
+
+	for (p = fmt; *p && left > 1; p += n) {
+		if (*p != '%') {
+			*out++ = *p;
+			left--;
+			n = 1;
+			continue;
+		}
+		log_ring_parse(p, &spec);
+		n = spec.len;
+		if (spec.type == LRT_NONE) {
+			*out++ = '%';
+			left--;
+			continue;
+		}
+		if (spec.len >= sizeof(conv))
+			break;
+		memcpy(conv, p, spec.len);
+		conv[spec.len] = '\0';
+		for (i = 0; i < spec.stars; i++)
+			star[i] = LOG_RING_GET(int);
+
+		switch (spec.type) {
+		case LRT_INT:
+			i = LOG_RING_PRINT(LOG_RING_GET(int));
+			break;
+		case LRT_LONG:
+			i = LOG_RING_PRINT(LOG_RING_GET(long));
+			break;
+		case LRT_LLONG:
+			i = LOG_RING_PRINT(LOG_RING_GET(long long));
+			break;
+		case LRT_SIZE:
+			i = LOG_RING_PRINT(LOG_RING_GET(size_t));
+			break;
+		case LRT_PTRDIFF:
+			i = LOG_RING_PRINT(LOG_RING_GET(ptrdiff_t));
+			break;
+		case LRT_PTR:
+			i = LOG_RING_PRINT(LOG_RING_GET(void *));
+			break;
+		case LRT_STR:
+			i = LOG_RING_PRINT(data);
+			data += strlen(data) + 1;
+			break;
+		default:
+			i = 0;
+			break;
+		}
+		i = min(i, left - 1);
+		out += i;
+		left -= i;
+	}
+	*out = '\0';
+}
+
+static struct log_ring_hdr *log_ring_get(void)
+{
+	struct log_ring_hdr *hdr;
+
+	hdr = bloblist_find(BLOBLISTT_LOG_RING, 0);
+	if (hdr)
+		return hdr;
+
+	hdr = bloblist_add(BLOBLISTT_LOG_RING,
+			   sizeof(*hdr) + CONFIG_LOG_RING_SIZE);
+	if (!hdr)
+		return NULL;
+	memset(hdr, '\0', sizeof(*hdr));
+	hdr->size = CONFIG_LOG_RING_SIZE;
+
+	return hdr;
+}
+
+static void log_ring_copy(struct log_ring_hdr *hdr, u32 ofs, char *dst,
+			  const char *src, int len, bool to_ring)
+{
+	char *ring = (char *)(hdr + 1);
+	int first;
+
+	ofs %= hdr->size;
+	first = min_t(int, len, hdr->size - ofs);
+	if (to_ring) {
+		memcpy(ring + ofs, src, first);
+		memcpy(ring, src + first, len - first);
+	} else {
+		memcpy(dst, ring + ofs, first);
+		memcpy(dst + first, ring, len - first);
+	}
+}
+
+/* Remove the oldest record, copying it to @rec if not NULL */
+static void log_ring_pop(struct log_ring_hdr *hdr, struct log_ring_rec *rec)
+{
+	struct log_ring_rec tmp;
+
+	if (!rec)
+		rec = &tmp;
+	log_ring_copy(hdr, hdr->rd, (char *)rec, NULL, sizeof(*rec), false);
+	hdr->rd = (hdr->rd + rec->size) % hdr->size;
+	hdr->count--;
+}
+
+/* Add a record, dropping the oldest ones to make room */
+static void log_ring_push(struct log_ring_hdr *hdr, struct log_ring_rec *rec,
+			  const void *data)
+{
+	u32 used;
+
+	if (rec->size > hdr->size)
+		return;
+	for (;;) {
+		used = hdr->count ? (hdr->wr + hdr->size - hdr->rd) % hdr->size
+				  : 0;
+		if (!hdr->count || hdr->size - used >= rec->size)
+			break;
+		log_ring_pop(hdr, NULL);
+		hdr->dropped++;
+	}
+	if (!hdr->count)
+		hdr->rd = hdr->wr;
+	log_ring_copy(hdr, hdr->wr, NULL, (char *)rec, sizeof(*rec), true);
+	log_ring_copy(hdr, hdr->wr + sizeof(*rec), NULL, data,
+		      rec->size - sizeof(*rec), true);
+	hdr->wr = (hdr->wr + rec->size) % hdr->size;
+	hdr->count++;
+}
+
+static int log_ring_emit(struct log_device *ldev, struct log_rec *rec)
+{
+	char data[CONFIG_SYS_CBSIZE];
+	struct log_ring_rec lrec;
+	struct log_ring_hdr *hdr;
+	va_list args;
+	int len;
+
+	hdr = log_ring_get();
+	if (!hdr)
+		return -ENOSPC;
+
+	memset(&lrec, '\0', sizeof(lrec));
+	lrec.level = rec->level;
+	lrec.cat = rec->cat;
+	lrec.line = rec->line;
+	lrec.time_us = timer_get_boot_us();
+
+	va_copy(args, *rec->args);
+	len = log_ring_pack(data, LOG_RING_DATA_MAX, rec->fmt, args);
+	va_end(args);
+	if (len >= 0) {
+		lrec.fmt = rec->fmt;
+		lrec.file = rec->file;
+		lrec.func = rec->func;
+	} else {
+		/* Store the message itself */
+		va_copy(args, *rec->args);
+		len = vscnprintf(data, sizeof(data), rec->fmt, args) + 1;
+		va_end(args);
+		lrec.flags = LOGRF_TEXT;
+	}
+	lrec.size = sizeof(lrec) + len;
+	log_ring_push(hdr, &lrec, data);
+
+	return 0;
+}
+
+/*
+ * Call @func for each record, oldest first, with its formatted message.
+ * With @replace, each record is replaced by a text record
+ */
+static void log_ring_walk(struct log_ring_hdr *hdr, bool replace,
+			  void (*func)(struct log_ring_rec *rec,
+				       const char *msg))
+{
+	char data[CONFIG_SYS_CBSIZE];
+	char msg[CONFIG_SYS_CBSIZE];
+	struct log_ring_rec rec;
+	u32 ofs = hdr->rd;
+	int count = hdr->count;
+	u32 dropped;
+
+	while (count-- > 0) {
+		if (replace)
+			ofs = hdr->rd;
+		log_ring_copy(hdr, ofs, (char *)&rec, NULL, sizeof(rec), false);
+		log_ring_copy(hdr, ofs + sizeof(rec), data, NULL,
+			      rec.size - sizeof(rec), false);
+		if (rec.flags & LOGRF_TEXT)
+			strlcpy(msg, data, sizeof(msg));
+		else
+			log_ring_format(msg, sizeof(msg), rec.fmt, data);
+		if (func)
+			func(&rec, msg);
+
+		if (!replace) {
+			ofs += rec.size;
+			continue;
+		}
+		log_ring_pop(hdr, NULL);
+		rec.flags |= LOGRF_TEXT;
+		rec.fmt = NULL;
+		rec.file = NULL;
+		rec.func = NULL;
+		rec.size = sizeof(rec) + strlen(msg) + 1;
+		dropped = hdr->dropped;
+		log_ring_push(hdr, &rec, msg);
+		/* Pushing may have dropped records not yet formatted */
+		count -= hdr->dropped - dropped;
+	}
+}
+
+void log_ring_finish(void)
+{
+	struct log_ring_hdr *hdr;
+
+	hdr = bloblist_find(BLOBLISTT_LOG_RING, 0);
+	if (hdr)
+		log_ring_walk(hdr, true, NULL);
+}
+
+static void log_ring_show(struct log_ring_rec *rec, const char *msg)
+{
+	printf("%5u.%06u %s.%s,", rec->time_us / 1000000,
+	       rec->time_us % 1000000, log_get_level_name(rec->level),
+	       log_get_cat_name(rec->cat));
+	if (rec->file)
+		printf("%s:%d-%s() ", rec->file, rec->line, rec->func);
+	else
+		printf(" ");
+	puts(msg);
+}
+
+void log_ring_dump(void)
+{
+	struct log_ring_hdr *hdr;
+
+	hdr = bloblist_find(BLOBLISTT_LOG_RING, 0);
+	if (!hdr) {
+		printf("No log ring\n");
+		return;
+	}
+	log_ring_walk(hdr, false, log_ring_show);
+	printf("%u records, %u dropped\n", hdr->count, hdr->dropped);
+}
+
+int log_ring_fdt_setup(void *blob)
+{
+	struct log_ring_hdr *hdr;
+	int chosen, ret;
+	u64 start, end;
+
+	hdr = bloblist_find(BLOBLISTT_LOG_RING, 0);
+	if (!hdr)
+		return 0;
+	log_ring_finish();
+
+	start = map_to_sysmem(hdr);
+	end = start + sizeof(*hdr) + hdr->size;
+	ret = fdt_add_mem_rsv(blob, start, end - start);
+	if (ret < 0)
+		return ret;
+	chosen = fdt_find_or_add_subnode(blob, 0, "chosen");
+	if (chosen < 0)
+		return chosen;
+	ret = fdt_setprop_u64(blob, chosen, "u-boot,log-start", start);
+	if (!ret)
+		ret = fdt_setprop_u64(blob, chosen, "u-boot,log-end", end);
+
+	return ret;
+}
+
+LOG_DRIVER(ring) = {
+	.name	= "ring",
+	.flags	= LOGDF_RAW,
+	.emit	= log_ring_emit,
+};
@@ -10,6 +10,7 @@
 #include <autoboot.h>
 #include <cli.h>
 #include <console.h>
+#include <serial.h>
 #include <version.h>
 
 /*
@@ -60,6 +61,8 @@ void main_loop(void)
 
 	autoboot_command(s);
 
+	/* The boot command failed, so show any output held back */
+	serial_flush(false);
 	cli_loop();
 	panic("No CLI available");
 }
@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Heap allocation profiling
+ *
+ * malloc(), calloc(), realloc(), memalign() and free() are wrapped around
+ * the dlmalloc functions (which are renamed dlmalloc(), etc. in malloc.h)
+ * so that every call can be recorded along with its caller. With the
+ * simple malloc() only, malloc_simple.c records its calls directly.
+ *
+ * Call sites are kept in a small hash table. Addresses are recorded as
+ * link-time addresses, so they can be looked up in System.map even after
+ * relocation.
+ */
+
+#include <common.h>
+#include <bloblist.h>
+#include <malloc.h>
+#include <malloc_profile.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define MALLOC_PROFILE_SITES	32
+
+struct malloc_profile_site {
+	ulong caller;
+	uint count;
+	ulong bytes;
+};
+
+/*
+ * This is in the data section since allocations are recorded before
+ * relocation, when BSS is not available. The counts are then carried
+ * over by the relocation.
+ */
+static struct {
+	ulong in_use;
+	ulong peak;
+	uint allocs;
+	uint frees;
+	uint fails;
+	uint dropped;
+	struct malloc_profile_site sites[MALLOC_PROFILE_SITES];
+} mprof __attribute__((section(".data")));
+
+/* Check if @ptr is in the full malloc() heap */
+static bool malloc_profile_in_heap(void *ptr)
+{
+#if !CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
+	ulong addr = (ulong)ptr;
+
+	return (gd->flags & GD_FLG_FULL_MALLOC_INIT) &&
+		addr >= mem_malloc_start && addr < mem_malloc_end;
+#else
+	return false;
+#endif
+}
+
+static void malloc_profile_site(ulong caller, size_t bytes)
+{
+	struct malloc_profile_site *site;
+	int i, start;
+
+	if (!IS_ENABLED(CONFIG_SPL_BUILD) && (gd->flags & GD_FLG_RELOC))
+		caller -= gd->reloc_off;
+
+	start = (caller >> 2) % MALLOC_PROFILE_SITES;
+	for (i = 0; i < MALLOC_PROFILE_SITES; i++) {
+		site = &mprof.sites[(start + i) % MALLOC_PROFILE_SITES];
+		if (site->caller == caller || !site->caller) {
+			site->caller = caller;
+			site->count++;
+			site->bytes += bytes;
+			return;
+		}
+	}
+	mprof.dropped++;
+}
+
+void malloc_profile_alloc(void *ptr, size_t bytes, void *caller)
+{
+	if (!ptr) {
+		mprof.fails++;
+		return;
+	}
+	mprof.allocs++;
+	if (malloc_profile_in_heap(ptr)) {
+		mprof.in_use += malloc_usable_size(ptr);
+		if (mprof.in_use > mprof.peak)
+			mprof.peak = mprof.in_use;
+	}
+	malloc_profile_site((ulong)caller, bytes);
+}
+
+void malloc_profile_free(void *ptr)
+{
+	if (!ptr)
+		return;
+	mprof.frees++;
+	if (malloc_profile_in_heap(ptr))
+		mprof.in_use -= malloc_usable_size(ptr);
+}
+
+#if !CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
+void *malloc(size_t bytes)
+{
+	void *ptr = dlmalloc(bytes);
+
+	malloc_profile_alloc(ptr, bytes, __builtin_return_address(0));
+
+	return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	void *ptr = dlcalloc(nmemb, size);
+
+	malloc_profile_alloc(ptr, nmemb * size, __builtin_return_address(0));
+
+	return ptr;
+}
+
+void *memalign(size_t alignment, size_t bytes)
+{
+	void *ptr = dlmemalign(alignment, bytes);
+
+	malloc_profile_alloc(ptr, bytes, __builtin_return_address(0));
+
+	return ptr;
+}
+
+void *realloc(void *oldmem, size_t bytes)
+{
+	ulong old_size = 0;
+	void *ptr;
+
+	if (oldmem && malloc_profile_in_heap(oldmem))
+		old_size = malloc_usable_size(oldmem);
+	ptr = dlrealloc(oldmem, bytes);
+	if (ptr || !bytes) {
+		if (oldmem)
+			mprof.frees++;
+		mprof.in_use -= old_size;
+	}
+	if (ptr || bytes)
+		malloc_profile_alloc(ptr, bytes, __builtin_return_address(0));
+
+	return ptr;
+}
+
+void free(void *ptr)
+{
+	malloc_profile_free(ptr);
+	dlfree(ptr);
+}
+#endif
+
+static int malloc_profile_site_cmp(const void *a, const void *b)
+{
+	const struct malloc_profile_site *sa = a, *sb = b;
+
+	/* Put unused entries last, then sort by bytes allocated */
+	if (!sa->caller || !sb->caller)
+		return !sa->caller - !sb->caller;
+	if (sa->bytes != sb->bytes)
+		return sa->bytes < sb->bytes ? 1 : -1;
+
+	return 0;
+}
+
+static void malloc_profile_show_hist(void)
+{
+#if !CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
+	uint hist[MALLOC_PROFILE_BUCKETS];
+	ulong largest, top;
+	int i;
+
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return;
+	top = malloc_free_histogram(hist, &largest);
+	printf("Free chunks:\n");
+	for (i = 0; i < MALLOC_PROFILE_BUCKETS; i++) {
+		if (hist[i])
+			printf("  %8lx%s %u\n", 16UL << i,
+			       i == MALLOC_PROFILE_BUCKETS - 1 ? "+" : " ",
+			       hist[i]);
+	}
+	printf("  largest %lx, top %lx, unused %lx\n", largest, top,
+	       mem_malloc_end - mem_malloc_brk);
+#endif
+}
+
+void malloc_profile_show(void)
+{
+	struct malloc_profile_site sites[MALLOC_PROFILE_SITES];
+	int i;
+
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	printf("Early heap: %lx of %lx bytes used\n", gd->malloc_ptr,
+	       gd->malloc_limit);
+#endif
+#if !CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
+	if (gd->flags & GD_FLG_FULL_MALLOC_INIT) {
+		printf("Heap:       %lx of %lx bytes used, at %lx\n",
+		       mem_malloc_brk - mem_malloc_start,
+		       mem_malloc_end - mem_malloc_start, mem_malloc_start);
+	}
+#endif
+	printf("In use:     %lx bytes, peak %lx\n", mprof.in_use, mprof.peak);
+	printf("Calls:      %u allocs, %u frees, %u failed\n", mprof.allocs,
+	       mprof.frees, mprof.fails);
+	malloc_profile_show_hist();
+
+	memcpy(sites, mprof.sites, sizeof(sites));
+	qsort(sites, MALLOC_PROFILE_SITES, sizeof(*sites),
+	      malloc_profile_site_cmp);
+	printf("Call sites:\n");
+	printf("  %-*s %8s %8s\n", (int)sizeof(ulong) * 2, "caller", "count",
+	       "bytes");
+	for (i = 0; i < MALLOC_PROFILE_SITES && sites[i].caller; i++) {
+		printf("  %0*lx %8u %8lx\n", (int)sizeof(ulong) * 2,
+		       sites[i].caller, sites[i].count, sites[i].bytes);
+	}
+	if (mprof.dropped)
+		printf("  (%u allocations from other sites)\n", mprof.dropped);
+}
+
+#if CONFIG_IS_ENABLED(BLOBLIST)
+int malloc_profile_handoff(void)
+{
+	struct malloc_profile_handoff *ho;
+
+	ho = bloblist_ensure(BLOBLISTT_MALLOC_PROFILE, sizeof(*ho));
+	if (!ho)
+		return -ENOSPC;
+	memset(ho, '\0', sizeof(*ho));
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	ho->simple_used = gd->malloc_ptr;
+	ho->simple_size = gd->malloc_limit;
+#endif
+#if !CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
+	if (gd->flags & GD_FLG_FULL_MALLOC_INIT) {
+		ho->heap_used = mem_malloc_brk - mem_malloc_start;
+		ho->heap_size = mem_malloc_end - mem_malloc_start;
+	}
+#endif
+	ho->peak = mprof.peak;
+	ho->allocs = mprof.allocs;
+	ho->frees = mprof.frees;
+	ho->fails = mprof.fails;
+
+	return 0;
+}
+#endif
@@ -9,6 +9,7 @@
 
 #include <common.h>
 #include <malloc.h>
+#include <malloc_profile.h>
 #include <mapmem.h>
 #include <asm/io.h>
 
@@ -34,11 +35,22 @@ static void *alloc_simple(size_t bytes, int align)
 	return ptr;
 }
 
+/*
+ * Record an allocation for CONFIG_MALLOC_PROFILE, unless this is being called
+ * by dlmalloc, which records its own allocations
+ */
+static void profile_simple(void *ptr, size_t bytes, void *caller)
+{
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE))
+		malloc_profile_alloc(ptr, bytes, caller);
+}
+
 void *malloc_simple(size_t bytes)
 {
 	void *ptr;
 
 	ptr = alloc_simple(bytes, 1);
+	profile_simple(ptr, bytes, __builtin_return_address(0));
 	if (!ptr)
 		return ptr;
 
@@ -52,6 +64,7 @@ void *memalign_simple(size_t align, size_t bytes)
 	void *ptr;
 
 	ptr = alloc_simple(bytes, align);
+	profile_simple(ptr, bytes, __builtin_return_address(0));
 	if (!ptr)
 		return ptr;
 	log_debug("aligned to %lx\n", (ulong)ptr);
@@ -65,7 +78,8 @@ void *calloc(size_t nmemb, size_t elem_size)
 	size_t size = nmemb * elem_size;
 	void *ptr;
 
-	ptr = malloc(size);
+	ptr = alloc_simple(size, 1);
+	profile_simple(ptr, size, __builtin_return_address(0));
 	if (!ptr)
 		return ptr;
 	memset(ptr, '\0', size);
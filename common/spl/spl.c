@@ -9,6 +9,7 @@
 #include <common.h>
 #include <bloblist.h>
 #include <binman_sym.h>
+#include <cyclic.h>
 #include <dm.h>
 #include <handoff.h>
 #include <spl.h>
@@ -20,6 +21,7 @@
 #include <version.h>
 #include <image.h>
 #include <malloc.h>
+#include <malloc_profile.h>
 #include <dm/root.h>
 #include <linux/compiler.h>
 #include <fdt_support.h>
@@ -351,6 +353,9 @@ static int setup_spl_handoff(void)
 	ho = bloblist_ensure(BLOBLISTT_SPL_HANDOFF, sizeof(struct spl_handoff));
 	if (!ho)
 		return -ENOENT;
+#ifdef CONFIG_HANDOFF_DEVICES
+	handoff_init_devices(ho);
+#endif
 
 	return 0;
 }
@@ -363,6 +368,9 @@ static int write_spl_handoff(void)
 	if (!ho)
 		return -ENOENT;
 	handoff_save_dram(ho);
+#ifdef CONFIG_HANDOFF_DEVICES
+	handoff_save_console(ho);
+#endif
 #ifdef CONFIG_SANDBOX
 	ho->arch.magic = TEST_HANDOFF_MAGIC;
 #endif
@@ -678,6 +686,8 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 		hang();
 	}
 
+	/* The next phase cannot run our background tasks */
+	cyclic_wait_all();
 	spl_perform_fixups(&spl_image);
 	if (CONFIG_IS_ENABLED(HANDOFF)) {
 		ret = write_spl_handoff();
@@ -685,6 +695,13 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 			printf(SPL_TPL_PROMPT
 			       "SPL hand-off write failed (err=%d)\n", ret);
 	}
+	if (CONFIG_IS_ENABLED(MALLOC_PROFILE) && CONFIG_IS_ENABLED(BLOBLIST)) {
+		ret = malloc_profile_handoff();
+		if (ret)
+			debug("Failed to write malloc profile (err=%d)\n", ret);
+	}
+	/* The ring holds pointers into this image, so format it now */
+	log_ring_finish();
 	if (CONFIG_IS_ENABLED(BLOBLIST)) {
 		ret = bloblist_finish();
 		if (ret)
@@ -10,6 +10,7 @@
 #include <image.h>
 #include <linux/libfdt.h>
 #include <spl.h>
+#include <u-boot/zstd.h>
 
 #ifndef CONFIG_SYS_BOOTM_LEN
 #define CONFIG_SYS_BOOTM_LEN	(64 << 20)
@@ -150,6 +151,151 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return (data_size + info->bl_len - 1) / info->bl_len;
 }
 
+#if CONFIG_IS_ENABLED(FIT_READ_WINDOW)
+/*
+ * Read window for the external data of a FIT
+ *
+ * The external data of all the images of the configuration is read with a
+ * single read to the window, if it fits, and the reads of the single images
+ * are then served from there. A read for an image whose data is outside the
+ * window goes to the device as before.
+ */
+struct spl_fit_window {
+	struct spl_load_info info;	/* reads through the window */
+	struct spl_load_info *dev;	/* reads from the device */
+	ulong sector;			/* start sector of the FIT */
+	ulong start;			/* window start, in units from @sector */
+	ulong count;			/* window size, in units */
+	void *buf;
+	bool valid;
+};
+
+static ulong spl_fit_window_unit(struct spl_load_info *info)
+{
+	/* File system reads are in bytes */
+	return info->filename ? 1 : info->bl_len;
+}
+
+static ulong spl_fit_window_read(struct spl_load_info *load, ulong sector,
+				 ulong count, void *buf)
+{
+	struct spl_fit_window *win = container_of(load, struct spl_fit_window,
+						  info);
+	ulong unit = spl_fit_window_unit(load);
+	void *buf_end = buf + count * unit;
+	void *win_end = win->buf + win->count * unit;
+
+	if (win->valid && sector >= win->sector + win->start &&
+	    sector + count <= win->sector + win->start + win->count) {
+		/* memmove() as the destination may overlap the window */
+		memmove(buf, win->buf +
+			(sector - win->sector - win->start) * unit,
+			count * unit);
+		if (buf < win_end && buf_end > win->buf)
+			win->valid = false;
+		return count;
+	}
+
+	if (buf < win_end && buf_end > win->buf)
+		win->valid = false;
+
+	return win->dev->read(win->dev, sector, count, buf);
+}
+
+/* Note that memory was written to without a read, by a decompressor */
+static void spl_fit_window_written(struct spl_load_info *info, ulong addr,
+				   ulong len)
+{
+	struct spl_fit_window *win;
+
+	if (info->read != spl_fit_window_read)
+		return;
+	win = container_of(info, struct spl_fit_window, info);
+	if (addr < (ulong)win->buf + win->count * spl_fit_window_unit(info) &&
+	    addr + len > (ulong)win->buf)
+		win->valid = false;
+}
+
+/**
+ * spl_fit_window_open() - read the external data of a configuration at once
+ * @win:	window to set up
+ * @info:	points to information about the device to load data from
+ * @sector:	the start sector of the FIT image on the device
+ * @fit:	points to the flattened device tree blob describing the FIT
+ * @images:	offset of the /images node
+ * @base_offset: the beginning of the data area, relative to the FIT
+ *
+ * Return:	the load info to read the images through, which is @info if
+ *		the data does not fit into the window or the read failed
+ */
+static struct spl_load_info *spl_fit_window_open(struct spl_fit_window *win,
+						 struct spl_load_info *info,
+						 ulong sector, const void *fit,
+						 int images, int base_offset)
+{
+	static const char * const props[] = {
+		FIT_FIRMWARE_PROP, FIT_FDT_PROP, FIT_LOADABLE_PROP,
+#ifdef CONFIG_SPL_OS_BOOT
+		FIT_KERNEL_PROP,
+#endif
+#ifdef CONFIG_SPL_FPGA_SUPPORT
+		"fpga",
+#endif
+	};
+	ulong unit = spl_fit_window_unit(info);
+	ulong start = ULONG_MAX, end = 0;
+	int i, index, node, offset, len;
+
+	for (i = 0; i < ARRAY_SIZE(props); i++) {
+		for (index = 0; ; index++) {
+			node = spl_fit_get_image_node(fit, images, props[i],
+						      index);
+			if (node < 0)
+				break;
+			if (!fit_image_get_data_offset(fit, node, &offset))
+				offset += base_offset;
+			else if (fit_image_get_data_position(fit, node,
+							     &offset))
+				continue;
+			if (fit_image_get_data_size(fit, node, &len))
+				continue;
+			start = min(start, (ulong)offset);
+			end = max(end, (ulong)offset + len);
+		}
+	}
+	if (start >= end)
+		return info;
+
+	win->start = get_aligned_image_offset(info, start);
+	win->count = get_aligned_image_size(info, end - start, start);
+	if (win->count * unit > CONFIG_SPL_FIT_READ_WINDOW_SIZE) {
+		debug("FIT data %lx..%lx does not fit the read window\n",
+		      start, end);
+		return info;
+	}
+
+	win->buf = (void *)CONFIG_SPL_FIT_READ_WINDOW_ADDR;
+	if (info->read(info, sector + win->start, win->count, win->buf) !=
+	    win->count)
+		return info;
+	debug("FIT data %lx..%lx read to the window at %p\n", start, end,
+	      win->buf);
+
+	win->info = *info;
+	win->info.read = spl_fit_window_read;
+	win->dev = info;
+	win->sector = sector;
+	win->valid = true;
+
+	return &win->info;
+}
+#else
+static void spl_fit_window_written(struct spl_load_info *info, ulong addr,
+				   ulong len)
+{
+}
+#endif
+
 /**
  * spl_load_fit_image(): load the image described in a certain FIT node
  * @info:	points to information about the device to load data from
@@ -183,16 +329,18 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	uint8_t image_comp = -1, type = -1;
 	const void *data;
 	bool external_data = false;
+	bool decomp = IS_ENABLED(CONFIG_SPL_GZIP) ||
+		      IS_ENABLED(CONFIG_SPL_LZ4) ||
+		      IS_ENABLED(CONFIG_SPL_ZSTD);
 
-	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) ||
-	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP))) {
+	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) || decomp) {
 		if (fit_image_get_type(fit, node, &type))
 			puts("Cannot get image type.\n");
 		else
 			debug("%s ", genimg_get_type_name(type));
 	}
 
-	if (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP)) {
+	if (decomp) {
 		if (fit_image_get_comp(fit, node, &image_comp))
 			puts("Cannot get image compression format.\n");
 		else
@@ -214,10 +362,28 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		if (fit_image_get_data_size(fit, node, &len))
 			return -ENOENT;
 
-		load_ptr = (load_addr + align_len) & ~align_len;
+		overhead = get_aligned_image_overhead(info, offset);
+		/*
+		 * A compressed image cannot be read where it is to be
+		 * decompressed, it goes to the load buffer instead
+		 */
+		if (image_comp == IH_COMP_GZIP || image_comp == IH_COMP_LZ4 ||
+		    image_comp == IH_COMP_ZSTD)
+			load_ptr = (CONFIG_SYS_LOAD_ADDR + align_len) &
+				   ~align_len;
+		else if (!((load_addr - overhead) & align_len))
+			/*
+			 * The data sits as far into its first block as the
+			 * load address is past an aligned address, which
+			 * mkimage -B makes sure of, so it can be read in
+			 * place. Like the bytes after the image, those in
+			 * front of the load address are overwritten then.
+			 */
+			load_ptr = load_addr - overhead;
+		else
+			load_ptr = (load_addr + align_len) & ~align_len;
 		length = len;
 
-		overhead = get_aligned_image_overhead(info, offset);
 		nr_sectors = get_aligned_image_size(info, length, offset);
 
 		if (info->read(info,
@@ -260,9 +426,27 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 			return -EIO;
 		}
 		length = size;
-	} else {
+	} else if (IS_ENABLED(CONFIG_SPL_LZ4) && image_comp == IH_COMP_LZ4) {
+		size_t lsize = CONFIG_SYS_BOOTM_LEN;
+
+		if (ulz4fn(src, length, (void *)load_addr, &lsize)) {
+			puts("Uncompressing error\n");
+			return -EIO;
+		}
+		length = lsize;
+	} else if (IS_ENABLED(CONFIG_SPL_ZSTD) &&
+		   image_comp == IH_COMP_ZSTD) {
+		size_t zsize = CONFIG_SYS_BOOTM_LEN;
+
+		if (zstd_decompress(src, length, (void *)load_addr, &zsize)) {
+			puts("Uncompressing error\n");
+			return -EIO;
+		}
+		length = zsize;
+	} else if (src != (void *)load_addr) {
 		memcpy((void *)load_addr, src, length);
 	}
+	spl_fit_window_written(info, load_addr, length);
 
 	if (image_info) {
 		image_info->load_addr = load_addr;
@@ -362,6 +546,9 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	int base_offset, hsize, align_len = ARCH_DMA_MINALIGN - 1;
 	int index = 0;
 	int firmware_node;
+#if CONFIG_IS_ENABLED(FIT_READ_WINDOW)
+	struct spl_fit_window win;
+#endif
 
 	/*
 	 * For FIT with external data, figure out where the external images
@@ -411,6 +598,11 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 		return -1;
 	}
 
+#if CONFIG_IS_ENABLED(FIT_READ_WINDOW)
+	info = spl_fit_window_open(&win, info, sector, fit, images,
+				   base_offset);
+#endif
+
 #ifdef CONFIG_SPL_FPGA_SUPPORT
 	node = spl_fit_get_image_node(fit, images, "fpga", 0);
 	if (node >= 0) {
@@ -484,10 +676,12 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 #endif
 
 	/*
-	 * Booting a next-stage U-Boot may require us to append the FDT.
-	 * We allow this to fail, as the U-Boot image might embed its FDT.
+	 * Booting a next-stage U-Boot, or Linux in falcon mode, may require
+	 * us to append the FDT. We allow this to fail, as the U-Boot image
+	 * might embed its FDT.
 	 */
-	if (spl_image->os == IH_OS_U_BOOT)
+	if (spl_image->os == IH_OS_U_BOOT ||
+	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && spl_image->os == IH_OS_LINUX))
 		spl_fit_append_fdt(spl_image, info, sector, fit,
 				   images, base_offset);
 
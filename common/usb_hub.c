@@ -53,6 +53,7 @@ struct usb_device_scan {
 };
 
 static LIST_HEAD(usb_scan_list);
+static bool usb_scan_deferred;
 
 __weak void usb_hub_reset_devices(struct usb_hub_device *hub, int port)
 {
@@ -600,6 +601,15 @@ out:
 	return ret;
 }
 
+int usb_hub_defer_scan(bool defer)
+{
+	usb_scan_deferred = defer;
+	if (defer)
+		return 0;
+
+	return usb_device_list_scan();
+}
+
 static struct usb_hub_device *usb_get_hub_device(struct usb_device *dev)
 {
 	struct usb_hub_device *hub;
@@ -872,8 +882,11 @@ static int usb_hub_configure(struct usb_device *dev)
 	}
 
 	/*
-	 * And now call the scanning code which loops over the generated list
+	 * And now call the scanning code which loops over the generated list,
+	 * unless usb_hub_defer_scan() wants the ports of more hubs in it first
 	 */
+	if (usb_scan_deferred)
+		return 0;
 	ret = usb_device_list_scan();
 
 	return ret;
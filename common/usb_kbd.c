@@ -106,6 +106,8 @@ struct usb_kbd_pdata {
 	int		intpktsize;
 	int		intinterval;
 	unsigned long	last_report;
+	unsigned long	last_poll;
+	unsigned int	poll_ms;
 	struct int_queue *intq;
 
 	uint32_t	repeat_delay;
@@ -351,10 +353,20 @@ static inline void usb_kbd_poll_for_event(struct usb_device *dev)
 #endif
 }
 
+/* Poll for a new report at most once every poll_ms */
+static void usb_kbd_poll_if_due(struct usb_device *dev)
+{
+	struct usb_kbd_pdata *data = dev->privptr;
+
+	if (get_timer(data->last_poll) < data->poll_ms)
+		return;
+	usb_kbd_poll_for_event(dev);
+	data->last_poll = get_timer(0);
+}
+
 /* test if a character is in the queue */
 static int usb_kbd_testc(struct stdio_dev *sdev)
 {
-	struct stdio_dev *dev;
 	struct usb_device *usb_kbd_dev;
 	struct usb_kbd_pdata *data;
 
@@ -368,11 +380,10 @@ static int usb_kbd_testc(struct stdio_dev *sdev)
 		return 0;
 	kbd_testc_tms = get_timer(0);
 #endif
-	dev = stdio_get_by_name(sdev->name);
-	usb_kbd_dev = (struct usb_device *)dev->priv;
+	usb_kbd_dev = (struct usb_device *)sdev->priv;
 	data = usb_kbd_dev->privptr;
 
-	usb_kbd_poll_for_event(usb_kbd_dev);
+	usb_kbd_poll_if_due(usb_kbd_dev);
 
 	return !(data->usb_in_pointer == data->usb_out_pointer);
 }
@@ -380,17 +391,15 @@ static int usb_kbd_testc(struct stdio_dev *sdev)
 /* gets the character from the queue */
 static int usb_kbd_getc(struct stdio_dev *sdev)
 {
-	struct stdio_dev *dev;
 	struct usb_device *usb_kbd_dev;
 	struct usb_kbd_pdata *data;
 
-	dev = stdio_get_by_name(sdev->name);
-	usb_kbd_dev = (struct usb_device *)dev->priv;
+	usb_kbd_dev = (struct usb_device *)sdev->priv;
 	data = usb_kbd_dev->privptr;
 
 	while (data->usb_in_pointer == data->usb_out_pointer) {
 		WATCHDOG_RESET();
-		usb_kbd_poll_for_event(usb_kbd_dev);
+		usb_kbd_poll_if_due(usb_kbd_dev);
 	}
 
 	if (data->usb_out_pointer == USB_KBD_BUFFER_LEN - 1)
@@ -461,6 +470,14 @@ static int usb_kbd_probe_dev(struct usb_device *dev, unsigned int ifnum)
 	data->intinterval = ep->bInterval;
 	data->last_report = -1;
 
+	/* bInterval is in ms, or 2^(bInterval-1) microframes at high speed */
+	data->poll_ms = ep->bInterval;
+	if (dev->speed == USB_SPEED_HIGH)
+		data->poll_ms =
+			(1 << (clamp_t(uint, ep->bInterval, 1, 16) - 1)) / 8;
+	data->poll_ms = max_t(unsigned int, data->poll_ms,
+			      CONFIG_USB_KEYBOARD_POLL_MS);
+
 	/* We found a USB Keyboard, install it. */
 	usb_set_protocol(dev, iface->desc.bInterfaceNumber, 0);
 
@@ -36,10 +36,12 @@
 #include <command.h>
 #include <dm.h>
 #include <errno.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <memalign.h>
 #include <asm/byteorder.h>
 #include <asm/processor.h>
+#include <asm/unaligned.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 
@@ -97,6 +99,9 @@ struct us_data {
 	trans_reset	transport_reset;	/* reset routine */
 	trans_cmnd	transport;		/* transport routine */
 	unsigned short	max_xfer_blk;		/* maximum transfer blocks */
+#if CONFIG_IS_ENABLED(USB_UAS)
+	struct us_uas	*uas;			/* set when speaking UAS */
+#endif
 };
 
 #if !CONFIG_IS_ENABLED(BLK)
@@ -171,6 +176,12 @@ static unsigned int usb_get_max_lun(struct us_data *us)
 {
 	int len;
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, result, 1);
+
+#if CONFIG_IS_ENABLED(USB_UAS)
+	/* This is a BBB request, UAS would need REPORT LUNS */
+	if (us->uas)
+		return 0;
+#endif
 	len = usb_control_msg(us->pusb_dev,
 			      usb_rcvctrlpipe(us->pusb_dev, 0),
 			      US_BBB_GET_MAX_LUN,
@@ -700,12 +711,80 @@ static int usb_stor_BBB_clear_endpt_stall(struct us_data *us, __u8 endpt)
 			       endpt, NULL, 0, USB_CNTL_TIMEOUT * 5);
 }
 
+#if CONFIG_IS_ENABLED(DM_USB)
+/* As long as the synchronous transfers of xHCI wait */
+#define BBB_QUEUE_TIMEOUT_MS	5000
+
+/*
+ * Where the controller can queue transfers, ask for the CSW along with the
+ * data, so that the device can send it as soon as it is done with the data:
+ * that makes one wait per command instead of two. Returns -ENOSYS if nothing
+ * could be queued, else the result of the data phase. If that is OK too,
+ * @csw_result tells how the status phase went.
+ */
+static int usb_stor_BBB_queue(struct us_data *us, struct scsi_cmd *srb,
+			      unsigned int pipe, struct umass_bbb_csw *csw,
+			      int *data_actlen, int *csw_result, int *csw_actlen)
+{
+	struct usb_device *udev = us->pusb_dev;
+	unsigned int pipein = usb_rcvbulkpipe(udev, us->ep_in);
+	struct usb_stream_xfer data = {
+		.pipe = pipe,
+		.buffer = srb->pdata,
+		.length = srb->datalen,
+	};
+	struct usb_stream_xfer status = {
+		.pipe = pipein,
+		.buffer = csw,
+		.length = UMASS_BBB_CSW_SIZE,
+	};
+	bool csw_queued;
+	int ret;
+
+	if (usb_submit_stream_xfer(udev, &data))
+		return -ENOSYS;
+	csw_queued = !usb_submit_stream_xfer(udev, &status);
+
+	ret = usb_wait_stream_xfer(udev, &data, BBB_QUEUE_TIMEOUT_MS);
+	if (ret || data.status || !csw_queued) {
+		/* The CSW is then read on its own, if at all */
+		usb_cancel_stream_xfers(udev, pipe);
+		usb_cancel_stream_xfers(udev, pipein);
+	}
+	*data_actlen = data.act_len;
+	*csw_result = -ENOENT;
+	if (ret) {
+		debug("DATA: timeout\n");
+		udev->status = USB_ST_NAK_REC;
+		return -1;
+	}
+	udev->status = data.status;
+	if (data.status)
+		return -1;
+	if (!csw_queued)
+		return 0;
+
+	ret = usb_wait_stream_xfer(udev, &status, BBB_QUEUE_TIMEOUT_MS);
+	if (ret || status.status) {
+		usb_cancel_stream_xfers(udev, pipein);
+		udev->status = ret ? USB_ST_NAK_REC : status.status;
+		*csw_result = -1;
+	} else {
+		*csw_actlen = status.act_len;
+		*csw_result = 0;
+	}
+
+	return 0;
+}
+#endif
+
 static int usb_stor_BBB_transport(struct scsi_cmd *srb, struct us_data *us)
 {
 	int result, retry;
 	int dir_in;
 	int actlen, data_actlen;
 	unsigned int pipe, pipein, pipeout;
+	int csw_result = -ENOENT;
 	ALLOC_CACHE_ALIGN_BUFFER(struct umass_bbb_csw, csw, 1);
 #ifdef BBB_XPORT_TRACE
 	unsigned char *ptr;
@@ -738,8 +817,14 @@ static int usb_stor_BBB_transport(struct scsi_cmd *srb, struct us_data *us)
 	else
 		pipe = pipeout;
 
-	result = usb_bulk_msg(us->pusb_dev, pipe, srb->pdata, srb->datalen,
-			      &data_actlen, USB_CNTL_TIMEOUT * 5);
+#if CONFIG_IS_ENABLED(DM_USB)
+	result = usb_stor_BBB_queue(us, srb, pipe, csw, &data_actlen,
+				    &csw_result, &actlen);
+	if (result == -ENOSYS)
+#endif
+		result = usb_bulk_msg(us->pusb_dev, pipe, srb->pdata,
+				      srb->datalen, &data_actlen,
+				      USB_CNTL_TIMEOUT * 5);
 	/* special handling of STALL in DATA phase */
 	if ((result < 0) && (us->pusb_dev->status & USB_ST_STALLED)) {
 		debug("DATA:stall\n");
@@ -766,8 +851,15 @@ st:
 	retry = 0;
 again:
 	debug("STATUS phase\n");
-	result = usb_bulk_msg(us->pusb_dev, pipein, csw, UMASS_BBB_CSW_SIZE,
-				&actlen, USB_CNTL_TIMEOUT*5);
+	/* A CSW which came along with the data is only used once */
+	if (csw_result != -ENOENT) {
+		result = csw_result;
+		csw_result = -ENOENT;
+	} else {
+		result = usb_bulk_msg(us->pusb_dev, pipein, csw,
+				      UMASS_BBB_CSW_SIZE, &actlen,
+				      USB_CNTL_TIMEOUT * 5);
+	}
 
 	/* special handling of STALL in STATUS phase */
 	if ((result < 0) && (retry < 1) &&
@@ -935,6 +1027,433 @@ do_retry:
 	return USB_STOR_TRANSPORT_FAILED;
 }
 
+#if CONFIG_IS_ENABLED(USB_UAS)
+/*
+ * USB Attached SCSI over bulk streams
+ *
+ * Each command has a tag, which is also the stream of its data and status.
+ * The Command IU goes on the command pipe, which has no streams. Reads and
+ * writes keep up to UAS_MAX_CMDS commands queued, so that the device never
+ * waits for us between two of them.
+ */
+#define UAS_MAX_CMDS		8
+#define UAS_TIMEOUT_MS		5000	/* without any command completing */
+
+struct uas_cmd {
+	struct usb_stream_xfer	cmd;
+	struct usb_stream_xfer	status;
+	struct usb_stream_xfer	data;
+	bool			busy;
+	lbaint_t		blk;		/* first block of a read/write */
+	/* DMA buffers, each on cache lines of its own */
+	u8 cmd_iu[ALIGN(sizeof(struct uas_cmd_iu), ARCH_DMA_MINALIGN)]
+		__aligned(ARCH_DMA_MINALIGN);
+	u8 sense_iu[ALIGN(sizeof(struct uas_sense_iu), ARCH_DMA_MINALIGN)]
+		__aligned(ARCH_DMA_MINALIGN);
+};
+
+struct us_uas {
+	struct usb_interface	iface;		/* the UAS setting */
+	u8			ep[4];		/* by UAS_PIPE_... - 1 */
+	int			num_cmds;
+	struct uas_cmd		*cmd;		/* tag is index + 1 */
+	bool			need_reset;	/* data left on a stream */
+	/* Sense data from the last status, for the next REQUEST SENSE */
+	u8			sense[18];
+	int			sense_len;
+};
+
+static int usb_uas_submit(struct us_data *ss, int tag, const u8 *cdb,
+			  int cdb_len, int lun, void *data, int datalen,
+			  bool dir_in)
+{
+	struct usb_device *udev = ss->pusb_dev;
+	struct us_uas *uas = ss->uas;
+	struct uas_cmd *c = &uas->cmd[tag - 1];
+	struct uas_cmd_iu *iu = (struct uas_cmd_iu *)c->cmd_iu;
+	u8 ep;
+	int ret;
+
+	memset(iu, '\0', sizeof(*iu));
+	iu->bIUID = UAS_IU_ID_COMMAND;
+	iu->wTag = cpu_to_be16(tag);
+	iu->bPrioAttr = UAS_SIMPLE_TAG;
+	iu->LUN[1] = lun;
+	memcpy(iu->CDB, cdb, min(cdb_len, (int)sizeof(iu->CDB)));
+
+	/* The device may send the status as soon as it has the command */
+	c->status.pipe = usb_rcvbulkpipe(udev, uas->ep[UAS_PIPE_STATUS - 1]);
+	c->status.stream_id = tag;
+	c->status.buffer = c->sense_iu;
+	c->status.length = sizeof(struct uas_sense_iu);
+	ret = usb_submit_stream_xfer(udev, &c->status);
+	if (ret)
+		return ret;
+
+	c->data.length = datalen;
+	c->data.done = true;
+	if (datalen) {
+		ep = uas->ep[(dir_in ? UAS_PIPE_DATA_IN : UAS_PIPE_DATA_OUT) - 1];
+		c->data.pipe = dir_in ? usb_rcvbulkpipe(udev, ep) :
+					usb_sndbulkpipe(udev, ep);
+		c->data.stream_id = tag;
+		c->data.buffer = data;
+		ret = usb_submit_stream_xfer(udev, &c->data);
+		if (ret)
+			return ret;
+	}
+
+	c->cmd.pipe = usb_sndbulkpipe(udev, uas->ep[UAS_PIPE_CMD - 1]);
+	c->cmd.stream_id = 0;
+	c->cmd.buffer = iu;
+	c->cmd.length = sizeof(*iu);
+	ret = usb_submit_stream_xfer(udev, &c->cmd);
+	if (ret)
+		return ret;
+	c->busy = true;
+
+	return 0;
+}
+
+/* Is the command over, leaving its data transfer behind if it failed? */
+static bool usb_uas_cmd_over(struct uas_cmd *c)
+{
+	struct uas_sense_iu *iu = (struct uas_sense_iu *)c->sense_iu;
+
+	if (!c->cmd.done || !c->status.done)
+		return false;
+
+	return c->data.done || c->status.status ||
+	       iu->bIUID != UAS_IU_ID_STATUS || iu->bStatus != UAS_STATUS_GOOD;
+}
+
+static int usb_uas_result(struct us_uas *uas, struct uas_cmd *c,
+			  struct scsi_cmd *srb)
+{
+	struct uas_sense_iu *iu = (struct uas_sense_iu *)c->sense_iu;
+	int len;
+
+	c->busy = false;
+	if (!c->data.done)
+		uas->need_reset = true;
+	if (c->cmd.status || c->status.status) {
+		debug("UAS: command IU %lx, status IU %lx\n", c->cmd.status,
+		      c->status.status);
+		uas->need_reset = true;
+		return USB_STOR_TRANSPORT_ERROR;
+	}
+	if (iu->bIUID != UAS_IU_ID_STATUS) {
+		debug("UAS: IU %02x for tag %d\n", iu->bIUID,
+		      be16_to_cpu(iu->wTag));
+		return USB_STOR_TRANSPORT_ERROR;
+	}
+
+	switch (iu->bStatus) {
+	case UAS_STATUS_GOOD:
+		if (c->data.status)
+			return USB_STOR_TRANSPORT_ERROR;
+		if (srb)
+			srb->trans_bytes = c->data.act_len;
+		return USB_STOR_TRANSPORT_GOOD;
+	case UAS_STATUS_CHECK_COND:
+		len = min_t(int, be16_to_cpu(iu->wLength), sizeof(uas->sense));
+		memcpy(uas->sense, iu->SenseData, len);
+		uas->sense_len = len;
+		if (srb)
+			memcpy(srb->sense_buf, iu->SenseData, len);
+		debug("UAS: sense %02X %02X %02X\n", uas->sense[2],
+		      uas->sense[12], uas->sense[13]);
+		/* fallthrough */
+	default:
+		return USB_STOR_TRANSPORT_FAILED;
+	}
+}
+
+/*
+ * Give up on whatever is still queued: setting the streams up again gives
+ * the endpoints fresh rings.
+ */
+static int usb_stor_uas_reset(struct us_data *ss)
+{
+	struct us_uas *uas = ss->uas;
+	int i, ret;
+
+	debug("UAS: resetting the streams\n");
+	ret = usb_alloc_streams(ss->pusb_dev, &uas->iface, uas->num_cmds);
+	for (i = 0; i < uas->num_cmds; i++)
+		uas->cmd[i].busy = false;
+	uas->need_reset = false;
+	if (ret < 0) {
+		printf("UAS: can't reset the streams: %d\n", ret);
+		return ret;
+	}
+	for (i = 0; i < ARRAY_SIZE(uas->ep); i++) {
+		usb_clear_halt(ss->pusb_dev, uas->ep[i] & USB_DIR_IN ?
+			       usb_rcvbulkpipe(ss->pusb_dev, uas->ep[i]) :
+			       usb_sndbulkpipe(ss->pusb_dev, uas->ep[i]));
+	}
+
+	return 0;
+}
+
+static int usb_stor_uas_transport(struct scsi_cmd *srb, struct us_data *ss)
+{
+	struct us_uas *uas = ss->uas;
+	struct uas_cmd *c = &uas->cmd[0];
+	ulong start;
+	int ret;
+
+	/* The status of the last command came with its sense data */
+	if (srb->cmd[0] == SCSI_REQ_SENSE && uas->sense_len) {
+		memcpy(srb->pdata, uas->sense,
+		       min_t(int, srb->datalen, uas->sense_len));
+		uas->sense_len = 0;
+		return USB_STOR_TRANSPORT_GOOD;
+	}
+	uas->sense_len = 0;
+
+	ret = usb_uas_submit(ss, 1, srb->cmd, srb->cmdlen, srb->lun,
+			     srb->pdata, srb->datalen,
+			     US_DIRECTION(srb->cmd[0]));
+	start = get_timer(0);
+	while (!ret && !usb_uas_cmd_over(c)) {
+		usb_poll_stream_xfers(ss->pusb_dev);
+		if (get_timer(start) > UAS_TIMEOUT_MS)
+			ret = -ETIMEDOUT;
+	}
+	if (ret) {
+		debug("UAS: command %02x failed: %d\n", srb->cmd[0], ret);
+		usb_stor_uas_reset(ss);
+		return USB_STOR_TRANSPORT_ERROR;
+	}
+
+	ret = usb_uas_result(uas, c, srb);
+	if (uas->need_reset)
+		usb_stor_uas_reset(ss);
+
+	return ret;
+}
+
+/*
+ * Read or write with all the tags busy. Returns how many blocks from
+ * @start on went through fine.
+ */
+static lbaint_t usb_uas_rw(struct us_data *ss, struct blk_desc *block_dev,
+			   lbaint_t start, lbaint_t blkcnt, void *buffer,
+			   bool write)
+{
+	struct us_uas *uas = ss->uas;
+	struct uas_cmd *c;
+	lbaint_t next = 0, good = blkcnt;
+	unsigned short blks;
+	bool busy;
+	ulong last;
+	u8 cdb[10];
+	int i;
+
+	uas->sense_len = 0;
+	last = get_timer(0);
+	do {
+		busy = false;
+		for (i = 0; i < uas->num_cmds; i++) {
+			c = &uas->cmd[i];
+			if (!c->busy && next < blkcnt && good == blkcnt) {
+				blks = min_t(lbaint_t, blkcnt - next,
+					     ss->max_xfer_blk);
+				memset(cdb, '\0', sizeof(cdb));
+				cdb[0] = write ? SCSI_WRITE10 : SCSI_READ10;
+				put_unaligned_be32(start + next, &cdb[2]);
+				put_unaligned_be16(blks, &cdb[7]);
+				c->blk = next;
+				if (usb_uas_submit(ss, i + 1, cdb, sizeof(cdb),
+						   block_dev->lun,
+						   buffer + next * block_dev->blksz,
+						   blks * block_dev->blksz,
+						   !write)) {
+					/* Whatever got queued is stuck */
+					uas->need_reset = true;
+					good = next;
+					continue;
+				}
+				next += blks;
+				usb_show_progress();
+			}
+			if (c->busy)
+				busy = true;
+		}
+		if (!busy)
+			break;
+
+		usb_poll_stream_xfers(ss->pusb_dev);
+		for (i = 0; i < uas->num_cmds; i++) {
+			c = &uas->cmd[i];
+			if (!c->busy || !usb_uas_cmd_over(c))
+				continue;
+			if (usb_uas_result(uas, c, NULL))
+				good = min(good, c->blk);
+			last = get_timer(0);
+		}
+
+		if (get_timer(last) > UAS_TIMEOUT_MS) {
+			debug("UAS: %s timed out\n", write ? "write" : "read");
+			for (i = 0; i < uas->num_cmds; i++) {
+				if (uas->cmd[i].busy)
+					good = min(good, uas->cmd[i].blk);
+			}
+			uas->need_reset = true;
+			break;
+		}
+	} while (1);
+
+	if (uas->need_reset)
+		usb_stor_uas_reset(ss);
+
+	return good;
+}
+
+static lbaint_t usb_stor_uas_rw(struct us_data *ss, struct blk_desc *block_dev,
+				lbaint_t start, lbaint_t blkcnt, void *buffer,
+				bool write)
+{
+	lbaint_t done = 0;
+	int retry = 2;
+
+	debug("\nusb_%s: dev %d startblk " LBAF ", blccnt " LBAF " buffer %p\n",
+	      write ? "write" : "read", block_dev->devnum, start, blkcnt,
+	      buffer);
+
+	do {
+		done += usb_uas_rw(ss, block_dev, start + done, blkcnt - done,
+				   buffer + done * block_dev->blksz, write);
+	} while (done < blkcnt && retry--);
+
+	return done;
+}
+
+/* Switch from BBB to the UAS setting of the interface, if it has one */
+static int usb_stor_uas_probe(struct usb_device *dev, struct us_data *ss)
+{
+	struct usb_descriptor_header *head;
+	struct usb_interface_descriptor *if_desc;
+	struct usb_endpoint_descriptor *ep_desc;
+	struct usb_interface *iface;
+	struct us_uas *uas;
+	bool found = false;
+	u8 *buf;
+	int len, index, i, ret;
+
+	uas = calloc(1, sizeof(*uas));
+	if (!uas)
+		return -ENOMEM;
+	iface = &uas->iface;
+
+	len = usb_get_configuration_len(dev, 0);
+	buf = len > 0 ? malloc_cache_aligned(len) : NULL;
+	if (!buf) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	ret = usb_get_configuration_no(dev, 0, buf, len);
+	if (ret < 0)
+		goto err;
+
+	/* Gather the endpoints of the UAS setting and their pipe usage */
+	for (index = 0; index + 2 <= len; index += head->bLength) {
+		head = (struct usb_descriptor_header *)&buf[index];
+		if (head->bLength < 2 || index + head->bLength > len)
+			break;
+
+		switch (head->bDescriptorType) {
+		case USB_DT_INTERFACE:
+			if (found || head->bLength < USB_DT_INTERFACE_SIZE)
+				goto done;
+			if_desc = (struct usb_interface_descriptor *)head;
+			if (if_desc->bInterfaceNumber == ss->ifnum &&
+			    if_desc->bInterfaceClass ==
+			    USB_CLASS_MASS_STORAGE &&
+			    if_desc->bInterfaceSubClass == US_SC_SCSI &&
+			    if_desc->bInterfaceProtocol == US_PR_UAS) {
+				memcpy(&iface->desc, head,
+				       USB_DT_INTERFACE_SIZE);
+				found = true;
+			}
+			break;
+		case USB_DT_ENDPOINT:
+			if (!found || head->bLength < USB_DT_ENDPOINT_SIZE)
+				break;
+			if (iface->no_of_ep == USB_MAXENDPOINTS)
+				goto done;
+			ep_desc = &iface->ep_desc[iface->no_of_ep++];
+			memcpy(ep_desc, head, USB_DT_ENDPOINT_SIZE);
+			put_unaligned(get_unaligned_le16(
+						&ep_desc->wMaxPacketSize),
+				      &ep_desc->wMaxPacketSize);
+			break;
+		case USB_DT_SS_ENDPOINT_COMP:
+			if (found && iface->no_of_ep &&
+			    head->bLength >= USB_DT_SS_EP_COMP_SIZE)
+				memcpy(&iface->ss_ep_comp_desc
+				       [iface->no_of_ep - 1], head,
+				       USB_DT_SS_EP_COMP_SIZE);
+			break;
+		case USB_DT_PIPE_USAGE:
+			i = buf[index + 2];
+			if (found && iface->no_of_ep && head->bLength >= 4 &&
+			    i >= UAS_PIPE_CMD && i <= UAS_PIPE_DATA_OUT)
+				uas->ep[i - 1] = iface->ep_desc
+					[iface->no_of_ep - 1].bEndpointAddress;
+			break;
+		}
+	}
+done:
+	free(buf);
+	buf = NULL;
+	for (i = 0; i < ARRAY_SIZE(uas->ep); i++) {
+		if (!uas->ep[i])
+			found = false;
+	}
+	if (!found) {
+		ret = -ENOENT;
+		goto err;
+	}
+
+	uas->cmd = memalign(ARCH_DMA_MINALIGN,
+			    UAS_MAX_CMDS * sizeof(struct uas_cmd));
+	if (!uas->cmd) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	memset(uas->cmd, '\0', UAS_MAX_CMDS * sizeof(struct uas_cmd));
+
+	ret = usb_set_interface(dev, ss->ifnum,
+				iface->desc.bAlternateSetting);
+	if (ret)
+		goto err;
+	/* Only USB 3 gives the data and status pipes streams */
+	ret = usb_alloc_streams(dev, iface, UAS_MAX_CMDS);
+	if (ret < 0) {
+		usb_set_interface(dev, ss->ifnum, 0);
+		goto err;
+	}
+	uas->num_cmds = ret;
+
+	debug("UAS with %d commands queued\n", uas->num_cmds);
+	ss->uas = uas;
+	ss->protocol = US_PR_UAS;
+	ss->transport = usb_stor_uas_transport;
+	ss->transport_reset = usb_stor_uas_reset;
+
+	return 0;
+
+err:
+	debug("Not using UAS: %d\n", ret);
+	free(buf);
+	free(uas->cmd);
+	free(uas);
+	return ret;
+}
+#endif
+
 static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 				      struct us_data *us)
 {
@@ -1154,6 +1673,11 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+#if CONFIG_IS_ENABLED(USB_UAS)
+	if (ss->uas)
+		return usb_stor_uas_rw(ss, block_dev, blknr, blkcnt,
+				       (void *)buffer, false);
+#endif
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 	srb->lun = block_dev->lun;
@@ -1236,6 +1760,11 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+#if CONFIG_IS_ENABLED(USB_UAS)
+	if (ss->uas)
+		return usb_stor_uas_rw(ss, block_dev, blknr, blkcnt,
+				       (void *)buffer, true);
+#endif
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 
@@ -1405,6 +1934,12 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 	/* Set the maximum transfer size per host controller setting */
 	usb_stor_set_max_xfer_blk(dev, ss);
 
+#if CONFIG_IS_ENABLED(USB_UAS)
+	/* UAS devices have BBB in setting 0, keep it if UAS can't work */
+	if (ss->protocol == US_PR_BULK && ss->subclass == US_SC_SCSI)
+		usb_stor_uas_probe(dev, ss);
+#endif
+
 	dev->privptr = (void *)ss;
 	return 1;
 }
@@ -1514,11 +2049,29 @@ static const struct udevice_id usb_mass_storage_ids[] = {
 	{ }
 };
 
+#if CONFIG_IS_ENABLED(USB_UAS)
+static int usb_mass_storage_remove(struct udevice *dev)
+{
+	struct us_data *ss = dev_get_platdata(dev);
+
+	if (ss->uas) {
+		free(ss->uas->cmd);
+		free(ss->uas);
+		ss->uas = NULL;
+	}
+
+	return 0;
+}
+#endif
+
 U_BOOT_DRIVER(usb_mass_storage) = {
 	.name	= "usb_mass_storage",
 	.id	= UCLASS_MASS_STORAGE,
 	.of_match = usb_mass_storage_ids,
 	.probe = usb_mass_storage_probe,
+#if CONFIG_IS_ENABLED(USB_UAS)
+	.remove = usb_mass_storage_remove,
+#endif
 #if CONFIG_IS_ENABLED(BLK)
 	.platdata_auto_alloc_size	= sizeof(struct us_data),
 #endif
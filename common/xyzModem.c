@@ -247,6 +247,15 @@ xyzModem_flush (void)
     }
 }
 
+/* Character asking the sender for the next block, or to resend one */
+static char
+xyzModem_request (void)
+{
+  if (xyz.mode == xyzModem_ymodem_g)
+    return 'G';
+  return xyz.crc_mode ? 'C' : NAK;
+}
+
 static int
 xyzModem_get_hdr (void)
 {
@@ -438,7 +447,7 @@ xyzModem_stream_open (connection_info_t * info, int *err)
   xyz.read_length = 0;
   xyz.file_length = 0;
 
-  CYGACC_COMM_IF_PUTC (*xyz.__chan, (xyz.crc_mode ? 'C' : NAK));
+  CYGACC_COMM_IF_PUTC (*xyz.__chan, xyzModem_request ());
 
   if (xyz.mode == xyzModem_xmodem)
     {
@@ -460,7 +469,11 @@ xyzModem_stream_open (connection_info_t * info, int *err)
 	      /* get the length */
 	      parse_num ((char *) xyz.bufp, &xyz.file_length, NULL, " ");
 	      /* The rest of the file name data block quietly discarded */
-	      xyz.tx_ack = true;
+	      if (xyz.mode == xyzModem_ymodem_g)
+		/* Y-modem-g: ask for the data blocks, they are not ACKed */
+		CYGACC_COMM_IF_PUTC (*xyz.__chan, 'G');
+	      else
+		xyz.tx_ack = true;
 	    }
 	  xyz.next_blk = 1;
 	  xyz.len = 0;
@@ -468,10 +481,11 @@ xyzModem_stream_open (connection_info_t * info, int *err)
 	}
       else if (stat == xyzModem_timeout)
 	{
-	  if (--crc_retries <= 0)
+	  /* Y-modem-g has no checksum mode to fall back to */
+	  if (--crc_retries <= 0 && xyz.mode != xyzModem_ymodem_g)
 	    xyz.crc_mode = false;
 	  CYGACC_CALL_IF_DELAY_US (5 * 100000);	/* Extra delay for startup */
-	  CYGACC_COMM_IF_PUTC (*xyz.__chan, (xyz.crc_mode ? 'C' : NAK));
+	  CYGACC_COMM_IF_PUTC (*xyz.__chan, xyzModem_request ());
 	  xyz.total_retries++;
 	  ZM_DEBUG (zm_dprintf ("NAK (%d)\n", __LINE__));
 	}
@@ -506,7 +520,7 @@ xyzModem_stream_read (char *buf, int size, int *err)
 		{
 		  if (xyz.blk == xyz.next_blk)
 		    {
-		      xyz.tx_ack = true;
+		      xyz.tx_ack = xyz.mode != xyzModem_ymodem_g;
 		      ZM_DEBUG (zm_dprintf
 				("ACK block %d (%d)\n", xyz.blk, __LINE__));
 		      xyz.next_blk = (xyz.next_blk + 1) & 0xFF;
@@ -543,7 +557,8 @@ xyzModem_stream_read (char *buf, int size, int *err)
 			}
 		      break;
 		    }
-		  else if (xyz.blk == ((xyz.next_blk - 1) & 0xFF))
+		  else if (xyz.blk == ((xyz.next_blk - 1) & 0xFF) &&
+			   xyz.mode != xyzModem_ymodem_g)
 		    {
 		      /* Just re-ACK this so sender will get on with it */
 		      CYGACC_COMM_IF_PUTC (*xyz.__chan, ACK);
@@ -562,10 +577,9 @@ xyzModem_stream_read (char *buf, int size, int *err)
 		{
 		  CYGACC_COMM_IF_PUTC (*xyz.__chan, ACK);
 		  ZM_DEBUG (zm_dprintf ("ACK (%d)\n", __LINE__));
-		  if (xyz.mode == xyzModem_ymodem)
+		  if (xyz.mode != xyzModem_xmodem)
 		    {
-		      CYGACC_COMM_IF_PUTC (*xyz.__chan,
-					   (xyz.crc_mode ? 'C' : NAK));
+		      CYGACC_COMM_IF_PUTC (*xyz.__chan, xyzModem_request ());
 		      xyz.total_retries++;
 		      ZM_DEBUG (zm_dprintf ("Reading Final Header\n"));
 		      stat = xyzModem_get_hdr ();
@@ -575,6 +589,12 @@ xyzModem_stream_read (char *buf, int size, int *err)
 		  xyz.at_eof = true;
 		  break;
 		}
+	      if (xyz.mode == xyzModem_ymodem_g)
+		{
+		  /* Blocks are never resent, give up on the transfer */
+		  xyzModem_stream_terminate (true, NULL);
+		  break;
+		}
 	      CYGACC_COMM_IF_PUTC (*xyz.__chan, (xyz.crc_mode ? 'C' : NAK));
 	      xyz.total_retries++;
 	      ZM_DEBUG (zm_dprintf ("NAK (%d)\n", __LINE__));
@@ -627,6 +647,7 @@ xyzModem_stream_terminate (bool abort, int (*getc) (void))
 	{
 	case xyzModem_xmodem:
 	case xyzModem_ymodem:
+	case xyzModem_ymodem_g:
 	  /* The X/YMODEM Spec seems to suggest that multiple CAN followed by an equal */
 	  /* number of Backspaces is a friendly way to get the other end to abort. */
 	  CYGACC_COMM_IF_PUTC (*xyz.__chan, CAN);
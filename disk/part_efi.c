@@ -177,6 +177,131 @@ static void prepare_backup_gpt_header(gpt_header *gpt_h)
 }
 
 #if CONFIG_IS_ENABLED(EFI_PARTITION)
+/*
+ * The GPTs last found valid, so that looking partitions up by number or name
+ * does not read and CRC-check the header and all the entries each time.
+ */
+#define GPT_CACHE_SIZE	4
+
+struct gpt_cache {
+	struct blk_desc *dev_desc;	/* NULL if the slot is free */
+	int hwpart;
+	lbaint_t lba;			/* size of the device when read */
+	gpt_header *gpt_head;
+	gpt_entry *gpt_pte;
+};
+
+static struct gpt_cache gpt_cache[GPT_CACHE_SIZE];
+static int gpt_cache_next;	/* slot to replace next */
+
+static void gpt_cache_free(struct gpt_cache *cache)
+{
+	free(cache->gpt_head);
+	free(cache->gpt_pte);
+	cache->dev_desc = NULL;
+}
+
+/**
+ * gpt_cache_get() - Find the valid GPT of a device
+ *
+ * The primary GPT is used if it is valid, the backup one otherwise. The
+ * returned header and entries belong to the cache: they must not be freed
+ * and are only valid until the next block write or partition lookup.
+ *
+ * @dev_desc:	Block device descriptor
+ * @caller:	Name of the caller for the error messages
+ * @gpt_headp:	Returns the GPT header
+ * @gpt_ptep:	Returns the GPT entries
+ * @return 0 if OK, -EINVAL if there is no valid GPT, -ENOMEM
+ */
+static int gpt_cache_get(struct blk_desc *dev_desc, const char *caller,
+			 gpt_header **gpt_headp, gpt_entry **gpt_ptep)
+{
+	ALLOC_CACHE_ALIGN_BUFFER_PAD(gpt_header, gpt_head, 1, dev_desc->blksz);
+	struct gpt_cache *cache;
+	gpt_entry *gpt_pte = NULL;
+	int i;
+
+	for (i = 0; i < GPT_CACHE_SIZE; i++) {
+		cache = &gpt_cache[i];
+		if (cache->dev_desc == dev_desc &&
+		    cache->hwpart == dev_desc->hwpart &&
+		    cache->lba == dev_desc->lba) {
+			*gpt_headp = cache->gpt_head;
+			*gpt_ptep = cache->gpt_pte;
+			return 0;
+		}
+	}
+
+	/* This function validates AND fills in the GPT header and PTE */
+	if (is_gpt_valid(dev_desc, GPT_PRIMARY_PARTITION_TABLE_LBA,
+			 gpt_head, &gpt_pte) != 1) {
+		printf("%s: *** ERROR: Invalid GPT ***\n", caller);
+		if (is_gpt_valid(dev_desc, (dev_desc->lba - 1),
+				 gpt_head, &gpt_pte) != 1) {
+			printf("%s: *** ERROR: Invalid Backup GPT ***\n",
+			       caller);
+			return -EINVAL;
+		} else {
+			printf("%s: ***        Using Backup GPT ***\n",
+			       caller);
+		}
+	}
+
+	cache = &gpt_cache[gpt_cache_next];
+	gpt_cache_next = (gpt_cache_next + 1) % GPT_CACHE_SIZE;
+	if (cache->dev_desc)
+		gpt_cache_free(cache);
+	cache->gpt_head = malloc(sizeof(gpt_header));
+	if (!cache->gpt_head) {
+		free(gpt_pte);
+		return -ENOMEM;
+	}
+	memcpy(cache->gpt_head, gpt_head, sizeof(gpt_header));
+	cache->gpt_pte = gpt_pte;
+	cache->dev_desc = dev_desc;
+	cache->hwpart = dev_desc->hwpart;
+	cache->lba = dev_desc->lba;
+
+	*gpt_headp = cache->gpt_head;
+	*gpt_ptep = cache->gpt_pte;
+
+	return 0;
+}
+
+void gpt_cache_drop(struct blk_desc *dev_desc)
+{
+	int i;
+
+	for (i = 0; i < GPT_CACHE_SIZE; i++) {
+		if (gpt_cache[i].dev_desc == dev_desc)
+			gpt_cache_free(&gpt_cache[i]);
+	}
+}
+
+void gpt_cache_written(struct blk_desc *dev_desc, lbaint_t start,
+		       lbaint_t blkcnt)
+{
+	struct gpt_cache *cache;
+	lbaint_t first, last;
+	int i;
+
+	for (i = 0; i < GPT_CACHE_SIZE; i++) {
+		cache = &gpt_cache[i];
+		if (cache->dev_desc != dev_desc)
+			continue;
+
+		/*
+		 * The MBR, both headers and both entry arrays are outside
+		 * of the usable blocks
+		 */
+		first = le64_to_cpu(cache->gpt_head->first_usable_lba);
+		last = le64_to_cpu(cache->gpt_head->last_usable_lba);
+		if (start < first || start + blkcnt > last + 1)
+			gpt_cache_free(cache);
+	}
+}
+
 /*
  * Public Functions (include/part.h)
  */
@@ -272,8 +397,8 @@ void part_print_efi(struct blk_desc *dev_desc)
 int part_get_info_efi(struct blk_desc *dev_desc, int part,
 		      disk_partition_t *info)
 {
-	ALLOC_CACHE_ALIGN_BUFFER_PAD(gpt_header, gpt_head, 1, dev_desc->blksz);
-	gpt_entry *gpt_pte = NULL;
+	gpt_header *gpt_head;
+	gpt_entry *gpt_pte;
 
 	/* "part" argument must be at least 1 */
 	if (part < 1) {
@@ -281,26 +406,13 @@ int part_get_info_efi(struct blk_desc *dev_desc, int part,
 		return -1;
 	}
 
-	/* This function validates AND fills in the GPT header and PTE */
-	if (is_gpt_valid(dev_desc, GPT_PRIMARY_PARTITION_TABLE_LBA,
-			gpt_head, &gpt_pte) != 1) {
-		printf("%s: *** ERROR: Invalid GPT ***\n", __func__);
-		if (is_gpt_valid(dev_desc, (dev_desc->lba - 1),
-				 gpt_head, &gpt_pte) != 1) {
-			printf("%s: *** ERROR: Invalid Backup GPT ***\n",
-			       __func__);
-			return -1;
-		} else {
-			printf("%s: ***        Using Backup GPT ***\n",
-			       __func__);
-		}
-	}
+	if (gpt_cache_get(dev_desc, __func__, &gpt_head, &gpt_pte))
+		return -1;
 
 	if (part > le32_to_cpu(gpt_head->num_partition_entries) ||
 	    !is_pte_valid(&gpt_pte[part - 1])) {
 		debug("%s: *** ERROR: Invalid partition number %d ***\n",
 			__func__, part);
-		free(gpt_pte);
 		return -1;
 	}
 
@@ -327,8 +439,6 @@ int part_get_info_efi(struct blk_desc *dev_desc, int part,
 	debug("%s: start 0x" LBAF ", size 0x" LBAF ", name %s\n", __func__,
 	      info->start, info->size, info->name);
 
-	/* Remember to free pte */
-	free(gpt_pte);
 	return 0;
 }
 
@@ -392,6 +502,7 @@ int write_gpt_table(struct blk_desc *dev_desc,
 					   * sizeof(gpt_entry)), dev_desc);
 	u32 calc_crc32;
 
+	gpt_cache_drop(dev_desc);
 	debug("max lba: %x\n", (u32) dev_desc->lba);
 	/* Setup the Protective MBR */
 	if (set_protective_mbr(dev_desc) < 0)
@@ -816,6 +927,8 @@ int write_mbr_and_gpt_partitions(struct blk_desc *dev_desc, void *buf)
 	if (is_valid_gpt_buf(dev_desc, buf))
 		return -1;
 
+	gpt_cache_drop(dev_desc);
+
 	/* determine start of GPT Header in the buffer */
 	gpt_h = buf + (GPT_PRIMARY_PARTITION_TABLE_LBA *
 		       dev_desc->blksz);
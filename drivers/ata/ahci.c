@@ -500,11 +500,16 @@ static int ahci_init_one(struct ahci_uc_priv *uc_priv, pci_dev_t dev)
 
 #define MAX_DATA_BYTE_COUNT  (4*1024*1024)
 
-static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
+static ulong ahci_cmd_tbl(struct ahci_ioports *pp, int tag)
+{
+	return pp->cmd_tbl + tag * AHCI_CMD_TBL_SZ;
+}
+
+static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port, int tag,
 			unsigned char *buf, int buf_len)
 {
 	struct ahci_ioports *pp = &(uc_priv->port[port]);
-	struct ahci_sg *ahci_sg = pp->cmd_tbl_sg;
+	struct ahci_sg *ahci_sg;
 	u32 sg_count;
 	int i;
 
@@ -514,6 +519,7 @@ static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
 		return -1;
 	}
 
+	ahci_sg = (struct ahci_sg *)(ahci_cmd_tbl(pp, tag) + AHCI_CMD_TBL_HDR);
 	for (i = 0; i < sg_count; i++) {
 		ahci_sg->addr =
 		    cpu_to_le32((unsigned long) buf + i * MAX_DATA_BYTE_COUNT);
@@ -530,14 +536,16 @@ static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
 }
 
 
-static void ahci_fill_cmd_slot(struct ahci_ioports *pp, u32 opts)
+static void ahci_fill_cmd_slot(struct ahci_ioports *pp, int tag, u32 opts)
 {
-	pp->cmd_slot->opts = cpu_to_le32(opts);
-	pp->cmd_slot->status = 0;
-	pp->cmd_slot->tbl_addr = cpu_to_le32((u32)pp->cmd_tbl & 0xffffffff);
+	struct ahci_cmd_hdr *cmd_hdr = pp->cmd_slot + tag;
+	ulong cmd_tbl = ahci_cmd_tbl(pp, tag);
+
+	cmd_hdr->opts = cpu_to_le32(opts);
+	cmd_hdr->status = 0;
+	cmd_hdr->tbl_addr = cpu_to_le32((u32)cmd_tbl & 0xffffffff);
 #ifdef CONFIG_PHYS_64BIT
-	pp->cmd_slot->tbl_addr_hi =
-	    cpu_to_le32((u32)(((pp->cmd_tbl) >> 16) >> 16));
+	cmd_hdr->tbl_addr_hi = cpu_to_le32((u32)((cmd_tbl >> 16) >> 16));
 #endif
 }
 
@@ -571,16 +579,13 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 		return -1;
 	}
 
-	mem = malloc(AHCI_PORT_PRIV_DMA_SZ + 2048);
+	/* Aligned to 2048-bytes */
+	mem = memalign(2048, AHCI_PORT_NCQ_DMA_SZ);
 	if (!mem) {
-		free(pp);
 		printf("%s: No mem for table!\n", __func__);
 		return -ENOMEM;
 	}
-
-	/* Aligned to 2048-bytes */
-	mem = memalign(2048, AHCI_PORT_PRIV_DMA_SZ);
-	memset(mem, 0, AHCI_PORT_PRIV_DMA_SZ);
+	memset(mem, 0, AHCI_PORT_NCQ_DMA_SZ);
 
 	/*
 	 * First item in chunk of DMA memory: 32-slot command table,
@@ -589,7 +594,7 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 	pp->cmd_slot =
 		(struct ahci_cmd_hdr *)(uintptr_t)virt_to_phys((void *)mem);
 	debug("cmd_slot = %p\n", pp->cmd_slot);
-	mem += (AHCI_CMD_SLOT_SZ + 224);
+	mem += AHCI_CMD_SLOT_SZ * AHCI_MAX_CMD_SLOT;
 
 	/*
 	 * Second item: Received-FIS area
@@ -598,8 +603,8 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 	mem += AHCI_RX_FIS_SZ;
 
 	/*
-	 * Third item: data area for storing a single command
-	 * and its scatter-gather table
+	 * Third item: one data area per command slot for storing the
+	 * command and its scatter-gather table
 	 */
 	pp->cmd_tbl = virt_to_phys((void *)mem);
 	debug("cmd_tbl_dma = %lx\n", pp->cmd_tbl);
@@ -656,9 +661,9 @@ static int ahci_device_data_io(struct ahci_uc_priv *uc_priv, u8 port, u8 *fis,
 
 	memcpy((unsigned char *)pp->cmd_tbl, fis, fis_len);
 
-	sg_count = ahci_fill_sg(uc_priv, port, buf, buf_len);
+	sg_count = ahci_fill_sg(uc_priv, port, 0, buf, buf_len);
 	opts = (fis_len >> 2) | (sg_count << 16) | (is_write << 6);
-	ahci_fill_cmd_slot(pp, opts);
+	ahci_fill_cmd_slot(pp, 0, opts);
 
 	ahci_dcache_flush_sata_cmd(pp);
 	ahci_dcache_flush_range((unsigned long)buf, (unsigned long)buf_len);
@@ -678,6 +683,169 @@ static int ahci_device_data_io(struct ahci_uc_priv *uc_priv, u8 port, u8 *fis,
 	return 0;
 }
 
+/*
+ * Use native command queueing when both the controller and the drive
+ * support it, with as many tags as either of them can handle.
+ */
+static void ahci_ncq_setup(struct ahci_uc_priv *uc_priv, u8 port, u16 *id)
+{
+	struct ahci_ioports *pp = &(uc_priv->port[port]);
+	u32 depth;
+
+	pp->ncq_depth = 0;
+	if (!(uc_priv->cap & HOST_CAP_NCQ) || !ata_id_has_ncq(id))
+		return;
+
+	depth = min3((u32)((uc_priv->cap >> 8) & 0x1f) + 1,
+		     (u32)ata_id_queue_depth(id), (u32)AHCI_MAX_CMD_SLOT);
+	if (depth > 1)
+		pp->ncq_depth = depth;
+	debug("Port %d: NCQ depth %d\n", port, pp->ncq_depth);
+}
+
+/*
+ * Stop and restart the command list DMA engine after a failed NCQ command.
+ * This clears PxCI and PxSACT and leaves the port ready for new commands.
+ */
+static void ahci_ncq_recover(struct ahci_ioports *pp)
+{
+	void __iomem *port_mmio = pp->port_mmio;
+	u32 tmp;
+
+	tmp = readl(port_mmio + PORT_CMD);
+	writel_with_flush(tmp & ~PORT_CMD_START, port_mmio + PORT_CMD);
+	waiting_for_cmd_completed(port_mmio + PORT_CMD, 500, PORT_CMD_LIST_ON);
+
+	tmp = readl(port_mmio + PORT_SCR_ERR);
+	writel(tmp, port_mmio + PORT_SCR_ERR);
+	tmp = readl(port_mmio + PORT_IRQ_STAT);
+	writel(tmp, port_mmio + PORT_IRQ_STAT);
+
+	tmp = readl(port_mmio + PORT_CMD);
+	writel_with_flush(tmp | PORT_CMD_START, port_mmio + PORT_CMD);
+}
+
+/* Build READ/WRITE FPDMA QUEUED for one tag, but do not issue it yet */
+static int ahci_ncq_prep(struct ahci_uc_priv *uc_priv, u8 port, int tag,
+			 lbaint_t lba, u16 blocks, u8 *buf, u8 is_write)
+{
+	struct ahci_ioports *pp = &(uc_priv->port[port]);
+	u8 *fis = (u8 *)ahci_cmd_tbl(pp, tag);
+	int sg_count;
+
+	memset(fis, 0, 20);
+	fis[0] = 0x27;		 /* Host to device FIS. */
+	fis[1] = 1 << 7;	 /* Command FIS. */
+	fis[2] = is_write ? ATA_CMD_FPDMA_WRITE : ATA_CMD_FPDMA_READ;
+
+	/* Block count goes in the features field, tag in the sector count */
+	fis[3] = (blocks >> 0) & 0xff;
+	fis[11] = (blocks >> 8) & 0xff;
+	fis[12] = tag << 3;
+
+	fis[4] = (lba >> 0) & 0xff;
+	fis[5] = (lba >> 8) & 0xff;
+	fis[6] = (lba >> 16) & 0xff;
+	fis[7] = 1 << 6; /* device reg: set LBA mode */
+	fis[8] = ((lba >> 24) & 0xff);
+#ifdef CONFIG_SYS_64BIT_LBA
+	fis[9] = ((lba >> 32) & 0xff);
+	fis[10] = ((lba >> 40) & 0xff);
+#endif
+
+	sg_count = ahci_fill_sg(uc_priv, port, tag, buf,
+				blocks * ATA_SECT_SIZE);
+	if (sg_count < 0)
+		return -EIO;
+
+	ahci_fill_cmd_slot(pp, tag, 5 | (sg_count << 16) | (is_write << 6));
+	ahci_dcache_flush_range(ahci_cmd_tbl(pp, tag), AHCI_CMD_TBL_SZ);
+
+	return 0;
+}
+
+/*
+ * Transfer @blocks blocks with NCQ, keeping up to pp->ncq_depth commands
+ * of MAX_SATA_BLOCKS_READ_WRITE blocks each outstanding on the drive.
+ * Freed tags are refilled as soon as their bit drops out of PxSACT.
+ */
+static int ahci_ncq_rw(struct ahci_uc_priv *uc_priv, u8 port, lbaint_t lba,
+		       u32 blocks, u8 *buf, u8 is_write)
+{
+	struct ahci_ioports *pp = &(uc_priv->port[port]);
+	void __iomem *port_mmio = pp->port_mmio;
+	unsigned long len = (unsigned long)blocks * ATA_SECT_SIZE;
+	u8 *data = buf;
+	u32 busy = 0, issue, active, status;
+	ulong start;
+	int tag;
+
+	status = readl(port_mmio + PORT_IRQ_STAT);
+	writel(status, port_mmio + PORT_IRQ_STAT);
+
+	ahci_dcache_flush_range((unsigned long)data, len);
+
+	start = get_timer(0);
+	while (blocks || busy) {
+		issue = 0;
+		for (tag = 0; tag < pp->ncq_depth && blocks; tag++) {
+			u16 now_blocks;
+
+			if (busy & (1 << tag))
+				continue;
+
+			now_blocks = min_t(u32, MAX_SATA_BLOCKS_READ_WRITE,
+					   blocks);
+			if (ahci_ncq_prep(uc_priv, port, tag, lba, now_blocks,
+					  buf, is_write))
+				goto err;
+
+			issue |= 1 << tag;
+			buf += now_blocks * ATA_SECT_SIZE;
+			blocks -= now_blocks;
+			lba += now_blocks;
+		}
+
+		if (issue) {
+			ahci_dcache_flush_range((unsigned long)pp->cmd_slot,
+					AHCI_CMD_SLOT_SZ * AHCI_MAX_CMD_SLOT);
+			/* PxSACT must be set before the matching PxCI bit */
+			writel_with_flush(issue, port_mmio + PORT_SCR_ACT);
+			writel_with_flush(issue, port_mmio + PORT_CMD_ISSUE);
+			busy |= issue;
+		}
+
+		status = readl(port_mmio + PORT_IRQ_STAT);
+		if (status & (PORT_IRQ_FATAL)) {
+			printf("scsi_ahci: NCQ error on port %d, status 0x%x\n",
+			       port, status);
+			goto err;
+		}
+
+		active = readl(port_mmio + PORT_SCR_ACT) |
+			 readl(port_mmio + PORT_CMD_ISSUE);
+		if (busy & ~active)
+			start = get_timer(0);
+		else if (get_timer(start) > WAIT_MS_DATAIO) {
+			printf("scsi_ahci: NCQ timeout on port %d\n", port);
+			goto err;
+		}
+		busy &= active;
+	}
+
+	if (!is_write)
+		ahci_dcache_invalidate_range((unsigned long)data, len);
+
+	return 0;
+
+err:
+	/* Fall back to one command at a time from now on */
+	ahci_ncq_recover(pp);
+	pp->ncq_depth = 0;
+
+	return -EIO;
+}
+
 
 static char *ata_id_strcpy(u16 *target, u16 *src, int len)
 {
@@ -740,6 +908,7 @@ static int ata_scsiop_inquiry(struct ahci_uc_priv *uc_priv,
 
 	memcpy(idbuf, tmpid, ATA_ID_WORDS * 2);
 	ata_swap_buf_le16(idbuf, ATA_ID_WORDS);
+	ahci_ncq_setup(uc_priv, port, idbuf);
 
 	memcpy(&pccb->pdata[8], "ATA     ", 8);
 	ata_id_strcpy((u16 *)&pccb->pdata[16], &idbuf[ATA_ID_PROD], 16);
@@ -793,6 +962,26 @@ static int ata_scsiop_read_write(struct ahci_uc_priv *uc_priv,
 	debug("scsi_ahci: %s %u blocks starting from lba 0x" LBAFU "\n",
 	      is_write ?  "write" : "read", blocks, lba);
 
+	if (uc_priv->port[pccb->target].ncq_depth) {
+		if (ATA_SECT_SIZE * blocks > user_buffer_size) {
+			printf("scsi_ahci: Error: buffer too small.\n");
+			return -EIO;
+		}
+
+		if (ahci_ncq_rw(uc_priv, pccb->target, lba, blocks,
+				user_buffer, is_write)) {
+			debug("scsi_ahci: SCSI %s10 command failure.\n",
+			      is_write ? "WRITE" : "READ");
+			return -EIO;
+		}
+
+		/* One flush for the whole queued write */
+		if (is_write)
+			return ata_io_flush(uc_priv, pccb->target);
+
+		return 0;
+	}
+
 	/* Preset the FIS */
 	memset(fis, 0, sizeof(fis));
 	fis[0] = 0x27;		 /* Host to device FIS. */
@@ -1125,7 +1314,7 @@ static int ata_io_flush(struct ahci_uc_priv *uc_priv, u8 port)
 	fis[2] = ATA_CMD_FLUSH_EXT;
 
 	memcpy((unsigned char *)pp->cmd_tbl, fis, 20);
-	ahci_fill_cmd_slot(pp, cmd_fis_len);
+	ahci_fill_cmd_slot(pp, 0, cmd_fis_len);
 	ahci_dcache_flush_sata_cmd(pp);
 	writel_with_flush(1, port_mmio + PORT_CMD_ISSUE);
 
@@ -1173,6 +1362,8 @@ int ahci_probe_scsi(struct udevice *ahci_dev, ulong base)
 	uc_plat->base = base;
 	uc_plat->max_lun = 1;
 	uc_plat->max_id = 2;
+	/* Commands of any size are split up here, and queued with NCQ */
+	uc_plat->max_bytes = 0;
 
 	uc_priv = dev_get_uclass_priv(ahci_dev);
 	ret = ahci_init_one(uc_priv, dev);
@@ -431,22 +431,18 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 {
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
-	ulong blks_read;
 
 	if (!ops->read)
 		return -ENOSYS;
 
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
+	if (blkcache_read(block_dev, start, blkcnt, buffer))
 		return blkcnt;
-	blks_read = ops->read(dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
 
-	return blks_read;
+	return ops->read(dev, start, blkcnt, buffer);
 }
 
+static ulong blk_writes;	/* calls to blk_dwrite() and blk_derase() */
+
 unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt, const void *buffer)
 {
@@ -457,6 +453,8 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	gpt_cache_written(block_dev, start, blkcnt);
+	blk_writes++;
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -470,9 +468,16 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	gpt_cache_written(block_dev, start, blkcnt);
+	blk_writes++;
 	return ops->erase(dev, start, blkcnt);
 }
 
+ulong blk_write_count(void)
+{
+	return blk_writes;
+}
+
 int blk_get_from_parent(struct udevice *parent, struct udevice **devp)
 {
 	struct udevice *dev;
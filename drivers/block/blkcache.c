@@ -6,157 +6,307 @@
  */
 #include <config.h>
 #include <common.h>
+#include <blk.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
 
+/*
+ * The cache holds aligned chunks of max_blocks_per_entry blocks, per
+ * device, hashed by chunk number and kept in LRU order. A small read that
+ * misses fetches the chunks around it, so neighbouring metadata comes in
+ * with it, and once a device sees a run of sequential reads the fetch is
+ * widened to the read-ahead window.
+ */
+#define BLKCACHE_HASH_SIZE	64
+/* Sequential reads in a row before reading ahead */
+#define BLKCACHE_SEQ_MIN	2
+
 struct block_cache_node {
+	struct list_head lh;		/* LRU list, most recent first */
+	struct hlist_node hn;		/* hash chain */
+	lbaint_t start;			/* first block, chunk aligned */
+	bool ahead;			/* read ahead and not used yet */
+	char *cache;
+};
+
+struct block_cache_dev {
 	struct list_head lh;
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
 	unsigned long blksz;
-	char *cache;
+	unsigned max_blocks_per_entry;
+	unsigned max_entries;
+	unsigned entries;
+	struct list_head lru;
+	struct hlist_head hash[BLKCACHE_HASH_SIZE];
+	/* Sequential access detection */
+	lbaint_t next_start;
+	unsigned seq;
+	/* Bounce buffer for reads from the device */
+	lbaint_t ra_blocks;
+	char *buf;
+	struct block_cache_dev_stats stats;
 };
 
-static LIST_HEAD(block_cache);
+static LIST_HEAD(block_cache_devs);
 
 static struct block_cache_stats _stats = {
 	.max_blocks_per_entry = 8,
 	.max_entries = 32
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+static void cache_drop_all(struct block_cache_dev *dev)
 {
 	struct block_cache_node *node;
+	int i;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
-			return node;
-		}
-	return 0;
+	while (!list_empty(&dev->lru)) {
+		node = list_first_entry(&dev->lru, struct block_cache_node, lh);
+		list_del(&node->lh);
+		free(node->cache);
+		free(node);
+	}
+	for (i = 0; i < BLKCACHE_HASH_SIZE; i++)
+		INIT_HLIST_HEAD(&dev->hash[i]);
+	_stats.entries -= dev->entries;
+	dev->entries = 0;
+	dev->seq = 0;
 }
 
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
+static void cache_set_size(struct block_cache_dev *dev, unsigned blocks,
+			   unsigned entries)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
-	}
+	cache_drop_all(dev);
+	free(dev->buf);
+	dev->buf = NULL;
+	dev->max_blocks_per_entry = blocks;
+	dev->max_entries = entries;
+}
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+static struct block_cache_dev *cache_get_dev(int iftype, int devnum,
+					     bool create)
+{
+	struct block_cache_dev *dev;
+	int i;
+
+	list_for_each_entry(dev, &block_cache_devs, lh)
+		if (dev->iftype == iftype && dev->devnum == devnum)
+			return dev;
+	if (!create)
+		return NULL;
+
+	dev = calloc(1, sizeof(*dev));
+	if (!dev)
+		return NULL;
+	dev->iftype = iftype;
+	dev->devnum = devnum;
+	dev->max_blocks_per_entry = _stats.max_blocks_per_entry;
+	dev->max_entries = _stats.max_entries;
+	dev->stats.iftype = iftype;
+	dev->stats.devnum = devnum;
+	INIT_LIST_HEAD(&dev->lru);
+	for (i = 0; i < BLKCACHE_HASH_SIZE; i++)
+		INIT_HLIST_HEAD(&dev->hash[i]);
+	list_add_tail(&dev->lh, &block_cache_devs);
+
+	return dev;
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+static struct hlist_head *cache_bucket(struct block_cache_dev *dev,
+				       lbaint_t start)
+{
+	lbaint_t chunk = start / dev->max_blocks_per_entry;
+
+	return &dev->hash[chunk & (BLKCACHE_HASH_SIZE - 1)];
+}
+
+static struct block_cache_node *cache_find(struct block_cache_dev *dev,
+					   lbaint_t start)
 {
-	lbaint_t bytes;
 	struct block_cache_node *node;
+	struct hlist_node *pos;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
-		return;
+	hlist_for_each_entry(node, pos, cache_bucket(dev, start), hn)
+		if (node->start == start)
+			return node;
 
-	if (_stats.max_entries == 0)
+	return NULL;
+}
+
+static void cache_fill(struct block_cache_dev *dev, lbaint_t start,
+		       const char *data, bool ahead)
+{
+	ulong bytes = dev->max_blocks_per_entry * dev->blksz;
+	struct block_cache_node *node;
+
+	node = cache_find(dev, start);
+	if (node) {
+		/* Already there; only refresh its place in the LRU */
+		list_move(&node->lh, &dev->lru);
 		return;
+	}
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
+	if (dev->entries >= dev->max_entries) {
+		/* reuse the LRU entry, all entries have the same size */
+		node = list_last_entry(&dev->lru, struct block_cache_node, lh);
 		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
+		hlist_del(&node->hn);
+		debug("drop: start " LBAF "\n", node->start);
 	} else {
 		node = malloc(sizeof(*node));
 		if (!node)
 			return;
-		node->cache = 0;
-	}
-
-	if (!node->cache) {
 		node->cache = malloc(bytes);
 		if (!node->cache) {
 			free(node);
 			return;
 		}
+		dev->entries++;
+		_stats.entries++;
 	}
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-
-	node->iftype = iftype;
-	node->devnum = devnum;
+	debug("fill: start " LBAF "%s\n", start, ahead ? " (ahead)" : "");
 	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	node->ahead = ahead;
+	memcpy(node->cache, data, bytes);
+	list_add(&node->lh, &dev->lru);
+	hlist_add_head(&node->hn, cache_bucket(dev, start));
 }
 
-void blkcache_invalidate(int iftype, int devnum)
+/* Copy a read spanning at most two chunks out of the cache, if it is all there */
+static bool cache_copy(struct block_cache_dev *dev, lbaint_t start,
+		       lbaint_t blkcnt, void *buffer)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	lbaint_t chunk = dev->max_blocks_per_entry;
+	lbaint_t first = rounddown(start, chunk);
+	struct block_cache_node *node[2];
+	lbaint_t pos, n;
+	int i, count = 0;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
+	for (pos = first; pos < start + blkcnt; pos += chunk) {
+		node[count] = cache_find(dev, pos);
+		if (!node[count])
+			return false;
+		count++;
+	}
+
+	for (i = 0, pos = start; i < count; i++, pos += n) {
+		lbaint_t off = pos - node[i]->start;
+
+		n = min(chunk - off, start + blkcnt - pos);
+		memcpy(buffer, node[i]->cache + off * dev->blksz,
+		       n * dev->blksz);
+		buffer += n * dev->blksz;
+		list_move(&node[i]->lh, &dev->lru);
+		if (node[i]->ahead) {
+			node[i]->ahead = false;
+			dev->stats.ra_hits++;
 		}
 	}
+
+	return true;
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+int blkcache_read(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		  void *buffer)
 {
-	struct block_cache_node *node;
-	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries)) {
-		/* invalidate cache */
-		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
-		}
-		_stats.entries = 0;
+	const struct blk_ops *ops = blk_get_ops(desc->bdev);
+	struct block_cache_dev *dev;
+	lbaint_t chunk, first, end, want, n;
+	bool ahead = false;
+
+	dev = cache_get_dev(desc->if_type, desc->devnum, true);
+	if (!dev)
+		return 0;
+	if (dev->blksz != desc->blksz) {
+		cache_set_size(dev, dev->max_blocks_per_entry,
+			       dev->max_entries);
+		dev->blksz = desc->blksz;
 	}
 
+	dev->seq = start == dev->next_start ? dev->seq + 1 : 0;
+	dev->next_start = start + blkcnt;
+
+	/* don't cache big stuff */
+	chunk = dev->max_blocks_per_entry;
+	if (!chunk || !dev->max_entries || blkcnt > chunk)
+		return 0;
+
+	if (cache_copy(dev, start, blkcnt, buffer)) {
+		debug("hit: start " LBAF ", count " LBAFU "\n", start, blkcnt);
+		dev->stats.hits++;
+		++_stats.hits;
+		return 1;
+	}
+
+	debug("miss: start " LBAF ", count " LBAFU "\n", start, blkcnt);
+	dev->stats.misses++;
+	++_stats.misses;
+
+	/* The read-ahead window is at least the two chunks a miss may need */
+	if (!dev->buf) {
+		dev->ra_blocks = max_t(lbaint_t, CONFIG_BLOCK_CACHE_READAHEAD,
+				       2 * chunk);
+		dev->ra_blocks = min_t(lbaint_t, dev->ra_blocks,
+				       (lbaint_t)dev->max_entries * chunk);
+		dev->ra_blocks = roundup(dev->ra_blocks, chunk);
+		dev->buf = malloc_cache_aligned(dev->ra_blocks * dev->blksz);
+		if (!dev->buf)
+			return 0;
+	}
+
+	first = rounddown(start, chunk);
+	want = roundup(start + blkcnt, chunk);
+	end = want;
+	if (dev->seq >= BLKCACHE_SEQ_MIN && first + dev->ra_blocks > end) {
+		end = first + dev->ra_blocks;
+		ahead = true;
+	}
+	if (desc->lba && end > desc->lba)
+		end = desc->lba;
+	if (end < start + blkcnt)
+		return 0;
+
+	n = end - first;
+	if (ops->read(desc->bdev, first, n, dev->buf) != n)
+		return 0;
+	if (ahead) {
+		dev->stats.ra_reads++;
+		dev->stats.ra_blocks += end - want;
+	}
+
+	/* A partial chunk at the end of the device is not kept */
+	for (; first + chunk <= end; first += chunk)
+		cache_fill(dev, first,
+			   dev->buf + (first - rounddown(start, chunk)) *
+			   dev->blksz, first >= want);
+
+	memcpy(buffer, dev->buf + (start - rounddown(start, chunk)) *
+	       dev->blksz, blkcnt * dev->blksz);
+
+	return 1;
+}
+
+void blkcache_invalidate(int iftype, int devnum)
+{
+	struct block_cache_dev *dev = cache_get_dev(iftype, devnum, false);
+
+	if (dev)
+		cache_drop_all(dev);
+}
+
+void blkcache_configure(unsigned blocks, unsigned entries)
+{
+	struct block_cache_dev *dev;
+
+	list_for_each_entry(dev, &block_cache_devs, lh)
+		if (blocks != dev->max_blocks_per_entry ||
+		    entries != dev->max_entries)
+			cache_set_size(dev, blocks, entries);
+
 	_stats.max_blocks_per_entry = blocks;
 	_stats.max_entries = entries;
 
@@ -164,9 +314,45 @@ void blkcache_configure(unsigned blocks, unsigned entries)
 	_stats.misses = 0;
 }
 
+int blkcache_configure_dev(int iftype, int devnum, unsigned blocks,
+			   unsigned entries)
+{
+	struct block_cache_dev *dev = cache_get_dev(iftype, devnum, true);
+
+	if (!dev)
+		return -ENOMEM;
+	if (blocks != dev->max_blocks_per_entry ||
+	    entries != dev->max_entries)
+		cache_set_size(dev, blocks, entries);
+
+	return 0;
+}
+
 void blkcache_stats(struct block_cache_stats *stats)
 {
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
 }
+
+int blkcache_dev_stats(int index, struct block_cache_dev_stats *stats)
+{
+	struct block_cache_dev *dev;
+
+	list_for_each_entry(dev, &block_cache_devs, lh) {
+		if (index--)
+			continue;
+		dev->stats.entries = dev->entries;
+		dev->stats.max_blocks_per_entry = dev->max_blocks_per_entry;
+		dev->stats.max_entries = dev->max_entries;
+		memcpy(stats, &dev->stats, sizeof(*stats));
+		dev->stats.hits = 0;
+		dev->stats.misses = 0;
+		dev->stats.ra_reads = 0;
+		dev->stats.ra_blocks = 0;
+		dev->stats.ra_hits = 0;
+		return 0;
+	}
+
+	return -ENOENT;
+}
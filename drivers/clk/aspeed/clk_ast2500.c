@@ -577,6 +577,24 @@ static ulong ast2500_enable_usbbhclk(struct ast2500_scu *scu)
 	return 0;
 }
 
+#define SCU_CLKSTOP_YCLK 13
+static ulong ast2500_enable_yclk(struct ast2500_scu *scu)
+{
+	u32 reset_bit;
+	u32 clkstop_bit;
+
+	reset_bit = BIT(ASPEED_RESET_HACE);
+	clkstop_bit = BIT(SCU_CLKSTOP_YCLK);
+
+	setbits_le32(&scu->sysreset_ctrl1, reset_bit);
+	udelay(100);
+	clrbits_le32(&scu->clk_stop_ctrl1, clkstop_bit);
+	mdelay(10);
+	clrbits_le32(&scu->sysreset_ctrl1, reset_bit);
+
+	return 0;
+}
+
 static int ast2500_clk_enable(struct clk *clk)
 {
 	struct ast2500_clk_priv *priv = dev_get_priv(clk->dev);
@@ -608,6 +626,9 @@ static int ast2500_clk_enable(struct clk *clk)
 	case ASPEED_CLK_GATE_USBPORT2CLK:
 		ast2500_enable_usbbhclk(priv->scu);
 		break;
+	case ASPEED_CLK_GATE_YCLK:
+		ast2500_enable_yclk(priv->scu);
+		break;
 	default:
 		pr_debug("can't enable clk \n");
 		return -ENOENT;
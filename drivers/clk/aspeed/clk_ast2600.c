@@ -9,6 +9,8 @@
 #include <linux/iopoll.h>
 #include <clk-uclass.h>
 #include <dm.h>
+#include <dt-structs.h>
+#include <mapmem.h>
 #include <asm/io.h>
 #include <dm/lists.h>
 #include <asm/arch/scu_ast2600.h>
@@ -213,6 +215,12 @@ struct mac_delay_config {
 	u32 rx_delay_10;
 };
 
+struct ast2600_clk_plat {
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	struct dtd_aspeed_ast2600_scu dtplat;
+#endif
+};
+
 extern u32 ast2600_get_pll_rate(struct ast2600_scu *scu, int pll_idx)
 {
 	u32 clkin = AST2600_CLK_IN;
@@ -902,6 +910,18 @@ static int ast2600_find_dly32_tap(int target_pico_sec, int *lookup)
 	return i;
 }
 
+static int ast2600_read_mac_delay(struct udevice *dev, const char *propname,
+				  struct mac_delay_config *cfg)
+{
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	/* Not part of the platform data, keep the default delays */
+	return -ENOENT;
+#else
+	return dev_read_u32_array(dev, propname, (u32 *)cfg,
+				  sizeof(*cfg) / sizeof(u32));
+#endif
+}
+
 static u32 ast2600_configure_mac12_clk(struct ast2600_clk_priv *priv, struct udevice *dev)
 {
 	struct ast2600_scu *scu = priv->scu;
@@ -927,8 +947,7 @@ static u32 ast2600_configure_mac12_clk(struct ast2600_clk_priv *priv, struct ude
 		reg[2] |= FIELD_PREP(MAC_CLK_100M_10M_OUTPUT_DELAY_1, ret) |
 			  FIELD_PREP(MAC_CLK_100M_10M_OUTPUT_DELAY_2, ret);
 	}
-	ret = dev_read_u32_array(dev, "mac0-clk-delay", (u32 *)&mac1_cfg,
-				 sizeof(mac1_cfg) / sizeof(u32));
+	ret = ast2600_read_mac_delay(dev, "mac0-clk-delay", &mac1_cfg);
 	if (!ret) {
 		reg[0] &= ~(MAC_CLK_1G_INPUT_DELAY_1 | MAC_CLK_1G_OUTPUT_DELAY_1);
 		reg[0] |= FIELD_PREP(MAC_CLK_1G_INPUT_DELAY_1, mac1_cfg.rx_delay_1000) |
@@ -943,8 +962,7 @@ static u32 ast2600_configure_mac12_clk(struct ast2600_clk_priv *priv, struct ude
 			  FIELD_PREP(MAC_CLK_100M_10M_OUTPUT_DELAY_1, mac1_cfg.tx_delay_10);
 	}
 
-	ret = dev_read_u32_array(dev, "mac1-clk-delay", (u32 *)&mac2_cfg,
-				 sizeof(mac2_cfg) / sizeof(u32));
+	ret = ast2600_read_mac_delay(dev, "mac1-clk-delay", &mac2_cfg);
 	if (!ret) {
 		reg[0] &= ~(MAC_CLK_1G_INPUT_DELAY_2 | MAC_CLK_1G_OUTPUT_DELAY_2);
 		reg[0] |= FIELD_PREP(MAC_CLK_1G_INPUT_DELAY_2, mac2_cfg.rx_delay_1000) |
@@ -996,7 +1014,7 @@ static u32 ast2600_configure_mac34_clk(struct ast2600_clk_priv *priv, struct ude
 			  FIELD_PREP(MAC_CLK_100M_10M_OUTPUT_DELAY_2, ret);
 	}
 
-	ret = dev_read_u32_array(dev, "mac2-clk-delay", (u32 *)&mac3_cfg, sizeof(mac3_cfg) / sizeof(u32));
+	ret = ast2600_read_mac_delay(dev, "mac2-clk-delay", &mac3_cfg);
 	if (!ret) {
 		reg[0] &= ~(MAC_CLK_1G_INPUT_DELAY_1 | MAC_CLK_1G_OUTPUT_DELAY_1);
 		reg[0] |= FIELD_PREP(MAC_CLK_1G_INPUT_DELAY_1, mac3_cfg.rx_delay_1000) |
@@ -1011,7 +1029,7 @@ static u32 ast2600_configure_mac34_clk(struct ast2600_clk_priv *priv, struct ude
 			  FIELD_PREP(MAC_CLK_100M_10M_OUTPUT_DELAY_1, mac3_cfg.tx_delay_10);
 	}
 
-	ret = dev_read_u32_array(dev, "mac3-clk-delay", (u32 *)&mac4_cfg, sizeof(mac4_cfg) / sizeof(u32));
+	ret = ast2600_read_mac_delay(dev, "mac3-clk-delay", &mac4_cfg);
 	if (!ret) {
 		reg[0] &= ~(MAC_CLK_1G_INPUT_DELAY_2 | MAC_CLK_1G_OUTPUT_DELAY_2);
 		reg[0] |= FIELD_PREP(MAC_CLK_1G_INPUT_DELAY_2, mac4_cfg.rx_delay_1000) |
@@ -1564,11 +1582,18 @@ static int ast2600_clk_probe(struct udevice *dev)
 	struct ast2600_clk_priv *priv = dev_get_priv(dev);
 	u32 uart_clk_source;
 
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	struct ast2600_clk_plat *plat = dev_get_platdata(dev);
+
+	priv->scu = map_sysmem(plat->dtplat.reg[0], plat->dtplat.reg[1]);
+	uart_clk_source = plat->dtplat.uart_clk_source;
+#else
 	priv->scu = devfdt_get_addr_ptr(dev);
 	if (IS_ERR(priv->scu))
 		return PTR_ERR(priv->scu);
 
 	uart_clk_source = dev_read_u32_default(dev, "uart-clk-source", 0x0);
+#endif
 
 	if (uart_clk_source) {
 		if (uart_clk_source & GENMASK(5, 0))
@@ -1668,11 +1693,13 @@ static const struct udevice_id ast2600_clk_ids[] = {
 };
 
 U_BOOT_DRIVER(aspeed_scu) = {
-	.name = "aspeed_scu",
+	.name = "aspeed_ast2600_scu",
 	.id = UCLASS_CLK,
 	.of_match = ast2600_clk_ids,
 	.priv_auto_alloc_size = sizeof(struct ast2600_clk_priv),
+	.platdata_auto_alloc_size = sizeof(struct ast2600_clk_plat),
 	.ops = &ast2600_clk_ops,
 	.bind = ast2600_clk_bind,
 	.probe = ast2600_clk_probe,
+	.flags = DM_FLAG_HANDOFF,
 };
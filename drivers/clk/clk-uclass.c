@@ -13,12 +13,82 @@
 #include <dm/read.h>
 #include <dt-structs.h>
 #include <errno.h>
+#include <handoff.h>
 
 static inline const struct clk_ops *clk_dev_ops(struct udevice *dev)
 {
 	return (const struct clk_ops *)dev->driver->ops;
 }
 
+#ifdef CONFIG_CLK_RATE_CACHE
+#define CLK_RATE_CACHE_SIZE	16
+
+/**
+ * struct clk_rate_cache - rates last returned by a clock provider
+ *
+ * @id:		Clock ID of each entry
+ * @data:	Clock data of each entry
+ * @rate:	Rate of each entry
+ * @count:	Number of valid entries
+ * @next:	Entry to replace once the cache is full
+ */
+struct clk_rate_cache {
+	ulong id[CLK_RATE_CACHE_SIZE];
+	ulong data[CLK_RATE_CACHE_SIZE];
+	ulong rate[CLK_RATE_CACHE_SIZE];
+	int count;
+	int next;
+};
+
+static int clk_rate_cache_find(struct clk_rate_cache *cache, struct clk *clk)
+{
+	int i;
+
+	for (i = 0; i < cache->count; i++) {
+		if (cache->id[i] == clk->id && cache->data[i] == clk->data)
+			return i;
+	}
+
+	return -ENOENT;
+}
+
+static void clk_rate_cache_add(struct clk_rate_cache *cache, struct clk *clk,
+			       ulong rate)
+{
+	int i = cache->next;
+
+	if (cache->count < CLK_RATE_CACHE_SIZE)
+		cache->count++;
+	cache->next = (cache->next + 1) % CLK_RATE_CACHE_SIZE;
+
+	cache->id[i] = clk->id;
+	cache->data[i] = clk->data;
+	cache->rate[i] = rate;
+}
+
+/*
+ * A clock may be the parent of clocks on other providers, so any change
+ * drops the cached rates of all of them.
+ */
+static void clk_rate_cache_invalidate(void)
+{
+	struct clk_rate_cache *cache;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	if (uclass_get(UCLASS_CLK, &uc))
+		return;
+
+	uclass_foreach_dev(dev, uc) {
+		cache = dev_get_uclass_priv(dev);
+		if (cache)
+			cache->count = cache->next = 0;
+	}
+}
+#else
+static inline void clk_rate_cache_invalidate(void) {}
+#endif
+
 #if CONFIG_IS_ENABLED(OF_CONTROL)
 # if CONFIG_IS_ENABLED(OF_PLATDATA)
 int clk_get_by_index_platdata(struct udevice *dev, int index,
@@ -331,25 +401,58 @@ int clk_free(struct clk *clk)
 ulong clk_get_rate(struct clk *clk)
 {
 	const struct clk_ops *ops = clk_dev_ops(clk->dev);
+#ifdef CONFIG_CLK_RATE_CACHE
+	struct clk_rate_cache *cache = dev_get_uclass_priv(clk->dev);
+	ulong rate;
+	int i;
+#endif
 
 	debug("%s(clk=%p)\n", __func__, clk);
 
 	if (!ops->get_rate)
 		return -ENOSYS;
 
+#ifdef CONFIG_CLK_RATE_CACHE
+	if (!cache)
+		return ops->get_rate(clk);
+
+	i = clk_rate_cache_find(cache, clk);
+	if (i >= 0)
+		return cache->rate[i];
+
+	rate = ops->get_rate(clk);
+	if (!IS_ERR_VALUE(rate))
+		clk_rate_cache_add(cache, clk, rate);
+
+	return rate;
+#else
 	return ops->get_rate(clk);
+#endif
 }
 
 ulong clk_set_rate(struct clk *clk, ulong rate)
 {
 	const struct clk_ops *ops = clk_dev_ops(clk->dev);
+	ulong ret;
 
 	debug("%s(clk=%p, rate=%lu)\n", __func__, clk, rate);
 
 	if (!ops->set_rate)
 		return -ENOSYS;
 
-	return ops->set_rate(clk, rate);
+	clk_rate_cache_invalidate();
+#if CONFIG_IS_ENABLED(HANDOFF) && defined(CONFIG_HANDOFF_DEVICES)
+	if (!IS_ENABLED(CONFIG_SPL_BUILD) &&
+	    handoff_adopt_clk_rate(clk, rate, &ret))
+		return ret;
+#endif
+	ret = ops->set_rate(clk, rate);
+#if CONFIG_IS_ENABLED(HANDOFF) && defined(CONFIG_HANDOFF_DEVICES)
+	if (IS_ENABLED(CONFIG_SPL_BUILD) && !IS_ERR_VALUE(ret))
+		handoff_save_clk_rate(clk, rate, ret);
+#endif
+
+	return ret;
 }
 
 int clk_set_parent(struct clk *clk, struct clk *parent)
@@ -361,6 +464,8 @@ int clk_set_parent(struct clk *clk, struct clk *parent)
 	if (!ops->set_parent)
 		return -ENOSYS;
 
+	clk_rate_cache_invalidate();
+
 	return ops->set_parent(clk, parent);
 }
 
@@ -373,6 +478,8 @@ int clk_enable(struct clk *clk)
 	if (!ops->enable)
 		return -ENOSYS;
 
+	clk_rate_cache_invalidate();
+
 	return ops->enable(clk);
 }
 
@@ -398,6 +505,8 @@ int clk_disable(struct clk *clk)
 	if (!ops->disable)
 		return -ENOSYS;
 
+	clk_rate_cache_invalidate();
+
 	return ops->disable(clk);
 }
 
@@ -417,4 +526,7 @@ int clk_disable_bulk(struct clk_bulk *bulk)
 UCLASS_DRIVER(clk) = {
 	.id		= UCLASS_CLK,
 	.name		= "clk",
+#ifdef CONFIG_CLK_RATE_CACHE
+	.per_device_auto_alloc_size = sizeof(struct clk_rate_cache),
+#endif
 };
@@ -10,6 +10,7 @@
 
 #include <common.h>
 #include <asm/io.h>
+#include <bootstage.h>
 #include <clk.h>
 #include <fdtdec.h>
 #include <fdt_support.h>
@@ -21,6 +22,7 @@
 #include <dm/pinctrl.h>
 #include <dm/platdata.h>
 #include <dm/read.h>
+#include <dm/root.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
@@ -30,6 +32,27 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#ifdef CONFIG_DM_TIMING
+#define dm_timing_start()			timer_get_us()
+#define dm_timing_end(dev, field, start)	\
+	((dev)->timing.field = timer_get_us() - (start))
+#else
+#define dm_timing_start()			0
+#define dm_timing_end(dev, field, start)	do { } while (0)
+#endif
+
+/* Add the devices which are slow to probe to the bootstage report */
+static void dm_timing_report(struct udevice *dev)
+{
+#if defined(CONFIG_DM_TIMING_BOOTSTAGE_MIN_US) && CONFIG_IS_ENABLED(BOOTSTAGE)
+	u32 self_us = dev->timing.probe_us - dev->timing.parent_us;
+
+	if (self_us >= CONFIG_DM_TIMING_BOOTSTAGE_MIN_US)
+		bootstage_add_accum(dev->name, timer_get_boot_us() - self_us,
+				    self_us);
+#endif
+}
+
 static int device_bind_common(struct udevice *parent, const struct driver *drv,
 			      const char *name, void *platdata,
 			      ulong driver_data, ofnode node,
@@ -37,6 +60,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 {
 	struct udevice *dev;
 	struct uclass *uc;
+	ulong __maybe_unused start = dm_timing_start();
 	int size, ret = 0;
 
 	if (devp)
@@ -50,7 +74,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		return ret;
 	}
 
-	dev = calloc(1, sizeof(struct udevice));
+	dev = dm_pool_alloc(sizeof(struct udevice));
 	if (!dev)
 		return -ENOMEM;
 
@@ -100,8 +124,8 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		}
 		if (alloc) {
 			dev->flags |= DM_FLAG_ALLOC_PDATA;
-			dev->platdata = calloc(1,
-					       drv->platdata_auto_alloc_size);
+			dev->platdata = dm_pool_alloc(
+					drv->platdata_auto_alloc_size);
 			if (!dev->platdata) {
 				ret = -ENOMEM;
 				goto fail_alloc1;
@@ -116,7 +140,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	size = uc->uc_drv->per_device_platdata_auto_alloc_size;
 	if (size) {
 		dev->flags |= DM_FLAG_ALLOC_UCLASS_PDATA;
-		dev->uclass_platdata = calloc(1, size);
+		dev->uclass_platdata = dm_pool_alloc(size);
 		if (!dev->uclass_platdata) {
 			ret = -ENOMEM;
 			goto fail_alloc2;
@@ -131,7 +155,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		}
 		if (size) {
 			dev->flags |= DM_FLAG_ALLOC_PARENT_PDATA;
-			dev->parent_platdata = calloc(1, size);
+			dev->parent_platdata = dm_pool_alloc(size);
 			if (!dev->parent_platdata) {
 				ret = -ENOMEM;
 				goto fail_alloc3;
@@ -170,6 +194,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		*devp = dev;
 
 	dev->flags |= DM_FLAG_BOUND;
+	dm_timing_end(dev, bind_us, start);
 
 	return 0;
 
@@ -194,24 +219,31 @@ fail_uclass_bind:
 	if (CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)) {
 		list_del(&dev->sibling_node);
 		if (dev->flags & DM_FLAG_ALLOC_PARENT_PDATA) {
-			free(dev->parent_platdata);
+			size = parent->driver->
+					per_child_platdata_auto_alloc_size;
+			if (!size) {
+				size = parent->uclass->uc_drv->
+					per_child_platdata_auto_alloc_size;
+			}
+			dm_pool_free(dev->parent_platdata, size);
 			dev->parent_platdata = NULL;
 		}
 	}
 fail_alloc3:
 	if (dev->flags & DM_FLAG_ALLOC_UCLASS_PDATA) {
-		free(dev->uclass_platdata);
+		dm_pool_free(dev->uclass_platdata,
+			     uc->uc_drv->per_device_platdata_auto_alloc_size);
 		dev->uclass_platdata = NULL;
 	}
 fail_alloc2:
 	if (dev->flags & DM_FLAG_ALLOC_PDATA) {
-		free(dev->platdata);
+		dm_pool_free(dev->platdata, drv->platdata_auto_alloc_size);
 		dev->platdata = NULL;
 	}
 fail_alloc1:
 	devres_release_all(dev);
 
-	free(dev);
+	dm_pool_free(dev, sizeof(struct udevice));
 
 	return ret;
 }
@@ -299,7 +331,7 @@ static void *alloc_priv(int size, uint flags)
 #endif
 		}
 	} else {
-		priv = calloc(1, size);
+		priv = dm_pool_alloc(size);
 	}
 
 	return priv;
@@ -309,6 +341,8 @@ int device_probe(struct udevice *dev)
 {
 	struct power_domain pd;
 	const struct driver *drv;
+	ulong __maybe_unused start = dm_timing_start();
+	ulong __maybe_unused t;
 	int size = 0;
 	int ret;
 	int seq;
@@ -356,7 +390,9 @@ int device_probe(struct udevice *dev)
 			}
 		}
 
+		t = dm_timing_start();
 		ret = device_probe(dev->parent);
+		dm_timing_end(dev, parent_us, t);
 		if (ret)
 			goto fail;
 
@@ -375,7 +411,7 @@ int device_probe(struct udevice *dev)
 		ret = seq;
 		goto fail;
 	}
-	dev->seq = seq;
+	uclass_set_seq(dev, seq);
 
 	dev->flags |= DM_FLAG_ACTIVATED;
 
@@ -385,13 +421,17 @@ int device_probe(struct udevice *dev)
 	 * settings for pinctrl devices since the device may not yet be
 	 * probed.
 	 */
+	t = dm_timing_start();
 	if (dev->parent && device_get_uclass_id(dev) != UCLASS_PINCTRL)
 		pinctrl_select_state(dev, "default");
+	dm_timing_end(dev, pinctrl_us, t);
 
+	t = dm_timing_start();
 	if (dev->parent && device_get_uclass_id(dev) != UCLASS_POWER_DOMAIN) {
 		if (!power_domain_get(dev, &pd))
 			power_domain_on(&pd);
 	}
+	dm_timing_end(dev, power_us, t);
 
 	ret = uclass_pre_probe_device(dev);
 	if (ret)
@@ -410,7 +450,9 @@ int device_probe(struct udevice *dev)
 	}
 
 	/* Process 'assigned-{clocks/clock-parents/clock-rates}' properties */
+	t = dm_timing_start();
 	ret = clk_set_defaults(dev);
+	dm_timing_end(dev, clk_us, t);
 	if (ret)
 		goto fail;
 
@@ -426,8 +468,14 @@ int device_probe(struct udevice *dev)
 	if (ret)
 		goto fail_uclass;
 
-	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL)
+	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL) {
+		t = dm_timing_start();
 		pinctrl_select_state(dev, "default");
+		dm_timing_end(dev, pinctrl_us, t);
+	}
+
+	dm_timing_end(dev, probe_us, start);
+	dm_timing_report(dev);
 
 	return 0;
 fail_uclass:
@@ -438,7 +486,7 @@ fail_uclass:
 fail:
 	dev->flags &= ~DM_FLAG_ACTIVATED;
 
-	dev->seq = -1;
+	uclass_set_seq(dev, -1);
 	device_free(dev);
 
 	return ret;
@@ -550,6 +598,7 @@ int device_get_child(struct udevice *parent, int index, struct udevice **devp)
 {
 	struct udevice *dev;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (!index--)
 			return device_get_device_tail(dev, 0, devp);
@@ -567,6 +616,7 @@ int device_find_child_by_seq(struct udevice *parent, int seq_or_req_seq,
 	if (seq_or_req_seq == -1)
 		return -ENODEV;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if ((find_req_seq ? dev->req_seq : dev->seq) ==
 				seq_or_req_seq) {
@@ -603,6 +653,7 @@ int device_find_child_by_of_offset(struct udevice *parent, int of_offset,
 
 	*devp = NULL;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (dev_of_offset(dev) == of_offset) {
 			*devp = dev;
@@ -641,9 +692,21 @@ static struct udevice *_device_find_global_by_ofnode(struct udevice *parent,
 	return NULL;
 }
 
+static struct udevice *device_find_global(ofnode ofnode)
+{
+	struct udevice *dev;
+
+	dm_lazy_bind_ofnode(ofnode);
+	dev = uclass_find_global_by_ofnode(ofnode);
+	if (dev)
+		return dev;
+
+	return _device_find_global_by_ofnode(gd->dm_root, ofnode);
+}
+
 int device_find_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
-	*devp = _device_find_global_by_ofnode(gd->dm_root, ofnode);
+	*devp = device_find_global(ofnode);
 
 	return *devp ? 0 : -ENOENT;
 }
@@ -652,12 +715,13 @@ int device_get_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
 	struct udevice *dev;
 
-	dev = _device_find_global_by_ofnode(gd->dm_root, ofnode);
+	dev = device_find_global(ofnode);
 	return device_get_device_tail(dev, dev ? 0 : -ENOENT, devp);
 }
 
 int device_find_first_child(struct udevice *parent, struct udevice **devp)
 {
+	dm_lazy_bind_children(parent);
 	if (list_empty(&parent->child_head)) {
 		*devp = NULL;
 	} else {
@@ -690,6 +754,7 @@ int device_find_first_inactive_child(struct udevice *parent,
 	struct udevice *dev;
 
 	*devp = NULL;
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (!device_active(dev) &&
 		    device_get_uclass_id(dev) == uclass_id) {
@@ -708,6 +773,7 @@ int device_find_first_child_by_uclass(struct udevice *parent,
 	struct udevice *dev;
 
 	*devp = NULL;
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (device_get_uclass_id(dev) == uclass_id) {
 			*devp = dev;
@@ -725,6 +791,7 @@ int device_find_child_by_name(struct udevice *parent, const char *name,
 
 	*devp = NULL;
 
+	dm_lazy_bind_children(parent);
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
 		if (!strcmp(dev->name, name)) {
 			*devp = dev;
@@ -19,6 +19,9 @@ static void show_devices(struct udevice *dev, int depth, int last_flag)
 	printf(" %-10.10s  %2d  [ %c ]   %-20.20s  ", dev->uclass->uc_drv->name,
 	       dev_get_uclass_index(dev, NULL),
 	       dev->flags & DM_FLAG_ACTIVATED ? '+' : ' ', dev->driver->name);
+#ifdef CONFIG_DM_TIMING
+	printf("%8u  %9u  ", dev->timing.bind_us, dev->timing.probe_us);
+#endif
 
 	for (i = depth; i >= 0; i--) {
 		is_last = (last_flag >> i) & 1;
@@ -49,8 +52,13 @@ void dm_dump_all(void)
 
 	root = dm_root();
 	if (root) {
+#ifdef CONFIG_DM_TIMING
+		printf(" Class     Index  Probed  Driver                Bind(us)  Probe(us)  Name\n");
+		printf("--------------------------------------------------------------------------------\n");
+#else
 		printf(" Class     Index  Probed  Driver                Name\n");
 		printf("-----------------------------------------------------------\n");
+#endif
 		show_devices(root, -1, 0);
 	}
 }
@@ -69,6 +77,12 @@ static void dm_display_line(struct udevice *dev, int index)
 	       dev->name, (ulong)map_to_sysmem(dev));
 	if (dev->seq != -1 || dev->req_seq != -1)
 		printf(", seq %d, (req %d)", dev->seq, dev->req_seq);
+#ifdef CONFIG_DM_TIMING
+	printf("\n    bind %u us, probe %u us (parent %u, pinctrl %u, power %u, clk %u)",
+	       dev->timing.bind_us, dev->timing.probe_us,
+	       dev->timing.parent_us, dev->timing.pinctrl_us,
+	       dev->timing.power_us, dev->timing.clk_us);
+#endif
 	puts("\n");
 }
 
@@ -0,0 +1,232 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Lazy binding of device tree nodes
+ *
+ * Instead of binding a device for every node while scanning the device
+ * tree, the scan only records which nodes have a driver in a compact table.
+ * A device is bound the first time its uclass, its node or the children of
+ * its parent are looked up. Nodes below a device are only bound if that
+ * device scans its subnodes with dm_scan_fdt_dev(), as with eager binding.
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <dm/lists.h>
+#include <dm/root.h>
+#include <dm/util.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Number of nodes allocated at once in the table */
+#define DM_LAZY_CHUNK_NODES	32
+
+enum dm_lazy_state {
+	DM_LAZY_WAITING,	/* the parent did not scan its subnodes yet */
+	DM_LAZY_READY,		/* can be bound to parent_dev */
+	DM_LAZY_BOUND,		/* bound, or binding was attempted */
+};
+
+/**
+ * struct dm_lazy_node - A device tree node which has a driver
+ *
+ * @node: Device tree node
+ * @parent: Entry of the parent node, NULL for nodes scanned by a device
+ *	which is not in the table (e.g. the root device)
+ * @parent_dev: Device to bind the node to, once it scanned its subnodes
+ * @uclass_id: Uclass of the driver matching the node
+ * @state: enum dm_lazy_state
+ */
+struct dm_lazy_node {
+	ofnode node;
+	struct dm_lazy_node *parent;
+	struct udevice *parent_dev;
+	u8 uclass_id;
+	u8 state;
+};
+
+struct dm_lazy_chunk {
+	struct dm_lazy_chunk *next;
+	int count;
+	struct dm_lazy_node nodes[DM_LAZY_CHUNK_NODES];
+};
+
+#define dm_lazy_foreach(chunk, e)					\
+	for (chunk = gd->dm_lazy; chunk; chunk = chunk->next)		\
+		for (e = chunk->nodes; e < chunk->nodes + chunk->count; e++)
+
+static struct dm_lazy_node *dm_lazy_add(void)
+{
+	struct dm_lazy_chunk *chunk, **chunkp = &gd->dm_lazy;
+
+	for (chunk = gd->dm_lazy; chunk; chunk = chunk->next) {
+		if (chunk->count < DM_LAZY_CHUNK_NODES)
+			return &chunk->nodes[chunk->count++];
+		chunkp = &chunk->next;
+	}
+
+	chunk = calloc(1, sizeof(*chunk));
+	if (!chunk)
+		return NULL;
+	*chunkp = chunk;
+
+	return &chunk->nodes[chunk->count++];
+}
+
+static struct dm_lazy_node *dm_lazy_find(ofnode node)
+{
+	struct dm_lazy_chunk *chunk;
+	struct dm_lazy_node *e;
+
+	dm_lazy_foreach(chunk, e) {
+		if (ofnode_equal(e->node, node))
+			return e;
+	}
+
+	return NULL;
+}
+
+/*
+ * Record the subnodes of @parent_node which have a driver, and their own
+ * subnodes. Only the direct subnodes can be bound to @parent_dev, the
+ * others wait until their parent scans them.
+ */
+static int dm_lazy_record(struct dm_lazy_node *parent, ofnode parent_node,
+			  struct udevice *parent_dev, bool pre_reloc_only)
+{
+	const struct driver *drv;
+	struct dm_lazy_node *e;
+	ofnode node;
+	int ret;
+
+	ofnode_for_each_subnode(node, parent_node) {
+		const char *name = ofnode_get_name(node);
+
+		/*
+		 * The "chosen" and "firmware" nodes aren't devices
+		 * themselves but may contain some:
+		 */
+		if (!strcmp(name, "chosen") || !strcmp(name, "firmware")) {
+			ret = dm_lazy_record(parent, node, parent_dev,
+					     pre_reloc_only);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		if (!ofnode_is_available(node))
+			continue;
+
+		/* A device outside the table may scan the same nodes again */
+		if (!parent && dm_lazy_find(node))
+			continue;
+
+		drv = lists_match_fdt(node, pre_reloc_only);
+		if (!drv)
+			continue;
+
+		e = dm_lazy_add();
+		if (!e)
+			return -ENOMEM;
+		e->node = node;
+		e->parent = parent;
+		e->parent_dev = parent_dev;
+		e->uclass_id = drv->id;
+		e->state = parent_dev ? DM_LAZY_READY : DM_LAZY_WAITING;
+
+		ret = dm_lazy_record(e, node, NULL, pre_reloc_only);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int dm_lazy_scan(struct udevice *parent_dev, ofnode parent_node,
+		 bool pre_reloc_only)
+{
+	struct dm_lazy_chunk *chunk;
+	struct dm_lazy_node *parent, *e;
+
+	/* The subnodes of a device bound from the table are known already */
+	parent = dm_lazy_find(parent_node);
+	if (!parent)
+		return dm_lazy_record(NULL, parent_node, parent_dev,
+				      pre_reloc_only);
+
+	dm_lazy_foreach(chunk, e) {
+		if (e->parent == parent && e->state == DM_LAZY_WAITING) {
+			e->parent_dev = parent_dev;
+			e->state = DM_LAZY_READY;
+		}
+	}
+
+	return 0;
+}
+
+static int dm_lazy_bind_node(struct dm_lazy_node *e)
+{
+	int ret;
+
+	if (e->state == DM_LAZY_BOUND)
+		return 0;
+
+	if (e->state == DM_LAZY_WAITING) {
+		if (!e->parent)
+			return -ENODEV;
+		ret = dm_lazy_bind_node(e->parent);
+		if (ret)
+			return ret;
+		/* The parent device does not bind its subnodes */
+		if (e->state == DM_LAZY_WAITING)
+			return -ENODEV;
+	}
+
+	e->state = DM_LAZY_BOUND;
+	ret = lists_bind_fdt(e->parent_dev, e->node, NULL,
+			     !(gd->flags & GD_FLG_RELOC));
+	if (ret)
+		dm_warn("Lazy binding of '%s' failed: %d\n",
+			ofnode_get_name(e->node), ret);
+
+	return ret;
+}
+
+void dm_lazy_bind_uclass(enum uclass_id id)
+{
+	struct dm_lazy_chunk *chunk;
+	struct dm_lazy_node *e;
+
+	dm_lazy_foreach(chunk, e) {
+		if (e->uclass_id == id)
+			dm_lazy_bind_node(e);
+	}
+}
+
+void dm_lazy_bind_ofnode(ofnode node)
+{
+	struct dm_lazy_node *e = dm_lazy_find(node);
+
+	if (e)
+		dm_lazy_bind_node(e);
+}
+
+void dm_lazy_bind_children(struct udevice *parent)
+{
+	struct dm_lazy_chunk *chunk;
+	struct dm_lazy_node *e;
+
+	dm_lazy_foreach(chunk, e) {
+		if (e->parent_dev == parent && e->state == DM_LAZY_READY)
+			dm_lazy_bind_node(e);
+	}
+}
+
+void dm_lazy_reset(void)
+{
+	/*
+	 * The table may live in the pre-relocation heap, which cannot be
+	 * freed; simply forget about it.
+	 */
+	gd->dm_lazy = NULL;
+}
@@ -122,6 +122,40 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
+const struct driver *lists_match_fdt(ofnode node, bool pre_reloc_only)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct driver *entry;
+	const char *compat_list, *compat;
+	int compat_length, i;
+
+	compat_list = ofnode_get_property(node, "compatible", &compat_length);
+	if (!compat_list)
+		return NULL;
+
+	for (i = 0; i < compat_length; i += strlen(compat) + 1) {
+		compat = compat_list + i;
+
+		for (entry = driver; entry != driver + n_ents; entry++) {
+			if (!driver_check_compatible(entry->of_match, &id,
+						     compat))
+				break;
+		}
+		if (entry == driver + n_ents)
+			continue;
+
+		if (pre_reloc_only && !dm_ofnode_pre_reloc(node) &&
+		    !(entry->flags & DM_FLAG_PRE_RELOC))
+			return NULL;
+
+		return entry;
+	}
+
+	return NULL;
+}
+
 int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		   bool pre_reloc_only)
 {
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Object pool for driver model allocations
+ *
+ * Every bound device costs a struct udevice plus up to three platdata
+ * blocks, and every probed device up to three more private-data blocks.
+ * These are small and mostly a handful of common sizes, so carve them
+ * from large chunks with one free list per size class rather than giving
+ * each its own malloc() block with a header and alignment padding.
+ *
+ * The pool is only used once the full malloc() is available. Before that
+ * the simple malloc() is already a bump allocator and its memory is never
+ * freed, so allocations there go straight to calloc(). Frees check which
+ * chunk (if any) the pointer came from, so objects allocated before the
+ * pool was in use can still be freed safely.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <dm/device-internal.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define DM_POOL_CHUNK_SIZE	SZ_8K
+#define DM_POOL_ALIGN		16
+
+static const uint dm_pool_class_size[] = { 16, 32, 64, 128, 256, 512 };
+
+#define DM_POOL_CLASSES		ARRAY_SIZE(dm_pool_class_size)
+
+/**
+ * struct dm_pool_chunk - a chunk of memory that objects are carved from
+ *
+ * @next: Next chunk in the pool
+ * @free: Start of the memory not yet handed out
+ * @end: End of this chunk
+ */
+struct dm_pool_chunk {
+	struct dm_pool_chunk *next;
+	char *free;
+	char *end;
+};
+
+/* Freed objects are kept on a list, linked through their first word */
+struct dm_pool_obj {
+	struct dm_pool_obj *next;
+};
+
+static struct {
+	struct dm_pool_chunk *chunks;
+	struct dm_pool_obj *free[DM_POOL_CLASSES];
+} dm_pool;
+
+static int dm_pool_class(size_t size)
+{
+	int i;
+
+	for (i = 0; i < DM_POOL_CLASSES; i++) {
+		if (size <= dm_pool_class_size[i])
+			return i;
+	}
+
+	return -1;
+}
+
+static struct dm_pool_chunk *dm_pool_find_chunk(void *ptr)
+{
+	struct dm_pool_chunk *chunk;
+
+	for (chunk = dm_pool.chunks; chunk; chunk = chunk->next) {
+		if ((char *)ptr > (char *)chunk && (char *)ptr < chunk->end)
+			return chunk;
+	}
+
+	return NULL;
+}
+
+static void *dm_pool_carve(uint size)
+{
+	struct dm_pool_chunk *chunk = dm_pool.chunks;
+	void *ptr;
+
+	if (!chunk || chunk->free + size > chunk->end) {
+		chunk = malloc(DM_POOL_CHUNK_SIZE);
+		if (!chunk)
+			return NULL;
+		chunk->free = (char *)chunk + ALIGN(sizeof(*chunk),
+						    DM_POOL_ALIGN);
+		chunk->end = (char *)chunk + DM_POOL_CHUNK_SIZE;
+		/*
+		 * The rest of the old chunk is wasted. It is less than the
+		 * largest size class, and chunks are much larger than that.
+		 */
+		chunk->next = dm_pool.chunks;
+		dm_pool.chunks = chunk;
+	}
+	ptr = chunk->free;
+	chunk->free += size;
+
+	return ptr;
+}
+
+void *dm_pool_alloc(size_t size)
+{
+	struct dm_pool_obj *obj;
+	void *ptr;
+	int cls;
+
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return calloc(1, size);
+
+	cls = dm_pool_class(size);
+	if (cls < 0)
+		return calloc(1, size);
+
+	obj = dm_pool.free[cls];
+	if (obj) {
+		dm_pool.free[cls] = obj->next;
+		ptr = obj;
+	} else {
+		ptr = dm_pool_carve(dm_pool_class_size[cls]);
+		if (!ptr)
+			return calloc(1, size);
+	}
+	memset(ptr, '\0', dm_pool_class_size[cls]);
+
+	return ptr;
+}
+
+void dm_pool_free(void *ptr, size_t size)
+{
+	struct dm_pool_obj *obj = ptr;
+	int cls;
+
+	if (!ptr)
+		return;
+
+	cls = dm_pool_class(size);
+	if (cls < 0 || !dm_pool_find_chunk(ptr)) {
+		free(ptr);
+		return;
+	}
+	obj->next = dm_pool.free[cls];
+	dm_pool.free[cls] = obj;
+}
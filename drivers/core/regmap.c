@@ -30,11 +30,32 @@ static struct regmap *regmap_alloc(int count)
 	map = malloc(sizeof(*map) + sizeof(map->ranges[0]) * count);
 	if (!map)
 		return NULL;
+	map->endianness = REGMAP_NATIVE_ENDIAN;
+	map->base = NULL;
 	map->range_count = count;
 
 	return map;
 }
 
+/**
+ * regmap_init_base() - Set up the fast path for a regmap
+ *
+ * Native-endian accesses to the first range are plain MMIO, so map it once
+ * and let regmap_read()/regmap_write() skip the generic lookups.
+ *
+ * @map: Regmap with its ranges and endianness set up
+ */
+static void regmap_init_base(struct regmap *map)
+{
+	struct regmap_range *range = &map->ranges[0];
+
+	if (map->range_count && map->endianness == REGMAP_NATIVE_ENDIAN)
+		map->base = map_physmem(range->start, range->size,
+					MAP_NOCACHE);
+	else
+		map->base = NULL;
+}
+
 #if CONFIG_IS_ENABLED(OF_PLATDATA)
 int regmap_init_mem_platdata(struct udevice *dev, fdt_val_t *reg, int count,
 			     struct regmap **mapp)
@@ -50,6 +71,7 @@ int regmap_init_mem_platdata(struct udevice *dev, fdt_val_t *reg, int count,
 		range->start = *reg;
 		range->size = reg[1];
 	}
+	regmap_init_base(map);
 
 	*mapp = map;
 
@@ -172,6 +194,7 @@ int regmap_init_mem(ofnode node, struct regmap **mapp)
 		map->endianness = REGMAP_NATIVE_ENDIAN;
 	else /* Default: native endianness */
 		map->endianness = REGMAP_NATIVE_ENDIAN;
+	regmap_init_base(map);
 
 	*mapp = map;
 
@@ -296,6 +319,14 @@ int regmap_raw_read(struct regmap *map, uint offset, void *valp, size_t val_len)
 
 int regmap_read(struct regmap *map, uint offset, uint *valp)
 {
+	if (likely(map->base &&
+		   offset + REGMAP_SIZE_32 <= map->ranges[0].size)) {
+		void *ptr = map->base + offset;
+
+		*valp = readl(ptr);
+		return 0;
+	}
+
 	return regmap_raw_read(map, offset, valp, REGMAP_SIZE_32);
 }
 
@@ -406,6 +437,14 @@ int regmap_raw_write(struct regmap *map, uint offset, const void *val,
 
 int regmap_write(struct regmap *map, uint offset, uint val)
 {
+	if (likely(map->base &&
+		   offset + REGMAP_SIZE_32 <= map->ranges[0].size)) {
+		void *ptr = map->base + offset;
+
+		writel(val, ptr);
+		return 0;
+	}
+
 	return regmap_raw_write(map, offset, &val, REGMAP_SIZE_32);
 }
 
@@ -422,3 +461,20 @@ int regmap_update_bits(struct regmap *map, uint offset, uint mask, uint val)
 
 	return regmap_write(map, offset, reg | val);
 }
+
+int regmap_multi_reg_write(struct regmap *map, const struct reg_sequence *regs,
+			   int num_regs)
+{
+	int ret;
+	int i;
+
+	for (i = 0; i < num_regs; i++) {
+		ret = regmap_write(map, regs[i].reg, regs[i].def);
+		if (ret)
+			return ret;
+		if (regs[i].delay_us)
+			udelay(regs[i].delay_us);
+	}
+
+	return 0;
+}
@@ -158,6 +158,7 @@ int dm_init(bool of_live)
 		return -EINVAL;
 	}
 	INIT_LIST_HEAD(&DM_UCLASS_ROOT_NON_CONST);
+	dm_lazy_reset();
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	fix_drivers();
@@ -188,6 +189,7 @@ int dm_uninit(void)
 	device_remove(dm_root(), DM_REMOVE_NORMAL);
 	device_unbind(dm_root());
 	gd->dm_root = NULL;
+	dm_lazy_reset();
 
 	return 0;
 }
@@ -222,6 +224,10 @@ static int dm_scan_fdt_live(struct udevice *parent,
 	struct device_node *np;
 	int ret = 0, err;
 
+	if (CONFIG_IS_ENABLED(DM_LAZY_BIND))
+		return dm_lazy_scan(parent, np_to_ofnode(node_parent),
+				    pre_reloc_only);
+
 	for (np = node_parent->child; np; np = np->sibling) {
 		/* "chosen" node isn't a device itself but may contain some: */
 		if (!strcmp(np->name, "chosen")) {
@@ -271,6 +277,10 @@ static int dm_scan_fdt_node(struct udevice *parent, const void *blob,
 {
 	int ret = 0, err;
 
+	if (CONFIG_IS_ENABLED(DM_LAZY_BIND))
+		return dm_lazy_scan(parent, offset_to_ofnode(offset),
+				    pre_reloc_only);
+
 	for (offset = fdt_first_subnode(blob, offset);
 	     offset > 0;
 	     offset = fdt_next_subnode(blob, offset)) {
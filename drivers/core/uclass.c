@@ -13,12 +13,159 @@
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
+#include <dm/root.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
+#include <linux/log2.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/* Minimum number of entries of the seq array and node hash table */
+#define UCLASS_INDEX_MIN	16
+
+static uint uclass_node_hash(ofnode node, int size)
+{
+	ulong key = (ulong)node.of_offset;
+
+	/* Live tree nodes are pointers, fold their alignment bits away */
+	key ^= key >> 6;
+
+	return ((u32)key * 0x9e3779b1) >> (32 - ilog2(size));
+}
+
+static void uclass_node_insert(struct uclass *uc, struct udevice *dev)
+{
+	uint mask = uc->node_size - 1;
+	uint i = uclass_node_hash(dev_ofnode(dev), uc->node_size);
+
+	while (uc->node_devs[i]) {
+		/* Keep the first device using the node, as a list walk would */
+		if (ofnode_equal(dev_ofnode(uc->node_devs[i]), dev_ofnode(dev)))
+			return;
+		i = (i + 1) & mask;
+	}
+	uc->node_devs[i] = dev;
+	uc->node_count++;
+}
+
+/*
+ * (Re)build the node hash table from the device list. Entries are never
+ * removed from the table, it is rebuilt instead when a device goes away
+ * or is found to have changed its node.
+ */
+static void uclass_node_rebuild(struct uclass *uc)
+{
+	struct udevice *dev;
+	int count = 0, size = UCLASS_INDEX_MIN;
+
+	uclass_foreach_dev(dev, uc) {
+		if (ofnode_valid(dev_ofnode(dev)))
+			count++;
+	}
+	while (size < (count + 1) * 2)
+		size *= 2;
+
+	free(uc->node_devs);
+	uc->node_devs = calloc(size, sizeof(*uc->node_devs));
+	uc->node_count = 0;
+	if (!uc->node_devs) {
+		uc->node_size = -1;
+		return;
+	}
+	uc->node_size = size;
+
+	uclass_foreach_dev(dev, uc) {
+		if (ofnode_valid(dev_ofnode(dev)))
+			uclass_node_insert(uc, dev);
+	}
+}
+
+static void uclass_node_add(struct uclass *uc, struct udevice *dev)
+{
+	if (uc->node_size < 0 || !ofnode_valid(dev_ofnode(dev)))
+		return;
+
+	if ((uc->node_count + 1) * 2 > uc->node_size)
+		uclass_node_rebuild(uc);
+	else
+		uclass_node_insert(uc, dev);
+}
+
+static struct udevice *uclass_node_find(struct uclass *uc, ofnode node)
+{
+	struct udevice *dev;
+	uint mask, i;
+
+	if (uc->node_size <= 0)
+		return NULL;
+
+	mask = uc->node_size - 1;
+	for (i = uclass_node_hash(node, uc->node_size); uc->node_devs[i];
+	     i = (i + 1) & mask) {
+		dev = uc->node_devs[i];
+		if (ofnode_equal(dev_ofnode(dev), node))
+			return dev;
+	}
+
+	return NULL;
+}
+
+static void uclass_seq_disable(struct uclass *uc)
+{
+	free(uc->seq_devs);
+	uc->seq_devs = NULL;
+	uc->seq_size = -1;
+}
+
+static void uclass_seq_add(struct uclass *uc, struct udevice *dev, int seq)
+{
+	struct udevice **devs;
+	int size;
+
+	if (seq >= uc->seq_size) {
+		size = max(UCLASS_INDEX_MIN, uc->seq_size);
+		while (size <= seq)
+			size *= 2;
+		devs = calloc(size, sizeof(*devs));
+		if (!devs) {
+			uclass_seq_disable(uc);
+			return;
+		}
+		if (uc->seq_devs)
+			memcpy(devs, uc->seq_devs,
+			       uc->seq_size * sizeof(*devs));
+		free(uc->seq_devs);
+		uc->seq_devs = devs;
+		uc->seq_size = size;
+	}
+
+	/* A duplicate sequence number needs the list walk to pick the device */
+	if (uc->seq_devs[seq]) {
+		uclass_seq_disable(uc);
+		return;
+	}
+	uc->seq_devs[seq] = dev;
+}
+#endif
+
+void uclass_set_seq(struct udevice *dev, int seq)
+{
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct uclass *uc = dev->uclass;
+
+	if (uc->seq_size >= 0) {
+		if (dev->seq >= 0 && dev->seq < uc->seq_size &&
+		    uc->seq_devs[dev->seq] == dev)
+			uc->seq_devs[dev->seq] = NULL;
+		if (seq >= 0)
+			uclass_seq_add(uc, dev, seq);
+	}
+#endif
+	dev->seq = seq;
+}
+
 struct uclass *uclass_find(enum uclass_id key)
 {
 	struct uclass *uc;
@@ -65,11 +212,11 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 		 */
 		return -EPFNOSUPPORT;
 	}
-	uc = calloc(1, sizeof(*uc));
+	uc = dm_pool_alloc(sizeof(*uc));
 	if (!uc)
 		return -ENOMEM;
 	if (uc_drv->priv_auto_alloc_size) {
-		uc->priv = calloc(1, uc_drv->priv_auto_alloc_size);
+		uc->priv = dm_pool_alloc(uc_drv->priv_auto_alloc_size);
 		if (!uc->priv) {
 			ret = -ENOMEM;
 			goto fail_mem;
@@ -91,12 +238,12 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	return 0;
 fail:
 	if (uc_drv->priv_auto_alloc_size) {
-		free(uc->priv);
+		dm_pool_free(uc->priv, uc_drv->priv_auto_alloc_size);
 		uc->priv = NULL;
 	}
 	list_del(&uc->sibling_node);
 fail_mem:
-	free(uc);
+	dm_pool_free(uc, sizeof(*uc));
 
 	return ret;
 }
@@ -129,8 +276,12 @@ int uclass_destroy(struct uclass *uc)
 		uc_drv->destroy(uc);
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto_alloc_size)
-		free(uc->priv);
-	free(uc);
+		dm_pool_free(uc->priv, uc_drv->priv_auto_alloc_size);
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	free(uc->seq_devs);
+	free(uc->node_devs);
+#endif
+	dm_pool_free(uc, sizeof(*uc));
 
 	return 0;
 }
@@ -148,6 +299,17 @@ int uclass_get(enum uclass_id id, struct uclass **ucp)
 	return 0;
 }
 
+/*
+ * Get a uclass to look up its devices, after binding the nodes of the uclass
+ * which are still waiting in the lazy binding table
+ */
+static int uclass_get_for_lookup(enum uclass_id id, struct uclass **ucp)
+{
+	dm_lazy_bind_uclass(id);
+
+	return uclass_get(id, ucp);
+}
+
 const char *uclass_get_name(enum uclass_id id)
 {
 	struct uclass *uc;
@@ -199,7 +361,7 @@ int uclass_find_device(enum uclass_id id, int index, struct udevice **devp)
 	int ret;
 
 	*devp = NULL;
-	ret = uclass_get(id, &uc);
+	ret = uclass_get_for_lookup(id, &uc);
 	if (ret)
 		return ret;
 	if (list_empty(&uc->dev_head))
@@ -221,7 +383,7 @@ int uclass_find_first_device(enum uclass_id id, struct udevice **devp)
 	int ret;
 
 	*devp = NULL;
-	ret = uclass_get(id, &uc);
+	ret = uclass_get_for_lookup(id, &uc);
 	if (ret)
 		return ret;
 	if (list_empty(&uc->dev_head))
@@ -255,7 +417,7 @@ int uclass_find_device_by_name(enum uclass_id id, const char *name,
 	*devp = NULL;
 	if (!name)
 		return -EINVAL;
-	ret = uclass_get(id, &uc);
+	ret = uclass_get_for_lookup(id, &uc);
 	if (ret)
 		return ret;
 
@@ -304,10 +466,19 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 	debug("%s: %d %d\n", __func__, find_req_seq, seq_or_req_seq);
 	if (seq_or_req_seq == -1)
 		return -ENODEV;
-	ret = uclass_get(id, &uc);
+	ret = uclass_get_for_lookup(id, &uc);
 	if (ret)
 		return ret;
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	if (!find_req_seq && uc->seq_size >= 0) {
+		if (seq_or_req_seq >= 0 && seq_or_req_seq < uc->seq_size)
+			*devp = uc->seq_devs[seq_or_req_seq];
+		debug("   - %s\n", *devp ? "found" : "not found");
+		return *devp ? 0 : -ENODEV;
+	}
+#endif
+
 	uclass_foreach_dev(dev, uc) {
 		debug("   - %d %d '%s'\n", dev->req_seq, dev->seq, dev->name);
 		if ((find_req_seq ? dev->req_seq : dev->seq) ==
@@ -332,7 +503,7 @@ int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 	*devp = NULL;
 	if (node < 0)
 		return -ENODEV;
-	ret = uclass_get(id, &uc);
+	ret = uclass_get_for_lookup(id, &uc);
 	if (ret)
 		return ret;
 
@@ -357,15 +528,26 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	*devp = NULL;
 	if (!ofnode_valid(node))
 		return -ENODEV;
-	ret = uclass_get(id, &uc);
+	ret = uclass_get_for_lookup(id, &uc);
 	if (ret)
 		return ret;
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	*devp = uclass_node_find(uc, node);
+	if (*devp)
+		goto done;
+#endif
+
 	uclass_foreach_dev(dev, uc) {
 		log(LOGC_DM, LOGL_DEBUG_CONTENT, "      - checking %s\n",
 		    dev->name);
 		if (ofnode_equal(dev_ofnode(dev), node)) {
 			*devp = dev;
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+			/* The node was set after binding, refresh the index */
+			if (uc->node_size >= 0)
+				uclass_node_rebuild(uc);
+#endif
 			goto done;
 		}
 	}
@@ -377,6 +559,47 @@ done:
 	return ret;
 }
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+static bool uclass_dev_is_ancestor(struct udevice *ancestor,
+				   struct udevice *dev)
+{
+	for (dev = dev->parent; dev; dev = dev->parent) {
+		if (dev == ancestor)
+			return true;
+	}
+
+	return false;
+}
+
+struct udevice *uclass_find_global_by_ofnode(ofnode node)
+{
+	struct udevice *dev, *found = NULL;
+	struct uclass *uc;
+
+	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
+		dev = uclass_node_find(uc, node);
+		if (!dev || dev == found)
+			continue;
+		/*
+		 * A device tree walk finds the parent first when a device
+		 * and its child share the node; for unrelated devices the
+		 * order depends on the tree, so let the caller walk it.
+		 */
+		if (!found || uclass_dev_is_ancestor(dev, found))
+			found = dev;
+		else if (!uclass_dev_is_ancestor(found, dev))
+			return NULL;
+	}
+
+	return found;
+}
+#else
+struct udevice *uclass_find_global_by_ofnode(ofnode node)
+{
+	return NULL;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(OF_CONTROL)
 int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
 				  const char *name, struct udevice **devp)
@@ -390,7 +613,7 @@ int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
 	find_phandle = dev_read_u32_default(parent, name, -1);
 	if (find_phandle <= 0)
 		return -ENOENT;
-	ret = uclass_get(id, &uc);
+	ret = uclass_get_for_lookup(id, &uc);
 	if (ret)
 		return ret;
 
@@ -417,7 +640,7 @@ int uclass_get_device_by_driver(enum uclass_id id,
 	struct uclass *uc;
 	int ret;
 
-	ret = uclass_get(id, &uc);
+	ret = uclass_get_for_lookup(id, &uc);
 	if (ret)
 		return ret;
 
@@ -517,7 +740,7 @@ int uclass_get_device_by_phandle_id(enum uclass_id id, uint phandle_id,
 	int ret;
 
 	*devp = NULL;
-	ret = uclass_get(id, &uc);
+	ret = uclass_get_for_lookup(id, &uc);
 	if (ret)
 		return ret;
 
@@ -631,6 +854,9 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	uclass_node_add(uc, dev);
+#endif
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -646,6 +872,10 @@ int uclass_bind_device(struct udevice *dev)
 err:
 	/* There is no need to undo the parent's post_bind call */
 	list_del(&dev->uclass_node);
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	if (uc->node_size > 0)
+		uclass_node_rebuild(uc);
+#endif
 
 	return ret;
 }
@@ -664,6 +894,10 @@ int uclass_unbind_device(struct udevice *dev)
 	}
 
 	list_del(&dev->uclass_node);
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	if (uc->node_size > 0)
+		uclass_node_rebuild(uc);
+#endif
 	return 0;
 }
 #endif
@@ -47,10 +47,13 @@ struct aspeed_acry {
 	phys_addr_t base;
 	phys_addr_t sram_base; /* internal sram */
 	struct clk clk;
+	/* DMA buffer of the operation in progress, NULL when idle */
+	u8 *ctx;
+	int num_bits;
 };
 
-static int aspeed_acry_mod_exp(struct udevice *dev, const uint8_t *sig, uint32_t sig_len,
-			       struct key_prop *prop, uint8_t *out)
+static int aspeed_acry_mod_exp_start(struct udevice *dev, const uint8_t *sig,
+				     uint32_t sig_len, struct key_prop *prop)
 {
 	int i, j;
 	u8 *ctx;
@@ -58,6 +61,9 @@ static int aspeed_acry_mod_exp(struct udevice *dev, const uint8_t *sig, uint32_t
 	u32 reg;
 	struct aspeed_acry *acry = dev_get_priv(dev);
 
+	if (acry->ctx)
+		return -EBUSY;
+
 	ctx = memalign(16, ACRY_CTX_BUFSZ);
 	if (!ctx)
 		return -ENOMEM;
@@ -99,6 +105,21 @@ static int aspeed_acry_mod_exp(struct udevice *dev, const uint8_t *sig, uint32_t
 
 	writel(ACRY_CTRL1_RSA_DMA | ACRY_CTRL1_RSA_START, acry->base + ACRY_CTRL1);
 
+	acry->ctx = ctx;
+	acry->num_bits = prop->num_bits;
+
+	return 0;
+}
+
+static int aspeed_acry_mod_exp_finish(struct udevice *dev, uint8_t *out)
+{
+	int i, j;
+	u32 reg;
+	struct aspeed_acry *acry = dev_get_priv(dev);
+
+	if (!acry->ctx)
+		return -EINVAL;
+
 	/* polling RSA status */
 	while (1) {
 		reg = readl(acry->base + ACRY_RSA_INT_STS);
@@ -114,17 +135,30 @@ static int aspeed_acry_mod_exp(struct udevice *dev, const uint8_t *sig, uint32_t
 	writel(ACRY_CTRL3_SRAM_AHB_ACCESS, acry->base + ACRY_CTRL3);
 	udelay(20);
 
-	for (i = (prop->num_bits / 8) - 1, j = 0; i >= 0; --i) {
+	for (i = (acry->num_bits / 8) - 1, j = 0; i >= 0; --i) {
 		out[i] = readb(acry->sram_base + (j + 32));
 		j++;
 		j = (j % 16) ? j : j + 32;
 	}
 
-	free(ctx);
+	free(acry->ctx);
+	acry->ctx = NULL;
 
 	return 0;
 }
 
+static int aspeed_acry_mod_exp(struct udevice *dev, const uint8_t *sig, uint32_t sig_len,
+			       struct key_prop *prop, uint8_t *out)
+{
+	int ret;
+
+	ret = aspeed_acry_mod_exp_start(dev, sig, sig_len, prop);
+	if (ret)
+		return ret;
+
+	return aspeed_acry_mod_exp_finish(dev, out);
+}
+
 static int aspeed_acry_probe(struct udevice *dev)
 {
 	struct aspeed_acry *acry = dev_get_priv(dev);
@@ -171,6 +205,8 @@ static int aspeed_acry_remove(struct udevice *dev)
 
 static const struct mod_exp_ops aspeed_acry_ops = {
 	.mod_exp = aspeed_acry_mod_exp,
+	.mod_exp_start = aspeed_acry_mod_exp_start,
+	.mod_exp_finish = aspeed_acry_mod_exp_finish,
 };
 
 static const struct udevice_id aspeed_acry_ids[] = {
@@ -7,18 +7,36 @@
 #include <clk.h>
 
 #include <log.h>
+#include <asm/cache.h>
 #include <asm/io.h>
 #include <malloc.h>
 #include <hash.h>
+#include <hw_aes.h>
+#include <hw_sha.h>
+#include <image.h>
 
 #include <dm/device.h>
 #include <dm/fdtaddr.h>
+#include <dm/lists.h>
+#include <u-boot/hash.h>
 
 #include <linux/bitops.h>
 #include <linux/delay.h>
 #include <linux/kernel.h>
 #include <linux/iopoll.h>
 
+#define ASPEED_HACE_SRC			0x00
+#define ASPEED_HACE_DEST		0x04
+#define ASPEED_HACE_CONTEXT		0x08
+#define ASPEED_HACE_DATA_LEN		0x0C
+#define ASPEED_HACE_CMD			0x10
+#define  HACE_CMD_AES_KEY_HW_EXP	BIT(13)
+#define  HACE_CMD_ISR_EN		BIT(12)
+#define  HACE_CMD_CTR			BIT(6)
+#define  HACE_CMD_CBC			BIT(4)
+#define  HACE_CMD_AES256		BIT(3)
+#define  HACE_CMD_AES192		BIT(2)
+#define  HACE_CMD_AES128		0
 #define ASPEED_HACE_STS			0x1C
 #define  HACE_RSA_ISR			BIT(13)
 #define  HACE_CRYPTO_ISR		BIT(12)
@@ -59,14 +77,26 @@ struct aspeed_sg {
 };
 
 struct aspeed_hash_ctx {
-	struct aspeed_sg sg[2]; /* Must be 8 byte aligned */
-	u8 digest[64]; /* Must be 8 byte aligned */
+	/* Written by the engine: keep it in cache lines of its own */
+	u8 digest[64] __aligned(ARCH_DMA_MINALIGN);
+	struct aspeed_sg sg[2] __aligned(ARCH_DMA_MINALIGN);
 	u32 method;
 	u32 digest_size;
 	u32 block_size;
 	u64 digcnt[2]; /* total length */
 	u32 bufcnt;
 	u8 buffer[256];
+	/*
+	 * Asynchronous updates leave the engine running when they return:
+	 * the partial block is staged in tail[] so that buffer[] is not
+	 * touched while the engine may still be reading it.
+	 */
+	bool pending;
+	u32 pending_len;
+	ulong pending_start;
+	u8 tail[128];
+	/* Set once an update failed, returned by every later call */
+	int err;
 };
 
 struct aspeed_hace {
@@ -99,6 +129,33 @@ static const u32 sha512_iv[16] = {
 
 static phys_addr_t base;
 
+/*
+ * The engine accesses the DRAM behind the D-cache: what it reads is
+ * flushed before it starts and what it writes is invalidated once it is
+ * done. These are no-ops while the D-cache is off.
+ */
+static void hace_flush(const void *buf, size_t len)
+{
+	flush_dcache_range(rounddown((ulong)buf, ARCH_DMA_MINALIGN),
+			   roundup((ulong)buf + len, ARCH_DMA_MINALIGN));
+}
+
+static void hace_inval(const void *buf, size_t len)
+{
+	invalidate_dcache_range(rounddown((ulong)buf, ARCH_DMA_MINALIGN),
+				roundup((ulong)buf + len, ARCH_DMA_MINALIGN));
+}
+
+static void hace_flush_sg(const struct aspeed_sg *sg)
+{
+	int i = 0;
+
+	do {
+		hace_flush((void *)sg[i].addr, sg[i].len & ~HACE_SG_LAST);
+	} while (!(sg[i++].len & HACE_SG_LAST));
+	hace_flush(sg, i * sizeof(*sg));
+}
+
 static int aspeed_hace_wait_completion(u32 reg, u32 flag, int timeout_us)
 {
 	u32 val;
@@ -131,7 +188,8 @@ static void aspeed_ahash_fill_padding(struct aspeed_hash_ctx *ctx, unsigned int
 	}
 }
 
-static int hash_trigger(struct aspeed_hash_ctx *ctx, int hash_len)
+static int hash_start(struct aspeed_hash_ctx *ctx, struct aspeed_sg *sg,
+		      int hash_len)
 {
 	if (readl(base + ASPEED_HACE_STS) & HACE_HASH_BUSY) {
 		debug("HACE error: engine busy\n");
@@ -140,16 +198,73 @@ static int hash_trigger(struct aspeed_hash_ctx *ctx, int hash_len)
 	/* Clear pending completion status */
 	writel(HACE_HASH_ISR, base + ASPEED_HACE_STS);
 
-	writel((u32)ctx->sg, base + ASPEED_HACE_HASH_SRC);
+	hace_flush_sg(sg);
+	hace_flush(ctx->digest, sizeof(ctx->digest));
+	writel((u32)sg, base + ASPEED_HACE_HASH_SRC);
 	writel((u32)ctx->digest, base + ASPEED_HACE_HASH_DIGEST_BUFF);
 	writel((u32)ctx->digest, base + ASPEED_HACE_HASH_KEY_BUFF);
 	writel(hash_len, base + ASPEED_HACE_HASH_DATA_LEN);
 	writel(ctx->method, base + ASPEED_HACE_HASH_CMD);
 
+	return 0;
+}
+
+static int hash_trigger(struct aspeed_hash_ctx *ctx, struct aspeed_sg *sg,
+			int hash_len)
+{
+	int rc;
+
+	rc = hash_start(ctx, sg, hash_len);
+	if (rc)
+		return rc;
+
 	/* SHA512 hashing appears to have a througput of about 12MB/s */
-	return aspeed_hace_wait_completion(base + ASPEED_HACE_STS,
-					   HACE_HASH_ISR,
-					   1000 + (hash_len >> 3));
+	rc = aspeed_hace_wait_completion(base + ASPEED_HACE_STS,
+					 HACE_HASH_ISR,
+					 1000 + (hash_len >> 3));
+	hace_inval(ctx->digest, sizeof(ctx->digest));
+
+	return rc;
+}
+
+/*
+ * The context whose asynchronous update is running on the engine, if any.
+ * The digest state lives in each context, so contexts may take turns on
+ * the engine as long as one update is finished before the next starts.
+ */
+static struct aspeed_hash_ctx *active;
+
+static void hash_complete(struct aspeed_hash_ctx *ctx, int rc)
+{
+	ctx->pending = false;
+	ctx->err = rc;
+	active = NULL;
+	hace_inval(ctx->digest, sizeof(ctx->digest));
+	memcpy(ctx->buffer, ctx->tail, ctx->bufcnt);
+}
+
+/* Wait for an asynchronous update to complete and restore the partial block */
+static int hash_wait(struct aspeed_hash_ctx *ctx)
+{
+	int rc;
+
+	if (!ctx->pending)
+		return ctx->err;
+
+	rc = aspeed_hace_wait_completion(base + ASPEED_HACE_STS,
+					 HACE_HASH_ISR,
+					 1000 + (ctx->pending_len >> 3));
+	hash_complete(ctx, rc);
+
+	return rc;
+}
+
+/* Let the update of another context finish before using the engine */
+static void hash_idle(void)
+{
+	/* An error stays with the context it belongs to */
+	if (active)
+		hash_wait(active);
 }
 
 #if IS_ENABLED(CONFIG_SHA_PROG_HW_ACCEL)
@@ -159,7 +274,7 @@ int hw_sha_init(struct hash_algo *algo, void **ctxp)
 	u32 method;
 	u32 block_size;
 
-	ctx = memalign(8, sizeof(struct aspeed_hash_ctx));
+	ctx = memalign(ARCH_DMA_MINALIGN, sizeof(struct aspeed_hash_ctx));
 	memset(ctx, '\0', sizeof(struct aspeed_hash_ctx));
 
 	method = HASH_CMD_ACC_MODE | HACE_SHA_BE_EN | HACE_SG_EN;
@@ -198,17 +313,23 @@ int hw_sha_init(struct hash_algo *algo, void **ctxp)
 
 	return 0;
 }
+#endif
 
-int hw_sha_update(struct hash_algo *algo, void *hash_ctx, const void *buf,
-		  unsigned int size, int is_last)
+#if IS_ENABLED(CONFIG_SHA_PROG_HW_ACCEL) || CONFIG_IS_ENABLED(DM_HASH)
+static int aspeed_sha_update(struct aspeed_hash_ctx *ctx, const void *buf,
+			     unsigned int size, bool async)
 {
-	struct aspeed_hash_ctx *ctx = hash_ctx;
 	struct aspeed_sg *sg = ctx->sg;
 	int rc;
 	int remainder;
 	int total_len;
 	int i;
 
+	rc = hash_wait(ctx);
+	if (rc)
+		return rc;
+	hash_idle();
+
 	ctx->digcnt[0] += size;
 	if (ctx->digcnt[0] < size)
 		ctx->digcnt[1]++;
@@ -234,23 +355,47 @@ int hw_sha_update(struct hash_algo *algo, void *hash_ctx, const void *buf,
 		sg[i].len = (total_len - ctx->bufcnt) | HACE_SG_LAST;
 	}
 
-	rc = hash_trigger(ctx, total_len);
+	if (async) {
+		rc = hash_start(ctx, sg, total_len);
+		if (rc) {
+			ctx->err = rc;
+			return rc;
+		}
+		active = ctx;
+		ctx->pending = true;
+		ctx->pending_len = total_len;
+		ctx->pending_start = timer_get_us();
+		memcpy(ctx->tail, buf + (total_len - ctx->bufcnt), remainder);
+		ctx->bufcnt = remainder;
+
+		return 0;
+	}
+
+	rc = hash_trigger(ctx, sg, total_len);
 	if (remainder != 0) {
 		memcpy(ctx->buffer, buf + (total_len - ctx->bufcnt), remainder);
 		ctx->bufcnt = remainder;
 	} else {
 		ctx->bufcnt = 0;
 	}
+	ctx->err = rc;
 
 	return rc;
 }
 
-int hw_sha_finish(struct hash_algo *algo, void *hash_ctx, void *dest_buf, int size)
+static int aspeed_sha_finish(struct aspeed_hash_ctx *ctx, void *dest_buf,
+			     int size)
 {
-	struct aspeed_hash_ctx *ctx = hash_ctx;
 	struct aspeed_sg *sg = ctx->sg;
 	int rc;
 
+	rc = hash_wait(ctx);
+	if (rc) {
+		free(ctx);
+		return rc;
+	}
+	hash_idle();
+
 	if (size < ctx->digest_size) {
 		debug("HACE error: insufficient size on destination buffer\n");
 		free(ctx);
@@ -261,7 +406,7 @@ int hw_sha_finish(struct hash_algo *algo, void *hash_ctx, void *dest_buf, int si
 	sg[0].addr = (u32)ctx->buffer;
 	sg[0].len = ctx->bufcnt | HACE_SG_LAST;
 
-	rc = hash_trigger(ctx, ctx->bufcnt);
+	rc = hash_trigger(ctx, sg, ctx->bufcnt);
 	memcpy(dest_buf, ctx->digest, ctx->digest_size);
 
 	free(ctx);
@@ -270,29 +415,27 @@ int hw_sha_finish(struct hash_algo *algo, void *hash_ctx, void *dest_buf, int si
 }
 #endif
 
-static int sha_digest(const void *src, unsigned int length, void *digest,
-		      u32 sha_type)
+#if IS_ENABLED(CONFIG_SHA_PROG_HW_ACCEL)
+int hw_sha_update(struct hash_algo *algo, void *hash_ctx, const void *buf,
+		  unsigned int size, int is_last)
 {
-	struct aspeed_hash_ctx *ctx;
-	int ret;
-
-	if (!((u32)src & BIT(31))) {
-		debug("HACE src out of bounds: can only copy from SDRAM\n");
-		return -EINVAL;
-	}
+	return aspeed_sha_update(hash_ctx, buf, size, false);
+}
 
-	if (readl(base + ASPEED_HACE_STS) & HACE_HASH_BUSY) {
-		debug("HACE error: engine busy\n");
-		return -EBUSY;
-	}
+int hw_sha_update_async(struct hash_algo *algo, void *hash_ctx,
+			const void *buf, unsigned int size, int is_last)
+{
+	return aspeed_sha_update(hash_ctx, buf, size, true);
+}
 
-	ctx = memalign(8, sizeof(struct aspeed_hash_ctx));
-	memset(ctx, '\0', sizeof(struct aspeed_hash_ctx));
+int hw_sha_finish(struct hash_algo *algo, void *hash_ctx, void *dest_buf, int size)
+{
+	return aspeed_sha_finish(hash_ctx, dest_buf, size);
+}
+#endif
 
-	if (!ctx) {
-		debug("HACE error: Cannot allocate memory for context\n");
-		return -ENOMEM;
-	}
+static int aspeed_sha_ctx_setup(struct aspeed_hash_ctx *ctx, u32 sha_type)
+{
 	ctx->method = HASH_CMD_ACC_MODE | HACE_SHA_BE_EN | HACE_SG_EN;
 
 	switch (sha_type) {
@@ -310,7 +453,7 @@ static int sha_digest(const void *src, unsigned int length, void *digest,
 		break;
 	case ASPEED_SHA_TYPE_SHA384:
 		ctx->block_size = 128;
-		ctx->digest_size = 64;
+		ctx->digest_size = 48;
 		ctx->method |= HACE_ALGO_SHA384;
 		memcpy(ctx->digest, sha384_iv, 64);
 		break;
@@ -324,6 +467,38 @@ static int sha_digest(const void *src, unsigned int length, void *digest,
 		return -ENOTSUPP;
 	}
 
+	return 0;
+}
+
+static int sha_digest(const void *src, unsigned int length, void *digest,
+		      u32 sha_type)
+{
+	struct aspeed_hash_ctx *ctx;
+	int ret;
+
+	if (!((u32)src & BIT(31))) {
+		debug("HACE src out of bounds: can only copy from SDRAM\n");
+		return -EINVAL;
+	}
+
+	hash_idle();
+	if (readl(base + ASPEED_HACE_STS) & HACE_HASH_BUSY) {
+		debug("HACE error: engine busy\n");
+		return -EBUSY;
+	}
+
+	ctx = memalign(ARCH_DMA_MINALIGN, sizeof(struct aspeed_hash_ctx));
+	memset(ctx, '\0', sizeof(struct aspeed_hash_ctx));
+
+	if (!ctx) {
+		debug("HACE error: Cannot allocate memory for context\n");
+		return -ENOMEM;
+	}
+	if (aspeed_sha_ctx_setup(ctx, sha_type)) {
+		free(ctx);
+		return -ENOTSUPP;
+	}
+
 	ctx->digcnt[0] = length;
 	ctx->digcnt[1] = 0;
 
@@ -339,13 +514,112 @@ static int sha_digest(const void *src, unsigned int length, void *digest,
 		ctx->sg[0].len = ctx->bufcnt | HACE_SG_LAST;
 	}
 
-	ret = hash_trigger(ctx, length + ctx->bufcnt);
+	ret = hash_trigger(ctx, ctx->sg, length + ctx->bufcnt);
 	memcpy(digest, ctx->digest, ctx->digest_size);
 	free(ctx);
 
 	return ret;
 }
 
+#if IS_ENABLED(CONFIG_SHA_HW_SG) || CONFIG_IS_ENABLED(DM_HASH)
+static u32 aspeed_sha_type(const char *name)
+{
+	if (!strcmp(name, "sha1"))
+		return ASPEED_SHA_TYPE_SHA1;
+	if (!strcmp(name, "sha256"))
+		return ASPEED_SHA_TYPE_SHA256;
+	if (!strcmp(name, "sha384"))
+		return ASPEED_SHA_TYPE_SHA384;
+	if (!strcmp(name, "sha512"))
+		return ASPEED_SHA_TYPE_SHA512;
+
+	return 0;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_SHA_HW_SG)
+int hw_sha_digest_sg(struct hash_algo *algo,
+		     const struct image_region region[], int region_count,
+		     void *dest_buf, int size)
+{
+	struct aspeed_hash_ctx *ctx;
+	struct aspeed_sg *sg;
+	u32 length = 0;
+	int i, n;
+	int ret;
+
+	if (size < algo->digest_size) {
+		debug("HACE error: insufficient size on destination buffer\n");
+		return -ENOSPC;
+	}
+
+	/*
+	 * The engine fetches the regions itself, so every one of them must
+	 * live in SDRAM. Let the caller fall back otherwise.
+	 */
+	for (i = 0; i < region_count; i++) {
+		if (region[i].size && !((u32)region[i].data & BIT(31))) {
+			debug("HACE SG region %d out of bounds: %p\n", i,
+			      region[i].data);
+			return -EINVAL;
+		}
+		length += region[i].size;
+	}
+
+	hash_idle();
+	if (readl(base + ASPEED_HACE_STS) & HACE_HASH_BUSY) {
+		debug("HACE error: engine busy\n");
+		return -EBUSY;
+	}
+
+	ctx = memalign(ARCH_DMA_MINALIGN, sizeof(struct aspeed_hash_ctx));
+	if (!ctx) {
+		debug("HACE error: Cannot allocate memory for context\n");
+		return -ENOMEM;
+	}
+	memset(ctx, '\0', sizeof(struct aspeed_hash_ctx));
+
+	/* Not an algorithm the engine knows, e.g. crc32: let the caller cope */
+	if (aspeed_sha_ctx_setup(ctx, aspeed_sha_type(algo->name))) {
+		ret = -EINVAL;
+		goto err_ctx;
+	}
+
+	/* One descriptor per region plus one for the padding block */
+	sg = memalign(8, (region_count + 1) * sizeof(struct aspeed_sg));
+	if (!sg) {
+		debug("HACE error: Cannot allocate memory for SG list\n");
+		ret = -ENOMEM;
+		goto err_ctx;
+	}
+
+	ctx->digcnt[0] = length;
+	ctx->digcnt[1] = 0;
+	aspeed_ahash_fill_padding(ctx, length);
+
+	n = 0;
+	for (i = 0; i < region_count; i++) {
+		if (!region[i].size)
+			continue;
+		sg[n].addr = (u32)region[i].data;
+		sg[n].len = region[i].size;
+		n++;
+	}
+	sg[n].addr = (u32)ctx->buffer;
+	sg[n].len = ctx->bufcnt | HACE_SG_LAST;
+
+	ret = hash_trigger(ctx, sg, length + ctx->bufcnt);
+	if (!ret)
+		memcpy(dest_buf, ctx->digest, ctx->digest_size);
+
+	free(sg);
+err_ctx:
+	free(ctx);
+
+	return ret;
+}
+#endif
+
 void hw_sha1(const unsigned char *pbuf, unsigned int buf_len,
 	     unsigned char *pout, unsigned int chunk_size)
 {
@@ -386,6 +660,267 @@ void hw_sha512(const unsigned char *pbuf, unsigned int buf_len,
 		debug("HACE failure: %d\n", rc);
 }
 
+#if IS_ENABLED(CONFIG_AES_HW_ACCEL)
+/*
+ * The crypto engine runs next to the hash engine, so a stream can be
+ * decrypted while another one is hashed. It saves the chaining state back
+ * into the context buffer after every command.
+ */
+struct aspeed_aes_ctx {
+	/* IV or counter, then the key; in cache lines of its own */
+	u8 context[48] __aligned(ARCH_DMA_MINALIGN);
+	u32 cmd __aligned(ARCH_DMA_MINALIGN);
+	bool pending;
+	void *pending_dst;
+	u32 pending_len;
+	int err;
+};
+
+static struct aspeed_aes_ctx *aes_active;
+
+static int aes_wait(struct aspeed_aes_ctx *ctx)
+{
+	int rc;
+
+	if (!ctx->pending)
+		return ctx->err;
+
+	/* Assume at least the 8MB/s of the hash engine */
+	rc = aspeed_hace_wait_completion(base + ASPEED_HACE_STS,
+					 HACE_CRYPTO_ISR,
+					 1000 + (ctx->pending_len >> 3));
+	hace_inval(ctx->context, sizeof(ctx->context));
+	hace_inval(ctx->pending_dst, ctx->pending_len);
+	ctx->pending = false;
+	ctx->err = rc;
+	aes_active = NULL;
+
+	return rc;
+}
+
+int hw_aes_init(enum hw_aes_mode mode, const u8 *key, int key_len,
+		const u8 *iv, void **ctxp)
+{
+	struct aspeed_aes_ctx *ctx;
+	u32 cmd;
+
+	switch (key_len) {
+	case 16:
+		cmd = HACE_CMD_AES128;
+		break;
+	case 24:
+		cmd = HACE_CMD_AES192;
+		break;
+	case 32:
+		cmd = HACE_CMD_AES256;
+		break;
+	default:
+		debug("HACE error: unsupported AES key length %d\n", key_len);
+		return -EINVAL;
+	}
+
+	ctx = memalign(ARCH_DMA_MINALIGN, sizeof(struct aspeed_aes_ctx));
+	if (!ctx) {
+		debug("HACE error: Cannot allocate memory for context\n");
+		return -ENOMEM;
+	}
+	memset(ctx, '\0', sizeof(struct aspeed_aes_ctx));
+
+	/* Decryption is the default direction */
+	ctx->cmd = cmd | HACE_CMD_AES_KEY_HW_EXP | HACE_CMD_ISR_EN |
+		   (mode == HW_AES_CTR ? HACE_CMD_CTR : HACE_CMD_CBC);
+	memcpy(ctx->context, iv, HW_AES_BLOCK_SIZE);
+	memcpy(ctx->context + HW_AES_BLOCK_SIZE, key, key_len);
+	*ctxp = ctx;
+
+	return 0;
+}
+
+int hw_aes_decrypt(void *vctx, const void *src, void *dst, unsigned int len)
+{
+	struct aspeed_aes_ctx *ctx = vctx;
+	int rc;
+
+	rc = aes_wait(ctx);
+	if (rc)
+		return rc;
+	if (aes_active)
+		aes_wait(aes_active);
+
+	if (!((u32)src & BIT(31)) || !((u32)dst & BIT(31))) {
+		debug("HACE AES buffers out of bounds: %p -> %p\n", src, dst);
+		return -EINVAL;
+	}
+	if (len % HW_AES_BLOCK_SIZE) {
+		ctx->err = -EINVAL;
+		return -EINVAL;
+	}
+	if (!len)
+		return 0;
+
+	if (readl(base + ASPEED_HACE_STS) & HACE_CRYPTO_BUSY) {
+		debug("HACE error: crypto engine busy\n");
+		ctx->err = -EBUSY;
+		return -EBUSY;
+	}
+	/* Clear pending completion status */
+	writel(HACE_CRYPTO_ISR, base + ASPEED_HACE_STS);
+
+	/* The destination lines must not be written back over the result */
+	hace_flush(src, len);
+	hace_flush(dst, len);
+	hace_flush(ctx->context, sizeof(ctx->context));
+	writel((u32)src, base + ASPEED_HACE_SRC);
+	writel((u32)dst, base + ASPEED_HACE_DEST);
+	writel((u32)ctx->context, base + ASPEED_HACE_CONTEXT);
+	writel(len, base + ASPEED_HACE_DATA_LEN);
+	writel(ctx->cmd, base + ASPEED_HACE_CMD);
+
+	ctx->pending = true;
+	ctx->pending_dst = dst;
+	ctx->pending_len = len;
+	aes_active = ctx;
+
+	return 0;
+}
+
+int hw_aes_finish(void *vctx)
+{
+	struct aspeed_aes_ctx *ctx = vctx;
+	int rc;
+
+	rc = aes_wait(ctx);
+	free(ctx);
+
+	return rc;
+}
+#endif
+
+#if CONFIG_IS_ENABLED(DM_HASH)
+/* Like hash_wait(), but do not block: -EBUSY while the engine runs */
+static int hash_poll(struct aspeed_hash_ctx *ctx)
+{
+	if (!ctx->pending)
+		return ctx->err;
+
+	if (readl(base + ASPEED_HACE_STS) & HACE_HASH_ISR)
+		hash_complete(ctx, 0);
+	else if (timer_get_us() - ctx->pending_start >
+		 1000 + (ctx->pending_len >> 3))
+		hash_complete(ctx, -ETIMEDOUT);
+	else
+		return -EBUSY;
+
+	return ctx->err;
+}
+
+static bool aspeed_hace_hash_supports(struct udevice *dev,
+				     const char *algo_name)
+{
+	return aspeed_sha_type(algo_name) != 0;
+}
+
+static int aspeed_hace_hash_init(struct udevice *dev, const char *algo_name,
+				 void **ctxp)
+{
+	struct aspeed_hash_ctx *ctx;
+
+	ctx = memalign(ARCH_DMA_MINALIGN, sizeof(struct aspeed_hash_ctx));
+	if (!ctx) {
+		debug("HACE error: Cannot allocate memory for context\n");
+		return -ENOMEM;
+	}
+	memset(ctx, '\0', sizeof(struct aspeed_hash_ctx));
+
+	if (aspeed_sha_ctx_setup(ctx, aspeed_sha_type(algo_name))) {
+		free(ctx);
+		return -EPROTONOSUPPORT;
+	}
+	*ctxp = ctx;
+
+	return 0;
+}
+
+/* Callers may hand us anything, e.g. a FIT in memory-mapped SPI flash */
+static int aspeed_hace_hash_check(struct aspeed_hash_ctx *ctx,
+				  const void *buf, unsigned int size)
+{
+	int rc;
+
+	/* So that the end of a running update cannot clear the error */
+	rc = hash_wait(ctx);
+	if (rc)
+		return rc;
+
+	if (size && !((u32)buf & BIT(31))) {
+		debug("HACE src out of bounds: can only copy from SDRAM\n");
+		ctx->err = -EINVAL;
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int aspeed_hace_hash_update(struct udevice *dev, void *ctx,
+				   const void *buf, unsigned int size,
+				   int is_last)
+{
+	int rc;
+
+	rc = aspeed_hace_hash_check(ctx, buf, size);
+	if (rc)
+		return rc;
+
+	return aspeed_sha_update(ctx, buf, size, false);
+}
+
+static int aspeed_hace_hash_submit(struct udevice *dev, void *ctx,
+				   const void *buf, unsigned int size,
+				   int is_last)
+{
+	int rc;
+
+	rc = aspeed_hace_hash_check(ctx, buf, size);
+	if (rc)
+		return rc;
+
+	return aspeed_sha_update(ctx, buf, size, true);
+}
+
+static int aspeed_hace_hash_poll(struct udevice *dev, void *ctx)
+{
+	return hash_poll(ctx);
+}
+
+static int aspeed_hace_hash_finish(struct udevice *dev, void *ctx,
+				   void *dest_buf, int size)
+{
+	return aspeed_sha_finish(ctx, dest_buf, size);
+}
+
+static const struct hash_ops aspeed_hace_hash_ops = {
+	.supports	= aspeed_hace_hash_supports,
+	.init		= aspeed_hace_hash_init,
+	.update		= aspeed_hace_hash_update,
+	.submit		= aspeed_hace_hash_submit,
+	.poll		= aspeed_hace_hash_poll,
+	.finish		= aspeed_hace_hash_finish,
+};
+
+/* A child of the engine, so that probing it probes the engine first */
+U_BOOT_DRIVER(aspeed_hace_hash) = {
+	.name		= "aspeed_hace_hash",
+	.id		= UCLASS_HASH,
+	.ops		= &aspeed_hace_hash_ops,
+	.flags		= DM_FLAG_PRE_RELOC,
+};
+
+static int aspeed_hace_bind(struct udevice *dev)
+{
+	return device_bind_driver(dev, "aspeed_hace_hash", "hash", NULL);
+}
+#endif
+
 static int aspeed_hace_probe(struct udevice *dev)
 {
 	struct aspeed_hace *hace = dev_get_priv(dev);
@@ -427,6 +962,9 @@ U_BOOT_DRIVER(aspeed_hace) = {
 	.name		= "aspeed_hace",
 	.id		= UCLASS_MISC,
 	.of_match	= aspeed_hace_ids,
+#if CONFIG_IS_ENABLED(DM_HASH)
+	.bind		= aspeed_hace_bind,
+#endif
 	.probe		= aspeed_hace_probe,
 	.remove		= aspeed_hace_remove,
 	.priv_auto_alloc_size = sizeof(struct aspeed_hace),
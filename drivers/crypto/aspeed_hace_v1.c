@@ -9,12 +9,18 @@
 #include <clk.h>
 
 #include <log.h>
+#include <asm/cache.h>
 #include <asm/io.h>
 #include <malloc.h>
 #include <hash.h>
+#include <hw_sha.h>
+#include <image.h>
 
 #include <dm/device.h>
 #include <dm/fdtaddr.h>
+#include <dm/lists.h>
+#include <u-boot/hash.h>
+#include <u-boot/sha512.h>
 
 #include <linux/bitops.h>
 #include <linux/delay.h>
@@ -42,28 +48,63 @@
 #define  HACE_ALGO_SHA256		(BIT(4) | BIT(6))
 #define  HACE_ALGO_SHA512		(BIT(5) | BIT(6))
 #define  HACE_ALGO_SHA384		(BIT(5) | BIT(6) | BIT(10))
+#define  HASH_CMD_ACC_MODE		(0x2 << 7)
 #define  HACE_SG_EN			BIT(18)
 
 #define ASPEED_MAX_SG			32
 
+/*
+ * The AST2600 engine is used in scatter-gather mode: the segments are
+ * collected and hashed in one go, with the padding done by the engine.
+ * The AST2500 engine cannot walk a list, so it is used in accumulative
+ * mode instead: the engine keeps the digest state in the context between
+ * commands, the software buffers partial blocks and adds the padding.
+ */
+#define HACE_V1_ACC			BIT(0)
+
 struct aspeed_sg {
 	u32 len;
 	u32 addr;
 };
 
 struct aspeed_hash_ctx {
+	/* Accumulative mode: written by the engine, in cache lines of its own */
+	u8 digest[32] __aligned(ARCH_DMA_MINALIGN);
+	u8 buffer[128] __aligned(ARCH_DMA_MINALIGN);
 	u32 method;
 	u32 digest_size;
 	u32 len;
 	u32 count;
 	struct aspeed_sg list[ASPEED_MAX_SG]; /* Must be 8 byte aligned */
+	/* Accumulative mode */
+	u32 block_size;
+	u64 digcnt;
+	u32 bufcnt;
+	/* An asynchronous update left the engine running on the context */
+	bool pending;
+	u32 pending_len;
+	ulong pending_start;
+	/* Set once an update failed, returned by every later call */
+	int err;
 };
 
 struct aspeed_hace {
 	struct clk clk;
 };
 
+static const u32 sha1_iv[8] = {
+	0x01234567UL, 0x89abcdefUL, 0xfedcba98UL, 0x76543210UL,
+	0xf0e1d2c3UL, 0, 0, 0
+};
+
+static const u32 sha256_iv[8] = {
+	0x67e6096aUL, 0x85ae67bbUL, 0x72f36e3cUL, 0x3af54fa5UL,
+	0x7f520e51UL, 0x8c68059bUL, 0xabd9831fUL, 0x19cde05bUL
+};
+
 static phys_addr_t base;
+static bool hace_acc;
+static struct clk *hace_clk;
 
 static int aspeed_hace_wait_completion(u32 reg, u32 flag, int timeout_us)
 {
@@ -72,6 +113,21 @@ static int aspeed_hace_wait_completion(u32 reg, u32 flag, int timeout_us)
 	return readl_poll_timeout(reg, val, (val & flag) == flag, timeout_us);
 }
 
+static void aspeed_hace_reset(void)
+{
+	debug("\nHACE error 0x%08x, resetting\n", readl(base + 0x1c));
+
+	/* Enabling the YCLK gate of the AST2500 pulses the engine reset */
+	if (hace_acc) {
+		clk_enable(hace_clk);
+		return;
+	}
+
+	writel(0x10, 0x1e6e2040);
+	mdelay(5);
+	writel(0x10, 0x1e6e2044);
+}
+
 static int digest_object(const void *src, unsigned int length, void *digest,
 		  u32 method)
 {
@@ -103,23 +159,281 @@ static int digest_object(const void *src, unsigned int length, void *digest,
 	aspeed_hace_wait_completion(base + ASPEED_HACE_STS, HACE_HASH_ISR,
 				    1000 + (length >> 3));
 
-	if (readl(base + ASPEED_HACE_STS)) {
-		debug("\nHACE error 0x%08x, resetting\n", readl(base + 0x1c));
+	if (readl(base + ASPEED_HACE_STS))
+		aspeed_hace_reset();
 
-		writel(0x10, 0x1e6e2040);
-		mdelay(5);
-		writel(0x10, 0x1e6e2044);
+	return 0;
+}
+
+/*
+ * Accumulative mode
+ *
+ * The engine accesses the DRAM behind the D-cache: what it reads is
+ * flushed before it starts and what it writes is invalidated once it is
+ * done. These are no-ops while the D-cache is off.
+ */
+static void hace_flush(const void *buf, size_t len)
+{
+	flush_dcache_range(rounddown((ulong)buf, ARCH_DMA_MINALIGN),
+			   roundup((ulong)buf + len, ARCH_DMA_MINALIGN));
+}
+
+static void hace_inval(const void *buf, size_t len)
+{
+	invalidate_dcache_range(rounddown((ulong)buf, ARCH_DMA_MINALIGN),
+				roundup((ulong)buf + len, ARCH_DMA_MINALIGN));
+}
+
+static int acc_setup(struct aspeed_hash_ctx *ctx, const char *name)
+{
+	ctx->method = HASH_CMD_ACC_MODE | HACE_SHA_BE_EN;
+	ctx->block_size = 64;
+
+	if (!strcmp(name, "sha1")) {
+		ctx->method |= HACE_ALGO_SHA1;
+		ctx->digest_size = 20;
+		memcpy(ctx->digest, sha1_iv, 32);
+	} else if (!strcmp(name, "sha256")) {
+		ctx->method |= HACE_ALGO_SHA256;
+		ctx->digest_size = 32;
+		memcpy(ctx->digest, sha256_iv, 32);
+	} else {
+		/* Nor SHA-384 and SHA-512 on the AST2500 */
+		return -ENOTSUPP;
 	}
 
 	return 0;
 }
 
+static int acc_start(struct aspeed_hash_ctx *ctx, const void *src,
+		     unsigned int len)
+{
+	if (readl(base + ASPEED_HACE_STS) & HACE_HASH_BUSY) {
+		debug("HACE error: engine busy\n");
+		return -EBUSY;
+	}
+	/* Clear pending completion status */
+	writel(HACE_HASH_ISR, base + ASPEED_HACE_STS);
+
+	hace_flush(src, len);
+	hace_flush(ctx->digest, sizeof(ctx->digest));
+	writel((u32)src, base + ASPEED_HACE_HASH_SRC);
+	writel((u32)ctx->digest, base + ASPEED_HACE_HASH_DIGEST_BUFF);
+	writel((u32)ctx->digest, base + ASPEED_HACE_HASH_KEY_BUFF);
+	writel(len, base + ASPEED_HACE_HASH_DATA_LEN);
+	writel(ctx->method, base + ASPEED_HACE_HASH_CMD);
+
+	return 0;
+}
+
+static int acc_end(struct aspeed_hash_ctx *ctx, int rc)
+{
+	hace_inval(ctx->digest, sizeof(ctx->digest));
+	if (rc)
+		aspeed_hace_reset();
+
+	return rc;
+}
+
+static int acc_trigger(struct aspeed_hash_ctx *ctx, const void *src,
+		       unsigned int len)
+{
+	int rc;
+
+	rc = acc_start(ctx, src, len);
+	if (rc)
+		return rc;
+
+	rc = aspeed_hace_wait_completion(base + ASPEED_HACE_STS,
+					 HACE_HASH_ISR, 1000 + (len >> 3));
+
+	return acc_end(ctx, rc);
+}
+
+/*
+ * The context whose asynchronous update is running on the engine, if any.
+ * The digest state lives in each context, so contexts may take turns on
+ * the engine as long as one update is finished before the next starts.
+ */
+static struct aspeed_hash_ctx *active;
+
+static void acc_complete(struct aspeed_hash_ctx *ctx, int rc)
+{
+	ctx->pending = false;
+	ctx->err = acc_end(ctx, rc);
+	active = NULL;
+}
+
+/* Wait for an asynchronous update to complete */
+static int acc_wait(struct aspeed_hash_ctx *ctx)
+{
+	int rc;
+
+	if (!ctx->pending)
+		return ctx->err;
+
+	rc = aspeed_hace_wait_completion(base + ASPEED_HACE_STS,
+					 HACE_HASH_ISR,
+					 1000 + (ctx->pending_len >> 3));
+	acc_complete(ctx, rc);
+
+	return ctx->err;
+}
+
+/* Let the update of another context finish before using the engine */
+static void acc_idle(void)
+{
+	/* An error stays with the context it belongs to */
+	if (active)
+		acc_wait(active);
+}
+
+/*
+ * The engine reads one contiguous source per command: a block started by
+ * an earlier update is completed from @buf and hashed on its own, then
+ * the whole blocks are hashed in place and the rest is kept for later.
+ * Only the last command may be left running if @async is set.
+ */
+static int acc_update(struct aspeed_hash_ctx *ctx, const void *buf,
+		      unsigned int size, bool async)
+{
+	unsigned int fill, len;
+	int rc;
+
+	rc = acc_wait(ctx);
+	if (rc)
+		return rc;
+	acc_idle();
+
+	if (size && !((u32)buf & BIT(31))) {
+		debug("HACE src out of bounds: can only copy from SDRAM\n");
+		ctx->err = -EINVAL;
+		return -EINVAL;
+	}
+	ctx->digcnt += size;
+
+	if (ctx->bufcnt) {
+		fill = min(size, ctx->block_size - ctx->bufcnt);
+		memcpy(ctx->buffer + ctx->bufcnt, buf, fill);
+		ctx->bufcnt += fill;
+		buf += fill;
+		size -= fill;
+		if (ctx->bufcnt < ctx->block_size)
+			return 0;
+
+		ctx->bufcnt = 0;
+		rc = acc_trigger(ctx, ctx->buffer, ctx->block_size);
+		if (rc)
+			goto err;
+	}
+
+	len = rounddown(size, ctx->block_size);
+	ctx->bufcnt = size - len;
+	memcpy(ctx->buffer, buf + len, ctx->bufcnt);
+	if (!len)
+		return 0;
+
+	if (async) {
+		rc = acc_start(ctx, buf, len);
+		if (rc)
+			goto err;
+		active = ctx;
+		ctx->pending = true;
+		ctx->pending_len = len;
+		ctx->pending_start = timer_get_us();
+
+		return 0;
+	}
+
+	rc = acc_trigger(ctx, buf, len);
+err:
+	ctx->err = rc;
+
+	return rc;
+}
+
+/* Pad the buffered bytes and hash them, which frees @ctx */
+static int acc_finish(struct aspeed_hash_ctx *ctx, void *dest_buf, int size)
+{
+	unsigned int padlen;
+	u64 bits;
+	int rc;
+
+	rc = acc_wait(ctx);
+	if (rc)
+		goto out;
+	acc_idle();
+
+	if (size < ctx->digest_size) {
+		debug("HACE error: insufficient size on destination buffer\n");
+		rc = -EINVAL;
+		goto out;
+	}
+
+	/* 0x80, zeroes up to 8 bytes before the end of a block, the bit count */
+	bits = cpu_to_be64(ctx->digcnt << 3);
+	padlen = ctx->bufcnt < 56 ? 56 - ctx->bufcnt : 120 - ctx->bufcnt;
+	ctx->buffer[ctx->bufcnt] = 0x80;
+	memset(ctx->buffer + ctx->bufcnt + 1, 0, padlen - 1);
+	memcpy(ctx->buffer + ctx->bufcnt + padlen, &bits, 8);
+	ctx->bufcnt += padlen + 8;
+
+	rc = acc_trigger(ctx, ctx->buffer, ctx->bufcnt);
+	if (!rc)
+		memcpy(dest_buf, ctx->digest, ctx->digest_size);
+out:
+	free(ctx);
+
+	return rc;
+}
+
+static struct aspeed_hash_ctx *acc_new(const char *name)
+{
+	struct aspeed_hash_ctx *ctx;
+
+	ctx = memalign(ARCH_DMA_MINALIGN, sizeof(*ctx));
+	if (!ctx) {
+		debug("HACE error: Cannot allocate memory for context\n");
+		return NULL;
+	}
+	memset(ctx, '\0', sizeof(*ctx));
+
+	if (acc_setup(ctx, name)) {
+		free(ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+static int acc_digest(const void *src, unsigned int length, void *digest,
+		      const char *name)
+{
+	struct aspeed_hash_ctx *ctx;
+	int rc;
+
+	ctx = acc_new(name);
+	if (!ctx)
+		return -ENOTSUPP;
+
+	rc = acc_update(ctx, src, length, false);
+	if (rc) {
+		free(ctx);
+		return rc;
+	}
+
+	return acc_finish(ctx, digest, 32);
+}
+
 void hw_sha1(const unsigned char *pbuf, unsigned int buf_len,
 	       unsigned char *pout, unsigned int chunk_size)
 {
 	int rc;
 
-	rc = digest_object(pbuf, buf_len, pout, HACE_ALGO_SHA1);
+	if (hace_acc)
+		rc = acc_digest(pbuf, buf_len, pout, "sha1");
+	else
+		rc = digest_object(pbuf, buf_len, pout, HACE_ALGO_SHA1);
 	if (rc)
 		debug("HACE failure: %d\n", rc);
 }
@@ -129,7 +443,10 @@ void hw_sha256(const unsigned char *pbuf, unsigned int buf_len,
 {
 	int rc;
 
-	rc = digest_object(pbuf, buf_len, pout, HACE_ALGO_SHA256);
+	if (hace_acc)
+		rc = acc_digest(pbuf, buf_len, pout, "sha256");
+	else
+		rc = digest_object(pbuf, buf_len, pout, HACE_ALGO_SHA256);
 	if (rc)
 		debug("HACE failure: %d\n", rc);
 }
@@ -139,6 +456,14 @@ void hw_sha512(const unsigned char *pbuf, unsigned int buf_len,
 {
 	int rc;
 
+#if IS_ENABLED(CONFIG_SHA512_ALGO)
+	/* The AST2500 engine has no SHA-512 */
+	if (hace_acc) {
+		sha512_csum_wd(pbuf, buf_len, pout, chunk_size);
+		return;
+	}
+#endif
+
 	rc = digest_object(pbuf, buf_len, pout, HACE_ALGO_SHA512);
 	if (rc)
 		debug("HACE failure: %d\n", rc);
@@ -150,6 +475,15 @@ int hw_sha_init(struct hash_algo *algo, void **ctxp)
 	struct aspeed_hash_ctx *ctx;
 	u32 method;
 
+	if (hace_acc) {
+		ctx = acc_new(algo->name);
+		if (!ctx)
+			return -ENOTSUPP;
+		*ctxp = ctx;
+
+		return 0;
+	}
+
 	if (!strcmp(algo->name, "sha1")) {
 		method = HACE_ALGO_SHA1;
 	}
@@ -163,7 +497,7 @@ int hw_sha_init(struct hash_algo *algo, void **ctxp)
 		return -ENOTSUPP;
 	}
 
-	ctx = memalign(8, sizeof(*ctx));
+	ctx = memalign(ARCH_DMA_MINALIGN, sizeof(*ctx));
 	memset(ctx, '\0', sizeof(*ctx));
 
 	if (ctx == NULL) {
@@ -189,6 +523,9 @@ int hw_sha_update(struct hash_algo *algo, void *hash_ctx, const void *buf,
 	struct aspeed_hash_ctx *ctx = hash_ctx;
 	struct aspeed_sg *sg = &ctx->list[ctx->count];
 
+	if (hace_acc)
+		return acc_update(ctx, buf, size, false);
+
 	if (ctx->count >= ARRAY_SIZE(ctx->list)) {
 		debug("HACE error: Reached maximum number of hash segments\n");
 		free(ctx);
@@ -211,6 +548,9 @@ int hw_sha_finish(struct hash_algo *algo, void *hash_ctx, void *dest_buf, int si
 	struct aspeed_hash_ctx *ctx = hash_ctx;
 	int rc;
 
+	if (hace_acc)
+		return acc_finish(ctx, dest_buf, size);
+
 	if (size < ctx->digest_size) {
 		debug("HACE error: insufficient size on destination buffer\n");
 		free(ctx);
@@ -227,6 +567,182 @@ int hw_sha_finish(struct hash_algo *algo, void *hash_ctx, void *dest_buf, int si
 }
 #endif
 
+#if IS_ENABLED(CONFIG_SHA_HW_SG)
+/*
+ * The AST2600 engine walks the regions itself. The AST2500 one is given
+ * them one after the other in accumulative mode, which still hashes them
+ * in place: only the blocks that straddle two regions are copied.
+ */
+int hw_sha_digest_sg(struct hash_algo *algo,
+		     const struct image_region region[], int region_count,
+		     void *dest_buf, int size)
+{
+	struct aspeed_hash_ctx *ctx;
+	struct aspeed_sg *sg;
+	u32 method;
+	u32 length = 0;
+	int i, n;
+	int ret;
+
+	if (size < algo->digest_size) {
+		debug("HACE error: insufficient size on destination buffer\n");
+		return -ENOSPC;
+	}
+
+	/* Let the caller fall back for regions outside of SDRAM */
+	for (i = 0; i < region_count; i++) {
+		if (region[i].size && !((u32)region[i].data & BIT(31))) {
+			debug("HACE SG region %d out of bounds: %p\n", i,
+			      region[i].data);
+			return -EINVAL;
+		}
+		length += region[i].size;
+	}
+
+	if (hace_acc) {
+		ctx = acc_new(algo->name);
+		if (!ctx)
+			return -EINVAL;
+		for (i = 0; i < region_count; i++) {
+			ret = acc_update(ctx, region[i].data, region[i].size,
+					 false);
+			if (ret) {
+				free(ctx);
+				return ret;
+			}
+		}
+
+		return acc_finish(ctx, dest_buf, size);
+	}
+
+	if (!strcmp(algo->name, "sha1"))
+		method = HACE_ALGO_SHA1;
+	else if (!strcmp(algo->name, "sha256"))
+		method = HACE_ALGO_SHA256;
+	else if (!strcmp(algo->name, "sha512"))
+		method = HACE_ALGO_SHA512;
+	else
+		return -EINVAL;
+
+	sg = memalign(8, region_count * sizeof(*sg));
+	if (!sg) {
+		debug("HACE error: Cannot allocate memory for SG list\n");
+		return -ENOMEM;
+	}
+
+	n = 0;
+	for (i = 0; i < region_count; i++) {
+		if (!region[i].size)
+			continue;
+		sg[n].addr = (u32)region[i].data;
+		sg[n].len = region[i].size;
+		n++;
+	}
+	if (!n) {
+		free(sg);
+		return -EINVAL;
+	}
+	sg[n - 1].len |= HACE_SG_LAST;
+
+	ret = digest_object(sg, length, dest_buf, method | HACE_SG_EN);
+	free(sg);
+
+	return ret;
+}
+#endif
+
+#if CONFIG_IS_ENABLED(DM_HASH)
+/* Like acc_wait(), but do not block: -EBUSY while the engine runs */
+static int acc_poll(struct aspeed_hash_ctx *ctx)
+{
+	if (!ctx->pending)
+		return ctx->err;
+
+	if (readl(base + ASPEED_HACE_STS) & HACE_HASH_ISR)
+		acc_complete(ctx, 0);
+	else if (timer_get_us() - ctx->pending_start >
+		 1000 + (ctx->pending_len >> 3))
+		acc_complete(ctx, -ETIMEDOUT);
+	else
+		return -EBUSY;
+
+	return ctx->err;
+}
+
+static bool aspeed_hace_hash_supports(struct udevice *dev,
+				      const char *algo_name)
+{
+	return !strcmp(algo_name, "sha1") || !strcmp(algo_name, "sha256");
+}
+
+static int aspeed_hace_hash_init(struct udevice *dev, const char *algo_name,
+				 void **ctxp)
+{
+	struct aspeed_hash_ctx *ctx;
+
+	ctx = acc_new(algo_name);
+	if (!ctx)
+		return -EPROTONOSUPPORT;
+	*ctxp = ctx;
+
+	return 0;
+}
+
+static int aspeed_hace_hash_update(struct udevice *dev, void *ctx,
+				   const void *buf, unsigned int size,
+				   int is_last)
+{
+	return acc_update(ctx, buf, size, false);
+}
+
+static int aspeed_hace_hash_submit(struct udevice *dev, void *ctx,
+				   const void *buf, unsigned int size,
+				   int is_last)
+{
+	return acc_update(ctx, buf, size, true);
+}
+
+static int aspeed_hace_hash_poll(struct udevice *dev, void *ctx)
+{
+	return acc_poll(ctx);
+}
+
+static int aspeed_hace_hash_finish(struct udevice *dev, void *ctx,
+				   void *dest_buf, int size)
+{
+	return acc_finish(ctx, dest_buf, size);
+}
+
+static const struct hash_ops aspeed_hace_hash_ops = {
+	.supports	= aspeed_hace_hash_supports,
+	.init		= aspeed_hace_hash_init,
+	.update		= aspeed_hace_hash_update,
+	.submit		= aspeed_hace_hash_submit,
+	.poll		= aspeed_hace_hash_poll,
+	.finish		= aspeed_hace_hash_finish,
+};
+
+/* A child of the engine, so that probing it probes the engine first */
+U_BOOT_DRIVER(aspeed_hace_v1_hash) = {
+	.name		= "aspeed_hace_v1_hash",
+	.id		= UCLASS_HASH,
+	.ops		= &aspeed_hace_hash_ops,
+	.flags		= DM_FLAG_PRE_RELOC,
+};
+
+/*
+ * Only accumulative mode can hash a stream whose buffers are reused
+ * between updates, so the AST2600 engine is not offered as a hash device
+ */
+static int aspeed_hace_bind(struct udevice *dev)
+{
+	if (!(dev_get_driver_data(dev) & HACE_V1_ACC))
+		return 0;
+
+	return device_bind_driver(dev, "aspeed_hace_v1_hash", "hash", NULL);
+}
+#endif
+
 static int aspeed_hace_probe(struct udevice *dev)
 {
 	struct aspeed_hace *hace = dev_get_priv(dev);
@@ -246,6 +762,8 @@ static int aspeed_hace_probe(struct udevice *dev)
 
 	/* As the crypto code does not pass us any driver state */
 	base = devfdt_get_addr(dev);
+	hace_acc = dev_get_driver_data(dev) & HACE_V1_ACC;
+	hace_clk = &hace->clk;
 
 	return ret;
 }
@@ -261,6 +779,7 @@ static int aspeed_hace_remove(struct udevice *dev)
 
 static const struct udevice_id aspeed_hace_ids[] = {
 	{ .compatible = "aspeed,ast2600-hace" },
+	{ .compatible = "aspeed,ast2500-hace", .data = HACE_V1_ACC },
 	{ }
 };
 
@@ -268,6 +787,9 @@ U_BOOT_DRIVER(aspeed_hace) = {
 	.name		= "aspeed_hace",
 	.id		= UCLASS_MISC,
 	.of_match	= aspeed_hace_ids,
+#if CONFIG_IS_ENABLED(DM_HASH)
+	.bind		= aspeed_hace_bind,
+#endif
 	.probe		= aspeed_hace_probe,
 	.remove 	= aspeed_hace_remove,
 	.priv_auto_alloc_size = sizeof(struct aspeed_hace),
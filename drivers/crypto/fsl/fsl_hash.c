@@ -13,14 +13,19 @@
 #include "fsl_hash.h"
 #include <hw_sha.h>
 #include <linux/errno.h>
+#include <watchdog.h>
 
 #define CRYPTO_MAX_ALG_NAME	80
 #define SHA1_DIGEST_SIZE        20
 #define SHA256_DIGEST_SIZE      32
+#define SHA1_BLOCK_SIZE		64
+#define SHA256_BLOCK_SIZE	64
 
 struct caam_hash_template {
 	char name[CRYPTO_MAX_ALG_NAME];
 	unsigned int digestsize;
+	unsigned int blocksize;
+	unsigned int ctxsize;
 	u32 alg_type;
 };
 
@@ -33,11 +38,15 @@ static struct caam_hash_template driver_hash[] = {
 	{
 		.name = "sha1",
 		.digestsize = SHA1_DIGEST_SIZE,
+		.blocksize = SHA1_BLOCK_SIZE,
+		.ctxsize = SHA1_DIGEST_SIZE + 8,
 		.alg_type = OP_ALG_ALGSEL_SHA1,
 	},
 	{
 		.name = "sha256",
 		.digestsize = SHA256_DIGEST_SIZE,
+		.blocksize = SHA256_BLOCK_SIZE,
+		.ctxsize = SHA256_DIGEST_SIZE + 8,
 		.alg_type = OP_ALG_ALGSEL_SHA256,
 	},
 };
@@ -50,6 +59,15 @@ static enum caam_hash_algos get_hash_type(struct hash_algo *algo)
 		return SHA256;
 }
 
+static void caam_flush(const void *buf, unsigned int size)
+{
+	unsigned long start = rounddown((unsigned long)buf, ARCH_DMA_MINALIGN);
+	unsigned long end = roundup((unsigned long)buf + size,
+				    ARCH_DMA_MINALIGN);
+
+	flush_dcache_range(start, end);
+}
+
 /* Create the context for progressive hashing using h/w acceleration.
  *
  * @ctxp: Pointer to the pointer of the context for hashing
@@ -58,59 +76,142 @@ static enum caam_hash_algos get_hash_type(struct hash_algo *algo)
  */
 static int caam_hash_init(void **ctxp, enum caam_hash_algos caam_algo)
 {
-	*ctxp = calloc(1, sizeof(struct sha_ctx));
-	if (*ctxp == NULL) {
+	struct sha_ctx *ctx;
+
+	ctx = malloc_cache_aligned(sizeof(struct sha_ctx));
+	if (!ctx) {
 		debug("Cannot allocate memory for context\n");
 		return -ENOMEM;
 	}
+	memset(ctx, 0, sizeof(struct sha_ctx));
+	ctx->algo = caam_algo;
+	*ctxp = ctx;
+
+	return 0;
+}
+
+/* Wait for the job in flight on @ctx, if any */
+static int caam_hash_wait(struct sha_ctx *ctx)
+{
+	int ret;
+
+	if (!ctx->pending)
+		return 0;
+
+	ctx->pending = false;
+	ret = wait_descriptor_jr(&ctx->op);
+	if (ret)
+		debug("Error %x\n", ret);
+
+	return ret;
+}
+
+/*
+ * Start a job hashing the buffered partial block then @size bytes at @msg,
+ * without waiting for it
+ *
+ * @ctx: Pointer to the context for hashing, with no job in flight
+ * @state: OP_ALG_AS_* step of the hash
+ * @msg: Pointer to the data following the partial block
+ * @size: Size of the data following the partial block
+ * @return 0 if ok, -ve on error
+ */
+static int caam_hash_start(struct sha_ctx *ctx, u32 state, const void *msg,
+			   unsigned int size)
+{
+	struct caam_hash_template *alg = &driver_hash[ctx->algo];
+	const u8 *pre = ctx->buf[ctx->cur];
+	int ret;
+
+	inline_cnstr_jobdesc_hash_step(ctx->sha_desc, alg->alg_type, state,
+				       ctx->mdha_ctx, alg->ctxsize,
+				       pre, ctx->buflen, msg, size,
+				       ctx->hash, alg->digestsize);
+
+	caam_flush(ctx->sha_desc, sizeof(ctx->sha_desc));
+	caam_flush(ctx->mdha_ctx, sizeof(ctx->mdha_ctx));
+	caam_flush(ctx->hash, sizeof(ctx->hash));
+	caam_flush(pre, ctx->buflen);
+	caam_flush(msg, size);
+
+	ret = run_descriptor_jr_async(ctx->sha_desc, &ctx->op);
+	if (ret) {
+		debug("Error %x\n", ret);
+		return ret;
+	}
+	ctx->pending = true;
+	ctx->started = true;
+
 	return 0;
 }
 
 /*
- * Update sg table for progressive hashing using h/w acceleration
+ * Hash a buffer for progressive hashing using h/w acceleration
  *
- * The context is freed by this function if an error occurs.
- * We support at most 32 Scatter/Gather Entries.
+ * Whole blocks are hashed by a job which saves the MDHA context, to be
+ * loaded back by the next one. What is left of the buffer is kept until
+ * the next call. The context is freed by this function if an error occurs.
  *
  * @hash_ctx: Pointer to the context for hashing
  * @buf: Pointer to the buffer being hashed
  * @size: Size of the buffer being hashed
  * @is_last: 1 if this is the last update; 0 otherwise
- * @caam_algo: Enum for SHA1 or SHA256
- * @return 0 if ok, -EINVAL on error
+ * @async: return while the job is still running; @buf must then be left
+ *	   untouched until the next call on @hash_ctx
+ * @return 0 if ok, -ve on error
  */
 static int caam_hash_update(void *hash_ctx, const void *buf,
-			    unsigned int size, int is_last,
-			    enum caam_hash_algos caam_algo)
+			    unsigned int size, int is_last, bool async)
 {
-	uint32_t final = 0;
-	phys_addr_t addr = virt_to_phys((void *)buf);
 	struct sha_ctx *ctx = hash_ctx;
+	unsigned int bs = driver_hash[ctx->algo].blocksize;
+	unsigned int tail;
+	int ret;
 
-	if (ctx->sg_num >= MAX_SG_32) {
-		free(ctx);
-		return -EINVAL;
-	}
-
-#ifdef CONFIG_PHYS_64BIT
-	sec_out32(&ctx->sg_tbl[ctx->sg_num].addr_hi, (uint32_t)(addr >> 32));
-#else
-	sec_out32(&ctx->sg_tbl[ctx->sg_num].addr_hi, 0x0);
-#endif
-	sec_out32(&ctx->sg_tbl[ctx->sg_num].addr_lo, (uint32_t)addr);
-
-	sec_out32(&ctx->sg_tbl[ctx->sg_num].len_flag,
-		  (size & SG_ENTRY_LENGTH_MASK));
+	/* The job in flight reads the partial block and the context */
+	ret = caam_hash_wait(ctx);
+	if (ret)
+		goto err;
 
-	ctx->sg_num++;
+	if (ctx->finished) {
+		ret = -EINVAL;
+		goto err;
+	}
 
 	if (is_last) {
-		final = sec_in32(&ctx->sg_tbl[ctx->sg_num - 1].len_flag) |
-			SG_ENTRY_FINAL_BIT;
-		sec_out32(&ctx->sg_tbl[ctx->sg_num - 1].len_flag, final);
+		ret = caam_hash_start(ctx, ctx->started ? OP_ALG_AS_FINALIZE :
+				      OP_ALG_AS_INITFINAL, buf, size);
+		if (ret)
+			goto err;
+		ctx->finished = true;
+	} else if (ctx->buflen + size < bs) {
+		memcpy(ctx->buf[ctx->cur] + ctx->buflen, buf, size);
+		ctx->buflen += size;
+		return 0;
+	} else {
+		tail = (ctx->buflen + size) % bs;
+		ret = caam_hash_start(ctx, ctx->started ? OP_ALG_AS_UPDATE :
+				      OP_ALG_AS_INIT, buf, size - tail);
+		if (ret)
+			goto err;
+		/* The job reads the other buffer */
+		ctx->cur ^= 1;
+		memcpy(ctx->buf[ctx->cur], buf + size - tail, tail);
+		ctx->buflen = tail;
+	}
+
+	if (!async) {
+		ret = caam_hash_wait(ctx);
+		if (ret)
+			goto err;
 	}
 
 	return 0;
+
+err:
+	caam_hash_wait(ctx);
+	free(ctx);
+	return ret;
 }
 
 /*
@@ -122,93 +223,80 @@ static int caam_hash_update(void *hash_ctx, const void *buf,
  * @hash_ctx: Pointer to the context for hashing
  * @dest_buf: Pointer to the destination buffer where hash is to be copied
  * @size: Size of the buffer being hashed
- * @caam_algo: Enum for SHA1 or SHA256
  * @return 0 if ok, -EINVAL on error
  */
-static int caam_hash_finish(void *hash_ctx, void *dest_buf,
-			    int size, enum caam_hash_algos caam_algo)
+static int caam_hash_finish(void *hash_ctx, void *dest_buf, int size)
 {
-	uint32_t len = 0;
 	struct sha_ctx *ctx = hash_ctx;
-	int i = 0, ret = 0;
-
-	if (size < driver_hash[caam_algo].digestsize) {
-		free(ctx);
-		return -EINVAL;
+	unsigned int digestsize = driver_hash[ctx->algo].digestsize;
+	int ret;
+
+	ret = caam_hash_wait(ctx);
+	if (!ret && size < digestsize)
+		ret = -EINVAL;
+
+	if (!ret && !ctx->finished) {
+		ret = caam_hash_start(ctx, ctx->started ? OP_ALG_AS_FINALIZE :
+				      OP_ALG_AS_INITFINAL, NULL, 0);
+		if (!ret)
+			ret = caam_hash_wait(ctx);
 	}
 
-	for (i = 0; i < ctx->sg_num; i++)
-		len += (sec_in32(&ctx->sg_tbl[i].len_flag) &
-			SG_ENTRY_LENGTH_MASK);
-
-	inline_cnstr_jobdesc_hash(ctx->sha_desc, (uint8_t *)ctx->sg_tbl, len,
-				  ctx->hash,
-				  driver_hash[caam_algo].alg_type,
-				  driver_hash[caam_algo].digestsize,
-				  1);
-
-	ret = run_descriptor_jr(ctx->sha_desc);
-
-	if (ret)
-		debug("Error %x\n", ret);
-	else
-		memcpy(dest_buf, ctx->hash, sizeof(ctx->hash));
+	if (!ret) {
+		invalidate_dcache_range((unsigned long)ctx->hash,
+					(unsigned long)ctx->hash +
+					sizeof(ctx->hash));
+		memcpy(dest_buf, ctx->hash, digestsize);
+	}
 
 	free(ctx);
 	return ret;
 }
 
-int caam_hash(const unsigned char *pbuf, unsigned int buf_len,
-	      unsigned char *pout, enum caam_hash_algos algo)
+/*
+ * Hash a buffer in pieces of @chunk_size, so that the watchdog is kept
+ * alive on long inputs. The buffer needs no alignment.
+ */
+static int caam_hash(const unsigned char *pbuf, unsigned int buf_len,
+		     unsigned char *pout, enum caam_hash_algos algo,
+		     unsigned int chunk_size)
 {
-	int ret = 0;
-	uint32_t *desc;
-	unsigned int size;
+	unsigned int off = 0;
+	unsigned int len;
+	void *ctx;
+	int ret;
 
-	desc = malloc_cache_aligned(sizeof(int) * MAX_CAAM_DESCSIZE);
-	if (!desc) {
-		debug("Not enough memory for descriptor allocation\n");
-		return -ENOMEM;
-	}
-
-	if (!IS_ALIGNED((uintptr_t)pbuf, ARCH_DMA_MINALIGN) ||
-	    !IS_ALIGNED((uintptr_t)pout, ARCH_DMA_MINALIGN)) {
-		puts("Error: Address arguments are not aligned\n");
-		return -EINVAL;
-	}
-
-	size = ALIGN(buf_len, ARCH_DMA_MINALIGN);
-	flush_dcache_range((unsigned long)pbuf, (unsigned long)pbuf + size);
-
-	inline_cnstr_jobdesc_hash(desc, pbuf, buf_len, pout,
-				  driver_hash[algo].alg_type,
-				  driver_hash[algo].digestsize,
-				  0);
-
-	size = ALIGN(sizeof(int) * MAX_CAAM_DESCSIZE, ARCH_DMA_MINALIGN);
-	flush_dcache_range((unsigned long)desc, (unsigned long)desc + size);
-
-	ret = run_descriptor_jr(desc);
-
-	size = ALIGN(driver_hash[algo].digestsize, ARCH_DMA_MINALIGN);
-	invalidate_dcache_range((unsigned long)pout,
-				(unsigned long)pout + size);
-
-	free(desc);
-	return ret;
+	ret = caam_hash_init(&ctx, algo);
+	if (ret)
+		return ret;
+
+	if (!chunk_size)
+		chunk_size = buf_len;
+
+	do {
+		len = min(buf_len - off, chunk_size);
+		ret = caam_hash_update(ctx, pbuf + off, len,
+				       off + len == buf_len, true);
+		if (ret)
+			return ret;
+		off += len;
+		WATCHDOG_RESET();
+	} while (off < buf_len);
+
+	return caam_hash_finish(ctx, pout, driver_hash[algo].digestsize);
 }
 
 void hw_sha256(const unsigned char *pbuf, unsigned int buf_len,
 			unsigned char *pout, unsigned int chunk_size)
 {
-	if (caam_hash(pbuf, buf_len, pout, SHA256))
+	if (caam_hash(pbuf, buf_len, pout, SHA256, chunk_size))
 		printf("CAAM was not setup properly or it is faulty\n");
 }
 
 void hw_sha1(const unsigned char *pbuf, unsigned int buf_len,
 			unsigned char *pout, unsigned int chunk_size)
 {
-	if (caam_hash(pbuf, buf_len, pout, SHA1))
+	if (caam_hash(pbuf, buf_len, pout, SHA1, chunk_size))
 		printf("CAAM was not setup properly or it is faulty\n");
 }
 
@@ -220,11 +308,17 @@ int hw_sha_init(struct hash_algo *algo, void **ctxp)
 int hw_sha_update(struct hash_algo *algo, void *ctx, const void *buf,
 			    unsigned int size, int is_last)
 {
-	return caam_hash_update(ctx, buf, size, is_last, get_hash_type(algo));
+	return caam_hash_update(ctx, buf, size, is_last, false);
+}
+
+int hw_sha_update_async(struct hash_algo *algo, void *ctx, const void *buf,
+			unsigned int size, int is_last)
+{
+	return caam_hash_update(ctx, buf, size, is_last, true);
 }
 
 int hw_sha_finish(struct hash_algo *algo, void *ctx, void *dest_buf,
 		     int size)
 {
-	return caam_hash_finish(ctx, dest_buf, size, get_hash_type(algo));
+	return caam_hash_finish(ctx, dest_buf, size);
 }
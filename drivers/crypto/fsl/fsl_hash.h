@@ -11,23 +11,36 @@
 #include <hash.h>
 #include "jr.h"
 
-/* We support at most 32 Scatter/Gather Entries.*/
-#define MAX_SG_32	32
+/* Largest SHA block and MDHA running context (digest + message length) */
+#define SHA_MAX_BLOCK_SIZE	64
+#define MDHA_MAX_CTX_SIZE	(32 + 8)
 
 /*
  * Hash context contains the following fields
  * @sha_desc: Sha Descriptor
- * @sg_num: number of entries in sg table
- * @len: total length of buffer
- * @sg_tbl: sg entry table
+ * @mdha_ctx: running MDHA context, saved between two jobs
+ * @buf: partial blocks, one of which may be read by a job in flight
  * @hash: index to the hash calculated
+ * @algo: index in driver_hash[]
+ * @cur: buffer holding the current partial block
+ * @buflen: number of bytes in @buf[@cur]
+ * @started: the first job has been run
+ * @finished: the last job has been run
+ * @pending: a job is in flight, completing into @op
+ * @op: result of the job in flight
  */
 struct sha_ctx {
-	uint32_t sha_desc[64];
-	uint32_t sg_num;
-	uint32_t len;
-	struct sg_entry sg_tbl[MAX_SG_32];
-	u8 hash[HASH_MAX_DIGEST_SIZE];
+	uint32_t sha_desc[64] __aligned(ARCH_DMA_MINALIGN);
+	u8 mdha_ctx[MDHA_MAX_CTX_SIZE] __aligned(ARCH_DMA_MINALIGN);
+	u8 buf[2][SHA_MAX_BLOCK_SIZE] __aligned(ARCH_DMA_MINALIGN);
+	u8 hash[HASH_MAX_DIGEST_SIZE] __aligned(ARCH_DMA_MINALIGN);
+	int algo;
+	int cur;
+	uint32_t buflen;
+	bool started;
+	bool finished;
+	bool pending;
+	struct result op;
 };
 
 #endif
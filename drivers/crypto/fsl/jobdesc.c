@@ -172,37 +172,53 @@ int inline_cnstr_jobdesc_blob_dek(uint32_t *desc, const uint8_t *plain_txt,
 }
 #endif
 
-void inline_cnstr_jobdesc_hash(uint32_t *desc,
-			  const uint8_t *msg, uint32_t msgsz, uint8_t *digest,
-			  u32 alg_type, uint32_t alg_size, int sg_tbl)
+/*
+ * One step of a hash computed over several jobs. Unless @state is INIT or
+ * INITFINAL, the running MDHA context is first loaded from @ctx. @pre and
+ * then @msg are hashed, either may be empty. At the end, the context is
+ * saved back to @ctx, or the digest stored in @digest by the last step
+ * (FINALIZE or INITFINAL).
+ */
+void inline_cnstr_jobdesc_hash_step(uint32_t *desc, u32 alg_type, u32 state,
+				    uint8_t *ctx, uint32_t ctxsz,
+				    const uint8_t *pre, uint32_t presz,
+				    const uint8_t *msg, uint32_t msgsz,
+				    uint8_t *digest, uint32_t digestsz)
 {
-	/* SHA 256 , output is of length 32 words */
-	uint32_t storelen = alg_size;
-	u32 options;
-	dma_addr_t dma_addr_in, dma_addr_out;
-
-	dma_addr_in = virt_to_phys((void *)msg);
-	dma_addr_out = virt_to_phys((void *)digest);
+	bool final = state == OP_ALG_AS_FINALIZE ||
+		     state == OP_ALG_AS_INITFINAL;
+	dma_addr_t dma_addr_ctx = virt_to_phys((void *)ctx);
+	u32 options = LDST_CLASS_2_CCB | FIFOLD_TYPE_MSG;
 
 	init_job_desc(desc, 0);
-	append_operation(desc, OP_TYPE_CLASS2_ALG |
-			 OP_ALG_AAI_HASH | OP_ALG_AS_INITFINAL |
+	if (state == OP_ALG_AS_UPDATE || state == OP_ALG_AS_FINALIZE)
+		append_load(desc, dma_addr_ctx, ctxsz,
+			    LDST_CLASS_2_CCB | LDST_SRCDST_BYTE_CONTEXT);
+
+	append_operation(desc, OP_TYPE_CLASS2_ALG | OP_ALG_AAI_HASH | state |
 			 OP_ALG_ENCRYPT | OP_ALG_ICV_OFF | alg_type);
 
-	options = LDST_CLASS_2_CCB | FIFOLD_TYPE_MSG | FIFOLD_TYPE_LAST2;
-	if (sg_tbl)
-		options |= FIFOLDST_SGF;
+	if (presz)
+		append_fifo_load(desc, virt_to_phys((void *)pre), presz,
+				 options | (msgsz ? 0 : FIFOLD_TYPE_LAST2));
+
 	if (msgsz > 0xffff) {
-		options |= FIFOLDST_EXT;
-		append_fifo_load(desc, dma_addr_in, 0, options);
+		append_fifo_load(desc, virt_to_phys((void *)msg), 0,
+				 options | FIFOLDST_EXT | FIFOLD_TYPE_LAST2);
 		append_cmd(desc, msgsz);
-	} else {
-		append_fifo_load(desc, dma_addr_in, msgsz, options);
+	} else if (msgsz || !presz) {
+		append_fifo_load(desc, virt_to_phys((void *)msg), msgsz,
+				 options | FIFOLD_TYPE_LAST2);
 	}
 
-	append_store(desc, dma_addr_out, storelen,
-		     LDST_CLASS_2_CCB | LDST_SRCDST_BYTE_CONTEXT);
+	if (final)
+		append_store(desc, virt_to_phys((void *)digest), digestsz,
+			     LDST_CLASS_2_CCB | LDST_SRCDST_BYTE_CONTEXT);
+	else
+		append_store(desc, dma_addr_ctx, ctxsz,
+			     LDST_CLASS_2_CCB | LDST_SRCDST_BYTE_CONTEXT);
 }
+
 #ifndef CONFIG_SPL_BUILD
 void inline_cnstr_jobdesc_blob_encap(uint32_t *desc, uint8_t *key_idnfr,
 				     uint8_t *plain_txt, uint8_t *enc_blob,
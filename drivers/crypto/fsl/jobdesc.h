@@ -27,9 +27,11 @@ int inline_cnstr_jobdesc_blob_dek(uint32_t *desc, const uint8_t *plain_txt,
 				uint8_t *enc_blob, uint32_t in_sz);
 #endif
 
-void inline_cnstr_jobdesc_hash(uint32_t *desc,
-			  const uint8_t *msg, uint32_t msgsz, uint8_t *digest,
-			  u32 alg_type, uint32_t alg_size, int sg_tbl);
+void inline_cnstr_jobdesc_hash_step(uint32_t *desc, u32 alg_type, u32 state,
+				    uint8_t *ctx, uint32_t ctxsz,
+				    const uint8_t *pre, uint32_t presz,
+				    const uint8_t *msg, uint32_t msgsz,
+				    uint8_t *digest, uint32_t digestsz);
 
 void inline_cnstr_jobdesc_blob_encap(uint32_t *desc, uint8_t *key_idnfr,
 				     uint8_t *plain_txt, uint8_t *enc_blob,
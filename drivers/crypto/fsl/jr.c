@@ -346,45 +346,79 @@ static void desc_done(uint32_t status, void *arg)
 	x->done = 1;
 }
 
-static inline int run_descriptor_jr_idx(uint32_t *desc, uint8_t sec_idx)
+/*
+ * Enqueue @desc, which completes into @op. Several jobs may be in flight:
+ * if the ring is full, wait for the oldest ones to complete first.
+ */
+static int jr_submit(uint32_t *desc, struct result *op, uint8_t sec_idx)
 {
+	struct jobring *jr = &jr0[sec_idx];
 	unsigned long long timeval = get_ticks();
 	unsigned long long timeout = usec2ticks(CONFIG_SEC_DEQ_TIMEOUT);
-	struct result op;
-	int ret = 0;
 
-	memset(&op, 0, sizeof(op));
+	memset(op, 0, sizeof(*op));
 
-	ret = jr_enqueue(desc, desc_done, &op, sec_idx);
-	if (ret) {
+	while (!CIRC_SPACE(jr->head, jr->tail, jr->size)) {
+		if (jr_dequeue(sec_idx)) {
+			debug("Error in SEC deq\n");
+			return JQ_DEQ_ERR;
+		}
+
+		if ((get_ticks() - timeval) > timeout) {
+			debug("SEC Dequeue timed out\n");
+			return JQ_DEQ_TO_ERR;
+		}
+	}
+
+	if (jr_enqueue(desc, desc_done, op, sec_idx)) {
 		debug("Error in SEC enq\n");
-		ret = JQ_ENQ_ERR;
-		goto out;
+		return JQ_ENQ_ERR;
 	}
 
-	timeval = get_ticks();
-	timeout = usec2ticks(CONFIG_SEC_DEQ_TIMEOUT);
-	while (op.done != 1) {
+	return 0;
+}
+
+/*
+ * Wait for the job which completes into @op. The other jobs which complete
+ * in the meantime are dequeued too, into their own results.
+ */
+static int jr_wait(struct result *op, uint8_t sec_idx)
+{
+	unsigned long long timeval = get_ticks();
+	unsigned long long timeout = usec2ticks(CONFIG_SEC_DEQ_TIMEOUT);
+	int ret;
+
+	while (op->done != 1) {
 		ret = jr_dequeue(sec_idx);
 		if (ret) {
 			debug("Error in SEC deq\n");
-			ret = JQ_DEQ_ERR;
-			goto out;
+			return JQ_DEQ_ERR;
 		}
 
 		if ((get_ticks() - timeval) > timeout) {
 			debug("SEC Dequeue timed out\n");
-			ret = JQ_DEQ_TO_ERR;
-			goto out;
+			return JQ_DEQ_TO_ERR;
 		}
 	}
 
-	if (op.status) {
-		debug("Error %x\n", op.status);
-		ret = op.status;
+	if (op->status) {
+		debug("Error %x\n", op->status);
+		return op->status;
 	}
-out:
-	return ret;
+
+	return 0;
+}
+
+static inline int run_descriptor_jr_idx(uint32_t *desc, uint8_t sec_idx)
+{
+	struct result op;
+	int ret;
+
+	ret = jr_submit(desc, &op, sec_idx);
+	if (ret)
+		return ret;
+
+	return jr_wait(&op, sec_idx);
 }
 
 int run_descriptor_jr(uint32_t *desc)
@@ -392,6 +426,16 @@ int run_descriptor_jr(uint32_t *desc)
 	return run_descriptor_jr_idx(desc, 0);
 }
 
+int run_descriptor_jr_async(uint32_t *desc, struct result *op)
+{
+	return jr_submit(desc, op, 0);
+}
+
+int wait_descriptor_jr(struct result *op)
+{
+	return jr_wait(op, 0);
+}
+
 static inline int jr_reset_sec(uint8_t sec_idx)
 {
 	if (jr_hw_reset(sec_idx) < 0)
@@ -106,4 +106,12 @@ struct result {
 void caam_jr_strstatus(u32 status);
 int run_descriptor_jr(uint32_t *desc);
 
+/*
+ * Start @desc and return without waiting for it: @op is filled in when the
+ * job completes, which wait_descriptor_jr() waits for. Both @desc and @op
+ * must stay valid until then. Other jobs may be run in the meantime.
+ */
+int run_descriptor_jr_async(uint32_t *desc, struct result *op);
+int wait_descriptor_jr(struct result *op);
+
 #endif
@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Driver model for hash engines
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <errno.h>
+#include <watchdog.h>
+#include <dm/lists.h>
+#include <dm/root.h>
+#include <u-boot/hash.h>
+
+static bool hash_dev_supports(struct udevice *dev, const char *algo_name)
+{
+	const struct hash_ops *ops = hash_get_ops(dev);
+
+	return ops->supports && ops->supports(dev, algo_name);
+}
+
+int hash_get_device(const char *algo_name, struct udevice **devp)
+{
+	struct udevice *dev;
+	int ret;
+
+	for (ret = uclass_first_device_check(UCLASS_HASH, &dev); dev;
+	     ret = uclass_next_device_check(&dev)) {
+		if (!ret && hash_dev_supports(dev, algo_name)) {
+			*devp = dev;
+			return 0;
+		}
+	}
+
+	/*
+	 * The fallback is only bound now, so that it never comes before an
+	 * engine in the uclass.
+	 */
+	if (IS_ENABLED(CONFIG_HASH_SOFTWARE)) {
+		ret = uclass_get_device_by_name(UCLASS_HASH, "hash_sw", &dev);
+		if (ret == -ENODEV) {
+			ret = device_bind_driver(dm_root(), "hash_sw",
+						 "hash_sw", &dev);
+			if (!ret)
+				ret = device_probe(dev);
+			if (!ret && hash_dev_supports(dev, algo_name)) {
+				*devp = dev;
+				return 0;
+			}
+		}
+	}
+	debug("%s: no device for %s\n", __func__, algo_name);
+
+	return -EPROTONOSUPPORT;
+}
+
+int hash_dev_init(struct udevice *dev, const char *algo_name, void **ctxp)
+{
+	const struct hash_ops *ops = hash_get_ops(dev);
+
+	if (!ops->init)
+		return -ENOSYS;
+
+	return ops->init(dev, algo_name, ctxp);
+}
+
+int hash_dev_update(struct udevice *dev, void *ctx, const void *buf,
+		    unsigned int size, int is_last)
+{
+	const struct hash_ops *ops = hash_get_ops(dev);
+
+	if (!ops->update)
+		return -ENOSYS;
+
+	return ops->update(dev, ctx, buf, size, is_last);
+}
+
+int hash_dev_submit(struct udevice *dev, void *ctx, const void *buf,
+		    unsigned int size, int is_last)
+{
+	const struct hash_ops *ops = hash_get_ops(dev);
+
+	if (!ops->submit)
+		return hash_dev_update(dev, ctx, buf, size, is_last);
+
+	return ops->submit(dev, ctx, buf, size, is_last);
+}
+
+int hash_dev_poll(struct udevice *dev, void *ctx)
+{
+	const struct hash_ops *ops = hash_get_ops(dev);
+
+	if (!ops->poll)
+		return 0;
+
+	return ops->poll(dev, ctx);
+}
+
+int hash_dev_wait(struct udevice *dev, void *ctx)
+{
+	int ret;
+
+	while ((ret = hash_dev_poll(dev, ctx)) == -EBUSY)
+		WATCHDOG_RESET();
+
+	return ret;
+}
+
+int hash_dev_finish(struct udevice *dev, void *ctx, void *dest_buf, int size)
+{
+	const struct hash_ops *ops = hash_get_ops(dev);
+
+	if (!ops->finish)
+		return -ENOSYS;
+
+	return ops->finish(dev, ctx, dest_buf, size);
+}
+
+int hash_dev_digest(struct udevice *dev, const char *algo_name,
+		    const void *buf, unsigned int size, void *dest_buf,
+		    int dest_size)
+{
+	void *ctx;
+	int ret;
+
+	ret = hash_dev_init(dev, algo_name, &ctx);
+	if (ret)
+		return ret;
+
+	ret = hash_dev_update(dev, ctx, buf, size, 1);
+	if (ret) {
+		/* Only to free the context */
+		hash_dev_finish(dev, ctx, dest_buf, dest_size);
+		return ret;
+	}
+
+	return hash_dev_finish(dev, ctx, dest_buf, dest_size);
+}
+
+UCLASS_DRIVER(hash) = {
+	.id		= UCLASS_HASH,
+	.name		= "hash",
+};
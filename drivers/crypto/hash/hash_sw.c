@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Fallback hash device on top of the algorithms of common/hash.c
+ *
+ * That table points at the hw_sha_*() functions when SHA_PROG_HW_ACCEL is
+ * set, so this also reaches engines which have no driver of their own in
+ * the hash uclass. Every update blocks.
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <errno.h>
+#include <hash.h>
+#include <malloc.h>
+#include <u-boot/hash.h>
+
+struct hash_sw_ctx {
+	struct hash_algo *algo;
+	void *ctx;		/* NULL once the algorithm has freed it */
+	int err;
+};
+
+static bool hash_sw_supports(struct udevice *dev, const char *algo_name)
+{
+	struct hash_algo *algo;
+
+	return !hash_progressive_lookup_algo(algo_name, &algo);
+}
+
+static int hash_sw_init(struct udevice *dev, const char *algo_name,
+			void **ctxp)
+{
+	struct hash_sw_ctx *sw;
+	int ret;
+
+	sw = calloc(1, sizeof(*sw));
+	if (!sw)
+		return -ENOMEM;
+
+	ret = hash_progressive_lookup_algo(algo_name, &sw->algo);
+	if (!ret)
+		ret = sw->algo->hash_init(sw->algo, &sw->ctx);
+	if (ret) {
+		free(sw);
+		return ret;
+	}
+	*ctxp = sw;
+
+	return 0;
+}
+
+static int hash_sw_update(struct udevice *dev, void *ctx, const void *buf,
+			  unsigned int size, int is_last)
+{
+	struct hash_sw_ctx *sw = ctx;
+	int ret;
+
+	if (sw->err)
+		return sw->err;
+
+	/* The hw_sha_update() implementations free the context on error */
+	ret = sw->algo->hash_update(sw->algo, sw->ctx, buf, size, is_last);
+	if (ret) {
+		sw->ctx = NULL;
+		sw->err = ret;
+	}
+
+	return ret;
+}
+
+static int hash_sw_finish(struct udevice *dev, void *ctx, void *dest_buf,
+			  int size)
+{
+	struct hash_sw_ctx *sw = ctx;
+	int ret = sw->err;
+
+	if (!ret)
+		ret = sw->algo->hash_finish(sw->algo, sw->ctx, dest_buf, size);
+	free(sw);
+
+	return ret;
+}
+
+static const struct hash_ops hash_sw_ops = {
+	.supports	= hash_sw_supports,
+	.init		= hash_sw_init,
+	.update		= hash_sw_update,
+	.finish		= hash_sw_finish,
+};
+
+U_BOOT_DRIVER(hash_sw) = {
+	.name	= "hash_sw",
+	.id	= UCLASS_HASH,
+	.ops	= &hash_sw_ops,
+	.flags	= DM_FLAG_PRE_RELOC,
+};
@@ -24,6 +24,27 @@ int rsa_mod_exp(struct udevice *dev, const uint8_t *sig, uint32_t sig_len,
 	return ops->mod_exp(dev, sig, sig_len, node, out);
 }
 
+int rsa_mod_exp_start(struct udevice *dev, const uint8_t *sig,
+		      uint32_t sig_len, struct key_prop *node)
+{
+	const struct mod_exp_ops *ops = device_get_ops(dev);
+
+	if (!ops->mod_exp_start || !ops->mod_exp_finish)
+		return -ENOSYS;
+
+	return ops->mod_exp_start(dev, sig, sig_len, node);
+}
+
+int rsa_mod_exp_finish(struct udevice *dev, uint8_t *out)
+{
+	const struct mod_exp_ops *ops = device_get_ops(dev);
+
+	if (!ops->mod_exp_finish)
+		return -ENOSYS;
+
+	return ops->mod_exp_finish(dev, out);
+}
+
 UCLASS_DRIVER(mod_exp) = {
 	.id		= UCLASS_MOD_EXP,
 	.name		= "rsa_mod_exp",
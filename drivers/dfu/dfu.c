@@ -15,6 +15,19 @@
 #include <hash.h>
 #include <linux/list.h>
 #include <linux/compiler.h>
+#include <linux/sizes.h>
+#include <u-boot/crc.h>
+#include <u-boot/zlib.h>
+#include <asm/unaligned.h>
+
+#if CONFIG_IS_ENABLED(DFU_DOUBLE_BUFFER)
+#define DFU_BUF_COUNT		2
+#else
+#define DFU_BUF_COUNT		1
+#endif
+
+/* Most written to the medium per dfu_write_poll() */
+#define DFU_WRITE_SLICE		SZ_256K
 
 static LIST_HEAD(dfu_list);
 static int dfu_alt_num;
@@ -95,6 +108,12 @@ unsigned long dfu_get_buf_size(void)
 	return dfu_buf_size;
 }
 
+static bool dfu_buf_contains(const void *p)
+{
+	return dfu_buf && (u8 *)p >= dfu_buf &&
+	       (u8 *)p < dfu_buf + dfu_buf_size * DFU_BUF_COUNT;
+}
+
 unsigned char *dfu_get_buf(struct dfu_entity *dfu)
 {
 	char *s;
@@ -112,10 +131,11 @@ unsigned char *dfu_get_buf(struct dfu_entity *dfu)
 	if (dfu->max_buf_size && dfu_buf_size > dfu->max_buf_size)
 		dfu_buf_size = dfu->max_buf_size;
 
-	dfu_buf = memalign(CONFIG_SYS_CACHELINE_SIZE, dfu_buf_size);
+	dfu_buf = memalign(CONFIG_SYS_CACHELINE_SIZE,
+			   dfu_buf_size * DFU_BUF_COUNT);
 	if (dfu_buf == NULL)
 		printf("%s: Could not memalign 0x%lx bytes\n",
-		       __func__, dfu_buf_size);
+		       __func__, dfu_buf_size * DFU_BUF_COUNT);
 
 	return dfu_buf;
 }
@@ -137,6 +157,102 @@ static char *dfu_get_hash_algo(void)
 	return NULL;
 }
 
+#if CONFIG_IS_ENABLED(DFU_DOUBLE_BUFFER)
+/* The entity with a buffer waiting for the medium */
+static struct dfu_entity *dfu_busy;
+
+/*
+ * Write the buffer handed over by dfu_write_buffer_drain(), all of it or
+ * just a slice. Entities which limit the buffer size (to an erase block)
+ * get the whole buffer at once.
+ */
+static int dfu_write_pending(struct dfu_entity *dfu, bool all)
+{
+	long w_size, len;
+	int ret;
+
+	while (dfu->w_left) {
+		len = dfu->w_left;
+		if (!all && !dfu->max_buf_size)
+			len = min(len, (long)DFU_WRITE_SLICE);
+		w_size = len;
+
+		ret = dfu->write_medium(dfu, dfu->offset, dfu->w_buf, &w_size);
+		if (ret) {
+			debug("%s: Write error!\n", __func__);
+			dfu->w_left = 0;
+			return ret;
+		}
+		dfu->offset += w_size;
+		dfu->w_buf += len;
+		dfu->w_left -= len;
+		if (!dfu->w_left)
+			puts("#");
+		if (!all)
+			break;
+	}
+	if (dfu_busy == dfu)
+		dfu_busy = NULL;
+
+	return 0;
+}
+
+int dfu_write_poll(void)
+{
+	struct dfu_entity *dfu = dfu_busy;
+	int ret;
+
+	if (!dfu)
+		return 0;
+
+	ret = dfu_write_pending(dfu, false);
+	if (ret) {
+		dfu->w_err = ret;
+		dfu_busy = NULL;
+	}
+
+	return ret;
+}
+
+/* Hand the full buffer over to dfu_write_poll() and switch to the other */
+static int dfu_write_buffer_drain(struct dfu_entity *dfu)
+{
+	long w_size;
+	int ret;
+
+	/* flush size? */
+	w_size = dfu->i_buf - dfu->i_buf_start;
+	if (w_size == 0)
+		return 0;
+
+	if (dfu_hash_algo)
+		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
+					   dfu->i_buf_start, w_size, 0);
+
+	/* Both buffers are full: the host has to wait */
+	ret = dfu_write_pending(dfu, true);
+	if (ret)
+		return ret;
+
+	dfu->w_buf = dfu->i_buf_start;
+	dfu->w_left = w_size;
+	dfu_busy = dfu;
+
+	if (dfu->i_buf_start == dfu_buf)
+		dfu->i_buf_start = dfu_buf + dfu_buf_size;
+	else
+		dfu->i_buf_start = dfu_buf;
+	dfu->i_buf_end = dfu->i_buf_start + dfu_buf_size;
+	dfu->i_buf = dfu->i_buf_start;
+
+	return 0;
+}
+#else
+static inline int dfu_write_pending(struct dfu_entity *dfu, bool all)
+{
+	return 0;
+}
+
 static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 {
 	long w_size;
@@ -165,6 +281,168 @@ static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 
 	return ret;
 }
+#endif
+
+#if CONFIG_IS_ENABLED(DFU_GZIP)
+struct dfu_gzip {
+	z_stream s;
+	bool started;
+	bool ended;		/* the deflate stream ended, trailer follows */
+	u32 crc;
+	u32 size;
+	u8 trailer[8];		/* CRC32 and ISIZE */
+	int trailer_len;
+};
+
+#define GZ_HEAD_CRC		0x02
+#define GZ_EXTRA_FIELD		0x04
+#define GZ_ORIG_NAME		0x08
+#define GZ_COMMENT		0x10
+#define GZ_RESERVED		0xe0
+#define GZ_DEFLATED		8
+
+/* Size of the gzip header, which must be in the first block */
+static int dfu_gzip_header(const u8 *p, int len)
+{
+	int i = 10;
+	u8 flags;
+
+	if (len < i || p[0] != 0x1f || p[1] != 0x8b || p[2] != GZ_DEFLATED)
+		return -EINVAL;
+	flags = p[3];
+	if (flags & GZ_RESERVED)
+		return -EINVAL;
+	if (flags & GZ_EXTRA_FIELD) {
+		if (len < 12)
+			return -EINVAL;
+		i = 12 + p[10] + (p[11] << 8);
+	}
+	if (flags & GZ_ORIG_NAME) {
+		while (i < len && p[i])
+			i++;
+		i++;
+	}
+	if (flags & GZ_COMMENT) {
+		while (i < len && p[i])
+			i++;
+		i++;
+	}
+	if (flags & GZ_HEAD_CRC)
+		i += 2;
+
+	return i <= len ? i : -EINVAL;
+}
+
+static void dfu_gzip_free(struct dfu_entity *dfu)
+{
+	if (!dfu->gz)
+		return;
+	if (dfu->gz->started)
+		inflateEnd(&dfu->gz->s);
+	free(dfu->gz);
+	dfu->gz = NULL;
+}
+
+/* Inflate @buf into the buffer, draining it whenever it fills up */
+static int dfu_gzip_write(struct dfu_entity *dfu, void *buf, int size)
+{
+	struct dfu_gzip *gz = dfu->gz;
+	z_stream *s;
+	int hdr, n, r, ret;
+	u8 *out;
+
+	if (!gz) {
+		gz = calloc(1, sizeof(*gz));
+		if (!gz)
+			return -ENOMEM;
+		dfu->gz = gz;
+
+		hdr = dfu_gzip_header(buf, size);
+		if (hdr < 0) {
+			pr_err("DFU: %s: bad gzip header\n", dfu->name);
+			return hdr;
+		}
+		gz->s.zalloc = gzalloc;
+		gz->s.zfree = gzfree;
+		if (inflateInit2(&gz->s, -MAX_WBITS) != Z_OK)
+			return -ENOMEM;
+		gz->started = true;
+		buf += hdr;
+		size -= hdr;
+	}
+
+	s = &gz->s;
+	s->next_in = buf;
+	s->avail_in = size;
+	while (s->avail_in) {
+		if (gz->ended) {
+			n = min_t(int, s->avail_in,
+				  sizeof(gz->trailer) - gz->trailer_len);
+			memcpy(gz->trailer + gz->trailer_len, s->next_in, n);
+			gz->trailer_len += n;
+			/* Anything after the trailer is ignored */
+			break;
+		}
+
+		out = dfu->i_buf;
+		s->next_out = out;
+		s->avail_out = dfu->i_buf_end - out;
+		r = inflate(s, Z_SYNC_FLUSH);
+		if (r != Z_OK && r != Z_STREAM_END) {
+			pr_err("DFU: %s: inflate() returned %d\n", dfu->name,
+			       r);
+			return -EILSEQ;
+		}
+		n = s->next_out - out;
+		gz->crc = crc32(gz->crc, out, n);
+		gz->size += n;
+		dfu->i_buf += n;
+		if (r == Z_STREAM_END)
+			gz->ended = true;
+
+		if (dfu->i_buf == dfu->i_buf_end) {
+			ret = dfu_write_buffer_drain(dfu);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+/* All of the stream arrived, and it is the one that was sent */
+static int dfu_gzip_check(struct dfu_entity *dfu)
+{
+	struct dfu_gzip *gz = dfu->gz;
+
+	if (!gz || !gz->ended || gz->trailer_len != sizeof(gz->trailer)) {
+		pr_err("DFU: %s: gzip stream truncated\n", dfu->name);
+		return -EILSEQ;
+	}
+	if (get_unaligned_le32(gz->trailer) != gz->crc ||
+	    get_unaligned_le32(gz->trailer + 4) != gz->size) {
+		pr_err("DFU: %s: gzip CRC or size mismatch\n", dfu->name);
+		return -EILSEQ;
+	}
+
+	return 0;
+}
+#else
+static inline void dfu_gzip_free(struct dfu_entity *dfu)
+{
+}
+
+static inline int dfu_gzip_write(struct dfu_entity *dfu, void *buf,
+				 int size)
+{
+	return -ENOSYS;
+}
+
+static inline int dfu_gzip_check(struct dfu_entity *dfu)
+{
+	return 0;
+}
+#endif
 
 void dfu_transaction_cleanup(struct dfu_entity *dfu)
 {
@@ -179,6 +457,14 @@ void dfu_transaction_cleanup(struct dfu_entity *dfu)
 	dfu->b_left = 0;
 	dfu->bad_skip = 0;
 
+	dfu->w_left = 0;
+	dfu->w_err = 0;
+#if CONFIG_IS_ENABLED(DFU_DOUBLE_BUFFER)
+	if (dfu_busy == dfu)
+		dfu_busy = NULL;
+#endif
+	dfu_gzip_free(dfu);
+
 	dfu->inited = 0;
 }
 
@@ -212,9 +498,17 @@ int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 {
 	int ret = 0;
 
-	ret = dfu_write_buffer_drain(dfu);
-	if (ret)
+	ret = dfu->w_err;
+	if (!ret && dfu->gzip)
+		ret = dfu_gzip_check(dfu);
+	if (!ret)
+		ret = dfu_write_buffer_drain(dfu);
+	if (!ret)
+		ret = dfu_write_pending(dfu, true);
+	if (ret) {
+		dfu_transaction_cleanup(dfu);
 		return ret;
+	}
 
 	if (dfu->flush_medium)
 		ret = dfu->flush_medium(dfu);
@@ -263,6 +557,26 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	/* handle rollover */
 	dfu->i_blk_seq_num = (dfu->i_blk_seq_num + 1) & 0xffff;
 
+	/* a write handed over to dfu_write_poll() failed */
+	if (dfu->w_err) {
+		ret = dfu->w_err;
+		dfu_transaction_cleanup(dfu);
+		return ret;
+	}
+
+	if (dfu->gzip) {
+		/* thor receives into dfu_get_buf(), it can't inflate there */
+		if (dfu_buf_contains(buf)) {
+			pr_err("DFU: %s: can't gunzip in place\n", dfu->name);
+			ret = -EINVAL;
+		} else {
+			ret = size ? dfu_gzip_write(dfu, buf, size) : 0;
+		}
+		if (ret)
+			dfu_transaction_cleanup(dfu);
+		return ret;
+	}
+
 	/* flush buffer if overflow */
 	if ((dfu->i_buf + size) > dfu->i_buf_end) {
 		ret = dfu_write_buffer_drain(dfu);
@@ -292,6 +606,15 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 		}
 	}
 
+	/* A caller receiving into dfu_get_buf() overwrites it right away */
+	if (dfu_buf_contains(buf)) {
+		ret = dfu_write_pending(dfu, true);
+		if (ret) {
+			dfu_transaction_cleanup(dfu);
+			return ret;
+		}
+	}
+
 	return 0;
 }
 
@@ -393,6 +716,16 @@ static int dfu_fill_entity(struct dfu_entity *dfu, char *s, int alt,
 	st = strsep(&s, " ");
 	strcpy(dfu->name, st);
 
+#if CONFIG_IS_ENABLED(DFU_GZIP)
+	/* "<name> <layout> ... gzip": the host sends the data gzipped */
+	dfu->gzip = 0;
+	st = s ? strrchr(s, ' ') : NULL;
+	if (st && !strcmp(st + 1, "gzip")) {
+		*st = '\0';
+		dfu->gzip = 1;
+	}
+#endif
+
 	dfu->alt = alt;
 	dfu->max_buf_size = 0;
 	dfu->free_entity = NULL;
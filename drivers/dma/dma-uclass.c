@@ -234,6 +234,28 @@ int dma_memcpy(void *dst, void *src, size_t len)
 	return ops->transfer(dev, DMA_MEM_TO_MEM, dst, src, len);
 }
 
+#if CONFIG_IS_ENABLED(DMA_MEMCPY_LARGE)
+int dma_memcpy_large(void *dst, const void *src, size_t len)
+{
+	ulong d = (ulong)dst, s = (ulong)src;
+	int ret;
+
+	if (len < CONFIG_DMA_MEMCPY_LARGE_MIN ||
+	    !IS_ALIGNED(d | s | len, ARCH_DMA_MINALIGN) ||
+	    (d < s + len && s < d + len))
+		return -EINVAL;
+
+	flush_dcache_range(s, s + len);
+	ret = dma_memcpy(dst, (void *)src, len);
+	if (ret < 0)
+		return ret;
+	/* Drop lines which the CPU may have fetched during the transfer */
+	invalidate_dcache_range(d, d + len);
+
+	return 0;
+}
+#endif
+
 UCLASS_DRIVER(dma) = {
 	.id		= UCLASS_DMA,
 	.name		= "dma",
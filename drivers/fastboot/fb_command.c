@@ -26,6 +26,27 @@ static u32 fastboot_bytes_received;
  */
 static u32 fastboot_bytes_expected;
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+#define FASTBOOT_STREAM_PAD	512
+
+/**
+ * fastboot_stream - state of a download which is flashed as it arrives
+ *
+ * @part: Partition for the next download, set by "oem stream"
+ * @active: The current download is being written to @part
+ * @failed: Writing failed, @response says why
+ * @pending: Bytes at fastboot_buf_addr which have not been written yet
+ * @response: Response for the "flash" command after a failure
+ */
+static struct {
+	char part[FASTBOOT_COMMAND_LEN];
+	bool active;
+	bool failed;
+	u32 pending;
+	char response[FASTBOOT_RESPONSE_LEN];
+} fastboot_stream;
+#endif
+
 static void okay(char *, char *);
 static void getvar(char *, char *);
 static void download(char *, char *);
@@ -37,6 +58,9 @@ static void reboot_bootloader(char *, char *);
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_FORMAT)
 static void oem_format(char *, char *);
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+static void oem_stream(char *, char *);
+#endif
 
 static const struct {
 	const char *command;
@@ -86,6 +110,12 @@ static const struct {
 		.dispatch = oem_format,
 	},
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	[FASTBOOT_COMMAND_OEM_STREAM] = {
+		.command = "oem stream",
+		.dispatch = oem_stream,
+	},
+#endif
 };
 
 /**
@@ -167,6 +197,22 @@ static void download(char *cmd_parameter, char *response)
 		fastboot_fail("Expected nonzero image size", response);
 		return;
 	}
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	fastboot_stream.active = false;
+	if (fastboot_stream.part[0]) {
+		if (fastboot_mmc_stream_start(fastboot_stream.part,
+					      fastboot_bytes_expected,
+					      response))
+			return;
+		fastboot_stream.active = true;
+		fastboot_stream.failed = false;
+		fastboot_stream.pending = 0;
+		printf("Starting download of %d bytes to '%s'\n",
+		       fastboot_bytes_expected, fastboot_stream.part);
+		fastboot_response("DATA", response, "%s", cmd_parameter);
+		return;
+	}
+#endif
 	/*
 	 * Nothing to download yet. Response is of the form:
 	 * [DATA|FAIL]$cmd_parameter
@@ -192,6 +238,28 @@ u32 fastboot_data_remaining(void)
 	return fastboot_bytes_expected - fastboot_bytes_received;
 }
 
+/**
+ * fastboot_data_addr() - Get where download data can be received in place
+ *
+ * @offset: Offset of the data in the download
+ * @len: Number of bytes to receive
+ *
+ * Return: Address in fastboot_buf_addr to receive the data at and then pass
+ * to fastboot_data_download(), or NULL to receive it elsewhere
+ */
+void *fastboot_data_addr(u32 offset, u32 len)
+{
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	/* The data is staged at the start of the buffer instead */
+	if (fastboot_stream.active)
+		return NULL;
+#endif
+	if (offset + len > fastboot_buf_size || offset + len < offset)
+		return NULL;
+
+	return fastboot_buf_addr + offset;
+}
+
 /**
  * fastboot_data_download() - Copy image data to fastboot_buf_addr.
  *
@@ -220,9 +288,26 @@ void fastboot_data_download(const void *fastboot_data,
 			      response);
 		return;
 	}
-	/* Download data to fastboot_buf_addr */
-	memcpy(fastboot_buf_addr + fastboot_bytes_received,
-	       fastboot_data, fastboot_data_len);
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	if (fastboot_stream.active) {
+		/* Keep a block spare to pad the tail of a raw image */
+		if (fastboot_stream.pending + fastboot_data_len +
+		    FASTBOOT_STREAM_PAD > fastboot_buf_size) {
+			fastboot_fail("Download buffer overrun", response);
+			return;
+		}
+		/* After a failure the rest is dropped, "flash" reports it */
+		if (!fastboot_stream.failed) {
+			memcpy(fastboot_buf_addr + fastboot_stream.pending,
+			       fastboot_data, fastboot_data_len);
+			fastboot_stream.pending += fastboot_data_len;
+		}
+	} else
+#endif
+	/* Download data to fastboot_buf_addr, unless it was received there */
+	if (fastboot_data != fastboot_buf_addr + fastboot_bytes_received)
+		memmove(fastboot_buf_addr + fastboot_bytes_received,
+			fastboot_data, fastboot_data_len);
 
 	pre_dot_num = fastboot_bytes_received / BYTES_PER_DOT;
 	fastboot_bytes_received += fastboot_data_len;
@@ -254,6 +339,86 @@ void fastboot_data_complete(char *response)
 	fastboot_bytes_received = 0;
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/**
+ * fastboot_stream_write() - Write the data received for a streamed download
+ *
+ * @last: true to write everything, including a partial block at the end
+ */
+static void fastboot_stream_write(bool last)
+{
+	u32 consumed;
+
+	if (fastboot_stream.failed)
+		return;
+	if (fastboot_mmc_stream_write(fastboot_buf_addr,
+				      fastboot_stream.pending, last, &consumed,
+				      fastboot_stream.response)) {
+		fastboot_stream.failed = true;
+		fastboot_stream.pending = 0;
+		return;
+	}
+	fastboot_stream.pending -= consumed;
+	memmove(fastboot_buf_addr, fastboot_buf_addr + consumed,
+		fastboot_stream.pending);
+}
+
+void fastboot_data_flush(void)
+{
+	/*
+	 * Writing half of the buffer at a time leaves the other half for the
+	 * data that comes in meanwhile
+	 */
+	if (fastboot_stream.active &&
+	    fastboot_stream.pending >= fastboot_buf_size / 2)
+		fastboot_stream_write(false);
+}
+
+/**
+ * oem_stream() - Flash the next download while it arrives
+ *
+ * @cmd_parameter: Pointer to partition name, none to stop streaming
+ * @response: Pointer to fastboot response buffer
+ *
+ * The image of the next download is written to the partition as it is
+ * received, so it may be larger than the download buffer. The "flash"
+ * command which follows, for the same partition, then only completes it.
+ */
+static void oem_stream(char *cmd_parameter, char *response)
+{
+	strlcpy(fastboot_stream.part, cmd_parameter ? cmd_parameter : "",
+		sizeof(fastboot_stream.part));
+	fastboot_okay(NULL, response);
+}
+
+/**
+ * flash_stream() - Complete a download that was streamed to flash
+ *
+ * @cmd_parameter: Pointer to partition name
+ * @response: Pointer to fastboot response buffer
+ */
+static void flash_stream(char *cmd_parameter, char *response)
+{
+	fastboot_stream.active = false;
+	if (!cmd_parameter || strcmp(cmd_parameter, fastboot_stream.part)) {
+		fastboot_fail("image was streamed to another partition",
+			      response);
+	} else {
+		fastboot_stream_write(true);
+		if (fastboot_stream.failed)
+			strlcpy(response, fastboot_stream.response,
+				FASTBOOT_RESPONSE_LEN);
+		else
+			fastboot_mmc_stream_finish(cmd_parameter, response);
+	}
+	fastboot_stream.part[0] = '\0';
+}
+#else
+void fastboot_data_flush(void)
+{
+}
+#endif
+
 #if CONFIG_IS_ENABLED(FASTBOOT_FLASH)
 /**
  * flash() - write the downloaded image to the indicated partition.
@@ -266,6 +431,12 @@ void fastboot_data_complete(char *response)
  */
 static void flash(char *cmd_parameter, char *response)
 {
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	if (fastboot_stream.active) {
+		flash_stream(cmd_parameter, response);
+		return;
+	}
+#endif
 #if CONFIG_IS_ENABLED(FASTBOOT_FLASH_MMC)
 	fastboot_mmc_flash_write(cmd_parameter, fastboot_buf_addr, image_size,
 				 response);
@@ -96,6 +96,97 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+/**
+ * fb_mmc_blk_erase_arg() - Erase MMC in chunks of FASTBOOT_MAX_BLK_WRITE
+ *
+ * @block_dev: Pointer to block device
+ * @start: First block to erase
+ * @blkcnt: Count of blocks
+ * @arg: MMC_TRIM_ARG or MMC_DISCARD_ARG
+ * @return blkcnt, or 0 if the range could not be erased
+ */
+static lbaint_t fb_mmc_blk_erase_arg(struct blk_desc *block_dev,
+				     lbaint_t start, lbaint_t blkcnt, uint arg)
+{
+	lbaint_t blk = start;
+	lbaint_t blks_erased;
+	lbaint_t cur_blkcnt;
+	lbaint_t blks = 0;
+	int i;
+
+	for (i = 0; i < blkcnt; i += FASTBOOT_MAX_BLK_WRITE) {
+		cur_blkcnt = min((int)blkcnt - i, FASTBOOT_MAX_BLK_WRITE);
+		if (fastboot_progress_callback)
+			fastboot_progress_callback("erasing");
+		blks_erased = mmc_berase_arg(block_dev, blk, cur_blkcnt, arg);
+		/* Let the caller write the blocks instead */
+		if (blks_erased != cur_blkcnt)
+			return 0;
+		blk += blks_erased;
+		blks += blks_erased;
+	}
+	return blks;
+}
+
+/* Erase FILL chunks whose pattern is what erased blocks read back as */
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt, u32 fill_val)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+	struct blk_desc *dev_desc = sparse->dev_desc;
+	struct mmc *mmc = find_mmc_device(dev_desc->devnum);
+	u32 erased_val;
+
+	if (!mmc || !mmc_can_trim(mmc, &erased_val) || erased_val != fill_val)
+		return 0;
+
+	return fb_mmc_blk_erase_arg(dev_desc, blk, blkcnt, MMC_TRIM_ARG);
+}
+
+/* DONT_CARE chunks are discarded, so that the device can reuse them */
+static lbaint_t fb_mmc_sparse_discard(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+	struct blk_desc *dev_desc = sparse->dev_desc;
+	struct mmc *mmc = find_mmc_device(dev_desc->devnum);
+
+	/* This is only a hint, so never fail for it */
+	if (mmc && mmc_can_discard(mmc))
+		fb_mmc_blk_erase_arg(dev_desc, blk, blkcnt, MMC_DISCARD_ARG);
+
+	return blkcnt;
+}
+#endif
+
+static void fb_mmc_setup_sparse(struct sparse_storage *sparse,
+				struct fb_mmc_sparse *sparse_priv,
+				struct blk_desc *dev_desc,
+				disk_partition_t *info)
+{
+	sparse_priv->dev_desc = dev_desc;
+
+	sparse->blksz = info->blksz;
+	sparse->start = info->start;
+	sparse->size = info->size;
+	sparse->write = fb_mmc_sparse_write;
+	sparse->reserve = fb_mmc_sparse_reserve;
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	sparse->erase = fb_mmc_sparse_erase;
+	sparse->discard = fb_mmc_sparse_discard;
+#else
+	sparse->erase = NULL;
+	sparse->discard = NULL;
+#endif
+	sparse->mssg = fastboot_fail;
+
+	printf("Flashing sparse image at offset " LBAFU "\n",
+	       sparse->start);
+
+	sparse->priv = sparse_priv;
+}
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		u32 download_bytes, char *response)
@@ -405,19 +496,7 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		struct sparse_storage sparse;
 		int err;
 
-		sparse_priv.dev_desc = dev_desc;
-
-		sparse.blksz = info.blksz;
-		sparse.start = info.start;
-		sparse.size = info.size;
-		sparse.write = fb_mmc_sparse_write;
-		sparse.reserve = fb_mmc_sparse_reserve;
-		sparse.mssg = fastboot_fail;
-
-		printf("Flashing sparse image at offset " LBAFU "\n",
-		       sparse.start);
-
-		sparse.priv = &sparse_priv;
+		fb_mmc_setup_sparse(&sparse, &sparse_priv, dev_desc, &info);
 		err = write_sparse_image(&sparse, cmd, download_buffer,
 					 response);
 		if (!err)
@@ -428,6 +507,116 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 	}
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+static struct fb_mmc_stream {
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+	u32 size;		/* of the whole image */
+	bool started;		/* the image type is known */
+	bool sparse;
+	struct fb_mmc_sparse sparse_priv;
+	struct sparse_storage storage;
+	struct sparse_stream stream;
+	lbaint_t blk;		/* next block of a raw image */
+} fb_stream;
+
+int fastboot_mmc_stream_start(const char *cmd, u32 size, char *response)
+{
+	struct fb_mmc_stream *s = &fb_stream;
+
+	s->dev_desc = blk_get_dev("mmc", CONFIG_FASTBOOT_FLASH_MMC_DEV);
+	if (!s->dev_desc || s->dev_desc->type == DEV_TYPE_UNKNOWN) {
+		pr_err("invalid mmc device\n");
+		fastboot_fail("invalid mmc device", response);
+		return -ENODEV;
+	}
+
+	if (part_get_info_by_name_or_alias(s->dev_desc, cmd, &s->info) < 0) {
+		pr_err("cannot find partition: '%s'\n", cmd);
+		fastboot_fail("cannot find partition", response);
+		return -ENOENT;
+	}
+
+	s->size = size;
+	s->started = false;
+
+	return 0;
+}
+
+int fastboot_mmc_stream_write(void *buf, u32 len, bool last, u32 *consumedp,
+			      char *response)
+{
+	struct fb_mmc_stream *s = &fb_stream;
+	lbaint_t blkcnt, blks;
+	size_t consumed;
+
+	*consumedp = 0;
+	if (!s->started) {
+		if (len < sizeof(sparse_header_t) && !last)
+			return 0;
+		s->sparse = len >= sizeof(sparse_header_t) &&
+			    is_sparse_image(buf);
+		if (s->sparse) {
+			fb_mmc_setup_sparse(&s->storage, &s->sparse_priv,
+					    s->dev_desc, &s->info);
+			sparse_stream_init(&s->stream, &s->storage);
+		} else {
+			blkcnt = DIV_ROUND_UP(s->size, s->info.blksz);
+			if (blkcnt > s->info.size) {
+				pr_err("too large for partition\n");
+				fastboot_fail("too large for partition",
+					      response);
+				return -EFBIG;
+			}
+			puts("Flashing Raw Image\n");
+			s->blk = s->info.start;
+		}
+		s->started = true;
+	}
+
+	if (s->sparse) {
+		if (sparse_stream_write(&s->stream, buf, len, &consumed,
+					response))
+			return -EIO;
+		*consumedp = consumed;
+		return 0;
+	}
+
+	/* The caller leaves room to round the tail up to a whole block */
+	blkcnt = len / s->info.blksz;
+	if (last && len % s->info.blksz) {
+		memset(buf + len, '\0', s->info.blksz - len % s->info.blksz);
+		blkcnt++;
+	}
+	blks = fb_mmc_blk_write(s->dev_desc, s->blk, blkcnt, buf);
+	if (blks != blkcnt) {
+		pr_err("failed writing to device %d\n", s->dev_desc->devnum);
+		fastboot_fail("failed writing to device", response);
+		return -EIO;
+	}
+	s->blk += blks;
+	*consumedp = last ? len : blkcnt * s->info.blksz;
+
+	return 0;
+}
+
+int fastboot_mmc_stream_finish(const char *cmd, char *response)
+{
+	struct fb_mmc_stream *s = &fb_stream;
+
+	if (s->sparse) {
+		if (sparse_stream_finish(&s->stream, cmd, response))
+			return -EIO;
+	} else {
+		printf("........ wrote " LBAFU " bytes to '%s'\n",
+		       (s->blk - s->info.start) * s->info.blksz, cmd);
+	}
+	fastboot_okay(NULL, response);
+
+	return 0;
+}
+#endif
+
 /**
  * fastboot_mmc_flash_erase() - Erase eMMC for fastboot
  *
@@ -145,6 +145,20 @@ static lbaint_t fb_nand_sparse_reserve(struct sparse_storage *info,
 	return blkcnt + bad_blocks;
 }
 
+static lbaint_t fb_nand_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt, u32 fill_val)
+{
+	/*
+	 * Like every other write here, this relies on the partition being
+	 * erased before it is flashed: erased pages already read back as
+	 * all ones, so there is nothing to program for them.
+	 */
+	if (fill_val != 0xffffffff)
+		return 0;
+
+	return fb_nand_sparse_reserve(info, blk, blkcnt);
+}
+
 /**
  * fastboot_nand_get_part_info() - Lookup NAND partion by name
  *
@@ -198,6 +212,8 @@ void fastboot_nand_flash_write(const char *cmd, void *download_buffer,
 		sparse.size = part->size / sparse.blksz;
 		sparse.write = fb_nand_sparse_write;
 		sparse.reserve = fb_nand_sparse_reserve;
+		sparse.erase = fb_nand_sparse_erase;
+		sparse.discard = NULL;
 		sparse.mssg = fastboot_fail;
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
@@ -21,6 +21,9 @@
 
 #define HIGHSPEED_TTIMEOUT		3
 
+/* Shorter transfers are done a byte at a time */
+#define I2C_BUF_MIN_LEN			4
+
 /*
  * Device private data
  */
@@ -31,6 +34,10 @@ struct ast_i2c_priv {
 	struct ast_i2c_regs *regs;
 	/* I2C speed in Hz */
 	int speed;
+	/* Pool buffer, NULL if the bus has none */
+	void __iomem *buf_base;
+	/* Pool buffer size in bytes */
+	int buf_size;
 };
 
 /*
@@ -87,12 +94,20 @@ static void ast_i2c_init_bus(struct udevice *dev)
 static int ast_i2c_ofdata_to_platdata(struct udevice *dev)
 {
 	struct ast_i2c_priv *priv = dev_get_priv(dev);
+	fdt_addr_t addr;
+	fdt_size_t size;
 	int ret;
 
 	priv->regs = devfdt_get_addr_ptr(dev);
 	if (IS_ERR(priv->regs))
 		return PTR_ERR(priv->regs);
 
+	addr = devfdt_get_addr_size_index(dev, 1, &size);
+	if (addr != FDT_ADDR_T_NONE && size >= I2C_BUF_MIN_LEN) {
+		priv->buf_base = map_physmem(addr, size, MAP_NOCACHE);
+		priv->buf_size = size;
+	}
+
 	ret = clk_get_by_index(dev, 0, &priv->clk);
 	if (ret < 0) {
 		debug("%s: Can't get clock for %s: %d\n", __func__, dev->name,
@@ -184,6 +199,77 @@ static int ast_i2c_start_txn(struct udevice *dev, uint devaddr)
 	return ast_i2c_wait_tx(dev);
 }
 
+/*
+ * The pool buffer is SRAM which must be accessed a word at a time. The
+ * bytes are sent and received in little-endian order.
+ */
+static void ast_i2c_buf_fill(struct ast_i2c_priv *priv, const u8 *data,
+			     int len)
+{
+	u32 word;
+	int i;
+
+	for (i = 0; i < len; i += 4) {
+		word = 0;
+		memcpy(&word, data + i, min(len - i, 4));
+		writel(le32_to_cpu(word), priv->buf_base + i);
+	}
+}
+
+static void ast_i2c_buf_drain(struct ast_i2c_priv *priv, u8 *data, int len)
+{
+	u32 word;
+	int i;
+
+	for (i = 0; i < len; i += 4) {
+		word = cpu_to_le32(readl(priv->buf_base + i));
+		memcpy(data + i, &word, min(len - i, 4));
+	}
+}
+
+/* Read @len bytes using the pool buffer, NAKing the last one */
+static int ast_i2c_read_buf(struct udevice *dev, u8 *buffer, size_t len)
+{
+	struct ast_i2c_priv *priv = dev_get_priv(dev);
+	u32 i2c_cmd;
+	int chunk, ret;
+
+	for (; len > 0; len -= chunk, buffer += chunk) {
+		chunk = min_t(size_t, len, priv->buf_size);
+		i2c_cmd = I2CD_M_RX_CMD | I2CD_RX_BUFF_ENABLE;
+		if (chunk == len)
+			i2c_cmd |= I2CD_M_S_RX_CMD_LAST;
+		writel(I2CD_BUF_RX_SIZE(chunk - 1) | I2CD_BUF_OFFSET(0),
+		       &priv->regs->pbcr);
+		writel(i2c_cmd, &priv->regs->csr);
+		ret = ast_i2c_wait_isr(dev, I2CD_INTR_RX_DONE);
+		if (ret < 0)
+			return ret;
+		ast_i2c_buf_drain(priv, buffer, chunk);
+	}
+
+	return 0;
+}
+
+static int ast_i2c_write_buf(struct udevice *dev, u8 *buffer, size_t len)
+{
+	struct ast_i2c_priv *priv = dev_get_priv(dev);
+	int chunk, ret;
+
+	for (; len > 0; len -= chunk, buffer += chunk) {
+		chunk = min_t(size_t, len, priv->buf_size);
+		ast_i2c_buf_fill(priv, buffer, chunk);
+		writel(I2CD_BUF_TX_COUNT(chunk - 1) | I2CD_BUF_OFFSET(0),
+		       &priv->regs->pbcr);
+		writel(I2CD_M_TX_CMD | I2CD_TX_BUFF_ENABLE, &priv->regs->csr);
+		ret = ast_i2c_wait_tx(dev);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
 static int ast_i2c_read_data(struct udevice *dev, u8 chip_addr, u8 *buffer,
 			     size_t len, bool send_stop)
 {
@@ -195,6 +281,13 @@ static int ast_i2c_read_data(struct udevice *dev, u8 chip_addr, u8 *buffer,
 	if (ret < 0)
 		return ret;
 
+	if (priv->buf_base && len >= I2C_BUF_MIN_LEN) {
+		ret = ast_i2c_read_buf(dev, buffer, len);
+		if (ret < 0)
+			return ret;
+		len = 0;
+	}
+
 	for (; len > 0; len--, buffer++) {
 		if (len == 1)
 			i2c_cmd |= I2CD_M_S_RX_CMD_LAST;
@@ -223,6 +316,13 @@ static int ast_i2c_write_data(struct udevice *dev, u8 chip_addr, u8
 	if (ret < 0)
 		return ret;
 
+	if (priv->buf_base && len >= I2C_BUF_MIN_LEN) {
+		ret = ast_i2c_write_buf(dev, buffer, len);
+		if (ret < 0)
+			return ret;
+		len = 0;
+	}
+
 	for (; len > 0; len--, buffer++) {
 		writel(*buffer, &priv->regs->trbbr);
 		writel(I2CD_M_TX_CMD, &priv->regs->csr);
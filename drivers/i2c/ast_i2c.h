@@ -123,6 +123,12 @@ struct ast_i2c_regs {
 #define I2CD_M_TX_CMD					(0x1 << 1)
 #define I2CD_M_START_CMD				0x1
 
+/* 0x1c : I2CD Pool Buffer Control Register */
+#define I2CD_BUF_RX_SIZE(x)				((x) << 16)
+#define I2CD_BUF_TX_COUNT(x)			((x) << 8)
+#define I2CD_BUF_OFFSET(x)				(x)
+
+/* 0x20 : I2CD Transmit/Receive Byte Buffer Register */
 #define I2CD_RX_DATA_SHIFT			8
 #define I2CD_RX_DATA_MASK			(0xff << I2CD_RX_DATA_SHIFT)
 
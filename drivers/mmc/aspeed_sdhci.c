@@ -18,6 +18,9 @@
 #define EMMC_MIN_FREQ	400000
 
 struct aspeed_sdhci_plat {
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	struct dtd_aspeed_emmc_ast2600 dtplat;
+#endif
 	struct mmc_config cfg;
 	struct mmc mmc;
 	unsigned int f_max;
@@ -42,7 +45,11 @@ static int aspeed_sdhci_probe(struct udevice *dev)
 	int node = dev_of_offset(dev);
 #endif
 
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	ret = clk_get_by_index_platdata(dev, 0, plat->dtplat.clocks, &clk);
+#else
 	ret = clk_get_by_index(dev, 0, &clk);
+#endif
 	if (ret < 0) {
 		pr_debug("%s: Can't get clock for %s: %d\n", __func__, dev->name,
 		      ret);
@@ -83,9 +90,14 @@ static int aspeed_sdhci_probe(struct udevice *dev)
 #endif
 //	host->quirks = SDHCI_QUIRK_WAIT_SEND_CMD;
 	host->max_clk = clock;
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	f_max = clock;
+	host->bus_width = plat->dtplat.bus_width;
+#else
 	f_max = dev_read_u32_default(dev, "max-frequency", clock);
 
 	host->bus_width = dev_read_u32_default(dev, "bus-width", 4);
+#endif
 
 	if (host->bus_width == 8)
 		host->host_caps |= MMC_MODE_8BIT;
@@ -96,7 +108,11 @@ static int aspeed_sdhci_probe(struct udevice *dev)
 	if (ret)
 		return ret;
 
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	host->mmc->drv_type = plat->dtplat.sdhci_drive_type;
+#else
 	host->mmc->drv_type = dev_read_u32_default(dev, "sdhci-drive-type", 0);
+#endif
 	host->mmc->priv = host;
 	host->mmc->dev = dev;
 	upriv->mmc = host->mmc;
@@ -107,13 +123,33 @@ static int aspeed_sdhci_probe(struct udevice *dev)
 static int aspeed_sdhci_ofdata_to_platdata(struct udevice *dev)
 {
 	struct aspeed_sdhci_priv *priv = dev_get_priv(dev);
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	struct aspeed_sdhci_plat *plat = dev_get_platdata(dev);
+	struct dtd_aspeed_aspeed_emmc_irq *ic_plat;
+	struct udevice *ic;
+	int ret;
+#endif
 
 	priv->host = calloc(1, sizeof(struct sdhci_host));
 	if (!priv->host)
 			return -1;
 
 	priv->host->name = dev->name;
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	/*
+	 * The slot registers are relative to the interrupt controller, which
+	 * is the parent node in the device tree but not with of-platdata.
+	 */
+	ret = uclass_get_device_by_driver(UCLASS_MISC,
+					  DM_GET_DRIVER(aspeed_sdhci_ic), &ic);
+	if (ret)
+		return ret;
+	ic_plat = dev_get_platdata(ic);
+	priv->host->ioaddr = map_sysmem(ic_plat->reg[0] + plat->dtplat.reg[0],
+					plat->dtplat.reg[1]);
+#else
 	priv->host->ioaddr = (void *)dev_read_addr(dev);
+#endif
 
 	return 0;
 }
@@ -133,7 +169,12 @@ static const struct udevice_id aspeed_sdhci_ids[] = {
 };
 
 U_BOOT_DRIVER(aspeed_sdhci_drv) = {
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	/* of-platdata only describes the eMMC slot SPL boots from */
+	.name		= "aspeed_emmc_ast2600",
+#else
 	.name		= "aspeed_sdhci",
+#endif
 	.id		= UCLASS_MMC,
 	.of_match	= aspeed_sdhci_ids,
 	.ofdata_to_platdata = aspeed_sdhci_ofdata_to_platdata,
@@ -6,8 +6,10 @@
 #include <common.h>
 #include <clk.h>
 #include <dm.h>
+#include <dt-structs.h>
 #include <errno.h>
 #include <fdtdec.h>
+#include <mapmem.h>
 #include <asm/io.h>
 #include <linux/io.h>
 #include <linux/ioport.h>
@@ -27,23 +29,48 @@ struct aspeed_sdhci_general_reg {
 struct aspeed_sdhci_general_data {
 	struct aspeed_sdhci_general_reg *regs;
 	struct clk_bulk clks;
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	struct clk clk[2];
+#endif
 };
 
 static int aspeed_sdhci_irq_ofdata_to_platdata(struct udevice *dev)
 {
 	struct aspeed_sdhci_general_data *priv = dev_get_priv(dev);
 
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	struct dtd_aspeed_aspeed_emmc_irq *dtplat = dev_get_platdata(dev);
+	int i, ret;
+
+	/* clk_get_by_index_platdata() only decodes the first cell */
+	for (i = 0; i < ARRAY_SIZE(priv->clk); i++) {
+		ret = clk_get_by_index_platdata(dev, 0, &dtplat->clocks[i],
+						&priv->clk[i]);
+		if (ret)
+			return ret;
+	}
+	priv->clks.clks = priv->clk;
+	priv->clks.count = ARRAY_SIZE(priv->clk);
+
+	return 0;
+#else
 	return clk_get_bulk(dev, &priv->clks);
+#endif
 }
 
 static int aspeed_sdhci_irq_probe(struct udevice *dev)
 {
 	struct aspeed_sdhci_general_data *priv = dev_get_priv(dev);
-	int ret = 0;
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	struct dtd_aspeed_aspeed_emmc_irq *dtplat = dev_get_platdata(dev);
+#else
 	struct resource regs;
+#endif
+	int ret = 0;
 	void __iomem  *sdhci_ctrl_base;
 	u32 timing_phase;
 	u32 reg_val;
+	bool hs200;
 
 	debug("%s(dev=%p) \n", __func__, dev);
 
@@ -53,6 +80,12 @@ static int aspeed_sdhci_irq_probe(struct udevice *dev)
 		return ret;
 	}
 
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	sdhci_ctrl_base = map_sysmem(dtplat->reg[0], dtplat->reg[1]);
+	timing_phase = dtplat->timing_phase;
+	/* SPL boots the eMMC in a legacy mode */
+	hs200 = false;
+#else
 	ret = dev_read_resource(dev, 0, &regs);
 	if (ret < 0)
 		return ret;
@@ -60,9 +93,12 @@ static int aspeed_sdhci_irq_probe(struct udevice *dev)
 	sdhci_ctrl_base = (void __iomem  *)regs.start;
 
 	timing_phase = dev_read_u32_default(dev, "timing-phase", 0);
+	hs200 = dev_read_bool(dev, "sdhci_hs200");
+#endif
+	priv->regs = sdhci_ctrl_base;
 	writel(timing_phase, sdhci_ctrl_base + TIMING_PHASE_OFFSET);
 
-	if (dev_read_bool(dev, "sdhci_hs200")) {
+	if (hs200) {
 		reg_val = readl(sdhci_ctrl_base + SDHCI140_SLOT_0_CAP_REG_1_OFFSET);
 		/* support 1.8V */
 		reg_val |= BIT(26);
@@ -83,7 +119,12 @@ static const struct udevice_id aspeed_sdhci_irq_ids[] = {
 };
 
 U_BOOT_DRIVER(aspeed_sdhci_ic) = {
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	/* of-platdata only describes the eMMC controller SPL boots from */
+	.name		= "aspeed_aspeed_emmc_irq",
+#else
 	.name		= "aspeed_sdhci_ic",
+#endif
 	.id			= UCLASS_MISC,
 	.of_match	= aspeed_sdhci_irq_ids,
 	.probe		= aspeed_sdhci_irq_probe,
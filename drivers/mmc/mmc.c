@@ -8,6 +8,7 @@
 
 #include <config.h>
 #include <common.h>
+#include <bloblist.h>
 #include <command.h>
 #include <dm.h>
 #include <dm/device-internal.h>
@@ -206,16 +207,24 @@ int mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 }
 #endif
 
+/*
+ * Wait for the card to be ready for data, for up to @timeout ms. A card is
+ * mostly done within a few tens of microseconds after a write, so it is
+ * polled often at first and then less and less, up to once a millisecond.
+ */
 int mmc_send_status(struct mmc *mmc, int timeout)
 {
 	struct mmc_cmd cmd;
 	int err, retries = 5;
+	uint delay = 8;
+	ulong start;
 
 	cmd.cmdidx = MMC_CMD_SEND_STATUS;
 	cmd.resp_type = MMC_RSP_R1;
 	if (!mmc_host_is_spi(mmc))
 		cmd.cmdarg = mmc->rca << 16;
 
+	start = get_timer(0);
 	while (1) {
 		err = mmc_send_cmd(mmc, &cmd, NULL);
 		if (!err) {
@@ -234,10 +243,13 @@ int mmc_send_status(struct mmc *mmc, int timeout)
 		} else if (--retries < 0)
 			return err;
 
-		if (timeout-- <= 0)
+		if (get_timer(start) > timeout) {
+			timeout = 0;
 			break;
+		}
 
-		udelay(1000);
+		udelay(delay);
+		delay = min(delay * 2, 1000U);
 	}
 
 	mmc_trace_state(mmc, &cmd);
@@ -353,11 +365,40 @@ int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error)
 }
 #endif
 
+/*
+ * Announce a multiple block transfer of @blkcnt blocks with CMD23, if the
+ * card supports it. Returns 1 if it was announced and so needs no CMD12, 0 if
+ * not, -ve on error.
+ */
+int mmc_set_block_count(struct mmc *mmc, lbaint_t blkcnt)
+{
+	struct mmc_cmd cmd;
+	int err;
+
+	if (!IS_ENABLED(CONFIG_MMC_SET_BLOCK_COUNT) || !mmc->set_block_count ||
+	    blkcnt < 2 || blkcnt > 0xffff)
+		return 0;
+
+	cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+	cmd.cmdarg = blkcnt;
+	cmd.resp_type = MMC_RSP_R1;
+	err = mmc_send_cmd(mmc, &cmd, NULL);
+	if (err)
+		return err;
+
+	return 1;
+}
+
 static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 			   lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
+	int predefined;
+
+	predefined = mmc_set_block_count(mmc, blkcnt);
+	if (predefined < 0)
+		return 0;
 
 	if (blkcnt > 1)
 		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
@@ -379,7 +420,7 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	if (mmc_send_cmd(mmc, &cmd, &data))
 		return 0;
 
-	if (blkcnt > 1) {
+	if (blkcnt > 1 && !predefined) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
@@ -835,10 +876,14 @@ static int mmc_get_capabilities(struct mmc *mmc)
 	char cardtype;
 
 	mmc->card_caps = MMC_MODE_1BIT | MMC_CAP(MMC_LEGACY);
+	mmc->set_block_count = false;
 
 	if (mmc_host_is_spi(mmc))
 		return 0;
 
+	/* CMD23 came with version 3.1, the first with CSD structure 3 */
+	mmc->set_block_count = mmc->version >= MMC_VERSION_3;
+
 	/* Only version 4 supports high-speed */
 	if (mmc->version < MMC_VERSION_4)
 		return 0;
@@ -1209,6 +1254,7 @@ static int sd_get_capabilities(struct mmc *mmc)
 #endif
 
 	mmc->card_caps = MMC_MODE_1BIT | MMC_CAP(SD_LEGACY);
+	mmc->set_block_count = false;
 
 	if (mmc_host_is_spi(mmc))
 		return 0;
@@ -1266,6 +1312,8 @@ retry_scr:
 
 	if (mmc->scr[0] & SD_DATA_4BIT)
 		mmc->card_caps |= MMC_MODE_4BIT;
+	if (mmc->scr[0] & SD_SCR_CMD23)
+		mmc->set_block_count = true;
 
 	/* Version 1.0 doesn't support switching */
 	if (mmc->version == SD_VERSION_1_0)
@@ -1923,6 +1971,163 @@ static int mmc_select_hs400(struct mmc *mmc)
 	    ecbv++) \
 		if ((ddr == ecbv->is_ddr) && (caps & ecbv->cap))
 
+/*
+ * Switch the card and the host to a mode and width and check that it works.
+ * On failure the bus is reverted to a safe 1-bit legacy mode.
+ */
+static int mmc_try_mode_and_width(struct mmc *mmc,
+				  const struct mode_width_tuning *mwt,
+				  const struct ext_csd_bus_width *ecbw)
+{
+	enum mmc_voltage old_voltage;
+	int err;
+
+	pr_debug("trying mode %s width %d (at %d MHz)\n",
+		 mmc_mode_name(mwt->mode),
+		 bus_width(ecbw->cap),
+		 mmc_mode2freq(mmc, mwt->mode) / 1000000);
+	old_voltage = mmc->signal_voltage;
+	err = mmc_set_lowest_voltage(mmc, mwt->mode,
+				     MMC_ALL_SIGNAL_VOLTAGE);
+	if (err)
+		return err;
+
+	/* configure the bus width (card + host) */
+	err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL,
+			 EXT_CSD_BUS_WIDTH,
+			 ecbw->ext_csd_bits & ~EXT_CSD_DDR_FLAG);
+	if (err)
+		goto error;
+	mmc_set_bus_width(mmc, bus_width(ecbw->cap));
+
+	if (mwt->mode == MMC_HS_400) {
+		err = mmc_select_hs400(mmc);
+		if (err) {
+			printf("Select HS400 failed %d\n", err);
+			goto error;
+		}
+	} else {
+		/* configure the bus speed (card) */
+		err = mmc_set_card_speed(mmc, mwt->mode, false);
+		if (err)
+			goto error;
+
+		/*
+		 * configure the bus width AND the ddr mode
+		 * (card). The host side will be taken care
+		 * of in the next step
+		 */
+		if (ecbw->ext_csd_bits & EXT_CSD_DDR_FLAG) {
+			err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL,
+					 EXT_CSD_BUS_WIDTH,
+					 ecbw->ext_csd_bits);
+			if (err)
+				goto error;
+		}
+
+		/* configure the bus mode (host) */
+		mmc_select_mode(mmc, mwt->mode);
+		mmc_set_clock(mmc, mmc->tran_speed, MMC_CLK_ENABLE);
+#ifdef MMC_SUPPORTS_TUNING
+
+		/* execute tuning if needed */
+		if (mwt->tuning) {
+			err = mmc_execute_tuning(mmc, mwt->tuning);
+			if (err) {
+				pr_debug("tuning failed\n");
+				goto error;
+			}
+		}
+#endif
+	}
+
+	/* do a transfer to check the configuration */
+	err = mmc_read_and_compare_ext_csd(mmc);
+	if (!err)
+		return 0;
+error:
+	mmc_set_signal_voltage(mmc, old_voltage);
+	/* if an error occured, revert to a safer bus mode */
+	mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL,
+		   EXT_CSD_BUS_WIDTH, EXT_CSD_BUS_WIDTH_1);
+	mmc_select_mode(mmc, MMC_LEGACY);
+	mmc_set_bus_width(mmc, 1);
+
+	return err;
+}
+
+#ifdef CONFIG_MMC_MODE_CACHE
+/*
+ * The mode and width which the last negotiation with a card ended in, found
+ * again by the CID of the card. A re-init tries it first, so that the modes
+ * which failed before are not tried again.
+ */
+#define MMC_MODE_CACHE_ENTRIES	4
+
+static struct mmc_mode_cache {
+	uint cid[4];
+	enum bus_mode mode;
+	uint width_cap;
+	bool is_ddr;
+	bool valid;
+} mmc_mode_cache[MMC_MODE_CACHE_ENTRIES];
+
+static struct mmc_mode_cache *mmc_mode_cache_find(struct mmc *mmc)
+{
+	int i;
+
+	for (i = 0; i < MMC_MODE_CACHE_ENTRIES; i++) {
+		if (mmc_mode_cache[i].valid &&
+		    !memcmp(mmc_mode_cache[i].cid, mmc->cid, sizeof(mmc->cid)))
+			return &mmc_mode_cache[i];
+	}
+
+	return NULL;
+}
+
+static void mmc_mode_cache_save(struct mmc *mmc,
+				const struct mode_width_tuning *mwt,
+				const struct ext_csd_bus_width *ecbw)
+{
+	struct mmc_mode_cache *c = mmc_mode_cache_find(mmc);
+	static int next;
+
+	if (!c) {
+		c = &mmc_mode_cache[next];
+		next = (next + 1) % MMC_MODE_CACHE_ENTRIES;
+	}
+	memcpy(c->cid, mmc->cid, sizeof(c->cid));
+	c->mode = mwt->mode;
+	c->width_cap = ecbw->cap;
+	c->is_ddr = ecbw->is_ddr;
+	c->valid = true;
+}
+
+static int mmc_select_cached_mode(struct mmc *mmc, uint card_caps)
+{
+	struct mmc_mode_cache *c = mmc_mode_cache_find(mmc);
+	const struct mode_width_tuning *mwt;
+	const struct ext_csd_bus_width *ecbw;
+
+	if (!c)
+		return -ENOENT;
+
+	for_each_mmc_mode_by_pref(card_caps, mwt) {
+		if (mwt->mode != c->mode)
+			continue;
+		for_each_supported_width(card_caps & mwt->widths & c->width_cap,
+					 c->is_ddr, ecbw) {
+			if (!mmc_try_mode_and_width(mmc, mwt, ecbw))
+				return 0;
+		}
+	}
+	pr_debug("cached mode %s failed\n", mmc_mode_name(c->mode));
+	c->valid = false;
+
+	return -EIO;
+}
+#endif
+
 static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 {
 	int err;
@@ -1960,83 +2165,21 @@ static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 #endif
 		mmc_set_clock(mmc, mmc->legacy_speed, MMC_CLK_ENABLE);
 
+#ifdef CONFIG_MMC_MODE_CACHE
+	if (!mmc_select_cached_mode(mmc, card_caps))
+		return 0;
+#endif
+
 	for_each_mmc_mode_by_pref(card_caps, mwt) {
 		for_each_supported_width(card_caps & mwt->widths,
 					 mmc_is_mode_ddr(mwt->mode), ecbw) {
-			enum mmc_voltage old_voltage;
-			pr_debug("trying mode %s width %d (at %d MHz)\n",
-				 mmc_mode_name(mwt->mode),
-				 bus_width(ecbw->cap),
-				 mmc_mode2freq(mmc, mwt->mode) / 1000000);
-			old_voltage = mmc->signal_voltage;
-			err = mmc_set_lowest_voltage(mmc, mwt->mode,
-						     MMC_ALL_SIGNAL_VOLTAGE);
-			if (err)
-				continue;
-
-			/* configure the bus width (card + host) */
-			err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL,
-				    EXT_CSD_BUS_WIDTH,
-				    ecbw->ext_csd_bits & ~EXT_CSD_DDR_FLAG);
-			if (err)
-				goto error;
-			mmc_set_bus_width(mmc, bus_width(ecbw->cap));
-
-			if (mwt->mode == MMC_HS_400) {
-				err = mmc_select_hs400(mmc);
-				if (err) {
-					printf("Select HS400 failed %d\n", err);
-					goto error;
-				}
-			} else {
-				/* configure the bus speed (card) */
-				err = mmc_set_card_speed(mmc, mwt->mode, false);
-				if (err)
-					goto error;
-
-				/*
-				 * configure the bus width AND the ddr mode
-				 * (card). The host side will be taken care
-				 * of in the next step
-				 */
-				if (ecbw->ext_csd_bits & EXT_CSD_DDR_FLAG) {
-					err = mmc_switch(mmc,
-							 EXT_CSD_CMD_SET_NORMAL,
-							 EXT_CSD_BUS_WIDTH,
-							 ecbw->ext_csd_bits);
-					if (err)
-						goto error;
-				}
-
-				/* configure the bus mode (host) */
-				mmc_select_mode(mmc, mwt->mode);
-				mmc_set_clock(mmc, mmc->tran_speed,
-					      MMC_CLK_ENABLE);
-#ifdef MMC_SUPPORTS_TUNING
-
-				/* execute tuning if needed */
-				if (mwt->tuning) {
-					err = mmc_execute_tuning(mmc,
-								 mwt->tuning);
-					if (err) {
-						pr_debug("tuning failed\n");
-						goto error;
-					}
-				}
+			err = mmc_try_mode_and_width(mmc, mwt, ecbw);
+			if (!err) {
+#ifdef CONFIG_MMC_MODE_CACHE
+				mmc_mode_cache_save(mmc, mwt, ecbw);
 #endif
-			}
-
-			/* do a transfer to check the configuration */
-			err = mmc_read_and_compare_ext_csd(mmc);
-			if (!err)
 				return 0;
-error:
-			mmc_set_signal_voltage(mmc, old_voltage);
-			/* if an error occured, revert to a safer bus mode */
-			mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL,
-				   EXT_CSD_BUS_WIDTH, EXT_CSD_BUS_WIDTH_1);
-			mmc_select_mode(mmc, MMC_LEGACY);
-			mmc_set_bus_width(mmc, 1);
+			}
 		}
 	}
 
@@ -2267,6 +2410,10 @@ static int mmc_startup(struct mmc *mmc)
 	}
 #endif
 
+	/* An adopted card is in transfer state, with its CID and CSD known */
+	if (mmc->adopted)
+		goto identified;
+
 	/* Put the Card in Identify Mode */
 	cmd.cmdidx = mmc_host_is_spi(mmc) ? MMC_CMD_SEND_CID :
 		MMC_CMD_ALL_SEND_CID; /* cmd not supported in spi */
@@ -2329,8 +2476,9 @@ static int mmc_startup(struct mmc *mmc)
 	mmc->csd[2] = cmd.response[2];
 	mmc->csd[3] = cmd.response[3];
 
+identified:
 	if (mmc->version == MMC_VERSION_UNKNOWN) {
-		int version = (cmd.response[0] >> 26) & 0xf;
+		int version = (mmc->csd[0] >> 26) & 0xf;
 
 		switch (version) {
 		case 0:
@@ -2355,20 +2503,20 @@ static int mmc_startup(struct mmc *mmc)
 	}
 
 	/* divide frequency by 10, since the mults are 10x bigger */
-	freq = fbase[(cmd.response[0] & 0x7)];
-	mult = multipliers[((cmd.response[0] >> 3) & 0xf)];
+	freq = fbase[(mmc->csd[0] & 0x7)];
+	mult = multipliers[((mmc->csd[0] >> 3) & 0xf)];
 
 	mmc->legacy_speed = freq * mult;
-	mmc_select_mode(mmc, MMC_LEGACY);
+	mmc_select_mode(mmc, mmc->adopted ? mmc->selected_mode : MMC_LEGACY);
 
-	mmc->dsr_imp = ((cmd.response[1] >> 12) & 0x1);
-	mmc->read_bl_len = 1 << ((cmd.response[1] >> 16) & 0xf);
+	mmc->dsr_imp = ((mmc->csd[1] >> 12) & 0x1);
+	mmc->read_bl_len = 1 << ((mmc->csd[1] >> 16) & 0xf);
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 
 	if (IS_SD(mmc))
 		mmc->write_bl_len = mmc->read_bl_len;
 	else
-		mmc->write_bl_len = 1 << ((cmd.response[3] >> 22) & 0xf);
+		mmc->write_bl_len = 1 << ((mmc->csd[3] >> 22) & 0xf);
 #endif
 
 	if (mmc->high_capacity) {
@@ -2396,7 +2544,7 @@ static int mmc_startup(struct mmc *mmc)
 		mmc->write_bl_len = MMC_MAX_BLOCK_LEN;
 #endif
 
-	if ((mmc->dsr_imp) && (0xffffffff != mmc->dsr)) {
+	if ((mmc->dsr_imp) && (0xffffffff != mmc->dsr) && !mmc->adopted) {
 		cmd.cmdidx = MMC_CMD_SET_DSR;
 		cmd.cmdarg = (mmc->dsr & 0xffff) << 16;
 		cmd.resp_type = MMC_RSP_NONE;
@@ -2405,7 +2553,7 @@ static int mmc_startup(struct mmc *mmc)
 	}
 
 	/* Select the card, and put it into Transfer Mode */
-	if (!mmc_host_is_spi(mmc)) { /* cmd not supported in spi */
+	if (!mmc_host_is_spi(mmc) && !mmc->adopted) { /* not supported in spi */
 		cmd.cmdidx = MMC_CMD_SELECT_CARD;
 		cmd.resp_type = MMC_RSP_R1;
 		cmd.cmdarg = mmc->rca << 16;
@@ -2427,6 +2575,11 @@ static int mmc_startup(struct mmc *mmc)
 	if (err)
 		return err;
 
+	/* SPL may have left the card in another partition */
+	if (mmc->adopted && mmc->part_config != MMCPART_NOAVAILABLE)
+		mmc_get_blk_desc(mmc)->hwpart =
+			mmc->part_config & PART_ACCESS_MASK;
+
 	err = mmc_set_capacity(mmc, mmc_get_blk_desc(mmc)->hwpart);
 	if (err)
 		return err;
@@ -2440,12 +2593,17 @@ static int mmc_startup(struct mmc *mmc)
 		err = sd_get_capabilities(mmc);
 		if (err)
 			return err;
-		err = sd_select_mode_and_width(mmc, mmc->card_caps);
+		if (!mmc->adopted)
+			err = sd_select_mode_and_width(mmc, mmc->card_caps);
 	} else {
 		err = mmc_get_capabilities(mmc);
 		if (err)
 			return err;
-		mmc_select_mode_and_width(mmc, mmc->card_caps);
+		if (mmc->adopted)
+			/* check that the bus works in the adopted mode */
+			err = mmc_read_and_compare_ext_csd(mmc);
+		else
+			mmc_select_mode_and_width(mmc, mmc->card_caps);
 	}
 #endif
 	if (err)
@@ -2701,6 +2859,139 @@ retry:
 	return err;
 }
 
+#if CONFIG_IS_ENABLED(MMC_HANDOFF)
+#ifdef CONFIG_SPL_BUILD
+/* Record the card for U-Boot proper, in the state it is in now */
+static void mmc_handoff_save(struct mmc *mmc)
+{
+	struct mmc_handoff_card *card = NULL;
+	struct mmc_handoff *ho;
+	int i;
+
+	if (mmc_host_is_spi(mmc))
+		return;
+	ho = bloblist_find(BLOBLISTT_MMC_HANDOFF, sizeof(*ho));
+	if (!ho) {
+		ho = bloblist_add(BLOBLISTT_MMC_HANDOFF, sizeof(*ho));
+		if (!ho)
+			return;
+		memset(ho, '\0', sizeof(*ho));
+	}
+	for (i = 0; i < MMC_HANDOFF_CARDS; i++) {
+		if (!strncmp(ho->card[i].name, mmc->cfg->name,
+			     sizeof(ho->card[i].name))) {
+			card = &ho->card[i];
+			break;
+		}
+		if (!card && !ho->card[i].name[0])
+			card = &ho->card[i];
+	}
+	if (!card)
+		return;
+
+	memset(card, '\0', sizeof(*card));
+	strlcpy(card->name, mmc->cfg->name, sizeof(card->name));
+	memcpy(card->cid, mmc->cid, sizeof(card->cid));
+	memcpy(card->csd, mmc->csd, sizeof(card->csd));
+	card->ocr = mmc->ocr;
+	card->version = mmc->version;
+	card->high_capacity = mmc->high_capacity;
+	card->rca = mmc->rca;
+	card->mode = mmc->selected_mode;
+	card->bus_width = mmc->bus_width;
+	card->signal_voltage = mmc->signal_voltage;
+	card->clock = mmc->clock;
+}
+#else
+/*
+ * Take over a card which SPL left in transfer state: set the host to the bus
+ * mode of the card and check that it answers. mmc_startup() then skips the
+ * identification of the card, and falls back to a full init if the bus does
+ * not work.
+ */
+static int mmc_handoff_adopt(struct mmc *mmc)
+{
+	struct mmc_handoff_card *card = NULL;
+	struct mmc_handoff *ho;
+	struct mmc_cmd cmd;
+	int i, err;
+
+	ho = bloblist_find(BLOBLISTT_MMC_HANDOFF, sizeof(*ho));
+	if (!ho)
+		return -ENOENT;
+	for (i = 0; i < MMC_HANDOFF_CARDS; i++) {
+		if (!strncmp(ho->card[i].name, mmc->cfg->name,
+			     sizeof(ho->card[i].name)))
+			card = &ho->card[i];
+	}
+	if (!card || !card->name[0])
+		return -ENOENT;
+	/* Only used once, a later init starts from scratch */
+	card->name[0] = '\0';
+
+	/* Tuning is not possible in HS400 mode */
+	if (card->mode == MMC_HS_400)
+		return -ENOTSUPP;
+
+	err = mmc_power_init(mmc);
+	if (err)
+		return err;
+
+#ifdef CONFIG_MMC_QUIRKS
+	mmc->quirks = MMC_QUIRK_RETRY_SET_BLOCKLEN |
+		      MMC_QUIRK_RETRY_SEND_CID;
+#endif
+	memcpy(mmc->cid, card->cid, sizeof(mmc->cid));
+	memcpy(mmc->csd, card->csd, sizeof(mmc->csd));
+	mmc->ocr = card->ocr;
+	mmc->version = card->version;
+	mmc->high_capacity = card->high_capacity;
+	mmc->rca = card->rca;
+	mmc->ddr_mode = 0;
+
+	mmc_set_signal_voltage(mmc, card->signal_voltage);
+	mmc_select_mode(mmc, card->mode);
+	mmc_set_bus_width(mmc, card->bus_width);
+	mmc_set_clock(mmc, card->clock, MMC_CLK_ENABLE);
+
+#ifdef MMC_SUPPORTS_TUNING
+	if (card->mode == MMC_HS_200 || card->mode == UHS_SDR104) {
+		err = mmc_execute_tuning(mmc, card->mode == MMC_HS_200 ?
+					 MMC_CMD_SEND_TUNING_BLOCK_HS200 :
+					 MMC_CMD_SEND_TUNING_BLOCK);
+		if (err)
+			goto err;
+	}
+#endif
+
+	cmd.cmdidx = MMC_CMD_SEND_STATUS;
+	cmd.resp_type = MMC_RSP_R1;
+	cmd.cmdarg = mmc->rca << 16;
+	err = mmc_send_cmd(mmc, &cmd, NULL);
+	if (err)
+		goto err;
+	if ((cmd.response[0] & MMC_STATUS_CURR_STATE) != MMC_STATE_TRANS) {
+		err = -EBUSY;
+		goto err;
+	}
+
+	mmc->adopted = true;
+	pr_debug("%s: adopted card %04x in mode %s\n", mmc->cfg->name,
+		 mmc->rca, mmc_mode_name(card->mode));
+
+	return 0;
+
+err:
+	pr_debug("%s: can't adopt card: %d\n", mmc->cfg->name, err);
+	mmc->version = MMC_VERSION_UNKNOWN;
+	mmc->high_capacity = 0;
+	mmc->rca = 0;
+
+	return err;
+}
+#endif
+#endif
+
 int mmc_start_init(struct mmc *mmc)
 {
 	bool no_card;
@@ -2730,6 +3021,14 @@ int mmc_start_init(struct mmc *mmc)
 		return -ENOMEDIUM;
 	}
 
+	mmc->adopted = false;
+#if CONFIG_IS_ENABLED(MMC_HANDOFF) && !defined(CONFIG_SPL_BUILD)
+	if (!mmc_handoff_adopt(mmc)) {
+		mmc->init_in_progress = 1;
+		return 0;
+	}
+#endif
+
 	err = mmc_get_op_cond(mmc);
 
 	if (!err)
@@ -2748,6 +3047,16 @@ static int mmc_complete_init(struct mmc *mmc)
 
 	if (!err)
 		err = mmc_startup(mmc);
+	if (err && mmc->adopted) {
+		pr_debug("%s: adopted card failed (%d), resetting it\n",
+			 __func__, err);
+		mmc->adopted = false;
+		err = mmc_get_op_cond(mmc);
+		if (!err && mmc->op_cond_pending)
+			err = mmc_complete_op_cond(mmc);
+		if (!err)
+			err = mmc_startup(mmc);
+	}
 	if (err)
 		mmc->has_init = 0;
 	else
@@ -2776,6 +3085,10 @@ int mmc_init(struct mmc *mmc)
 		err = mmc_complete_init(mmc);
 	if (err)
 		pr_info("%s: %d, time %lu\n", __func__, err, get_timer(start));
+#if CONFIG_IS_ENABLED(MMC_HANDOFF) && defined(CONFIG_SPL_BUILD)
+	else
+		mmc_handoff_save(mmc);
+#endif
 
 	return err;
 }
@@ -14,7 +14,8 @@
 #include <linux/math64.h>
 #include "mmc_private.h"
 
-static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt)
+static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt,
+			 uint arg)
 {
 	struct mmc_cmd cmd;
 	ulong end;
@@ -51,7 +52,7 @@ static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt)
 		goto err_out;
 
 	cmd.cmdidx = MMC_CMD_ERASE;
-	cmd.cmdarg = MMC_ERASE_ARG;
+	cmd.cmdarg = IS_SD(mmc) ? MMC_ERASE_ARG : arg;
 	cmd.resp_type = MMC_RSP_R1b;
 
 	err = mmc_send_cmd(mmc, &cmd, NULL);
@@ -65,15 +66,32 @@ err_out:
 	return err;
 }
 
-#if CONFIG_IS_ENABLED(BLK)
-ulong mmc_berase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
-#else
-ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
-#endif
+bool mmc_can_trim(struct mmc *mmc, u32 *fillp)
+{
+	bool ones;
+
+	if (IS_SD(mmc)) {
+		ones = mmc->scr[0] & SD_DATA_STAT_AFTER_ERASE;
+	} else {
+		if (!mmc->ext_csd || !(mmc->ext_csd[EXT_CSD_SEC_FEATURE_SUPPORT] &
+				       EXT_CSD_SEC_GB_CL_EN))
+			return false;
+		ones = mmc->ext_csd[EXT_CSD_ERASED_MEM_CONT];
+	}
+	*fillp = ones ? 0xffffffff : 0;
+
+	return true;
+}
+
+bool mmc_can_discard(struct mmc *mmc)
+{
+	/* DISCARD is mandatory from eMMC 4.5 on */
+	return !IS_SD(mmc) && mmc->ext_csd && mmc->ext_csd[EXT_CSD_REV] >= 6;
+}
+
+ulong mmc_berase_arg(struct blk_desc *block_dev, lbaint_t start,
+		     lbaint_t blkcnt, uint arg)
 {
-#if CONFIG_IS_ENABLED(BLK)
-	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
-#endif
 	int dev_num = block_dev->devnum;
 	int err = 0;
 	u32 start_rem, blkcnt_rem;
@@ -96,7 +114,7 @@ ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
 	 */
 	err = div_u64_rem(start, mmc->erase_grp_size, &start_rem);
 	err = div_u64_rem(blkcnt, mmc->erase_grp_size, &blkcnt_rem);
-	if (start_rem || blkcnt_rem)
+	if (arg == MMC_ERASE_ARG && (start_rem || blkcnt_rem))
 		printf("\n\nCaution! Your devices Erase group is 0x%x\n"
 		       "The erase range would be change to "
 		       "0x" LBAF "~0x" LBAF "\n\n",
@@ -112,7 +130,7 @@ ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
 			blk_r = ((blkcnt - blk) > mmc->erase_grp_size) ?
 				mmc->erase_grp_size : (blkcnt - blk);
 		}
-		err = mmc_erase_t(mmc, start + blk, blk_r);
+		err = mmc_erase_t(mmc, start + blk, blk_r, arg);
 		if (err)
 			break;
 
@@ -126,12 +144,48 @@ ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
 	return blk;
 }
 
+#if CONFIG_IS_ENABLED(BLK)
+ulong mmc_berase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
+#else
+ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
+#endif
+{
+#if CONFIG_IS_ENABLED(BLK)
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+#endif
+
+	return mmc_berase_arg(block_dev, start, blkcnt, MMC_ERASE_ARG);
+}
+
+/*
+ * Tell an SD card how many blocks the next multiple block write covers
+ * (ACMD23), so that it can erase them beforehand instead of one by one as
+ * they arrive. This is only a hint: a card that refuses it is written to
+ * all the same.
+ */
+static void mmc_sd_pre_erase(struct mmc *mmc, lbaint_t blkcnt)
+{
+	struct mmc_cmd cmd;
+
+	cmd.cmdidx = MMC_CMD_APP_CMD;
+	cmd.cmdarg = mmc->rca << 16;
+	cmd.resp_type = MMC_RSP_R1;
+	if (mmc_send_cmd(mmc, &cmd, NULL))
+		return;
+
+	/* The count has 23 bits */
+	cmd.cmdidx = SD_CMD_APP_SET_WR_BLK_ERASE_COUNT;
+	cmd.cmdarg = min_t(lbaint_t, blkcnt, 0x7fffff);
+	mmc_send_cmd(mmc, &cmd, NULL);
+}
+
 static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 		lbaint_t blkcnt, const void *src)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
 	int timeout = 1000;
+	int predefined;
 
 	if ((start + blkcnt) > mmc_get_blk_desc(mmc)->lba) {
 		printf("MMC: block number 0x" LBAF " exceeds max(0x" LBAF ")\n",
@@ -141,7 +195,18 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 
 	if (blkcnt == 0)
 		return 0;
-	else if (blkcnt == 1)
+
+	predefined = mmc_set_block_count(mmc, blkcnt);
+	if (predefined < 0) {
+		printf("mmc fail to set block count\n");
+		return 0;
+	}
+
+	/* With CMD23 the card knows the length of the write already */
+	if (IS_SD(mmc) && !mmc_host_is_spi(mmc) && blkcnt > 1 && !predefined)
+		mmc_sd_pre_erase(mmc, blkcnt);
+
+	if (blkcnt == 1)
 		cmd.cmdidx = MMC_CMD_WRITE_SINGLE_BLOCK;
 	else
 		cmd.cmdidx = MMC_CMD_WRITE_MULTIPLE_BLOCK;
@@ -166,7 +231,7 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 	/* SPI multiblock writes terminate using a special
 	 * token, not a STOP_TRANSMISSION request.
 	 */
-	if (!mmc_host_is_spi(mmc) && blkcnt > 1) {
+	if (!mmc_host_is_spi(mmc) && blkcnt > 1 && !predefined) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
@@ -67,6 +67,68 @@ static void sdhci_transfer_pio(struct sdhci_host *host, struct mmc_data *data)
 	}
 }
 
+#ifdef CONFIG_MMC_SDHCI_ADMA
+static void sdhci_adma_write_desc(struct sdhci_adma_desc *desc,
+				  dma_addr_t addr, u32 len, bool end)
+{
+	u8 attr = ADMA_DESC_ATTR_VALID | ADMA_DESC_TRANSFER_DATA;
+
+	if (end)
+		attr |= ADMA_DESC_ATTR_END;
+	desc->attr = attr;
+	desc->reserved = 0;
+	desc->len = cpu_to_le16(len);
+	desc->addr_lo = cpu_to_le32(lower_32_bits(addr));
+#ifdef CONFIG_DMA_ADDR_T_64BIT
+	desc->addr_hi = cpu_to_le32(upper_32_bits(addr));
+#endif
+}
+
+/*
+ * Describe the whole transfer in the descriptor table and point the host at
+ * it. Returns false, for PIO to be used, if the buffer is not aligned for
+ * ADMA2.
+ */
+static bool sdhci_prepare_adma(struct sdhci_host *host, void *buf,
+			       unsigned int trans_bytes)
+{
+	struct sdhci_adma_desc *desc = host->adma_desc_table;
+	dma_addr_t addr = (unsigned long)buf;
+	unsigned int len;
+	u8 ctrl;
+
+	if (!desc || (addr & (ADMA_ADDR_ALIGN - 1)))
+		return false;
+
+	flush_cache(addr, ALIGN(trans_bytes, CONFIG_SYS_CACHELINE_SIZE));
+	while (trans_bytes) {
+		len = min_t(unsigned int, trans_bytes, ADMA_MAX_LEN);
+		trans_bytes -= len;
+		sdhci_adma_write_desc(desc++, addr, len, !trans_bytes);
+		addr += len;
+	}
+	flush_cache((unsigned long)host->adma_desc_table,
+		    ALIGN((void *)desc - (void *)host->adma_desc_table,
+			  CONFIG_SYS_CACHELINE_SIZE));
+
+	addr = (unsigned long)host->adma_desc_table;
+	sdhci_writel(host, lower_32_bits(addr), SDHCI_ADMA_ADDRESS);
+#ifdef CONFIG_DMA_ADDR_T_64BIT
+	sdhci_writel(host, upper_32_bits(addr), SDHCI_ADMA_ADDRESS_HI);
+#endif
+
+	ctrl = sdhci_readb(host, SDHCI_HOST_CONTROL);
+	ctrl &= ~SDHCI_CTRL_DMA_MASK;
+	if (IS_ENABLED(CONFIG_DMA_ADDR_T_64BIT))
+		ctrl |= SDHCI_CTRL_ADMA64;
+	else
+		ctrl |= SDHCI_CTRL_ADMA32;
+	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
+
+	return true;
+}
+#endif
+
 static int sdhci_transfer_data(struct sdhci_host *host, struct mmc_data *data,
 				unsigned int start_addr)
 {
@@ -244,6 +306,12 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 
 		sdhci_writel(host, start_addr, SDHCI_DMA_ADDRESS);
 		mode |= SDHCI_TRNS_DMA;
+#endif
+#ifdef CONFIG_MMC_SDHCI_ADMA
+		if (sdhci_prepare_adma(host, data->flags == MMC_DATA_READ ?
+				       data->dest : (void *)data->src,
+				       trans_bytes))
+			mode |= SDHCI_TRNS_DMA;
 #endif
 		sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG,
 				data->blocksize),
@@ -598,6 +666,20 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 		       __func__);
 		return -EINVAL;
 	}
+#endif
+#ifdef CONFIG_MMC_SDHCI_ADMA
+	if (!(caps & SDHCI_CAN_DO_ADMA2) ||
+	    (IS_ENABLED(CONFIG_DMA_ADDR_T_64BIT) && !(caps & SDHCI_CAN_64BIT))) {
+		printf("%s: Your controller doesn't support ADMA2!!\n",
+		       __func__);
+		return -EINVAL;
+	}
+	if (!host->adma_desc_table) {
+		host->adma_desc_table = memalign(ARCH_DMA_MINALIGN,
+						 ADMA_TABLE_SZ);
+		if (!host->adma_desc_table)
+			return -ENOMEM;
+	}
 #endif
 	if (host->quirks & SDHCI_QUIRK_REG32_RW)
 		host->version =
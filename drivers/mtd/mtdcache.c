@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Small page cache sitting between mtd_read() and the NAND drivers.
+ *
+ * UBI attach, UBIFS mount and JFFS2 scanning keep re-reading the same
+ * handful of pages (EC/VID headers, master node, index and LPT nodes).
+ * Each of those reads costs a full array load plus ECC correction on
+ * NAND, so keep the last few pages around and serve repeated reads
+ * from RAM instead.
+ *
+ * Entries are keyed on the master device and the absolute page offset,
+ * so a page read through a partition and through the master device is
+ * cached once. Every entry carries a CRC32 of its data which is checked
+ * on each hit, a mismatch drops the entry and the page is read again.
+ * Writes and erases going through the mtd_* API invalidate the pages
+ * they touch.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <u-boot/crc.h>
+#include <linux/errno.h>
+#include <linux/compat.h>
+#include <linux/mtd/mtd.h>
+#include <linux/mtd/partitions.h>
+#include "mtdcore.h"
+
+/* Reads spanning more pages than this are bulk loads, don't cache them */
+#define MTD_CACHE_MAX_READ_PAGES	4
+
+struct mtd_cache_entry {
+	struct mtd_info *master;
+	loff_t page;
+	u32 size;
+	u32 crc;
+	ulong stamp;
+	u8 *buf;
+};
+
+static struct mtd_cache_entry mtd_cache[CONFIG_MTD_PAGE_CACHE_PAGES];
+static ulong mtd_cache_clock;
+
+static struct mtd_info *mtd_cache_master(struct mtd_info *mtd, loff_t *ofs)
+{
+	while (mtd->parent) {
+		*ofs += mtd->offset;
+		mtd = mtd->parent;
+	}
+
+	return mtd;
+}
+
+static bool mtd_cache_usable(struct mtd_info *mtd, struct mtd_info *master,
+			     loff_t delta, loff_t from, size_t len)
+{
+	u32 npages;
+
+	if (mtd->type != MTD_NANDFLASH && mtd->type != MTD_MLCNANDFLASH)
+		return false;
+	if (!mtd->_read || !master->writesize)
+		return false;
+
+	/* Partition must start on a page boundary to read whole pages */
+	if (mtd_mod_by_ws(delta, master))
+		return false;
+
+	npages = mtd_div_by_ws(from + len - 1, mtd) - mtd_div_by_ws(from, mtd);
+
+	return npages < MTD_CACHE_MAX_READ_PAGES;
+}
+
+static struct mtd_cache_entry *mtd_cache_find(struct mtd_info *master,
+					      loff_t page)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mtd_cache); i++) {
+		if (mtd_cache[i].master == master &&
+		    mtd_cache[i].page == page)
+			return &mtd_cache[i];
+	}
+
+	return NULL;
+}
+
+static struct mtd_cache_entry *mtd_cache_alloc(struct mtd_info *master,
+					       loff_t page)
+{
+	struct mtd_cache_entry *e = &mtd_cache[0];
+	int i;
+
+	/* Prefer a free slot, otherwise evict the least recently used one */
+	for (i = 0; i < ARRAY_SIZE(mtd_cache); i++) {
+		if (!mtd_cache[i].master) {
+			e = &mtd_cache[i];
+			break;
+		}
+		if (mtd_cache[i].stamp < e->stamp)
+			e = &mtd_cache[i];
+	}
+
+	e->master = NULL;
+	if (e->buf && e->size != master->writesize) {
+		free(e->buf);
+		e->buf = NULL;
+	}
+	if (!e->buf) {
+		e->buf = malloc(master->writesize);
+		if (!e->buf)
+			return NULL;
+		e->size = master->writesize;
+	}
+
+	e->page = page;
+
+	return e;
+}
+
+/**
+ * mtd_cache_read - Serve a read from the page cache
+ * @mtd: MTD device or partition the read was issued on
+ * @from: offset in @mtd
+ * @len: number of bytes to read
+ * @retlen: number of bytes actually read
+ * @buf: destination buffer
+ *
+ * Pages missing from the cache are read in full through @mtd->_read and
+ * added to the cache, unless the driver reported an error or as many
+ * bitflips as the device's bitflip threshold; in that case nothing is
+ * cached and the caller is asked to do a plain read, so error reporting
+ * is exactly the same as without the cache.
+ *
+ * Returns the maximum number of bitflips corrected on the pages read
+ * from the flash, or -EAGAIN if the read must go to the driver.
+ */
+int mtd_cache_read(struct mtd_info *mtd, loff_t from, size_t len,
+		   size_t *retlen, u_char *buf)
+{
+	struct mtd_info *master;
+	loff_t abs = from, delta = 0;
+	size_t done = 0;
+	int max_bitflips = 0;
+
+	master = mtd_cache_master(mtd, &delta);
+	abs += delta;
+
+	if (!mtd_cache_usable(mtd, master, delta, from, len))
+		return -EAGAIN;
+
+	while (done < len) {
+		struct mtd_cache_entry *e;
+		loff_t page = abs - mtd_mod_by_ws(abs, master);
+		u32 col = abs - page;
+		size_t n = min_t(size_t, len - done, master->writesize - col);
+
+		e = mtd_cache_find(master, page);
+		if (e && crc32(0, e->buf, e->size) != e->crc) {
+			e->master = NULL;
+			e = NULL;
+			mtd->cache_stats.crc_errors++;
+		}
+
+		if (e) {
+			mtd->cache_stats.hits++;
+		} else {
+			size_t rlen = 0;
+			int ret;
+
+			mtd->cache_stats.misses++;
+
+			e = mtd_cache_alloc(master, page);
+			if (!e)
+				return -EAGAIN;
+
+			ret = mtd->_read(mtd, page - delta, e->size, &rlen,
+					 e->buf);
+			if (ret < 0 || rlen != e->size ||
+			    (mtd->ecc_strength &&
+			     ret >= mtd->bitflip_threshold))
+				return -EAGAIN;
+
+			e->crc = crc32(0, e->buf, e->size);
+			e->master = master;
+			max_bitflips = max(max_bitflips, ret);
+		}
+
+		e->stamp = ++mtd_cache_clock;
+		memcpy(buf + done, e->buf + col, n);
+		done += n;
+		abs += n;
+	}
+
+	*retlen = done;
+
+	return max_bitflips;
+}
+
+/**
+ * mtd_cache_invalidate - Drop cached pages overlapping a range
+ * @mtd: MTD device or partition being written or erased
+ * @ofs: offset in @mtd
+ * @len: length of the range, in bytes
+ */
+void mtd_cache_invalidate(struct mtd_info *mtd, loff_t ofs, u64 len)
+{
+	struct mtd_info *master;
+	loff_t start = ofs, end;
+	int i;
+
+	master = mtd_cache_master(mtd, &start);
+	end = start + len;
+	if (master->writesize)
+		start -= mtd_mod_by_ws(start, master);
+
+	for (i = 0; i < ARRAY_SIZE(mtd_cache); i++) {
+		struct mtd_cache_entry *e = &mtd_cache[i];
+
+		if (e->master != master || e->page < start || e->page >= end)
+			continue;
+
+		e->master = NULL;
+		mtd->cache_stats.invalidated++;
+	}
+}
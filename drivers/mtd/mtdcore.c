@@ -559,6 +559,7 @@ int del_mtd_device(struct mtd_info *mtd)
 #endif
 
 		idr_remove(&mtd_idr, mtd->index);
+		mtd_cache_invalidate(mtd, 0, mtd->size);
 
 		module_put(THIS_MODULE);
 		ret = 0;
@@ -890,6 +891,7 @@ int mtd_erase(struct mtd_info *mtd, struct erase_info *instr)
 		mtd_erase_callback(instr);
 		return 0;
 	}
+	mtd_cache_invalidate(mtd, instr->addr, instr->len);
 	return mtd->_erase(mtd, instr);
 }
 EXPORT_SYMBOL_GPL(mtd_erase);
@@ -960,6 +962,10 @@ int mtd_read(struct mtd_info *mtd, loff_t from, size_t len, size_t *retlen,
 	 * representing the maximum number of bitflips that were corrected on
 	 * any one ecc region (if applicable; zero otherwise).
 	 */
+	ret_code = mtd_cache_read(mtd, from, len, retlen, buf);
+	if (ret_code != -EAGAIN)
+		goto out;
+
 	if (mtd->_read) {
 		ret_code = mtd->_read(mtd, from, len, retlen, buf);
 	} else if (mtd->_read_oob) {
@@ -974,6 +980,7 @@ int mtd_read(struct mtd_info *mtd, loff_t from, size_t len, size_t *retlen,
 		return -ENOTSUPP;
 	}
 
+out:
 	if (unlikely(ret_code < 0))
 		return ret_code;
 	if (mtd->ecc_strength == 0)
@@ -994,6 +1001,8 @@ int mtd_write(struct mtd_info *mtd, loff_t to, size_t len, size_t *retlen,
 	if (!len)
 		return 0;
 
+	mtd_cache_invalidate(mtd, to, len);
+
 	if (!mtd->_write) {
 		struct mtd_oob_ops ops = {
 			.len = len,
@@ -1029,6 +1038,7 @@ int mtd_panic_write(struct mtd_info *mtd, loff_t to, size_t len, size_t *retlen,
 		return -EROFS;
 	if (!len)
 		return 0;
+	mtd_cache_invalidate(mtd, to, len);
 	return mtd->_panic_write(mtd, to, len, retlen, buf);
 }
 EXPORT_SYMBOL_GPL(mtd_panic_write);
@@ -1117,6 +1127,9 @@ int mtd_write_oob(struct mtd_info *mtd, loff_t to,
 	if (!mtd->_write_oob && (!mtd->_write || ops->oobbuf))
 		return -EOPNOTSUPP;
 
+	if (ops->datbuf)
+		mtd_cache_invalidate(mtd, to, ops->len);
+
 	if (mtd->_write_oob)
 		return mtd->_write_oob(mtd, to, ops);
 	else
@@ -1633,6 +1646,8 @@ int mtd_block_markbad(struct mtd_info *mtd, loff_t ofs)
 		return -EINVAL;
 	if (!(mtd->flags & MTD_WRITEABLE))
 		return -EROFS;
+	mtd_cache_invalidate(mtd, ofs - mtd_mod_by_eb(ofs, mtd),
+			     mtd->erasesize);
 	return mtd->_block_markbad(mtd, ofs);
 }
 EXPORT_SYMBOL_GPL(mtd_block_markbad);
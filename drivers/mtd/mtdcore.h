@@ -15,3 +15,20 @@ int parse_mtd_partitions(struct mtd_info *master, const char * const *types,
 
 int __init init_mtdchar(void);
 void __exit cleanup_mtdchar(void);
+
+#ifdef CONFIG_MTD_PAGE_CACHE
+int mtd_cache_read(struct mtd_info *mtd, loff_t from, size_t len,
+		   size_t *retlen, u_char *buf);
+void mtd_cache_invalidate(struct mtd_info *mtd, loff_t ofs, u64 len);
+#else
+static inline int mtd_cache_read(struct mtd_info *mtd, loff_t from,
+				 size_t len, size_t *retlen, u_char *buf)
+{
+	return -EAGAIN;
+}
+
+static inline void mtd_cache_invalidate(struct mtd_info *mtd, loff_t ofs,
+					u64 len)
+{
+}
+#endif
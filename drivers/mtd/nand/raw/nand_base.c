@@ -1687,6 +1687,35 @@ static int nand_setup_read_retry(struct mtd_info *mtd, int retry_mode)
  *
  * Internal function. Called with chip held.
  */
+/**
+ * nand_cache_read_last - [INTERN] find the end of a cache read sequence
+ * @mtd: MTD device structure
+ * @ops: oob ops structure
+ * @realpage: first page of the sequence, read as a whole page
+ * @readlen: number of bytes left to read, starting at @realpage
+ *
+ * Returns the last page that can be streamed with READ CACHE SEQUENTIAL
+ * after @realpage, or -1 if the remaining pages should be read one by one.
+ * The sequence is kept within one erase block since not all chips can
+ * stream across a block (and plane) boundary.
+ */
+static int nand_cache_read_last(struct mtd_info *mtd,
+				struct mtd_oob_ops *ops, int realpage,
+				uint32_t readlen)
+{
+	struct nand_chip *chip = mtd_to_nand(mtd);
+	int ppb = 1 << (chip->phys_erase_shift - chip->page_shift);
+	int last;
+
+	if (!NAND_HAS_CACHERD(chip) || ops->oobbuf)
+		return -1;
+
+	last = realpage + (readlen >> chip->page_shift) - 1;
+	last = min(last, realpage | (ppb - 1));
+
+	return last > realpage ? last : -1;
+}
+
 static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 			    struct mtd_oob_ops *ops)
 {
@@ -1702,6 +1731,7 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 	unsigned int max_bitflips = 0;
 	int retry_mode = 0;
 	bool ecc_fail = false;
+	int cache_last = -1;
 
 	chipnr = (int)(from >> chip->chip_shift);
 	chip->select_chip(mtd, chipnr);
@@ -1739,9 +1769,31 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 						 __func__, buf);
 
 read_retry:
-			if (nand_standard_page_accessors(&chip->ecc))
+			if (cache_last >= 0) {
+				/*
+				 * The page was loaded while the previous one
+				 * was transferred; move it to the cache
+				 * register and start loading the next one.
+				 */
+				if (realpage == cache_last) {
+					chip->cmdfunc(mtd, NAND_CMD_READCACHEEND,
+						      -1, -1);
+					cache_last = -1;
+				} else {
+					chip->cmdfunc(mtd, NAND_CMD_READCACHESEQ,
+						      -1, -1);
+				}
+			} else if (nand_standard_page_accessors(&chip->ecc)) {
 				chip->cmdfunc(mtd, NAND_CMD_READ0, 0x00, page);
 
+				if (aligned && !retry_mode)
+					cache_last = nand_cache_read_last(mtd,
+							ops, realpage, readlen);
+				if (cache_last >= 0)
+					chip->cmdfunc(mtd, NAND_CMD_READCACHESEQ,
+						      -1, -1);
+			}
+
 			/*
 			 * Now read the page into the buffer.  Absent an error,
 			 * the read methods return max bitflips per ecc step.
@@ -1801,6 +1853,13 @@ read_retry:
 
 			if (mtd->ecc_stats.failed - ecc_failures) {
 				if (retry_mode + 1 < chip->read_retries) {
+					/* Retries go back to plain page reads */
+					if (cache_last >= 0) {
+						chip->cmdfunc(mtd,
+							NAND_CMD_READCACHEEND,
+							-1, -1);
+						cache_last = -1;
+					}
 					retry_mode++;
 					ret = nand_setup_read_retry(mtd,
 							retry_mode);
@@ -1850,6 +1909,10 @@ read_retry:
 			chip->select_chip(mtd, chipnr);
 		}
 	}
+
+	/* Terminate a cache read sequence cut short by an error */
+	if (cache_last >= 0)
+		chip->cmdfunc(mtd, NAND_CMD_READCACHEEND, -1, -1);
 	chip->select_chip(mtd, -1);
 
 	ops->retlen = ops->len - (size_t) readlen;
@@ -4565,6 +4628,22 @@ int nand_scan_tail(struct mtd_info *mtd)
 		break;
 	}
 
+	/*
+	 * Use READ CACHE SEQUENTIAL for ONFI chips that advertise it, as long
+	 * as the page accessors are the generic ones that only move data
+	 * after the core has issued the read command.
+	 */
+	if (chip->onfi_version &&
+	    (le16_to_cpu(chip->onfi_params.opt_cmd) &
+	     ONFI_OPT_CMD_READ_CACHE) &&
+	    chip->cmdfunc == nand_command_lp &&
+	    nand_standard_page_accessors(ecc) &&
+	    (ecc->read_page == nand_read_page_hwecc ||
+	     ecc->read_page == nand_read_page_swecc ||
+	     ecc->read_page == nand_read_page_raw) &&
+	    ecc->read_page_raw == nand_read_page_raw)
+		chip->options |= NAND_CACHERD;
+
 	/* Fill in remaining MTD driver data */
 	mtd->type = nand_is_slc(chip) ? MTD_NANDFLASH : MTD_MLCNANDFLASH;
 	mtd->flags = (chip->options & NAND_ROM) ? MTD_CAP_ROM :
@@ -530,6 +530,83 @@ static int spinand_read_page(struct spinand_device *spinand,
 	return spinand_check_ecc_status(spinand, status);
 }
 
+/*
+ * Return the number of whole pages, starting at @iter, that can be read with
+ * a single continuous read, or 0 if the current page should be read alone.
+ */
+static unsigned int spinand_cont_read_pages(struct spinand_device *spinand,
+					    const struct nand_io_iter *iter)
+{
+	struct spi_mem_op op = *spinand->op_templates.read_cache;
+	struct nand_device *nand = spinand_to_nand(spinand);
+	unsigned int page_size = nanddev_page_size(nand);
+	unsigned int npages;
+
+	if (iter->req.dataoffs || iter->req.ooblen)
+		return 0;
+
+	/* Never stream across an eraseblock */
+	npages = nanddev_pages_per_eraseblock(nand) - iter->req.pos.page;
+	npages = min(npages, iter->dataleft / page_size);
+	if (npages < 2)
+		return 0;
+
+	/* Bad blocks are read page by page, like before */
+	if (nanddev_isbad(nand, &iter->req.pos))
+		return 0;
+
+	/*
+	 * Releasing CS ends a continuous read, so the whole run has to fit in
+	 * one operation of the controller.
+	 */
+	op.data.nbytes = npages * page_size;
+	if (spi_mem_adjust_op_size(spinand->slave, &op))
+		return 0;
+
+	npages = op.data.nbytes / page_size;
+
+	return npages < 2 ? 0 : npages;
+}
+
+static int spinand_cont_read(struct spinand_device *spinand,
+			     const struct nand_page_io_req *req,
+			     unsigned int npages)
+{
+	struct spi_mem_op op = *spinand->op_templates.read_cache;
+	struct nand_device *nand = spinand_to_nand(spinand);
+	u16 column = 0;
+	u8 status;
+	int ret, ret2;
+
+	ret = spinand->set_cont_read(spinand, true);
+	if (ret)
+		return ret;
+
+	ret = spinand_load_page_op(spinand, req);
+	if (!ret)
+		ret = spinand_wait(spinand, &status);
+	if (!ret) {
+		spinand_cache_op_adjust_colum(spinand, req, &column);
+		op.addr.val = column;
+		op.data.buf.in = req->databuf.in;
+		op.data.nbytes = npages * nanddev_page_size(nand);
+		ret = spi_mem_exec_op(spinand->slave, &op);
+	}
+
+	ret2 = spinand->set_cont_read(spinand, false);
+	if (ret)
+		return ret;
+	if (ret2)
+		return ret2;
+
+	/* The ECC status now covers every page of the run */
+	ret = spinand_read_status(spinand, &status);
+	if (ret)
+		return ret;
+
+	return spinand_check_ecc_status(spinand, status);
+}
+
 static int spinand_write_page(struct spinand_device *spinand,
 			      const struct nand_page_io_req *req)
 {
@@ -564,11 +641,16 @@ static int spinand_mtd_read(struct mtd_info *mtd, loff_t from,
 	struct nand_io_iter iter;
 	bool enable_ecc = false;
 	bool ecc_failed = false;
+	bool cont_read;
+	unsigned int npages;
 	int ret = 0;
 
 	if (ops->mode != MTD_OPS_RAW && spinand->eccinfo.ooblayout)
 		enable_ecc = true;
 
+	/* Continuous reads rely on the on-die ECC and carry no OOB data */
+	cont_read = enable_ecc && spinand->set_cont_read && !ops->ooblen;
+
 #ifndef __UBOOT__
 	mutex_lock(&spinand->lock);
 #endif
@@ -582,7 +664,18 @@ static int spinand_mtd_read(struct mtd_info *mtd, loff_t from,
 		if (ret)
 			break;
 
-		ret = spinand_read_page(spinand, &iter.req, enable_ecc);
+		npages = cont_read ? spinand_cont_read_pages(spinand, &iter) : 0;
+		if (npages) {
+			ret = spinand_cont_read(spinand, &iter.req, npages);
+			if (ret == -EBADMSG) {
+				/* Go back to page mode to find the bad page */
+				cont_read = false;
+				npages = 0;
+			}
+		}
+
+		if (!npages)
+			ret = spinand_read_page(spinand, &iter.req, enable_ecc);
 		if (ret < 0 && ret != -EBADMSG)
 			break;
 
@@ -597,6 +690,12 @@ static int spinand_mtd_read(struct mtd_info *mtd, loff_t from,
 
 		ops->retlen += iter.req.datalen;
 		ops->oobretlen += iter.req.ooblen;
+
+		/* Skip the pages read along with this one */
+		while (npages-- > 1) {
+			nanddev_io_iter_next_page(nand, &iter);
+			ops->retlen += iter.req.datalen;
+		}
 	}
 
 #ifndef __UBOOT__
@@ -937,6 +1036,7 @@ int spinand_match_and_init(struct spinand_device *spinand,
 		spinand->eccinfo = table[i].eccinfo;
 		spinand->flags = table[i].flags;
 		spinand->select_target = table[i].select_target;
+		spinand->set_cont_read = table[i].set_cont_read;
 
 		op = spinand_select_op_variant(spinand,
 					       info->op_variants.read_cache);
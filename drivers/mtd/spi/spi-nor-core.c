@@ -34,6 +34,12 @@
 
 #define DEFAULT_READY_WAIT_JIFFIES		(40UL * HZ)
 
+/*
+ * For full-chip erase, calibrated to a 2MB flash (M25P16); should be scaled up
+ * for larger flash
+ */
+#define CHIP_ERASE_2MB_READY_WAIT_JIFFIES	(40UL * HZ)
+
 static int spi_nor_read_write_reg(struct spi_nor *nor, struct spi_mem_op
 		*op, void *buf)
 {
@@ -315,6 +321,8 @@ static u8 spi_nor_convert_3to4_erase(u8 opcode)
 static void spi_nor_set_4byte_opcodes(struct spi_nor *nor,
 				      const struct flash_info *info)
 {
+	int i;
+
 	/* Do some manufacturer fixups first */
 	switch (JEDEC_MFR(info)) {
 	case SNOR_MFR_SPANSION:
@@ -322,6 +330,7 @@ static void spi_nor_set_4byte_opcodes(struct spi_nor *nor,
 		/* No small sector erase for 4-byte command set */
 		nor->erase_opcode = SPINOR_OP_SE;
 		nor->mtd.erasesize = info->sector_size;
+		memset(nor->erase_types, 0, sizeof(nor->erase_types));
 		break;
 
 	default:
@@ -331,6 +340,16 @@ static void spi_nor_set_4byte_opcodes(struct spi_nor *nor,
 	nor->read_opcode = spi_nor_convert_3to4_read(nor->read_opcode);
 	nor->program_opcode = spi_nor_convert_3to4_program(nor->program_opcode);
 	nor->erase_opcode = spi_nor_convert_3to4_erase(nor->erase_opcode);
+
+	/* Drop the erase types which have no 4-byte address variant */
+	for (i = 0; i < SNOR_ERASE_TYPE_MAX; i++) {
+		struct spi_nor_erase_type *erase = &nor->erase_types[i];
+		u8 opcode = spi_nor_convert_3to4_erase(erase->opcode);
+
+		if (opcode == erase->opcode)
+			erase->size = 0;
+		erase->opcode = opcode;
+	}
 }
 #endif /* !CONFIG_SPI_FLASH_BAR */
 
@@ -543,10 +562,22 @@ static int read_bar(struct spi_nor *nor, const struct flash_info *info)
 }
 #endif
 
+/*
+ * Erase the whole flash memory
+ *
+ * Returns 0 if successful, non-zero otherwise.
+ */
+static int spi_nor_erase_chip(struct spi_nor *nor)
+{
+	dev_dbg(nor->dev, " %lldKiB\n", (long long)(nor->mtd.size >> 10));
+
+	return nor->write_reg(nor, SPINOR_OP_CHIP_ERASE, NULL, 0);
+}
+
 /*
  * Initiate the erasure of a single sector
  */
-static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
+static int spi_nor_erase_sector(struct spi_nor *nor, u8 opcode, u32 addr)
 {
 	u8 buf[SPI_NOR_MAX_ADDR_WIDTH];
 	int i;
@@ -563,12 +594,45 @@ static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
 		addr >>= 8;
 	}
 
-	return nor->write_reg(nor, nor->erase_opcode, buf, nor->addr_width);
+	return nor->write_reg(nor, opcode, buf, nor->addr_width);
+}
+
+/*
+ * Pick the largest erase type which is aligned on @addr and fits in @len,
+ * falling back to the default erase opcode and size.
+ */
+static u32 spi_nor_select_erase_type(struct spi_nor *nor, u32 addr, u32 len,
+				     u8 *opcode)
+{
+	struct mtd_info *mtd = &nor->mtd;
+	u32 size = mtd->erasesize;
+	int i;
+
+	*opcode = nor->erase_opcode;
+
+	/* A driver-specific erase hook only knows about the default opcode */
+	if (nor->erase)
+		return size;
+
+	for (i = 0; i < SNOR_ERASE_TYPE_MAX; i++) {
+		const struct spi_nor_erase_type *erase = &nor->erase_types[i];
+
+		if (erase->size <= size || erase->size > len ||
+		    erase->size % mtd->erasesize || addr % erase->size)
+			continue;
+
+		*opcode = erase->opcode;
+		size = erase->size;
+	}
+
+	return size;
 }
 
 /*
  * Erase an address range on the nor chip.  The address range may extend
- * one or more erase sectors.  Return an error is there is a problem erasing.
+ * one or more erase sectors and is covered with the fewest, largest erase
+ * commands the flash supports; the whole flash is erased with a single chip
+ * erase command.  Return an error is there is a problem erasing.
  */
 static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 {
@@ -586,20 +650,47 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 	addr = instr->addr;
 	len = instr->len;
 
+	if (len == mtd->size && !(nor->flags & SNOR_F_NO_OP_CHIP_ERASE)) {
+		unsigned long timeout;
+
+		write_enable(nor);
+
+		ret = spi_nor_erase_chip(nor);
+		if (ret)
+			goto erase_err;
+
+		/*
+		 * Scale the timeout linearly with the size of the flash, with
+		 * a minimum calibrated to an old 2MB flash. We could try to
+		 * pull these from CFI/SFDP, but these values should be good
+		 * enough for now.
+		 */
+		timeout = max(CHIP_ERASE_2MB_READY_WAIT_JIFFIES,
+			      CHIP_ERASE_2MB_READY_WAIT_JIFFIES *
+			      (unsigned long)div_u64(mtd->size, SZ_2M));
+		ret = spi_nor_wait_till_ready_with_timeout(nor, timeout);
+		goto erase_err;
+	}
+
 	while (len) {
+		u32 erasesize;
+		u8 opcode;
+
 #ifdef CONFIG_SPI_FLASH_BAR
 		ret = write_bar(nor, addr);
 		if (ret < 0)
 			return ret;
 #endif
+		erasesize = spi_nor_select_erase_type(nor, addr, len, &opcode);
+
 		write_enable(nor);
 
-		ret = spi_nor_erase_sector(nor, addr);
+		ret = spi_nor_erase_sector(nor, opcode, addr);
 		if (ret)
 			goto erase_err;
 
-		addr += mtd->erasesize;
-		len -= mtd->erasesize;
+		addr += erasesize;
+		len -= erasesize;
 
 		ret = spi_nor_wait_till_ready(nor);
 		if (ret)
@@ -2029,11 +2120,16 @@ static int spi_nor_parse_bfpt(struct spi_nor *nor,
 
 		erasesize = 1U << erasesize;
 		opcode = (half >> 8) & 0xff;
+		nor->erase_types[i].size = erasesize;
+		nor->erase_types[i].opcode = opcode;
 #ifdef CONFIG_MTD_SPI_NOR_USE_4K_SECTORS
+		/* Keep parsing the larger erase types for spi_nor_erase() */
+		if (mtd->erasesize == SZ_4K)
+			continue;
 		if (erasesize == SZ_4K) {
 			nor->erase_opcode = opcode;
 			mtd->erasesize = erasesize;
-			break;
+			continue;
 		}
 #endif
 		if (!mtd->erasesize || mtd->erasesize < erasesize) {
@@ -2174,6 +2270,11 @@ static int spi_nor_parse_sfdp(struct spi_nor *nor,
 		switch (SFDP_PARAM_HEADER_ID(param_header)) {
 		case SFDP_SECTOR_MAP_ID:
 			dev_info(dev, "non-uniform erase sector maps are not supported yet.\n");
+			/*
+			 * The BFPT erase types may not apply to every region,
+			 * stick to the default erase size.
+			 */
+			memset(nor->erase_types, 0, sizeof(nor->erase_types));
 			break;
 
 		default:
@@ -2282,6 +2383,7 @@ static int spi_nor_init_params(struct spi_nor *nor,
 	/* Override the parameters with data read from SFDP tables. */
 	nor->addr_width = 0;
 	nor->mtd.erasesize = 0;
+	memset(nor->erase_types, 0, sizeof(nor->erase_types));
 	if ((info->flags & (SPI_NOR_DUAL_READ | SPI_NOR_QUAD_READ)) &&
 	    !(info->flags & SPI_NOR_SKIP_SFDP)) {
 		struct spi_nor_flash_parameter sfdp_params;
@@ -2290,6 +2392,7 @@ static int spi_nor_init_params(struct spi_nor *nor,
 		if (spi_nor_parse_sfdp(nor, &sfdp_params)) {
 			nor->addr_width = 0;
 			nor->mtd.erasesize = 0;
+			memset(nor->erase_types, 0, sizeof(nor->erase_types));
 		} else {
 			memcpy(params, &sfdp_params, sizeof(*params));
 #ifdef CONFIG_SPI_FLASH_SPANSION
@@ -2298,6 +2401,9 @@ static int spi_nor_init_params(struct spi_nor *nor,
 				params->page_size = 256;
 				/* Reset erase size in case it is set to 4K from BFPT */
 				nor->mtd.erasesize = info->sector_size ;
+				/* 4K sectors only exist in the overlaid regions */
+				memset(nor->erase_types, 0,
+				       sizeof(nor->erase_types));
 				/* READ_FAST_4B (0Ch) requires mode cycles*/
 				params->reads[SNOR_CMD_READ_FAST].num_mode_clocks = 8;
 				/* PP_1_1_4 is not supported */
@@ -2445,9 +2551,89 @@ static int spi_nor_select_erase(struct spi_nor *nor,
 		nor->erase_opcode = SPINOR_OP_SE;
 		mtd->erasesize = info->sector_size;
 	}
+
+	/* Large ranges can still be erased a whole sector at a time */
+	nor->erase_types[0].size = info->sector_size;
+	nor->erase_types[0].opcode = SPINOR_OP_SE;
+
 	return 0;
 }
 
+/*
+ * spi_nor_spimem_check_op() - check whether the controller can run a read
+ * or page program command with the given protocol and dummy cycles.
+ */
+static bool spi_nor_spimem_check_op(struct spi_nor *nor, u8 opcode,
+				    enum spi_nor_protocol proto, u8 ndummy,
+				    enum spi_mem_data_dir dir)
+{
+	struct spi_mem_op op =
+			SPI_MEM_OP(SPI_MEM_OP_CMD(opcode, 1),
+				   SPI_MEM_OP_ADDR(nor->addr_width ?: 3, 0, 1),
+				   SPI_MEM_OP_NO_DUMMY,
+				   SPI_MEM_OP_DATA_IN(1, NULL, 1));
+
+	op.cmd.buswidth = spi_nor_get_protocol_inst_nbits(proto);
+	op.addr.buswidth = spi_nor_get_protocol_addr_nbits(proto);
+	op.dummy.buswidth = op.addr.buswidth;
+	op.data.buswidth = spi_nor_get_protocol_data_nbits(proto);
+	op.data.dir = dir;
+
+	/* spi-mem counts dummy bytes, the cycles must fill whole bytes */
+	if ((ndummy * op.dummy.buswidth) % 8)
+		return false;
+	op.dummy.nbytes = (ndummy * op.dummy.buswidth) / 8;
+
+	return spi_mem_supports_op(nor->spi, &op);
+}
+
+/*
+ * spi_nor_spimem_adjust_hwcaps() - drop the read and page program
+ * protocols the SPI controller cannot run, so that the selection below
+ * picks the fastest one it accepts.
+ */
+static void spi_nor_spimem_adjust_hwcaps(struct spi_nor *nor,
+					 const struct spi_nor_flash_parameter
+					 *params, u32 *hwcaps)
+{
+	const struct spi_nor_read_command *read;
+	const struct spi_nor_pp_command *pp;
+	u32 mask;
+	int cmd;
+
+	for (mask = *hwcaps & SNOR_HWCAPS_READ_MASK; mask; mask &= mask - 1) {
+		u32 cap = mask & -mask;
+
+		cmd = spi_nor_hwcaps_read2cmd(cap);
+		if (cmd < 0) {
+			*hwcaps &= ~cap;
+			continue;
+		}
+
+		read = &params->reads[cmd];
+		if (!spi_nor_spimem_check_op(nor, read->opcode, read->proto,
+					     read->num_mode_clocks +
+					     read->num_wait_states,
+					     SPI_MEM_DATA_IN))
+			*hwcaps &= ~cap;
+	}
+
+	for (mask = *hwcaps & SNOR_HWCAPS_PP_MASK; mask; mask &= mask - 1) {
+		u32 cap = mask & -mask;
+
+		cmd = spi_nor_hwcaps_pp2cmd(cap);
+		if (cmd < 0) {
+			*hwcaps &= ~cap;
+			continue;
+		}
+
+		pp = &params->page_programs[cmd];
+		if (!spi_nor_spimem_check_op(nor, pp->opcode, pp->proto, 0,
+					     SPI_MEM_DATA_OUT))
+			*hwcaps &= ~cap;
+	}
+}
+
 static int spi_nor_setup(struct spi_nor *nor, const struct flash_info *info,
 			 const struct spi_nor_flash_parameter *params,
 			 const struct spi_nor_hwcaps *hwcaps)
@@ -2462,12 +2648,10 @@ static int spi_nor_setup(struct spi_nor *nor, const struct flash_info *info,
 	 */
 	shared_mask = hwcaps->mask & params->hwcaps.mask;
 
-	/* SPI n-n-n protocols are not supported yet. */
+	/* SPI n-n-n and DTR protocols are not supported yet. */
 	ignored_mask = (SNOR_HWCAPS_READ_1_1_1_DTR |
-			SNOR_HWCAPS_READ_1_2_2 |
 			SNOR_HWCAPS_READ_1_2_2_DTR |
 			SNOR_HWCAPS_READ_2_2_2 |
-			SNOR_HWCAPS_READ_1_4_4 |
 			SNOR_HWCAPS_READ_1_4_4_DTR |
 			SNOR_HWCAPS_READ_4_4_4 |
 			SNOR_HWCAPS_READ_8_8_8 |
@@ -2480,6 +2664,9 @@ static int spi_nor_setup(struct spi_nor *nor, const struct flash_info *info,
 		shared_mask &= ~ignored_mask;
 	}
 
+	/* Keep only what the SPI controller can actually run. */
+	spi_nor_spimem_adjust_hwcaps(nor, params, &shared_mask);
+
 	/* Select the (Fast) Read command. */
 	err = spi_nor_select_read(nor, params, shared_mask);
 	if (err) {
@@ -815,7 +815,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		    int pnum, int *vid, unsigned long long *sqnum)
 {
 	long long uninitialized_var(ec);
-	int err, bitflips = 0, vol_id = -1, ec_err = 0;
+	int err, bitflips = 0, vol_id = -1, ec_err = 0, vid_err;
 
 	dbg_bld("scan PEB %d", pnum);
 
@@ -828,7 +828,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	err = ubi_io_read_hdrs(ubi, pnum, ech, vidh, &vid_err, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -909,9 +909,11 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		}
 	}
 
-	/* OK, we've done with the EC header, let's look at the VID header */
-
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidh, 0);
+	/*
+	 * OK, we've done with the EC header, let's look at the VID header,
+	 * which has been read together with it.
+	 */
+	err = vid_err;
 	if (err < 0)
 		return err;
 	switch (err) {
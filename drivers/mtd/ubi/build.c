@@ -1064,6 +1064,20 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 
 	spin_unlock(&ubi->wl_lock);
 
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	/*
+	 * We had to scan the whole device because there was no valid
+	 * fastmap. Write one now instead of waiting for the first pool
+	 * refill or detach, so that the next attach is fast.
+	 */
+	if (!ubi->fm_disabled && !ubi->fm && !ubi->ro_mode) {
+		err = ubi_update_fastmap(ubi);
+		if (err)
+			ubi_warn(ubi, "unable to write fastmap, error %d",
+				 err);
+	}
+#endif
+
 	ubi_devices[ubi_num] = ubi;
 	ubi_notify_all(ubi, UBI_VOLUME_ADDED, NULL);
 	return ubi_num;
@@ -167,6 +167,10 @@ static void tx_descs_init(struct dw_eth_dev *priv)
 	/* Correcting the last pointer of the chain */
 	desc_p->dmamac_next = (ulong)&desc_table_p[0];
 
+#ifdef CONFIG_NET_RX_LEND
+	memset(priv->rx_lent, '\0', sizeof(priv->rx_lent));
+#endif
+
 	/* Flush all Tx buffer descriptors at once */
 	flush_dcache_range((ulong)priv->tx_mac_descrtable,
 			   (ulong)priv->tx_mac_descrtable +
@@ -216,6 +220,57 @@ static void rx_descs_init(struct dw_eth_dev *priv)
 	priv->rx_currdescnum = 0;
 }
 
+#ifdef CONFIG_NET_RX_LEND
+/*
+ * Set up an RX descriptor before handing it back to the DMA. If a protocol
+ * lends a buffer, switch the descriptor from chained to ring mode so its
+ * second buffer pointer is free: the start of the frame then goes to our
+ * own buffer and the rest straight to the lent one. Buffer sizes must be
+ * multiples of the bus width, so the split may come a few bytes after the
+ * lender's header length.
+ */
+static void dw_rx_desc_refill(struct dw_eth_dev *priv, u32 desc_num)
+{
+	struct dmamacdescr *desc_table_p = &priv->rx_mac_descrtable[0];
+	struct dmamacdescr *desc_p = &desc_table_p[desc_num];
+	int hdr_len = 0, split, len;
+	uchar *data = NULL;
+
+	priv->rx_lent[desc_num] = NULL;
+	len = net_rx_lend(CONFIG_RX_DESCR_NUM - 1, &hdr_len, &data);
+	/* Keep off cache lines past the end of the lent buffer */
+	len = rounddown((ulong)data + len, ARCH_DMA_MINALIGN) - (ulong)data;
+	split = roundup(hdr_len, CONFIG_DW_GMAC_DMA_BUS_BYTES);
+	len -= split - hdr_len;
+	len = rounddown(min(len, MAC_MAX_FRAME_SZ),
+			CONFIG_DW_GMAC_DMA_BUS_BYTES);
+	if (!data || len <= 0 || split > MAC_MAX_FRAME_SZ ||
+	    !IS_ALIGNED((ulong)data, ARCH_DMA_MINALIGN)) {
+		desc_p->dmamac_next = (ulong)&desc_table_p[(desc_num + 1) %
+							   CONFIG_RX_DESCR_NUM];
+		desc_p->dmamac_cntl =
+			(MAC_MAX_FRAME_SZ & DESC_RXCTRL_SIZE1MASK) |
+				      DESC_RXCTRL_RXCHAIN;
+		return;
+	}
+
+	data += split - hdr_len;
+	priv->rx_lent[desc_num] = data;
+	priv->rx_lent_split[desc_num] = split;
+
+	/* Nothing of ours may be written back over what the DMA stores */
+	invalidate_dcache_range(rounddown((ulong)data, ARCH_DMA_MINALIGN),
+				roundup((ulong)data + len, ARCH_DMA_MINALIGN));
+
+	desc_p->dmamac_next = (ulong)data;
+	desc_p->dmamac_cntl =
+		((split << DESC_RXCTRL_SIZE1SHFT) & DESC_RXCTRL_SIZE1MASK) |
+		((len << DESC_RXCTRL_SIZE2SHFT) & DESC_RXCTRL_SIZE2MASK);
+	if (desc_num == CONFIG_RX_DESCR_NUM - 1)
+		desc_p->dmamac_cntl |= DESC_RXCTRL_RXRINGEND;
+}
+#endif
+
 static int _dw_write_hwaddr(struct dw_eth_dev *priv, u8 *mac_id)
 {
 	struct eth_mac_regs *mac_p = priv->mac_regs_p;
@@ -309,7 +364,14 @@ int designware_eth_init(struct dw_eth_dev *priv, u8 *enetaddr)
 	rx_descs_init(priv);
 	tx_descs_init(priv);
 
+#ifdef CONFIG_NET_RX_LEND
+	/* Lent RX descriptors are in ring mode, skip the alignment padding */
+	writel(FIXEDBURST | PRIORXTX_41 | DMA_PBL |
+	       DMA_DSL((sizeof(struct dmamacdescr) - 16) /
+		       CONFIG_DW_GMAC_DMA_BUS_BYTES), &dma_p->busmode);
+#else
 	writel(FIXEDBURST | PRIORXTX_41 | DMA_PBL, &dma_p->busmode);
+#endif
 
 #ifndef CONFIG_DW_MAC_FORCE_THRESHOLD_MODE
 	writel(readl(&dma_p->opmode) | FLUSHTXFIFO | STOREFORWARD,
@@ -421,36 +483,104 @@ static int _dw_eth_send(struct dw_eth_dev *priv, void *packet, int length)
 	return 0;
 }
 
+/* Inspect an invalidated RX descriptor, and the packet when it has one */
+static int dw_rx_desc_read(struct dw_eth_dev *priv, u32 desc_num,
+			   struct eth_rx_pkt *pkt)
+{
+	struct dmamacdescr *desc_p = &priv->rx_mac_descrtable[desc_num];
+	u32 status = desc_p->txrx_status;
+	ulong data_start = desc_p->dmamac_addr;
+	ulong data_end;
+	int length;
+
+	/* Check  if the owner is the CPU */
+	if (status & DESC_RXSTS_OWNBYDMA)
+		return -EAGAIN;
+
+	length = (status & DESC_RXSTS_FRMLENMSK) >> DESC_RXSTS_FRMLENSHFT;
+
+	/* Invalidate received data */
+	data_end = data_start + roundup(length, ARCH_DMA_MINALIGN);
+	invalidate_dcache_range(data_start, data_end);
+	pkt->packet = (uchar *)(ulong)desc_p->dmamac_addr;
+	pkt->len = length;
+	pkt->split_hdr_len = 0;
+	pkt->split_data = NULL;
+	pkt->csum_ok = false;
+
+#ifdef CONFIG_NET_RX_LEND
+	if (priv->rx_lent[desc_num]) {
+		uchar *data = priv->rx_lent[desc_num];
+		u32 split = priv->rx_lent_split[desc_num];
+
+		/* A frame too long for both buffers: drop its parts */
+		if ((status & (DESC_RXSTS_RXFIRST | DESC_RXSTS_RXLAST)) !=
+		    (DESC_RXSTS_RXFIRST | DESC_RXSTS_RXLAST)) {
+			pkt->len = 0;
+			return 0;
+		}
+		if (length > split) {
+			invalidate_dcache_range(
+				rounddown((ulong)data, ARCH_DMA_MINALIGN),
+				roundup((ulong)data + length - split,
+					ARCH_DMA_MINALIGN));
+			pkt->split_hdr_len = split;
+			pkt->split_data = data;
+		}
+	}
+#endif
+
+	return length;
+}
+
 static int _dw_eth_recv(struct dw_eth_dev *priv, uchar **packetp)
 {
-	u32 status, desc_num = priv->rx_currdescnum;
+	u32 desc_num = priv->rx_currdescnum;
 	struct dmamacdescr *desc_p = &priv->rx_mac_descrtable[desc_num];
-	int length = -EAGAIN;
 	ulong desc_start = (ulong)desc_p;
 	ulong desc_end = desc_start +
 		roundup(sizeof(*desc_p), ARCH_DMA_MINALIGN);
-	ulong data_start = desc_p->dmamac_addr;
-	ulong data_end;
+	struct eth_rx_pkt pkt;
+	int length;
 
 	/* Invalidate entire buffer descriptor */
 	invalidate_dcache_range(desc_start, desc_end);
 
-	status = desc_p->txrx_status;
+	length = dw_rx_desc_read(priv, desc_num, &pkt);
+	if (length >= 0) {
+		*packetp = pkt.packet;
+		length = pkt.len;
+		net_rx_set_split(pkt.split_hdr_len, pkt.split_data);
+	}
 
-	/* Check  if the owner is the CPU */
-	if (!(status & DESC_RXSTS_OWNBYDMA)) {
+	return length;
+}
+
+#ifdef CONFIG_DM_ETH
+/*
+ * Take all the frames the DMA has finished with, invalidating the whole
+ * descriptor table once rather than descriptor by descriptor
+ */
+static int _dw_eth_recv_batch(struct dw_eth_dev *priv,
+			      struct eth_rx_pkt *pkts, int max)
+{
+	ulong desc_start = (ulong)priv->rx_mac_descrtable;
+	ulong desc_end = desc_start + sizeof(priv->rx_mac_descrtable);
+	int count;
+
+	invalidate_dcache_range(desc_start, desc_end);
 
-		length = (status & DESC_RXSTS_FRMLENMSK) >>
-			 DESC_RXSTS_FRMLENSHFT;
+	for (count = 0; count < min(max, CONFIG_RX_DESCR_NUM); count++) {
+		u32 desc_num = (priv->rx_currdescnum + count) %
+			       CONFIG_RX_DESCR_NUM;
 
-		/* Invalidate received data */
-		data_end = data_start + roundup(length, ARCH_DMA_MINALIGN);
-		invalidate_dcache_range(data_start, data_end);
-		*packetp = (uchar *)(ulong)desc_p->dmamac_addr;
+		if (dw_rx_desc_read(priv, desc_num, &pkts[count]) < 0)
+			break;
 	}
 
-	return length;
+	return count ? count : -EAGAIN;
 }
+#endif
 
 static int _dw_free_pkt(struct dw_eth_dev *priv)
 {
@@ -460,6 +590,10 @@ static int _dw_free_pkt(struct dw_eth_dev *priv)
 	ulong desc_end = desc_start +
 		roundup(sizeof(*desc_p), ARCH_DMA_MINALIGN);
 
+#ifdef CONFIG_NET_RX_LEND
+	dw_rx_desc_refill(priv, desc_num);
+#endif
+
 	/*
 	 * Make the current descriptor valid again and go to
 	 * the next one
@@ -477,6 +611,35 @@ static int _dw_free_pkt(struct dw_eth_dev *priv)
 	return 0;
 }
 
+#ifdef CONFIG_DM_ETH
+static int _dw_free_batch(struct dw_eth_dev *priv, int count)
+{
+	struct eth_dma_regs *dma_p = priv->dma_regs_p;
+	ulong desc_start = (ulong)priv->rx_mac_descrtable;
+	ulong desc_end = desc_start + sizeof(priv->rx_mac_descrtable);
+	u32 desc_num = priv->rx_currdescnum;
+
+	while (count--) {
+#ifdef CONFIG_NET_RX_LEND
+		dw_rx_desc_refill(priv, desc_num);
+#endif
+		priv->rx_mac_descrtable[desc_num].txrx_status |=
+			DESC_RXSTS_OWNBYDMA;
+		if (++desc_num >= CONFIG_RX_DESCR_NUM)
+			desc_num = 0;
+	}
+	priv->rx_currdescnum = desc_num;
+
+	/* Flush all Rx buffer descriptors at once */
+	flush_dcache_range(desc_start, desc_end);
+
+	/* Resume reception if the DMA ran out of descriptors */
+	writel(POLL_DATA, &dma_p->rxpolldemand);
+
+	return 0;
+}
+#endif
+
 static int dw_phy_init(struct dw_eth_dev *priv, void *dev)
 {
 	struct phy_device *phydev;
@@ -640,6 +803,21 @@ int designware_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 	return _dw_free_pkt(priv);
 }
 
+int designware_eth_recv_batch(struct udevice *dev, int flags,
+			      struct eth_rx_pkt *pkts, int max)
+{
+	struct dw_eth_dev *priv = dev_get_priv(dev);
+
+	return _dw_eth_recv_batch(priv, pkts, max);
+}
+
+int designware_eth_free_batch(struct udevice *dev, int count)
+{
+	struct dw_eth_dev *priv = dev_get_priv(dev);
+
+	return _dw_free_batch(priv, count);
+}
+
 void designware_eth_stop(struct udevice *dev)
 {
 	struct dw_eth_dev *priv = dev_get_priv(dev);
@@ -791,6 +969,8 @@ const struct eth_ops designware_eth_ops = {
 	.send			= designware_eth_send,
 	.recv			= designware_eth_recv,
 	.free_pkt		= designware_eth_free_pkt,
+	.recv_batch		= designware_eth_recv_batch,
+	.free_batch		= designware_eth_free_batch,
 	.stop			= designware_eth_stop,
 	.write_hwaddr		= designware_eth_write_hwaddr,
 };
@@ -94,9 +94,15 @@ struct eth_dma_regs {
 #define PRIORXTX_21		(1 << 14)
 #define PRIORXTX_11		(0 << 14)
 #define DMA_PBL			(CONFIG_DW_GMAC_DEFAULT_DMA_PBL<<8)
+#define DMA_DSL(x)		(((x) & 0x1f) << 2)
 #define RXHIGHPRIO		(1 << 1)
 #define DMAMAC_SRST		(1 << 0)
 
+/* DMA bus width, the unit of the descriptor skip length and buffer sizes */
+#ifndef CONFIG_DW_GMAC_DMA_BUS_BYTES
+#define CONFIG_DW_GMAC_DMA_BUS_BYTES	4
+#endif
+
 /* Poll demand definitions */
 #define POLL_DATA		(0xFFFFFFFF)
 
@@ -229,6 +235,11 @@ struct dw_eth_dev {
 	u32 max_speed;
 	u32 tx_currdescnum;
 	u32 rx_currdescnum;
+#ifdef CONFIG_NET_RX_LEND
+	/* Lent second buffer of each RX descriptor and where it starts */
+	uchar *rx_lent[CONFIG_RX_DESCR_NUM];
+	u32 rx_lent_split[CONFIG_RX_DESCR_NUM];
+#endif
 
 	struct eth_mac_regs *mac_regs_p;
 	struct eth_dma_regs *dma_regs_p;
@@ -263,6 +274,9 @@ int designware_eth_send(struct udevice *dev, void *packet, int length);
 int designware_eth_recv(struct udevice *dev, int flags, uchar **packetp);
 int designware_eth_free_pkt(struct udevice *dev, uchar *packet,
 				   int length);
+int designware_eth_recv_batch(struct udevice *dev, int flags,
+			      struct eth_rx_pkt *pkts, int max);
+int designware_eth_free_batch(struct udevice *dev, int count);
 void designware_eth_stop(struct udevice *dev);
 int designware_eth_write_hwaddr(struct udevice *dev);
 #endif
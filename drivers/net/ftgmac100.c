@@ -16,6 +16,7 @@
 #include <miiphy.h>
 #include <net.h>
 #include <wait_bit.h>
+#include <u-boot/crc.h>
 #include <linux/io.h>
 #include <linux/iopoll.h>
 #include <net/ncsi.h>
@@ -30,7 +31,7 @@
 #define FTGMAC100_RBSR_DEFAULT		0x640
 
 /* PKTBUFSTX/PKTBUFSRX must both be power of 2 */
-#define PKTBUFSTX	4	/* must be power of 2 */
+#define PKTBUFSTX	8	/* must be power of 2 */
 
 /* Timeout for transmit */
 #define FTGMAC100_TX_TIMEOUT_MS		1000
@@ -60,13 +61,18 @@ enum ftgmac100_model {
  * @iobase: The base address of the hardware registers
  * @txdes: The array of transmit descriptors
  * @rxdes: The array of receive descriptors
+ * @txbuf: A frame buffer for each transmit descriptor
  * @tx_index: Transmit descriptor index in @txdes
+ * @tx_clean: Index in @txdes of the oldest frame not yet reclaimed
+ * @tx_pending: Number of frames given to DMA and not yet reclaimed
  * @rx_index: Receive descriptor index in @rxdes
  * @phy_addr: The PHY interface address to use
  * @phydev: The PHY device backing the MAC
  * @bus: The mdio bus
  * @phy_mode: The mode of the PHY interface (rgmii, rmii, ...)
  * @max_speed: Maximum speed of Ethernet connection supported by MAC
+ * @csum_offload: The MAC checks and fills in IPv4, TCP and UDP checksums
+ * @maht: Multicast address hash table (MAHT0, MAHT1)
  * @clks: The bulk of clocks assigned to the device in the DT
  * @rxdes0_edorr_mask: The bit number identifying the end of the RX ring buffer
  * @txdes0_edotr_mask: The bit number identifying the end of the TX ring buffer
@@ -77,7 +83,10 @@ struct ftgmac100_data {
 
 	struct ftgmac100_txdes txdes[PKTBUFSTX];
 	struct ftgmac100_rxdes rxdes[PKTBUFSRX];
+	uchar txbuf[PKTBUFSTX][PKTSIZE_ALIGN] __aligned(ARCH_DMA_MINALIGN);
 	int tx_index;
+	int tx_clean;
+	int tx_pending;
 	int rx_index;
 
 	u32 phy_addr;
@@ -86,6 +95,8 @@ struct ftgmac100_data {
 	u32 phy_mode;
 	u32 max_speed;
 	bool ncsi_mode;
+	bool csum_offload;
+	u32 maht[2];
 
 	struct clk_bulk clks;
 
@@ -275,6 +286,60 @@ static int ftgmac100_set_mac(struct ftgmac100_data *priv,
 	return 0;
 }
 
+static u32 ftgmac100_read_txdesc(const void *desc)
+{
+	const struct ftgmac100_txdes *txdes = desc;
+	ulong des_start = (ulong)txdes;
+	ulong des_end = des_start + roundup(sizeof(*txdes), ARCH_DMA_MINALIGN);
+
+	invalidate_dcache_range(des_start, des_end);
+
+	return txdes->txdes0;
+}
+
+BUILD_WAIT_FOR_BIT(ftgmac100_txdone, u32, ftgmac100_read_txdesc)
+
+/*
+ * Take back the descriptors of the frames which have gone out, oldest
+ * first. This is done lazily, when a descriptor is needed or when the
+ * network stack hands back a receive buffer.
+ */
+static void ftgmac100_tx_reclaim(struct ftgmac100_data *priv)
+{
+	while (priv->tx_pending) {
+		struct ftgmac100_txdes *des = &priv->txdes[priv->tx_clean];
+
+		if (ftgmac100_read_txdesc(des) & FTGMAC100_TXDES0_TXDMA_OWN)
+			break;
+		priv->tx_clean = (priv->tx_clean + 1) % PKTBUFSTX;
+		priv->tx_pending--;
+	}
+}
+
+/* Wait for the oldest frame in flight to go out and reclaim it */
+static int ftgmac100_tx_wait(struct ftgmac100_data *priv)
+{
+	int rc;
+
+	rc = wait_for_bit_ftgmac100_txdone(&priv->txdes[priv->tx_clean],
+					   FTGMAC100_TXDES0_TXDMA_OWN, false,
+					   FTGMAC100_TX_TIMEOUT_MS, true);
+	if (rc)
+		return rc;
+	ftgmac100_tx_reclaim(priv);
+
+	return 0;
+}
+
+/* Wait for all the frames in flight to go out */
+static void ftgmac100_tx_drain(struct ftgmac100_data *priv)
+{
+	while (priv->tx_pending) {
+		if (ftgmac100_tx_wait(priv))
+			break;
+	}
+}
+
 /*
  * disable transmitter, receiver
  */
@@ -285,6 +350,8 @@ static void ftgmac100_stop(struct udevice *dev)
 
 	debug("%s()\n", __func__);
 
+	/* Let the frames still in flight go out */
+	ftgmac100_tx_drain(priv);
 	writel(0, &ftgmac100->maccr);
 
 	if (!priv->ncsi_mode)
@@ -316,10 +383,12 @@ static int ftgmac100_start(struct udevice *dev)
 
 	/* initialize descriptors */
 	priv->tx_index = 0;
+	priv->tx_clean = 0;
+	priv->tx_pending = 0;
 	priv->rx_index = 0;
 
 	for (i = 0; i < PKTBUFSTX; i++) {
-		priv->txdes[i].txdes3 = 0;
+		priv->txdes[i].txdes3 = (unsigned int)priv->txbuf[i];
 		priv->txdes[i].txdes0 = 0;
 	}
 	priv->txdes[PKTBUFSTX - 1].txdes0 = priv->txdes0_edotr_mask;
@@ -373,6 +442,12 @@ static int ftgmac100_start(struct udevice *dev)
 		FTGMAC100_MACCR_RX_RUNT |
 		FTGMAC100_MACCR_RX_BROADPKT;
 
+	/* multicast groups joined before */
+	writel(priv->maht[0], &ftgmac100->maht0);
+	writel(priv->maht[1], &ftgmac100->maht1);
+	if (priv->maht[0] || priv->maht[1])
+		maccr |= FTGMAC100_MACCR_HT_MULTI_EN;
+
 	writel(maccr, &ftgmac100->maccr);
 
 	ret = phy_startup(phydev);
@@ -408,9 +483,45 @@ static int ftgmac100_free_pkt(struct udevice *dev, uchar *packet, int length)
 	/* Move to next descriptor */
 	priv->rx_index = (priv->rx_index + 1) % PKTBUFSRX;
 
+	ftgmac100_tx_reclaim(priv);
+
 	return 0;
 }
 
+/* Test if the MAC checked a frame and found its checksums correct */
+static bool ftgmac100_rx_csum_ok(struct ftgmac100_data *priv, u32 rxdes1)
+{
+	u32 prot = rxdes1 & FTGMAC100_RXDES1_PROT_MASK;
+
+	if (!priv->csum_offload)
+		return false;
+	if (prot != FTGMAC100_RXDES1_PROT_TCPIP &&
+	    prot != FTGMAC100_RXDES1_PROT_UDPIP)
+		return false;
+
+	return !(rxdes1 & (FTGMAC100_RXDES1_TCP_CHKSUM_ERR |
+			   FTGMAC100_RXDES1_UDP_CHKSUM_ERR |
+			   FTGMAC100_RXDES1_IP_CHKSUM_ERR));
+}
+
+/* Have the MAC fill in the checksums of an IPv4 TCP or UDP frame */
+static u32 ftgmac100_tx_csum(struct ftgmac100_data *priv, uchar *packet,
+			     int length)
+{
+	struct ethernet_hdr *et = (struct ethernet_hdr *)packet;
+	struct ip_udp_hdr *ip = (struct ip_udp_hdr *)(packet + ETHER_HDR_SIZE);
+
+	if (!priv->csum_offload || length < ETHER_HDR_SIZE + IP_HDR_SIZE ||
+	    ntohs(et->et_protlen) != PROT_IP || ip->ip_hl_v != 0x45)
+		return 0;
+	if (ip->ip_p == IPPROTO_TCP)
+		return FTGMAC100_TXDES1_IP_CHKSUM | FTGMAC100_TXDES1_TCP_CHKSUM;
+	if (ip->ip_p == IPPROTO_UDP)
+		return FTGMAC100_TXDES1_IP_CHKSUM | FTGMAC100_TXDES1_UDP_CHKSUM;
+
+	return FTGMAC100_TXDES1_IP_CHKSUM;
+}
+
 /*
  * Get a data block via Ethernet
  */
@@ -447,22 +558,86 @@ static int ftgmac100_recv(struct udevice *dev, int flags, uchar **packetp)
 	data_end = data_start + roundup(rxlen, ARCH_DMA_MINALIGN);
 	invalidate_dcache_range(data_start, data_end);
 	*packetp = (uchar *)data_start;
+	net_rx_set_csum_ok(ftgmac100_rx_csum_ok(priv, curr_des->rxdes1));
 
 	return rxlen;
 }
 
-static u32 ftgmac100_read_txdesc(const void *desc)
+/*
+ * Get every data block the MAC has ready in one pass. The descriptor ring
+ * is invalidated once and the packet buffers once per contiguous run, and
+ * bad frames are returned with a zero length so they get recycled too.
+ */
+static int ftgmac100_recv_batch(struct udevice *dev, int flags,
+				struct eth_rx_pkt *pkts, int max)
 {
-	const struct ftgmac100_txdes *txdes = desc;
-	ulong des_start = (ulong)txdes;
-	ulong des_end = des_start + roundup(sizeof(*txdes), ARCH_DMA_MINALIGN);
+	struct ftgmac100_data *priv = dev_get_priv(dev);
+	ulong start = (ulong)&priv->rxdes[0];
+	ulong end = start + roundup(sizeof(priv->rxdes), ARCH_DMA_MINALIGN);
+	ulong run_start = 0, run_end = 0;
+	int count;
+
+	invalidate_dcache_range(start, end);
+
+	for (count = 0; count < min(max, PKTBUFSRX); count++) {
+		int index = (priv->rx_index + count) % PKTBUFSRX;
+		struct ftgmac100_rxdes *curr_des = &priv->rxdes[index];
+		u32 rxdes0 = curr_des->rxdes0;
+		ulong data_start = curr_des->rxdes3;
+
+		if (!(rxdes0 & FTGMAC100_RXDES0_RXPKT_RDY))
+			break;
+
+		pkts[count].packet = (uchar *)data_start;
+		pkts[count].split_hdr_len = 0;
+		pkts[count].split_data = NULL;
+		if (rxdes0 & (FTGMAC100_RXDES0_RX_ERR |
+			      FTGMAC100_RXDES0_CRC_ERR |
+			      FTGMAC100_RXDES0_FTL |
+			      FTGMAC100_RXDES0_RUNT |
+			      FTGMAC100_RXDES0_RX_ODD_NB)) {
+			pkts[count].len = 0;
+			continue;
+		}
+		pkts[count].len = FTGMAC100_RXDES0_VDBC(rxdes0);
+		pkts[count].csum_ok = ftgmac100_rx_csum_ok(priv,
+							   curr_des->rxdes1);
 
-	invalidate_dcache_range(des_start, des_end);
+		debug("%s(): RX buffer %d, %x received\n",
+		      __func__, index, pkts[count].len);
 
-	return txdes->txdes0;
+		if (data_start != run_end) {
+			if (run_end)
+				invalidate_dcache_range(run_start, run_end);
+			run_start = data_start;
+		}
+		run_end = data_start + roundup(pkts[count].len,
+					       ARCH_DMA_MINALIGN);
+	}
+	if (run_end)
+		invalidate_dcache_range(run_start, run_end);
+
+	return count ? count : -EAGAIN;
 }
 
-BUILD_WAIT_FOR_BIT(ftgmac100_txdone, u32, ftgmac100_read_txdesc)
+static int ftgmac100_free_batch(struct udevice *dev, int count)
+{
+	struct ftgmac100_data *priv = dev_get_priv(dev);
+	ulong start = (ulong)&priv->rxdes[0];
+	ulong end = start + roundup(sizeof(priv->rxdes), ARCH_DMA_MINALIGN);
+
+	/* Release all the buffers to DMA, then flush the ring once */
+	while (count--) {
+		priv->rxdes[priv->rx_index].rxdes0 &=
+			~FTGMAC100_RXDES0_RXPKT_RDY;
+		priv->rx_index = (priv->rx_index + 1) % PKTBUFSRX;
+	}
+	flush_dcache_range(start, end);
+
+	ftgmac100_tx_reclaim(priv);
+
+	return 0;
+}
 
 /*
  * Send a data block via Ethernet
@@ -479,21 +654,34 @@ static int ftgmac100_send(struct udevice *dev, void *packet, int length)
 	ulong data_end;
 	int rc;
 
-	invalidate_dcache_range(des_start, des_end);
-
-	if (curr_des->txdes0 & FTGMAC100_TXDES0_TXDMA_OWN) {
-		dev_err(dev, "no TX descriptor available\n");
-		return -EPERM;
-	}
-
 	debug("%s(%x, %x)\n", __func__, (int)packet, length);
 
-	length = (length < ETH_ZLEN) ? ETH_ZLEN : length;
+	if (length > PKTSIZE_ALIGN)
+		return -EINVAL;
+
+	ftgmac100_tx_reclaim(priv);
+	if (priv->tx_pending == PKTBUFSTX) {
+		rc = ftgmac100_tx_wait(priv);
+		if (rc) {
+			dev_err(dev, "no TX descriptor available\n");
+			return rc;
+		}
+	}
 
-	curr_des->txdes3 = (unsigned int)packet;
+	/*
+	 * The caller reuses its buffer as soon as this returns, so the frame
+	 * is copied to the descriptor's own buffer while the previous ones
+	 * are still going out
+	 */
+	data_start = curr_des->txdes3;
+	memcpy((void *)data_start, packet, length);
+	curr_des->txdes1 = ftgmac100_tx_csum(priv, packet, length);
+	if (length < ETH_ZLEN) {
+		memset((void *)data_start + length, '\0', ETH_ZLEN - length);
+		length = ETH_ZLEN;
+	}
 
 	/* Flush data to be sent */
-	data_start = curr_des->txdes3;
 	data_end = data_start + roundup(length, ARCH_DMA_MINALIGN);
 	flush_dcache_range(data_start, data_end);
 
@@ -510,16 +698,9 @@ static int ftgmac100_send(struct udevice *dev, void *packet, int length)
 	/* Start transmit */
 	writel(1, &ftgmac100->txpd);
 
-	rc = wait_for_bit_ftgmac100_txdone(curr_des,
-					   FTGMAC100_TXDES0_TXDMA_OWN, false,
-					   FTGMAC100_TX_TIMEOUT_MS, true);
-	if (rc)
-		return rc;
-
-	debug("%s(): packet sent\n", __func__);
-
-	/* Move to next descriptor */
+	/* Move to next descriptor, the frame is reclaimed later */
 	priv->tx_index = (priv->tx_index + 1) % PKTBUFSTX;
+	priv->tx_pending++;
 
 	return 0;
 }
@@ -587,6 +768,11 @@ static int ftgmac100_probe(struct udevice *dev)
 	phy_mode = dev_read_string(dev, "phy-mode");
 	priv->ncsi_mode = dev_read_bool(dev, "use-ncsi") ||
 		(phy_mode && strcmp(phy_mode, "NC-SI") == 0);
+	/* As in Linux, the checksum engine is not trusted with NC-SI */
+	priv->csum_offload = !priv->ncsi_mode &&
+		!dev_read_bool(dev, "no-hw-checksum");
+	if (priv->csum_offload)
+		pdata->features |= ETH_FEATURE_TX_CSUM;
 
 	priv->iobase = (struct ftgmac100 *)pdata->iobase;
 	priv->phy_mode = pdata->phy_interface;
@@ -636,12 +822,42 @@ static int ftgmac100_remove(struct udevice *dev)
 	return 0;
 }
 
+/*
+ * Receive frames sent to the multicast address @enetaddr. The MAC filters
+ * them with a 64-bit hash table, so frames for other groups sharing the
+ * bit get through as well and are dropped by the network stack.
+ */
+static int ftgmac100_mcast(struct udevice *dev, const u8 *enetaddr, int join)
+{
+	struct ftgmac100_data *priv = dev_get_priv(dev);
+	struct ftgmac100 *ftgmac100 = priv->iobase;
+	u32 hash;
+
+	hash = (~(crc32_no_comp(~0, enetaddr, ARP_HLEN) >> 2)) & 0x3f;
+	if (join)
+		priv->maht[hash / 32] |= BIT(hash % 32);
+	else
+		priv->maht[hash / 32] &= ~BIT(hash % 32);
+
+	writel(priv->maht[0], &ftgmac100->maht0);
+	writel(priv->maht[1], &ftgmac100->maht1);
+	if (priv->maht[0] || priv->maht[1])
+		setbits_le32(&ftgmac100->maccr, FTGMAC100_MACCR_HT_MULTI_EN);
+	else
+		clrbits_le32(&ftgmac100->maccr, FTGMAC100_MACCR_HT_MULTI_EN);
+
+	return 0;
+}
+
 static const struct eth_ops ftgmac100_ops = {
 	.start	= ftgmac100_start,
 	.send	= ftgmac100_send,
 	.recv	= ftgmac100_recv,
 	.stop	= ftgmac100_stop,
 	.free_pkt = ftgmac100_free_pkt,
+	.recv_batch = ftgmac100_recv_batch,
+	.free_batch = ftgmac100_free_batch,
+	.mcast	= ftgmac100_mcast,
 	.write_hwaddr = ftgmac100_write_hwaddr,
 };
 
@@ -13,6 +13,9 @@
 #define CONFIG_NETCONSOLE_BUFFER_SIZE 512
 #endif
 
+/* Largest UDP payload which fits in a (possibly VLAN tagged) frame */
+#define NC_OUTPUT_SIZE	(PKTSIZE - VLAN_ETHER_HDR_SIZE - IP_UDP_HDR_SIZE)
+
 static char input_buffer[CONFIG_NETCONSOLE_BUFFER_SIZE];
 static int input_size; /* char count in input buffer */
 static int input_offset; /* offset to valid chars in input buffer */
@@ -25,6 +28,9 @@ static short nc_out_port; /* target output port */
 static short nc_in_port; /* source input port */
 static const char *output_packet; /* used by first send udp */
 static int output_packet_len;
+static char output_buffer[NC_OUTPUT_SIZE]; /* output not sent yet */
+static int output_len;
+static ulong output_start; /* time of the oldest char in output_buffer */
 /*
  * Start with a default last protocol.
  * We are only interested in NETCONS or not.
@@ -243,40 +249,66 @@ static int nc_stdio_start(struct stdio_dev *dev)
 	return 0;
 }
 
-static void nc_stdio_putc(struct stdio_dev *dev, char c)
+void nc_flush(void)
 {
-	if (output_recursion)
+	if (!output_len || output_recursion)
 		return;
 	output_recursion = 1;
 
-	nc_send_packet(&c, 1);
+	nc_send_packet(output_buffer, output_len);
+	output_len = 0;
 
 	output_recursion = 0;
 }
 
-static void nc_stdio_puts(struct stdio_dev *dev, const char *s)
+static void nc_flush_if_due(void)
+{
+	if (output_len &&
+	    get_timer(output_start) >= CONFIG_NETCONSOLE_FLUSH_MS)
+		nc_flush();
+}
+
+/*
+ * Output is collected into packets as large as a frame allows. A packet
+ * is sent when it is full, or when its oldest char has waited for
+ * CONFIG_NETCONSOLE_FLUSH_MS and more output comes or input is polled.
+ */
+static void nc_write(const char *s, int len)
 {
-	int len;
+	int chunk;
 
 	if (output_recursion)
 		return;
-	output_recursion = 1;
 
-	len = strlen(s);
 	while (len) {
-		int send_len = min(len, (int)sizeof(input_buffer));
-		nc_send_packet(s, send_len);
-		len -= send_len;
-		s += send_len;
+		if (!output_len)
+			output_start = get_timer(0);
+		chunk = min(len, (int)NC_OUTPUT_SIZE - output_len);
+		memcpy(output_buffer + output_len, s, chunk);
+		output_len += chunk;
+		len -= chunk;
+		s += chunk;
+		if (output_len == NC_OUTPUT_SIZE)
+			nc_flush();
 	}
+	nc_flush_if_due();
+}
 
-	output_recursion = 0;
+static void nc_stdio_putc(struct stdio_dev *dev, char c)
+{
+	nc_write(&c, 1);
+}
+
+static void nc_stdio_puts(struct stdio_dev *dev, const char *s)
+{
+	nc_write(s, strlen(s));
 }
 
 static int nc_stdio_getc(struct stdio_dev *dev)
 {
 	uchar c;
 
+	nc_flush();
 	input_recursion = 1;
 
 	net_timeout = 0;	/* no timeout */
@@ -305,6 +337,7 @@ static int nc_stdio_tstc(struct stdio_dev *dev)
 	if (input_recursion)
 		return 0;
 
+	nc_flush_if_due();
 	if (input_size)
 		return 1;
 
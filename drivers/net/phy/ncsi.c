@@ -6,6 +6,7 @@
  */
 
 #include <common.h>
+#include <environment.h>
 #include <malloc.h>
 #include <phy.h>
 #include <net/ncsi.h>
@@ -29,14 +30,24 @@
 #define NCSI_CAP_AEN_MASK	0x07
 #define NCSI_CAP_VLAN_MASK	0x07
 
+/* Response timeouts, the short one is used to try the cached channel */
+#define NCSI_TIMEOUT_MS		1000
+#define NCSI_CACHE_TIMEOUT_MS	200
+
 static void ncsi_send_ebf(unsigned int np, unsigned int nc);
 static void ncsi_send_ae(unsigned int np, unsigned int nc);
 static void ncsi_send_gls(unsigned int np, unsigned int nc);
+static void ncsi_send_gvi(unsigned int np, unsigned int nc);
+static void ncsi_send_cis(unsigned int np, unsigned int nc);
+static void ncsi_send_sma(unsigned int np, unsigned int nc);
+static void ncsi_send_sp(unsigned int np);
+static void ncsi_send_dp(unsigned int np, bool wait);
 static int ncsi_send_command(unsigned int np, unsigned int nc, unsigned int cmd,
 			     uchar *payload, int len, bool wait);
 
 struct ncsi_channel {
 	unsigned int	id;
+	bool		present;
 	bool		has_link;
 
 	/* capabilities */
@@ -61,16 +72,34 @@ struct ncsi_channel {
 
 struct ncsi_package {
 	unsigned int		id;
-	unsigned int		n_channels;
-	struct ncsi_channel	*channels;
+	bool			present;
+	struct ncsi_channel	*channels;	/* NCSI_CHANNEL_MAX entries */
+};
+
+/*
+ * The last channel configured, and the identity of the NIC behind it. It is
+ * kept in the ncsi_channel environment variable so it can be tried first
+ * after a reset.
+ */
+struct ncsi_cache {
+	bool		valid;
+	unsigned int	package;
+	unsigned int	channel;
+	u32		mf_id;
+	u16		pci_ids[4];
 };
 
+/*
+ * Discovery sends Deselect Package to all the packages at once, then probes
+ * the channels of each package found in turn, again sending to all the
+ * channels at once. Each state waits for all its responses or a timeout.
+ */
 struct ncsi {
 	enum {
-		NCSI_PROBE_PACKAGE_SP,
-		NCSI_PROBE_PACKAGE_DP,
-		NCSI_PROBE_CHANNEL_SP,
-		NCSI_PROBE_CHANNEL,
+		NCSI_PROBE_CACHED,	/* trying the cached channel */
+		NCSI_PROBE_PACKAGE,	/* finding packages */
+		NCSI_PROBE_CHANNEL_SP,	/* selecting current_package */
+		NCSI_PROBE_CHANNEL,	/* finding its channels */
 		NCSI_CONFIG,
 	} state;
 
@@ -82,10 +111,11 @@ struct ncsi {
 	unsigned int	current_channel;
 
 	unsigned int		n_packages;
-	struct ncsi_package	*packages;
+	struct ncsi_package	packages[NCSI_PACKAGE_MAX];
 };
 
 struct ncsi *ncsi_priv;
+static struct ncsi_cache ncsi_cache;
 
 bool ncsi_active(void)
 {
@@ -101,9 +131,158 @@ bool ncsi_active(void)
 		return false;
 
 	return np < NCSI_PACKAGE_MAX && nc < NCSI_CHANNEL_MAX &&
+		ncsi_priv->packages[np].present &&
 		ncsi_priv->packages[np].channels[nc].has_link;
 }
 
+static bool ncsi_probing_channels(void)
+{
+	return ncsi_priv->state == NCSI_PROBE_CHANNEL ||
+		ncsi_priv->state == NCSI_PROBE_CACHED;
+}
+
+static struct ncsi_package *ncsi_add_package(unsigned int np)
+{
+	struct ncsi_package *package = &ncsi_priv->packages[np];
+
+	if (package->present)
+		return package;
+
+	debug("NCSI: adding new package %d\n", np);
+	package->channels = calloc(NCSI_CHANNEL_MAX,
+				   sizeof(struct ncsi_channel));
+	if (!package->channels) {
+		printf("NCSI: could not allocate memory for new package\n");
+		return NULL;
+	}
+	package->id = np;
+	package->present = true;
+	ncsi_priv->n_packages++;
+
+	return package;
+}
+
+static void ncsi_free_packages(void)
+{
+	int i;
+
+	for (i = 0; i < NCSI_PACKAGE_MAX; i++)
+		free(ncsi_priv->packages[i].channels);
+	memset(ncsi_priv->packages, '\0', sizeof(ncsi_priv->packages));
+	ncsi_priv->n_packages = 0;
+}
+
+/* Get the channel a response came from, if it is known */
+static struct ncsi_channel *ncsi_rsp_channel(struct ncsi_rsp_pkt_hdr *rsp)
+{
+	unsigned int np, nc;
+
+	np = NCSI_PACKAGE_INDEX(rsp->common.channel);
+	nc = NCSI_CHANNEL_INDEX(rsp->common.channel);
+
+	if (!ncsi_priv->packages[np].present || nc >= NCSI_CHANNEL_MAX ||
+	    !ncsi_priv->packages[np].channels[nc].present) {
+		printf("NCSI: Invalid package / channel (0x%02x, 0x%02x)\n",
+		       np, nc);
+		return NULL;
+	}
+
+	return &ncsi_priv->packages[np].channels[nc];
+}
+
+static bool ncsi_cache_match(void)
+{
+	struct ncsi_package *package = &ncsi_priv->packages[ncsi_cache.package];
+	struct ncsi_channel *c;
+
+	if (!package->present)
+		return false;
+	c = &package->channels[ncsi_cache.channel];
+
+	return c->present && c->has_link &&
+		c->version.mf_id == ncsi_cache.mf_id &&
+		!memcmp(c->version.pci_ids, ncsi_cache.pci_ids,
+			sizeof(ncsi_cache.pci_ids));
+}
+
+static void ncsi_cache_load(void)
+{
+	const char *s = env_get("ncsi_channel");
+	ulong val[7];
+	char *end;
+	int i;
+
+	if (!s)
+		return;
+	for (i = 0; i < ARRAY_SIZE(val); i++) {
+		val[i] = simple_strtoul(s, &end, 16);
+		if (end == s || *end != (i == ARRAY_SIZE(val) - 1 ? '\0' : ':'))
+			return;
+		s = end + 1;
+	}
+	if (val[0] >= NCSI_PACKAGE_MAX || val[1] >= NCSI_CHANNEL_MAX)
+		return;
+
+	ncsi_cache.package = val[0];
+	ncsi_cache.channel = val[1];
+	ncsi_cache.mf_id = val[2];
+	for (i = 0; i < ARRAY_SIZE(ncsi_cache.pci_ids); i++)
+		ncsi_cache.pci_ids[i] = val[3 + i];
+	ncsi_cache.valid = true;
+}
+
+static void ncsi_cache_save(void)
+{
+	unsigned int np = ncsi_priv->current_package;
+	unsigned int nc = ncsi_priv->current_channel;
+	struct ncsi_channel *c = &ncsi_priv->packages[np].channels[nc];
+	const char *old = env_get("ncsi_channel");
+	char buf[64];
+
+	ncsi_cache.package = np;
+	ncsi_cache.channel = nc;
+	ncsi_cache.mf_id = c->version.mf_id;
+	memcpy(ncsi_cache.pci_ids, c->version.pci_ids,
+	       sizeof(ncsi_cache.pci_ids));
+	ncsi_cache.valid = true;
+
+	snprintf(buf, sizeof(buf), "%x:%x:%x:%x:%x:%x:%x", np, nc,
+		 c->version.mf_id, c->version.pci_ids[0],
+		 c->version.pci_ids[1], c->version.pci_ids[2],
+		 c->version.pci_ids[3]);
+	if (!old || strcmp(old, buf))
+		env_set("ncsi_channel", buf);
+}
+
+static void ncsi_start_discovery(void)
+{
+	ncsi_free_packages();
+	ncsi_priv->state = NCSI_PROBE_PACKAGE;
+	ncsi_priv->current_package = NCSI_PACKAGE_MAX;
+	ncsi_priv->current_channel = NCSI_CHANNEL_MAX;
+
+	ncsi_probe_packages();
+}
+
+/* Probe the channels of the first package found from @first on */
+static void ncsi_probe_package_from(unsigned int first)
+{
+	unsigned int np;
+
+	for (np = first; np < NCSI_PACKAGE_MAX; np++)
+		if (ncsi_priv->packages[np].present)
+			break;
+
+	if (np < NCSI_PACKAGE_MAX) {
+		ncsi_priv->state = NCSI_PROBE_CHANNEL_SP;
+		ncsi_priv->current_package = np;
+	} else {
+		ncsi_priv->state = NCSI_CONFIG;
+	}
+
+	ncsi_probe_packages();
+}
+
 static unsigned int cmd_payload(int cmd)
 {
 	switch (cmd) {
@@ -223,13 +402,10 @@ static int ncsi_validate_rsp(struct ncsi_rsp_pkt *pkt, int payload)
 static void ncsi_rsp_ec(struct ncsi_rsp_pkt *pkt)
 {
 	struct ncsi_rsp_pkt_hdr *rsp = (struct ncsi_rsp_pkt_hdr *)&pkt->rsp;
-	unsigned int np, nc;
-
-	np = NCSI_PACKAGE_INDEX(rsp->common.channel);
-	nc = NCSI_CHANNEL_INDEX(rsp->common.channel);
+	struct ncsi_channel *c = ncsi_rsp_channel(rsp);
 
-	if (ncsi_priv->packages[np].channels[nc].cap_aen != 0)
-		ncsi_send_ae(np, nc);
+	if (c && c->cap_aen != 0)
+		ncsi_send_ae(NCSI_PACKAGE_INDEX(rsp->common.channel), c->id);
 	/* else, done */
 }
 
@@ -258,32 +434,21 @@ static void ncsi_rsp_ebf(struct ncsi_rsp_pkt *pkt)
 static void ncsi_rsp_sma(struct ncsi_rsp_pkt *pkt)
 {
 	struct ncsi_rsp_pkt_hdr *rsp = (struct ncsi_rsp_pkt_hdr *)&pkt->rsp;
-	unsigned int np, nc;
+	struct ncsi_channel *c = ncsi_rsp_channel(rsp);
 
-	np = NCSI_PACKAGE_INDEX(rsp->common.channel);
-	nc = NCSI_CHANNEL_INDEX(rsp->common.channel);
-
-	ncsi_send_ebf(np, nc);
+	if (c)
+		ncsi_send_ebf(NCSI_PACKAGE_INDEX(rsp->common.channel), c->id);
 }
 
 static void ncsi_rsp_gc(struct ncsi_rsp_pkt *pkt)
 {
 	struct ncsi_rsp_gc_pkt *gc = (struct ncsi_rsp_gc_pkt *)pkt;
 	struct ncsi_rsp_pkt_hdr *rsp = (struct ncsi_rsp_pkt_hdr *)&gc->rsp;
-	struct ncsi_channel *c;
-	unsigned int np, nc;
-
-	np = NCSI_PACKAGE_INDEX(rsp->common.channel);
-	nc = NCSI_CHANNEL_INDEX(rsp->common.channel);
+	struct ncsi_channel *c = ncsi_rsp_channel(rsp);
 
-	if (np >= ncsi_priv->n_packages ||
-	    nc >= ncsi_priv->packages[np].n_channels) {
-		printf("NCSI: Invalid package / channel (0x%02x, 0x%02x)\n",
-		       np, nc);
+	if (!c)
 		return;
-	}
 
-	c = &ncsi_priv->packages[np].channels[nc];
 	c->cap_generic = ntohl(gc->cap) & NCSI_CAP_GENERIC_MASK;
 	c->cap_bc = ntohl(gc->bc_cap) & NCSI_CAP_BC_MASK;
 	c->cap_mc = ntohl(gc->mc_cap) & NCSI_CAP_MC_MASK;
@@ -297,20 +462,12 @@ static void ncsi_rsp_gvi(struct ncsi_rsp_pkt *pkt)
 {
 	struct ncsi_rsp_gvi_pkt *gvi = (struct ncsi_rsp_gvi_pkt *)pkt;
 	struct ncsi_rsp_pkt_hdr *rsp = (struct ncsi_rsp_pkt_hdr *)&gvi->rsp;
-	struct ncsi_channel *c;
-	unsigned int np, nc, i;
-
-	np = NCSI_PACKAGE_INDEX(rsp->common.channel);
-	nc = NCSI_CHANNEL_INDEX(rsp->common.channel);
+	struct ncsi_channel *c = ncsi_rsp_channel(rsp);
+	unsigned int i;
 
-	if (np >= ncsi_priv->n_packages ||
-	    nc >= ncsi_priv->packages[np].n_channels) {
-		printf("NCSI: Invalid package / channel (0x%02x, 0x%02x)\n",
-		       np, nc);
+	if (!c)
 		return;
-	}
 
-	c = &ncsi_priv->packages[np].channels[nc];
 	c->version.version = get_unaligned_be32(&gvi->ncsi_version);
 	c->version.alpha2 = gvi->alpha2;
 	memcpy(c->version.fw_name, gvi->fw_name, sizeof(c->version.fw_name));
@@ -319,31 +476,24 @@ static void ncsi_rsp_gvi(struct ncsi_rsp_pkt *pkt)
 		c->version.pci_ids[i] = get_unaligned_be16(gvi->pci_ids + i);
 	c->version.mf_id = get_unaligned_be32(&gvi->mf_id);
 
-	if (ncsi_priv->state == NCSI_PROBE_CHANNEL)
-		ncsi_send_command(np, nc, NCSI_PKT_CMD_GC, NULL, 0, true);
+	if (ncsi_probing_channels())
+		ncsi_send_command(NCSI_PACKAGE_INDEX(rsp->common.channel),
+				  c->id, NCSI_PKT_CMD_GC, NULL, 0, true);
 }
 
 static void ncsi_rsp_gls(struct ncsi_rsp_pkt *pkt)
 {
 	struct ncsi_rsp_gls_pkt *gls = (struct ncsi_rsp_gls_pkt *)pkt;
 	struct ncsi_rsp_pkt_hdr *rsp = (struct ncsi_rsp_pkt_hdr *)&gls->rsp;
-	unsigned int np, nc;
+	struct ncsi_channel *c = ncsi_rsp_channel(rsp);
 
-	np = NCSI_PACKAGE_INDEX(rsp->common.channel);
-	nc = NCSI_CHANNEL_INDEX(rsp->common.channel);
-
-	if (np >= ncsi_priv->n_packages ||
-	    nc >= ncsi_priv->packages[np].n_channels) {
-		printf("NCSI: Invalid package / channel (0x%02x, 0x%02x)\n",
-		       np, nc);
+	if (!c)
 		return;
-	}
 
-	ncsi_priv->packages[np].channels[nc].has_link =
-					!!(get_unaligned_be32(&gls->status));
+	c->has_link = !!(get_unaligned_be32(&gls->status));
 
-	if (ncsi_priv->state == NCSI_PROBE_CHANNEL)
-		ncsi_send_command(np, nc, NCSI_PKT_CMD_GVI, NULL, 0, true);
+	if (ncsi_probing_channels())
+		ncsi_send_gvi(NCSI_PACKAGE_INDEX(rsp->common.channel), c->id);
 }
 
 static void ncsi_rsp_cis(struct ncsi_rsp_pkt *pkt)
@@ -355,14 +505,14 @@ static void ncsi_rsp_cis(struct ncsi_rsp_pkt *pkt)
 	np = NCSI_PACKAGE_INDEX(rsp->common.channel);
 	nc = NCSI_CHANNEL_INDEX(rsp->common.channel);
 
-	if (np >= ncsi_priv->n_packages) {
-		printf("NCSI: Mystery package 0x%02x from CIS\n", np);
+	package = &ncsi_priv->packages[np];
+	if (!package->present || nc >= NCSI_CHANNEL_MAX) {
+		printf("NCSI: Mystery channel (0x%02x, 0x%02x) from CIS\n",
+		       np, nc);
 		return;
 	}
 
-	package = &ncsi_priv->packages[np];
-
-	if (nc < package->n_channels) {
+	if (package->channels[nc].present) {
 		/*
 		 * This is fine in general but in the current design we
 		 * don't send CIS commands to known channels.
@@ -371,19 +521,11 @@ static void ncsi_rsp_cis(struct ncsi_rsp_pkt *pkt)
 		return;
 	}
 
-	package->channels = realloc(package->channels,
-				    sizeof(struct ncsi_channel) *
-				    (package->n_channels + 1));
-	if (!package->channels) {
-		printf("NCSI: Could not allocate memory for new channel\n");
-		return;
-	}
-
 	debug("NCSI: New channel 0x%02x\n", nc);
 
 	package->channels[nc].id = nc;
+	package->channels[nc].present = true;
 	package->channels[nc].has_link = false;
-	package->n_channels++;
 
 	ncsi_send_gls(np, nc);
 }
@@ -393,11 +535,11 @@ static void ncsi_rsp_dp(struct ncsi_rsp_pkt *pkt)
 	struct ncsi_rsp_pkt_hdr *rsp = (struct ncsi_rsp_pkt_hdr *)pkt;
 	unsigned int np;
 
-	/* No action needed */
-
 	np = NCSI_PACKAGE_INDEX(rsp->common.channel);
-	if (np >= ncsi_priv->n_packages)
-		debug("NCSI: DP response from unknown package %d\n", np);
+
+	/* Every package answers Deselect Package, so it finds them */
+	if (ncsi_priv->state == NCSI_PROBE_PACKAGE)
+		ncsi_add_package(np);
 }
 
 static void ncsi_rsp_sp(struct ncsi_rsp_pkt *pkt)
@@ -407,96 +549,78 @@ static void ncsi_rsp_sp(struct ncsi_rsp_pkt *pkt)
 
 	np = NCSI_PACKAGE_INDEX(rsp->common.channel);
 
-	if (np < ncsi_priv->n_packages) {
-		/* Already know about this package */
-		debug("NCSI: package 0x%02x selected\n", np);
+	if (np != ncsi_priv->current_package) {
+		debug("NCSI: unexpected SP response from package %d\n", np);
 		return;
 	}
 
-	debug("NCSI: adding new package %d\n", np);
-
-	ncsi_priv->packages = realloc(ncsi_priv->packages,
-				      sizeof(struct ncsi_package) *
-				      (ncsi_priv->n_packages + 1));
-	if (!ncsi_priv->packages) {
-		printf("NCSI: could not allocate memory for new package\n");
-		return;
+	debug("NCSI: package 0x%02x selected\n", np);
+	switch (ncsi_priv->state) {
+	case NCSI_PROBE_CACHED:
+		if (ncsi_add_package(np))
+			ncsi_send_cis(np, ncsi_priv->current_channel);
+		break;
+	case NCSI_PROBE_CHANNEL_SP:
+		ncsi_priv->state = NCSI_PROBE_CHANNEL;
+		ncsi_probe_packages();
+		break;
+	case NCSI_CONFIG:
+		/* Kicks off rest of configure chain */
+		ncsi_send_sma(np, ncsi_priv->current_channel);
+		break;
+	default:
+		break;
 	}
-
-	ncsi_priv->packages[np].id = np;
-	ncsi_priv->packages[np].n_channels = 0;
-	ncsi_priv->packages[np].channels = NULL;
-	ncsi_priv->n_packages++;
 }
 
 static void ncsi_update_state(struct ncsi_rsp_pkt_hdr *nh)
 {
 	bool timeout = !nh;
-	int np, nc;
 
 	switch (ncsi_priv->state) {
-	case NCSI_PROBE_PACKAGE_SP:
-		if (!timeout &&
-		    ncsi_priv->current_package + 1 < NCSI_PACKAGE_MAX) {
-			ncsi_priv->current_package++;
-		} else {
-			ncsi_priv->state = NCSI_PROBE_PACKAGE_DP;
-			ncsi_priv->current_package = 0;
+	case NCSI_PROBE_CACHED:
+		if (ncsi_priv->pending_requests)
+			break;
+		if (!timeout && ncsi_cache_match()) {
+			debug("NCSI: using cached channel\n");
+			ncsi_priv->state = NCSI_CONFIG;
+			return ncsi_probe_packages();
 		}
-		return ncsi_probe_packages();
-	case NCSI_PROBE_PACKAGE_DP:
-		if (ncsi_priv->current_package + 1 < ncsi_priv->n_packages &&
-		    !timeout) {
-			ncsi_priv->current_package++;
-		} else {
-			if (!ncsi_priv->n_packages) {
-				printf("NCSI: no packages found\n");
-				net_set_state(NETLOOP_FAIL);
-				return;
-			}
-			debug("NCSI: probing channels\n");
-			ncsi_priv->state = NCSI_PROBE_CHANNEL_SP;
-			ncsi_priv->current_package = 0;
-			ncsi_priv->current_channel = 0;
+		debug("NCSI: cached channel not usable, probing\n");
+		return ncsi_start_discovery();
+	case NCSI_PROBE_PACKAGE:
+		if (ncsi_priv->pending_requests)
+			break;
+		if (!ncsi_priv->n_packages) {
+			printf("NCSI: no packages found\n");
+			net_set_state(NETLOOP_FAIL);
+			return;
 		}
-		return ncsi_probe_packages();
+		debug("NCSI: probing channels\n");
+		return ncsi_probe_package_from(0);
 	case NCSI_PROBE_CHANNEL_SP:
-		if (!timeout && nh->common.type == NCSI_PKT_RSP_SP) {
-			ncsi_priv->state = NCSI_PROBE_CHANNEL;
-			return ncsi_probe_packages();
+		/* The SP response moves on to NCSI_PROBE_CHANNEL */
+		if (timeout) {
+			printf("NCSI: failed to select package 0x%02x\n",
+			       ncsi_priv->current_package);
+			return ncsi_probe_package_from(
+					ncsi_priv->current_package + 1);
 		}
-		printf("NCSI: failed to select package 0x%0x2 or timeout\n",
-		       ncsi_priv->current_package);
-		net_set_state(NETLOOP_FAIL);
 		break;
 	case NCSI_PROBE_CHANNEL:
-		// TODO only does package 0 for now
-		if (ncsi_priv->pending_requests == 0) {
-			np = ncsi_priv->current_package;
-			nc = ncsi_priv->current_channel;
-
-			/* Configure first channel that has link */
-			if (ncsi_priv->packages[np].channels[nc].has_link) {
-				ncsi_priv->state = NCSI_CONFIG;
-			} else if (ncsi_priv->current_channel + 1 <
-				   NCSI_CHANNEL_MAX) {
-				ncsi_priv->current_channel++;
-			} else {
-				// XXX As above only package 0
-				printf("NCSI: no channel found with link\n");
-				net_set_state(NETLOOP_FAIL);
-				return;
-			}
-			return ncsi_probe_packages();
-		}
-		break;
+		if (ncsi_priv->pending_requests)
+			break;
+		/* Absent channels time out, so this is once per package */
+		ncsi_send_dp(ncsi_priv->current_package, false);
+		return ncsi_probe_package_from(ncsi_priv->current_package + 1);
 	case NCSI_CONFIG:
-		if (ncsi_priv->pending_requests == 0) {
-			debug("NCSI: configuration done!\n");
-			net_set_state(NETLOOP_SUCCESS);
-		} else if (timeout) {
+		if (timeout) {
 			printf("NCSI: timeout during configure\n");
 			net_set_state(NETLOOP_FAIL);
+		} else if (ncsi_priv->pending_requests == 0) {
+			debug("NCSI: configuration done!\n");
+			ncsi_cache_save();
+			net_set_state(NETLOOP_SUCCESS);
 		}
 		break;
 	default:
@@ -508,8 +632,9 @@ static void ncsi_update_state(struct ncsi_rsp_pkt_hdr *nh)
 
 static void ncsi_timeout_handler(void)
 {
-	if (ncsi_priv->pending_requests)
-		ncsi_priv->pending_requests--;
+	/* Whatever is still outstanding is not going to be answered */
+	memset(ncsi_priv->requests, '\0', sizeof(ncsi_priv->requests));
+	ncsi_priv->pending_requests = 0;
 
 	ncsi_update_state(NULL);
 }
@@ -536,8 +661,9 @@ static int ncsi_send_command(unsigned int np, unsigned int nc, unsigned int cmd,
 	hdr = (struct ncsi_pkt_hdr *)pkt;
 	hdr->mc_id = 0;
 	hdr->revision = NCSI_PKT_REVISION;
-	hdr->id = ++ncsi_priv->last_request;
-	ncsi_priv->requests[ncsi_priv->last_request] = 1;
+	/* IDs are 8 bits wide and 0 is not used */
+	ncsi_priv->last_request = ncsi_priv->last_request % 255 + 1;
+	hdr->id = ncsi_priv->last_request;
 	hdr->type = cmd;
 	hdr->channel = NCSI_TO_CHANNEL(np, nc);
 	hdr->length = htons(len);
@@ -552,7 +678,10 @@ static int ncsi_send_command(unsigned int np, unsigned int nc, unsigned int cmd,
 	put_unaligned_be32(checksum, pchecksum);
 
 	if (wait) {
-		net_set_timeout_handler(1000UL, ncsi_timeout_handler);
+		net_set_timeout_handler(ncsi_priv->state == NCSI_PROBE_CACHED ?
+					NCSI_CACHE_TIMEOUT_MS : NCSI_TIMEOUT_MS,
+					ncsi_timeout_handler);
+		ncsi_priv->requests[hdr->id] = 1;
 		ncsi_priv->pending_requests++;
 	}
 
@@ -569,7 +698,7 @@ static int ncsi_send_command(unsigned int np, unsigned int nc, unsigned int cmd,
 static void ncsi_handle_aen(struct ip_udp_hdr *ip, unsigned int len)
 {
 	struct ncsi_aen_pkt_hdr *hdr = (struct ncsi_aen_pkt_hdr *)ip;
-	int payload, i;
+	int payload;
 	__be32 pchecksum;
 	u32 checksum;
 
@@ -616,16 +745,7 @@ static void ncsi_handle_aen(struct ip_udp_hdr *ip, unsigned int len)
 	}
 
 	/* Link or configuration lost - just redo the discovery process */
-	ncsi_priv->state = NCSI_PROBE_PACKAGE_SP;
-	for (i = 0; i < ncsi_priv->n_packages; i++)
-		free(ncsi_priv->packages[i].channels);
-	free(ncsi_priv->packages);
-	ncsi_priv->n_packages = 0;
-
-	ncsi_priv->current_package = NCSI_PACKAGE_MAX;
-	ncsi_priv->current_channel = NCSI_CHANNEL_MAX;
-
-	ncsi_probe_packages();
+	ncsi_start_discovery();
 }
 
 void ncsi_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip,
@@ -636,17 +756,23 @@ void ncsi_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip,
 	void (*handler)(struct ncsi_rsp_pkt *pkt) = NULL;
 	unsigned short payload;
 
-	if (ncsi_priv->pending_requests)
-		ncsi_priv->pending_requests--;
-
 	if (len < sizeof(struct ncsi_rsp_pkt_hdr)) {
 		printf("NCSI: undersized packet: %u bytes\n", len);
-		goto out;
+		return;
 	}
 
 	if (nh->common.type == NCSI_PKT_AEN)
 		return ncsi_handle_aen(ip, len);
 
+	/* Drop responses nobody waits for, e.g. after a timeout */
+	if (!ncsi_priv->requests[nh->common.id]) {
+		debug("NCSI: dropping response 0x%02x with id %d\n",
+		      nh->common.type, nh->common.id);
+		return;
+	}
+	ncsi_priv->requests[nh->common.id] = 0;
+	ncsi_priv->pending_requests--;
+
 	switch (nh->common.type) {
 	case NCSI_PKT_RSP_SP:
 		payload = 4;
@@ -719,10 +845,10 @@ static void ncsi_send_sp(unsigned int np)
 			  cmd_payload(NCSI_PKT_CMD_SP), true);
 }
 
-static void ncsi_send_dp(unsigned int np)
+static void ncsi_send_dp(unsigned int np, bool wait)
 {
 	ncsi_send_command(np, NCSI_RESERVED_CHANNEL, NCSI_PKT_CMD_DP, NULL, 0,
-			  true);
+			  wait);
 }
 
 static void ncsi_send_gls(unsigned int np, unsigned int nc)
@@ -730,6 +856,11 @@ static void ncsi_send_gls(unsigned int np, unsigned int nc)
 	ncsi_send_command(np, nc, NCSI_PKT_CMD_GLS, NULL, 0, true);
 }
 
+static void ncsi_send_gvi(unsigned int np, unsigned int nc)
+{
+	ncsi_send_command(np, nc, NCSI_PKT_CMD_GVI, NULL, 0, true);
+}
+
 static void ncsi_send_cis(unsigned int np, unsigned int nc)
 {
 	ncsi_send_command(np, nc, NCSI_PKT_CMD_CIS, NULL, 0, true);
@@ -790,53 +921,51 @@ void ncsi_probe_packages(void)
 	unsigned int np, nc;
 
 	switch (ncsi_priv->state) {
-	case NCSI_PROBE_PACKAGE_SP:
-		if (ncsi_priv->current_package == NCSI_PACKAGE_MAX)
-			ncsi_priv->current_package = 0;
-		debug("%s: NCSI_PROBE_PACKAGE_SP current_package %d\n",
-				__func__, ncsi_priv->current_package);
+	case NCSI_PROBE_CACHED:
+		debug("%s: NCSI_PROBE_CACHED package %d channel %d\n",
+		      __func__, ncsi_priv->current_package,
+		      ncsi_priv->current_channel);
 		ncsi_send_sp(ncsi_priv->current_package);
 		break;
-	case NCSI_PROBE_PACKAGE_DP:
-		debug("%s: NCSI_PROBE_PACKAGE_DP current_package %d\n",
-				__func__, ncsi_priv->current_package);
-		ncsi_send_dp(ncsi_priv->current_package);
+	case NCSI_PROBE_PACKAGE:
+		debug("%s: NCSI_PROBE_PACKAGE\n", __func__);
+		for (np = 0; np < NCSI_PACKAGE_MAX; np++)
+			ncsi_send_dp(np, true);
 		break;
 	case NCSI_PROBE_CHANNEL_SP:
-		debug("%s: NCSI_PROBE_CHANNEL_SP\n", __func__);
-		if (ncsi_priv->n_packages > 0)
-			ncsi_send_sp(ncsi_priv->current_package);
-		else
-			printf("NCSI: no packages discovered, configuration not possible\n");
+		debug("%s: NCSI_PROBE_CHANNEL_SP package %d\n", __func__,
+		      ncsi_priv->current_package);
+		ncsi_send_sp(ncsi_priv->current_package);
 		break;
 	case NCSI_PROBE_CHANNEL:
-		debug("%s NCSI_PROBE_CHANNEL package %d channel %d\n",
-				__func__,
-				ncsi_priv->current_package,
-				ncsi_priv->current_channel);
-		/* Kicks off chain of channel discovery */
-		ncsi_send_cis(ncsi_priv->current_package,
-			      ncsi_priv->current_channel);
+		debug("%s NCSI_PROBE_CHANNEL package %d\n", __func__,
+		      ncsi_priv->current_package);
+		/* Kicks off chains of channel discovery */
+		for (nc = 0; nc < NCSI_CHANNEL_MAX; nc++)
+			ncsi_send_cis(ncsi_priv->current_package, nc);
 		break;
 	case NCSI_CONFIG:
-		for (np = 0; np < ncsi_priv->n_packages; np++) {
+		for (np = 0; np < NCSI_PACKAGE_MAX; np++) {
 			package = &ncsi_priv->packages[np];
-			for (nc = 0; nc < package->n_channels; nc++)
+			if (!package->present)
+				continue;
+			for (nc = 0; nc < NCSI_CHANNEL_MAX; nc++)
 				if (package->channels[nc].has_link)
 					break;
-			if (nc < package->n_channels)
+			if (nc < NCSI_CHANNEL_MAX)
 				break;
 		}
-		if (np == ncsi_priv->n_packages) {
-			printf("NCSI: no link available\n");
+		if (np == NCSI_PACKAGE_MAX) {
+			printf("NCSI: no channel found with link\n");
+			net_set_state(NETLOOP_FAIL);
 			return;
 		}
 
-		debug("NCSI: configuring channel %d\n", nc);
+		debug("NCSI: configuring package %d channel %d\n", np, nc);
 		ncsi_priv->current_package = np;
 		ncsi_priv->current_channel = nc;
-		/* Kicks off rest of configure chain */
-		ncsi_send_sma(np, nc);
+		/* Select the package, the SP response configures the channel */
+		ncsi_send_sp(np);
 		break;
 	default:
 		printf("NCSI: unknown state 0x%x\n", ncsi_priv->state);
@@ -865,26 +994,33 @@ int ncsi_startup(struct phy_device *phydev)
 	/* Normal phy reset is N/A */
 	phydev->flags |= PHY_FLAG_BROKEN_RESET;
 
-	/* Set initial probe state */
-	ncsi_priv->state = NCSI_PROBE_PACKAGE_SP;
-
-	/* No active package/channel yet */
-	ncsi_priv->current_package = NCSI_PACKAGE_MAX;
-	ncsi_priv->current_channel = NCSI_CHANNEL_MAX;
+	/* Set ncsi_priv so we can use it when called from net_loop() */
+	ncsi_priv = phydev->priv;
+	ncsi_free_packages();
+
+	/* Try the channel which worked last time first, if any */
+	if (!ncsi_cache.valid)
+		ncsi_cache_load();
+	if (ncsi_cache.valid) {
+		ncsi_priv->state = NCSI_PROBE_CACHED;
+		ncsi_priv->current_package = ncsi_cache.package;
+		ncsi_priv->current_channel = ncsi_cache.channel;
+	} else {
+		ncsi_priv->state = NCSI_PROBE_PACKAGE;
+		ncsi_priv->current_package = NCSI_PACKAGE_MAX;
+		ncsi_priv->current_channel = NCSI_CHANNEL_MAX;
+	}
 
 	/* Pretend link works so the MAC driver sets final bits up */
 	phydev->link = true;
 
-	/* Set ncsi_priv so we can use it when called from net_loop() */
-	ncsi_priv = phydev->priv;
-
 	return 0;
 }
 
 int ncsi_shutdown(struct phy_device *phydev)
 {
 	printf("NCSI: Disabling package %d\n", ncsi_priv->current_package);
-	ncsi_send_dp(ncsi_priv->current_package);
+	ncsi_send_dp(ncsi_priv->current_package, false);
 	return 0;
 }
 
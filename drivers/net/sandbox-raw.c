@@ -17,6 +17,137 @@ DECLARE_GLOBAL_DATA_PTR;
 static int reply_arp;
 static struct in_addr arp_ip;
 
+/* Number of received packets the emulated link can hold back */
+#define SB_ETH_LINK_QLEN	64
+
+/**
+ * struct sb_eth_link - emulated link to the host
+ *
+ * The link is set up from the environment each time the device is started:
+ * "ethlinkrtt" is the round-trip time in microseconds, "ethlinkrate" the
+ * bandwidth in bytes per second and "ethlinkloss" the packet loss in parts
+ * per thousand. The loss pattern comes from a generator seeded with
+ * "ethlinkseed", so that a run can be repeated exactly.
+ *
+ * The whole round-trip time is applied to received packets, which is the
+ * same as splitting it between both directions for the request/response
+ * protocols U-Boot speaks, and the bandwidth limit is only applied to
+ * received packets, since downloads are what we want to measure. Packets
+ * are lost in both directions. When the queue is full, further packets wait
+ * in the host socket buffer.
+ *
+ * rtt_us: round-trip time in microseconds
+ * rate: bandwidth in bytes per second, 0 if unlimited
+ * loss: packet loss in parts per thousand
+ * seed: state of the loss generator
+ * busy_until: time at which the last queued packet has been received
+ * head: index of the oldest queued packet
+ * count: number of queued packets
+ * queue: packets held back until their arrival time
+ */
+struct sb_eth_link {
+	unsigned long rtt_us;
+	unsigned long rate;
+	unsigned int loss;
+	unsigned int seed;
+	unsigned long busy_until;
+	int head;
+	int count;
+	struct {
+		unsigned long due;
+		int length;
+		uchar data[PKTSIZE_ALIGN];
+	} queue[SB_ETH_LINK_QLEN];
+};
+
+static void sb_eth_link_setup(struct eth_sandbox_raw_priv *priv)
+{
+	struct sb_eth_link *link;
+	unsigned long rtt_us, rate, loss;
+
+	free(priv->link);
+	priv->link = NULL;
+
+	rtt_us = env_get_ulong("ethlinkrtt", 10, 0);
+	rate = env_get_ulong("ethlinkrate", 10, 0);
+	loss = env_get_ulong("ethlinkloss", 10, 0);
+	if (!rtt_us && !rate && !loss)
+		return;
+
+	link = calloc(1, sizeof(*link));
+	if (!link) {
+		printf("eth_sandbox_raw: Cannot emulate link\n");
+		return;
+	}
+	link->rtt_us = rtt_us;
+	link->rate = rate;
+	link->loss = min(loss, 1000UL);
+	link->seed = env_get_ulong("ethlinkseed", 10, 1) ?: 1;
+	priv->link = link;
+	debug("eth_sandbox_raw: Link rtt %lu us, rate %lu B/s, loss %u/1000\n",
+	      link->rtt_us, link->rate, link->loss);
+}
+
+/* Decide whether to lose the next packet, using a xorshift generator */
+static bool sb_eth_link_lose(struct sb_eth_link *link)
+{
+	if (!link->loss)
+		return false;
+
+	link->seed ^= link->seed << 13;
+	link->seed ^= link->seed >> 17;
+	link->seed ^= link->seed << 5;
+
+	return link->seed % 1000 < link->loss;
+}
+
+static int sb_eth_link_recv(struct eth_sandbox_raw_priv *priv, void *packet,
+			    int *length)
+{
+	struct sb_eth_link *link = priv->link;
+	unsigned long now = timer_get_us();
+	int slot;
+	int ret;
+
+	/* Put everything the host has sent us on the link */
+	while (link->count < SB_ETH_LINK_QLEN) {
+		unsigned long start;
+		int len;
+
+		slot = (link->head + link->count) % SB_ETH_LINK_QLEN;
+		ret = sandbox_eth_raw_os_recv(link->queue[slot].data, &len,
+					      priv);
+		if (ret)
+			return ret;
+		if (!len)
+			break;
+		if (sb_eth_link_lose(link))
+			continue;
+
+		start = link->busy_until;
+		if ((long)(now - start) > 0)
+			start = now;
+		if (link->rate)
+			start += (u64)len * 1000000 / link->rate;
+		link->busy_until = start;
+		link->queue[slot].due = start + link->rtt_us;
+		link->queue[slot].length = len;
+		link->count++;
+	}
+
+	*length = 0;
+	slot = link->head;
+	if (!link->count || (long)(now - link->queue[slot].due) < 0)
+		return 0;
+
+	memcpy(packet, link->queue[slot].data, link->queue[slot].length);
+	*length = link->queue[slot].length;
+	link->head = (slot + 1) % SB_ETH_LINK_QLEN;
+	link->count--;
+
+	return 0;
+}
+
 static int sb_eth_raw_start(struct udevice *dev)
 {
 	struct eth_sandbox_raw_priv *priv = dev_get_priv(dev);
@@ -25,6 +156,7 @@ static int sb_eth_raw_start(struct udevice *dev)
 
 	debug("eth_sandbox_raw: Start\n");
 
+	sb_eth_link_setup(priv);
 	ret = sandbox_eth_raw_os_start(priv, pdata->enetaddr);
 	if (priv->local) {
 		env_set("ipaddr", "127.0.0.1");
@@ -58,6 +190,8 @@ static int sb_eth_raw_send(struct udevice *dev, void *packet, int length)
 		packet += ETHER_HDR_SIZE;
 		length -= ETHER_HDR_SIZE;
 	}
+	if (priv->link && sb_eth_link_lose(priv->link))
+		return 0;
 	return sandbox_eth_raw_os_send(packet, length, priv);
 }
 
@@ -98,7 +232,10 @@ static int sb_eth_raw_recv(struct udevice *dev, int flags, uchar **packetp)
 		uchar *pktptr = priv->local ?
 			net_rx_packets[0] + ETHER_HDR_SIZE : net_rx_packets[0];
 
-		retval = sandbox_eth_raw_os_recv(pktptr, &length, priv);
+		if (priv->link)
+			retval = sb_eth_link_recv(priv, pktptr, &length);
+		else
+			retval = sandbox_eth_raw_os_recv(pktptr, &length, priv);
 	}
 
 	if (!retval && length) {
@@ -127,6 +264,8 @@ static void sb_eth_raw_stop(struct udevice *dev)
 
 	debug("eth_sandbox_raw: Stop\n");
 
+	free(priv->link);
+	priv->link = NULL;
 	sandbox_eth_raw_os_stop(priv);
 }
 
@@ -12,13 +12,13 @@
 #include <dm/device-internal.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+/* At most NVME_Q_DEPTH - 1 I/O commands are outstanding, see nvme_blk_rw() */
+#define NVME_Q_DEPTH		16
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
 
 enum nvme_queue_id {
 	NVME_ADMIN_Q,
@@ -65,12 +65,26 @@ static int nvme_wait_ready(struct nvme_dev *dev, bool enabled)
 	return -ETIME;
 }
 
+/**
+ * nvme_setup_prps() - fill in the PRP list of an I/O command
+ *
+ * Each I/O command slot has its own PRP list pages in dev->prp_pool, so the
+ * lists of outstanding commands are left alone.
+ *
+ * @dev:	NVMe device
+ * @prp2:	Returns the PRP entry 2 of the command
+ * @total_len:	Length of the transfer in bytes
+ * @dma_addr:	Address of the transfer, also the PRP entry 1
+ * @slot:	I/O command slot the PRP list is for
+ * @return 0 if OK, -EINVAL if the transfer is too large for the PRP list
+ */
 static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
-			   int total_len, u64 dma_addr)
+			   int total_len, u64 dma_addr, int slot)
 {
 	u32 page_size = dev->page_size;
+	u32 entries = page_size >> 3;
 	int offset = dma_addr & (page_size - 1);
-	u64 *prp_pool;
+	u64 *prp_list, *prp_pool;
 	int length = total_len;
 	int i, nprps;
 	length -= (page_size - offset);
@@ -89,31 +103,27 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 	}
 
 	nprps = DIV_ROUND_UP(length, page_size);
+	if (nprps > dev->prp_pages * (entries - 1) + 1)
+		return -EINVAL;
 
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		dev->prp_pool = malloc(nprps << 3);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
-			return -ENOMEM;
-		}
-		dev->prp_entry_num = nprps;
-	}
-
-	prp_pool = dev->prp_pool;
+	prp_list = dev->prp_pool + slot * dev->prp_pages * entries;
+	prp_pool = prp_list;
 	i = 0;
 	while (nprps) {
-		if (i == ((page_size >> 3) - 1)) {
+		/* The last entry of a full page chains to the next page */
+		if (i == entries - 1 && nprps > 1) {
 			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
 					page_size);
 			i = 0;
-			prp_pool += page_size;
+			prp_pool += entries;
 		}
 		*(prp_pool + i++) = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
 		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	flush_dcache_range((ulong)prp_list,
+			   ALIGN((ulong)(prp_pool + i), ARCH_DMA_MINALIGN));
+	*prp2 = (ulong)prp_list;
 
 	return 0;
 }
@@ -216,6 +226,53 @@ static int nvme_submit_admin_cmd(struct nvme_dev *dev, struct nvme_command *cmd,
 				    result, ADMIN_TIMEOUT);
 }
 
+/**
+ * nvme_poll_cq() - reap all completions posted to a queue
+ *
+ * The completion queue head doorbell is written once for the whole batch.
+ *
+ * @nvmeq:	The queue to poll
+ * @done:	Gets the bit of the command ID of each completed command set
+ * @failed:	Gets the bit of the command ID of each failed command set
+ * @return number of completions reaped
+ */
+static int nvme_poll_cq(struct nvme_queue *nvmeq, u32 *done, u32 *failed)
+{
+	u16 head = nvmeq->cq_head;
+	u16 phase = nvmeq->cq_phase;
+	u16 status, cmd_id;
+	int count = 0;
+
+	for (;;) {
+		status = nvme_read_completion_status(nvmeq, head);
+		if ((status & 0x01) != phase)
+			break;
+
+		cmd_id = le16_to_cpu(readw(&nvmeq->cqes[head].command_id));
+		*done |= BIT(cmd_id);
+		status >>= 1;
+		if (status) {
+			printf("ERROR: status = %x, phase = %d, head = %d\n",
+			       status, phase, head);
+			*failed |= BIT(cmd_id);
+		}
+		count++;
+
+		if (++head == nvmeq->q_depth) {
+			head = 0;
+			phase = !phase;
+		}
+	}
+
+	if (count) {
+		writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
+		nvmeq->cq_head = head;
+		nvmeq->cq_phase = phase;
+	}
+
+	return count;
+}
+
 static struct nvme_queue *nvme_alloc_queue(struct nvme_dev *dev,
 					   int qid, int depth)
 {
@@ -673,60 +730,94 @@ static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 {
 	struct nvme_ns *ns = dev_get_priv(udev);
 	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
 	struct nvme_command c;
 	struct blk_desc *desc = dev_get_uclass_platdata(udev);
-	int status;
+	u64 slot_lba[NVME_Q_DEPTH];
+	u32 busy = 0, done, failed;
+	int nslots = nvmeq->q_depth - 1;
+	int slot, i;
 	u64 prp2;
 	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
+	void *addr;
+	ulong start_time;
+	ulong timeout_us = IO_TIMEOUT * 100000;
 
 	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-	u64 total_lbas = blkcnt;
+	u64 end = blknr + blkcnt;
+	/* First LBA of the first chunk that failed */
+	u64 err_lba = end;
+	u32 lbas = min(1U << (dev->max_transfer_shift - ns->lba_shift),
+		       0x10000U);
+	u32 n;
 
 	if (!read)
 		flush_dcache_range((unsigned long)buffer,
 				   (unsigned long)buffer + total_len);
 
+	memset(&c, 0, sizeof(c));
 	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
 	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
+
+	/*
+	 * Keep up to nslots chunks outstanding. Each slot is the command ID of
+	 * its chunk and has its own PRP list, so chunks may complete in any
+	 * order.
+	 */
+	start_time = timer_get_us();
+	while ((slba < end && err_lba == end) || busy) {
+		while (slba < end && err_lba == end) {
+			for (slot = 0; busy & BIT(slot); slot++)
+				;
+			if (slot >= nslots)
+				break;
+
+			n = min_t(u64, end - slba, lbas);
+			addr = buffer + ((slba - blknr) << ns->lba_shift);
+			if (nvme_setup_prps(dev, &prp2, n << ns->lba_shift,
+					    (ulong)addr, slot)) {
+				err_lba = slba;
+				break;
+			}
+			c.rw.command_id = cpu_to_le16(slot);
+			c.rw.slba = cpu_to_le64(slba);
+			c.rw.length = cpu_to_le16(n - 1);
+			c.rw.prp1 = cpu_to_le64((ulong)addr);
+			c.rw.prp2 = cpu_to_le64(prp2);
+			nvme_submit_cmd(nvmeq, &c);
+
+			slot_lba[slot] = slba;
+			busy |= BIT(slot);
+			slba += n;
+		}
+		if (!busy)
+			break;
+
+		done = 0;
+		failed = 0;
+		if (!nvme_poll_cq(nvmeq, &done, &failed)) {
+			if (timer_get_us() - start_time < timeout_us)
+				continue;
+			/* Whatever is still outstanding counts as failed */
+			printf("ERROR: %s: I/O timeout\n", udev->name);
+			failed = busy;
+			done = busy;
 		} else {
-			total_lbas -= lbas;
+			start_time = timer_get_us();
 		}
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, (ulong)buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
-		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64((ulong)buffer);
-		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
-			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		buffer += lbas << ns->lba_shift;
+		for (i = 0; i < nslots; i++) {
+			if ((failed & BIT(i)) && slot_lba[i] < err_lba)
+				err_lba = slot_lba[i];
+		}
+		busy &= ~done;
 	}
 
 	if (read)
 		invalidate_dcache_range((unsigned long)buffer,
 					(unsigned long)buffer + total_len);
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	return err_lba - blknr;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -766,6 +857,7 @@ static int nvme_bind(struct udevice *udev)
 
 static int nvme_probe(struct udevice *udev)
 {
+	ulong prps;
 	int ret;
 	struct nvme_dev *ndev = dev_get_priv(udev);
 
@@ -788,14 +880,6 @@ static int nvme_probe(struct udevice *udev)
 	}
 	memset(ndev->queues, 0, NVME_Q_NUM * sizeof(struct nvme_queue *));
 
-	ndev->prp_pool = malloc(MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
-
 	ndev->cap = nvme_readq(&ndev->bar->cap);
 	ndev->q_depth = min_t(int, NVME_CAP_MQES(ndev->cap) + 1, NVME_Q_DEPTH);
 	ndev->db_stride = 1 << NVME_CAP_STRIDE(ndev->cap);
@@ -811,6 +895,21 @@ static int nvme_probe(struct udevice *udev)
 
 	nvme_get_info_from_identify(ndev);
 
+	/*
+	 * Each I/O command slot gets enough PRP list pages for the largest
+	 * transfer, chained through the last entry of each page
+	 */
+	prps = max(1UL << ndev->max_transfer_shift, (ulong)ndev->page_size) /
+	       ndev->page_size;
+	ndev->prp_pages = DIV_ROUND_UP(prps, (ndev->page_size >> 3) - 1);
+	ndev->prp_pool = memalign(ndev->page_size, (ndev->q_depth - 1) *
+				  ndev->prp_pages * ndev->page_size);
+	if (!ndev->prp_pool) {
+		ret = -ENOMEM;
+		printf("Error: %s: Out of memory!\n", udev->name);
+		goto free_queue;
+	}
+
 	return 0;
 
 free_queue:
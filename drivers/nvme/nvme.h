@@ -624,8 +624,8 @@ struct nvme_dev {
 	u32 stripe_size;
 	u32 page_size;
 	u8 vwc;
-	u64 *prp_pool;
-	u32 prp_entry_num;
+	u64 *prp_pool;		/* PRP list pages of the I/O command slots */
+	u32 prp_pages;		/* PRP list pages per I/O command slot */
 	u32 nn;
 };
 
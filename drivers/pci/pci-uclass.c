@@ -753,6 +753,32 @@ error:
 	return ret;
 }
 
+/*
+ * The link below a PCIe root port or switch downstream port is point to
+ * point, so only device 0 can exist on its secondary bus. Config reads of
+ * the other devices end in Unsupported Request completions, which some
+ * root complexes only turn into all-ones data after a long timeout.
+ */
+static bool pci_bus_only_one_child(struct udevice *bus)
+{
+	u16 flags;
+	int type;
+	int pos;
+
+	if (!device_is_on_pci_bus(bus))
+		return false;
+
+	pos = dm_pci_find_capability(bus, PCI_CAP_ID_EXP);
+	if (!pos)
+		return false;
+
+	dm_pci_read_config16(bus, pos + PCI_EXP_FLAGS, &flags);
+	type = (flags & PCI_EXP_FLAGS_TYPE) >> 4;
+
+	return type == PCI_EXP_TYPE_ROOT_PORT ||
+	       type == PCI_EXP_TYPE_DOWNSTREAM;
+}
+
 int pci_bind_bus_devices(struct udevice *bus)
 {
 	ulong vendor, device;
@@ -762,8 +788,11 @@ int pci_bind_bus_devices(struct udevice *bus)
 	int ret;
 
 	found_multi = false;
-	end = PCI_BDF(bus->seq, PCI_MAX_PCI_DEVICES - 1,
-		      PCI_MAX_PCI_FUNCTIONS - 1);
+	if (pci_bus_only_one_child(bus))
+		end = PCI_BDF(bus->seq, 0, PCI_MAX_PCI_FUNCTIONS - 1);
+	else
+		end = PCI_BDF(bus->seq, PCI_MAX_PCI_DEVICES - 1,
+			      PCI_MAX_PCI_FUNCTIONS - 1);
 	for (bdf = PCI_BDF(bus->seq, 0, 0); bdf <= end;
 	     bdf += PCI_BDF(0, 0, 1)) {
 		struct pci_child_platdata *pplat;
@@ -7,15 +7,20 @@
 #include <common.h>
 #include <clk.h>
 #include <dm.h>
+#include <dt-structs.h>
 #include <errno.h>
+#include <mapmem.h>
 #include <ram.h>
 #include <regmap.h>
 #include <reset.h>
+#include <spi_flash.h>
 #include <asm/io.h>
+#include <asm/arch/platform.h>
 #include <asm/arch/scu_ast2600.h>
 #include <asm/arch/sdram_ast2600.h>
 #include <linux/err.h>
 #include <linux/kernel.h>
+#include <u-boot/crc.h>
 #include <dt-bindings/clock/ast2600-clock.h>
 #include "sdram_phy_ast2600.h"
 
@@ -175,6 +180,12 @@ static const u32 ddr_max_grant_params[4] = { 0x44484488, 0xee4444ee, 0x44444444,
 					     0x44444444 };
 #endif
 
+struct ast2600_sdrammc_plat {
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	struct dtd_aspeed_ast2600_sdrammc dtplat;
+#endif
+};
+
 struct dram_info {
 	struct ram_info info;
 	struct clk ddr_clk;
@@ -392,12 +403,15 @@ int ast2600_sdrammc_dg_test(struct dram_info *info, unsigned int datagen, u32 mo
 	return 1;
 }
 
-int ast2600_sdrammc_cbr_test(struct dram_info *info)
+#define MC_TEST_LEN_FULL	0x7ffff0
+#define MC_TEST_LEN_QUICK	0x07fff0
+
+int ast2600_sdrammc_cbr_test(struct dram_info *info, u32 len)
 {
 	struct ast2600_sdrammc_regs *regs = info->regs;
 	u32 i;
 
-	clrsetbits_le32(&regs->test_addr, GENMASK(30, 4), 0x7ffff0);
+	clrsetbits_le32(&regs->test_addr, GENMASK(30, 4), len);
 
 	/* single */
 	for (i = 0; i < 8; i++) {
@@ -414,26 +428,31 @@ int ast2600_sdrammc_cbr_test(struct dram_info *info)
 	return(1);
 }
 
-static int ast2600_sdrammc_test(struct dram_info *info)
+/*
+ * The quick test checks a sixteenth of the range with one pattern, for a
+ * training which is known to be good
+ */
+static int ast2600_sdrammc_test(struct dram_info *info, bool quick)
 {
 	struct ast2600_sdrammc_regs *regs = info->regs;
 
 	u32 pass_cnt = 0;
 	u32 fail_cnt = 0;
-	u32 target_cnt = 2;
+	u32 target_cnt = quick ? 1 : 2;
+	u32 len = quick ? MC_TEST_LEN_QUICK : MC_TEST_LEN_FULL;
 	u32 test_cnt = 0;
 	u32 pattern;
 	u32 i = 0;
 	bool finish = false;
 
-	debug("sdram mc test:\n");
+	debug("sdram mc %stest:\n", quick ? "quick " : "");
 	while (finish == false) {
 		pattern = as2600_sdrammc_test_pattern[i++];
 		i = i % MC_TEST_PATTERN_N;
 		debug("  pattern = %08x : ", pattern);
 		writel(pattern, &regs->test_init_val);
 
-		if (!ast2600_sdrammc_cbr_test(info)) {
+		if (!ast2600_sdrammc_cbr_test(info, len)) {
 			debug("fail\n");
 			fail_cnt++;
 		} else {
@@ -450,6 +469,142 @@ static int ast2600_sdrammc_test(struct dram_info *info)
 	return fail_cnt;
 }
 #endif
+#if defined(CONFIG_ASPEED_DDR_TRAIN_CACHE) && \
+	!defined(CONFIG_FPGA_ASPEED) && !defined(CONFIG_ASPEED_PALLADIUM)
+/*
+ * Cache of a known good DDR-PHY training
+ *
+ * The PHY trains itself on every kick and its results cannot be loaded back,
+ * so it is the full memory test after the training that the cache saves. If
+ * the PHY reports pass windows no narrower than those of the training which
+ * passed the full test before, on the same SoC revision, DRAM data rate,
+ * width and refresh (temperature) setting, only a quick test is run. The
+ * record is read by SPL from the memory mapped boot flash; U-Boot proper
+ * writes it after a boot which needed the full test.
+ */
+#define DDR_TRAIN_CACHE_MAGIC	0x54524444	/* "DDRT" */
+
+static const struct {
+	u16 reg;		/* in the PHY status registers */
+	u8 width;		/* of the two pass window fields */
+} ddr_train_results[] = {
+	{ 0x50, 16 },		/* gate */
+	{ 0x68, 8 },		/* read eye, rising edge */
+	{ 0x7c, 8 },		/* write eye, rising edge */
+	{ 0xc8, 8 },		/* read eye, falling edge */
+};
+
+struct ast2600_ddr_train_cache {
+	u32 magic;
+	u32 key;
+	u32 result[ARRAY_SIZE(ddr_train_results)];
+	u32 cap;		/* SDRAM_CONF_CAP_* found with it */
+	u32 crc;
+};
+
+static void ast2600_ddr_train_get(struct dram_info *info,
+				  struct ast2600_ddr_train_cache *rec)
+{
+	const u32 key[] = {
+		readl(info->scu + AST_SCU_FPGA_STATUS),	/* silicon revision */
+		SCU_MPLL_FREQ_CFG,
+		DDR4_TRFI,
+		IS_ENABLED(CONFIG_ASPEED_DDR4_DUALX8),
+	};
+	int i;
+
+	memset(rec, '\0', sizeof(*rec));
+	rec->magic = DDR_TRAIN_CACHE_MAGIC;
+	rec->key = crc32(0, (const u8 *)key, sizeof(key));
+	for (i = 0; i < ARRAY_SIZE(ddr_train_results); i++)
+		rec->result[i] = readl(info->phy_status +
+				       ddr_train_results[i].reg);
+	rec->cap = readl(&info->regs->config) & SDRAM_CONF_CAP_MASK;
+	rec->crc = crc32(0, (const u8 *)rec, offsetof(typeof(*rec), crc));
+}
+
+/* Whether the current training is at least as good as the cached one */
+static bool ast2600_ddr_train_cached(struct dram_info *info)
+{
+	const struct ast2600_ddr_train_cache *cache =
+		(void *)(ASPEED_FMC_CS0_BASE +
+			 CONFIG_ASPEED_DDR_TRAIN_CACHE_OFFSET);
+	struct ast2600_ddr_train_cache rec;
+	u32 mask, live, good;
+	int i, f, w;
+
+	if (cache->magic != DDR_TRAIN_CACHE_MAGIC ||
+	    cache->crc != crc32(0, (const u8 *)cache,
+				offsetof(typeof(*cache), crc)))
+		return false;
+
+	ast2600_ddr_train_get(info, &rec);
+	if (rec.key != cache->key || rec.cap != cache->cap)
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(ddr_train_results); i++) {
+		w = ddr_train_results[i].width;
+		mask = (1 << w) - 1;
+		for (f = 0; f < 2; f++) {
+			live = (rec.result[i] >> (f * w)) & mask;
+			good = (cache->result[i] >> (f * w)) & mask;
+			/* allow for some spread between trainings */
+			if (live * 4 < good * 3)
+				return false;
+		}
+	}
+	debug("DDR-PHY training matches the cached one\n");
+
+	return true;
+}
+
+#ifndef CONFIG_SPL_BUILD
+int ast2600_sdrammc_save_training(void)
+{
+	struct ast2600_ddr_train_cache rec;
+	struct spi_flash *flash;
+	struct udevice *dev;
+	struct dram_info *info;
+	int ret;
+
+	ret = uclass_get_device(UCLASS_RAM, 0, &dev);
+	if (ret)
+		return ret;
+	info = dev_get_priv(dev);
+
+	/* Nothing new if SPL could use the cache */
+	if (ast2600_ddr_train_cached(info))
+		return 0;
+	ast2600_ddr_train_get(info, &rec);
+
+	flash = spi_flash_probe(CONFIG_SF_DEFAULT_BUS, CONFIG_SF_DEFAULT_CS,
+				CONFIG_SF_DEFAULT_SPEED,
+				CONFIG_SF_DEFAULT_MODE);
+	if (!flash) {
+		debug("%s: no SPI flash\n", __func__);
+		return -ENODEV;
+	}
+	ret = spi_flash_erase(flash, CONFIG_ASPEED_DDR_TRAIN_CACHE_OFFSET,
+			      flash->erase_size);
+	if (!ret)
+		ret = spi_flash_write(flash,
+				      CONFIG_ASPEED_DDR_TRAIN_CACHE_OFFSET,
+				      sizeof(rec), &rec);
+	spi_flash_free(flash);
+	if (ret)
+		printf("DDR training cache write failed: %d\n", ret);
+	else
+		debug("DDR-PHY training saved\n");
+
+	return ret;
+}
+#endif
+#else
+static inline bool ast2600_ddr_train_cached(struct dram_info *info)
+{
+	return false;
+}
+#endif
 /**
  * scu500[14:13]
  * 	2b'00: VGA memory size = 16MB
@@ -846,6 +1001,15 @@ static void ast2600_sdrammc_update_size(struct dram_info *info)
 	info->info.size = hw_size;
 }
 #ifdef CONFIG_ASPEED_ECC
+static void ast2600_sdrammc_ecc_done(struct ast2600_sdrammc_regs *regs)
+{
+	while (0 == (readl(&regs->ecc_test_ctrl) & BIT(12)))
+		;
+	writel(0, &regs->ecc_test_ctrl);
+	writel(BIT(31), &regs->intr_ctrl);
+	writel(0, &regs->intr_ctrl);
+}
+
 static void ast2600_sdrammc_ecc_enable(struct dram_info *info)
 {
 	struct ast2600_sdrammc_regs *regs = info->regs;
@@ -867,14 +1031,40 @@ static void ast2600_sdrammc_ecc_enable(struct dram_info *info)
 	reg = readl(&regs->config) | SDRAM_CONF_ECC_SETUP;
 	writel(reg, &regs->config);
 
+	/* Fill the ECC range with the data generator of the test engine */
 	writel(0, &regs->test_init_val);
 	writel(0x80000001, &regs->test_addr);
 	writel(0x221, &regs->ecc_test_ctrl);
-	while (0 == (readl(&regs->ecc_test_ctrl) & BIT(12)))
-		;
-	writel(0, &regs->ecc_test_ctrl);
-	writel(BIT(31), &regs->intr_ctrl);
-	writel(0, &regs->intr_ctrl);
+#ifndef CONFIG_ASPEED_ECC_BACKGROUND_INIT
+	ast2600_sdrammc_ecc_done(regs);
+#endif
+}
+#endif
+
+#ifdef CONFIG_ASPEED_ECC_BACKGROUND_INIT
+int ast2600_sdrammc_ecc_wait(void)
+{
+	struct ast2600_sdrammc_regs *regs;
+	struct dram_info *priv;
+	struct udevice *dev;
+	int ret;
+
+	ret = uclass_first_device_err(UCLASS_RAM, &dev);
+	if (ret)
+		return ret;
+	priv = dev_get_priv(dev);
+	regs = priv->regs;
+
+	/* The engine is stopped again once the fill is done */
+	if (!(readl(&regs->ecc_test_ctrl) & BIT(0)))
+		return 0;
+
+	debug("%s: waiting for the ECC init\n", __func__);
+	ast2600_sdrammc_unlock(priv);
+	ast2600_sdrammc_ecc_done(regs);
+	ast2600_sdrammc_lock(priv);
+
+	return 0;
 }
 #endif
 
@@ -882,9 +1072,17 @@ static int ast2600_sdrammc_probe(struct udevice *dev)
 {
 	struct dram_info *priv = (struct dram_info *)dev_get_priv(dev);
 	struct ast2600_sdrammc_regs *regs = priv->regs;
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	struct ast2600_sdrammc_plat *plat = dev_get_platdata(dev);
+#endif
+	struct ast2600_clk_priv *clk_priv;
 	struct udevice *clk_dev;
 	int ret;
 	volatile uint32_t reg;
+#ifndef CONFIG_ASPEED_BYPASS_SELFTEST
+	bool use_cache = true;
+	bool quick;
+#endif
 
 	/* find SCU base address from clock device */
 	ret = uclass_get_device_by_driver(UCLASS_CLK, DM_GET_DRIVER(aspeed_scu),
@@ -894,11 +1092,9 @@ static int ast2600_sdrammc_probe(struct udevice *dev)
 		return ret;
 	}
 
-	priv->scu = devfdt_get_addr_ptr(clk_dev);
-	if (IS_ERR(priv->scu)) {
-		debug("%s(): can't get SCU\n", __func__);
-		return PTR_ERR(priv->scu);
-	}
+	/* The clock driver has mapped the SCU already */
+	clk_priv = dev_get_priv(clk_dev);
+	priv->scu = clk_priv->scu;
 
 	reg = readl(priv->scu + AST_SCU_HANDSHAKE);
 	if (reg & SCU_SDRAM_INIT_READY_MASK) {
@@ -919,6 +1115,14 @@ static int ast2600_sdrammc_probe(struct udevice *dev)
 	writel(reg, priv->scu + AST_SCU_MPLL);
 	while (0 == (readl(priv->scu + AST_SCU_MPLL_EXT) & BIT(31)))
 		;
+#elif CONFIG_IS_ENABLED(OF_PLATDATA)
+	ret = clk_get_by_index_platdata(dev, 0, plat->dtplat.clocks,
+					&priv->ddr_clk);
+	if (ret) {
+		debug("DDR:No CLK\n");
+		return ret;
+	}
+	clk_set_rate(&priv->ddr_clk, priv->clock_rate);
 #else
 	ret = clk_get_by_index(dev, 0, &priv->ddr_clk);
 	if (ret) {
@@ -967,7 +1171,13 @@ L_ast2600_sdramphy_train:
 	ast2600_sdrammc_calc_size(priv);
 
 #ifndef CONFIG_ASPEED_BYPASS_SELFTEST
-	ret = ast2600_sdrammc_test(priv);
+	quick = use_cache && ast2600_ddr_train_cached(priv);
+	ret = ast2600_sdrammc_test(priv, quick);
+	if (ret && quick) {
+		printf("DDR4 quick test fail, retrain\n");
+		use_cache = false;
+		goto L_ast2600_sdramphy_train;
+	}
 	if (ret) {
 		printf("%s: DDR4 init fail\n", __func__);
 		return -EINVAL;
@@ -987,12 +1197,22 @@ static int ast2600_sdrammc_ofdata_to_platdata(struct udevice *dev)
 {
 	struct dram_info *priv = dev_get_priv(dev);
 
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	struct ast2600_sdrammc_plat *plat = dev_get_platdata(dev);
+	struct dtd_aspeed_ast2600_sdrammc *dtplat = &plat->dtplat;
+
+	priv->regs = map_sysmem(dtplat->reg[0], dtplat->reg[1]);
+	priv->phy_setting = map_sysmem(dtplat->reg[2], dtplat->reg[3]);
+	priv->phy_status = map_sysmem(dtplat->reg[4], dtplat->reg[5]);
+	priv->clock_rate = dtplat->clock_frequency;
+#else
 	priv->regs = (void *)(uintptr_t)devfdt_get_addr_index(dev, 0);
 	priv->phy_setting = (void *)(uintptr_t)devfdt_get_addr_index(dev, 1);
 	priv->phy_status = (void *)(uintptr_t)devfdt_get_addr_index(dev, 2);
 
 	priv->clock_rate = fdtdec_get_int(gd->fdt_blob, dev_of_offset(dev),
 					  "clock-frequency", 0);
+#endif
 	if (!priv->clock_rate) {
 		debug("DDR Clock Rate not defined\n");
 		return -EINVAL;
@@ -1027,4 +1247,5 @@ U_BOOT_DRIVER(sdrammc_ast2600) = {
 	.ofdata_to_platdata = ast2600_sdrammc_ofdata_to_platdata,
 	.probe = ast2600_sdrammc_probe,
 	.priv_auto_alloc_size = sizeof(struct dram_info),
+	.platdata_auto_alloc_size = sizeof(struct ast2600_sdrammc_plat),
 };
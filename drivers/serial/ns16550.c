@@ -322,6 +322,30 @@ static int ns16550_serial_putc(struct udevice *dev, const char ch)
 	return 0;
 }
 
+static int ns16550_serial_puts(struct udevice *dev, const char *s, int len)
+{
+	struct NS16550 *const com_port = dev_get_priv(dev);
+	struct ns16550_platdata *plat = com_port->plat;
+	int i;
+
+	/* With the FIFO on, THRE is only set once it is empty */
+	if (!(serial_in(&com_port->lsr) & UART_LSR_THRE))
+		return -EAGAIN;
+	if (!(plat->fcr & UART_FCR_FIFO_EN))
+		len = 1;
+	else
+		len = min(len, NS16550_FIFO_SIZE);
+
+	for (i = 0; i < len; i++) {
+		serial_out(s[i], &com_port->thr);
+		/* See ns16550_serial_putc() */
+		if (s[i] == '\n')
+			WATCHDOG_RESET();
+	}
+
+	return len;
+}
+
 static int ns16550_serial_pending(struct udevice *dev, bool input)
 {
 	struct NS16550 *const com_port = dev_get_priv(dev);
@@ -511,6 +535,7 @@ int ns16550_serial_ofdata_to_platdata(struct udevice *dev)
 
 const struct dm_serial_ops ns16550_serial_ops = {
 	.putc = ns16550_serial_putc,
+	.puts = ns16550_serial_puts,
 	.pending = ns16550_serial_pending,
 	.getc = ns16550_serial_getc,
 	.setbrg = ns16550_serial_setbrg,
@@ -7,6 +7,7 @@
 #include <dm.h>
 #include <environment.h>
 #include <errno.h>
+#include <handoff.h>
 #include <os.h>
 #include <serial.h>
 #include <stdio_dev.h>
@@ -78,6 +79,16 @@ static void serial_find_console_or_panic(void)
 	int ret;
 #endif
 
+#if CONFIG_IS_ENABLED(HANDOFF) && defined(CONFIG_HANDOFF_DEVICES)
+	/* Take over the console that SPL was using, at the same baud rate */
+	if (!SPL_BUILD && handoff_console_seq() >= 0 &&
+	    !uclass_get_device_by_seq(UCLASS_SERIAL, handoff_console_seq(),
+				      &dev)) {
+		gd->cur_serial_dev = dev;
+		return;
+	}
+#endif
+
 	if (CONFIG_IS_ENABLED(OF_PLATDATA)) {
 		uclass_first_device(UCLASS_SERIAL, &dev);
 		if (dev) {
@@ -170,6 +181,99 @@ void serial_initialize(void)
 	serial_init();
 }
 
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+#define TX_BUF_IDX(idx)	((idx) & (CONFIG_SERIAL_TX_BUFFER_SIZE - 1))
+
+/*
+ * Pass buffered output to the UART. Without @wait, stop as soon as its TX
+ * FIFO is full.
+ */
+static void serial_tx_drain(struct udevice *dev, bool wait)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	uint idx, len;
+	int err;
+
+	if (upriv->tx_hold)
+		return;
+	while (upriv->tx_rd != upriv->tx_wr) {
+		idx = TX_BUF_IDX(upriv->tx_rd);
+		if (ops->puts) {
+			/* Up to the end of the ring in one go */
+			len = min(upriv->tx_wr - upriv->tx_rd,
+				  CONFIG_SERIAL_TX_BUFFER_SIZE - idx);
+			err = ops->puts(dev, upriv->tx_buf + idx, len);
+		} else {
+			err = ops->putc(dev, upriv->tx_buf[idx]);
+		}
+		if (err == -EAGAIN) {
+			if (!wait)
+				break;
+			continue;
+		}
+		upriv->tx_rd += (ops->puts && err > 0) ? err : 1;
+	}
+}
+
+/* Returns true if the character was buffered */
+static bool serial_tx_put(struct udevice *dev, char ch)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	int err;
+
+	if (!upriv->tx_buf)
+		return false;
+
+	if (upriv->tx_wr - upriv->tx_rd == CONFIG_SERIAL_TX_BUFFER_SIZE) {
+		if (upriv->tx_hold) {
+			/* Keep the latest output */
+			upriv->tx_rd++;
+		} else {
+			do {
+				err = ops->putc(dev,
+					upriv->tx_buf[TX_BUF_IDX(upriv->tx_rd)]);
+			} while (err == -EAGAIN);
+			upriv->tx_rd++;
+		}
+	}
+	upriv->tx_buf[TX_BUF_IDX(upriv->tx_wr++)] = ch;
+	if (!upriv->tx_hold)
+		serial_tx_drain(dev, false);
+
+	return true;
+}
+
+void serial_flush(bool boot)
+{
+	struct serial_dev_priv *upriv;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	if (uclass_get(UCLASS_SERIAL, &uc))
+		return;
+	uclass_foreach_dev(dev, uc) {
+		if (!device_active(dev))
+			continue;
+		upriv = dev_get_uclass_priv(dev);
+		if (!upriv->tx_buf)
+			continue;
+		if (upriv->tx_hold && boot)
+			upriv->tx_rd = upriv->tx_wr;
+		upriv->tx_hold = false;
+		serial_tx_drain(dev, true);
+	}
+}
+#else
+static inline bool serial_tx_put(struct udevice *dev, char ch)
+{
+	return false;
+}
+
+static inline void serial_tx_drain(struct udevice *dev, bool wait) {}
+#endif /* CONFIG_IS_ENABLED(SERIAL_TX_BUFFER) */
+
 static void _serial_putc(struct udevice *dev, char ch)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
@@ -178,15 +282,51 @@ static void _serial_putc(struct udevice *dev, char ch)
 	if (ch == '\n')
 		_serial_putc(dev, '\r');
 
+	if (serial_tx_put(dev, ch))
+		return;
+
 	do {
 		err = ops->putc(dev, ch);
 	} while (err == -EAGAIN);
 }
 
+/* Write @len characters with the puts() method, waiting for room */
+static void _serial_write(struct udevice *dev, const char *s, int len)
+{
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	int ret;
+
+	while (len > 0) {
+		ret = ops->puts(dev, s, len);
+		if (ret == -EAGAIN)
+			continue;
+		if (ret < 0)
+			return;
+		s += ret;
+		len -= ret;
+	}
+}
+
 static void _serial_puts(struct udevice *dev, const char *str)
 {
-	while (*str)
-		_serial_putc(dev, *str++);
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	const char *newline;
+
+	if (!ops->puts || upriv->tx_buf) {
+		while (*str)
+			_serial_putc(dev, *str++);
+		return;
+	}
+
+	while (*str) {
+		newline = strchrnul(str, '\n');
+		_serial_write(dev, str, newline - str);
+		if (!*newline)
+			break;
+		_serial_write(dev, "\r\n", 2);
+		str = newline + 1;
+	}
 }
 
 static int __serial_getc(struct udevice *dev)
@@ -194,6 +334,8 @@ static int __serial_getc(struct udevice *dev)
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 	int err;
 
+	/* Show everything written before waiting for input */
+	serial_tx_drain(dev, true);
 	do {
 		err = ops->getc(dev);
 		if (err == -EAGAIN)
@@ -207,6 +349,8 @@ static int __serial_tstc(struct udevice *dev)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 
+	/* Callers such as ctrlc() poll this, so keep the output moving */
+	serial_tx_drain(dev, false);
 	if (ops->pending)
 		return ops->pending(dev, true);
 
@@ -218,9 +362,15 @@ static int _serial_tstc(struct udevice *dev)
 {
 	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
 
-	/* Read all available chars into the RX buffer */
-	while (__serial_tstc(dev)) {
-		upriv->buf[upriv->wr_ptr++] = __serial_getc(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	int ch;
+
+	/* Keep the output moving, as __serial_tstc() does */
+	serial_tx_drain(dev, false);
+
+	/* Drain the RX FIFO into the RX buffer, one status read per char */
+	while ((ch = ops->getc(dev)) >= 0) {
+		upriv->buf[upriv->wr_ptr++] = ch;
 		upriv->wr_ptr %= CONFIG_SERIAL_RX_BUFFER_SIZE;
 	}
 
@@ -478,6 +628,11 @@ static int serial_post_probe(struct udevice *dev)
 	/* Allocate the RX buffer */
 	upriv->buf = malloc(CONFIG_SERIAL_RX_BUFFER_SIZE);
 #endif
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	/* Allocate the TX buffer; output is sent directly if this fails */
+	upriv->tx_buf = malloc(CONFIG_SERIAL_TX_BUFFER_SIZE);
+	upriv->tx_hold = IS_ENABLED(CONFIG_SERIAL_TX_BUFFER_QUIET);
+#endif
 
 	stdio_register_dev(&sdev, &upriv->sdev);
 #endif
@@ -488,7 +643,10 @@ static int serial_pre_remove(struct udevice *dev)
 {
 #if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
 	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+#endif
 
+	serial_tx_drain(dev, true);
+#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
 	if (stdio_deregister_dev(upriv->sdev, true))
 		return -EPERM;
 #endif
@@ -10,9 +10,13 @@
 #include <common.h>
 #include <clk.h>
 #include <dm.h>
+#include <dt-structs.h>
+#include <mapmem.h>
 #include <spi.h>
 #include <spi_flash.h>
 #include <asm/io.h>
+#include <asm/cache.h>
+#include <linux/iopoll.h>
 #include <linux/ioport.h>
 #include <malloc.h>
 
@@ -156,6 +160,10 @@ struct aspeed_spi_regs {
 #define DMA_GET_REQ_MAGIC		0xaeed0000
 #define DMA_DISCARD_REQ_MAGIC	0xdeea0000
 
+/* Largest transfer programmed in one go, and its completion timeout */
+#define DMA_READ_MAX_LEN		0x100000
+#define DMA_READ_TIMEOUT_US		100000
+
 /* for ast2600 setting */
 #define SPI_3B_AUTO_CLR_REG   0x1e6e2510
 #define SPI_3B_AUTO_CLR       BIT(9)
@@ -177,6 +185,7 @@ struct aspeed_spi_flash {
 	u32 read_iomode;
 	u32 write_iomode;
 	u32 max_freq;
+	u32 calib_cache; /* Flash offset of the calibration record, or ~0 */
 	struct spi_flash *spi; /* Associated SPI Flash device */
 };
 
@@ -196,6 +205,12 @@ struct aspeed_spi_priv {
 	size_t cmd_len;
 };
 
+struct aspeed_spi_plat {
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	struct dtd_aspeed_ast2600_fmc dtplat;
+#endif
+};
+
 static struct aspeed_spi_flash *aspeed_spi_get_flash(struct udevice *dev)
 {
 	struct dm_spi_slave_platdata *slave_plat = dev_get_parent_platdata(dev);
@@ -301,6 +316,25 @@ static u32 aspeed_spi_fmc_checksum(struct aspeed_spi_priv *priv,
 	return checksum;
 }
 
+/*
+ * On the AST2600, the DMA engine is shared with the secure boot hardware
+ * and must be requested before use.
+ */
+static void aspeed_g6_spi_dma_request(struct aspeed_spi_priv *priv)
+{
+	writel(DMA_GET_REQ_MAGIC, &priv->regs->dma_ctrl);
+	if (readl(&priv->regs->dma_ctrl) & DAM_CTRL_REQUEST) {
+		while (!(readl(&priv->regs->dma_ctrl) & DAM_CTRL_GRANT))
+			;
+	}
+}
+
+static void aspeed_g6_spi_dma_release(struct aspeed_spi_priv *priv)
+{
+	writel(0x0, &priv->regs->dma_ctrl);
+	writel(DMA_DISCARD_REQ_MAGIC, &priv->regs->dma_ctrl);
+}
+
 /*
  * Use some address/size under the first flash device CE0
  */
@@ -312,11 +346,7 @@ static u32 aspeed_g6_spi_fmc_checksum(struct aspeed_spi_priv *priv,
 	u32 dma_ctrl;
 	u32 checksum;
 
-	writel(DMA_GET_REQ_MAGIC, &priv->regs->dma_ctrl);
-	if (readl(&priv->regs->dma_ctrl) & DAM_CTRL_REQUEST) {
-		while (!(readl(&priv->regs->dma_ctrl) & DAM_CTRL_GRANT))
-			;
-	}
+	aspeed_g6_spi_dma_request(priv);
 
 	writel(flash_addr, &priv->regs->dma_flash_addr);
 	writel(FLASH_CALIBRATION_LEN,  &priv->regs->dma_len);
@@ -336,8 +366,7 @@ static u32 aspeed_g6_spi_fmc_checksum(struct aspeed_spi_priv *priv,
 	checksum = readl(&priv->regs->dma_checksum);
 
 	writel(0x0, &priv->regs->intr_ctrl);
-	writel(0x0, &priv->regs->dma_ctrl);
-	writel(DMA_DISCARD_REQ_MAGIC, &priv->regs->dma_ctrl);
+	aspeed_g6_spi_dma_release(priv);
 
 	return checksum;
 }
@@ -361,6 +390,31 @@ static u32 aspeed_spi_read_checksum(struct aspeed_spi_priv *priv,
 #define TIMING_DELAY_DI_4NS         BIT(3)
 #define TIMING_DELAY_HCYCLE_MAX     5
 
+#define CALIB_CACHE_MAGIC		0x424c4143	/* "CALB" */
+
+/*
+ * Calibration result kept in a reserved flash sector so that later boots
+ * only need to confirm it with a single checksum.
+ */
+struct aspeed_spi_calib_rec {
+	u32 magic;
+	u32 jedec_id;
+	u32 hclk_rate;
+	u32 timing;	/* Read Timing Compensation Register of the CS */
+	u32 check;	/* ~(magic ^ jedec_id ^ hclk_rate ^ timing) */
+};
+
+#if IS_ENABLED(CONFIG_ASPEED_SPI_CALIB_CACHE)
+static u32 aspeed_spi_read_jedec(struct aspeed_spi_priv *priv,
+				 struct aspeed_spi_flash *flash);
+static bool aspeed_spi_calib_cache_lookup(struct aspeed_spi_priv *priv,
+					  struct aspeed_spi_flash *flash,
+					  u32 jedec_id, u32 *timing);
+static void aspeed_spi_calib_cache_store(struct aspeed_spi_priv *priv,
+					 struct aspeed_spi_flash *flash,
+					 u32 jedec_id, u32 timing);
+#endif
+
 /*
  * Check whether the data is not all 0 or 1 in order to
  * avoid calibriate umount spi-flash.
@@ -430,11 +484,25 @@ static int aspeed_spi_timing_calibration(struct aspeed_spi_priv *priv,
 	u8 *calib_res = NULL;
 	int calib_point;
 	bool pass;
+	u32 __maybe_unused jedec_id = 0;
+	bool __maybe_unused calibrated = false;
 
 	if (priv->new_ver) {
+#if IS_ENABLED(CONFIG_ASPEED_SPI_CALIB_CACHE)
+		if (flash->calib_cache != ~0)
+			jedec_id = aspeed_spi_read_jedec(priv, flash);
+#endif
 		timing_reg = readl(&priv->regs->timings + cs);
-		if (timing_reg != 0)
+		if (timing_reg != 0) {
+#if IS_ENABLED(CONFIG_ASPEED_SPI_CALIB_CACHE)
+			/* Calibrated by an earlier stage: keep its result */
+			if (flash->calib_cache != ~0)
+				aspeed_spi_calib_cache_store(priv, flash,
+							     jedec_id,
+							     timing_reg);
+#endif
 			return 0;
+		}
 
 		/*
 		 * use the related low frequency to get check calibration data
@@ -455,6 +523,32 @@ static int aspeed_spi_timing_calibration(struct aspeed_spi_priv *priv,
 		/* Compute reference checksum at lowest freq HCLK/16 */
 		gold_checksum = aspeed_spi_read_checksum(priv, flash, 0, 0);
 
+#if IS_ENABLED(CONFIG_ASPEED_SPI_CALIB_CACHE)
+		/* A previous result only needs to be confirmed once */
+		if (flash->calib_cache != ~0 &&
+		    aspeed_spi_calib_cache_lookup(priv, flash, jedec_id,
+						  &timing_reg)) {
+			u32 delay;
+
+			for (i = 0; !(timing_reg & (0xff << (i * 8))); i++)
+				;
+			delay = (timing_reg >> (i * 8)) & 0xff;
+			checksum = aspeed_g6_spi_fmc_checksum(priv, flash,
+							      hclk_masks[3 - i],
+							      delay);
+			if (checksum == gold_checksum &&
+			    priv->hclk_rate / (i + 2) <= max_freq) {
+				debug("cs: %d, cached timing 0x%08x\n", cs,
+				      timing_reg);
+				max_freq = (u32)priv->hclk_rate / (i + 2);
+				writel(timing_reg, &priv->regs->timings + cs);
+				goto no_calib;
+			}
+			debug("cs: %d, stale cached timing 0x%08x\n", cs,
+			      timing_reg);
+		}
+#endif
+
 		/*
 		 * allocate a space to record calibration result for
 		 * different timing compensation with fixed
@@ -502,6 +596,7 @@ static int aspeed_spi_timing_calibration(struct aspeed_spi_priv *priv,
 
 			final_delay = (TIMING_DELAY_DI_4NS | hcycle | (delay_ns << 4)) << (i * 8);
 			writel(final_delay, &priv->regs->timings + cs);
+			calibrated = true;
 			break;
 		}
 
@@ -524,6 +619,12 @@ no_calib:
 			free(tmp_buf);
 		if (calib_res)
 			free(calib_res);
+
+#if IS_ENABLED(CONFIG_ASPEED_SPI_CALIB_CACHE)
+		if (calibrated && flash->calib_cache != ~0)
+			aspeed_spi_calib_cache_store(priv, flash, jedec_id,
+						     final_delay);
+#endif
 	} else {
 		/* Use the ctrl setting in aspeed_spi_flash_init() to
 		 * implement calibration process.
@@ -836,6 +937,125 @@ static ssize_t aspeed_spi_write_user(struct aspeed_spi_priv *priv,
 	return 0;
 }
 
+#if IS_ENABLED(CONFIG_ASPEED_SPI_CALIB_CACHE)
+static u32 aspeed_spi_read_jedec(struct aspeed_spi_priv *priv,
+				 struct aspeed_spi_flash *flash)
+{
+	u32 ce_ctrl_user = flash->ce_ctrl_user;
+	u8 id[3];
+
+	/* The read timings are not known yet, use HCLK/16 */
+	flash->ce_ctrl_user &= CE_CTRL_FREQ_MASK;
+	aspeed_spi_read_reg(priv, flash, SPINOR_OP_RDID, id, sizeof(id));
+	flash->ce_ctrl_user = ce_ctrl_user;
+
+	return (id[0] << 16) | (id[1] << 8) | id[2];
+}
+
+static bool aspeed_spi_calib_cache_lookup(struct aspeed_spi_priv *priv,
+					  struct aspeed_spi_flash *flash,
+					  u32 jedec_id, u32 *timing)
+{
+	struct aspeed_spi_calib_rec rec;
+
+	memcpy_fromio(&rec, flash->ahb_base + flash->calib_cache, sizeof(rec));
+	if (rec.magic != CALIB_CACHE_MAGIC ||
+	    rec.check != ~(rec.magic ^ rec.jedec_id ^ rec.hclk_rate ^
+			  rec.timing))
+		return false;
+
+	if (rec.jedec_id != jedec_id || rec.hclk_rate != priv->hclk_rate ||
+	    !rec.timing)
+		return false;
+
+	*timing = rec.timing;
+
+	return true;
+}
+
+static int aspeed_spi_wait_ready(struct aspeed_spi_priv *priv,
+				 struct aspeed_spi_flash *flash)
+{
+	ulong start = get_timer(0);
+	u8 sr;
+
+	do {
+		aspeed_spi_read_reg(priv, flash, SPINOR_OP_RDSR, &sr, 1);
+		if (!(sr & SR_WIP))
+			return 0;
+	} while (get_timer(start) < 3 * CONFIG_SYS_HZ);
+
+	return -ETIMEDOUT;
+}
+
+static int aspeed_spi_fill_cmd(struct aspeed_spi_flash *flash, u8 *cmd,
+			       u8 opcode, u32 addr)
+{
+	int len = 0;
+
+	cmd[len++] = opcode;
+	if (flash->spi->addr_width == 4)
+		cmd[len++] = addr >> 24;
+	cmd[len++] = addr >> 16;
+	cmd[len++] = addr >> 8;
+	cmd[len++] = addr;
+
+	return len;
+}
+
+/*
+ * Save a calibration result in the reserved sector. This runs from the
+ * first bus claim after the flash has been identified, before the caller
+ * has issued any command, so the device can be driven directly here.
+ * Only U-Boot proper writes the record: SPL leaves the result in the
+ * timing registers and U-Boot proper picks it up from there.
+ */
+static void aspeed_spi_calib_cache_store(struct aspeed_spi_priv *priv,
+					 struct aspeed_spi_flash *flash,
+					 u32 jedec_id, u32 timing)
+{
+	struct aspeed_spi_calib_rec rec;
+	u32 cur_timing;
+	u8 cmd[5];
+	int len;
+
+	if (IS_ENABLED(CONFIG_SPL_BUILD))
+		return;
+
+	if (aspeed_spi_calib_cache_lookup(priv, flash, jedec_id, &cur_timing) &&
+	    cur_timing == timing)
+		return;
+
+	rec.magic = CALIB_CACHE_MAGIC;
+	rec.jedec_id = jedec_id;
+	rec.hclk_rate = priv->hclk_rate;
+	rec.timing = timing;
+	rec.check = ~(rec.magic ^ rec.jedec_id ^ rec.hclk_rate ^ rec.timing);
+
+	aspeed_spi_write_reg(priv, flash, SPINOR_OP_WREN, NULL, 0);
+	len = aspeed_spi_fill_cmd(flash, cmd, flash->spi->erase_opcode,
+				  flash->calib_cache);
+	aspeed_spi_start_user(priv, flash);
+	aspeed_spi_send_cmd_addr(priv, flash, cmd, len, 0);
+	aspeed_spi_stop_user(priv, flash);
+	if (aspeed_spi_wait_ready(priv, flash))
+		goto err;
+
+	aspeed_spi_write_reg(priv, flash, SPINOR_OP_WREN, NULL, 0);
+	len = aspeed_spi_fill_cmd(flash, cmd, flash->spi->program_opcode,
+				  flash->calib_cache);
+	aspeed_spi_write_user(priv, flash, len, cmd, sizeof(rec), (u8 *)&rec);
+	if (aspeed_spi_wait_ready(priv, flash))
+		goto err;
+
+	debug("CS%u: saved timing 0x%08x at 0x%x\n", flash->cs, timing,
+	      flash->calib_cache);
+	return;
+err:
+	pr_warn("CS%u: failed to save timing calibration\n", flash->cs);
+}
+#endif
+
 static u32 aspeed_spi_flash_to_addr(struct aspeed_spi_flash *flash,
 				    const u8 *cmdbuf, unsigned int cmdlen)
 {
@@ -852,6 +1072,94 @@ static u32 aspeed_spi_flash_to_addr(struct aspeed_spi_flash *flash,
 	return addr;
 }
 
+#if IS_ENABLED(CONFIG_ASPEED_SPI_DMA)
+/*
+ * Copy a cache line aligned buffer from the flash AHB window with the
+ * controller DMA engine.
+ */
+static int aspeed_spi_dma_xfer(struct aspeed_spi_priv *priv,
+			       struct aspeed_spi_flash *flash,
+			       u32 offset, u8 *buf, size_t len)
+{
+	ulong start = (ulong)buf;
+	u32 status;
+	int ret;
+
+	invalidate_dcache_range(start, start + len);
+
+	if (priv->new_ver)
+		aspeed_g6_spi_dma_request(priv);
+
+	writel((u32)flash->ahb_base + offset, &priv->regs->dma_flash_addr);
+	writel((u32)buf, &priv->regs->dma_dram_addr);
+	writel(len, &priv->regs->dma_len);
+	writel(DMA_CTRL_ENABLE, &priv->regs->dma_ctrl);
+
+	ret = readl_poll_timeout(&priv->regs->intr_ctrl, status,
+				 status & INTR_CTRL_DMA_STATUS,
+				 DMA_READ_TIMEOUT_US);
+
+	writel(0x0, &priv->regs->intr_ctrl);
+	if (priv->new_ver)
+		aspeed_g6_spi_dma_release(priv);
+	else
+		writel(0x0, &priv->regs->dma_ctrl);
+
+	/* Drop any line speculatively fetched while the DMA was running */
+	invalidate_dcache_range(start, start + len);
+
+	return ret;
+}
+
+/*
+ * Read through the DMA engine when it is worth it. The unaligned head and
+ * tail of the buffer, which share cache lines with other data, are copied
+ * from the AHB window with the CPU. Returns the number of bytes left for
+ * the caller to copy at the start of the buffer, i.e. @len if the DMA
+ * engine could not be used at all.
+ */
+static size_t aspeed_spi_read_dma(struct aspeed_spi_priv *priv,
+				  struct aspeed_spi_flash *flash,
+				  u32 offset, u8 *buf, size_t len)
+{
+	size_t head, body, chunk;
+
+	if (!priv->new_ver && !priv->is_fmc)
+		return len;
+
+	if (len < CONFIG_ASPEED_SPI_DMA_MIN_LEN)
+		return len;
+
+	/* Both sides of the engine work on 32-bit words */
+	if ((offset ^ (u32)buf) & 0x3)
+		return len;
+
+	head = ALIGN((ulong)buf, ARCH_DMA_MINALIGN) - (ulong)buf;
+	if (len < head + ARCH_DMA_MINALIGN)
+		return len;
+	body = ALIGN_DOWN(len - head, ARCH_DMA_MINALIGN);
+
+	for (chunk = 0; chunk < body; chunk += DMA_READ_MAX_LEN) {
+		size_t sz = min_t(size_t, body - chunk, DMA_READ_MAX_LEN);
+
+		if (aspeed_spi_dma_xfer(priv, flash, offset + head + chunk,
+					buf + head + chunk, sz)) {
+			debug("CS%u: DMA read timeout, using AHB\n",
+			      flash->cs);
+			memcpy_fromio(buf + head + chunk,
+				      flash->ahb_base + offset + head + chunk,
+				      body - chunk);
+			break;
+		}
+	}
+
+	memcpy_fromio(buf + head + body, flash->ahb_base + offset + head + body,
+		      len - head - body);
+
+	return head;
+}
+#endif
+
 /* TODO(clg@kaod.org): add support for XFER_MMAP instead ? */
 static ssize_t aspeed_spi_read(struct aspeed_spi_priv *priv,
 			       struct aspeed_spi_flash *flash,
@@ -877,6 +1185,9 @@ static ssize_t aspeed_spi_read(struct aspeed_spi_priv *priv,
 					    len, read_buf);
 	}
 
+#if IS_ENABLED(CONFIG_ASPEED_SPI_DMA)
+	len = aspeed_spi_read_dma(priv, flash, offset, read_buf, len);
+#endif
 	memcpy_fromio(read_buf, flash->ahb_base + offset, len);
 
 	return 0;
@@ -1099,6 +1410,19 @@ static int aspeed_spi_flash_init(struct aspeed_spi_priv *priv,
 
 	flash->ce_ctrl_user = CE_CTRL_USERMODE;
 	flash->max_freq = slave->speed;
+	flash->calib_cache = ~0;
+#if IS_ENABLED(CONFIG_ASPEED_SPI_CALIB_CACHE)
+	flash->calib_cache = dev_read_u32_default(dev,
+						  "aspeed,calibration-cache",
+						  ~0);
+	if (flash->calib_cache != ~0 &&
+	    (flash->calib_cache % spi_flash->erase_size ||
+	     flash->calib_cache >= spi_flash->size)) {
+		pr_warn("CS%u: bad calibration cache offset 0x%x\n",
+			flash->cs, flash->calib_cache);
+		flash->calib_cache = ~0;
+	}
+#endif
 
 	if(priv->new_ver)
 		read_hclk = aspeed_g6_spi_hclk_divisor(priv, slave->speed);
@@ -1234,6 +1558,7 @@ static int aspeed_spi_set_speed(struct udevice *bus, uint hz)
 	return 0;
 }
 
+#if !CONFIG_IS_ENABLED(OF_PLATDATA)
 static int aspeed_spi_count_flash_devices(struct udevice *bus)
 {
 	ofnode node;
@@ -1247,6 +1572,7 @@ static int aspeed_spi_count_flash_devices(struct udevice *bus)
 
 	return count;
 }
+#endif
 
 static int aspeed_spi_bind(struct udevice *bus)
 {
@@ -1256,6 +1582,47 @@ static int aspeed_spi_bind(struct udevice *bus)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+/*
+ * of-platdata only describes the FMC which SPL boots from. Its flash nodes
+ * are not bound below it, so allow a flash on each chip select.
+ */
+static int aspeed_spi_probe(struct udevice *bus)
+{
+	struct aspeed_spi_plat *plat = dev_get_platdata(bus);
+	struct dtd_aspeed_ast2600_fmc *dtplat = &plat->dtplat;
+	struct aspeed_spi_priv *priv = dev_get_priv(bus);
+	struct clk hclk;
+	int ret;
+
+	priv->regs = map_sysmem(dtplat->reg[0], dtplat->reg[1]);
+	priv->ahb_base = map_sysmem(dtplat->reg[2], dtplat->reg[3]);
+	priv->ahb_size = dtplat->reg[3];
+
+	ret = clk_get_by_index_platdata(bus, 0, dtplat->clocks, &hclk);
+	if (ret < 0) {
+		pr_err("%s could not get clock: %d\n", bus->name, ret);
+		return ret;
+	}
+
+	priv->hclk_rate = clk_get_rate(&hclk);
+	clk_free(&hclk);
+
+	priv->num_cs = dtplat->num_cs;
+	priv->flash_count = priv->num_cs;
+	priv->new_ver = 1;
+	priv->is_fmc = 1;
+
+	ret = aspeed_spi_controller_init(priv);
+	if (ret)
+		return ret;
+
+	debug("%s probed regs=%p ahb_base=%p cs_num=%d seq=%d\n",
+	      bus->name, priv->regs, priv->ahb_base, priv->flash_count, bus->seq);
+
+	return 0;
+}
+#else
 static int aspeed_spi_probe(struct udevice *bus)
 {
 	struct resource res_regs, res_ahb;
@@ -1319,6 +1686,7 @@ static int aspeed_spi_probe(struct udevice *bus)
 
 	return 0;
 }
+#endif
 
 static const struct dm_spi_ops aspeed_spi_ops = {
 	.claim_bus	= aspeed_spi_claim_bus,
@@ -1338,11 +1706,16 @@ static const struct udevice_id aspeed_spi_ids[] = {
 };
 
 U_BOOT_DRIVER(aspeed_spi) = {
+#if CONFIG_IS_ENABLED(OF_PLATDATA)
+	.name = "aspeed_ast2600_fmc",
+#else
 	.name = "aspeed_spi",
+#endif
 	.id = UCLASS_SPI,
 	.of_match = aspeed_spi_ids,
 	.ops = &aspeed_spi_ops,
 	.priv_auto_alloc_size = sizeof(struct aspeed_spi_priv),
+	.platdata_auto_alloc_size = sizeof(struct aspeed_spi_plat),
 	.child_pre_probe = aspeed_spi_child_pre_probe,
 	.bind  = aspeed_spi_bind,
 	.probe = aspeed_spi_probe,
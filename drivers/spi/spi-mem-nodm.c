@@ -82,6 +82,31 @@ int spi_mem_exec_op(struct spi_slave *slave,
 	return 0;
 }
 
+bool spi_mem_supports_op(struct spi_slave *slave,
+			 const struct spi_mem_op *op)
+{
+	/* Command, address and dummy bytes go out in a single spi_xfer() */
+	if (op->cmd.buswidth != 1 ||
+	    (op->addr.nbytes && op->addr.buswidth != 1) ||
+	    (op->dummy.nbytes && op->dummy.buswidth != 1))
+		return false;
+
+	switch (op->data.nbytes ? op->data.buswidth : 1) {
+	case 1:
+		return true;
+	case 2:
+		return op->data.dir == SPI_MEM_DATA_OUT ?
+		       !!(slave->mode & (SPI_TX_DUAL | SPI_TX_QUAD)) :
+		       !!(slave->mode & (SPI_RX_DUAL | SPI_RX_QUAD));
+	case 4:
+		return op->data.dir == SPI_MEM_DATA_OUT ?
+		       !!(slave->mode & SPI_TX_QUAD) :
+		       !!(slave->mode & SPI_RX_QUAD);
+	default:
+		return false;
+	}
+}
+
 int spi_mem_adjust_op_size(struct spi_slave *slave,
 			   struct spi_mem_op *op)
 {
@@ -178,6 +178,18 @@ bool spi_mem_supports_op(struct spi_slave *slave,
 	if (ops->mem_ops && ops->mem_ops->supports_op)
 		return ops->mem_ops->supports_op(slave, op);
 
+	/*
+	 * Without ->exec_op() the operation goes through plain spi_xfer()
+	 * calls, which have no way to send the command, address and dummy
+	 * phases on more than one line.
+	 */
+	if (!ops->mem_ops || !ops->mem_ops->exec_op) {
+		if (op->cmd.buswidth != 1 ||
+		    (op->addr.nbytes && op->addr.buswidth != 1) ||
+		    (op->dummy.nbytes && op->dummy.buswidth != 1))
+			return false;
+	}
+
 	return spi_mem_default_supports_op(slave, op);
 }
 EXPORT_SYMBOL_GPL(spi_mem_supports_op);
@@ -11,6 +11,9 @@
 #include <tpm-v2.h>
 #include "tpm_internal.h"
 
+/* First delay between two polls for the response of a command */
+#define TPM_POLL_MIN_US		100
+
 int tpm_open(struct udevice *dev)
 {
 	struct tpm_ops *ops = tpm_get_ops(dev);
@@ -72,6 +75,7 @@ int tpm_xfer(struct udevice *dev, const uint8_t *sendbuf, size_t send_size,
 	struct tpm_ops *ops = tpm_get_ops(dev);
 	ulong start, stop;
 	uint count, ordinal;
+	uint delay_us, max_us;
 	int ret, ret2;
 
 	if (ops->xfer)
@@ -98,8 +102,14 @@ int tpm_xfer(struct udevice *dev, const uint8_t *sendbuf, size_t send_size,
 	if (ret < 0)
 		return ret;
 
+	/*
+	 * Poll for the response with a growing delay, up to the retry time
+	 * of the driver, so that quick commands are not held up by it
+	 */
 	start = get_timer(0);
 	stop = tpm_tis_i2c_calc_ordinal_duration(priv, ordinal);
+	max_us = priv->retry_time_ms * 1000;
+	delay_us = min_t(uint, max_us, TPM_POLL_MIN_US);
 	do {
 		ret = ops->recv(dev, priv->buf, sizeof(priv->buf));
 		if (ret >= 0) {
@@ -113,7 +123,8 @@ int tpm_xfer(struct udevice *dev, const uint8_t *sendbuf, size_t send_size,
 			return ret;
 		}
 
-		mdelay(priv->retry_time_ms);
+		udelay(delay_us);
+		delay_us = min(delay_us * 2, max_us);
 		if (get_timer(start) > stop) {
 			ret = -ETIMEDOUT;
 			break;
@@ -227,6 +227,7 @@ static int tpm_tis_spi_request_locality(struct udevice *dev, int loc)
 	struct tpm_chip *chip = dev_get_priv(dev);
 	unsigned long start, stop;
 	u8 buf = TPM_ACCESS_REQUEST_USE;
+	uint delay_us = 0;
 	int ret;
 
 	ret = tpm_tis_spi_check_locality(dev, loc);
@@ -259,7 +260,7 @@ static int tpm_tis_spi_request_locality(struct udevice *dev, int loc)
 			return ret;
 		}
 
-		mdelay(TPM_TIMEOUT_MS);
+		tpm_tis_backoff(&delay_us, stop);
 	} while (get_timer(start) < stop);
 
 	log(LOGC_NONE, LOGL_ERR, "%s: Timeout getting locality: %d\n", __func__,
@@ -280,46 +281,60 @@ static int tpm_tis_spi_wait_for_stat(struct udevice *dev, u8 mask,
 {
 	unsigned long start = get_timer(0);
 	unsigned long stop = timeout;
+	uint delay_us = 0;
 	int ret;
 
 	do {
-		mdelay(TPM_TIMEOUT_MS);
 		ret = tpm_tis_spi_status(dev, status);
 		if (ret)
 			return ret;
 
 		if ((*status & mask) == mask)
 			return 0;
+
+		tpm_tis_backoff(&delay_us, stop);
 	} while (get_timer(start) < stop);
 
 	return -ETIMEDOUT;
 }
 
-static int tpm_tis_spi_get_burstcount(struct udevice *dev)
+/*
+ * Wait until the status has all the bits in @mask and a non-zero burst
+ * count, which are read together in a single transfer
+ */
+static int tpm_tis_spi_wait_for_burst(struct udevice *dev, u8 mask,
+				      unsigned long timeout)
 {
 	struct tpm_chip *chip = dev_get_priv(dev);
 	unsigned long start, stop;
-	u32 burstcount, ret;
+	uint delay_us = 0;
+	u32 sts, burstcount;
+	int ret;
 
-	/* wait for burstcount */
 	start = get_timer(0);
-	stop = chip->timeout_d;
+	stop = timeout;
 	do {
-		ret = tpm_tis_spi_read32(dev, TPM_STS(chip->locality),
-					 &burstcount);
+		ret = tpm_tis_spi_read32(dev, TPM_STS(chip->locality), &sts);
 		if (ret)
 			return -EBUSY;
 
-		burstcount = (burstcount >> 8) & 0xFFFF;
-		if (burstcount)
+		burstcount = (sts >> 8) & 0xFFFF;
+		if ((sts & mask) == mask && burstcount)
 			return burstcount;
 
-		mdelay(TPM_TIMEOUT_MS);
+		tpm_tis_backoff(&delay_us, stop);
 	} while (get_timer(start) < stop);
 
 	return -EBUSY;
 }
 
+static int tpm_tis_spi_get_burstcount(struct udevice *dev)
+{
+	struct tpm_chip *chip = dev_get_priv(dev);
+
+	return tpm_tis_spi_wait_for_burst(dev, 0, chip->timeout_d);
+}
+
 static int tpm_tis_spi_cancel(struct udevice *dev)
 {
 	struct tpm_chip *chip = dev_get_priv(dev);
@@ -332,16 +347,16 @@ static int tpm_tis_spi_recv_data(struct udevice *dev, u8 *buf, size_t count)
 {
 	struct tpm_chip *chip = dev_get_priv(dev);
 	int size = 0, burstcnt, len, ret;
-	u8 status;
 
-	while (size < count &&
-	       tpm_tis_spi_wait_for_stat(dev,
-					 TPM_STS_DATA_AVAIL | TPM_STS_VALID,
-					 chip->timeout_c, &status) == 0) {
-		burstcnt = tpm_tis_spi_get_burstcount(dev);
+	while (size < count) {
+		burstcnt = tpm_tis_spi_wait_for_burst(dev,
+						      TPM_STS_DATA_AVAIL |
+						      TPM_STS_VALID,
+						      chip->timeout_c);
 		if (burstcnt < 0)
-			return burstcnt;
+			break;
 
+		/* The whole burst is read at once, split into SPI frames */
 		len = min_t(int, burstcnt, count - size);
 		ret = tpm_tis_spi_read(dev, TPM_DATA_FIFO(chip->locality),
 				       buf + size, len);
@@ -550,13 +565,14 @@ static int tpm_tis_wait_init(struct udevice *dev, int loc)
 {
 	struct tpm_chip *chip = dev_get_priv(dev);
 	unsigned long start, stop;
+	uint delay_us = 0;
 	u8 status;
 	int ret;
 
 	start = get_timer(0);
 	stop = chip->timeout_b;
 	do {
-		mdelay(TPM_TIMEOUT_MS);
+		tpm_tis_backoff(&delay_us, stop);
 
 		ret = tpm_tis_spi_read(dev, TPM_ACCESS(loc), &status, 1);
 		if (ret)
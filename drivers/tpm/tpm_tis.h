@@ -128,4 +128,24 @@ enum tis_status {
 	TPM_STS_DATA_EXPECT		= 0x08,
 };
 
+/**
+ * tpm_tis_backoff() - Wait before polling a TPM register again
+ *
+ * Most state changes are quick, so the first polls come soon after each
+ * other. The delay then doubles up to a limit set by the timing class of
+ * the wait: operations allowed the long timeout are polled less often.
+ *
+ * @delay_us: Delay before the next poll, 0 before the first one
+ * @timeout_ms: Timeout of the wait
+ */
+static inline void tpm_tis_backoff(uint *delay_us, ulong timeout_ms)
+{
+	uint max_us = TPM_TIMEOUT_MS * 1000;
+
+	if (timeout_ms < TIS_LONG_TIMEOUT_MS)
+		max_us /= 5;
+	*delay_us = *delay_us ? min(*delay_us * 2, max_us) : SLEEP_DURATION_US;
+	udelay(*delay_us);
+}
+
 #endif
@@ -227,6 +227,7 @@ static int tpm_tis_i2c_request_locality(struct udevice *dev, int loc)
 	struct tpm_chip *chip = dev_get_priv(dev);
 	unsigned long start, stop;
 	u8 buf = TPM_ACCESS_REQUEST_USE;
+	uint delay_us = 0;
 	int rc;
 
 	rc = tpm_tis_i2c_check_locality(dev, loc);
@@ -256,7 +257,7 @@ static int tpm_tis_i2c_request_locality(struct udevice *dev, int loc)
 			debug("%s: Failed to get locality: %d\n", __func__, rc);
 			return rc;
 		}
-		mdelay(TPM_TIMEOUT_MS);
+		tpm_tis_backoff(&delay_us, stop);
 	} while (get_timer(start) < stop);
 	debug("%s: Timeout getting locality: %d\n", __func__, rc);
 
@@ -295,6 +296,7 @@ static ssize_t tpm_tis_i2c_get_burstcount(struct udevice *dev)
 {
 	struct tpm_chip *chip = dev_get_priv(dev);
 	unsigned long start, stop;
+	uint delay_us = 0;
 	ssize_t burstcnt;
 	u8 addr, buf[3];
 
@@ -312,7 +314,7 @@ static ssize_t tpm_tis_i2c_get_burstcount(struct udevice *dev)
 
 		if (burstcnt)
 			return burstcnt;
-		mdelay(TPM_TIMEOUT_MS);
+		tpm_tis_backoff(&delay_us, stop);
 	} while (get_timer(start) < stop);
 
 	return -EBUSY;
@@ -322,6 +324,7 @@ static int tpm_tis_i2c_wait_for_stat(struct udevice *dev, u8 mask,
 				     unsigned long timeout, int *status)
 {
 	unsigned long start, stop;
+	uint delay_us = 0;
 
 	/* Check current status */
 	*status = tpm_tis_i2c_status(dev);
@@ -331,7 +334,7 @@ static int tpm_tis_i2c_wait_for_stat(struct udevice *dev, u8 mask,
 	start = get_timer(0);
 	stop = timeout;
 	do {
-		mdelay(TPM_TIMEOUT_MS);
+		tpm_tis_backoff(&delay_us, stop);
 		*status = tpm_tis_i2c_status(dev);
 		if ((*status & mask) == mask)
 			return 0;
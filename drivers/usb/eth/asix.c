@@ -748,7 +748,11 @@ static int asix_eth_start(struct udevice *dev)
 
 void asix_eth_stop(struct udevice *dev)
 {
+	struct asix_private *priv = dev_get_priv(dev);
+
 	debug("** %s()\n", __func__);
+
+	usb_ether_stop_receive(&priv->ueth);
 }
 
 int asix_eth_send(struct udevice *dev, void *packet, int length)
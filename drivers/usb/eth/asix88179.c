@@ -172,7 +172,8 @@
 #define USB_BULK_SEND_TIMEOUT 5000
 #define USB_BULK_RECV_TIMEOUT 5000
 
-#define AX_RX_URB_SIZE 1024 * 0x12
+/* Largest bulk IN transfer, for the biggest size in AX88179_BULKIN_SIZE */
+#define AX_RX_URB_SIZE (1024 * (0x18 + 2))
 #define BLK_FRAME_SIZE 0x200
 #define PHY_CONNECT_TIMEOUT 5000
 
@@ -187,14 +188,19 @@
 #define FLAG_TYPE_LENOVO	(1U << 5)
 #define FLAG_TYPE_GX3		(1U << 6)
 
-/* local vars */
+/*
+ * local vars
+ *
+ * The device aggregates frames into bulk IN transfers of up to
+ * (size + 2) KB, the same limits as Linux
+ */
 static const struct {
 	unsigned char ctrl, timer_l, timer_h, size, ifg;
 } AX88179_BULKIN_SIZE[] =	{
-	{7, 0x4f, 0,	0x02, 0xff},
-	{7, 0x20, 3,	0x03, 0xff},
-	{7, 0xae, 7,	0x04, 0xff},
-	{7, 0xcc, 0x4c, 0x04, 8},
+	{7, 0x4f, 0,	0x12, 0xff},
+	{7, 0x20, 3,	0x16, 0xff},
+	{7, 0xae, 7,	0x18, 0xff},
+	{7, 0xcc, 0x4c, 0x18, 8},
 };
 
 #ifndef CONFIG_DM_ETH
@@ -316,7 +322,7 @@ static int asix_basic_reset(struct ueth_data *dev,
 	memcpy(tmp, &AX88179_BULKIN_SIZE[0], 5);
 	asix_write_cmd(dev, AX_ACCESS_MAC, AX_RX_BULKIN_QCTRL, 5, 5, tmp);
 
-	dev_priv->rx_urb_size = 128 * 20;
+	dev_priv->rx_urb_size = 1024 * (tmp[3] + 2);
 
 	/* Water Level configuration */
 	*tmp = 0x34;
@@ -760,6 +766,7 @@ void ax88179_eth_stop(struct udevice *dev)
 
 	debug("** %s()\n", __func__);
 
+	usb_ether_stop_receive(ueth);
 	usb_ether_advance_rxbuf(ueth, -1);
 	priv->pkt_cnt = 0;
 	priv->pkt_data = NULL;
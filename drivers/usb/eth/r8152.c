@@ -469,7 +469,9 @@ static void r8153_set_rx_early_timeout(struct r8152 *tp)
 
 static void r8153_set_rx_early_size(struct r8152 *tp)
 {
-	u32 ocp_data = (RTL8152_AGG_BUF_SZ - RTL8153_RMS) / 4;
+	/* Leave room for one more frame and its descriptor */
+	u32 ocp_data = (RTL8152_AGG_BUF_SZ - RTL8153_RMS -
+			sizeof(struct rx_desc) - RX_ALIGN) / 4;
 
 	ocp_write_word(tp, MCU_TYPE_USB, USB_RX_EARLY_SIZE, ocp_data);
 }
@@ -1491,6 +1493,7 @@ void r8152_eth_stop(struct udevice *dev)
 	debug("** %s (%d)\n", __func__, __LINE__);
 
 	tp->rtl_ops.disable(tp);
+	usb_ether_stop_receive(&tp->ueth);
 }
 
 int r8152_eth_send(struct udevice *dev, void *packet, int length)
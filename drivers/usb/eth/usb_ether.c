@@ -15,6 +15,7 @@
 #ifdef CONFIG_DM_ETH
 
 #define USB_BULK_RECV_TIMEOUT 500
+#define USB_ETHER_RX_QUEUE	4	/* bulk IN transfers kept queued */
 
 int usb_ether_register(struct udevice *dev, struct ueth_data *ueth, int rxsize)
 {
@@ -89,9 +90,122 @@ int usb_ether_register(struct udevice *dev, struct ueth_data *ueth, int rxsize)
 
 int usb_ether_deregister(struct ueth_data *ueth)
 {
+	usb_ether_stop_receive(ueth);
+
+	return 0;
+}
+
+void usb_ether_stop_receive(struct ueth_data *ueth)
+{
+#if CONFIG_IS_ENABLED(DM_USB)
+	if (!ueth->rxq)
+		return;
+
+	usb_cancel_stream_xfers(ueth->pusb_dev,
+				usb_rcvbulkpipe(ueth->pusb_dev, ueth->ep_in));
+	free(ueth->rxq_bufs);
+	free(ueth->rxq);
+	ueth->rxq = NULL;
+	ueth->rxlen = 0;
+#endif
+}
+
+#if CONFIG_IS_ENABLED(DM_USB)
+static int usb_ether_queue_start(struct ueth_data *ueth, int rxsize)
+{
+	int stride = ALIGN(rxsize, ARCH_DMA_MINALIGN);
+	struct usb_stream_xfer *xfer;
+	int i, ret;
+
+	ueth->rxq = calloc(USB_ETHER_RX_QUEUE, sizeof(*ueth->rxq));
+	ueth->rxq_bufs = memalign(ARCH_DMA_MINALIGN,
+				  USB_ETHER_RX_QUEUE * stride);
+	if (!ueth->rxq || !ueth->rxq_bufs) {
+		free(ueth->rxq_bufs);
+		free(ueth->rxq);
+		ueth->rxq = NULL;
+		return -ENOMEM;
+	}
+	ueth->rxq_len = rxsize;
+	ueth->rxq_head = 0;
+	ueth->rxq_held = false;
+
+	for (i = 0; i < USB_ETHER_RX_QUEUE; i++) {
+		xfer = &ueth->rxq[i];
+		xfer->pipe = usb_rcvbulkpipe(ueth->pusb_dev, ueth->ep_in);
+		xfer->buffer = ueth->rxq_bufs + i * stride;
+		xfer->length = rxsize;
+		ret = usb_submit_stream_xfer(ueth->pusb_dev, xfer);
+		if (ret) {
+			usb_ether_stop_receive(ueth);
+			return ret;
+		}
+	}
+
 	return 0;
 }
 
+/* Requeue the head transfer, whose data we are done with */
+static int usb_ether_queue_next(struct ueth_data *ueth)
+{
+	int ret;
+
+	ret = usb_submit_stream_xfer(ueth->pusb_dev,
+				     &ueth->rxq[ueth->rxq_head]);
+	if (ret) {
+		usb_ether_stop_receive(ueth);
+		return ret;
+	}
+	ueth->rxq_head = (ueth->rxq_head + 1) % USB_ETHER_RX_QUEUE;
+	ueth->rxq_held = false;
+
+	return 0;
+}
+
+/*
+ * Packets go to whichever of the queued transfers is the oldest, while we
+ * go through the data of the one before. Returns -ENOSYS if the controller
+ * can't queue transfers.
+ */
+static int usb_ether_queue_receive(struct ueth_data *ueth, int rxsize)
+{
+	struct usb_stream_xfer *xfer;
+	int ret;
+
+	if (ueth->rxq && ueth->rxq_len != rxsize)
+		usb_ether_stop_receive(ueth);
+	if (!ueth->rxq) {
+		ret = usb_ether_queue_start(ueth, rxsize);
+		if (ret)
+			return ret;
+	} else if (ueth->rxq_held) {
+		ret = usb_ether_queue_next(ueth);
+		if (ret)
+			return ret;
+	}
+
+	xfer = &ueth->rxq[ueth->rxq_head];
+	if (!xfer->done)
+		usb_poll_stream_xfers(ueth->pusb_dev);
+	if (!xfer->done)
+		return -EAGAIN;
+	debug("Rx: len = %u, actual = %u, status = %lx\n", rxsize,
+	      xfer->act_len, xfer->status);
+	if (xfer->status) {
+		printf("Rx: failed to receive: %lx\n", xfer->status);
+		usb_ether_stop_receive(ueth);
+		return -EIO;
+	}
+
+	ueth->rxdata = xfer->buffer;
+	ueth->rxlen = xfer->act_len;
+	ueth->rxptr = 0;
+	ueth->rxq_held = true;
+
+	return xfer->act_len ? 0 : -EAGAIN;
+}
+#endif
+
 int usb_ether_receive(struct ueth_data *ueth, int rxsize)
 {
 	int actual_len;
@@ -99,6 +213,14 @@ int usb_ether_receive(struct ueth_data *ueth, int rxsize)
 
 	if (rxsize > ueth->rxsize)
 		return -EINVAL;
+#if CONFIG_IS_ENABLED(DM_USB)
+	if (!ueth->rxq_off) {
+		ret = usb_ether_queue_receive(ueth, rxsize);
+		if (ret != -ENOSYS)
+			return ret;
+		ueth->rxq_off = true;
+	}
+#endif
 	ret = usb_bulk_msg(ueth->pusb_dev,
 			   usb_rcvbulkpipe(ueth->pusb_dev, ueth->ep_in),
 			   ueth->rxbuf, rxsize, &actual_len,
@@ -112,6 +234,7 @@ int usb_ether_receive(struct ueth_data *ueth, int rxsize)
 		debug("Rx: received too many bytes %d\n", actual_len);
 		return -ENOSPC;
 	}
+	ueth->rxdata = ueth->rxbuf;
 	ueth->rxlen = actual_len;
 	ueth->rxptr = 0;
 
@@ -130,7 +253,7 @@ int usb_ether_get_rx_bytes(struct ueth_data *ueth, uint8_t **ptrp)
 	if (!ueth->rxlen)
 		return 0;
 
-	*ptrp = &ueth->rxbuf[ueth->rxptr];
+	*ptrp = &ueth->rxdata[ueth->rxptr];
 
 	return ueth->rxlen - ueth->rxptr;
 }
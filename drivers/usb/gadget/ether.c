@@ -34,9 +34,6 @@
 #define atomic_read
 extern struct platform_data brd;
 
-
-unsigned packet_received, packet_sent;
-
 /*
  * Ethernet gadget driver -- with CDC and non-CDC options
  * Builds on hardware support for a full duplex link.
@@ -80,6 +77,16 @@ static const char driver_desc[] = DRIVER_DESC;
 
 #define RX_EXTRA	20		/* guard against rx overflows */
 
+/*
+ * Up to ETH_MAX_QLEN requests are queued in each direction, so the host
+ * can send and receive several packets without waiting for U-Boot.
+ * Each request has its own buffer, large enough for a full frame, the
+ * RNDIS header and rounding up to the bulk maxpacket.
+ */
+#define ETH_MAX_QLEN	8
+#define ETH_BUF_SIZE	ALIGN(ETHER_HDR_SIZE + PKTSIZE_ALIGN + RX_EXTRA + \
+				sizeof(struct rndis_packet_msg_type), 1024)
+
 #ifndef	CONFIG_USB_ETH_RNDIS
 #define rndis_uninit(x)		do {} while (0)
 #define rndis_deregister(c)	do {} while (0)
@@ -106,7 +113,13 @@ struct eth_dev {
 	const struct usb_endpoint_descriptor
 				*in, *out, *status;
 
-	struct usb_request	*tx_req, *rx_req;
+	struct usb_request	*tx_reqs[ETH_MAX_QLEN];
+	struct usb_request	*rx_reqs[ETH_MAX_QLEN];
+	unsigned int		qlen;		/* requests in each direction */
+	unsigned int		tx_busy;	/* mask of queued tx_reqs */
+	/* received packets not yet handed to the network stack */
+	struct usb_request	*rx_done[ETH_MAX_QLEN];
+	unsigned int		rx_head, rx_count;
 
 #ifndef CONFIG_DM_ETH
 	struct eth_device	*net;
@@ -868,6 +881,9 @@ DEFINE_CACHE_ALIGN_BUFFER(u8, control_req, USB_BUFSIZ);
 DEFINE_CACHE_ALIGN_BUFFER(u8, status_req, STATUS_BYTECOUNT);
 #endif
 
+DEFINE_CACHE_ALIGN_BUFFER(u8, tx_bufs, ETH_MAX_QLEN * ETH_BUF_SIZE);
+DEFINE_CACHE_ALIGN_BUFFER(u8, rx_bufs, ETH_MAX_QLEN * ETH_BUF_SIZE);
+
 /*============================================================================*/
 
 /*
@@ -922,6 +938,7 @@ config_buf(struct usb_gadget *g, u8 *buf, u8 type, unsigned index, int is_otg)
 
 static void eth_start(struct eth_dev *dev, gfp_t gfp_flags);
 static int alloc_requests(struct eth_dev *dev, unsigned n, gfp_t gfp_flags);
+static void free_requests(struct eth_dev *dev);
 
 static int
 set_ether_config(struct eth_dev *dev, gfp_t gfp_flags)
@@ -1015,20 +1032,11 @@ static void eth_reset_config(struct eth_dev *dev)
 	 * pending i/o.  then free the requests.
 	 */
 
-	if (dev->in) {
+	if (dev->in)
 		usb_ep_disable(dev->in_ep);
-		if (dev->tx_req) {
-			usb_ep_free_request(dev->in_ep, dev->tx_req);
-			dev->tx_req = NULL;
-		}
-	}
-	if (dev->out) {
+	if (dev->out)
 		usb_ep_disable(dev->out_ep);
-		if (dev->rx_req) {
-			usb_ep_free_request(dev->out_ep, dev->rx_req);
-			dev->rx_req = NULL;
-		}
-	}
+	free_requests(dev);
 	if (dev->status)
 		usb_ep_disable(dev->status_ep);
 
@@ -1539,7 +1547,6 @@ static int rx_submit(struct eth_dev *dev, struct usb_request *req,
 	 * RNDIS headers involve variable numbers of LE32 values.
 	 */
 
-	req->buf = (u8 *)net_rx_packets[0];
 	req->length = size;
 	req->complete = rx_complete;
 
@@ -1577,14 +1584,19 @@ length_err:
 
 		dev->stats.rx_packets++;
 		dev->stats.rx_bytes += req->length;
-		break;
+
+		/* hold the request until the network stack is done with it */
+		dev->rx_done[(dev->rx_head + dev->rx_count) % ETH_MAX_QLEN] =
+			req;
+		dev->rx_count++;
+		return;
 
 	/* software-driven interface shutdown */
 	case -ECONNRESET:		/* unlink */
 	case -ESHUTDOWN:		/* disconnect etc */
 	/* for hardware automagic (such as pxa) */
 	case -ECONNABORTED:		/* endpoint reset */
-		break;
+		return;
 
 	/* data overrun */
 	case -EOVERFLOW:
@@ -1595,34 +1607,94 @@ length_err:
 		break;
 	}
 
-	packet_received = 1;
+	/* nothing to hand over, the request can be used again right away */
+	rx_submit(dev, req, GFP_ATOMIC);
 }
 
-static int alloc_requests(struct eth_dev *dev, unsigned n, gfp_t gfp_flags)
+/* Oldest received packet, or NULL if there is none */
+static struct usb_request *rx_peek(struct eth_dev *dev)
 {
+	return dev->rx_count ? dev->rx_done[dev->rx_head] : NULL;
+}
+
+/* Queue the request of the oldest received packet again */
+static int rx_release(struct eth_dev *dev)
+{
+	struct usb_request *req = rx_peek(dev);
+
+	if (!req)
+		return 0;
+	dev->rx_head = (dev->rx_head + 1) % ETH_MAX_QLEN;
+	dev->rx_count--;
 
-	dev->tx_req = usb_ep_alloc_request(dev->in_ep, 0);
+	return rx_submit(dev, req, 0);
+}
 
-	if (!dev->tx_req)
-		goto fail1;
+static int alloc_requests(struct eth_dev *dev, unsigned n, gfp_t gfp_flags)
+{
+	unsigned int i;
 
-	dev->rx_req = usb_ep_alloc_request(dev->out_ep, 0);
+	dev->qlen = min_t(unsigned int, n, ETH_MAX_QLEN);
+	for (i = 0; i < dev->qlen; i++) {
+		dev->tx_reqs[i] = usb_ep_alloc_request(dev->in_ep, 0);
+		if (!dev->tx_reqs[i])
+			goto fail;
+		dev->tx_reqs[i]->buf = tx_bufs + i * ETH_BUF_SIZE;
 
-	if (!dev->rx_req)
-		goto fail2;
+		dev->rx_reqs[i] = usb_ep_alloc_request(dev->out_ep, 0);
+		if (!dev->rx_reqs[i])
+			goto fail;
+		dev->rx_reqs[i]->buf = rx_bufs + i * ETH_BUF_SIZE;
+	}
+	dev->tx_busy = 0;
+	dev->tx_qlen = 0;
+	dev->rx_head = 0;
+	dev->rx_count = 0;
 
 	return 0;
 
-fail2:
-	usb_ep_free_request(dev->in_ep, dev->tx_req);
-fail1:
+fail:
+	free_requests(dev);
 	pr_err("can't alloc requests");
 	return -1;
 }
 
+static void free_requests(struct eth_dev *dev)
+{
+	unsigned int i;
+
+	for (i = 0; i < ETH_MAX_QLEN; i++) {
+		if (dev->tx_reqs[i]) {
+			usb_ep_free_request(dev->in_ep, dev->tx_reqs[i]);
+			dev->tx_reqs[i] = NULL;
+		}
+		if (dev->rx_reqs[i]) {
+			usb_ep_free_request(dev->out_ep, dev->rx_reqs[i]);
+			dev->rx_reqs[i] = NULL;
+		}
+	}
+	dev->qlen = 0;
+	dev->tx_busy = 0;
+	dev->rx_count = 0;
+}
+
+/* Index of a tx request which is not queued, or -1 if they all are */
+static int tx_get(struct eth_dev *dev)
+{
+	int i;
+
+	for (i = 0; i < dev->qlen; i++) {
+		if (!(dev->tx_busy & BIT(i)))
+			return i;
+	}
+
+	return -1;
+}
+
 static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct eth_dev	*dev = ep->driver_data;
+	unsigned int	i;
 
 	debug("%s: status %s\n", __func__, (req->status) ? "failed" : "ok");
 	switch (req->status) {
@@ -1638,7 +1710,12 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 	}
 	dev->stats.tx_packets++;
 
-	packet_sent = 1;
+	for (i = 0; i < dev->qlen; i++) {
+		if (dev->tx_reqs[i] == req) {
+			dev->tx_busy &= ~BIT(i);
+			dev->tx_qlen--;
+		}
+	}
 }
 
 static inline int eth_is_promisc(struct eth_dev *dev)
@@ -1780,15 +1857,7 @@ static void eth_unbind(struct usb_gadget *gadget)
 		dev->stat_req = NULL;
 	}
 
-	if (dev->tx_req) {
-		usb_ep_free_request(dev->in_ep, dev->tx_req);
-		dev->tx_req = NULL;
-	}
-
-	if (dev->rx_req) {
-		usb_ep_free_request(dev->out_ep, dev->rx_req);
-		dev->rx_req = NULL;
-	}
+	free_requests(dev);
 
 /*	unregister_netdev (dev->net);*/
 /*	free_netdev(dev->net);*/
@@ -2340,6 +2409,7 @@ static int _usb_eth_init(struct ether_priv *priv)
 	struct eth_dev *dev = &priv->ethdev;
 	struct usb_gadget *gadget;
 	unsigned long ts;
+	unsigned int i;
 	int ret;
 	unsigned long timeout = USB_CONNECT_TIMEOUT;
 
@@ -2385,9 +2455,6 @@ static int _usb_eth_init(struct ether_priv *priv)
 
 	dev->network_started = 0;
 
-	packet_received = 0;
-	packet_sent = 0;
-
 	gadget = dev->gadget;
 	usb_gadget_connect(gadget);
 
@@ -2404,8 +2471,8 @@ static int _usb_eth_init(struct ether_priv *priv)
 		usb_gadget_handle_interrupts(0);
 	}
 
-	packet_received = 0;
-	rx_submit(dev, dev->rx_req, 0);
+	for (i = 0; i < dev->qlen; i++)
+		rx_submit(dev, dev->rx_reqs[i], 0);
 	return 0;
 fail:
 	_usb_eth_halt(priv);
@@ -2415,29 +2482,39 @@ fail:
 static int _usb_eth_send(struct ether_priv *priv, void *packet, int length)
 {
 	int			retval;
-	void			*rndis_pkt = NULL;
 	struct eth_dev		*dev = &priv->ethdev;
-	struct usb_request	*req = dev->tx_req;
+	struct usb_request	*req;
 	unsigned long ts;
 	unsigned long timeout = USB_CONNECT_TIMEOUT;
+	int i;
 
 	debug("%s:...\n", __func__);
 
-	/* new buffer is needed to include RNDIS header */
-	if (rndis_active(dev)) {
-		rndis_pkt = malloc(length +
-					sizeof(struct rndis_packet_msg_type));
-		if (!rndis_pkt) {
-			pr_err("No memory to alloc RNDIS packet");
-			goto drop;
+	if (length > PKTSIZE_ALIGN) {
+		dev->stats.tx_dropped++;
+		return -EINVAL;
+	}
+
+	/* wait only if the host has not collected any queued packet yet */
+	ts = get_timer(0);
+	while ((i = tx_get(dev)) < 0) {
+		if (!dev->qlen || get_timer(ts) > timeout) {
+			printf("timeout sending packets to usb ethernet\n");
+			return -1;
 		}
-		rndis_add_hdr(rndis_pkt, length);
-		memcpy(rndis_pkt + sizeof(struct rndis_packet_msg_type),
-				packet, length);
-		packet = rndis_pkt;
+		usb_gadget_handle_interrupts(0);
+	}
+	req = dev->tx_reqs[i];
+
+	/* the packet is copied, with the RNDIS header in front if needed */
+	if (rndis_active(dev)) {
+		rndis_add_hdr(req->buf, length);
+		memcpy(req->buf + sizeof(struct rndis_packet_msg_type),
+		       packet, length);
 		length += sizeof(struct rndis_packet_msg_type);
+	} else {
+		memcpy(req->buf, packet, length);
 	}
-	req->buf = packet;
 	req->context = NULL;
 	req->complete = tx_complete;
 
@@ -2457,28 +2534,18 @@ static int _usb_eth_send(struct ether_priv *priv, void *packet, int length)
 		req->no_interrupt = (dev->gadget->speed == USB_SPEED_HIGH)
 			? ((dev->tx_qlen % qmult) != 0) : 0;
 #endif
-	dev->tx_qlen = 1;
-	ts = get_timer(0);
-	packet_sent = 0;
-
+	dev->tx_busy |= BIT(i);
+	dev->tx_qlen++;
 	retval = usb_ep_queue(dev->in_ep, req, GFP_ATOMIC);
-
-	if (!retval)
-		debug("%s: packet queued\n", __func__);
-	while (!packet_sent) {
-		if (get_timer(ts) > timeout) {
-			printf("timeout sending packets to usb ethernet\n");
-			return -1;
-		}
-		usb_gadget_handle_interrupts(0);
+	if (retval) {
+		dev->tx_busy &= ~BIT(i);
+		dev->tx_qlen--;
+		dev->stats.tx_dropped++;
+		return retval;
 	}
-	if (rndis_pkt)
-		free(rndis_pkt);
+	debug("%s: packet queued\n", __func__);
 
 	return 0;
-drop:
-	dev->stats.tx_dropped++;
-	return -ENOMEM;
 }
 
 static int _usb_eth_recv(struct ether_priv *priv)
@@ -2491,11 +2558,18 @@ static int _usb_eth_recv(struct ether_priv *priv)
 static void _usb_eth_halt(struct ether_priv *priv)
 {
 	struct eth_dev *dev = &priv->ethdev;
+	unsigned long ts;
 
 	/* If the gadget not registered, simple return */
 	if (!dev->gadget)
 		return;
 
+	/* Give the host a chance to collect the packets still queued */
+	ts = get_timer(0);
+	while (dev->network_started && dev->tx_busy &&
+	       get_timer(ts) < CONFIG_SYS_HZ)
+		usb_gadget_handle_interrupts(0);
+
 	/*
 	 * Some USB controllers may need additional deinitialization here
 	 * before dropping pull-up (also due to hardware issues).
@@ -2540,6 +2614,7 @@ static int usb_eth_recv(struct eth_device *netdev)
 {
 	struct ether_priv *priv = (struct ether_priv *)netdev->priv;
 	struct eth_dev *dev = &priv->ethdev;
+	struct usb_request *req;
 	int ret;
 
 	ret = _usb_eth_recv(priv);
@@ -2548,17 +2623,10 @@ static int usb_eth_recv(struct eth_device *netdev)
 		return ret;
 	}
 
-	if (!packet_received)
-		return 0;
-
-	if (dev->rx_req) {
-		net_process_received_packet(net_rx_packets[0],
-					    dev->rx_req->length);
-	} else {
-		pr_err("dev->rx_req invalid");
+	while ((req = rx_peek(dev))) {
+		net_process_received_packet(req->buf, req->actual);
+		rx_release(dev);
 	}
-	packet_received = 0;
-	rx_submit(dev, dev->rx_req, 0);
 
 	return 0;
 }
@@ -2604,6 +2672,7 @@ static int usb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct ether_priv *priv = dev_get_priv(dev);
 	struct eth_dev *ethdev = &priv->ethdev;
+	struct usb_request *req;
 	int ret;
 
 	ret = _usb_eth_recv(priv);
@@ -2612,17 +2681,12 @@ static int usb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		return ret;
 	}
 
-	if (packet_received) {
-		if (ethdev->rx_req) {
-			*packetp = (uchar *)net_rx_packets[0];
-			return ethdev->rx_req->length;
-		} else {
-			pr_err("dev->rx_req invalid");
-			return -EFAULT;
-		}
-	}
+	req = rx_peek(ethdev);
+	if (!req)
+		return -EAGAIN;
+	*packetp = req->buf;
 
-	return -EAGAIN;
+	return req->actual;
 }
 
 static int usb_eth_free_pkt(struct udevice *dev, uchar *packet,
@@ -2631,9 +2695,7 @@ static int usb_eth_free_pkt(struct udevice *dev, uchar *packet,
 	struct ether_priv *priv = dev_get_priv(dev);
 	struct eth_dev *ethdev = &priv->ethdev;
 
-	packet_received = 0;
-
-	return rx_submit(ethdev, ethdev->rx_req, 0);
+	return rx_release(ethdev);
 }
 
 static void usb_eth_stop(struct udevice *dev)
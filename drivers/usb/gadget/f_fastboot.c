@@ -35,12 +35,29 @@
  * that expect bulk OUT requests to be divisible by maxpacket size.
  */
 
+#if CONFIG_IS_ENABLED(FASTBOOT_USB_DL_MULTI_REQ)
+#define DL_REQ_SIZE		CONFIG_FASTBOOT_USB_DL_REQ_SIZE
+#define DL_REQS			CONFIG_FASTBOOT_USB_DL_REQS
+
+/* A request which receives download data */
+struct fastboot_dl_req {
+	struct usb_request *req;
+	void *bounce;		/* for data which can't be received in place */
+	bool queued;
+};
+#endif
+
 struct f_fastboot {
 	struct usb_function usb_function;
 
 	/* IN/OUT EP's and corresponding requests */
 	struct usb_ep *in_ep, *out_ep;
 	struct usb_request *in_req, *out_req;
+#if CONFIG_IS_ENABLED(FASTBOOT_USB_DL_MULTI_REQ)
+	/* The download requests, queued in order, and where the next goes */
+	struct fastboot_dl_req dl[DL_REQS];
+	u32 dl_offset;
+#endif
 };
 
 static inline struct f_fastboot *func_to_fastboot(struct usb_function *f)
@@ -213,6 +230,20 @@ static void fastboot_disable(struct usb_function *f)
 		usb_ep_free_request(f_fb->in_ep, f_fb->in_req);
 		f_fb->in_req = NULL;
 	}
+#if CONFIG_IS_ENABLED(FASTBOOT_USB_DL_MULTI_REQ)
+	{
+		struct fastboot_dl_req *dl;
+		int i;
+
+		for (i = 0; i < DL_REQS; i++) {
+			dl = &f_fb->dl[i];
+			if (dl->req)
+				usb_ep_free_request(f_fb->out_ep, dl->req);
+			free(dl->bounce);
+			memset(dl, '\0', sizeof(*dl));
+		}
+	}
+#endif
 }
 
 static struct usb_request *fastboot_start_ep(struct usb_ep *ep)
@@ -234,6 +265,28 @@ static struct usb_request *fastboot_start_ep(struct usb_ep *ep)
 	return req;
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_USB_DL_MULTI_REQ)
+static void rx_handler_dl_req(struct usb_ep *ep, struct usb_request *req);
+
+static int fastboot_alloc_dl_reqs(struct f_fastboot *f_fb)
+{
+	struct fastboot_dl_req *dl;
+	int i;
+
+	for (i = 0; i < DL_REQS; i++) {
+		dl = &f_fb->dl[i];
+		dl->req = usb_ep_alloc_request(f_fb->out_ep, 0);
+		dl->bounce = memalign(CONFIG_SYS_CACHELINE_SIZE, DL_REQ_SIZE);
+		if (!dl->req || !dl->bounce)
+			return -ENOMEM;
+		dl->req->complete = rx_handler_dl_req;
+		dl->req->context = dl;
+	}
+
+	return 0;
+}
+#endif
+
 static int fastboot_set_alt(struct usb_function *f,
 			    unsigned interface, unsigned alt)
 {
@@ -261,6 +314,14 @@ static int fastboot_set_alt(struct usb_function *f,
 	}
 	f_fb->out_req->complete = rx_handler_command;
 
+#if CONFIG_IS_ENABLED(FASTBOOT_USB_DL_MULTI_REQ)
+	ret = fastboot_alloc_dl_reqs(f_fb);
+	if (ret) {
+		puts("failed to alloc download reqs\n");
+		goto err;
+	}
+#endif
+
 	d = fb_ep_desc(gadget, &fs_ep_in, &hs_ep_in);
 	ret = usb_ep_enable(f_fb->in_ep, d);
 	if (ret) {
@@ -345,6 +406,7 @@ static void compl_do_reset(struct usb_ep *ep, struct usb_request *req)
 	do_reset(NULL, 0, 0, NULL);
 }
 
+#if !CONFIG_IS_ENABLED(FASTBOOT_USB_DL_MULTI_REQ)
 static unsigned int rx_bytes_expected(struct usb_ep *ep)
 {
 	int rx_remain = fastboot_data_remaining();
@@ -403,8 +465,116 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 
 	req->actual = 0;
 	usb_ep_queue(ep, req, 0);
+
+	/* Write out what has arrived while the next data comes in */
+	fastboot_data_flush();
+}
+#endif
+
+#if CONFIG_IS_ENABLED(FASTBOOT_USB_DL_MULTI_REQ)
+/*
+ * Keep the download requests queued, each asking for the data after the
+ * one before. As far as it fits, the data is received straight into the
+ * download buffer; fastboot_data_download() moves it down if the host
+ * sent a short packet.
+ */
+static void fastboot_dl_queue(struct usb_ep *ep)
+{
+	struct f_fastboot *f_fb = fastboot_func;
+	unsigned int maxpacket = ep->maxpacket;
+	struct fastboot_dl_req *dl;
+	u32 outstanding = 0;
+	u32 remaining;
+	u32 len;
+	int i;
+
+	for (i = 0; i < DL_REQS; i++) {
+		if (f_fb->dl[i].queued)
+			outstanding += f_fb->dl[i].req->length;
+	}
+
+	for (i = 0; i < DL_REQS; i++) {
+		dl = &f_fb->dl[i];
+		remaining = fastboot_data_remaining();
+		if (remaining <= outstanding)
+			break;
+		if (dl->queued)
+			continue;
+
+		len = min_t(u32, remaining - outstanding, DL_REQ_SIZE);
+		len = roundup(len, maxpacket);
+		dl->req->buf = fastboot_data_addr(f_fb->dl_offset, len);
+		if (!dl->req->buf)
+			dl->req->buf = dl->bounce;
+		dl->req->length = len;
+		dl->req->actual = 0;
+		if (usb_ep_queue(ep, dl->req, 0)) {
+			puts("failed to queue download req\n");
+			break;
+		}
+		dl->queued = true;
+		f_fb->dl_offset += len;
+		outstanding += len;
+	}
 }
 
+/* Cancel the requests that are left when the download is complete */
+static void fastboot_dl_cancel(struct usb_ep *ep)
+{
+	struct fastboot_dl_req *dl;
+	int i;
+
+	for (i = 0; i < DL_REQS; i++) {
+		dl = &fastboot_func->dl[i];
+		if (dl->queued) {
+			dl->queued = false;
+			usb_ep_dequeue(ep, dl->req);
+		}
+	}
+}
+
+static void rx_handler_dl_req(struct usb_ep *ep, struct usb_request *req)
+{
+	char response[FASTBOOT_RESPONSE_LEN] = {0};
+	struct fastboot_dl_req *dl = req->context;
+	struct usb_request *out_req = fastboot_func->out_req;
+	unsigned int transfer_size = fastboot_data_remaining();
+
+	/* Cancelled by fastboot_dl_cancel() */
+	if (!dl->queued)
+		return;
+	dl->queued = false;
+
+	if (req->status != 0) {
+		printf("Bad status: %d\n", req->status);
+		return;
+	}
+
+	if (req->actual < transfer_size)
+		transfer_size = req->actual;
+
+	fastboot_data_download(req->buf, transfer_size, response);
+	if (response[0]) {
+		fastboot_tx_write_str(response);
+	} else if (!fastboot_data_remaining()) {
+		fastboot_data_complete(response);
+		fastboot_dl_cancel(ep);
+
+		out_req->complete = rx_handler_command;
+		out_req->length = EP_BUFFER_SIZE;
+		out_req->actual = 0;
+		usb_ep_queue(ep, out_req, 0);
+
+		fastboot_tx_write_str(response);
+	} else {
+		fastboot_dl_queue(ep);
+	}
+
+	/* Write out what has arrived while the next data comes in */
+	fastboot_data_flush();
+}
+#endif
+
 static void do_exit_on_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	g_dnl_trigger_detach();
@@ -434,8 +604,17 @@ static void rx_handler_command(struct usb_ep *ep, struct usb_request *req)
 	}
 
 	if (!strncmp("DATA", response, 4)) {
+#if CONFIG_IS_ENABLED(FASTBOOT_USB_DL_MULTI_REQ)
+		/* The download requests take over until the data is in */
+		fastboot_func->dl_offset = 0;
+		fastboot_dl_queue(ep);
+		fastboot_tx_write_str(response);
+		*cmdbuf = '\0';
+		return;
+#else
 		req->complete = rx_handler_dl_image;
 		req->length = rx_bytes_expected(ep);
+#endif
 	}
 
 	fastboot_tx_write_str(response);
@@ -300,6 +300,13 @@ struct fsg_common {
 	struct fsg_buffhd	*next_buffhd_to_drain;
 	struct fsg_buffhd	buffhds[FSG_NUM_BUFFERS];
 
+	/* Sequential read-ahead, filled while waiting for the next CBW */
+	void			*ra_buf;
+	unsigned int		ra_lun;
+	loff_t			ra_offset;	/* Where the last READ ended */
+	u32			ra_len;		/* Valid bytes in ra_buf */
+	u32			ra_want;	/* Bytes to read ahead, or 0 */
+
 	int			cmnd_size;
 	u8			cmnd[MAX_COMMAND_SIZE];
 
@@ -680,6 +687,51 @@ static int sleep_thread(struct fsg_common *common)
 
 /*-------------------------------------------------------------------------*/
 
+/* Read the data the host is expected to ask for next.  This runs while the
+ * reply to the previous READ is still being sent, so the medium and the
+ * UDC work in parallel. */
+static void fsg_read_ahead(struct fsg_common *common)
+{
+	struct fsg_lun		*curlun = &common->luns[common->ra_lun];
+	u32			sector = common->ra_offset / SECTOR_SIZE;
+	u32			count = common->ra_want / SECTOR_SIZE;
+	int			rc;
+
+	common->ra_want = 0;
+	common->ra_len = 0;
+	if (sector >= curlun->num_sectors)
+		return;
+
+	count = min_t(u32, count, curlun->num_sectors - sector);
+	rc = ums[common->ra_lun].read_sector(&ums[common->ra_lun], sector,
+					     count, common->ra_buf);
+	if (rc > 0)
+		common->ra_len = rc * SECTOR_SIZE;
+}
+
+/* Hand the read-ahead buffer over to @bh if it holds the data at
+ * @file_offset, trimming @amount to what was read ahead. */
+static bool fsg_take_read_ahead(struct fsg_common *common,
+				struct fsg_buffhd *bh, loff_t file_offset,
+				unsigned int *amount)
+{
+	void			*buf;
+
+	if (!common->ra_len || common->ra_lun != common->lun ||
+	    common->ra_offset != file_offset)
+		return false;
+
+	*amount = min(*amount, common->ra_len);
+	common->ra_len = 0;
+
+	buf = bh->buf;
+	bh->buf = common->ra_buf;
+	common->ra_buf = buf;
+	bh->inreq->buf = bh->outreq->buf = bh->buf;
+
+	return true;
+}
+
 static int do_read(struct fsg_common *common)
 {
 	struct fsg_lun		*curlun = &common->luns[common->lun];
@@ -691,6 +743,7 @@ static int do_read(struct fsg_common *common)
 	unsigned int		amount;
 	unsigned int		partial_page;
 	ssize_t			nread;
+	bool			sequential;
 
 	/* Get the starting Logical Block Address and check that it's
 	 * not too big */
@@ -718,6 +771,10 @@ static int do_read(struct fsg_common *common)
 	if (unlikely(amount_left == 0))
 		return -EIO;		/* No default reply */
 
+	/* Did this READ pick up where the previous one ended? */
+	sequential = common->ra_lun == common->lun &&
+		     common->ra_offset == file_offset;
+
 	for (;;) {
 
 		/* Figure out how much we need to read:
@@ -753,11 +810,14 @@ static int do_read(struct fsg_common *common)
 			break;
 		}
 
-		/* Perform the read */
-		rc = ums[common->lun].read_sector(&ums[common->lun],
-				      file_offset / SECTOR_SIZE,
-				      amount / SECTOR_SIZE,
-				      (char __user *)bh->buf);
+		/* Perform the read, unless it was already done ahead */
+		if (fsg_take_read_ahead(common, bh, file_offset, &amount))
+			rc = amount / SECTOR_SIZE;
+		else
+			rc = ums[common->lun].read_sector(&ums[common->lun],
+					      file_offset / SECTOR_SIZE,
+					      amount / SECTOR_SIZE,
+					      (char __user *)bh->buf);
 		if (!rc)
 			return -EIO;
 
@@ -802,6 +862,13 @@ static int do_read(struct fsg_common *common)
 		common->next_buffhd_to_fill = bh->next;
 	}
 
+	/* Once the host streams, read its next chunk ahead of time */
+	common->ra_lun = common->lun;
+	common->ra_offset = file_offset;
+	common->ra_len = 0;
+	if (sequential && amount_left == 0)
+		common->ra_want = min(common->data_size_from_cmnd, FSG_BUFLEN);
+
 	return -EIO;		/* No default reply */
 }
 
@@ -846,6 +913,9 @@ static int do_write(struct fsg_common *common)
 		return -EINVAL;
 	}
 
+	/* Anything read ahead may be about to go stale */
+	common->ra_len = 0;
+
 	/* Carry out the file writes */
 	get_some_more = 1;
 	file_offset = usb_offset = ((loff_t) lba) << 9;
@@ -2128,6 +2198,11 @@ static int get_next_command(struct fsg_common *common)
 	 * can reuse it for the next filling.  No need to advance
 	 * next_buffhd_to_fill. */
 
+	/* The host is streaming; fetch its next chunk while the
+	 * previous reply drains and the CBW is on its way. */
+	if (common->ra_want)
+		fsg_read_ahead(common);
+
 	/* Wait for the CBW to arrive */
 	while (bh->state != BUF_STATE_FULL) {
 		rc = sleep_thread(common);
@@ -2508,6 +2583,13 @@ buffhds_first_it:
 	} while (--i);
 	bh->next = common->buffhds;
 
+	common->ra_buf = memalign(CONFIG_SYS_CACHELINE_SIZE, FSG_BUFLEN);
+	if (unlikely(!common->ra_buf)) {
+		rc = -ENOMEM;
+		goto error_release;
+	}
+	common->ra_offset = -1;
+
 	snprintf(common->inquiry_string, sizeof common->inquiry_string,
 		 "%-8s%-16s%04x",
 		 "Linux   ",
@@ -2573,6 +2655,7 @@ static void fsg_common_release(struct kref *ref)
 			kfree(bh->buf);
 		} while (++bh, --i);
 	}
+	kfree(common->ra_buf);
 
 	if (common->free_storage_on_release)
 		kfree(common);
@@ -296,20 +296,126 @@ static void ehci_update_endpt2_dev_n_port(struct usb_device *udev,
 				     QH_ENDPT2_HUBADDR(hubaddr));
 }
 
+static int ehci_enable_async(struct ehci_ctrl *ctrl, bool enable)
+{
+	uint32_t cmd, usbsts;
+	int ret;
+
+	cmd = ehci_readl(&ctrl->hcor->or_usbcmd);
+	if (!(cmd & CMD_ASE) == !enable)
+		return 0;
+
+	if (enable) {
+		/* Set async. queue head pointer. */
+		ehci_writel(&ctrl->hcor->or_asynclistaddr,
+			    virt_to_phys(&ctrl->qh_list));
+		usbsts = ehci_readl(&ctrl->hcor->or_usbsts);
+		ehci_writel(&ctrl->hcor->or_usbsts, (usbsts & 0x3f));
+		cmd |= CMD_ASE;
+	} else {
+		cmd &= ~CMD_ASE;
+	}
+	ehci_writel(&ctrl->hcor->or_usbcmd, cmd);
+
+	ret = handshake((uint32_t *)&ctrl->hcor->or_usbsts, STS_ASS,
+			enable ? STS_ASS : 0, 100 * 1000);
+	if (ret < 0)
+		printf("EHCI fail timeout STS_ASS %s\n", enable ? "set" : "reset");
+
+	return ret;
+}
+
+/* Control endpoints have one QH for both directions */
+static uint ehci_qh_key(unsigned long pipe)
+{
+	return 1 << 12 | usb_pipedevice(pipe) << 5 |
+	       usb_pipeendpoint(pipe) << 1 |
+	       (!usb_pipecontrol(pipe) && usb_pipein(pipe));
+}
+
+/* Take @qh out of the async schedule, which must be stopped */
+static void ehci_unlink_qh(struct ehci_ctrl *ctrl, struct QH *qh)
+{
+	uint32_t link = cpu_to_hc32(virt_to_phys(qh) | QH_LINK_TYPE_QH);
+	struct QH *prev = &ctrl->qh_list;
+	int i;
+
+	for (i = 0; prev->qh_link != link; i++) {
+		if (i == EHCI_QH_CACHE_SIZE)
+			return;
+		prev = ctrl->qh_cache[i];
+		if (!ctrl->qh_key[i])
+			prev = &ctrl->qh_list;
+	}
+	prev->qh_link = qh->qh_link;
+	flush_dcache_range((unsigned long)prev,
+			   ALIGN_END_ADDR(struct QH, prev, 1));
+}
+
+/*
+ * The QHs of the endpoints we talk to stay in the async schedule, which
+ * keeps running: a transfer only has to give the QH of its endpoint new
+ * qTDs. Only making room for yet another endpoint stops the schedule, until
+ * the next transfer.
+ */
+static struct QH *ehci_get_qh(struct ehci_ctrl *ctrl, unsigned long pipe)
+{
+	uint key = ehci_qh_key(pipe);
+	struct QH *qh;
+	int i;
+
+	for (i = 0; i < EHCI_QH_CACHE_SIZE; i++) {
+		if (ctrl->qh_key[i] == key)
+			return ctrl->qh_cache[i];
+	}
+
+	for (i = 0; i < EHCI_QH_CACHE_SIZE && ctrl->qh_key[i]; i++)
+		;
+	if (i == EHCI_QH_CACHE_SIZE) {
+		i = ctrl->qh_evict;
+		ctrl->qh_evict = (i + 1) % EHCI_QH_CACHE_SIZE;
+		/* The controller must be done with the QH we take */
+		if (ehci_enable_async(ctrl, false) < 0)
+			return NULL;
+		ehci_unlink_qh(ctrl, ctrl->qh_cache[i]);
+		ctrl->qh_key[i] = 0;
+	}
+	if (!ctrl->qh_cache[i]) {
+		ctrl->qh_cache[i] = memalign(USB_DMA_MINALIGN,
+					     ALIGN(sizeof(struct QH),
+						   USB_DMA_MINALIGN));
+		if (!ctrl->qh_cache[i])
+			return NULL;
+	}
+	qh = ctrl->qh_cache[i];
+
+	/* Link it behind the head of the reclamation list, idle */
+	memset(qh, 0, sizeof(*qh));
+	qh->qh_link = ctrl->qh_list.qh_link;
+	qh->qh_overlay.qt_next = cpu_to_hc32(QT_NEXT_TERMINATE);
+	qh->qh_overlay.qt_altnext = cpu_to_hc32(QT_NEXT_TERMINATE);
+	flush_dcache_range((unsigned long)qh, ALIGN_END_ADDR(struct QH, qh, 1));
+	ctrl->qh_list.qh_link = cpu_to_hc32(virt_to_phys(qh) | QH_LINK_TYPE_QH);
+	flush_dcache_range((unsigned long)&ctrl->qh_list,
+		ALIGN_END_ADDR(struct QH, &ctrl->qh_list, 1));
+	ctrl->qh_key[i] = key;
+
+	return qh;
+}
+
 static int
 ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 		   int length, struct devrequest *req)
 {
-	ALLOC_ALIGN_BUFFER(struct QH, qh, 1, USB_DMA_MINALIGN);
+	struct QH *qh;
 	struct qTD *qtd;
 	int qtd_count = 0;
 	int qtd_counter = 0;
 	volatile struct qTD *vtd;
 	unsigned long ts;
-	uint32_t *tdp;
-	uint32_t endpt, maxpacket, token, usbsts;
+	uint32_t *tdp, first_td;
+	uint32_t endpt, maxpacket, token;
 	uint32_t c, toggle;
-	uint32_t cmd;
 	int timeout;
 	int ret = 0;
 	struct ehci_ctrl *ctrl = ehci_get_ctrl(dev);
@@ -382,28 +488,37 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 #if CONFIG_SYS_MALLOC_LEN <= 64 + 128 * 1024
 #warning CONFIG_SYS_MALLOC_LEN may be too small for EHCI
 #endif
-	qtd = memalign(USB_DMA_MINALIGN, qtd_count * sizeof(struct qTD));
+	/* The controller is done with the qTDs of the last transfer */
+	if (qtd_count > ctrl->td_pool_size) {
+		free(ctrl->td_pool);
+		ctrl->td_pool = memalign(USB_DMA_MINALIGN,
+					 qtd_count * sizeof(struct qTD));
+		ctrl->td_pool_size = ctrl->td_pool ? qtd_count : 0;
+	}
+	qtd = ctrl->td_pool;
 	if (qtd == NULL) {
 		printf("unable to allocate TDs\n");
 		return -1;
 	}
+	qh = ehci_get_qh(ctrl, pipe);
+	if (qh == NULL) {
+		printf("unable to get QH\n");
+		return -1;
+	}
 
-	memset(qh, 0, sizeof(struct QH));
 	memset(qtd, 0, qtd_count * sizeof(*qtd));
 
 	toggle = usb_gettoggle(dev, usb_pipeendpoint(pipe), usb_pipeout(pipe));
 
 	/*
-	 * Setup QH (3.6 in ehci-r10.pdf)
+	 * Setup QH (3.6 in ehci-r10.pdf), which is idle and stays linked
 	 *
-	 *   qh_link ................. 03-00 H
 	 *   qh_endpt1 ............... 07-04 H
 	 *   qh_endpt2 ............... 0B-08 H
 	 * - qh_curtd
 	 *   qh_overlay.qt_next ...... 13-10 H
 	 * - qh_overlay.qt_altnext
 	 */
-	qh->qh_link = cpu_to_hc32(virt_to_phys(&ctrl->qh_list) | QH_LINK_TYPE_QH);
 	c = (dev->speed != USB_SPEED_HIGH) && !usb_pipeendpoint(pipe);
 	maxpacket = usb_maxpacket(dev, pipe);
 	endpt = QH_ENDPT1_RL(8) | QH_ENDPT1_C(c) |
@@ -422,10 +537,12 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 	endpt = QH_ENDPT2_MULT(1) | QH_ENDPT2_UFCMASK(0) | QH_ENDPT2_UFSMASK(0);
 	qh->qh_endpt2 = cpu_to_hc32(endpt);
 	ehci_update_endpt2_dev_n_port(dev, qh);
+	/* Clears what a halt of the last transfer left there */
+	memset(&qh->qh_overlay, 0, sizeof(qh->qh_overlay));
 	qh->qh_overlay.qt_next = cpu_to_hc32(QT_NEXT_TERMINATE);
 	qh->qh_overlay.qt_altnext = cpu_to_hc32(QT_NEXT_TERMINATE);
 
-	tdp = &qh->qh_overlay.qt_next;
+	tdp = &first_td;
 	if (req != NULL) {
 		/*
 		 * Setup request qTD (3.5 in ehci-r10.pdf)
@@ -542,32 +659,18 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 		tdp = &qtd[qtd_counter++].qt_next;
 	}
 
-	ctrl->qh_list.qh_link = cpu_to_hc32(virt_to_phys(qh) | QH_LINK_TYPE_QH);
-
-	/* Flush dcache */
-	flush_dcache_range((unsigned long)&ctrl->qh_list,
-		ALIGN_END_ADDR(struct QH, &ctrl->qh_list, 1));
-	flush_dcache_range((unsigned long)qh, ALIGN_END_ADDR(struct QH, qh, 1));
+	/*
+	 * Flush dcache: the qTDs before the QH points at them, since the
+	 * controller may be looking at the QH already
+	 */
 	flush_dcache_range((unsigned long)qtd,
 			   ALIGN_END_ADDR(struct qTD, qtd, qtd_count));
+	qh->qh_overlay.qt_next = first_td;
+	flush_dcache_range((unsigned long)qh, ALIGN_END_ADDR(struct QH, qh, 1));
 
-	/* Set async. queue head pointer. */
-	ehci_writel(&ctrl->hcor->or_asynclistaddr, virt_to_phys(&ctrl->qh_list));
-
-	usbsts = ehci_readl(&ctrl->hcor->or_usbsts);
-	ehci_writel(&ctrl->hcor->or_usbsts, (usbsts & 0x3f));
-
-	/* Enable async. schedule. */
-	cmd = ehci_readl(&ctrl->hcor->or_usbcmd);
-	cmd |= CMD_ASE;
-	ehci_writel(&ctrl->hcor->or_usbcmd, cmd);
-
-	ret = handshake((uint32_t *)&ctrl->hcor->or_usbsts, STS_ASS, STS_ASS,
-			100 * 1000);
-	if (ret < 0) {
-		printf("EHCI fail timeout STS_ASS set\n");
+	ret = ehci_enable_async(ctrl, true);
+	if (ret < 0)
 		goto fail;
-	}
 
 	/* Wait for TDs to be processed. */
 	ts = get_timer(0);
@@ -575,18 +678,22 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 	timeout = USB_TIMEOUT_MS(pipe);
 	do {
 		/* Invalidate dcache */
-		invalidate_dcache_range((unsigned long)&ctrl->qh_list,
-			ALIGN_END_ADDR(struct QH, &ctrl->qh_list, 1));
+		invalidate_dcache_range((unsigned long)vtd,
+			ALIGN_END_ADDR(struct qTD, vtd, 1));
 		invalidate_dcache_range((unsigned long)qh,
 			ALIGN_END_ADDR(struct QH, qh, 1));
-		invalidate_dcache_range((unsigned long)qtd,
-			ALIGN_END_ADDR(struct qTD, qtd, qtd_count));
 
 		token = hc32_to_cpu(vtd->qt_token);
 		if (!(QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE))
 			break;
+		/* An error halts the queue before it gets to the last qTD */
+		if (QT_TOKEN_GET_STATUS(hc32_to_cpu(qh->qh_overlay.qt_token)) &
+		    QT_TOKEN_STATUS_HALTED)
+			break;
 		WATCHDOG_RESET();
 	} while (get_timer(ts) < timeout);
+	invalidate_dcache_range((unsigned long)qh,
+				ALIGN_END_ADDR(struct QH, qh, 1));
 
 	/*
 	 * Invalidate the memory area occupied by buffer
@@ -602,22 +709,25 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 			ALIGN((unsigned long)buffer + length, ARCH_DMA_MINALIGN));
 
 	/* Check that the TD processing happened */
-	if (QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE)
+	if (QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE &&
+	    !(QT_TOKEN_GET_STATUS(hc32_to_cpu(qh->qh_overlay.qt_token)) &
+	      QT_TOKEN_STATUS_HALTED)) {
 		printf("EHCI timed out on TD - token=%#x\n", token);
 
-	/* Disable async schedule. */
-	cmd = ehci_readl(&ctrl->hcor->or_usbcmd);
-	cmd &= ~CMD_ASE;
-	ehci_writel(&ctrl->hcor->or_usbcmd, cmd);
-
-	ret = handshake((uint32_t *)&ctrl->hcor->or_usbsts, STS_ASS, 0,
-			100 * 1000);
-	if (ret < 0) {
-		printf("EHCI fail timeout STS_ASS reset\n");
-		goto fail;
+		/* Stop the schedule to take the qTDs back from the QH */
+		ret = ehci_enable_async(ctrl, false);
+		if (ret < 0)
+			goto fail;
+		invalidate_dcache_range((unsigned long)qh,
+					ALIGN_END_ADDR(struct QH, qh, 1));
+		token = hc32_to_cpu(qh->qh_overlay.qt_token);
+		qh->qh_overlay.qt_next = cpu_to_hc32(QT_NEXT_TERMINATE);
+		qh->qh_overlay.qt_token = 0;
+		flush_dcache_range((unsigned long)qh,
+				   ALIGN_END_ADDR(struct QH, qh, 1));
+	} else {
+		token = hc32_to_cpu(qh->qh_overlay.qt_token);
 	}
-
-	token = hc32_to_cpu(qh->qh_overlay.qt_token);
 	if (!(QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE)) {
 		debug("TOKEN=%#x\n", token);
 		switch (QT_TOKEN_GET_STATUS(token) &
@@ -656,11 +766,9 @@ ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 #endif
 	}
 
-	free(qtd);
 	return (dev->status != USB_ST_NOT_PROC) ? 0 : -1;
 
 fail:
-	free(qtd);
 	return -1;
 }
 
@@ -1015,6 +1123,15 @@ static int ehci_common_init(struct ehci_ctrl *ctrl, uint tweaks)
 	flush_dcache_range((unsigned long)qh_list,
 			   ALIGN_END_ADDR(struct QH, qh_list, 1));
 
+	/* No QH is linked behind it yet, see ehci_get_qh() */
+	memset(ctrl->qh_key, 0, sizeof(ctrl->qh_key));
+	ctrl->qh_evict = 0;
+	if (!ctrl->td_pool) {
+		ctrl->td_pool = memalign(USB_DMA_MINALIGN,
+					 EHCI_TD_POOL_MIN * sizeof(struct qTD));
+		ctrl->td_pool_size = ctrl->td_pool ? EHCI_TD_POOL_MIN : 0;
+	}
+
 	/* Set async. queue head pointer. */
 	ehci_writel(&ctrl->hcor->or_asynclistaddr, virt_to_phys(qh_list));
 
@@ -1665,12 +1782,17 @@ err:
 int ehci_deregister(struct udevice *dev)
 {
 	struct ehci_ctrl *ctrl = dev_get_priv(dev);
+	int i;
 
 	if (ctrl->init == USB_INIT_DEVICE)
 		return 0;
 
 	ehci_shutdown(ctrl);
 
+	for (i = 0; i < EHCI_QH_CACHE_SIZE; i++)
+		free(ctrl->qh_cache[i]);
+	free(ctrl->td_pool);
+
 	return 0;
 }
 
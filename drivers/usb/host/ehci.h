@@ -243,6 +243,11 @@ struct ehci_ops {
 	int (*init_after_reset)(struct ehci_ctrl *ctrl);
 };
 
+/* Number of QHs kept in the async schedule, see ehci_get_qh() */
+#define EHCI_QH_CACHE_SIZE	8
+/* qTDs allocated up front, the pool grows for larger transfers */
+#define EHCI_TD_POOL_MIN	64
+
 struct ehci_ctrl {
 	enum usb_init_type init;
 	struct ehci_hccr *hccr;	/* R/O registers, not need for volatile */
@@ -253,6 +258,11 @@ struct ehci_ctrl {
 	struct QH periodic_queue __aligned(USB_DMA_MINALIGN);
 	uint32_t *periodic_list;
 	int periodic_schedules;
+	struct QH *qh_cache[EHCI_QH_CACHE_SIZE];
+	uint qh_key[EHCI_QH_CACHE_SIZE];	/* endpoint of each QH, 0 if free */
+	int qh_evict;			/* next QH to take for another endpoint */
+	struct qTD *td_pool;		/* qTDs of the transfer in progress */
+	int td_pool_size;
 	int ntds;
 	bool has_fsl_erratum_a005275;	/* Freescale HS silicon quirk */
 	struct ehci_ops ops;
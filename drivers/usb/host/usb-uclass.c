@@ -158,6 +158,69 @@ int usb_get_max_xfer_size(struct usb_device *udev, size_t *size)
 	return ops->get_max_xfer_size(bus, size);
 }
 
+int usb_alloc_streams(struct usb_device *udev, struct usb_interface *iface,
+		      unsigned int num_streams)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->alloc_streams)
+		return -ENOSYS;
+
+	return ops->alloc_streams(bus, udev, iface, num_streams);
+}
+
+int usb_submit_stream_xfer(struct usb_device *udev,
+			   struct usb_stream_xfer *xfer)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->submit_stream_xfer)
+		return -ENOSYS;
+
+	return ops->submit_stream_xfer(bus, udev, xfer);
+}
+
+int usb_poll_stream_xfers(struct usb_device *udev)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->poll_stream_xfers)
+		return -ENOSYS;
+
+	return ops->poll_stream_xfers(bus, udev);
+}
+
+int usb_wait_stream_xfer(struct usb_device *udev, struct usb_stream_xfer *xfer,
+			 unsigned long timeout_ms)
+{
+	ulong start = get_timer(0);
+	int ret;
+
+	while (!xfer->done) {
+		ret = usb_poll_stream_xfers(udev);
+		if (ret)
+			return ret;
+		if (!xfer->done && get_timer(start) > timeout_ms)
+			return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+int usb_cancel_stream_xfers(struct usb_device *udev, unsigned long pipe)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->cancel_stream_xfers)
+		return -ENOSYS;
+
+	return ops->cancel_stream_xfers(bus, udev, pipe);
+}
+
 int usb_stop(void)
 {
 	struct udevice *bus;
@@ -204,23 +267,62 @@ static void usb_scan_bus(struct udevice *bus, bool recurse)
 {
 	struct usb_bus_priv *priv;
 	struct udevice *dev;
-	int ret;
 
 	priv = dev_get_uclass_priv(bus);
 
 	assert(recurse);	/* TODO: Support non-recusive */
 
+	debug("scanning bus %d\n", bus->seq);
+	priv->scan_err = usb_scan_device(bus, 0, USB_SPEED_FULL, &dev);
+}
+
+static void usb_report_bus(struct udevice *bus)
+{
+	struct usb_bus_priv *priv = dev_get_uclass_priv(bus);
+
 	printf("scanning bus %d for devices... ", bus->seq);
-	debug("\n");
-	ret = usb_scan_device(bus, 0, USB_SPEED_FULL, &dev);
-	if (ret)
-		printf("failed, error %d\n", ret);
+	if (priv->scan_err)
+		printf("failed, error %d\n", priv->scan_err);
 	else if (priv->next_addr == 0)
 		printf("No USB Device found\n");
 	else
 		printf("%d USB Device(s) found\n", priv->next_addr);
 }
 
+/*
+ * Set up the root hubs of all primary or all companion controllers, then
+ * scan their ports together, so that each bus does not wait out the power-on
+ * and connect delays of its hubs alone.
+ */
+static void usb_scan_buses(struct uclass *uc, bool companion)
+{
+	struct usb_bus_priv *priv;
+	struct udevice *bus;
+	int ret;
+
+	usb_hub_defer_scan(true);
+	uclass_foreach_dev(bus, uc) {
+		if (!device_active(bus))
+			continue;
+
+		priv = dev_get_uclass_priv(bus);
+		if (priv->companion == companion)
+			usb_scan_bus(bus, true);
+	}
+	ret = usb_hub_defer_scan(false);
+	if (ret)
+		debug("%s: port scan failed, error %d\n", __func__, ret);
+
+	uclass_foreach_dev(bus, uc) {
+		if (!device_active(bus))
+			continue;
+
+		priv = dev_get_uclass_priv(bus);
+		if (priv->companion == companion)
+			usb_report_bus(bus);
+	}
+}
+
 static void remove_inactive_children(struct uclass *uc, struct udevice *bus)
 {
 	uclass_foreach_dev(bus, uc) {
@@ -239,7 +341,6 @@ int usb_init(void)
 {
 	int controllers_initialized = 0;
 	struct usb_uclass_priv *uc_priv;
-	struct usb_bus_priv *priv;
 	struct udevice *bus;
 	struct uclass *uc;
 	int count = 0;
@@ -291,30 +392,15 @@ int usb_init(void)
 	 * lowlevel init done, now scan the bus for devices i.e. search HUBs
 	 * and configure them, first scan primary controllers.
 	 */
-	uclass_foreach_dev(bus, uc) {
-		if (!device_active(bus))
-			continue;
-
-		priv = dev_get_uclass_priv(bus);
-		if (!priv->companion)
-			usb_scan_bus(bus, true);
-	}
+	usb_scan_buses(uc, false);
 
 	/*
 	 * Now that the primary controllers have been scanned and have handed
 	 * over any devices they do not understand to their companions, scan
 	 * the companions if necessary.
 	 */
-	if (uc_priv->companion_device_count) {
-		uclass_foreach_dev(bus, uc) {
-			if (!device_active(bus))
-				continue;
-
-			priv = dev_get_uclass_priv(bus);
-			if (priv->companion)
-				usb_scan_bus(bus, true);
-		}
-	}
+	if (uc_priv->companion_device_count)
+		usb_scan_buses(uc, true);
 
 	debug("scan end\n");
 
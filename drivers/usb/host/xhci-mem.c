@@ -75,7 +75,7 @@ static void xhci_segment_free(struct xhci_segment *seg)
  * @param ptr	pointer to "ring" to be freed
  * @return none
  */
-static void xhci_ring_free(struct xhci_ring *ring)
+void xhci_ring_free(struct xhci_ring *ring)
 {
 	struct xhci_segment *seg;
 	struct xhci_segment *first_seg;
@@ -148,9 +148,13 @@ static void xhci_free_virt_devices(struct xhci_ctrl *ctrl)
 
 		ctrl->dcbaa->dev_context_ptrs[slot_id] = 0;
 
-		for (i = 0; i < 31; ++i)
+		for (i = 0; i < 31; ++i) {
 			if (virt_dev->eps[i].ring)
 				xhci_ring_free(virt_dev->eps[i].ring);
+			if (virt_dev->eps[i].stream_info)
+				xhci_stream_info_free(
+					virt_dev->eps[i].stream_info);
+		}
 
 		if (virt_dev->in_ctx)
 			xhci_free_container_ctx(virt_dev->in_ctx);
@@ -251,6 +255,7 @@ static void xhci_initialize_ring_info(struct xhci_ring *ring)
 	ring->enq_seg = ring->first_seg;
 	ring->dequeue = ring->enqueue;
 	ring->deq_seg = ring->first_seg;
+	ring->queued_trbs = 0;
 
 	/*
 	 * The ring is initialized to 0. The producer must write 1 to the
@@ -307,6 +312,7 @@ struct xhci_ring *xhci_ring_alloc(unsigned int num_segs, bool link_trbs)
 	ring = (struct xhci_ring *)malloc(sizeof(struct xhci_ring));
 	BUG_ON(!ring);
 
+	ring->num_segs = num_segs;
 	if (num_segs == 0)
 		return ring;
 
@@ -338,6 +344,59 @@ struct xhci_ring *xhci_ring_alloc(unsigned int num_segs, bool link_trbs)
 	return ring;
 }
 
+/**
+ * Create a linear stream context array and a ring for each of its streams.
+ * Stream 0 is reserved and gets no ring.
+ *
+ * @param num_streams	number of stream contexts, a power of two
+ * @return pointer to the new stream info
+ */
+struct xhci_stream_info *xhci_stream_info_alloc(unsigned int num_streams)
+{
+	struct xhci_stream_info *info;
+	struct xhci_ring *ring;
+	unsigned int i;
+	u64 val_64;
+
+	info = malloc(sizeof(struct xhci_stream_info));
+	BUG_ON(!info);
+	info->num_streams = num_streams;
+	info->stream_rings = calloc(num_streams, sizeof(struct xhci_ring *));
+	BUG_ON(!info->stream_rings);
+	info->stream_ctx_array = xhci_malloc(num_streams *
+					     sizeof(struct xhci_stream_ctx));
+
+	for (i = 1; i < num_streams; i++) {
+		ring = xhci_ring_alloc(1, true);
+		info->stream_rings[i] = ring;
+		val_64 = (uintptr_t)ring->first_seg->trbs;
+		info->stream_ctx_array[i].stream_ring =
+			cpu_to_le64(val_64 | SCT_FOR_CTX(SCT_PRI_TR) |
+				    ring->cycle_state);
+	}
+	xhci_flush_cache((uintptr_t)info->stream_ctx_array,
+			 num_streams * sizeof(struct xhci_stream_ctx));
+
+	return info;
+}
+
+/**
+ * Free a stream context array and its rings
+ *
+ * @param info	stream info to be freed
+ * @return none
+ */
+void xhci_stream_info_free(struct xhci_stream_info *info)
+{
+	unsigned int i;
+
+	for (i = 1; i < info->num_streams; i++)
+		xhci_ring_free(info->stream_rings[i]);
+	free(info->stream_rings);
+	free(info->stream_ctx_array);
+	free(info);
+}
+
 /**
  * Set up the scratchpad buffer array and scratchpad buffers
  *
@@ -15,6 +15,7 @@
 
 #include <common.h>
 #include <asm/byteorder.h>
+#include <malloc.h>
 #include <usb.h>
 #include <asm/unaligned.h>
 #include <linux/errno.h>
@@ -351,12 +352,13 @@ static u32 xhci_v1_0_td_remainder(int running_total,
  *
  * @param udev		pointer to the USB device structure
  * @param ep_index	index of the endpoint
+ * @param stream_id	stream of the endpoint, 0 if it has none
  * @param start_cycle	cycle flag of the first TRB
  * @param start_trb	pionter to the first TRB
  * @return none
  */
 static void giveback_first_trb(struct usb_device *udev, int ep_index,
-				int start_cycle,
+				unsigned int stream_id, int start_cycle,
 				struct xhci_generic_trb *start_trb)
 {
 	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
@@ -374,7 +376,7 @@ static void giveback_first_trb(struct usb_device *udev, int ep_index,
 
 	/* Ringing EP doorbell here */
 	xhci_writel(&ctrl->dba->doorbell[udev->slot_id],
-				DB_VALUE(ep_index, 0));
+				DB_VALUE(ep_index, stream_id));
 
 	return;
 }
@@ -422,6 +424,9 @@ static int event_ready(struct xhci_ctrl *ctrl)
 	return 1;
 }
 
+static bool stream_transfer_event(struct xhci_ctrl *ctrl,
+				  union xhci_trb *event);
+
 /**
  * Waits for a specific type of event and returns it. Discards unexpected
  * events. Caller *must* call xhci_acknowledge_event() after it is finished
@@ -443,6 +448,11 @@ union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
 			continue;
 
 		type = TRB_FIELD_TO_TYPE(le32_to_cpu(event->event_cmd.flags));
+		/* Queued TDs complete while we wait for something else */
+		if (type == TRB_TRANSFER && stream_transfer_event(ctrl, event)) {
+			xhci_acknowledge_event(ctrl);
+			continue;
+		}
 		if (type == expected)
 			return event;
 
@@ -513,49 +523,60 @@ static void abort_td(struct usb_device *udev, int ep_index)
 	xhci_acknowledge_event(ctrl);
 }
 
-static void record_transfer_result(struct usb_device *udev,
-				   union xhci_trb *event, int length)
+static int transfer_status(union xhci_trb *event)
 {
-	udev->act_len = min(length, length -
-		(int)EVENT_TRB_LEN(le32_to_cpu(event->trans_event.transfer_len)));
-
 	switch (GET_COMP_CODE(le32_to_cpu(event->trans_event.transfer_len))) {
 	case COMP_SUCCESS:
-		BUG_ON(udev->act_len != length);
-		/* fallthrough */
 	case COMP_SHORT_TX:
-		udev->status = 0;
-		break;
+		return 0;
 	case COMP_STALL:
-		udev->status = USB_ST_STALLED;
-		break;
+		return USB_ST_STALLED;
 	case COMP_DB_ERR:
 	case COMP_TRB_ERR:
-		udev->status = USB_ST_BUF_ERR;
-		break;
+		return USB_ST_BUF_ERR;
 	case COMP_BABBLE:
-		udev->status = USB_ST_BABBLE_DET;
-		break;
+		return USB_ST_BABBLE_DET;
 	default:
-		udev->status = 0x80;  /* USB_ST_TOO_LAZY_TO_MAKE_A_NEW_MACRO */
+		return 0x80;  /* USB_ST_TOO_LAZY_TO_MAKE_A_NEW_MACRO */
 	}
 }
 
+static void record_transfer_result(struct usb_device *udev,
+				   union xhci_trb *event, int length)
+{
+	udev->act_len = min(length, length -
+		(int)EVENT_TRB_LEN(le32_to_cpu(event->trans_event.transfer_len)));
+
+	if (GET_COMP_CODE(le32_to_cpu(event->trans_event.transfer_len)) ==
+	    COMP_SUCCESS)
+		BUG_ON(udev->act_len != length);
+	udev->status = transfer_status(event);
+}
+
 /**** Bulk and Control transfer methods ****/
 /**
- * Queues up the BULK Request
+ * Queues the TRBs of a BULK Request and rings the doorbell
  *
  * @param udev		pointer to the USB device structure
  * @param pipe		contains the DIR_IN or OUT , devnum
+ * @param ring		transfer ring of the endpoint or of the stream
+ * @param stream_id	stream to ring the doorbell for, 0 if none
  * @param length	length of the buffer
  * @param buffer	buffer to be read/written based on the request
- * @return returns 0 if successful else -1 on failure
+ * @param first		if not NULL, set to the first TRB of the TD
+ * @param last		if not NULL, set to the last TRB of the TD
+ * @return returns the number of TRBs queued if successful else error code
+ *	   on failure
  */
-int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
-			int length, void *buffer)
+static int queue_bulk_td(struct usb_device *udev, unsigned long pipe,
+			 struct xhci_ring *ring, unsigned int stream_id,
+			 int length, void *buffer, union xhci_trb **first,
+			 union xhci_trb **last)
 {
 	int num_trbs = 0;
+	int queued;
 	struct xhci_generic_trb *start_trb;
+	struct xhci_generic_trb *trb;
 	bool first_trb = false;
 	int start_cycle;
 	u32 field = 0;
@@ -565,8 +586,6 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	int ep_index;
 	struct xhci_virt_device *virt_dev;
 	struct xhci_ep_ctx *ep_ctx;
-	struct xhci_ring *ring;		/* EP transfer ring */
-	union xhci_trb *event;
 
 	int running_total, trb_buff_len;
 	unsigned int total_packet_count;
@@ -587,7 +606,6 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 
 	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
 
-	ring = virt_dev->eps[ep_index].ring;
 	/*
 	 * How much data is (potentially) left before the 64KB boundary?
 	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
@@ -612,6 +630,12 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		running_total += TRB_MAX_BUFF_SIZE;
 	}
 
+	/* Don't overwrite the TRBs of TDs the controller still has */
+	if (ring->queued_trbs + num_trbs >
+	    ring->num_segs * (TRBS_PER_SEGMENT - 1))
+		return -EBUSY;
+	queued = num_trbs;
+
 	/*
 	 * XXX: Calling routine prepare_ring() called in place of
 	 * prepare_trasfer() as there in 'Linux' since we are not
@@ -698,7 +722,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		trb_fields[2] = length_field;
 		trb_fields[3] = field | (TRB_NORMAL << TRB_TYPE_SHIFT);
 
-		queue_trb(ctrl, ring, (num_trbs > 1), trb_fields);
+		trb = queue_trb(ctrl, ring, (num_trbs > 1), trb_fields);
 
 		--num_trbs;
 
@@ -709,7 +733,46 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		trb_buff_len = min((length - running_total), TRB_MAX_BUFF_SIZE);
 	} while (running_total < length);
 
-	giveback_first_trb(udev, ep_index, start_cycle, start_trb);
+	if (first)
+		*first = (union xhci_trb *)start_trb;
+	if (last)
+		*last = (union xhci_trb *)trb;
+
+	giveback_first_trb(udev, ep_index, stream_id, start_cycle, start_trb);
+
+	return queued;
+}
+
+/**
+ * Queues up the BULK Request
+ *
+ * @param udev		pointer to the USB device structure
+ * @param pipe		contains the DIR_IN or OUT , devnum
+ * @param length	length of the buffer
+ * @param buffer	buffer to be read/written based on the request
+ * @return returns 0 if successful else -1 on failure
+ */
+int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
+			int length, void *buffer)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	int slot_id = udev->slot_id;
+	int ep_index = usb_pipe_ep_index(pipe);
+	struct xhci_ring *ring = ctrl->devs[slot_id]->eps[ep_index].ring;
+	union xhci_trb *event;
+	u32 field;
+	int ret;
+
+	/* Endpoints with streams only take xhci_stream_submit() */
+	if (!ring)
+		return -EINVAL;
+	/* Its TDs would complete before ours */
+	if (ring->queued_trbs)
+		return -EBUSY;
+
+	ret = queue_bulk_td(udev, pipe, ring, 0, length, buffer, NULL, NULL);
+	if (ret < 0)
+		return ret;
 
 	event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
 	if (!event) {
@@ -733,6 +796,260 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	return (udev->status != USB_ST_NOT_PROC) ? 0 : -1;
 }
 
+/**** Queued bulk transfers and streams ****/
+/*
+ * A TD queued by xhci_stream_submit(), on the list of the controller until
+ * its transfer event comes. Each ring completes its TDs in order, but the
+ * stream rings of an endpoint complete in whatever order the device serves
+ * the streams.
+ */
+struct xhci_stream_td {
+	struct list_head list;
+	struct usb_stream_xfer *xfer;
+	struct usb_device *udev;
+	struct xhci_ring *ring;
+	union xhci_trb *first;
+	union xhci_trb *last;
+	int num_trbs;
+};
+
+/* Is @trb one of the TRBs of @td, which may go over link TRBs? */
+static bool td_has_trb(struct xhci_stream_td *td, union xhci_trb *trb)
+{
+	union xhci_trb *cur = td->first;
+
+	for (;;) {
+		if (cur == trb)
+			return true;
+		if (cur == td->last)
+			return false;
+		cur++;
+		while (TRB_TYPE_LINK_LE32(cur->link.control))
+			cur = (union xhci_trb *)(uintptr_t)
+				le64_to_cpu(cur->link.segment_ptr);
+	}
+}
+
+/**
+ * Queues up a BULK Request on a stream of an endpoint, or on the ring of an
+ * endpoint without streams when the stream ID is 0. This does not wait for
+ * the transfer: xhci_stream_poll() sets @xfer->done once it is over. Each
+ * ring takes several such requests, until it is full.
+ *
+ * @param udev	pointer to the USB device structure
+ * @param xfer	request to queue, which must stay around until it is done
+ * @return returns 0 if successful, -EBUSY if the ring is full, else error
+ *	   code on failure
+ */
+int xhci_stream_submit(struct usb_device *udev, struct usb_stream_xfer *xfer)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_ep *ep;
+	struct xhci_stream_td *td;
+	struct xhci_ring *ring;
+	int ret;
+
+	ep = &ctrl->devs[udev->slot_id]->eps[usb_pipe_ep_index(xfer->pipe)];
+	if (!xfer->stream_id)
+		ring = ep->ring;
+	else if (ep->stream_info &&
+		 xfer->stream_id < ep->stream_info->num_streams)
+		ring = ep->stream_info->stream_rings[xfer->stream_id];
+	else
+		ring = NULL;
+	if (!ring)
+		return -EINVAL;
+
+	td = malloc(sizeof(*td));
+	if (!td)
+		return -ENOMEM;
+	td->xfer = xfer;
+	td->udev = udev;
+	td->ring = ring;
+
+	xfer->done = false;
+	xfer->status = 0;
+	xfer->act_len = 0;
+	ret = queue_bulk_td(udev, xfer->pipe, ring, xfer->stream_id,
+			    xfer->length, xfer->buffer, &td->first, &td->last);
+	if (ret < 0) {
+		free(td);
+		return ret;
+	}
+	td->num_trbs = ret;
+	ring->queued_trbs += ret;
+	list_add_tail(&td->list, &ctrl->stream_tds);
+
+	return 0;
+}
+
+static void stream_td_done(struct xhci_stream_td *td, int status, int act_len)
+{
+	struct usb_stream_xfer *xfer = td->xfer;
+
+	xfer->status = status;
+	xfer->act_len = act_len;
+	xfer->done = true;
+	if (usb_pipein(xfer->pipe))
+		xhci_inval_cache((uintptr_t)xfer->buffer, xfer->length);
+	td->ring->queued_trbs -= td->num_trbs;
+	list_del(&td->list);
+	free(td);
+}
+
+/* Handles @event if it is about a TD queued by xhci_stream_submit() */
+static bool stream_transfer_event(struct xhci_ctrl *ctrl,
+				  union xhci_trb *event)
+{
+	u32 field = le32_to_cpu(event->trans_event.flags);
+	u32 len = le32_to_cpu(event->trans_event.transfer_len);
+	struct xhci_stream_td *td;
+	union xhci_trb *trb;
+	uintptr_t addr;
+	int act_len;
+
+	trb = (union xhci_trb *)(uintptr_t)
+		le64_to_cpu(event->trans_event.buffer);
+	list_for_each_entry(td, &ctrl->stream_tds, list) {
+		if (td->udev->slot_id == TRB_TO_SLOT_ID(field) &&
+		    usb_pipe_ep_index(td->xfer->pipe) ==
+		    TRB_TO_EP_INDEX(field) && td_has_trb(td, trb))
+			break;
+	}
+	if (&td->list == &ctrl->stream_tds)
+		return false;
+
+	/* Stopping an endpoint ends no TD */
+	if (GET_COMP_CODE(len) == COMP_STOP ||
+	    GET_COMP_CODE(len) == COMP_STOP_INVAL)
+		return true;
+
+	/*
+	 * With ISP set a short packet ends the TD at whichever TRB it hit:
+	 * count what went before that TRB, then what went in it.
+	 */
+	addr = le32_to_cpu(trb->generic.field[0]);
+	if (sizeof(uintptr_t) > 4)
+		addr |= (u64)le32_to_cpu(trb->generic.field[1]) << 32;
+	act_len = addr - (uintptr_t)td->xfer->buffer +
+		  TRB_LEN(le32_to_cpu(trb->generic.field[2])) -
+		  EVENT_TRB_LEN(len);
+
+	stream_td_done(td, transfer_status(event),
+		       clamp(act_len, 0, td->xfer->length));
+
+	return true;
+}
+
+/**
+ * Handles all the events waiting on the event ring, completing the requests
+ * queued by xhci_stream_submit() which are over. Never waits.
+ *
+ * @param ctrl	Host controller data structure
+ * @return none
+ */
+void xhci_stream_poll(struct xhci_ctrl *ctrl)
+{
+	union xhci_trb *event;
+	trb_type type;
+
+	while (event_ready(ctrl)) {
+		event = ctrl->event_ring->dequeue;
+		type = TRB_FIELD_TO_TYPE(le32_to_cpu(event->event_cmd.flags));
+		if (type == TRB_TRANSFER) {
+			/* e.g. a success after a short packet, on some hosts */
+			if (!stream_transfer_event(ctrl, event))
+				debug("Stray XHCI transfer event for TRB %llx\n",
+				      le64_to_cpu(event->trans_event.buffer));
+		} else if (type != TRB_PORT_STATUS) {
+			printf("Unexpected XHCI event TRB, skipping... "
+				"(%08x %08x %08x %08x)\n",
+				le32_to_cpu(event->generic.field[0]),
+				le32_to_cpu(event->generic.field[1]),
+				le32_to_cpu(event->generic.field[2]),
+				le32_to_cpu(event->generic.field[3]));
+		}
+		xhci_acknowledge_event(ctrl);
+	}
+}
+
+/* Runs a command on an endpoint, completing queued TDs meanwhile */
+static void stream_ep_command(struct usb_device *udev, void *ptr,
+			      int ep_index, trb_type cmd)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	union xhci_trb *event;
+
+	xhci_queue_command(ctrl, ptr, udev->slot_id, ep_index, cmd);
+	event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
+	if (GET_COMP_CODE(le32_to_cpu(event->event_cmd.status)) !=
+	    COMP_SUCCESS)
+		debug("XHCI command %d on ep %d failed: %d\n", cmd, ep_index,
+		      GET_COMP_CODE(le32_to_cpu(event->event_cmd.status)));
+	xhci_acknowledge_event(ctrl);
+}
+
+/**
+ * Gives up on the requests queued by xhci_stream_submit() on an endpoint
+ * without streams, which may be halted. The endpoint then starts again with
+ * the next request queued. The requests given up are done with status
+ * USB_ST_NOT_PROC, unless they completed in the meantime.
+ *
+ * @param udev	pointer to the USB device structure
+ * @param pipe	endpoint of the requests
+ * @return none
+ */
+void xhci_stream_cancel(struct usb_device *udev, unsigned long pipe)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	int ep_index = usb_pipe_ep_index(pipe);
+	struct xhci_ring *ring = virt_dev->eps[ep_index].ring;
+	struct xhci_stream_td *td, *next;
+	struct xhci_ep_ctx *ep_ctx;
+
+	if (!ring || !ring->queued_trbs)
+		return;
+
+	xhci_inval_cache((uintptr_t)virt_dev->out_ctx->bytes,
+			 virt_dev->out_ctx->size);
+	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
+	switch (le32_to_cpu(ep_ctx->ep_info) & EP_STATE_MASK) {
+	case EP_STATE_RUNNING:
+		stream_ep_command(udev, NULL, ep_index, TRB_STOP_RING);
+		break;
+	case EP_STATE_HALTED:
+		stream_ep_command(udev, NULL, ep_index, TRB_RESET_EP);
+		break;
+	}
+	stream_ep_command(udev, (void *)((uintptr_t)ring->enqueue |
+			  ring->cycle_state), ep_index, TRB_SET_DEQ);
+
+	list_for_each_entry_safe(td, next, &ctrl->stream_tds, list) {
+		if (td->ring == ring)
+			stream_td_done(td, USB_ST_NOT_PROC, 0);
+	}
+}
+
+/**
+ * Gives up on all the requests of a device still queued by
+ * xhci_stream_submit(), before its endpoints are reconfigured. They are
+ * done with status USB_ST_NOT_PROC.
+ *
+ * @param ctrl	Host controller data structure
+ * @param udev	pointer to the USB device structure
+ * @return none
+ */
+void xhci_stream_forget(struct xhci_ctrl *ctrl, struct usb_device *udev)
+{
+	struct xhci_stream_td *td, *next;
+
+	list_for_each_entry_safe(td, next, &ctrl->stream_tds, list) {
+		if (td->udev == udev)
+			stream_td_done(td, USB_ST_NOT_PROC, 0);
+	}
+}
+
 /**
  * Queues up the Control Transfer Request
  *
@@ -906,7 +1223,7 @@ int xhci_ctrl_tx(struct usb_device *udev, unsigned long pipe,
 
 	queue_trb(ctrl, ep_ring, false, trb_fields);
 
-	giveback_first_trb(udev, ep_index, start_cycle, start_trb);
+	giveback_first_trb(udev, ep_index, 0, start_cycle, start_trb);
 
 	event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
 	if (!event)
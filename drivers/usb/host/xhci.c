@@ -28,6 +28,7 @@
 #include <asm/cache.h>
 #include <asm/unaligned.h>
 #include <linux/errno.h>
+#include <linux/log2.h>
 #include "xhci.h"
 
 #ifndef CONFIG_USB_MAX_CONTROLLER_COUNT
@@ -480,6 +481,79 @@ static int xhci_configure_endpoints(struct usb_device *udev, bool ctx_change)
 	return 0;
 }
 
+/**
+ * Fill in the input context of an endpoint from its descriptors.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param ep_ctx	endpoint context in the input context
+ * @param endpt_desc	endpoint descriptor
+ * @param ss_ep_comp_desc	SuperSpeed endpoint companion descriptor
+ * @param deq		dequeue pointer, with the cycle state for a ring
+ * @return none
+ */
+static void xhci_init_ep_ctx(struct usb_device *udev,
+			     struct xhci_ep_ctx *ep_ctx,
+			     struct usb_endpoint_descriptor *endpt_desc,
+			     struct usb_ss_ep_comp_descriptor *ss_ep_comp_desc,
+			     u64 deq)
+{
+	u32 max_esit_payload;
+	unsigned int interval;
+	unsigned int mult;
+	unsigned int max_burst;
+	unsigned int avg_trb_len;
+	unsigned int err_count = 0;
+	unsigned int dir;
+	unsigned int ep_type;
+
+	/*
+	 * Get values to fill the endpoint context, mostly from ep
+	 * descriptor. The average TRB buffer lengt for bulk endpoints
+	 * is unclear as we have no clue on scatter gather list entry
+	 * size. For Isoc and Int, set it to max available.
+	 * See xHCI 1.1 spec 4.14.1.1 for details.
+	 */
+	max_esit_payload = xhci_get_max_esit_payload(udev, endpt_desc,
+						     ss_ep_comp_desc);
+	interval = xhci_get_endpoint_interval(udev, endpt_desc);
+	mult = xhci_get_endpoint_mult(udev, endpt_desc, ss_ep_comp_desc);
+	max_burst = xhci_get_endpoint_max_burst(udev, endpt_desc,
+						ss_ep_comp_desc);
+	avg_trb_len = max_esit_payload;
+
+	/*NOTE: ep_desc[0] actually represents EP1 and so on */
+	dir = (((endpt_desc->bEndpointAddress) & (0x80)) >> 7);
+	ep_type = (((endpt_desc->bmAttributes) & (0x3)) | (dir << 2));
+
+	ep_ctx->ep_info =
+		cpu_to_le32(EP_MAX_ESIT_PAYLOAD_HI(max_esit_payload) |
+		EP_INTERVAL(interval) | EP_MULT(mult));
+
+	ep_ctx->ep_info2 = cpu_to_le32(ep_type << EP_TYPE_SHIFT);
+	ep_ctx->ep_info2 |=
+		cpu_to_le32(MAX_PACKET
+		(get_unaligned(&endpt_desc->wMaxPacketSize)));
+
+	/* Allow 3 retries for everything but isoc, set CErr = 3 */
+	if (!usb_endpoint_xfer_isoc(endpt_desc))
+		err_count = 3;
+	ep_ctx->ep_info2 |=
+		cpu_to_le32(MAX_BURST(max_burst) |
+		ERROR_COUNT(err_count));
+
+	ep_ctx->deq = cpu_to_le64(deq);
+
+	/*
+	 * xHCI spec 6.2.3:
+	 * 'Average TRB Length' should be 8 for control endpoints.
+	 */
+	if (usb_endpoint_xfer_control(endpt_desc))
+		avg_trb_len = 8;
+	ep_ctx->tx_info =
+		cpu_to_le32(EP_MAX_ESIT_PAYLOAD_LO(max_esit_payload) |
+		EP_AVG_TRB_LENGTH(avg_trb_len));
+}
+
 /**
  * Configure the endpoint, programming the device contexts.
  *
@@ -496,8 +570,6 @@ static int xhci_set_configuration(struct usb_device *udev)
 	int cur_ep;
 	int max_ep_flag = 0;
 	int ep_index;
-	unsigned int dir;
-	unsigned int ep_type;
 	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
 	int num_of_ep;
 	int ep_flag = 0;
@@ -505,12 +577,6 @@ static int xhci_set_configuration(struct usb_device *udev)
 	int slot_id = udev->slot_id;
 	struct xhci_virt_device *virt_dev = ctrl->devs[slot_id];
 	struct usb_interface *ifdesc;
-	u32 max_esit_payload;
-	unsigned int interval;
-	unsigned int mult;
-	unsigned int max_burst;
-	unsigned int avg_trb_len;
-	unsigned int err_count = 0;
 
 	out_ctx = virt_dev->out_ctx;
 	in_ctx = virt_dev->in_ctx;
@@ -548,71 +614,160 @@ static int xhci_set_configuration(struct usb_device *udev)
 
 		endpt_desc = &ifdesc->ep_desc[cur_ep];
 		ss_ep_comp_desc = &ifdesc->ss_ep_comp_desc[cur_ep];
-		trb_64 = 0;
-
-		/*
-		 * Get values to fill the endpoint context, mostly from ep
-		 * descriptor. The average TRB buffer lengt for bulk endpoints
-		 * is unclear as we have no clue on scatter gather list entry
-		 * size. For Isoc and Int, set it to max available.
-		 * See xHCI 1.1 spec 4.14.1.1 for details.
-		 */
-		max_esit_payload = xhci_get_max_esit_payload(udev, endpt_desc,
-							     ss_ep_comp_desc);
-		interval = xhci_get_endpoint_interval(udev, endpt_desc);
-		mult = xhci_get_endpoint_mult(udev, endpt_desc,
-					      ss_ep_comp_desc);
-		max_burst = xhci_get_endpoint_max_burst(udev, endpt_desc,
-							ss_ep_comp_desc);
-		avg_trb_len = max_esit_payload;
 
 		ep_index = xhci_get_ep_index(endpt_desc);
 		ep_ctx[ep_index] = xhci_get_ep_ctx(ctrl, in_ctx, ep_index);
 
 		/* Allocate the ep rings */
-		virt_dev->eps[ep_index].ring = xhci_ring_alloc(1, true);
+		virt_dev->eps[ep_index].ring = xhci_ring_alloc(
+			usb_endpoint_xfer_bulk(endpt_desc) ? BULK_RING_SEGS : 1,
+			true);
 		if (!virt_dev->eps[ep_index].ring)
 			return -ENOMEM;
 
-		/*NOTE: ep_desc[0] actually represents EP1 and so on */
-		dir = (((endpt_desc->bEndpointAddress) & (0x80)) >> 7);
-		ep_type = (((endpt_desc->bmAttributes) & (0x3)) | (dir << 2));
+		trb_64 = (uintptr_t)
+				virt_dev->eps[ep_index].ring->enqueue;
+		xhci_init_ep_ctx(udev, ep_ctx[ep_index], endpt_desc,
+				 ss_ep_comp_desc, trb_64 |
+				 virt_dev->eps[ep_index].ring->cycle_state);
+	}
 
-		ep_ctx[ep_index]->ep_info =
-			cpu_to_le32(EP_MAX_ESIT_PAYLOAD_HI(max_esit_payload) |
-			EP_INTERVAL(interval) | EP_MULT(mult));
+	return xhci_configure_endpoints(udev, false);
+}
 
-		ep_ctx[ep_index]->ep_info2 =
-			cpu_to_le32(ep_type << EP_TYPE_SHIFT);
-		ep_ctx[ep_index]->ep_info2 |=
-			cpu_to_le32(MAX_PACKET
-			(get_unaligned(&endpt_desc->wMaxPacketSize)));
+#if CONFIG_IS_ENABLED(DM_USB)
+/* Number of streams an endpoint takes, 0 if it can't have any */
+static unsigned int xhci_ep_max_streams(struct usb_endpoint_descriptor *desc,
+				struct usb_ss_ep_comp_descriptor *comp)
+{
+	if (!usb_endpoint_xfer_bulk(desc) || !(comp->bmAttributes & 0x1f))
+		return 0;
 
-		/* Allow 3 retries for everything but isoc, set CErr = 3 */
-		if (!usb_endpoint_xfer_isoc(endpt_desc))
-			err_count = 3;
-		ep_ctx[ep_index]->ep_info2 |=
-			cpu_to_le32(MAX_BURST(max_burst) |
-			ERROR_COUNT(err_count));
+	return 1 << (comp->bmAttributes & 0x1f);
+}
 
-		trb_64 = (uintptr_t)
-				virt_dev->eps[ep_index].ring->enqueue;
-		ep_ctx[ep_index]->deq = cpu_to_le64(trb_64 |
-				virt_dev->eps[ep_index].ring->cycle_state);
+/**
+ * Reconfigure all the endpoints of an interface setting, giving bulk
+ * streams to those whose SuperSpeed companion allows some. The transfers
+ * still queued on them are forgotten. Calling this again resets the rings.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param iface		interface setting, which need not be in udev->config
+ * @param num_streams	streams wanted on each endpoint
+ * @return number of streams usable on each endpoint (IDs 1 to this number),
+ *	   else error code on failure
+ */
+static int _xhci_alloc_streams(struct usb_device *udev,
+			       struct usb_interface *iface,
+			       unsigned int num_streams)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	struct xhci_container_ctx *in_ctx = virt_dev->in_ctx;
+	struct xhci_container_ctx *out_ctx = virt_dev->out_ctx;
+	struct xhci_virt_ep new_eps[USB_MAXENDPOINTS];
+	struct xhci_input_control_ctx *ctrl_ctx;
+	struct usb_endpoint_descriptor *desc;
+	struct usb_ss_ep_comp_descriptor *comp;
+	struct xhci_slot_ctx *slot_ctx;
+	struct xhci_ep_ctx *ep_ctx;
+	struct xhci_virt_ep *ep;
+	unsigned int ep_index, max_ep_index, size, max, i;
+	bool streams = false;
+	u64 deq;
+	u32 hcc;
+	int ret;
 
-		/*
-		 * xHCI spec 6.2.3:
-		 * 'Average TRB Length' should be 8 for control endpoints.
-		 */
-		if (usb_endpoint_xfer_control(endpt_desc))
-			avg_trb_len = 8;
-		ep_ctx[ep_index]->tx_info =
-			cpu_to_le32(EP_MAX_ESIT_PAYLOAD_LO(max_esit_payload) |
-			EP_AVG_TRB_LENGTH(avg_trb_len));
+	hcc = xhci_readl(&ctrl->hccr->cr_hccparams);
+	if (HCC_MAX_PSA(hcc) < 4) {
+		debug("xHCI controller does not support streams\n");
+		return -EOPNOTSUPP;
+	}
+	if (iface->no_of_ep > USB_MAXENDPOINTS)
+		return -EINVAL;
+	for (i = 0; i < iface->no_of_ep; i++) {
+		max = xhci_ep_max_streams(&iface->ep_desc[i],
+					  &iface->ss_ep_comp_desc[i]);
+		if (max) {
+			num_streams = min(num_streams, max);
+			streams = true;
+		}
 	}
+	if (!streams || !num_streams)
+		return -EOPNOTSUPP;
 
-	return xhci_configure_endpoints(udev, false);
+	/* Stream 0 is reserved, the linear array starts with its context */
+	size = min_t(unsigned int, roundup_pow_of_two(num_streams + 1),
+		     HCC_MAX_PSA(hcc));
+	num_streams = min(num_streams, size - 1);
+
+	ctrl_ctx = xhci_get_input_control_ctx(in_ctx);
+	ctrl_ctx->add_flags = cpu_to_le32(SLOT_FLAG);
+	ctrl_ctx->drop_flags = 0;
+
+	xhci_inval_cache((uintptr_t)out_ctx->bytes, out_ctx->size);
+	xhci_slot_copy(ctrl, in_ctx, out_ctx);
+	slot_ctx = xhci_get_slot_ctx(ctrl, in_ctx);
+	max_ep_index = LAST_CTX_TO_EP_NUM(le32_to_cpu(slot_ctx->dev_info));
+
+	memset(new_eps, '\0', sizeof(new_eps));
+	for (i = 0; i < iface->no_of_ep; i++) {
+		desc = &iface->ep_desc[i];
+		comp = &iface->ss_ep_comp_desc[i];
+		ep_index = xhci_get_ep_index(desc);
+		ep = &new_eps[i];
+
+		if (xhci_ep_max_streams(desc, comp)) {
+			ep->stream_info = xhci_stream_info_alloc(size);
+			deq = (uintptr_t)ep->stream_info->stream_ctx_array;
+		} else {
+			ep->ring = xhci_ring_alloc(usb_endpoint_xfer_bulk(desc) ?
+						   BULK_RING_SEGS : 1, true);
+			deq = (uintptr_t)ep->ring->enqueue |
+			      ep->ring->cycle_state;
+		}
+
+		ep_ctx = xhci_get_ep_ctx(ctrl, in_ctx, ep_index);
+		xhci_init_ep_ctx(udev, ep_ctx, desc, comp, deq);
+		if (ep->stream_info)
+			ep_ctx->ep_info |=
+				cpu_to_le32(EP_MAXPSTREAMS(ilog2(size) - 1) |
+					    EP_HAS_LSA);
+
+		/* Drop and add again whatever endpoint is there already */
+		ctrl_ctx->add_flags |= cpu_to_le32(1 << (ep_index + 1));
+		if (virt_dev->eps[ep_index].ring ||
+		    virt_dev->eps[ep_index].stream_info)
+			ctrl_ctx->drop_flags |=
+				cpu_to_le32(1 << (ep_index + 1));
+		max_ep_index = max(max_ep_index, ep_index);
+	}
+	slot_ctx->dev_info &= ~(cpu_to_le32(LAST_CTX_MASK));
+	slot_ctx->dev_info |= cpu_to_le32(LAST_CTX(max_ep_index + 1));
+
+	xhci_stream_forget(ctrl, udev);
+	ret = xhci_configure_endpoints(udev, false);
+
+	/* Free the rings which are not used any more, old or new */
+	for (i = 0; i < iface->no_of_ep; i++) {
+		ep = &new_eps[i];
+		if (!ret) {
+			ep_index = xhci_get_ep_index(&iface->ep_desc[i]);
+			swap(virt_dev->eps[ep_index], *ep);
+		}
+		if (ep->ring)
+			xhci_ring_free(ep->ring);
+		if (ep->stream_info)
+			xhci_stream_info_free(ep->stream_info);
+	}
+	if (ret)
+		return ret;
+	debug("%d streams per endpoint of interface %d\n", num_streams,
+	      iface->desc.bInterfaceNumber);
+
+	return num_streams;
 }
+#endif
 
 /**
  * Issue an Address Device command (which will issue a SetAddress request to
@@ -1209,6 +1364,7 @@ static int xhci_lowlevel_init(struct xhci_ctrl *ctrl)
 	/* initializing xhci data structures */
 	if (xhci_mem_init(ctrl, hccr, hcor) < 0)
 		return -ENOMEM;
+	INIT_LIST_HEAD(&ctrl->stream_tds);
 
 	reg = xhci_readl(&hccr->cr_hcsparams1);
 	descriptor.hub.bNbrPorts = ((reg & HCS_MAX_PORTS_MASK) >>
@@ -1464,6 +1620,38 @@ static int xhci_update_hub_device(struct udevice *dev, struct usb_device *udev)
 	return xhci_configure_endpoints(udev, false);
 }
 
+static int xhci_alloc_streams(struct udevice *dev, struct usb_device *udev,
+			      struct usb_interface *iface,
+			      unsigned int num_streams)
+{
+	debug("%s: dev='%s', udev=%p\n", __func__, dev->name, udev);
+	return _xhci_alloc_streams(udev, iface, num_streams);
+}
+
+static int xhci_submit_stream_xfer(struct udevice *dev,
+				   struct usb_device *udev,
+				   struct usb_stream_xfer *xfer)
+{
+	return xhci_stream_submit(udev, xfer);
+}
+
+static int xhci_poll_stream_xfers(struct udevice *dev,
+				  struct usb_device *udev)
+{
+	xhci_stream_poll(dev_get_priv(dev));
+
+	return 0;
+}
+
+static int xhci_cancel_stream_xfers(struct udevice *dev,
+				    struct usb_device *udev,
+				    unsigned long pipe)
+{
+	xhci_stream_cancel(udev, pipe);
+
+	return 0;
+}
+
 static int xhci_get_max_xfer_size(struct udevice *dev, size_t *size)
 {
 	/*
@@ -1472,6 +1660,8 @@ static int xhci_get_max_xfer_size(struct udevice *dev, size_t *size)
 	 * a TRB ring. Each TRB can transfer up to 64K bytes, however data
 	 * buffers referenced by transfer TRBs shall not span 64KB boundaries.
 	 * Hence the maximum number of TRBs we can use in one transfer is 62.
+	 * Bulk rings have BULK_RING_SEGS segments, which leaves room for the
+	 * next transfers queued with xhci_stream_submit().
 	 */
 	*size = (TRBS_PER_SEGMENT - 2) * TRB_MAX_BUFF_SIZE;
 
@@ -1532,6 +1722,10 @@ struct dm_usb_ops xhci_usb_ops = {
 	.alloc_device = xhci_alloc_device,
 	.update_hub_device = xhci_update_hub_device,
 	.get_max_xfer_size  = xhci_get_max_xfer_size,
+	.alloc_streams = xhci_alloc_streams,
+	.submit_stream_xfer = xhci_submit_stream_xfer,
+	.poll_stream_xfers = xhci_poll_stream_xfers,
+	.cancel_stream_xfers = xhci_cancel_stream_xfers,
 };
 
 #endif
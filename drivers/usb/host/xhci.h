@@ -996,6 +996,11 @@ typedef enum {
  * Change this if you change TRBS_PER_SEGMENT!
  */
 #define SEGMENT_SHIFT		10
+/*
+ * Bulk endpoints get rings of two segments, so that a TD as large as
+ * xhci_get_max_xfer_size() allows still leaves room for a few more
+ */
+#define BULK_RING_SEGS		2
 /* TRB buffer pointers can't cross 64KB boundaries */
 #define TRB_MAX_BUFF_SHIFT	16
 #define TRB_MAX_BUFF_SIZE	(1 << TRB_MAX_BUFF_SHIFT)
@@ -1019,6 +1024,8 @@ struct xhci_ring {
 	 */
 	volatile u32		cycle_state;
 	unsigned int		num_segs;
+	/* TRBs of the TDs queued by xhci_stream_submit() still in flight */
+	unsigned int		queued_trbs;
 };
 
 struct xhci_erst_entry {
@@ -1056,8 +1063,34 @@ struct xhci_scratchpad {
 #define XHCI_STOP_EP_CMD_TIMEOUT	5
 /* XXX: Make these module parameters */
 
+/**
+ * struct xhci_stream_ctx - Stream context, an entry of a stream context array
+ * @stream_ring:	64-bit stream ring address, cycle state, and stream type
+ *
+ * Section 6.2.4.1
+ */
+struct xhci_stream_ctx {
+	__le64	stream_ring;
+	/* offset 0x8 - 0xf reserved for the Stopped EDTLA */
+	__le32	reserved[2];
+};
+
+/* Stream Context Types (section 6.4.1) - bits 3:1 of stream ctx deq ptr */
+#define SCT_FOR_CTX(p)		(((p) & 0x7) << 1)
+/* Primary stream array type, dequeue pointer is to a transfer ring */
+#define SCT_PRI_TR		1
+
+struct xhci_stream_info {
+	struct xhci_ring		**stream_rings;
+	/* Number of streams, including stream 0 (which drivers can't use) */
+	unsigned int			num_streams;
+	struct xhci_stream_ctx		*stream_ctx_array;
+};
+
 struct xhci_virt_ep {
 	struct xhci_ring		*ring;
+	/* Set instead of @ring when the endpoint has streams */
+	struct xhci_stream_info		*stream_info;
 	unsigned int			ep_state;
 #define SET_DEQ_PENDING		(1 << 0)
 #define EP_HALTED		(1 << 1)	/* For stall handling */
@@ -1230,6 +1263,8 @@ struct xhci_ctrl {
 	struct xhci_scratchpad *scratchpad;
 	struct xhci_virt_device *devs[MAX_HC_SLOTS];
 	int rootdev;
+	/* TDs queued by xhci_stream_submit() and not completed yet */
+	struct list_head stream_tds;
 };
 
 unsigned long trb_addr(struct xhci_segment *seg, union xhci_trb *trb);
@@ -1262,6 +1297,13 @@ void xhci_flush_cache(uintptr_t addr, u32 type_len);
 void xhci_inval_cache(uintptr_t addr, u32 type_len);
 void xhci_cleanup(struct xhci_ctrl *ctrl);
 struct xhci_ring *xhci_ring_alloc(unsigned int num_segs, bool link_trbs);
+void xhci_ring_free(struct xhci_ring *ring);
+struct xhci_stream_info *xhci_stream_info_alloc(unsigned int num_streams);
+void xhci_stream_info_free(struct xhci_stream_info *info);
+int xhci_stream_submit(struct usb_device *udev, struct usb_stream_xfer *xfer);
+void xhci_stream_poll(struct xhci_ctrl *ctrl);
+void xhci_stream_cancel(struct usb_device *udev, unsigned long pipe);
+void xhci_stream_forget(struct xhci_ctrl *ctrl, struct usb_device *udev);
 int xhci_alloc_virt_device(struct xhci_ctrl *ctrl, unsigned int slot_id);
 int xhci_mem_init(struct xhci_ctrl *ctrl, struct xhci_hccr *hccr,
 		  struct xhci_hcor *hcor);
@@ -91,6 +91,38 @@ struct pos_info {
  */
 #define POS_HISTORY_SIZE	(CONFIG_SYS_CBSIZE * 11 / 10)
 
+/* Size of the glyph cache hash table, and the most glyphs kept */
+#define GLYPH_HASH_SIZE		64
+#define GLYPH_MAX		256
+
+/**
+ * struct tt_glyph - A character rendered for the display
+ *
+ * The image is held in the pixel format of the display, ready to be
+ * combined with the frame buffer.
+ *
+ * @next:	Next glyph in the same hash chain
+ * @ch:		Character
+ * @x_shift:	Position within the pixel at which the character was rendered
+ * @inverse:	true if rendered for a non-black background
+ * @width:	Width of the image in pixels, 0 if the character is empty
+ * @height:	Height of the image in pixels
+ * @xoff:	X offset of the image from the cursor position
+ * @yoff:	Y offset of the image from the baseline
+ * @pix:	Image, @width x @height pixels
+ */
+struct tt_glyph {
+	struct tt_glyph *next;
+	int ch;
+	double x_shift;
+	bool inverse;
+	int width;
+	int height;
+	int xoff;
+	int yoff;
+	u16 pix[];
+};
+
 /**
  * struct console_tt_priv - Private data for this driver
  *
@@ -110,6 +142,9 @@ struct pos_info {
  * @scale:	Scale of the font. This is calculated from the pixel height
  *		of the font. It is used by the STB library to generate images
  *		of the correct size.
+ * @glyphs:	Glyph cache, hashed by character. The font and size are fixed
+ *		for the device, so they are not part of the key
+ * @glyph_count: Number of glyphs in the cache
  */
 struct console_tt_priv {
 	int font_size;
@@ -119,6 +154,8 @@ struct console_tt_priv {
 	int pos_ptr;
 	int baseline;
 	double scale;
+	struct tt_glyph *glyphs[GLYPH_HASH_SIZE];
+	int glyph_count;
 };
 
 static int console_truetype_set_row(struct udevice *dev, uint row, int clr)
@@ -186,6 +223,99 @@ static int console_truetype_move_rows(struct udevice *dev, uint rowdst,
 	return 0;
 }
 
+static void console_truetype_drop_glyphs(struct console_tt_priv *priv)
+{
+	struct tt_glyph *glyph, *next;
+	int i;
+
+	for (i = 0; i < GLYPH_HASH_SIZE; i++) {
+		for (glyph = priv->glyphs[i]; glyph; glyph = next) {
+			next = glyph->next;
+			free(glyph);
+		}
+		priv->glyphs[i] = NULL;
+	}
+	priv->glyph_count = 0;
+}
+
+/**
+ * console_truetype_get_glyph() - Get a character rendered for a 16bpp display
+ *
+ * The character is rendered and added to the cache unless it is there
+ * already. The cache is emptied when it is full.
+ *
+ * @priv:	Driver private data
+ * @ch:		Character to render
+ * @x_shift:	Position within the pixel to render at
+ * @inverse:	true to render for a non-black background
+ * @return glyph, or NULL if out of memory
+ */
+static struct tt_glyph *console_truetype_get_glyph(struct console_tt_priv *priv,
+						   int ch, double x_shift,
+						   bool inverse)
+{
+	struct tt_glyph **chain = &priv->glyphs[(uchar)ch % GLYPH_HASH_SIZE];
+	struct tt_glyph *glyph;
+	int width, height, xoff, yoff;
+	u8 *data;
+	int i;
+
+	for (glyph = *chain; glyph; glyph = glyph->next) {
+		if (glyph->ch == ch && glyph->x_shift == x_shift &&
+		    glyph->inverse == inverse)
+			return glyph;
+	}
+
+	/*
+	 * Render the character as an 8-bit-per-pixel image. For empty
+	 * characters, like ' ', data will return NULL
+	 */
+	data = stbtt_GetCodepointBitmapSubpixel(&priv->font, priv->scale,
+						priv->scale, x_shift, 0, ch,
+						&width, &height, &xoff, &yoff);
+	if (!data)
+		width = 0;
+	if (!width)
+		height = 0;
+
+	if (priv->glyph_count == GLYPH_MAX) {
+		console_truetype_drop_glyphs(priv);
+		chain = &priv->glyphs[(uchar)ch % GLYPH_HASH_SIZE];
+	}
+	glyph = malloc(sizeof(*glyph) + width * height * sizeof(u16));
+	if (!glyph) {
+		free(data);
+		return NULL;
+	}
+	glyph->ch = ch;
+	glyph->x_shift = x_shift;
+	glyph->inverse = inverse;
+	glyph->width = width;
+	glyph->height = height;
+	glyph->xoff = xoff;
+	glyph->yoff = yoff;
+
+	/*
+	 * Convert the image into the colour depth of the display. We only
+	 * expect white-on-black or the reverse so the code only handles this
+	 * simple case.
+	 */
+	for (i = 0; i < width * height; i++) {
+		int val = data[i];
+
+		if (inverse)
+			val = 255 - val;
+		glyph->pix[i] = val >> 3 | (val >> 2) << 5 | (val >> 3) << 11;
+	}
+	free(data);
+
+	glyph->next = *chain;
+	*chain = glyph;
+	priv->glyph_count++;
+
+	return glyph;
+}
+
 static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 				    char ch)
 {
@@ -194,12 +324,12 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	struct video_priv *vid_priv = dev_get_uclass_priv(vid);
 	struct console_tt_priv *priv = dev_get_priv(dev);
 	stbtt_fontinfo *font = &priv->font;
-	int width, height, xoff, yoff;
 	double xpos, x_shift;
 	int lsb;
 	int width_frac, linenum;
 	struct pos_info *pos;
-	u8 *bits, *data;
+	struct tt_glyph *glyph;
+	u16 *pix;
 	int advance;
 	void *line;
 	int row;
@@ -238,63 +368,52 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	}
 
 	/*
-	 * Figure out how much past the start of a pixel we are, and pass this
-	 * information into the render, which will return a 8-bit-per-pixel
-	 * image of the character. For empty characters, like ' ', data will
-	 * return NULL;
+	 * Figure out how much past the start of a pixel we are, and get the
+	 * image of the character rendered at that position
 	 */
-	data = stbtt_GetCodepointBitmapSubpixel(font, priv->scale, priv->scale,
-						x_shift, 0, ch, &width, &height,
-						&xoff, &yoff);
-	if (!data)
+#if CONFIG_CONSOLE_TRUETYPE_SUBPIXEL_STEPS
+	x_shift = tt_floor(x_shift * CONFIG_CONSOLE_TRUETYPE_SUBPIXEL_STEPS);
+	x_shift /= CONFIG_CONSOLE_TRUETYPE_SUBPIXEL_STEPS;
+#endif
+	glyph = console_truetype_get_glyph(priv, ch, x_shift,
+					   vid_priv->colour_bg != 0);
+	if (!glyph)
+		return -ENOMEM;
+	if (!glyph->width)
 		return width_frac;
 
 	/* Figure out where to write the character in the frame buffer */
-	bits = data;
+	pix = glyph->pix;
 	line = vid_priv->fb + y * vid_priv->line_length +
 		VID_TO_PIXEL(x) * VNBYTES(vid_priv->bpix);
-	linenum = priv->baseline + yoff;
+	linenum = priv->baseline + glyph->yoff;
 	if (linenum > 0)
 		line += linenum * vid_priv->line_length;
 
-	/*
-	 * Write a row at a time, converting the 8bpp image into the colour
-	 * depth of the display. We only expect white-on-black or the reverse
-	 * so the code only handles this simple case.
-	 */
-	for (row = 0; row < height; row++) {
+	/* Write a row at a time, combining the image with the display */
+	for (row = 0; row < glyph->height; row++) {
 		switch (vid_priv->bpix) {
 #ifdef CONFIG_VIDEO_BPP16
 		case VIDEO_BPP16: {
-			uint16_t *dst = (uint16_t *)line + xoff;
+			uint16_t *dst = (uint16_t *)line + glyph->xoff;
 			int i;
 
-			for (i = 0; i < width; i++) {
-				int val = *bits;
-				int out;
-
-				if (vid_priv->colour_bg)
-					val = 255 - val;
-				out = val >> 3 |
-					(val >> 2) << 5 |
-					(val >> 3) << 11;
+			for (i = 0; i < glyph->width; i++) {
 				if (vid_priv->colour_fg)
-					*dst++ |= out;
+					*dst++ |= *pix;
 				else
-					*dst++ &= out;
-				bits++;
+					*dst++ &= *pix;
+				pix++;
 			}
 			break;
 		}
 #endif
 		default:
-			free(data);
 			return -ENOSYS;
 		}
 
 		line += vid_priv->line_length;
 	}
-	free(data);
 
 	return width_frac;
 }
@@ -533,6 +652,13 @@ static int console_truetype_probe(struct udevice *dev)
 	return 0;
 }
 
+static int console_truetype_remove(struct udevice *dev)
+{
+	console_truetype_drop_glyphs(dev_get_priv(dev));
+
+	return 0;
+}
+
 struct vidconsole_ops console_truetype_ops = {
 	.putc_xy	= console_truetype_putc_xy,
 	.move_rows	= console_truetype_move_rows,
@@ -546,5 +672,6 @@ U_BOOT_DRIVER(vidconsole_truetype) = {
 	.id	= UCLASS_VIDEO_CONSOLE,
 	.ops	= &console_truetype_ops,
 	.probe	= console_truetype_probe,
+	.remove	= console_truetype_remove,
 	.priv_auto_alloc_size	= sizeof(struct console_tt_priv),
 };
@@ -28,31 +28,64 @@ struct vid_rgb {
 #define CONFIG_CONSOLE_SCROLL_LINES 1
 #endif
 
+/* Note an area of the display drawn by the console, see video_damage() */
+static void vidconsole_damage(struct udevice *dev, int x, int y, int width,
+			      int height)
+{
+	struct video_priv *vid_priv = dev_get_uclass_priv(dev->parent);
+
+	/* A rotated console draws elsewhere in the frame buffer */
+	if (vid_priv->rot)
+		video_damage(dev->parent, 0, 0, vid_priv->xsize,
+			     vid_priv->ysize);
+	else
+		video_damage(dev->parent, x, y, width, height);
+}
+
 int vidconsole_putc_xy(struct udevice *dev, uint x, uint y, char ch)
 {
+	struct vidconsole_priv *priv = dev_get_uclass_priv(dev);
 	struct vidconsole_ops *ops = vidconsole_get_ops(dev);
+	int ret;
 
 	if (!ops->putc_xy)
 		return -ENOSYS;
-	return ops->putc_xy(dev, x, y, ch);
+	ret = ops->putc_xy(dev, x, y, ch);
+	/* Allow for a character overhanging its advance */
+	if (ret > 0)
+		vidconsole_damage(dev, VID_TO_PIXEL(x), y,
+				  VID_TO_PIXEL(ret) + 1 + priv->x_charsize,
+				  priv->y_charsize);
+
+	return ret;
 }
 
 int vidconsole_move_rows(struct udevice *dev, uint rowdst, uint rowsrc,
 			 uint count)
 {
+	struct vidconsole_priv *priv = dev_get_uclass_priv(dev);
 	struct vidconsole_ops *ops = vidconsole_get_ops(dev);
+	struct video_priv *vid_priv = dev_get_uclass_priv(dev->parent);
 
 	if (!ops->move_rows)
 		return -ENOSYS;
+	vidconsole_damage(dev, 0, rowdst * priv->y_charsize, vid_priv->xsize,
+			  count * priv->y_charsize);
+
 	return ops->move_rows(dev, rowdst, rowsrc, count);
 }
 
 int vidconsole_set_row(struct udevice *dev, uint row, int clr)
 {
+	struct vidconsole_priv *priv = dev_get_uclass_priv(dev);
 	struct vidconsole_ops *ops = vidconsole_get_ops(dev);
+	struct video_priv *vid_priv = dev_get_uclass_priv(dev->parent);
 
 	if (!ops->set_row)
 		return -ENOSYS;
+	vidconsole_damage(dev, 0, row * priv->y_charsize, vid_priv->xsize,
+			  priv->y_charsize);
+
 	return ops->set_row(dev, row, clr);
 }
 
@@ -74,8 +107,13 @@ static int vidconsole_back(struct udevice *dev)
 
 	if (ops->backspace) {
 		ret = ops->backspace(dev);
-		if (ret != -ENOSYS)
+		if (ret != -ENOSYS) {
+			/* The character erased is at the new position */
+			vidconsole_damage(dev, 0, priv->ycur,
+					  video_get_xsize(dev->parent),
+					  priv->y_charsize);
 			return ret;
+		}
 	}
 
 	priv->xcur_frac -= VID_TO_POS(priv->x_charsize);
@@ -90,6 +90,7 @@ int video_clear(struct udevice *dev)
 {
 	struct video_priv *priv = dev_get_uclass_priv(dev);
 
+	video_damage(dev, 0, 0, priv->xsize, priv->ysize);
 	switch (priv->bpix) {
 	case VIDEO_BPP16: {
 		u16 *ppix = priv->fb;
@@ -140,26 +141,84 @@ void video_set_default_colors(struct udevice *dev, bool invert)
 	priv->colour_bg = vid_console_color(priv, back);
 }
 
-/* Flush video activity to the caches */
-void video_sync(struct udevice *vid, bool force)
+void video_damage(struct udevice *vid, int x, int y, int width, int height)
 {
+	struct video_priv *priv = dev_get_uclass_priv(vid);
+	struct video_damage *damage = &priv->damage;
+	int xend = min(x + width, (int)priv->xsize);
+	int yend = min(y + height, (int)priv->ysize);
+
+	if (x >= xend || y >= yend)
+		return;
+	if (damage->xstart >= damage->xend || damage->ystart >= damage->yend) {
+		damage->xstart = x;
+		damage->ystart = y;
+		damage->xend = xend;
+		damage->yend = yend;
+	} else {
+		damage->xstart = min(damage->xstart, x);
+		damage->ystart = min(damage->ystart, y);
+		damage->xend = max(damage->xend, xend);
+		damage->yend = max(damage->yend, yend);
+	}
+}
+
+#if defined(CONFIG_VIDEO_SANDBOX_SDL)
+static ulong last_sync;
+#endif
+
+/* Sync @size bytes of the frame buffer at @offset */
+static void video_sync_span(struct video_priv *priv, ulong offset, ulong size)
+{
+	__maybe_unused void *fb = priv->fb;
+
+	if (IS_ENABLED(CONFIG_VIDEO_COPY) && priv->copy_fb) {
+		memcpy(priv->copy_fb + offset, priv->fb + offset, size);
+		fb = priv->copy_fb;
+	}
+
 	/*
 	 * flush_dcache_range() is declared in common.h but it seems that some
 	 * architectures do not actually implement it. Is there a way to find
 	 * out whether it exists? For now, ARM is safe.
 	 */
 #if defined(CONFIG_ARM) && !defined(CONFIG_SYS_DCACHE_OFF)
-	struct video_priv *priv = dev_get_uclass_priv(vid);
-
 	if (priv->flush_dcache) {
-		flush_dcache_range((ulong)priv->fb,
-				   ALIGN((ulong)priv->fb + priv->fb_size,
+		flush_dcache_range(ALIGN_DOWN((ulong)fb + offset,
+					      CONFIG_SYS_CACHELINE_SIZE),
+				   ALIGN((ulong)fb + offset + size,
 					 CONFIG_SYS_CACHELINE_SIZE));
 	}
-#elif defined(CONFIG_VIDEO_SANDBOX_SDL)
+#endif
+}
+
+/* Flush video activity to the caches */
+void video_sync(struct udevice *vid, bool force)
+{
 	struct video_priv *priv = dev_get_uclass_priv(vid);
-	static ulong last_sync;
+	struct video_damage *damage = &priv->damage;
+	int bytes = VNBYTES(priv->bpix);
+	int y;
+
+	if (damage->xstart < damage->xend && damage->ystart < damage->yend) {
+		/* Sync whole rows as one span, otherwise row by row */
+		if (!damage->xstart && damage->xend == priv->xsize) {
+			video_sync_span(priv,
+					damage->ystart * priv->line_length,
+					(damage->yend - damage->ystart) *
+					priv->line_length);
+		} else {
+			for (y = damage->ystart; y < damage->yend; y++)
+				video_sync_span(priv,
+						y * priv->line_length +
+						damage->xstart * bytes,
+						(damage->xend - damage->xstart) *
+						bytes);
+		}
+		memset(damage, '\0', sizeof(*damage));
+	}
 
+#if defined(CONFIG_VIDEO_SANDBOX_SDL)
 	if (force || get_timer(last_sync) > 10) {
 		sandbox_sdl_sync(priv->fb);
 		last_sync = get_timer(0);
@@ -174,8 +233,11 @@ void video_sync_all(void)
 	for (uclass_find_first_device(UCLASS_VIDEO, &dev);
 	     dev;
 	     uclass_find_next_device(&dev)) {
-		if (device_active(dev))
+		if (device_active(dev)) {
+			video_damage(dev, 0, 0, video_get_xsize(dev),
+				     video_get_ysize(dev));
 			video_sync(dev, true);
+		}
 	}
 }
 
@@ -230,6 +292,8 @@ static int video_post_probe(struct udevice *dev)
 		priv->line_length = priv->xsize * VNBYTES(priv->bpix);
 
 	priv->fb_size = priv->line_length * priv->ysize;
+	if (IS_ENABLED(CONFIG_VIDEO_COPY) && plat->copy_base)
+		priv->copy_fb = map_sysmem(plat->copy_base, priv->fb_size);
 
 	/* Set up colors  */
 	video_set_default_colors(dev, false);
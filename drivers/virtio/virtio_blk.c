@@ -7,51 +7,138 @@
 #include <common.h>
 #include <blk.h>
 #include <dm.h>
+#include <malloc.h>
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
 #include "virtio_blk.h"
 
+/* Requests that one read or write keeps in flight at most */
+#define VIRTIO_BLK_MAX_REQS	16
+/* Sectors per request, unless seg_max and size_max allow fewer */
+#define VIRTIO_BLK_REQ_SECTORS	2048
+
+struct virtio_blk_req {
+	struct virtio_blk_outhdr out_hdr;
+	u8 status;
+	u64 sector;
+};
+
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	struct virtio_blk_req reqs[VIRTIO_BLK_MAX_REQS];
+	struct virtio_sg *sg;	/* header, data segments and status */
+	struct virtio_sg **sgs;
+	u32 seg_max;		/* data segments per request */
+	u32 size_max;		/* bytes per data segment */
+	u32 req_sectors;	/* sectors per request */
 };
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+static const u32 feature[] = {
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+};
+
+static int virtio_blk_add_req(struct udevice *dev, struct virtio_blk_req *req,
+			      u32 type, u64 sector, u32 count, void *buffer)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg *sgs[3];
-	u8 status;
-	int ret;
-
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(dev, type),
-		.sector = cpu_to_virtio64(dev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
-	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
-
-	sgs[num_out++] = &hdr_sg;
-
-	if (type & VIRTIO_BLK_T_OUT)
-		sgs[num_out++] = &data_sg;
-	else
-		sgs[num_out + num_in++] = &data_sg;
-
-	sgs[num_out + num_in++] = &status_sg;
-
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
-	if (ret)
-		return ret;
-
-	virtqueue_kick(priv->vq);
+	u32 len = count * 512;
+	u32 seg;
+
+	req->out_hdr.type = cpu_to_virtio32(dev, type);
+	req->out_hdr.ioprio = 0;
+	req->out_hdr.sector = cpu_to_virtio64(dev, sector);
+	req->status = VIRTIO_BLK_S_UNSUPP;
+	req->sector = sector;
+
+	priv->sg[0].addr = &req->out_hdr;
+	priv->sg[0].length = sizeof(req->out_hdr);
+	priv->sgs[num_out++] = &priv->sg[0];
+
+	/* The data, in segments of at most size_max bytes */
+	while (len) {
+		struct virtio_sg *sg = &priv->sg[num_out + num_in];
+
+		seg = min(len, priv->size_max);
+		sg->addr = buffer;
+		sg->length = seg;
+		if (type & VIRTIO_BLK_T_OUT)
+			priv->sgs[num_out++] = sg;
+		else
+			priv->sgs[num_out + num_in++] = sg;
+		buffer += seg;
+		len -= seg;
+	}
+
+	priv->sg[num_out + num_in].addr = &req->status;
+	priv->sg[num_out + num_in].length = sizeof(req->status);
+	priv->sgs[num_out + num_in] = &priv->sg[num_out + num_in];
+	num_in++;
+
+	return virtqueue_add(priv->vq, priv->sgs, num_out, num_in);
+}
 
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
+static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
+			       lbaint_t blkcnt, void *buffer, u32 type)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_outhdr *out_hdr;
+	struct virtio_blk_req *req;
+	u64 start = sector;
+	u64 end = sector + blkcnt;
+	/* First sector of the first request that failed */
+	u64 err_sector = end;
+	u32 busy = 0;
+	bool added;
+	u32 count;
+	int i, ret;
 
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+	/*
+	 * Keep up to VIRTIO_BLK_MAX_REQS requests in flight, as many as the
+	 * ring has room for. They may complete in any order.
+	 */
+	while ((sector < end && err_sector == end) || busy) {
+		added = false;
+		while (sector < end && err_sector == end) {
+			for (i = 0; busy & BIT(i); i++)
+				;
+			if (i == VIRTIO_BLK_MAX_REQS)
+				break;
+
+			req = &priv->reqs[i];
+			count = min_t(u64, end - sector, priv->req_sectors);
+			ret = virtio_blk_add_req(dev, req, type, sector, count,
+						 buffer + (sector - start) * 512);
+			if (ret == -ENOSPC && busy)
+				break;
+			if (ret) {
+				err_sector = sector;
+				break;
+			}
+			busy |= BIT(i);
+			sector += count;
+			added = true;
+		}
+		if (added)
+			virtqueue_kick(priv->vq);
+		if (!busy)
+			break;
+
+		while (!(out_hdr = virtqueue_get_buf(priv->vq, NULL)))
+			;
+		do {
+			req = container_of(out_hdr, struct virtio_blk_req,
+					   out_hdr);
+			if (req->status != VIRTIO_BLK_S_OK &&
+			    req->sector < err_sector)
+				err_sector = req->sector;
+			busy &= ~BIT(req - priv->reqs);
+		} while ((out_hdr = virtqueue_get_buf(priv->vq, NULL)));
+	}
+
+	return err_sector - start;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
@@ -97,7 +184,8 @@ static int virtio_blk_bind(struct udevice *dev)
 	desc->bdev = dev;
 
 	/* Indicate what driver features we support */
-	virtio_driver_features_init(uc_priv, NULL, 0, NULL, 0);
+	virtio_driver_features_init(uc_priv, feature, ARRAY_SIZE(feature),
+				    NULL, 0);
 
 	return 0;
 }
@@ -106,6 +194,7 @@ static int virtio_blk_probe(struct udevice *dev)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	unsigned int ring_size;
 	u64 cap;
 	int ret;
 
@@ -117,6 +206,34 @@ static int virtio_blk_probe(struct udevice *dev)
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
 	desc->lba = cap;
 
+	priv->size_max = VIRTIO_BLK_REQ_SECTORS * 512;
+	if (virtio_has_feature(dev, VIRTIO_BLK_F_SIZE_MAX))
+		virtio_cread(dev, struct virtio_blk_config, size_max,
+			     &priv->size_max);
+	priv->size_max = max_t(u32, priv->size_max & ~511, 512);
+
+	/*
+	 * A request has to fit into the ring also when it cannot get an
+	 * indirect table
+	 */
+	priv->seg_max = 1;
+	if (virtio_has_feature(dev, VIRTIO_BLK_F_SEG_MAX))
+		virtio_cread(dev, struct virtio_blk_config, seg_max,
+			     &priv->seg_max);
+	ring_size = max(virtqueue_get_vring_size(priv->vq), 3U);
+	priv->seg_max = clamp_t(u32, priv->seg_max, 1, ring_size - 2);
+
+	priv->req_sectors = min_t(u64, VIRTIO_BLK_REQ_SECTORS,
+				  (u64)priv->seg_max * priv->size_max / 512);
+
+	priv->sg = calloc(priv->seg_max + 2, sizeof(*priv->sg));
+	priv->sgs = calloc(priv->seg_max + 2, sizeof(*priv->sgs));
+	if (!priv->sg || !priv->sgs) {
+		free(priv->sg);
+		free(priv->sgs);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -12,8 +12,11 @@
 #include <virtio_ring.h>
 #include "virtio_net.h"
 
-/* Amount of buffers to keep in the RX virtqueue */
-#define VIRTIO_NET_NUM_RX_BUFS	32
+/* Amount of buffers to keep in the RX virtqueue, if it has room for them */
+#define VIRTIO_NET_NUM_RX_BUFS	128
+
+/* Frames that may wait in the TX virtqueue for the device to send them */
+#define VIRTIO_NET_NUM_TX_BUFS	16
 
 /*
  * This value comes from the VirtIO spec: 1500 for maximum packet size,
@@ -31,39 +34,89 @@ struct virtio_net_priv {
 	};
 
 	char rx_buff[VIRTIO_NET_NUM_RX_BUFS][VIRTIO_NET_RX_BUF_SIZE];
+	int rx_num;		/* buffers used, as many as the ring takes */
+	/* RX buffers handed out by the last recv_batch() */
+	void *rx_batch[ETH_RX_BATCH];
 	bool rx_running;
+
+	/* Frames are copied here, so that send() need not wait for them */
+	char tx_buff[VIRTIO_NET_NUM_TX_BUFS][VIRTIO_NET_RX_BUF_SIZE];
+	u32 tx_busy;
+
+	bool mrg_rxbuf;
 	int net_hdr_len;
 };
 
 /*
- * For simplicity, the driver only negotiates the VIRTIO_NET_F_MAC feature.
- * For the VIRTIO_NET_F_STATUS feature, we don't negotiate it, hence per spec
- * we should assume the link is always active.
+ * For simplicity, the driver only negotiates the VIRTIO_NET_F_MAC and
+ * VIRTIO_NET_F_MRG_RXBUF features. For the VIRTIO_NET_F_STATUS feature, we
+ * don't negotiate it, hence per spec we should assume the link is always
+ * active.
  */
 static const u32 feature[] = {
-	VIRTIO_NET_F_MAC
+	VIRTIO_NET_F_MAC,
+	VIRTIO_NET_F_MRG_RXBUF,
 };
 
 static const u32 feature_legacy[] = {
-	VIRTIO_NET_F_MAC
+	VIRTIO_NET_F_MAC,
+	VIRTIO_NET_F_MRG_RXBUF,
 };
 
+static void virtio_net_rx_post(struct virtio_net_priv *priv, void *buf)
+{
+	struct virtio_sg sg = { buf, VIRTIO_NET_RX_BUF_SIZE };
+	struct virtio_sg *sgs[] = { &sg };
+
+	virtqueue_add(priv->rx_vq, sgs, 0, 1);
+}
+
+/*
+ * Take the next received frame from the RX virtqueue. Its length is 0 if it
+ * is to be dropped, which is the case for frames merged from several buffers:
+ * with our MTU the device never needs more than one.
+ */
+static void *virtio_net_rx_get(struct udevice *dev, int *lenp)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	struct virtio_net_hdr_v1 *hdr;
+	unsigned int len;
+	void *buf, *extra;
+	u16 num;
+
+	buf = virtqueue_get_buf(priv->rx_vq, &len);
+	if (!buf)
+		return NULL;
+
+	*lenp = len - priv->net_hdr_len;
+	if (priv->mrg_rxbuf) {
+		hdr = buf;
+		num = virtio16_to_cpu(dev, hdr->num_buffers);
+		if (num > 1) {
+			debug("%s: dropping frame of %u buffers\n", __func__,
+			      num);
+			*lenp = 0;
+			while (--num) {
+				extra = virtqueue_get_buf(priv->rx_vq, NULL);
+				if (!extra)
+					break;
+				virtio_net_rx_post(priv, extra);
+			}
+		}
+	}
+
+	return buf;
+}
+
 static int virtio_net_start(struct udevice *dev)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
-	struct virtio_sg sg;
-	struct virtio_sg *sgs[] = { &sg };
 	int i;
 
 	if (!priv->rx_running) {
-		/* receive buffer length is always 1526 */
-		sg.length = VIRTIO_NET_RX_BUF_SIZE;
-
 		/* setup the receive buffer address */
-		for (i = 0; i < VIRTIO_NET_NUM_RX_BUFS; i++) {
-			sg.addr = priv->rx_buff[i];
-			virtqueue_add(priv->rx_vq, sgs, 0, 1);
-		}
+		for (i = 0; i < priv->rx_num; i++)
+			virtio_net_rx_post(priv, priv->rx_buff[i]);
 
 		virtqueue_kick(priv->rx_vq);
 
@@ -74,61 +127,113 @@ static int virtio_net_start(struct udevice *dev)
 	return 0;
 }
 
+/* Reclaim all the TX buffers the device is done with */
+static void virtio_net_tx_reclaim(struct virtio_net_priv *priv)
+{
+	char *buf;
+
+	while ((buf = virtqueue_get_buf(priv->tx_vq, NULL)))
+		priv->tx_busy &= ~BIT((buf - priv->tx_buff[0]) /
+				      VIRTIO_NET_RX_BUF_SIZE);
+}
+
 static int virtio_net_send(struct udevice *dev, void *packet, int length)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
-	struct virtio_net_hdr hdr;
-	struct virtio_net_hdr_v1 hdr_v1;
-	struct virtio_sg hdr_sg;
-	struct virtio_sg data_sg = { packet, length };
+	struct virtio_sg hdr_sg, data_sg;
 	struct virtio_sg *sgs[] = { &hdr_sg, &data_sg };
+	char *buf;
 	int ret;
+	int i;
 
-	if (priv->net_hdr_len == sizeof(struct virtio_net_hdr))
-		hdr_sg.addr = &hdr;
-	else
-		hdr_sg.addr = &hdr_v1;
-	hdr_sg.length = priv->net_hdr_len;
+	if (length > VIRTIO_NET_RX_BUF_SIZE - priv->net_hdr_len)
+		return -EINVAL;
 
-	memset(hdr_sg.addr, 0, priv->net_hdr_len);
+	/* Only wait for the device when all TX buffers are in flight */
+	virtio_net_tx_reclaim(priv);
+	while (priv->tx_busy == GENMASK(VIRTIO_NET_NUM_TX_BUFS - 1, 0))
+		virtio_net_tx_reclaim(priv);
+
+	for (i = 0; priv->tx_busy & BIT(i); i++)
+		;
+	buf = priv->tx_buff[i];
+
+	memset(buf, 0, priv->net_hdr_len);
+	memcpy(buf + priv->net_hdr_len, packet, length);
+	hdr_sg.addr = buf;
+	hdr_sg.length = priv->net_hdr_len;
+	data_sg.addr = buf + priv->net_hdr_len;
+	data_sg.length = length;
 
 	ret = virtqueue_add(priv->tx_vq, sgs, 2, 0);
 	if (ret)
 		return ret;
+	priv->tx_busy |= BIT(i);
 
 	virtqueue_kick(priv->tx_vq);
 
-	while (1) {
-		if (virtqueue_get_buf(priv->tx_vq, NULL))
-			break;
-	}
-
 	return 0;
 }
 
 static int virtio_net_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
-	unsigned int len;
 	void *buf;
+	int len;
 
-	buf = virtqueue_get_buf(priv->rx_vq, &len);
+	buf = virtio_net_rx_get(dev, &len);
 	if (!buf)
 		return -EAGAIN;
 
 	*packetp = buf + priv->net_hdr_len;
-	return len - priv->net_hdr_len;
+	return len;
 }
 
 static int virtio_net_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
-	void *buf = packet - priv->net_hdr_len;
-	struct virtio_sg sg = { buf, VIRTIO_NET_RX_BUF_SIZE };
-	struct virtio_sg *sgs[] = { &sg };
 
 	/* Put the buffer back to the rx ring */
-	virtqueue_add(priv->rx_vq, sgs, 0, 1);
+	virtio_net_rx_post(priv, packet - priv->net_hdr_len);
+	virtqueue_kick(priv->rx_vq);
+
+	return 0;
+}
+
+/*
+ * Take every frame the device has received in one pass, and give their
+ * buffers back with a single kick
+ */
+static int virtio_net_recv_batch(struct udevice *dev, int flags,
+				 struct eth_rx_pkt *pkts, int max)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	int count;
+	void *buf;
+
+	for (count = 0; count < min(max, ETH_RX_BATCH); count++) {
+		buf = virtio_net_rx_get(dev, &pkts[count].len);
+		if (!buf)
+			break;
+
+		priv->rx_batch[count] = buf;
+		pkts[count].packet = buf + priv->net_hdr_len;
+		pkts[count].split_hdr_len = 0;
+		pkts[count].split_data = NULL;
+		pkts[count].csum_ok = false;
+	}
+
+	return count ? count : -EAGAIN;
+}
+
+static int virtio_net_free_batch(struct udevice *dev, int count)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	int i;
+
+	for (i = 0; i < count; i++)
+		virtio_net_rx_post(priv, priv->rx_batch[i]);
+	virtqueue_kick(priv->rx_vq);
 
 	return 0;
 }
@@ -208,11 +313,15 @@ static int virtio_net_probe(struct udevice *dev)
 	 * VIRTIO_NET_F_MRG_RXBUF was negotiated. Without that feature
 	 * the structure was 2 bytes shorter.
 	 */
-	if (uc_priv->legacy)
+	priv->mrg_rxbuf = virtio_has_feature(dev, VIRTIO_NET_F_MRG_RXBUF);
+	if (uc_priv->legacy && !priv->mrg_rxbuf)
 		priv->net_hdr_len = sizeof(struct virtio_net_hdr);
 	else
 		priv->net_hdr_len = sizeof(struct virtio_net_hdr_v1);
 
+	priv->rx_num = min_t(int, virtqueue_get_vring_size(priv->rx_vq),
+			     VIRTIO_NET_NUM_RX_BUFS);
+
 	return 0;
 }
 
@@ -221,6 +330,8 @@ static const struct eth_ops virtio_net_ops = {
 	.send = virtio_net_send,
 	.recv = virtio_net_recv,
 	.free_pkt = virtio_net_free_pkt,
+	.recv_batch = virtio_net_recv_batch,
+	.free_batch = virtio_net_free_batch,
 	.stop = virtio_net_stop,
 	.write_hwaddr = virtio_net_write_hwaddr,
 	.read_rom_hwaddr = virtio_net_read_rom_hwaddr,
@@ -4,20 +4,51 @@
  */
 
 #include <common.h>
+#include <cyclic.h>
 #include <dm.h>
 #include <errno.h>
 #include <wdt.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 
+/**
+ * struct wdt_priv - Per-device uclass information
+ *
+ * @cyclic: Background task which resets the watchdog while it is running
+ */
+struct wdt_priv {
+	struct cyclic_info cyclic;
+};
+
+static int wdt_cyclic(void *ctx)
+{
+	wdt_reset(ctx);
+
+	return -EBUSY;
+}
+
 int wdt_start(struct udevice *dev, u64 timeout_ms, ulong flags)
 {
 	const struct wdt_ops *ops = device_get_ops(dev);
+	int ret;
 
 	if (!ops->start)
 		return -ENOSYS;
 
-	return ops->start(dev, timeout_ms, flags);
+	ret = ops->start(dev, timeout_ms, flags);
+	if (ret)
+		return ret;
+	if (CONFIG_IS_ENABLED(CYCLIC)) {
+		struct wdt_priv *priv = dev_get_uclass_priv(dev);
+
+		/* Reset it well before it expires */
+		cyclic_unregister(&priv->cyclic);
+		cyclic_register(&priv->cyclic, wdt_cyclic, dev,
+				timeout_ms * 1000 / 4, CYCLICF_ENDLESS,
+				dev->name);
+	}
+
+	return 0;
 }
 
 int wdt_stop(struct udevice *dev)
@@ -27,6 +58,12 @@ int wdt_stop(struct udevice *dev)
 	if (!ops->stop)
 		return -ENOSYS;
 
+	if (CONFIG_IS_ENABLED(CYCLIC)) {
+		struct wdt_priv *priv = dev_get_uclass_priv(dev);
+
+		cyclic_unregister(&priv->cyclic);
+	}
+
 	return ops->stop(dev);
 }
 
@@ -85,9 +122,20 @@ static int wdt_post_bind(struct udevice *dev)
 	return 0;
 }
 
+static int wdt_pre_remove(struct udevice *dev)
+{
+	struct wdt_priv *priv = dev_get_uclass_priv(dev);
+
+	cyclic_unregister(&priv->cyclic);
+
+	return 0;
+}
+
 UCLASS_DRIVER(wdt) = {
 	.id		= UCLASS_WDT,
 	.name		= "watchdog",
 	.flags		= DM_UC_FLAG_SEQ_ALIAS,
 	.post_bind	= wdt_post_bind,
+	.pre_remove	= wdt_pre_remove,
+	.per_device_auto_alloc_size = sizeof(struct wdt_priv),
 };
@@ -307,3 +307,141 @@ int env_attr_lookup(const char *attr_list, const char *name, char *attributes)
 	return -ENOENT;
 }
 #endif
+
+#ifndef USE_HOSTCC
+/**
+ * struct env_attr_entry - one entry of a compiled attribute list
+ *
+ * @name: Name of the variable
+ * @attributes: Its attributes, "" if none
+ * @pos: Position of the entry in the list, so the last of several entries
+ *	for a name can be found
+ */
+struct env_attr_entry {
+	char *name;
+	char *attributes;
+	int pos;
+};
+
+void env_attr_table_free(struct env_attr_table *tab)
+{
+	int i;
+
+	for (i = 0; tab->entries && i < tab->count; i++) {
+		free(tab->entries[i].name);
+		free(tab->entries[i].attributes);
+	}
+	free(tab->entries);
+	free(tab->list);
+	tab->entries = NULL;
+	tab->count = 0;
+	tab->list = NULL;
+}
+
+#if defined(CONFIG_REGEX)
+int env_attr_table_build(struct env_attr_table *tab, const char *attr_list)
+{
+	env_attr_table_free(tab);
+	if (!attr_list)
+		return 0;
+	tab->list = strdup(attr_list);
+
+	return tab->list ? 0 : -ENOMEM;
+}
+
+int env_attr_table_lookup(const struct env_attr_table *tab, const char *name,
+			  char *attributes)
+{
+	if (!tab->list)
+		return -ENOENT;
+
+	return env_attr_lookup(tab->list, name, attributes);
+}
+#else
+/* Count the entries, or add them once the table has been allocated */
+static int env_attr_table_add(const char *name, const char *attributes,
+			      void *priv)
+{
+	struct env_attr_table *tab = priv;
+	struct env_attr_entry *entry;
+
+	if (tab->entries) {
+		entry = &tab->entries[tab->count];
+		entry->name = strdup(name);
+		entry->attributes = strdup(attributes ? attributes : "");
+		if (!entry->name || !entry->attributes)
+			return -ENOMEM;
+		/* env_attr_lookup() stops at a space too */
+		entry->attributes[strcspn(entry->attributes, " ")] = '\0';
+		entry->pos = tab->count;
+	}
+	tab->count++;
+
+	return 0;
+}
+
+static int env_attr_entry_cmp(const void *a, const void *b)
+{
+	const struct env_attr_entry *ea = a, *eb = b;
+	int ret;
+
+	ret = strcmp(ea->name, eb->name);
+	if (ret)
+		return ret;
+
+	return ea->pos - eb->pos;
+}
+
+int env_attr_table_build(struct env_attr_table *tab, const char *attr_list)
+{
+	int count, ret;
+
+	env_attr_table_free(tab);
+	if (!attr_list)
+		return 0;
+
+	ret = env_attr_walk(attr_list, env_attr_table_add, tab);
+	count = tab->count;
+	tab->count = 0;
+	if (ret || !count)
+		return ret;
+
+	tab->entries = calloc(count, sizeof(*tab->entries));
+	if (!tab->entries)
+		return -ENOMEM;
+	ret = env_attr_walk(attr_list, env_attr_table_add, tab);
+	if (ret) {
+		/* Free the entry that failed too */
+		tab->count++;
+		env_attr_table_free(tab);
+		return ret;
+	}
+	qsort(tab->entries, tab->count, sizeof(*tab->entries),
+	      env_attr_entry_cmp);
+
+	return 0;
+}
+
+int env_attr_table_lookup(const struct env_attr_table *tab, const char *name,
+			  char *attributes)
+{
+	int lo = 0, hi = tab->count;
+
+	/* Find the last entry for this name */
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (strcmp(tab->entries[mid].name, name) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!lo || strcmp(tab->entries[lo - 1].name, name))
+		return -ENOENT;
+
+	strcpy(attributes, tab->entries[lo - 1].attributes);
+
+	return 0;
+}
+#endif
+#endif /* !USE_HOSTCC */
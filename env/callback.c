@@ -35,7 +35,20 @@ static struct env_clbk_tbl *find_env_callback(const char *name)
 }
 
 static int first_call = 1;
-static const char *callback_list;
+/* The ".callbacks" and static lists, compiled for lookups by name */
+static struct env_attr_table callback_table;
+static struct env_attr_table callback_static_table;
+
+static void env_callback_tables_init(void)
+{
+	if (first_call) {
+		env_attr_table_build(&callback_static_table,
+				     ENV_CALLBACK_LIST_STATIC);
+		env_attr_table_build(&callback_table,
+				     env_get(ENV_CALLBACK_VAR));
+		first_call = 0;
+	}
+}
 
 /*
  * Look for a possible callback for a newly added variable
@@ -49,19 +62,15 @@ void env_callback_init(ENTRY *var_entry)
 	struct env_clbk_tbl *clbkp;
 	int ret = 1;
 
-	if (first_call) {
-		callback_list = env_get(ENV_CALLBACK_VAR);
-		first_call = 0;
-	}
+	env_callback_tables_init();
 
 	/* look in the ".callbacks" var for a reference to this variable */
-	if (callback_list != NULL)
-		ret = env_attr_lookup(callback_list, var_name, callback_name);
+	ret = env_attr_table_lookup(&callback_table, var_name, callback_name);
 
 	/* only if not found there, look in the static list */
 	if (ret)
-		ret = env_attr_lookup(ENV_CALLBACK_LIST_STATIC, var_name,
-			callback_name);
+		ret = env_attr_table_lookup(&callback_static_table, var_name,
+					    callback_name);
 
 	/* if an association was found, set the callback pointer */
 	if (!ret && strlen(callback_name)) {
@@ -122,6 +131,10 @@ static int set_callback(const char *name, const char *value, void *priv)
 static int on_callbacks(const char *name, const char *value, enum env_op op,
 	int flags)
 {
+	/* recompile the ".callbacks" list for newly added variables */
+	env_callback_tables_init();
+	env_attr_table_build(&callback_table, value);
+
 	/* remove all callbacks */
 	hwalk_r(&env_htab, clear_callback);
 
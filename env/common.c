@@ -198,8 +198,7 @@ int env_import_redund(const char *buf1, int buf1_read_fail,
 }
 #endif /* CONFIG_SYS_REDUNDAND_ENVIRONMENT */
 
-/* Export the environment and generate CRC for it. */
-int env_export(env_t *env_out)
+static int env_export_data(env_t *env_out)
 {
 	char *res;
 	ssize_t	len;
@@ -213,6 +212,15 @@ int env_export(env_t *env_out)
 
 	env_out->crc = crc32(0, env_out->data, ENV_SIZE);
 
+	return 0;
+}
+
+/* Export the environment and generate CRC for it. */
+int env_export(env_t *env_out)
+{
+	if (env_export_data(env_out))
+		return 1;
+
 #ifdef CONFIG_SYS_REDUNDAND_ENVIRONMENT
 	env_out->flags = ++env_flags; /* increase the serial */
 #endif
@@ -220,6 +228,31 @@ int env_export(env_t *env_out)
 	return 0;
 }
 
+#ifdef CONFIG_SPL_ENV_HANDOFF
+/* Export the environment as it is in storage, keeping the serial */
+int env_export_handoff(env_t *env_out)
+{
+	if (env_export_data(env_out))
+		return 1;
+
+#ifdef CONFIG_SYS_REDUNDAND_ENVIRONMENT
+	env_out->flags = env_flags;
+#endif
+
+	return 0;
+}
+
+/* Import an environment that SPL already checked */
+int env_import_handoff(const env_t *ep)
+{
+#ifdef CONFIG_SYS_REDUNDAND_ENVIRONMENT
+	env_flags = ep->flags;
+#endif
+
+	return env_import((const char *)ep, 0);
+}
+#endif
+
 void env_relocate(void)
 {
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
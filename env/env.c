@@ -5,6 +5,7 @@
  */
 
 #include <common.h>
+#include <bloblist.h>
 #include <environment.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -161,6 +162,82 @@ static struct env_driver *env_driver_lookup(enum env_operation op, int prio)
 	return drv;
 }
 
+#ifdef CONFIG_SPL_ENV_HANDOFF
+enum {
+	ENV_HANDOFF_VERSION	= 1,
+};
+
+/**
+ * struct env_handoff - environment passed from SPL to U-Boot proper
+ *
+ * @version: ENV_HANDOFF_VERSION
+ * @location: Location SPL loaded the environment from (enum env_location)
+ * @prio: Priority of that location, as passed to env_get_location()
+ * @valid: Value of gd->env_valid after loading
+ * @env: Environment, as exported by SPL
+ */
+struct env_handoff {
+	u32 version;
+	u32 location;
+	u32 prio;
+	u32 valid;
+	env_t env;
+};
+
+#ifdef CONFIG_SPL_BUILD
+/* Add or update the hand-off record after loading or saving */
+static void env_handoff_save(struct env_driver *drv, int prio)
+{
+	struct env_handoff *ho;
+
+	ho = bloblist_ensure(BLOBLISTT_ENV_HANDOFF, sizeof(*ho));
+	if (!ho) {
+		debug("%s: No room for environment hand-off\n", __func__);
+		return;
+	}
+	if (env_export_handoff(&ho->env)) {
+		ho->version = 0;
+		return;
+	}
+	ho->version = ENV_HANDOFF_VERSION;
+	ho->location = drv->location;
+	ho->prio = prio;
+	ho->valid = gd->env_valid;
+}
+#else
+/*
+ * Import the environment passed on by SPL, if it came from the location
+ * that env_load() would try first
+ */
+static int env_load_handoff(void)
+{
+	struct env_handoff *ho;
+	struct env_driver *drv;
+	int ret;
+
+	ho = bloblist_find(BLOBLISTT_ENV_HANDOFF, sizeof(*ho));
+	if (!ho || ho->version != ENV_HANDOFF_VERSION)
+		return -ENOENT;
+
+	drv = env_driver_lookup(ENVOP_LOAD, ho->prio);
+	if (!drv || drv->location != ho->location ||
+	    !env_has_inited(drv->location))
+		return -ENOENT;
+
+	printf("Loading Environment from %s (SPL)... ", drv->name);
+	ret = env_import_handoff(&ho->env);
+	if (ret) {
+		printf("Failed (%d)\n", ret);
+		return ret;
+	}
+	gd->env_valid = ho->valid;
+	printf("OK\n");
+
+	return 0;
+}
+#endif
+#endif /* CONFIG_SPL_ENV_HANDOFF */
+
 __weak int env_get_char_spec(int index)
 {
 	return *(uchar *)(gd->env_addr + index);
@@ -180,6 +257,11 @@ int env_load(void)
 	int best_prio = -1;
 	int prio;
 
+#if defined(CONFIG_SPL_ENV_HANDOFF) && !defined(CONFIG_SPL_BUILD)
+	if (!env_load_handoff())
+		return 0;
+#endif
+
 	for (prio = 0; (drv = env_driver_lookup(ENVOP_LOAD, prio)); prio++) {
 		int ret;
 
@@ -198,6 +280,9 @@ int env_load(void)
 		ret = drv->load();
 		if (!ret) {
 			printf("OK\n");
+#if defined(CONFIG_SPL_ENV_HANDOFF) && defined(CONFIG_SPL_BUILD)
+			env_handoff_save(drv, prio);
+#endif
 			return 0;
 		} else if (ret == -ENOMSG) {
 			/* Handle "bad CRC" case */
@@ -246,6 +331,10 @@ int env_save(void)
 			printf("Failed (%d)\n", ret);
 		else
 			printf("OK\n");
+#if defined(CONFIG_SPL_ENV_HANDOFF) && defined(CONFIG_SPL_BUILD)
+		if (!ret)
+			env_handoff_save(drv, gd->env_load_prio);
+#endif
 
 		if (!ret)
 			return 0;
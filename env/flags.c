@@ -411,7 +411,19 @@ static int env_parse_flags_to_bin(const char *flags)
 }
 
 static int first_call = 1;
-static const char *flags_list;
+/* The ".flags" and static lists, compiled for lookups by name */
+static struct env_attr_table flags_table;
+static struct env_attr_table flags_static_table;
+
+static void env_flags_tables_init(void)
+{
+	if (first_call) {
+		env_attr_table_build(&flags_static_table,
+				     ENV_FLAGS_LIST_STATIC);
+		env_attr_table_build(&flags_table, env_get(ENV_FLAGS_VAR));
+		first_call = 0;
+	}
+}
 
 /*
  * Look for possible flags for a newly added variable
@@ -424,12 +436,12 @@ void env_flags_init(ENTRY *var_entry)
 	char flags[ENV_FLAGS_ATTR_MAX_LEN + 1] = "";
 	int ret = 1;
 
-	if (first_call) {
-		flags_list = env_get(ENV_FLAGS_VAR);
-		first_call = 0;
-	}
+	env_flags_tables_init();
 	/* look in the ".flags" and static for a reference to this variable */
-	ret = env_flags_lookup(flags_list, var_name, flags);
+	ret = env_attr_table_lookup(&flags_table, var_name, flags);
+	if (ret)
+		ret = env_attr_table_lookup(&flags_static_table, var_name,
+					    flags);
 
 	/* if any flags were found, set the binary form to the entry */
 	if (!ret && strlen(flags))
@@ -475,6 +487,10 @@ static int set_flags(const char *name, const char *value, void *priv)
 static int on_flags(const char *name, const char *value, enum env_op op,
 	int flags)
 {
+	/* recompile the ".flags" list for newly added variables */
+	env_flags_tables_init();
+	env_attr_table_build(&flags_table, value);
+
 	/* remove all flags */
 	hwalk_r(&env_htab, clear_flags);
 
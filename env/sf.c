@@ -70,7 +70,7 @@ static int setup_flash_device(void)
 
 #if defined(CONFIG_ENV_OFFSET_REDUND)
 #ifdef CMD_SAVEENV
-static int env_sf_save(void)
+static int __maybe_unused env_sf_save(void)
 {
 	env_t	env_new;
 	char	*saved_buffer = NULL, flag = OBSOLETE_FLAG;
@@ -188,7 +188,7 @@ out:
 }
 #else
 #ifdef CMD_SAVEENV
-static int env_sf_save(void)
+static int __maybe_unused env_sf_save(void)
 {
 	u32	saved_size, saved_offset, sector;
 	char	*saved_buffer = NULL;
@@ -285,6 +285,221 @@ out:
 }
 #endif
 
+#ifdef CONFIG_ENV_SPI_JOURNAL
+/*
+ * Environment journal: each 'saveenv' appends the used part of the
+ * environment to one half of the journal area, so that flash only needs
+ * erasing when a half is full. The other half is then erased and used,
+ * leaving the newest record intact until a newer one is complete.
+ */
+#define ENV_JOURNAL_MAGIC	0x4a564e45	/* "ENVJ" */
+#define ENV_JOURNAL_HALF	(CONFIG_ENV_SPI_JOURNAL_SIZE / 2)
+#define ENV_JOURNAL_ALIGN	16
+
+/**
+ * struct env_journal_rec - header of an environment saved in the journal
+ *
+ * The header is written after the data, so a record with a valid header is
+ * complete unless its CRC says otherwise.
+ *
+ * @magic: ENV_JOURNAL_MAGIC
+ * @seq: Sequence number, one more than that of the previous record
+ * @len: Number of bytes of environment data following the header
+ * @crc: CRC32 of the data
+ */
+struct env_journal_rec {
+	u32 magic;
+	u32 seq;
+	u32 len;
+	u32 crc;
+};
+
+static struct {
+	int half;	/* Half holding the newest record, -1 if none */
+	u32 seq;	/* Sequence number of the newest record */
+	u32 offset;	/* Flash offset of the newest record */
+	u32 end[2];	/* Offset after the last record in each half */
+} env_journal;
+
+static u32 env_journal_base(int half)
+{
+	return CONFIG_ENV_SPI_JOURNAL_OFFSET + half * ENV_JOURNAL_HALF;
+}
+
+/* Find the newest record and the end of the records in each half */
+static int env_journal_scan(char *buf)
+{
+	struct env_journal_rec rec;
+	u32 base, off;
+	int half, ret;
+
+	env_journal.half = -1;
+	for (half = 0; half < 2; half++) {
+		base = env_journal_base(half);
+		for (off = 0; off + sizeof(rec) <= ENV_JOURNAL_HALF;
+		     off += ALIGN(sizeof(rec) + rec.len, ENV_JOURNAL_ALIGN)) {
+			ret = spi_flash_read(env_flash, base + off, sizeof(rec),
+					     &rec);
+			if (ret)
+				return ret;
+			if (rec.magic != ENV_JOURNAL_MAGIC || rec.len > ENV_SIZE ||
+			    off + sizeof(rec) + rec.len > ENV_JOURNAL_HALF)
+				break;
+			ret = spi_flash_read(env_flash, base + off + sizeof(rec),
+					     rec.len, buf);
+			if (ret)
+				return ret;
+			if (crc32(0, (uchar *)buf, rec.len) != rec.crc)
+				break;
+			if (env_journal.half < 0 ||
+			    (int)(rec.seq - env_journal.seq) > 0) {
+				env_journal.half = half;
+				env_journal.seq = rec.seq;
+				env_journal.offset = base + off;
+			}
+		}
+		env_journal.end[half] = off;
+	}
+
+	return 0;
+}
+
+static int env_sf_journal_load(void)
+{
+	struct env_journal_rec rec;
+	env_t *ep;
+	int ret;
+
+	ep = memalign(ARCH_DMA_MINALIGN, CONFIG_ENV_SIZE);
+	if (!ep) {
+		set_default_env("malloc() failed", 0);
+		return -EIO;
+	}
+
+	ret = setup_flash_device();
+	if (ret)
+		goto out;
+
+	ret = env_journal_scan((char *)ep->data);
+	if (ret || env_journal.half < 0) {
+		/* Nothing saved in the journal yet */
+		spi_flash_free(env_flash);
+		env_flash = NULL;
+		free(ep);
+		return env_sf_load();
+	}
+
+	memset(ep, '\0', CONFIG_ENV_SIZE);
+	ret = spi_flash_read(env_flash, env_journal.offset, sizeof(rec), &rec);
+	if (!ret)
+		ret = spi_flash_read(env_flash, env_journal.offset + sizeof(rec),
+				     rec.len, ep->data);
+	if (ret) {
+		set_default_env("spi_flash_read() failed", 0);
+		goto err_read;
+	}
+
+	ret = env_import((char *)ep, 0);
+	if (!ret)
+		gd->env_valid = ENV_VALID;
+
+err_read:
+	spi_flash_free(env_flash);
+	env_flash = NULL;
+out:
+	free(ep);
+
+	return ret;
+}
+
+#ifdef CMD_SAVEENV
+/* Check that a part of the journal can be written without erasing it */
+static bool env_journal_erased(u32 offset, u32 size, char *buf)
+{
+	u32 i;
+
+	if (spi_flash_read(env_flash, offset, size, buf))
+		return false;
+	for (i = 0; i < size; i++) {
+		if ((u8)buf[i] != 0xff)
+			return false;
+	}
+
+	return true;
+}
+
+static int env_sf_journal_save(void)
+{
+	struct env_journal_rec rec;
+	env_t env_new;
+	u32 len, size, offset;
+	char *buf;
+	int half, ret;
+
+	ret = setup_flash_device();
+	if (ret)
+		return ret;
+
+	ret = env_export(&env_new);
+	if (ret)
+		return -EIO;
+
+	/* Only the used part, up to and including the final "\0\0" */
+	for (len = 0; len < ENV_SIZE - 1; len++) {
+		if (!env_new.data[len] && !env_new.data[len + 1])
+			break;
+	}
+	len = min(len + 2, (u32)ENV_SIZE);
+	size = ALIGN(sizeof(rec) + len, ENV_JOURNAL_ALIGN);
+
+	buf = memalign(ARCH_DMA_MINALIGN, max(size, (u32)ENV_SIZE));
+	if (!buf)
+		return -ENOMEM;
+
+	ret = env_journal_scan(buf);
+	if (ret)
+		goto done;
+
+	half = env_journal.half < 0 ? 0 : env_journal.half;
+	offset = env_journal_base(half) + env_journal.end[half];
+	if (env_journal.end[half] + size > ENV_JOURNAL_HALF ||
+	    !env_journal_erased(offset, size, buf)) {
+		/* Never erase the half holding the newest record */
+		if (env_journal.half >= 0)
+			half = !half;
+		offset = env_journal_base(half);
+
+		puts("Erasing SPI flash...");
+		ret = spi_flash_erase(env_flash, offset, ENV_JOURNAL_HALF);
+		if (ret)
+			goto done;
+	}
+
+	rec.magic = ENV_JOURNAL_MAGIC;
+	rec.seq = env_journal.half < 0 ? 0 : env_journal.seq + 1;
+	rec.len = len;
+	rec.crc = crc32(0, env_new.data, len);
+
+	puts("Writing to SPI flash...");
+	ret = spi_flash_write(env_flash, offset + sizeof(rec), len,
+			      env_new.data);
+	if (ret)
+		goto done;
+	ret = spi_flash_write(env_flash, offset, sizeof(rec), &rec);
+	if (ret)
+		goto done;
+
+	puts("done\n");
+	gd->env_valid = ENV_VALID;
+
+done:
+	free(buf);
+
+	return ret;
+}
+#endif /* CMD_SAVEENV */
+#endif /* CONFIG_ENV_SPI_JOURNAL */
+
 #ifdef CONFIG_ENV_ADDR
 __weak void *env_sf_get_env_addr(void)
 {
@@ -312,10 +527,18 @@ static int env_sf_init(void)
 U_BOOT_ENV_LOCATION(sf) = {
 	.location	= ENVL_SPI_FLASH,
 	ENV_NAME("SPI Flash")
+#ifdef CONFIG_ENV_SPI_JOURNAL
+	.load		= env_sf_journal_load,
+#else
 	.load		= env_sf_load,
+#endif
 #ifdef CMD_SAVEENV
+#ifdef CONFIG_ENV_SPI_JOURNAL
+	.save		= env_save_ptr(env_sf_journal_save),
+#else
 	.save		= env_save_ptr(env_sf_save),
 #endif
+#endif
 #if defined(INITENV) && defined(CONFIG_ENV_ADDR)
 	.init		= env_sf_init,
 #endif
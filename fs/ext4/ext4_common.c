@@ -44,6 +44,56 @@ int ext4fs_indir3_blkno = -1;
 struct ext2_inode *g_parent_inode;
 static int symlinknest;
 
+/*
+ * Inodes and group descriptors read from the mounted volume, direct
+ * mapped by number. ext4fs_mount() keeps them while the same, unchanged
+ * volume is mounted again, and every write through put_ext4() drops them.
+ */
+#define EXT4_INODE_CACHE_SIZE	64
+#define EXT4_BG_CACHE_SIZE	16
+
+static struct {
+	bool valid;
+	int ino;
+	struct ext2_inode inode;
+} ext4_inode_cache[EXT4_INODE_CACHE_SIZE];
+
+static struct {
+	bool valid;
+	int group;
+	struct ext2_block_group desc;
+} ext4_bg_cache[EXT4_BG_CACHE_SIZE];
+
+/* What the caches were filled from */
+static struct blk_desc *ext4_cache_dev;
+static lbaint_t ext4_cache_part;
+static struct ext2_sblock ext4_cache_sblock;
+
+static void ext4fs_meta_cache_invalidate(void)
+{
+	int i;
+
+	for (i = 0; i < EXT4_INODE_CACHE_SIZE; i++)
+		ext4_inode_cache[i].valid = false;
+	for (i = 0; i < EXT4_BG_CACHE_SIZE; i++)
+		ext4_bg_cache[i].valid = false;
+}
+
+/* Drop the caches unless the volume is the one they were filled from */
+static void ext4fs_meta_cache_check(struct ext2_sblock *sblock)
+{
+	struct blk_desc *dev = get_fs()->dev_desc;
+
+	if (ext4_cache_dev == dev && ext4_cache_part == part_offset &&
+	    !memcmp(&ext4_cache_sblock, sblock, sizeof(*sblock)))
+		return;
+
+	ext4fs_meta_cache_invalidate();
+	ext4_cache_dev = dev;
+	ext4_cache_part = part_offset;
+	memcpy(&ext4_cache_sblock, sblock, sizeof(*sblock));
+}
+
 #if defined(CONFIG_EXT4_WRITE)
 struct ext2_block_group *ext4fs_get_group_descriptor
 	(const struct ext_filesystem *fs, uint32_t bg_idx)
@@ -199,6 +249,9 @@ void put_ext4(uint64_t off, void *buf, uint32_t size)
 	int log2blksz = fs->dev_desc->log2blksz;
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, sec_buf, fs->dev_desc->blksz);
 
+	/* it may be an inode or a group descriptor we have cached */
+	ext4fs_meta_cache_invalidate();
+
 	startblock = off >> log2blksz;
 	startblock += part_offset;
 	remainder = off & (uint64_t)(fs->dev_desc->blksz - 1);
@@ -635,18 +688,27 @@ static int search_dir(struct ext2_inode *parent_inode, char *dirname)
 	struct ext2_dirent *dir = NULL;
 	struct ext_filesystem *fs = get_fs();
 	uint32_t directory_blocks;
+	uint32_t leaves[EXT4_DX_MAX_LEAVES];
+	int nleaves;
 	char *direntname;
 
 	directory_blocks = le32_to_cpu(parent_inode->size) >>
 		LOG2_BLOCK_SIZE(ext4fs_root);
 
+	/* an indexed directory only needs the leaves the name hashes to */
+	nleaves = ext4fs_dx_lookup(parent_inode, dirname, leaves,
+				   ARRAY_SIZE(leaves));
+	if (nleaves > 0)
+		directory_blocks = nleaves;
+
 	block_buffer = zalloc(fs->blksz);
 	if (!block_buffer)
 		goto fail;
 
 	/* get the block no allocated to a file */
 	for (blk_idx = 0; blk_idx < directory_blocks; blk_idx++) {
-		blknr = read_allocated_block(parent_inode, blk_idx);
+		blknr = read_allocated_block(parent_inode, nleaves > 0 ?
+					     leaves[blk_idx] : blk_idx);
 		if (blknr <= 0)
 			goto fail;
 
@@ -954,6 +1016,36 @@ int ext4fs_filename_unlink(char *filename)
 	return -1;
 }
 
+/*
+ * Move fs->curr_blkno past the blocks in use in group bg_idx, to the next
+ * free one, or to the start of the next group when the rest is full.
+ */
+static void ext4fs_skip_used_blocks(unsigned char *bmap, unsigned int bg_idx)
+{
+	struct ext_filesystem *fs = get_fs();
+	long int nbits = fs->blksz * 8;
+	long int bit;
+
+	bit = fs->curr_blkno - bg_idx * nbits;
+	if (fs->blksz == 1024)
+		bit--;
+
+	while (bit < nbits) {
+		/* whole bytes in use at once */
+		if (!(bit & 7) && bmap[bit >> 3] == 0xff) {
+			bit += 8;
+			continue;
+		}
+		if (!(bmap[bit >> 3] & (1 << (bit & 7))))
+			break;
+		bit++;
+	}
+
+	fs->curr_blkno = bg_idx * nbits + bit;
+	if (fs->blksz == 1024)
+		fs->curr_blkno++;
+}
+
 uint32_t ext4fs_get_new_blk_no(void)
 {
 	short i;
@@ -963,12 +1055,15 @@ uint32_t ext4fs_get_new_blk_no(void)
 	static int prev_bg_bitmap_index = -1;
 	unsigned int blk_per_grp = le32_to_cpu(ext4fs_root->sblock.blocks_per_group);
 	struct ext_filesystem *fs = get_fs();
-	char *journal_buffer = zalloc(fs->blksz);
-	char *zero_buffer = zalloc(fs->blksz);
-	if (!journal_buffer || !zero_buffer)
-		goto fail;
+	char *journal_buffer = NULL;
+	char *zero_buffer = NULL;
 
 	if (fs->first_pass_bbmap == 0) {
+		journal_buffer = zalloc(fs->blksz);
+		zero_buffer = zalloc(fs->blksz);
+		if (!journal_buffer || !zero_buffer)
+			goto fail;
+
 		for (i = 0; i < fs->no_blkgrp; i++) {
 			struct ext2_block_group *bgd = NULL;
 			bgd = ext4fs_get_group_descriptor(fs, i);
@@ -1041,6 +1136,11 @@ restart:
 		uint16_t bg_flags = ext4fs_bg_get_flags(bgd);
 		uint64_t b_bitmap_blk = ext4fs_bg_get_block_id(bgd, fs);
 		if (bg_flags & EXT4_BG_BLOCK_UNINIT) {
+			if (!zero_buffer) {
+				zero_buffer = zalloc(fs->blksz);
+				if (!zero_buffer)
+					goto fail;
+			}
 			memcpy(fs->blk_bmaps[bg_idx], zero_buffer, fs->blksz);
 			put_ext4(b_bitmap_blk * fs->blksz,
 				 zero_buffer, fs->blksz);
@@ -1052,12 +1152,15 @@ restart:
 				   bg_idx) != 0) {
 			debug("going for restart for the block no %ld %u\n",
 			      fs->curr_blkno, bg_idx);
-			fs->curr_blkno++;
+			ext4fs_skip_used_blocks(fs->blk_bmaps[bg_idx], bg_idx);
 			goto restart;
 		}
 
 		/* journal backup */
 		if (prev_bg_bitmap_index != bg_idx) {
+			journal_buffer = zalloc(fs->blksz);
+			if (!journal_buffer)
+				goto fail;
 			status = ext4fs_devread(b_bitmap_blk * fs->sect_perblk,
 						0, fs->blksz, journal_buffer);
 			if (status == 0)
@@ -1521,16 +1624,84 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 
 #endif
 
-static struct ext4_extent_header *ext4fs_get_extent_block
-	(struct ext2_data *data, char *buf,
-		struct ext4_extent_header *ext_block,
-		uint32_t fileblock, int log2_blksz)
+/*
+ * Decoded extent tree leaves of the file being read. Each slot holds a
+ * copy of one leaf block together with the range of file blocks it maps,
+ * so mapping a run of blocks does not walk the tree (and re-read its index
+ * blocks) again. The slots belong to one extent root at a time: looking up
+ * a block of another inode drops them.
+ */
+#define EXT4_LEAF_CACHE_SLOTS	4
+
+struct ext4_leaf_cache {
+	uint32_t first;		/* first file block mapped by the leaf */
+	uint32_t last;		/* last one, inclusive */
+	bool valid;
+	char *buf;		/* the leaf, one filesystem block */
+};
+
+static struct {
+	struct ext2_data *root;
+	int blksz;
+	__le32 key[INDIRECT_BLOCKS + 3];	/* the inode's extent root */
+	struct ext4_leaf_cache slot[EXT4_LEAF_CACHE_SLOTS];
+	int next;
+} ext4_leaf_cache;
+
+static void ext4fs_leaf_cache_invalidate(void)
+{
+	int i;
+
+	for (i = 0; i < EXT4_LEAF_CACHE_SLOTS; i++) {
+		free(ext4_leaf_cache.slot[i].buf);
+		ext4_leaf_cache.slot[i].buf = NULL;
+		ext4_leaf_cache.slot[i].valid = false;
+	}
+	ext4_leaf_cache.root = NULL;
+	ext4_leaf_cache.next = 0;
+}
+
+/* Find the leaf mapping 'fileblock', reading it from disk if not cached */
+static struct ext4_leaf_cache *ext4fs_get_extent_leaf
+	(struct ext2_inode *inode, uint32_t fileblock, int log2_blksz)
 {
+	struct ext4_extent_header *ext_block;
 	struct ext4_extent_idx *index;
+	struct ext4_leaf_cache *slot;
 	unsigned long long block;
-	int blksz = EXT2_BLOCK_SIZE(data);
+	int blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	uint32_t first = 0, last = ~0U;
 	int i;
 
+	if (ext4_leaf_cache.root != ext4fs_root ||
+	    ext4_leaf_cache.blksz != blksz ||
+	    memcmp(ext4_leaf_cache.key, inode->b.blocks.dir_blocks,
+		   sizeof(ext4_leaf_cache.key))) {
+		ext4fs_leaf_cache_invalidate();
+		ext4_leaf_cache.root = ext4fs_root;
+		ext4_leaf_cache.blksz = blksz;
+		memcpy(ext4_leaf_cache.key, inode->b.blocks.dir_blocks,
+		       sizeof(ext4_leaf_cache.key));
+	}
+
+	for (i = 0; i < EXT4_LEAF_CACHE_SLOTS; i++) {
+		slot = &ext4_leaf_cache.slot[i];
+		if (slot->valid && fileblock >= slot->first &&
+		    fileblock <= slot->last)
+			return slot;
+	}
+
+	slot = &ext4_leaf_cache.slot[ext4_leaf_cache.next];
+	ext4_leaf_cache.next = (ext4_leaf_cache.next + 1) %
+			       EXT4_LEAF_CACHE_SLOTS;
+	slot->valid = false;
+	if (!slot->buf) {
+		slot->buf = zalloc(blksz);
+		if (!slot->buf)
+			return NULL;
+	}
+
+	ext_block = (struct ext4_extent_header *)inode->b.blocks.dir_blocks;
 	while (1) {
 		index = (struct ext4_extent_idx *)(ext_block + 1);
 
@@ -1538,7 +1709,7 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 			return NULL;
 
 		if (ext_block->eh_depth == 0)
-			return ext_block;
+			break;
 		i = -1;
 		do {
 			i++;
@@ -1549,15 +1720,97 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 		if (--i < 0)
 			return NULL;
 
+		/* Each level narrows down the range the leaf maps */
+		first = le32_to_cpu(index[i].ei_block);
+		if (i + 1 < le16_to_cpu(ext_block->eh_entries) &&
+		    le32_to_cpu(index[i + 1].ei_block) - 1 < last)
+			last = le32_to_cpu(index[i + 1].ei_block) - 1;
+
 		block = le16_to_cpu(index[i].ei_leaf_hi);
 		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
 
 		if (ext4fs_devread((lbaint_t)block << log2_blksz, 0, blksz,
-				   buf))
-			ext_block = (struct ext4_extent_header *)buf;
+				   slot->buf))
+			ext_block = (struct ext4_extent_header *)slot->buf;
 		else
 			return NULL;
 	}
+
+	/* A depth 0 tree lives in the inode itself */
+	if ((char *)ext_block != slot->buf)
+		memcpy(slot->buf, ext_block, sizeof(ext4_leaf_cache.key));
+	slot->first = first;
+	slot->last = last;
+	slot->valid = true;
+
+	return slot;
+}
+
+/*
+ * Map 'fileblock' of an extent mapped inode: return the number of blocks,
+ * at most 'maxblocks', that follow it contiguously on disk, or that are
+ * all a hole, with the first physical block in *blknr (0 for a hole).
+ */
+static int ext4fs_map_extent(struct ext2_inode *inode, uint32_t fileblock,
+			     int maxblocks, long int *blknr)
+{
+	struct ext4_extent_header *ext_block;
+	struct ext4_leaf_cache *leaf;
+	struct ext4_extent *extent;
+	unsigned long long start;
+	uint32_t startblock, endblock;
+	int log2_blksz;
+	int lo, hi, mid, entries;
+	long int count;
+
+	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
+		- get_fs()->dev_desc->log2blksz;
+	leaf = ext4fs_get_extent_leaf(inode, fileblock, log2_blksz);
+	if (!leaf) {
+		printf("invalid extent block\n");
+		return -EINVAL;
+	}
+
+	ext_block = (struct ext4_extent_header *)leaf->buf;
+	extent = (struct ext4_extent *)(ext_block + 1);
+	entries = le16_to_cpu(ext_block->eh_entries);
+
+	/* Find the first extent ending after fileblock */
+	lo = 0;
+	hi = entries;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		startblock = le32_to_cpu(extent[mid].ee_block);
+		endblock = startblock + le16_to_cpu(extent[mid].ee_len);
+		if (endblock <= fileblock)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*blknr = 0;
+	if (lo == entries) {
+		/* Sparse up to the end of what this leaf maps */
+		count = (long int)(leaf->last - fileblock) + 1;
+	} else {
+		startblock = le32_to_cpu(extent[lo].ee_block);
+		endblock = startblock + le16_to_cpu(extent[lo].ee_len);
+		if (startblock > fileblock) {
+			/* Sparse file */
+			count = startblock - fileblock;
+		} else {
+			start = le16_to_cpu(extent[lo].ee_start_hi);
+			start = (start << 32) +
+				le32_to_cpu(extent[lo].ee_start_lo);
+			*blknr = (fileblock - startblock) + start;
+			count = endblock - fileblock;
+		}
+	}
+
+	if (count > maxblocks || count <= 0)
+		count = maxblocks;
+
+	return count;
 }
 
 static int ext4fs_blockgroup
@@ -1567,6 +1820,13 @@ static int ext4fs_blockgroup
 	unsigned int blkoff, desc_per_blk;
 	int log2blksz = get_fs()->dev_desc->log2blksz;
 	int desc_size = get_fs()->gdsize;
+	int slot = group % EXT4_BG_CACHE_SIZE;
+	int status;
+
+	if (ext4_bg_cache[slot].valid && ext4_bg_cache[slot].group == group) {
+		memcpy(blkgrp, &ext4_bg_cache[slot].desc, desc_size);
+		return 1;
+	}
 
 	desc_per_blk = EXT2_BLOCK_SIZE(data) / desc_size;
 
@@ -1577,9 +1837,16 @@ static int ext4fs_blockgroup
 	debug("ext4fs read %d group descriptor (blkno %ld blkoff %u)\n",
 	      group, blkno, blkoff);
 
-	return ext4fs_devread((lbaint_t)blkno <<
-			      (LOG2_BLOCK_SIZE(data) - log2blksz),
-			      blkoff, desc_size, (char *)blkgrp);
+	status = ext4fs_devread((lbaint_t)blkno <<
+				(LOG2_BLOCK_SIZE(data) - log2blksz),
+				blkoff, desc_size, (char *)blkgrp);
+	if (status && desc_size <= sizeof(ext4_bg_cache[slot].desc)) {
+		memcpy(&ext4_bg_cache[slot].desc, blkgrp, desc_size);
+		ext4_bg_cache[slot].group = group;
+		ext4_bg_cache[slot].valid = true;
+	}
+
+	return status;
 }
 
 int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
@@ -1591,6 +1858,12 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 	int inodes_per_block, status;
 	long int blkno;
 	unsigned int blkoff;
+	int slot = ino % EXT4_INODE_CACHE_SIZE;
+
+	if (ext4_inode_cache[slot].valid && ext4_inode_cache[slot].ino == ino) {
+		memcpy(inode, &ext4_inode_cache[slot].inode, sizeof(*inode));
+		return 1;
+	}
 
 	/* It is easier to calculate if the first inode is 0. */
 	ino--;
@@ -1610,6 +1883,10 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 	if (status == 0)
 		return 0;
 
+	memcpy(&ext4_inode_cache[slot].inode, inode, sizeof(*inode));
+	ext4_inode_cache[slot].ino = ino + 1;
+	ext4_inode_cache[slot].valid = true;
+
 	return 1;
 }
 
@@ -1622,53 +1899,17 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 	long int rblock;
 	long int perblock_parent;
 	long int perblock_child;
-	unsigned long long start;
 	/* get the blocksize of the filesystem */
 	blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
 		- get_fs()->dev_desc->log2blksz;
 
 	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
-		long int startblock, endblock;
-		char *buf = zalloc(blksz);
-		if (!buf)
-			return -ENOMEM;
-		struct ext4_extent_header *ext_block;
-		struct ext4_extent *extent;
-		int i;
-		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, buf,
-						(struct ext4_extent_header *)
-						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
-		if (!ext_block) {
-			printf("invalid extent block\n");
-			free(buf);
-			return -EINVAL;
-		}
-
-		extent = (struct ext4_extent *)(ext_block + 1);
-
-		for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
-			startblock = le32_to_cpu(extent[i].ee_block);
-			endblock = startblock + le16_to_cpu(extent[i].ee_len);
-
-			if (startblock > fileblock) {
-				/* Sparse file */
-				free(buf);
-				return 0;
-
-			} else if (fileblock < endblock) {
-				start = le16_to_cpu(extent[i].ee_start_hi);
-				start = (start << 32) +
-					le32_to_cpu(extent[i].ee_start_lo);
-				free(buf);
-				return (fileblock - startblock) + start;
-			}
-		}
+		status = ext4fs_map_extent(inode, fileblock, 1, &blknr);
+		if (status < 0)
+			return status;
 
-		free(buf);
-		return 0;
+		return blknr;
 	}
 
 	/* Direct blocks. */
@@ -1956,6 +2197,32 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 	return blknr;
 }
 
+/*
+ * Like read_allocated_block(), but also return in *count how many blocks
+ * from 'fileblock' on, at most 'maxblocks', are contiguous on disk (or all
+ * a hole, when 0 is returned). Only extent trees are mapped a run at a
+ * time; other inodes get runs of one block.
+ */
+long int ext4fs_map_blocks(struct ext2_inode *inode, int fileblock,
+			   int maxblocks, int *count)
+{
+	long int blknr;
+	int status;
+
+	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
+		status = ext4fs_map_extent(inode, fileblock, maxblocks, &blknr);
+		if (status < 0)
+			return status;
+		*count = status;
+
+		return blknr;
+	}
+
+	*count = 1;
+
+	return read_allocated_block(inode, fileblock);
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -1970,6 +2237,7 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
  */
 void ext4fs_reinit_global(void)
 {
+	ext4fs_leaf_cache_invalidate();
 	if (ext4fs_indir1_block != NULL) {
 		free(ext4fs_indir1_block);
 		ext4fs_indir1_block = NULL;
@@ -2007,6 +2275,9 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 				struct ext2fs_node **fnode, int *ftype)
 {
 	unsigned int fpos = 0;
+	unsigned int fend;
+	uint32_t leaves[EXT4_DX_MAX_LEAVES];
+	int nleaves = 0, leaf = 0;
 	int status;
 	loff_t actread;
 	struct ext2fs_node *diro = (struct ext2fs_node *) dir;
@@ -2020,8 +2291,22 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 		if (status == 0)
 			return 0;
 	}
+	fend = le32_to_cpu(diro->inode.size);
+
+	/* Looking up a name in an indexed directory scans only its leaves */
+	if ((name != NULL) && (fnode != NULL) && (ftype != NULL))
+		nleaves = ext4fs_dx_lookup(&diro->inode, name, leaves,
+					   ARRAY_SIZE(leaves));
+next_leaf:
+	if (nleaves > 0) {
+		if (leaf == nleaves)
+			return 0;
+		fpos = leaves[leaf++] << LOG2_BLOCK_SIZE(diro->data);
+		fend = min_t(unsigned int, fpos + EXT2_BLOCK_SIZE(diro->data),
+			     le32_to_cpu(diro->inode.size));
+	}
 	/* Search the file.  */
-	while (fpos < le32_to_cpu(diro->inode.size)) {
+	while (fpos < fend) {
 		struct ext2_dirent dirent;
 
 		status = ext4fs_read_file(diro, fpos,
@@ -2135,6 +2420,8 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 		}
 		fpos += le16_to_cpu(dirent.direntlen);
 	}
+	if (nleaves > 0)
+		goto next_leaf;
 	return 0;
 }
 
@@ -2363,6 +2650,8 @@ int ext4fs_mount(unsigned part_length)
 	      le32_to_cpu(data->sblock.revision_level),
 	      fs->inodesz, fs->gdsize);
 
+	ext4fs_meta_cache_check(&data->sblock);
+
 	data->diropen.data = data;
 	data->diropen.ino = 2;
 	data->diropen.inode_read = 1;
@@ -2372,6 +2661,7 @@ int ext4fs_mount(unsigned part_length)
 	if (status == 0)
 		goto fail;
 
+	ext4fs_leaf_cache_invalidate();
 	ext4fs_root = data;
 
 	return 1;
@@ -56,6 +56,17 @@ int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			struct ext2fs_node **fnode, int *ftype);
 
+/* Most leaf blocks a hashed lookup may have to scan */
+#define EXT4_DX_MAX_LEAVES	8
+
+/*
+ * Find the leaf blocks of indexed directory 'dir' that may hold 'name'.
+ * Returns how many logical block numbers were stored in 'blocks', 0 if
+ * the directory has to be scanned linearly, -ve on error.
+ */
+int ext4fs_dx_lookup(struct ext2_inode *dir, const char *name,
+		     uint32_t *blocks, int max);
+
 #if defined(CONFIG_EXT4_WRITE)
 uint32_t ext4fs_div_roundup(uint32_t size, uint32_t n);
 uint16_t ext4fs_checksum_update(unsigned int i);
@@ -0,0 +1,362 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Hashed b-tree (dir_index) directory lookups for ext4
+ *
+ * The directory hash functions are taken from the Linux kernel,
+ * fs/ext4/hash.c, Copyright (C) 2002 by Theodore Ts'o, and the on-disk
+ * index format from fs/ext4/namei.c.
+ *
+ * Only lookups use the index: listing a directory still reads it from
+ * start to end, which visits every entry of an indexed directory too.
+ */
+
+#include <common.h>
+#include <ext4fs.h>
+#include <ext_common.h>
+#include "ext4_common.h"
+
+#define EXT4_FEATURE_COMPAT_DIR_INDEX	0x0020
+#define EXT4_FEATURE_INCOMPAT_LARGEDIR	0x4000
+#define EXT2_FLAGS_UNSIGNED_HASH	0x0002
+
+#define DX_HASH_LEGACY		0
+#define DX_HASH_HALF_MD4	1
+#define DX_HASH_TEA		2
+#define DX_HASH_LEGACY_UNSIGNED	3
+#define DX_HASH_HALF_MD4_UNSIGNED	4
+#define DX_HASH_TEA_UNSIGNED	5
+
+#define EXT4_HTREE_EOF		0x7fffffff
+
+/* The root block starts with the "." and ".." entries, then this */
+struct dx_root_info {
+	__le32 reserved_zero;
+	u8 hash_version;
+	u8 info_length;
+	u8 indirect_levels;
+	u8 unused_flags;
+};
+
+/*
+ * The first entry of a node has no hash, its place holds the limit and
+ * count of entries instead.
+ */
+struct dx_entry {
+	__le32 hash;
+	__le32 block;
+};
+
+struct dx_countlimit {
+	__le16 limit;
+	__le16 count;
+};
+
+static inline u32 rol32(u32 word, unsigned int shift)
+{
+	return (word << shift) | (word >> (32 - shift));
+}
+
+#define DELTA	0x9E3779B9
+
+static void tea_transform(u32 buf[4], const u32 in[])
+{
+	u32 sum = 0;
+	u32 b0 = buf[0], b1 = buf[1];
+	u32 a = in[0], b = in[1], c = in[2], d = in[3];
+	int n = 16;
+
+	do {
+		sum += DELTA;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	} while (--n);
+
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+#define F(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z)	(((x) & (y)) + (((x) ^ (y)) & (z)))
+#define H(x, y, z)	((x) ^ (y) ^ (z))
+
+#define ROUND(f, a, b, c, d, x, s)	\
+	(a += f(b, c, d) + x, a = rol32(a, s))
+#define K1	0
+#define K2	013240474631UL
+#define K3	015666365641UL
+
+static void half_md4_transform(u32 buf[4], const u32 in[8])
+{
+	u32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	/* Round 1 */
+	ROUND(F, a, b, c, d, in[0] + K1,  3);
+	ROUND(F, d, a, b, c, in[1] + K1,  7);
+	ROUND(F, c, d, a, b, in[2] + K1, 11);
+	ROUND(F, b, c, d, a, in[3] + K1, 19);
+	ROUND(F, a, b, c, d, in[4] + K1,  3);
+	ROUND(F, d, a, b, c, in[5] + K1,  7);
+	ROUND(F, c, d, a, b, in[6] + K1, 11);
+	ROUND(F, b, c, d, a, in[7] + K1, 19);
+
+	/* Round 2 */
+	ROUND(G, a, b, c, d, in[1] + K2,  3);
+	ROUND(G, d, a, b, c, in[3] + K2,  5);
+	ROUND(G, c, d, a, b, in[5] + K2,  9);
+	ROUND(G, b, c, d, a, in[7] + K2, 13);
+	ROUND(G, a, b, c, d, in[0] + K2,  3);
+	ROUND(G, d, a, b, c, in[2] + K2,  5);
+	ROUND(G, c, d, a, b, in[4] + K2,  9);
+	ROUND(G, b, c, d, a, in[6] + K2, 13);
+
+	/* Round 3 */
+	ROUND(H, a, b, c, d, in[3] + K3,  3);
+	ROUND(H, d, a, b, c, in[7] + K3,  9);
+	ROUND(H, c, d, a, b, in[2] + K3, 11);
+	ROUND(H, b, c, d, a, in[6] + K3, 15);
+	ROUND(H, a, b, c, d, in[1] + K3,  3);
+	ROUND(H, d, a, b, c, in[5] + K3,  9);
+	ROUND(H, c, d, a, b, in[0] + K3, 11);
+	ROUND(H, b, c, d, a, in[4] + K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+/* The old legacy hash */
+static u32 dx_hack_hash(const char *name, int len, bool unsigned_char)
+{
+	u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+	int c;
+
+	while (len--) {
+		if (unsigned_char)
+			c = *(const unsigned char *)name++;
+		else
+			c = *(const signed char *)name++;
+		hash = hash1 + (hash0 ^ (c * 7152373));
+
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+
+	return hash0 << 1;
+}
+
+static void str2hashbuf(const char *msg, int len, u32 *buf, int num,
+			bool unsigned_char)
+{
+	u32 pad, val;
+	int i, c;
+
+	pad = (u32)len | ((u32)len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		if (unsigned_char)
+			c = ((const unsigned char *)msg)[i];
+		else
+			c = ((const signed char *)msg)[i];
+		val = c + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+/* Return the major hash of a name, or -1 for an unknown hash version */
+static int ext4fs_dirhash(const char *name, int len, int version,
+			  const __le32 *seed, u32 *hashp)
+{
+	u32 buf[4], in[8];
+	bool uc = false;
+	u32 hash;
+	int i;
+
+	buf[0] = 0x67452301;
+	buf[1] = 0xefcdab89;
+	buf[2] = 0x98badcfe;
+	buf[3] = 0x10325476;
+
+	/* A zero seed means the default one */
+	for (i = 0; i < 4; i++) {
+		if (seed[i])
+			break;
+	}
+	if (i < 4) {
+		for (i = 0; i < 4; i++)
+			buf[i] = le32_to_cpu(seed[i]);
+	}
+
+	switch (version) {
+	case DX_HASH_LEGACY_UNSIGNED:
+		uc = true;
+		/* fall through */
+	case DX_HASH_LEGACY:
+		hash = dx_hack_hash(name, len, uc);
+		break;
+	case DX_HASH_HALF_MD4_UNSIGNED:
+		uc = true;
+		/* fall through */
+	case DX_HASH_HALF_MD4:
+		for (; len > 0; len -= 32, name += 32) {
+			str2hashbuf(name, len, in, 8, uc);
+			half_md4_transform(buf, in);
+		}
+		hash = buf[1];
+		break;
+	case DX_HASH_TEA_UNSIGNED:
+		uc = true;
+		/* fall through */
+	case DX_HASH_TEA:
+		for (; len > 0; len -= 16, name += 16) {
+			str2hashbuf(name, len, in, 4, uc);
+			tea_transform(buf, in);
+		}
+		hash = buf[0];
+		break;
+	default:
+		return -1;
+	}
+
+	hash &= ~1;
+	if (hash == (EXT4_HTREE_EOF << 1))
+		hash = (EXT4_HTREE_EOF - 1) << 1;
+	*hashp = hash;
+
+	return 0;
+}
+
+static int ext4fs_dx_read_block(struct ext2_inode *dir, uint32_t fileblock,
+				char *buf)
+{
+	int log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+			 get_fs()->dev_desc->log2blksz;
+	long int blknr;
+
+	blknr = read_allocated_block(dir, fileblock);
+	if (blknr <= 0)
+		return -EIO;
+	if (!ext4fs_devread((lbaint_t)blknr << log2_blksz, 0,
+			    EXT2_BLOCK_SIZE(ext4fs_root), buf))
+		return -EIO;
+
+	return 0;
+}
+
+int ext4fs_dx_lookup(struct ext2_inode *dir, const char *name,
+		     uint32_t *blocks, int max)
+{
+	struct ext2_sblock *sblock = &ext4fs_root->sblock;
+	int blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	struct dx_root_info *info;
+	struct dx_entry *entries, *p, *q, *at;
+	struct dx_countlimit *cl;
+	int version, depth, levels, max_levels;
+	unsigned int count, limit;
+	uint32_t hash, block;
+	char *buf;
+	int n, ret;
+
+	if (!(le32_to_cpu(sblock->feature_compatibility) &
+	      EXT4_FEATURE_COMPAT_DIR_INDEX) ||
+	    !(le32_to_cpu(dir->flags) & EXT4_INDEX_FL))
+		return 0;
+
+	buf = zalloc(blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	ret = ext4fs_dx_read_block(dir, 0, buf);
+	if (ret)
+		goto out;
+
+	/* Anything we do not understand is left to the linear scan */
+	ret = 0;
+	info = (struct dx_root_info *)(buf + 24);
+	version = info->hash_version;
+	if (version <= DX_HASH_TEA &&
+	    (le32_to_cpu(sblock->flags) & EXT2_FLAGS_UNSIGNED_HASH))
+		version += 3;
+	max_levels = le32_to_cpu(sblock->feature_incompat) &
+		     EXT4_FEATURE_INCOMPAT_LARGEDIR ? 3 : 2;
+	depth = info->indirect_levels;
+	levels = depth;
+	if (info->reserved_zero || (info->unused_flags & 1) ||
+	    depth >= max_levels || info->info_length < sizeof(*info))
+		goto out;
+	if (ext4fs_dirhash(name, strlen(name), version, sblock->hash_seed,
+			   &hash))
+		goto out;
+
+	entries = (struct dx_entry *)((char *)info + info->info_length);
+	while (1) {
+		cl = (struct dx_countlimit *)entries;
+		count = le16_to_cpu(cl->count);
+		limit = le16_to_cpu(cl->limit);
+		if (!count || count > limit ||
+		    (char *)(entries + limit) > buf + blksz)
+			goto out;
+
+		/* The last entry whose hash is not above ours */
+		p = entries + 1;
+		q = entries + count - 1;
+		while (p <= q) {
+			struct dx_entry *m = p + (q - p) / 2;
+
+			if (le32_to_cpu(m->hash) > hash)
+				q = m - 1;
+			else
+				p = m + 1;
+		}
+		at = p - 1;
+		block = le32_to_cpu(at->block) & 0x0fffffff;
+
+		if (!levels--)
+			break;
+
+		ret = ext4fs_dx_read_block(dir, block, buf);
+		if (ret)
+			goto out;
+		/* Index nodes start with an empty entry covering the block */
+		entries = (struct dx_entry *)(buf + sizeof(struct ext2_dirent));
+	}
+
+	/*
+	 * Names with equal hashes may have spilled into the following
+	 * leaves, which have our hash with the low bit set.
+	 */
+	n = 0;
+	blocks[n++] = block;
+	for (at++; at < entries + count; at++) {
+		if ((le32_to_cpu(at->hash) & ~1) != hash)
+			break;
+		if (n == max)
+			goto out;
+		blocks[n++] = le32_to_cpu(at->block) & 0x0fffffff;
+	}
+	/* They may go on into the next index node, give up */
+	if (at == entries + count && depth)
+		goto out;
+
+	debug("ext4 dx: %s hash %08x in %d block(s) from %u\n", name, hash,
+	      n, blocks[0]);
+	ret = n;
+out:
+	free(buf);
+
+	return ret;
+}
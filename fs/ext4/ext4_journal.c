@@ -16,6 +16,7 @@
 #include <common.h>
 #include <ext4fs.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <ext_common.h>
 #include "ext4_common.h"
 
@@ -549,7 +550,8 @@ end:
 	return 0;
 }
 
-static void update_descriptor_block(long int blknr)
+/* Fill in the descriptor block of the transaction in buf */
+static void update_descriptor_block(char *buf)
 {
 	int i;
 	long int jsb_blknr;
@@ -557,7 +559,6 @@ static void update_descriptor_block(long int blknr)
 	struct ext3_journal_block_tag tag;
 	struct ext2_inode inode_journal;
 	struct journal_superblock_t *jsb = NULL;
-	char *buf = NULL;
 	char *temp = NULL;
 	struct ext_filesystem *fs = get_fs();
 	char *temp_buff = zalloc(fs->blksz);
@@ -574,11 +575,6 @@ static void update_descriptor_block(long int blknr)
 	jdb.h_blocktype = cpu_to_be32(EXT3_JOURNAL_DESCRIPTOR_BLOCK);
 	jdb.h_magic = cpu_to_be32(EXT3_JOURNAL_MAGIC_NUMBER);
 	jdb.h_sequence = jsb->s_sequence;
-	buf = zalloc(fs->blksz);
-	if (!buf) {
-		free(temp_buff);
-		return;
-	}
 	temp = buf;
 	memcpy(buf, &jdb, sizeof(struct journal_header_t));
 	temp += sizeof(struct journal_header_t);
@@ -597,17 +593,15 @@ static void update_descriptor_block(long int blknr)
 	tag.flags = cpu_to_be32(EXT3_JOURNAL_FLAG_LAST_TAG);
 	memcpy(temp - sizeof(struct ext3_journal_block_tag), &tag,
 	       sizeof(struct ext3_journal_block_tag));
-	put_ext4((uint64_t) ((uint64_t)blknr * (uint64_t)fs->blksz), buf, (uint32_t) fs->blksz);
 
 	free(temp_buff);
-	free(buf);
 }
 
-static void update_commit_block(long int blknr)
+/* Fill in the commit block of the transaction in buf */
+static void update_commit_block(char *buf)
 {
 	struct journal_header_t jdb;
 	struct ext_filesystem *fs = get_fs();
-	char *buf = NULL;
 	struct ext2_inode inode_journal;
 	struct journal_superblock_t *jsb;
 	long int jsb_blknr;
@@ -626,35 +620,71 @@ static void update_commit_block(long int blknr)
 	jdb.h_blocktype = cpu_to_be32(EXT3_JOURNAL_COMMIT_BLOCK);
 	jdb.h_magic = cpu_to_be32(EXT3_JOURNAL_MAGIC_NUMBER);
 	jdb.h_sequence = jsb->s_sequence;
-	buf = zalloc(fs->blksz);
-	if (!buf) {
-		free(temp_buff);
-		return;
-	}
 	memcpy(buf, &jdb, sizeof(struct journal_header_t));
-	put_ext4((uint64_t) ((uint64_t)blknr * (uint64_t)fs->blksz), buf, (uint32_t) fs->blksz);
 
 	free(temp_buff);
-	free(buf);
 }
 
+/*
+ * Write the transaction: its descriptor block, the logged blocks and the
+ * commit block. The journal is usually contiguous on disk, so the blocks
+ * are gathered and written in runs of up to JOURNAL_WRITE_BATCH blocks
+ * rather than one at a time. The commit block always goes last, on its
+ * own, once the rest of the transaction is on disk.
+ */
 void ext4fs_update_journal(void)
 {
 	struct ext2_inode inode_journal;
 	struct ext_filesystem *fs = get_fs();
-	long int blknr;
-	int i;
+	char *blocks[MAX_JOURNAL_ENTRIES + 2];
+	long int blknr[MAX_JOURNAL_ENTRIES + 2];
+	char *desc = zalloc(fs->blksz);
+	char *commit = zalloc(fs->blksz);
+	char *batch;
+	int i, j, n, count;
+
+	if (!desc || !commit) {
+		printf("no memory to update the journal\n");
+		goto out;
+	}
+
+	update_descriptor_block(desc);
+	update_commit_block(commit);
+
 	ext4fs_read_inode(ext4fs_root, EXT2_JOURNAL_INO, &inode_journal);
-	blknr = read_allocated_block(&inode_journal, jrnl_blk_idx++);
-	update_descriptor_block(blknr);
+	count = 0;
+	blocks[count] = desc;
+	blknr[count++] = read_allocated_block(&inode_journal, jrnl_blk_idx++);
 	for (i = 0; i < MAX_JOURNAL_ENTRIES; i++) {
 		if (journal_ptr[i]->blknr == -1)
 			break;
-		blknr = read_allocated_block(&inode_journal, jrnl_blk_idx++);
-		put_ext4((uint64_t) ((uint64_t)blknr * (uint64_t)fs->blksz),
-			 journal_ptr[i]->buf, fs->blksz);
+		blocks[count] = journal_ptr[i]->buf;
+		blknr[count++] = read_allocated_block(&inode_journal,
+						      jrnl_blk_idx++);
+	}
+	blocks[count] = commit;
+	blknr[count++] = read_allocated_block(&inode_journal, jrnl_blk_idx++);
+
+	/* Without a staging buffer, go one block at a time */
+	batch = malloc_cache_aligned(JOURNAL_WRITE_BATCH * fs->blksz);
+	for (i = 0; i < count; i += n) {
+		n = 1;
+		while (batch && i + n < count - 1 && n < JOURNAL_WRITE_BATCH &&
+		       blknr[i + n] == blknr[i] + n)
+			n++;
+		if (n == 1) {
+			put_ext4((uint64_t)blknr[i] * (uint64_t)fs->blksz,
+				 blocks[i], fs->blksz);
+			continue;
+		}
+		for (j = 0; j < n; j++)
+			memcpy(batch + j * fs->blksz, blocks[i + j], fs->blksz);
+		put_ext4((uint64_t)blknr[i] * (uint64_t)fs->blksz, batch,
+			 n * fs->blksz);
 	}
-	blknr = read_allocated_block(&inode_journal, jrnl_blk_idx++);
-	update_commit_block(blknr);
+	free(batch);
 	printf("update journal finished\n");
+out:
+	free(desc);
+	free(commit);
 }
@@ -37,6 +37,8 @@
 
 /* Maximum entries in 1 journal transaction */
 #define MAX_JOURNAL_ENTRIES 100
+/* Most journal blocks written to the disk at once */
+#define JOURNAL_WRITE_BATCH 32
 struct journal_log {
 	char *buf;
 	int blknr;
@@ -44,12 +44,15 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
  * reads into one potentially more efficient larger sequential read action
+ *
+ * Blocks are mapped a run at a time, so a file made of a few extents is
+ * read with one device read per extent.
  */
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
+	int i, first, count;
 	lbaint_t blockcnt;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
@@ -72,28 +75,34 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
+	first = lldiv(pos, blocksize);
+	for (i = first; i < blockcnt; i += count) {
 		long int blknr;
 		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
+		loff_t blockend;
 		int skipfirst = 0;
-		blknr = read_allocated_block(&(node->inode), i);
+
+		/* Map as many blocks as are contiguous, i.e. a whole extent */
+		blknr = ext4fs_map_blocks(&(node->inode), i, blockcnt - i,
+					  &count);
 		if (blknr < 0)
 			return -1;
 
 		blknr = blknr << log2_fs_blocksize;
+		blockend = (loff_t)count * blocksize;
 
 		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
+		if (i + count == blockcnt) {
+			int lastend = (len + pos) - (blocksize * (blockcnt - 1));
 
 			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
+			if (!lastend)
+				lastend = blocksize;
+			blockend -= blocksize - lastend;
 		}
 
 		/* First block. */
-		if (i == lldiv(pos, blocksize)) {
+		if (i == first) {
 			skipfirst = blockoff;
 			blockend -= skipfirst;
 		}
@@ -103,7 +112,8 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 			if (previous_block_number != -1) {
 				if (delayed_next == blknr) {
 					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
+					delayed_next += count <<
+							log2_fs_blocksize;
 				} else {	/* spill */
 					status = ext4fs_devread(delayed_start,
 							delayed_skipfirst,
@@ -117,7 +127,7 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 					delayed_skipfirst = skipfirst;
 					delayed_buf = buf;
 					delayed_next = blknr +
-						(blockend >> log2blksz);
+						(count << log2_fs_blocksize);
 				}
 			} else {
 				previous_block_number = blknr;
@@ -126,10 +136,9 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 				delayed_skipfirst = skipfirst;
 				delayed_buf = buf;
 				delayed_next = blknr +
-					(blockend >> log2blksz);
+					(count << log2_fs_blocksize);
 			}
 		} else {
-			int n;
 			if (previous_block_number != -1) {
 				/* spill */
 				status = ext4fs_devread(delayed_start,
@@ -140,13 +149,10 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 					return -1;
 				previous_block_number = -1;
 			}
-			/* Zero no more than `len' bytes. */
-			n = blocksize - skipfirst;
-			if (n > len)
-				n = len;
-			memset(buf, 0, n);
+			/* A hole, zero it */
+			memset(buf, 0, blockend);
 		}
-		buf += blocksize - skipfirst;
+		buf += blockend;
 	}
 	if (previous_block_number != -1) {
 		/* spill */
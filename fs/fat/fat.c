@@ -14,11 +14,13 @@
 #include <exports.h>
 #include <fat.h>
 #include <fs.h>
+#include <fs_internal.h>
 #include <asm/byteorder.h>
 #include <part.h>
 #include <malloc.h>
 #include <memalign.h>
 #include <linux/compiler.h>
+#include <linux/math64.h>
 #include <linux/ctype.h>
 
 /*
@@ -56,6 +58,30 @@ static int disk_read(__u32 block, __u32 nr_blocks, void *buf)
 	return ret;
 }
 
+static void fat_extents_invalidate(void);
+static void fat_dentry_invalidate(void);
+
+/* Size of the boot sector fields, up to the FAT32 volume ID and label */
+#define FAT_VOLUME_KEY_SIZE	0x5a
+
+/* Drop what is cached about the previous volume if this is another one */
+static void fat_check_volume(const unsigned char *boot_sector)
+{
+	static struct blk_desc *dev;
+	static lbaint_t part_start;
+	static unsigned char key[FAT_VOLUME_KEY_SIZE];
+
+	if (dev == cur_dev && part_start == cur_part_info.start &&
+	    !memcmp(key, boot_sector, FAT_VOLUME_KEY_SIZE))
+		return;
+
+	fat_extents_invalidate();
+	fat_dentry_invalidate();
+	dev = cur_dev;
+	part_start = cur_part_info.start;
+	memcpy(key, boot_sector, FAT_VOLUME_KEY_SIZE);
+}
+
 int fat_set_blk_dev(struct blk_desc *dev_desc, disk_partition_t *info)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, buffer, dev_desc->blksz);
@@ -76,10 +102,11 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, disk_partition_t *info)
 	}
 
 	/* Check for FAT12/FAT16/FAT32 filesystem */
-	if (!memcmp(buffer + DOS_FS_TYPE_OFFSET, "FAT", 3))
-		return 0;
-	if (!memcmp(buffer + DOS_FS32_TYPE_OFFSET, "FAT32", 5))
+	if (!memcmp(buffer + DOS_FS_TYPE_OFFSET, "FAT", 3) ||
+	    !memcmp(buffer + DOS_FS32_TYPE_OFFSET, "FAT32", 5)) {
+		fat_check_volume(buffer);
 		return 0;
+	}
 
 	cur_dev = NULL;
 	return -1;
@@ -145,6 +172,7 @@ static void get_name(dir_entry *dirent, char *s_name)
 }
 
 static int flush_dirty_fat_buffer(fsdata *mydata);
+static int flush_fat_window(fsdata *mydata, int w);
 
 #if !CONFIG_IS_ENABLED(FAT_WRITE)
 /* Stub for read only operation */
@@ -153,8 +181,76 @@ int flush_dirty_fat_buffer(fsdata *mydata)
 	(void)(mydata);
 	return 0;
 }
+
+static int flush_fat_window(fsdata *mydata, int w)
+{
+	return 0;
+}
 #endif
 
+/*
+ * The FAT cache: FAT_CACHE_WINDOWS windows of FATBUFBLOCKS sectors, replaced
+ * in LRU order. Writes mark the sectors they touch dirty and only those are
+ * written back.
+ */
+static void fat_cache_reset(fsdata *mydata)
+{
+	int i;
+
+	for (i = 0; i < FAT_CACHE_WINDOWS; i++) {
+		mydata->fatwin[i].bufnum = -1;
+		mydata->fatwin[i].used = 0;
+		mydata->fatwin[i].dirty_lo = 0;
+		mydata->fatwin[i].dirty_hi = 0;
+	}
+	mydata->fatwin_clock = 0;
+}
+
+static __u8 *fat_window_buf(fsdata *mydata, int w)
+{
+	return mydata->fatbuf + w * FATBUFSIZE;
+}
+
+/* Get the window holding FAT buffer 'bufnum', reading it in if needed */
+static int fat_get_window(fsdata *mydata, __u32 bufnum)
+{
+	struct fat_window *win;
+	__u32 getsize = FATBUFBLOCKS;
+	__u32 startblock = bufnum * FATBUFBLOCKS;
+	int i, victim = 0;
+
+	for (i = 0; i < FAT_CACHE_WINDOWS; i++) {
+		win = &mydata->fatwin[i];
+		if (win->bufnum == (int)bufnum) {
+			win->used = ++mydata->fatwin_clock;
+			return i;
+		}
+		/* Empty windows are never used, so they go first */
+		if (win->used < mydata->fatwin[victim].used)
+			victim = i;
+	}
+
+	/* Write back the window to the disk */
+	if (flush_fat_window(mydata, victim) < 0)
+		return -1;
+
+	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+	if (startblock + getsize > mydata->fatlength)
+		getsize = mydata->fatlength - startblock;
+
+	startblock += mydata->fat_sect;	/* Offset from start of disk */
+
+	win = &mydata->fatwin[victim];
+	win->bufnum = -1;
+	win->used = 0;
+	if (disk_read(startblock, getsize, fat_window_buf(mydata, victim)) < 0)
+		return -1;
+	win->bufnum = bufnum;
+	win->used = ++mydata->fatwin_clock;
+
+	return victim;
+}
+
 /*
  * Get the entry at index 'entry' in a FAT (12/16/32) table.
  * On failure 0x00 is returned.
@@ -164,6 +260,8 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	__u32 bufnum;
 	__u32 offset, off8;
 	__u32 ret = 0x00;
+	__u8 *fatbuf;
+	int w;
 
 	if (CHECK_CLUST(entry, mydata->fatsize)) {
 		printf("Error: Invalid FAT entry: 0x%08x\n", entry);
@@ -193,41 +291,25 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	       mydata->fatsize, entry, entry, offset, offset);
 
 	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		startblock += mydata->fat_sect;	/* Offset from start of disk */
-
-		/* Write back the fatbuf to the disk */
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return ret;
-		}
-		mydata->fatbufnum = bufnum;
+	w = fat_get_window(mydata, bufnum);
+	if (w < 0) {
+		debug("Error reading FAT blocks\n");
+		return ret;
 	}
+	fatbuf = fat_window_buf(mydata, w);
 
 	/* Get the actual entry from the table */
 	switch (mydata->fatsize) {
 	case 32:
-		ret = FAT2CPU32(((__u32 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU32(((__u32 *)fatbuf)[offset]);
 		break;
 	case 16:
-		ret = FAT2CPU16(((__u16 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU16(((__u16 *)fatbuf)[offset]);
 		break;
 	case 12:
 		off8 = (offset * 3) / 2;
 		/* fatbut + off8 may be unaligned, read in byte granularity */
-		ret = mydata->fatbuf[off8] + (mydata->fatbuf[off8 + 1] << 8);
+		ret = fatbuf[off8] + (fatbuf[off8 + 1] << 8);
 
 		if (offset & 0x1)
 			ret >>= 4;
@@ -259,21 +341,19 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	debug("gc - clustnum: %d, startsect: %d\n", clustnum, startsect);
 
 	if ((unsigned long)buffer & (ARCH_DMA_MINALIGN - 1)) {
-		ALLOC_CACHE_ALIGN_BUFFER(__u8, tmpbuf, mydata->sect_size);
-
 		debug("FAT: Misaligned buffer address (%p)\n", buffer);
 
-		while (size >= mydata->sect_size) {
-			ret = disk_read(startsect++, 1, tmpbuf);
-			if (ret != 1) {
-				debug("Error reading data (got %d)\n", ret);
-				return -1;
-			}
-
-			memcpy(buffer, tmpbuf, mydata->sect_size);
-			buffer += mydata->sect_size;
-			size -= mydata->sect_size;
+		idx = size / mydata->sect_size;
+		if (idx && (!cur_dev ||
+			    fs_devread_blocks(cur_dev, cur_part_info.start +
+					      startsect, idx, buffer))) {
+			debug("Error reading data\n");
+			return -1;
 		}
+		startsect += idx;
+		idx *= mydata->sect_size;
+		buffer += idx;
+		size -= idx;
 	} else {
 		idx = size / mydata->sect_size;
 		ret = disk_read(startsect, idx, buffer);
@@ -301,6 +381,158 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/*
+ * Extent maps: the cluster chain of a file as runs of consecutive clusters,
+ * built the first time the file is read. Reads then go out one run at a
+ * time and seeking is a binary search instead of a walk down the chain.
+ * The fs layer resolves the path again for every read, so the maps of the
+ * last few files are kept, keyed by device, start cluster, size and date.
+ */
+#define FAT_EXTENT_MAPS		4
+
+struct fat_run {
+	__u32 clust;		/* First cluster of the run */
+	__u32 count;		/* Number of clusters */
+	__u32 fidx;		/* Index of the first cluster in the file */
+};
+
+struct fat_extents {
+	struct blk_desc *dev;	/* NULL if unused */
+	lbaint_t part_start;
+	__u32 start;
+	__u32 size;
+	__u16 time, date;
+	__u32 nclust;		/* Clusters found in the chain */
+	int nr_runs;
+	int max_runs;
+	struct fat_run *runs;
+};
+
+static struct fat_extents fat_extent_maps[FAT_EXTENT_MAPS];
+static int fat_extent_next;
+
+static void fat_extents_invalidate(void)
+{
+	int i;
+
+	for (i = 0; i < FAT_EXTENT_MAPS; i++) {
+		free(fat_extent_maps[i].runs);
+		fat_extent_maps[i].runs = NULL;
+		fat_extent_maps[i].max_runs = 0;
+		fat_extent_maps[i].dev = NULL;
+	}
+}
+
+static int fat_add_run(struct fat_extents *map, __u32 clust, __u32 fidx)
+{
+	struct fat_run *run;
+
+	if (map->nr_runs) {
+		run = &map->runs[map->nr_runs - 1];
+		if (run->clust + run->count == clust) {
+			run->count++;
+			return 0;
+		}
+	}
+
+	if (map->nr_runs == map->max_runs) {
+		int max = map->max_runs ? map->max_runs * 2 : 16;
+
+		run = realloc(map->runs, max * sizeof(*run));
+		if (!run)
+			return -ENOMEM;
+		map->runs = run;
+		map->max_runs = max;
+	}
+	run = &map->runs[map->nr_runs++];
+	run->clust = clust;
+	run->count = 1;
+	run->fidx = fidx;
+
+	return 0;
+}
+
+/*
+ * Walk the chain once. A chain shorter than the file size leaves nclust
+ * short: reads stop there, as they always did.
+ */
+static int fat_build_extents(fsdata *mydata, struct fat_extents *map,
+			     __u32 clust, __u32 nclust)
+{
+	__u32 idx;
+
+	map->nr_runs = 0;
+	for (idx = 0; idx < nclust; idx++) {
+		if (idx)
+			clust = get_fatent(mydata, clust);
+		if (CHECK_CLUST(clust, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", clust);
+			debug("Invalid FAT entry\n");
+			break;
+		}
+		if (fat_add_run(map, clust, idx))
+			return -ENOMEM;
+	}
+	map->nclust = idx;
+
+	return 0;
+}
+
+static struct fat_extents *fat_get_extents(fsdata *mydata,
+					   dir_entry *dentptr)
+{
+	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
+	__u32 size = FAT2CPU32(dentptr->size);
+	__u32 start = START(dentptr);
+	struct fat_extents *map;
+	int i;
+
+	for (i = 0; i < FAT_EXTENT_MAPS; i++) {
+		map = &fat_extent_maps[i];
+		if (map->dev == cur_dev &&
+		    map->part_start == cur_part_info.start &&
+		    map->start == start && map->size == size &&
+		    map->time == dentptr->time && map->date == dentptr->date)
+			return map;
+	}
+
+	map = &fat_extent_maps[fat_extent_next];
+	fat_extent_next = (fat_extent_next + 1) % FAT_EXTENT_MAPS;
+	map->dev = NULL;
+	if (fat_build_extents(mydata, map, start,
+			      DIV_ROUND_UP(size, bytesperclust)))
+		return NULL;
+
+	map->dev = cur_dev;
+	map->part_start = cur_part_info.start;
+	map->start = start;
+	map->size = size;
+	map->time = dentptr->time;
+	map->date = dentptr->date;
+
+	return map;
+}
+
+/* Find the run holding cluster 'idx' of the file, or -1 past the chain */
+static int fat_find_run(struct fat_extents *map, __u32 idx)
+{
+	int lo = 0, hi = map->nr_runs - 1;
+
+	if (idx >= map->nclust)
+		return -1;
+
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+
+		if (map->runs[mid].fidx <= idx)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	return lo;
+}
+
 /*
  * Read at most 'maxsize' bytes from 'pos' in the file associated with 'dentptr'
  * into 'buffer'.
@@ -311,9 +543,11 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	struct fat_extents *map;
+	struct fat_run *run;
+	__u32 idx, off;
 	loff_t actsize;
+	int r;
 
 	*gotsize = 0;
 	debug("Filesize: %llu bytes\n", filesize);
@@ -328,21 +562,15 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
-
-	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize += bytesperclust;
+	map = fat_get_extents(mydata, dentptr);
+	if (!map) {
+		debug("Error: allocating extent map\n");
+		return -ENOMEM;
 	}
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
+	/* go to cluster at pos */
+	idx = div_u64(pos, bytesperclust);
+	actsize = (loff_t)idx * bytesperclust;
 	filesize -= actsize;
 	pos -= actsize;
 
@@ -350,6 +578,13 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 	if (pos) {
 		__u8 *tmp_buffer;
 
+		r = fat_find_run(map, idx);
+		if (r < 0) {
+			debug("Invalid FAT entry\n");
+			return 0;
+		}
+		run = &map->runs[r];
+
 		actsize = min(filesize, (loff_t)bytesperclust);
 		tmp_buffer = malloc_cache_aligned(actsize);
 		if (!tmp_buffer) {
@@ -357,7 +592,8 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 			return -ENOMEM;
 		}
 
-		if (get_cluster(mydata, curclust, tmp_buffer, actsize) != 0) {
+		if (get_cluster(mydata, run->clust + idx - run->fidx,
+				tmp_buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			free(tmp_buffer);
 			return -1;
@@ -370,59 +606,33 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 		if (!filesize)
 			return 0;
 		buffer += actsize;
-
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
-		}
+		idx++;
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				debug("Invalid FAT entry\n");
-				return 0;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
+	/* read whole runs of consecutive clusters in one go */
+	while (filesize) {
+		r = fat_find_run(map, idx);
+		if (r < 0) {
+			printf("Invalid FAT entry\n");
+			return 0;
 		}
+		run = &map->runs[r];
+		off = idx - run->fidx;
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		actsize = min(filesize,
+			      (loff_t)(run->count - off) * bytesperclust);
+		if (get_cluster(mydata, run->clust + off, buffer,
+				actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
 		buffer += actsize;
+		idx = run->fidx + run->count;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
@@ -606,9 +816,8 @@ static int get_fs_info(fsdata *mydata)
 			sect_to_clust(mydata, mydata->rootdir_sect);
 	}
 
-	mydata->fatbufnum = -1;
-	mydata->fat_dirty = 0;
-	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
+	fat_cache_reset(mydata);
+	mydata->fatbuf = malloc_cache_aligned(FAT_CACHE_SIZE);
 	if (mydata->fatbuf == NULL) {
 		debug("Error: allocating memory\n");
 		return -1;
@@ -1011,6 +1220,94 @@ static int fat_itr_resolve(fat_itr *itr, const char *path, unsigned type)
 	return -ENOENT;
 }
 
+/*
+ * Dentry cache: the outcome of resolving a path on the current volume, so
+ * that looking up the same paths again, as boot scripts probing for their
+ * files do, needs no directory reads. Writes drop it, and so does
+ * switching to another volume.
+ */
+#define FAT_DENTRY_CACHE	16
+#define FAT_DENTRY_PATH_MAX	128
+
+struct fat_dentry {
+	bool valid;
+	bool found;
+	bool is_dir;
+	dir_entry dent;		/* Entry of a file */
+	char path[FAT_DENTRY_PATH_MAX];
+};
+
+static struct fat_dentry fat_dentries[FAT_DENTRY_CACHE];
+static int fat_dentry_next;
+
+static void fat_dentry_invalidate(void)
+{
+	int i;
+
+	for (i = 0; i < FAT_DENTRY_CACHE; i++)
+		fat_dentries[i].valid = false;
+}
+
+/**
+ * fat_lookup() - resolve a path like fat_itr_resolve(), through the
+ * dentry cache
+ *
+ * @itr: iterator initialized to root, only used if the path is not cached
+ * @path: the requested path
+ * @type: bitmask of allowable file types
+ * @dent: if not NULL, gets a copy of the entry when a file is found
+ * @return 0 on success or -errno
+ */
+static int fat_lookup(fat_itr *itr, const char *path, unsigned type,
+		      dir_entry *dent)
+{
+	struct fat_dentry tmp, *de = NULL;
+	int i, ret;
+
+	while (path[0] && ISDIRDELIM(path[0]))
+		path++;
+
+	for (i = 0; i < FAT_DENTRY_CACHE; i++) {
+		if (fat_dentries[i].valid &&
+		    !strcasecmp(path, fat_dentries[i].path)) {
+			de = &fat_dentries[i];
+			break;
+		}
+	}
+
+	if (!de) {
+		ret = fat_itr_resolve(itr, path, TYPE_ANY);
+		if (ret && ret != -ENOENT)
+			return ret;
+
+		if (strlen(path) < FAT_DENTRY_PATH_MAX) {
+			de = &fat_dentries[fat_dentry_next];
+			fat_dentry_next = (fat_dentry_next + 1) %
+					  FAT_DENTRY_CACHE;
+			strcpy(de->path, path);
+			de->valid = true;
+		} else {
+			de = &tmp;
+		}
+		/* A directory leaves the iterator at its start */
+		de->found = !ret;
+		de->is_dir = de->found && !itr->dent;
+		if (de->found && !de->is_dir)
+			de->dent = *itr->dent;
+	}
+
+	if (!de->found)
+		return -ENOENT;
+	if (de->is_dir)
+		return type & TYPE_DIR ? 0 : -ENOENT;
+	if (!(type & TYPE_FILE))
+		return -ENOTDIR;
+	if (dent)
+		*dent = de->dent;
+
+	return 0;
+}
+
 int file_fat_detectfs(void)
 {
 	boot_sector bs;
@@ -1086,7 +1383,7 @@ int fat_exists(const char *filename)
 	if (ret)
 		goto out;
 
-	ret = fat_itr_resolve(itr, filename, TYPE_ANY);
+	ret = fat_lookup(itr, filename, TYPE_ANY, NULL);
 	free(fsdata.fatbuf);
 out:
 	free(itr);
@@ -1097,6 +1394,7 @@ int fat_size(const char *filename, loff_t *size)
 {
 	fsdata fsdata;
 	fat_itr *itr;
+	dir_entry dent;
 	int ret;
 
 	itr = malloc_cache_aligned(sizeof(fat_itr));
@@ -1106,7 +1404,7 @@ int fat_size(const char *filename, loff_t *size)
 	if (ret)
 		goto out_free_itr;
 
-	ret = fat_itr_resolve(itr, filename, TYPE_FILE);
+	ret = fat_lookup(itr, filename, TYPE_FILE, &dent);
 	if (ret) {
 		/*
 		 * Directories don't have size, but fs_size() is not
@@ -1114,14 +1412,14 @@ int fat_size(const char *filename, loff_t *size)
 		 */
 		free(fsdata.fatbuf);
 		fat_itr_root(itr, &fsdata);
-		if (!fat_itr_resolve(itr, filename, TYPE_DIR)) {
+		if (!fat_lookup(itr, filename, TYPE_DIR, NULL)) {
 			*size = 0;
 			ret = 0;
 		}
 		goto out_free_both;
 	}
 
-	*size = FAT2CPU32(itr->dent->size);
+	*size = FAT2CPU32(dent.size);
 out_free_both:
 	free(fsdata.fatbuf);
 out_free_itr:
@@ -1134,6 +1432,7 @@ int file_fat_read_at(const char *filename, loff_t pos, void *buffer,
 {
 	fsdata fsdata;
 	fat_itr *itr;
+	dir_entry dent;
 	int ret;
 
 	itr = malloc_cache_aligned(sizeof(fat_itr));
@@ -1143,20 +1442,18 @@ int file_fat_read_at(const char *filename, loff_t pos, void *buffer,
 	if (ret)
 		goto out_free_itr;
 
-	ret = fat_itr_resolve(itr, filename, TYPE_FILE);
+	ret = fat_lookup(itr, filename, TYPE_FILE, &dent);
 	if (ret)
 		goto out_free_both;
 
 	debug("reading %s at pos %llu\n", filename, pos);
 
 	/* For saving default max clustersize memory allocated to malloc pool */
-	dir_entry *dentptr = itr->dent;
-
 	free(itr);
 
 	itr = NULL;
 
-	ret = get_contents(&fsdata, dentptr, pos, buffer, maxsize, actread);
+	ret = get_contents(&fsdata, &dent, pos, buffer, maxsize, actread);
 
 out_free_both:
 	free(fsdata.fatbuf);
@@ -100,46 +100,102 @@ static void set_name(dir_entry *dirent, const char *filename)
 }
 
 /*
- * Write fat buffer into block device
+ * Write the dirty sectors of a FAT cache window to one copy of the FAT
  */
-static int flush_dirty_fat_buffer(fsdata *mydata)
+static int write_fat_window(fsdata *mydata, int w, int copy)
 {
-	int getsize = FATBUFBLOCKS;
-	__u32 fatlength = mydata->fatlength;
-	__u8 *bufptr = mydata->fatbuf;
-	__u32 startblock = mydata->fatbufnum * FATBUFBLOCKS;
+	struct fat_window *win = &mydata->fatwin[w];
+	__u32 startblock = win->bufnum * FATBUFBLOCKS + win->dirty_lo;
+
+	startblock += mydata->fat_sect + copy * mydata->fatlength;
 
-	debug("debug: evicting %d, dirty: %d\n", mydata->fatbufnum,
-	      (int)mydata->fat_dirty);
+	if (disk_write(startblock, win->dirty_hi - win->dirty_lo,
+		       fat_window_buf(mydata, w) +
+		       win->dirty_lo * mydata->sect_size) < 0) {
+		debug("error: writing FAT %d blocks\n", copy);
+		return -1;
+	}
+
+	return 0;
+}
 
-	if ((!mydata->fat_dirty) || (mydata->fatbufnum == -1))
+/*
+ * Write a FAT cache window back to every copy of the FAT, before it is
+ * reused
+ */
+static int flush_fat_window(fsdata *mydata, int w)
+{
+	struct fat_window *win = &mydata->fatwin[w];
+	int copy;
+
+	debug("debug: evicting %d, dirty: %d-%d\n", win->bufnum,
+	      win->dirty_lo, win->dirty_hi);
+
+	if (win->bufnum == -1 || win->dirty_lo == win->dirty_hi)
 		return 0;
 
-	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-	if (startblock + getsize > fatlength)
-		getsize = fatlength - startblock;
+	for (copy = 0; copy < mydata->fats; copy++)
+		if (write_fat_window(mydata, w, copy) < 0)
+			return -1;
+	win->dirty_lo = 0;
+	win->dirty_hi = 0;
+
+	return 0;
+}
 
-	startblock += mydata->fat_sect;
+/*
+ * Write all modified FAT sectors into block device: the dirty windows in
+ * the order of the FAT, for one copy of the FAT after the other
+ */
+static int flush_dirty_fat_buffer(fsdata *mydata)
+{
+	int order[FAT_CACHE_WINDOWS];
+	int count = 0;
+	int i, j, copy;
 
-	/* Write FAT buf */
-	if (disk_write(startblock, getsize, bufptr) < 0) {
-		debug("error: writing FAT blocks\n");
-		return -1;
+	for (i = 0; i < FAT_CACHE_WINDOWS; i++) {
+		struct fat_window *win = &mydata->fatwin[i];
+
+		if (win->bufnum == -1 || win->dirty_lo == win->dirty_hi)
+			continue;
+		for (j = count; j > 0 &&
+		     mydata->fatwin[order[j - 1]].bufnum > win->bufnum; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+		count++;
 	}
 
-	if (mydata->fats == 2) {
-		/* Update corresponding second FAT blocks */
-		startblock += mydata->fatlength;
-		if (disk_write(startblock, getsize, bufptr) < 0) {
-			debug("error: writing second FAT blocks\n");
-			return -1;
-		}
+	for (copy = 0; copy < mydata->fats; copy++)
+		for (i = 0; i < count; i++)
+			if (write_fat_window(mydata, order[i], copy) < 0)
+				return -1;
+
+	for (i = 0; i < count; i++) {
+		mydata->fatwin[order[i]].dirty_lo = 0;
+		mydata->fatwin[order[i]].dirty_hi = 0;
 	}
-	mydata->fat_dirty = 0;
 
 	return 0;
 }
 
+/* Note that 'len' bytes at 'off' in window 'w' were modified */
+static void fat_window_set_dirty(fsdata *mydata, int w, __u32 off,
+				 __u32 len)
+{
+	struct fat_window *win = &mydata->fatwin[w];
+	__u16 lo = off / mydata->sect_size;
+	__u16 hi = min((off + len - 1) / mydata->sect_size + 1,
+		       (__u32)FATBUFBLOCKS);
+
+	if (win->dirty_lo == win->dirty_hi) {
+		win->dirty_lo = lo;
+		win->dirty_hi = hi;
+	} else {
+		win->dirty_lo = min(win->dirty_lo, lo);
+		win->dirty_hi = max(win->dirty_hi, hi);
+	}
+}
+
 /*
  * Set the file name information from 'name' into 'slotptr',
  */
@@ -265,6 +321,8 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 {
 	__u32 bufnum, offset, off16;
 	__u16 val1, val2;
+	__u8 *fatbuf;
+	int w;
 
 	switch (mydata->fatsize) {
 	case 32:
@@ -285,38 +343,33 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 	}
 
 	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		startblock += mydata->fat_sect;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return -1;
-		}
-		mydata->fatbufnum = bufnum;
+	w = fat_get_window(mydata, bufnum);
+	if (w < 0) {
+		debug("Error reading FAT blocks\n");
+		return -1;
 	}
+	fatbuf = fat_window_buf(mydata, w);
 
-	/* Mark as dirty */
-	mydata->fat_dirty = 1;
+	/* Mark the sectors holding the entry as dirty */
+	switch (mydata->fatsize) {
+	case 32:
+		fat_window_set_dirty(mydata, w, offset * 4, 4);
+		break;
+	case 16:
+		fat_window_set_dirty(mydata, w, offset * 2, 2);
+		break;
+	case 12:
+		fat_window_set_dirty(mydata, w, (offset * 3) / 4 * 2, 4);
+		break;
+	}
 
 	/* Set the actual entry */
 	switch (mydata->fatsize) {
 	case 32:
-		((__u32 *) mydata->fatbuf)[offset] = cpu_to_le32(entry_value);
+		((__u32 *) fatbuf)[offset] = cpu_to_le32(entry_value);
 		break;
 	case 16:
-		((__u16 *) mydata->fatbuf)[offset] = cpu_to_le16(entry_value);
+		((__u16 *) fatbuf)[offset] = cpu_to_le16(entry_value);
 		break;
 	case 12:
 		off16 = (offset * 3) / 4;
@@ -324,33 +377,33 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 		switch (offset & 0x3) {
 		case 0:
 			val1 = cpu_to_le16(entry_value) & 0xfff;
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xfff;
-			((__u16 *)mydata->fatbuf)[off16] |= val1;
+			((__u16 *)fatbuf)[off16] &= ~0xfff;
+			((__u16 *)fatbuf)[off16] |= val1;
 			break;
 		case 1:
 			val1 = cpu_to_le16(entry_value) & 0xf;
 			val2 = (cpu_to_le16(entry_value) >> 4) & 0xff;
 
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xf000;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 12);
+			((__u16 *)fatbuf)[off16] &= ~0xf000;
+			((__u16 *)fatbuf)[off16] |= (val1 << 12);
 
-			((__u16 *)mydata->fatbuf)[off16 + 1] &= ~0xff;
-			((__u16 *)mydata->fatbuf)[off16 + 1] |= val2;
+			((__u16 *)fatbuf)[off16 + 1] &= ~0xff;
+			((__u16 *)fatbuf)[off16 + 1] |= val2;
 			break;
 		case 2:
 			val1 = cpu_to_le16(entry_value) & 0xff;
 			val2 = (cpu_to_le16(entry_value) >> 8) & 0xf;
 
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xff00;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 8);
+			((__u16 *)fatbuf)[off16] &= ~0xff00;
+			((__u16 *)fatbuf)[off16] |= (val1 << 8);
 
-			((__u16 *)mydata->fatbuf)[off16 + 1] &= ~0xf;
-			((__u16 *)mydata->fatbuf)[off16 + 1] |= val2;
+			((__u16 *)fatbuf)[off16 + 1] &= ~0xf;
+			((__u16 *)fatbuf)[off16 + 1] |= val2;
 			break;
 		case 3:
 			val1 = cpu_to_le16(entry_value) & 0xfff;
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xfff0;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 4);
+			((__u16 *)fatbuf)[off16] &= ~0xfff0;
+			((__u16 *)fatbuf)[off16] |= (val1 << 4);
 			break;
 		default:
 			break;
@@ -1060,6 +1113,10 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 
 	debug("writing %s\n", filename);
 
+	/* The cluster chains and directories may change */
+	fat_extents_invalidate();
+	fat_dentry_invalidate();
+
 	filename_copy = strdup(filename);
 	if (!filename_copy)
 		return -ENOMEM;
@@ -1195,7 +1252,7 @@ static int fat_dir_entries(fat_itr *itr)
 {
 	fat_itr *dirs;
 	fsdata fsdata = { .fatbuf = NULL, }, *mydata = &fsdata;
-						/* for FATBUFSIZE */
+						/* for FAT_CACHE_SIZE */
 	int count;
 
 	dirs = malloc_cache_aligned(sizeof(fat_itr));
@@ -1210,13 +1267,13 @@ static int fat_dir_entries(fat_itr *itr)
 	fsdata = *dirs->fsdata;
 
 	/* allocate local fat buffer */
-	fsdata.fatbuf = malloc_cache_aligned(FATBUFSIZE);
+	fsdata.fatbuf = malloc_cache_aligned(FAT_CACHE_SIZE);
 	if (!fsdata.fatbuf) {
 		debug("Error: allocating memory\n");
 		count = -ENOMEM;
 		goto exit;
 	}
-	fsdata.fatbufnum = -1;
+	fat_cache_reset(&fsdata);
 	dirs->fsdata = &fsdata;
 
 	for (count = 0; fat_itr_next(dirs); count++)
@@ -1265,6 +1322,9 @@ int fat_unlink(const char *filename)
 	int n_entries, ret;
 	char *filename_copy, *dirname, *basename;
 
+	fat_extents_invalidate();
+	fat_dentry_invalidate();
+
 	filename_copy = strdup(filename);
 	if (!filename_copy) {
 		printf("Error: allocating memory\n");
@@ -1342,6 +1402,8 @@ int fat_mkdir(const char *new_dirname)
 	unsigned int bytesperclust;
 	dir_entry *dotdent = NULL;
 
+	fat_dentry_invalidate();
+
 	dirname_copy = strdup(new_dirname);
 	if (!dirname_copy)
 		goto exit;
@@ -6,6 +6,8 @@
 #include <config.h>
 #include <errno.h>
 #include <common.h>
+#include <decomp_stream.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <part.h>
 #include <ext4fs.h>
@@ -14,6 +16,7 @@
 #include <sandboxfs.h>
 #include <ubifs_uboot.h>
 #include <btrfs.h>
+#include <squashfs.h>
 #include <asm/io.h>
 #include <div64.h>
 #include <linux/math64.h>
@@ -259,6 +262,26 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 	},
+#endif
+#ifdef CONFIG_FS_SQUASHFS
+	{
+		.fstype = FS_TYPE_SQUASHFS,
+		.name = "squashfs",
+		.null_dev_desc_ok = false,
+		.probe = sqfs_probe,
+		.close = sqfs_close,
+		.ls = fs_ls_generic,
+		.exists = sqfs_exists,
+		.size = sqfs_size,
+		.read = sqfs_read,
+		.write = fs_write_unsupported,
+		.uuid = fs_uuid_unsupported,
+		.opendir = sqfs_opendir,
+		.readdir = sqfs_readdir,
+		.closedir = sqfs_closedir,
+		.unlink = fs_unlink_unsupported,
+		.mkdir = fs_mkdir_unsupported,
+	},
 #endif
 	{
 		.fstype = FS_TYPE_ANY,
@@ -305,12 +328,96 @@ const char *fs_get_type_name(void)
 	return fs_get_info(fs_type)->name;
 }
 
-int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
+/*
+ * The filesystem last found on a few partitions. When one of them is set
+ * again its type is probed first, instead of going through fstypes[] in
+ * order. The filesystems keep their own caches for a volume that has not
+ * changed, so with this a command on a partition used before skips most
+ * of the probe and mount cost.
+ */
+#define FS_TYPE_CACHE_SIZE	8
+
+static struct {
+	struct blk_desc *desc;
+	lbaint_t start;
+	int fstype;
+} fs_type_cache[FS_TYPE_CACHE_SIZE];
+static int fs_type_cache_next;
+
+static int fs_type_cache_find(void)
+{
+	int i;
+
+	for (i = 0; i < FS_TYPE_CACHE_SIZE; i++) {
+		if (fs_dev_desc && fs_type_cache[i].desc == fs_dev_desc &&
+		    fs_type_cache[i].start == fs_partition.start)
+			return i;
+	}
+
+	return -1;
+}
+
+static void fs_type_cache_add(int fstype)
+{
+	int i;
+
+	if (!fs_dev_desc || fstype == FS_TYPE_ANY)
+		return;
+
+	i = fs_type_cache_find();
+	if (i < 0) {
+		i = fs_type_cache_next;
+		fs_type_cache_next = (i + 1) % FS_TYPE_CACHE_SIZE;
+	}
+	fs_type_cache[i].desc = fs_dev_desc;
+	fs_type_cache[i].start = fs_partition.start;
+	fs_type_cache[i].fstype = fstype;
+}
+
+/* Find the filesystem on fs_dev_desc/fs_partition */
+static int fs_probe(int fstype, int part)
 {
 	struct fstype_info *info;
-	int part, i;
+	int i, cached;
+
+	i = fs_type_cache_find();
+	if (i >= 0) {
+		cached = fs_type_cache[i].fstype;
+		info = fs_get_info(cached);
+		if ((fstype == FS_TYPE_ANY || fstype == cached) &&
+		    !info->probe(fs_dev_desc, &fs_partition)) {
+			fs_type = cached;
+			fs_dev_part = part;
+			return 0;
+		}
+	}
+
+	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
+		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
+				fstype != info->fstype)
+			continue;
+
+		if (!fs_dev_desc && !info->null_dev_desc_ok)
+			continue;
+
+		if (!info->probe(fs_dev_desc, &fs_partition)) {
+			fs_type = info->fstype;
+			fs_dev_part = part;
+			fs_type_cache_add(fs_type);
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
+{
+	int part;
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
+	struct fstype_info *info;
 	static int relocated;
+	int i;
 
 	if (!relocated) {
 		for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes);
@@ -331,29 +438,13 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	if (part < 0)
 		return -1;
 
-	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
-		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
-				fstype != info->fstype)
-			continue;
-
-		if (!fs_dev_desc && !info->null_dev_desc_ok)
-			continue;
-
-		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
-			return 0;
-		}
-	}
-
-	return -1;
+	return fs_probe(fstype, part);
 }
 
 /* set current blk device w/ blk_desc + partition # */
 int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 {
-	struct fstype_info *info;
-	int ret, i;
+	int ret;
 
 	if (part >= 1)
 		ret = part_get_info(desc, part, &fs_partition);
@@ -363,15 +454,7 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 		return ret;
 	fs_dev_desc = desc;
 
-	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
-		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
-			return 0;
-		}
-	}
-
-	return -1;
+	return fs_probe(FS_TYPE_ANY, part);
 }
 
 static void fs_close(void)
@@ -522,6 +605,86 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	return ret;
 }
 
+struct fs_file {
+	struct blk_desc *desc;
+	int part;
+	disk_partition_t partition;
+	int fstype;
+	loff_t size;
+	char *name;
+};
+
+struct fs_file *fs_file_open(const char *filename)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+	struct fs_file *file;
+	int ret;
+
+	file = calloc(1, sizeof(*file));
+	if (file)
+		file->name = strdup(filename);
+	if (!file || !file->name) {
+		free(file);
+		fs_close();
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	ret = info->size(filename, &file->size);
+	if (ret) {
+		free(file->name);
+		free(file);
+		fs_close();
+		errno = ENOENT;
+		return NULL;
+	}
+
+	file->desc = fs_dev_desc;
+	file->part = fs_dev_part;
+	file->partition = fs_partition;
+	file->fstype = fs_type;
+	fs_close();
+
+	return file;
+}
+
+loff_t fs_file_size(struct fs_file *file)
+{
+	return file->size;
+}
+
+int fs_file_read(struct fs_file *file, ulong addr, loff_t offset, loff_t len,
+		 loff_t *actread)
+{
+	struct fstype_info *info = fs_get_info(file->fstype);
+	void *buf;
+	int ret;
+
+	/* The partition and the filesystem type are known already */
+	fs_dev_desc = file->desc;
+	fs_partition = file->partition;
+	if (info->probe(fs_dev_desc, &fs_partition))
+		return -ENODEV;
+	fs_type = file->fstype;
+	fs_dev_part = file->part;
+
+	buf = map_sysmem(addr, len);
+	ret = info->read(file->name, buf, offset, len, actread);
+	unmap_sysmem(buf);
+	fs_close();
+
+	return ret;
+}
+
+void fs_file_close(struct fs_file *file)
+{
+	if (!file)
+		return;
+
+	free(file->name);
+	free(file);
+}
+
 struct fs_dir_stream *fs_opendir(const char *filename)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
@@ -621,6 +784,87 @@ int do_size(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	return 0;
 }
 
+#ifdef CONFIG_DECOMP_STREAM
+/* Size of the pieces load -z reads a compressed file in */
+#define FS_DECOMP_CHUNK		(1 << 20)
+
+/*
+ * Read a compressed file from @offset, decompressing each piece to @addr
+ * as soon as it is read. At most @maxlen bytes are written, or if 0, as
+ * many as there is free memory for at @addr.
+ */
+static int fs_read_decomp(const char *filename, ulong addr, loff_t offset,
+			  loff_t maxlen, loff_t *actread)
+{
+	struct decomp_stream *ds;
+	struct fs_file *file;
+	loff_t size, pos, got;
+	size_t outlen;
+	void *buf, *dst;
+	int ret, err;
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t avail;
+#endif
+
+	*actread = 0;
+	file = fs_file_open(filename);
+	if (!file)
+		return -ENOENT;
+	size = fs_file_size(file);
+
+#ifdef CONFIG_LMB
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+	avail = lmb_get_free_size(&lmb, addr);
+	if (!avail) {
+		printf("** Reading file would overwrite reserved memory **\n");
+		fs_file_close(file);
+		return -ENOSPC;
+	}
+	if (!maxlen || maxlen > avail)
+		maxlen = avail;
+#endif
+	if (!maxlen) {
+		printf("** Give the largest size the file may decompress to **\n");
+		fs_file_close(file);
+		return -EINVAL;
+	}
+
+	buf = memalign(ARCH_DMA_MINALIGN, FS_DECOMP_CHUNK);
+	dst = map_sysmem(addr, maxlen);
+	ds = decomp_stream_start(dst, maxlen);
+	ret = buf && ds ? 0 : -ENOMEM;
+
+	for (pos = offset; !ret && pos < size; pos += got) {
+		ret = fs_file_read(file, map_to_sysmem(buf), pos,
+				   min_t(loff_t, size - pos, FS_DECOMP_CHUNK),
+				   &got);
+		if (!ret && !got)
+			ret = -EIO;
+		if (!ret)
+			ret = decomp_stream_feed(ds, buf, got);
+	}
+
+	if (ds) {
+		err = decomp_stream_end(ds, &outlen);
+		if (!ret)
+			ret = err;
+		*actread = outlen;
+	}
+	if (ret == -ENOSPC || ret == -ENOBUFS)
+		printf("** %s decompresses to more than %llu bytes **\n",
+		       filename, maxlen);
+	else if (ret)
+		printf("** Unable to decompress %s: %d **\n", filename, ret);
+
+	unmap_sysmem(dst);
+	free(buf);
+	fs_file_close(file);
+
+	return ret;
+}
+#endif
+
 int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype)
 {
@@ -633,7 +877,15 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	int ret;
 	unsigned long time;
 	char *ep;
+	bool decomp = false;
 
+#ifdef CONFIG_DECOMP_STREAM
+	if (argc >= 2 && !strcmp(argv[1], "-z")) {
+		decomp = true;
+		argc--;
+		argv++;
+	}
+#endif
 	if (argc < 2)
 		return CMD_RET_USAGE;
 	if (argc > 7)
@@ -672,7 +924,12 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		pos = 0;
 
 	time = get_timer(0);
-	ret = _fs_read(filename, addr, pos, bytes, 1, &len_read);
+#ifdef CONFIG_DECOMP_STREAM
+	if (decomp)
+		ret = fs_read_decomp(filename, addr, pos, bytes, &len_read);
+	else
+#endif
+		ret = _fs_read(filename, addr, pos, bytes, 1, &len_read);
 	time = get_timer(time);
 	if (ret < 0)
 		return 1;
@@ -7,9 +7,44 @@
 
 #include <common.h>
 #include <compiler.h>
+#include <errno.h>
+#include <fs_internal.h>
 #include <part.h>
 #include <memalign.h>
 
+int fs_devread_blocks(struct blk_desc *blk, lbaint_t start, lbaint_t blkcnt,
+		      void *buf)
+{
+	ulong misalign = (ulong)buf & (ARCH_DMA_MINALIGN - 1);
+	ALLOC_CACHE_ALIGN_BUFFER(char, sec_buf, blk->blksz);
+	size_t len;
+	char *dst;
+
+	if (!misalign || blk->blksz < ARCH_DMA_MINALIGN) {
+		if (blk_dread(blk, start, blkcnt, buf) != blkcnt)
+			return -EIO;
+		return 0;
+	}
+
+	/*
+	 * Read all but the last block to the first aligned address in @buf
+	 * and move them down. The last block would not fit there, so read it
+	 * through an aligned sector buffer.
+	 */
+	len = (size_t)(blkcnt - 1) << blk->log2blksz;
+	if (blkcnt > 1) {
+		dst = buf + ARCH_DMA_MINALIGN - misalign;
+		if (blk_dread(blk, start, blkcnt - 1, dst) != blkcnt - 1)
+			return -EIO;
+		memmove(buf, dst, len);
+	}
+	if (blk_dread(blk, start + blkcnt - 1, 1, sec_buf) != 1)
+		return -EIO;
+	memcpy(buf + len, sec_buf, blk->blksz);
+
+	return 0;
+}
+
 int fs_devread(struct blk_desc *blk, disk_partition_t *partition,
 	       lbaint_t sector, int byte_offset, int byte_len, char *buf)
 {
@@ -68,9 +103,8 @@ int fs_devread(struct blk_desc *blk, disk_partition_t *partition,
 		return 1;
 	}
 
-	if (blk_dread(blk, partition->start + sector,
-		      block_len >> log2blksz, (void *)buf) !=
-			block_len >> log2blksz) {
+	if (fs_devread_blocks(blk, partition->start + sector,
+			      block_len >> log2blksz, buf)) {
 		printf(" ** %s read error - block\n", __func__);
 		return 0;
 	}
@@ -637,17 +637,55 @@ static int compare_dirents(struct b_node *new, struct b_node *old)
 }
 #endif
 
+/*
+ * Scanned lists of every partition seen so far. They are kept here rather
+ * than only in the part_info, which mtdparts frees and re-creates whenever
+ * the partition table is re-parsed, so that a partition keeps its lists
+ * as long as it covers the same flash area.
+ */
+static struct b_lists *jffs2_caches;
+
+static int
+jffs2_cache_matches(struct b_lists *pL, struct part_info *part)
+{
+	return pL->dev_type == part->dev->id->type &&
+	       pL->dev_num == part->dev->id->num &&
+	       pL->offset == part->offset && pL->size == part->size;
+}
+
+static struct b_lists *
+jffs2_find_cache(struct part_info *part)
+{
+	struct b_lists *pL;
+
+	for (pL = jffs2_caches; pL; pL = pL->next)
+		if (jffs2_cache_matches(pL, part))
+			return pL;
+
+	return NULL;
+}
+
 void
 jffs2_free_cache(struct part_info *part)
 {
-	struct b_lists *pL;
+	struct b_lists *pL, **pp;
+
+	if (part->jffs2_priv == NULL)
+		part->jffs2_priv = jffs2_find_cache(part);
 
 	if (part->jffs2_priv != NULL) {
 		pL = (struct b_lists *)part->jffs2_priv;
+		for (pp = &jffs2_caches; *pp; pp = &(*pp)->next) {
+			if (*pp == pL) {
+				*pp = pL->next;
+				break;
+			}
+		}
 		free_nodes(&pL->frag);
 		free_nodes(&pL->dir);
 		free(pL->readbuf);
 		free(pL);
+		part->jffs2_priv = NULL;
 	}
 }
 
@@ -666,6 +704,12 @@ jffs_init_1pass_list(struct part_info *part)
 		pL->dir.listCompare = compare_dirents;
 		pL->frag.listCompare = compare_inodes;
 #endif
+		pL->dev_type = part->dev->id->type;
+		pL->dev_num = part->dev->id->num;
+		pL->offset = part->offset;
+		pL->size = part->size;
+		pL->next = jffs2_caches;
+		jffs2_caches = pL;
 	}
 	return 0;
 }
@@ -1466,6 +1510,31 @@ static inline uint32_t EMPTY_SCAN_SIZE(uint32_t sector_size)
 		return DEFAULT_EMPTY_SCAN_SIZE;
 }
 
+/*
+ * JFFS2 only ever appends to an eraseblock, so once a run of 0xFF words
+ * has been found after the last node the rest of the block is normally
+ * erased too. Rather than reading it all word by word, check one word
+ * every EMPTY_SCAN_SIZE bytes plus the last one. If any of them is not
+ * erased, the caller goes on with the full scan.
+ */
+static int
+jffs2_sector_tail_erased(struct part_info *part, u32 ofs, u32 end)
+{
+	u32 word, *p;
+
+	ofs = ALIGN(ofs, 4);
+	for (; ofs < end; ofs += EMPTY_SCAN_SIZE(part->sector_size)) {
+		p = get_fl_mem((u32)part->offset + ofs, sizeof(word), &word);
+		if (*p != 0xffffffff)
+			return 0;
+	}
+
+	p = get_fl_mem((u32)part->offset + end - sizeof(word), sizeof(word),
+		       &word);
+
+	return *p == 0xffffffff;
+}
+
 static u32
 jffs2_1pass_build_lists(struct part_info * part)
 {
@@ -1634,9 +1703,12 @@ jffs2_1pass_build_lists(struct part_info * part)
 				 * If this sector had a clean marker at the
 				 * beginning, and immediately following this
 				 * have been a bunch of FF bytes, treat the
-				 * entire sector as empty.
+				 * entire sector as empty. Otherwise sample
+				 * the rest of the sector before scanning it.
 				 */
-				if (clean_sector)
+				if (clean_sector ||
+				    jffs2_sector_tail_erased(part, ofs,
+						sector_ofs + part->sector_size))
 					break;
 
 				/* See how much more there is to read in this
@@ -1851,6 +1923,10 @@ jffs2_get_list(struct part_info * part, const char *who)
 	/* copy requested part_info struct pointer to global location */
 	current_part = part;
 
+	/* Reuse the lists of a previous part_info for the same area */
+	if (!part->jffs2_priv)
+		part->jffs2_priv = jffs2_find_cache(part);
+
 	if (jffs2_1pass_rescan_needed(part)) {
 		if (!jffs2_1pass_build_lists(part)) {
 			printf("%s: Failed to scan JFFSv2 file structure\n", who);
@@ -26,6 +26,12 @@ struct b_lists {
 	struct b_list dir;
 	struct b_list frag;
 	void *readbuf;
+	/* partition the lists were built for, see jffs2_find_cache() */
+	struct b_lists *next;
+	u8 dev_type;
+	u8 dev_num;
+	u64 offset;
+	u64 size;
 };
 
 struct b_compr_info {
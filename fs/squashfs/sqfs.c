@@ -0,0 +1,988 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Read-only SquashFS 4.0 support
+ *
+ * The on-disk format follows the Linux kernel, fs/squashfs/squashfs_fs.h.
+ * Inodes and directories are stored in compressed metadata blocks of up
+ * to 8 KiB, file data in blocks of block_size, and the ends of files
+ * packed together into fragment blocks. Decompressed metadata blocks and
+ * fragment blocks are cached, as both are typically used many times in a
+ * row: by every entry of a directory, by every file of a fragment.
+ */
+
+#include <common.h>
+#include <fs.h>
+#include <fs_internal.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <part.h>
+#include <squashfs.h>
+#include <linux/lzo.h>
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+#include <lzma/LzmaTools.h>
+
+#define SQFS_MAGIC		0x73717368
+#define SQFS_MAJOR		4
+
+#define SQFS_COMP_ZLIB		1
+#define SQFS_COMP_LZMA		2
+#define SQFS_COMP_LZO		3
+#define SQFS_COMP_XZ		4
+#define SQFS_COMP_LZ4		5
+
+#define SQFS_META_SIZE		8192
+#define SQFS_META_UNCOMPRESSED	0x8000
+#define SQFS_DATA_UNCOMPRESSED	(1 << 24)
+#define SQFS_INVALID_FRAG	0xffffffff
+#define SQFS_FRAGS_PER_BLOCK	(SQFS_META_SIZE / \
+				 sizeof(struct sqfs_fragment_entry))
+
+#define SQFS_DIR_TYPE		1
+#define SQFS_REG_TYPE		2
+#define SQFS_SYMLINK_TYPE	3
+#define SQFS_LDIR_TYPE		8
+#define SQFS_LREG_TYPE		9
+#define SQFS_LSYMLINK_TYPE	10
+
+#define SQFS_NAME_LEN		256
+#define SQFS_PATH_MAX		1024
+#define SQFS_MAX_DEPTH		64
+#define SQFS_MAX_SYMLINKS	8
+
+/* Decompressed metadata and fragment blocks kept */
+#define SQFS_META_CACHE		8
+#define SQFS_FRAG_CACHE		3
+
+struct sqfs_super_block {
+	__le32 s_magic;
+	__le32 inodes;
+	__le32 mkfs_time;
+	__le32 block_size;
+	__le32 fragments;
+	__le16 compression;
+	__le16 block_log;
+	__le16 flags;
+	__le16 no_ids;
+	__le16 s_major;
+	__le16 s_minor;
+	__le64 root_inode;
+	__le64 bytes_used;
+	__le64 id_table_start;
+	__le64 xattr_id_table_start;
+	__le64 inode_table_start;
+	__le64 directory_table_start;
+	__le64 fragment_table_start;
+	__le64 lookup_table_start;
+} __packed;
+
+struct sqfs_base_inode {
+	__le16 inode_type;
+	__le16 mode;
+	__le16 uid;
+	__le16 guid;
+	__le32 mtime;
+	__le32 inode_number;
+} __packed;
+
+struct sqfs_reg_inode {
+	__le32 start_block;
+	__le32 fragment;
+	__le32 offset;
+	__le32 file_size;
+	/* followed by the block size list */
+} __packed;
+
+struct sqfs_lreg_inode {
+	__le64 start_block;
+	__le64 file_size;
+	__le64 sparse;
+	__le32 nlink;
+	__le32 fragment;
+	__le32 offset;
+	__le32 xattr;
+	/* followed by the block size list */
+} __packed;
+
+struct sqfs_dir_inode {
+	__le32 start_block;
+	__le32 nlink;
+	__le16 file_size;
+	__le16 offset;
+	__le32 parent_inode;
+} __packed;
+
+struct sqfs_ldir_inode {
+	__le32 nlink;
+	__le32 file_size;
+	__le32 start_block;
+	__le32 parent_inode;
+	__le16 i_count;
+	__le16 offset;
+	__le32 xattr;
+	/* followed by the directory index */
+} __packed;
+
+struct sqfs_symlink_inode {
+	__le32 nlink;
+	__le32 symlink_size;
+	/* followed by the target */
+} __packed;
+
+struct sqfs_dir_header {
+	__le32 count;
+	__le32 start_block;
+	__le32 inode_number;
+} __packed;
+
+struct sqfs_dir_entry {
+	__le16 offset;
+	__le16 inode_number;
+	__le16 type;
+	__le16 size;
+	/* followed by the name */
+} __packed;
+
+struct sqfs_fragment_entry {
+	__le64 start_block;
+	__le32 size;
+	__le32 unused;
+} __packed;
+
+/* An inode, decoded */
+struct sqfs_inode {
+	u16 type;
+	u64 size;
+	/* regular files */
+	u64 start;		/* disk offset of the first data block */
+	u32 frag;		/* fragment holding the tail */
+	u32 frag_off;		/* offset of the tail in the fragment */
+	u64 blist_block;	/* the block size list */
+	u32 blist_off;
+	/* directories */
+	u32 dir_block;
+	u16 dir_off;
+	/* symlinks */
+	u64 link_block;
+	u32 link_off;
+};
+
+struct sqfs_dir_iter {
+	u64 block;		/* position in the directory table */
+	u32 off;
+	u32 remaining;		/* bytes of the listing left */
+	u32 entries;		/* entries left under the current header */
+	u32 inode_block;	/* metadata block of their inodes */
+};
+
+struct sqfs_dir_stream {
+	struct fs_dir_stream parent;
+	struct fs_dirent dirent;
+	struct sqfs_dir_iter it;
+};
+
+struct sqfs_meta {
+	bool valid;
+	u32 used;		/* LRU clock */
+	u64 start;		/* disk offset of the block */
+	u64 next;		/* and of the one after it */
+	u32 len;
+	char data[SQFS_META_SIZE];
+};
+
+struct sqfs_frag {
+	bool valid;
+	u32 used;
+	u32 index;
+	u32 len;
+	char *data;
+};
+
+static struct {
+	struct blk_desc *dev;
+	disk_partition_t part;
+	struct sqfs_super_block sb;
+	u32 block_size;
+	u16 block_log;
+	u16 comp;
+	u32 fragments;
+	u64 *frag_index;	/* disk offsets of the fragment table blocks */
+	char *cbuf;		/* compressed data */
+	char *dbuf;		/* partially read data blocks */
+	struct sqfs_meta *meta;
+	struct sqfs_frag frag[SQFS_FRAG_CACHE];
+	u32 clock;
+} sqfs;
+
+static int sqfs_disk_read(u64 off, u32 len, void *buf)
+{
+	lbaint_t sector = off >> sqfs.dev->log2blksz;
+	int byte_off = off & (sqfs.dev->blksz - 1);
+
+	if (!fs_devread(sqfs.dev, &sqfs.part, sector, byte_off, len, buf))
+		return -EIO;
+
+	return 0;
+}
+
+static int sqfs_decompress(void *dst, u32 *dstlen, void *src, u32 srclen)
+{
+	switch (sqfs.comp) {
+	case SQFS_COMP_ZLIB: {
+		unsigned long len = srclen;
+
+		/* zunzip() wants raw deflate, skip the zlib header */
+		if (zunzip(dst, *dstlen, src, &len, 1, 2))
+			return -EIO;
+		*dstlen = len;
+		return 0;
+	}
+#ifdef CONFIG_LZMA
+	case SQFS_COMP_LZMA: {
+		SizeT len = *dstlen;
+
+		if (lzmaBuffToBuffDecompress(dst, &len, src, srclen))
+			return -EIO;
+		*dstlen = len;
+		return 0;
+	}
+#endif
+#ifdef CONFIG_LZO
+	case SQFS_COMP_LZO: {
+		size_t len = *dstlen;
+
+		if (lzo1x_decompress_safe(src, srclen, dst, &len) != LZO_E_OK)
+			return -EIO;
+		*dstlen = len;
+		return 0;
+	}
+#endif
+#ifdef CONFIG_LZ4
+	case SQFS_COMP_LZ4: {
+		size_t len = *dstlen;
+
+		if (ulz4_block(src, srclen, dst, &len))
+			return -EIO;
+		*dstlen = len;
+		return 0;
+	}
+#endif
+	default:
+		return -EPROTONOSUPPORT;
+	}
+}
+
+static bool sqfs_comp_supported(u16 comp)
+{
+	switch (comp) {
+	case SQFS_COMP_ZLIB:
+		return true;
+	case SQFS_COMP_LZMA:
+		return IS_ENABLED(CONFIG_LZMA);
+	case SQFS_COMP_LZO:
+		return IS_ENABLED(CONFIG_LZO);
+	case SQFS_COMP_LZ4:
+		return IS_ENABLED(CONFIG_LZ4);
+	default:
+		return false;
+	}
+}
+
+static struct sqfs_meta *sqfs_get_meta(u64 start)
+{
+	struct sqfs_meta *m, *victim = NULL;
+	__le16 hdr;
+	u32 len;
+	int i;
+
+	for (i = 0; i < SQFS_META_CACHE; i++) {
+		m = &sqfs.meta[i];
+		if (m->valid && m->start == start) {
+			m->used = ++sqfs.clock;
+			return m;
+		}
+		if (!victim || !m->valid ||
+		    (victim->valid && m->used < victim->used))
+			victim = m;
+	}
+
+	victim->valid = false;
+	if (sqfs_disk_read(start, sizeof(hdr), &hdr))
+		return NULL;
+	len = le16_to_cpu(hdr) & ~SQFS_META_UNCOMPRESSED;
+	if (!len || len > SQFS_META_SIZE) {
+		debug("squashfs: bad metadata block at %llx\n", start);
+		return NULL;
+	}
+
+	if (le16_to_cpu(hdr) & SQFS_META_UNCOMPRESSED) {
+		if (sqfs_disk_read(start + sizeof(hdr), len, victim->data))
+			return NULL;
+		victim->len = len;
+	} else {
+		victim->len = SQFS_META_SIZE;
+		if (sqfs_disk_read(start + sizeof(hdr), len, sqfs.cbuf) ||
+		    sqfs_decompress(victim->data, &victim->len, sqfs.cbuf,
+				    len))
+			return NULL;
+	}
+
+	victim->start = start;
+	victim->next = start + sizeof(hdr) + len;
+	victim->used = ++sqfs.clock;
+	victim->valid = true;
+
+	return victim;
+}
+
+/* Read metadata from *block, *off on, and move them past it */
+static int sqfs_read_meta(u64 *block, u32 *off, void *buf, u32 len)
+{
+	struct sqfs_meta *m;
+	u32 n;
+
+	while (len) {
+		m = sqfs_get_meta(*block);
+		if (!m || *off >= m->len)
+			return -EIO;
+
+		n = min(len, m->len - *off);
+		memcpy(buf, m->data + *off, n);
+		buf += n;
+		len -= n;
+		*off += n;
+		if (*off == m->len) {
+			*block = m->next;
+			*off = 0;
+		}
+	}
+
+	return 0;
+}
+
+static int sqfs_read_inode(u64 ref, struct sqfs_inode *inode)
+{
+	u64 block = le64_to_cpu(sqfs.sb.inode_table_start) + (ref >> 16);
+	u32 off = ref & 0xffff;
+	struct sqfs_base_inode base;
+	int ret;
+
+	ret = sqfs_read_meta(&block, &off, &base, sizeof(base));
+	if (ret)
+		return ret;
+
+	memset(inode, 0, sizeof(*inode));
+	inode->type = le16_to_cpu(base.inode_type);
+	inode->frag = SQFS_INVALID_FRAG;
+
+	switch (inode->type) {
+	case SQFS_REG_TYPE: {
+		struct sqfs_reg_inode reg;
+
+		ret = sqfs_read_meta(&block, &off, &reg, sizeof(reg));
+		inode->size = le32_to_cpu(reg.file_size);
+		inode->start = le32_to_cpu(reg.start_block);
+		inode->frag = le32_to_cpu(reg.fragment);
+		inode->frag_off = le32_to_cpu(reg.offset);
+		break;
+	}
+	case SQFS_LREG_TYPE: {
+		struct sqfs_lreg_inode lreg;
+
+		ret = sqfs_read_meta(&block, &off, &lreg, sizeof(lreg));
+		inode->size = le64_to_cpu(lreg.file_size);
+		inode->start = le64_to_cpu(lreg.start_block);
+		inode->frag = le32_to_cpu(lreg.fragment);
+		inode->frag_off = le32_to_cpu(lreg.offset);
+		break;
+	}
+	case SQFS_DIR_TYPE: {
+		struct sqfs_dir_inode dir;
+
+		ret = sqfs_read_meta(&block, &off, &dir, sizeof(dir));
+		inode->size = le16_to_cpu(dir.file_size);
+		inode->dir_block = le32_to_cpu(dir.start_block);
+		inode->dir_off = le16_to_cpu(dir.offset);
+		break;
+	}
+	case SQFS_LDIR_TYPE: {
+		struct sqfs_ldir_inode ldir;
+
+		ret = sqfs_read_meta(&block, &off, &ldir, sizeof(ldir));
+		inode->size = le32_to_cpu(ldir.file_size);
+		inode->dir_block = le32_to_cpu(ldir.start_block);
+		inode->dir_off = le16_to_cpu(ldir.offset);
+		inode->type = SQFS_DIR_TYPE;
+		break;
+	}
+	case SQFS_SYMLINK_TYPE:
+	case SQFS_LSYMLINK_TYPE: {
+		struct sqfs_symlink_inode link;
+
+		ret = sqfs_read_meta(&block, &off, &link, sizeof(link));
+		inode->size = le32_to_cpu(link.symlink_size);
+		inode->type = SQFS_SYMLINK_TYPE;
+		break;
+	}
+	default:
+		/* devices, fifos and sockets have nothing to read */
+		break;
+	}
+
+	/* What follows: the block size list or the symlink target */
+	inode->blist_block = block;
+	inode->blist_off = off;
+	inode->link_block = block;
+	inode->link_off = off;
+
+	if (inode->type == SQFS_LREG_TYPE)
+		inode->type = SQFS_REG_TYPE;
+
+	return ret;
+}
+
+static void sqfs_dir_open(struct sqfs_inode *dir, struct sqfs_dir_iter *it)
+{
+	it->block = le64_to_cpu(sqfs.sb.directory_table_start) +
+		    dir->dir_block;
+	it->off = dir->dir_off;
+	/* the size counts 3 bytes for "." and "..", which are not stored */
+	it->remaining = dir->size > 3 ? dir->size - 3 : 0;
+	it->entries = 0;
+}
+
+/* Return 1 with the next entry, 0 at the end of the directory */
+static int sqfs_dir_next(struct sqfs_dir_iter *it, char *name, u64 *ref,
+			 u16 *type)
+{
+	struct sqfs_dir_entry entry;
+	u32 len;
+	int ret;
+
+	if (!it->entries) {
+		struct sqfs_dir_header hdr;
+
+		if (it->remaining < sizeof(hdr))
+			return 0;
+		ret = sqfs_read_meta(&it->block, &it->off, &hdr, sizeof(hdr));
+		if (ret)
+			return ret;
+		it->remaining -= sizeof(hdr);
+		it->entries = le32_to_cpu(hdr.count) + 1;
+		it->inode_block = le32_to_cpu(hdr.start_block);
+	}
+
+	if (it->remaining < sizeof(entry))
+		return 0;
+	ret = sqfs_read_meta(&it->block, &it->off, &entry, sizeof(entry));
+	if (ret)
+		return ret;
+	it->remaining -= sizeof(entry);
+
+	len = le16_to_cpu(entry.size) + 1;
+	if (len >= SQFS_NAME_LEN || len > it->remaining)
+		return -EIO;
+	ret = sqfs_read_meta(&it->block, &it->off, name, len);
+	if (ret)
+		return ret;
+	it->remaining -= len;
+	name[len] = '\0';
+
+	*ref = ((u64)it->inode_block << 16) | le16_to_cpu(entry.offset);
+	*type = le16_to_cpu(entry.type);
+	it->entries--;
+
+	return 1;
+}
+
+static int sqfs_dir_find(struct sqfs_inode *dir, const char *name, int len,
+			 u64 *ref)
+{
+	char entry[SQFS_NAME_LEN];
+	struct sqfs_dir_iter it;
+	u16 type;
+	int ret;
+
+	sqfs_dir_open(dir, &it);
+	while ((ret = sqfs_dir_next(&it, entry, ref, &type)) == 1) {
+		if (!strncmp(entry, name, len) && !entry[len])
+			return 0;
+	}
+
+	return ret ? ret : -ENOENT;
+}
+
+/*
+ * Resolve a path to its inode, following symlinks. When one is met the
+ * path is rewritten with its target and walked again from the root, so
+ * ".." in a target goes back through the directories walked.
+ */
+static int sqfs_lookup(const char *path, struct sqfs_inode *inode)
+{
+	u64 stack[SQFS_MAX_DEPTH];
+	char *work, *next, *p, *q;
+	int depth, links = 0;
+	int ret, len;
+
+	work = malloc(SQFS_PATH_MAX);
+	next = malloc(SQFS_PATH_MAX);
+	if (!work || !next) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	strlcpy(work, path, SQFS_PATH_MAX);
+
+restart:
+	depth = 0;
+	stack[0] = le64_to_cpu(sqfs.sb.root_inode);
+	ret = sqfs_read_inode(stack[0], inode);
+	if (ret)
+		goto out;
+
+	for (p = work; *p; p = q) {
+		if (*p == '/') {
+			q = p + 1;
+			continue;
+		}
+		q = (char *)strchrnul(p, '/');
+		len = q - p;
+
+		if (len == 1 && p[0] == '.')
+			continue;
+		if (len == 2 && p[0] == '.' && p[1] == '.') {
+			if (depth)
+				depth--;
+			ret = sqfs_read_inode(stack[depth], inode);
+			if (ret)
+				goto out;
+			continue;
+		}
+
+		if (inode->type != SQFS_DIR_TYPE) {
+			ret = -ENOTDIR;
+			goto out;
+		}
+		if (depth + 1 >= ARRAY_SIZE(stack)) {
+			ret = -ENAMETOOLONG;
+			goto out;
+		}
+		ret = sqfs_dir_find(inode, p, len, &stack[depth + 1]);
+		if (ret)
+			goto out;
+		ret = sqfs_read_inode(stack[++depth], inode);
+		if (ret)
+			goto out;
+
+		if (inode->type != SQFS_SYMLINK_TYPE)
+			continue;
+
+		/* Replace the link in the path by its target */
+		if (++links > SQFS_MAX_SYMLINKS || inode->size == 0 ||
+		    inode->size >= SQFS_PATH_MAX) {
+			ret = -ELOOP;
+			goto out;
+		}
+		ret = sqfs_read_meta(&inode->link_block, &inode->link_off,
+				     next, inode->size);
+		if (ret)
+			goto out;
+		next[inode->size] = '\0';
+		if (next[0] == '/')
+			len = 0;
+		else
+			len = p - work;
+		if (len + strlen(next) + strlen(q) + 1 >= SQFS_PATH_MAX) {
+			ret = -ENAMETOOLONG;
+			goto out;
+		}
+		memmove(next + len, next, strlen(next) + 1);
+		memcpy(next, work, len);
+		strcat(next, "/");
+		strcat(next, q);
+		strcpy(work, next);
+		goto restart;
+	}
+	ret = 0;
+
+out:
+	free(work);
+	free(next);
+
+	return ret;
+}
+
+static struct sqfs_frag *sqfs_get_frag(u32 index)
+{
+	struct sqfs_fragment_entry entry;
+	struct sqfs_frag *f, *victim = NULL;
+	u64 block, start;
+	u32 off, size;
+	int i;
+
+	if (index >= sqfs.fragments)
+		return NULL;
+
+	for (i = 0; i < SQFS_FRAG_CACHE; i++) {
+		f = &sqfs.frag[i];
+		if (f->valid && f->index == index) {
+			f->used = ++sqfs.clock;
+			return f;
+		}
+		if (!victim || !f->valid ||
+		    (victim->valid && f->used < victim->used))
+			victim = f;
+	}
+
+	victim->valid = false;
+	if (!victim->data) {
+		victim->data = malloc_cache_aligned(sqfs.block_size);
+		if (!victim->data)
+			return NULL;
+	}
+
+	block = sqfs.frag_index[index / SQFS_FRAGS_PER_BLOCK];
+	off = (index % SQFS_FRAGS_PER_BLOCK) * sizeof(entry);
+	if (sqfs_read_meta(&block, &off, &entry, sizeof(entry)))
+		return NULL;
+	start = le64_to_cpu(entry.start_block);
+	size = le32_to_cpu(entry.size) & ~SQFS_DATA_UNCOMPRESSED;
+	if (size > sqfs.block_size)
+		return NULL;
+
+	if (le32_to_cpu(entry.size) & SQFS_DATA_UNCOMPRESSED) {
+		if (sqfs_disk_read(start, size, victim->data))
+			return NULL;
+		victim->len = size;
+	} else {
+		victim->len = sqfs.block_size;
+		if (sqfs_disk_read(start, size, sqfs.cbuf) ||
+		    sqfs_decompress(victim->data, &victim->len, sqfs.cbuf,
+				    size))
+			return NULL;
+	}
+
+	victim->index = index;
+	victim->used = ++sqfs.clock;
+	victim->valid = true;
+
+	return victim;
+}
+
+/* Read one data block of a file, or the part of it wanted */
+static int sqfs_read_block(u64 pos, u32 bsize, u32 blen, u32 from, u32 n,
+			   char *buf)
+{
+	u32 csize = bsize & ~SQFS_DATA_UNCOMPRESSED;
+	u32 len;
+	int ret;
+
+	if (!csize) {
+		/* sparse */
+		memset(buf, 0, n);
+		return 0;
+	}
+	if (bsize & SQFS_DATA_UNCOMPRESSED)
+		return sqfs_disk_read(pos + from, n, buf);
+	if (csize > sqfs.block_size)
+		return -EIO;
+
+	ret = sqfs_disk_read(pos, csize, sqfs.cbuf);
+	if (ret)
+		return ret;
+
+	/* A whole block goes straight to the caller's buffer */
+	if (!from && n == blen) {
+		len = blen;
+		ret = sqfs_decompress(buf, &len, sqfs.cbuf, csize);
+		return ret ? ret : (len == blen ? 0 : -EIO);
+	}
+
+	len = sqfs.block_size;
+	ret = sqfs_decompress(sqfs.dbuf, &len, sqfs.cbuf, csize);
+	if (ret)
+		return ret;
+	if (from + n > len)
+		return -EIO;
+	memcpy(buf, sqfs.dbuf + from, n);
+
+	return 0;
+}
+
+static int sqfs_read_data(struct sqfs_inode *inode, char *buf, loff_t offset,
+			  loff_t len)
+{
+	u64 end = offset + len;
+	u64 nblocks, i, bstart, pos;
+	__le32 sizes[64];
+	u32 bsize, blen, from, n;
+	u64 block = inode->blist_block;
+	u32 off = inode->blist_off;
+	int ret;
+
+	if (inode->frag == SQFS_INVALID_FRAG)
+		nblocks = DIV_ROUND_UP(inode->size, sqfs.block_size);
+	else
+		nblocks = inode->size >> sqfs.block_log;
+
+	/* Only blocks read in part go through here */
+	if (!sqfs.dbuf) {
+		sqfs.dbuf = malloc_cache_aligned(sqfs.block_size);
+		if (!sqfs.dbuf)
+			return -ENOMEM;
+	}
+
+	pos = inode->start;
+	for (i = 0; i < nblocks; i++) {
+		bstart = i << sqfs.block_log;
+		if (bstart >= end)
+			return 0;
+
+		if (!(i % ARRAY_SIZE(sizes))) {
+			n = min_t(u64, ARRAY_SIZE(sizes), nblocks - i);
+			ret = sqfs_read_meta(&block, &off, sizes,
+					     n * sizeof(sizes[0]));
+			if (ret)
+				return ret;
+		}
+		bsize = le32_to_cpu(sizes[i % ARRAY_SIZE(sizes)]);
+		blen = min_t(u64, sqfs.block_size, inode->size - bstart);
+
+		if (bstart + blen > offset) {
+			from = offset > bstart ? offset - bstart : 0;
+			n = min_t(u64, blen - from, end - bstart - from);
+			ret = sqfs_read_block(pos, bsize, blen, from, n,
+					      buf + bstart + from - offset);
+			if (ret)
+				return ret;
+		}
+		pos += bsize & ~SQFS_DATA_UNCOMPRESSED;
+	}
+
+	/* The tail, from a fragment */
+	bstart = nblocks << sqfs.block_log;
+	if (inode->frag != SQFS_INVALID_FRAG && bstart < end) {
+		struct sqfs_frag *f = sqfs_get_frag(inode->frag);
+
+		blen = inode->size - bstart;
+		if (!f || inode->frag_off + blen > f->len)
+			return -EIO;
+		from = offset > bstart ? offset - bstart : 0;
+		n = min_t(u64, blen - from, end - bstart - from);
+		memcpy(buf + bstart + from - offset,
+		       f->data + inode->frag_off + from, n);
+	}
+
+	return 0;
+}
+
+static void sqfs_drop_caches(void)
+{
+	int i;
+
+	for (i = 0; sqfs.meta && i < SQFS_META_CACHE; i++)
+		sqfs.meta[i].valid = false;
+	for (i = 0; i < SQFS_FRAG_CACHE; i++) {
+		free(sqfs.frag[i].data);
+		sqfs.frag[i].data = NULL;
+		sqfs.frag[i].valid = false;
+	}
+	free(sqfs.frag_index);
+	sqfs.frag_index = NULL;
+	free(sqfs.cbuf);
+	sqfs.cbuf = NULL;
+	free(sqfs.dbuf);
+	sqfs.dbuf = NULL;
+}
+
+int sqfs_probe(struct blk_desc *fs_dev_desc, disk_partition_t *fs_partition)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct sqfs_super_block, sb, 1);
+	struct blk_desc *old_dev = sqfs.dev;
+	disk_partition_t old_part = sqfs.part;
+	u32 nindex, i;
+	bool same;
+	u16 comp;
+
+	same = sqfs.cbuf && old_dev == fs_dev_desc &&
+	       old_part.start == fs_partition->start;
+	sqfs.dev = fs_dev_desc;
+	sqfs.part = *fs_partition;
+
+	if (sqfs_disk_read(0, sizeof(*sb), sb) ||
+	    le32_to_cpu(sb->s_magic) != SQFS_MAGIC) {
+		/* Not ours: leave what is cached of the last image alone */
+		sqfs.dev = old_dev;
+		sqfs.part = old_part;
+		return -1;
+	}
+
+	/* The caches stay valid while the same image is mounted again */
+	if (same && !memcmp(&sqfs.sb, sb, sizeof(*sb)))
+		return 0;
+
+	sqfs_drop_caches();
+	memcpy(&sqfs.sb, sb, sizeof(*sb));
+
+	comp = le16_to_cpu(sb->compression);
+	sqfs.block_size = le32_to_cpu(sb->block_size);
+	sqfs.block_log = le16_to_cpu(sb->block_log);
+	sqfs.fragments = le32_to_cpu(sb->fragments);
+	if (le16_to_cpu(sb->s_major) != SQFS_MAJOR ||
+	    sqfs.block_log < 12 || sqfs.block_log > 20 ||
+	    sqfs.block_size != 1 << sqfs.block_log) {
+		printf("squashfs: unsupported version or block size\n");
+		goto fail;
+	}
+	if (!sqfs_comp_supported(comp)) {
+		printf("squashfs: unsupported compression %u\n", comp);
+		goto fail;
+	}
+	sqfs.comp = comp;
+
+	if (!sqfs.meta) {
+		sqfs.meta = calloc(SQFS_META_CACHE, sizeof(*sqfs.meta));
+		if (!sqfs.meta)
+			goto fail;
+	}
+	sqfs.cbuf = malloc_cache_aligned(max_t(u32, sqfs.block_size,
+					       SQFS_META_SIZE));
+	if (!sqfs.cbuf)
+		goto fail;
+
+	/* The fragment table index, read once per image */
+	nindex = DIV_ROUND_UP(sqfs.fragments, SQFS_FRAGS_PER_BLOCK);
+	if (nindex) {
+		sqfs.frag_index = malloc_cache_aligned(nindex * sizeof(u64));
+		if (!sqfs.frag_index ||
+		    sqfs_disk_read(le64_to_cpu(sb->fragment_table_start),
+				   nindex * sizeof(u64), sqfs.frag_index))
+			goto fail;
+		for (i = 0; i < nindex; i++)
+			sqfs.frag_index[i] = le64_to_cpu(sqfs.frag_index[i]);
+	}
+
+	return 0;
+
+fail:
+	sqfs_drop_caches();
+	memset(&sqfs.sb, 0, sizeof(sqfs.sb));
+
+	return -1;
+}
+
+int sqfs_exists(const char *filename)
+{
+	struct sqfs_inode inode;
+
+	return !sqfs_lookup(filename, &inode);
+}
+
+int sqfs_size(const char *filename, loff_t *size)
+{
+	struct sqfs_inode inode;
+	int ret;
+
+	ret = sqfs_lookup(filename, &inode);
+	if (ret)
+		return ret;
+
+	*size = inode.size;
+
+	return 0;
+}
+
+int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
+	      loff_t *actread)
+{
+	struct sqfs_inode inode;
+	int ret;
+
+	*actread = 0;
+	ret = sqfs_lookup(filename, &inode);
+	if (ret) {
+		printf("** File not found %s **\n", filename);
+		return ret;
+	}
+	if (inode.type != SQFS_REG_TYPE) {
+		printf("** %s is not a regular file **\n", filename);
+		return -EISDIR;
+	}
+
+	if (offset >= inode.size)
+		return 0;
+	if (!len || len > inode.size - offset)
+		len = inode.size - offset;
+
+	ret = sqfs_read_data(&inode, buf, offset, len);
+	if (ret)
+		return ret;
+
+	*actread = len;
+
+	return 0;
+}
+
+int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
+{
+	struct sqfs_dir_stream *dirs;
+	struct sqfs_inode inode;
+	int ret;
+
+	ret = sqfs_lookup(filename, &inode);
+	if (ret)
+		return ret;
+	if (inode.type != SQFS_DIR_TYPE)
+		return -ENOTDIR;
+
+	dirs = calloc(1, sizeof(*dirs));
+	if (!dirs)
+		return -ENOMEM;
+	sqfs_dir_open(&inode, &dirs->it);
+	*dirsp = &dirs->parent;
+
+	return 0;
+}
+
+int sqfs_readdir(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp)
+{
+	struct sqfs_dir_stream *dirs = (struct sqfs_dir_stream *)fs_dirs;
+	struct fs_dirent *dent = &dirs->dirent;
+	struct sqfs_inode inode;
+	u16 type;
+	u64 ref;
+	int ret;
+
+	memset(dent, 0, sizeof(*dent));
+	ret = sqfs_dir_next(&dirs->it, dent->name, &ref, &type);
+	if (ret <= 0)
+		return ret ? ret : -ENOENT;
+
+	switch (type) {
+	case SQFS_DIR_TYPE:
+	case SQFS_LDIR_TYPE:
+		dent->type = FS_DT_DIR;
+		break;
+	case SQFS_SYMLINK_TYPE:
+	case SQFS_LSYMLINK_TYPE:
+		dent->type = FS_DT_LNK;
+		break;
+	default:
+		dent->type = FS_DT_REG;
+		if (!sqfs_read_inode(ref, &inode))
+			dent->size = inode.size;
+		break;
+	}
+	*dentp = dent;
+
+	return 0;
+}
+
+void sqfs_closedir(struct fs_dir_stream *dirs)
+{
+	free(dirs);
+}
+
+void sqfs_close(void)
+{
+	/* Keep the caches for the next command on the same image */
+}
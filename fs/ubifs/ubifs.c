@@ -15,6 +15,7 @@
 #include <memalign.h>
 #include "ubifs.h"
 #include <u-boot/zlib.h>
+#include <u-boot/zstd.h>
 
 #include <linux/err.h>
 #include <linux/lzo.h>
@@ -34,6 +35,14 @@ static int gzip_decompress(const unsigned char *in, size_t in_len,
 		      (unsigned long *)out_len, 0, 0);
 }
 
+#ifdef CONFIG_ZSTD
+static int ubifs_zstd_decompress(const unsigned char *in, size_t in_len,
+				 unsigned char *out, size_t *out_len)
+{
+	return zstd_decompress(in, in_len, out, out_len);
+}
+#endif
+
 /* Fake description object for the "none" compressor */
 static struct ubifs_compressor none_compr = {
 	.compr_type = UBIFS_COMPR_NONE,
@@ -63,6 +72,15 @@ static struct ubifs_compressor zlib_compr = {
 	.decompress = gzip_decompress,
 };
 
+static struct ubifs_compressor zstd_compr = {
+	.compr_type = UBIFS_COMPR_ZSTD,
+	.name = "zstd",
+#ifdef CONFIG_ZSTD
+	.capi_name = "zstd",
+	.decompress = ubifs_zstd_decompress,
+#endif
+};
+
 /* All UBIFS compressors */
 struct ubifs_compressor *ubifs_compressors[UBIFS_COMPR_TYPES_CNT];
 
@@ -248,6 +266,10 @@ int __init ubifs_compressors_init(void)
 	if (err)
 		return err;
 
+	err = compr_init(&zstd_compr);
+	if (err)
+		return err;
+
 	err = compr_init(&none_compr);
 	if (err)
 		return err;
@@ -729,13 +751,18 @@ dump:
 	return -EINVAL;
 }
 
+/*
+ * @dn must hold UBIFS_MAX_DATA_NODE_SZ bytes and @buff UBIFS_BLOCK_SIZE
+ * bytes; both are allocated once by the caller and reused for every page
+ * of the file.
+ */
 static int do_readpage(struct ubifs_info *c, struct inode *inode,
-		       struct page *page, int last_block_size)
+		       struct page *page, int last_block_size,
+		       struct ubifs_data_node *dn, void *buff)
 {
 	void *addr;
 	int err = 0, i;
 	unsigned int block, beyond;
-	struct ubifs_data_node *dn;
 	loff_t i_size = inode->i_size;
 
 	dbg_gen("ino %lu, pg %lu, i_size %lld",
@@ -751,10 +778,6 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 		goto out;
 	}
 
-	dn = kmalloc(UBIFS_MAX_DATA_NODE_SZ, GFP_NOFS);
-	if (!dn)
-		return -ENOMEM;
-
 	i = 0;
 	while (1) {
 		int ret;
@@ -769,7 +792,6 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 			 * the requested size in the destination buffer.
 			 */
 			if (((block + 1) == beyond) || last_block_size) {
-				void *buff;
 				int dlen;
 
 				/*
@@ -778,22 +800,11 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 				 * destination area to a multiple of
 				 * UBIFS_BLOCK_SIZE.
 				 */
-				buff = malloc_cache_aligned(UBIFS_BLOCK_SIZE);
-				if (!buff) {
-					printf("%s: Error, malloc fails!\n",
-					       __func__);
-					err = -ENOMEM;
-					break;
-				}
-
-				/* Read block-size into temp buffer */
 				ret = read_block(inode, buff, block, dn);
 				if (ret) {
 					err = ret;
-					if (err != -ENOENT) {
-						free(buff);
+					if (err != -ENOENT)
 						break;
-					}
 				}
 
 				if (last_block_size)
@@ -803,8 +814,6 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 
 				/* Now copy required size back to dest */
 				memcpy(addr, buff, dlen);
-
-				free(buff);
 			} else {
 				ret = read_block(inode, addr, block, dn);
 				if (ret) {
@@ -823,21 +832,15 @@ static int do_readpage(struct ubifs_info *c, struct inode *inode,
 		if (err == -ENOENT) {
 			/* Not found, so it must be a hole */
 			dbg_gen("hole");
-			goto out_free;
+			goto out;
 		}
 		ubifs_err(c, "cannot read page %lu of inode %lu, error %d",
 			  page->index, inode->i_ino, err);
-		goto error;
+		return err;
 	}
 
-out_free:
-	kfree(dn);
 out:
 	return 0;
-
-error:
-	kfree(dn);
-	return err;
 }
 
 int ubifs_read(const char *filename, void *buf, loff_t offset,
@@ -847,8 +850,10 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 	unsigned long inum;
 	struct inode *inode;
 	struct page page;
+	struct ubifs_data_node *dn;
+	void *buff;
 	int err = 0;
-	int i;
+	int i = 0;
 	int count;
 	int last_block_size = 0;
 
@@ -895,6 +900,15 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 
 	count = (size + UBIFS_BLOCK_SIZE - 1) >> UBIFS_BLOCK_SHIFT;
 
+	/* Node and bounce buffers are shared by all pages of the file */
+	dn = kmalloc(UBIFS_MAX_DATA_NODE_SZ, GFP_NOFS);
+	buff = malloc_cache_aligned(UBIFS_BLOCK_SIZE);
+	if (!dn || !buff) {
+		printf("%s: Error, malloc fails!\n", __func__);
+		err = -ENOMEM;
+		goto free_bufs;
+	}
+
 	page.addr = buf;
 	page.index = offset / PAGE_SIZE;
 	page.inode = inode;
@@ -905,7 +919,7 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 		if (((i + 1) == count) && (size < inode->i_size))
 			last_block_size = size - (i * PAGE_SIZE);
 
-		err = do_readpage(c, inode, &page, last_block_size);
+		err = do_readpage(c, inode, &page, last_block_size, dn, buff);
 		if (err)
 			break;
 
@@ -913,6 +927,10 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 		page.index++;
 	}
 
+free_bufs:
+	free(buff);
+	kfree(dn);
+
 	if (err) {
 		printf("Error reading file '%s'\n", filename);
 		*actread = i * PAGE_SIZE;
@@ -76,6 +76,11 @@ extern char _image_binary_end[];
 extern char __rel_dyn_start[];
 extern char __rel_dyn_end[];
 
+/* CONFIG_XIP_RAM_DATA: the writable sections in RAM, and their flash copy */
+extern char __xip_data_start[];
+extern char __xip_data_end[];
+extern char __xip_data_load[];
+
 #else /* don't use offsets: */
 
 /* Exports from the Linker Script */
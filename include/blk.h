@@ -114,36 +114,21 @@ struct blk_desc {
 
 #if CONFIG_IS_ENABLED(BLOCK_CACHE)
 /**
- * blkcache_read() - attempt to read a set of blocks from cache
+ * blkcache_read() - read a set of blocks through the cache
  *
- * @param iftype - IF_TYPE_x for type of device
- * @param dev - device index of particular type
- * @param start - starting block number
- * @param blkcnt - number of blocks to read
- * @param blksz - size in bytes of each block
- * @param buf - buffer to contain cached data
- *
- * @return - '1' if block returned from cache, '0' otherwise.
- */
-int blkcache_read(int iftype, int dev,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer);
-
-/**
- * blkcache_fill() - make data read from a block device available
- * to the block cache
+ * Small reads are served from the cache, or read from the device a chunk
+ * at a time (more once the device is read sequentially) and kept.
  *
- * @param iftype - IF_TYPE_x for type of device
- * @param dev - device index of particular type
+ * @param desc - block device to read from
  * @param start - starting block number
- * @param blkcnt - number of blocks available
- * @param blksz - size in bytes of each block
- * @param buf - buffer containing data to cache
+ * @param blkcnt - number of blocks to read
+ * @param buf - buffer to contain the data
  *
+ * @return - '1' if the read was done, '0' if the caller must read from the
+ * device itself.
  */
-void blkcache_fill(int iftype, int dev,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer);
+int blkcache_read(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		  void *buffer);
 
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
@@ -162,6 +147,18 @@ void blkcache_invalidate(int iftype, int dev);
  */
 void blkcache_configure(unsigned blocks, unsigned entries);
 
+/**
+ * blkcache_configure_dev() - configure the cache of one device
+ *
+ * @param iftype - IF_TYPE_x for type of device
+ * @param dev - device index of particular type
+ * @param blocks - maximum blocks per entry
+ * @param entries - maximum entries in the cache of this device
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int blkcache_configure_dev(int iftype, int dev, unsigned blocks,
+			   unsigned entries);
+
 /*
  * statistics of the block cache
  */
@@ -180,19 +177,39 @@ struct block_cache_stats {
  */
 void blkcache_stats(struct block_cache_stats *stats);
 
+/*
+ * statistics of the cache of one device
+ */
+struct block_cache_dev_stats {
+	int iftype;
+	int devnum;
+	unsigned hits;
+	unsigned misses;
+	unsigned entries; /* current entry count */
+	unsigned max_blocks_per_entry;
+	unsigned max_entries;
+	unsigned ra_reads; /* reads widened to the read-ahead window */
+	unsigned ra_blocks; /* blocks read ahead */
+	unsigned ra_hits; /* read-ahead entries that were used */
+};
+
+/**
+ * blkcache_dev_stats() - return statistics of a device and reset them
+ *
+ * @param index - index of the device, in the order they were first used
+ * @param stats - statistics are copied here
+ * @return 0 if OK, -ENOENT if there is no device at @index
+ */
+int blkcache_dev_stats(int index, struct block_cache_dev_stats *stats);
+
 #else
 
-static inline int blkcache_read(int iftype, int dev,
-				lbaint_t start, lbaint_t blkcnt,
-				unsigned long blksz, void *buffer)
+static inline int blkcache_read(struct blk_desc *desc, lbaint_t start,
+				lbaint_t blkcnt, void *buffer)
 {
 	return 0;
 }
 
-static inline void blkcache_fill(int iftype, int dev,
-				 lbaint_t start, lbaint_t blkcnt,
-				 unsigned long blksz, void const *buffer) {}
-
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
 #endif
@@ -275,6 +292,17 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
 
+/**
+ * blk_write_count() - Get the number of writes and erases so far
+ *
+ * This counts the calls to blk_dwrite() and blk_derase() on any block
+ * device, so that a caller can tell whether data may have changed since it
+ * last looked.
+ *
+ * @return number of writes and erases
+ */
+ulong blk_write_count(void);
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -428,9 +456,7 @@ struct blk_desc *blk_get_by_device(struct udevice *dev);
 static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			      lbaint_t blkcnt, void *buffer)
 {
-	ulong blks_read;
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
+	if (blkcache_read(block_dev, start, blkcnt, buffer))
 		return blkcnt;
 
 	/*
@@ -438,12 +464,7 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	 * bloats the code slightly (cause some board to fail to build), and
 	 * it would be an error to try an operation that does not exist.
 	 */
-	blks_read = block_dev->block_read(block_dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
-
-	return blks_read;
+	return block_dev->block_read(block_dev, start, blkcnt, buffer);
 }
 
 static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
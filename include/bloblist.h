@@ -27,6 +27,10 @@ enum bloblist_tag_t {
 	BLOBLISTT_SPL_HANDOFF,		/* Hand-off info from SPL */
 	BLOBLISTT_VBOOT_CTX,		/* Chromium OS verified boot context */
 	BLOBLISTT_VBOOT_HANDOFF,	/* Chromium OS internal handoff info */
+	BLOBLISTT_MMC_HANDOFF,		/* MMC cards initialised by SPL */
+	BLOBLISTT_MALLOC_PROFILE,	/* Heap usage of SPL */
+	BLOBLISTT_ENV_HANDOFF,		/* Environment loaded by SPL */
+	BLOBLISTT_LOG_RING,		/* Binary log records */
 };
 
 /**
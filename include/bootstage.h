@@ -15,6 +15,7 @@
 enum bootstage_flags {
 	BOOTSTAGEF_ERROR	= 1 << 0,	/* Error record */
 	BOOTSTAGEF_ALLOC	= 1 << 1,	/* Allocate an id */
+	BOOTSTAGEF_SPAN		= 1 << 2,	/* Nested span, see bootstage_begin() */
 };
 
 /* bootstate sub-IDs used for kernel and ramdisk ranges */
@@ -212,6 +213,13 @@ enum bootstage_id {
  */
 ulong timer_get_boot_us(void);
 
+/*
+ * Return the time since boot in nanoseconds. By default this is
+ * timer_get_boot_us() * 1000, but timers with a higher resolution can
+ * provide more precision.
+ */
+u64 timer_get_boot_ns(void);
+
 #if defined(USE_HOSTCC)
 #define show_boot_progress(val) do {} while (0)
 #else
@@ -304,9 +312,59 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name);
  */
 uint32_t bootstage_accum(enum bootstage_id id);
 
+/**
+ * Add an accumulator record for an activity measured by the caller
+ *
+ * This is the same as a bootstage_start() / bootstage_accum() pair, except
+ * that a new id is allocated for the record.
+ *
+ * @param name		Textual name to display for this record in the report
+ * @param start_us	Time stamp of the start of the activity, in microseconds
+ * @param duration_us	Time spent in the activity, in microseconds
+ * @return duration_us, or 0 if there is no room left for the record
+ */
+uint32_t bootstage_add_accum(const char *name, uint32_t start_us,
+			     uint32_t duration_us);
+
+/**
+ * bootstage_begin() - Start a span
+ *
+ * A span records the start time and duration of an activity with
+ * nanosecond resolution, if the timer provides it. Spans can be nested: a
+ * span begun while another is open is recorded as its child. Each span must
+ * be closed with bootstage_end(), in reverse order of the bootstage_begin()
+ * calls.
+ *
+ * @name: Textual name to display for this span in the report
+ * @return id of the span, or 0 if there is no room left for it
+ */
+uint bootstage_begin(const char *name);
+
+/**
+ * bootstage_end() - Finish a span
+ *
+ * @id: Span id returned by bootstage_begin(); 0 is ignored
+ * @return duration of the span in microseconds, or 0 if @id is not valid
+ */
+uint32_t bootstage_end(uint id);
+
 /* Print a report about boot time */
 void bootstage_report(void);
 
+/**
+ * bootstage_export() - Write the records in Chrome trace-event format
+ *
+ * This writes a JSON file which can be loaded into chrome://tracing or
+ * Perfetto. Marks are shown as instant events and accumulators and spans
+ * as complete events.
+ *
+ * @buf: Buffer to write to
+ * @size: Size of buffer in bytes
+ * @return number of bytes needed for the output. If this is larger than
+ *	@size the output is truncated.
+ */
+int bootstage_export(char *buf, int size);
+
 /**
  * Add bootstage information to the device tree
  *
@@ -403,6 +461,23 @@ static inline uint32_t bootstage_accum(enum bootstage_id id)
 	return 0;
 }
 
+static inline uint32_t bootstage_add_accum(const char *name,
+					   uint32_t start_us,
+					   uint32_t duration_us)
+{
+	return 0;
+}
+
+static inline uint bootstage_begin(const char *name)
+{
+	return 0;
+}
+
+static inline uint32_t bootstage_end(uint id)
+{
+	return 0;
+}
+
 static inline int bootstage_stash(void *base, int size)
 {
 	return 0;	/* Pretend to succeed */
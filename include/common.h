@@ -433,6 +433,15 @@ int gzip_parse_header(const unsigned char *src, unsigned long len);
 int gunzip(void *, int, unsigned char *, unsigned long *);
 int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 						int stoponerr, int offset);
+/*
+ * Decompress gzip data fed in pieces of any size, except that the gzip
+ * header must be in the first one
+ */
+struct gunzip_stream;
+struct gunzip_stream *gunzip_stream_start(void *dst, unsigned long dstlen);
+int gunzip_stream_feed(struct gunzip_stream *gz, const void *src,
+		       unsigned long len);
+int gunzip_stream_end(struct gunzip_stream *gz, unsigned long *lenp);
 
 /**
  * gzwrite progress indicators: defined weak to allow board-specific
@@ -461,7 +470,8 @@ void gzwrite_progress_finish(int retcode,
  * @param	src		compressed image address
  * @param	len		compressed image length in bytes
  * @param	dev		block device descriptor
- * @param	szwritebuf	bytes per write (pad to erase size)
+ * @param	szwritebuf	bytes per write, rounded up to the
+ *				erase group size of eMMC
  * @param	startoffs	offset in bytes of first write
  * @param	szexpected	expected uncompressed length
  *				may be zero to use gzip trailer
@@ -475,6 +485,13 @@ int gzwrite(unsigned char *src, int len,
 
 /* lib/lz4_wrapper.c */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
+/* Decompress a single raw LZ4 block, without the frame around it */
+int ulz4_block(const void *src, size_t srcn, void *dst, size_t *dstn);
+/* Decompress an LZ4 frame fed in pieces of any size, see ulz4fn() */
+struct ulz4_stream;
+struct ulz4_stream *ulz4_stream_start(void *dst, size_t dstn);
+int ulz4_stream_feed(struct ulz4_stream *ls, const void *src, size_t srcn);
+int ulz4_stream_end(struct ulz4_stream *ls, size_t *dstn);
 
 /* lib/qsort.c */
 void qsort(void *base, size_t nmemb, size_t size,
@@ -449,11 +449,19 @@
 	\
 	BOOT_TARGET_DEVICES(BOOTENV_DEV)                                  \
 	\
+	BOOTENV_DISTRO_BOOTCMD
+
+#ifdef CONFIG_CMD_BOOTSCAN
+#define BOOTENV_DISTRO_BOOTCMD \
+	"distro_bootcmd=bootscan\0"
+#else
+#define BOOTENV_DISTRO_BOOTCMD \
 	"distro_bootcmd=" BOOTENV_SET_SCSI_NEED_INIT                      \
 		BOOTENV_SET_NVME_NEED_INIT                                \
 		"for target in ${boot_targets}; do "                      \
 			"run bootcmd_${target}; "                         \
 		"done\0"
+#endif
 
 #ifndef CONFIG_BOOTCOMMAND
 #define CONFIG_BOOTCOMMAND "run distro_bootcmd"
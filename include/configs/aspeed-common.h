@@ -25,6 +25,16 @@
 #define CONFIG_SETUP_MEMORY_TAGS
 #define CONFIG_INITRD_TAG
 
+/* SPL may run with the D-cache on even if U-Boot does not */
+#if defined(CONFIG_SPL_BUILD) && defined(CONFIG_ASPEED_SPL_DCACHE)
+#undef CONFIG_SYS_DCACHE_OFF
+#endif
+
+/* U-Boot running from the SPI flash needs its data linked in the DRAM */
+#ifdef CONFIG_ASPEED_UBOOT_XIP
+#define CONFIG_SYS_LDSCRIPT	"arch/arm/mach-aspeed/ast2600/u-boot-xip.lds"
+#endif
+
 #define CONFIG_SYS_SDRAM_BASE		(ASPEED_DRAM_BASE + CONFIG_ASPEED_SSP_RERV_MEM)
 
 #ifdef CONFIG_PRE_CON_BUF_SZ
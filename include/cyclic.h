@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Cooperative background tasks
+ *
+ * Drivers can register a poll function which is called from udelay(), and
+ * so from mdelay() and the wait_for_bit helpers, while the boot goes on.
+ * This lets slow hardware operations on different devices overlap, e.g.
+ * one driver can wait for PHY auto-negotiation while another initialises
+ * an eMMC card.
+ */
+
+#ifndef __CYCLIC_H
+#define __CYCLIC_H
+
+#include <linux/errno.h>
+#include <linux/kernel.h>
+
+struct cyclic_info;
+
+/* Flags for cyclic_register() */
+enum cyclic_flags {
+	CYCLICF_ENDLESS		= 1 << 0,	/* Never finishes, e.g. watchdog */
+};
+
+/**
+ * cyclic_func_t - Poll function of a task
+ *
+ * This should do a small amount of work and return, e.g. move a state
+ * machine on by one step. It may call udelay(); other tasks run meanwhile,
+ * but not this one.
+ *
+ * @ctx: Context pointer passed to cyclic_register()
+ * @return -EBUSY to be called again, 0 if the task is done, other -ve
+ *	error if the task failed. In the last two cases the task is removed.
+ */
+typedef int (*cyclic_func_t)(void *ctx);
+
+/**
+ * struct cyclic_info - A registered task
+ *
+ * This is owned by the caller, e.g. embedded in the private data of a
+ * device, and must stay valid until the task is done or unregistered.
+ *
+ * @func: Poll function
+ * @ctx: Context pointer for @func
+ * @name: Name of the task, for debugging
+ * @period_us: Minimum time between calls to @func, in microseconds
+ * @next_us: Time when @func is next due (timer_get_us() value)
+ * @flags: Task flags (enum cyclic_flags)
+ * @ret: Last value returned by @func
+ * @active: true if the task is registered
+ * @running: true while @func is being called
+ * @next: Next task in the list
+ */
+struct cyclic_info {
+	cyclic_func_t func;
+	void *ctx;
+	const char *name;
+	ulong period_us;
+	ulong next_us;
+	uint flags;
+	int ret;
+	bool active;
+	bool running;
+	struct cyclic_info *next;
+};
+
+#if CONFIG_IS_ENABLED(CYCLIC)
+/**
+ * cyclic_register() - Start a background task
+ *
+ * @info: Task information, filled in by this function
+ * @func: Poll function
+ * @ctx: Context pointer for @func
+ * @period_us: Minimum time between calls to @func, in microseconds
+ * @flags: Task flags (enum cyclic_flags)
+ * @name: Name of the task, for debugging
+ * @return 0 if OK, -EALREADY if @info is already registered
+ */
+int cyclic_register(struct cyclic_info *info, cyclic_func_t func, void *ctx,
+		    ulong period_us, uint flags, const char *name);
+
+/**
+ * cyclic_unregister() - Stop a background task
+ *
+ * This does nothing if the task is not registered.
+ *
+ * @info: Task to stop
+ */
+void cyclic_unregister(struct cyclic_info *info);
+
+/**
+ * cyclic_run() - Run the tasks which are due
+ *
+ * This is called from udelay() and can be called from any other loop which
+ * waits for hardware.
+ *
+ * @return maximum time in microseconds until this should be called again,
+ *	at least 1, or ULONG_MAX if no task is registered
+ */
+ulong cyclic_run(void);
+
+/**
+ * cyclic_wait() - Wait for a background task to finish
+ *
+ * Other tasks keep running while waiting.
+ *
+ * @info: Task to wait for
+ * @return 0 if the task finished (or was not registered), -ve error it
+ *	returned if it failed
+ */
+int cyclic_wait(struct cyclic_info *info);
+
+/**
+ * cyclic_wait_all() - Wait for all tasks to finish
+ *
+ * This is used before U-Boot relocates or jumps to the next boot phase,
+ * since the tasks cannot run after that. Tasks registered with
+ * CYCLICF_ENDLESS are unregistered once the others are done.
+ *
+ * @return 0 (for use in init sequences)
+ */
+int cyclic_wait_all(void);
+#else
+static inline int cyclic_register(struct cyclic_info *info,
+				  cyclic_func_t func, void *ctx,
+				  ulong period_us, uint flags,
+				  const char *name)
+{
+	return -ENOSYS;
+}
+
+static inline void cyclic_unregister(struct cyclic_info *info)
+{
+}
+
+static inline ulong cyclic_run(void)
+{
+	return ULONG_MAX;
+}
+
+static inline int cyclic_wait(struct cyclic_info *info)
+{
+	return 0;
+}
+
+static inline int cyclic_wait_all(void)
+{
+	return 0;
+}
+#endif
+
+#endif
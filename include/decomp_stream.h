@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Decompression of data fed in pieces
+ */
+
+#ifndef __DECOMP_STREAM_H
+#define __DECOMP_STREAM_H
+
+struct decomp_stream;
+
+/**
+ * decomp_stream_start() - start decompressing data into a buffer
+ *
+ * The format (gzip, LZ4 or zstd) is detected from the start of the first
+ * piece of input. Data in no known format is copied as it is.
+ *
+ * @dst:	output buffer
+ * @dstlen:	size of the output buffer
+ * @return the stream, or NULL if out of memory
+ */
+struct decomp_stream *decomp_stream_start(void *dst, size_t dstlen);
+
+/**
+ * decomp_stream_feed() - decompress the next piece of input
+ *
+ * The piece is not needed any more on return. The first one is used to
+ * detect the format, so must be at least four bytes long, and must hold
+ * the whole header of a gzip file.
+ *
+ * @ds:		stream from decomp_stream_start()
+ * @src:	next piece of input
+ * @len:	length of that piece
+ * @return 0 if OK, -ENOSPC if the output buffer is too small, other -ve
+ *	value if the data is corrupt
+ */
+int decomp_stream_feed(struct decomp_stream *ds, const void *src, size_t len);
+
+/**
+ * decomp_stream_end() - finish a stream and free it
+ *
+ * @ds:		stream from decomp_stream_start()
+ * @dstlen:	returns the number of bytes written
+ * @return 0 if OK, -ve if the input was truncated or decompression failed
+ */
+int decomp_stream_end(struct decomp_stream *ds, size_t *dstlen);
+
+/**
+ * decomp_stream_type() - get the format of a stream
+ *
+ * @ds:		stream fed at least once
+ * @return IH_COMP_... value
+ */
+int decomp_stream_type(struct decomp_stream *ds);
+
+#endif
@@ -93,6 +93,8 @@ struct sf_internal_data {
 #define DFU_MANIFEST_POLL_TIMEOUT	DFU_DEFAULT_POLL_TIMEOUT
 #endif
 
+struct dfu_gzip;
+
 struct dfu_entity {
 	char			name[DFU_NAME_SIZE];
 	int                     alt;
@@ -135,7 +137,16 @@ struct dfu_entity {
 
 	u32 bad_skip;	/* for nand use */
 
+	/* full buffer still being written, see dfu_write_poll() */
+	u8 *w_buf;
+	long w_left;
+	int w_err;
+
+	/* the host sends gzipped data, for "gzip" alt settings */
+	struct dfu_gzip *gz;
+
 	unsigned int inited:1;
+	unsigned int gzip:1;
 };
 
 #ifdef CONFIG_SET_DFU_ALT_INFO
@@ -161,6 +172,25 @@ int dfu_read(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 int dfu_write(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 int dfu_flush(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 
+/**
+ * dfu_write_poll - write some of the data waiting for the medium
+ *
+ * With CONFIG_DFU_DOUBLE_BUFFER a full buffer is handed over here instead
+ * of being written from dfu_write(), so that the USB transfer can go on
+ * into the other buffer. Call this from the loop that handles the gadget.
+ * An error is also reported by the next dfu_write() or dfu_flush().
+ *
+ * @return - 0 on success, other value on failure
+ */
+#if CONFIG_IS_ENABLED(DFU_DOUBLE_BUFFER)
+int dfu_write_poll(void);
+#else
+static inline int dfu_write_poll(void)
+{
+	return 0;
+}
+#endif
+
 /*
  * dfu_defer_flush - pointer to store dfu_entity for deferred flashing.
  *		     It should be NULL when not used.
@@ -10,6 +10,7 @@
 #ifndef _DM_DEVICE_INTERNAL_H
 #define _DM_DEVICE_INTERNAL_H
 
+#include <malloc.h>
 #include <dm/ofnode.h>
 
 struct device_node;
@@ -124,6 +125,36 @@ int device_unbind(struct udevice *dev);
 static inline int device_unbind(struct udevice *dev) { return 0; }
 #endif
 
+/**
+ * dm_pool_alloc() - Allocate zeroed memory for a device or uclass
+ *
+ * With CONFIG_DM_POOL, small objects come from a pool with one free list
+ * per size class. Otherwise this is the same as calloc().
+ *
+ * @size: Number of bytes to allocate
+ * @return pointer to the memory, or NULL if out of memory
+ */
+/**
+ * dm_pool_free() - Free memory allocated by dm_pool_alloc()
+ *
+ * @ptr: Pointer to free (may be NULL)
+ * @size: Size that was passed to dm_pool_alloc()
+ */
+#if CONFIG_IS_ENABLED(DM_POOL)
+void *dm_pool_alloc(size_t size);
+void dm_pool_free(void *ptr, size_t size);
+#else
+static inline void *dm_pool_alloc(size_t size)
+{
+	return calloc(1, size);
+}
+
+static inline void dm_pool_free(void *ptr, size_t size)
+{
+	free(ptr);
+}
+#endif
+
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 void device_free(struct udevice *dev);
 #else
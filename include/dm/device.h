@@ -61,6 +61,12 @@ struct driver_info;
  */
 #define DM_FLAG_OS_PREPARE		(1 << 10)
 
+/*
+ * Driver can adopt the state which SPL left the hardware in, as recorded in
+ * the SPL handoff, instead of programming it again
+ */
+#define DM_FLAG_HANDOFF			(1 << 11)
+
 /*
  * One or multiple of these flags are passed to device_remove() so that
  * a selective device removal as specified by the remove-stage and the
@@ -82,6 +88,26 @@ enum {
 	DM_REMOVE_ACTIVE_ALL = DM_REMOVE_ACTIVE_DMA | DM_REMOVE_OS_PREPARE,
 };
 
+/**
+ * struct dm_timing - Bind and probe times of a device, in microseconds
+ *
+ * @bind_us: Time spent binding the device, including the driver's bind()
+ *	method, which may bind child devices
+ * @probe_us: Total time spent probing the device, including all of the below
+ * @parent_us: Time spent probing the parent devices
+ * @pinctrl_us: Time spent selecting the default pinctrl state
+ * @power_us: Time spent turning on the power domain
+ * @clk_us: Time spent setting up the assigned clocks
+ */
+struct dm_timing {
+	u32 bind_us;
+	u32 probe_us;
+	u32 parent_us;
+	u32 pinctrl_us;
+	u32 power_us;
+	u32 clk_us;
+};
+
 /**
  * struct udevice - An instance of a driver
  *
@@ -123,6 +149,7 @@ enum {
  *		When CONFIG_DEVRES is enabled, devm_kmalloc() and friends will
  *		add to this list. Memory so-allocated will be freed
  *		automatically when the device is removed / unbound
+ * @timing: Bind and probe times of the device (CONFIG_DM_TIMING)
  */
 struct udevice {
 	const struct driver *driver;
@@ -146,6 +173,9 @@ struct udevice {
 #ifdef CONFIG_DEVRES
 	struct list_head devres_head;
 #endif
+#ifdef CONFIG_DM_TIMING
+	struct dm_timing timing;
+#endif
 };
 
 /* Maximum sequence number supported */
@@ -61,6 +61,20 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		   bool pre_reloc_only);
 
+/**
+ * lists_match_fdt() - find the driver for a device tree node
+ *
+ * This finds the driver lists_bind_fdt() would bind to the node, without
+ * binding anything.
+ *
+ * @node: device tree node to check
+ * @pre_reloc_only: If true, match only nodes with special devicetree
+ * properties, or drivers with the DM_FLAG_PRE_RELOC flag. If false match all
+ * drivers.
+ * @return matching driver, or NULL if there is none
+ */
+const struct driver *lists_match_fdt(ofnode node, bool pre_reloc_only);
+
 /**
  * device_bind_driver() - bind a device to a driver
  *
@@ -9,6 +9,10 @@
 #ifndef _DM_ROOT_H_
 #define _DM_ROOT_H_
 
+#include <dm/ofnode.h>
+#include <dm/uclass-id.h>
+#include <linux/errno.h>
+
 struct udevice;
 
 /**
@@ -114,6 +118,61 @@ int dm_init(bool of_live);
  */
 int dm_uninit(void);
 
+#if CONFIG_IS_ENABLED(DM_LAZY_BIND)
+/**
+ * dm_lazy_scan() - Record the subnodes of a node for lazy binding
+ *
+ * This is what scanning the device tree does with CONFIG_DM_LAZY_BIND: the
+ * subnodes of @parent_node which have a driver are recorded, to be bound to
+ * @parent_dev the first time they are looked up.
+ *
+ * @parent_dev: Parent device for the devices that will be created
+ * @parent_node: Node to scan
+ * @pre_reloc_only: If true, record only nodes with special devicetree
+ * properties, or drivers with the DM_FLAG_PRE_RELOC flag.
+ * @return 0 if OK, -ve on error
+ */
+int dm_lazy_scan(struct udevice *parent_dev, ofnode parent_node,
+		 bool pre_reloc_only);
+
+/**
+ * dm_lazy_bind_uclass() - Bind the recorded nodes of a uclass
+ *
+ * @id: Uclass ID about to be looked up
+ */
+void dm_lazy_bind_uclass(enum uclass_id id);
+
+/**
+ * dm_lazy_bind_ofnode() - Bind a recorded node, and the parents it needs
+ *
+ * @node: Node about to be looked up
+ */
+void dm_lazy_bind_ofnode(ofnode node);
+
+/**
+ * dm_lazy_bind_children() - Bind the recorded subnodes of a device
+ *
+ * @parent: Device whose children are about to be looked up
+ */
+void dm_lazy_bind_children(struct udevice *parent);
+
+/**
+ * dm_lazy_reset() - Forget all recorded nodes
+ */
+void dm_lazy_reset(void);
+#else
+static inline int dm_lazy_scan(struct udevice *parent_dev, ofnode parent_node,
+			       bool pre_reloc_only)
+{
+	return -ENOSYS;
+}
+
+static inline void dm_lazy_bind_uclass(enum uclass_id id) {}
+static inline void dm_lazy_bind_ofnode(ofnode node) {}
+static inline void dm_lazy_bind_children(struct udevice *parent) {}
+static inline void dm_lazy_reset(void) {}
+#endif
+
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 /**
  * dm_remove_devices_flags - Call remove function of all drivers with
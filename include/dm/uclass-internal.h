@@ -24,6 +24,30 @@
  */
 int uclass_find_next_free_req_seq(enum uclass_id id);
 
+/**
+ * uclass_set_seq() - Set the sequence number of a device
+ *
+ * This keeps the sequence number index of the device's uclass up to date,
+ * so dev->seq must not be changed directly.
+ *
+ * @dev:	Device to update
+ * @seq:	New sequence number, -1 for none
+ */
+void uclass_set_seq(struct udevice *dev, int seq);
+
+/**
+ * uclass_find_global_by_ofnode() - Find a device by node using the indexes
+ *
+ * This looks up the device tree node in the index of every uclass. It
+ * returns the same device as walking the whole device tree would, or NULL
+ * if it cannot tell (no indexed device uses the node, or several unrelated
+ * devices do), in which case the device tree must be walked.
+ *
+ * @node:	Device tree node to look for
+ * @return the device, or NULL if not found in the indexes
+ */
+struct udevice *uclass_find_global_by_ofnode(ofnode node);
+
 /**
  * uclass_get_device_tail() - handle the end of a get_device call
  *
@@ -30,12 +30,24 @@
  * @dev_head: List of devices in this uclass (devices are attached to their
  * uclass when their bind method is called)
  * @sibling_node: Next uclass in the linked list of uclasses
+ * @seq_devs: Probed devices indexed by sequence number (DM_UCLASS_INDEX)
+ * @seq_size: Number of entries in @seq_devs, -1 if the index is disabled
+ * @node_devs: Hash table of the devices by device tree node (DM_UCLASS_INDEX)
+ * @node_size: Number of buckets in @node_devs, -1 if the index is disabled
+ * @node_count: Number of devices in @node_devs
  */
 struct uclass {
 	void *priv;
 	struct uclass_driver *uc_drv;
 	struct list_head dev_head;
 	struct list_head sibling_node;
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct udevice **seq_devs;
+	int seq_size;
+	struct udevice **node_devs;
+	int node_size;
+	int node_count;
+#endif
 };
 
 struct driver;
@@ -316,4 +316,27 @@ int dma_get_device(u32 transfer_type, struct udevice **devp);
  */
 int dma_memcpy(void *dst, void *src, size_t len);
 
+#if CONFIG_IS_ENABLED(DMA_MEMCPY_LARGE)
+/*
+ * dma_memcpy_large - copy with DMA if it is worth it and safe to do
+ *
+ * Large copies between distinct buffers aligned for cache maintenance
+ * are given to dma_memcpy(), with the source flushed from the cache first
+ * and the destination invalidated afterwards. The caller copies with the
+ * CPU when this fails.
+ *
+ * @dst - destination pointer
+ * @src - source pointer
+ * @len - data length to be copied
+ * @return - 0 if copied, -EINVAL if the copy is too small, unaligned or
+ *	     overlapping, or another error code from dma_memcpy()
+ */
+int dma_memcpy_large(void *dst, const void *src, size_t len);
+#else
+static inline int dma_memcpy_large(void *dst, const void *src, size_t len)
+{
+	return -ENOSYS;
+}
+#endif
+
 #endif	/* _DMA_H_ */
@@ -35,4 +35,37 @@ int env_attr_walk(const char *attr_list,
  */
 int env_attr_lookup(const char *attr_list, const char *name, char *attributes);
 
+struct env_attr_entry;
+
+/*
+ * An attribute list compiled for lookups by name, so that a list which is
+ * consulted for every variable (e.g. ".flags" and ".callbacks") is not
+ * parsed again for each one. With CONFIG_REGEX the names are patterns, so
+ * the list is kept as it is and searched by env_attr_lookup().
+ */
+struct env_attr_table {
+	struct env_attr_entry *entries;
+	int count;
+	char *list;
+};
+
+/*
+ * env_attr_table_build compiles "attr_list" (which may be NULL) into "tab",
+ * replacing anything that was there before.
+ * Returns 0 on success, -ENOMEM if out of memory.
+ */
+int env_attr_table_build(struct env_attr_table *tab, const char *attr_list);
+
+/*
+ * env_attr_table_lookup looks up "name" in "tab" with the same result as
+ * env_attr_lookup() on the list it was built from: the attributes of the
+ * last entry for "name" are copied into "attributes".
+ * Returns 0 on success, -ENOENT if "name" is not found.
+ */
+int env_attr_table_lookup(const struct env_attr_table *tab, const char *name,
+			  char *attributes);
+
+/* env_attr_table_free frees everything held by "tab" */
+void env_attr_table_free(struct env_attr_table *tab);
+
 #endif /* __ENV_ATTR_H__ */
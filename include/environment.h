@@ -273,6 +273,14 @@ int env_import(const char *buf, int check);
 /* Export from hash table into binary representation */
 int env_export(env_t *env_out);
 
+#ifdef CONFIG_SPL_ENV_HANDOFF
+/* Export the environment for U-Boot proper, without a new serial */
+int env_export_handoff(env_t *env_out);
+
+/* Import an environment passed on by SPL, without checking the CRC */
+int env_import_handoff(const env_t *ep);
+#endif
+
 #ifdef CONFIG_SYS_REDUNDAND_ENVIRONMENT
 /* Select and import one of two redundant environments */
 int env_import_redund(const char *buf1, int buf1_status,
@@ -36,6 +36,9 @@ enum {
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_FORMAT)
 	FASTBOOT_COMMAND_OEM_FORMAT,
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	FASTBOOT_COMMAND_OEM_STREAM,
+#endif
 
 	FASTBOOT_COMMAND_COUNT
 };
@@ -128,6 +131,17 @@ int fastboot_handle_command(char *cmd_string, char *response);
  */
 u32 fastboot_data_remaining(void);
 
+/**
+ * fastboot_data_addr() - Get where download data can be received in place
+ *
+ * @offset: Offset of the data in the download
+ * @len: Number of bytes to receive
+ *
+ * Return: Address in fastboot_buf_addr to receive the data at and then pass
+ * to fastboot_data_download(), or NULL to receive it elsewhere
+ */
+void *fastboot_data_addr(u32 offset, u32 len);
+
 /**
  * fastboot_data_download() - Copy image data to fastboot_buf_addr.
  *
@@ -151,4 +165,13 @@ void fastboot_data_download(const void *fastboot_data,
  */
 void fastboot_data_complete(char *response);
 
+/**
+ * fastboot_data_flush() - Write the data received so far, when streaming
+ *
+ * Call this after the next part of the download has been asked for, so that
+ * the transfer goes on while the data is written to flash. This does
+ * nothing unless the download has been announced with "oem stream".
+ */
+void fastboot_data_flush(void);
+
 #endif /* _FASTBOOT_H_ */
@@ -29,6 +29,14 @@
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
 #define FAT32BUFSIZE	(FATBUFSIZE/4)
 
+/* The FAT cache holds this many windows of FATBUFBLOCKS sectors */
+#ifdef CONFIG_FS_FAT_CACHE_WINDOWS
+#define FAT_CACHE_WINDOWS	CONFIG_FS_FAT_CACHE_WINDOWS
+#else
+#define FAT_CACHE_WINDOWS	1
+#endif
+#define FAT_CACHE_SIZE		(FATBUFSIZE * FAT_CACHE_WINDOWS)
+
 /* Maximum number of entry for long file name according to spec */
 #define MAX_LFN_SLOT	20
 
@@ -160,17 +168,25 @@ typedef struct dir_slot {
  * Note: FAT buffer has to be 32 bit aligned
  * (see FAT32 accesses)
  */
+/* A window of the FAT cache */
+struct fat_window {
+	int	bufnum;		/* FAT buffer held, -1 if none */
+	__u32	used;		/* Last use, for LRU replacement */
+	__u16	dirty_lo;	/* Modified sectors, from dirty_lo */
+	__u16	dirty_hi;	/* up to dirty_hi excluded */
+};
+
 typedef struct {
-	__u8	*fatbuf;	/* Current FAT buffer */
+	__u8	*fatbuf;	/* FAT cache, FAT_CACHE_SIZE bytes */
 	int	fatsize;	/* Size of FAT in bits */
 	__u32	fatlength;	/* Length of FAT in sectors */
 	__u16	fat_sect;	/* Starting sector of the FAT */
-	__u8	fat_dirty;      /* Set if fatbuf has been modified */
+	struct fat_window fatwin[FAT_CACHE_WINDOWS];
+	__u32	fatwin_clock;	/* Incremented on each window use */
 	__u32	rootdir_sect;	/* Start sector of root directory */
 	__u16	sect_size;	/* Size of sectors in bytes */
 	__u16	clust_size;	/* Size of clusters in sectors */
 	int	data_begin;	/* The sector of the first cluster, can be negative */
-	int	fatbufnum;	/* Used by get_fatent, init to -1 */
 	int	rootdir_size;	/* Size of root dir for non-FAT32 */
 	__u32	root_cluster;	/* First cluster of root dir for FAT32 */
 	u32	total_sect;	/* Number of sectors */
@@ -34,4 +34,39 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
  * @response: Pointer to fastboot response buffer
  */
 void fastboot_mmc_erase(const char *cmd, char *response);
+
+/**
+ * fastboot_mmc_stream_start() - Prepare to write an image while it arrives
+ *
+ * @cmd: Named partition to write the image to
+ * @size: Size of the whole image
+ * @response: Pointer to fastboot response buffer, set on error
+ * @return 0 if ok, -ve on error
+ */
+int fastboot_mmc_stream_start(const char *cmd, u32 size, char *response);
+
+/**
+ * fastboot_mmc_stream_write() - Write the next part of a streamed image
+ *
+ * Only whole blocks and, for sparse images, whole headers are written until
+ * @last is set. The rest must be passed again with the data that follows.
+ *
+ * @buf: Image data, with room for one more block after @len
+ * @len: Number of bytes in @buf
+ * @last: true if this is the end of the image
+ * @consumedp: Returns the number of bytes written from @buf
+ * @response: Pointer to fastboot response buffer, set on error
+ * @return 0 if ok, -ve on error
+ */
+int fastboot_mmc_stream_write(void *buf, u32 len, bool last, u32 *consumedp,
+			      char *response);
+
+/**
+ * fastboot_mmc_stream_finish() - Check that a streamed image was written
+ *
+ * @cmd: Named partition the image was written to
+ * @response: Pointer to fastboot response buffer
+ * @return 0 if ok, -ve on error
+ */
+int fastboot_mmc_stream_finish(const char *cmd, char *response);
 #endif
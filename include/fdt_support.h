@@ -66,6 +66,65 @@ void do_fixup_by_compat(void *fdt, const char *compat,
 			const char *prop, const void *val, int len, int create);
 void do_fixup_by_compat_u32(void *fdt, const char *compat,
 			    const char *prop, u32 val, int create);
+
+#ifdef CONFIG_FDT_FIXUP_SESSION
+/**
+ * fdt_fixup_session_begin() - Start recording the fixups of a blob
+ *
+ * Until fdt_fixup_session_end(), do_fixup_by_path() and do_fixup_by_compat()
+ * on @fdt only record their changes, so the blob keeps its old contents and
+ * node offsets. Other changes still go straight to the blob; the recorded
+ * ones are applied on top of them.
+ *
+ * @fdt: FDT blob to fix up
+ * @return 0 if OK, -FDT_ERR_BADSTATE if a session is already open
+ */
+int fdt_fixup_session_begin(void *fdt);
+
+/**
+ * fdt_fixup_session_end() - Apply the recorded fixups
+ *
+ * The tree is written out once with all the changes, within the current
+ * total size of the blob.
+ *
+ * @return 0 if OK, -FDT_ERR_... on error
+ */
+int fdt_fixup_session_end(void);
+
+/**
+ * fdt_fixup_session_add() - Record a property change in the open session
+ *
+ * @fdt: FDT blob to change
+ * @target: Path of the node, or compatible string of the nodes to change
+ * @by_compat: true if @target is a compatible string
+ * @name: Property name
+ * @val: Property value, copied
+ * @len: Length of @val
+ * @create: Add the property if the node does not have it
+ * @return true if recorded, false if there is no session open for @fdt
+ */
+bool fdt_fixup_session_add(void *fdt, const char *target, bool by_compat,
+			   const char *name, const void *val, int len,
+			   int create);
+#else
+static inline int fdt_fixup_session_begin(void *fdt)
+{
+	return 0;
+}
+
+static inline int fdt_fixup_session_end(void)
+{
+	return 0;
+}
+
+static inline bool fdt_fixup_session_add(void *fdt, const char *target,
+					 bool by_compat, const char *name,
+					 const void *val, int len, int create)
+{
+	return false;
+}
+#endif
+
 /**
  * Setup the memory node in the DT. Creates one if none was existing before.
  * Calls fdt_fixup_memory_banks() to populate a single reg pair covering the
@@ -287,6 +346,7 @@ int fdt_setup_simplefb_node(void *fdt, int node, u64 base_address, u32 width,
 			    u32 height, u32 stride, const char *format);
 
 int fdt_overlay_apply_verbose(void *fdt, void *fdto);
+int fdt_overlay_apply_in_place(void *fdt, void *fdto, int extra);
 
 /**
  * fdt_get_cells_len() - Get the length of a type of cell in top-level nodes
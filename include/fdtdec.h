@@ -237,6 +237,59 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 int fdtdec_next_alias(const void *blob, const char *name,
 		enum fdt_compat_id id, int *upto);
 
+#if CONFIG_IS_ENABLED(OF_INDEX)
+/**
+ * Build the phandle and compatible index of a device tree
+ *
+ * The fdtdec_node_offset_by_*() lookups use the index while the blob is
+ * the one it was built from and its size is unchanged, and fall back to
+ * libfdt otherwise. The index is built once after relocation.
+ *
+ * @param blob		FDT blob to index
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int fdtdec_index_build(const void *blob);
+
+/**
+ * Find a node by phandle, see fdt_node_offset_by_phandle()
+ *
+ * @param blob		FDT blob to use
+ * @param phandle	Phandle to look up
+ * @return offset of the node, or -ve FDT_ERR_... on error
+ */
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle);
+
+/**
+ * Find the next node with a compatible string, see
+ * fdt_node_offset_by_compatible()
+ *
+ * @param blob		FDT blob to use
+ * @param startoffset	Only nodes after this offset are returned, -1 for all
+ * @param compat	Compatible string to look for
+ * @return offset of the node, or -ve FDT_ERR_... on error
+ */
+int fdtdec_node_offset_by_compatible(const void *blob, int startoffset,
+				     const char *compat);
+#else
+static inline int fdtdec_index_build(const void *blob)
+{
+	return 0;
+}
+
+static inline int fdtdec_node_offset_by_phandle(const void *blob,
+						uint32_t phandle)
+{
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+
+static inline int fdtdec_node_offset_by_compatible(const void *blob,
+						   int startoffset,
+						   const char *compat)
+{
+	return fdt_node_offset_by_compatible(blob, startoffset, compat);
+}
+#endif
+
 /**
  * Find the compatible ID for a given node.
  *
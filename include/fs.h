@@ -13,6 +13,7 @@
 #define FS_TYPE_SANDBOX	3
 #define FS_TYPE_UBIFS	4
 #define FS_TYPE_BTRFS	5
+#define FS_TYPE_SQUASHFS 6
 
 /*
  * Tell the fs layer which block device an partition to use for future
@@ -99,6 +100,51 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	     loff_t *actwrite);
 
+/* Note: fs_file should be treated as opaque to the user of fs layer */
+struct fs_file;
+
+/*
+ * fs_file_open - Open a file on the partition previously set by
+ * fs_set_blk_dev(), for any number of reads
+ *
+ * The handle remembers the partition and its filesystem, so reading it
+ * later does not need fs_set_blk_dev() and does not probe for the
+ * filesystem type again. Where the filesystem supports it, the path
+ * lookup and the file's block map stay cached between reads.
+ *
+ * @filename: Name of the file to open
+ * @return a file handle, or NULL on error and errno set appropriately
+ */
+struct fs_file *fs_file_open(const char *filename);
+
+/*
+ * fs_file_size - Get the size of an open file
+ *
+ * @file: File handle from fs_file_open()
+ * @return the file size in bytes
+ */
+loff_t fs_file_size(struct fs_file *file);
+
+/*
+ * fs_file_read - Read from an open file
+ *
+ * @file: File handle from fs_file_open()
+ * @addr: The address to read into
+ * @offset: The offset in file to read from
+ * @len: The number of bytes to read. Maybe 0 to read up to the end
+ * @actread: Returns the actual number of bytes read
+ * @return 0 if ok with valid *actread, non-zero on error
+ */
+int fs_file_read(struct fs_file *file, ulong addr, loff_t offset, loff_t len,
+		 loff_t *actread);
+
+/*
+ * fs_file_close - Close a file handle
+ *
+ * @file: File handle from fs_file_open(), may be NULL
+ */
+void fs_file_close(struct fs_file *file);
+
 /*
  * Directory entry types, matches the subset of DT_x in posix readdir()
  * which apply to u-boot.
@@ -13,4 +13,21 @@
 int fs_devread(struct blk_desc *, disk_partition_t *, lbaint_t, int, int,
 	       char *);
 
+/**
+ * fs_devread_blocks() - Read whole blocks into a buffer of any alignment
+ *
+ * If @buf is not aligned for DMA, all but the last block are read to the
+ * first aligned address in @buf and moved down, and the last block is read
+ * through an aligned sector buffer. This avoids the block driver bouncing
+ * (and allocating) the whole transfer.
+ *
+ * @blk: Block device to read from
+ * @start: First block to read
+ * @blkcnt: Number of blocks to read
+ * @buf: Buffer to read into, at least @blkcnt blocks long
+ * @return 0 if OK, -EIO on error
+ */
+int fs_devread_blocks(struct blk_desc *blk, lbaint_t start, lbaint_t blkcnt,
+		      void *buf);
+
 #endif /* __U_BOOT_FS_INTERNAL_H__ */
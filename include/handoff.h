@@ -12,10 +12,35 @@
 
 #include <asm/handoff.h>
 
+struct clk;
+
+/* Number of clock rates which SPL can pass on */
+#define HANDOFF_CLKS		8
+#define HANDOFF_CLK_NAME_LEN	32
+
+/**
+ * struct handoff_clk - a clock rate programmed by SPL
+ *
+ * @dev: Name of the clock device
+ * @id: Clock ID within that device
+ * @rate: Rate that was asked for, 0 once U-Boot proper has looked at it
+ * @actual: Rate that the driver actually set
+ */
+struct handoff_clk {
+	char dev[HANDOFF_CLK_NAME_LEN];
+	u32 id;
+	u64 rate;
+	u64 actual;
+};
+
 /**
  * struct spl_handoff - information passed from SPL to U-Boot proper
  *
  * @ram_size: Value to use for gd->ram_size
+ * @baudrate: Baud rate of the SPL console
+ * @console_seq: Sequence number of the SPL console, -1 if none
+ * @clk_count: Number of valid entries in @clk
+ * @clk: Clock rates set by SPL
  */
 struct spl_handoff {
 	struct arch_spl_handoff arch;
@@ -26,11 +51,67 @@ struct spl_handoff {
 		u64 size;
 	} ram_bank[CONFIG_NR_DRAM_BANKS];
 #endif
+#ifdef CONFIG_HANDOFF_DEVICES
+	u32 baudrate;
+	s32 console_seq;
+	u32 clk_count;
+	struct handoff_clk clk[HANDOFF_CLKS];
+#endif
 };
 
 void handoff_save_dram(struct spl_handoff *ho);
 void handoff_load_dram_size(struct spl_handoff *ho);
 void handoff_load_dram_banks(struct spl_handoff *ho);
+
+#ifdef CONFIG_HANDOFF_DEVICES
+/**
+ * handoff_init_devices() - Start with no device state in the handoff
+ *
+ * @ho: Handoff information to set up
+ */
+void handoff_init_devices(struct spl_handoff *ho);
+
+/**
+ * handoff_save_console() - Record the console in use by SPL
+ *
+ * @ho: Handoff information to update
+ */
+void handoff_save_console(struct spl_handoff *ho);
+
+/**
+ * handoff_console_seq() - Get the sequence number of the SPL console
+ *
+ * This only returns a sequence number if the SPL console ran at the baud
+ * rate that U-Boot proper is about to use.
+ *
+ * @return sequence number, or -ENOENT if there is nothing to adopt
+ */
+int handoff_console_seq(void);
+
+/**
+ * handoff_save_clk_rate() - Record a clock rate set by SPL
+ *
+ * This does nothing until the handoff information has been set up.
+ *
+ * @clk: Clock that was set
+ * @rate: Rate that was asked for
+ * @actual: Rate that the driver set
+ */
+void handoff_save_clk_rate(struct clk *clk, ulong rate, ulong actual);
+
+/**
+ * handoff_adopt_clk_rate() - Check whether SPL already set a clock rate
+ *
+ * Only clocks of drivers with DM_FLAG_HANDOFF are adopted. The record is
+ * used once, so that later changes of the rate are always carried out.
+ *
+ * @clk: Clock about to be set
+ * @rate: Rate wanted
+ * @actualp: Returns the rate that SPL set, if adopted
+ * @return true if SPL already set the clock to @rate, false otherwise
+ */
+bool handoff_adopt_clk_rate(struct clk *clk, ulong rate, ulong *actualp);
+#endif
 #endif
 
 #endif
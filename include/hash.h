@@ -82,7 +82,9 @@ struct hash_algo {
  *
  * This common function is used to implement specific hash commands.
  *
- * @algo_name:		Hash algorithm being used (lower case!)
+ * @algo_name:		Hash algorithm being used (lower case!), or a
+ *			comma-separated list of algorithms to compute in a
+ *			single pass over the data
  * @flags:		Flags value (HASH_FLAG_...)
  * @cmdtp:		Pointer to command table entry
  * @flag:		Some flags normally 0 (see CMD_FLAG_.. above)
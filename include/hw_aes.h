@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Header file for AES hardware acceleration
+ */
+#ifndef __HW_AES_H
+#define __HW_AES_H
+
+#define HW_AES_BLOCK_SIZE	16
+
+enum hw_aes_mode {
+	HW_AES_CBC,
+	HW_AES_CTR,
+};
+
+/*
+ * Create a context for decrypting a stream with h/w acceleration
+ *
+ * @mode: Chaining mode
+ * @key: Key, of @key_len bytes
+ * @key_len: 16, 24 or 32 for AES-128, AES-192 or AES-256
+ * @iv: Initialisation vector (CBC) or initial counter block (CTR), of
+ *	HW_AES_BLOCK_SIZE bytes
+ * @ctxp: Returns the new context
+ * @return 0 if ok, -EINVAL for an unsupported key length, -ENOMEM
+ */
+int hw_aes_init(enum hw_aes_mode mode, const u8 *key, int key_len,
+		const u8 *iv, void **ctxp);
+
+/*
+ * Start decrypting the next part of the stream
+ *
+ * This returns as soon as the hardware has been started. The chaining state
+ * is kept in @ctx, so consecutive calls decrypt one contiguous stream. The
+ * caller must leave @src and @dst untouched until the next call on @ctx,
+ * which waits for the previous operation to complete. @src and @dst may be
+ * the same buffer.
+ *
+ * @ctx: Context from hw_aes_init()
+ * @src: Ciphertext
+ * @dst: Destination of the plain data
+ * @len: Number of bytes, a multiple of HW_AES_BLOCK_SIZE
+ * @return 0 if ok, -EINVAL if the hardware cannot reach a buffer (the caller
+ * should then fall back to another method), other -ve on error
+ */
+int hw_aes_decrypt(void *ctx, const void *src, void *dst, unsigned int len);
+
+/*
+ * Wait for the last decryption, then free the context
+ *
+ * @ctx: Context from hw_aes_init()
+ * @return 0 if ok, -ve if this or any earlier part of the stream failed
+ */
+int hw_aes_finish(void *ctx);
+
+#endif
@@ -84,6 +84,25 @@ int hw_sha_init(struct hash_algo *algo, void **ctxp);
 int hw_sha_update(struct hash_algo *algo, void *ctx, const void *buf,
 		  unsigned int size, int is_last);
 
+/*
+ * Start hashing a buffer without waiting for the hardware to finish
+ *
+ * This behaves like hw_sha_update() except that it returns as soon as the
+ * hardware has been started. The caller must leave @buf untouched until
+ * the next hw_sha_update_async() or hw_sha_finish() call on @ctx, which
+ * waits for the previous operation to complete. This lets the CPU prepare
+ * the next buffer while the current one is being hashed.
+ *
+ * @algo: Pointer to the hash_algo struct
+ * @ctx: Pointer to the context for hashing
+ * @buf: Pointer to the buffer being hashed
+ * @size: Size of the buffer being hashed
+ * @is_last: 1 if this is the last update; 0 otherwise
+ * @return 0 if ok, -ve on error
+ */
+int hw_sha_update_async(struct hash_algo *algo, void *ctx, const void *buf,
+			unsigned int size, int is_last);
+
 /*
  * Copy sha hash result at destination location
  *
@@ -98,4 +117,24 @@ int hw_sha_update(struct hash_algo *algo, void *ctx, const void *buf,
 int hw_sha_finish(struct hash_algo *algo, void *ctx, void *dest_buf,
 		  int size);
 
+/*
+ * Compute a hash over a list of memory regions in a single pass
+ *
+ * The regions are handed to the hardware as a scatter-gather list so that
+ * they are hashed in place, without being copied into a bounce buffer.
+ *
+ * @algo: Pointer to the hash_algo struct
+ * @region: Array of regions to hash, in order
+ * @region_count: Number of entries in @region
+ * @dest_buf: Pointer to the destination buffer where hash is to be copied
+ * @size: Size of the destination buffer
+ * @return 0 if ok, -EINVAL if the algorithm or a region cannot be handled by
+ * the hardware (the caller should then fall back to another method), other
+ * -ve on error
+ */
+struct image_region;
+int hw_sha_digest_sg(struct hash_algo *algo,
+		     const struct image_region region[], int region_count,
+		     void *dest_buf, int size);
+
 #endif
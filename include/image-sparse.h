@@ -23,6 +23,24 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	/*
+	 * Optional: make the blocks read back as the 32-bit pattern fill_val
+	 * without transferring any data. Returns the number of blocks used,
+	 * like write(), or 0 if the storage can't do that for fill_val.
+	 */
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt,
+				 uint32_t fill_val);
+
+	/*
+	 * Optional: replaces reserve() for blocks whose contents don't
+	 * matter, so that the storage can drop them.
+	 */
+	lbaint_t	(*discard)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+
 	void		(*mssg)(const char *str, char *response);
 };
 
@@ -37,5 +55,34 @@ static inline int is_sparse_image(void *buf)
 	return 0;
 }
 
+/*
+ * A sparse image which is written while it arrives, see sparse_stream_write()
+ */
+struct sparse_stream {
+	struct sparse_storage	*info;
+	sparse_header_t		hdr;		/* zero until it was read */
+	lbaint_t		blk;		/* next block to write */
+	unsigned int		chunk;		/* chunks started so far */
+	lbaint_t		raw_left;	/* blocks to come in a RAW chunk */
+	unsigned int		skip;		/* bytes of chunk data to skip */
+	uint32_t		bytes_written;
+	uint32_t		total_blocks;
+};
+
 int write_sparse_image(struct sparse_storage *info, const char *part_name,
 		       void *data, char *response);
+
+void sparse_stream_init(struct sparse_stream *stream,
+			struct sparse_storage *info);
+
+/*
+ * Write the next part of a sparse image. Only whole headers and blocks are
+ * used, *consumedp returns how much of the data that was; the rest has to
+ * be passed again, followed by more data. Returns 0 or -1 on error.
+ */
+int sparse_stream_write(struct sparse_stream *stream, const void *data,
+			size_t len, size_t *consumedp, char *response);
+
+/* Check that the whole image was written. Returns 0 or -1 on error. */
+int sparse_stream_finish(struct sparse_stream *stream, const char *part_name,
+			 char *response);
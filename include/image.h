@@ -41,6 +41,10 @@ struct fdt_region;
 
 #define IMAGE_ENABLE_IGNORE	0
 #define IMAGE_INDENT_STRING	""
+#define IMAGE_ENABLE_FIT_VERIFY_CACHE	0
+#define IMAGE_ENABLE_FIT_PARALLEL_VERIFY	0
+#define IMAGE_ENABLE_DECRYPT	0
+#define IMAGE_ENABLE_FIT_LAZY	0
 
 #else
 
@@ -54,6 +58,10 @@ struct fdt_region;
 
 #define IMAGE_ENABLE_FIT	CONFIG_IS_ENABLED(FIT)
 #define IMAGE_ENABLE_OF_LIBFDT	CONFIG_IS_ENABLED(OF_LIBFDT)
+#define IMAGE_ENABLE_FIT_VERIFY_CACHE	CONFIG_IS_ENABLED(FIT_VERIFY_CACHE)
+#define IMAGE_ENABLE_FIT_PARALLEL_VERIFY	CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+#define IMAGE_ENABLE_DECRYPT	CONFIG_IS_ENABLED(FIT_CIPHER)
+#define IMAGE_ENABLE_FIT_LAZY	CONFIG_IS_ENABLED(FIT_LAZY_LOAD)
 
 #endif /* USE_HOSTCC */
 
@@ -320,6 +328,7 @@ enum {
 	IH_COMP_LZMA,			/* lzma  Compression Used	*/
 	IH_COMP_LZO,			/* lzo   Compression Used	*/
 	IH_COMP_LZ4,			/* lz4   Compression Used	*/
+	IH_COMP_ZSTD,			/* zstd  Compression Used	*/
 
 	IH_COMP_COUNT,
 };
@@ -389,6 +398,22 @@ typedef struct bootm_headers {
 	void		*fit_hdr_setup;	/* x86 setup FIT image header */
 	const char	*fit_uname_setup; /* x86 setup subimage node name */
 	int		fit_noffset_setup;/* x86 setup subimage node offset */
+
+#if IMAGE_ENABLE_FIT_VERIFY_CACHE
+	/*
+	 * Configurations and subimages verified so far, so that loading
+	 * the next subimage of the same configuration does not check them
+	 * again. An entry is dropped once anything is loaded over its data.
+	 */
+#define FIT_VERIFIED_MAX	8
+	struct fit_verified {
+		const void	*fit;
+		int		noffset;
+		const void	*data;
+		ulong		size;
+	} fit_verified[FIT_VERIFIED_MAX];
+	int		fit_verified_count;
+#endif
 #endif
 
 #ifndef USE_HOSTCC
@@ -722,8 +747,11 @@ int boot_get_fdt(int flag, int argc, char * const argv[], uint8_t arch,
 void boot_fdt_add_mem_rsv_regions(struct lmb *lmb, void *fdt_blob);
 int boot_relocate_fdt(struct lmb *lmb, char **of_flat_tree, ulong *of_size);
 
+bool boot_addr_in_ram(ulong addr, ulong len);
 int boot_ramdisk_high(struct lmb *lmb, ulong rd_data, ulong rd_len,
 		  ulong *initrd_start, ulong *initrd_end);
+ulong boot_ramdisk_plan(bootm_headers_t *images, ulong load, ulong len,
+			ulong img_start, ulong img_end);
 int boot_get_cmdline(struct lmb *lmb, ulong *cmd_start, ulong *cmd_end);
 #ifdef CONFIG_SYS_BOOT_GET_KBD
 int boot_get_kbd(struct lmb *lmb, bd_t **kbd);
@@ -927,12 +955,19 @@ int booti_setup(ulong image, ulong *relocated_addr, ulong *size,
 #define FIT_VALUE_PROP		"value"
 #define FIT_IGNORE_PROP		"uboot-ignore"
 #define FIT_SIG_NODENAME	"signature"
+#define FIT_KEY_HINT		"key-name-hint"
+
+/* cipher node */
+#define FIT_CIPHER_NODENAME	"cipher"
+#define FIT_CIPHER_KEY_PROP	"key"
+#define FIT_CIPHER_IV_PROP	"iv"
 
 /* image node */
 #define FIT_DATA_PROP		"data"
 #define FIT_DATA_POSITION_PROP	"data-position"
 #define FIT_DATA_OFFSET_PROP	"data-offset"
 #define FIT_DATA_SIZE_PROP	"data-size"
+#define FIT_DATA_SIZE_UNCIPHERED_PROP	"data-size-unciphered"
 #define FIT_TIMESTAMP_PROP	"timestamp"
 #define FIT_DESC_PROP		"description"
 #define FIT_ARCH_PROP		"arch"
@@ -952,6 +987,7 @@ int booti_setup(ulong image, ulong *relocated_addr, ulong *size,
 #define FIT_FPGA_PROP		"fpga"
 #define FIT_FIRMWARE_PROP	"firmware"
 #define FIT_STANDALONE_PROP	"standalone"
+#define FIT_COMPATIBLE_PROP	"compatible"
 
 #define FIT_MAX_HASH_LEN	HASH_MAX_DIGEST_SIZE
 
@@ -1053,6 +1089,48 @@ int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 
 int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       const void *data, size_t size);
+int fit_image_copy_verify(const void *fit, int image_noffset, void *dst,
+			  const void *src, size_t size);
+
+/* Ciphered subimages, see common/image-cipher.c */
+struct fit_cipher;
+bool fit_image_has_cipher(const void *fit, int image_noffset);
+int fit_image_cipher_init(const void *fit, int image_noffset,
+			  struct fit_cipher **cp, size_t *plain_sizep);
+int fit_cipher_decrypt(struct fit_cipher *c, const void *src, void *dst,
+		       size_t len);
+int fit_cipher_finish(struct fit_cipher *c);
+int fit_image_decrypt_copy(const void *fit, int image_noffset, void *dst,
+			   const void *src, size_t size, bool verify,
+			   size_t *lenp);
+
+/**
+ * struct fit_lazy_src - Where a lazily loaded FIT is read from
+ *
+ * @read: Read @size bytes at @offset from the start of the FIT to @buf,
+ *	returning 0 or -ve on error
+ */
+struct fit_lazy_src {
+	int (*read)(struct fit_lazy_src *src, ulong offset, ulong size,
+		    void *buf);
+};
+
+/**
+ * fit_lazy_open() - Read the FDT part of a FIT and set it up for lazy loading
+ *
+ * The data of subimages with external data is then only read when it is
+ * used. @src must stay valid until the next call.
+ *
+ * @src:	Source of the FIT
+ * @buf:	Where to put the FDT part of the FIT
+ * @return 0 if OK, -ENOEXEC if this is no FIT, other -ve on read error
+ */
+int fit_lazy_open(struct fit_lazy_src *src, void *buf);
+bool fit_is_lazy(const void *fit);
+/* Have the data of a subimage read to @dst rather than to the heap */
+void fit_lazy_set_dest(const void *fit, int noffset, void *dst);
+int fit_lazy_get_data(const void *fit, int noffset, ulong offset, size_t size,
+		      const void **datap);
 int fit_image_verify(const void *fit, int noffset);
 int fit_config_verify(const void *fit, int conf_noffset);
 int fit_all_image_verify(const void *fit);
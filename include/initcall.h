@@ -11,15 +11,36 @@ typedef int (*init_fnc_t)(void);
 #include <common.h>
 #include <initcall.h>
 #include <efi.h>
+#include <malloc.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if defined(CONFIG_INITCALL_TIMING) && CONFIG_IS_ENABLED(BOOTSTAGE)
+/* Add the initcalls which are slow to the bootstage report */
+static inline void initcall_timing_report(void *func, ulong start_us)
+{
+	u32 duration_us = timer_get_boot_us() - start_us;
+	char *name;
+
+	if (duration_us < CONFIG_INITCALL_TIMING_MIN_US)
+		return;
+
+	/* Look up the address in System.map */
+	name = malloc(20);
+	if (!name)
+		return;
+	snprintf(name, 20, "initcall %p", func);
+	bootstage_add_accum(name, start_us, duration_us);
+}
+#endif
+
 static inline int initcall_run_list(const init_fnc_t init_sequence[])
 {
 	const init_fnc_t *init_fnc_ptr;
 
 	for (init_fnc_ptr = init_sequence; *init_fnc_ptr; ++init_fnc_ptr) {
 		unsigned long reloc_ofs = 0;
+		__maybe_unused ulong start_us = 0;
 		int ret;
 
 		if (gd->flags & GD_FLG_RELOC)
@@ -32,7 +53,17 @@ static inline int initcall_run_list(const init_fnc_t init_sequence[])
 			debug(" (relocated to %p)\n", (char *)*init_fnc_ptr);
 		else
 			debug("\n");
+#if defined(CONFIG_INITCALL_TIMING) && CONFIG_IS_ENABLED(BOOTSTAGE)
+		/* Bootstage is only set up by one of the initcalls */
+		if (gd->bootstage)
+			start_us = timer_get_boot_us();
+#endif
 		ret = (*init_fnc_ptr)();
+#if defined(CONFIG_INITCALL_TIMING) && CONFIG_IS_ENABLED(BOOTSTAGE)
+		if (start_us)
+			initcall_timing_report((char *)*init_fnc_ptr - reloc_ofs,
+					       start_us);
+#endif
 		if (ret) {
 			printf("initcall sequence %p failed at call %p (err=%d)\n",
 			       init_sequence,
@@ -21,19 +21,63 @@ enum iotrace_flags {
 	IOT_WRITE = 1 << 3,
 };
 
+/* Maximum number of regions which can be traced at once */
+#define IOTRACE_MAX_REGIONS	8
+
+#define IOTRACE_MAGIC		0x494f5452	/* "IOTR" */
+#define IOTRACE_VERSION		1
+
+/**
+ * struct iotrace_hdr - Header at the start of the iotrace buffer
+ *
+ * The buffer can be saved to a file and decoded on the host. Records
+ * follow the header.
+ *
+ * @magic: IOTRACE_MAGIC
+ * @version: IOTRACE_VERSION
+ * @rec_size: Size of each record in bytes
+ * @tick_rate: Rate of the timer used for timestamps, in Hz
+ * @count: Number of records in the buffer
+ */
+struct iotrace_hdr {
+	u32 magic;
+	u16 version;
+	u16 rec_size;
+	u32 tick_rate;
+	u32 count;
+};
+
 /**
  * struct iotrace_record - Holds a single I/O trace record
  *
- * @flags: I/O access type
- * @timestamp: Timestamp of access
- * @addr: Address of access
+ * @ticks: Timer ticks at the start of the access (bottom 32 bits). Records
+ *	are in order, so the reader can account for wrapping.
  * @value: Value written or read
+ * @addr: Address of access
+ * @duration: Timer ticks taken by the access, saturated at 0xffff
+ * @flags: I/O access type (enum iotrace_flags)
  */
 struct iotrace_record {
-	enum iotrace_flags flags;
-	u64 timestamp;
+	u32 ticks;
+	u32 value;
+	phys_addr_t addr;
+	u16 duration;
+	u8 flags;
+};
+
+/**
+ * struct iotrace_summary - Accesses to one register, in summary mode
+ *
+ * @addr: Address of register
+ * @reads: Number of reads
+ * @writes: Number of writes
+ * @ticks: Total timer ticks taken by the accesses
+ */
+struct iotrace_summary {
 	phys_addr_t addr;
-	iovalue_t value;
+	u32 reads;
+	u32 writes;
+	u64 ticks;
 };
 
 /*
@@ -90,7 +134,8 @@ u32 iotrace_get_checksum(void);
  * iotrace_set_region() - Set whether iotrace is limited to a specific
  * io region.
  *
- * Defines the address and size of the limited region.
+ * Defines the address and size of the limited region. This replaces any
+ * regions added before.
  *
  * @start: address of the beginning of the region
  * @size: size of the region in bytes.
@@ -98,17 +143,32 @@ u32 iotrace_get_checksum(void);
 void iotrace_set_region(ulong start, ulong size);
 
 /**
- * iotrace_reset_region() - Reset the region limit
+ * iotrace_add_region() - Add a region to trace
+ *
+ * Once a region is added, only accesses within one of the regions are
+ * traced.
+ *
+ * @start: address of the beginning of the region
+ * @size: size of the region in bytes
+ * @return 0 if OK, -ENOSPC if IOTRACE_MAX_REGIONS regions are already set
+ */
+int iotrace_add_region(ulong start, ulong size);
+
+/**
+ * iotrace_reset_region() - Reset the region limit, so all accesses are
+ * traced
  */
 void iotrace_reset_region(void);
 
 /**
  * iotrace_get_region() - Get region information
  *
+ * @idx: Index of region (0 for the first)
  * @start: Returns start address of region
  * @size: Returns size of region in bytes
+ * @return 0 if OK, -ENOENT if there is no region @idx
  */
-void iotrace_get_region(ulong *start, ulong *size);
+int iotrace_get_region(int idx, ulong *start, ulong *size);
 
 /**
  * iotrace_set_enabled() - Set whether iotracing is enabled or not
@@ -127,11 +187,34 @@ void iotrace_set_enabled(int enable);
  */
 int iotrace_get_enabled(void);
 
+/**
+ * iotrace_set_summary() - Set whether to count accesses instead of
+ * recording them
+ *
+ * In summary mode no records are written. Instead the number of reads and
+ * writes and the time taken by them are totalled for each register, in a
+ * table which is cleared when summary mode is enabled.
+ *
+ * @enable: true to enable summary mode, false to record accesses
+ * @return 0 if OK, -ENOMEM if there is no memory for the table
+ */
+int iotrace_set_summary(bool enable);
+
+/**
+ * iotrace_get_summary() - Get the per-register totals
+ *
+ * @countp: Returns the number of entries in the table. Entries with no
+ *	reads or writes are unused.
+ * @return table of totals, in no particular order, or NULL if summary
+ *	mode was never enabled
+ */
+struct iotrace_summary *iotrace_get_summary(int *countp);
+
 /**
  * iotrace_set_buffer() - Set position and size of iotrace buffer
  *
- * Defines where the iotrace buffer goes, and resets the output pointer to
- * the start of the buffer.
+ * Defines where the iotrace buffer goes, writes a struct iotrace_hdr at
+ * its start and resets the output pointer to follow the header.
  *
  * The buffer can be 0 size in which case the checksum is updated but no
  * trace records are writen. If the buffer is exhausted, the offset will
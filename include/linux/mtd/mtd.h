@@ -148,6 +148,20 @@ struct nand_ecclayout {
 
 struct module;	/* only needed for owner field in mtd_info */
 
+/**
+ * struct mtd_cache_stats - page cache statistics of an MTD device
+ * @hits: pages served from the cache
+ * @misses: pages read from the flash and added to the cache
+ * @invalidated: cached pages dropped by a write or an erase
+ * @crc_errors: cached pages dropped because their CRC did not match
+ */
+struct mtd_cache_stats {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long invalidated;
+	unsigned long crc_errors;
+};
+
 struct mtd_info {
 	u_char type;
 	uint32_t flags;
@@ -296,6 +310,10 @@ struct mtd_info {
 
 	/* ECC status information */
 	struct mtd_ecc_stats ecc_stats;
+#ifdef CONFIG_MTD_PAGE_CACHE
+	/* Page cache statistics */
+	struct mtd_cache_stats cache_stats;
+#endif
 	/* Subpage shift (NAND) */
 	int subpage_sft;
 
@@ -247,6 +247,19 @@ enum spi_nor_option_flags {
 	SNOR_F_BROKEN_RESET	= BIT(6),
 };
 
+/**
+ * struct spi_nor_erase_type - Structure to describe a SPI NOR erase type
+ * @size:		the size of the sector/block erased by the erase type,
+ *			0 if the slot is unused
+ * @opcode:		the SPI command op code to erase the sector/block
+ */
+struct spi_nor_erase_type {
+	u32	size;
+	u8	opcode;
+};
+
+#define SNOR_ERASE_TYPE_MAX	4
+
 /**
  * struct flash_info - Forward declaration of a structure used internally by
  *		       spi_nor_scan()
@@ -265,6 +278,8 @@ struct flash_info;
  * @page_size:		the page size of the SPI NOR
  * @addr_width:		number of address bytes
  * @erase_opcode:	the opcode for erasing a sector
+ * @erase_types:	the erase types supported by the flash, used to erase
+ *			large ranges with fewer, bigger erase commands
  * @read_opcode:	the read opcode
  * @read_dummy:		the dummy needed by the read operation
  * @program_opcode:	the program opcode
@@ -303,6 +318,7 @@ struct spi_nor {
 	u32			page_size;
 	u8			addr_width;
 	u8			erase_opcode;
+	struct spi_nor_erase_type erase_types[SNOR_ERASE_TYPE_MAX];
 	u8			read_opcode;
 	u8			read_dummy;
 	u8			program_opcode;
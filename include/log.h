@@ -9,6 +9,7 @@
 #ifndef __LOG_H
 #define __LOG_H
 
+#include <stdarg.h>
 #include <dm/uclass-id.h>
 #include <linux/list.h>
 
@@ -231,7 +232,10 @@ void __assert_fail(const char *assertion, const char *file, unsigned int line,
  * @file: Name of file where the log record was generated (not allocated)
  * @line: Line number where the log record was generated
  * @func: Function where the log record was generated (not allocated)
- * @msg: Log message (allocated)
+ * @msg: Log message (allocated), NULL for drivers with LOGDF_RAW
+ * @fmt: printf() format string of the message (not allocated)
+ * @args: Arguments for @fmt. Only valid during emit() for drivers with
+ *	LOGDF_RAW, which must va_copy() it before use
  */
 struct log_rec {
 	enum log_category_t cat;
@@ -240,17 +244,29 @@ struct log_rec {
 	int line;
 	const char *func;
 	const char *msg;
+	const char *fmt;
+	va_list *args;
 };
 
 struct log_device;
 
+/* Flags for struct log_driver */
+enum log_driver_flags {
+	LOGDF_RAW	= 1 << 0,	/* Takes @fmt and @args, not @msg */
+};
+
 /**
  * struct log_driver - a driver which accepts and processes log records
  *
+ * The message is only formatted if a driver without LOGDF_RAW accepts the
+ * record.
+ *
  * @name: Name of driver
+ * @flags: Flags for this driver (enum log_driver_flags)
  */
 struct log_driver {
 	const char *name;
+	unsigned short flags;
 	/**
 	 * emit() - emit a log record
 	 *
@@ -394,6 +410,41 @@ int log_add_filter(const char *drv_name, enum log_category_t cat_list[],
  */
 int log_remove_filter(const char *drv_name, int filter_num);
 
+#if CONFIG_IS_ENABLED(LOG_RING)
+/**
+ * log_ring_finish() - Format the records in the log ring
+ *
+ * The log ring holds printf() arguments and pointers into the current
+ * image, which are no use to a later boot phase or the OS. This replaces
+ * each such record with its formatted message. It is called before SPL
+ * jumps to the next phase and before an OS is booted.
+ */
+void log_ring_finish(void);
+
+/**
+ * log_ring_dump() - Show the records in the log ring on the console
+ */
+void log_ring_dump(void);
+
+/**
+ * log_ring_fdt_setup() - Tell the OS where the log ring is
+ *
+ * This formats the log ring with log_ring_finish(), reserves its memory
+ * and adds its location to /chosen as "u-boot,log-start" and
+ * "u-boot,log-end".
+ *
+ * @blob: Device tree to update
+ * @return 0 if OK (including if there is no log ring), -ve FDT error
+ */
+int log_ring_fdt_setup(void *blob);
+#else
+static inline void log_ring_finish(void) {}
+static inline int log_ring_fdt_setup(void *blob)
+{
+	return 0;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(LOG)
 /**
  * log_init() - Set up the log system ready for use
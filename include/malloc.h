@@ -893,6 +893,17 @@ void malloc_simple_info(void);
 # define pvALLOc		dlpvalloc
 # define mALLINFo	dlmallinfo
 # define mALLOPt		dlmallopt
+# elif CONFIG_IS_ENABLED(MALLOC_PROFILE)
+/* malloc(), etc. are wrappers in malloc_profile.c */
+# define cALLOc		dlcalloc
+# define fREe		dlfree
+# define mALLOc		dlmalloc
+# define mEMALIGn	dlmemalign
+# define rEALLOc		dlrealloc
+# define vALLOc		valloc
+# define pvALLOc		pvalloc
+# define mALLINFo	mallinfo
+# define mALLOPt		mallopt
 # else /* USE_DL_PREFIX */
 # define cALLOc		calloc
 # define fREe		free
@@ -949,6 +960,14 @@ struct mallinfo mALLINFo();
 #endif
 #pragma GCC visibility pop
 
+#if CONFIG_IS_ENABLED(MALLOC_PROFILE) && !CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
+void *malloc(size_t bytes);
+void free(void *ptr);
+void *realloc(void *oldmem, size_t bytes);
+void *memalign(size_t alignment, size_t bytes);
+void *calloc(size_t nmemb, size_t size);
+#endif
+
 /*
  * Begin and End of memory area for malloc(), and current "brk"
  */
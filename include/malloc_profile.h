@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Heap allocation profiling
+ *
+ * With CONFIG_MALLOC_PROFILE every malloc() and free() is recorded: the
+ * bytes in use and their peak, the number of allocations from each call
+ * site and a histogram of the free chunks in the heap.
+ */
+
+#ifndef __MALLOC_PROFILE_H
+#define __MALLOC_PROFILE_H
+
+/* Number of free-chunk size buckets: 16 bytes, 32 bytes, ... 1MB and up */
+#define MALLOC_PROFILE_BUCKETS	17
+
+/**
+ * struct malloc_profile_handoff - heap usage of SPL, passed in the bloblist
+ *
+ * @simple_used: Bytes used in the simple (pre-relocation) malloc() pool
+ * @simple_size: Size of that pool
+ * @heap_used: Bytes of the full malloc() heap that were ever used
+ * @heap_size: Size of the full malloc() heap (0 if none)
+ * @peak: Peak bytes in use in the full malloc() heap
+ * @allocs: Number of allocations
+ * @frees: Number of frees
+ * @fails: Number of allocations which failed
+ */
+struct malloc_profile_handoff {
+	u32 simple_used;
+	u32 simple_size;
+	u32 heap_used;
+	u32 heap_size;
+	u32 peak;
+	u32 allocs;
+	u32 frees;
+	u32 fails;
+};
+
+#if CONFIG_IS_ENABLED(MALLOC_PROFILE)
+/**
+ * malloc_profile_alloc() - Record an allocation
+ *
+ * @ptr: Memory that was allocated, or NULL if the allocation failed
+ * @bytes: Number of bytes requested
+ * @caller: Return address of the caller of malloc(), etc.
+ */
+void malloc_profile_alloc(void *ptr, size_t bytes, void *caller);
+
+/**
+ * malloc_profile_free() - Record a free, before the memory is freed
+ *
+ * @ptr: Memory that is to be freed (may be NULL)
+ */
+void malloc_profile_free(void *ptr);
+
+/**
+ * malloc_profile_show() - Show heap usage, call sites and free chunks
+ */
+void malloc_profile_show(void);
+
+/**
+ * malloc_profile_handoff() - Write SPL's heap usage to the bloblist
+ *
+ * @return 0 if OK, -ENOSPC if the bloblist is full
+ */
+int malloc_profile_handoff(void);
+#else
+static inline void malloc_profile_alloc(void *ptr, size_t bytes, void *caller)
+{
+}
+
+static inline void malloc_profile_free(void *ptr)
+{
+}
+
+static inline int malloc_profile_handoff(void)
+{
+	return -ENOSYS;
+}
+#endif
+
+/**
+ * malloc_free_histogram() - Count the free chunks in the malloc() heap
+ *
+ * @hist: Returns the number of free chunks of each size. Entry n counts
+ *	chunks of at least 16 << n bytes, the last entry everything larger
+ * @largestp: Returns the size of the largest free chunk, not counting the
+ *	top chunk
+ * @return size of the top chunk, i.e. the space at the end of the heap
+ */
+ulong malloc_free_histogram(uint hist[MALLOC_PROFILE_BUCKETS],
+			    ulong *largestp);
+
+#endif
@@ -73,6 +73,8 @@
 
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_DATA_STAT_AFTER_ERASE	0x00800000
+#define SD_SCR_CMD23	0x00000002
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -119,6 +121,7 @@
 
 #define SD_CMD_APP_SET_BUS_WIDTH	6
 #define SD_CMD_APP_SD_STATUS		13
+#define SD_CMD_APP_SET_WR_BLK_ERASE_COUNT	23
 #define SD_CMD_ERASE_WR_BLK_START	32
 #define SD_CMD_ERASE_WR_BLK_END		33
 #define SD_CMD_APP_SEND_OP_COND		41
@@ -168,6 +171,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define MMC_STATUS_CURR_STATE	(0xf << 9)
 #define MMC_STATUS_ERROR	(1 << 19)
 
+#define MMC_STATE_TRANS		(4 << 9)
 #define MMC_STATE_PRG		(7 << 9)
 
 #define MMC_VDD_165_195		0x00000080	/* VDD voltage 1.65 - 1.95 */
@@ -218,6 +222,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_ERASE_GROUP_DEF		175	/* R/W */
 #define EXT_CSD_BOOT_BUS_WIDTH		177
 #define EXT_CSD_PART_CONF		179	/* R/W */
+#define EXT_CSD_ERASED_MEM_CONT		181	/* RO */
 #define EXT_CSD_BUS_WIDTH		183	/* R/W */
 #define EXT_CSD_HS_TIMING		185	/* R/W */
 #define EXT_CSD_REV			192	/* RO */
@@ -226,6 +231,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_HC_WP_GRP_SIZE		221	/* RO */
 #define EXT_CSD_HC_ERASE_GRP_SIZE	224	/* RO */
 #define EXT_CSD_BOOT_MULT		226	/* RO */
+#define EXT_CSD_SEC_FEATURE_SUPPORT	231	/* RO */
 #define EXT_CSD_BKOPS_SUPPORT		502	/* RO */
 
 /*
@@ -293,6 +299,8 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_WR_DATA_REL_USR		(1 << 0)	/* user data area WR_REL */
 #define EXT_CSD_WR_DATA_REL_GP(x)	(1 << ((x)+1))	/* GP part (x+1) WR_REL */
 
+#define EXT_CSD_SEC_GB_CL_EN		(1 << 4)	/* TRIM is supported */
+
 #define R1_ILLEGAL_COMMAND		(1 << 22)
 #define R1_APP_CMD			(1 << 5)
 
@@ -577,11 +585,13 @@ struct mmc {
 	uint has_init;
 	int high_capacity;
 	bool clk_disable; /* true if the clock can be turned off */
+	bool adopted; /* true if the card is taken over from the last phase */
 	uint bus_width;
 	uint clock;
 	enum mmc_voltage signal_voltage;
 	uint card_caps;
 	uint host_caps;
+	bool set_block_count; /* true if the card supports CMD23 */
 	uint ocr;
 	uint dsr;
 	uint dsr_imp;
@@ -689,6 +699,45 @@ void mmc_destroy(struct mmc *mmc);
 int mmc_unbind(struct udevice *dev);
 int mmc_initialize(bd_t *bis);
 int mmc_init(struct mmc *mmc);
+
+#define MMC_HANDOFF_CARDS	2
+
+/**
+ * struct mmc_handoff_card - State of a card left in transfer state
+ *
+ * SPL records each card it initialises in the BLOBLISTT_MMC_HANDOFF blob,
+ * for U-Boot proper to carry on with the card where SPL left it instead of
+ * resetting it and enumerating it again.
+ *
+ * @name: Name of the host (mmc->cfg->name), empty if unused
+ * @cid: Card identification
+ * @csd: Card-specific data
+ * @ocr: Operating conditions
+ * @version: Card version (mmc->version)
+ * @high_capacity: Block addressed card
+ * @rca: Relative card address
+ * @mode: Bus mode (enum bus_mode)
+ * @bus_width: Bus width in bits
+ * @signal_voltage: Signal voltage (enum mmc_voltage)
+ * @clock: Bus clock in Hz
+ */
+struct mmc_handoff_card {
+	char name[32];
+	u32 cid[4];
+	u32 csd[4];
+	u32 ocr;
+	u32 version;
+	u32 high_capacity;
+	u16 rca;
+	u8 mode;
+	u8 bus_width;
+	u32 signal_voltage;
+	u32 clock;
+};
+
+struct mmc_handoff {
+	struct mmc_handoff_card card[MMC_HANDOFF_CARDS];
+};
 int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error);
 
 #if CONFIG_IS_ENABLED(MMC_UHS_SUPPORT) || \
@@ -789,6 +838,41 @@ int mmc_rpmb_route_frames(struct mmc *mmc, void *req, unsigned long reqlen,
 int mmc_set_bkops_enable(struct mmc *mmc);
 #endif
 
+/**
+ * mmc_can_trim() - Check whether single blocks can be erased
+ *
+ * SD cards erase single blocks with CMD38, eMMC devices need TRIM for that.
+ *
+ * @mmc:	MMC device
+ * @fillp:	Returns the 32-bit pattern that erased blocks read back as
+ * @return true if mmc_berase_arg() with MMC_TRIM_ARG erases any range
+ */
+bool mmc_can_trim(struct mmc *mmc, u32 *fillp);
+
+/**
+ * mmc_can_discard() - Check whether the device supports DISCARD
+ *
+ * @mmc:	MMC device
+ * @return true if mmc_berase_arg() with MMC_DISCARD_ARG can be used
+ */
+bool mmc_can_discard(struct mmc *mmc);
+
+/**
+ * mmc_berase_arg() - Erase blocks with a particular CMD38 argument
+ *
+ * MMC_ERASE_ARG erases whole erase groups, MMC_TRIM_ARG and
+ * MMC_DISCARD_ARG only the blocks asked for. SD cards always use a plain
+ * erase.
+ *
+ * @block_dev:	Block device, for the hardware partition
+ * @start:	First block to erase
+ * @blkcnt:	Number of blocks to erase
+ * @arg:	MMC_ERASE_ARG, MMC_TRIM_ARG or MMC_DISCARD_ARG
+ * @return number of blocks erased
+ */
+ulong mmc_berase_arg(struct blk_desc *block_dev, lbaint_t start,
+		     lbaint_t blkcnt, uint arg);
+
 /**
  * Start device initialization and return immediately; it does not block on
  * polling OCR (operation condition register) status. Useful for checking
@@ -73,6 +73,15 @@ typedef void rxhand_f(uchar *pkt, unsigned dport,
 typedef void rxhand_icmp_f(unsigned type, unsigned code, unsigned dport,
 		struct in_addr sip, unsigned sport, uchar *pkt, unsigned len);
 
+/**
+ * A receive buffer lender, see net_set_rx_lender().
+ * @param ahead	number of frames the driver may receive before the one that
+ *		will use this buffer
+ * @param datap	returns where the payload of that frame should go
+ * @return number of bytes available at *datap, or 0 to lend nothing
+ */
+typedef int rx_lend_f(int ahead, uchar **datap);
+
 /*
  *	A timeout handler.  Called after time interval has expired.
  */
@@ -84,6 +93,27 @@ enum eth_state_t {
 	ETH_STATE_ACTIVE
 };
 
+/**
+ * struct eth_rx_pkt - A packet returned by eth_ops.recv_batch()
+ *
+ * @packet: The packet buffer
+ * @len: Length of the packet, 0 for a descriptor that was only reclaimed
+ *	 (e.g. a bad frame) and need not be processed
+ * @split_hdr_len: See net_rx_set_split(), when @split_data is not NULL
+ * @split_data: Where the rest of a split frame is, NULL if contiguous
+ * @csum_ok: See net_rx_set_csum_ok()
+ */
+struct eth_rx_pkt {
+	uchar *packet;
+	int len;
+	int split_hdr_len;
+	uchar *split_data;
+	bool csum_ok;
+};
+
+/* Maximum number of packets taken from a driver by one eth_rx() call */
+#define ETH_RX_BATCH	32
+
 #ifdef CONFIG_DM_ETH
 /**
  * struct eth_pdata - Platform data for Ethernet MAC controllers
@@ -92,12 +122,20 @@ enum eth_state_t {
  * @enetaddr: The Ethernet MAC address that is loaded from EEPROM or env
  * @phy_interface: PHY interface to use - see PHY_INTERFACE_MODE_...
  * @max_speed: Maximum speed of Ethernet connection supported by MAC
+ * @features: What the MAC does in hardware (enum eth_features)
  */
 struct eth_pdata {
 	phys_addr_t iobase;
 	unsigned char enetaddr[ARP_HLEN];
 	int phy_interface;
 	int max_speed;
+	uint features;
+};
+
+/* Hardware features of Ethernet MAC controllers, see eth_has_feature() */
+enum eth_features {
+	/* Fill in the IPv4 header, UDP and TCP checksums of sent frames */
+	ETH_FEATURE_TX_CSUM	= 1 << 0,
 };
 
 enum eth_recv_flags {
@@ -117,10 +155,20 @@ enum eth_recv_flags {
  *	 packet buffer in the packetp parameter. If not, return an error or 0 to
  *	 indicate that the hardware receive FIFO is empty. If 0 is returned, the
  *	 network stack will not process the empty packet, but free_pkt() will be
- *	 called if supplied
+ *	 called if supplied. Drivers refilling their ring with buffers from
+ *	 net_rx_lend() flag frames split into one with net_rx_set_split().
+ *	 Drivers whose MAC verified the checksums of the frame tell so with
+ *	 net_rx_set_csum_ok()
  * free_pkt: Give the driver an opportunity to manage its packet buffer memory
  *	     when the network stack is finished processing it. This will only be
  *	     called when no error was returned from recv - optional
+ * recv_batch: Like recv(), but return every ready packet, up to @max, in
+ *	       @pkts in one pass, so that descriptor and cache maintenance is
+ *	       done once for the batch. Returns the number of entries filled in
+ *	       or an error. Used instead of recv() when present - optional
+ * free_batch: Give back the @count packets returned by the last
+ *	       recv_batch() once they have been processed, mandatory if
+ *	       recv_batch() is provided
  * stop: Stop the hardware from looking for packets - may be called even if
  *	 state == PASSIVE
  * mcast: Join or leave a multicast group (for TFTP) - optional
@@ -139,6 +187,9 @@ struct eth_ops {
 	int (*send)(struct udevice *dev, void *packet, int length);
 	int (*recv)(struct udevice *dev, int flags, uchar **packetp);
 	int (*free_pkt)(struct udevice *dev, uchar *packet, int length);
+	int (*recv_batch)(struct udevice *dev, int flags,
+			  struct eth_rx_pkt *pkts, int max);
+	int (*free_batch)(struct udevice *dev, int count);
 	void (*stop)(struct udevice *dev);
 	int (*mcast)(struct udevice *dev, const u8 *enetaddr, int join);
 	int (*write_hwaddr)(struct udevice *dev);
@@ -154,6 +205,8 @@ struct udevice *eth_get_dev(void); /* get the current device */
  */
 struct udevice *eth_get_dev_by_name(const char *devname);
 unsigned char *eth_get_ethaddr(void); /* get the current device MAC */
+/* Test if the current device has a feature (enum eth_features) */
+bool eth_has_feature(uint feature);
 
 /* Used only when NetConsole is enabled */
 int eth_is_active(struct udevice *dev); /* Test device for active state */
@@ -200,6 +253,11 @@ static inline unsigned char *eth_get_ethaddr(void)
 	return NULL;
 }
 
+static inline bool eth_has_feature(uint feature)
+{
+	return false;
+}
+
 /* Used only when NetConsole is enabled */
 int eth_is_active(struct eth_device *dev); /* Test device for active state */
 /* Set active state */
@@ -231,6 +289,7 @@ int usb_eth_initialize(bd_t *bi);
 #endif
 
 int eth_initialize(void);		/* Initialize network subsystem */
+int eth_probe_early(void);		/* Probe devices, start PHY aneg */
 void eth_try_another(int first_restart);	/* Change the device */
 void eth_set_current(void);		/* set nterface to ethcur var */
 
@@ -344,6 +403,7 @@ struct vlan_ethernet_hdr {
 #define PROT_NCSI	0x88f8		/* NC-SI control packets        */
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -513,6 +573,9 @@ extern u8		net_ethaddr[ARP_HLEN];		/* Our ethernet address */
 extern u8		net_server_ethaddr[ARP_HLEN];	/* Boot server enet address */
 extern struct in_addr	net_ip;		/* Our    IP addr (0 = unknown) */
 extern struct in_addr	net_server_ip;	/* Server IP addr (0 = unknown) */
+#ifdef CONFIG_TFTP_MCAST
+extern struct in_addr	net_mcast_addr;	/* Multicast group joined (0 = none) */
+#endif
 extern uchar		*net_tx_packet;		/* THE transmit packet */
 extern uchar		*net_rx_packets[PKTBUFSRX]; /* Receive packets */
 extern uchar		*net_rx_packet;		/* Current receive packet */
@@ -529,7 +592,7 @@ extern int		net_restart_wrap;	/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, NCSI
+	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, NCSI, WGET, FASTBOOT_TCP
 };
 
 extern char	net_boot_file_name[1024];/* Boot File name */
@@ -599,6 +662,20 @@ void net_set_udp_header(uchar *pkt, struct in_addr dest, int dport,
  */
 unsigned compute_ip_checksum(const void *addr, unsigned nbytes);
 
+/**
+ * compute_ip_pseudo_checksum() - Compute the checksum of a pseudo header
+ *
+ * This is the IPv4 pseudo header covered by the TCP and UDP checksums.
+ *
+ * @src:	Source address
+ * @dst:	Destination address
+ * @proto:	IP protocol (IPPROTO_...)
+ * @len:	Length of the TCP or UDP header and data
+ * @return 16-bit IP checksum
+ */
+unsigned compute_ip_pseudo_checksum(struct in_addr src, struct in_addr dst,
+				    u8 proto, unsigned len);
+
 /**
  * add_ip_checksums() - add two IP checksums
  *
@@ -629,6 +706,43 @@ bool arp_is_waiting(void);		/* Waiting for ARP reply? */
 void net_set_icmp_handler(rxhand_icmp_f *f); /* Set ICMP RX handler */
 void net_set_timeout_handler(ulong, thand_f *);/* Set timeout handler */
 
+#ifdef CONFIG_NET_RX_LEND
+/*
+ * Receive buffer lending. A protocol may lend the final destination of the
+ * payload it expects next to the Ethernet driver, so that drivers able to
+ * split a frame across two buffers receive the first hdr_len bytes into
+ * their own packet buffer and the rest straight into place. Such a frame
+ * is delivered with net_rx_split_data pointing at the rest; anything the
+ * lending protocol does not claim is linearized first.
+ */
+extern uchar *net_rx_split_data;	/* Frame data past the header, or NULL */
+void net_set_rx_lender(rx_lend_f *f, int hdr_len, int port);
+int net_rx_lend(int ahead, int *hdr_lenp, uchar **datap);
+void net_rx_set_split(int hdr_len, uchar *data);
+void net_rx_linearize(void);
+bool net_rx_split_to(uchar *payload, void *dst);
+#else
+#define net_rx_split_data	((uchar *)NULL)
+static inline void net_set_rx_lender(rx_lend_f *f, int hdr_len, int port) {}
+static inline int net_rx_lend(int ahead, int *hdr_lenp, uchar **datap)
+{
+	return 0;
+}
+static inline void net_rx_set_split(int hdr_len, uchar *data) {}
+static inline void net_rx_linearize(void) {}
+static inline bool net_rx_split_to(uchar *payload, void *dst)
+{
+	return false;
+}
+#endif
+
+/*
+ * Set by the Ethernet driver when its MAC verified the IPv4 header and the
+ * TCP or UDP checksum of the frame it is returning from recv()
+ */
+extern bool net_rx_csum_ok;
+void net_rx_set_csum_ok(bool ok);
+
 /* Network loop state */
 enum net_loop_state {
 	NETLOOP_CONTINUE,
@@ -682,6 +796,18 @@ void net_process_received_packet(uchar *in_packet, int len);
 void nc_start(void);
 int nc_input_packet(uchar *pkt, struct in_addr src_ip, unsigned dest_port,
 	unsigned src_port, unsigned len);
+
+/**
+ * nc_flush() - Send the NetConsole output which is still buffered
+ *
+ * Call this before the network is stopped for good, e.g. before booting
+ * an OS or resetting.
+ */
+void nc_flush(void);
+#else
+static inline void nc_flush(void)
+{
+}
 #endif
 
 static __always_inline int eth_is_on_demand_init(void)
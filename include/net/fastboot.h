@@ -16,6 +16,11 @@
  */
 void fastboot_start_server(void);
 
+/**
+ * Wait for a fastboot host to connect over TCP.
+ */
+void fastboot_tcp_start_server(void);
+
 /**********************************************************************/
 
 #endif /* __NET_FASTBOOT_H__ */
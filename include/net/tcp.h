@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Minimal TCP: one connection at a time, opened by us or accepted on a
+ * listening port, with a selective acknowledgment (RFC 2018) receive window
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+/*
+ *	Internet Protocol (IP) + TCP header, without options.
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* Sequence number		*/
+	u32		tcp_ack;	/* Acknowledgment number	*/
+	u8		tcp_hlen;	/* Header length in words << 4	*/
+	u8		tcp_flags;	/* Control flags		*/
+	u16		tcp_win;	/* Receive window		*/
+	u16		tcp_xsum;	/* Checksum			*/
+	u16		tcp_urg;	/* Urgent pointer		*/
+} __attribute__((packed));
+
+#define IP_TCP_HDR_SIZE		(sizeof(struct ip_tcp_hdr))
+#define TCP_HDR_SIZE		(IP_TCP_HDR_SIZE - IP_HDR_SIZE)
+
+/* Control flags */
+#define TCP_FIN			0x01
+#define TCP_SYN			0x02
+#define TCP_RST			0x04
+#define TCP_PSH			0x08
+#define TCP_ACK			0x10
+
+/* Largest segment we accept, for a 1500 bytes Ethernet MTU */
+#define TCP_MSS			(1500 - IP_TCP_HDR_SIZE)
+
+enum tcp_event {
+	TCP_EV_CONNECTED,	/* Handshake done, tcp_send() may be used */
+	TCP_EV_DATA,		/* In-order data received */
+	TCP_EV_SENT,		/* All data sent so far was acknowledged */
+	TCP_EV_CLOSED,		/* The peer closed after sending all its data */
+	TCP_EV_RESET,		/* Connection refused, reset or timed out */
+};
+
+/**
+ * An event handler for the current connection.
+ * @param event	what happened
+ * @param data	received data for TCP_EV_DATA, NULL otherwise
+ * @param len	length of @data
+ */
+typedef void tcp_handler_f(enum tcp_event event, const uchar *data,
+			   unsigned int len);
+
+/**
+ * tcp_connect() - open a connection from within net_loop()
+ *
+ * Sends the SYN and takes over the net_loop() timeout handler for the
+ * life of the connection, so callers get a TCP_EV_RESET rather than a
+ * timeout of their own if the peer goes away.
+ *
+ * @dest:	IP address to connect to
+ * @dport:	destination port
+ * @handler:	gets the events of the connection
+ * @return 0 if OK, -ve on error
+ */
+int tcp_connect(struct in_addr dest, u16 dport, tcp_handler_f *handler);
+
+/**
+ * tcp_listen() - accept connections from within net_loop()
+ *
+ * Each connection in turn gets the events; once it is closed or reset
+ * the next SYN for @port is accepted. Unlike for tcp_connect() there is
+ * no timeout while the peer has nothing to say.
+ *
+ * @port:	local port to listen on
+ * @handler:	gets the events of the connections
+ * @return 0 if OK, -ve on error
+ */
+int tcp_listen(u16 port, tcp_handler_f *handler);
+
+/**
+ * tcp_send() - send data on the established connection
+ *
+ * Only one segment may be in flight: data sent before it is acknowledged
+ * is added to it, and once that would exceed TCP_MSS this fails with
+ * -EBUSY.
+ *
+ * @data:	data to send
+ * @len:	its length, at most TCP_MSS
+ * @return 0 if OK, -ve on error
+ */
+int tcp_send(const void *data, unsigned int len);
+
+/* Send our FIN; the connection stays up to receive */
+void tcp_close(void);
+
+/* Drop the connection without telling the peer, and stop listening */
+void tcp_stop(void);
+
+/*
+ * net.c glue: fill in the IP and TCP headers (and options) in front of
+ * the payload, returning their size, and process a received segment.
+ */
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num);
+void tcp_receive(struct ip_tcp_hdr *ip, unsigned int len);
+
+#endif /* __TCP_H__ */
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * HTTP download over the minimal TCP client
+ */
+
+#ifndef __WGET_H__
+#define __WGET_H__
+
+#include <blk.h>
+
+struct spi_flash;
+
+/**
+ * struct wget_sink - where the body of the response goes
+ *
+ * @write:	store @len bytes at @offset of the file. Calls come in order,
+ *		from within net_loop(), so a slow sink holds up the receive
+ *		path but not the transfer: the TCP window keeps the server
+ *		busy in the meantime.
+ * @finish:	called once after the last write with the file size, may be
+ *		NULL
+ * @priv:	for the sink
+ */
+struct wget_sink {
+	int (*write)(struct wget_sink *sink, ulong offset, const void *buf,
+		     size_t len);
+	int (*finish)(struct wget_sink *sink, ulong size);
+	void *priv;
+};
+
+/* Begin an HTTP GET of net_boot_file_name */
+void wget_start(void);
+
+/**
+ * wget_set_sink() - stream the next download to @sink
+ *
+ * This holds for one download only, afterwards files go to memory at
+ * load_addr again.
+ */
+void wget_set_sink(struct wget_sink *sink);
+
+/**
+ * wget_set_blk_sink() - stream the next download to a block device
+ *
+ * @desc:	block device to write to
+ * @start:	first block to write
+ * @count:	number of blocks the file may take
+ * @return 0 if OK, -ve on error
+ */
+int wget_set_blk_sink(struct blk_desc *desc, lbaint_t start, lbaint_t count);
+
+/**
+ * wget_set_sf_sink() - stream the next download to SPI flash
+ *
+ * Each erase sector is erased just before it is written.
+ *
+ * @flash:	flash to write to
+ * @offset:	where to write, a multiple of the erase size
+ * @size:	space the file may take
+ * @return 0 if OK, -ve on error
+ */
+int wget_set_sf_sink(struct spi_flash *flash, u32 offset, u32 size);
+
+#endif /* __WGET_H__ */
@@ -128,6 +128,9 @@ typedef struct NS16550 *NS16550_t;
 			UART_FCR_RXSR |	\
 			UART_FCR_TXSR)
 
+/* Smallest TX FIFO of the 16550 compatible UARTs */
+#define NS16550_FIFO_SIZE	16
+
 /*
  * These are the definitions for the Modem Control Register
  */
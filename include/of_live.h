@@ -11,9 +11,30 @@
 
 struct device_node;
 
+/**
+ * struct of_live_image - live tree generated at build time
+ *
+ * With CONFIG_OF_LIVE_IMAGE, dtoc writes out the live tree of the control
+ * FDT so that it does not need to be unflattened at run time.
+ *
+ * @fdt_size: Total size of the flat tree it was generated from
+ * @fdt_crc: CRC32 of that flat tree
+ * @root: Root node of the live tree
+ */
+struct of_live_image {
+	u32 fdt_size;
+	u32 fdt_crc;
+	struct device_node *root;
+};
+
+extern const struct of_live_image of_live_image;
+
 /**
  * of_live_build() - build a live (hierarchical) tree from a flat DT
  *
+ * If the build-time live tree (CONFIG_OF_LIVE_IMAGE) was generated from
+ * @fdt_blob, it is used directly instead of unflattening @fdt_blob.
+ *
  * @fdt_blob: Input tree to convert
  * @rootp: Returns live tree that was created
  * @return 0 if OK, -ve on error
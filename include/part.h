@@ -420,6 +420,33 @@ int gpt_verify_partitions(struct blk_desc *dev_desc,
  */
 int get_disk_guid(struct blk_desc *dev_desc, char *guid);
 
+/**
+ * gpt_cache_drop() - Forget the GPT read from a device
+ *
+ * The next partition lookup reads and checks the GPT again.
+ *
+ * @param dev_desc - block device descriptor
+ */
+void gpt_cache_drop(struct blk_desc *dev_desc);
+
+/**
+ * gpt_cache_written() - Forget the GPT of a device if it was written to
+ *
+ * Called for each write to a device, this drops its cached GPT if the
+ * blocks written may hold a part of it, i.e. are outside of the usable
+ * blocks.
+ *
+ * @param dev_desc - block device descriptor
+ * @param start - first block written
+ * @param blkcnt - number of blocks written
+ */
+void gpt_cache_written(struct blk_desc *dev_desc, lbaint_t start,
+		       lbaint_t blkcnt);
+
+#else
+static inline void gpt_cache_drop(struct blk_desc *dev_desc) {}
+static inline void gpt_cache_written(struct blk_desc *dev_desc,
+				     lbaint_t start, lbaint_t blkcnt) {}
 #endif
 
 #if CONFIG_IS_ENABLED(DOS_PARTITION)
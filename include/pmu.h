@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * CPU performance monitor counters
+ */
+
+#ifndef __PMU_H
+#define __PMU_H
+
+#include <linux/errno.h>
+
+/* Counters, in the order used by struct pmu_counts */
+enum pmu_counter {
+	PMUC_CYCLES,		/* always counts CPU cycles */
+	PMUC_INSTRUCTIONS,	/* the others count a configurable event */
+	PMUC_L1D_MISSES,
+	PMUC_L2D_MISSES,
+	PMUC_BRANCH_MISSES,
+
+	PMUC_COUNT,
+};
+
+/**
+ * struct pmu_counts - a snapshot of the counters
+ *
+ * @count: Value of each counter
+ * @valid: Bit mask of the counters which are counting (BIT(PMUC_...))
+ */
+struct pmu_counts {
+	u64 count[PMUC_COUNT];
+	uint valid;
+};
+
+#ifdef CONFIG_ARM_PMU
+/**
+ * pmu_init() - Start the performance counters
+ *
+ * This enables the counters the first time it is called. They are never
+ * reset after that, so callers take a snapshot before and after the code
+ * they measure and use the difference.
+ *
+ * @return 0 if OK, -ENODEV if the CPU has no performance monitor
+ */
+int pmu_init(void);
+
+/**
+ * pmu_read() - Read the counters
+ *
+ * The hardware counters may only be 32 bits wide. They are extended to 64
+ * bits here, which requires that they are read at least once every 2^31
+ * events.
+ *
+ * @counts: Returns the counter values
+ */
+void pmu_read(struct pmu_counts *counts);
+
+/**
+ * pmu_set_event() - Select the event counted by a counter
+ *
+ * The counter is reset, so any snapshot taken before is no longer valid
+ * for it.
+ *
+ * @counter: Counter to change (not PMUC_CYCLES)
+ * @event: Event number as defined by the architecture
+ * @return 0 if OK, -EINVAL if @counter is not valid, -ENODEV if the CPU
+ *	has no performance monitor
+ */
+int pmu_set_event(enum pmu_counter counter, uint event);
+
+/**
+ * pmu_get_event() - Get the event counted by a counter
+ *
+ * @counter: Counter to check (not PMUC_CYCLES)
+ * @return event number
+ */
+uint pmu_get_event(enum pmu_counter counter);
+
+/**
+ * pmu_show() - Show the events counted between two snapshots
+ *
+ * @start: Snapshot taken before
+ * @end: Snapshot taken after
+ */
+void pmu_show(const struct pmu_counts *start, const struct pmu_counts *end);
+#else
+static inline int pmu_init(void)
+{
+	return -ENOSYS;
+}
+
+static inline void pmu_read(struct pmu_counts *counts)
+{
+}
+
+static inline void pmu_show(const struct pmu_counts *start,
+			    const struct pmu_counts *end)
+{
+}
+#endif
+
+#endif
@@ -76,15 +76,32 @@ struct regmap_range {
 /**
  * struct regmap - a way of accessing hardware/bus registers
  *
+ * @endianness:		Endianness of the register accesses
+ * @base:		Mapped address of the first range if it can be
+ *			accessed with plain native-endian MMIO, else NULL
  * @range_count:	Number of ranges available within the map
  * @ranges:		Array of ranges
  */
 struct regmap {
 	enum regmap_endianness_t endianness;
+	void *base;
 	int range_count;
 	struct regmap_range ranges[0];
 };
 
+/**
+ * struct reg_sequence - a register write in a sequence
+ *
+ * @reg:	Offset of the register in the regmap
+ * @def:	Value to write
+ * @delay_us:	Delay in microseconds after the write, 0 for none
+ */
+struct reg_sequence {
+	uint reg;
+	uint def;
+	uint delay_us;
+};
+
 /*
  * Interface to provide access to registers either through a direct memory
  * bus or through a peripheral bus like I2C, SPI.
@@ -300,6 +317,21 @@ int regmap_raw_read_range(struct regmap *map, uint range_num, uint offset,
  */
 int regmap_update_bits(struct regmap *map, uint offset, uint mask, uint val);
 
+/**
+ * regmap_multi_reg_write() - Write a sequence of 32-bit registers
+ *
+ * @map:	The map returned by regmap_init_mem*()
+ * @regs:	Registers to write, in order
+ * @num_regs:	Number of entries in @regs
+ *
+ * This is meant for the register init tables of clock and pin controllers,
+ * and stops at the first write that fails.
+ *
+ * Return: 0 if OK, -ve on error
+ */
+int regmap_multi_reg_write(struct regmap *map, const struct reg_sequence *regs,
+			   int num_regs);
+
 /**
  * regmap_init_mem() - Set up a new register map that uses memory access
  *
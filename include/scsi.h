@@ -163,11 +163,14 @@ struct scsi_cmd {
  * @base: Controller base address
  * @max_lun: Maximum number of logical units
  * @max_id: Maximum number of target ids
+ * @max_bytes: Maximum number of bytes moved by one READ or WRITE command, or
+ *	0 if the controller takes any command and splits it up itself
  */
 struct scsi_platdata {
 	unsigned long base;
 	unsigned long max_lun;
 	unsigned long max_id;
+	unsigned long max_bytes;
 };
 
 /* Operations for SCSI */
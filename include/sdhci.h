@@ -190,6 +190,7 @@
 /* 55-57 reserved */
 
 #define SDHCI_ADMA_ADDRESS	0x58
+#define SDHCI_ADMA_ADDRESS_HI	0x5C
 
 /* 60-FB reserved */
 
@@ -239,6 +240,42 @@ struct sdhci_host;
  */
 #define SDHCI_DEFAULT_BOUNDARY_SIZE	(512 * 1024)
 #define SDHCI_DEFAULT_BOUNDARY_ARG	(7)
+
+#ifdef CONFIG_MMC_SDHCI_ADMA
+/*
+ * ADMA2 descriptors. One table describes a whole transfer; a descriptor
+ * moves at most ADMA_MAX_LEN bytes, a multiple of the 4-byte alignment.
+ */
+#define ADMA_MAX_LEN		65532
+#define ADMA_TABLE_NO_ENTRIES	\
+	DIV_ROUND_UP(CONFIG_SYS_MMC_MAX_BLK_COUNT * 512, ADMA_MAX_LEN)
+#define ADMA_TABLE_SZ		\
+	(ADMA_TABLE_NO_ENTRIES * sizeof(struct sdhci_adma_desc))
+
+#define ADMA_DESC_ATTR_VALID	BIT(0)
+#define ADMA_DESC_ATTR_END	BIT(1)
+#define ADMA_DESC_ATTR_INT	BIT(2)
+#define ADMA_DESC_ATTR_ACT1	BIT(4)
+#define ADMA_DESC_ATTR_ACT2	BIT(5)
+#define ADMA_DESC_TRANSFER_DATA	ADMA_DESC_ATTR_ACT2
+
+/* 64-bit descriptors, and 8-byte aligned data, with 64-bit DMA addresses */
+struct sdhci_adma_desc {
+	u8 attr;
+	u8 reserved;
+	__le16 len;
+	__le32 addr_lo;
+#ifdef CONFIG_DMA_ADDR_T_64BIT
+	__le32 addr_hi;
+#endif
+} __packed;
+
+#ifdef CONFIG_DMA_ADDR_T_64BIT
+#define ADMA_ADDR_ALIGN		8
+#else
+#define ADMA_ADDR_ALIGN		4
+#endif
+#endif
 struct sdhci_ops {
 #ifdef CONFIG_MMC_SDHCI_IO_ACCESSORS
 	u32	(*read_l)(struct sdhci_host *host, int reg);
@@ -277,6 +314,9 @@ struct sdhci_host {
 	uint	voltages;
 
 	struct mmc_config cfg;
+#ifdef CONFIG_MMC_SDHCI_ADMA
+	struct sdhci_adma_desc *adma_desc_table;
+#endif
 };
 
 #ifdef CONFIG_MMC_SDHCI_IO_ACCESSORS
@@ -61,6 +61,11 @@ struct hsearch_data {
  */
 	int (*change_ok)(const ENTRY *__item, const char *newval, enum env_op,
 		int flag);
+/*
+ * Non-zero while entries are being accessed by index, e.g. by the callbacks
+ * of hsearch_r() and hwalk_r(). The table is not grown then.
+ */
+	unsigned int busy;
 };
 
 /* Create a new hash table which will contain at most "__nel" elements.  */
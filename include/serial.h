@@ -189,6 +189,21 @@ struct dm_serial_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*putc)(struct udevice *dev, const char ch);
+	/**
+	 * puts() - Write characters
+	 *
+	 * Write as many of the characters as fit in the UART, such as a
+	 * FIFO's worth at once, without waiting. No newline translation is
+	 * done. If nothing can be written, this should return -EAGAIN.
+	 *
+	 * This method is optional, putc() is used without it.
+	 *
+	 * @dev: Device pointer
+	 * @s: characters to write
+	 * @len: number of characters, at least 1
+	 * @return number of characters written, -ve on error
+	 */
+	int (*puts)(struct udevice *dev, const char *s, int len);
 	/**
 	 * pending() - Check if input/output characters are waiting
 	 *
@@ -268,6 +283,11 @@ struct dm_serial_ops {
  * @buf:	Pointer to the RX buffer
  * @rd_ptr:	Read pointer in the RX buffer
  * @wr_ptr:	Write pointer in the RX buffer
+ *
+ * @tx_buf:	Pointer to the TX buffer
+ * @tx_rd:	Number of bytes taken from the TX buffer
+ * @tx_wr:	Number of bytes added to the TX buffer
+ * @tx_hold:	true to hold output in the TX buffer instead of sending it
  */
 struct serial_dev_priv {
 	struct stdio_dev *sdev;
@@ -275,11 +295,32 @@ struct serial_dev_priv {
 	char *buf;
 	int rd_ptr;
 	int wr_ptr;
+
+	char *tx_buf;
+	uint tx_rd;
+	uint tx_wr;
+	bool tx_hold;
 };
 
 /* Access the serial operations for a device */
 #define serial_get_ops(dev)	((struct dm_serial_ops *)(dev)->driver->ops)
 
+/**
+ * serial_flush() - Send the output held in the TX buffers
+ *
+ * With CONFIG_SERIAL_TX_BUFFER this waits until the output buffered by
+ * each serial device has been passed to its UART. Output held because of
+ * CONFIG_SERIAL_TX_BUFFER_QUIET is sent too, unless @boot is true, in
+ * which case it is dropped. Either way, later output is no longer held.
+ *
+ * @boot: true if an OS is about to be booted
+ */
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+void serial_flush(bool boot);
+#else
+static inline void serial_flush(bool boot) {}
+#endif
+
 /**
  * serial_getconfig() - Get the uart configuration
  * (parity, 5/6/7/8 bits word length, stop bits)
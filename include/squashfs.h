@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Read-only SquashFS support for U-Boot
+ */
+
+#ifndef __U_BOOT_SQUASHFS_H__
+#define __U_BOOT_SQUASHFS_H__
+
+struct fs_dir_stream;
+struct fs_dirent;
+
+int sqfs_probe(struct blk_desc *, disk_partition_t *);
+int sqfs_exists(const char *);
+int sqfs_size(const char *, loff_t *);
+int sqfs_read(const char *, void *, loff_t, loff_t, loff_t *);
+void sqfs_close(void);
+int sqfs_opendir(const char *, struct fs_dir_stream **);
+int sqfs_readdir(struct fs_dir_stream *, struct fs_dirent **);
+void sqfs_closedir(struct fs_dir_stream *);
+
+#endif /* __U_BOOT_SQUASHFS_H__ */
@@ -9,6 +9,21 @@
 
 #include <test/test.h>
 
+/* Text compressed by each tool, see test/compression_corpus.c */
+extern const char compression_plain[];
+extern const char bzip2_compressed[];
+extern const unsigned long bzip2_compressed_size;
+extern const char lzma_compressed[];
+extern const unsigned long lzma_compressed_size;
+extern const char xz_compressed[];
+extern const unsigned long xz_compressed_size;
+extern const char lzo_compressed[];
+extern const unsigned long lzo_compressed_size;
+extern const char lz4_compressed[];
+extern const unsigned long lz4_compressed_size;
+extern const char zstd_compressed[];
+extern const unsigned long zstd_compressed_size;
+
 /* Declare a new compression test */
 #define COMPRESSION_TEST(_name, _flags) \
 		UNIT_TEST(_name, _flags, compression_test)
@@ -308,4 +308,17 @@ u32 tpm2_pcr_setauthvalue(struct udevice *dev, const char *pw,
 			  const ssize_t pw_sz, u32 index, const char *key,
 			  const ssize_t key_sz);
 
+/**
+ * Extend a SHA256 digest computed elsewhere into a PCR of the first TPM.
+ *
+ * The TPM is opened and started first if that has not been done yet, so
+ * verified images can be measured without any prior 'tpm2' command.
+ *
+ * @index	Index of the PCR
+ * @digest	SHA256 digest of the measured data
+ *
+ * @return 0 if OK, -ve on error
+ */
+int tpm2_measure(u32 index, const uint8_t *digest);
+
 #endif /* __TPM_V2_H */
@@ -28,6 +28,7 @@ enum {
 enum trace_chunk_type {
 	TRACE_CHUNK_FUNCS,
 	TRACE_CHUNK_CALLS,
+	TRACE_CHUNK_SAMPLES,
 };
 
 /* A trace record for a function, as written to the profile output file */
@@ -79,6 +80,73 @@ struct trace_call {
 
 int trace_list_calls(void *buff, int buff_size, unsigned int *needed);
 
+/* A sample taken by the sampling profiler, as written to the output file */
+struct trace_sample {
+	uint32_t pc;		/* Interrupted instruction, offset into code */
+	uint32_t lr;		/* Its link register, offset into code */
+};
+
+struct pt_regs;
+
+/**
+ * Start the sampling profiler
+ *
+ * This samples the PC and LR every @period_us microseconds, keeping the
+ * last @count samples. It does not need a build with -finstrument-functions.
+ *
+ * @param period_us	Sampling period in microseconds
+ * @param count		Number of samples to keep
+ * @return 0 if ok, -ve on error
+ */
+int trace_sample_start(unsigned int period_us, unsigned int count);
+
+/* Stop the sampling profiler, keeping the samples taken */
+void trace_sample_stop(void);
+
+/* Print statistics about the samples taken */
+void trace_sample_print_stats(void);
+
+/**
+ * Dump the samples, oldest first, into a buffer
+ *
+ * This stops the sampling profiler. The buffer holds a struct
+ * trace_output_hdr of type TRACE_CHUNK_SAMPLES followed by a struct
+ * trace_sample for each sample.
+ *
+ * @param buff		Buffer in which to place data
+ * @param buff_size	Size of buffer
+ * @param needed	Returns number of bytes used / needed
+ * @return 0 if ok, -1 on error (buffer exhausted)
+ */
+int trace_list_samples(void *buff, int buff_size, unsigned int *needed);
+
+/**
+ * Record a sample, called from the sampling interrupt
+ *
+ * @param pc		Address of the interrupted instruction
+ * @param lr		Link register of the interrupted code
+ */
+void trace_sample_record(ulong pc, ulong lr);
+
+/**
+ * Start a periodic interrupt which calls trace_sample_record()
+ *
+ * @param period_us	Interrupt period in microseconds
+ * @return 0 if ok, -ve on error
+ */
+int arch_sample_start(unsigned int period_us);
+
+/* Stop the periodic interrupt */
+void arch_sample_stop(void);
+
+/**
+ * Handle an interrupt, if it is the sampling interrupt
+ *
+ * @param regs		Registers of the interrupted code
+ * @return 0 if handled, -ve if this is not the sampling interrupt
+ */
+int arch_sample_irq(struct pt_regs *regs);
+
 /**
  * Turn function tracing on and off
  *
@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Driver model for hash engines
+ */
+
+#ifndef _UBOOT_HASH_H
+#define _UBOOT_HASH_H
+
+struct udevice;
+
+/**
+ * struct hash_ops - Driver model operations for hash engines
+ *
+ * Algorithms are named as in common/hash.c ("sha256", ...). A device may
+ * hand out any number of contexts, each one holding the state of a single
+ * digest, and may run updates of different contexts in any order.
+ *
+ * After an error the context may only be passed to finish(), which frees
+ * it and returns the error again.
+ */
+struct hash_ops {
+	/**
+	 * supports() - Check whether the device can compute a digest
+	 *
+	 * @dev:	Hash device
+	 * @algo_name:	Algorithm name
+	 * @return true if init() will accept @algo_name
+	 */
+	bool (*supports)(struct udevice *dev, const char *algo_name);
+
+	/**
+	 * init() - Create a context for a new digest
+	 *
+	 * @dev:	Hash device
+	 * @algo_name:	Algorithm name
+	 * @ctxp:	Returns the new context
+	 * @return 0 if OK, -EPROTONOSUPPORT for an unknown algorithm, -ENOMEM
+	 */
+	int (*init)(struct udevice *dev, const char *algo_name, void **ctxp);
+
+	/**
+	 * update() - Add data to a digest and wait until it is consumed
+	 *
+	 * @dev:	Hash device
+	 * @ctx:	Context from init()
+	 * @buf:	Data to add
+	 * @size:	Number of bytes at @buf
+	 * @is_last:	Non-zero if this is the last data of the digest
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*update)(struct udevice *dev, void *ctx, const void *buf,
+		      unsigned int size, int is_last);
+
+	/**
+	 * submit() - Start adding data to a digest (optional)
+	 *
+	 * The engine may still read @buf when this returns, so it must stay
+	 * untouched until poll() or any other call for @ctx reports that the
+	 * update is done. If this is missing, update() is used instead.
+	 *
+	 * Parameters and return value as for update()
+	 */
+	int (*submit)(struct udevice *dev, void *ctx, const void *buf,
+		      unsigned int size, int is_last);
+
+	/**
+	 * poll() - Check whether a submitted update is done (optional)
+	 *
+	 * @dev:	Hash device
+	 * @ctx:	Context from init()
+	 * @return 0 if no update is running for @ctx, -EBUSY if one is, other
+	 * -ve value if it failed
+	 */
+	int (*poll)(struct udevice *dev, void *ctx);
+
+	/**
+	 * finish() - Wait for the context, read its digest and free it
+	 *
+	 * @dev:	Hash device
+	 * @ctx:	Context from init(), freed even on error
+	 * @dest_buf:	Returns the digest
+	 * @size:	Number of bytes available at @dest_buf
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*finish)(struct udevice *dev, void *ctx, void *dest_buf,
+		      int size);
+};
+
+#define hash_get_ops(dev)	((struct hash_ops *)(dev)->driver->ops)
+
+/**
+ * hash_get_device() - Find a hash device for an algorithm
+ *
+ * Hardware engines are preferred; if none of them can compute @algo_name
+ * the software fallback is used, when enabled.
+ *
+ * @algo_name:	Algorithm name
+ * @devp:	Returns the probed device
+ * @return 0 if OK, -EPROTONOSUPPORT if no device supports the algorithm
+ */
+int hash_get_device(const char *algo_name, struct udevice **devp);
+
+/* See struct hash_ops for these */
+int hash_dev_init(struct udevice *dev, const char *algo_name, void **ctxp);
+int hash_dev_update(struct udevice *dev, void *ctx, const void *buf,
+		    unsigned int size, int is_last);
+int hash_dev_submit(struct udevice *dev, void *ctx, const void *buf,
+		    unsigned int size, int is_last);
+int hash_dev_poll(struct udevice *dev, void *ctx);
+int hash_dev_finish(struct udevice *dev, void *ctx, void *dest_buf, int size);
+
+/**
+ * hash_dev_wait() - Wait until no submitted update is running for a context
+ *
+ * @dev:	Hash device
+ * @ctx:	Context from hash_dev_init()
+ * @return 0 if OK, -ve if the update failed
+ */
+int hash_dev_wait(struct udevice *dev, void *ctx);
+
+/**
+ * hash_dev_digest() - Compute the digest of a single buffer
+ *
+ * @dev:	Hash device
+ * @algo_name:	Algorithm name
+ * @buf:	Data to hash
+ * @size:	Number of bytes at @buf
+ * @dest_buf:	Returns the digest
+ * @dest_size:	Number of bytes available at @dest_buf
+ * @return 0 if OK, -ve on error
+ */
+int hash_dev_digest(struct udevice *dev, const char *algo_name,
+		    const void *buf, unsigned int size, void *dest_buf,
+		    int dest_size);
+
+#endif
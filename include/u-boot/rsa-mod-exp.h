@@ -9,6 +9,8 @@
 #include <errno.h>
 #include <image.h>
 
+struct rsa_public_key;
+
 /**
  * struct key_prop - holder for a public key properties
  *
@@ -24,8 +26,27 @@ struct key_prop {
 	uint32_t n0inv;		/* -1 / modulus[0] mod 2^32 */
 	int num_bits;		/* Key length in bits */
 	uint32_t exp_len;	/* Exponent length in number of uint8_t */
+	/* The same key converted for rsa_mod_exp_sw(), or NULL */
+	const struct rsa_public_key *key;
 };
 
+/**
+ * rsa_key_check() - Check that a key can be used by rsa_mod_exp_sw()
+ *
+ * @prop:	Key to check
+ * @return 0 if OK, -ve if a property is missing or the size is unsupported
+ */
+int rsa_key_check(const struct key_prop *prop);
+
+/**
+ * rsa_key_convert() - Convert a key to the form used by rsa_mod_exp_sw()
+ *
+ * @prop:	Key, which must have passed rsa_key_check()
+ * @key:	Returns the key; modulus and rr must point to arrays of
+ *		prop->num_bits / 32 words
+ */
+void rsa_key_convert(const struct key_prop *prop, struct rsa_public_key *key);
+
 /**
  * rsa_mod_exp_sw() - Perform RSA Modular Exponentiation in sw
  *
@@ -42,6 +63,28 @@ int rsa_mod_exp_sw(const uint8_t *sig, uint32_t sig_len,
 int rsa_mod_exp(struct udevice *dev, const uint8_t *sig, uint32_t sig_len,
 		struct key_prop *node, uint8_t *out);
 
+/**
+ * rsa_mod_exp_start() - Start a modular exponentiation and return
+ *
+ * Only devices with the mod_exp_start operation support this; the caller
+ * is expected to use rsa_mod_exp() instead when -ENOSYS is returned.
+ * Parameters as for rsa_mod_exp(): @sig and @node must stay valid until
+ * rsa_mod_exp_finish() returns.
+ *
+ * @return 0 if started, -ENOSYS if not supported, other -ve on error
+ */
+int rsa_mod_exp_start(struct udevice *dev, const uint8_t *sig,
+		      uint32_t sig_len, struct key_prop *node);
+
+/**
+ * rsa_mod_exp_finish() - Wait for the result of rsa_mod_exp_start()
+ *
+ * @dev:	RSA Device
+ * @out:	Result in form of byte array of len equal to sig_len
+ * @return 0 if OK, -ve on error
+ */
+int rsa_mod_exp_finish(struct udevice *dev, uint8_t *out);
+
 #if defined(CONFIG_CMD_ZYNQ_RSA)
 int zynq_pow_mod(u32 *keyptr, u32 *inout);
 #endif
@@ -73,6 +116,27 @@ struct mod_exp_ops {
 	int (*mod_exp)(struct udevice *dev, const uint8_t *sig,
 			   uint32_t sig_len, struct key_prop *node,
 			   uint8_t *outp);
+
+	/**
+	 * Start a Modular Exponentiation without waiting for it (optional)
+	 *
+	 * Parameters as for mod_exp(). Only one may be running per device.
+	 *
+	 * Returns: 0 if started, -EBUSY if one is already running, or
+	 * another negative value on error.
+	 */
+	int (*mod_exp_start)(struct udevice *dev, const uint8_t *sig,
+			     uint32_t sig_len, struct key_prop *node);
+
+	/**
+	 * Wait for the Modular Exponentiation started by mod_exp_start()
+	 *
+	 * @dev:	RSA Device
+	 * @outp:	Result in form of byte array of len equal to sig_len
+	 *
+	 * Returns: 0 if successful, or a negative value if it wasn't.
+	 */
+	int (*mod_exp_finish)(struct udevice *dev, uint8_t *outp);
 };
 
 #endif
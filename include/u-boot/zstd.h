@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Zstandard decompression
+ */
+
+#ifndef __UBOOT_ZSTD_H
+#define __UBOOT_ZSTD_H
+
+/**
+ * zstd_decompress() - decompress zstd frames from one buffer to another
+ *
+ * @src:	compressed data, one or more frames
+ * @srclen:	length of the compressed data
+ * @dst:	output buffer
+ * @dstlen:	size of the output buffer on entry, bytes written on return;
+ *		set to the buffer size when the output does not fit
+ * @return 0 if OK, -ENOSPC if the buffer is too small, -EOPNOTSUPP for
+ *	frames needing a dictionary, -ENOMEM or -EINVAL for corrupt data
+ */
+int zstd_decompress(const void *src, size_t srclen, void *dst,
+		    size_t *dstlen);
+
+struct zstd_stream;
+
+/**
+ * zstd_stream_start() - start decompressing zstd frames fed in pieces
+ *
+ * The output is written to a single buffer, which serves as the window, so
+ * the pieces of input can be of any size and need not be kept.
+ *
+ * @dst:	output buffer
+ * @dstlen:	size of the output buffer
+ * @return the stream, or NULL if out of memory
+ */
+struct zstd_stream *zstd_stream_start(void *dst, size_t dstlen);
+
+/**
+ * zstd_stream_feed() - decompress the next piece of input
+ *
+ * @zs:		stream from zstd_stream_start()
+ * @src:	next piece of compressed data
+ * @len:	length of that piece
+ * @return 0 if OK, or an error as for zstd_decompress()
+ */
+int zstd_stream_feed(struct zstd_stream *zs, const void *src, size_t len);
+
+/**
+ * zstd_stream_end() - finish a stream and free it
+ *
+ * @zs:		stream from zstd_stream_start()
+ * @dstlen:	returns the number of bytes written
+ * @return 0 if OK, -EINVAL if the input ended in the middle of a frame
+ */
+int zstd_stream_end(struct zstd_stream *zs, size_t *dstlen);
+
+#endif
@@ -156,6 +156,33 @@ struct usb_device {
 
 struct int_queue;
 
+/**
+ * struct usb_stream_xfer - A bulk transfer which does not wait for the device
+ *
+ * Some controllers (xHCI) can have several transfers queued on a bulk
+ * endpoint, so that the endpoint never idles between two of them. They
+ * complete in order, unless the endpoint has bulk streams: then there is one
+ * queue per stream and the device serves the streams in any order. See
+ * usb_submit_stream_xfer().
+ *
+ * @pipe:	Bulk pipe
+ * @stream_id:	Stream of the endpoint, or 0 for an endpoint without streams
+ * @buffer:	DMA-aligned buffer to send or receive
+ * @length:	Buffer length in bytes
+ * @done:	Set by the controller once the transfer is over
+ * @status:	USB_ST_... status, 0 if OK, valid once @done
+ * @act_len:	Number of bytes transferred, valid once @done
+ */
+struct usb_stream_xfer {
+	unsigned long pipe;
+	unsigned int stream_id;
+	void *buffer;
+	int length;
+	bool done;
+	unsigned long status;
+	int act_len;
+};
+
 /*
  * You can initialize platform's USB host or device
  * ports by passing this enum as an argument to
@@ -644,11 +671,13 @@ struct usb_dev_platdata {
  *		so this will be false.
  * @companion:  True if this is a companion controller to another USB
  *		controller
+ * @scan_err:	Error from setting up the root hub in the last usb_init()
  */
 struct usb_bus_priv {
 	int next_addr;
 	bool desc_before_addr;
 	bool companion;
+	int scan_err;
 };
 
 /**
@@ -785,6 +814,55 @@ struct dm_usb_ops {
 	 * in a USB transfer. USB class driver needs to be aware of this.
 	 */
 	int (*get_max_xfer_size)(struct udevice *bus, size_t *size);
+
+	/**
+	 * alloc_streams() - Set up the bulk streams of an interface (xHCI)
+	 *
+	 * Reconfigure all the endpoints of @iface, giving up to @num_streams
+	 * streams to the bulk endpoints whose SuperSpeed companion allows
+	 * streams. Transfers still queued on them are given up with status
+	 * USB_ST_NOT_PROC.
+	 *
+	 * @iface: Interface setting in use, not necessarily from udev->config
+	 * @num_streams: Streams wanted per endpoint, not counting stream 0
+	 * @return number of streams usable per endpoint (stream IDs start
+	 *	   at 1), or -ve on error
+	 */
+	int (*alloc_streams)(struct udevice *bus, struct usb_device *udev,
+			     struct usb_interface *iface,
+			     unsigned int num_streams);
+
+	/**
+	 * submit_stream_xfer() - Queue a bulk transfer and return at once
+	 *
+	 * @xfer: Transfer, which must stay around until @xfer->done is set
+	 * @return 0 if queued, -EBUSY if the endpoint has too many transfers
+	 *	   queued already, other -ve on error
+	 */
+	int (*submit_stream_xfer)(struct udevice *bus, struct usb_device *udev,
+				  struct usb_stream_xfer *xfer);
+
+	/**
+	 * poll_stream_xfers() - Complete the queued transfers that are over
+	 *
+	 * This never waits.
+	 *
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*poll_stream_xfers)(struct udevice *bus, struct usb_device *udev);
+
+	/**
+	 * cancel_stream_xfers() - Give up on the transfers queued on a pipe
+	 *
+	 * The transfers which are not over are done with status
+	 * USB_ST_NOT_PROC. The endpoint, which need not have streams, may be
+	 * halted: it takes new transfers afterwards either way, although a
+	 * halted device endpoint still needs usb_clear_halt().
+	 *
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*cancel_stream_xfers)(struct udevice *bus, struct usb_device *udev,
+				   unsigned long pipe);
 };
 
 #define usb_get_ops(dev)	((struct dm_usb_ops *)(dev)->driver->ops)
@@ -923,6 +1001,18 @@ bool usb_device_has_child_on_port(struct usb_device *parent, int port);
 int usb_hub_probe(struct usb_device *dev, int ifnum);
 void usb_hub_reset(void);
 
+/**
+ * usb_hub_defer_scan() - Hold back the port scan of newly configured hubs
+ *
+ * While deferred, configuring a hub only powers up its ports and queues
+ * them. Ending the deferral scans the ports of all these hubs at once, so
+ * that their power-on and connect delays run concurrently.
+ *
+ * @defer:	true to start deferring, false to scan the queued ports
+ * @return 0 if OK, -ve on error
+ */
+int usb_hub_defer_scan(bool defer);
+
 /*
  * usb_find_usb2_hub_address_port() - Get hub address and port for TT setting
  *
@@ -980,6 +1070,61 @@ int usb_update_hub_device(struct usb_device *dev);
  */
 int usb_get_max_xfer_size(struct usb_device *dev, size_t *size);
 
+/**
+ * usb_alloc_streams() - Set up the bulk streams of an interface
+ *
+ * See struct dm_usb_ops for details
+ *
+ * @dev:		USB device
+ * @iface:		Interface setting in use
+ * @num_streams:	Streams wanted per endpoint
+ * @return number of streams usable per endpoint, -ve on error
+ */
+int usb_alloc_streams(struct usb_device *dev, struct usb_interface *iface,
+		      unsigned int num_streams);
+
+/**
+ * usb_submit_stream_xfer() - Queue a bulk transfer without waiting for it
+ *
+ * @dev:		USB device
+ * @xfer:		Transfer, completed by usb_poll_stream_xfers()
+ * @return 0 if queued, -ve on error
+ */
+int usb_submit_stream_xfer(struct usb_device *dev,
+			   struct usb_stream_xfer *xfer);
+
+/**
+ * usb_poll_stream_xfers() - Complete the queued transfers that are over
+ *
+ * @dev:		USB device
+ * @return 0 if OK, -ve on error
+ */
+int usb_poll_stream_xfers(struct usb_device *dev);
+
+/**
+ * usb_wait_stream_xfer() - Wait for a queued bulk transfer to be over
+ *
+ * Other queued transfers complete meanwhile as well.
+ *
+ * @dev:		USB device
+ * @xfer:		Transfer queued by usb_submit_stream_xfer()
+ * @timeout_ms:		Time to wait
+ * @return 0 if @xfer is done, -ETIMEDOUT if not, other -ve on error
+ */
+int usb_wait_stream_xfer(struct usb_device *dev, struct usb_stream_xfer *xfer,
+			 unsigned long timeout_ms);
+
+/**
+ * usb_cancel_stream_xfers() - Give up on the bulk transfers queued on a pipe
+ *
+ * See struct dm_usb_ops for details
+ *
+ * @dev:		USB device
+ * @pipe:		Bulk pipe, of an endpoint without streams
+ * @return 0 if OK, -ve on error
+ */
+int usb_cancel_stream_xfers(struct usb_device *dev, unsigned long pipe);
+
 /**
  * usb_emul_setup_device() - Set up a new USB device emulation
  *
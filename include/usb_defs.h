@@ -45,6 +45,7 @@
 #define US_PR_CB               1		/* Control/Bulk w/o interrupt */
 #define US_PR_CBI              0		/* Control/Bulk/Interrupt */
 #define US_PR_BULK             0x50		/* bulk only */
+#define US_PR_UAS              0x62		/* USB Attached SCSI */
 
 /* USB types */
 #define USB_TYPE_STANDARD   (0x00 << 5)
@@ -362,4 +363,47 @@ struct umass_bbb_csw {
 #define US_BBB_RESET		0xff
 #define US_BBB_GET_MAX_LUN	0xfe
 
+/*
+ * USB Attached SCSI: the pipe usage descriptor which follows each endpoint
+ * of the UAS setting tells what its endpoint is for. Commands, their data
+ * and their status travel as Information Units; with bulk streams the
+ * data and status of a command go over the stream of its tag.
+ */
+#define UAS_PIPE_CMD		1
+#define UAS_PIPE_STATUS		2
+#define UAS_PIPE_DATA_IN	3
+#define UAS_PIPE_DATA_OUT	4
+
+#define UAS_IU_ID_COMMAND	0x01
+#define UAS_IU_ID_STATUS	0x03
+#define UAS_IU_ID_RESPONSE	0x04
+
+/* Command IU, for CDBs of up to 16 bytes */
+struct uas_cmd_iu {
+	__u8		bIUID;
+	__u8		bReserved1;
+	__be16		wTag;
+	__u8		bPrioAttr;
+#	define UAS_SIMPLE_TAG	0
+	__u8		bReserved5;
+	__u8		bAddCDBLength;
+	__u8		bReserved7;
+	__u8		LUN[8];
+	__u8		CDB[16];
+} __packed;
+
+/* Sense IU, the status of a command */
+struct uas_sense_iu {
+	__u8		bIUID;
+	__u8		bReserved1;
+	__be16		wTag;
+	__be16		wStatusQualifier;
+	__u8		bStatus;
+#	define UAS_STATUS_GOOD		0x00
+#	define UAS_STATUS_CHECK_COND	0x02
+	__u8		bReserved7[7];
+	__be16		wLength;
+	__u8		SenseData[96];
+} __packed;
+
 #endif /*_USB_DEFS_H_ */
@@ -14,8 +14,18 @@ struct ueth_data {
 #ifdef CONFIG_DM_ETH
 	uint8_t *rxbuf;
 	int rxsize;
-	int rxlen;			/* Total bytes available in rxbuf */
-	int rxptr;			/* Current position in rxbuf */
+	uint8_t *rxdata;		/* rxbuf, or a buffer of rxq */
+	int rxlen;			/* Total bytes available in rxdata */
+	int rxptr;			/* Current position in rxdata */
+#if CONFIG_IS_ENABLED(DM_USB)
+	/* Bulk IN transfers kept queued, see usb_ether_receive() */
+	struct usb_stream_xfer *rxq;
+	uint8_t *rxq_bufs;
+	int rxq_len;			/* Length of each transfer */
+	int rxq_head;			/* Oldest transfer */
+	bool rxq_held;			/* rxdata is the head's buffer */
+	bool rxq_off;			/* The controller can't queue */
+#endif
 #else
 	struct eth_device eth_dev;	/* used with eth_register */
 	/* driver private */
@@ -58,7 +68,10 @@ int usb_ether_deregister(struct ueth_data *ueth);
 /**
  * usb_ether_receive() - recieve a packet from the bulk in endpoint
  *
- * The packet is stored in the internal buffer ready for processing.
+ * The packet is stored in the internal buffer ready for processing. Where
+ * the USB controller can queue bulk transfers, several are kept queued so
+ * that the adapter never waits for us, and this does not wait for the next
+ * one to complete.
  *
  * @ueth:	USB Ethernet device
  * @rxsize:	Maximum size to receive
@@ -67,6 +80,15 @@ int usb_ether_deregister(struct ueth_data *ueth);
  */
 int usb_ether_receive(struct ueth_data *ueth, int rxsize);
 
+/**
+ * usb_ether_stop_receive() - give up on the receive transfers still queued
+ *
+ * Call this when the device stops.
+ *
+ * @ueth:	USB Ethernet device
+ */
+void usb_ether_stop_receive(struct ueth_data *ueth);
+
 /**
  * usb_ether_get_rx_bytes() - obtain bytes from the internal packet buffer
  *
@@ -17,10 +17,21 @@
 
 #include <stdio_dev.h>
 
+/**
+ * struct video_uc_platdata - uclass platform data for a video device
+ *
+ * @align:	Frame buffer alignment
+ * @size:	Frame buffer size
+ * @base:	Base address of the frame buffer, set by the uclass
+ * @copy_base:	Base address of the hardware frame buffer, which the frame
+ *		buffer is copied to with CONFIG_VIDEO_COPY. Set by the driver
+ *		in its probe() method, 0 to draw in the hardware frame buffer
+ */
 struct video_uc_platdata {
 	uint align;
 	uint size;
 	ulong base;
+	ulong copy_base;
 };
 
 enum video_polarity {
@@ -49,6 +60,23 @@ enum video_log2_bpp {
 
 #define VNBITS(bpix)	(1 << (bpix))
 
+/**
+ * struct video_damage - area of the frame buffer changed since the last sync
+ *
+ * The area is empty if @xend <= @xstart or @yend <= @ystart.
+ *
+ * @xstart:	First column changed
+ * @ystart:	First row changed
+ * @xend:	Column after the last column changed
+ * @yend:	Row after the last row changed
+ */
+struct video_damage {
+	int xstart;
+	int ystart;
+	int xend;
+	int yend;
+};
+
 /**
  * struct video_priv - Device information used by the video uclass
  *
@@ -60,6 +88,8 @@ enum video_log2_bpp {
  *		select automatically
  * @font_size:	Font size in pixels (0 to use a default value)
  * @fb:		Frame buffer
+ * @copy_fb:	Hardware frame buffer which @fb is copied to, or NULL, see
+ *		CONFIG_VIDEO_COPY
  * @fb_size:	Frame buffer size
  * @line_length:	Length of each frame buffer line, in bytes. This can be
  *		set by the driver, but if not, the uclass will set it after
@@ -70,6 +100,7 @@ enum video_log2_bpp {
  *		the LCD is updated
  * @cmap:	Colour map for 8-bit-per-pixel displays
  * @fg_col_idx:	Foreground color code (bit 3 = bold, bit 0-2 = color)
+ * @damage:	Area changed since the last sync, see video_damage()
  */
 struct video_priv {
 	/* Things set up by the driver: */
@@ -85,6 +116,7 @@ struct video_priv {
 	 * driver
 	 */
 	void *fb;
+	void *copy_fb;
 	int fb_size;
 	int line_length;
 	u32 colour_fg;
@@ -92,6 +124,7 @@ struct video_priv {
 	bool flush_dcache;
 	ushort *cmap;
 	u8 fg_col_idx;
+	struct video_damage damage;
 };
 
 /* Placeholder - there are no video operations at present */
@@ -131,7 +164,8 @@ int video_clear(struct udevice *dev);
  *
  * Some frame buffers are cached or have a secondary frame buffer. This
  * function syncs these up so that the current contents of the U-Boot frame
- * buffer are displayed to the user.
+ * buffer are displayed to the user. Only the area noted with video_damage()
+ * since the last sync is synced.
  *
  * @dev:	Device to sync
  * @force:	True to force a sync even if there was one recently (this is
@@ -139,10 +173,26 @@ int video_clear(struct udevice *dev);
  */
 void video_sync(struct udevice *vid, bool force);
 
+/**
+ * video_damage() - Note an area of the frame buffer which has changed
+ *
+ * The next video_sync() only flushes (and copies, see CONFIG_VIDEO_COPY) the
+ * area changed since the previous sync, so code which draws in the frame
+ * buffer must call this.
+ *
+ * @dev:	Device which was drawn on
+ * @x:		X position of the area in pixels from the left
+ * @y:		Y position of the area in pixels from the top
+ * @width:	Width of the area in pixels
+ * @height:	Height of the area in pixels
+ */
+void video_damage(struct udevice *vid, int x, int y, int width, int height);
+
 /**
  * video_sync_all() - Sync all devices' frame buffers with there hardware
  *
- * This calls video_sync() on all active video devices.
+ * This calls video_sync() on all active video devices, syncing the whole
+ * frame buffer.
  */
 void video_sync_all(void);
 
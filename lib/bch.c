@@ -384,7 +384,7 @@ static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
 			      unsigned int *syn)
 {
 	int i, j, s;
-	unsigned int m;
+	unsigned int m, e, step;
 	uint32_t poly;
 	const int t = GF_T(bch);
 
@@ -402,8 +402,18 @@ static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
 		s -= 32;
 		while (poly) {
 			i = deg(poly);
-			for (j = 0; j < 2*t; j += 2)
-				syn[j] ^= a_pow(bch, (j+1)*(i+s));
+			/*
+			 * walk the exponents (j+1)*(i+s) for odd j+1 by adding
+			 * 2*(i+s) each time, instead of a multiply and a full
+			 * modulo reduction per syndrome; i+s < n always holds
+			 * since the extra bits of the last word are cleared
+			 */
+			e = i+s;
+			step = mod_s(bch, 2*e);
+			for (j = 0; j < 2*t; j += 2) {
+				syn[j] ^= bch->a_pow_tab[e];
+				e = mod_s(bch, e+step);
+			}
 
 			poly ^= (1 << i);
 		}
@@ -155,6 +155,46 @@ tole(0xb40bbe37L), tole(0xc30c8ea1L), tole(0x5a05df1bL), tole(0x2d02ef8dL)
 };
 #endif
 
+#if !defined(USE_HOSTCC) && !defined(CONFIG_DYNAMIC_CRC_TABLE) && \
+	__BYTE_ORDER == __LITTLE_ENDIAN
+#if CONFIG_IS_ENABLED(CRC32_SLICE_BY_8)
+#define CRC32_SLICE_BY_8
+#include "crc32_slice8.h"
+#endif
+#endif
+
+#if defined(CONFIG_ARM64) && !defined(USE_HOSTCC) && \
+	__BYTE_ORDER == __LITTLE_ENDIAN
+#define CRC32_ARM64
+
+/* The CRC32 instructions are optional in ARMv8.0 */
+static inline int __efi_runtime crc32_arm64_have(void)
+{
+    uint64_t isar0;
+
+    asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+
+    return ((isar0 >> 16) & 0xf) != 0;
+}
+
+static uint32_t __efi_runtime crc32_arm64(uint32_t crc, const Bytef *p,
+					   uInt len)
+{
+    /* U-Boot runs with strict alignment, so go byte-wise up to 8 */
+    for (; len && ((long)p & 7); len--, p++)
+	 asm(".arch_extension crc\n\tcrc32b %w0, %w0, %w1"
+	     : "+r" (crc) : "r" ((uint32_t)*p));
+    for (; len >= 8; len -= 8, p += 8)
+	 asm(".arch_extension crc\n\tcrc32x %w0, %w0, %x1"
+	     : "+r" (crc) : "r" (*(const uint64_t *)p));
+    for (; len; len--, p++)
+	 asm(".arch_extension crc\n\tcrc32b %w0, %w0, %w1"
+	     : "+r" (crc) : "r" ((uint32_t)*p));
+
+    return crc;
+}
+#endif
+
 #if 0
 /* =========================================================================
  * This function can be used by asm versions of crc32()
@@ -188,6 +228,10 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 #ifdef CONFIG_DYNAMIC_CRC_TABLE
     if (crc_table_empty)
       make_crc_table();
+#endif
+#ifdef CRC32_ARM64
+    if (crc32_arm64_have())
+	 return crc32_arm64(crc, buf, len);
 #endif
     crc = cpu_to_le32(crc);
     /* Align it */
@@ -199,6 +243,18 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 	 b = (uint32_t *)p;
     }
 
+#ifdef CRC32_SLICE_BY_8
+    /* Eight bytes at a time, see crc32_slice8.h */
+    for (; len >= 8; len -= 8, b += 2) {
+	 const uint32_t (*t)[256] = crc_slice_table;
+	 uint32_t lo = b[0] ^ crc, hi = b[1];
+
+	 crc = t[6][lo & 255] ^ t[5][(lo >> 8) & 255] ^
+	       t[4][(lo >> 16) & 255] ^ t[3][lo >> 24] ^
+	       t[2][hi & 255] ^ t[1][(hi >> 8) & 255] ^
+	       t[0][(hi >> 16) & 255] ^ tab[hi >> 24];
+    }
+#endif
     rem_len = len & 3;
     len = len >> 2;
     for (--b; len; --len) {
@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Decompression of data fed in pieces
+ *
+ * This picks the gzip, LZ4 or zstd decoder from the first bytes of the
+ * data and hands it each piece in turn, so that a loader can decompress a
+ * file as it reads it, through one small buffer, instead of reading all of
+ * it first. All three decoders write to a single output buffer, which also
+ * serves as their window.
+ */
+
+#include <common.h>
+#include <decomp_stream.h>
+#include <errno.h>
+#include <image.h>
+#include <malloc.h>
+#include <asm/unaligned.h>
+#include <u-boot/zstd.h>
+
+#define LZ4F_MAGIC	0x184d2204
+#define ZSTD_MAGIC	0xfd2fb528
+
+struct decomp_stream {
+	int comp;		/* -1 until the first piece is seen */
+	void *dst;
+	size_t dstlen;
+	size_t len;		/* bytes copied, for IH_COMP_NONE */
+	void *priv;		/* stream of the decoder */
+};
+
+struct decomp_stream *decomp_stream_start(void *dst, size_t dstlen)
+{
+	struct decomp_stream *ds;
+
+	ds = calloc(1, sizeof(*ds));
+	if (!ds)
+		return NULL;
+	ds->comp = -1;
+	ds->dst = dst;
+	ds->dstlen = dstlen;
+
+	return ds;
+}
+
+static int decomp_stream_detect(const u8 *p, size_t len)
+{
+	if (len >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+		return IH_COMP_GZIP;
+	if (len >= 4 && get_unaligned_le32(p) == LZ4F_MAGIC)
+		return IH_COMP_LZ4;
+	if (len >= 4 && get_unaligned_le32(p) == ZSTD_MAGIC)
+		return IH_COMP_ZSTD;
+
+	return IH_COMP_NONE;
+}
+
+static int decomp_stream_begin(struct decomp_stream *ds, const void *src,
+			       size_t len)
+{
+	ds->comp = decomp_stream_detect(src, len);
+	switch (ds->comp) {
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		ds->priv = gunzip_stream_start(ds->dst, ds->dstlen);
+		break;
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+		ds->priv = ulz4_stream_start(ds->dst, ds->dstlen);
+		break;
+#endif
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD:
+		ds->priv = zstd_stream_start(ds->dst, ds->dstlen);
+		break;
+#endif
+	case IH_COMP_NONE:
+		return 0;
+	default:
+		printf("%s decompression not built in\n",
+		       genimg_get_comp_name(ds->comp));
+		return -EPROTONOSUPPORT;
+	}
+
+	return ds->priv ? 0 : -ENOMEM;
+}
+
+int decomp_stream_feed(struct decomp_stream *ds, const void *src, size_t len)
+{
+	int ret;
+
+	if (ds->comp < 0) {
+		ret = decomp_stream_begin(ds, src, len);
+		if (ret)
+			return ret;
+	}
+
+	switch (ds->comp) {
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		return gunzip_stream_feed(ds->priv, src, len);
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+		return ulz4_stream_feed(ds->priv, src, len);
+#endif
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD:
+		return zstd_stream_feed(ds->priv, src, len);
+#endif
+	default:
+		if (len > ds->dstlen - ds->len)
+			return -ENOSPC;
+		memcpy(ds->dst + ds->len, src, len);
+		ds->len += len;
+		return 0;
+	}
+}
+
+int decomp_stream_end(struct decomp_stream *ds, size_t *dstlen)
+{
+	int ret = 0;
+
+	*dstlen = ds->len;
+	switch (ds->priv ? ds->comp : IH_COMP_NONE) {
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP: {
+		unsigned long len;
+
+		ret = gunzip_stream_end(ds->priv, &len);
+		*dstlen = len;
+		break;
+	}
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+		ret = ulz4_stream_end(ds->priv, dstlen);
+		break;
+#endif
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD:
+		ret = zstd_stream_end(ds->priv, dstlen);
+		break;
+#endif
+	}
+	free(ds);
+
+	return ret;
+}
+
+int decomp_stream_type(struct decomp_stream *ds)
+{
+	return ds->comp < 0 ? IH_COMP_NONE : ds->comp;
+}
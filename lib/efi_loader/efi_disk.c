@@ -13,12 +13,14 @@
 #include <malloc.h>
 
 const efi_guid_t efi_block_io_guid = BLOCK_IO_GUID;
+static const efi_guid_t efi_block_io2_guid = BLOCK_IO2_GUID;
 
 /**
  * struct efi_disk_obj - EFI disk object
  *
  * @header:	EFI object header
  * @ops:	EFI disk I/O protocol interface
+ * @ops2:	EFI disk I/O 2 protocol interface
  * @ifname:	interface name for block device
  * @dev_index:	device index of block device
  * @media:	block I/O media information
@@ -31,6 +33,7 @@ const efi_guid_t efi_block_io_guid = BLOCK_IO_GUID;
 struct efi_disk_obj {
 	struct efi_object header;
 	struct efi_block_io ops;
+	struct efi_block_io2 ops2;
 	const char *ifname;
 	int dev_index;
 	struct efi_block_io_media media;
@@ -92,31 +95,41 @@ static efi_status_t efi_disk_rw_blocks(struct efi_block_io *this,
 	return EFI_SUCCESS;
 }
 
-static efi_status_t EFIAPI efi_disk_read_blocks(struct efi_block_io *this,
-			u32 media_id, u64 lba, efi_uintn_t buffer_size,
-			void *buffer)
+#ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
+/*
+ * The bounce buffer is only needed for buffers the hardware cannot reach,
+ * i.e. those which do not lie below 4 GiB
+ */
+static bool efi_disk_need_bounce(void *buffer, efi_uintn_t buffer_size)
+{
+	return upper_32_bits((uintptr_t)buffer + buffer_size - 1) != 0;
+}
+#endif
+
+static efi_status_t efi_disk_read(struct efi_block_io *this, u32 media_id,
+				  u64 lba, efi_uintn_t buffer_size,
+				  void *buffer)
 {
 	void *real_buffer = buffer;
 	efi_status_t r;
 
 #ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
-	if (buffer_size > EFI_LOADER_BOUNCE_BUFFER_SIZE) {
-		r = efi_disk_read_blocks(this, media_id, lba,
+	if (buffer_size > EFI_LOADER_BOUNCE_BUFFER_SIZE &&
+	    efi_disk_need_bounce(buffer, buffer_size)) {
+		r = efi_disk_read(this, media_id, lba,
 			EFI_LOADER_BOUNCE_BUFFER_SIZE, buffer);
 		if (r != EFI_SUCCESS)
 			return r;
-		return efi_disk_read_blocks(this, media_id, lba +
+		return efi_disk_read(this, media_id, lba +
 			EFI_LOADER_BOUNCE_BUFFER_SIZE / this->media->block_size,
 			buffer_size - EFI_LOADER_BOUNCE_BUFFER_SIZE,
 			buffer + EFI_LOADER_BOUNCE_BUFFER_SIZE);
 	}
 
-	real_buffer = efi_bounce_buffer;
+	if (efi_disk_need_bounce(buffer, buffer_size))
+		real_buffer = efi_bounce_buffer;
 #endif
 
-	EFI_ENTRY("%p, %x, %llx, %zx, %p", this, media_id, lba,
-		  buffer_size, buffer);
-
 	r = efi_disk_rw_blocks(this, media_id, lba, buffer_size, real_buffer,
 			       EFI_DISK_READ);
 
@@ -124,42 +137,61 @@ static efi_status_t EFIAPI efi_disk_read_blocks(struct efi_block_io *this,
 	if ((r == EFI_SUCCESS) && (real_buffer != buffer))
 		memcpy(buffer, real_buffer, buffer_size);
 
-	return EFI_EXIT(r);
+	return r;
 }
 
-static efi_status_t EFIAPI efi_disk_write_blocks(struct efi_block_io *this,
-			u32 media_id, u64 lba, efi_uintn_t buffer_size,
-			void *buffer)
+static efi_status_t efi_disk_write(struct efi_block_io *this, u32 media_id,
+				   u64 lba, efi_uintn_t buffer_size,
+				   void *buffer)
 {
 	void *real_buffer = buffer;
 	efi_status_t r;
 
 #ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
-	if (buffer_size > EFI_LOADER_BOUNCE_BUFFER_SIZE) {
-		r = efi_disk_write_blocks(this, media_id, lba,
+	if (buffer_size > EFI_LOADER_BOUNCE_BUFFER_SIZE &&
+	    efi_disk_need_bounce(buffer, buffer_size)) {
+		r = efi_disk_write(this, media_id, lba,
 			EFI_LOADER_BOUNCE_BUFFER_SIZE, buffer);
 		if (r != EFI_SUCCESS)
 			return r;
-		return efi_disk_write_blocks(this, media_id, lba +
+		return efi_disk_write(this, media_id, lba +
 			EFI_LOADER_BOUNCE_BUFFER_SIZE / this->media->block_size,
 			buffer_size - EFI_LOADER_BOUNCE_BUFFER_SIZE,
 			buffer + EFI_LOADER_BOUNCE_BUFFER_SIZE);
 	}
 
-	real_buffer = efi_bounce_buffer;
+	if (efi_disk_need_bounce(buffer, buffer_size))
+		real_buffer = efi_bounce_buffer;
 #endif
 
-	EFI_ENTRY("%p, %x, %llx, %zx, %p", this, media_id, lba,
-		  buffer_size, buffer);
-
 	/* Populate bounce buffer if necessary */
 	if (real_buffer != buffer)
 		memcpy(real_buffer, buffer, buffer_size);
 
-	r = efi_disk_rw_blocks(this, media_id, lba, buffer_size, real_buffer,
-			       EFI_DISK_WRITE);
+	return efi_disk_rw_blocks(this, media_id, lba, buffer_size,
+				  real_buffer, EFI_DISK_WRITE);
+}
+
+static efi_status_t EFIAPI efi_disk_read_blocks(struct efi_block_io *this,
+			u32 media_id, u64 lba, efi_uintn_t buffer_size,
+			void *buffer)
+{
+	EFI_ENTRY("%p, %x, %llx, %zx, %p", this, media_id, lba,
+		  buffer_size, buffer);
+
+	return EFI_EXIT(efi_disk_read(this, media_id, lba, buffer_size,
+				      buffer));
+}
 
-	return EFI_EXIT(r);
+static efi_status_t EFIAPI efi_disk_write_blocks(struct efi_block_io *this,
+			u32 media_id, u64 lba, efi_uintn_t buffer_size,
+			void *buffer)
+{
+	EFI_ENTRY("%p, %x, %llx, %zx, %p", this, media_id, lba,
+		  buffer_size, buffer);
+
+	return EFI_EXIT(efi_disk_write(this, media_id, lba, buffer_size,
+				       buffer));
 }
 
 static efi_status_t EFIAPI efi_disk_flush_blocks(struct efi_block_io *this)
@@ -176,6 +208,84 @@ static const struct efi_block_io block_io_disk_template = {
 	.flush_blocks = &efi_disk_flush_blocks,
 };
 
+/*
+ * The block I/O 2 protocol. Requests are carried out before the service
+ * returns, as U-Boot has no interrupts to complete them later, but a
+ * request with a token event still completes by signalling the event.
+ */
+
+/* Complete a block I/O 2 request with status @r */
+static efi_status_t efi_disk_complete(struct efi_block_io2_token *token,
+				      efi_status_t r)
+{
+	if (!token || !token->event)
+		return r;
+
+	token->transaction_status = r;
+	efi_signal_event(token->event, true);
+
+	return EFI_SUCCESS;
+}
+
+static efi_status_t EFIAPI efi_disk_reset_ex(struct efi_block_io2 *this,
+			char extended_verification)
+{
+	EFI_ENTRY("%p, %x", this, extended_verification);
+
+	/* No request is ever outstanding, so there is nothing to abort */
+	return EFI_EXIT(EFI_SUCCESS);
+}
+
+static efi_status_t EFIAPI efi_disk_read_blocks_ex(struct efi_block_io2 *this,
+			u32 media_id, u64 lba,
+			struct efi_block_io2_token *token,
+			efi_uintn_t buffer_size, void *buffer)
+{
+	struct efi_disk_obj *diskobj;
+	efi_status_t r;
+
+	EFI_ENTRY("%p, %x, %llx, %p, %zx, %p", this, media_id, lba, token,
+		  buffer_size, buffer);
+
+	diskobj = container_of(this, struct efi_disk_obj, ops2);
+	r = efi_disk_read(&diskobj->ops, media_id, lba, buffer_size, buffer);
+
+	return EFI_EXIT(efi_disk_complete(token, r));
+}
+
+static efi_status_t EFIAPI efi_disk_write_blocks_ex(struct efi_block_io2 *this,
+			u32 media_id, u64 lba,
+			struct efi_block_io2_token *token,
+			efi_uintn_t buffer_size, void *buffer)
+{
+	struct efi_disk_obj *diskobj;
+	efi_status_t r;
+
+	EFI_ENTRY("%p, %x, %llx, %p, %zx, %p", this, media_id, lba, token,
+		  buffer_size, buffer);
+
+	diskobj = container_of(this, struct efi_disk_obj, ops2);
+	r = efi_disk_write(&diskobj->ops, media_id, lba, buffer_size, buffer);
+
+	return EFI_EXIT(efi_disk_complete(token, r));
+}
+
+static efi_status_t EFIAPI efi_disk_flush_blocks_ex(struct efi_block_io2 *this,
+			struct efi_block_io2_token *token)
+{
+	EFI_ENTRY("%p, %p", this, token);
+
+	/* We always write synchronously */
+	return EFI_EXIT(efi_disk_complete(token, EFI_SUCCESS));
+}
+
+static const struct efi_block_io2 block_io2_disk_template = {
+	.reset_ex = &efi_disk_reset_ex,
+	.read_blocks_ex = &efi_disk_read_blocks_ex,
+	.write_blocks_ex = &efi_disk_write_blocks_ex,
+	.flush_blocks_ex = &efi_disk_flush_blocks_ex,
+};
+
 /*
  * Get the simple file system protocol for a file device path.
  *
@@ -266,6 +376,10 @@ static efi_status_t efi_disk_add_dev(
 			       &diskobj->ops);
 	if (ret != EFI_SUCCESS)
 		return ret;
+	ret = efi_add_protocol(&diskobj->header, &efi_block_io2_guid,
+			       &diskobj->ops2);
+	if (ret != EFI_SUCCESS)
+		return ret;
 	ret = efi_add_protocol(&diskobj->header, &efi_guid_device_path,
 			       diskobj->dp);
 	if (ret != EFI_SUCCESS)
@@ -280,6 +394,7 @@ static efi_status_t efi_disk_add_dev(
 			return ret;
 	}
 	diskobj->ops = block_io_disk_template;
+	diskobj->ops2 = block_io2_disk_template;
 	diskobj->ifname = if_typename;
 	diskobj->dev_index = dev_index;
 	diskobj->offset = offset;
@@ -294,6 +409,7 @@ static efi_status_t efi_disk_add_dev(
 	if (part != 0)
 		diskobj->media.logical_partition = 1;
 	diskobj->ops.media = &diskobj->media;
+	diskobj->ops2.media = &diskobj->media;
 	if (disk)
 		*disk = diskobj;
 	return EFI_SUCCESS;
@@ -29,6 +29,9 @@ struct file_handle {
 	loff_t offset;       /* current file position/cursor */
 	int isdir;
 
+	/* for reading a regular file, opened on first use: */
+	struct fs_file *file;
+
 	/* for reading a directory: */
 	struct fs_dir_stream *dirs;
 	struct fs_dirent *dent;
@@ -52,6 +55,26 @@ static int set_blk_dev(struct file_handle *fh)
 	return fs_set_blk_dev_with_part(fh->fs->desc, fh->fs->part);
 }
 
+/*
+ * Get the fs layer handle of a regular file. It keeps the partition and
+ * the file's size, so reading a file chunk by chunk does not probe the
+ * partition and look the file up again for every chunk.
+ */
+static struct fs_file *file_get(struct file_handle *fh)
+{
+	if (!fh->file && !set_blk_dev(fh))
+		fh->file = fs_file_open(fh->path);
+
+	return fh->file;
+}
+
+/* Drop the fs layer handle after the file changed */
+static void file_put(struct file_handle *fh)
+{
+	fs_file_close(fh->file);
+	fh->file = NULL;
+}
+
 /**
  * is_dir() - check if file handle points to directory
  *
@@ -268,6 +291,7 @@ out:
 static efi_status_t file_close(struct file_handle *fh)
 {
 	fs_closedir(fh->dirs);
+	file_put(fh);
 	free(fh);
 	return EFI_SUCCESS;
 }
@@ -286,6 +310,7 @@ static efi_status_t EFIAPI efi_file_delete(struct efi_file_handle *file)
 
 	EFI_ENTRY("%p", file);
 
+	file_put(fh);
 	if (set_blk_dev(fh)) {
 		ret = EFI_DEVICE_ERROR;
 		goto error;
@@ -302,10 +327,19 @@ error:
 static efi_status_t file_read(struct file_handle *fh, u64 *buffer_size,
 		void *buffer)
 {
+	struct fs_file *file = file_get(fh);
 	loff_t actread;
 
-	if (fs_read(fh->path, map_to_sysmem(buffer), fh->offset,
-		    *buffer_size, &actread))
+	if (!file)
+		return EFI_DEVICE_ERROR;
+
+	if (fh->offset >= fs_file_size(file)) {
+		*buffer_size = 0;
+		return EFI_SUCCESS;
+	}
+
+	if (fs_file_read(file, map_to_sysmem(buffer), fh->offset,
+			 *buffer_size, &actread))
 		return EFI_DEVICE_ERROR;
 
 	*buffer_size = actread;
@@ -400,16 +434,16 @@ static efi_status_t EFIAPI efi_file_read(struct efi_file_handle *file,
 		goto error;
 	}
 
-	if (set_blk_dev(fh)) {
-		ret = EFI_DEVICE_ERROR;
-		goto error;
-	}
-
 	bs = *buffer_size;
-	if (fh->isdir)
+	if (fh->isdir) {
+		if (set_blk_dev(fh)) {
+			ret = EFI_DEVICE_ERROR;
+			goto error;
+		}
 		ret = dir_read(fh, &bs, buffer);
-	else
+	} else {
 		ret = file_read(fh, &bs, buffer);
+	}
 	if (bs <= SIZE_MAX)
 		*buffer_size = bs;
 	else
@@ -429,6 +463,7 @@ static efi_status_t EFIAPI efi_file_write(struct efi_file_handle *file,
 
 	EFI_ENTRY("%p, %p, %p", file, buffer_size, buffer);
 
+	file_put(fh);
 	if (set_blk_dev(fh)) {
 		ret = EFI_DEVICE_ERROR;
 		goto error;
@@ -503,19 +538,14 @@ static efi_status_t EFIAPI efi_file_setpos(struct efi_file_handle *file,
 	}
 
 	if (pos == ~0ULL) {
-		loff_t file_size;
+		struct fs_file *f = file_get(fh);
 
-		if (set_blk_dev(fh)) {
+		if (!f) {
 			ret = EFI_DEVICE_ERROR;
 			goto error;
 		}
 
-		if (fs_size(fh->path, &file_size)) {
-			ret = EFI_DEVICE_ERROR;
-			goto error;
-		}
-
-		pos = file_size;
+		pos = fs_file_size(f);
 	}
 
 	fh->offset = pos;
@@ -548,14 +578,18 @@ static efi_status_t EFIAPI efi_file_getinfo(struct efi_file_handle *file,
 			goto error;
 		}
 
-		if (set_blk_dev(fh)) {
-			ret = EFI_DEVICE_ERROR;
-			goto error;
-		}
+		if (!fh->isdir && file_get(fh)) {
+			file_size = fs_file_size(fh->file);
+		} else {
+			if (set_blk_dev(fh)) {
+				ret = EFI_DEVICE_ERROR;
+				goto error;
+			}
 
-		if (fs_size(fh->path, &file_size)) {
-			ret = EFI_DEVICE_ERROR;
-			goto error;
+			if (fs_size(fh->path, &file_size)) {
+				ret = EFI_DEVICE_ERROR;
+				goto error;
+			}
 		}
 
 		memset(info, 0, required_size);
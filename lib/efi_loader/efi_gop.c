@@ -25,6 +25,7 @@ static const efi_guid_t efi_gop_guid = EFI_GOP_GUID;
  * @mode:	graphical output mode
  * @bpix:	bits per pixel
  * @fb:		frame buffer
+ * @vdev:	video device
  */
 struct efi_gop_obj {
 	struct efi_object header;
@@ -34,6 +35,9 @@ struct efi_gop_obj {
 	/* Fields we only have access to during init */
 	u32 bpix;
 	void *fb;
+#ifdef CONFIG_DM_VIDEO
+	struct udevice *vdev;
+#endif
 };
 
 static efi_status_t EFIAPI gop_query_mode(struct efi_gop *this, u32 mode_number,
@@ -82,6 +86,102 @@ static __always_inline u16 efi_blt_col_to_vid16(struct efi_gop_pixel *blt)
 	       (u16)(blt->blue  >> 3);
 }
 
+/* Fill @count pixels, writing two at a time where possible */
+static void gop_fill16(u16 *dst, u16 val, efi_uintn_t count)
+{
+	u32 val32 = val | (u32)val << 16;
+	u32 *dst32;
+
+	if (((uintptr_t)dst & 2) && count) {
+		*dst++ = val;
+		count--;
+	}
+	for (dst32 = (u32 *)dst; count >= 2; count -= 2)
+		*dst32++ = val32;
+	if (count)
+		*(u16 *)dst32 = val;
+}
+
+static void gop_fill32(u32 *dst, u32 val, efi_uintn_t count)
+{
+	while (count--)
+		*dst++ = val;
+}
+
+/*
+ * Carry out a blit a line at a time with memcpy()/memmove(), which are
+ * word-wide or better, where the frame buffer and the blit buffer use the
+ * same pixel format or the frame buffer is only filled or moved.
+ *
+ * Return: true if the blit was done, false to convert pixel by pixel
+ */
+static __always_inline bool gop_blt_lines(struct efi_gop_obj *gopobj,
+					  struct efi_gop_pixel *buffer,
+					  u32 operation, efi_uintn_t sx,
+					  efi_uintn_t sy, efi_uintn_t dx,
+					  efi_uintn_t dy, efi_uintn_t width,
+					  efi_uintn_t height,
+					  efi_uintn_t swidth,
+					  efi_uintn_t dwidth,
+					  efi_uintn_t vid_bpp)
+{
+	efi_uintn_t bytes = width * vid_bpp / 8;
+	efi_uintn_t i;
+	void *src, *dst, *first;
+
+	switch (operation) {
+	case EFI_BLT_VIDEO_FILL:
+		/* Fill the first line, then copy it */
+		first = gopobj->fb + (dwidth * dy + dx) * vid_bpp / 8;
+		if (vid_bpp == 32)
+			gop_fill32(first, *(u32 *)buffer, width);
+		else
+			gop_fill16(first, efi_blt_col_to_vid16(buffer), width);
+		dst = first;
+		for (i = 1; i < height; i++) {
+			dst += dwidth * vid_bpp / 8;
+			memcpy(dst, first, bytes);
+		}
+		return true;
+	case EFI_BLT_BUFFER_TO_VIDEO:
+		if (vid_bpp != 32)
+			return false;
+		src = buffer + swidth * sy + sx;
+		dst = gopobj->fb + (dwidth * dy + dx) * 4;
+		for (i = 0; i < height; i++) {
+			memcpy(dst, src, bytes);
+			src += swidth * 4;
+			dst += dwidth * 4;
+		}
+		return true;
+	case EFI_BLT_VIDEO_TO_BLT_BUFFER:
+		if (vid_bpp != 32)
+			return false;
+		src = gopobj->fb + (swidth * sy + sx) * 4;
+		dst = buffer + dwidth * dy + dx;
+		for (i = 0; i < height; i++) {
+			memcpy(dst, src, bytes);
+			src += swidth * 4;
+			dst += dwidth * 4;
+		}
+		return true;
+	case EFI_BLT_VIDEO_TO_VIDEO:
+		/* The areas may overlap, so copy bottom-up if moving down */
+		for (i = 0; i < height; i++) {
+			efi_uintn_t line = dy > sy ? height - 1 - i : i;
+
+			src = gopobj->fb +
+			      (swidth * (sy + line) + sx) * vid_bpp / 8;
+			dst = gopobj->fb +
+			      (dwidth * (dy + line) + dx) * vid_bpp / 8;
+			memmove(dst, src, bytes);
+		}
+		return true;
+	}
+
+	return false;
+}
+
 static __always_inline efi_status_t gop_blt_int(struct efi_gop *this,
 						struct efi_gop_pixel *bufferp,
 						u32 operation, efi_uintn_t sx,
@@ -169,6 +269,10 @@ static __always_inline efi_status_t gop_blt_int(struct efi_gop *this,
 		break;
 	}
 
+	if (gop_blt_lines(gopobj, buffer, operation, sx, sy, dx, dy, width,
+			  height, swidth, dwidth, vid_bpp))
+		return EFI_SUCCESS;
+
 	slineoff = swidth * sy;
 	dlineoff = dwidth * dy;
 	for (i = 0; i < height; i++) {
@@ -333,6 +437,7 @@ efi_status_t EFIAPI gop_blt(struct efi_gop *this, struct efi_gop_pixel *buffer,
 			    efi_uintn_t dy, efi_uintn_t width,
 			    efi_uintn_t height, efi_uintn_t delta)
 {
+	__maybe_unused struct efi_gop_obj *gopobj;
 	efi_status_t ret = EFI_INVALID_PARAMETER;
 	efi_uintn_t vid_bpp;
 
@@ -373,8 +478,14 @@ efi_status_t EFIAPI gop_blt(struct efi_gop *this, struct efi_gop_pixel *buffer,
 	if (ret != EFI_SUCCESS)
 		return EFI_EXIT(ret);
 
+	/* Reading the frame buffer does not change it */
+	if (operation == EFI_BLT_VIDEO_TO_BLT_BUFFER)
+		return EFI_EXIT(EFI_SUCCESS);
+
 #ifdef CONFIG_DM_VIDEO
-	video_sync_all();
+	gopobj = container_of(this, struct efi_gop_obj, ops);
+	video_damage(gopobj->vdev, dx, dy, width, height);
+	video_sync(gopobj->vdev, true);
 #else
 	lcd_sync();
 #endif
@@ -486,6 +597,9 @@ efi_status_t efi_gop_register(void)
 
 	gopobj->bpix = bpix;
 	gopobj->fb = fb;
+#ifdef CONFIG_DM_VIDEO
+	gopobj->vdev = vdev;
+#endif
 
 	return EFI_SUCCESS;
 }
@@ -10,24 +10,31 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <watchdog.h>
-#include <linux/list_sort.h>
+#include <linux/rbtree_augmented.h>
 #include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
 efi_uintn_t efi_memory_map_key;
 
+/**
+ * struct efi_mem_list - memory map item
+ *
+ * @node:	node in the efi_mem tree, ordered by start address
+ * @desc:	memory descriptor
+ * @max_free:	number of pages of the largest free region in the subtree
+ *		rooted at this item, used to find free memory quickly
+ */
 struct efi_mem_list {
-	struct list_head link;
+	struct rb_node node;
 	struct efi_mem_desc desc;
+	u64 max_free;
 };
 
-#define EFI_CARVE_NO_OVERLAP		-1
-#define EFI_CARVE_LOOP_AGAIN		-2
-#define EFI_CARVE_OVERLAPS_NONRAM	-3
-
-/* This list contains all memory map items */
-LIST_HEAD(efi_mem);
+/* This tree contains all memory map items, which never overlap */
+static struct rb_root efi_mem = RB_ROOT;
+/* Number of items in efi_mem */
+static int efi_mem_count;
 
 #ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
 void *efi_bounce_buffer;
@@ -46,24 +53,9 @@ struct efi_pool_allocation {
 	char data[] __aligned(ARCH_DMA_MINALIGN);
 };
 
-/*
- * Sorts the memory list from highest address to lowest address
- *
- * When allocating memory we should always start from the highest
- * address chunk, so sort the memory list such that the first list
- * iterator gets the highest address and goes lower from there.
- */
-static int efi_mem_cmp(void *priv, struct list_head *a, struct list_head *b)
+static struct efi_mem_list *efi_mem_entry(struct rb_node *node)
 {
-	struct efi_mem_list *mema = list_entry(a, struct efi_mem_list, link);
-	struct efi_mem_list *memb = list_entry(b, struct efi_mem_list, link);
-
-	if (mema->desc.physical_start == memb->desc.physical_start)
-		return 0;
-	else if (mema->desc.physical_start < memb->desc.physical_start)
-		return 1;
-	else
-		return -1;
+	return node ? rb_entry(node, struct efi_mem_list, node) : NULL;
 }
 
 static uint64_t desc_get_end(struct efi_mem_desc *desc)
@@ -71,138 +63,167 @@ static uint64_t desc_get_end(struct efi_mem_desc *desc)
 	return desc->physical_start + (desc->num_pages << EFI_PAGE_SHIFT);
 }
 
-static void efi_mem_sort(void)
+static u64 efi_mem_compute_free(struct efi_mem_list *lmem)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *prevmem = NULL;
-	bool merge_again = true;
-
-	list_sort(NULL, &efi_mem, efi_mem_cmp);
-
-	/* Now merge entries that can be merged */
-	while (merge_again) {
-		merge_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			struct efi_mem_desc *prev = &prevmem->desc;
-			struct efi_mem_desc *cur;
-			uint64_t pages;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			if (!prevmem) {
-				prevmem = lmem;
-				continue;
-			}
+	struct efi_mem_list *child;
+	u64 max_free = 0;
+
+	if (lmem->desc.type == EFI_CONVENTIONAL_MEMORY)
+		max_free = lmem->desc.num_pages;
+	child = efi_mem_entry(lmem->node.rb_left);
+	if (child)
+		max_free = max(max_free, child->max_free);
+	child = efi_mem_entry(lmem->node.rb_right);
+	if (child)
+		max_free = max(max_free, child->max_free);
+
+	return max_free;
+}
 
-			cur = &lmem->desc;
-
-			if ((desc_get_end(cur) == prev->physical_start) &&
-			    (prev->type == cur->type) &&
-			    (prev->attribute == cur->attribute)) {
-				/* There is an existing map before, reuse it */
-				pages = cur->num_pages;
-				prev->num_pages += pages;
-				prev->physical_start -= pages << EFI_PAGE_SHIFT;
-				prev->virtual_start -= pages << EFI_PAGE_SHIFT;
-				list_del(&lmem->link);
-				free(lmem);
-
-				merge_again = true;
-				break;
-			}
+RB_DECLARE_CALLBACKS(static, efi_mem_cb, struct efi_mem_list, node, u64,
+		     max_free, efi_mem_compute_free)
 
-			prevmem = lmem;
-		}
+/* Update the tree after changing the size or type of @lmem */
+static void efi_mem_update(struct efi_mem_list *lmem)
+{
+	efi_mem_cb_propagate(&lmem->node, NULL);
+}
+
+static void efi_mem_insert(struct efi_mem_list *newmem)
+{
+	struct rb_node **link = &efi_mem.rb_node, *parent = NULL;
+	u64 start = newmem->desc.physical_start;
+
+	while (*link) {
+		parent = *link;
+		if (start < efi_mem_entry(parent)->desc.physical_start)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
 	}
+	rb_link_node(&newmem->node, parent, link);
+	newmem->max_free = efi_mem_compute_free(newmem);
+	if (parent)
+		efi_mem_update(efi_mem_entry(parent));
+	rb_insert_augmented(&newmem->node, &efi_mem, &efi_mem_cb);
+	efi_mem_count++;
 }
 
-/** efi_mem_carve_out - unmap memory region
- *
- * @map:		memory map
- * @carve_desc:		memory region to unmap
- * @overlap_only_ram:	the carved out region may only overlap RAM
- * Return Value:	the number of overlapping pages which have been
- *			removed from the map,
- *			EFI_CARVE_NO_OVERLAP, if the regions don't overlap,
- *			EFI_CARVE_OVERLAPS_NONRAM, if the carve and map overlap,
- *			and the map contains anything but free ram
- *			(only when overlap_only_ram is true),
- *			EFI_CARVE_LOOP_AGAIN, if the mapping list should be
- *			traversed again, as it has been altered.
- *
- * Unmaps all memory occupied by the carve_desc region from the list entry
- * pointed to by map.
- *
- * In case of EFI_CARVE_OVERLAPS_NONRAM it is the callers responsibility
- * to re-add the already carved out pages to the mapping.
- */
-static s64 efi_mem_carve_out(struct efi_mem_list *map,
-			     struct efi_mem_desc *carve_desc,
-			     bool overlap_only_ram)
+static void efi_mem_remove(struct efi_mem_list *lmem)
+{
+	rb_erase_augmented(&lmem->node, &efi_mem, &efi_mem_cb);
+	efi_mem_count--;
+	free(lmem);
+}
+
+/* Find the first item which ends after @addr */
+static struct efi_mem_list *efi_mem_find(u64 addr)
 {
-	struct efi_mem_list *newmap;
-	struct efi_mem_desc *map_desc = &map->desc;
-	uint64_t map_start = map_desc->physical_start;
-	uint64_t map_end = map_start + (map_desc->num_pages << EFI_PAGE_SHIFT);
-	uint64_t carve_start = carve_desc->physical_start;
-	uint64_t carve_end = carve_start +
-			     (carve_desc->num_pages << EFI_PAGE_SHIFT);
-
-	/* check whether we're overlapping */
-	if ((carve_end <= map_start) || (carve_start >= map_end))
-		return EFI_CARVE_NO_OVERLAP;
-
-	/* We're overlapping with non-RAM, warn the caller if desired */
-	if (overlap_only_ram && (map_desc->type != EFI_CONVENTIONAL_MEMORY))
-		return EFI_CARVE_OVERLAPS_NONRAM;
-
-	/* Sanitize carve_start and carve_end to lie within our bounds */
-	carve_start = max(carve_start, map_start);
-	carve_end = min(carve_end, map_end);
-
-	/* Carving at the beginning of our map? Just move it! */
-	if (carve_start == map_start) {
-		if (map_end == carve_end) {
-			/* Full overlap, just remove map */
-			list_del(&map->link);
-			free(map);
+	struct rb_node *node = efi_mem.rb_node;
+	struct efi_mem_list *found = NULL;
+
+	while (node) {
+		struct efi_mem_list *lmem = efi_mem_entry(node);
+
+		if (desc_get_end(&lmem->desc) > addr) {
+			found = lmem;
+			node = node->rb_left;
 		} else {
-			map->desc.physical_start = carve_end;
-			map->desc.num_pages = (map_end - carve_end)
-					      >> EFI_PAGE_SHIFT;
+			node = node->rb_right;
 		}
+	}
+
+	return found;
+}
 
-		return (carve_end - carve_start) >> EFI_PAGE_SHIFT;
+static bool efi_mem_can_merge(struct efi_mem_desc *prev,
+			      struct efi_mem_desc *cur)
+{
+	return desc_get_end(prev) == cur->physical_start &&
+	       prev->type == cur->type && prev->attribute == cur->attribute;
+}
+
+/* Merge @lmem with its neighbours, if they are of the same kind */
+static void efi_mem_merge(struct efi_mem_list *lmem)
+{
+	struct efi_mem_list *prev, *next;
+	u64 pages;
+
+	prev = efi_mem_entry(rb_prev(&lmem->node));
+	if (prev && efi_mem_can_merge(&prev->desc, &lmem->desc)) {
+		pages = lmem->desc.num_pages;
+		efi_mem_remove(lmem);
+		prev->desc.num_pages += pages;
+		efi_mem_update(prev);
+		lmem = prev;
 	}
 
-	/*
-	 * Overlapping maps, just split the list map at carve_start,
-	 * it will get moved or removed in the next iteration.
-	 *
-	 * [ map_desc |__carve_start__| newmap ]
-	 */
+	next = efi_mem_entry(rb_next(&lmem->node));
+	if (next && efi_mem_can_merge(&lmem->desc, &next->desc)) {
+		pages = next->desc.num_pages;
+		efi_mem_remove(next);
+		lmem->desc.num_pages += pages;
+		efi_mem_update(lmem);
+	}
+}
 
-	/* Create a new map from [ carve_start ... map_end ] */
-	newmap = calloc(1, sizeof(*newmap));
-	newmap->desc = map->desc;
-	newmap->desc.physical_start = carve_start;
-	newmap->desc.num_pages = (map_end - carve_start) >> EFI_PAGE_SHIFT;
-	/* Insert before current entry (descending address order) */
-	list_add_tail(&newmap->link, &map->link);
+/**
+ * efi_mem_carve_out() - unmap a memory region
+ *
+ * Removes the region from all items which overlap it, splitting an item
+ * if the region is in its middle.
+ *
+ * @first:	first item which overlaps the region
+ * @start:	start of the region
+ * @end:	end of the region
+ * Return Value: 0 if OK, -ENOMEM if out of memory
+ */
+static int efi_mem_carve_out(struct efi_mem_list *first, u64 start, u64 end)
+{
+	struct efi_mem_list *lmem, *next, *tail;
 
-	/* Shrink the map to [ map_start ... carve_start ] */
-	map_desc->num_pages = (carve_start - map_start) >> EFI_PAGE_SHIFT;
+	for (lmem = first; lmem && lmem->desc.physical_start < end;
+	     lmem = next) {
+		struct efi_mem_desc *desc = &lmem->desc;
+		u64 map_start = desc->physical_start;
+		u64 map_end = desc_get_end(desc);
+
+		next = efi_mem_entry(rb_next(&lmem->node));
+		if (map_start < start) {
+			if (map_end > end) {
+				/* [ lmem | carve | tail ] */
+				tail = calloc(1, sizeof(*tail));
+				if (!tail)
+					return -ENOMEM;
+				tail->desc = *desc;
+				tail->desc.physical_start = end;
+				tail->desc.virtual_start += end - map_start;
+				tail->desc.num_pages = (map_end - end) >>
+						       EFI_PAGE_SHIFT;
+				efi_mem_insert(tail);
+			}
+			desc->num_pages = (start - map_start) >> EFI_PAGE_SHIFT;
+			efi_mem_update(lmem);
+		} else if (map_end > end) {
+			/* Carving at the beginning of the item, just move it */
+			desc->physical_start = end;
+			desc->virtual_start += end - map_start;
+			desc->num_pages = (map_end - end) >> EFI_PAGE_SHIFT;
+			efi_mem_update(lmem);
+		} else {
+			/* Full overlap, just remove the item */
+			efi_mem_remove(lmem);
+		}
+	}
 
-	return EFI_CARVE_LOOP_AGAIN;
+	return 0;
 }
 
 uint64_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 			    bool overlap_only_ram)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *newlist;
-	bool carve_again;
-	uint64_t carved_pages = 0;
+	struct efi_mem_list *newmem, *first, *lmem;
+	u64 end = start + (pages << EFI_PAGE_SHIFT);
 
 	debug("%s: 0x%llx 0x%llx %d %s\n", __func__,
 	      start, pages, memory_type, overlap_only_ram ? "yes" : "no");
@@ -213,124 +234,104 @@ uint64_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 	if (!pages)
 		return start;
 
+	first = efi_mem_find(start);
+	if (overlap_only_ram) {
+		u64 pos = start;
+
+		/*
+		 * The payload wanted to have RAM overlaps, so the region must
+		 * be entirely covered by free RAM
+		 */
+		for (lmem = first; lmem && lmem->desc.physical_start < end;
+		     lmem = efi_mem_entry(rb_next(&lmem->node))) {
+			if (lmem->desc.physical_start > pos ||
+			    lmem->desc.type != EFI_CONVENTIONAL_MEMORY)
+				return 0;
+			pos = desc_get_end(&lmem->desc);
+		}
+		if (pos < end)
+			return 0;
+	}
+
 	++efi_memory_map_key;
-	newlist = calloc(1, sizeof(*newlist));
-	newlist->desc.type = memory_type;
-	newlist->desc.physical_start = start;
-	newlist->desc.virtual_start = start;
-	newlist->desc.num_pages = pages;
+	newmem = calloc(1, sizeof(*newmem));
+	if (!newmem)
+		return 0;
+	newmem->desc.type = memory_type;
+	newmem->desc.physical_start = start;
+	newmem->desc.virtual_start = start;
+	newmem->desc.num_pages = pages;
 
 	switch (memory_type) {
 	case EFI_RUNTIME_SERVICES_CODE:
 	case EFI_RUNTIME_SERVICES_DATA:
-		newlist->desc.attribute = EFI_MEMORY_WB | EFI_MEMORY_RUNTIME;
+		newmem->desc.attribute = EFI_MEMORY_WB | EFI_MEMORY_RUNTIME;
 		break;
 	case EFI_MMAP_IO:
-		newlist->desc.attribute = EFI_MEMORY_RUNTIME;
+		newmem->desc.attribute = EFI_MEMORY_RUNTIME;
 		break;
 	default:
-		newlist->desc.attribute = EFI_MEMORY_WB;
+		newmem->desc.attribute = EFI_MEMORY_WB;
 		break;
 	}
 
-	/* Add our new map */
-	do {
-		carve_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			s64 r;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			r = efi_mem_carve_out(lmem, &newlist->desc,
-					      overlap_only_ram);
-			switch (r) {
-			case EFI_CARVE_OVERLAPS_NONRAM:
-				/*
-				 * The user requested to only have RAM overlaps,
-				 * but we hit a non-RAM region. Error out.
-				 */
-				return 0;
-			case EFI_CARVE_NO_OVERLAP:
-				/* Just ignore this list entry */
-				break;
-			case EFI_CARVE_LOOP_AGAIN:
-				/*
-				 * We split an entry, but need to loop through
-				 * the list again to actually carve it.
-				 */
-				carve_again = true;
-				break;
-			default:
-				/* We carved a number of pages */
-				carved_pages += r;
-				carve_again = true;
-				break;
-			}
+	if (efi_mem_carve_out(first, start, end)) {
+		free(newmem);
+		return 0;
+	}
 
-			if (carve_again) {
-				/* The list changed, we need to start over */
-				break;
-			}
-		}
-	} while (carve_again);
+	/* Add our new map and merge it with its neighbours */
+	efi_mem_insert(newmem);
+	efi_mem_merge(newmem);
 
-	if (overlap_only_ram && (carved_pages != pages)) {
-		/*
-		 * The payload wanted to have RAM overlaps, but we overlapped
-		 * with an unallocated region. Error out.
-		 */
+	return start;
+}
+
+/**
+ * efi_find_free() - find the highest free region in a subtree
+ *
+ * @node:	root of subtree to search
+ * @len:	size of region in bytes, a multiple of the page size
+ * @max_addr:	end of the region must not be above this page-aligned address
+ * Return Value: start address of region, or 0 if none
+ */
+static u64 efi_find_free(struct rb_node *node, u64 len, u64 max_addr)
+{
+	struct efi_mem_list *lmem = efi_mem_entry(node);
+	u64 ret, curmax;
+
+	/* Skip subtrees which don't have a large enough free region */
+	if (!lmem || lmem->max_free < len >> EFI_PAGE_SHIFT)
 		return 0;
+
+	/* Try higher addresses first, unless they are all above max_addr */
+	if (lmem->desc.physical_start < max_addr) {
+		ret = efi_find_free(node->rb_right, len, max_addr);
+		if (ret)
+			return ret;
 	}
 
-	/* Add our new map */
-        list_add_tail(&newlist->link, &efi_mem);
+	/* We only take memory from free RAM */
+	if (lmem->desc.type == EFI_CONVENTIONAL_MEMORY) {
+		curmax = min(max_addr, desc_get_end(&lmem->desc));
 
-	/* And make sure memory is listed in descending order */
-	efi_mem_sort();
+		/* Return the highest address in this map within bounds */
+		if (curmax >= lmem->desc.physical_start + len)
+			return curmax - len;
+	}
 
-	return start;
+	return efi_find_free(node->rb_left, len, max_addr);
 }
 
 static uint64_t efi_find_free_memory(uint64_t len, uint64_t max_addr)
 {
-	struct list_head *lhandle;
-
 	/*
 	 * Prealign input max address, so we simplify our matching
 	 * logic below and can just reuse it as return pointer.
 	 */
 	max_addr &= ~EFI_PAGE_MASK;
 
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem = list_entry(lhandle,
-			struct efi_mem_list, link);
-		struct efi_mem_desc *desc = &lmem->desc;
-		uint64_t desc_len = desc->num_pages << EFI_PAGE_SHIFT;
-		uint64_t desc_end = desc->physical_start + desc_len;
-		uint64_t curmax = min(max_addr, desc_end);
-		uint64_t ret = curmax - len;
-
-		/* We only take memory from free RAM */
-		if (desc->type != EFI_CONVENTIONAL_MEMORY)
-			continue;
-
-		/* Out of bounds for max_addr */
-		if ((ret + len) > max_addr)
-			continue;
-
-		/* Out of bounds for upper map limit */
-		if ((ret + len) > desc_end)
-			continue;
-
-		/* Out of bounds for lower map limit */
-		if (ret < desc->physical_start)
-			continue;
-
-		/* Return the highest address in this map within bounds */
-		return ret;
-	}
-
-	return 0;
+	return efi_find_free(efi_mem.rb_node, len, max_addr);
 }
 
 /*
@@ -421,7 +422,6 @@ efi_status_t efi_free_pages(uint64_t memory, efi_uintn_t pages)
 	uint64_t r = 0;
 
 	r = efi_add_memory_map(memory, pages, EFI_CONVENTIONAL_MEMORY, false);
-	/* Merging of adjacent free regions is missing */
 
 	if (r == memory)
 		return EFI_SUCCESS;
@@ -505,8 +505,8 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 				uint32_t *descriptor_version)
 {
 	efi_uintn_t map_size = 0;
-	int map_entries = 0;
-	struct list_head *lhandle;
+	int map_entries = efi_mem_count;
+	struct rb_node *node;
 	efi_uintn_t provided_map_size;
 
 	if (!memory_map_size)
@@ -514,9 +514,6 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 
 	provided_map_size = *memory_map_size;
 
-	list_for_each(lhandle, &efi_mem)
-		map_entries++;
-
 	map_size = map_entries * sizeof(struct efi_mem_desc);
 
 	*memory_map_size = map_size;
@@ -533,16 +530,9 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 	if (descriptor_version)
 		*descriptor_version = EFI_MEMORY_DESCRIPTOR_VERSION;
 
-	/* Copy list into array */
-	/* Return the list in ascending order */
-	memory_map = &memory_map[map_entries - 1];
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem;
-
-		lmem = list_entry(lhandle, struct efi_mem_list, link);
-		*memory_map = lmem->desc;
-		memory_map--;
-	}
+	/* Copy tree into array, in ascending order */
+	for (node = rb_first(&efi_mem); node; node = rb_next(node))
+		*memory_map++ = efi_mem_entry(node)->desc;
 
 	if (map_key)
 		*map_key = efi_memory_map_key;
@@ -12,10 +12,21 @@
 static const efi_guid_t efi_net_guid = EFI_SIMPLE_NETWORK_GUID;
 static const efi_guid_t efi_pxe_guid = EFI_PXE_GUID;
 static struct efi_pxe_packet *dhcp_ack;
-static bool new_rx_packet;
 static void *new_tx_packet;
 static void *transmit_buffer;
 
+/*
+ * Received packets are queued until the application reads them. The queue
+ * is only refilled when there is room for a whole batch from eth_rx(), so
+ * further packets wait in the driver instead of being dropped.
+ */
+#define EFI_NET_RX_QUEUE	(2 * ETH_RX_BATCH)	/* power of 2 */
+
+static uchar *rx_buffer;		/* EFI_NET_RX_QUEUE packet buffers */
+static int rx_len[EFI_NET_RX_QUEUE];
+static uint rx_head;			/* next packet to hand out */
+static uint rx_tail;			/* next free buffer */
+
 /*
  * The notification function of this event is called in every timer cycle
  * to check if a new network packet has been received.
@@ -43,6 +54,17 @@ struct efi_net_obj {
 	struct efi_pxe_mode pxe_mode;
 };
 
+/* Number of received packets waiting to be read */
+static uint efi_net_rx_count(void)
+{
+	return rx_tail - rx_head;
+}
+
+static uchar *efi_net_rx_buf(uint idx)
+{
+	return rx_buffer + (idx % EFI_NET_RX_QUEUE) * PKTSIZE_ALIGN;
+}
+
 /*
  * efi_net_start() - start the network interface
  *
@@ -131,6 +153,7 @@ static efi_status_t EFIAPI efi_net_initialize(struct efi_simple_network *this,
 
 	/* Setup packet buffers */
 	net_init();
+	rx_head = rx_tail;
 	/* Disable hardware and put it into the reset state */
 	eth_halt();
 	/* Set current device according to environment variables */
@@ -351,7 +374,7 @@ static efi_status_t EFIAPI efi_net_get_status(struct efi_simple_network *this,
 	if (int_status) {
 		/* We send packets synchronously, so nothing is outstanding */
 		*int_status = EFI_SIMPLE_NETWORK_TRANSMIT_INTERRUPT;
-		if (new_rx_packet)
+		if (efi_net_rx_count())
 			*int_status |= EFI_SIMPLE_NETWORK_RECEIVE_INTERRUPT;
 	}
 	if (txbuf)
@@ -457,6 +480,8 @@ static efi_status_t EFIAPI efi_net_receive
 	efi_status_t ret = EFI_SUCCESS;
 	struct ethernet_hdr *eth_hdr;
 	size_t hdr_size = sizeof(struct ethernet_hdr);
+	uchar *pkt;
+	int len;
 	u16 protlen;
 
 	EFI_ENTRY("%p, %p, %p, %p, %p, %p, %p", this, header_size,
@@ -482,22 +507,18 @@ static efi_status_t EFIAPI efi_net_receive
 		break;
 	}
 
-	if (!new_rx_packet) {
-		ret = EFI_NOT_READY;
-		goto out;
-	}
-	/* Check that we at least received an Ethernet header */
-	if (net_rx_packet_len < sizeof(struct ethernet_hdr)) {
-		new_rx_packet = false;
+	if (!efi_net_rx_count()) {
 		ret = EFI_NOT_READY;
 		goto out;
 	}
+	pkt = efi_net_rx_buf(rx_head);
+	len = rx_len[rx_head % EFI_NET_RX_QUEUE];
 	/* Fill export parameters */
-	eth_hdr = (struct ethernet_hdr *)net_rx_packet;
+	eth_hdr = (struct ethernet_hdr *)pkt;
 	protlen = ntohs(eth_hdr->et_protlen);
 	if (protlen == 0x8100) {
 		hdr_size += 4;
-		protlen = ntohs(*(u16 *)&net_rx_packet[hdr_size - 2]);
+		protlen = ntohs(*(u16 *)&pkt[hdr_size - 2]);
 	}
 	if (header_size)
 		*header_size = hdr_size;
@@ -507,16 +528,18 @@ static efi_status_t EFIAPI efi_net_receive
 		memcpy(src_addr, eth_hdr->et_src, ARP_HLEN);
 	if (protocol)
 		*protocol = protlen;
-	if (*buffer_size < net_rx_packet_len) {
+	if (*buffer_size < len) {
 		/* Packet doesn't fit, try again with bigger buffer */
-		*buffer_size = net_rx_packet_len;
+		*buffer_size = len;
 		ret = EFI_BUFFER_TOO_SMALL;
 		goto out;
 	}
 	/* Copy packet */
-	memcpy(buffer, net_rx_packet, net_rx_packet_len);
-	*buffer_size = net_rx_packet_len;
-	new_rx_packet = false;
+	memcpy(buffer, pkt, len);
+	*buffer_size = len;
+	rx_head++;
+	if (!efi_net_rx_count())
+		wait_for_packet->is_signaled = false;
 out:
 	return EFI_EXIT(ret);
 }
@@ -540,13 +563,21 @@ void efi_net_set_dhcp_ack(void *pkt, int len)
  * efi_net_push() - callback for received network packet
  *
  * This function is called when a network packet is received by eth_rx().
+ * The packet is copied to the receive queue, or dropped if the queue is
+ * full or the packet is too short to hold an Ethernet header.
  *
  * @pkt:	network packet
  * @len:	length
  */
 static void efi_net_push(void *pkt, int len)
 {
-	new_rx_packet = true;
+	if (len < sizeof(struct ethernet_hdr) || len > PKTSIZE_ALIGN ||
+	    efi_net_rx_count() == EFI_NET_RX_QUEUE)
+		return;
+
+	memcpy(efi_net_rx_buf(rx_tail), pkt, len);
+	rx_len[rx_tail % EFI_NET_RX_QUEUE] = len;
+	rx_tail++;
 	wait_for_packet->is_signaled = true;
 }
 
@@ -572,7 +603,8 @@ static void EFIAPI efi_network_timer_notify(struct efi_event *event,
 	if (!this || this->mode->state != EFI_NETWORK_INITIALIZED)
 		goto out;
 
-	if (!new_rx_packet) {
+	/* Fetch a whole batch from the driver if there is room for it */
+	if (EFI_NET_RX_QUEUE - efi_net_rx_count() >= ETH_RX_BATCH) {
 		push_packet = efi_net_push;
 		eth_rx();
 		push_packet = NULL;
@@ -607,6 +639,11 @@ efi_status_t efi_net_register(void)
 		goto out_of_resources;
 	transmit_buffer = (void *)ALIGN((uintptr_t)transmit_buffer, PKTALIGN);
 
+	/* Allocate the receive queue */
+	rx_buffer = memalign(PKTALIGN, EFI_NET_RX_QUEUE * PKTSIZE_ALIGN);
+	if (!rx_buffer)
+		goto out_of_resources;
+
 	/* Hook net up to the device list */
 	efi_add_handle(&netobj->header);
 
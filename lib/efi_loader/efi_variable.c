@@ -8,10 +8,13 @@
 #include <malloc.h>
 #include <charset.h>
 #include <efi_loader.h>
+#include <fs.h>
 #include <hexdump.h>
 #include <environment.h>
+#include <mapmem.h>
 #include <search.h>
 #include <uuid.h>
+#include <u-boot/crc.h>
 
 #define READ_ONLY BIT(31)
 
@@ -37,6 +40,12 @@
  * NOTE: with current implementation, no variables are available after
  * ExitBootServices, and all are persisted (if possible).
  *
+ * The U-Boot variables are only read when the first UEFI variable is
+ * accessed. The UEFI variables are then held in an in-memory store, indexed
+ * by a hash of the vendor GUID and the name, and each change is written
+ * back. With CONFIG_EFI_VARIABLE_FILE_STORE they are written to a file in
+ * a binary format instead, see struct efi_var_file.
+ *
  * If not specified, the attributes default to "{boot}".
  *
  * The required type is one of:
@@ -145,165 +154,502 @@ static const char *parse_attr(const char *str, u32 *attrp)
 	return str;
 }
 
+/* Number of hash chains in the variable store */
+#define EFI_VAR_HASH_SIZE	64
+
+/* Binary file holding the variables with CONFIG_EFI_VARIABLE_FILE_STORE */
+#define EFI_VAR_FILE_NAME	"ubootefi.var"
+#define EFI_VAR_FILE_MAGIC	0x0161566966456255ULL	/* UbEfiVa, version 1 */
+
 /**
- * efi_efi_get_variable() - retrieve value of a UEFI variable
+ * struct efi_var - UEFI variable in the in-memory store
  *
- * This function implements the GetVariable runtime service.
+ * @list:	entry in efi_var_list, in order of creation
+ * @hash_next:	next variable in the same hash chain
+ * @vendor:	vendor GUID
+ * @attr:	attributes, including READ_ONLY
+ * @hash:	hash of @vendor and @name
+ * @data_size:	size of @data in bytes
+ * @data:	value of the variable
+ * @name_size:	size of @name in bytes, including the terminating 0
+ * @name:	name of the variable
+ */
+struct efi_var {
+	struct list_head list;
+	struct efi_var *hash_next;
+	efi_guid_t vendor;
+	u32 attr;
+	u32 hash;
+	efi_uintn_t data_size;
+	void *data;
+	efi_uintn_t name_size;
+	u16 name[];
+};
+
+/**
+ * struct efi_var_file - header of the variable file
  *
- * See the Unified Extensible Firmware Interface (UEFI) specification for
- * details.
+ * @magic:	EFI_VAR_FILE_MAGIC
+ * @length:	size of the file in bytes
+ * @crc32:	CRC32 of the entries
  *
- * @variable_name:	name of the variable
- * @vendor:		vendor GUID
- * @attributes:		attributes of the variable
- * @data_size:		size of the buffer to which the variable value is copied
- * @data:		buffer to which the variable value is copied
- * Return:		status code
+ * The header is followed by a struct efi_var_entry for each variable.
  */
-efi_status_t EFIAPI efi_get_variable(u16 *variable_name,
-				     const efi_guid_t *vendor, u32 *attributes,
-				     efi_uintn_t *data_size, void *data)
+struct efi_var_file {
+	u64 magic;
+	u32 length;
+	u32 crc32;
+};
+
+/**
+ * struct efi_var_entry - variable in the variable file
+ *
+ * @length:	size of the entry in bytes, a multiple of 8
+ * @attr:	attributes
+ * @name_size:	size of the name in bytes, including the terminating 0
+ * @data_size:	size of the value in bytes
+ * @vendor:	vendor GUID
+ *
+ * The entry is followed by the name and the value.
+ */
+struct efi_var_entry {
+	u32 length;
+	u32 attr;
+	u32 name_size;
+	u32 data_size;
+	efi_guid_t vendor;
+};
+
+static LIST_HEAD(efi_var_list);
+static struct efi_var *efi_var_hash[EFI_VAR_HASH_SIZE];
+static bool efi_var_loaded;
+
+/* FNV-1a hash of the vendor GUID and name */
+static u32 efi_var_hash_of(const u16 *name, size_t name_size,
+			   const efi_guid_t *vendor)
 {
-	char *native_name;
-	efi_status_t ret;
-	unsigned long in_size;
+	const u8 *p = (const u8 *)vendor;
+	u32 hash = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < sizeof(*vendor); i++)
+		hash = (hash ^ p[i]) * 16777619U;
+	for (p = (const u8 *)name, i = 0; i < name_size; i++)
+		hash = (hash ^ p[i]) * 16777619U;
+
+	return hash;
+}
+
+static struct efi_var *efi_var_find(const u16 *name,
+				    const efi_guid_t *vendor)
+{
+	size_t name_size = (u16_strlen(name) + 1) * sizeof(u16);
+	u32 hash = efi_var_hash_of(name, name_size, vendor);
+	struct efi_var *var;
+
+	for (var = efi_var_hash[hash % EFI_VAR_HASH_SIZE]; var;
+	     var = var->hash_next) {
+		if (var->hash == hash && var->name_size == name_size &&
+		    !guidcmp(&var->vendor, vendor) &&
+		    !memcmp(var->name, name, name_size))
+			return var;
+	}
+
+	return NULL;
+}
+
+/* Add a variable without a value to the store */
+static struct efi_var *efi_var_add(const u16 *name, const efi_guid_t *vendor)
+{
+	size_t name_size = (u16_strlen(name) + 1) * sizeof(u16);
+	struct efi_var *var, **chain;
+
+	var = calloc(1, sizeof(*var) + name_size);
+	if (!var)
+		return NULL;
+	memcpy(var->name, name, name_size);
+	var->name_size = name_size;
+	var->vendor = *vendor;
+	var->hash = efi_var_hash_of(name, name_size, vendor);
+
+	chain = &efi_var_hash[var->hash % EFI_VAR_HASH_SIZE];
+	var->hash_next = *chain;
+	*chain = var;
+	list_add_tail(&var->list, &efi_var_list);
+
+	return var;
+}
+
+static void efi_var_remove(struct efi_var *var)
+{
+	struct efi_var **ptr;
+
+	for (ptr = &efi_var_hash[var->hash % EFI_VAR_HASH_SIZE]; *ptr != var;
+	     ptr = &(*ptr)->hash_next)
+		;
+	*ptr = var->hash_next;
+	list_del(&var->list);
+	free(var->data);
+	free(var);
+}
+
+/* Set the value of a variable, taking over @data which must be malloc()ed */
+static void efi_var_set_data(struct efi_var *var, u32 attr, void *data,
+			     efi_uintn_t data_size)
+{
+	free(var->data);
+	var->attr = attr;
+	var->data = data;
+	var->data_size = data_size;
+}
+
+/**
+ * efi_var_from_env() - add a variable from its U-Boot variable
+ *
+ * @line:	U-Boot variable as name=value, which is modified
+ */
+static void efi_var_from_env(char *line)
+{
+	char *guid, *name, *end;
 	const char *val, *s;
+	efi_guid_t vendor;
+	struct efi_var *var;
+	u16 *name16, *p;
+	void *data;
+	size_t len;
 	u32 attr;
 
-	EFI_ENTRY("\"%ls\" %pUl %p %p %p", variable_name, vendor, attributes,
-		  data_size, data);
+	guid = strchr(line, '_');
+	if (!guid)
+		return;
+	guid++;
+	name = strchr(guid, '_');
+	if (!name)
+		return;
+	*name++ = '\0';
+	end = strchr(name, '=');
+	if (!end)
+		return;
+	*end = '\0';
+	if (uuid_str_to_bin(guid, (unsigned char *)&vendor,
+			    UUID_STR_FORMAT_GUID))
+		return;
+
+	val = parse_attr(end + 1, &attr);
+	s = prefix(val, "(blob)");
+	if (s) {
+		len = strlen(s);
+		if (len & 1)
+			return;
+		len /= 2;
+		data = malloc(len);
+		if (!data)
+			return;
+		if (hex2bin(data, s, len)) {
+			free(data);
+			return;
+		}
+	} else {
+		s = prefix(val, "(utf8)");
+		if (!s) {
+			debug("%s: invalid value: '%s'\n", __func__, val);
+			return;
+		}
+		len = strlen(s) + 1;
+		data = malloc(len);
+		if (!data)
+			return;
+		memcpy(data, s, len);
+	}
 
-	if (!variable_name || !vendor || !data_size)
-		return EFI_EXIT(EFI_INVALID_PARAMETER);
+	name16 = malloc((utf8_utf16_strlen(name) + 1) * sizeof(u16));
+	if (!name16) {
+		free(data);
+		return;
+	}
+	p = name16;
+	utf8_utf16_strcpy(&p, name);
+	var = efi_var_find(name16, &vendor);
+	if (!var)
+		var = efi_var_add(name16, &vendor);
+	free(name16);
+	if (!var) {
+		free(data);
+		return;
+	}
+	efi_var_set_data(var, attr, data, len);
+}
+
+/* Read all the UEFI variables held in U-Boot variables */
+static void efi_var_load_env(void)
+{
+	char regex[256];
+	char * const regexlist[] = {regex};
+	char *list = NULL, *line, *next;
+	ssize_t list_len;
+
+	snprintf(regex, 256, "efi_.*-.*-.*-.*-.*_.*");
+	list_len = hexport_r(&env_htab, '\n', H_MATCH_REGEX | H_MATCH_KEY,
+			     &list, 0, 1, regexlist);
+	/* 1 indicates that no match was found */
+	if (list_len > 1) {
+		for (line = list; line && *line; line = next) {
+			next = strchr(line, '\n');
+			if (next)
+				*next++ = '\0';
+			efi_var_from_env(line);
+		}
+	}
+	free(list);
+}
 
-	ret = efi_to_native(&native_name, variable_name, vendor);
+/**
+ * efi_var_to_env() - write a variable to its U-Boot variable
+ *
+ * @name:	name of the variable
+ * @vendor:	vendor GUID
+ * @var:	variable, or NULL to delete it
+ * Return:	status code
+ */
+static efi_status_t efi_var_to_env(const u16 *name, const efi_guid_t *vendor,
+				   struct efi_var *var)
+{
+	char *native_name, *val = NULL, *s;
+	efi_status_t ret;
+	u32 attributes;
+
+	ret = efi_to_native(&native_name, name, vendor);
 	if (ret)
-		return EFI_EXIT(ret);
+		return ret;
 
-	debug("%s: get '%s'\n", __func__, native_name);
+	if (!var) {
+		/* delete the variable: */
+		env_set(native_name, NULL);
+		goto out;
+	}
 
-	val = env_get(native_name);
-	free(native_name);
-	if (!val)
-		return EFI_EXIT(EFI_NOT_FOUND);
+	val = malloc(2 * var->data_size + strlen("{ro,run,boot}(blob)") + 1);
+	if (!val) {
+		ret = EFI_OUT_OF_RESOURCES;
+		goto out;
+	}
 
-	val = parse_attr(val, &attr);
+	s = val;
 
-	in_size = *data_size;
+	/*
+	 * store attributes
+	 * TODO: several attributes are not supported
+	 */
+	attributes = var->attr & (EFI_VARIABLE_BOOTSERVICE_ACCESS |
+				  EFI_VARIABLE_RUNTIME_ACCESS);
+	s += sprintf(s, "{");
+	while (attributes) {
+		u32 attr = 1 << (ffs(attributes) - 1);
 
-	if ((s = prefix(val, "(blob)"))) {
-		size_t len = strlen(s);
+		if (attr == EFI_VARIABLE_BOOTSERVICE_ACCESS)
+			s += sprintf(s, "boot");
+		else if (attr == EFI_VARIABLE_RUNTIME_ACCESS)
+			s += sprintf(s, "run");
 
-		/* number of hexadecimal digits must be even */
-		if (len & 1)
-			return EFI_EXIT(EFI_DEVICE_ERROR);
+		attributes &= ~attr;
+		if (attributes)
+			s += sprintf(s, ",");
+	}
+	s += sprintf(s, "}");
 
-		/* two characters per byte: */
-		len /= 2;
-		*data_size = len;
+	/* store payload: */
+	s += sprintf(s, "(blob)");
+	s = bin2hex(s, var->data, var->data_size);
+	*s = '\0';
 
-		if (in_size < len)
-			return EFI_EXIT(EFI_BUFFER_TOO_SMALL);
+	debug("%s: setting: %s=%s\n", __func__, native_name, val);
 
-		if (!data)
-			return EFI_EXIT(EFI_INVALID_PARAMETER);
+	if (env_set(native_name, val))
+		ret = EFI_DEVICE_ERROR;
 
-		if (hex2bin(data, s, len))
-			return EFI_EXIT(EFI_DEVICE_ERROR);
+out:
+	free(native_name);
+	free(val);
+
+	return ret;
+}
 
-		debug("%s: got value: \"%s\"\n", __func__, s);
-	} else if ((s = prefix(val, "(utf8)"))) {
-		unsigned len = strlen(s) + 1;
+static size_t efi_var_entry_size(struct efi_var *var)
+{
+	return ALIGN(sizeof(struct efi_var_entry) + var->name_size +
+		     var->data_size, 8);
+}
 
-		*data_size = len;
+/* Read the variables from the variable file, if there is one */
+static void efi_var_load_file(void)
+{
+	const char *iface = CONFIG_EFI_VARIABLE_FILE_IFACE;
+	const char *devpart = CONFIG_EFI_VARIABLE_FILE_DEVPART;
+	struct efi_var_file *hdr;
+	struct efi_var_entry *entry;
+	struct efi_var *var;
+	loff_t size, actread;
+	void *buf, *ptr, *end, *data;
+
+	if (fs_set_blk_dev(iface, devpart, FS_TYPE_ANY) ||
+	    fs_size(EFI_VAR_FILE_NAME, &size) || size < sizeof(*hdr))
+		return;
+	buf = malloc(size);
+	if (!buf)
+		return;
+	if (fs_set_blk_dev(iface, devpart, FS_TYPE_ANY) ||
+	    fs_read(EFI_VAR_FILE_NAME, map_to_sysmem(buf), 0, size, &actread))
+		goto out;
 
-		if (in_size < len)
-			return EFI_EXIT(EFI_BUFFER_TOO_SMALL);
+	hdr = buf;
+	if (actread != size || hdr->magic != EFI_VAR_FILE_MAGIC ||
+	    hdr->length != size ||
+	    hdr->crc32 != crc32(0, buf + sizeof(*hdr), size - sizeof(*hdr))) {
+		printf("Invalid UEFI variable file\n");
+		goto out;
+	}
 
+	end = buf + size;
+	for (ptr = buf + sizeof(*hdr); ptr + sizeof(*entry) <= end;
+	     ptr += entry->length) {
+		entry = ptr;
+		if (entry->length < sizeof(*entry) + entry->name_size +
+				    entry->data_size ||
+		    entry->length > end - ptr || entry->name_size < 2 ||
+		    *(u16 *)(ptr + sizeof(*entry) + entry->name_size - 2))
+			break;
+		data = malloc(entry->data_size);
 		if (!data)
-			return EFI_EXIT(EFI_INVALID_PARAMETER);
+			break;
+		memcpy(data, ptr + sizeof(*entry) + entry->name_size,
+		       entry->data_size);
+		var = efi_var_find(ptr + sizeof(*entry), &entry->vendor);
+		if (!var)
+			var = efi_var_add(ptr + sizeof(*entry), &entry->vendor);
+		if (!var) {
+			free(data);
+			break;
+		}
+		efi_var_set_data(var, entry->attr, data, entry->data_size);
+	}
+out:
+	free(buf);
+}
 
-		memcpy(data, s, len);
-		((char *)data)[len] = '\0';
+/* Write all the variables to the variable file */
+static efi_status_t efi_var_save_file(void)
+{
+	struct efi_var_file *hdr;
+	struct efi_var_entry *entry;
+	struct efi_var *var;
+	loff_t actwrite;
+	size_t size = sizeof(*hdr);
+	void *buf, *ptr;
+	efi_status_t ret = EFI_SUCCESS;
 
-		debug("%s: got value: \"%s\"\n", __func__, (char *)data);
-	} else {
-		debug("%s: invalid value: '%s'\n", __func__, val);
-		return EFI_EXIT(EFI_DEVICE_ERROR);
+	list_for_each_entry(var, &efi_var_list, list)
+		size += efi_var_entry_size(var);
+	buf = calloc(1, size);
+	if (!buf)
+		return EFI_OUT_OF_RESOURCES;
+
+	ptr = buf + sizeof(*hdr);
+	list_for_each_entry(var, &efi_var_list, list) {
+		entry = ptr;
+		entry->length = efi_var_entry_size(var);
+		entry->attr = var->attr;
+		entry->name_size = var->name_size;
+		entry->data_size = var->data_size;
+		entry->vendor = var->vendor;
+		memcpy(ptr + sizeof(*entry), var->name, var->name_size);
+		memcpy(ptr + sizeof(*entry) + var->name_size, var->data,
+		       var->data_size);
+		ptr += entry->length;
 	}
+	hdr = buf;
+	hdr->magic = EFI_VAR_FILE_MAGIC;
+	hdr->length = size;
+	hdr->crc32 = crc32(0, buf + sizeof(*hdr), size - sizeof(*hdr));
+
+	if (fs_set_blk_dev(CONFIG_EFI_VARIABLE_FILE_IFACE,
+			   CONFIG_EFI_VARIABLE_FILE_DEVPART, FS_TYPE_ANY) ||
+	    fs_write(EFI_VAR_FILE_NAME, map_to_sysmem(buf), 0, size,
+		     &actwrite))
+		ret = EFI_DEVICE_ERROR;
+	free(buf);
 
-	if (attributes)
-		*attributes = attr & EFI_VARIABLE_MASK;
+	return ret;
+}
 
-	return EFI_EXIT(EFI_SUCCESS);
+/* Read the variables into the store when it is first used */
+static void efi_var_init(void)
+{
+	if (efi_var_loaded)
+		return;
+	efi_var_loaded = true;
+
+	efi_var_load_env();
+	if (IS_ENABLED(CONFIG_EFI_VARIABLE_FILE_STORE))
+		efi_var_load_file();
 }
 
-static char *efi_variables_list;
-static char *efi_cur_variable;
+/* Write back a changed variable, @var is NULL if it was deleted */
+static efi_status_t efi_var_save(const u16 *name, const efi_guid_t *vendor,
+				 struct efi_var *var)
+{
+	if (IS_ENABLED(CONFIG_EFI_VARIABLE_FILE_STORE))
+		return efi_var_save_file();
+
+	return efi_var_to_env(name, vendor, var);
+}
 
 /**
- * parse_uboot_variable() - parse a u-boot variable and get uefi-related
- *			    information
- * @variable:		whole data of u-boot variable (ie. name=value)
- * @variable_name_size: size of variable_name buffer in byte
- * @variable_name:	name of uefi variable in u16, null-terminated
- * @vendor:		vendor's guid
- * @attributes:		attributes
+ * efi_efi_get_variable() - retrieve value of a UEFI variable
+ *
+ * This function implements the GetVariable runtime service.
  *
- * A uefi variable is encoded into a u-boot variable as described above.
- * This function parses such a u-boot variable and retrieve uefi-related
- * information into respective parameters. In return, variable_name_size
- * is the size of variable name including NULL.
+ * See the Unified Extensible Firmware Interface (UEFI) specification for
+ * details.
  *
- * Return:		EFI_SUCCESS if parsing is OK, EFI_NOT_FOUND when
-			the entire variable list has been returned,
-			otherwise non-zero status code
+ * @variable_name:	name of the variable
+ * @vendor:		vendor GUID
+ * @attributes:		attributes of the variable
+ * @data_size:		size of the buffer to which the variable value is copied
+ * @data:		buffer to which the variable value is copied
+ * Return:		status code
  */
-static efi_status_t parse_uboot_variable(char *variable,
-					 efi_uintn_t *variable_name_size,
-					 u16 *variable_name,
-					 const efi_guid_t *vendor,
-					 u32 *attributes)
+efi_status_t EFIAPI efi_get_variable(u16 *variable_name,
+				     const efi_guid_t *vendor, u32 *attributes,
+				     efi_uintn_t *data_size, void *data)
 {
-	char *guid, *name, *end, c;
-	unsigned long name_len;
-	u16 *p;
+	struct efi_var *var;
+	efi_uintn_t in_size;
 
-	guid = strchr(variable, '_');
-	if (!guid)
-		return EFI_INVALID_PARAMETER;
-	guid++;
-	name = strchr(guid, '_');
-	if (!name)
-		return EFI_INVALID_PARAMETER;
-	name++;
-	end = strchr(name, '=');
-	if (!end)
-		return EFI_INVALID_PARAMETER;
+	EFI_ENTRY("\"%ls\" %pUl %p %p %p", variable_name, vendor, attributes,
+		  data_size, data);
 
-	name_len = end - name;
-	if (*variable_name_size < (name_len + 1)) {
-		*variable_name_size = name_len + 1;
-		return EFI_BUFFER_TOO_SMALL;
-	}
-	end++; /* point to value */
+	if (!variable_name || !vendor || !data_size)
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
 
-	/* variable name */
-	p = variable_name;
-	utf8_utf16_strncpy(&p, name, name_len);
-	variable_name[name_len] = 0;
-	*variable_name_size = name_len + 1;
+	efi_var_init();
+	var = efi_var_find(variable_name, vendor);
+	if (!var)
+		return EFI_EXIT(EFI_NOT_FOUND);
 
-	/* guid */
-	c = *(name - 1);
-	*(name - 1) = '\0'; /* guid need be null-terminated here */
-	uuid_str_to_bin(guid, (unsigned char *)vendor, UUID_STR_FORMAT_GUID);
-	*(name - 1) = c;
+	in_size = *data_size;
+	*data_size = var->data_size;
+	if (in_size < var->data_size)
+		return EFI_EXIT(EFI_BUFFER_TOO_SMALL);
 
-	/* attributes */
-	parse_attr(end, attributes);
+	if (!data)
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
 
-	return EFI_SUCCESS;
+	memcpy(data, var->data, var->data_size);
+
+	if (attributes)
+		*attributes = var->attr & EFI_VARIABLE_MASK;
+
+	return EFI_EXIT(EFI_SUCCESS);
 }
 
 /**
@@ -324,76 +670,45 @@ efi_status_t EFIAPI efi_get_next_variable_name(efi_uintn_t *variable_name_size,
 					       u16 *variable_name,
 					       const efi_guid_t *vendor)
 {
-	char *native_name, *variable;
-	ssize_t name_len, list_len;
-	char regex[256];
-	char * const regexlist[] = {regex};
-	u32 attributes;
+	struct list_head *next;
+	struct efi_var *var;
 	int i;
-	efi_status_t ret;
 
 	EFI_ENTRY("%p \"%ls\" %pUl", variable_name_size, variable_name, vendor);
 
 	if (!variable_name_size || !variable_name || !vendor)
 		return EFI_EXIT(EFI_INVALID_PARAMETER);
 
+	efi_var_init();
 	if (variable_name[0]) {
 		/* check null-terminated string */
-		for (i = 0; i < *variable_name_size; i++)
+		for (i = 0; i < *variable_name_size / sizeof(u16); i++)
 			if (!variable_name[i])
 				break;
-		if (i >= *variable_name_size)
+		if (i >= *variable_name_size / sizeof(u16))
 			return EFI_EXIT(EFI_INVALID_PARAMETER);
 
 		/* search for the last-returned variable */
-		ret = efi_to_native(&native_name, variable_name, vendor);
-		if (ret)
-			return EFI_EXIT(ret);
-
-		name_len = strlen(native_name);
-		for (variable = efi_variables_list; variable && *variable;) {
-			if (!strncmp(variable, native_name, name_len) &&
-			    variable[name_len] == '=')
-				break;
-
-			variable = strchr(variable, '\n');
-			if (variable)
-				variable++;
-		}
-
-		free(native_name);
-		if (!(variable && *variable))
+		var = efi_var_find(variable_name, vendor);
+		if (!var)
 			return EFI_EXIT(EFI_INVALID_PARAMETER);
-
-		/* next variable */
-		variable = strchr(variable, '\n');
-		if (variable)
-			variable++;
-		if (!(variable && *variable))
-			return EFI_EXIT(EFI_NOT_FOUND);
+		next = var->list.next;
 	} else {
-		/*
-		 *new search: free a list used in the previous search
-		 */
-		free(efi_variables_list);
-		efi_variables_list = NULL;
-		efi_cur_variable = NULL;
-
-		snprintf(regex, 256, "efi_.*-.*-.*-.*-.*_.*");
-		list_len = hexport_r(&env_htab, '\n',
-				     H_MATCH_REGEX | H_MATCH_KEY,
-				     &efi_variables_list, 0, 1, regexlist);
-		/* 1 indicates that no match was found */
-		if (list_len <= 1)
-			return EFI_EXIT(EFI_NOT_FOUND);
-
-		variable = efi_variables_list;
+		next = efi_var_list.next;
 	}
+	if (next == &efi_var_list)
+		return EFI_EXIT(EFI_NOT_FOUND);
 
-	ret = parse_uboot_variable(variable, variable_name_size, variable_name,
-				   vendor, &attributes);
+	var = list_entry(next, struct efi_var, list);
+	if (*variable_name_size < var->name_size) {
+		*variable_name_size = var->name_size;
+		return EFI_EXIT(EFI_BUFFER_TOO_SMALL);
+	}
+	memcpy(variable_name, var->name, var->name_size);
+	*variable_name_size = var->name_size;
+	memcpy((void *)vendor, &var->vendor, sizeof(var->vendor));
 
-	return EFI_EXIT(ret);
+	return EFI_EXIT(EFI_SUCCESS);
 }
 
 /**
@@ -415,84 +730,47 @@ efi_status_t EFIAPI efi_set_variable(u16 *variable_name,
 				     const efi_guid_t *vendor, u32 attributes,
 				     efi_uintn_t data_size, const void *data)
 {
-	char *native_name = NULL, *val = NULL, *s;
-	efi_status_t ret = EFI_SUCCESS;
-	u32 attr;
+	struct efi_var *var;
+	void *buf;
 
 	EFI_ENTRY("\"%ls\" %pUl %x %zu %p", variable_name, vendor, attributes,
 		  data_size, data);
 
-	if (!variable_name || !vendor) {
-		ret = EFI_INVALID_PARAMETER;
-		goto out;
-	}
+	if (!variable_name || !vendor)
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
 
-	ret = efi_to_native(&native_name, variable_name, vendor);
-	if (ret)
-		goto out;
+	efi_var_init();
+	var = efi_var_find(variable_name, vendor);
 
 #define ACCESS_ATTR (EFI_VARIABLE_RUNTIME_ACCESS | EFI_VARIABLE_BOOTSERVICE_ACCESS)
 
 	if ((data_size == 0) || !(attributes & ACCESS_ATTR)) {
 		/* delete the variable: */
-		env_set(native_name, NULL);
-		ret = EFI_SUCCESS;
-		goto out;
+		if (!var)
+			return EFI_EXIT(EFI_SUCCESS);
+		efi_var_remove(var);
+		return EFI_EXIT(efi_var_save(variable_name, vendor, NULL));
 	}
 
-	val = env_get(native_name);
-	if (val) {
-		parse_attr(val, &attr);
+	if (var && (var->attr & READ_ONLY))
+		return EFI_EXIT(EFI_WRITE_PROTECTED);
 
-		if (attr & READ_ONLY) {
-			/* We should not free val */
-			val = NULL;
-			ret = EFI_WRITE_PROTECTED;
-			goto out;
+	if (!data)
+		return EFI_EXIT(EFI_INVALID_PARAMETER);
+	buf = malloc(data_size);
+	if (!buf)
+		return EFI_EXIT(EFI_OUT_OF_RESOURCES);
+	memcpy(buf, data, data_size);
+	if (!var) {
+		var = efi_var_add(variable_name, vendor);
+		if (!var) {
+			free(buf);
+			return EFI_EXIT(EFI_OUT_OF_RESOURCES);
 		}
 	}
 
-	val = malloc(2 * data_size + strlen("{ro,run,boot}(blob)") + 1);
-	if (!val) {
-		ret = EFI_OUT_OF_RESOURCES;
-		goto out;
-	}
-
-	s = val;
-
-	/*
-	 * store attributes
-	 * TODO: several attributes are not supported
-	 */
-	attributes &= (EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS);
-	s += sprintf(s, "{");
-	while (attributes) {
-		u32 attr = 1 << (ffs(attributes) - 1);
-
-		if (attr == EFI_VARIABLE_BOOTSERVICE_ACCESS)
-			s += sprintf(s, "boot");
-		else if (attr == EFI_VARIABLE_RUNTIME_ACCESS)
-			s += sprintf(s, "run");
-
-		attributes &= ~attr;
-		if (attributes)
-			s += sprintf(s, ",");
-	}
-	s += sprintf(s, "}");
-
-	/* store payload: */
-	s += sprintf(s, "(blob)");
-	s = bin2hex(s, data, data_size);
-	*s = '\0';
-
-	debug("%s: setting: %s=%s\n", __func__, native_name, val);
-
-	if (env_set(native_name, val))
-		ret = EFI_DEVICE_ERROR;
-
-out:
-	free(native_name);
-	free(val);
+	/* TODO: several attributes are not supported */
+	efi_var_set_data(var, attributes & EFI_VARIABLE_MASK, buf, data_size);
 
-	return EFI_EXIT(ret);
+	return EFI_EXIT(efi_var_save(variable_name, vendor, var));
 }
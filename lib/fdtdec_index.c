@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Phandle and compatible index of the control device tree
+ *
+ * libfdt looks up phandles and compatible strings by walking the whole
+ * flat tree. After relocation the control FDT does not move any more, so
+ * index it once: a table of (phandle, offset) sorted by phandle and a
+ * table of (compatible string, offset) sorted by string then offset.
+ *
+ * The index is only used for the blob it was built from, and only while
+ * the sizes of its structure and strings blocks are unchanged; anything
+ * else falls back to libfdt. Hits are also checked against the blob.
+ */
+
+#include <common.h>
+#include <fdtdec.h>
+#include <malloc.h>
+
+struct fdt_index_phandle {
+	u32 phandle;
+	int offset;
+};
+
+struct fdt_index_compat {
+	const char *compat;
+	int offset;
+};
+
+static struct {
+	const void *blob;
+	u32 size_dt_struct;
+	u32 size_dt_strings;
+	struct fdt_index_phandle *phandles;
+	int phandle_count;
+	struct fdt_index_compat *compats;
+	int compat_count;
+} fdt_index;
+
+static bool fdtdec_index_valid(const void *blob)
+{
+	return blob && blob == fdt_index.blob &&
+	       fdt_size_dt_struct(blob) == fdt_index.size_dt_struct &&
+	       fdt_size_dt_strings(blob) == fdt_index.size_dt_strings;
+}
+
+static int fdt_index_phandle_cmp(const void *a, const void *b)
+{
+	const struct fdt_index_phandle *pa = a, *pb = b;
+
+	if (pa->phandle != pb->phandle)
+		return pa->phandle < pb->phandle ? -1 : 1;
+
+	return pa->offset - pb->offset;
+}
+
+static int fdt_index_compat_cmp(const void *a, const void *b)
+{
+	const struct fdt_index_compat *ca = a, *cb = b;
+	int ret;
+
+	ret = strcmp(ca->compat, cb->compat);
+	if (ret)
+		return ret;
+
+	return ca->offset - cb->offset;
+}
+
+int fdtdec_index_build(const void *blob)
+{
+	int phandles = 0, compats = 0;
+	int offset, depth = 0;
+
+	fdt_index.blob = NULL;
+	free(fdt_index.phandles);
+	free(fdt_index.compats);
+	fdt_index.phandles = NULL;
+	fdt_index.compats = NULL;
+	fdt_index.phandle_count = 0;
+	fdt_index.compat_count = 0;
+
+	/* Size the tables first */
+	for (offset = fdt_next_node(blob, -1, &depth); offset >= 0;
+	     offset = fdt_next_node(blob, offset, &depth)) {
+		int count = fdt_stringlist_count(blob, offset, "compatible");
+
+		if (fdt_get_phandle(blob, offset))
+			phandles++;
+		if (count > 0)
+			compats += count;
+	}
+
+	fdt_index.phandles = malloc(phandles * sizeof(*fdt_index.phandles));
+	fdt_index.compats = malloc(compats * sizeof(*fdt_index.compats));
+	if ((phandles && !fdt_index.phandles) ||
+	    (compats && !fdt_index.compats)) {
+		free(fdt_index.phandles);
+		free(fdt_index.compats);
+		fdt_index.phandles = NULL;
+		fdt_index.compats = NULL;
+		return -ENOMEM;
+	}
+
+	depth = 0;
+	for (offset = fdt_next_node(blob, -1, &depth); offset >= 0;
+	     offset = fdt_next_node(blob, offset, &depth)) {
+		const char *compat;
+		u32 phandle;
+		int i;
+
+		phandle = fdt_get_phandle(blob, offset);
+		if (phandle && fdt_index.phandle_count < phandles) {
+			fdt_index.phandles[fdt_index.phandle_count].phandle =
+				phandle;
+			fdt_index.phandles[fdt_index.phandle_count++].offset =
+				offset;
+		}
+
+		for (i = 0; fdt_index.compat_count < compats; i++) {
+			compat = fdt_stringlist_get(blob, offset, "compatible",
+						    i, NULL);
+			if (!compat)
+				break;
+			fdt_index.compats[fdt_index.compat_count].compat =
+				compat;
+			fdt_index.compats[fdt_index.compat_count++].offset =
+				offset;
+		}
+	}
+
+	qsort(fdt_index.phandles, fdt_index.phandle_count,
+	      sizeof(*fdt_index.phandles), fdt_index_phandle_cmp);
+	qsort(fdt_index.compats, fdt_index.compat_count,
+	      sizeof(*fdt_index.compats), fdt_index_compat_cmp);
+
+	fdt_index.blob = blob;
+	fdt_index.size_dt_struct = fdt_size_dt_struct(blob);
+	fdt_index.size_dt_strings = fdt_size_dt_strings(blob);
+	debug("%s: %d phandles, %d compatible strings\n", __func__,
+	      fdt_index.phandle_count, fdt_index.compat_count);
+
+	return 0;
+}
+
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle)
+{
+	int lo = 0, hi = fdt_index.phandle_count;
+
+	if (!fdtdec_index_valid(blob) || !phandle || phandle == -1)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	/* Find the first entry with this phandle */
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (fdt_index.phandles[mid].phandle < phandle)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == fdt_index.phandle_count ||
+	    fdt_index.phandles[lo].phandle != phandle)
+		return -FDT_ERR_NOTFOUND;
+
+	if (fdt_get_phandle(blob, fdt_index.phandles[lo].offset) != phandle)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	return fdt_index.phandles[lo].offset;
+}
+
+int fdtdec_node_offset_by_compatible(const void *blob, int startoffset,
+				     const char *compat)
+{
+	struct fdt_index_compat key = { compat, startoffset };
+	int lo = 0, hi = fdt_index.compat_count;
+	int offset;
+
+	if (!fdtdec_index_valid(blob))
+		return fdt_node_offset_by_compatible(blob, startoffset, compat);
+
+	/* Find the first entry with this string after startoffset */
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (fdt_index_compat_cmp(&fdt_index.compats[mid], &key) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == fdt_index.compat_count ||
+	    strcmp(fdt_index.compats[lo].compat, compat))
+		return -FDT_ERR_NOTFOUND;
+
+	offset = fdt_index.compats[lo].offset;
+	if (fdt_node_check_compatible(blob, offset, compat))
+		return fdt_node_offset_by_compatible(blob, startoffset, compat);
+
+	return offset;
+}
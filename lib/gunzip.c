@@ -11,6 +11,7 @@
 #include <image.h>
 #include <malloc.h>
 #include <memalign.h>
+#include <mmc.h>
 #include <u-boot/zlib.h>
 #include <div64.h>
 
@@ -113,6 +114,25 @@ void gzwrite_progress_finish(int returnval,
 	}
 }
 
+/*
+ * Blocks of @dev which are best written together and on a boundary of
+ * their own size: the erase group of eMMC, which it would otherwise have
+ * to read back and merge with
+ */
+static unsigned long gzwrite_grain(struct blk_desc *dev)
+{
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	struct mmc *mmc;
+
+	if (dev->if_type == IF_TYPE_MMC) {
+		mmc = find_mmc_device(dev->devnum);
+		if (mmc && mmc->erase_grp_size * 512 > dev->blksz)
+			return mmc->erase_grp_size * 512 / dev->blksz;
+	}
+#endif
+	return 1;
+}
+
 int gzwrite(unsigned char *src, int len,
 	    struct blk_desc *dev,
 	    unsigned long szwritebuf,
@@ -125,7 +145,9 @@ int gzwrite(unsigned char *src, int len,
 	unsigned char *writebuf;
 	unsigned crc = 0;
 	u64 totalfilled = 0;
-	lbaint_t blksperbuf, outblock;
+	lbaint_t blksperbuf, bufblks, outblock;
+	unsigned long grain;
+	u64 skew;
 	u32 expected_crc;
 	u32 payload_size;
 	int iteration = 0;
@@ -144,8 +166,16 @@ int gzwrite(unsigned char *src, int len,
 		return -1;
 	}
 
+	/*
+	 * Write whole erase groups, and make the first write short if need
+	 * be so that all the others start on one
+	 */
+	grain = gzwrite_grain(dev);
+	szwritebuf = roundup(szwritebuf, grain * dev->blksz);
 	blksperbuf = szwritebuf / dev->blksz;
 	outblock = lldiv(startoffs, dev->blksz);
+	skew = outblock;
+	bufblks = blksperbuf - do_div(skew, grain);
 
 	/* skip header */
 	i = 10;
@@ -203,6 +233,12 @@ int gzwrite(unsigned char *src, int len,
 	s.next_in = src + i;
 	s.avail_in = payload_size+8;
 	writebuf = (unsigned char *)malloc_cache_aligned(szwritebuf);
+	if (!writebuf) {
+		printf("%s: no memory for a %lu byte write buffer\n",
+		       __func__, szwritebuf);
+		r = -1;
+		goto out;
+	}
 
 	/* decompress until deflate stream ends or end of file */
 	do {
@@ -215,10 +251,11 @@ int gzwrite(unsigned char *src, int len,
 		/* run inflate() on input until output buffer not full */
 		do {
 			unsigned long blocks_written;
+			unsigned long bufsize = bufblks * dev->blksz;
 			int numfilled;
 			lbaint_t writeblocks;
 
-			s.avail_out = szwritebuf;
+			s.avail_out = bufsize;
 			s.next_out = writebuf;
 			r = inflate(&s, Z_SYNC_FLUSH);
 			if ((r != Z_OK) &&
@@ -226,16 +263,16 @@ int gzwrite(unsigned char *src, int len,
 				printf("Error: inflate() returned %d\n", r);
 				goto out;
 			}
-			numfilled = szwritebuf - s.avail_out;
+			numfilled = bufsize - s.avail_out;
 			crc = crc32(crc, writebuf, numfilled);
 			totalfilled += numfilled;
-			if (numfilled < szwritebuf) {
+			if (numfilled < bufsize) {
 				writeblocks = (numfilled+dev->blksz-1)
 						/ dev->blksz;
 				memset(writebuf+numfilled, 0,
 				       dev->blksz-(numfilled%dev->blksz));
 			} else {
-				writeblocks = blksperbuf;
+				writeblocks = bufblks;
 			}
 
 			gzwrite_progress(iteration++,
@@ -244,6 +281,13 @@ int gzwrite(unsigned char *src, int len,
 			blocks_written = blk_dwrite(dev, outblock,
 						    writeblocks, writebuf);
 			outblock += blocks_written;
+			if (blocks_written != writeblocks) {
+				printf("%s: write failed at block " LBAF "\n",
+				       __func__, outblock);
+				r = -1;
+				goto out;
+			}
+			bufblks = blksperbuf;
 			if (ctrlc()) {
 				puts("abort\n");
 				goto out;
@@ -305,3 +349,79 @@ int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 
 	return err;
 }
+
+struct gunzip_stream {
+	z_stream s;
+	void *dst;
+	bool started;		/* the gzip header has been skipped */
+	bool ended;		/* the deflate stream is complete */
+};
+
+struct gunzip_stream *gunzip_stream_start(void *dst, unsigned long dstlen)
+{
+	struct gunzip_stream *gz;
+
+	gz = calloc(1, sizeof(*gz));
+	if (!gz)
+		return NULL;
+
+	gz->s.zalloc = gzalloc;
+	gz->s.zfree = gzfree;
+	if (inflateInit2(&gz->s, -MAX_WBITS) != Z_OK) {
+		free(gz);
+		return NULL;
+	}
+	gz->dst = dst;
+	gz->s.next_out = dst;
+	gz->s.avail_out = dstlen;
+
+	return gz;
+}
+
+int gunzip_stream_feed(struct gunzip_stream *gz, const void *src,
+		       unsigned long len)
+{
+	int offset = 0;
+	int r;
+
+	/* The trailer and anything after it are ignored, as by gunzip() */
+	if (gz->ended || !len)
+		return 0;
+
+	if (!gz->started) {
+		offset = gzip_parse_header(src, len);
+		if (offset < 0)
+			return -EINVAL;
+		gz->started = true;
+	}
+
+	gz->s.next_in = (unsigned char *)src + offset;
+	gz->s.avail_in = len - offset;
+	do {
+		r = inflate(&gz->s, Z_NO_FLUSH);
+		if (r == Z_STREAM_END) {
+			gz->ended = true;
+			break;
+		}
+		if (r != Z_OK) {
+			if (!gz->s.avail_out)
+				return -ENOSPC;
+			printf("Error: inflate() returned %d\n", r);
+			return -EINVAL;
+		}
+		WATCHDOG_RESET();
+	} while (gz->s.avail_in);
+
+	return 0;
+}
+
+int gunzip_stream_end(struct gunzip_stream *gz, unsigned long *lenp)
+{
+	int ret = gz->ended ? 0 : -EINVAL;
+
+	*lenp = gz->s.next_out - (unsigned char *)gz->dst;
+	inflateEnd(&gz->s);
+	free(gz);
+
+	return ret;
+}
@@ -224,6 +224,69 @@ int hmatch_r(const char *match, int last_idx, ENTRY ** retval,
  * Compare an existing entry with the desired key, and overwrite if the action
  * is ENTER.  This is simply a helper function for hsearch_r().
  */
+/* Compute an value for the given string. Perhaps use a better method. */
+static unsigned int hash_key(const char *key)
+{
+	unsigned int count = strlen(key);
+	unsigned int hval = count;
+
+	while (count-- > 0) {
+		hval <<= 4;
+		hval += key[count];
+	}
+
+	return hval;
+}
+
+/*
+ * Grow the table to about twice its size once it is three quarters full.
+ * Double hashing degrades badly as the table fills up, and a table sized
+ * from a guess at hcreate_r() time may also simply be too small.
+ *
+ * Entries keep their key and data strings, but move to a new slot, so this
+ * must not happen while a caller is holding an index or entry pointer. That
+ * is the case while an ENTER runs its callbacks (which may set other
+ * variables) and during hwalk_r(), both of which mark the table busy.
+ */
+static void hgrow_r(struct hsearch_data *htab)
+{
+	unsigned int size, idx, hval, hval2, i;
+	_ENTRY *table;
+
+	if (htab->busy || (htab->filled + 1) * 4 <= htab->size * 3)
+		return;
+
+	size = htab->size * 2 + 1;
+	while (!isprime(size))
+		size += 2;
+	table = calloc(size + 1, sizeof(_ENTRY));
+	if (!table)
+		return;
+
+	for (i = 1; i <= htab->size; i++) {
+		if (htab->table[i].used <= 0)
+			continue;
+		hval = hash_key(htab->table[i].entry.key) % size;
+		if (hval == 0)
+			++hval;
+		hval2 = 1 + hval % (size - 2);
+		for (idx = hval; table[idx].used; ) {
+			if (idx <= hval2)
+				idx = size + idx - hval2;
+			else
+				idx -= hval2;
+		}
+		table[idx].used = hval;
+		table[idx].entry = htab->table[i].entry;
+	}
+	debug("hgrow_r: %u entries, size %u -> %u\n", htab->filled,
+	      htab->size, size);
+
+	free(htab->table);
+	htab->table = table;
+	htab->size = size;
+}
+
 static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 	ENTRY **retval, struct hsearch_data *htab, int flag,
 	unsigned int hval, unsigned int idx)
@@ -270,23 +333,15 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 	return -1;
 }
 
-int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
-	      struct hsearch_data *htab, int flag)
+static int _hsearch_r(ENTRY item, ACTION action, ENTRY **retval,
+		      struct hsearch_data *htab, int flag)
 {
 	unsigned int hval;
-	unsigned int count;
-	unsigned int len = strlen(item.key);
 	unsigned int idx;
 	unsigned int first_deleted = 0;
 	int ret;
 
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
-	}
+	hval = hash_key(item.key);
 
 	/*
 	 * First hash function:
@@ -421,6 +476,21 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 }
 
 
+int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
+	      struct hsearch_data *htab, int flag)
+{
+	int ret;
+
+	if (action == ENTER)
+		hgrow_r(htab);
+
+	htab->busy++;
+	ret = _hsearch_r(item, action, retval, htab, flag);
+	htab->busy--;
+
+	return ret;
+}
+
 /*
  * hdelete()
  */
@@ -782,6 +852,26 @@ static int drop_var_from_set(const char *name, int nvars, char * vars[])
  * '\0' and '\n' have really been tested.
  */
 
+/* Count the entries in an environment to import, stopping at its end */
+static int himport_count(const char *data, size_t size, const char sep)
+{
+	int count = 0;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		if (!data[i]) {
+			count++;
+			/* '\0' ends the data unless it also separates entries */
+			if (sep || !data[i + 1])
+				break;
+		} else if (data[i] == sep) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
 int himport_r(struct hsearch_data *htab,
 		const char *env, size_t size, const char sep, int flag,
 		int crlf_is_lf, int nvars, char * const vars[])
@@ -838,9 +928,17 @@ int himport_r(struct hsearch_data *htab,
 
 	if (!htab->table) {
 		int nent = CONFIG_ENV_MIN_ENTRIES + size / 8;
+		int count = himport_count(data, size, sep);
 
 		if (nent > CONFIG_ENV_MAX_ENTRIES)
 			nent = CONFIG_ENV_MAX_ENTRIES;
+		/*
+		 * The table grows as needed, but size it for what is being
+		 * imported so that a large environment does not have to
+		 * grow it several times on the way in.
+		 */
+		if (nent < count * 3 / 2)
+			nent = count * 3 / 2;
 
 		debug("Create Hash Table: N=%d\n", nent);
 
@@ -979,15 +1077,17 @@ end:
 int hwalk_r(struct hsearch_data *htab, int (*callback)(ENTRY *))
 {
 	int i;
-	int retval;
+	int retval = 0;
 
+	htab->busy++;
 	for (i = 1; i <= htab->size; ++i) {
 		if (htab->table[i].used > 0) {
 			retval = callback(&htab->table[i].entry);
 			if (retval)
-				return retval;
+				break;
 		}
 	}
+	htab->busy--;
 
-	return 0;
+	return retval;
 }
@@ -44,43 +44,90 @@
 
 #include <linux/math64.h>
 
+
 static void default_log(const char *ignored, char *response) {}
 
-int write_sparse_image(struct sparse_storage *info,
-		       const char *part_name, void *data, char *response)
+static int sparse_write_fill(struct sparse_storage *info, lbaint_t *blkp,
+			     lbaint_t blkcnt, uint32_t fill_val,
+			     char *response)
 {
-	lbaint_t blk;
-	lbaint_t blkcnt;
-	lbaint_t blks;
-	uint32_t bytes_written = 0;
-	unsigned int chunk;
-	unsigned int offset;
-	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
-	uint32_t fill_val;
-	sparse_header_t *sparse_header;
-	chunk_header_t *chunk_header;
-	uint32_t total_blocks = 0;
 	int fill_buf_num_blks;
+	uint32_t *fill_buf;
+	lbaint_t blk = *blkp;
+	lbaint_t blks;
 	int i;
 	int j;
 
+	/* Let the storage fill it without sending any data */
+	blks = info->erase ? info->erase(info, blk, blkcnt, fill_val) : 0;
+	if (blks) {
+		/* blks might be > blkcnt (eg. NAND bad-blocks) */
+		if (blks < blkcnt) {
+			printf("%s: %s " LBAFU " [" LBAFU "]\n",
+			       __func__, "Erase failed, block #", blk, blks);
+			info->mssg("flash erase failure", response);
+			return -1;
+		}
+		*blkp = blk + blks;
+		return 0;
+	}
+
 	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	fill_buf = (uint32_t *)
+		   memalign(ARCH_DMA_MINALIGN,
+			    ROUNDUP(info->blksz * fill_buf_num_blks,
+				    ARCH_DMA_MINALIGN));
+	if (!fill_buf) {
+		info->mssg("Malloc failed for: CHUNK_TYPE_FILL", response);
+		return -1;
+	}
 
-	/* Read and skip over sparse image header */
-	sparse_header = (sparse_header_t *)data;
+	for (i = 0;
+	     i < (info->blksz * fill_buf_num_blks / sizeof(fill_val));
+	     i++)
+		fill_buf[i] = fill_val;
 
-	data += sparse_header->file_hdr_sz;
-	if (sparse_header->file_hdr_sz > sizeof(sparse_header_t)) {
-		/*
-		 * Skip the remaining bytes in a header that is longer than
-		 * we expected.
-		 */
-		data += (sparse_header->file_hdr_sz - sizeof(sparse_header_t));
+	for (i = 0; i < blkcnt;) {
+		j = blkcnt - i;
+		if (j > fill_buf_num_blks)
+			j = fill_buf_num_blks;
+		blks = info->write(info, blk, j, fill_buf);
+		/* blks might be > j (eg. NAND bad-blocks) */
+		if (blks < j) {
+			printf("%s: %s " LBAFU " [%d]\n",
+			       __func__, "Write failed, block #", blk, j);
+			info->mssg("flash write failure", response);
+			free(fill_buf);
+			return -1;
+		}
+		blk += blks;
+		i += j;
 	}
+	free(fill_buf);
+	*blkp = blk;
+
+	return 0;
+}
 
+void sparse_stream_init(struct sparse_stream *stream,
+			struct sparse_storage *info)
+{
+	memset(stream, '\0', sizeof(*stream));
+	stream->info = info;
+	stream->blk = info->start;
 	if (!info->mssg)
 		info->mssg = default_log;
+}
+
+static int sparse_stream_header(struct sparse_stream *stream,
+				const void *data, size_t len, char *response)
+{
+	struct sparse_storage *info = stream->info;
+	sparse_header_t *sparse_header = (sparse_header_t *)data;
+	unsigned int offset;
+
+	if (len < sizeof(sparse_header_t) || len < sparse_header->file_hdr_sz)
+		return 0;
 
 	debug("=== Sparse Image Header ===\n");
 	debug("magic: 0x%x\n", sparse_header->magic);
@@ -103,159 +150,227 @@ int write_sparse_image(struct sparse_storage *info,
 		info->mssg("sparse image block size issue", response);
 		return -1;
 	}
+	if (sparse_header->file_hdr_sz < sizeof(sparse_header_t) ||
+	    sparse_header->chunk_hdr_sz < sizeof(chunk_header_t)) {
+		printf("%s: Bogus sparse header sizes\n", __func__);
+		info->mssg("sparse image header size issue", response);
+		return -1;
+	}
 
 	puts("Flashing Sparse Image\n");
+	stream->hdr = *sparse_header;
+
+	/*
+	 * Skip the remaining bytes in a header that is longer than
+	 * we expected.
+	 */
+	return sparse_header->file_hdr_sz;
+}
+
+static int sparse_stream_chunk(struct sparse_stream *stream,
+			       const void *data, size_t len, char *response)
+{
+	struct sparse_storage *info = stream->info;
+	sparse_header_t *sparse_header = &stream->hdr;
+	chunk_header_t *chunk_header = (chunk_header_t *)data;
+	unsigned int chunk_data_sz;
+	uint32_t fill_val;
+	lbaint_t blkcnt;
+
+	/* Wait for the whole chunk header */
+	if (len < sparse_header->chunk_hdr_sz ||
+	    (chunk_header->chunk_type == CHUNK_TYPE_FILL &&
+	     len < sparse_header->chunk_hdr_sz + sizeof(uint32_t)))
+		return 0;
+
+	if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
+		debug("=== Chunk Header ===\n");
+		debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
+		debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
+		debug("total_size: 0x%x\n", chunk_header->total_sz);
+	}
+
+	/*
+	 * Skip the remaining bytes in a header that is longer
+	 * than we expected.
+	 */
+	data += sparse_header->chunk_hdr_sz;
 
-	/* Start processing chunks */
-	blk = info->start;
-	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
-		/* Read and skip over chunk header */
-		chunk_header = (chunk_header_t *)data;
-		data += sizeof(chunk_header_t);
-
-		if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
-			debug("=== Chunk Header ===\n");
-			debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
-			debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
-			debug("total_size: 0x%x\n", chunk_header->total_sz);
+	chunk_data_sz = sparse_header->blk_sz * chunk_header->chunk_sz;
+	blkcnt = chunk_data_sz / info->blksz;
+	switch (chunk_header->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if (chunk_header->total_sz !=
+		    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
+			info->mssg("Bogus chunk size for chunk type Raw",
+				   response);
+			return -1;
 		}
 
-		if (sparse_header->chunk_hdr_sz > sizeof(chunk_header_t)) {
-			/*
-			 * Skip the remaining bytes in a header that is longer
-			 * than we expected.
-			 */
-			data += (sparse_header->chunk_hdr_sz -
-				 sizeof(chunk_header_t));
+		if (stream->blk + blkcnt > info->start + info->size) {
+			printf("%s: Request would exceed partition size!\n",
+			       __func__);
+			info->mssg("Request would exceed partition size!",
+				   response);
+			return -1;
 		}
 
-		chunk_data_sz = sparse_header->blk_sz * chunk_header->chunk_sz;
-		blkcnt = chunk_data_sz / info->blksz;
-		switch (chunk_header->chunk_type) {
-		case CHUNK_TYPE_RAW:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
-				info->mssg("Bogus chunk size for chunk type Raw",
-					   response);
-				return -1;
-			}
+		/* The data follows, as it arrives */
+		stream->raw_left = blkcnt;
+		stream->total_blocks += chunk_header->chunk_sz;
+		break;
 
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
-				return -1;
-			}
+	case CHUNK_TYPE_FILL:
+		if (chunk_header->total_sz !=
+		    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
+			info->mssg("Bogus chunk size for chunk type FILL",
+				   response);
+			return -1;
+		}
+
+		fill_val = *(uint32_t *)data;
 
-			blks = info->write(info, blk, blkcnt, data);
+		if (stream->blk + blkcnt > info->start + info->size) {
+			printf("%s: Request would exceed partition size!\n",
+			       __func__);
+			info->mssg("Request would exceed partition size!",
+				   response);
+			return -1;
+		}
+
+		if (sparse_write_fill(info, &stream->blk, blkcnt, fill_val,
+				      response))
+			return -1;
+		stream->bytes_written += blkcnt * info->blksz;
+		stream->total_blocks += chunk_data_sz / sparse_header->blk_sz;
+
+		return sparse_header->chunk_hdr_sz + sizeof(uint32_t);
+
+	case CHUNK_TYPE_DONT_CARE:
+		if (info->discard)
+			stream->blk += info->discard(info, stream->blk, blkcnt);
+		else
+			stream->blk += info->reserve(info, stream->blk, blkcnt);
+		stream->total_blocks += chunk_header->chunk_sz;
+		break;
+
+	case CHUNK_TYPE_CRC32:
+		if (chunk_header->total_sz !=
+		    sparse_header->chunk_hdr_sz) {
+			info->mssg("Bogus chunk size for chunk type Dont Care",
+				   response);
+			return -1;
+		}
+		stream->total_blocks += chunk_header->chunk_sz;
+		stream->skip = chunk_data_sz;
+		break;
+
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__,
+		       chunk_header->chunk_type);
+		info->mssg("Unknown chunk type", response);
+		return -1;
+	}
+
+	return sparse_header->chunk_hdr_sz;
+}
+
+int sparse_stream_write(struct sparse_stream *stream, const void *data,
+			size_t len, size_t *consumedp, char *response)
+{
+	struct sparse_storage *info = stream->info;
+	size_t left = len;
+	lbaint_t blkcnt;
+	lbaint_t blks;
+	size_t n;
+	int ret;
+
+	while (left) {
+		ret = 0;
+		n = 0;
+		if (!stream->hdr.file_hdr_sz) {
+			ret = sparse_stream_header(stream, data, left,
+						   response);
+		} else if (stream->skip) {
+			n = min_t(size_t, stream->skip, left);
+			stream->skip -= n;
+		} else if (stream->raw_left) {
+			blkcnt = min_t(lbaint_t, stream->raw_left,
+				       left / info->blksz);
+			if (!blkcnt)
+				break;
+			blks = info->write(info, stream->blk, blkcnt, data);
 			/* blks might be > blkcnt (eg. NAND bad-blocks) */
 			if (blks < blkcnt) {
 				printf("%s: %s" LBAFU " [" LBAFU "]\n",
 				       __func__, "Write failed, block #",
-				       blk, blks);
+				       stream->blk, blks);
 				info->mssg("flash write failure", response);
 				return -1;
 			}
-			blk += blks;
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
+			stream->blk += blks;
+			stream->raw_left -= blkcnt;
+			n = blkcnt * info->blksz;
+			stream->bytes_written += n;
+		} else if (stream->chunk < stream->hdr.total_chunks) {
+			ret = sparse_stream_chunk(stream, data, left, response);
+			if (ret > 0)
+				stream->chunk++;
+		} else {
+			/* Anything after the last chunk is ignored */
 			break;
-
-		case CHUNK_TYPE_FILL:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
-				info->mssg("Bogus chunk size for chunk type FILL", response);
-				return -1;
-			}
-
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
-			}
-
-			fill_val = *(uint32_t *)data;
-			data = (char *)data + sizeof(uint32_t);
-
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
-				return -1;
-			}
-
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
-			}
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
+		}
+		if (ret < 0)
+			return ret;
+		if (ret > 0)
+			n = ret;
+		if (!n)
 			break;
+		data += n;
+		left -= n;
+	}
+	*consumedp = len - left;
 
-		case CHUNK_TYPE_DONT_CARE:
-			blk += info->reserve(info, blk, blkcnt);
-			total_blocks += chunk_header->chunk_sz;
-			break;
+	return 0;
+}
 
-		case CHUNK_TYPE_CRC32:
-			if (chunk_header->total_sz !=
-			    sparse_header->chunk_hdr_sz) {
-				info->mssg("Bogus chunk size for chunk type Dont Care",
-					   response);
-				return -1;
-			}
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
-			break;
+int sparse_stream_finish(struct sparse_stream *stream, const char *part_name,
+			 char *response)
+{
+	struct sparse_storage *info = stream->info;
+	sparse_header_t *sparse_header = &stream->hdr;
 
-		default:
-			printf("%s: Unknown chunk type: %x\n", __func__,
-			       chunk_header->chunk_type);
-			info->mssg("Unknown chunk type", response);
-			return -1;
-		}
+	if (!sparse_header->file_hdr_sz ||
+	    stream->chunk < sparse_header->total_chunks ||
+	    stream->raw_left || stream->skip) {
+		printf("%s: Sparse image is truncated\n", __func__);
+		info->mssg("sparse image truncated", response);
+		return -1;
 	}
 
 	debug("Wrote %d blocks, expected to write %d blocks\n",
-	      total_blocks, sparse_header->total_blks);
-	printf("........ wrote %u bytes to '%s'\n", bytes_written, part_name);
+	      stream->total_blocks, sparse_header->total_blks);
+	printf("........ wrote %u bytes to '%s'\n", stream->bytes_written,
+	       part_name);
 
-	if (total_blocks != sparse_header->total_blks) {
+	if (stream->total_blocks != sparse_header->total_blks) {
 		info->mssg("sparse image write failure", response);
 		return -1;
 	}
 
 	return 0;
 }
+
+int write_sparse_image(struct sparse_storage *info,
+		       const char *part_name, void *data, char *response)
+{
+	struct sparse_stream stream;
+	size_t consumed;
+
+	/* The whole image is in memory, so the headers give its size */
+	sparse_stream_init(&stream, info);
+	if (sparse_stream_write(&stream, data, SIZE_MAX, &consumed, response))
+		return -1;
+
+	return sparse_stream_finish(&stream, part_name, response);
+}
@@ -24,6 +24,89 @@
 /* Maximum size of a vbmeta image - 64 KiB. */
 #define VBMETA_MAX_SIZE (64 * 1024)
 
+/* Partitions are read in chunks of this size, so that a hash engine can
+ * hash one chunk while the next one is being read - 1 MiB. */
+#define LOAD_CHUNK_SIZE (1024 * 1024)
+
+/* Digest of the data covered by a hash descriptor. It is computed by a hash
+ * engine of the platform when there is one, and by libavb otherwise. */
+typedef struct {
+  void* engine;
+  bool is_sha512;
+  bool failed;
+  union {
+    AvbSHA256Ctx sha256;
+    AvbSHA512Ctx sha512;
+  } sw;
+  uint8_t digest[AVB_SHA512_DIGEST_SIZE];
+} HashDescriptorCtx;
+
+/* Returns false if |algorithm| is not supported. */
+static bool hash_desc_init(HashDescriptorCtx* ctx, const char* algorithm) {
+  if (avb_strcmp(algorithm, "sha256") == 0) {
+    ctx->is_sha512 = false;
+  } else if (avb_strcmp(algorithm, "sha512") == 0) {
+    ctx->is_sha512 = true;
+  } else {
+    return false;
+  }
+  ctx->failed = false;
+
+  ctx->engine = avb_hash_engine_init(algorithm);
+  if (ctx->engine == NULL) {
+    if (ctx->is_sha512) {
+      avb_sha512_init(&ctx->sw.sha512);
+    } else {
+      avb_sha256_init(&ctx->sw.sha256);
+    }
+  }
+  return true;
+}
+
+/* The data must stay untouched until hash_desc_final() is called. */
+static void hash_desc_update(HashDescriptorCtx* ctx,
+                             const uint8_t* data,
+                             uint64_t len) {
+  uint32_t n;
+
+  if (ctx->engine != NULL) {
+    if (!ctx->failed && !avb_hash_engine_update(ctx->engine, data, len)) {
+      ctx->failed = true;
+    }
+    return;
+  }
+
+  /* The libavb update functions take 32-bit lengths. */
+  while (len > 0) {
+    n = len > LOAD_CHUNK_SIZE ? LOAD_CHUNK_SIZE : len;
+    if (ctx->is_sha512) {
+      avb_sha512_update(&ctx->sw.sha512, data, n);
+    } else {
+      avb_sha256_update(&ctx->sw.sha256, data, n);
+    }
+    data += n;
+    len -= n;
+  }
+}
+
+/* Returns NULL if the hash engine failed. */
+static uint8_t* hash_desc_final(HashDescriptorCtx* ctx, size_t* out_len) {
+  *out_len = ctx->is_sha512 ? AVB_SHA512_DIGEST_SIZE : AVB_SHA256_DIGEST_SIZE;
+
+  if (ctx->engine != NULL) {
+    if (!avb_hash_engine_final(ctx->engine, ctx->digest, *out_len) ||
+        ctx->failed) {
+      return NULL;
+    }
+    return ctx->digest;
+  }
+
+  if (ctx->is_sha512) {
+    return avb_sha512_final(&ctx->sw.sha512);
+  }
+  return avb_sha256_final(&ctx->sw.sha256);
+}
+
 /* Helper function to see if we should continue with verification in
  * allow_verification_error=true mode if something goes wrong. See the
  * comments for the avb_slot_verify() function for more information.
@@ -47,13 +130,21 @@ static inline bool result_should_continue(AvbSlotVerifyResult result) {
   return false;
 }
 
+/* Loads |image_size| bytes of |part_name|. If |hash_ctx| is not NULL, the
+ * first |hash_size| bytes loaded are added to it, chunk by chunk as they are
+ * read.
+ */
 static AvbSlotVerifyResult load_full_partition(AvbOps* ops,
                                                const char* part_name,
                                                uint64_t image_size,
                                                uint8_t** out_image_buf,
-                                               bool* out_image_preloaded) {
+                                               bool* out_image_preloaded,
+                                               HashDescriptorCtx* hash_ctx,
+                                               uint64_t hash_size) {
   size_t part_num_read;
   AvbIOResult io_ret;
+  uint64_t offset;
+  size_t chunk;
 
   /* Make sure that we do not overwrite existing data. */
   avb_assert(*out_image_buf == NULL);
@@ -83,6 +174,11 @@ static AvbSlotVerifyResult load_full_partition(AvbOps* ops,
         return AVB_SLOT_VERIFY_RESULT_ERROR_IO;
       }
       *out_image_preloaded = true;
+      if (hash_ctx != NULL) {
+        hash_desc_update(hash_ctx,
+                         *out_image_buf,
+                         hash_size < image_size ? hash_size : image_size);
+      }
     }
   }
 
@@ -93,21 +189,34 @@ static AvbSlotVerifyResult load_full_partition(AvbOps* ops,
       return AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
     }
 
-    io_ret = ops->read_from_partition(ops,
-                                      part_name,
-                                      0 /* offset */,
-                                      image_size,
-                                      *out_image_buf,
-                                      &part_num_read);
-    if (io_ret == AVB_IO_RESULT_ERROR_OOM) {
-      return AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
-    } else if (io_ret != AVB_IO_RESULT_OK) {
-      avb_errorv(part_name, ": Error loading data from partition.\n", NULL);
-      return AVB_SLOT_VERIFY_RESULT_ERROR_IO;
-    }
-    if (part_num_read != image_size) {
-      avb_errorv(part_name, ": Read incorrect number of bytes.\n", NULL);
-      return AVB_SLOT_VERIFY_RESULT_ERROR_IO;
+    for (offset = 0; offset < image_size; offset += chunk) {
+      chunk = image_size - offset;
+      if (chunk > LOAD_CHUNK_SIZE) {
+        chunk = LOAD_CHUNK_SIZE;
+      }
+      io_ret = ops->read_from_partition(ops,
+                                        part_name,
+                                        offset,
+                                        chunk,
+                                        *out_image_buf + offset,
+                                        &part_num_read);
+      if (io_ret == AVB_IO_RESULT_ERROR_OOM) {
+        return AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
+      } else if (io_ret != AVB_IO_RESULT_OK) {
+        avb_errorv(part_name, ": Error loading data from partition.\n", NULL);
+        return AVB_SLOT_VERIFY_RESULT_ERROR_IO;
+      }
+      if (part_num_read != chunk) {
+        avb_errorv(part_name, ": Read incorrect number of bytes.\n", NULL);
+        return AVB_SLOT_VERIFY_RESULT_ERROR_IO;
+      }
+      /* The engine hashes this chunk while the next one is read. */
+      if (hash_ctx != NULL && offset < hash_size) {
+        hash_desc_update(hash_ctx,
+                         *out_image_buf + offset,
+                         hash_size - offset < chunk ? hash_size - offset
+                                                    : chunk);
+      }
     }
   }
 
@@ -178,6 +287,7 @@ static AvbSlotVerifyResult load_and_verify_hash_partition(
   size_t expected_digest_len = 0;
   uint8_t expected_digest_buf[AVB_SHA512_DIGEST_SIZE];
   const uint8_t* expected_digest = NULL;
+  HashDescriptorCtx hash_ctx;
 
   if (!avb_hash_descriptor_validate_and_byteswap(
           (const AvbHashDescriptor*)descriptor, &hash_desc)) {
@@ -268,29 +378,27 @@ static AvbSlotVerifyResult load_and_verify_hash_partition(
     }
   }
 
-  ret = load_full_partition(
-      ops, part_name, image_size, &image_buf, &image_preloaded);
+  if (!hash_desc_init(&hash_ctx, (const char*)hash_desc.hash_algorithm)) {
+    avb_errorv(part_name, ": Unsupported hash algorithm.\n", NULL);
+    ret = AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_METADATA;
+    goto out;
+  }
+  hash_desc_update(&hash_ctx, desc_salt, hash_desc.salt_len);
+
+  ret = load_full_partition(ops,
+                            part_name,
+                            image_size,
+                            &image_buf,
+                            &image_preloaded,
+                            &hash_ctx,
+                            hash_desc.image_size);
+  digest = hash_desc_final(&hash_ctx, &digest_len);
   if (ret != AVB_SLOT_VERIFY_RESULT_OK) {
     goto out;
   }
-
-  if (avb_strcmp((const char*)hash_desc.hash_algorithm, "sha256") == 0) {
-    AvbSHA256Ctx sha256_ctx;
-    avb_sha256_init(&sha256_ctx);
-    avb_sha256_update(&sha256_ctx, desc_salt, hash_desc.salt_len);
-    avb_sha256_update(&sha256_ctx, image_buf, hash_desc.image_size);
-    digest = avb_sha256_final(&sha256_ctx);
-    digest_len = AVB_SHA256_DIGEST_SIZE;
-  } else if (avb_strcmp((const char*)hash_desc.hash_algorithm, "sha512") == 0) {
-    AvbSHA512Ctx sha512_ctx;
-    avb_sha512_init(&sha512_ctx);
-    avb_sha512_update(&sha512_ctx, desc_salt, hash_desc.salt_len);
-    avb_sha512_update(&sha512_ctx, image_buf, hash_desc.image_size);
-    digest = avb_sha512_final(&sha512_ctx);
-    digest_len = AVB_SHA512_DIGEST_SIZE;
-  } else {
-    avb_errorv(part_name, ": Unsupported hash algorithm.\n", NULL);
-    ret = AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_METADATA;
+  if (digest == NULL) {
+    avb_errorv(part_name, ": Error hashing partition.\n", NULL);
+    ret = AVB_SLOT_VERIFY_RESULT_ERROR_IO;
     goto out;
   }
 
@@ -399,8 +507,13 @@ static AvbSlotVerifyResult load_requested_partitions(
     }
     avb_debugv(part_name, ": Loading entire partition.\n", NULL);
 
-    ret = load_full_partition(
-        ops, part_name, image_size, &image_buf, &image_preloaded);
+    ret = load_full_partition(ops,
+                              part_name,
+                              image_size,
+                              &image_buf,
+                              &image_preloaded,
+                              NULL /* hash_ctx */,
+                              0 /* hash_size */);
     if (ret != AVB_SLOT_VERIFY_RESULT_OK) {
       goto out;
     }
@@ -93,6 +93,24 @@ size_t avb_strlen(const char* str) AVB_ATTR_WARN_UNUSED_RESULT;
  * remainder. */
 uint32_t avb_div_by_10(uint64_t* dividend);
 
+/* Starts a digest with |algorithm| ("sha256" or "sha512") on a hash
+ * engine of the platform. Returns NULL if there is no engine for it, in
+ * which case the data has to be hashed in software.
+ */
+void* avb_hash_engine_init(const char* algorithm) AVB_ATTR_WARN_UNUSED_RESULT;
+
+/* Adds |len| bytes at |data| to the digest of |engine|. The engine may
+ * still be reading |data| when this returns, so it must stay untouched
+ * until the next call for |engine|. Returns false on error.
+ */
+bool avb_hash_engine_update(void* engine, const uint8_t* data, size_t len);
+
+/* Writes the digest of |engine| to |digest|, which has room for
+ * |digest_size| bytes, and frees |engine|. Returns false if this or any
+ * update failed.
+ */
+bool avb_hash_engine_final(void* engine, uint8_t* digest, size_t digest_size);
+
 #ifdef __cplusplus
 }
 #endif
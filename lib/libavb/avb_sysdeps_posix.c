@@ -8,6 +8,9 @@
 
 #include "avb_sysdeps.h"
 
+#include <dm.h>
+#include <u-boot/hash.h>
+
 int avb_memcmp(const void* src1, const void* src2, size_t n) {
   return memcmp(src1, src2, n);
 }
@@ -60,3 +63,60 @@ void* avb_malloc_(size_t size) {
 void avb_free(void* ptr) {
   free(ptr);
 }
+
+#if CONFIG_IS_ENABLED(DM_HASH)
+struct avb_hash_engine {
+  struct udevice* dev;
+  void* ctx;
+};
+
+void* avb_hash_engine_init(const char* algorithm) {
+  struct avb_hash_engine* engine;
+  struct udevice* dev;
+
+  /* Without submit() the engine is no faster than libavb itself */
+  if (hash_get_device(algorithm, &dev) || !hash_get_ops(dev)->submit) {
+    return NULL;
+  }
+  engine = malloc(sizeof(*engine));
+  if (engine == NULL) {
+    return NULL;
+  }
+  engine->dev = dev;
+  if (hash_dev_init(dev, algorithm, &engine->ctx)) {
+    free(engine);
+    return NULL;
+  }
+
+  return engine;
+}
+
+bool avb_hash_engine_update(void* engine, const uint8_t* data, size_t len) {
+  struct avb_hash_engine* e = engine;
+
+  return !hash_dev_submit(e->dev, e->ctx, data, len, 0);
+}
+
+bool avb_hash_engine_final(void* engine, uint8_t* digest, size_t digest_size) {
+  struct avb_hash_engine* e = engine;
+  int ret;
+
+  /* This also returns the error of any update, and frees the context */
+  ret = hash_dev_finish(e->dev, e->ctx, digest, digest_size);
+  free(e);
+
+  return !ret;
+}
+#else
+void* avb_hash_engine_init(const char* algorithm) {
+  return NULL;
+}
+
+bool avb_hash_engine_update(void* engine, const uint8_t* data, size_t len) {
+  return false;
+}
+
+bool avb_hash_engine_final(void* engine, uint8_t* digest, size_t digest_size) {
+  return false;
+}
+#endif
@@ -31,6 +31,8 @@ static void LZ4_wildCopy(void* dstPtr, const void* srcPtr, void* dstEnd)
 #define COPYLENGTH 8
 #define LASTLITERALS 5
 #define MFLIMIT (COPYLENGTH+MINMATCH)
+/* matches from here on are copied with memcpy() */
+#define LZ4_LONGCOPY 32
 static const int LZ4_minLength = (MFLIMIT+1);
 
 #define KB *(1 <<10)
@@ -202,6 +204,22 @@ FORCE_INLINE int LZ4_decompress_generic(
 
         /* copy repeated sequence */
         cpy = op + length;
+        if (unlikely(op-match == 1))
+        {
+            /* run of one byte */
+            if (cpy > oend-LASTLITERALS) goto _output_error;
+            memset(op, *match, length);
+            op = cpy;
+            continue;
+        }
+        if ((size_t)(op-match) >= length && length >= LZ4_LONGCOPY)
+        {
+            /* no overlap */
+            if (cpy > oend-LASTLITERALS) goto _output_error;
+            memcpy(op, match, length);
+            op = cpy;
+            continue;
+        }
         if (unlikely((op-match)<8))
         {
             const size_t dec64 = dec64table[op-match];
@@ -5,12 +5,20 @@
 
 #include <common.h>
 #include <compiler.h>
+#include <malloc.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
+#include <asm/unaligned.h>
 
-static u16 LZ4_readLE16(const void *src) { return le16_to_cpu(*(u16 *)src); }
-static void LZ4_copy4(void *dst, const void *src) { *(u32 *)dst = *(u32 *)src; }
-static void LZ4_copy8(void *dst, const void *src) { *(u64 *)dst = *(u64 *)src; }
+/*
+ * Neither pointer is aligned. A fixed-size memcpy() lets the compiler use
+ * the widest access the target allows, which is a single load and store
+ * where unaligned access is fine and byte moves where it traps (ARM with
+ * -mno-unaligned-access), instead of an alignment fault.
+ */
+static u16 LZ4_readLE16(const void *src) { return get_unaligned_le16(src); }
+static void LZ4_copy4(void *dst, const void *src) { __builtin_memcpy(dst, src, 4); }
+static void LZ4_copy8(void *dst, const void *src) { __builtin_memcpy(dst, src, 8); }
 
 typedef  uint8_t BYTE;
 typedef uint16_t U16;
@@ -20,7 +28,10 @@ typedef uint64_t U64;
 
 #define FORCE_INLINE static inline __attribute__((always_inline))
 
-/* Unaltered (except removing unrelated code) from github.com/Cyan4973/lz4. */
+/*
+ * From github.com/Cyan4973/lz4, with unrelated code removed and long
+ * matches and runs of one byte handed to memcpy()/memset().
+ */
 #include "lz4.c"	/* #include for inlining, do not link! */
 
 #define LZ4F_MAGIC 0x184D2204
@@ -95,7 +106,7 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	while (1) {
 		struct lz4_block_header b;
 
-		b.raw = le32_to_cpu(*(u32 *)in);
+		b.raw = get_unaligned_le32(in);
 		in += sizeof(struct lz4_block_header);
 
 		if (in - src + b.size > srcn) {
@@ -136,3 +147,177 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	*dstn = out - dst;
 	return ret;
 }
+
+int ulz4_block(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	int ret;
+
+	/* constant folding essential, do not touch params! */
+	ret = LZ4_decompress_generic(src, dst, srcn, *dstn, endOnInputSize,
+				     full, 0, noDict, dst, NULL, 0);
+	if (ret < 0)
+		return -EPROTO;	/* decompression error */
+
+	*dstn = ret;
+	return 0;
+}
+
+enum ulz4_stream_state {
+	ULZ4_FRAME_HDR,		/* magic, flags and block descriptor */
+	ULZ4_FRAME_HDR_END,	/* content size and header checksum */
+	ULZ4_BLOCK_HDR,
+	ULZ4_BLOCK,
+	ULZ4_CHECKSUM,		/* content checksum */
+	ULZ4_DONE,		/* anything after the frame is ignored */
+};
+
+/*
+ * Like ulz4fn(), a stream holds a single frame of independent blocks. Each
+ * block is gathered in @buf, unless it is all in one piece of input.
+ */
+struct ulz4_stream {
+	void *dst;
+	void *out;
+	void *end;
+	enum ulz4_stream_state state;
+	size_t need;		/* length of the current unit */
+	size_t have;		/* bytes of it in @buf */
+	size_t hdr_end;		/* length of the end of the frame header */
+	bool has_block_checksum;
+	bool has_content_checksum;
+	struct lz4_block_header b;
+	u8 hdr[sizeof(struct lz4_frame_header)];
+	u8 *buf;
+	size_t bufsize;
+};
+
+struct ulz4_stream *ulz4_stream_start(void *dst, size_t dstn)
+{
+	struct ulz4_stream *ls;
+
+	ls = calloc(1, sizeof(*ls));
+	if (!ls)
+		return NULL;
+	ls->dst = dst;
+	ls->out = dst;
+	ls->end = dst + dstn;
+	ls->state = ULZ4_FRAME_HDR;
+	ls->need = sizeof(struct lz4_frame_header);
+
+	return ls;
+}
+
+/* Handle a complete unit at @p, setting up the next one */
+static int ulz4_stream_unit(struct ulz4_stream *ls, const u8 *p)
+{
+	const struct lz4_frame_header *h = (const void *)p;
+	size_t size;
+	int ret;
+
+	switch (ls->state) {
+	case ULZ4_FRAME_HDR:
+		if (le32_to_cpu(h->magic) != LZ4F_MAGIC || h->version != 1)
+			return -EPROTONOSUPPORT;
+		if (h->reserved0 || h->reserved1 || h->reserved2)
+			return -EINVAL;
+		if (!h->independent_blocks || h->max_block_size < 4)
+			return -EPROTONOSUPPORT;
+		ls->has_block_checksum = h->has_block_checksum;
+		ls->has_content_checksum = h->has_content_checksum;
+		ls->bufsize = 1 << (8 + 2 * h->max_block_size);
+		ls->buf = malloc(ls->bufsize + sizeof(u32));
+		if (!ls->buf)
+			return -ENOMEM;
+		ls->state = ULZ4_FRAME_HDR_END;
+		ls->need = (h->has_content_size ? sizeof(u64) : 0) +
+			   sizeof(u8);
+		return 0;
+	case ULZ4_FRAME_HDR_END:
+		ls->state = ULZ4_BLOCK_HDR;
+		ls->need = sizeof(struct lz4_block_header);
+		return 0;
+	case ULZ4_BLOCK_HDR:
+		ls->b.raw = get_unaligned_le32(p);
+		if (!ls->b.size) {
+			ls->state = ls->has_content_checksum ? ULZ4_CHECKSUM :
+				    ULZ4_DONE;
+			ls->need = sizeof(u32);
+			return 0;
+		}
+		if (ls->b.size > ls->bufsize)
+			return -EINVAL;
+		ls->state = ULZ4_BLOCK;
+		ls->need = ls->b.size +
+			   (ls->has_block_checksum ? sizeof(u32) : 0);
+		return 0;
+	case ULZ4_BLOCK:
+		if (ls->b.not_compressed) {
+			size = min((ptrdiff_t)ls->b.size, ls->end - ls->out);
+			memcpy(ls->out, p, size);
+			ls->out += size;
+			if (size < ls->b.size)
+				return -ENOBUFS;
+		} else {
+			/* constant folding essential, do not touch params! */
+			ret = LZ4_decompress_generic((const void *)p, ls->out,
+					ls->b.size, ls->end - ls->out, endOnInputSize,
+					full, 0, noDict, ls->out, NULL, 0);
+			if (ret < 0)
+				return -EPROTO;
+			ls->out += ret;
+		}
+		ls->state = ULZ4_BLOCK_HDR;
+		ls->need = sizeof(struct lz4_block_header);
+		return 0;
+	case ULZ4_CHECKSUM:
+		ls->state = ULZ4_DONE;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+int ulz4_stream_feed(struct ulz4_stream *ls, const void *src, size_t srcn)
+{
+	const u8 *in = src, *end = in + srcn;
+	const u8 *unit;
+	u8 *buf;
+	size_t n;
+	int ret;
+
+	while (in < end && ls->state != ULZ4_DONE) {
+		if (!ls->have && end - in >= ls->need) {
+			unit = in;
+			in += ls->need;
+		} else {
+			buf = ls->buf ? ls->buf : ls->hdr;
+			n = min_t(size_t, ls->need - ls->have, end - in);
+			memcpy(buf + ls->have, in, n);
+			ls->have += n;
+			in += n;
+			if (ls->have < ls->need)
+				break;
+			unit = buf;
+		}
+		ls->have = 0;
+
+		ret = ulz4_stream_unit(ls, unit);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int ulz4_stream_end(struct ulz4_stream *ls, size_t *dstn)
+{
+	int ret = 0;
+
+	if (ls->state != ULZ4_DONE)
+		ret = -EINVAL;
+	*dstn = ls->out - ls->dst;
+	free(ls->buf);
+	free(ls);
+
+	return ret;
+}
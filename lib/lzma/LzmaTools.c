@@ -50,6 +50,12 @@ int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
     ELzmaStatus state;
     SizeT compressedSize = (SizeT)(length - LZMA_PROPS_SIZE);
 
+#ifdef CONFIG_LZMA_XZ
+    if (xz_is_stream(inStream, length))
+        return xzBuffToBuffDecompress(outStream, uncompressedSize,
+                                      inStream, length);
+#endif
+
     debug ("LZMA: Image address............... 0x%p\n", inStream);
     debug ("LZMA: Properties address.......... 0x%p\n", inStream + LZMA_PROPERTIES_OFFSET);
     debug ("LZMA: Uncompressed size address... 0x%p\n", inStream + LZMA_SIZE_OFFSET);
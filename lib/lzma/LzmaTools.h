@@ -15,4 +15,12 @@
 
 extern int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
 			      unsigned char *inStream,  SizeT  length);
+
+/*
+ * Decode an xz stream, as lzmaBuffToBuffDecompress() does for the
+ * LZMA_Alone format. That function hands xz streams over to this one.
+ */
+int xz_is_stream(const unsigned char *in, SizeT len);
+int xzBuffToBuffDecompress(unsigned char *outStream, SizeT *uncompressedSize,
+			   unsigned char *inStream, SizeT length);
 #endif
@@ -0,0 +1,526 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Decoding of the xz container, built on the LZMA decoder from the SDK
+ *
+ * An xz stream is a sequence of blocks followed by an index giving the
+ * compressed and uncompressed size of each. Each block is an LZMA2 stream
+ * of its own, so once the index has been read, every block's position in
+ * both the input and the output is known and the blocks can be decoded in
+ * any order. With CONFIG_ASPEED_SMP_JOBS, the secondary core decodes part
+ * of them while this one decodes the rest.
+ *
+ * Only single streams whose blocks use LZMA2 alone are supported, which is
+ * what "xz" and "xz -T0" produce. Give xz --block-size to get several
+ * blocks out of a single-threaded compressor.
+ */
+
+#include <config.h>
+#include <common.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <watchdog.h>
+#include <u-boot/crc.h>
+#include <u-boot/sha256.h>
+#include <asm/unaligned.h>
+#ifdef CONFIG_ASPEED_SMP_JOBS
+#include <asm/arch/smp.h>
+#endif
+
+#include "LzmaTools.h"
+#include "LzmaDec.h"
+
+#define XZ_HEADER_SIZE		12
+#define XZ_FOOTER_SIZE		12
+#define XZ_CHECK_NONE		0
+#define XZ_CHECK_CRC32		1
+#define XZ_CHECK_CRC64		4
+#define XZ_CHECK_SHA256		10
+#define XZ_FILTER_LZMA2		0x21
+#define XZ_BLOCK_COMP_SIZE	0x40
+#define XZ_BLOCK_UNCOMP_SIZE	0x80
+
+/* LZMA2 restricts lc + lp, which bounds the size of the probabilities */
+#define LZMA2_LCLP_MAX		4
+#define LZMA2_PROBS		(1846 + (0x300 << LZMA2_LCLP_MAX))
+
+/* Not in LzmaDec.h, as in the SDK's own LZMA2 decoder */
+void LzmaDec_InitDicAndState(CLzmaDec *p, Bool initDic, Bool initState);
+
+static const u8 xz_magic[6] = { 0xfd, '7', 'z', 'X', 'Z', 0x00 };
+static const u8 xz_footer_magic[2] = { 'Y', 'Z' };
+
+static u64 xz_crc64_table[256];
+
+struct xz_block {
+	const u8 *in;
+	SizeT in_len;		/* unpadded size, from the index */
+	u8 *out;
+	SizeT out_len;
+};
+
+/* Blocks decoded by one core, with the state it needs of its own */
+struct xz_work {
+	struct xz_block *blk;
+	int count;
+	int check;
+	CLzmaProb *probs;
+	int ret;
+} __aligned(ARCH_DMA_MINALIGN);
+
+int xz_is_stream(const unsigned char *in, SizeT len)
+{
+	return len >= XZ_HEADER_SIZE + XZ_FOOTER_SIZE &&
+	       !memcmp(in, xz_magic, sizeof(xz_magic));
+}
+
+static void xz_crc64_init(void)
+{
+	u64 c;
+	int i, j;
+
+	if (xz_crc64_table[1])
+		return;
+	for (i = 0; i < 256; i++) {
+		c = i;
+		for (j = 0; j < 8; j++)
+			c = (c >> 1) ^ (c & 1 ? 0xc96c5795d7870f42ULL : 0);
+		xz_crc64_table[i] = c;
+	}
+}
+
+static u64 xz_crc64(const u8 *p, SizeT len)
+{
+	u64 c = ~0ULL;
+
+	while (len--)
+		c = xz_crc64_table[(c ^ *p++) & 0xff] ^ (c >> 8);
+
+	return ~c;
+}
+
+static int xz_check_size(int check)
+{
+	switch (check) {
+	case XZ_CHECK_NONE:
+		return 0;
+	case XZ_CHECK_CRC32:
+		return 4;
+	case XZ_CHECK_CRC64:
+		return 8;
+	case XZ_CHECK_SHA256:
+		return SHA256_SUM_LEN;
+	default:
+		return -1;
+	}
+}
+
+static int xz_verify(int check, const u8 *data, SizeT len, const u8 *sum)
+{
+	u8 digest[SHA256_SUM_LEN];
+	sha256_context ctx;
+
+	switch (check) {
+	case XZ_CHECK_CRC32:
+		return crc32(0, data, len) == get_unaligned_le32(sum);
+	case XZ_CHECK_CRC64:
+		return xz_crc64(data, len) == get_unaligned_le64(sum);
+	case XZ_CHECK_SHA256:
+		sha256_starts(&ctx);
+		sha256_update(&ctx, data, len);
+		sha256_finish(&ctx, digest);
+		return !memcmp(digest, sum, sizeof(digest));
+	default:
+		return 1;
+	}
+}
+
+/* Read a variable-length integer, returning its length or 0 if invalid */
+static int xz_varint(const u8 *p, const u8 *end, u64 *val)
+{
+	int i;
+
+	*val = 0;
+	for (i = 0; i < 9 && p + i < end; i++) {
+		*val |= (u64)(p[i] & 0x7f) << (i * 7);
+		if (!(p[i] & 0x80))
+			return (i && !p[i]) ? 0 : i + 1;
+	}
+
+	return 0;
+}
+
+/* Decode the LZMA2 stream in @in to exactly @blk->out_len bytes */
+static int xz_lzma2(CLzmaDec *dec, const u8 *in, SizeT in_len,
+		    struct xz_block *blk)
+{
+	const u8 *end = in + in_len;
+	bool need_dic = true, need_state = true, need_props = true;
+	ELzmaStatus status;
+	SizeT unpacked, packed, inlen;
+	unsigned int c, mode, lc, lp, pb;
+	SRes res;
+
+	dec->dic = blk->out;
+	dec->dicBufSize = blk->out_len;
+	dec->dicPos = 0;
+
+	for (;;) {
+		if (in == end)
+			return SZ_ERROR_INPUT_EOF;
+		c = *in++;
+		if (!c)
+			break;
+
+		if (c == 1 || c == 2) {
+			/* Stored chunk */
+			if (end - in < 2)
+				return SZ_ERROR_INPUT_EOF;
+			unpacked = get_unaligned_be16(in) + 1;
+			in += 2;
+			if (c == 2 && need_dic)
+				return SZ_ERROR_DATA;
+			if (c == 1)
+				need_state = need_props = true;
+			need_dic = false;
+			if (unpacked > (SizeT)(end - in) ||
+			    unpacked > dec->dicBufSize - dec->dicPos)
+				return SZ_ERROR_DATA;
+
+			LzmaDec_InitDicAndState(dec, c == 1, False);
+			memcpy(dec->dic + dec->dicPos, in, unpacked);
+			dec->dicPos += unpacked;
+			if (!dec->checkDicSize &&
+			    dec->prop.dicSize - dec->processedPos <= unpacked)
+				dec->checkDicSize = dec->prop.dicSize;
+			dec->processedPos += unpacked;
+			in += unpacked;
+			continue;
+		}
+		if (c < 0x80)
+			return SZ_ERROR_DATA;
+
+		/* LZMA chunk */
+		mode = (c >> 5) & 3;
+		if (end - in < (mode >= 2 ? 5 : 4))
+			return SZ_ERROR_INPUT_EOF;
+		unpacked = ((c & 0x1f) << 16) + get_unaligned_be16(in) + 1;
+		packed = get_unaligned_be16(in + 2) + 1;
+		in += 4;
+		if ((mode < 3 && need_dic) || (!mode && need_state) ||
+		    (mode < 2 && need_props))
+			return SZ_ERROR_DATA;
+		if (mode >= 2) {
+			c = *in++;
+			lc = c % 9;
+			c /= 9;
+			lp = c % 5;
+			pb = c / 5;
+			if (pb > 4 || lc + lp > LZMA2_LCLP_MAX)
+				return SZ_ERROR_DATA;
+			dec->prop.lc = lc;
+			dec->prop.lp = lp;
+			dec->prop.pb = pb;
+			need_props = false;
+		}
+		need_dic = need_state = false;
+		if (packed > (SizeT)(end - in) ||
+		    unpacked > dec->dicBufSize - dec->dicPos)
+			return SZ_ERROR_DATA;
+
+		LzmaDec_InitDicAndState(dec, mode == 3, mode > 0);
+		inlen = packed;
+		res = LzmaDec_DecodeToDic(dec, dec->dicPos + unpacked, in,
+					  &inlen, LZMA_FINISH_END, &status);
+		if (res != SZ_OK)
+			return res;
+		if (inlen != packed ||
+		    status != LZMA_STATUS_MAYBE_FINISHED_WITHOUT_MARK)
+			return SZ_ERROR_DATA;
+		in += packed;
+	}
+
+	if (in != end || dec->dicPos != blk->out_len)
+		return SZ_ERROR_DATA;
+
+	return SZ_OK;
+}
+
+/* Decode one block, which must not print or allocate: see xz_smp_job() */
+static int xz_block(struct xz_block *blk, int check, CLzmaProb *probs)
+{
+	const u8 *p = blk->in, *hend;
+	int check_size = xz_check_size(check);
+	CLzmaDec dec;
+	u64 comp, uncomp = 0, id, size;
+	SizeT hsize, data_len;
+	int flags, n;
+	u8 dsz;
+	SRes res;
+
+	hsize = (p[0] + 1) * 4;
+	if (!p[0] || hsize + check_size > blk->in_len)
+		return SZ_ERROR_DATA;
+	hend = p + hsize - 4;
+	if (crc32(0, p, hsize - 4) != get_unaligned_le32(hend))
+		return SZ_ERROR_CRC;
+
+	flags = p[1];
+	p += 2;
+	if (flags & 0x3c)
+		return SZ_ERROR_UNSUPPORTED;
+	if (flags & 3)
+		return SZ_ERROR_UNSUPPORTED;	/* a filter chain */
+	data_len = blk->in_len - hsize - check_size;
+	if (flags & XZ_BLOCK_COMP_SIZE) {
+		n = xz_varint(p, hend, &comp);
+		if (!n || comp != data_len)
+			return SZ_ERROR_DATA;
+		p += n;
+	}
+	if (flags & XZ_BLOCK_UNCOMP_SIZE) {
+		n = xz_varint(p, hend, &uncomp);
+		if (!n || uncomp != blk->out_len)
+			return SZ_ERROR_DATA;
+		p += n;
+	}
+
+	/* The one filter, which must be LZMA2 */
+	n = xz_varint(p, hend, &id);
+	if (!n || id != XZ_FILTER_LZMA2)
+		return SZ_ERROR_UNSUPPORTED;
+	p += n;
+	n = xz_varint(p, hend, &size);
+	if (!n || size != 1 || p + n >= hend)
+		return SZ_ERROR_DATA;
+	p += n;
+	dsz = *p++;
+	if (dsz > 40)
+		return SZ_ERROR_UNSUPPORTED;
+	while (p < hend) {
+		if (*p++)
+			return SZ_ERROR_DATA;
+	}
+
+	memset(&dec, '\0', sizeof(dec));
+	dec.probs = probs;
+	dec.numProbs = LZMA2_PROBS;
+	dec.prop.dicSize = dsz == 40 ? 0xffffffff :
+			   (2 | (dsz & 1)) << (dsz / 2 + 11);
+	res = xz_lzma2(&dec, hend + 4, data_len, blk);
+	if (res != SZ_OK)
+		return res;
+
+	/* The check follows the padding of the data to four bytes */
+	p = blk->in + ALIGN(hsize + data_len, 4);
+	if (!xz_verify(check, blk->out, blk->out_len, p))
+		return SZ_ERROR_CRC;
+
+	return SZ_OK;
+}
+
+static int xz_blocks(struct xz_work *w, bool primary)
+{
+	int ret;
+	int i;
+
+	for (i = 0; i < w->count; i++) {
+		ret = xz_block(&w->blk[i], w->check, w->probs);
+		if (ret)
+			return ret;
+		if (primary)
+			WATCHDOG_RESET();
+	}
+
+	return SZ_OK;
+}
+
+#ifdef CONFIG_ASPEED_SMP_JOBS
+static struct xz_work xz_smp_work;
+
+static int xz_smp_job(void *arg)
+{
+	return xz_blocks(arg, false);
+}
+
+/*
+ * Decode the blocks on both cores. A block's output is only cache-line
+ * aligned by chance, so the secondary core gets a run of blocks from the
+ * middle. This core decodes those before the run during the job, and the
+ * two either side of it once the job is done, so that no cache line is
+ * written by both cores at once.
+ */
+static int xz_blocks_smp(struct xz_block *blk, int count, int check,
+			 CLzmaProb *probs)
+{
+	struct xz_work *w = &xz_smp_work, mine;
+	SizeT total = 0, head = 0, best = ~(SizeT)0, diff, run;
+	int first = 0, i, job, ret, sret;
+
+	for (i = 0; i < count - 1; i++)
+		total += blk[i].out_len;
+
+	/* Pick the split for which both cores have the same work */
+	for (i = 2; i < count - 1; i++) {
+		head += blk[i - 2].out_len;
+		run = total - head - blk[i - 1].out_len;
+		diff = head > run ? head - run : run - head;
+		if (diff < best) {
+			best = diff;
+			first = i;
+		}
+	}
+
+	w->blk = &blk[first];
+	w->count = count - 1 - first;
+	w->check = check;
+	w->probs = malloc_cache_aligned(LZMA2_PROBS * sizeof(CLzmaProb));
+	if (!w->probs)
+		return SZ_ERROR_MEM;
+
+	mine.blk = blk;
+	mine.count = count;
+	mine.check = check;
+	mine.probs = probs;
+
+	job = aspeed_smp_job_submit(xz_smp_job, w);
+	if (job < 0) {
+		free(w->probs);
+		return xz_blocks(&mine, true);
+	}
+
+	mine.count = first - 1;
+	ret = xz_blocks(&mine, true);
+
+	sret = aspeed_smp_job_wait(job);
+	free(w->probs);
+	if (!ret)
+		ret = sret;
+	if (!ret)
+		ret = xz_block(&blk[first - 1], check, probs);
+	if (!ret)
+		ret = xz_block(&blk[count - 1], check, probs);
+
+	return ret;
+}
+#endif
+
+int xzBuffToBuffDecompress(unsigned char *outStream, SizeT *uncompressedSize,
+			   unsigned char *inStream, SizeT length)
+{
+	const u8 *end = inStream + length, *p, *idx, *idx_end;
+	struct xz_block *blk;
+	struct xz_work w;
+	CLzmaProb *probs;
+	u64 count, unpadded, uncomp;
+	SizeT in_pos, out_pos;
+	int check, check_size;
+	SizeT out_max = *uncompressedSize;
+	int i, n, ret;
+
+	*uncompressedSize = 0;
+	if (!xz_is_stream(inStream, length))
+		return SZ_ERROR_DATA;
+
+	/* Stream header */
+	check = inStream[7];
+	if (inStream[6] || check > 15 ||
+	    crc32(0, inStream + 6, 2) != get_unaligned_le32(inStream + 8))
+		return SZ_ERROR_DATA;
+	check_size = xz_check_size(check);
+	if (check_size < 0) {
+		printf("xz: Unsupported check type %d\n", check);
+		return SZ_ERROR_UNSUPPORTED;
+	}
+
+	/* Stream padding, then the footer */
+	while (end - inStream >= XZ_HEADER_SIZE + XZ_FOOTER_SIZE + 4 &&
+	       !get_unaligned_le32(end - 4))
+		end -= 4;
+	p = end - XZ_FOOTER_SIZE;
+	if (memcmp(p + 10, xz_footer_magic, 2) ||
+	    memcmp(p + 8, inStream + 6, 2) ||
+	    crc32(0, p + 4, 6) != get_unaligned_le32(p))
+		return SZ_ERROR_DATA;
+
+	/* The index, which ends where the footer starts */
+	idx_end = p;
+	idx = idx_end - ((SizeT)get_unaligned_le32(p + 4) + 1) * 4;
+	if (idx < inStream + XZ_HEADER_SIZE || idx[0] ||
+	    crc32(0, idx, idx_end - idx - 4) !=
+	    get_unaligned_le32(idx_end - 4))
+		return SZ_ERROR_DATA;
+	p = idx + 1;
+	n = xz_varint(p, idx_end, &count);
+	if (!n || count > (idx_end - idx) / 2)
+		return SZ_ERROR_DATA;
+	p += n;
+
+	blk = count ? calloc(count, sizeof(*blk)) : NULL;
+	probs = malloc_cache_aligned(LZMA2_PROBS * sizeof(CLzmaProb));
+	if ((count && !blk) || !probs) {
+		ret = SZ_ERROR_MEM;
+		goto out;
+	}
+
+	ret = SZ_ERROR_DATA;
+	in_pos = XZ_HEADER_SIZE;
+	out_pos = 0;
+	for (i = 0; i < count; i++) {
+		n = xz_varint(p, idx_end, &unpadded);
+		if (!n)
+			goto out;
+		p += n;
+		n = xz_varint(p, idx_end, &uncomp);
+		if (!n)
+			goto out;
+		p += n;
+		if (unpadded > idx - inStream - in_pos)
+			goto out;
+		if (uncomp > (SizeT)~0 - out_pos)
+			goto out;
+		blk[i].in = inStream + in_pos;
+		blk[i].in_len = unpadded;
+		blk[i].out = outStream + out_pos;
+		blk[i].out_len = uncomp;
+		in_pos += ALIGN(unpadded, 4);
+		out_pos += uncomp;
+	}
+	if (inStream + in_pos != idx)
+		goto out;
+	while (p < idx_end - 4) {
+		if (*p++)
+			goto out;
+	}
+
+	if (out_pos > out_max) {
+		ret = SZ_ERROR_OUTPUT_EOF;
+		goto out;
+	}
+
+	xz_crc64_init();
+	debug("xz: %llu blocks, %zu bytes\n", count, (size_t)out_pos);
+	WATCHDOG_RESET();
+#ifdef CONFIG_ASPEED_SMP_JOBS
+	if (count >= 4) {
+		ret = xz_blocks_smp(blk, count, check, probs);
+		goto done;
+	}
+#endif
+	w.blk = blk;
+	w.count = count;
+	w.check = check;
+	w.probs = probs;
+	ret = xz_blocks(&w, true);
+#ifdef CONFIG_ASPEED_SMP_JOBS
+done:
+#endif
+	if (ret == SZ_OK)
+		*uncompressedSize = out_pos;
+	else if (ret == SZ_ERROR_UNSUPPORTED)
+		puts("xz: Only blocks with LZMA2 alone are supported\n");
+out:
+	free(probs);
+	free(blk);
+
+	return ret;
+}
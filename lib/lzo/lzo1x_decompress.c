@@ -21,8 +21,15 @@
 #define HAVE_OP(x, op_end, op) ((size_t)(op_end - op) < (x))
 #define HAVE_LB(m_pos, out, op) (m_pos < out || m_pos >= op)
 
-#define COPY4(dst, src)	\
-		put_unaligned(get_unaligned((const u32 *)(src)), (u32 *)(dst))
+/*
+ * A fixed-size memcpy() is a single access where unaligned loads are
+ * allowed and byte moves where they trap, rather than shifting bytes
+ * together through get_unaligned().
+ */
+#define COPY4(dst, src)	__builtin_memcpy(dst, src, 4)
+
+/* Runs from this length on go to memcpy() */
+#define LZO_LONGCOPY	32
 
 static const unsigned char lzop_magic[] = {
 	0x89, 0x4c, 0x5a, 0x4f, 0x00, 0x0d, 0x0a, 0x1a, 0x0a
@@ -183,26 +190,21 @@ int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
 		if (HAVE_IP(t + 4, ip_end, ip))
 			goto input_overrun;
 
-		COPY4(op, ip);
-		op += 4;
-		ip += 4;
-		if (--t > 0) {
-			if (t >= 4) {
-				do {
-					COPY4(op, ip);
-					op += 4;
-					ip += 4;
-					t -= 4;
-				} while (t >= 4);
-				if (t > 0) {
-					do {
-						*op++ = *ip++;
-					} while (--t > 0);
-				}
-			} else {
-				do {
-					*op++ = *ip++;
-				} while (--t > 0);
+		t += 3;
+		if (t >= LZO_LONGCOPY) {
+			memcpy(op, ip, t);
+			op += t;
+			ip += t;
+		} else {
+			do {
+				COPY4(op, ip);
+				op += 4;
+				ip += 4;
+				t -= 4;
+			} while (t >= 4);
+			while (t > 0) {
+				*op++ = *ip++;
+				t--;
 			}
 		}
 
@@ -294,7 +296,13 @@ match:
 			if (HAVE_OP(t + 3 - 1, op_end, op))
 				goto output_overrun;
 
-			if (t >= 2 * 4 - (3 - 1) && (op - m_pos) >= 4) {
+			if (op - m_pos == 1) {
+				memset(op, *m_pos, t + 2);
+				op += t + 2;
+			} else if (t + 2 >= LZO_LONGCOPY && op - m_pos >= t + 2) {
+				memcpy(op, m_pos, t + 2);
+				op += t + 2;
+			} else if (t >= 2 * 4 - (3 - 1) && (op - m_pos) >= 4) {
 				COPY4(op, m_pos);
 				op += 4;
 				m_pos += 4;
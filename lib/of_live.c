@@ -14,6 +14,7 @@
 #include <malloc.h>
 #include <dm/of_access.h>
 #include <linux/err.h>
+#include <u-boot/crc.h>
 
 static void *unflatten_dt_alloc(void **mem, unsigned long size,
 				unsigned long align)
@@ -314,12 +315,39 @@ static int unflatten_device_tree(const void *blob,
 	return 0;
 }
 
+/**
+ * of_live_image_get() - use the live tree generated at build time
+ *
+ * The generated tree is only valid for the flat tree it was generated from,
+ * which may have been replaced (e.g. with CONFIG_OF_SEPARATE) or fixed up.
+ *
+ * @blob: Flat tree in use
+ * @rootp: Returns the generated live tree
+ * @return 0 if OK, -ENOENT if the generated tree does not match @blob
+ */
+static int of_live_image_get(const void *blob, struct device_node **rootp)
+{
+	if (!CONFIG_IS_ENABLED(OF_LIVE_IMAGE))
+		return -ENOENT;
+
+	if (fdt_totalsize(blob) != of_live_image.fdt_size ||
+	    crc32(0, blob, fdt_totalsize(blob)) != of_live_image.fdt_crc) {
+		debug("Live tree image does not match the device tree\n");
+		return -ENOENT;
+	}
+	*rootp = of_live_image.root;
+
+	return 0;
+}
+
 int of_live_build(const void *fdt_blob, struct device_node **rootp)
 {
 	int ret;
 
 	debug("%s: start\n", __func__);
-	ret = unflatten_device_tree(fdt_blob, rootp);
+	ret = of_live_image_get(fdt_blob, rootp);
+	if (ret)
+		ret = unflatten_device_tree(fdt_blob, rootp);
 	if (ret) {
 		debug("Failed to create live tree: err=%d\n", ret);
 		return ret;
@@ -10,6 +10,7 @@
 #include <linux/errno.h>
 #include <asm/unaligned.h>
 #include <hash.h>
+#include <hw_sha.h>
 #else
 #include "fdt_host.h"
 #endif
@@ -29,6 +30,13 @@ int hash_calculate(const char *name,
 	if (ret)
 		return ret;
 
+#if defined(CONFIG_SHA_HW_SG) && !defined(USE_HOSTCC)
+	ret = hw_sha_digest_sg(algo, region, region_count, checksum,
+			       algo->digest_size);
+	if (ret != -EINVAL)
+		return ret;
+#endif
+
 	ret = algo->hash_init(algo, &ctx);
 	if (ret)
 		return ret;
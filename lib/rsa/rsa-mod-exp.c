@@ -246,53 +246,54 @@ static void rsa_convert_big_endian(uint32_t *dst, const uint32_t *src, int len)
 		dst[i] = fdt32_to_cpu(src[len - 1 - i]);
 }
 
-int rsa_mod_exp_sw(const uint8_t *sig, uint32_t sig_len,
-		struct key_prop *prop, uint8_t *out)
+int rsa_key_check(const struct key_prop *prop)
 {
-	struct rsa_public_key key;
-	int ret;
-
 	if (!prop) {
 		debug("%s: Skipping invalid prop", __func__);
 		return -EBADF;
 	}
-	key.n0inv = prop->n0inv;
-	key.len = prop->num_bits;
 
-	if (!prop->public_exponent)
-		key.exponent = RSA_DEFAULT_PUBEXP;
-	else
-		key.exponent =
-			fdt64_to_cpu(*((uint64_t *)(prop->public_exponent)));
-
-	if (!key.len || !prop->modulus || !prop->rr) {
+	if (!prop->num_bits || !prop->modulus || !prop->rr) {
 		debug("%s: Missing RSA key info", __func__);
 		return -EFAULT;
 	}
 
 	/* Sanity check for stack size */
-	if (key.len > RSA_MAX_KEY_BITS || key.len < RSA_MIN_KEY_BITS) {
-		debug("RSA key bits %u outside allowed range %d..%d\n",
-		      key.len, RSA_MIN_KEY_BITS, RSA_MAX_KEY_BITS);
+	if (prop->num_bits > RSA_MAX_KEY_BITS ||
+	    prop->num_bits < RSA_MIN_KEY_BITS) {
+		debug("RSA key bits %d outside allowed range %d..%d\n",
+		      prop->num_bits, RSA_MIN_KEY_BITS, RSA_MAX_KEY_BITS);
 		return -EFAULT;
 	}
-	key.len /= sizeof(uint32_t) * 8;
-	uint32_t key1[key.len], key2[key.len];
 
-	key.modulus = key1;
-	key.rr = key2;
-	rsa_convert_big_endian(key.modulus, (uint32_t *)prop->modulus, key.len);
-	rsa_convert_big_endian(key.rr, (uint32_t *)prop->rr, key.len);
-	if (!key.modulus || !key.rr) {
-		debug("%s: Out of memory", __func__);
-		return -ENOMEM;
-	}
+	return 0;
+}
+
+void rsa_key_convert(const struct key_prop *prop, struct rsa_public_key *key)
+{
+	key->n0inv = prop->n0inv;
+	key->len = prop->num_bits / (sizeof(uint32_t) * 8);
+
+	if (!prop->public_exponent)
+		key->exponent = RSA_DEFAULT_PUBEXP;
+	else
+		key->exponent =
+			fdt64_to_cpu(*((uint64_t *)(prop->public_exponent)));
 
+	rsa_convert_big_endian(key->modulus, (uint32_t *)prop->modulus,
+			       key->len);
+	rsa_convert_big_endian(key->rr, (uint32_t *)prop->rr, key->len);
+}
+
+static int rsa_mod_exp_key(const struct rsa_public_key *key,
+			   const uint8_t *sig, uint32_t sig_len, uint8_t *out)
+{
 	uint32_t buf[sig_len / sizeof(uint32_t)];
+	int ret;
 
 	memcpy(buf, sig, sig_len);
 
-	ret = pow_mod(&key, buf);
+	ret = pow_mod(key, buf);
 	if (ret)
 		return ret;
 
@@ -301,6 +302,29 @@ int rsa_mod_exp_sw(const uint8_t *sig, uint32_t sig_len,
 	return 0;
 }
 
+int rsa_mod_exp_sw(const uint8_t *sig, uint32_t sig_len,
+		struct key_prop *prop, uint8_t *out)
+{
+	struct rsa_public_key key;
+	int ret;
+
+	/* Already converted, e.g. by the key cache of rsa_verify() */
+	if (prop && prop->key)
+		return rsa_mod_exp_key(prop->key, sig, sig_len, out);
+
+	ret = rsa_key_check(prop);
+	if (ret)
+		return ret;
+
+	uint32_t key1[prop->num_bits / 32], key2[prop->num_bits / 32];
+
+	key.modulus = key1;
+	key.rr = key2;
+	rsa_key_convert(prop, &key);
+
+	return rsa_mod_exp_key(&key, sig, sig_len, out);
+}
+
 #if defined(CONFIG_CMD_ZYNQ_RSA)
 /**
  * zynq_pow_mod - in-place public exponentiation
@@ -20,9 +20,16 @@
 #include <u-boot/rsa-mod-exp.h>
 #include <u-boot/rsa.h>
 
+#ifndef USE_HOSTCC
+DECLARE_GLOBAL_DATA_PTR;
+#endif
+
 /* Default public exponent for backward compatibility */
 #define RSA_DEFAULT_PUBEXP	65537
 
+/* Number of key nodes of the control FDT kept parsed */
+#define RSA_KEY_CACHE_MAX	4
+
 /**
  * rsa_verify_padding() - Verify RSA message padding is valid
  *
@@ -270,6 +277,24 @@ out:
 }
 #endif
 
+/* Check that @sig can be verified with @prop at all */
+static int rsa_verify_key_check(struct key_prop *prop, const uint32_t sig_len)
+{
+	if (sig_len != (prop->num_bits / 8)) {
+		debug("Signature is of incorrect length %d\n", sig_len);
+		return -EINVAL;
+	}
+
+	/* Sanity check for stack size */
+	if (sig_len > RSA_MAX_SIG_BITS / 8) {
+		debug("Signature length %u exceeds maximum %d\n", sig_len,
+		      RSA_MAX_SIG_BITS / 8);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 /**
  * rsa_verify_key() - Verify a signature against some data using RSA Key
  *
@@ -282,12 +307,14 @@ out:
  * @sig_len:	Number of bytes in signature
  * @hash:	Pointer to the expected hash
  * @key_len:	Number of bytes in rsa key
+ * @started:	The modular exponentiation of @sig with @prop was started by
+ *		rsa_verify_key_start() and only needs to be finished
  * @return 0 if verified, -ve on error
  */
 static int rsa_verify_key(struct image_sign_info *info,
 			  struct key_prop *prop, const uint8_t *sig,
 			  const uint32_t sig_len, const uint8_t *hash,
-			  const uint32_t key_len)
+			  const uint32_t key_len, bool started)
 {
 	int ret;
 #if !defined(USE_HOSTCC)
@@ -300,20 +327,12 @@ static int rsa_verify_key(struct image_sign_info *info,
 	if (!prop || !sig || !hash || !checksum)
 		return -EIO;
 
-	if (sig_len != (prop->num_bits / 8)) {
-		debug("Signature is of incorrect length %d\n", sig_len);
-		return -EINVAL;
-	}
+	ret = rsa_verify_key_check(prop, sig_len);
+	if (ret)
+		return ret;
 
 	debug("Checksum algorithm: %s", checksum->name);
 
-	/* Sanity check for stack size */
-	if (sig_len > RSA_MAX_SIG_BITS / 8) {
-		debug("Signature length %u exceeds maximum %d\n", sig_len,
-		      RSA_MAX_SIG_BITS / 8);
-		return -EINVAL;
-	}
-
 	uint8_t buf[sig_len];
 	hash_len = checksum->checksum_len;
 
@@ -324,7 +343,10 @@ static int rsa_verify_key(struct image_sign_info *info,
 		return -EINVAL;
 	}
 
-	ret = rsa_mod_exp(mod_exp_dev, sig, sig_len, prop, buf);
+	if (started)
+		ret = rsa_mod_exp_finish(mod_exp_dev, buf);
+	else
+		ret = rsa_mod_exp(mod_exp_dev, sig, sig_len, prop, buf);
 #else
 	ret = rsa_mod_exp_sw(sig, sig_len, prop, buf);
 #endif
@@ -342,6 +364,140 @@ static int rsa_verify_key(struct image_sign_info *info,
 	return 0;
 }
 
+/**
+ * rsa_key_prop() - Read the properties of a key node
+ *
+ * @blob:	FDT holding the key
+ * @node:	Node having the RSA Key properties
+ * @prop:	Returns the key, pointing into @blob
+ * @return 0 if OK, -EFAULT if the key is incomplete
+ */
+static int rsa_key_prop(const void *blob, int node, struct key_prop *prop)
+{
+	int length;
+
+	memset(prop, '\0', sizeof(*prop));
+
+	prop->num_bits = fdtdec_get_int(blob, node, "rsa,num-bits", 0);
+
+	prop->n0inv = fdtdec_get_int(blob, node, "rsa,n0-inverse", 0);
+
+	prop->public_exponent = fdt_getprop(blob, node, "rsa,exponent",
+					    &length);
+	if (!prop->public_exponent || length < sizeof(uint64_t))
+		prop->public_exponent = NULL;
+
+	prop->exp_len = sizeof(uint64_t);
+
+	prop->modulus = fdt_getprop(blob, node, "rsa,modulus", NULL);
+
+	prop->rr = fdt_getprop(blob, node, "rsa,r-squared", NULL);
+
+	if (!prop->num_bits || !prop->modulus) {
+		debug("%s: Missing RSA key info", __func__);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+#ifndef USE_HOSTCC
+#define RSA_ENABLE_KEY_CACHE	CONFIG_IS_ENABLED(RSA_KEY_CACHE)
+#else
+#define RSA_ENABLE_KEY_CACHE	0
+#endif
+
+#if RSA_ENABLE_KEY_CACHE
+/*
+ * Keys of the control FDT, read and converted for rsa_mod_exp_sw() the
+ * first time they are used. That FDT does not change once U-Boot runs
+ * from its final place, so an entry never goes stale.
+ */
+static struct rsa_key_cache {
+	const void *blob;
+	int node;
+	struct key_prop prop;
+	struct rsa_public_key key;
+} rsa_key_cache[RSA_KEY_CACHE_MAX];
+static int rsa_key_cache_count;
+
+static struct key_prop *rsa_key_cache_get(const void *blob, int node)
+{
+	struct rsa_key_cache *c;
+	uint32_t *words;
+	int i;
+
+	/* Before relocation .bss is not ours to write */
+	if (blob != gd->fdt_blob ||
+	    (!IS_ENABLED(CONFIG_SPL_BUILD) && !(gd->flags & GD_FLG_RELOC)))
+		return NULL;
+
+	for (i = 0; i < rsa_key_cache_count; i++) {
+		c = &rsa_key_cache[i];
+		if (c->blob == blob && c->node == node)
+			return &c->prop;
+	}
+
+	if (rsa_key_cache_count == RSA_KEY_CACHE_MAX)
+		return NULL;
+	c = &rsa_key_cache[rsa_key_cache_count];
+	if (rsa_key_prop(blob, node, &c->prop))
+		return NULL;
+
+	/* A key the software cannot use is still worth keeping for an engine */
+	if (!rsa_key_check(&c->prop)) {
+		words = malloc(c->prop.num_bits / 8 * 2);
+		if (!words)
+			return NULL;
+		c->key.modulus = words;
+		c->key.rr = words + c->prop.num_bits / 32;
+		rsa_key_convert(&c->prop, &c->key);
+		c->prop.key = &c->key;
+	}
+	c->blob = blob;
+	c->node = node;
+	rsa_key_cache_count++;
+
+	return &c->prop;
+}
+#else
+static inline struct key_prop *rsa_key_cache_get(const void *blob, int node)
+{
+	return NULL;
+}
+#endif
+
+/**
+ * rsa_key_get() - Get the properties of a key node
+ *
+ * @blob:	FDT holding the key
+ * @node:	Node having the RSA Key properties
+ * @buf:	Space for the key if it is not cached
+ * @propp:	Returns the key, either @buf or a cached copy
+ * @return 0 if OK, -ve on error
+ */
+static int rsa_key_get(const void *blob, int node, struct key_prop *buf,
+		       struct key_prop **propp)
+{
+	int ret;
+
+	if (node < 0) {
+		debug("%s: Skipping invalid node", __func__);
+		return -EBADF;
+	}
+
+	*propp = rsa_key_cache_get(blob, node);
+	if (*propp)
+		return 0;
+
+	ret = rsa_key_prop(blob, node, buf);
+	if (ret)
+		return ret;
+	*propp = buf;
+
+	return 0;
+}
+
 /**
  * rsa_verify_with_keynode() - Verify a signature against some data using
  * information in node with prperties of RSA Key like modulus, exponent etc.
@@ -355,46 +511,68 @@ static int rsa_verify_key(struct image_sign_info *info,
  * @sig:	Signature
  * @sig_len:	Number of bytes in signature
  * @node:	Node having the RSA Key properties
+ * @started:	See rsa_verify_key()
  * @return 0 if verified, -ve on error
  */
 static int rsa_verify_with_keynode(struct image_sign_info *info,
 				   const void *hash, uint8_t *sig,
-				   uint sig_len, int node)
+				   uint sig_len, int node, bool started)
 {
-	const void *blob = info->fdt_blob;
-	struct key_prop prop;
-	int length;
-	int ret = 0;
-
-	if (node < 0) {
-		debug("%s: Skipping invalid node", __func__);
-		return -EBADF;
-	}
-
-	prop.num_bits = fdtdec_get_int(blob, node, "rsa,num-bits", 0);
+	struct key_prop buf, *prop;
+	int ret;
 
-	prop.n0inv = fdtdec_get_int(blob, node, "rsa,n0-inverse", 0);
+	ret = rsa_key_get(info->fdt_blob, node, &buf, &prop);
+	if (ret)
+		return ret;
 
-	prop.public_exponent = fdt_getprop(blob, node, "rsa,exponent", &length);
-	if (!prop.public_exponent || length < sizeof(uint64_t))
-		prop.public_exponent = NULL;
+	return rsa_verify_key(info, prop, sig, sig_len, hash,
+			      info->crypto->key_len, started);
+}
 
-	prop.exp_len = sizeof(uint64_t);
+#if !defined(USE_HOSTCC)
+/**
+ * rsa_verify_key_start() - Start the modular exponentiation for a key
+ *
+ * The result does not depend on the hash, so an engine can work on it
+ * while the hash is calculated. rsa_verify_with_keynode() must then be
+ * called for @node with @started set, to collect the result.
+ *
+ * @return true if started, false if the caller must do it the usual way
+ */
+static bool rsa_verify_key_start(struct image_sign_info *info, uint8_t *sig,
+				 uint sig_len, int node)
+{
+	struct udevice *mod_exp_dev;
+	struct key_prop buf, *prop;
 
-	prop.modulus = fdt_getprop(blob, node, "rsa,modulus", NULL);
+	if (rsa_key_get(info->fdt_blob, node, &buf, &prop) ||
+	    rsa_verify_key_check(prop, sig_len) ||
+	    uclass_get_device(UCLASS_MOD_EXP, 0, &mod_exp_dev))
+		return false;
 
-	prop.rr = fdt_getprop(blob, node, "rsa,r-squared", NULL);
+	return !rsa_mod_exp_start(mod_exp_dev, sig, sig_len, prop);
+}
 
-	if (!prop.num_bits || !prop.modulus) {
-		debug("%s: Missing RSA key info", __func__);
-		return -EFAULT;
-	}
+/* Collect and drop the result of rsa_verify_key_start() */
+static void rsa_verify_key_cancel(uint sig_len)
+{
+	struct udevice *mod_exp_dev;
+	uint8_t buf[sig_len];
 
-	ret = rsa_verify_key(info, &prop, sig, sig_len, hash,
-			     info->crypto->key_len);
+	if (!uclass_get_device(UCLASS_MOD_EXP, 0, &mod_exp_dev))
+		rsa_mod_exp_finish(mod_exp_dev, buf);
+}
+#else
+static inline bool rsa_verify_key_start(struct image_sign_info *info,
+					uint8_t *sig, uint sig_len, int node)
+{
+	return false;
+}
 
-	return ret;
+static inline void rsa_verify_key_cancel(uint sig_len)
+{
 }
+#endif
 
 int rsa_verify(struct image_sign_info *info,
 	       const struct image_region region[], int region_count,
@@ -405,6 +583,7 @@ int rsa_verify(struct image_sign_info *info,
 	uint8_t hash[info->crypto->key_len];
 	int ndepth, noffset;
 	int sig_node, node;
+	bool started;
 	char name[100];
 	int ret;
 
@@ -425,26 +604,34 @@ int rsa_verify(struct image_sign_info *info,
 		return -ENOENT;
 	}
 
+	/* The key we must use, otherwise the one that matches our hint */
+	snprintf(name, sizeof(name), "key-%s", info->keyname);
+	node = fdt_subnode_offset(blob, sig_node, name);
+	started = rsa_verify_key_start(info, sig, sig_len,
+				       info->required_keynode != -1 ?
+				       info->required_keynode : node);
+
 	/* Calculate checksum with checksum-algorithm */
 	ret = info->checksum->calculate(info->checksum->name,
 					region, region_count, hash);
 	if (ret < 0) {
 		debug("%s: Error in checksum calculation\n", __func__);
+		if (started)
+			rsa_verify_key_cancel(sig_len);
 		return -EINVAL;
 	}
 
 	/* See if we must use a particular key */
 	if (info->required_keynode != -1) {
 		ret = rsa_verify_with_keynode(info, hash, sig, sig_len,
-			info->required_keynode);
+			info->required_keynode, started);
+		started = false;
 		if (!ret)
 			return ret;
 	}
 
 	/* Look for a key that matches our hint */
-	snprintf(name, sizeof(name), "key-%s", info->keyname);
-	node = fdt_subnode_offset(blob, sig_node, name);
-	ret = rsa_verify_with_keynode(info, hash, sig, sig_len, node);
+	ret = rsa_verify_with_keynode(info, hash, sig, sig_len, node, started);
 	if (!ret)
 		return ret;
 
@@ -454,7 +641,7 @@ int rsa_verify(struct image_sign_info *info,
 			noffset = fdt_next_node(info->fit, noffset, &ndepth)) {
 		if (ndepth == 1 && noffset != node) {
 			ret = rsa_verify_with_keynode(info, hash, sig, sig_len,
-						      noffset);
+						      noffset, false);
 			if (!ret)
 				break;
 		}
@@ -219,6 +219,46 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 	ctx->state[4] += E;
 }
 
+#if defined(CONFIG_ARM64) && !defined(USE_HOSTCC)
+#if CONFIG_IS_ENABLED(ARMV8_CE_SHA1)
+#define SHA1_ARM64_CE
+
+void sha1_ce_transform(uint32_t state[5], const unsigned char *data,
+		       unsigned int blocks);
+
+/* The SHA-1 instructions are optional in ARMv8.0 */
+static inline int sha1_ce_have(void)
+{
+	uint64_t isar0;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+
+	return ((isar0 >> 8) & 0xf) != 0;
+}
+#endif
+#endif
+
+static void sha1_process_blocks(sha1_context *ctx, const unsigned char *data,
+				unsigned int blocks)
+{
+#ifdef SHA1_ARM64_CE
+	uint32_t state[5];
+	int i;
+
+	if (sha1_ce_have()) {
+		/* The context holds the words in unsigned longs */
+		for (i = 0; i < 5; i++)
+			state[i] = ctx->state[i];
+		sha1_ce_transform(state, data, blocks);
+		for (i = 0; i < 5; i++)
+			ctx->state[i] = state[i];
+		return;
+	}
+#endif
+	for (; blocks; blocks--, data += 64)
+		sha1_process(ctx, data);
+}
+
 /*
  * SHA-1 process buffer
  */
@@ -242,16 +282,16 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
 
 	if (left && ilen >= fill) {
 		memcpy ((void *) (ctx->buffer + left), (void *) input, fill);
-		sha1_process (ctx, ctx->buffer);
+		sha1_process_blocks(ctx, ctx->buffer, 1);
 		input += fill;
 		ilen -= fill;
 		left = 0;
 	}
 
-	while (ilen >= 64) {
-		sha1_process (ctx, input);
-		input += 64;
-		ilen -= 64;
+	if (ilen >= 64) {
+		sha1_process_blocks(ctx, input, ilen / 64);
+		input += ilen & ~63;
+		ilen &= 63;
 	}
 
 	if (ilen > 0) {
@@ -186,6 +186,38 @@ static void sha256_process(sha256_context *ctx, const uint8_t data[64])
 	ctx->state[7] += H;
 }
 
+#if defined(CONFIG_ARM64) && !defined(USE_HOSTCC)
+#if CONFIG_IS_ENABLED(ARMV8_CE_SHA256)
+#define SHA256_ARM64_CE
+
+void sha256_ce_transform(uint32_t state[8], const uint8_t *data,
+			 unsigned int blocks);
+
+/* The SHA-256 instructions are optional in ARMv8.0 */
+static inline int sha256_ce_have(void)
+{
+	uint64_t isar0;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+
+	return ((isar0 >> 12) & 0xf) != 0;
+}
+#endif
+#endif
+
+static void sha256_process_blocks(sha256_context *ctx, const uint8_t *data,
+				  uint32_t blocks)
+{
+#ifdef SHA256_ARM64_CE
+	if (sha256_ce_have()) {
+		sha256_ce_transform(ctx->state, data, blocks);
+		return;
+	}
+#endif
+	for (; blocks; blocks--, data += 64)
+		sha256_process(ctx, data);
+}
+
 void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 {
 	uint32_t left, fill;
@@ -204,16 +236,16 @@ void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 
 	if (left && length >= fill) {
 		memcpy((void *) (ctx->buffer + left), (void *) input, fill);
-		sha256_process(ctx, ctx->buffer);
+		sha256_process_blocks(ctx, ctx->buffer, 1);
 		length -= fill;
 		input += fill;
 		left = 0;
 	}
 
-	while (length >= 64) {
-		sha256_process(ctx, input);
-		length -= 64;
-		input += 64;
+	if (length >= 64) {
+		sha256_process_blocks(ctx, input, length / 64);
+		input += length & ~63;
+		length &= 63;
 	}
 
 	if (length)
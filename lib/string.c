@@ -22,6 +22,26 @@
 #include <malloc.h>
 #include <common.h>
 
+#if CONFIG_IS_ENABLED(STRING_WORD_AT_A_TIME)
+/*
+ * The word-at-a-time loops below only make aligned loads, so they never
+ * read from a page the byte loops would not have read from.
+ */
+#define WORD_ONES	(~0UL / 0xff)
+#define WORD_HIGHS	(WORD_ONES << 7)
+
+static inline bool word_aligned(const void *p)
+{
+	return IS_ALIGNED((ulong)p, sizeof(ulong));
+}
+
+/* Non-zero if one of the bytes of @w is zero */
+static inline ulong word_has_zero(ulong w)
+{
+	return (w - WORD_ONES) & ~w & WORD_HIGHS;
+}
+#endif
+
 /**
  * strncasecmp - Case insensitive, length-limited string comparison
  * @s1: One string
@@ -186,6 +206,25 @@ int strcmp(const char * cs,const char * ct)
 {
 	register signed char __res;
 
+#if CONFIG_IS_ENABLED(STRING_WORD_AT_A_TIME)
+	if (word_aligned((void *)((ulong)cs ^ (ulong)ct))) {
+		const ulong *a, *b;
+
+		for (; !word_aligned(cs); cs++, ct++) {
+			if ((__res = *cs - *ct) != 0 || !*cs)
+				return __res;
+		}
+		a = (const ulong *)cs;
+		b = (const ulong *)ct;
+		while (*a == *b && !word_has_zero(*a)) {
+			a++;
+			b++;
+		}
+		/* The bytes below find the difference or the end */
+		cs = (const char *)a;
+		ct = (const char *)b;
+	}
+#endif
 	while (1) {
 		if ((__res = *cs - *ct++) != 0 || !*cs++)
 			break;
@@ -224,6 +263,21 @@ int strncmp(const char * cs,const char * ct,size_t count)
  */
 char * strchr(const char * s, int c)
 {
+#if CONFIG_IS_ENABLED(STRING_WORD_AT_A_TIME)
+	ulong mask = (u8)c * WORD_ONES;
+	const ulong *w;
+
+	for (; !word_aligned(s); ++s) {
+		if (*s == (char)c)
+			return (char *)s;
+		if (*s == '\0')
+			return NULL;
+	}
+	for (w = (const ulong *)s;
+	     !word_has_zero(*w) && !word_has_zero(*w ^ mask); w++)
+		;
+	s = (const char *)w;
+#endif
 	for(; *s != (char) c; ++s)
 		if (*s == '\0')
 			return NULL;
@@ -263,9 +317,20 @@ char * strrchr(const char * s, int c)
  */
 size_t strlen(const char * s)
 {
-	const char *sc;
+	const char *sc = s;
 
-	for (sc = s; *sc != '\0'; ++sc)
+#if CONFIG_IS_ENABLED(STRING_WORD_AT_A_TIME)
+	const ulong *w;
+
+	for (; !word_aligned(sc); ++sc) {
+		if (*sc == '\0')
+			return sc - s;
+	}
+	for (w = (const ulong *)sc; !word_has_zero(*w); w++)
+		;
+	sc = (const char *)w;
+#endif
+	for (; *sc != '\0'; ++sc)
 		/* nothing */;
 	return sc - s;
 }
@@ -561,7 +626,7 @@ void * memmove(void * dest,const void *src,size_t count)
 		return dest;
 	}
 #endif
-	if (dest <= src) {
+	if (dest <= src || dest >= src + count) {
 		memcpy(dest, src, count);
 	} else {
 		tmp = (char *) dest + count;
@@ -586,6 +651,24 @@ int memcmp(const void * cs,const void * ct,size_t count)
 	const unsigned char *su1, *su2;
 	int res = 0;
 
+#if CONFIG_IS_ENABLED(STRING_WORD_AT_A_TIME)
+	if (word_aligned((void *)((ulong)cs ^ (ulong)ct))) {
+		const ulong *a, *b;
+
+		for (su1 = cs, su2 = ct; count && !word_aligned(su1);
+		     ++su1, ++su2, count--) {
+			if ((res = *su1 - *su2) != 0)
+				return res;
+		}
+		for (a = (const ulong *)su1, b = (const ulong *)su2;
+		     count >= sizeof(ulong) && *a == *b;
+		     a++, b++, count -= sizeof(ulong))
+			;
+		/* The bytes below find the difference */
+		cs = a;
+		ct = b;
+	}
+#endif
 	for( su1 = cs, su2 = ct; 0 < count; ++su1, ++su2, count--)
 		if ((res = *su1 - *su2) != 0)
 			break;
@@ -654,6 +737,20 @@ char * strstr(const char * s1,const char * s2)
 void *memchr(const void *s, int c, size_t n)
 {
 	const unsigned char *p = s;
+#if CONFIG_IS_ENABLED(STRING_WORD_AT_A_TIME)
+	ulong mask = (u8)c * WORD_ONES;
+	const ulong *w;
+
+	for (; n && !word_aligned(p); p++, n--) {
+		if ((unsigned char)c == *p)
+			return (void *)p;
+	}
+	for (w = (const ulong *)p;
+	     n >= sizeof(ulong) && !word_has_zero(*w ^ mask);
+	     w++, n -= sizeof(ulong))
+		;
+	p = (const unsigned char *)w;
+#endif
 	while (n-- != 0) {
 		if ((unsigned char)c == *p++) {
 			return (void *)(p-1);
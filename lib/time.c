@@ -5,6 +5,7 @@
  */
 
 #include <common.h>
+#include <cyclic.h>
 #include <dm.h>
 #include <errno.h>
 #include <timer.h>
@@ -56,6 +57,14 @@ ulong timer_get_boot_us(void)
 extern unsigned long __weak timer_read_counter(void);
 #endif
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE)
+/* Timers which count faster than 1MHz can override this */
+__weak u64 timer_get_boot_ns(void)
+{
+	return (u64)timer_get_boot_us() * 1000;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(TIMER)
 ulong notrace get_tbclk(void)
 {
@@ -165,7 +174,8 @@ void udelay(unsigned long usec)
 
 	do {
 		WATCHDOG_RESET();
-		kv = usec > CONFIG_WD_PERIOD ? CONFIG_WD_PERIOD : usec;
+		/* Wake up in time for the next background task */
+		kv = min3(usec, (ulong)CONFIG_WD_PERIOD, cyclic_run());
 		__udelay (kv);
 		usec -= kv;
 	} while(usec);
@@ -421,3 +421,29 @@ u32 tpm2_pcr_setauthvalue(struct udevice *dev, const char *pw,
 
 	return tpm_sendrecv_command(dev, command_v2, NULL, NULL);
 }
+
+int tpm2_measure(u32 index, const uint8_t *digest)
+{
+	static bool started;
+	struct udevice *dev;
+	int ret;
+
+	ret = uclass_first_device_err(UCLASS_TPM, &dev);
+	if (ret)
+		return ret;
+
+	if (!started) {
+		/* The TPM may already be open, from the 'tpm2' command */
+		ret = tpm_init(dev);
+		if (ret && ret != -EBUSY)
+			return ret;
+		if (tpm2_startup(dev, TPM2_SU_CLEAR))
+			return -EIO;
+		started = true;
+	}
+
+	if (tpm2_pcr_extend(dev, index, digest))
+		return -EIO;
+
+	return 0;
+}
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sampling profiler
+ *
+ * A periodic interrupt records the interrupted PC and LR in a ring, so the
+ * code can be profiled without building it with -finstrument-functions.
+ * The samples are exported with 'trace sample dump' and turned into folded
+ * stacks by tools/proftool.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <trace.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static struct trace_sample *sample_ring;
+static uint sample_size;	/* number of samples in the ring */
+static ulong sample_total;	/* number of samples taken */
+static ulong sample_base;	/* address of the start of the code */
+static uint sample_period;	/* sampling period in us, 0 if stopped */
+
+void trace_sample_record(ulong pc, ulong lr)
+{
+	struct trace_sample *rec = &sample_ring[sample_total % sample_size];
+
+	rec->pc = pc - sample_base;
+	rec->lr = lr - sample_base;
+	sample_total++;
+}
+
+int trace_sample_start(uint period_us, uint count)
+{
+	int ret;
+
+	if (!period_us || !count)
+		return -EINVAL;
+	trace_sample_stop();
+
+	if (count != sample_size) {
+		free(sample_ring);
+		sample_ring = malloc(count * sizeof(*sample_ring));
+		if (!sample_ring) {
+			sample_size = 0;
+			return -ENOMEM;
+		}
+		sample_size = count;
+	}
+	sample_total = 0;
+	sample_base = gd->relocaddr;
+
+	ret = arch_sample_start(period_us);
+	if (ret)
+		return ret;
+	sample_period = period_us;
+
+	return 0;
+}
+
+void trace_sample_stop(void)
+{
+	if (!sample_period)
+		return;
+	arch_sample_stop();
+	sample_period = 0;
+}
+
+void trace_sample_print_stats(void)
+{
+	printf("%s, period %u us\n", sample_period ? "Running" : "Stopped",
+	       sample_period);
+	printf("%15lu samples taken\n", sample_total);
+	printf("%15lu samples kept\n", min(sample_total, (ulong)sample_size));
+}
+
+int trace_list_samples(void *buff, int buff_size, uint *needed)
+{
+	struct trace_output_hdr *output_hdr = NULL;
+	struct trace_sample *out;
+	void *end, *ptr = buff;
+	ulong first, i;
+	uint count;
+
+	trace_sample_stop();
+	end = buff ? buff + buff_size : NULL;
+
+	if (ptr + sizeof(struct trace_output_hdr) <= end) {
+		output_hdr = ptr;
+		output_hdr->type = TRACE_CHUNK_SAMPLES;
+	}
+	ptr += sizeof(struct trace_output_hdr);
+
+	first = sample_total > sample_size ? sample_total - sample_size : 0;
+	for (i = first, count = 0; i < sample_total; i++) {
+		if (ptr + sizeof(*out) <= end) {
+			out = ptr;
+			*out = sample_ring[i % sample_size];
+			count++;
+		}
+		ptr += sizeof(*out);
+	}
+
+	if (output_hdr)
+		output_hdr->rec_count = count;
+	*needed = ptr - buff;
+	if (ptr > end)
+		return -1;
+
+	return 0;
+}
@@ -12,24 +12,75 @@
 
 #ifndef ASMINF
 
-/* Allow machine dependent optimization for post-increment or pre-increment.
-   Based on testing to date,
-   Pre-increment preferred for:
-   - PowerPC G3 (Adler)
-   - MIPS R5000 (Randers-Pehrson)
-   Post-increment preferred for:
-   - none
-   No measurable difference:
-   - Pentium III (Anderson)
-   - M68060 (Nikl)
+/*
+   The bit accumulator is a whole machine word and is refilled with as many
+   bytes as fit, so that on 64-bit machines a length/distance pair is
+   decoded with a single refill.  Our builds use strict alignment, so the
+   input is still read a byte at a time, but the refill test is made once
+   per code instead of once per byte pair.
  */
-#ifdef POSTINC
-#  define OFF 0
-#  define PUP(a) *(a)++
-#else
-#  define OFF 1
-#  define PUP(a) *++(a)
-#endif
+#define HOLD_BITS (8 * sizeof(unsigned long))
+
+#define REFILL() \
+    do { \
+        while (bits <= HOLD_BITS - 8) { \
+            hold |= (unsigned long)(*in++) << bits; \
+            bits += 8; \
+        } \
+    } while (0)
+
+/* Matches at least this long are copied with memcpy() */
+#define COPY_MIN 16
+
+/* Copy len bytes from an area that does not overlap the output */
+local inline unsigned char FAR *copy_bytes(unsigned char FAR *out,
+                                           const unsigned char FAR *from,
+                                           unsigned len)
+{
+    if (len >= COPY_MIN) {
+        memcpy(out, from, len);
+        return out + len;
+    }
+    while (len > 2) {
+        *out++ = *from++;
+        *out++ = *from++;
+        *out++ = *from++;
+        len -= 3;
+    }
+    if (len) {
+        *out++ = *from++;
+        if (len > 1)
+            *out++ = *from++;
+    }
+    return out;
+}
+
+/*
+   Copy len bytes from dist bytes back in the output.  When they overlap,
+   each pass copies all the bytes written since the start of the match, so
+   the copies double in size instead of going a byte at a time.
+ */
+local inline unsigned char FAR *copy_match(unsigned char FAR *out,
+                                           unsigned dist, unsigned len)
+{
+    const unsigned char FAR *from = out - dist;
+    unsigned n;
+
+    if (dist >= len)
+        return copy_bytes(out, from, len);
+    if (dist == 1) {
+        memset(out, out[-1], len);
+        return out + len;
+    }
+    while (len) {
+        n = (unsigned)(out - from);
+        if (n > len)
+            n = len;
+        out = copy_bytes(out, from, n);
+        len -= n;
+    }
+    return out;
+}
 
 /*
    Decode literal, length, and distance codes and write out the resulting
@@ -42,8 +93,8 @@
    Entry assumptions:
 
         state->mode == LEN
-        strm->avail_in >= 6
-        strm->avail_out >= 258
+        strm->avail_in >= INFLATE_FAST_MIN_INPUT
+        strm->avail_out >= INFLATE_FAST_MIN_OUTPUT
         start >= strm->avail_out
         state->bits < 8
 
@@ -58,7 +109,8 @@
     - The maximum input bits used by a length/distance pair is 15 bits for the
       length code, 5 bits for the length extra, 15 bits for the distance code,
       and 13 bits for the distance extra.  This totals 48 bits, or six bytes.
-      Therefore if strm->avail_in >= 6, then there is enough input to avoid
+      The accumulator may hold up to a word more, read ahead, so if there
+      are 6 + sizeof(long) bytes of input then there is enough to avoid
       checking for available input while decoding.
 
     - The maximum bytes that a single length/distance pair can output is 258
@@ -97,19 +149,19 @@ void inflate_fast(z_streamp strm, unsigned start)
 
     /* copy state to local variables */
     state = (struct inflate_state FAR *)strm->state;
-    in = strm->next_in - OFF;
-    last = in + (strm->avail_in - 5);
-    if (in > last && strm->avail_in > 5) {
+    in = strm->next_in;
+    last = in + (strm->avail_in - INFLATE_FAST_MIN_INPUT);
+    if (in > last && strm->avail_in > INFLATE_FAST_MIN_INPUT) {
         /*
          * overflow detected, limit strm->avail_in to the
          * max. possible size and recalculate last
          */
 	strm->avail_in = 0xffffffff - (uintptr_t)in;
-        last = in + (strm->avail_in - 5);
+        last = in + (strm->avail_in - INFLATE_FAST_MIN_INPUT);
     }
-    out = strm->next_out - OFF;
+    out = strm->next_out;
     beg = out - (start - strm->avail_out);
-    end = out + (strm->avail_out - 257);
+    end = out + (strm->avail_out - (INFLATE_FAST_MIN_OUTPUT - 1));
 #ifdef INFLATE_STRICT
     dmax = state->dmax;
 #endif
@@ -127,12 +179,8 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* decode literals and length/distances until end-of-block or not enough
        input data or output space */
     do {
-        if (bits < 15) {
-            hold += (unsigned long)(PUP(in)) << bits;
-            bits += 8;
-            hold += (unsigned long)(PUP(in)) << bits;
-            bits += 8;
-        }
+        if (bits < 15)
+            REFILL();
         this = lcode[hold & lmask];
       dolen:
         op = (unsigned)(this.bits);
@@ -143,27 +191,21 @@ void inflate_fast(z_streamp strm, unsigned start)
             Tracevv((stderr, this.val >= 0x20 && this.val < 0x7f ?
                     "inflate:         literal '%c'\n" :
                     "inflate:         literal 0x%02x\n", this.val));
-            PUP(out) = (unsigned char)(this.val);
+            *out++ = (unsigned char)(this.val);
         }
         else if (op & 16) {                     /* length base */
             len = (unsigned)(this.val);
             op &= 15;                           /* number of extra bits */
             if (op) {
-                if (bits < op) {
-                    hold += (unsigned long)(PUP(in)) << bits;
-                    bits += 8;
-                }
+                if (bits < op)
+                    REFILL();
                 len += (unsigned)hold & ((1U << op) - 1);
                 hold >>= op;
                 bits -= op;
             }
             Tracevv((stderr, "inflate:         length %u\n", len));
-            if (bits < 15) {
-                hold += (unsigned long)(PUP(in)) << bits;
-                bits += 8;
-                hold += (unsigned long)(PUP(in)) << bits;
-                bits += 8;
-            }
+            if (bits < 15)
+                REFILL();
             this = dcode[hold & dmask];
           dodist:
             op = (unsigned)(this.bits);
@@ -173,14 +215,8 @@ void inflate_fast(z_streamp strm, unsigned start)
             if (op & 16) {                      /* distance base */
                 dist = (unsigned)(this.val);
                 op &= 15;                       /* number of extra bits */
-                if (bits < op) {
-                    hold += (unsigned long)(PUP(in)) << bits;
-                    bits += 8;
-                    if (bits < op) {
-                        hold += (unsigned long)(PUP(in)) << bits;
-                        bits += 8;
-                    }
-                }
+                if (bits < op)
+                    REFILL();
                 dist += (unsigned)hold & ((1U << op) - 1);
 #ifdef INFLATE_STRICT
                 if (dist > dmax) {
@@ -200,15 +236,13 @@ void inflate_fast(z_streamp strm, unsigned start)
                         state->mode = BAD;
                         break;
                     }
-                    from = window - OFF;
+                    from = window;
                     if (write == 0) {           /* very common case */
                         from += wsize - op;
                         if (op < len) {         /* some from window */
                             len -= op;
-                            do {
-                                PUP(out) = PUP(from);
-                            } while (--op);
-                            from = out - dist;  /* rest from output */
+                            out = copy_bytes(out, from, op);
+                            from = NULL;        /* rest from output */
                         }
                     }
                     else if (write < op) {      /* wrap around window */
@@ -216,17 +250,13 @@ void inflate_fast(z_streamp strm, unsigned start)
                         op -= write;
                         if (op < len) {         /* some from end of window */
                             len -= op;
-                            do {
-                                PUP(out) = PUP(from);
-                            } while (--op);
-                            from = window - OFF;
+                            out = copy_bytes(out, from, op);
+                            from = window;
                             if (write < len) {  /* some from start of window */
                                 op = write;
                                 len -= op;
-                                do {
-                                    PUP(out) = PUP(from);
-                                } while (--op);
-                                from = out - dist;      /* rest from output */
+                                out = copy_bytes(out, from, op);
+                                from = NULL;    /* rest from output */
                             }
                         }
                     }
@@ -234,66 +264,17 @@ void inflate_fast(z_streamp strm, unsigned start)
                         from += write - op;
                         if (op < len) {         /* some from window */
                             len -= op;
-                            do {
-                                PUP(out) = PUP(from);
-                            } while (--op);
-                            from = out - dist;  /* rest from output */
+                            out = copy_bytes(out, from, op);
+                            from = NULL;        /* rest from output */
                         }
                     }
-                    while (len > 2) {
-                        PUP(out) = PUP(from);
-                        PUP(out) = PUP(from);
-                        PUP(out) = PUP(from);
-                        len -= 3;
-                    }
-                    if (len) {
-                        PUP(out) = PUP(from);
-                        if (len > 1)
-                            PUP(out) = PUP(from);
-                    }
+                    if (from)
+                        out = copy_bytes(out, from, len);
+                    else
+                        out = copy_match(out, dist, len);
                 }
                 else {
-		    unsigned short *sout;
-		    unsigned long loops;
-
-                    from = out - dist;          /* copy direct from output */
-                    /* minimum length is three */
-		    /* Align out addr */
-		    if (!((long)(out - 1 + OFF) & 1)) {
-			PUP(out) = PUP(from);
-			len--;
-		    }
-		    sout = (unsigned short *)(out - OFF);
-		    if (dist > 2 ) {
-			unsigned short *sfrom;
-
-			sfrom = (unsigned short *)(from - OFF);
-			loops = len >> 1;
-			do
-			    PUP(sout) = get_unaligned(++sfrom);
-			while (--loops);
-			out = (unsigned char *)sout + OFF;
-			from = (unsigned char *)sfrom + OFF;
-		    } else { /* dist == 1 or dist == 2 */
-			unsigned short pat16;
-
-			pat16 = *(sout-2+2*OFF);
-			if (dist == 1)
-#if defined(__BIG_ENDIAN)
-			    pat16 = (pat16 & 0xff) | ((pat16 & 0xff ) << 8);
-#elif defined(__LITTLE_ENDIAN)
-			    pat16 = (pat16 & 0xff00) | ((pat16 & 0xff00 ) >> 8);
-#else
-#error __BIG_ENDIAN nor __LITTLE_ENDIAN is defined
-#endif
-			loops = len >> 1;
-			do
-			    PUP(sout) = pat16;
-			while (--loops);
-			out = (unsigned char *)sout + OFF;
-		    }
-		    if (len & 1)
-			PUP(out) = PUP(from);
+                    out = copy_match(out, dist, len);  /* from output */
                 }
             }
             else if ((op & 64) == 0) {          /* 2nd level distance code */
@@ -322,18 +303,17 @@ void inflate_fast(z_streamp strm, unsigned start)
         }
     } while (in < last && out < end);
 
-    /* return unused bytes (on entry, bits < 8, so in won't go too far back) */
+    /* return unused bytes, whole bytes read ahead into the accumulator */
     len = bits >> 3;
     in -= len;
     bits -= len << 3;
-    hold &= (1U << bits) - 1;
+    hold &= (1UL << bits) - 1;
 
     /* update state and return */
-    strm->next_in = in + OFF;
-    strm->next_out = out + OFF;
-    strm->avail_in = (unsigned)(in < last ? 5 + (last - in) : 5 - (in - last));
-    strm->avail_out = (unsigned)(out < end ?
-                                 257 + (end - out) : 257 - (out - end));
+    strm->next_in = in;
+    strm->next_out = out;
+    strm->avail_in = (unsigned)(INFLATE_FAST_MIN_INPUT + (last - in));
+    strm->avail_out = (unsigned)((INFLATE_FAST_MIN_OUTPUT - 1) + (end - out));
     state->hold = hold;
     state->bits = bits;
     return;
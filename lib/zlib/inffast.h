@@ -8,4 +8,8 @@
    subject to change. Applications should only use zlib.h.
  */
 
+/* Input and output inflate_fast() needs to decode without further checks */
+#define INFLATE_FAST_MIN_INPUT (6 + sizeof(unsigned long))
+#define INFLATE_FAST_MIN_OUTPUT 258
+
 void inflate_fast OF((z_streamp strm, unsigned start));
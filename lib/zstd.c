@@ -0,0 +1,1150 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Zstandard decompression, following RFC 8878
+ *
+ * Images are decompressed in one go from one buffer to another, so the
+ * whole output of a frame is its window and nothing is kept between
+ * calls. Dictionaries are not supported and the optional content checksum
+ * is skipped, not checked: FIT images carry their own hashes.
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <malloc.h>
+#include <asm/unaligned.h>
+#include <linux/bitops.h>
+#include <u-boot/zstd.h>
+
+#define ZSTD_MAGIC		0xfd2fb528
+#define ZSTD_SKIP_MAGIC		0x184d2a50
+#define ZSTD_SKIP_MASK		0xfffffff0
+#define ZSTD_BLOCK_MAX		(128 << 10)
+
+#define ZSTD_BLOCK_RAW		0
+#define ZSTD_BLOCK_RLE		1
+#define ZSTD_BLOCK_COMPRESSED	2
+
+#define ZSTD_LIT_RAW		0
+#define ZSTD_LIT_RLE		1
+#define ZSTD_LIT_COMPRESSED	2
+#define ZSTD_LIT_TREELESS	3
+
+#define ZSTD_SEQ_PREDEFINED	0
+#define ZSTD_SEQ_RLE		1
+#define ZSTD_SEQ_COMPRESSED	2
+#define ZSTD_SEQ_REPEAT		3
+
+#define FSE_MIN_LOG		5
+#define HUF_MAX_LOG		11
+#define HUF_MAX_SYMS		256
+#define HUF_WEIGHT_LOG		6
+
+#define LL_MAX_SYM		35
+#define LL_MAX_LOG		9
+#define LL_DEFAULT_LOG		6
+#define ML_MAX_SYM		52
+#define ML_MAX_LOG		9
+#define ML_DEFAULT_LOG		6
+#define OF_MAX_SYM		31
+#define OF_MAX_LOG		8
+#define OF_DEFAULT_LOG		5
+
+struct fse_entry {
+	u8 symbol;
+	u8 bits;
+	u16 base;
+};
+
+struct fse_table {
+	struct fse_entry *e;
+	int log;
+	bool valid;
+};
+
+struct huf_entry {
+	u8 symbol;
+	u8 bits;
+};
+
+struct zstd_ctx {
+	u8 *base;		/* start of the frame's output */
+	u64 fcs;		/* frame content size, if @has_fcs */
+	bool has_fcs;
+	bool checksum;		/* the frame ends in a content checksum */
+	u32 rep[3];		/* repeated offsets */
+	struct fse_table ll, of, ml;
+	int huf_log;		/* 0 until a Huffman table is read */
+	struct fse_entry ll_e[1 << LL_MAX_LOG];
+	struct fse_entry of_e[1 << OF_MAX_LOG];
+	struct fse_entry ml_e[1 << ML_MAX_LOG];
+	struct huf_entry huf[1 << HUF_MAX_LOG];
+	u8 lit[ZSTD_BLOCK_MAX];
+};
+
+/*
+ * The bit streams of literals and sequences are read backwards, from the
+ * last bit written to the first, through a 64-bit window of the input.
+ * consumed counts the bits used from the top of that window.
+ */
+struct zstd_bits {
+	const u8 *start;
+	const u8 *ptr;
+	u64 bits;
+	unsigned int consumed;
+};
+
+static const s16 ll_default[LL_MAX_SYM + 1] = {
+	4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+	-1, -1, -1, -1
+};
+
+static const s16 ml_default[ML_MAX_SYM + 1] = {
+	1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+	-1, -1, -1, -1, -1
+};
+
+static const s16 of_default[OF_MAX_SYM + 1] = {
+	1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1, 0, 0, 0
+};
+
+static const u32 ll_base[LL_MAX_SYM + 1] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048,
+	4096, 8192, 16384, 32768, 65536
+};
+
+static const u8 ll_bits[LL_MAX_SYM + 1] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+	13, 14, 15, 16
+};
+
+static const u32 ml_base[ML_MAX_SYM + 1] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+	19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+	35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027,
+	2051, 4099, 8195, 16387, 32771, 65539
+};
+
+static const u8 ml_bits[ML_MAX_SYM + 1] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+	12, 13, 14, 15, 16
+};
+
+static int zb_init(struct zstd_bits *b, const u8 *src, size_t len)
+{
+	size_t i;
+	u8 last;
+
+	if (!len || !src[len - 1])
+		return -EINVAL;
+	last = src[len - 1];
+
+	b->start = src;
+	if (len >= sizeof(b->bits)) {
+		b->ptr = src + len - sizeof(b->bits);
+		b->bits = get_unaligned_le64(b->ptr);
+		b->consumed = 0;
+	} else {
+		b->ptr = src;
+		b->bits = 0;
+		for (i = 0; i < len; i++)
+			b->bits |= (u64)src[i] << (8 * i);
+		b->consumed = (sizeof(b->bits) - len) * 8;
+	}
+	/* The highest bit set in the last byte marks the end of the data */
+	b->consumed += 9 - fls(last);
+
+	return 0;
+}
+
+static inline u32 zb_peek(struct zstd_bits *b, unsigned int n)
+{
+	if (b->consumed >= 64)
+		return 0;
+
+	/* two shifts, so that n = 0 is fine */
+	return (b->bits << b->consumed) >> 1 >> (63 - n);
+}
+
+static inline u32 zb_read(struct zstd_bits *b, unsigned int n)
+{
+	u32 val = zb_peek(b, n);
+
+	b->consumed += n;
+
+	return val;
+}
+
+/* Refill the window, leaving at least 57 bits unless at the start */
+static inline void zb_reload(struct zstd_bits *b)
+{
+	size_t back = b->consumed >> 3;
+
+	if (b->consumed > 64)
+		return;
+	if (back > b->ptr - b->start)
+		back = b->ptr - b->start;
+	if (!back)
+		return;
+	b->ptr -= back;
+	b->consumed -= back * 8;
+	b->bits = get_unaligned_le64(b->ptr);
+}
+
+static inline bool zb_overflow(struct zstd_bits *b)
+{
+	return b->consumed > 64;
+}
+
+static inline bool zb_finished(struct zstd_bits *b)
+{
+	return b->ptr == b->start && b->consumed == 64;
+}
+
+/* Table descriptions are read forwards, low bits first */
+static u32 fwd_bits(const u8 *src, size_t len, size_t pos, unsigned int n)
+{
+	size_t byte = pos >> 3;
+	u32 val = 0;
+	int i;
+
+	for (i = 0; i < 4 && byte + i < len; i++)
+		val |= (u32)src[byte + i] << (8 * i);
+
+	return (val >> (pos & 7)) & ((1 << n) - 1);
+}
+
+/*
+ * Read the normalised counts of an FSE table. Return the bytes used, -1
+ * counts standing for "less than one".
+ */
+static int fse_read_counts(const u8 *src, size_t len, s16 *norm, int max_sym,
+			   int max_log, int *nsym, int *logp)
+{
+	int remaining, threshold, nbits, log, sym = 0;
+	bool prev0 = false;
+	size_t pos;
+	int count, max, i;
+	u32 val;
+
+	if (!len)
+		return -EINVAL;
+	log = (src[0] & 0xf) + FSE_MIN_LOG;
+	if (log > max_log)
+		return -EINVAL;
+
+	pos = 4;
+	remaining = (1 << log) + 1;
+	threshold = 1 << log;
+	nbits = log + 1;
+	while (remaining > 1) {
+		if (prev0) {
+			/* Runs of zero counts are coded in 2-bit repeats */
+			do {
+				val = fwd_bits(src, len, pos, 2);
+				pos += 2;
+				if (sym + val > max_sym + 1)
+					return -EINVAL;
+				for (i = 0; i < val; i++)
+					norm[sym++] = 0;
+			} while (val == 3);
+			prev0 = false;
+		}
+		if (sym > max_sym || pos > len * 8)
+			return -EINVAL;
+
+		max = (2 * threshold - 1) - remaining;
+		val = fwd_bits(src, len, pos, nbits);
+		if ((val & (threshold - 1)) < max) {
+			count = val & (threshold - 1);
+			pos += nbits - 1;
+		} else {
+			count = val & (2 * threshold - 1);
+			if (count >= threshold)
+				count -= max;
+			pos += nbits;
+		}
+		count--;
+		remaining -= count < 0 ? -count : count;
+		norm[sym++] = count;
+		prev0 = !count;
+		while (remaining < threshold) {
+			nbits--;
+			threshold >>= 1;
+		}
+	}
+	if (remaining != 1 || pos > len * 8)
+		return -EINVAL;
+
+	*nsym = sym;
+	*logp = log;
+
+	return (pos + 7) >> 3;
+}
+
+static int fse_build(struct fse_entry *t, const s16 *norm, int nsym, int log)
+{
+	u16 next[ML_MAX_SYM + 1];
+	int size = 1 << log;
+	int high = size - 1;
+	int step = (size >> 1) + (size >> 3) + 3;
+	int s, i, u, pos = 0;
+
+	/* "Less than one" symbols take the last cells, one each */
+	for (s = 0; s < nsym; s++) {
+		if (norm[s] == -1) {
+			t[high--].symbol = s;
+			next[s] = 1;
+		} else {
+			next[s] = norm[s];
+		}
+	}
+
+	for (s = 0; s < nsym; s++) {
+		for (i = 0; i < norm[s]; i++) {
+			t[pos].symbol = s;
+			do
+				pos = (pos + step) & (size - 1);
+			while (pos > high);
+		}
+	}
+	if (pos)
+		return -EINVAL;
+
+	for (u = 0; u < size; u++) {
+		int n = next[t[u].symbol]++;
+		int bits = log + 1 - fls(n);
+
+		t[u].bits = bits;
+		t[u].base = (n << bits) - size;
+	}
+
+	return 0;
+}
+
+static inline u8 fse_decode(const struct fse_entry *t, u32 *state,
+			    struct zstd_bits *b)
+{
+	const struct fse_entry *e = &t[*state];
+
+	*state = e->base + zb_read(b, e->bits);
+
+	return e->symbol;
+}
+
+/* Huffman weights compressed with FSE, two interleaved states */
+static int huf_fse_weights(const u8 *src, size_t len, u8 *w)
+{
+	struct fse_entry t[1 << HUF_WEIGHT_LOG];
+	struct zstd_bits b;
+	s16 norm[HUF_MAX_LOG + 2];
+	int used, nsym, log, n = 0;
+	u32 s1, s2;
+
+	used = fse_read_counts(src, len, norm, HUF_MAX_LOG + 1,
+			       HUF_WEIGHT_LOG, &nsym, &log);
+	if (used < 0)
+		return used;
+	if (fse_build(t, norm, nsym, log) ||
+	    zb_init(&b, src + used, len - used))
+		return -EINVAL;
+
+	s1 = zb_read(&b, log);
+	s2 = zb_read(&b, log);
+	zb_reload(&b);
+	for (;;) {
+		if (n > HUF_MAX_SYMS - 3)
+			return -EINVAL;
+		w[n++] = fse_decode(t, &s1, &b);
+		zb_reload(&b);
+		if (zb_overflow(&b)) {
+			w[n++] = t[s2].symbol;
+			break;
+		}
+		w[n++] = fse_decode(t, &s2, &b);
+		zb_reload(&b);
+		if (zb_overflow(&b)) {
+			w[n++] = t[s1].symbol;
+			break;
+		}
+	}
+
+	return n;
+}
+
+/* Read a Huffman tree description and build its table, return bytes used */
+static int huf_read_table(struct zstd_ctx *z, const u8 *src, size_t len)
+{
+	u32 rank[HUF_MAX_LOG + 2] = { 0 };
+	u8 w[HUF_MAX_SYMS];
+	u32 total = 0, rest;
+	int hdr, used, n, i, s, log;
+
+	if (!len)
+		return -EINVAL;
+	hdr = src[0];
+	if (hdr >= 128) {
+		/* 4-bit weights, two per byte */
+		n = hdr - 127;
+		used = 1 + (n + 1) / 2;
+		if (used > len)
+			return -EINVAL;
+		for (i = 0; i < n; i++)
+			w[i] = i & 1 ? src[1 + i / 2] & 0xf : src[1 + i / 2] >> 4;
+	} else {
+		used = 1 + hdr;
+		if (used > len)
+			return -EINVAL;
+		n = huf_fse_weights(src + 1, hdr, w);
+		if (n < 0)
+			return n;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (w[i] > HUF_MAX_LOG)
+			return -EINVAL;
+		if (w[i])
+			total += 1 << (w[i] - 1);
+	}
+	if (!total)
+		return -EINVAL;
+
+	/* The last weight is implied: it fills up to a power of two */
+	log = fls(total);
+	rest = (1 << log) - total;
+	if (log > HUF_MAX_LOG || n >= HUF_MAX_SYMS || (rest & (rest - 1)))
+		return -EINVAL;
+	w[n++] = fls(rest);
+
+	/* Longer codes, i.e. smaller weights, come first */
+	for (i = 0; i < n; i++)
+		rank[w[i]]++;
+	for (i = 1, total = 0; i <= log; i++) {
+		u32 cells = rank[i] << (i - 1);
+
+		rank[i] = total;
+		total += cells;
+	}
+	for (s = 0; s < n; s++) {
+		u32 cells = w[s] ? 1 << (w[s] - 1) : 0;
+
+		for (i = 0; i < cells; i++) {
+			z->huf[rank[w[s]] + i].symbol = s;
+			z->huf[rank[w[s]] + i].bits = log + 1 - w[s];
+		}
+		rank[w[s]] += cells;
+	}
+	z->huf_log = log;
+
+	return used;
+}
+
+static int huf_decode_stream(struct zstd_ctx *z, const u8 *src, size_t len,
+			     u8 *dst, size_t n)
+{
+	const struct huf_entry *e;
+	struct zstd_bits b;
+	u8 *end = dst + n;
+	int log = z->huf_log;
+
+	if (zb_init(&b, src, len))
+		return -EINVAL;
+
+	/* Four symbols of at most 11 bits between refills */
+	while (end - dst >= 4) {
+		e = &z->huf[zb_peek(&b, log)];
+		*dst++ = e->symbol;
+		b.consumed += e->bits;
+		e = &z->huf[zb_peek(&b, log)];
+		*dst++ = e->symbol;
+		b.consumed += e->bits;
+		e = &z->huf[zb_peek(&b, log)];
+		*dst++ = e->symbol;
+		b.consumed += e->bits;
+		e = &z->huf[zb_peek(&b, log)];
+		*dst++ = e->symbol;
+		b.consumed += e->bits;
+		zb_reload(&b);
+	}
+	while (dst < end) {
+		e = &z->huf[zb_peek(&b, log)];
+		*dst++ = e->symbol;
+		b.consumed += e->bits;
+		zb_reload(&b);
+	}
+
+	return zb_finished(&b) ? 0 : -EINVAL;
+}
+
+/* Decode the literals section, return the bytes used */
+static int zstd_literals(struct zstd_ctx *z, const u8 *src, size_t len,
+			 const u8 **lit, size_t *litlen)
+{
+	int type = src[0] & 3, format = (src[0] >> 2) & 3;
+	size_t hsize, size, csize, total, seg, s[4];
+	const u8 *p;
+	int i, used;
+
+	if (type == ZSTD_LIT_RAW || type == ZSTD_LIT_RLE) {
+		switch (format) {
+		case 1:
+			hsize = 2;
+			break;
+		case 3:
+			hsize = 3;
+			break;
+		default:
+			hsize = 1;
+			break;
+		}
+		if (hsize > len)
+			return -EINVAL;
+		if (hsize == 1)
+			size = src[0] >> 3;
+		else if (hsize == 2)
+			size = (src[0] >> 4) | (src[1] << 4);
+		else
+			size = (src[0] >> 4) | (src[1] << 4) | (src[2] << 12);
+		if (size > ZSTD_BLOCK_MAX)
+			return -EINVAL;
+
+		if (type == ZSTD_LIT_RAW) {
+			/* used in place */
+			if (hsize + size > len)
+				return -EINVAL;
+			*lit = src + hsize;
+			*litlen = size;
+			return hsize + size;
+		}
+		if (hsize + 1 > len)
+			return -EINVAL;
+		memset(z->lit, src[hsize], size);
+		*lit = z->lit;
+		*litlen = size;
+		return hsize + 1;
+	}
+
+	hsize = format < 2 ? 3 : format + 2;
+	if (hsize > len)
+		return -EINVAL;
+	switch (hsize) {
+	case 3: {
+		u32 v = src[0] | (src[1] << 8) | (src[2] << 16);
+
+		size = (v >> 4) & 0x3ff;
+		csize = v >> 14;
+		break;
+	}
+	case 4: {
+		u32 v = get_unaligned_le32(src);
+
+		size = (v >> 4) & 0x3fff;
+		csize = v >> 18;
+		break;
+	}
+	default: {
+		u32 v = get_unaligned_le32(src);
+
+		size = (v >> 4) & 0x3ffff;
+		csize = (v >> 22) | (src[4] << 10);
+		break;
+	}
+	}
+	if (size > ZSTD_BLOCK_MAX || hsize + csize > len)
+		return -EINVAL;
+	total = hsize + csize;
+
+	p = src + hsize;
+	if (type == ZSTD_LIT_COMPRESSED) {
+		used = huf_read_table(z, p, csize);
+		if (used < 0)
+			return used;
+		p += used;
+		csize -= used;
+	} else if (!z->huf_log) {
+		return -EINVAL;
+	}
+
+	if (!format) {
+		if (huf_decode_stream(z, p, csize, z->lit, size))
+			return -EINVAL;
+	} else {
+		/* Four streams behind a jump table of the first three sizes */
+		if (csize < 6)
+			return -EINVAL;
+		s[0] = get_unaligned_le16(p);
+		s[1] = get_unaligned_le16(p + 2);
+		s[2] = get_unaligned_le16(p + 4);
+		if (s[0] + s[1] + s[2] > csize - 6)
+			return -EINVAL;
+		s[3] = csize - 6 - s[0] - s[1] - s[2];
+		seg = (size + 3) / 4;
+		if (size < 3 * seg)
+			return -EINVAL;
+		p += 6;
+		for (i = 0; i < 4; i++) {
+			if (huf_decode_stream(z, p, s[i], z->lit + i * seg,
+					      i < 3 ? seg : size - 3 * seg))
+				return -EINVAL;
+			p += s[i];
+		}
+	}
+	*lit = z->lit;
+	*litlen = size;
+
+	return total;
+}
+
+/* Set up the table for one of the sequence codes, return the bytes used */
+static int zstd_seq_table(struct fse_table *t, int mode, const u8 *src,
+			  size_t len, const s16 *def, int max_sym, int max_log,
+			  int def_log)
+{
+	s16 norm[ML_MAX_SYM + 1];
+	int used = 0, nsym, log;
+
+	switch (mode) {
+	case ZSTD_SEQ_PREDEFINED:
+		if (fse_build(t->e, def, max_sym + 1, def_log))
+			return -EINVAL;
+		t->log = def_log;
+		break;
+	case ZSTD_SEQ_RLE:
+		if (!len || src[0] > max_sym)
+			return -EINVAL;
+		t->e[0].symbol = src[0];
+		t->e[0].bits = 0;
+		t->e[0].base = 0;
+		t->log = 0;
+		used = 1;
+		break;
+	case ZSTD_SEQ_COMPRESSED:
+		used = fse_read_counts(src, len, norm, max_sym, max_log, &nsym,
+				       &log);
+		if (used < 0 || fse_build(t->e, norm, nsym, log))
+			return -EINVAL;
+		t->log = log;
+		break;
+	default:
+		if (!t->valid)
+			return -EINVAL;
+		break;
+	}
+	t->valid = true;
+
+	return used;
+}
+
+static int zstd_sequences(struct zstd_ctx *z, const u8 *src, size_t len,
+			  int nseq, const u8 *lit, size_t litlen, u8 **opp,
+			  u8 *oend)
+{
+	const u8 *litend = lit + litlen;
+	struct zstd_bits b;
+	u32 ll_state, of_state, ml_state;
+	u8 *op = *opp;
+
+	if (zb_init(&b, src, len))
+		return -EINVAL;
+	ll_state = zb_read(&b, z->ll.log);
+	of_state = zb_read(&b, z->of.log);
+	ml_state = zb_read(&b, z->ml.log);
+	zb_reload(&b);
+
+	while (nseq--) {
+		u8 llc = z->ll.e[ll_state].symbol;
+		u8 ofc = z->of.e[of_state].symbol;
+		u8 mlc = z->ml.e[ml_state].symbol;
+		u32 ll, ml, off, idx;
+		const u8 *match;
+		size_t n;
+
+		off = (1U << ofc) + zb_read(&b, ofc);
+		zb_reload(&b);
+		ml = ml_base[mlc] + zb_read(&b, ml_bits[mlc]);
+		ll = ll_base[llc] + zb_read(&b, ll_bits[llc]);
+		zb_reload(&b);
+
+		if (off > 3) {
+			off -= 3;
+			z->rep[2] = z->rep[1];
+			z->rep[1] = z->rep[0];
+			z->rep[0] = off;
+		} else {
+			/* Repeated offsets are shifted by one after no literal */
+			idx = off - 1 + !ll;
+			if (idx) {
+				off = idx == 3 ? z->rep[0] - 1 : z->rep[idx];
+				if (idx != 1)
+					z->rep[2] = z->rep[1];
+				z->rep[1] = z->rep[0];
+				z->rep[0] = off;
+			} else {
+				off = z->rep[0];
+			}
+		}
+
+		if (nseq) {
+			fse_decode(z->ll.e, &ll_state, &b);
+			fse_decode(z->ml.e, &ml_state, &b);
+			fse_decode(z->of.e, &of_state, &b);
+			zb_reload(&b);
+		}
+
+		if (ll > litend - lit || ll + ml > oend - op)
+			return -ENOSPC;
+		memcpy(op, lit, ll);
+		op += ll;
+		lit += ll;
+
+		if (!off || off > op - z->base)
+			return -EINVAL;
+		/* The match may overlap what it writes, copy what is there */
+		match = op - off;
+		while (ml) {
+			n = min_t(size_t, ml, op - match);
+			memcpy(op, match, n);
+			op += n;
+			ml -= n;
+		}
+	}
+	if (!zb_finished(&b))
+		return -EINVAL;
+
+	if (litend - lit > oend - op)
+		return -ENOSPC;
+	memcpy(op, lit, litend - lit);
+	*opp = op + (litend - lit);
+
+	return 0;
+}
+
+static int zstd_block(struct zstd_ctx *z, const u8 *src, size_t len, u8 **opp,
+		      u8 *oend)
+{
+	const u8 *ip = src, *iend = src + len;
+	const u8 *lit;
+	size_t litlen;
+	int nseq, modes, ret;
+
+	if (!len)
+		return -EINVAL;
+	ret = zstd_literals(z, ip, len, &lit, &litlen);
+	if (ret < 0)
+		return ret;
+	ip += ret;
+
+	if (ip >= iend)
+		return -EINVAL;
+	nseq = *ip++;
+	if (nseq == 255) {
+		if (iend - ip < 2)
+			return -EINVAL;
+		nseq = ip[0] + (ip[1] << 8) + 0x7f00;
+		ip += 2;
+	} else if (nseq >= 128) {
+		if (ip >= iend)
+			return -EINVAL;
+		nseq = ((nseq - 128) << 8) + *ip++;
+	}
+
+	if (!nseq) {
+		if (litlen > oend - *opp)
+			return -ENOSPC;
+		memcpy(*opp, lit, litlen);
+		*opp += litlen;
+		return 0;
+	}
+
+	if (ip >= iend)
+		return -EINVAL;
+	modes = *ip++;
+	if (modes & 3)
+		return -EINVAL;
+
+	ret = zstd_seq_table(&z->ll, modes >> 6, ip, iend - ip, ll_default,
+			     LL_MAX_SYM, LL_MAX_LOG, LL_DEFAULT_LOG);
+	if (ret < 0)
+		return ret;
+	ip += ret;
+	ret = zstd_seq_table(&z->of, (modes >> 4) & 3, ip, iend - ip,
+			     of_default, OF_MAX_SYM, OF_MAX_LOG, OF_DEFAULT_LOG);
+	if (ret < 0)
+		return ret;
+	ip += ret;
+	ret = zstd_seq_table(&z->ml, (modes >> 2) & 3, ip, iend - ip,
+			     ml_default, ML_MAX_SYM, ML_MAX_LOG, ML_DEFAULT_LOG);
+	if (ret < 0)
+		return ret;
+	ip += ret;
+
+	return zstd_sequences(z, ip, iend - ip, nseq, lit, litlen, opp, oend);
+}
+
+static const u8 did_size[4] = { 0, 1, 2, 4 };
+static const u8 fcs_size[4] = { 0, 2, 4, 8 };
+
+/* Length of a frame header, from its first byte (after the magic number) */
+static int zstd_frame_header_len(int fhd)
+{
+	int n = fcs_size[fhd >> 6];
+
+	if (!n && (fhd & 0x20))
+		n = 1;
+
+	return 1 + !(fhd & 0x20) + did_size[fhd & 3] + n;
+}
+
+/*
+ * Parse the frame header at @ip, after the magic number, and start a frame
+ * whose output goes to @op. Returns the length of the header, -ve on error.
+ */
+static int zstd_frame_begin(struct zstd_ctx *z, const u8 *ip, size_t len,
+			    u8 *op, u8 *oend)
+{
+	const u8 *start = ip;
+	u64 fcs = 0, did = 0;
+	int fhd, n, i;
+
+	if (!len)
+		return -EINVAL;
+	fhd = *ip;
+	if (fhd & 0x08)
+		return -EINVAL;
+	if (zstd_frame_header_len(fhd) > len)
+		return -EINVAL;
+	ip++;
+	/* The window size is implied by our output buffer */
+	if (!(fhd & 0x20))
+		ip++;
+
+	n = did_size[fhd & 3];
+	for (i = 0; i < n; i++)
+		did |= (u64)ip[i] << (8 * i);
+	ip += n;
+	if (did) {
+		printf("zstd: dictionaries are not supported\n");
+		return -EOPNOTSUPP;
+	}
+
+	n = fcs_size[fhd >> 6];
+	if (!n && (fhd & 0x20))
+		n = 1;
+	for (i = 0; i < n; i++)
+		fcs |= (u64)ip[i] << (8 * i);
+	if (n == 2)
+		fcs += 256;
+	ip += n;
+	if (n && fcs > oend - op)
+		return -ENOSPC;
+
+	z->base = op;
+	z->fcs = fcs;
+	z->has_fcs = n;
+	z->checksum = fhd & 0x04;
+	z->rep[0] = 1;
+	z->rep[1] = 4;
+	z->rep[2] = 8;
+	z->huf_log = 0;
+	z->ll.valid = false;
+	z->of.valid = false;
+	z->ml.valid = false;
+
+	return ip - start;
+}
+
+/* Number of bytes following a block header @hdr */
+static u32 zstd_block_len(u32 hdr)
+{
+	return ((hdr >> 1) & 3) == ZSTD_BLOCK_RLE ? 1 : hdr >> 3;
+}
+
+/*
+ * Decode the block with header @hdr whose contents (zstd_block_len(hdr)
+ * bytes) are at @ip
+ */
+static int zstd_frame_block(struct zstd_ctx *z, u32 hdr, const u8 *ip,
+			    u8 **opp, u8 *oend)
+{
+	u32 size = hdr >> 3;
+
+	switch ((hdr >> 1) & 3) {
+	case ZSTD_BLOCK_RAW:
+		if (size > oend - *opp)
+			return -ENOSPC;
+		memcpy(*opp, ip, size);
+		*opp += size;
+		return 0;
+	case ZSTD_BLOCK_RLE:
+		if (size > oend - *opp)
+			return -ENOSPC;
+		memset(*opp, *ip, size);
+		*opp += size;
+		return 0;
+	case ZSTD_BLOCK_COMPRESSED:
+		if (size > ZSTD_BLOCK_MAX)
+			return -EINVAL;
+		return zstd_block(z, ip, size, opp, oend);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int zstd_frame(struct zstd_ctx *z, const u8 **ipp, const u8 *iend,
+		      u8 **opp, u8 *oend)
+{
+	const u8 *ip = *ipp + 4;
+	u32 hdr;
+	int ret;
+
+	ret = zstd_frame_begin(z, ip, iend - ip, *opp, oend);
+	if (ret < 0)
+		return ret;
+	ip += ret;
+
+	do {
+		if (iend - ip < 3)
+			return -EINVAL;
+		hdr = ip[0] | (ip[1] << 8) | (ip[2] << 16);
+		ip += 3;
+		if (zstd_block_len(hdr) > iend - ip)
+			return -EINVAL;
+		ret = zstd_frame_block(z, hdr, ip, opp, oend);
+		if (ret)
+			return ret;
+		ip += zstd_block_len(hdr);
+	} while (!(hdr & 1));
+
+	if (z->checksum) {
+		if (iend - ip < 4)
+			return -EINVAL;
+		ip += 4;
+	}
+	if (z->has_fcs && *opp - z->base != z->fcs)
+		return -EINVAL;
+	*ipp = ip;
+
+	return 0;
+}
+
+int zstd_decompress(const void *src, size_t srclen, void *dst, size_t *dstlen)
+{
+	const u8 *ip = src, *iend = ip + srclen;
+	u8 *op = dst, *oend = op + *dstlen;
+	struct zstd_ctx *z;
+	u32 magic;
+	int ret = 0;
+
+	z = malloc(sizeof(*z));
+	if (!z)
+		return -ENOMEM;
+	z->ll.e = z->ll_e;
+	z->of.e = z->of_e;
+	z->ml.e = z->ml_e;
+
+	/* Any number of frames, skippable ones in between */
+	while (!ret && iend - ip >= 4) {
+		magic = get_unaligned_le32(ip);
+		if ((magic & ZSTD_SKIP_MASK) == ZSTD_SKIP_MAGIC) {
+			if (iend - ip < 8 ||
+			    get_unaligned_le32(ip + 4) > iend - ip - 8)
+				ret = -EINVAL;
+			else
+				ip += 8 + get_unaligned_le32(ip + 4);
+		} else if (magic == ZSTD_MAGIC) {
+			ret = zstd_frame(z, &ip, iend, &op, oend);
+		} else {
+			ret = -EINVAL;
+		}
+	}
+	if (!ret && ip != iend)
+		ret = -EINVAL;
+	free(z);
+
+	/* A full buffer tells the caller the output did not fit */
+	*dstlen = ret == -ENOSPC ? oend - (u8 *)dst : op - (u8 *)dst;
+
+	return ret;
+}
+
+enum zstd_stream_state {
+	ZS_MAGIC,		/* magic number of the next frame */
+	ZS_SKIP_SIZE,		/* size of a skippable frame */
+	ZS_SKIP,		/* contents of a skippable frame */
+	ZS_FHD,			/* first byte of a frame header */
+	ZS_FRAME_HDR,		/* rest of the frame header */
+	ZS_BLOCK_HDR,
+	ZS_BLOCK,
+	ZS_CHECKSUM,
+};
+
+/*
+ * The input is gathered a unit at a time (a header or a whole block) in
+ * @buf, unless a unit is all in one piece of input. The output of a frame
+ * is contiguous, so it still serves as the window.
+ */
+struct zstd_stream {
+	struct zstd_ctx z;
+	u8 *dst;
+	u8 *op;
+	u8 *oend;
+	enum zstd_stream_state state;
+	u32 need;		/* length of the current unit */
+	u32 have;		/* bytes of it in @buf */
+	u32 skip;		/* bytes left in a skippable frame */
+	u32 hdr;		/* header of the current block */
+	int frames;		/* number of frames decoded */
+	u8 buf[ZSTD_BLOCK_MAX];
+};
+
+struct zstd_stream *zstd_stream_start(void *dst, size_t dstlen)
+{
+	struct zstd_stream *zs;
+
+	zs = malloc(sizeof(*zs));
+	if (!zs)
+		return NULL;
+	zs->z.ll.e = zs->z.ll_e;
+	zs->z.of.e = zs->z.of_e;
+	zs->z.ml.e = zs->z.ml_e;
+	zs->dst = dst;
+	zs->op = dst;
+	zs->oend = dst + dstlen;
+	zs->state = ZS_MAGIC;
+	zs->need = 4;
+	zs->have = 0;
+	zs->frames = 0;
+
+	return zs;
+}
+
+/* Handle a complete unit at @p, setting up the next one */
+static int zstd_stream_unit(struct zstd_stream *zs, const u8 *p)
+{
+	u32 magic;
+	int ret;
+
+	switch (zs->state) {
+	case ZS_MAGIC:
+		magic = get_unaligned_le32(p);
+		if ((magic & ZSTD_SKIP_MASK) == ZSTD_SKIP_MAGIC) {
+			zs->state = ZS_SKIP_SIZE;
+			zs->need = 4;
+		} else if (magic == ZSTD_MAGIC) {
+			zs->state = ZS_FHD;
+			zs->need = 1;
+		} else {
+			return -EINVAL;
+		}
+		return 0;
+	case ZS_SKIP_SIZE:
+		zs->skip = get_unaligned_le32(p);
+		zs->state = zs->skip ? ZS_SKIP : ZS_MAGIC;
+		zs->need = 4;
+		return 0;
+	case ZS_FHD:
+		/* The whole header is parsed from @buf */
+		zs->buf[0] = *p;
+		zs->have = 1;
+		zs->state = ZS_FRAME_HDR;
+		zs->need = zstd_frame_header_len(*p);
+		return 0;
+	case ZS_FRAME_HDR:
+		ret = zstd_frame_begin(&zs->z, zs->buf, zs->need, zs->op,
+				       zs->oend);
+		if (ret < 0)
+			return ret;
+		zs->state = ZS_BLOCK_HDR;
+		zs->need = 3;
+		return 0;
+	case ZS_BLOCK_HDR:
+		zs->hdr = p[0] | (p[1] << 8) | (p[2] << 16);
+		zs->state = ZS_BLOCK;
+		zs->need = zstd_block_len(zs->hdr);
+		if (zs->need > ZSTD_BLOCK_MAX)
+			return -EINVAL;
+		return 0;
+	case ZS_BLOCK:
+		ret = zstd_frame_block(&zs->z, zs->hdr, p, &zs->op, zs->oend);
+		if (ret)
+			return ret;
+		if (!(zs->hdr & 1)) {
+			zs->state = ZS_BLOCK_HDR;
+			zs->need = 3;
+			return 0;
+		}
+		if (zs->z.checksum) {
+			zs->state = ZS_CHECKSUM;
+			zs->need = 4;
+			return 0;
+		}
+		/* fall through */
+	case ZS_CHECKSUM:
+		if (zs->z.has_fcs && zs->op - zs->z.base != zs->z.fcs)
+			return -EINVAL;
+		zs->frames++;
+		zs->state = ZS_MAGIC;
+		zs->need = 4;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+int zstd_stream_feed(struct zstd_stream *zs, const void *src, size_t len)
+{
+	const u8 *ip = src, *iend = ip + len;
+	const u8 *unit;
+	size_t n;
+	int ret;
+
+	while (ip < iend || (zs->state == ZS_BLOCK && !zs->need)) {
+		if (zs->state == ZS_SKIP) {
+			n = min_t(size_t, zs->skip, iend - ip);
+			ip += n;
+			zs->skip -= n;
+			if (!zs->skip)
+				zs->state = ZS_MAGIC;
+			continue;
+		}
+
+		if (!zs->have && iend - ip >= zs->need) {
+			unit = ip;
+			ip += zs->need;
+		} else {
+			n = min_t(size_t, zs->need - zs->have, iend - ip);
+			memcpy(zs->buf + zs->have, ip, n);
+			zs->have += n;
+			ip += n;
+			if (zs->have < zs->need)
+				break;
+			unit = zs->buf;
+		}
+		zs->have = 0;
+
+		ret = zstd_stream_unit(zs, unit);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int zstd_stream_end(struct zstd_stream *zs, size_t *dstlen)
+{
+	int ret = 0;
+
+	if (zs->state != ZS_MAGIC || zs->have || !zs->frames)
+		ret = -EINVAL;
+	*dstlen = zs->op - zs->dst;
+	free(zs);
+
+	return ret;
+}
@@ -27,6 +27,23 @@
 # define ARP_TIMEOUT_COUNT	CONFIG_NET_RETRY_COUNT
 #endif
 
+/**
+ * struct arp_entry - an entry in the neighbour cache
+ *
+ * @ip: IP address, 0 if the entry is free
+ * @ethaddr: MAC address of @ip
+ * @time: Time the entry was last confirmed, in ms
+ */
+struct arp_entry {
+	struct in_addr ip;
+	uchar ethaddr[ARP_HLEN];
+	ulong time;
+};
+
+static struct arp_entry arp_cache[CONFIG_NET_ARP_CACHE_SIZE];
+/* Index of the Ethernet device the cache is for */
+static int arp_cache_dev = -1;
+
 struct in_addr net_arp_wait_packet_ip;
 static struct in_addr net_arp_wait_reply_ip;
 /* MAC address of waiting packet's destination */
@@ -37,6 +54,102 @@ int		arp_wait_try;
 uchar	       *arp_tx_packet; /* THE ARP transmit packet */
 static uchar	arp_tx_packet_buf[PKTSIZE_ALIGN + PKTALIGN];
 
+/* Get the address which has to be resolved to reach @ip */
+static struct in_addr arp_next_hop(struct in_addr ip)
+{
+	if ((ip.s_addr & net_netmask.s_addr) !=
+	    (net_ip.s_addr & net_netmask.s_addr) && net_gateway.s_addr)
+		return net_gateway;
+
+	return ip;
+}
+
+static struct arp_entry *arp_cache_find(struct in_addr ip)
+{
+	int i;
+
+	/* The neighbours of another interface are no use */
+	if (eth_get_dev_index() != arp_cache_dev) {
+		memset(arp_cache, '\0', sizeof(arp_cache));
+		arp_cache_dev = eth_get_dev_index();
+	}
+
+	for (i = 0; i < ARRAY_SIZE(arp_cache); i++) {
+		if (arp_cache[i].ip.s_addr == ip.s_addr)
+			return &arp_cache[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Record that @ip is at @ethaddr. An existing entry is always refreshed, but
+ * a new one is only made if @create is set. The oldest entry is replaced
+ * when the cache is full.
+ */
+static void arp_cache_update(struct in_addr ip, const uchar *ethaddr,
+			     bool create)
+{
+	struct arp_entry *entry;
+	int i;
+
+	if (!ip.s_addr || ip.s_addr == 0xFFFFFFFF || !is_valid_ethaddr(ethaddr))
+		return;
+
+	entry = arp_cache_find(ip);
+	if (!entry) {
+		if (!create)
+			return;
+		/* Only neighbours are reached directly */
+		if ((ip.s_addr & net_netmask.s_addr) !=
+		    (net_ip.s_addr & net_netmask.s_addr))
+			return;
+		entry = &arp_cache[0];
+		for (i = 1; i < ARRAY_SIZE(arp_cache) && entry->ip.s_addr; i++) {
+			if (!arp_cache[i].ip.s_addr ||
+			    arp_cache[i].time - entry->time > LONG_MAX)
+				entry = &arp_cache[i];
+		}
+		entry->ip = ip;
+	}
+	memcpy(entry->ethaddr, ethaddr, ARP_HLEN);
+	entry->time = get_timer(0);
+}
+
+void arp_cache_learn(struct in_addr ip, const uchar *ethaddr)
+{
+	arp_cache_update(ip, ethaddr, true);
+}
+
+int arp_cache_lookup(struct in_addr ip, uchar *ethaddr)
+{
+	struct arp_entry *entry;
+
+	if (!net_ip.s_addr)
+		return -ENOENT;
+	entry = arp_cache_find(arp_next_hop(ip));
+	if (!entry)
+		return -ENOENT;
+	if (get_timer(entry->time) > CONFIG_NET_ARP_CACHE_TIMEOUT * 1000UL) {
+		entry->ip.s_addr = 0;
+		return -ENOENT;
+	}
+	memcpy(ethaddr, entry->ethaddr, ARP_HLEN);
+
+	return 0;
+}
+
+void arp_prefetch(struct in_addr ip)
+{
+	uchar ethaddr[ARP_HLEN];
+
+	if (!ip.s_addr || !net_ip.s_addr || !arp_cache_lookup(ip, ethaddr))
+		return;
+
+	debug_cond(DEBUG_DEV_PKT, "ARP prefetch %pI4\n", &ip);
+	arp_raw_request(net_ip, net_null_ethaddr, arp_next_hop(ip));
+}
+
 void arp_init(void)
 {
 	/* XXX problem with bss workaround */
@@ -155,8 +268,13 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 	if (net_ip.s_addr == 0)
 		return;
 
+	/* Any ARP packet, gratuitous ones too, refreshes the cache */
+	arp_cache_update(net_read_ip(&arp->ar_spa), &arp->ar_sha, false);
+
 	if (net_read_ip(&arp->ar_tpa).s_addr != net_ip.s_addr)
 		return;
+	/* Whoever asks for us is going to talk to us, so remember it */
+	arp_cache_learn(net_read_ip(&arp->ar_spa), &arp->ar_sha);
 
 	switch (ntohs(arp->ar_op)) {
 	case ARPOP_REQUEST:
@@ -27,6 +27,38 @@ void arp_request(void);
 void arp_raw_request(struct in_addr source_ip, const uchar *targetEther,
 	struct in_addr target_ip);
 int arp_timeout_check(void);
+
+/**
+ * arp_cache_learn() - Add an address to the neighbour cache
+ *
+ * Addresses which are not on the local network are ignored.
+ *
+ * @ip: IP address
+ * @ethaddr: MAC address of @ip
+ */
+void arp_cache_learn(struct in_addr ip, const uchar *ethaddr);
+
+/**
+ * arp_cache_lookup() - Find the MAC address to send to for an IP address
+ *
+ * This looks up the gateway if @ip is not on the local network. Entries
+ * older than CONFIG_NET_ARP_CACHE_TIMEOUT are dropped.
+ *
+ * @ip: IP address
+ * @ethaddr: Returns the MAC address
+ * @return 0 if OK, -ENOENT if it is not known
+ */
+int arp_cache_lookup(struct in_addr ip, uchar *ethaddr);
+
+/**
+ * arp_prefetch() - Ask for the address needed to reach an IP address
+ *
+ * This sends an ARP request for @ip, or its gateway, unless it is cached
+ * already. Nothing waits for the reply, which just fills the cache.
+ *
+ * @ip: IP address, ignored if 0
+ */
+void arp_prefetch(struct in_addr ip);
 void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len);
 
 #endif /* __ARP_H__ */
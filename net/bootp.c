@@ -13,6 +13,7 @@
 #include <efi_loader.h>
 #include <net.h>
 #include <net/tftp.h>
+#include "arp.h"
 #include "bootp.h"
 #ifdef CONFIG_LED_STATUS
 #include <status_led.h>
@@ -407,8 +408,8 @@ static void bootp_timeout_handler(void)
 		}
 	} else {
 		bootp_timeout *= 2;
-		if (bootp_timeout > 2000)
-			bootp_timeout = 2000;
+		if (bootp_timeout > CONFIG_BOOTP_RETRY_MAX_MS)
+			bootp_timeout = CONFIG_BOOTP_RETRY_MAX_MS;
 		net_set_timeout_handler(bootp_timeout, bootp_timeout_handler);
 		bootp_request();
 	}
@@ -499,6 +500,12 @@ static int dhcp_extended(u8 *e, int message_type, struct in_addr server_ip,
 		*e++ = tmp >> 8;
 		*e++ = tmp & 0xff;
 	}
+
+	if (IS_ENABLED(CONFIG_BOOTP_RAPID_COMMIT) &&
+	    message_type == DHCP_DISCOVER) {
+		*e++ = 80;	/* Rapid Commit */
+		*e++ = 0;
+	}
 #if defined(CONFIG_BOOTP_SEND_HOSTNAME)
 	hostname = env_get("hostname");
 	if (hostname) {
@@ -703,9 +710,26 @@ void bootp_reset(void)
 	bootp_num_ids = 0;
 	bootp_try = 0;
 	bootp_start = get_timer(0);
-	bootp_timeout = 250;
+	bootp_timeout = CONFIG_BOOTP_RETRY_START_MS;
 }
 
+#if defined(CONFIG_CMD_DHCP)
+/*
+ * Get the address to ask for in the INIT-REBOOT state, which is only tried
+ * for the first request
+ */
+static struct in_addr dhcp_lease_ip(void)
+{
+	struct in_addr ip;
+
+	ip.s_addr = 0;
+	if (IS_ENABLED(CONFIG_BOOTP_INIT_REBOOT) && bootp_try == 1)
+		ip = env_get_ip("dhcp_lease");
+
+	return ip;
+}
+#endif
+
 void bootp_request(void)
 {
 	uchar *pkt, *iphdr;
@@ -718,6 +742,9 @@ void bootp_request(void)
 	u32 bootp_id;
 	struct in_addr zero_ip;
 	struct in_addr bcast_ip;
+#if defined(CONFIG_CMD_DHCP)
+	struct in_addr lease_ip;
+#endif
 	char *ep;  /* Environment pointer */
 
 	bootstage_mark_name(BOOTSTAGE_ID_BOOTP_START, "bootp_start");
@@ -784,8 +811,11 @@ void bootp_request(void)
 
 	/* Request additional information from the BOOTP/DHCP server */
 #if defined(CONFIG_CMD_DHCP)
-	extlen = dhcp_extended((u8 *)bp->bp_vend, DHCP_DISCOVER, zero_ip,
-			       zero_ip);
+	/* Ask for the previous address straight away if there is one */
+	lease_ip = dhcp_lease_ip();
+	extlen = dhcp_extended((u8 *)bp->bp_vend,
+			       lease_ip.s_addr ? DHCP_REQUEST : DHCP_DISCOVER,
+			       zero_ip, lease_ip);
 #else
 	extlen = bootp_extended((u8 *)bp->bp_vend);
 #endif
@@ -814,7 +844,7 @@ void bootp_request(void)
 	net_set_timeout_handler(bootp_timeout, bootp_timeout_handler);
 
 #if defined(CONFIG_CMD_DHCP)
-	dhcp_state = SELECTING;
+	dhcp_state = lease_ip.s_addr ? REBOOTING : SELECTING;
 	net_set_udp_handler(dhcp_handler);
 #else
 	net_set_udp_handler(bootp_handler);
@@ -1031,6 +1061,35 @@ static void dhcp_send_request_packet(struct bootp_hdr *bp_offer)
 	net_send_packet(net_tx_packet, pktlen);
 }
 
+/*
+ *	Handle a DHCPACK, in whichever state it arrives.
+ */
+static void dhcp_bound(struct bootp_hdr *bp)
+{
+	char buf[16];
+
+	dhcp_packet_process_options(bp);
+	/* Store net params from reply */
+	store_net_params(bp);
+	dhcp_state = BOUND;
+	printf("DHCP client bound to address %pI4 (%lu ms)\n",
+	       &net_ip, get_timer(bootp_start));
+	net_set_timeout_handler(0, (thand_f *)0);
+	bootstage_mark_name(BOOTSTAGE_ID_BOOTP_STOP, "bootp_stop");
+
+	if (IS_ENABLED(CONFIG_BOOTP_INIT_REBOOT) &&
+	    env_get_ip("dhcp_lease").s_addr != net_ip.s_addr) {
+		ip_to_string(net_ip, buf);
+		env_set("dhcp_lease", buf);
+	}
+
+	/* Resolve the addresses the next transfers need */
+	arp_prefetch(net_server_ip);
+	arp_prefetch(net_gateway);
+
+	net_auto_load();
+}
+
 /*
  *	Handle DHCP received packets.
  */
@@ -1049,11 +1108,36 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	debug("DHCPHandler: got DHCP packet: (src=%d, dst=%d, len=%d) state: "
 	      "%d\n", src, dest, len, dhcp_state);
 
-	if (net_read_ip(&bp->bp_yiaddr).s_addr == 0)
+	if (net_read_ip(&bp->bp_yiaddr).s_addr == 0) {
+		/* The previous address is gone, so start again without it */
+		if (dhcp_state == REBOOTING &&
+		    dhcp_message_type((u8 *)bp->bp_vend) == DHCP_NAK) {
+			debug("DHCP: previous address refused\n");
+			env_set("dhcp_lease", NULL);
+			bootp_request();
+		}
 		return;
+	}
 
 	switch (dhcp_state) {
+	case REBOOTING:
+		debug("DHCP State: REBOOTING\n");
+
+		if (dhcp_message_type((u8 *)bp->bp_vend) == DHCP_ACK) {
+			efi_net_set_dhcp_ack(pkt, len);
+			dhcp_bound(bp);
+			return;
+		}
+		break;
 	case SELECTING:
+		/* A server doing Rapid Commit answers with an ACK at once */
+		if (IS_ENABLED(CONFIG_BOOTP_RAPID_COMMIT) &&
+		    dhcp_message_type((u8 *)bp->bp_vend) == DHCP_ACK) {
+			debug("DHCP: rapid commit\n");
+			efi_net_set_dhcp_ack(pkt, len);
+			dhcp_bound(bp);
+			return;
+		}
 		/*
 		 * Wait an appropriate time for any potential DHCPOFFER packets
 		 * to arrive.  Then select one, and generate DHCPREQUEST
@@ -1072,7 +1156,8 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			debug("TRANSITIONING TO REQUESTING STATE\n");
 			dhcp_state = REQUESTING;
 
-			net_set_timeout_handler(5000, bootp_timeout_handler);
+			net_set_timeout_handler(CONFIG_BOOTP_RETRY_MAX_MS,
+						bootp_timeout_handler);
 			dhcp_send_request_packet(bp);
 #ifdef CONFIG_SYS_BOOTFILE_PREFIX
 		}
@@ -1084,17 +1169,7 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		debug("DHCP State: REQUESTING\n");
 
 		if (dhcp_message_type((u8 *)bp->bp_vend) == DHCP_ACK) {
-			dhcp_packet_process_options(bp);
-			/* Store net params from reply */
-			store_net_params(bp);
-			dhcp_state = BOUND;
-			printf("DHCP client bound to address %pI4 (%lu ms)\n",
-			       &net_ip, get_timer(bootp_start));
-			net_set_timeout_handler(0, (thand_f *)0);
-			bootstage_mark_name(BOOTSTAGE_ID_BOOTP_STOP,
-					    "bootp_stop");
-
-			net_auto_load();
+			dhcp_bound(bp);
 			return;
 		}
 		break;
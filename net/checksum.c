@@ -12,10 +12,36 @@
 
 unsigned compute_ip_checksum(const void *vptr, unsigned nbytes)
 {
-	int sum, oddbyte;
 	const unsigned short *ptr = vptr;
+	const u32 *ptr32;
+	u64 sum = 0;
+	int oddbyte;
 
-	sum = 0;
+	/*
+	 * The one's complement sum of 32-bit words folds down to that of the
+	 * 16-bit words, so add a word at a time and let the carries collect
+	 * in the upper half of the 64-bit sum
+	 */
+	if (!((ulong)ptr & 1)) {
+		if (((ulong)ptr & 2) && nbytes > 1) {
+			sum += *ptr++;
+			nbytes -= 2;
+		}
+		ptr32 = (const u32 *)ptr;
+		while (nbytes >= 16) {
+			sum += ptr32[0];
+			sum += ptr32[1];
+			sum += ptr32[2];
+			sum += ptr32[3];
+			ptr32 += 4;
+			nbytes -= 16;
+		}
+		while (nbytes >= 4) {
+			sum += *ptr32++;
+			nbytes -= 4;
+		}
+		ptr = (const unsigned short *)ptr32;
+	}
 	while (nbytes > 1) {
 		sum += *ptr++;
 		nbytes -= 2;
@@ -26,11 +52,13 @@ unsigned compute_ip_checksum(const void *vptr, unsigned nbytes)
 		((u8 *)&oddbyte)[1] = 0;
 		sum += oddbyte;
 	}
+	sum = (sum >> 32) + (sum & 0xffffffff);
+	sum = (sum >> 32) + (sum & 0xffffffff);
+	sum = (sum >> 16) + (sum & 0xffff);
 	sum = (sum >> 16) + (sum & 0xffff);
 	sum += (sum >> 16);
-	sum = ~sum & 0xffff;
 
-	return sum;
+	return ~sum & 0xffff;
 }
 
 unsigned add_ip_checksums(unsigned offset, unsigned sum, unsigned new)
@@ -53,6 +81,26 @@ unsigned add_ip_checksums(unsigned offset, unsigned sum, unsigned new)
 	return (~checksum) & 0xffff;
 }
 
+unsigned compute_ip_pseudo_checksum(struct in_addr src, struct in_addr dst,
+				    u8 proto, unsigned len)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		u16 len;
+	} __attribute__((packed)) pseudo;
+
+	pseudo.src = src;
+	pseudo.dst = dst;
+	pseudo.zero = 0;
+	pseudo.proto = proto;
+	pseudo.len = htons(len);
+
+	return compute_ip_checksum(&pseudo, sizeof(pseudo));
+}
+
 int ip_checksum_ok(const void *addr, unsigned nbytes)
 {
 	return !(compute_ip_checksum(addr, nbytes) & 0xfffe);
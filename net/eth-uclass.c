@@ -19,9 +19,12 @@ DECLARE_GLOBAL_DATA_PTR;
  * struct eth_device_priv - private structure for each Ethernet device
  *
  * @state: The state of the Ethernet MAC driver (defined by enum eth_state_t)
+ * @enetaddr_pending: The device was probed before the environment was
+ *	loaded, so its MAC address still needs to be set up from it
  */
 struct eth_device_priv {
 	enum eth_state_t state;
+	bool enetaddr_pending;
 };
 
 /**
@@ -141,6 +144,17 @@ unsigned char *eth_get_ethaddr(void)
 	return NULL;
 }
 
+bool eth_has_feature(uint feature)
+{
+	struct eth_pdata *pdata;
+
+	if (!eth_get_dev())
+		return false;
+	pdata = eth_get_dev()->platdata;
+
+	return pdata->features & feature;
+}
+
 /* Set active state without calling start on the driver */
 int eth_init_state_only(void)
 {
@@ -316,6 +330,28 @@ void eth_halt(void)
 		priv->state = ETH_STATE_PASSIVE;
 }
 
+/*
+ * Join (@join = 1) or leave (@join = 0) the multicast group @mcast_ip, by
+ * having the driver receive the matching Ethernet multicast address
+ */
+int eth_mcast_join(struct in_addr mcast_ip, int join)
+{
+	struct udevice *current = eth_get_dev();
+	u8 mcast_mac[ARP_HLEN];
+
+	if (!current || !eth_get_ops(current)->mcast)
+		return -ENOSYS;
+
+	mcast_mac[5] = htonl(mcast_ip.s_addr) & 0xff;
+	mcast_mac[4] = (htonl(mcast_ip.s_addr) >> 8) & 0xff;
+	mcast_mac[3] = (htonl(mcast_ip.s_addr) >> 16) & 0x7f;
+	mcast_mac[2] = 0x5e;
+	mcast_mac[1] = 0x0;
+	mcast_mac[0] = 0x1;
+
+	return eth_get_ops(current)->mcast(current, mcast_mac, join);
+}
+
 int eth_is_active(struct udevice *dev)
 {
 	struct eth_device_priv *priv;
@@ -347,6 +383,37 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+/* Take all the packets the device has ready in one go */
+static int eth_rx_batch(struct udevice *dev)
+{
+	struct eth_rx_pkt pkts[ETH_RX_BATCH];
+	int count;
+	int i;
+
+	count = eth_get_ops(dev)->recv_batch(dev, ETH_RECV_CHECK_DEVICE,
+					     pkts, ARRAY_SIZE(pkts));
+	if (count == -EAGAIN)
+		return 0;
+	if (count < 0) {
+		/* We cannot completely return the error at present */
+		debug("%s: recv_batch() returned error %d\n", __func__, count);
+		return count;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (pkts[i].len <= 0)
+			continue;
+		net_rx_set_split(pkts[i].split_hdr_len, pkts[i].split_data);
+		net_rx_set_csum_ok(pkts[i].csum_ok);
+		net_process_received_packet(pkts[i].packet, pkts[i].len);
+	}
+	net_rx_set_csum_ok(false);
+	if (count)
+		eth_get_ops(dev)->free_batch(dev, count);
+
+	return count;
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
@@ -362,9 +429,18 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
+	if (eth_get_ops(current)->recv_batch)
+		return eth_rx_batch(current);
+
 	/* Process up to 32 packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < 32; i++) {
+	for (i = 0; i < ETH_RX_BATCH; i++) {
+		/*
+		 * Drivers using lent buffers flag split frames from recv(),
+		 * and those with checksum offload the verified ones
+		 */
+		net_rx_set_split(0, NULL);
+		net_rx_set_csum_ok(false);
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
 		if (ret > 0)
@@ -374,6 +450,7 @@ int eth_rx(void)
 		if (ret <= 0)
 			break;
 	}
+	net_rx_set_csum_ok(false);
 	if (ret == -EAGAIN)
 		ret = 0;
 	if (ret < 0) {
@@ -383,6 +460,27 @@ int eth_rx(void)
 	return ret;
 }
 
+static int eth_setup_enetaddr(struct udevice *dev);
+
+#if IS_ENABLED(CONFIG_ETH_EARLY_PROBE)
+int eth_probe_early(void)
+{
+	struct udevice *dev;
+
+	/*
+	 * Probing starts PHY autonegotiation, which then runs while the rest
+	 * of board_init_r() completes. The link is collected when net_loop()
+	 * starts the device. MAC addresses are set up by eth_initialize(),
+	 * once the environment is available.
+	 */
+	for (uclass_first_device_check(UCLASS_ETH, &dev); dev;
+	     uclass_next_device_check(&dev))
+		;
+
+	return 0;
+}
+#endif
+
 int eth_initialize(void)
 {
 	int num_devices = 0;
@@ -402,6 +500,20 @@ int eth_initialize(void)
 	 * their write_hwaddr() operation.
 	 */
 	uclass_first_device_check(UCLASS_ETH, &dev);
+	if (IS_ENABLED(CONFIG_ETH_EARLY_PROBE)) {
+		struct udevice *edev;
+
+		uclass_foreach_dev_probe(UCLASS_ETH, edev) {
+			struct eth_device_priv *priv = edev->uclass_priv;
+
+			if (!priv->enetaddr_pending)
+				continue;
+			priv->enetaddr_pending = false;
+			/* Same outcome as a failed probe */
+			if (eth_setup_enetaddr(edev))
+				device_remove(edev, DM_REMOVE_NORMAL);
+		}
+	}
 	if (!dev) {
 		printf("No ethernet found.\n");
 		bootstage_error(BOOTSTAGE_ID_NET_ETH_START);
@@ -463,8 +575,6 @@ static int eth_pre_unbind(struct udevice *dev)
 static int eth_post_probe(struct udevice *dev)
 {
 	struct eth_device_priv *priv = dev->uclass_priv;
-	struct eth_pdata *pdata = dev->platdata;
-	unsigned char env_enetaddr[ARP_HLEN];
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	struct eth_ops *ops = eth_get_ops(dev);
@@ -479,6 +589,10 @@ static int eth_post_probe(struct udevice *dev)
 			ops->recv += gd->reloc_off;
 		if (ops->free_pkt)
 			ops->free_pkt += gd->reloc_off;
+		if (ops->recv_batch)
+			ops->recv_batch += gd->reloc_off;
+		if (ops->free_batch)
+			ops->free_batch += gd->reloc_off;
 		if (ops->stop)
 			ops->stop += gd->reloc_off;
 		if (ops->mcast)
@@ -498,6 +612,25 @@ static int eth_post_probe(struct udevice *dev)
 	if (eth_get_ops(dev)->read_rom_hwaddr)
 		eth_get_ops(dev)->read_rom_hwaddr(dev);
 
+	/* See eth_probe_early(): the environment is not there yet */
+	if (IS_ENABLED(CONFIG_ETH_EARLY_PROBE) &&
+	    !(gd->flags & GD_FLG_ENV_READY)) {
+		priv->enetaddr_pending = true;
+		return 0;
+	}
+
+	return eth_setup_enetaddr(dev);
+}
+
+/*
+ * Pick the MAC address from the environment, falling back to the one found
+ * in ROM, and keep both in sync.
+ */
+static int eth_setup_enetaddr(struct udevice *dev)
+{
+	struct eth_pdata *pdata = dev->platdata;
+	unsigned char env_enetaddr[ARP_HLEN];
+
 	eth_env_get_enetaddr_by_index("eth", dev->seq, env_enetaddr);
 	if (!is_zero_ethaddr(env_enetaddr)) {
 		if (!is_zero_ethaddr(pdata->enetaddr) &&
@@ -176,6 +176,7 @@ static void fastboot_send(struct fastboot_header header, char *fastboot_data,
 				fastboot_data_download(fastboot_data,
 						       fastboot_data_len,
 						       response);
+				fastboot_data_flush();
 			}
 		} else if (!pending_command) {
 			strlcpy(command, fastboot_data,
@@ -0,0 +1,284 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Fastboot over TCP, as spoken by "fastboot -s tcp:<address>"
+ *
+ * Both ends start by sending "FB" and two digits of protocol version. From
+ * then on every fastboot packet, be it a command, a response or a piece of
+ * download data, is preceded by its length as a big-endian 64-bit number.
+ * The commands are those of the USB and UDP transports.
+ */
+
+#include <common.h>
+#include <fastboot.h>
+#include <net.h>
+#include <net/fastboot.h>
+#include <net/tcp.h>
+#include <asm/unaligned.h>
+#include <linux/ctype.h>
+
+/* Fastboot port # defined in spec */
+#define FASTBOOT_TCP_PORT	5554
+
+#define FASTBOOT_TCP_HANDSHAKE	"FB01"
+#define FASTBOOT_TCP_HANDSHAKE_LEN	4
+#define FASTBOOT_TCP_LEN_SIZE	8
+
+enum fastboot_tcp_state {
+	FASTBOOT_TCP_WAIT_HANDSHAKE,
+	FASTBOOT_TCP_WAIT_LENGTH,
+	FASTBOOT_TCP_WAIT_PAYLOAD,
+	FASTBOOT_TCP_ABORTED,		/* Waiting for the host to go away */
+};
+
+static struct fastboot_tcp {
+	enum fastboot_tcp_state state;
+	/* Handshake or length being received */
+	uchar hdr[FASTBOOT_TCP_LEN_SIZE];
+	unsigned int hdr_len;
+	/* Bytes left in the current packet */
+	u64 payload_left;
+	char command[FASTBOOT_COMMAND_LEN];
+	unsigned int command_len;
+	/* Command being handled, -1 if none */
+	int cmd;
+	/* Run @cmd once the host has its OKAY */
+	bool action;
+} fb_tcp;
+
+static void fastboot_tcp_reset(void)
+{
+	fb_tcp.state = FASTBOOT_TCP_WAIT_HANDSHAKE;
+	fb_tcp.hdr_len = 0;
+	fb_tcp.command_len = 0;
+	fb_tcp.cmd = -1;
+	fb_tcp.action = false;
+}
+
+static void fastboot_tcp_send(const char *response)
+{
+	uchar buf[FASTBOOT_TCP_LEN_SIZE + FASTBOOT_RESPONSE_LEN];
+	unsigned int len = strlen(response);
+
+	put_unaligned_be64(len, buf);
+	memcpy(buf + FASTBOOT_TCP_LEN_SIZE, response, len);
+	if (tcp_send(buf, FASTBOOT_TCP_LEN_SIZE + len))
+		pr_err("Can't send fastboot response\n");
+}
+
+/* Give up on this connection, telling the host why if @msg is set */
+static void fastboot_tcp_abort(const char *msg)
+{
+	char response[FASTBOOT_RESPONSE_LEN];
+
+	if (msg) {
+		fastboot_fail(msg, response);
+		fastboot_tcp_send(response);
+	}
+	tcp_close();
+	fb_tcp.state = FASTBOOT_TCP_ABORTED;
+}
+
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH)
+/**
+ * fastboot_tcp_timed_send_info() - Send INFO packet every 30 seconds
+ *
+ * @msg: String describing the reason for waiting
+ *
+ * Keep the host from timing out during long commands. The packets go out
+ * while we are too busy to see their acknowledgments, so they are added to
+ * the segment in flight for as long as it has room.
+ */
+static void fastboot_tcp_timed_send_info(const char *msg)
+{
+	char response[FASTBOOT_RESPONSE_LEN];
+	static ulong start;
+
+	if (!start || get_timer(start) >= 30000) {
+		if (start) {
+			fastboot_response("INFO", response, "%s", msg);
+			fastboot_tcp_send(response);
+		}
+		start = get_timer(0);
+	}
+}
+#endif
+
+/* The host has the OKAY of the last command: do what it asked */
+static void fastboot_tcp_action(void)
+{
+	fb_tcp.action = false;
+
+	switch (fb_tcp.cmd) {
+	case FASTBOOT_COMMAND_BOOT:
+		tcp_stop();
+		fastboot_boot();
+		net_set_state(NETLOOP_SUCCESS);
+		break;
+	case FASTBOOT_COMMAND_CONTINUE:
+		tcp_stop();
+		net_set_state(NETLOOP_SUCCESS);
+		break;
+	case FASTBOOT_COMMAND_REBOOT:
+	case FASTBOOT_COMMAND_REBOOT_BOOTLOADER:
+		do_reset(NULL, 0, 0, NULL);
+		break;
+	}
+	fb_tcp.cmd = -1;
+}
+
+static void fastboot_tcp_command(void)
+{
+	char response[FASTBOOT_RESPONSE_LEN] = {0};
+
+	fb_tcp.command[fb_tcp.command_len] = '\0';
+	fb_tcp.command_len = 0;
+	fb_tcp.cmd = fastboot_handle_command(fb_tcp.command, response);
+	fastboot_tcp_send(response);
+
+	if (!strncmp("OKAY", response, 4)) {
+		switch (fb_tcp.cmd) {
+		case FASTBOOT_COMMAND_BOOT:
+		case FASTBOOT_COMMAND_CONTINUE:
+		case FASTBOOT_COMMAND_REBOOT:
+		case FASTBOOT_COMMAND_REBOOT_BOOTLOADER:
+			fb_tcp.action = true;
+			return;
+		}
+	}
+	/* Anything else than a download accepted with DATA is done */
+	if (strncmp("DATA", response, 4))
+		fb_tcp.cmd = -1;
+}
+
+static void fastboot_tcp_header(void)
+{
+	fb_tcp.hdr_len = 0;
+
+	if (fb_tcp.state == FASTBOOT_TCP_WAIT_HANDSHAKE) {
+		/* We speak version 1 whatever the host asks for */
+		if (memcmp(fb_tcp.hdr, "FB", 2) || !isdigit(fb_tcp.hdr[2]) ||
+		    !isdigit(fb_tcp.hdr[3])) {
+			pr_err("Bad fastboot handshake\n");
+			fastboot_tcp_abort(NULL);
+			return;
+		}
+		tcp_send(FASTBOOT_TCP_HANDSHAKE, FASTBOOT_TCP_HANDSHAKE_LEN);
+		fb_tcp.state = FASTBOOT_TCP_WAIT_LENGTH;
+		return;
+	}
+
+	fb_tcp.payload_left = get_unaligned_be64(fb_tcp.hdr);
+	if (fb_tcp.cmd == FASTBOOT_COMMAND_DOWNLOAD) {
+		if (fb_tcp.payload_left > fastboot_data_remaining()) {
+			fastboot_tcp_abort("Received invalid data length");
+			return;
+		}
+	} else if (fb_tcp.payload_left >= FASTBOOT_COMMAND_LEN) {
+		fastboot_tcp_abort("Command too long");
+		return;
+	}
+
+	if (fb_tcp.payload_left)
+		fb_tcp.state = FASTBOOT_TCP_WAIT_PAYLOAD;
+	else if (fb_tcp.cmd != FASTBOOT_COMMAND_DOWNLOAD)
+		fastboot_tcp_command();
+}
+
+static void fastboot_tcp_payload(const uchar *data, unsigned int len)
+{
+	char response[FASTBOOT_RESPONSE_LEN] = {0};
+
+	fb_tcp.payload_left -= len;
+	if (!fb_tcp.payload_left)
+		fb_tcp.state = FASTBOOT_TCP_WAIT_LENGTH;
+
+	if (fb_tcp.cmd != FASTBOOT_COMMAND_DOWNLOAD) {
+		memcpy(fb_tcp.command + fb_tcp.command_len, data, len);
+		fb_tcp.command_len += len;
+		if (!fb_tcp.payload_left)
+			fastboot_tcp_command();
+		return;
+	}
+
+	fastboot_data_download(data, len, response);
+	if (*response) {
+		/* The response says FAIL already */
+		fastboot_tcp_send(response);
+		fastboot_tcp_abort(NULL);
+		return;
+	}
+	fastboot_data_flush();
+
+	if (!fastboot_data_remaining()) {
+		fastboot_data_complete(response);
+		fastboot_tcp_send(response);
+		fb_tcp.cmd = -1;
+	}
+}
+
+static void fastboot_tcp_receive(const uchar *data, unsigned int len)
+{
+	unsigned int want, n;
+
+	while (len) {
+		switch (fb_tcp.state) {
+		case FASTBOOT_TCP_WAIT_HANDSHAKE:
+		case FASTBOOT_TCP_WAIT_LENGTH:
+			want = fb_tcp.state == FASTBOOT_TCP_WAIT_HANDSHAKE ?
+			       FASTBOOT_TCP_HANDSHAKE_LEN :
+			       FASTBOOT_TCP_LEN_SIZE;
+			n = min(len, want - fb_tcp.hdr_len);
+			memcpy(fb_tcp.hdr + fb_tcp.hdr_len, data, n);
+			fb_tcp.hdr_len += n;
+			if (fb_tcp.hdr_len == want)
+				fastboot_tcp_header();
+			break;
+		case FASTBOOT_TCP_WAIT_PAYLOAD:
+			n = min_t(u64, len, fb_tcp.payload_left);
+			fastboot_tcp_payload(data, n);
+			break;
+		default:
+			return;
+		}
+		data += n;
+		len -= n;
+	}
+}
+
+static void fastboot_tcp_handler(enum tcp_event event, const uchar *data,
+				 unsigned int len)
+{
+	switch (event) {
+	case TCP_EV_CONNECTED:
+		fastboot_tcp_reset();
+		break;
+	case TCP_EV_DATA:
+		fastboot_tcp_receive(data, len);
+		break;
+	case TCP_EV_SENT:
+		if (fb_tcp.action)
+			fastboot_tcp_action();
+		break;
+	case TCP_EV_CLOSED:
+	case TCP_EV_RESET:
+		/* The next host starts afresh, tcp_listen() stays on */
+		fastboot_tcp_reset();
+		break;
+	}
+}
+
+void fastboot_tcp_start_server(void)
+{
+	printf("Using %s device\n", eth_get_name());
+	printf("Listening for fastboot command on tcp %pI4\n", &net_ip);
+
+	fastboot_tcp_reset();
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH)
+	fastboot_set_progress_callback(fastboot_tcp_timed_send_info);
+#endif
+	if (tcp_listen(FASTBOOT_TCP_PORT, fastboot_tcp_handler))
+		net_set_state(NETLOOP_FAIL);
+
+	/* zero out server ether in case the server ip has changed */
+	memset(net_server_ethaddr, 0, 6);
+}
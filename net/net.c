@@ -94,7 +94,9 @@
 #include <errno.h>
 #include <net.h>
 #include <net/fastboot.h>
+#include <net/tcp.h>
 #include <net/tftp.h>
+#include <net/wget.h>
 #include <net/ncsi.h>
 #if defined(CONFIG_LED_STATUS)
 #include <miiphy.h>
@@ -142,6 +144,10 @@ u8 net_server_ethaddr[6];
 struct in_addr	net_ip;
 /* Server IP addr (0 = unknown) */
 struct in_addr	net_server_ip;
+#ifdef CONFIG_TFTP_MCAST
+/* Multicast group joined (0 = none) */
+struct in_addr	net_mcast_addr;
+#endif
 /* Current receive packet */
 uchar *net_rx_packet;
 /* Current rx packet length */
@@ -198,6 +204,17 @@ static rxhand_icmp_f *packet_icmp_handler;
 #endif
 /* Current timeout handler */
 static thand_f *time_handler;
+#ifdef CONFIG_NET_RX_LEND
+/* Current receive buffer lender, its header length and UDP port */
+static rx_lend_f *rx_lender;
+static int rx_lend_hdr_len;
+static int rx_lend_port;
+/* The driver verified the checksums of the current frame */
+bool net_rx_csum_ok;
+/* The current frame continues past rx_split_hdr_len at net_rx_split_data */
+uchar *net_rx_split_data;
+static int rx_split_hdr_len;
+#endif
 /* Time base value */
 static ulong	time_start;
 /* Current timeout value */
@@ -360,6 +377,7 @@ static void net_clear_handlers(void)
 	net_set_udp_handler(NULL);
 	net_set_arp_handler(NULL);
 	net_set_timeout_handler(0, NULL);
+	net_set_rx_lender(NULL, 0, 0);
 }
 
 static void net_cleanup_loop(void)
@@ -478,6 +496,11 @@ restart:
 			fastboot_start_server();
 			break;
 #endif
+#ifdef CONFIG_TCP_FUNCTION_FASTBOOT
+		case FASTBOOT_TCP:
+			fastboot_tcp_start_server();
+			break;
+#endif
 #if defined(CONFIG_CMD_DHCP)
 		case DHCP:
 			bootp_reset();
@@ -543,6 +566,11 @@ restart:
 		case NCSI:
 			ncsi_probe_packages();
 			break;
+#endif
+#if defined(CONFIG_CMD_WGET)
+		case WGET:
+			wget_start();
+			break;
 #endif
 		default:
 			break;
@@ -768,6 +796,115 @@ rxhand_f *net_get_udp_handler(void)
 	return udp_packet_handler;
 }
 
+#ifdef CONFIG_NET_RX_LEND
+void net_set_rx_lender(rx_lend_f *f, int hdr_len, int port)
+{
+	rx_lender = f;
+	rx_lend_hdr_len = hdr_len;
+	rx_lend_port = port;
+}
+
+int net_rx_lend(int ahead, int *hdr_lenp, uchar **datap)
+{
+	int len;
+
+	if (!rx_lender)
+		return 0;
+
+	len = rx_lender(ahead, datap);
+	if (len > 0)
+		*hdr_lenp = rx_lend_hdr_len;
+
+	return len;
+}
+
+void net_rx_set_split(int hdr_len, uchar *data)
+{
+	rx_split_hdr_len = hdr_len;
+	net_rx_split_data = data;
+}
+
+/* Copy the rest of a split frame back behind its header */
+void net_rx_linearize(void)
+{
+	if (!net_rx_split_data)
+		return;
+
+	if (net_rx_packet_len > rx_split_hdr_len)
+		memcpy(net_rx_packet + rx_split_hdr_len, net_rx_split_data,
+		       net_rx_packet_len - rx_split_hdr_len);
+	net_rx_split_data = NULL;
+}
+
+/*
+ * Finish a split frame whose data, from @payload on, belongs at @dst, the
+ * buffer lent for it. Returns true if it is all there now; false if the
+ * frame went to some other buffer, in which case it is linearized to be
+ * copied as usual.
+ */
+bool net_rx_split_to(uchar *payload, void *dst)
+{
+	int head = net_rx_packet + rx_split_hdr_len - payload;
+
+	if (!net_rx_split_data)
+		return false;
+
+	if (head < 0 || net_rx_split_data != (uchar *)dst + head) {
+		net_rx_linearize();
+		return false;
+	}
+	/* The driver may have split a few bytes into the payload */
+	memcpy(dst, payload, head);
+
+	return true;
+}
+
+/*
+ * Only plain IPv4 UDP frames for the lender's port are delivered split, all
+ * the rest of the stack expects contiguous frames.
+ */
+static void net_rx_check_split(void)
+{
+	struct ethernet_hdr *et = (struct ethernet_hdr *)net_rx_packet;
+	struct ip_udp_hdr *ip;
+
+	if (!net_rx_split_data)
+		return;
+
+	ip = (struct ip_udp_hdr *)(net_rx_packet + ETHER_HDR_SIZE);
+	if (net_rx_packet_len <= rx_split_hdr_len ||
+	    rx_split_hdr_len < ETHER_HDR_SIZE + IP_UDP_HDR_SIZE ||
+	    ntohs(et->et_protlen) != PROT_IP ||
+	    ip->ip_hl_v != 0x45 || ip->ip_p != IPPROTO_UDP ||
+	    (ntohs(ip->ip_off) & (IP_OFFS | IP_FLAGS_MFRAG)) ||
+	    ntohs(ip->udp_dst) != rx_lend_port ||
+	    (IS_ENABLED(CONFIG_UDP_CHECKSUM) && ip->udp_xsum &&
+	     !net_rx_csum_ok))
+		net_rx_linearize();
+}
+#endif
+
+void net_rx_set_csum_ok(bool ok)
+{
+	net_rx_csum_ok = ok;
+}
+
+#ifdef CONFIG_UDP_CHECKSUM
+static bool udp_checksum_ok(struct ip_udp_hdr *ip)
+{
+	unsigned sum;
+
+	sum = compute_ip_pseudo_checksum(net_read_ip(&ip->ip_src),
+					 net_read_ip(&ip->ip_dst), IPPROTO_UDP,
+					 ntohs(ip->udp_len));
+	/* The datagram follows the 12-byte pseudo header */
+	sum = add_ip_checksums(12, sum, compute_ip_checksum(&ip->udp_src,
+							    ntohs(ip->udp_len)));
+
+	return sum == 0 || sum == 0xffff;
+}
+#endif
+
 void net_set_udp_handler(rxhand_f *f)
 {
 	debug_cond(DEBUG_INT_STATE, "--- net_loop UDP handler set (%p)\n", f);
@@ -848,6 +985,9 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 	/* if broadcast, make the ether address a broadcast and don't do ARP */
 	if (dest.s_addr == 0xFFFFFFFF)
 		ether = (uchar *)net_bcast_ethaddr;
+	/* no need to ARP if the neighbour cache knows the address */
+	else if (memcmp(ether, net_null_ethaddr, 6) == 0)
+		arp_cache_lookup(dest, ether);
 
 	pkt = (uchar *)net_tx_packet;
 
@@ -859,6 +999,14 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 				   payload_len);
 		pkt_hdr_size = eth_hdr_size + IP_UDP_HDR_SIZE;
 		break;
+#if defined(CONFIG_PROT_TCP)
+	case IPPROTO_TCP:
+		pkt_hdr_size = eth_hdr_size +
+			tcp_set_tcp_header(pkt + eth_hdr_size, dest, dport,
+					   sport, payload_len, action,
+					   tcp_seq_num, tcp_ack_num);
+		break;
+#endif
 	default:
 		return -EINVAL;
 	}
@@ -898,6 +1046,14 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 #endif
 #define IP_PKTSIZE (CONFIG_NET_MAXDEFRAG)
 
+/*
+ * Number of packets reassembled at the same time, so that the fragments
+ * of several packets sent back to back can be interleaved
+ */
+#ifndef CONFIG_NET_DEFRAG_CONTEXTS
+#define CONFIG_NET_DEFRAG_CONTEXTS 4
+#endif
+
 #define IP_MAXUDP (IP_PKTSIZE - IP_HDR_SIZE)
 
 /*
@@ -912,36 +1068,77 @@ struct hole {
 	u16 unused;
 };
 
+/* A packet being reassembled */
+struct defrag_ctx {
+	uchar pkt_buff[IP_PKTSIZE] __aligned(PKTALIGN);
+	u16 first_hole;
+	u16 total_len;		/* 0 if the context is free */
+	ulong last_used;	/* for replacing the least recently used */
+};
+
+static struct defrag_ctx defrag_ctx[CONFIG_NET_DEFRAG_CONTEXTS];
+static ulong defrag_clock;
+
+/*
+ * Find the context of the packet @ip is a fragment of, or start a new one
+ * in a free context or else in the least recently used
+ */
+static struct defrag_ctx *net_defrag_ctx(struct ip_udp_hdr *ip)
+{
+	struct defrag_ctx *ctx, *lru = NULL;
+	struct ip_udp_hdr *localip;
+	struct hole *payload;
+
+	for (ctx = defrag_ctx; ctx < defrag_ctx + ARRAY_SIZE(defrag_ctx);
+	     ctx++) {
+		localip = (struct ip_udp_hdr *)ctx->pkt_buff;
+		if (ctx->total_len && localip->ip_id == ip->ip_id &&
+		    localip->ip_p == ip->ip_p &&
+		    localip->ip_src.s_addr == ip->ip_src.s_addr &&
+		    localip->ip_dst.s_addr == ip->ip_dst.s_addr)
+			goto found;
+		if (!lru || !ctx->total_len ||
+		    (lru->total_len && ctx->last_used < lru->last_used))
+			lru = ctx;
+	}
+
+	/* new packet, reset structs */
+	ctx = lru;
+	payload = (struct hole *)(ctx->pkt_buff + IP_HDR_SIZE);
+	ctx->total_len = 0xffff;
+	payload[0].last_byte = ~0;
+	payload[0].next_hole = 0;
+	payload[0].prev_hole = 0;
+	ctx->first_hole = 0;
+	/* any IP header will work, copy the first we received */
+	memcpy(ctx->pkt_buff, ip, IP_HDR_SIZE);
+found:
+	ctx->last_used = ++defrag_clock;
+
+	return ctx;
+}
+
 static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 {
-	static uchar pkt_buff[IP_PKTSIZE] __aligned(PKTALIGN);
-	static u16 first_hole, total_len;
+	struct defrag_ctx *ctx;
 	struct hole *payload, *thisfrag, *h, *newh;
-	struct ip_udp_hdr *localip = (struct ip_udp_hdr *)pkt_buff;
+	struct ip_udp_hdr *localip;
 	uchar *indata = (uchar *)ip;
 	int offset8, start, len, done = 0;
 	u16 ip_off = ntohs(ip->ip_off);
 
-	/* payload starts after IP header, this fragment is in there */
-	payload = (struct hole *)(pkt_buff + IP_HDR_SIZE);
 	offset8 =  (ip_off & IP_OFFS);
-	thisfrag = payload + offset8;
 	start = offset8 * 8;
 	len = ntohs(ip->ip_len) - IP_HDR_SIZE;
 
 	if (start + len > IP_MAXUDP) /* fragment extends too far */
 		return NULL;
 
-	if (!total_len || localip->ip_id != ip->ip_id) {
-		/* new (or different) packet, reset structs */
-		total_len = 0xffff;
-		payload[0].last_byte = ~0;
-		payload[0].next_hole = 0;
-		payload[0].prev_hole = 0;
-		first_hole = 0;
-		/* any IP header will work, copy the first we received */
-		memcpy(localip, ip, IP_HDR_SIZE);
-	}
+	ctx = net_defrag_ctx(ip);
+	localip = (struct ip_udp_hdr *)ctx->pkt_buff;
+	/* payload starts after IP header, this fragment is in there */
+	payload = (struct hole *)(ctx->pkt_buff + IP_HDR_SIZE);
+	thisfrag = payload + offset8;
 
 	/*
 	 * What follows is the reassembly algorithm. We use the payload
@@ -950,7 +1147,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 	 * so it is represented as byte count, not as 8-byte blocks.
 	 */
 
-	h = payload + first_hole;
+	h = payload + ctx->first_hole;
 	while (h->last_byte < start) {
 		if (!h->next_hole) {
 			/* no hole that far away */
@@ -967,7 +1164,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 
 	if (!(ip_off & IP_FLAGS_MFRAG)) {
 		/* no more fragmentss: truncate this (last) hole */
-		total_len = start + len;
+		ctx->total_len = start + len;
 		h->last_byte = start + len;
 	}
 
@@ -984,7 +1181,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 			done = 1;
 		} else if (!h->prev_hole) {
 			/* first hole */
-			first_hole = h->next_hole;
+			ctx->first_hole = h->next_hole;
 			payload[h->next_hole].prev_hole = 0;
 		} else if (!h->next_hole) {
 			/* last hole */
@@ -1009,7 +1206,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 		if (h->prev_hole)
 			payload[h->prev_hole].next_hole = (h - payload);
 		else
-			first_hole = (h - payload);
+			ctx->first_hole = (h - payload);
 
 	} else {
 		/* fragment sits in the middle: split the hole */
@@ -1027,8 +1224,10 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 	if (!done)
 		return NULL;
 
-	localip->ip_len = htons(total_len);
-	*lenp = total_len + IP_HDR_SIZE;
+	localip->ip_len = htons(ctx->total_len);
+	*lenp = ctx->total_len + IP_HDR_SIZE;
+	/* the packet stays in the buffer until the context is used again */
+	ctx->total_len = 0;
 	return localip;
 }
 
@@ -1089,7 +1288,7 @@ static void receive_icmp(struct ip_udp_hdr *ip, int len,
 void net_process_received_packet(uchar *in_packet, int len)
 {
 	struct ethernet_hdr *et;
-	struct ip_udp_hdr *ip;
+	struct ip_udp_hdr *ip, *frag;
 	struct in_addr dst_ip;
 	struct in_addr src_ip;
 	int eth_proto;
@@ -1108,6 +1307,10 @@ void net_process_received_packet(uchar *in_packet, int len)
 	if (len < ETHER_HDR_SIZE)
 		return;
 
+#ifdef CONFIG_NET_RX_LEND
+	net_rx_check_split();
+#endif
+
 #if defined(CONFIG_API) || defined(CONFIG_EFI_LOADER)
 	if (push_packet) {
 		(*push_packet)(in_packet, len);
@@ -1221,7 +1424,8 @@ void net_process_received_packet(uchar *in_packet, int len)
 		if ((ip->ip_hl_v & 0x0f) > 0x05)
 			return;
 		/* Check the Checksum of the header */
-		if (!ip_checksum_ok((uchar *)ip, IP_HDR_SIZE)) {
+		if (!net_rx_csum_ok &&
+		    !ip_checksum_ok((uchar *)ip, IP_HDR_SIZE)) {
 			debug("checksum bad\n");
 			return;
 		}
@@ -1229,18 +1433,29 @@ void net_process_received_packet(uchar *in_packet, int len)
 		dst_ip = net_read_ip(&ip->ip_dst);
 		if (net_ip.s_addr && dst_ip.s_addr != net_ip.s_addr &&
 		    dst_ip.s_addr != 0xFFFFFFFF) {
+#ifdef CONFIG_TFTP_MCAST
+			if (!net_mcast_addr.s_addr ||
+			    dst_ip.s_addr != net_mcast_addr.s_addr)
+#endif
 				return;
 		}
 		/* Read source IP address for later use */
 		src_ip = net_read_ip(&ip->ip_src);
+		/* Whoever sends to us is likely to be sent to */
+		if (net_ip.s_addr && dst_ip.s_addr == net_ip.s_addr)
+			arp_cache_learn(src_ip, et->et_src);
 		/*
 		 * The function returns the unchanged packet if it's not
 		 * a fragment, and either the complete packet or NULL if
 		 * it is a fragment (if !CONFIG_IP_DEFRAG, it returns NULL)
 		 */
+		frag = ip;
 		ip = net_defragment(ip, &len);
 		if (!ip)
 			return;
+		/* The driver only saw the last fragment */
+		if (ip != frag)
+			net_rx_csum_ok = false;
 		/*
 		 * watch for ICMP host redirects
 		 *
@@ -1265,6 +1480,11 @@ void net_process_received_packet(uchar *in_packet, int len)
 		if (ip->ip_p == IPPROTO_ICMP) {
 			receive_icmp(ip, len, src_ip, et);
 			return;
+#if defined(CONFIG_PROT_TCP)
+		} else if (ip->ip_p == IPPROTO_TCP) {
+			tcp_receive((struct ip_tcp_hdr *)ip, len);
+			return;
+#endif
 		} else if (ip->ip_p != IPPROTO_UDP) {	/* Only UDP packets */
 			return;
 		}
@@ -1277,44 +1497,10 @@ void net_process_received_packet(uchar *in_packet, int len)
 			   &dst_ip, &src_ip, len);
 
 #ifdef CONFIG_UDP_CHECKSUM
-		if (ip->udp_xsum != 0) {
-			ulong   xsum;
-			ushort *sumptr;
-			ushort  sumlen;
-
-			xsum  = ip->ip_p;
-			xsum += (ntohs(ip->udp_len));
-			xsum += (ntohl(ip->ip_src.s_addr) >> 16) & 0x0000ffff;
-			xsum += (ntohl(ip->ip_src.s_addr) >>  0) & 0x0000ffff;
-			xsum += (ntohl(ip->ip_dst.s_addr) >> 16) & 0x0000ffff;
-			xsum += (ntohl(ip->ip_dst.s_addr) >>  0) & 0x0000ffff;
-
-			sumlen = ntohs(ip->udp_len);
-			sumptr = (ushort *)&(ip->udp_src);
-
-			while (sumlen > 1) {
-				ushort sumdata;
-
-				sumdata = *sumptr++;
-				xsum += ntohs(sumdata);
-				sumlen -= 2;
-			}
-			if (sumlen > 0) {
-				ushort sumdata;
-
-				sumdata = *(unsigned char *)sumptr;
-				sumdata = (sumdata << 8) & 0xff00;
-				xsum += sumdata;
-			}
-			while ((xsum >> 16) != 0) {
-				xsum = (xsum & 0x0000ffff) +
-				       ((xsum >> 16) & 0x0000ffff);
-			}
-			if ((xsum != 0x00000000) && (xsum != 0x0000ffff)) {
-				printf(" UDP wrong checksum %08lx %08x\n",
-				       xsum, ntohs(ip->udp_xsum));
-				return;
-			}
+		if (ip->udp_xsum != 0 && !net_rx_csum_ok &&
+		    !udp_checksum_ok(ip)) {
+			printf(" UDP wrong checksum %04x\n", ntohs(ip->udp_xsum));
+			return;
 		}
 #endif
 
@@ -1383,6 +1569,9 @@ static int net_check_prereq(enum proto_t protocol)
 		/* Fall through */
 	case TFTPGET:
 	case TFTPPUT:
+#if defined(CONFIG_CMD_WGET)
+	case WGET:
+#endif
 		if (net_server_ip.s_addr == 0 && !is_serverip_in_cmd()) {
 			puts("*** ERROR: `serverip' not set\n");
 			return 1;
@@ -1395,6 +1584,7 @@ common:
 
 	case NETCONS:
 	case FASTBOOT:
+	case FASTBOOT_TCP:
 	case TFTPSRV:
 		if (net_ip.s_addr == 0) {
 			puts("*** ERROR: `ipaddr' not set\n");
@@ -1522,7 +1712,9 @@ void net_set_ip_header(uchar *pkt, struct in_addr dest, struct in_addr source,
 	/* already in network byte order */
 	net_copy_ip((void *)&ip->ip_dst, &dest);
 
-	ip->ip_sum   = compute_ip_checksum(ip, IP_HDR_SIZE);
+	/* the MAC may fill it in */
+	if (!eth_has_feature(ETH_FEATURE_TX_CSUM))
+		ip->ip_sum = compute_ip_checksum(ip, IP_HDR_SIZE);
 }
 
 void net_set_udp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
@@ -1545,6 +1737,12 @@ void net_set_udp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
 	ip->udp_dst  = htons(dport);
 	ip->udp_len  = htons(UDP_HDR_SIZE + len);
 	ip->udp_xsum = 0;
+	/* A MAC filling in the checksum adds the datagram to this */
+	if (eth_has_feature(ETH_FEATURE_TX_CSUM))
+		ip->udp_xsum = ~compute_ip_pseudo_checksum(net_ip, dest,
+							   IPPROTO_UDP,
+							   UDP_HDR_SIZE + len)
+			       & 0xffff;
 }
 
 void copy_filename(char *dst, const char *src, int size)
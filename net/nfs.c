@@ -42,15 +42,46 @@
 # define NFS_TIMEOUT CONFIG_NFS_TIMEOUT
 #endif
 
+/*
+ * Largest READ asked for. The whole reply has to fit in one datagram, so
+ * reads only get bigger than an Ethernet frame when IP fragments are
+ * reassembled.
+ */
+#if defined(CONFIG_NFS_READ_SIZE)
+# define NFS_READ_SIZE_MAX	CONFIG_NFS_READ_SIZE
+#elif defined(CONFIG_IP_DEFRAG)
+# define NFS_READ_SIZE_MAX	8192
+#else
+# define NFS_READ_SIZE_MAX	NFS_READ_SIZE
+#endif
+#if defined(CONFIG_NET_MAXDEFRAG) && \
+	NFS_READ_SIZE_MAX + 512 > CONFIG_NET_MAXDEFRAG
+# error "NFS reads do not fit in CONFIG_NET_MAXDEFRAG"
+#endif
+#define NFS2_MAXDATA	8192	/* largest NFSv2 READ */
+#define NFS_HASH_BYTES	(NFS_READ_SIZE / 2 * 10)
+
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
 static ulong nfs_timeout = NFS_TIMEOUT;
 
+/* A READ request waiting for its reply */
+struct nfs_read_slot {
+	unsigned long id;	/* RPC transaction ID, 0 if the slot is free */
+	int offset;
+	int len;
+};
+
+static struct nfs_read_slot nfs_reads[CONFIG_NFS_READ_WINDOW];
+static int nfs_read_size;	/* bytes asked for by each READ */
+static int nfs_next_offset;	/* offset of the next READ */
+static bool nfs_read_eof;	/* the end of the file was reached */
+static ulong nfs_read_bytes;	/* bytes stored so far */
+static int nfs_hashes;		/* progress hashes printed so far */
+
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
 static char filefh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle */
 static int filefh3_length;	/* (variable) length of filefh when NFSv3 */
@@ -69,6 +100,7 @@ static int nfs_state;
 #define STATE_LOOKUP_REQ		5
 #define STATE_READ_REQ			6
 #define STATE_READLINK_REQ		7
+#define STATE_FSINFO_REQ		8
 
 static char *nfs_filename;
 static char *nfs_path;
@@ -356,7 +388,7 @@ static void nfs_lookup_req(char *fname)
 /**************************************************************************
 NFS_READ - Read File on NFS Server
 **************************************************************************/
-static void nfs_read_req(int offset, int readlen)
+static void nfs_read_req(struct nfs_read_slot *slot)
 {
 	uint32_t data[1024];
 	uint32_t *p;
@@ -368,22 +400,108 @@ static void nfs_read_req(int offset, int readlen)
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		memcpy(p, filefh, NFS_FHSIZE);
 		p += (NFS_FHSIZE / 4);
-		*p++ = htonl(offset);
-		*p++ = htonl(readlen);
+		*p++ = htonl(slot->offset);
+		*p++ = htonl(slot->len);
 		*p++ = 0;
 	} else { /* NFSV3_FLAG */
 		*p++ = htonl(filefh3_length);
 		memcpy(p, filefh, filefh3_length);
 		p += (filefh3_length / 4);
 		*p++ = htonl(0); /* offset is 64-bit long, so fill with 0 */
-		*p++ = htonl(offset);
-		*p++ = htonl(readlen);
+		*p++ = htonl(slot->offset);
+		*p++ = htonl(slot->len);
 		*p++ = 0;
 	}
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
 	rpc_req(PROG_NFS, NFS_READ, data, len);
+	/* A retransmitted READ gets a new ID, a late reply is then dropped */
+	slot->id = rpc_id;
+}
+
+/* Ask for the next parts of the file until the window is full */
+static void nfs_read_fill(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_reads) && !nfs_read_eof; i++) {
+		if (nfs_reads[i].id)
+			continue;
+		nfs_reads[i].offset = nfs_next_offset;
+		nfs_reads[i].len = nfs_read_size;
+		nfs_next_offset += nfs_read_size;
+		nfs_read_req(&nfs_reads[i]);
+	}
+}
+
+static void nfs_read_start(void)
+{
+	memset(nfs_reads, '\0', sizeof(nfs_reads));
+	nfs_next_offset = 0;
+	nfs_read_eof = false;
+	nfs_read_bytes = 0;
+	nfs_hashes = 0;
+	nfs_read_fill();
+}
+
+/* Send again the READs still waiting for a reply */
+static void nfs_read_resend(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_reads); i++) {
+		if (nfs_reads[i].id)
+			nfs_read_req(&nfs_reads[i]);
+	}
+}
+
+static struct nfs_read_slot *nfs_read_find(unsigned long id)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_reads); i++) {
+		if (id && nfs_reads[i].id == id)
+			return &nfs_reads[i];
+	}
+
+	return NULL;
+}
+
+static bool nfs_read_done(void)
+{
+	int i;
+
+	if (!nfs_read_eof)
+		return false;
+	for (i = 0; i < ARRAY_SIZE(nfs_reads); i++) {
+		if (nfs_reads[i].id)
+			return false;
+	}
+
+	return true;
+}
+
+/**************************************************************************
+NFS3_FSINFO - Get the preferred read size of the file system
+**************************************************************************/
+static void nfs3_fsinfo_req(void)
+{
+	uint32_t data[1024];
+	uint32_t *p;
+	int len;
+
+	p = &(data[0]);
+	p = rpc_add_credentials(p);
+
+	/* Any file handle of the file system will do */
+	*p++ = htonl(filefh3_length);
+	memcpy(p, filefh, filefh3_length);
+	p += (filefh3_length / 4);
+
+	len = (uint32_t *)p - (uint32_t *)&(data[0]);
+
+	rpc_req(PROG_NFS, NFS3PROC_FSINFO, data, len);
 }
 
 /**************************************************************************
@@ -416,11 +534,14 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_resend();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
 		break;
+	case STATE_FSINFO_REQ:
+		nfs3_fsinfo_req();
+		break;
 	}
 }
 
@@ -652,21 +773,67 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
-static int nfs_read_reply(uchar *pkt, unsigned len)
+static int nfs3_fsinfo_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
-	int rlen;
-	uchar *data_ptr;
+	int nfsv3_data_offset;
+	uint rtpref;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	memcpy(&rpc_pkt.u.data[0], pkt, len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
 		return -NFS_RPC_ERR;
 	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
 		return -NFS_RPC_DROP;
 
+	if (rpc_pkt.u.reply.rstatus  ||
+	    rpc_pkt.u.reply.verifier ||
+	    rpc_pkt.u.reply.astatus  ||
+	    rpc_pkt.u.reply.data[0])
+		return -1;
+
+	nfsv3_data_offset = nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
+	/* Skip rtmax, the preferred size is the one to use */
+	rtpref = ntohl(rpc_pkt.u.reply.data[2 + nfsv3_data_offset]);
+	if (rtpref > NFS_READ_SIZE)
+		nfs_read_size = min_t(uint, rtpref, NFS_READ_SIZE_MAX) & ~3;
+	debug("NFS read size %d (server prefers %u)\n", nfs_read_size, rtpref);
+
+	return 0;
+}
+
+static void nfs_show_progress(int rlen)
+{
+	nfs_read_bytes += rlen;
+	while ((ulong)nfs_hashes * NFS_HASH_BYTES < nfs_read_bytes) {
+		if (nfs_hashes && !(nfs_hashes % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+		nfs_hashes++;
+	}
+}
+
+static int nfs_read_reply(uchar *pkt, unsigned len)
+{
+	struct rpc_t rpc_pkt;
+	struct nfs_read_slot *slot;
+	int rlen;
+	int data_offset;
+	bool eof = false;
+	uchar *data_ptr;
+
+	debug("%s\n", __func__);
+
+	/* The data is stored straight from the packet, copy the rest */
+	memcpy(&rpc_pkt.u.data[0], pkt, min_t(uint, len, sizeof(rpc_pkt)));
+
+	/* Replies can come in any order, or for a READ sent again */
+	slot = nfs_read_find(ntohl(rpc_pkt.u.reply.id));
+	if (!slot)
+		return -NFS_RPC_DROP;
+
 	if (rpc_pkt.u.reply.rstatus  ||
 	    rpc_pkt.u.reply.verifier ||
 	    rpc_pkt.u.reply.astatus  ||
@@ -678,31 +845,45 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
-		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
+		data_offset = 19;
 	} else {  /* NFSV3_FLAG */
 		int nfsv3_data_offset =
 			nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
 
 		/* count value */
 		rlen = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
-		/* Skip unused values :
-			EOF:		32 bits value,
-			data_size:	32 bits value,
-		*/
-		data_ptr = (uchar *)
-			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
+		eof = rpc_pkt.u.reply.data[2 + nfsv3_data_offset] != 0;
+		/* Skip data_size */
+		data_offset = 4 + nfsv3_data_offset;
 	}
+	data_ptr = pkt + ((uchar *)&rpc_pkt.u.reply.data[data_offset] -
+			  rpc_pkt.u.data);
+	if (rlen < 0 || rlen > slot->len || data_ptr + rlen > pkt + len)
+		return -NFS_RPC_DROP;
 
-	if (store_block(data_ptr, nfs_offset, rlen))
+	if (store_block(data_ptr, slot->offset, rlen))
 			return -9999;
+	nfs_show_progress(rlen);
+
+	if (!rlen || eof) {
+		nfs_read_eof = true;
+		slot->id = 0;
+	} else if (rlen < slot->len) {
+		/*
+		 * The server reads less than asked for at a time: ask for
+		 * the rest, and for less from now on
+		 */
+		if (rlen < nfs_read_size)
+			nfs_read_size = max_t(int, rlen & ~(NFS_READ_SIZE - 1),
+					      NFS_READ_SIZE);
+		slot->offset += rlen;
+		slot->len -= rlen;
+		nfs_read_req(slot);
+	} else {
+		slot->id = 0;
+	}
 
 	return rlen;
 }
@@ -734,6 +915,9 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 	if (dest != nfs_our_port)
 		return;
+	/* Only READ replies may be bigger, drop late ones */
+	if (nfs_state != STATE_READ_REQ && len > sizeof(struct rpc_t))
+		return;
 
 	switch (nfs_state) {
 	case STATE_PRCLOOKUP_PROG_MOUNT_REQ:
@@ -794,14 +978,30 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			/* And retry with another supported version */
 			nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
 			nfs_send();
-		} else {
+		} else if (supported_nfs_versions & NFSV2_FLAG) {
+			nfs_read_size = min(NFS_READ_SIZE_MAX, NFS2_MAXDATA);
 			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
+			nfs_read_start();
+		} else if (NFS_READ_SIZE_MAX > NFS_READ_SIZE) {
+			nfs_read_size = NFS_READ_SIZE;
+			nfs_state = STATE_FSINFO_REQ;
 			nfs_send();
+		} else {
+			nfs_read_size = NFS_READ_SIZE;
+			nfs_state = STATE_READ_REQ;
+			nfs_read_start();
 		}
 		break;
 
+	case STATE_FSINFO_REQ:
+		reply = nfs3_fsinfo_reply(pkt, len);
+		if (reply == -NFS_RPC_DROP)
+			break;
+		/* Without the preferred size, just keep the reads small */
+		nfs_state = STATE_READ_REQ;
+		nfs_read_start();
+		break;
+
 	case STATE_READLINK_REQ:
 		reply = nfs_readlink_reply(pkt, len);
 		if (reply == -NFS_RPC_DROP) {
@@ -825,17 +1025,16 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		if (rlen == -NFS_RPC_DROP)
 			break;
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
-			nfs_send();
+		if (rlen >= 0 && !nfs_read_done()) {
+			nfs_read_fill();
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
+			if (rlen >= 0)
 				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
+			else
 				debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
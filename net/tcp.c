@@ -0,0 +1,671 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Minimal TCP
+ *
+ * Just what is needed to pull a file from a server or to have a host push
+ * one to us: active or passive open of a single connection, in-order
+ * delivery of the received data, with out-of-order segments queued and
+ * reported to the peer with selective acknowledgments (RFC 2018) so that
+ * a lost segment costs one retransmission rather than the whole window,
+ * one small segment of our own in flight, and closing. There is no
+ * congestion control as we hardly send anything.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <asm/unaligned.h>
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_LISTEN,
+	TCP_SYN_SENT,
+	TCP_SYN_RCVD,
+	TCP_ESTABLISHED,
+	TCP_FIN_WAIT,		/* We sent our FIN, still receiving */
+	TCP_LAST_ACK,		/* The peer closed, our FIN is in flight */
+};
+
+/* Retransmission timeout, doubled up to 8 times, and retries */
+#define TCP_RTO_MS		1000
+#define TCP_RETRIES		10
+
+/* Acknowledge at least every this many in-order segments */
+#define TCP_ACK_EVERY		2
+
+/* Option kinds */
+#define TCP_OPT_END		0
+#define TCP_OPT_NOP		1
+#define TCP_OPT_MSS		2
+#define TCP_OPT_SACK_PERM	4
+#define TCP_OPT_SACK		5
+
+/* SACK blocks per ACK, as many as fit in the option space */
+#define TCP_SACK_BLOCKS		4
+
+/* Segments we can queue ahead of a hole, and the window that allows */
+#define TCP_RX_SEGS		CONFIG_PROT_TCP_RX_SEGS
+#define TCP_WINDOW		min_t(unsigned int, TCP_RX_SEGS * TCP_MSS, 0xffff)
+
+/* A segment received ahead of a hole, free if @len is 0 */
+struct tcp_ooo_seg {
+	u32 seq;
+	u16 len;
+	uchar data[TCP_MSS];
+};
+
+static enum tcp_state tcp_state;
+static tcp_handler_f *tcp_handler;
+static struct in_addr tcp_remote_ip;
+static u16 tcp_remote_port;
+static u16 tcp_local_port;
+/* Port to wait on for the next connection, 0 for a client */
+static u16 tcp_listen_port;
+/* Oldest unacknowledged and next sequence numbers of ours */
+static u32 tcp_snd_una;
+static u32 tcp_snd_nxt;
+/* Next sequence number expected from the peer */
+static u32 tcp_rcv_nxt;
+/* The peer accepts SACK options */
+static bool tcp_sack_ok;
+/* In-order segments received since we last sent an ACK */
+static int tcp_unacked;
+static int tcp_retries;
+/* Our segment in flight, kept for retransmission */
+static bool tcp_tx_pending;
+static u8 tcp_tx_flags;
+static u32 tcp_tx_seq;
+static unsigned int tcp_tx_len;
+static uchar tcp_tx_data[TCP_MSS];
+/* Reassembly queue, and the start of the segment queued last */
+static struct tcp_ooo_seg *tcp_ooo;
+static u32 tcp_ooo_last;
+/* SACK blocks for the next ACK */
+static u32 tcp_sack[TCP_SACK_BLOCKS][2];
+static int tcp_sack_count;
+
+static inline bool tcp_seq_before(u32 a, u32 b)
+{
+	return (s32)(a - b) < 0;
+}
+
+static void tcp_timeout_handler(void);
+
+/* The peer is alive: restart the retransmission timer */
+static void tcp_progress(void)
+{
+	tcp_retries = 0;
+	net_set_timeout_handler(TCP_RTO_MS, tcp_timeout_handler);
+}
+
+/* The connection is over: a server goes back to listening */
+static void tcp_closed(void)
+{
+	tcp_state = tcp_listen_port ? TCP_LISTEN : TCP_CLOSED;
+	tcp_tx_pending = false;
+	net_set_timeout_handler(0, NULL);
+}
+
+static void tcp_reset(const char *msg)
+{
+	printf("\nTCP: %s\n", msg);
+	tcp_closed();
+	tcp_handler(TCP_EV_RESET, NULL, 0);
+}
+
+static int tcp_opts_len(u8 flags)
+{
+	if (flags & TCP_SYN)
+		return 8;	/* MSS, 2 x NOP and SACK permitted */
+	if (tcp_sack_count)
+		return 4 + 8 * tcp_sack_count;
+
+	return 0;
+}
+
+static u16 tcp_checksum(struct ip_tcp_hdr *ip, int tcp_len)
+{
+	unsigned int sum;
+
+	sum = compute_ip_pseudo_checksum(net_read_ip(&ip->ip_src),
+					 net_read_ip(&ip->ip_dst), IPPROTO_TCP,
+					 tcp_len);
+
+	/* The segment follows the 12-byte pseudo header */
+	return add_ip_checksums(12, sum,
+				compute_ip_checksum(&ip->tcp_src, tcp_len));
+}
+
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num)
+{
+	struct ip_tcp_hdr *ip = (struct ip_tcp_hdr *)pkt;
+	uchar *opt = pkt + IP_TCP_HDR_SIZE;
+	int opt_len = tcp_opts_len(action);
+	int tcp_len = TCP_HDR_SIZE + opt_len + payload_len;
+	int i;
+
+	if (action & TCP_SYN) {
+		opt[0] = TCP_OPT_MSS;
+		opt[1] = 4;
+		put_unaligned_be16(TCP_MSS, opt + 2);
+		opt[4] = TCP_OPT_NOP;
+		opt[5] = TCP_OPT_NOP;
+		opt[6] = TCP_OPT_SACK_PERM;
+		opt[7] = 2;
+	} else if (opt_len) {
+		opt[0] = TCP_OPT_NOP;
+		opt[1] = TCP_OPT_NOP;
+		opt[2] = TCP_OPT_SACK;
+		opt[3] = 2 + 8 * tcp_sack_count;
+		for (i = 0; i < tcp_sack_count; i++) {
+			put_unaligned_be32(tcp_sack[i][0], opt + 4 + 8 * i);
+			put_unaligned_be32(tcp_sack[i][1], opt + 8 + 8 * i);
+		}
+	}
+
+	net_set_ip_header(pkt, dest, net_ip, IP_HDR_SIZE + tcp_len,
+			  IPPROTO_TCP);
+
+	ip->tcp_src = htons(sport);
+	ip->tcp_dst = htons(dport);
+	ip->tcp_seq = htonl(tcp_seq_num);
+	ip->tcp_ack = htonl(action & TCP_ACK ? tcp_ack_num : 0);
+	ip->tcp_hlen = ((TCP_HDR_SIZE + opt_len) / 4) << 4;
+	ip->tcp_flags = action;
+	ip->tcp_win = htons(TCP_WINDOW);
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	if (eth_has_feature(ETH_FEATURE_TX_CSUM))
+		/* The MAC adds in the segment to the pseudo header sum */
+		ip->tcp_xsum = ~compute_ip_pseudo_checksum(
+			net_read_ip(&ip->ip_src), net_read_ip(&ip->ip_dst),
+			IPPROTO_TCP, tcp_len) & 0xffff;
+	else
+		ip->tcp_xsum = tcp_checksum(ip, tcp_len);
+
+	return IP_TCP_HDR_SIZE + opt_len;
+}
+
+static int tcp_send_segment(u8 flags, u32 seq, const void *data,
+			    unsigned int len)
+{
+	uchar *pkt = net_tx_packet + net_eth_hdr_size() + IP_TCP_HDR_SIZE +
+		     tcp_opts_len(flags);
+
+	if (len)
+		memcpy(pkt, data, len);
+	if (flags & TCP_ACK)
+		tcp_unacked = 0;
+
+	return net_send_ip_packet(net_server_ethaddr, tcp_remote_ip,
+				  tcp_remote_port, tcp_local_port, len,
+				  IPPROTO_TCP, flags, seq, tcp_rcv_nxt);
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+}
+
+/* Send a segment that is retransmitted until the peer acknowledges it */
+static int tcp_send_reliable(u8 flags, const void *data, unsigned int len)
+{
+	tcp_tx_pending = true;
+	tcp_tx_flags = flags;
+	tcp_tx_seq = tcp_snd_nxt;
+	tcp_tx_len = len;
+	if (len)
+		memcpy(tcp_tx_data, data, len);
+
+	/* SYN and FIN take a sequence number each */
+	tcp_snd_nxt += len + !!(flags & (TCP_SYN | TCP_FIN));
+	tcp_progress();
+
+	return tcp_send_segment(flags, tcp_tx_seq, data, len);
+}
+
+static void tcp_send_fin(void)
+{
+	if (!tcp_tx_pending) {
+		tcp_send_reliable(TCP_FIN | TCP_ACK, NULL, 0);
+		return;
+	}
+
+	/* Add the FIN to the segment still in flight */
+	tcp_tx_flags |= TCP_FIN;
+	tcp_snd_nxt++;
+	tcp_send_segment(tcp_tx_flags, tcp_tx_seq, tcp_tx_data, tcp_tx_len);
+}
+
+static void tcp_timeout_handler(void)
+{
+	/* With nothing of ours in flight, a server waits for its client */
+	if (tcp_listen_port && !tcp_tx_pending)
+		return;
+	if (++tcp_retries > TCP_RETRIES) {
+		tcp_reset("connection timed out");
+		return;
+	}
+
+	puts("T ");
+	net_set_timeout_handler(TCP_RTO_MS << min(tcp_retries, 3),
+				tcp_timeout_handler);
+	/* With nothing of ours in flight, re-advertise what we have */
+	if (tcp_tx_pending)
+		tcp_send_segment(tcp_tx_flags, tcp_tx_seq, tcp_tx_data,
+				 tcp_tx_len);
+	else
+		tcp_send_ack();
+}
+
+/*
+ * Describe the reassembly queue as SACK blocks, merging adjacent segments,
+ * with the block holding the latest segment first as RFC 2018 asks
+ */
+static void tcp_update_sack(void)
+{
+	u32 ranges[TCP_RX_SEGS][2];
+	int count = 0, merged = 0;
+	int first = -1;
+	int i, j;
+
+	tcp_sack_count = 0;
+	if (!tcp_sack_ok)
+		return;
+
+	for (i = 0; i < TCP_RX_SEGS; i++) {
+		struct tcp_ooo_seg *seg = &tcp_ooo[i];
+
+		if (!seg->len)
+			continue;
+		for (j = count; j > 0 &&
+		     tcp_seq_before(seg->seq, ranges[j - 1][0]); j--) {
+			ranges[j][0] = ranges[j - 1][0];
+			ranges[j][1] = ranges[j - 1][1];
+		}
+		ranges[j][0] = seg->seq;
+		ranges[j][1] = seg->seq + seg->len;
+		count++;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (merged &&
+		    !tcp_seq_before(ranges[merged - 1][1], ranges[i][0])) {
+			if (tcp_seq_before(ranges[merged - 1][1],
+					   ranges[i][1]))
+				ranges[merged - 1][1] = ranges[i][1];
+			continue;
+		}
+		ranges[merged][0] = ranges[i][0];
+		ranges[merged][1] = ranges[i][1];
+		merged++;
+	}
+
+	for (i = 0; i < merged; i++) {
+		if (!tcp_seq_before(tcp_ooo_last, ranges[i][0]) &&
+		    tcp_seq_before(tcp_ooo_last, ranges[i][1])) {
+			first = i;
+			tcp_sack[0][0] = ranges[i][0];
+			tcp_sack[0][1] = ranges[i][1];
+			tcp_sack_count = 1;
+			break;
+		}
+	}
+	for (i = 0; i < merged && tcp_sack_count < TCP_SACK_BLOCKS; i++) {
+		if (i == first)
+			continue;
+		tcp_sack[tcp_sack_count][0] = ranges[i][0];
+		tcp_sack[tcp_sack_count][1] = ranges[i][1];
+		tcp_sack_count++;
+	}
+}
+
+static void tcp_ooo_add(u32 seq, const uchar *data, unsigned int len)
+{
+	int free = -1;
+	int i;
+
+	/* Past the window we advertised */
+	if (len > TCP_MSS ||
+	    tcp_seq_before(tcp_rcv_nxt + TCP_WINDOW, seq + len))
+		return;
+
+	for (i = 0; i < TCP_RX_SEGS; i++) {
+		struct tcp_ooo_seg *seg = &tcp_ooo[i];
+
+		if (seg->len && seg->seq == seq && seg->len >= len)
+			return;
+		if (free < 0 && (!seg->len || seg->seq == seq))
+			free = i;
+	}
+	/* Queue full: the peer will retransmit it */
+	if (free < 0)
+		return;
+
+	tcp_ooo[free].seq = seq;
+	tcp_ooo[free].len = len;
+	memcpy(tcp_ooo[free].data, data, len);
+	tcp_ooo_last = seq;
+	tcp_update_sack();
+}
+
+static void tcp_deliver(const uchar *data, unsigned int len)
+{
+	tcp_rcv_nxt += len;
+	tcp_handler(TCP_EV_DATA, data, len);
+}
+
+/* Deliver what the segment just received made contiguous */
+static bool tcp_ooo_drain(void)
+{
+	bool found, drained = false;
+	int i;
+
+	do {
+		found = false;
+		for (i = 0; i < TCP_RX_SEGS; i++) {
+			struct tcp_ooo_seg *seg = &tcp_ooo[i];
+			u32 end = seg->seq + seg->len;
+
+			if (!seg->len)
+				continue;
+			if (tcp_seq_before(tcp_rcv_nxt, seg->seq))
+				continue;
+			if (tcp_seq_before(tcp_rcv_nxt, end)) {
+				tcp_deliver(seg->data + (tcp_rcv_nxt - seg->seq),
+					    end - tcp_rcv_nxt);
+				found = true;
+			}
+			seg->len = 0;
+			drained = true;
+		}
+	} while (found);
+
+	if (drained)
+		tcp_update_sack();
+
+	return drained;
+}
+
+static void tcp_process_ack(u32 ack)
+{
+	if (!tcp_seq_before(tcp_snd_una, ack) ||
+	    tcp_seq_before(tcp_snd_nxt, ack))
+		return;
+
+	tcp_snd_una = ack;
+	if (ack != tcp_snd_nxt)
+		return;
+
+	tcp_tx_pending = false;
+	tcp_progress();
+	if (tcp_state == TCP_LAST_ACK)
+		tcp_closed();
+	else if (tcp_state == TCP_ESTABLISHED)
+		tcp_handler(TCP_EV_SENT, NULL, 0);
+}
+
+static void tcp_process_data(u32 seq, const uchar *data, unsigned int len,
+			     u8 flags)
+{
+	u32 end = seq + len;
+	bool ack_now = false;
+
+	if (len) {
+		if (tcp_seq_before(seq, tcp_rcv_nxt)) {
+			/* Retransmitted, maybe with something new at the end */
+			if (!tcp_seq_before(tcp_rcv_nxt, end)) {
+				tcp_send_ack();
+				return;
+			}
+			data += tcp_rcv_nxt - seq;
+			len = end - tcp_rcv_nxt;
+			seq = tcp_rcv_nxt;
+		}
+
+		if (seq == tcp_rcv_nxt) {
+			tcp_deliver(data, len);
+			tcp_progress();
+			/* A filled hole must be reported straight away */
+			ack_now = tcp_ooo_drain() || (flags & TCP_PSH) ||
+				  ++tcp_unacked >= TCP_ACK_EVERY;
+		} else {
+			/* Duplicate ACK, with the SACK blocks updated */
+			tcp_ooo_add(seq, data, len);
+			ack_now = true;
+		}
+	}
+
+	if ((flags & TCP_FIN) && end == tcp_rcv_nxt &&
+	    (tcp_state == TCP_ESTABLISHED || tcp_state == TCP_FIN_WAIT)) {
+		tcp_rcv_nxt++;
+		if (tcp_state == TCP_FIN_WAIT) {
+			tcp_send_ack();
+			tcp_closed();
+		} else {
+			tcp_state = TCP_LAST_ACK;
+			tcp_send_fin();
+		}
+		tcp_handler(TCP_EV_CLOSED, NULL, 0);
+		return;
+	}
+
+	/* Includes a retransmitted FIN whose ACK got lost */
+	if (ack_now || (flags & TCP_FIN))
+		tcp_send_ack();
+}
+
+static void tcp_parse_syn_options(const uchar *opt, int len)
+{
+	tcp_sack_ok = false;
+
+	while (len > 0) {
+		if (opt[0] == TCP_OPT_END)
+			break;
+		if (opt[0] == TCP_OPT_NOP) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (len < 2 || opt[1] < 2 || opt[1] > len)
+			break;
+		if (opt[0] == TCP_OPT_SACK_PERM)
+			tcp_sack_ok = true;
+		len -= opt[1];
+		opt += opt[1];
+	}
+}
+
+static int tcp_alloc(void)
+{
+	if (!tcp_ooo) {
+		tcp_ooo = malloc(TCP_RX_SEGS * sizeof(*tcp_ooo));
+		if (!tcp_ooo)
+			return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/* Forget everything about the previous connection */
+static void tcp_init_conn(void)
+{
+	int i;
+
+	for (i = 0; i < TCP_RX_SEGS; i++)
+		tcp_ooo[i].len = 0;
+	tcp_sack_ok = false;
+	tcp_sack_count = 0;
+	tcp_unacked = 0;
+	tcp_snd_una = (u32)get_ticks();
+	tcp_snd_nxt = tcp_snd_una;
+}
+
+/* A SYN for the port we listen on */
+static void tcp_accept(struct ip_tcp_hdr *ip, u32 seq, int hlen)
+{
+	struct in_addr src = net_read_ip(&ip->ip_src);
+
+	/* A new host may well have another ethernet address */
+	if (src.s_addr != tcp_remote_ip.s_addr)
+		memset(net_server_ethaddr, 0, 6);
+	tcp_remote_ip = src;
+	tcp_remote_port = ntohs(ip->tcp_src);
+
+	tcp_init_conn();
+	tcp_parse_syn_options((uchar *)(ip + 1), hlen - TCP_HDR_SIZE);
+	tcp_rcv_nxt = seq + 1;
+	tcp_state = TCP_SYN_RCVD;
+	tcp_send_reliable(TCP_SYN | TCP_ACK, NULL, 0);
+}
+
+void tcp_receive(struct ip_tcp_hdr *ip, unsigned int len)
+{
+	int hlen = (ip->tcp_hlen >> 4) * 4;
+	u8 flags = ip->tcp_flags;
+	const uchar *data;
+	u32 seq, ack;
+
+	if (tcp_state == TCP_CLOSED || len < IP_TCP_HDR_SIZE ||
+	    hlen < TCP_HDR_SIZE || IP_HDR_SIZE + hlen > len)
+		return;
+	if (ntohs(ip->tcp_dst) != tcp_local_port)
+		return;
+	if (tcp_state != TCP_LISTEN &&
+	    (net_read_ip(&ip->ip_src).s_addr != tcp_remote_ip.s_addr ||
+	     ntohs(ip->tcp_src) != tcp_remote_port))
+		return;
+	if (!net_rx_csum_ok && tcp_checksum(ip, len - IP_HDR_SIZE)) {
+		debug("TCP: bad checksum\n");
+		return;
+	}
+
+	seq = ntohl(ip->tcp_seq);
+	ack = ntohl(ip->tcp_ack);
+	data = (uchar *)ip + IP_HDR_SIZE + hlen;
+	len -= IP_HDR_SIZE + hlen;
+
+	if (flags & TCP_RST) {
+		/* Before the handshake, only if it answers our SYN */
+		if (tcp_state == TCP_LISTEN ||
+		    (tcp_state == TCP_SYN_SENT &&
+		     (!(flags & TCP_ACK) || ack != tcp_snd_nxt)))
+			return;
+		tcp_reset(tcp_state == TCP_SYN_SENT ? "connection refused" :
+			  "connection reset by peer");
+		return;
+	}
+
+	if (tcp_state == TCP_LISTEN) {
+		if ((flags & (TCP_SYN | TCP_ACK)) == TCP_SYN)
+			tcp_accept(ip, seq, hlen);
+		return;
+	}
+
+	if (tcp_state == TCP_SYN_RCVD) {
+		/* A retransmitted SYN is answered by our own timer */
+		if ((flags & (TCP_SYN | TCP_ACK)) != TCP_ACK ||
+		    ack != tcp_snd_nxt)
+			return;
+		tcp_snd_una = ack;
+		tcp_tx_pending = false;
+		tcp_state = TCP_ESTABLISHED;
+		tcp_progress();
+		tcp_handler(TCP_EV_CONNECTED, NULL, 0);
+		/* The ACK may carry data already */
+	}
+
+	if (tcp_state == TCP_SYN_SENT) {
+		if ((flags & (TCP_SYN | TCP_ACK)) != (TCP_SYN | TCP_ACK) ||
+		    ack != tcp_snd_nxt)
+			return;
+		tcp_parse_syn_options((uchar *)(ip + 1), hlen - TCP_HDR_SIZE);
+		tcp_rcv_nxt = seq + 1;
+		tcp_snd_una = ack;
+		tcp_tx_pending = false;
+		tcp_state = TCP_ESTABLISHED;
+		tcp_progress();
+		tcp_send_ack();
+		tcp_handler(TCP_EV_CONNECTED, NULL, 0);
+		return;
+	}
+
+	if (flags & TCP_ACK)
+		tcp_process_ack(ack);
+	if ((tcp_state == TCP_ESTABLISHED || tcp_state == TCP_FIN_WAIT ||
+	     tcp_state == TCP_LAST_ACK) && (len || (flags & TCP_FIN)))
+		tcp_process_data(seq, data, len, flags);
+}
+
+int tcp_connect(struct in_addr dest, u16 dport, tcp_handler_f *handler)
+{
+	if (tcp_alloc())
+		return -ENOMEM;
+	tcp_init_conn();
+
+	tcp_remote_ip = dest;
+	tcp_remote_port = dport;
+	/* Pick a new port each time, the server may still know the old one */
+	tcp_local_port = 49152 + (get_ticks() & 0x3fff);
+	tcp_listen_port = 0;
+	tcp_handler = handler;
+	tcp_state = TCP_SYN_SENT;
+
+	/* zero out server ether in case the server ip has changed */
+	memset(net_server_ethaddr, 0, 6);
+
+	return tcp_send_reliable(TCP_SYN, NULL, 0) < 0 ? -EIO : 0;
+}
+
+int tcp_listen(u16 port, tcp_handler_f *handler)
+{
+	if (tcp_alloc())
+		return -ENOMEM;
+
+	tcp_local_port = port;
+	tcp_listen_port = port;
+	tcp_handler = handler;
+	tcp_remote_ip.s_addr = 0;
+	tcp_closed();
+
+	return 0;
+}
+
+int tcp_send(const void *data, unsigned int len)
+{
+	if (tcp_state != TCP_ESTABLISHED)
+		return -ENOTCONN;
+	if (len > TCP_MSS)
+		return -EINVAL;
+	if (!tcp_tx_pending)
+		return tcp_send_reliable(TCP_ACK | TCP_PSH, data, len) < 0 ?
+		       -EIO : 0;
+
+	/* Add it to the segment in flight, which is sent again */
+	if (tcp_tx_len + len > TCP_MSS)
+		return -EBUSY;
+	memcpy(tcp_tx_data + tcp_tx_len, data, len);
+	tcp_tx_len += len;
+	tcp_snd_nxt += len;
+
+	return tcp_send_segment(tcp_tx_flags, tcp_tx_seq, tcp_tx_data,
+				tcp_tx_len) < 0 ? -EIO : 0;
+}
+
+void tcp_close(void)
+{
+	if (tcp_state != TCP_ESTABLISHED)
+		return;
+
+	tcp_state = TCP_FIN_WAIT;
+	tcp_send_fin();
+}
+
+void tcp_stop(void)
+{
+	tcp_listen_port = 0;
+	tcp_closed();
+}
@@ -140,6 +140,85 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440 windowsize: the server sends this many blocks before waiting
+ * for an ACK. 1 is plain lock-step RFC 1350 and is not negotiated.
+ */
+static unsigned short tftp_window_size = 1;
+static unsigned short tftp_window_size_option = CONFIG_TFTP_WINDOWSIZE;
+/* block number whose arrival completes the current window */
+static unsigned short tftp_next_ack;
+/* block number last re-acknowledged after a gap, -1 if none */
+static int	tftp_last_nack;
+
+#ifdef CONFIG_TFTP_MCAST
+/*
+ * RFC 2090 multicast: the server sends the file to a multicast group and
+ * one client at a time, the master client, acknowledges the blocks. The
+ * other clients keep every block they see, and ask for the ones they
+ * missed once the server makes them the master. Block numbers must not
+ * wrap, so files are limited to 65534 full blocks.
+ */
+/* 1 to ask the server for multicast (tftpmcast environment variable) */
+static int	tftp_mcast_enabled;
+/* 1 once the group is joined */
+static int	tftp_mcast_active;
+/* 1 while we are the client which acknowledges blocks */
+static int	tftp_mcast_master;
+/* UDP port the group is sent to */
+static int	tftp_mcast_port;
+/* Number of blocks in the file, 0 until the last block is seen */
+static ulong	tftp_mcast_blocks;
+/* Number of different blocks received */
+static ulong	tftp_mcast_received;
+/* Lowest block not received yet */
+static ulong	tftp_mcast_missing;
+/* Bit n is set once block n + 1 is received */
+static u8	tftp_mcast_bitmap[TFTP_SEQUENCE_SIZE / 8];
+#endif
+
+#if defined(CONFIG_NET_RX_LEND) && defined(CONFIG_TFTP_TSIZE) && \
+	!defined(CONFIG_SYS_DIRECT_FLASH_TFTP)
+#define TFTP_RX_LEND
+/* TFTP data payloads start after the opcode and block number */
+#define TFTP_RX_LEND_HDR_LEN	(ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + 4)
+/* Next block, counted from 1 across wraps, that may be lent to the driver */
+static ulong	tftp_lend_next;
+
+/*
+ * Lend the driver the place of the block it will receive into this buffer
+ * if every frame ahead of it is the next data block. That block and those
+ * after it cannot be stored before the buffer is used, so whatever else
+ * the DMA puts there is harmless: only a block arriving in the buffer lent
+ * for it skips the copy, all others are copied from wherever they landed.
+ */
+static int tftp_lend(int ahead, uchar **datap)
+{
+	ulong block = tftp_block_wrap * TFTP_SEQUENCE_SIZE + tftp_cur_block +
+		      1 + ahead;
+	ulong offset;
+
+	if (tftp_state != STATE_OACK && tftp_state != STATE_DATA)
+		return 0;
+
+	block = max(block, tftp_lend_next);
+	offset = (block - 1) * tftp_block_size;
+	/* Blocks must not share cache lines, nor go past the file */
+	if (tftp_block_size % ARCH_DMA_MINALIGN ||
+	    offset + tftp_block_size > tftp_tsize)
+		return 0;
+#ifdef CONFIG_LMB
+	if (tftp_tsize > tftp_load_size)
+		return 0;
+#endif
+
+	tftp_lend_next = block + 1;
+	*datap = map_sysmem(tftp_load_addr + offset, 0);
+
+	return tftp_tsize - offset;
+}
+#endif
+
 static inline int store_block(int block, uchar *src, unsigned int len)
 {
 	ulong offset = block * tftp_block_size + tftp_block_wrap_offset;
@@ -178,7 +257,9 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 		}
 #endif
 		ptr = map_sysmem(store_addr, len);
-		memcpy(ptr, src, len);
+		/* Unless the driver put the data there already */
+		if (!net_rx_split_to(src, ptr))
+			memcpy(ptr, src, len);
 		unmap_sysmem(ptr);
 	}
 
@@ -225,6 +306,18 @@ static int load_block(unsigned block, uchar *dst, unsigned len)
 static void tftp_send(void);
 static void tftp_timeout_handler(void);
 
+#ifdef CONFIG_TFTP_MCAST
+/* Leave the group, if any */
+static void tftp_mcast_stop(void)
+{
+	if (tftp_mcast_active)
+		eth_mcast_join(net_mcast_addr, 0);
+	net_mcast_addr.s_addr = 0;
+	tftp_mcast_active = 0;
+	tftp_mcast_master = 0;
+}
+#endif
+
 /**********************************************************************/
 
 static void show_block_marker(void)
@@ -302,6 +395,10 @@ static void tftp_complete(void)
 			time_start * 1000, "/s");
 	}
 	puts("\ndone\n");
+	net_set_rx_lender(NULL, 0, 0);
+#ifdef CONFIG_TFTP_MCAST
+	tftp_mcast_stop();
+#endif
 	net_set_state(NETLOOP_SUCCESS);
 }
 
@@ -346,6 +443,15 @@ static void tftp_send(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
+#ifdef CONFIG_TFTP_MCAST
+		/* Multicast transfers are lock-step, without a window */
+		if (tftp_state == STATE_SEND_RRQ && tftp_mcast_enabled)
+			pkt += sprintf((char *)pkt, "multicast%c%c", 0, 0);
+		else
+#endif
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, tftp_window_size_option, 0);
 		len = pkt - xp;
 		break;
 
@@ -411,14 +517,127 @@ static void icmp_handler(unsigned type, unsigned code, unsigned dest,
 }
 #endif
 
+#ifdef CONFIG_TFTP_MCAST
+/* Give up on a multicast transfer */
+static void tftp_mcast_fail(void)
+{
+	tftp_mcast_stop();
+	eth_halt();
+	net_set_state(NETLOOP_FAIL);
+}
+
+/* As master client, ask the server for the lowest block still missing */
+static void tftp_mcast_ack(void)
+{
+	tftp_cur_block = tftp_mcast_missing - 1;
+	tftp_send();
+}
+
+/*
+ * Handle the value of the multicast option of an OACK, "<addr>,<port>,<mc>".
+ * The first one gives the group to join, the later ones only tell whether
+ * we are the master client.
+ */
+static int tftp_mcast_oack(const char *opt)
+{
+	struct in_addr addr;
+	const char *port, *mc;
+
+	port = strchr(opt, ',');
+	mc = port ? strchr(port + 1, ',') : NULL;
+	if (!mc)
+		return -EINVAL;
+	tftp_mcast_master = simple_strtoul(mc + 1, NULL, 10) == 1;
+	tftp_state = STATE_DATA;
+	if (tftp_mcast_active)
+		return 0;
+
+	addr = string_to_ip(opt);
+	if (!addr.s_addr)
+		return -EINVAL;
+#ifdef CONFIG_TFTP_TSIZE
+	if (tftp_tsize / tftp_block_size >= TFTP_SEQUENCE_SIZE - 1) {
+		puts("\nTFTP error: file too large for multicast\n");
+		return -EFBIG;
+	}
+#endif
+	if (eth_mcast_join(addr, 1)) {
+		printf("\nTFTP error: %s cannot join multicast group %pI4\n",
+		       eth_get_name(), &addr);
+		return -ENOSYS;
+	}
+	net_mcast_addr = addr;
+	tftp_mcast_port = simple_strtoul(port + 1, NULL, 10);
+	tftp_mcast_active = 1;
+	tftp_mcast_blocks = 0;
+	tftp_mcast_received = 0;
+	tftp_mcast_missing = 1;
+	memset(tftp_mcast_bitmap, '\0', sizeof(tftp_mcast_bitmap));
+	new_transfer();
+
+	return 0;
+}
+
+/* Store a block received during a multicast transfer, in any order */
+static void tftp_mcast_data(unsigned short block, uchar *data, unsigned len)
+{
+	ulong n = block - 1;
+
+	timeout_count = 0;
+	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+	if (!block || len > tftp_block_size)
+		return;
+
+	if (!(tftp_mcast_bitmap[n / 8] & BIT(n % 8))) {
+		if (len == tftp_block_size && block == TFTP_SEQUENCE_SIZE - 1) {
+			puts("\nTFTP error: file too large for multicast\n");
+			tftp_mcast_fail();
+			return;
+		}
+		if (store_block(n, data, len)) {
+			tftp_mcast_fail();
+			return;
+		}
+		tftp_mcast_bitmap[n / 8] |= BIT(n % 8);
+		tftp_mcast_received++;
+		if (len < tftp_block_size)
+			tftp_mcast_blocks = block;
+		for (n = tftp_mcast_missing - 1;
+		     tftp_mcast_bitmap[n / 8] & BIT(n % 8); n++)
+			tftp_mcast_missing++;
+
+		tftp_cur_block = tftp_mcast_received;
+		show_block_marker();
+	}
+
+	if (tftp_mcast_blocks && tftp_mcast_received == tftp_mcast_blocks) {
+		/* Let the server move on to the next client */
+		if (tftp_mcast_master) {
+			tftp_cur_block = tftp_mcast_blocks;
+			tftp_send();
+		}
+		tftp_complete();
+	} else if (tftp_mcast_master) {
+		tftp_mcast_ack();
+	}
+}
+#endif
+
 static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 unsigned src, unsigned len)
 {
 	__be16 proto;
 	__be16 *s;
+	unsigned short block;
 	int i;
+#ifdef CONFIG_TFTP_MCAST
+	char *mcast_opt = NULL;
+#endif
 
 	if (dest != tftp_our_port) {
+#ifdef CONFIG_TFTP_MCAST
+		if (!tftp_mcast_active || dest != tftp_mcast_port)
+#endif
 			return;
 	}
 	if (tftp_state != STATE_SEND_RRQ && src != tftp_remote_port &&
@@ -432,6 +651,9 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	s = (__be16 *)pkt;
 	proto = *s++;
 	pkt = (uchar *)s;
+	/* Only data payloads may stay in a lent buffer */
+	if (ntohs(proto) != TFTP_DATA)
+		net_rx_linearize();
 	switch (ntohs(proto)) {
 	case TFTP_RRQ:
 		break;
@@ -490,6 +712,15 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("Blocksize ack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
 			}
+			if (strcmp((char *)pkt + i, "windowsize") == 0) {
+				tftp_window_size = (unsigned short)
+					simple_strtoul((char *)pkt + i + 11,
+						       NULL, 10);
+				if (!tftp_window_size)
+					tftp_window_size = 1;
+				debug("Windowsize ack: %s, %d\n",
+				      (char *)pkt + i + 11, tftp_window_size);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				tftp_tsize = simple_strtoul((char *)pkt + i + 6,
@@ -498,13 +729,34 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				      (char *)pkt + i + 6, tftp_tsize);
 			}
 #endif
+#ifdef CONFIG_TFTP_MCAST
+			if (strcmp((char *)pkt + i, "multicast") == 0)
+				mcast_opt = (char *)pkt + i + 10;
+#endif
+		}
+#ifdef CONFIG_TFTP_MCAST
+		if (mcast_opt) {
+			if (tftp_mcast_oack(mcast_opt)) {
+				tftp_mcast_fail();
+				break;
+			}
+			if (tftp_mcast_master)
+				tftp_mcast_ack();
+			break;
 		}
+#endif
 #ifdef CONFIG_CMD_TFTPPUT
 		if (tftp_put_active) {
 			/* Get ready to send the first block */
 			tftp_state = STATE_DATA;
 			tftp_cur_block++;
 		}
+#endif
+		tftp_next_ack = tftp_window_size;
+#ifdef TFTP_RX_LEND
+		if (!tftp_put_active)
+			net_set_rx_lender(tftp_lend, TFTP_RX_LEND_HDR_LEN,
+					  tftp_our_port);
 #endif
 		tftp_send(); /* Send ACK or first data block */
 		break;
@@ -512,12 +764,20 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		if (len < 2)
 			return;
 		len -= 2;
-		tftp_cur_block = ntohs(*(__be16 *)pkt);
-
-		update_block_number();
+		block = ntohs(*(__be16 *)pkt);
 
-		if (tftp_state == STATE_SEND_RRQ)
+#ifdef CONFIG_TFTP_MCAST
+		if (tftp_mcast_active) {
+			tftp_mcast_data(block, pkt + 2, len);
+			break;
+		}
+#endif
+		if (tftp_state == STATE_SEND_RRQ) {
 			debug("Server did not acknowledge timeout option!\n");
+			/* No OACK means no windowsize either */
+			tftp_window_size = 1;
+			tftp_next_ack = 1;
+		}
 
 		if (tftp_state == STATE_SEND_RRQ || tftp_state == STATE_OACK ||
 		    tftp_state == STATE_RECV_WRQ) {
@@ -526,21 +786,43 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			tftp_remote_port = src;
 			new_transfer();
 
-			if (tftp_cur_block != 1) {	/* Assertion */
+			if (block != 1) {	/* Assertion */
 				puts("\nTFTP error: ");
-				printf("First block is not block 1 (%ld)\n",
-				       tftp_cur_block);
+				printf("First block is not block 1 (%d)\n",
+				       block);
 				puts("Starting again\n\n");
 				net_start_again();
 				break;
 			}
 		}
 
-		if (tftp_cur_block == tftp_prev_block) {
-			/* Same block again; ignore it. */
+		if (block != (unsigned short)(tftp_cur_block + 1)) {
+			/*
+			 * Blocks from before the expected one are duplicates,
+			 * e.g. a window the server is resending; drop them.
+			 */
+			if ((short)(block - (tftp_cur_block + 1)) < 0)
+				break;
+			/*
+			 * A block went missing. Re-acknowledge the last one
+			 * we have so the server restarts the window from
+			 * there (RFC 7440 section 4), but only once for
+			 * each gap: the rest of the window will be out of
+			 * order too.
+			 */
+			debug("Received block %d, expected %d\n", block,
+			      (unsigned short)(tftp_cur_block + 1));
+			if (tftp_last_nack != (int)tftp_cur_block) {
+				tftp_last_nack = tftp_cur_block;
+				tftp_next_ack = tftp_cur_block +
+						tftp_window_size;
+				tftp_send();
+			}
 			break;
 		}
 
+		tftp_cur_block = block;
+		update_block_number();
 		tftp_prev_block = tftp_cur_block;
 		timeout_count_max = tftp_timeout_count_max;
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
@@ -552,18 +834,25 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		}
 
 		/*
-		 *	Acknowledge the block just received, which will prompt
-		 *	the remote for the next one.
+		 *	Acknowledge the last block of each window, and the
+		 *	final block, which will prompt the remote for the
+		 *	next window.
 		 */
-		tftp_send();
-
-		if (len < tftp_block_size)
+		if (len < tftp_block_size) {
+			tftp_send();
 			tftp_complete();
+		} else if (block == tftp_next_ack) {
+			tftp_send();
+			tftp_next_ack += tftp_window_size;
+		}
 		break;
 
 	case TFTP_ERROR:
 		printf("\nTFTP error: '%s' (%d)\n",
 		       pkt + 2, ntohs(*(__be16 *)pkt));
+#ifdef CONFIG_TFTP_MCAST
+		tftp_mcast_stop();
+#endif
 
 		switch (ntohs(*(__be16 *)pkt)) {
 		case TFTP_ERR_FILE_NOT_FOUND:
@@ -594,6 +883,17 @@ static void tftp_timeout_handler(void)
 	} else {
 		puts("T ");
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+#ifdef CONFIG_TFTP_MCAST
+		/* Only the master client may ask the server for blocks */
+		if (tftp_mcast_active) {
+			if (tftp_mcast_master)
+				tftp_mcast_ack();
+			return;
+		}
+#endif
+		/* The ACK below makes the server resend the whole window */
+		if (tftp_state == STATE_DATA && !tftp_put_active)
+			tftp_next_ack = tftp_cur_block + tftp_window_size;
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
 	}
@@ -632,6 +932,10 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_block_size_option = simple_strtol(ep, NULL, 10);
 
+	ep = env_get("tftpwindowsize");
+	if (ep != NULL)
+		tftp_window_size_option = simple_strtol(ep, NULL, 10);
+
 	ep = env_get("tftptimeout");
 	if (ep != NULL)
 		timeout_ms = simple_strtol(ep, NULL, 10);
@@ -653,8 +957,14 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-	      tftp_block_size_option, timeout_ms);
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
+
+#ifdef CONFIG_TFTP_MCAST
+	/* Leave the group of an earlier attempt */
+	tftp_mcast_stop();
+	tftp_mcast_enabled = env_get_yesno("tftpmcast") == 1;
+#endif
 
 	tftp_remote_ip = net_server_ip;
 	if (!net_parse_bootfile(&tftp_remote_ip, tftp_filename, MAX_LEN)) {
@@ -753,8 +1063,14 @@ void tftp_start(enum proto_t protocol)
 
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_window_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_window_size = 1;
+	tftp_next_ack = 0;
+	tftp_last_nack = -1;
+#ifdef TFTP_RX_LEND
+	tftp_lend_next = 0;
+#endif
 #ifdef CONFIG_TFTP_TSIZE
 	tftp_tsize = 0;
 	tftp_tsize_num_hash = 0;
@@ -785,8 +1101,11 @@ void tftp_start_server(void)
 	timeout_ms = TIMEOUT;
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_window_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_window_size = 1;
+	tftp_next_ack = 1;
+	tftp_last_nack = -1;
 	tftp_cur_block = 0;
 	tftp_our_port = WELL_KNOWN_PORT;
 
@@ -0,0 +1,516 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HTTP download
+ *
+ * Fetch a file with an HTTP/1.0 GET, which keeps the server from using
+ * chunked encoding, and stream the body to memory at load_addr or to a
+ * storage sink as it arrives. Only servers given by IP address are
+ * supported, there is no DNS lookup.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <lmb.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <memalign.h>
+#include <net.h>
+#include <spi_flash.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define HTTP_PORT		80
+#define WGET_PATH_MAX		256
+#define WGET_HDR_MAX		2048
+/* One hash mark per 64 KiB, 50 to a line */
+#define WGET_HASH_BYTES		(64 << 10)
+#define WGET_HASHES_PER_LINE	50
+/* Blocks gathered in memory per block device write */
+#define WGET_BLK_BATCH		128
+
+static struct in_addr wget_server_ip;
+static u16 wget_server_port;
+static char wget_path[WGET_PATH_MAX];
+static char *wget_url;
+/* Response header, until the empty line */
+static char wget_hdr[WGET_HDR_MAX];
+static unsigned int wget_hdr_len;
+static bool wget_in_body;
+static bool wget_have_len;
+static ulong wget_content_len;
+static ulong wget_received;
+static ulong wget_next_hash;
+static int wget_num_hash;
+static ulong wget_time_start;
+static bool wget_done;
+static struct wget_sink *wget_sink;
+
+static ulong wget_load_addr;
+#ifdef CONFIG_LMB
+static ulong wget_load_size;
+#endif
+
+void wget_set_sink(struct wget_sink *sink)
+{
+	wget_sink = sink;
+}
+
+static int wget_mem_write(struct wget_sink *sink, ulong offset,
+			  const void *buf, size_t len)
+{
+	void *ptr;
+
+#ifdef CONFIG_LMB
+	if (offset + len > wget_load_size)
+		return -ENOSPC;
+#endif
+	ptr = map_sysmem(wget_load_addr + offset, len);
+	memcpy(ptr, buf, len);
+	unmap_sysmem(ptr);
+
+	return 0;
+}
+
+static struct wget_sink wget_mem_sink = {
+	.write = wget_mem_write,
+};
+
+static int wget_init_load_addr(void)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t max_size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	max_size = lmb_get_free_size(&lmb, load_addr);
+	if (!max_size)
+		return -1;
+
+	wget_load_size = max_size;
+#endif
+	wget_load_addr = load_addr;
+	return 0;
+}
+
+#ifdef CONFIG_HAVE_BLOCK_DEVICE
+struct wget_blk_sink {
+	struct blk_desc *desc;
+	lbaint_t start;
+	lbaint_t count;
+	lbaint_t next;
+	uchar *buf;
+	ulong buf_size;
+	ulong fill;
+};
+
+static struct wget_blk_sink wget_blk;
+
+/* Write out what was gathered, the last block padded with zeroes */
+static int wget_blk_flush(struct wget_blk_sink *bs)
+{
+	ulong blksz = bs->desc->blksz;
+	lbaint_t blks = DIV_ROUND_UP(bs->fill, blksz);
+
+	if (!blks)
+		return 0;
+	if (bs->next + blks > bs->count)
+		return -ENOSPC;
+
+	memset(bs->buf + bs->fill, 0, blks * blksz - bs->fill);
+	if (blk_dwrite(bs->desc, bs->start + bs->next, blks, bs->buf) != blks)
+		return -EIO;
+
+	bs->next += blks;
+	bs->fill = 0;
+	return 0;
+}
+
+static int wget_blk_write(struct wget_sink *sink, ulong offset,
+			  const void *buf, size_t len)
+{
+	struct wget_blk_sink *bs = sink->priv;
+	size_t n;
+	int ret;
+
+	while (len) {
+		n = min(len, (size_t)(bs->buf_size - bs->fill));
+		memcpy(bs->buf + bs->fill, buf, n);
+		bs->fill += n;
+		buf += n;
+		len -= n;
+		if (bs->fill == bs->buf_size) {
+			ret = wget_blk_flush(bs);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int wget_blk_finish(struct wget_sink *sink, ulong size)
+{
+	return wget_blk_flush(sink->priv);
+}
+
+static struct wget_sink wget_blk_sink = {
+	.write = wget_blk_write,
+	.finish = wget_blk_finish,
+	.priv = &wget_blk,
+};
+
+int wget_set_blk_sink(struct blk_desc *desc, lbaint_t start, lbaint_t count)
+{
+	ulong size = WGET_BLK_BATCH * desc->blksz;
+
+	if (wget_blk.buf_size != size) {
+		free(wget_blk.buf);
+		wget_blk.buf_size = 0;
+		wget_blk.buf = malloc_cache_aligned(size);
+		if (!wget_blk.buf)
+			return -ENOMEM;
+		wget_blk.buf_size = size;
+	}
+	wget_blk.desc = desc;
+	wget_blk.start = start;
+	wget_blk.count = count;
+	wget_blk.next = 0;
+	wget_blk.fill = 0;
+	wget_set_sink(&wget_blk_sink);
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_SPI_FLASH
+struct wget_sf_sink {
+	struct spi_flash *flash;
+	u32 offset;
+	u32 size;
+	u32 next;
+	uchar *buf;
+	u32 buf_size;
+	u32 fill;
+};
+
+static struct wget_sf_sink wget_sf;
+
+/* Erase the next sector and program what was gathered for it */
+static int wget_sf_flush(struct wget_sf_sink *ss)
+{
+	u32 offset = ss->offset + ss->next;
+	int ret;
+
+	if (!ss->fill)
+		return 0;
+	if (ss->next + ss->buf_size > ss->size)
+		return -ENOSPC;
+
+	ret = spi_flash_erase(ss->flash, offset, ss->buf_size);
+	if (!ret)
+		ret = spi_flash_write(ss->flash, offset, ss->fill, ss->buf);
+	if (ret)
+		return ret;
+
+	ss->next += ss->buf_size;
+	ss->fill = 0;
+	return 0;
+}
+
+static int wget_sf_write(struct wget_sink *sink, ulong offset,
+			 const void *buf, size_t len)
+{
+	struct wget_sf_sink *ss = sink->priv;
+	size_t n;
+	int ret;
+
+	while (len) {
+		n = min(len, (size_t)(ss->buf_size - ss->fill));
+		memcpy(ss->buf + ss->fill, buf, n);
+		ss->fill += n;
+		buf += n;
+		len -= n;
+		if (ss->fill == ss->buf_size) {
+			ret = wget_sf_flush(ss);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int wget_sf_finish(struct wget_sink *sink, ulong size)
+{
+	return wget_sf_flush(sink->priv);
+}
+
+static struct wget_sink wget_sf_sink = {
+	.write = wget_sf_write,
+	.finish = wget_sf_finish,
+	.priv = &wget_sf,
+};
+
+int wget_set_sf_sink(struct spi_flash *flash, u32 offset, u32 size)
+{
+	u32 sector = flash->erase_size;
+
+	if (offset % sector || offset >= flash->size)
+		return -EINVAL;
+
+	if (wget_sf.buf_size != sector) {
+		free(wget_sf.buf);
+		wget_sf.buf_size = 0;
+		wget_sf.buf = malloc(sector);
+		if (!wget_sf.buf)
+			return -ENOMEM;
+		wget_sf.buf_size = sector;
+	}
+	wget_sf.flash = flash;
+	wget_sf.offset = offset;
+	wget_sf.size = min(size, flash->size - offset);
+	wget_sf.next = 0;
+	wget_sf.fill = 0;
+	wget_set_sink(&wget_sf_sink);
+
+	return 0;
+}
+#endif
+
+static void wget_stop(enum net_loop_state state)
+{
+	wget_done = true;
+	wget_sink = NULL;
+	net_set_timeout_handler(0, NULL);
+	net_set_state(state);
+}
+
+static void wget_fail(const char *msg)
+{
+	printf("\nwget: %s\n", msg);
+	tcp_close();
+	wget_stop(NETLOOP_FAIL);
+}
+
+static void wget_complete(void)
+{
+	ulong time;
+
+	if (wget_sink->finish &&
+	    wget_sink->finish(wget_sink, wget_received)) {
+		wget_fail("cannot store the end of the file");
+		return;
+	}
+
+	net_boot_file_size = wget_received;
+	puts("  ");
+	print_size(wget_received, "");
+	time = get_timer(wget_time_start);
+	if (time > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(wget_received / time * 1000, "/s");
+	}
+	puts("\ndone\n");
+	wget_stop(NETLOOP_SUCCESS);
+}
+
+static void wget_send_request(void)
+{
+	char req[TCP_MSS];
+	int len;
+
+	len = snprintf(req, sizeof(req),
+		       "GET %s HTTP/1.0\r\n"
+		       "Host: %pI4:%u\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "Connection: close\r\n\r\n",
+		       wget_url, &wget_server_ip, wget_server_port);
+	if (len >= sizeof(req)) {
+		wget_fail("file name too long");
+		return;
+	}
+	if (tcp_send(req, len))
+		wget_fail("cannot send the request");
+}
+
+/* Check the status line and pick up the length of the body */
+static int wget_parse_header(void)
+{
+	char *line, *p;
+	int status = 0;
+
+	if (!strncmp(wget_hdr, "HTTP/1.", 7)) {
+		p = strchr(wget_hdr, ' ');
+		if (p)
+			status = simple_strtoul(p + 1, NULL, 10);
+	}
+	if (status != 200) {
+		line = strstr(wget_hdr, "\r\n");
+		printf("\nwget: server replied '%.*s'\n",
+		       (int)(line - wget_hdr), wget_hdr);
+		tcp_close();
+		wget_stop(NETLOOP_FAIL);
+		return -1;
+	}
+
+	wget_have_len = false;
+	for (line = strstr(wget_hdr, "\r\n"); line;
+	     line = strstr(line, "\r\n")) {
+		line += 2;
+		if (strncasecmp(line, "Content-Length:", 15))
+			continue;
+		for (p = line + 15; *p == ' ' || *p == '\t'; p++)
+			;
+		wget_content_len = simple_strtoul(p, NULL, 10);
+		wget_have_len = true;
+	}
+
+	return 0;
+}
+
+static void wget_store(const uchar *data, unsigned int len)
+{
+	if (wget_have_len && wget_received + len > wget_content_len)
+		len = wget_content_len - wget_received;
+	if (len && wget_sink->write(wget_sink, wget_received, data, len)) {
+		wget_fail("cannot store the file");
+		return;
+	}
+	wget_received += len;
+
+	while (wget_received >= wget_next_hash) {
+		putc('#');
+		if (++wget_num_hash == WGET_HASHES_PER_LINE) {
+			puts("\n\t ");
+			wget_num_hash = 0;
+		}
+		wget_next_hash += WGET_HASH_BYTES;
+	}
+
+	if (wget_have_len && wget_received == wget_content_len) {
+		tcp_close();
+		wget_complete();
+	}
+}
+
+static void wget_receive(const uchar *data, unsigned int len)
+{
+	unsigned int prev, n;
+	char *end;
+
+	if (!wget_in_body) {
+		prev = wget_hdr_len;
+		n = min(len, WGET_HDR_MAX - 1 - prev);
+		memcpy(wget_hdr + prev, data, n);
+		wget_hdr_len += n;
+		wget_hdr[wget_hdr_len] = '\0';
+
+		end = strstr(wget_hdr, "\r\n\r\n");
+		if (!end) {
+			if (wget_hdr_len == WGET_HDR_MAX - 1)
+				wget_fail("response header too long");
+			return;
+		}
+		end[2] = '\0';
+		if (wget_parse_header())
+			return;
+		wget_in_body = true;
+
+		/* The start of the body may have come with the header */
+		n = end + 4 - wget_hdr - prev;
+		data += n;
+		len -= n;
+	}
+
+	wget_store(data, len);
+}
+
+static void wget_handler(enum tcp_event event, const uchar *data,
+			 unsigned int len)
+{
+	if (wget_done)
+		return;
+
+	switch (event) {
+	case TCP_EV_CONNECTED:
+		wget_send_request();
+		break;
+	case TCP_EV_DATA:
+		wget_receive(data, len);
+		break;
+	case TCP_EV_SENT:
+		break;
+	case TCP_EV_CLOSED:
+		if (!wget_in_body)
+			wget_fail("connection closed before the response");
+		else if (wget_have_len && wget_received < wget_content_len)
+			wget_fail("connection closed before the end of the file");
+		else
+			wget_complete();
+		break;
+	case TCP_EV_RESET:
+		wget_stop(NETLOOP_FAIL);
+		break;
+	}
+}
+
+void wget_start(void)
+{
+	char *ep;
+	int ret;
+
+	wget_done = false;
+	wget_server_ip = net_server_ip;
+	if (!net_parse_bootfile(&wget_server_ip, wget_path + 1,
+				WGET_PATH_MAX - 1)) {
+		puts("*** ERROR: no file name given\n");
+		wget_stop(NETLOOP_FAIL);
+		return;
+	}
+	wget_url = wget_path + 1;
+	if (*wget_url != '/') {
+		wget_path[0] = '/';
+		wget_url = wget_path;
+	}
+
+	wget_server_port = HTTP_PORT;
+	ep = env_get("httpdstp");
+	if (ep)
+		wget_server_port = simple_strtoul(ep, NULL, 10);
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4 port %u; our IP address is %pI4\n",
+	       &wget_server_ip, wget_server_port, &net_ip);
+	printf("Filename '%s'.\n", wget_url);
+
+	if (!wget_sink) {
+		if (wget_init_load_addr()) {
+			eth_halt();
+			puts("\nwget error: ");
+			puts("trying to overwrite reserved memory...\n");
+			wget_stop(NETLOOP_FAIL);
+			return;
+		}
+		printf("Load address: 0x%lx\n", wget_load_addr);
+		wget_sink = &wget_mem_sink;
+	}
+	puts("Loading: *\b");
+
+	wget_hdr_len = 0;
+	wget_in_body = false;
+	wget_have_len = false;
+	wget_content_len = 0;
+	wget_received = 0;
+	wget_next_hash = WGET_HASH_BYTES;
+	wget_num_hash = 0;
+	wget_time_start = get_timer(0);
+
+	ret = tcp_connect(wget_server_ip, wget_server_port, wget_handler);
+	if (ret) {
+		printf("\nwget: cannot connect (%d)\n", ret);
+		wget_stop(NETLOOP_FAIL);
+	}
+}
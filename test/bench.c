@@ -0,0 +1,442 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Microbenchmarks for library routines on hot boot paths
+ *
+ * Each benchmark is repeated for at least BENCH_MIN_US and reported as one
+ * comma-separated line, so that results can be collected from the console
+ * and compared between releases.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <hash.h>
+#include <image.h>
+#include <malloc.h>
+#include <search.h>
+#include <linux/libfdt.h>
+#include <linux/lzo.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+#include <lzma/LzmaTools.h>
+#include <test/compression.h>
+#include <test/suites.h>
+#include <u-boot/crc.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+#include <u-boot/sha512.h>
+#include <u-boot/zlib.h>
+#include <u-boot/zstd.h>
+#include <bzlib.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define BENCH_SIZE		SZ_1M
+#define BENCH_MIN_US		200000
+#define BENCH_OUT_SIZE		SZ_4K
+#define BENCH_HASH_VARS		256
+
+struct bench_state {
+	u8 *src;
+	u8 *dst;
+	u8 digest[SHA512_SUM_LEN];
+#ifdef CONFIG_CRC32C
+	u32 crc32c_table[256];
+#endif
+#ifdef CONFIG_GZIP_COMPRESSED
+	u8 gzip[BENCH_OUT_SIZE];
+	ulong gzip_size;
+#endif
+	struct hsearch_data htab;
+	char *env;
+	size_t env_size;
+};
+
+/**
+ * struct bench - a benchmark
+ *
+ * @name:	Name of the benchmark
+ * @unit:	What the count returned by @run measures
+ * @run:	Runs one iteration; returns the number of units processed, or
+ *		-ve on error
+ */
+struct bench {
+	const char *name;
+	const char *unit;
+	int (*run)(struct bench_state *bs);
+};
+
+static int bench_memcpy(struct bench_state *bs)
+{
+	memcpy(bs->dst, bs->src, BENCH_SIZE);
+
+	return BENCH_SIZE;
+}
+
+static int bench_memset(struct bench_state *bs)
+{
+	memset(bs->dst, 0x5a, BENCH_SIZE);
+
+	return BENCH_SIZE;
+}
+
+static int bench_memcmp(struct bench_state *bs)
+{
+	memcpy(bs->dst, bs->src, BENCH_SIZE);
+	if (memcmp(bs->dst, bs->src, BENCH_SIZE))
+		return -EIO;
+
+	return BENCH_SIZE;
+}
+
+static int bench_crc32(struct bench_state *bs)
+{
+	crc32(0, bs->src, BENCH_SIZE);
+
+	return BENCH_SIZE;
+}
+
+#ifdef CONFIG_CRC32C
+static int bench_crc32c(struct bench_state *bs)
+{
+	crc32c_cal(~0, (const char *)bs->src, BENCH_SIZE, bs->crc32c_table);
+
+	return BENCH_SIZE;
+}
+#endif
+
+#ifdef CONFIG_SHA1
+static int bench_sha1(struct bench_state *bs)
+{
+	sha1_csum_wd(bs->src, BENCH_SIZE, bs->digest, CHUNKSZ_SHA1);
+
+	return BENCH_SIZE;
+}
+#endif
+
+#ifdef CONFIG_SHA256
+static int bench_sha256(struct bench_state *bs)
+{
+	sha256_csum_wd(bs->src, BENCH_SIZE, bs->digest, CHUNKSZ_SHA256);
+
+	return BENCH_SIZE;
+}
+#endif
+
+#ifdef CONFIG_SHA512_ALGO
+static int bench_sha512(struct bench_state *bs)
+{
+	sha512_csum_wd(bs->src, BENCH_SIZE, bs->digest, CHUNKSZ_SHA512);
+
+	return BENCH_SIZE;
+}
+#endif
+
+#ifdef CONFIG_SHA_HW_ACCEL
+/* Whatever the hash command would use, which may be the hardware engine */
+static int bench_hash(struct bench_state *bs, const char *algo_name)
+{
+	struct hash_algo *algo;
+	int ret;
+
+	ret = hash_lookup_algo(algo_name, &algo);
+	if (ret)
+		return ret;
+	algo->hash_func_ws(bs->src, BENCH_SIZE, bs->digest, algo->chunk_size);
+
+	return BENCH_SIZE;
+}
+
+static int bench_hash_sha1(struct bench_state *bs)
+{
+	return bench_hash(bs, "sha1");
+}
+
+static int bench_hash_sha256(struct bench_state *bs)
+{
+	return bench_hash(bs, "sha256");
+}
+#endif
+
+#ifdef CONFIG_GZIP_COMPRESSED
+static int bench_gzip(struct bench_state *bs)
+{
+	unsigned long size = bs->gzip_size;
+
+	if (gunzip(bs->dst, BENCH_OUT_SIZE, bs->gzip, &size))
+		return -EIO;
+
+	return strlen(compression_plain);
+}
+#endif
+
+#ifdef CONFIG_BZIP2
+static int bench_bzip2(struct bench_state *bs)
+{
+	unsigned int size = BENCH_OUT_SIZE;
+
+	if (BZ2_bzBuffToBuffDecompress((char *)bs->dst, &size,
+				       (char *)bzip2_compressed,
+				       bzip2_compressed_size, 0, 0) != BZ_OK)
+		return -EIO;
+
+	return size;
+}
+#endif
+
+#ifdef CONFIG_LZMA
+static int bench_lzma(struct bench_state *bs)
+{
+	SizeT size = BENCH_OUT_SIZE;
+
+	if (lzmaBuffToBuffDecompress(bs->dst, &size,
+				     (unsigned char *)lzma_compressed,
+				     lzma_compressed_size) != SZ_OK)
+		return -EIO;
+
+	return size;
+}
+#endif
+
+#ifdef CONFIG_LZO
+static int bench_lzo(struct bench_state *bs)
+{
+	size_t size = BENCH_OUT_SIZE;
+
+	if (lzop_decompress((const unsigned char *)lzo_compressed,
+			    lzo_compressed_size, bs->dst, &size) != LZO_E_OK)
+		return -EIO;
+
+	return size;
+}
+#endif
+
+#ifdef CONFIG_LZ4
+static int bench_lz4(struct bench_state *bs)
+{
+	size_t size = BENCH_OUT_SIZE;
+
+	if (ulz4fn(lz4_compressed, lz4_compressed_size, bs->dst, &size))
+		return -EIO;
+
+	return size;
+}
+#endif
+
+#ifdef CONFIG_ZSTD
+static int bench_zstd(struct bench_state *bs)
+{
+	size_t size = BENCH_OUT_SIZE;
+
+	if (zstd_decompress(zstd_compressed, zstd_compressed_size, bs->dst,
+			    &size))
+		return -EIO;
+
+	return size;
+}
+#endif
+
+static int bench_htab_import(struct bench_state *bs)
+{
+	struct hsearch_data htab = { .change_ok = NULL };
+
+	if (!himport_r(&htab, bs->env, bs->env_size, '\n', 0, 0, 0, NULL))
+		return -EIO;
+	hdestroy_r(&htab);
+
+	return BENCH_HASH_VARS;
+}
+
+static int bench_htab_lookup(struct bench_state *bs)
+{
+	char name[16];
+	ENTRY e, *ep;
+	int i;
+
+	for (i = 0; i < BENCH_HASH_VARS; i++) {
+		snprintf(name, sizeof(name), "bench%d", i);
+		e.key = name;
+		e.data = NULL;
+		if (!hsearch_r(e, FIND, &ep, &bs->htab, 0))
+			return -ENOENT;
+	}
+
+	return BENCH_HASH_VARS;
+}
+
+#if CONFIG_IS_ENABLED(OF_CONTROL)
+/* Walk the whole control FDT looking for a compatible string */
+static int bench_fdt_scan(struct bench_state *bs)
+{
+	int node;
+
+	node = fdt_node_offset_by_compatible(gd->fdt_blob, -1,
+					     "u-boot,no-such-device");
+	if (node != -FDT_ERR_NOTFOUND)
+		return -EIO;
+
+	return fdt_totalsize(gd->fdt_blob);
+}
+
+static int bench_fdt_path(struct bench_state *bs)
+{
+	if (fdt_path_offset(gd->fdt_blob, "/chosen") < 0 &&
+	    fdt_path_offset(gd->fdt_blob, "/") < 0)
+		return -EIO;
+
+	return 1;
+}
+#endif
+
+static const struct bench benches[] = {
+	{ "memcpy", "bytes", bench_memcpy },
+	{ "memset", "bytes", bench_memset },
+	{ "memcmp", "bytes", bench_memcmp },
+	{ "crc32", "bytes", bench_crc32 },
+#ifdef CONFIG_CRC32C
+	{ "crc32c", "bytes", bench_crc32c },
+#endif
+#ifdef CONFIG_SHA1
+	{ "sha1", "bytes", bench_sha1 },
+#endif
+#ifdef CONFIG_SHA256
+	{ "sha256", "bytes", bench_sha256 },
+#endif
+#ifdef CONFIG_SHA512_ALGO
+	{ "sha512", "bytes", bench_sha512 },
+#endif
+#ifdef CONFIG_SHA_HW_ACCEL
+	{ "sha1-hw", "bytes", bench_hash_sha1 },
+	{ "sha256-hw", "bytes", bench_hash_sha256 },
+#endif
+#ifdef CONFIG_GZIP_COMPRESSED
+	{ "gunzip", "bytes", bench_gzip },
+#endif
+#ifdef CONFIG_BZIP2
+	{ "bunzip2", "bytes", bench_bzip2 },
+#endif
+#ifdef CONFIG_LZMA
+	{ "unlzma", "bytes", bench_lzma },
+#endif
+#ifdef CONFIG_LZO
+	{ "unlzo", "bytes", bench_lzo },
+#endif
+#ifdef CONFIG_LZ4
+	{ "unlz4", "bytes", bench_lz4 },
+#endif
+#ifdef CONFIG_ZSTD
+	{ "unzstd", "bytes", bench_zstd },
+#endif
+	{ "htab-import", "vars", bench_htab_import },
+	{ "htab-lookup", "lookups", bench_htab_lookup },
+#if CONFIG_IS_ENABLED(OF_CONTROL)
+	{ "fdt-scan", "bytes", bench_fdt_scan },
+	{ "fdt-path", "lookups", bench_fdt_path },
+#endif
+};
+
+static int bench_setup(struct bench_state *bs)
+{
+	char *p;
+	int i;
+
+	bs->src = memalign(ARCH_DMA_MINALIGN, BENCH_SIZE);
+	bs->dst = memalign(ARCH_DMA_MINALIGN, BENCH_SIZE);
+	bs->env = malloc(BENCH_HASH_VARS * 32);
+	if (!bs->src || !bs->dst || !bs->env)
+		return -ENOMEM;
+
+	/* Text-like data, so that nothing special-cases zeroes */
+	for (i = 0; i < BENCH_SIZE; i++)
+		bs->src[i] = compression_plain[i % strlen(compression_plain)];
+
+#ifdef CONFIG_CRC32C
+	crc32c_init(bs->crc32c_table, 0x82f63b78);
+#endif
+#ifdef CONFIG_GZIP_COMPRESSED
+	bs->gzip_size = sizeof(bs->gzip);
+	if (gzip(bs->gzip, &bs->gzip_size, (void *)compression_plain,
+		 strlen(compression_plain)))
+		return -EIO;
+#endif
+
+	for (i = 0, p = bs->env; i < BENCH_HASH_VARS; i++)
+		p += sprintf(p, "bench%d=value of variable %d\n", i, i);
+	bs->env_size = p - bs->env + 1;
+
+	if (!himport_r(&bs->htab, bs->env, bs->env_size, '\n', 0, 0, 0, NULL))
+		return -EIO;
+
+	return 0;
+}
+
+static void bench_teardown(struct bench_state *bs)
+{
+	hdestroy_r(&bs->htab);
+	free(bs->env);
+	free(bs->dst);
+	free(bs->src);
+}
+
+static int bench_run(struct bench_state *bs, const struct bench *b)
+{
+	ulong start, elapsed;
+	u64 count = 0;
+	u64 rate, cost;
+	int iters = 0;
+	int ret;
+
+	start = timer_get_us();
+	do {
+		ret = b->run(bs);
+		if (ret < 0) {
+			printf("%s: error %d\n", b->name, ret);
+			return ret;
+		}
+		count += ret;
+		iters++;
+		elapsed = timer_get_us() - start;
+	} while (elapsed < BENCH_MIN_US);
+
+	/* Millions of units per second and picoseconds per unit */
+	rate = div64_u64(count * 100, elapsed);
+	cost = div64_u64((u64)elapsed * 1000000, count);
+
+	printf("%s,%s,%llu,%d,%lu,%llu.%02llu,%llu.%03llu\n", b->name, b->unit,
+	       count, iters, elapsed, rate / 100, rate % 100, cost / 1000,
+	       cost % 1000);
+
+	return 0;
+}
+
+int do_ut_bench(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct bench_state *bs;
+	const struct bench *b;
+	int ret;
+
+	bs = calloc(1, sizeof(*bs));
+	if (!bs)
+		return CMD_RET_FAILURE;
+
+	ret = bench_setup(bs);
+	if (ret) {
+		printf("Benchmark setup failed: %d\n", ret);
+		goto out;
+	}
+
+	printf("name,unit,count,iterations,us,M/s,ns/unit\n");
+	for (b = benches; b < benches + ARRAY_SIZE(benches); b++) {
+		if (argc > 1 && strcmp(argv[1], b->name))
+			continue;
+		ret |= bench_run(bs, b);
+	}
+
+out:
+	bench_teardown(bs);
+	free(bs);
+
+	return ret ? CMD_RET_FAILURE : 0;
+}
@@ -117,6 +117,29 @@ static int dm_test_regmap_rw(struct unit_test_state *uts)
 
 DM_TEST(dm_test_regmap_rw, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/* Write a sequence of registers */
+static int dm_test_regmap_multi_write(struct unit_test_state *uts)
+{
+	static const struct reg_sequence seq[] = {
+		{ 0, 0xcacafafa },
+		{ 4, 0x55aa2211, 10 },
+		{ 8, 0x00ff00ff },
+	};
+	struct udevice *dev;
+	struct regmap *map;
+
+	ut_assertok(uclass_get_device(UCLASS_SYSCON, 0, &dev));
+	map = syscon_get_regmap(dev);
+	ut_assertok_ptr(map);
+
+	ut_assertok(regmap_multi_reg_write(map, seq, ARRAY_SIZE(seq)));
+	ut_assertok(regmap_multi_reg_write(map, seq, 0));
+
+	return 0;
+}
+
+DM_TEST(dm_test_regmap_multi_write, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* Get/Set test */
 static int dm_test_regmap_getset(struct unit_test_state *uts)
 {
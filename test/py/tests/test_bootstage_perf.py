@@ -0,0 +1,211 @@
+# SPDX-License-Identifier: GPL-2.0
+
+# Check boot time and transfer throughput against a per-board baseline.
+#
+# The boot-time test parses "bootstage report": the time of each boot stage
+# mark, accumulated times (which include slow initcalls and device probes
+# with CONFIG_INITCALL_TIMING and CONFIG_DM_TIMING) and span durations. The
+# throughput tests time a transfer command such as "mmc read" or "tftpboot".
+# The results are compared against a baseline file, and every run also
+# writes its results to the result directory, so a new baseline can be made
+# by copying that file.
+
+import json
+import os
+import re
+import pytest
+import u_boot_utils
+
+"""
+These tests rely on boardenv_* containing configuration values. The
+boot-time test needs:
+
+env__bootstage_perf_config = {
+    # Baseline file, relative to the U-Boot source directory if not absolute.
+    'baseline': 'test/py/perf/myboard.json',
+    # Relative slow-down allowed before a value counts as a regression.
+    # This value is optional, and defaults to 0.1.
+    'tolerance': 0.1,
+    # Absolute slack in microseconds, so that very short stages do not fail
+    # on noise. This value is optional, and defaults to 1000.
+    'slack_us': 1000,
+}
+
+Each transfer to time is an entry of:
+
+env__bootstage_perf_transfers = (
+    {
+        'fixture_id': 'mmc-read',
+        # Commands run before the timed command. This value is optional.
+        'setup': ('mmc dev 0',),
+        # The timed command. "$addr" is replaced by the load address.
+        'cmd': 'mmc read $addr 0 0x8000',
+        # Bytes transferred. This value is optional; if it is missing, the
+        # "filesize" variable is used, as set by tftpboot and load.
+        'size': 0x1000000,
+    },
+    {
+        'fixture_id': 'tftpboot',
+        'setup': ('setenv autoload no', 'dhcp'),
+        'cmd': 'tftpboot $addr image.bin',
+    },
+)
+
+The baseline file holds the values to compare against, in microseconds for
+boot stages and in bytes per second for transfers:
+
+{
+    "bootstage": {"main_loop": 1500000, "dm_r": 12000},
+    "throughput": {"mmc-read": 40000000, "tftpboot": 9000000}
+}
+"""
+
+def grouped_int(text):
+    """Convert a number printed with thousands separators to an integer."""
+    return int(text.replace(',', ''))
+
+def parse_bootstage_report(output):
+    """Parse the output of "bootstage report".
+
+    Args:
+        output: The command output.
+
+    Returns:
+        A dictionary from stage name to microseconds. Marks give the time
+        since reset, accumulated records and spans give their duration.
+    """
+    section = 'mark'
+    stages = {}
+    for line in output.splitlines():
+        line = line.rstrip()
+        if line.startswith('Accumulated time:'):
+            section = 'accum'
+            continue
+        if line.startswith('Spans:'):
+            section = 'span'
+            continue
+        if section == 'mark':
+            m = re.match(r'^\s*([\d,]+)\s+([\d,]+)\s+(\S.*)$', line)
+            if m:
+                stages[m.group(3)] = grouped_int(m.group(1))
+        elif section == 'accum':
+            m = re.match(r'^\s+([\d,]+)\s+(\S.*)$', line)
+            if m:
+                stages[m.group(2)] = grouped_int(m.group(1))
+        else:
+            m = re.match(r'^\s*([\d,]+)\s+([\d,]+)\s+(\S.*)$', line)
+            if m:
+                stages[m.group(3).strip()] = grouped_int(m.group(2))
+    return stages
+
+def perf_results_file(u_boot_console):
+    """Return the file this run's results are written to."""
+    config = u_boot_console.config
+    name = 'perf-%s' % config.board_type
+    if config.board_identity != 'na':
+        name += '-' + config.board_identity
+    return os.path.join(config.result_dir, name + '.json')
+
+def save_results(u_boot_console, kind, values):
+    """Merge this run's results into the results file.
+
+    Args:
+        u_boot_console: A U-Boot console connection.
+        kind: 'bootstage' or 'throughput'.
+        values: Dictionary of results to store.
+
+    Returns:
+        Nothing.
+    """
+    fn = perf_results_file(u_boot_console)
+    results = {}
+    if os.path.exists(fn):
+        with open(fn) as fh:
+            results = json.load(fh)
+    results.setdefault(kind, {}).update(values)
+    with open(fn, 'w') as fh:
+        json.dump(results, fh, indent=4, sort_keys=True)
+
+def load_baseline(u_boot_console, kind):
+    """Load one section of the board's baseline file.
+
+    Args:
+        u_boot_console: A U-Boot console connection.
+        kind: 'bootstage' or 'throughput'.
+
+    Returns:
+        A tuple of the baseline dictionary and the perf configuration, or
+        skips the test if there is no baseline.
+    """
+    perf_config = u_boot_console.config.env.get('env__bootstage_perf_config')
+    if not perf_config:
+        pytest.skip('No env__bootstage_perf_config')
+    fn = perf_config['baseline']
+    if not os.path.isabs(fn):
+        fn = os.path.join(u_boot_console.config.source_dir, fn)
+    if not os.path.exists(fn):
+        pytest.skip('No baseline %s; results are in %s' %
+                    (fn, perf_results_file(u_boot_console)))
+    with open(fn) as fh:
+        baseline = json.load(fh)
+    return baseline.get(kind, {}), perf_config
+
+@pytest.mark.buildconfigspec('bootstage_report')
+@pytest.mark.buildconfigspec('cmd_bootstage')
+def test_bootstage_perf_boot(u_boot_console):
+    """Compare the boot stage timings against the board's baseline."""
+
+    output = u_boot_console.run_command('bootstage report')
+    stages = parse_bootstage_report(output)
+    assert stages, 'No records in bootstage report'
+    save_results(u_boot_console, 'bootstage', stages)
+
+    baseline, perf_config = load_baseline(u_boot_console, 'bootstage')
+    tolerance = perf_config.get('tolerance', 0.1)
+    slack_us = perf_config.get('slack_us', 1000)
+
+    regressions = []
+    for name, base_us in sorted(baseline.items()):
+        if name not in stages:
+            u_boot_console.log.warning('Stage %s is not in the report' % name)
+            continue
+        limit = base_us * (1 + tolerance) + slack_us
+        if stages[name] > limit:
+            regressions.append('%s: %d us, baseline %d us' %
+                               (name, stages[name], base_us))
+    assert not regressions, 'Boot time regressions:\n' + '\n'.join(regressions)
+
+def test_bootstage_perf_transfer(u_boot_console, env__bootstage_perf_transfer):
+    """Compare the throughput of a transfer command against the baseline."""
+
+    cfg = env__bootstage_perf_transfer
+    fixture_id = cfg['fixture_id']
+    addr = '0x%x' % u_boot_utils.find_ram_base(u_boot_console)
+
+    for cmd in cfg.get('setup', ()):
+        u_boot_console.run_command(cmd)
+
+    output, seconds = u_boot_utils.run_timed(u_boot_console,
+        cfg['cmd'].replace('$addr', addr))
+    assert 'rror' not in output, output
+
+    size = cfg.get('size')
+    if size is None:
+        output = u_boot_console.run_command('printenv filesize')
+        m = re.search(r'filesize=([0-9a-fA-F]+)', output)
+        assert m, 'No filesize after ' + cfg['cmd']
+        size = int(m.group(1), 16)
+
+    assert seconds > 0, 'Transfer too short to time'
+    rate = int(size / seconds)
+    u_boot_console.log.info('%s: %d bytes in %.3f s, %d bytes/s' %
+                            (fixture_id, size, seconds, rate))
+    save_results(u_boot_console, 'throughput', {fixture_id: rate})
+
+    baseline, perf_config = load_baseline(u_boot_console, 'throughput')
+    if fixture_id not in baseline:
+        pytest.skip('No baseline for ' + fixture_id)
+    tolerance = perf_config.get('tolerance', 0.1)
+    limit = baseline[fixture_id] * (1 - tolerance)
+    assert rate >= limit, '%s: %d bytes/s, baseline %d bytes/s' % (
+        fixture_id, rate, baseline[fixture_id])
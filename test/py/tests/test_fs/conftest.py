@@ -13,6 +13,7 @@ supported_fs_basic = ['fat16', 'fat32', 'ext4']
 supported_fs_ext = ['fat16', 'fat32']
 supported_fs_mkdir = ['fat16', 'fat32']
 supported_fs_unlink = ['fat16', 'fat32']
+supported_fs_bench = ['fat16', 'fat32', 'ext4']
 
 #
 # Filesystem test specific setup
@@ -30,6 +31,8 @@ def pytest_addoption(parser):
     """
     parser.addoption('--fs-type', action='append', default=None,
         help='Targeting Filesystem Types')
+    parser.addoption('--fs-bench', action='store_true', default=False,
+        help='Run the file system benchmarks')
 
 def pytest_configure(config):
     """Restrict a file system(s) to be tested.
@@ -48,6 +51,7 @@ def pytest_configure(config):
     global supported_fs_ext
     global supported_fs_mkdir
     global supported_fs_unlink
+    global supported_fs_bench
 
     def intersect(listA, listB):
         return  [x for x in listA if x in listB]
@@ -59,6 +63,7 @@ def pytest_configure(config):
         supported_fs_ext =  intersect(supported_fs, supported_fs_ext)
         supported_fs_mkdir =  intersect(supported_fs, supported_fs_mkdir)
         supported_fs_unlink =  intersect(supported_fs, supported_fs_unlink)
+        supported_fs_bench =  intersect(supported_fs, supported_fs_bench)
 
 def pytest_generate_tests(metafunc):
     """Parametrize fixtures, fs_obj_xxx
@@ -84,6 +89,9 @@ def pytest_generate_tests(metafunc):
     if 'fs_obj_unlink' in metafunc.fixturenames:
         metafunc.parametrize('fs_obj_unlink', supported_fs_unlink,
             indirect=True, scope='module')
+    if 'fs_obj_bench' in metafunc.fixturenames:
+        metafunc.parametrize('fs_obj_bench', supported_fs_bench,
+            indirect=True, scope='module')
 
 #
 # Helper functions
@@ -523,3 +531,88 @@ def fs_obj_unlink(request, u_boot_config):
         call('rmdir %s' % mount_dir, shell=True)
         if fs_img:
             call('rm -f %s' % fs_img, shell=True)
+
+#
+# Fixture for fs benchmarks
+#
+# NOTE: yield_fixture was deprecated since pytest-3.0
+@pytest.yield_fixture()
+def fs_obj_bench(request, u_boot_config):
+    """Set up a file system to be used in the fs benchmarks.
+
+    The volume holds a big file, a file fragmented by interleaving its
+    writes with another one, a deep directory tree and a directory with
+    many entries. The benchmarks only run with --fs-bench.
+
+    Args:
+        request: Pytest request object.
+	u_boot_config: U-boot configuration.
+
+    Return:
+        A fixture for fs benchmarks, i.e. a triplet of file system type,
+        volume file name and a dictionary of MD5 hashes by file name.
+    """
+    if not request.config.getoption('fs_bench'):
+        pytest.skip('fs benchmarks need --fs-bench')
+
+    fs_type = request.param
+    fs_img = ''
+
+    fs_ubtype = fstype_to_ubname(fs_type)
+    check_ubconfig(u_boot_config, fs_ubtype)
+
+    mount_dir = u_boot_config.persistent_data_dir + '/mnt'
+
+    try:
+
+        # 256MiB volume
+        fs_img = mk_fs(u_boot_config, fs_type, 0x10000000, '256MB')
+
+        # Mount the image so we can populate it.
+        check_call('mkdir -p %s' % mount_dir, shell=True)
+        mount_fs(fs_type, fs_img, mount_dir)
+
+        check_call('dd if=/dev/urandom of=%s/%s bs=1M count=%d'
+            % (mount_dir, BENCH_BIG_FILE, BENCH_BIG_MB), shell=True)
+
+        # Append to two files in turn and flush each chunk, so that their
+        # clusters or blocks alternate on the disk.
+        for i in range(0, BENCH_FRAG_CHUNKS):
+            for name in (BENCH_FRAG_FILE, 'filler.file'):
+                check_call('dd if=/dev/urandom of=%s/%s bs=64K count=1 '
+                    'oflag=append conv=notrunc,fsync 2> /dev/null'
+                    % (mount_dir, name), shell=True)
+
+        deep_dir = mount_dir
+        for depth in range(0, BENCH_DEEP_DEPTH):
+            deep_dir += '/d%02d' % depth
+            check_call('mkdir %s' % deep_dir, shell=True)
+            for i in range(0, 16):
+                with open('%s/file%02d' % (deep_dir, i), 'w') as fh:
+                    fh.write('%d %d\n' % (depth, i))
+        check_call('dd if=/dev/urandom of=%s/%s bs=1M count=1'
+            % (deep_dir, BENCH_DEEP_FILE), shell=True)
+
+        check_call('mkdir %s/%s' % (mount_dir, BENCH_WIDE_DIR), shell=True)
+        for i in range(0, BENCH_WIDE_ENTRIES):
+            with open('%s/%s/entry%04d.txt' % (mount_dir, BENCH_WIDE_DIR, i),
+                      'w') as fh:
+                fh.write('%d\n' % i)
+
+        md5val = {}
+        for name in (BENCH_BIG_FILE, BENCH_FRAG_FILE,
+                     bench_deep_path(BENCH_DEEP_FILE)):
+            out = check_output('md5sum %s/%s' % (mount_dir, name), shell=True)
+            md5val[name] = out.split()[0]
+
+        umount_fs(mount_dir)
+    except CalledProcessError:
+        pytest.skip('Setup failed for filesystem: ' + fs_type)
+        return
+    else:
+        yield [fs_ubtype, fs_img, md5val]
+    finally:
+        umount_fs(mount_dir)
+        call('rmdir %s' % mount_dir, shell=True)
+        if fs_img:
+            call('rm -f %s' % fs_img, shell=True)
@@ -11,3 +11,17 @@ BIG_FILE='2.5GB.file'
 
 ADDR=0x01000008
 LENGTH=0x00100000
+
+# Benchmark volume contents, see fs_obj_bench
+BENCH_BIG_FILE='big.file'
+BENCH_BIG_MB=64
+BENCH_FRAG_FILE='frag.file'
+BENCH_FRAG_CHUNKS=128
+BENCH_DEEP_DEPTH=16
+BENCH_DEEP_FILE='deep.file'
+BENCH_WIDE_DIR='wide'
+BENCH_WIDE_ENTRIES=1000
+BENCH_ADDR=0x01000000
+
+def bench_deep_path(name):
+    return '/'.join(['d%02d' % i for i in range(0, BENCH_DEEP_DEPTH)] + [name])
@@ -0,0 +1,130 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System:Benchmarks
+
+"""
+This test measures file system throughput and metadata performance: loading
+a big file, a fragmented file and a file at the bottom of a deep directory
+tree, listing a directory with many entries and writing a big file back.
+The benchmarks only run with --fs-bench. The results are logged and written
+to fs-bench-<fs type>.json in the result directory; only the correctness of
+each operation is asserted.
+"""
+
+import json
+import os
+import pytest
+import re
+import u_boot_utils
+from fstest_defs import *
+
+def blkcache_stats(u_boot_console):
+    """Return the block cache (hits, misses) of host device 0, if available."""
+    bcfg = u_boot_console.config.buildconfig
+    if bcfg.get('config_cmd_block_cache', 'n') != 'y':
+        return None
+    output = u_boot_console.run_command('blkcache stats')
+    m = re.search(r'^host\s+0\s+(\d+)\s+(\d+)', output, re.M)
+    if not m:
+        return None
+    return int(m.group(1)), int(m.group(2))
+
+def run_bench(u_boot_console, results, name, cmd, size=None):
+    """Run and time one benchmark step and record its results.
+
+    Args:
+        u_boot_console: A U-Boot console connection.
+        results: Dictionary of results to add this step to.
+        name: Name of the step.
+        cmd: The command to time.
+        size: Bytes transferred, or None for metadata operations.
+
+    Returns:
+        The command output.
+    """
+    before = blkcache_stats(u_boot_console)
+    output, seconds = u_boot_utils.run_timed(u_boot_console, cmd)
+    after = blkcache_stats(u_boot_console)
+
+    result = {'seconds': seconds}
+    msg = '%s: %.3f s' % (name, seconds)
+    if size and seconds > 0:
+        result['bytes_per_s'] = int(size / seconds)
+        msg += ', %.1f MB/s' % (size / seconds / 1000000)
+    if before and after:
+        result['cache_hits'] = after[0] - before[0]
+        result['cache_misses'] = after[1] - before[1]
+        msg += ', %d cached block reads, %d misses' % (
+            result['cache_hits'], result['cache_misses'])
+    u_boot_console.log.info(msg)
+    results[name] = result
+    return output
+
+def check_md5(u_boot_console, md5val, name):
+    output = u_boot_console.run_command_list([
+        'md5sum %x $filesize' % BENCH_ADDR,
+        'setenv filesize'])
+    assert(md5val[name] in ''.join(output))
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.slow
+class TestFsBench(object):
+    def test_fs_bench(self, u_boot_console, fs_obj_bench):
+        """
+        Time reads, directory listings and a write on a prepared volume
+        """
+        fs_type,fs_img,md5val = fs_obj_bench
+        results = {}
+        big_size = BENCH_BIG_MB * 1024 * 1024
+        deep_file = bench_deep_path(BENCH_DEEP_FILE)
+
+        u_boot_console.run_command('host bind 0 %s' % fs_img)
+
+        with u_boot_console.log.section('Load big file'):
+            output = run_bench(u_boot_console, results, 'load-big',
+                'load host 0:0 %x /%s' % (BENCH_ADDR, BENCH_BIG_FILE),
+                big_size)
+            assert('%d bytes read' % big_size in output)
+            check_md5(u_boot_console, md5val, BENCH_BIG_FILE)
+
+        with u_boot_console.log.section('Load fragmented file'):
+            frag_size = BENCH_FRAG_CHUNKS * 64 * 1024
+            output = run_bench(u_boot_console, results, 'load-frag',
+                'load host 0:0 %x /%s' % (BENCH_ADDR, BENCH_FRAG_FILE),
+                frag_size)
+            assert('%d bytes read' % frag_size in output)
+            check_md5(u_boot_console, md5val, BENCH_FRAG_FILE)
+
+        with u_boot_console.log.section('Load file in deep directory'):
+            output = run_bench(u_boot_console, results, 'load-deep',
+                'load host 0:0 %x /%s' % (BENCH_ADDR, deep_file),
+                1024 * 1024)
+            assert('1048576 bytes read' in output)
+            check_md5(u_boot_console, md5val, deep_file)
+
+        with u_boot_console.log.section('List wide directory'):
+            output = run_bench(u_boot_console, results, 'ls-wide',
+                'ls host 0:0 /%s' % BENCH_WIDE_DIR)
+            assert('entry%04d.txt' % (BENCH_WIDE_ENTRIES - 1) in output)
+
+        with u_boot_console.log.section('List deep directory'):
+            output = run_bench(u_boot_console, results, 'ls-deep',
+                'ls host 0:0 /%s' % os.path.dirname(deep_file))
+            assert(BENCH_DEEP_FILE in output)
+
+        with u_boot_console.log.section('Write big file'):
+            u_boot_console.run_command(
+                'load host 0:0 %x /%s' % (BENCH_ADDR, BENCH_BIG_FILE))
+            output = run_bench(u_boot_console, results, 'write-big',
+                '%swrite host 0:0 %x /bench.file %x'
+                % (fs_type, BENCH_ADDR, big_size), big_size)
+            assert('%d bytes written' % big_size in output)
+            output = u_boot_console.run_command(
+                'load host 0:0 %x /bench.file' % (BENCH_ADDR))
+            assert('%d bytes read' % big_size in output)
+            check_md5(u_boot_console, md5val, BENCH_BIG_FILE)
+
+        fn = os.path.join(u_boot_console.config.result_dir,
+                          'fs-bench-%s.json' % fs_type)
+        with open(fn, 'w') as fh:
+            json.dump(results, fh, indent=4, sort_keys=True)
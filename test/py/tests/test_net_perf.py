@@ -0,0 +1,206 @@
+# SPDX-License-Identifier: GPL-2.0
+
+# Measure network goodput: TFTP with a range of block and window sizes, NFS
+# and fastboot over UDP. On sandbox the eth-raw bridge can emulate a link
+# with a given round-trip time, bandwidth and loss (see README.sandbox), so
+# that protocol changes can be compared reproducibly without lab hardware.
+# The results are logged and merged into net-perf-<board>.json in the
+# result directory; only the correctness of each transfer is asserted.
+
+import json
+import os
+import pytest
+import re
+import subprocess
+import time
+import u_boot_utils
+
+"""
+These tests use the network set-up of test_net.py (env__net_dhcp_server and
+env__net_static_env_vars) and rely on boardenv_* containing configuration
+values for the transfers. Each test runs once for each link:
+
+env__net_perf_links = (
+    # No emulation; this is the only sensible entry on real hardware.
+    {'fixture_id': 'native'},
+    # Emulated link, sandbox only. All values are optional: the round-trip
+    # time in microseconds, the bandwidth in bytes per second and the packet
+    # loss in parts per thousand.
+    {'fixture_id': 'wan', 'rtt_us': 20000, 'rate': 1250000, 'loss': 5},
+)
+
+# File to fetch over TFTP, with the blksize and windowsize pairs to try.
+env__net_perf_tftp_file = {
+    'fn': 'ubtest-readable.bin',
+    'size': 5058624,
+    'crc32': 'c2244b26',
+    # Optional, defaults to the list below.
+    'params': ((512, 1), (1468, 1), (1468, 8), (1468, 16)),
+}
+
+# File to fetch over NFS; 'fn' is the full path on the server.
+env__net_perf_nfs_file = {
+    'fn': '/srv/nfs/ubtest-readable.bin',
+    'size': 5058624,
+    'crc32': 'c2244b26',
+}
+
+# File to send with fastboot over UDP. 'fn' is a file on the host running
+# the tests and 'client' is the fastboot command line to reach U-Boot.
+env__net_perf_fastboot_udp = {
+    'fn': '/tmp/ubtest-readable.bin',
+    'client': 'fastboot -s udp:127.0.0.1',
+}
+"""
+
+default_tftp_params = ((512, 1), (1468, 1), (1468, 8), (1468, 16))
+link_vars = (('ethlinkrtt', 'rtt_us'), ('ethlinkrate', 'rate'),
+             ('ethlinkloss', 'loss'))
+
+def net_perf_setup(u_boot_console, link):
+    """Configure the network and the emulated link.
+
+    Args:
+        u_boot_console: A U-Boot console connection.
+        link: The env__net_perf_link entry to use.
+
+    Returns:
+        Nothing.
+    """
+
+    env = u_boot_console.config.env
+    for (var, val) in env.get('env__net_static_env_vars', []):
+        u_boot_console.run_command('setenv %s %s' % (var, val))
+
+    emulated = [key for (var, key) in link_vars if link.get(key)]
+    if emulated and u_boot_console.config.board_type != 'sandbox':
+        pytest.skip('Link emulation needs sandbox')
+    for (var, key) in link_vars:
+        u_boot_console.run_command('setenv %s %s' % (var, link.get(key, '')))
+
+    if env.get('env__net_dhcp_server', False):
+        u_boot_console.run_command('setenv autoload no')
+        output = u_boot_console.run_command('dhcp')
+        assert 'DHCP client bound to address ' in output
+
+def net_perf_check(u_boot_console, output, f, addr):
+    """Check the size and optionally the CRC32 of a received file.
+
+    Args:
+        u_boot_console: A U-Boot console connection.
+        output: The output of the transfer command.
+        f: The file description from the boardenv_* file.
+        addr: The address the file was loaded to.
+
+    Returns:
+        The size of the file.
+    """
+
+    m = re.search(r'Bytes transferred = (\d+)', output)
+    assert m, 'Transfer failed:\n' + output
+    size = int(m.group(1))
+    if f.get('size'):
+        assert size == f['size']
+
+    if (f.get('crc32') and
+        u_boot_console.config.buildconfig.get('config_cmd_crc32', 'n') == 'y'):
+        output = u_boot_console.run_command('crc32 %x $filesize' % addr)
+        assert f['crc32'] in output
+    return size
+
+def net_perf_record(u_boot_console, link, name, size, seconds):
+    """Log a goodput result and merge it into the results file.
+
+    Args:
+        u_boot_console: A U-Boot console connection.
+        link: The env__net_perf_link entry in use.
+        name: Name of the measurement.
+        size: Bytes transferred.
+        seconds: Duration of the transfer.
+
+    Returns:
+        Nothing.
+    """
+
+    assert seconds > 0, 'Transfer too short to time'
+    rate = int(size / seconds)
+    link_id = link.get('fixture_id', 'native')
+    u_boot_console.log.info('%s/%s: %d bytes in %.3f s, %d bytes/s' %
+                            (link_id, name, size, seconds, rate))
+
+    config = u_boot_console.config
+    fn = os.path.join(config.result_dir, 'net-perf-%s.json' % config.board_type)
+    results = {}
+    if os.path.exists(fn):
+        with open(fn) as fh:
+            results = json.load(fh)
+    results.setdefault(link_id, {})[name] = rate
+    with open(fn, 'w') as fh:
+        json.dump(results, fh, indent=4, sort_keys=True)
+
+@pytest.mark.buildconfigspec('cmd_net')
+def test_net_perf_tftp(u_boot_console, env__net_perf_link):
+    """Measure TFTP goodput for each block size and window size."""
+
+    f = u_boot_console.config.env.get('env__net_perf_tftp_file', None)
+    if not f:
+        pytest.skip('No TFTP file to time')
+
+    net_perf_setup(u_boot_console, env__net_perf_link)
+    addr = u_boot_utils.find_ram_base(u_boot_console)
+    try:
+        for (blksize, windowsize) in f.get('params', default_tftp_params):
+            u_boot_console.run_command('setenv tftpblocksize %d' % blksize)
+            u_boot_console.run_command('setenv tftpwindowsize %d' % windowsize)
+            output, seconds = u_boot_utils.run_timed(u_boot_console,
+                'tftpboot %x %s' % (addr, f['fn']))
+            size = net_perf_check(u_boot_console, output, f, addr)
+            net_perf_record(u_boot_console, env__net_perf_link,
+                            'tftp-%d-%d' % (blksize, windowsize), size, seconds)
+    finally:
+        u_boot_console.run_command('setenv tftpblocksize')
+        u_boot_console.run_command('setenv tftpwindowsize')
+
+@pytest.mark.buildconfigspec('cmd_nfs')
+def test_net_perf_nfs(u_boot_console, env__net_perf_link):
+    """Measure NFS goodput."""
+
+    f = u_boot_console.config.env.get('env__net_perf_nfs_file', None)
+    if not f:
+        pytest.skip('No NFS file to time')
+
+    net_perf_setup(u_boot_console, env__net_perf_link)
+    addr = u_boot_utils.find_ram_base(u_boot_console)
+    output, seconds = u_boot_utils.run_timed(u_boot_console,
+        'nfs %x %s' % (addr, f['fn']))
+    size = net_perf_check(u_boot_console, output, f, addr)
+    net_perf_record(u_boot_console, env__net_perf_link, 'nfs', size, seconds)
+
+@pytest.mark.buildconfigspec('udp_function_fastboot')
+def test_net_perf_fastboot_udp(u_boot_console, env__net_perf_link):
+    """Measure the goodput of a fastboot download over UDP.
+
+    The download is timed on the host, since U-Boot only prints the time of
+    the whole fastboot session.
+    """
+
+    f = u_boot_console.config.env.get('env__net_perf_fastboot_udp', None)
+    if not f:
+        pytest.skip('No fastboot-UDP configuration')
+
+    net_perf_setup(u_boot_console, env__net_perf_link)
+    client = f['client'].split()
+    u_boot_console.run_command('fastboot udp', wait_for_prompt=False)
+    try:
+        start = time.time()
+        subprocess.check_call(client + ['stage', f['fn']])
+        seconds = time.time() - start
+        subprocess.check_call(client + ['continue'])
+    except:
+        u_boot_console.ctrlc()
+        raise
+    u_boot_console.wait_for(u_boot_console.prompt)
+
+    size = os.path.getsize(f['fn'])
+    net_perf_record(u_boot_console, env__net_perf_link, 'fastboot-udp', size,
+                    seconds)
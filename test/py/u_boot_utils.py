@@ -338,3 +338,28 @@ def crc32(u_boot_console, address, count):
     assert m, 'CRC32 operation failed.'
 
     return m.group(1)
+
+def run_timed(u_boot_console, cmd):
+    """Run a U-Boot command and measure how long it took.
+
+    The "time" command is used if it is built in, since timing on the host
+    also counts the console round trip.
+
+    Args:
+        u_boot_console: A U-Boot console connection.
+        cmd: The command to run.
+
+    Returns:
+        A tuple of the command output and the elapsed time in seconds.
+    """
+
+    bcfg = u_boot_console.config.buildconfig
+    if bcfg.get('config_cmd_time', 'n') == 'y':
+        output = u_boot_console.run_command('time ' + cmd)
+        m = re.search(r'time:(?: (\d+) minutes,)? (\d+\.\d+) seconds', output)
+        assert m, 'No time in output:\n' + output
+        return output, int(m.group(1) or 0) * 60 + float(m.group(2))
+
+    start = time.time()
+    output = u_boot_console.run_command(cmd)
+    return output, time.time() - start
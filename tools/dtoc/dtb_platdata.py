@@ -14,6 +14,7 @@ static data.
 import collections
 import copy
 import sys
+import zlib
 
 import fdt
 import fdt_util
@@ -546,6 +547,130 @@ class DtbPlatdata(object):
             nodes_to_output.remove(node)
 
 
+    def generate_livetree(self):
+        """Generate a pre-unflattened live tree
+
+        This writes out the whole device tree as the struct device_node and
+        struct property objects which of_live_build() would create at run
+        time, so that U-Boot can use it without unflattening the flat tree.
+        Property values and names are const, the nodes and properties are
+        writable so that ofnode_write_prop() can still update them.
+
+        The tree is only used if the control FDT matches the one it was
+        generated from, which is checked with its size and CRC32.
+        """
+        nodes = []
+        def _add_node(node):
+            nodes.append(node)
+            for subnode in node.subnodes:
+                _add_node(subnode)
+        _add_node(self._fdt.GetRoot())
+        node_index = dict((node.path, i) for i, node in enumerate(nodes))
+
+        values = []
+        props = []
+        node_info = []
+
+        def _add_value(data):
+            while len(values) % 4:
+                values.append(0)
+            offset = len(values)
+            values.extend(ord(ch) for ch in data)
+            return offset
+
+        for node in nodes:
+            phandle = 0
+            name = None
+            dev_type = None
+            first = len(props)
+            node_props = sorted(node.props.values(),
+                                key=lambda prop: prop.GetOffset())
+            for prop in node_props:
+                offset = _add_value(prop.bytes)
+                if prop.name in ('phandle', 'linux,phandle') and not phandle:
+                    phandle = fdt_util.fdt32_to_cpu(prop.bytes[:4])
+                elif prop.name == 'ibm,phandle':
+                    phandle = fdt_util.fdt32_to_cpu(prop.bytes[:4])
+                elif prop.name == 'name':
+                    name = offset
+                elif prop.name == 'device_type':
+                    dev_type = offset
+                props.append((prop.name, len(prop.bytes), offset))
+
+            # Recreate the name property from the unit name, like of_live
+            if name is None:
+                unit = '' if node.parent is None else node.name
+                if '@' in unit:
+                    unit = unit[:unit.rfind('@')]
+                name = _add_value(unit + '\0')
+                props.append(('name', len(unit) + 1, name))
+            node_info.append((first, len(props), phandle, name, dev_type))
+
+        self.out_header()
+        self.out('#include <common.h>\n')
+        self.out('#include <of_live.h>\n')
+        self.out('#include <dm/of.h>\n')
+        self.out('\n')
+        self.out('static const u8 dtl_values[] __aligned(4) = {')
+        for i, val in enumerate(values):
+            self.out('%s0x%02x,' % ('\n\t' if not i % 12 else ' ', val))
+        self.out('\n};\n\n')
+
+        self.out('static struct property dtl_props[%d];\n' % len(props))
+        self.out('static struct device_node dtl_nodes[%d];\n' % len(nodes))
+        self.out('\n')
+
+        self.out('static struct property dtl_props[%d] = {\n' % len(props))
+        for first, last, _, _, _ in node_info:
+            for i in range(first, last):
+                prop_name, length, offset = props[i]
+                self.out('\t[%d] = {\n' % i)
+                self.out('\t\t.name\t\t= (char *)"%s",\n' % prop_name)
+                self.out('\t\t.length\t\t= %d,\n' % length)
+                self.out('\t\t.value\t\t= (void *)&dtl_values[%d],\n' %
+                         offset)
+                if i + 1 < last:
+                    self.out('\t\t.next\t\t= &dtl_props[%d],\n' % (i + 1))
+                self.out('\t},\n')
+        self.out('};\n\n')
+
+        self.out('static struct device_node dtl_nodes[%d] = {\n' % len(nodes))
+        for i, node in enumerate(nodes):
+            first, last, phandle, name, dev_type = node_info[i]
+            self.out('\t[%d] = {\n' % i)
+            self.out('\t\t.name\t\t= (const char *)&dtl_values[%d],\n' %
+                     name)
+            if dev_type is None:
+                self.out('\t\t.type\t\t= "<NULL>",\n')
+            else:
+                self.out('\t\t.type\t\t= (const char *)&dtl_values[%d],\n'
+                         % dev_type)
+            if phandle:
+                self.out('\t\t.phandle\t= %#x,\n' % phandle)
+            self.out('\t\t.full_name\t= "%s",\n' % node.path)
+            self.out('\t\t.properties\t= &dtl_props[%d],\n' % first)
+            if node.parent is not None:
+                self.out('\t\t.parent\t\t= &dtl_nodes[%d],\n' %
+                         node_index[node.parent.path])
+            if node.subnodes:
+                self.out('\t\t.child\t\t= &dtl_nodes[%d],\n' %
+                         node_index[node.subnodes[0].path])
+            if node.parent is not None:
+                siblings = node.parent.subnodes
+                pos = siblings.index(node)
+                if pos + 1 < len(siblings):
+                    self.out('\t\t.sibling\t= &dtl_nodes[%d],\n' %
+                             node_index[siblings[pos + 1].path])
+            self.out('\t},\n')
+        self.out('};\n\n')
+
+        contents = str(self._fdt.GetContents())
+        self.out('const struct of_live_image of_live_image = {\n')
+        self.out('\t.fdt_size\t= %#x,\n' % len(contents))
+        self.out('\t.fdt_crc\t= %#x,\n' % (zlib.crc32(contents) & 0xffffffff))
+        self.out('\t.root\t\t= &dtl_nodes[0],\n')
+        self.out('};\n')
+
 def run_steps(args, dtb_file, include_disabled, output):
     """Run all the steps of the dtoc tool
 
@@ -556,10 +681,15 @@ def run_steps(args, dtb_file, include_disabled, output):
         output: Name of output file
     """
     if not args:
-        raise ValueError('Please specify a command: struct, platdata')
+        raise ValueError('Please specify a command: struct, platdata, '
+                         'livetree')
 
     plat = DtbPlatdata(dtb_file, include_disabled)
     plat.scan_dtb()
+    if args[0] == 'livetree':
+        plat.setup_output(output)
+        plat.generate_livetree()
+        return
     plat.scan_tree()
     plat.scan_reg_sizes()
     plat.setup_output(output)
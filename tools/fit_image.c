@@ -23,6 +23,66 @@
 
 static image_header_t header;
 
+/**
+ * fit_add_compat_index() - Copy each fdt's compatible list to its configuration
+ *
+ * fit_conf_find_compat() then matches configurations on their own compatible
+ * property and need not look at the fdts. Configurations that have one
+ * already, or whose fdt is compressed, are left alone.
+ *
+ * @params:	mkimage parameters
+ * @fit:	FIT with all data internal
+ * @return 0 if OK, -ENOSPC if the FIT needs more space, other -ve on error
+ */
+static int fit_add_compat_index(struct image_tool_params *params, void *fit)
+{
+	int confs_noffset, images_noffset, noffset, fdt_noffset;
+	const char *fdt_name;
+	const void *data;
+	const void *compat;
+	size_t size;
+	char *copy;
+	int len;
+	int ret;
+
+	confs_noffset = fdt_path_offset(fit, FIT_CONFS_PATH);
+	images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (confs_noffset < 0 || images_noffset < 0)
+		return 0;
+
+	fdt_for_each_subnode(noffset, fit, confs_noffset) {
+		if (fdt_getprop(fit, noffset, FIT_COMPATIBLE_PROP, NULL))
+			continue;
+		fdt_name = fdt_getprop(fit, noffset, FIT_FDT_PROP, NULL);
+		if (!fdt_name)
+			continue;
+		fdt_noffset = fdt_subnode_offset(fit, images_noffset, fdt_name);
+		if (fdt_noffset < 0 ||
+		    fit_image_get_data(fit, fdt_noffset, &data, &size))
+			continue;
+		if (fdt_check_header(data)) {
+			fprintf(stderr, "%s: Can't index compressed fdt '%s'\n",
+				params->cmdname, fdt_name);
+			continue;
+		}
+		compat = fdt_getprop(data, 0, FIT_COMPATIBLE_PROP, &len);
+		if (!compat)
+			continue;
+
+		/* Adding the property moves the fdt data */
+		copy = malloc(len);
+		if (!copy)
+			return -ENOMEM;
+		memcpy(copy, compat, len);
+		ret = fdt_setprop(fit, noffset, FIT_COMPATIBLE_PROP, copy, len);
+		free(copy);
+		if (ret)
+			return ret == -FDT_ERR_NOSPACE ? -ENOSPC : -EIO;
+	}
+
+	return 0;
+}
+
 static int fit_add_file_data(struct image_tool_params *params, size_t size_inc,
 			     const char *tmpfile)
 {
@@ -56,6 +116,9 @@ static int fit_add_file_data(struct image_tool_params *params, size_t size_inc,
 		ret = fit_set_timestamp(ptr, 0, time);
 	}
 
+	if (!ret && params->compat_index)
+		ret = fit_add_compat_index(params, ptr);
+
 	if (!ret) {
 		ret = fit_add_verification_data(params->keydir, dest_blob, ptr,
 						params->comment,
@@ -397,6 +460,27 @@ err_buf:
 	return -1;
 }
 
+/*
+ * Offset of the data of an image from @base, the start of the external data
+ * in the file, at or after @ptr. With -B the data starts on a block boundary
+ * or, for an image with a load address that is not block aligned, at the
+ * same offset into a block as the load address, so that it can be read to
+ * its load address in whole blocks.
+ */
+static int fit_extract_align(struct image_tool_params *params, void *fdt,
+			     int node, int base, int ptr)
+{
+	int align = params->bl_len;
+	ulong load;
+
+	if (!align)
+		return (ptr + 3) & ~3;
+	if (fit_image_get_load(fdt, node, &load))
+		load = 0;
+
+	return ptr + ((load - base - ptr) & (align - 1));
+}
+
 /**
  * fit_extract_data() - Move all data outside the FIT
  *
@@ -410,8 +494,8 @@ err_buf:
  */
 static int fit_extract_data(struct image_tool_params *params, const char *fname)
 {
-	void *buf;
-	int buf_ptr;
+	void *buf = NULL, *out = NULL;
+	int buf_ptr, out_ptr;
 	int fit_size, new_size;
 	int fd;
 	struct stat sbuf;
@@ -419,6 +503,7 @@ static int fit_extract_data(struct image_tool_params *params, const char *fname)
 	int ret;
 	int images;
 	int node;
+	int count;
 
 	fd = mmap_fdt(params->cmdname, fname, 0, &fdt, &sbuf, false);
 	if (fd < 0)
@@ -432,6 +517,7 @@ static int fit_extract_data(struct image_tool_params *params, const char *fname)
 		goto err_munmap;
 	}
 	buf_ptr = 0;
+	count = 0;
 
 	images = fdt_path_offset(fdt, FIT_IMAGES_PATH);
 	if (images < 0) {
@@ -440,6 +526,10 @@ static int fit_extract_data(struct image_tool_params *params, const char *fname)
 		goto err_munmap;
 	}
 
+	/*
+	 * Take the data out first; where it goes depends on the final size of
+	 * the FIT, so the offsets are only filled in below.
+	 */
 	for (node = fdt_first_subnode(fdt, images);
 	     node >= 0;
 	     node = fdt_next_subnode(fdt, node)) {
@@ -457,34 +547,21 @@ static int fit_extract_data(struct image_tool_params *params, const char *fname)
 			ret = -EPERM;
 			goto err_munmap;
 		}
-		if (params->external_offset > 0) {
-			/* An external offset positions the data absolutely. */
-			fdt_setprop_u32(fdt, node, FIT_DATA_POSITION_PROP,
-					params->external_offset + buf_ptr);
-		} else {
-			fdt_setprop_u32(fdt, node, FIT_DATA_OFFSET_PROP,
-					buf_ptr);
-		}
+		fdt_setprop_u32(fdt, node, params->external_offset > 0 ?
+				FIT_DATA_POSITION_PROP : FIT_DATA_OFFSET_PROP,
+				0);
 		fdt_setprop_u32(fdt, node, FIT_DATA_SIZE_PROP, len);
 
-		buf_ptr += (len + 3) & ~3;
+		buf_ptr += len;
+		count++;
 	}
 
 	/* Pack the FDT and place the data after it */
 	fdt_pack(fdt);
 
 	debug("Size reduced from %x to %x\n", fit_size, fdt_totalsize(fdt));
-	debug("External data size %x\n", buf_ptr);
 	new_size = fdt_totalsize(fdt);
 	new_size = (new_size + 3) & ~3;
-	munmap(fdt, sbuf.st_size);
-
-	if (ftruncate(fd, new_size)) {
-		debug("%s: Failed to truncate file: %s\n", __func__,
-		      strerror(errno));
-		ret = -EIO;
-		goto err;
-	}
 
 	/* Check if an offset for the external data was set. */
 	if (params->external_offset > 0) {
@@ -492,22 +569,71 @@ static int fit_extract_data(struct image_tool_params *params, const char *fname)
 			debug("External offset %x overlaps FIT length %x",
 			      params->external_offset, new_size);
 			ret = -EINVAL;
-			goto err;
+			goto err_munmap;
 		}
 		new_size = params->external_offset;
 	}
+
+	out = calloc(1, buf_ptr + count * (params->bl_len + 3));
+	if (!out) {
+		ret = -ENOMEM;
+		goto err_munmap;
+	}
+	buf_ptr = 0;
+	out_ptr = 0;
+	for (node = fdt_first_subnode(fdt, images);
+	     node >= 0;
+	     node = fdt_next_subnode(fdt, node)) {
+		int len;
+
+		if (fdt_getprop(fdt, node, FIT_DATA_PROP, NULL))
+			continue;
+		len = fdtdec_get_int(fdt, node, FIT_DATA_SIZE_PROP, -1);
+		if (len < 0)
+			continue;
+
+		out_ptr = fit_extract_align(params, fdt, node, new_size,
+					    out_ptr);
+		memcpy(out + out_ptr, buf + buf_ptr, len);
+		if (params->external_offset > 0) {
+			/* An external offset positions the data absolutely. */
+			ret = fdt_setprop_inplace_u32(fdt, node,
+						      FIT_DATA_POSITION_PROP,
+						      new_size + out_ptr);
+		} else {
+			ret = fdt_setprop_inplace_u32(fdt, node,
+						      FIT_DATA_OFFSET_PROP,
+						      out_ptr);
+		}
+		if (ret) {
+			ret = -EPERM;
+			goto err_munmap;
+		}
+		buf_ptr += len;
+		out_ptr += len;
+	}
+	debug("External data size %x\n", out_ptr);
+	munmap(fdt, sbuf.st_size);
+
+	if (ftruncate(fd, new_size)) {
+		debug("%s: Failed to truncate file: %s\n", __func__,
+		      strerror(errno));
+		ret = -EIO;
+		goto err;
+	}
 	if (lseek(fd, new_size, SEEK_SET) < 0) {
 		debug("%s: Failed to seek to end of file: %s\n", __func__,
 		      strerror(errno));
 		ret = -EIO;
 		goto err;
 	}
-	if (write(fd, buf, buf_ptr) != buf_ptr) {
+	if (write(fd, out, out_ptr) != out_ptr) {
 		debug("%s: Failed to write external data to file %s\n",
 		      __func__, strerror(errno));
 		ret = -EIO;
 		goto err;
 	}
+	free(out);
 	free(buf);
 	close(fd);
 	return 0;
@@ -515,8 +641,8 @@ static int fit_extract_data(struct image_tool_params *params, const char *fname)
 err_munmap:
 	munmap(fdt, sbuf.st_size);
 err:
-	if (buf)
-		free(buf);
+	free(out);
+	free(buf);
 	close(fd);
 	return ret;
 }
@@ -74,8 +74,10 @@ struct image_tool_params {
 	struct content_info *content_head;	/* List of files to include */
 	struct content_info *content_tail;
 	bool external_data;	/* Store data outside the FIT */
+	bool compat_index;	/* Copy fdt compatibles to the configurations */
 	bool quiet;		/* Don't output text in normal operation */
 	unsigned int external_offset;	/* Add padding to external data */
+	unsigned int bl_len;	/* Block size to align external data to */
 	const char *engine_id;	/* Engine to use for signing */
 };
 
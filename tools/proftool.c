@@ -55,6 +55,8 @@ struct func_info *func_list;
 int func_count;
 struct trace_call *call_list;
 int call_count;
+struct trace_sample *sample_list;
+int sample_count;
 int verbose;	/* Verbosity level 0=none, 1=warn, 2=notice, 3=info, 4=debug */
 unsigned long text_offset;		/* text address of first function */
 
@@ -85,6 +87,7 @@ static void usage(void)
 		"\n"
 		"Commands\n"
 		"   dump-ftrace\t\tDump out textual data in ftrace format\n"
+		"   dump-folded\t\tDump out samples as folded stacks\n"
 		"\n"
 		"Options:\n"
 		"   -m <map>\tSpecify Systen.map file\n"
@@ -226,6 +229,22 @@ static int read_calls(FILE *fin, int count)
 	return 0;
 }
 
+static int read_samples(FILE *fin, int count)
+{
+	notice("sample count: %d\n", count);
+	sample_list = (struct trace_sample *)calloc(count,
+						    sizeof(*sample_list));
+	if (!sample_list) {
+		error("Cannot allocate sample_list\n");
+		return -1;
+	}
+	sample_count = count;
+
+	if (count && read_data(fin, sample_list, count * sizeof(*sample_list)))
+		return 1;
+	return 0;
+}
+
 static int read_profile(FILE *fin, int *not_found)
 {
 	struct trace_output_hdr hdr;
@@ -249,6 +268,11 @@ static int read_profile(FILE *fin, int *not_found)
 			if (read_calls(fin, hdr.rec_count))
 				return 1;
 			break;
+
+		case TRACE_CHUNK_SAMPLES:
+			if (read_samples(fin, hdr.rec_count))
+				return 1;
+			break;
 		}
 	}
 	return 0;
@@ -532,6 +556,78 @@ static int make_ftrace(void)
 	return 0;
 }
 
+/* A stack seen by the sampling profiler */
+struct folded_stack {
+	struct func_info *caller;	/* function containing LR, or NULL */
+	struct func_info *func;		/* function containing PC */
+};
+
+static int h_cmp_folded(const void *v1, const void *v2)
+{
+	const struct folded_stack *s1 = v1, *s2 = v2;
+
+	if (s1->caller != s2->caller)
+		return s1->caller < s2->caller ? -1 : 1;
+	if (s1->func != s2->func)
+		return s1->func < s2->func ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Output the samples as folded stacks for flamegraph.pl, one line for each
+ * stack with the number of samples:
+ *
+ * run_command_list;memcpy 42
+ *
+ * Only the PC and LR are sampled, so stacks are at most two deep. LR is
+ * the return address of the last call, which in a function that is not a
+ * leaf usually points back into the function itself; then only the
+ * function is shown.
+ */
+static int make_folded(void)
+{
+	struct folded_stack *stacks, *stack;
+	int missing_count = 0;
+	int i, n, count;
+
+	stacks = calloc(sample_count, sizeof(*stacks));
+	if (sample_count && !stacks) {
+		error("Cannot allocate stacks\n");
+		return -1;
+	}
+	for (i = 0, n = 0; i < sample_count; i++) {
+		struct trace_sample *sample = &sample_list[i];
+
+		stack = &stacks[n];
+		stack->func = find_caller_by_offset(sample->pc & ~1);
+		if (!stack->func) {
+			missing_count++;
+			continue;
+		}
+		/* LR follows the call instruction; bit 0 is set for Thumb */
+		stack->caller = find_caller_by_offset((sample->lr & ~1) - 1);
+		if (stack->caller == stack->func)
+			stack->caller = NULL;
+		n++;
+	}
+	qsort(stacks, n, sizeof(*stacks), h_cmp_folded);
+
+	for (i = 0; i < n; i += count) {
+		stack = &stacks[i];
+		for (count = 1; i + count < n; count++) {
+			if (h_cmp_folded(stack, &stacks[i + count]))
+				break;
+		}
+		if (stack->caller)
+			printf("%s;", stack->caller->name);
+		printf("%s %d\n", stack->func->name, count);
+	}
+	info("folded: %d samples not found\n", missing_count);
+	free(stacks);
+
+	return 0;
+}
+
 static int prof_tool(int argc, char * const argv[],
 		     const char *prof_fname, const char *map_fname,
 		     const char *trace_config_fname)
@@ -552,6 +648,8 @@ static int prof_tool(int argc, char * const argv[],
 
 		if (0 == strcmp(cmd, "dump-ftrace"))
 			err = make_ftrace();
+		else if (0 == strcmp(cmd, "dump-folded"))
+			err = make_folded();
 		else
 			warn("Unknown command '%s'\n", cmd);
 	}